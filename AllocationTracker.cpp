@@ -0,0 +1,670 @@
+﻿#include "AllocationTracker.h"
+#include "EngineWin.h"
+#include <DbgHelp.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "imgui/imgui.h"
+
+#pragma comment(lib, "Dbghelp.lib")
+
+namespace
+{
+	using Tag = AllocationTracker::Tag;
+	constexpr auto TagNum = static_cast<size_t>(Tag::Num);
+
+	struct TagCounters
+	{
+		std::atomic<unsigned long long> AllocationNum {0u};
+		std::atomic<unsigned long long> AllocatedBytes {0u};
+		std::atomic<unsigned long long> FreedNum {0u};
+		std::atomic<unsigned long long> FreedBytes {0u};
+	};
+
+	// One per thread on lines of their own, so counting never contends. Frees count under the tag the block was allocated with.
+	struct alignas(64) ThreadCounters
+	{
+		std::array<TagCounters, TagNum> Tags;
+	};
+
+	// The last slot is shared by the threads past MaxThreadNum, which is why counting adds atomically.
+	std::array<ThreadCounters, AllocationTracker::MaxThreadNum + 1u> Counters;
+	std::atomic<unsigned int> ClaimedThreadNum {0u};
+
+	thread_local ThreadCounters* CurrentCounters {nullptr};
+	thread_local Tag CurrentTag {Tag::Untagged};
+	thread_local unsigned int SinceSample {0u};
+
+	std::atomic<unsigned int> SampleInterval {0u};
+
+	// Written by whichever thread draws the slot, readers copy it and keep it only when its sequence didn't change meanwhile.
+	struct Sample
+	{
+		// The index the slot was written at plus one, zero while it is being written.
+		std::atomic<unsigned long long> Sequence {0u};
+		void* Frames[AllocationTracker::MaxStackDepth] {};
+		unsigned long Hash {0u};
+		unsigned int FrameNum {0u};
+		// How many allocations the sample stands for.
+		unsigned int Interval {0u};
+		size_t Size {0u};
+		Tag Owner {Tag::Untagged};
+	};
+
+	std::array<Sample, AllocationTracker::SampleNum> Samples;
+	std::atomic<unsigned long long> SampleWrittenNum {0u};
+
+	// Sits right before every block, which keeps the default 16 byte alignment of what it precedes.
+	struct alignas(16) BlockHeader
+	{
+		size_t Size;
+		Tag Owner;
+	};
+
+	static_assert(sizeof(BlockHeader) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == 0u, "Blocks must stay aligned after their header");
+
+	ThreadCounters& GetThreadCounters() noexcept
+	{
+		if (!CurrentCounters)
+		{
+			const auto Index = ClaimedThreadNum.fetch_add(1u, std::memory_order_relaxed);
+			CurrentCounters = &Counters[std::min(Index, AllocationTracker::MaxThreadNum)];
+		}
+
+		return *CurrentCounters;
+	}
+
+	__declspec(noinline) void RecordSample(const size_t InSize, const unsigned int InInterval) noexcept
+	{
+		const auto Index = SampleWrittenNum.fetch_add(1u, std::memory_order_relaxed);
+		auto& Slot = Samples[Index % Samples.size()];
+
+		Slot.Sequence.store(0u, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		// Leaves out this frame, the ones of the hooks are left out by name when reported.
+		Slot.FrameNum = RtlCaptureStackBackTrace(1u, AllocationTracker::MaxStackDepth, Slot.Frames, &Slot.Hash);
+		Slot.Interval = InInterval;
+		Slot.Size = InSize;
+		Slot.Owner = CurrentTag;
+
+		Slot.Sequence.store(Index + 1u, std::memory_order_release);
+	}
+
+	void CountAllocation(const size_t InSize) noexcept
+	{
+		auto& Counted = GetThreadCounters().Tags[static_cast<size_t>(CurrentTag)];
+		Counted.AllocationNum.fetch_add(1u, std::memory_order_relaxed);
+		Counted.AllocatedBytes.fetch_add(InSize, std::memory_order_relaxed);
+
+		if (const auto Interval = SampleInterval.load(std::memory_order_relaxed); Interval && ++SinceSample >= Interval)
+		{
+			SinceSample = 0u;
+			RecordSample(InSize, Interval);
+		}
+	}
+
+	// Over-aligned blocks keep their header in the last 16 bytes of a whole alignment before them.
+	void* Allocate(const size_t InSize, const size_t InAlignment)
+	{
+		const auto Offset = std::max(InAlignment, sizeof(BlockHeader));
+
+		while (true)
+		{
+			auto* const Block = static_cast<char*>(InAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? _aligned_malloc(InSize + Offset, InAlignment)
+			                                                                                     : std::malloc(InSize + Offset));
+
+			if (Block)
+			{
+				auto* const Header = reinterpret_cast<BlockHeader*>(Block + Offset) - 1;
+				Header->Size = InSize;
+				Header->Owner = CurrentTag;
+				CountAllocation(InSize);
+				return Block + Offset;
+			}
+
+			const auto Handler = std::get_new_handler();
+
+			if (!Handler)
+			{
+				throw std::bad_alloc();
+			}
+
+			Handler();
+		}
+	}
+
+	void Free(void* const InPointer, const size_t InAlignment) noexcept
+	{
+		if (!InPointer)
+		{
+			return;
+		}
+
+		const auto& Header = *(static_cast<const BlockHeader*>(InPointer) - 1);
+		auto& Counted = GetThreadCounters().Tags[static_cast<size_t>(Header.Owner)];
+		Counted.FreedNum.fetch_add(1u, std::memory_order_relaxed);
+		Counted.FreedBytes.fetch_add(Header.Size, std::memory_order_relaxed);
+
+		auto* const Block = static_cast<char*>(InPointer) - std::max(InAlignment, sizeof(BlockHeader));
+
+		if (InAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			_aligned_free(Block);
+		}
+		else
+		{
+			std::free(Block);
+		}
+	}
+
+	struct Totals
+	{
+		unsigned long long AllocationNum {0u};
+		unsigned long long AllocatedBytes {0u};
+		unsigned long long FreedNum {0u};
+		unsigned long long FreedBytes {0u};
+	};
+
+	// Only touched by the thread driving BeginFrame.
+	struct ReportState
+	{
+		std::array<Totals, TagNum> Previous {};
+		std::array<AllocationTracker::Statistics, TagNum> LastFrame {};
+		std::array<float, AllocationTracker::WindowFrameNum> FrameAllocationNums {};
+		unsigned int Cursor {0u};
+		// Samples written before this are left out of the report.
+		unsigned long long FirstReportedSample {0u};
+		int ShownInterval {64};
+	};
+
+	ReportState& GetReportState() noexcept
+	{
+		static ReportState State;
+		return State;
+	}
+
+	struct ResolvedFrame
+	{
+		std::string Symbol;
+		std::string Location;
+		// Frames of the hooks and of the standard library, which the call site is never reported as.
+		bool bIsAllocator;
+	};
+
+	// DbgHelp isn't thread safe, only the window resolves.
+	const ResolvedFrame& Resolve(void* const InAddress)
+	{
+		static std::unordered_map<void*, ResolvedFrame> Resolved;
+		static const auto bHasSymbols = []
+		{
+			SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+			return SymInitialize(GetCurrentProcess(), nullptr, TRUE) != FALSE;
+		}();
+
+		if (const auto Found = Resolved.find(InAddress); Found != Resolved.end())
+		{
+			return Found->second;
+		}
+
+		char AddressText[32];
+		std::snprintf(AddressText, sizeof(AddressText), "0x%p", InAddress);
+		ResolvedFrame Frame {AddressText, {}, false};
+
+		alignas(SYMBOL_INFO) char SymbolBuffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME] {};
+		auto* const Symbol = reinterpret_cast<SYMBOL_INFO*>(SymbolBuffer);
+		Symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+		Symbol->MaxNameLen = MAX_SYM_NAME;
+		const auto Address = reinterpret_cast<DWORD64>(InAddress);
+
+		if (bHasSymbols && SymFromAddr(GetCurrentProcess(), Address, nullptr, Symbol))
+		{
+			Frame.Symbol = Symbol->Name;
+		}
+
+		IMAGEHLP_LINE64 Line {};
+		Line.SizeOfStruct = sizeof(Line);
+		DWORD Displacement = 0u;
+
+		if (bHasSymbols && SymGetLineFromAddr64(GetCurrentProcess(), Address, &Displacement, &Line))
+		{
+			const auto* const FileName = std::strrchr(Line.FileName, '\\');
+			Frame.Location = std::string(FileName ? FileName + 1 : Line.FileName) + ':' + std::to_string(Line.LineNumber);
+		}
+
+		Frame.bIsAllocator = Frame.Symbol.starts_with("std::") || Frame.Symbol.find("operator new") != std::string::npos
+		                     || Frame.Location.starts_with("AllocationTracker.cpp:");
+
+		return Resolved.emplace(InAddress, std::move(Frame)).first->second;
+	}
+
+	struct CallSite
+	{
+		std::vector<void*> Frames;
+		Tag Owner;
+		unsigned int SampleNum {0u};
+		unsigned long long EstimatedNum {0u};
+		unsigned long long SampledBytes {0u};
+	};
+
+	std::vector<CallSite> CollectCallSites(const unsigned long long InFirst)
+	{
+		std::unordered_map<unsigned long long, CallSite> Sites;
+		const auto WrittenNum = SampleWrittenNum.load(std::memory_order_acquire);
+		const auto First = std::max(InFirst, WrittenNum > Samples.size() ? WrittenNum - Samples.size() : 0u);
+
+		for (auto Index = First; Index < WrittenNum; ++Index)
+		{
+			const auto& Slot = Samples[Index % Samples.size()];
+
+			if (Slot.Sequence.load(std::memory_order_acquire) != Index + 1u)
+			{
+				continue;
+			}
+
+			std::array<void*, AllocationTracker::MaxStackDepth> Frames;
+			const auto FrameNum = std::min(Slot.FrameNum, AllocationTracker::MaxStackDepth);
+			std::copy_n(Slot.Frames, FrameNum, Frames.begin());
+			const auto Hash = Slot.Hash;
+			const auto Interval = Slot.Interval;
+			const auto Size = Slot.Size;
+			const auto Owner = Slot.Owner;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			if (Slot.Sequence.load(std::memory_order_relaxed) != Index + 1u)
+			{
+				continue;
+			}
+
+			// The same stack allocating under different tags is reported apart.
+			auto& Site = Sites[static_cast<unsigned long long>(Hash) << 8u | static_cast<unsigned long long>(Owner)];
+
+			if (Site.SampleNum == 0u)
+			{
+				Site.Frames.assign(Frames.begin(), Frames.begin() + FrameNum);
+				Site.Owner = Owner;
+			}
+
+			++Site.SampleNum;
+			Site.EstimatedNum += Interval;
+			Site.SampledBytes += Size;
+		}
+
+		std::vector<CallSite> Sorted;
+		Sorted.reserve(Sites.size());
+
+		for (auto& [Key, Site] : Sites)
+		{
+			Sorted.push_back(std::move(Site));
+		}
+
+		std::sort(Sorted.begin(), Sorted.end(), [](const CallSite& InLeft, const CallSite& InRight)
+		{
+			return InLeft.EstimatedNum > InRight.EstimatedNum;
+		});
+
+		return Sorted;
+	}
+
+	void ShowCallSites(const ReportState& InState)
+	{
+		const auto Sites = CollectCallSites(InState.FirstReportedSample);
+
+		if (Sites.empty())
+		{
+			ImGui::TextUnformatted("No samples yet");
+			return;
+		}
+
+		constexpr auto TableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+
+		if (!ImGui::BeginTable("CallSites", 5, TableFlags, {0.0f, 300.0f}))
+		{
+			return;
+		}
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Call site", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Tag");
+		ImGui::TableSetupColumn("Samples");
+		ImGui::TableSetupColumn("Allocations");
+		ImGui::TableSetupColumn("Avg bytes");
+		ImGui::TableHeadersRow();
+
+		for (size_t Index = 0u; Index < std::min(Sites.size(), static_cast<size_t>(AllocationTracker::ReportedSiteNum)); ++Index)
+		{
+			const auto& Site = Sites[Index];
+			const auto Caller = std::find_if(Site.Frames.begin(), Site.Frames.end(), [](void* const InFrame)
+			{
+				return !Resolve(InFrame).bIsAllocator;
+			});
+			const auto& Shown = Caller != Site.Frames.end() ? Resolve(*Caller) : Resolve(Site.Frames.empty() ? nullptr : Site.Frames.front());
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::PushID(static_cast<int>(Index));
+			const auto bIsOpen = ImGui::TreeNode("Site", "%s %s", Shown.Symbol.c_str(), Shown.Location.c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(AllocationTracker::GetTagName(Site.Owner));
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", Site.SampleNum);
+			ImGui::TableNextColumn();
+			ImGui::Text("~%llu", Site.EstimatedNum);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", Site.SampledBytes / Site.SampleNum);
+
+			if (bIsOpen)
+			{
+				for (void* const Frame : Site.Frames)
+				{
+					const auto& Resolved = Resolve(Frame);
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::TextDisabled("%s %s", Resolved.Symbol.c_str(), Resolved.Location.c_str());
+				}
+
+				ImGui::TreePop();
+			}
+
+			ImGui::PopID();
+		}
+
+		ImGui::EndTable();
+	}
+}
+
+AllocationTracker::Scope::Scope(const Tag InTag) noexcept
+	: PreviousTag(CurrentTag)
+{
+	CurrentTag = InTag;
+}
+
+AllocationTracker::Scope::~Scope()
+{
+	CurrentTag = PreviousTag;
+}
+
+void AllocationTracker::BeginFrame() noexcept
+{
+	auto& State = GetReportState();
+	std::array<Totals, TagNum> Current {};
+	const auto ThreadNum = std::min(ClaimedThreadNum.load(std::memory_order_relaxed), MaxThreadNum) + 1u;
+
+	for (unsigned int Thread = 0u; Thread < ThreadNum; ++Thread)
+	{
+		// The shared slot is always read, the claimed ones are the first.
+		const auto& Slot = Counters[Thread + 1u == ThreadNum ? MaxThreadNum : Thread];
+
+		for (size_t Index = 0u; Index < TagNum; ++Index)
+		{
+			Current[Index].AllocationNum += Slot.Tags[Index].AllocationNum.load(std::memory_order_relaxed);
+			Current[Index].AllocatedBytes += Slot.Tags[Index].AllocatedBytes.load(std::memory_order_relaxed);
+			Current[Index].FreedNum += Slot.Tags[Index].FreedNum.load(std::memory_order_relaxed);
+			Current[Index].FreedBytes += Slot.Tags[Index].FreedBytes.load(std::memory_order_relaxed);
+		}
+	}
+
+	unsigned long long FrameAllocationNum = 0u;
+
+	for (size_t Index = 0u; Index < TagNum; ++Index)
+	{
+		const auto& Now = Current[Index];
+		const auto& Before = State.Previous[Index];
+
+		State.LastFrame[Index] =
+		{
+			Now.AllocationNum - Before.AllocationNum,
+			Now.AllocatedBytes - Before.AllocatedBytes,
+			static_cast<long long>(Now.AllocatedBytes - Now.FreedBytes),
+			static_cast<long long>(Now.AllocationNum - Now.FreedNum)
+		};
+
+		FrameAllocationNum += State.LastFrame[Index].FrameAllocationNum;
+	}
+
+	State.Previous = Current;
+	State.FrameAllocationNums[State.Cursor] = static_cast<float>(FrameAllocationNum);
+	State.Cursor = (State.Cursor + 1u) % WindowFrameNum;
+}
+
+AllocationTracker::Statistics AllocationTracker::GetLastFrame(const Tag InTag) noexcept
+{
+	return GetReportState().LastFrame[static_cast<size_t>(InTag)];
+}
+
+const char* AllocationTracker::GetTagName(const Tag InTag) noexcept
+{
+	constexpr std::array<const char*, TagNum> Names {"Untagged", "Rendering", "Bindables", "Geometry", "Assets", "Streaming", "Input", "Jobs", "Interface"};
+	return InTag < Tag::Num ? Names[static_cast<size_t>(InTag)] : "Unknown";
+}
+
+AllocationTracker::Tag AllocationTracker::GetCurrentTag() noexcept
+{
+	return CurrentTag;
+}
+
+void AllocationTracker::SetSampleInterval(const unsigned int InInterval) noexcept
+{
+	SampleInterval.store(InInterval, std::memory_order_relaxed);
+}
+
+void AllocationTracker::ShowWindow()
+{
+	ALLOCATION_SCOPE(Interface);
+	auto& State = GetReportState();
+
+	if (!ImGui::Begin("Allocations"))
+	{
+		ImGui::End();
+		return;
+	}
+
+	Statistics Sum {};
+
+	for (size_t Index = 0u; Index < TagNum; ++Index)
+	{
+		Sum.FrameAllocationNum += State.LastFrame[Index].FrameAllocationNum;
+		Sum.FrameBytes += State.LastFrame[Index].FrameBytes;
+		Sum.LiveBytes += State.LastFrame[Index].LiveBytes;
+		Sum.LiveAllocationNum += State.LastFrame[Index].LiveAllocationNum;
+	}
+
+	ImGui::Text("%llu allocations, %.1f KB last frame, %.2f MB live", Sum.FrameAllocationNum, static_cast<double>(Sum.FrameBytes) / 1024.0,
+	            static_cast<double>(Sum.LiveBytes) / (1024.0 * 1024.0));
+	ImGui::PlotLines("##FrameAllocations", State.FrameAllocationNums.data(), static_cast<int>(WindowFrameNum), static_cast<int>(State.Cursor),
+	                 "Allocations per frame", 0.0f, FLT_MAX, {0.0f, 60.0f});
+
+	if (ImGui::BeginTable("Tags", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+	{
+		ImGui::TableSetupColumn("Tag", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Frame allocations");
+		ImGui::TableSetupColumn("Frame KB");
+		ImGui::TableSetupColumn("Live allocations");
+		ImGui::TableSetupColumn("Live MB");
+		ImGui::TableHeadersRow();
+
+		for (size_t Index = 0u; Index < TagNum; ++Index)
+		{
+			const auto& Tagged = State.LastFrame[Index];
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(GetTagName(static_cast<Tag>(Index)));
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", Tagged.FrameAllocationNum);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", static_cast<double>(Tagged.FrameBytes) / 1024.0);
+			ImGui::TableNextColumn();
+			ImGui::Text("%lld", Tagged.LiveAllocationNum);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", static_cast<double>(Tagged.LiveBytes) / (1024.0 * 1024.0));
+		}
+
+		ImGui::EndTable();
+	}
+
+	if (ImGui::CollapsingHeader("Call sites"))
+	{
+		auto bIsSampling = SampleInterval.load(std::memory_order_relaxed) != 0u;
+
+		if (bIsSampling)
+		{
+			State.ShownInterval = static_cast<int>(SampleInterval.load(std::memory_order_relaxed));
+		}
+
+		if (ImGui::Checkbox("Sample", &bIsSampling))
+		{
+			SetSampleInterval(bIsSampling ? static_cast<unsigned int>(State.ShownInterval) : 0u);
+		}
+
+		ImGui::SameLine();
+		ImGui::SetNextItemWidth(100.0f);
+
+		if (ImGui::InputInt("Interval", &State.ShownInterval))
+		{
+			State.ShownInterval = std::max(State.ShownInterval, 1);
+
+			if (bIsSampling)
+			{
+				SetSampleInterval(static_cast<unsigned int>(State.ShownInterval));
+			}
+		}
+
+		ImGui::SameLine();
+
+		if (ImGui::Button("Clear"))
+		{
+			State.FirstReportedSample = SampleWrittenNum.load(std::memory_order_relaxed);
+		}
+
+		ShowCallSites(State);
+	}
+
+	ImGui::End();
+}
+
+#if ALLOCATION_TRACKING_ENABLED
+// Every form is replaced, the runtime's own forwarding between them isn't relied on.
+void* operator new(const size_t InSize)
+{
+	return Allocate(InSize, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](const size_t InSize)
+{
+	return Allocate(InSize, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(const size_t InSize, const std::align_val_t InAlignment)
+{
+	return Allocate(InSize, static_cast<size_t>(InAlignment));
+}
+
+void* operator new[](const size_t InSize, const std::align_val_t InAlignment)
+{
+	return Allocate(InSize, static_cast<size_t>(InAlignment));
+}
+
+void* operator new(const size_t InSize, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return Allocate(InSize, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](const size_t InSize, const std::nothrow_t&) noexcept
+{
+	return operator new(InSize, std::nothrow);
+}
+
+void* operator new(const size_t InSize, const std::align_val_t InAlignment, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return Allocate(InSize, static_cast<size_t>(InAlignment));
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](const size_t InSize, const std::align_val_t InAlignment, const std::nothrow_t&) noexcept
+{
+	return operator new(InSize, InAlignment, std::nothrow);
+}
+
+void operator delete(void* InPointer) noexcept
+{
+	Free(InPointer, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void* InPointer) noexcept
+{
+	Free(InPointer, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* InPointer, size_t) noexcept
+{
+	Free(InPointer, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void* InPointer, size_t) noexcept
+{
+	Free(InPointer, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* InPointer, const std::nothrow_t&) noexcept
+{
+	Free(InPointer, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete[](void* InPointer, const std::nothrow_t&) noexcept
+{
+	Free(InPointer, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void operator delete(void* InPointer, const std::align_val_t InAlignment) noexcept
+{
+	Free(InPointer, static_cast<size_t>(InAlignment));
+}
+
+void operator delete[](void* InPointer, const std::align_val_t InAlignment) noexcept
+{
+	Free(InPointer, static_cast<size_t>(InAlignment));
+}
+
+void operator delete(void* InPointer, size_t, const std::align_val_t InAlignment) noexcept
+{
+	Free(InPointer, static_cast<size_t>(InAlignment));
+}
+
+void operator delete[](void* InPointer, size_t, const std::align_val_t InAlignment) noexcept
+{
+	Free(InPointer, static_cast<size_t>(InAlignment));
+}
+
+void operator delete(void* InPointer, const std::align_val_t InAlignment, const std::nothrow_t&) noexcept
+{
+	Free(InPointer, static_cast<size_t>(InAlignment));
+}
+
+void operator delete[](void* InPointer, const std::align_val_t InAlignment, const std::nothrow_t&) noexcept
+{
+	Free(InPointer, static_cast<size_t>(InAlignment));
+}
+#endif
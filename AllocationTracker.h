@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <cstddef>
+
+// Shipping builds keep the runtime's operator new and delete.
+#ifdef SHIPPING
+	#define ALLOCATION_TRACKING_ENABLED 0
+#else
+	#define ALLOCATION_TRACKING_ENABLED 1
+#endif
+
+#define ALLOCATION_CONCAT_IMPL(InLeft, InRight) InLeft##InRight
+#define ALLOCATION_CONCAT(InLeft, InRight) ALLOCATION_CONCAT_IMPL(InLeft, InRight)
+#if ALLOCATION_TRACKING_ENABLED
+	// Counts what the enclosing block allocates on this thread, and everything it calls, under AllocationTracker::Tag::InTag.
+	#define ALLOCATION_SCOPE(InTag) const AllocationTracker::Scope ALLOCATION_CONCAT(AllocationScope, __LINE__) {AllocationTracker::Tag::InTag}
+#else
+	#define ALLOCATION_SCOPE(InTag)
+#endif
+
+/**
+ * Counts every operator new and delete of the process by the subsystem that made it, through the global operators
+ * AllocationTracker.cpp replaces. Each thread counts into a slot only it writes to, and ALLOCATION_SCOPE sets the tag its
+ * allocations go under. A block is freed under the tag it was allocated with, whichever thread frees it, so live bytes stay exact.
+ * While sampling, every SampleInterval-th allocation of each thread also records its call stack, which the window groups into
+ * the call sites that allocate most.
+ */
+class AllocationTracker
+{
+public:
+	enum class Tag : unsigned char
+	{
+		Untagged,
+		Rendering,
+		Bindables,
+		Geometry,
+		Assets,
+		Streaming,
+		Input,
+		Jobs,
+		Interface,
+		Num
+	};
+
+	class Scope
+	{
+	public:
+		explicit Scope(Tag InTag) noexcept;
+		Scope(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		Scope& operator=(Scope&&) = delete;
+		~Scope();
+
+	private:
+		Tag PreviousTag;
+	};
+
+	struct Statistics
+	{
+		// Made on any thread since the previous BeginFrame.
+		unsigned long long FrameAllocationNum;
+		unsigned long long FrameBytes;
+		long long LiveBytes;
+		long long LiveAllocationNum;
+	};
+
+	// Closes the frame being counted and starts the next one, from the thread driving FrameProfiler::BeginFrame.
+	static void BeginFrame() noexcept;
+	static void ShowWindow();
+
+	// What the frame closed by the last BeginFrame allocated under InTag.
+	[[nodiscard]] static Statistics GetLastFrame(Tag InTag) noexcept;
+	[[nodiscard]] static const char* GetTagName(Tag InTag) noexcept;
+	// What the calling thread allocates under right now.
+	[[nodiscard]] static Tag GetCurrentTag() noexcept;
+
+	// Zero stops sampling, earlier samples stay in the report until overwritten.
+	static void SetSampleInterval(unsigned int InInterval) noexcept;
+
+	static constexpr unsigned int MaxThreadNum {128u};
+	static constexpr unsigned int SampleNum {8192u};
+	static constexpr unsigned int MaxStackDepth {24u};
+	static constexpr unsigned int ReportedSiteNum {32u};
+	static constexpr unsigned int WindowFrameNum {120u};
+};
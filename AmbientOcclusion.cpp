@@ -0,0 +1,177 @@
+﻿#include "AmbientOcclusion.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+AmbientOcclusion::AmbientOcclusion(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView,
+                                   const UINT InWidth, const UINT InHeight)
+	: DepthView(InDepthView), Width(InWidth), Height(InHeight)
+{
+	HRESULT ResultHandle;
+
+	const auto OcclusionBlob = InShaderBundle.Load("AmbientOcclusionCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(OcclusionBlob->GetBufferPointer(), OcclusionBlob->GetBufferSize(), nullptr, &OcclusionShader))
+
+	const auto UpsampleBlob = InShaderBundle.Load("AmbientOcclusionUpsampleCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(UpsampleBlob->GetBufferPointer(), UpsampleBlob->GetBufferSize(), nullptr, &UpsampleShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(OcclusionConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	CreateOcclusionTexture(InDevice);
+
+	const std::vector<std::uint8_t> Unoccluded(UnoccludedSize * UnoccludedSize, 0xFFu);
+	const D3D11_SUBRESOURCE_DATA UnoccludedData {Unoccluded.data(), UnoccludedSize, 0u};
+
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = UnoccludedSize;
+	TextureDesc.Height = UnoccludedSize;
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = Format;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> UnoccludedTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, &UnoccludedData, &UnoccludedTexture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(UnoccludedTexture.Get(), nullptr, &UnoccludedView))
+}
+
+void AmbientOcclusion::Resize(ID3D11Device* InDevice, ID3D11ShaderResourceView* InDepthView, const UINT InWidth, const UINT InHeight)
+{
+	DepthView = InDepthView;
+	Width = InWidth;
+	Height = InHeight;
+	CreateOcclusionTexture(InDevice);
+	// The new texture holds nothing yet, a skipped frame has to clear it again.
+	bIsCleared = false;
+}
+
+void AmbientOcclusion::CreateOcclusionTexture(ID3D11Device* InDevice)
+{
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = Width;
+	TextureDesc.Height = Height;
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = Format;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, nullptr, &Texture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Texture.Get(), nullptr, &OcclusionView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(Texture.Get(), nullptr, &OcclusionUav))
+}
+
+void AmbientOcclusion::Compute(const Graphics& InGraphics, ID3D11UnorderedAccessView* InHalfUav, ID3D11ShaderResourceView* InNormalView)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "SSAO");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+	const auto& Viewport = InGraphics.GetViewport();
+
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMStoreFloat4x4(&Projection, InGraphics.GetProjectionMatrix());
+
+	// Both passes read the same constants, the upsample runs right after this with the buffer still bound.
+	OcclusionConstants Constants {};
+	Constants.View = DirectX::XMMatrixTranspose(InGraphics.GetViewMatrix());
+	Constants.ProjectionParameters = {1.0f / Projection._11, 1.0f / Projection._22, Projection._33, Projection._43};
+	Constants.ViewportSize = {static_cast<UINT>(Viewport.Width), static_cast<UINT>(Viewport.Height)};
+	Constants.HalfSize = {(Constants.ViewportSize.x + 1u) / 2u, (Constants.ViewportSize.y + 1u) / 2u};
+	Constants.Radius = Radius;
+	Constants.ProjectionScale = 0.5f * Viewport.Height * Projection._22;
+	Constants.Intensity = Intensity;
+	Constants.bHasNormals = InNormalView != nullptr;
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	// Depth is read here, and the texture the shading passes read is written by the upsample.
+	auto& Cache = Context.GetStateCache();
+	Cache.SetRenderTarget(nullptr, nullptr);
+	Cache.SetPixelShaderResource(OcclusionSlot, nullptr);
+	InGraphics.ResolveDepth();
+
+	ID3D11ShaderResourceView* const Views[] = {DepthView, InNormalView};
+	static_assert(SourceSlot == DepthSlot + 1u, "Views are bound as one range");
+
+	DeviceContext->CSSetShader(OcclusionShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(DepthSlot, 2u, Views);
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, &InHalfUav, nullptr);
+	InGraphics.Dispatch((Constants.HalfSize.x + GroupSize - 1u) / GroupSize, (Constants.HalfSize.y + GroupSize - 1u) / GroupSize);
+
+	bIsCleared = false;
+}
+
+void AmbientOcclusion::Upsample(const Graphics& InGraphics, ID3D11ShaderResourceView* InHalfView)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "SSAO upsample");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+	const auto& Viewport = InGraphics.GetViewport();
+
+	ID3D11ShaderResourceView* const Views[] = {DepthView, InHalfView};
+
+	DeviceContext->CSSetShader(UpsampleShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(DepthSlot, 2u, Views);
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, OcclusionUav.GetAddressOf(), nullptr);
+
+	const auto GroupNumX = (static_cast<UINT>(Viewport.Width) + GroupSize - 1u) / GroupSize;
+	const auto GroupNumY = (static_cast<UINT>(Viewport.Height) + GroupSize - 1u) / GroupSize;
+	InGraphics.Dispatch(GroupNumX, GroupNumY);
+
+	InGraphics.BindFrameState(Context);
+}
+
+void AmbientOcclusion::Skip(const Graphics& InGraphics)
+{
+	if (bIsCleared)
+	{
+		return;
+	}
+
+	auto& Context = InGraphics.GetImmediateContext();
+	Context.GetStateCache().SetPixelShaderResource(OcclusionSlot, nullptr);
+
+	constexpr float Unoccluded[] = {1.0f, 1.0f, 1.0f, 1.0f};
+	Context.GetDeviceContext()->ClearUnorderedAccessViewFloat(OcclusionUav.Get(), Unoccluded);
+	bIsCleared = true;
+}
+
+void AmbientOcclusion::Bind(RenderContext& InContext) const noexcept
+{
+	InContext.GetStateCache().SetPixelShaderResource(OcclusionSlot, OcclusionView.Get());
+}
+
+void AmbientOcclusion::BindCompute(ID3D11DeviceContext* InContext) const noexcept
+{
+	InContext->CSSetShaderResources(OcclusionSlot, 1u, OcclusionView.GetAddressOf());
+}
+
+void AmbientOcclusion::BindUnoccluded(RenderContext& InContext) const noexcept
+{
+	InContext.GetStateCache().SetPixelShaderResource(OcclusionSlot, UnoccludedView.Get());
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include "wrl/client.h"
+#include "RenderGraph.h"
+
+class Graphics;
+class RenderContext;
+class ShaderBundle;
+
+/**
+ * Screen-space ambient occlusion, which darkens the ambient term where nearby geometry blocks the sky.
+ * A compute pass samples the depth buffer at half resolution around every pixel and stores the occlusion with the
+ * pixel's view depth, then a bilateral upsample brings it to full resolution without bleeding across depth edges.
+ * It needs the depth before anything is shaded, so it runs after the G-buffer while deferred shading is active and
+ * after the depth pre-pass otherwise. The shading passes read the result at their pixel through CalcAmbient.
+ */
+class AmbientOcclusion
+{
+public:
+	static constexpr DXGI_FORMAT HalfResolutionFormat {DXGI_FORMAT_R16G16_FLOAT};
+	static constexpr DXGI_FORMAT Format {DXGI_FORMAT_R8_UNORM};
+	static constexpr UINT UnoccludedSize {256u};
+
+	// The depth view is Graphics', the occlusion texture is the subsystem's own and as large as the scene's targets.
+	AmbientOcclusion(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView, UINT InWidth, UINT InHeight);
+	AmbientOcclusion(const AmbientOcclusion&) = delete;
+	AmbientOcclusion(AmbientOcclusion&&) = delete;
+	AmbientOcclusion& operator=(const AmbientOcclusion&) = delete;
+	AmbientOcclusion& operator=(AmbientOcclusion&&) = delete;
+	~AmbientOcclusion() = default;
+
+	// For Graphics' depth view recreated at InWidth by InHeight, the occlusion texture follows.
+	void Resize(ID3D11Device* InDevice, ID3D11ShaderResourceView* InDepthView, UINT InWidth, UINT InHeight);
+
+	// The intermediate between the two passes, a render graph transient.
+	[[nodiscard]] RenderGraph::TextureDesc GetHalfResolutionDesc() const noexcept
+	{
+		return {(Width + 1u) / 2u, (Height + 1u) / 2u, HalfResolutionFormat, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS};
+	}
+
+	// Occlusion and view depth of the viewport's every other pixel into InHalfUav. The normals come from the G-buffer's
+	// normal target when there is one, otherwise from the depth around each pixel.
+	void Compute(const Graphics& InGraphics, ID3D11UnorderedAccessView* InHalfUav, ID3D11ShaderResourceView* InNormalView);
+	// Leaves the frame state bound again.
+	void Upsample(const Graphics& InGraphics, ID3D11ShaderResourceView* InHalfView);
+	// For frames the passes don't run in, what the shading passes read is reset to no occlusion once.
+	void Skip(const Graphics& InGraphics);
+
+	void Bind(RenderContext& InContext) const noexcept;
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+	// No occlusion anywhere, for draws into targets other than the scene's up to UnoccludedSize square, such as reflection probe faces.
+	void BindUnoccluded(RenderContext& InContext) const noexcept;
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+	// World space distance within which geometry occludes.
+	void SetRadius(const float InRadius) noexcept
+	{
+		Radius = InRadius;
+	}
+
+	[[nodiscard]] float GetRadius() const noexcept
+	{
+		return Radius;
+	}
+
+	void SetIntensity(const float InIntensity) noexcept
+	{
+		Intensity = InIntensity;
+	}
+
+	[[nodiscard]] float GetIntensity() const noexcept
+	{
+		return Intensity;
+	}
+
+private:
+	struct OcclusionConstants
+	{
+		DirectX::XMMATRIX View;
+		DirectX::XMFLOAT4 ProjectionParameters;
+		DirectX::XMUINT2 ViewportSize;
+		DirectX::XMUINT2 HalfSize;
+		float Radius;
+		float ProjectionScale;
+		float Intensity;
+		UINT bHasNormals;
+	};
+
+	// Registers in AmbientOcclusionCS.hlsl and AmbientOcclusionUpsampleCS.hlsl, and the one ShaderOperations.hlsli reads.
+	static constexpr UINT ConstantSlot {0u};
+	static constexpr UINT DepthSlot {0u};
+	static constexpr UINT SourceSlot {1u};
+	static constexpr UINT OutputSlot {0u};
+	static constexpr UINT OcclusionSlot {12u};
+	static constexpr UINT GroupSize {8u};
+
+	void CreateOcclusionTexture(ID3D11Device* InDevice);
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> OcclusionShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> UpsampleShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> OcclusionView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> OcclusionUav;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> UnoccludedView;
+
+	ID3D11ShaderResourceView* DepthView;
+	UINT Width;
+	UINT Height;
+	float Radius {0.5f};
+	float Intensity {1.0f};
+	bool bIsEnabled {true};
+	// Whether the texture still holds no occlusion from an earlier skipped frame.
+	bool bIsCleared {false};
+};
@@ -0,0 +1,29 @@
+// Shared by AmbientOcclusionCS.hlsl and AmbientOcclusionUpsampleCS.hlsl, laid out like AmbientOcclusion::OcclusionConstants.
+cbuffer Occlusion : register(b0)
+{
+    // World to view, for the G-buffer's world space normals.
+    matrix View;
+    // 1 / Projection._11, 1 / Projection._22, Projection._33 and Projection._43, enough to undo the projection.
+    float4 ProjectionParameters;
+    // The part of the targets this frame renders to, from their top left, and the half resolution texels covering it.
+    uint2 ViewportSize;
+    uint2 HalfSize;
+    float Radius;
+    // Full resolution pixels a view space unit spans at a view depth of one.
+    float ProjectionScale;
+    float Intensity;
+    uint bHasNormals;
+}
+
+float LinearizeDepth(const float InDepth)
+{
+    return ProjectionParameters.w / (InDepth - ProjectionParameters.z);
+}
+
+// Through the viewport position InPixelPosition, at the depth buffer's InDepth.
+float3 GetViewPosition(const float2 InPixelPosition, const float InDepth)
+{
+    const float ViewDepth = LinearizeDepth(InDepth);
+    const float2 Ndc = float2(InPixelPosition.x / ViewportSize.x * 2.0f - 1.0f, 1.0f - InPixelPosition.y / ViewportSize.y * 2.0f);
+    return float3(Ndc * ProjectionParameters.xy * ViewDepth, ViewDepth);
+}
@@ -0,0 +1,102 @@
+// Scalable ambient obscurance at half resolution, one thread per texel in 8x8 tiles, each covering the top left pixel
+// of its 2x2 block. Samples lie on a spiral of the world space radius projected to the screen, turned per pixel by
+// interleaved gradient noise, which the upsample's blur then smooths out. Writes the occlusion and the view depth it was
+// computed at, so the upsample can weigh texels by how close they are to the surface of the full resolution pixel.
+#include "AmbientOcclusion.hlsli"
+#include "GBuffer.hlsli"
+
+Texture2D<float> Depth : register(t0);
+Texture2D<float4> NormalPower : register(t1);
+RWTexture2D<float2> HalfOcclusion : register(u0);
+
+#define SAMPLE_NUM 8
+
+static const float SpiralTurns = 3.0f;
+static const float TwoPi = 6.28318530718f;
+// In view space units, keeps flat surfaces from occluding themselves through depth precision.
+static const float Bias = 0.01f;
+static const float Epsilon = 0.01f;
+
+float3 LoadViewPosition(const int2 InPixel)
+{
+    const int2 Pixel = clamp(InPixel, 0, (int2) ViewportSize - 1);
+    return GetViewPosition(Pixel + 0.5f, Depth[Pixel]);
+}
+
+float InterleavedGradientNoise(const float2 InPosition)
+{
+    return frac(52.9829189f * frac(dot(InPosition, float2(0.06711056f, 0.00583715f))));
+}
+
+float3 GetViewNormal(const int2 InPixel, const float3 InPosition)
+{
+    if (bHasNormals)
+    {
+        const float4 Encoded = NormalPower[InPixel];
+
+        // Pixels the G-buffer didn't cover were drawn forward, their normal comes from the depth like without one.
+        if ((uint) round(Encoded.w * 3.0f) != SpecularModeEmpty)
+        {
+            return normalize(mul(DecodeNormal(Encoded.xy), (float3x3) View));
+        }
+    }
+
+    // From the neighbours on the side closer in depth, so silhouettes don't bend the normal towards the background.
+    const float3 Left = LoadViewPosition(InPixel - int2(1, 0));
+    const float3 Right = LoadViewPosition(InPixel + int2(1, 0));
+    const float3 Up = LoadViewPosition(InPixel - int2(0, 1));
+    const float3 Down = LoadViewPosition(InPixel + int2(0, 1));
+
+    const bool bIsRightCloser = InPixel.x == 0 || (InPixel.x + 1 < (int) ViewportSize.x && abs(Right.z - InPosition.z) < abs(InPosition.z - Left.z));
+    const bool bIsDownCloser = InPixel.y == 0 || (InPixel.y + 1 < (int) ViewportSize.y && abs(Down.z - InPosition.z) < abs(InPosition.z - Up.z));
+    const float3 DeltaX = bIsRightCloser ? Right - InPosition : InPosition - Left;
+    const float3 DeltaY = bIsDownCloser ? Down - InPosition : InPosition - Up;
+
+    // Screen Y runs down while view Y runs up, this order faces the camera.
+    return normalize(cross(DeltaX, DeltaY));
+}
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= HalfSize))
+    {
+        return;
+    }
+
+    const int2 Pixel = min(InThreadID.xy * 2u, ViewportSize - 1u);
+    const float DeviceDepth = Depth[Pixel];
+    const float3 Position = GetViewPosition(Pixel + 0.5f, DeviceDepth);
+
+    // Nothing was drawn there, or the radius covers less than a pixel.
+    const float ProjectedRadius = Radius * ProjectionScale / Position.z;
+
+    if (DeviceDepth >= 1.0f || ProjectedRadius < 1.0f)
+    {
+        HalfOcclusion[InThreadID.xy] = float2(1.0f, Position.z);
+        return;
+    }
+
+    const float3 Normal = GetViewNormal(Pixel, Position);
+    const float RadiusSquared = Radius * Radius;
+    const float Rotation = InterleavedGradientNoise(InThreadID.xy) * TwoPi;
+
+    float Obscurance = 0.0f;
+
+    [unroll]
+    for (uint Index = 0u; Index < SAMPLE_NUM; ++Index)
+    {
+        const float Alpha = (Index + 0.5f) / SAMPLE_NUM;
+        const float Angle = Alpha * SpiralTurns * TwoPi + Rotation;
+        const float2 Offset = float2(cos(Angle), sin(Angle)) * Alpha * ProjectedRadius;
+
+        const float3 Delta = LoadViewPosition(int2(Pixel + 0.5f + Offset)) - Position;
+        const float DistanceSquared = dot(Delta, Delta);
+        const float Falloff = max(RadiusSquared - DistanceSquared, 0.0f);
+
+        Obscurance += Falloff * Falloff * Falloff * max((dot(Delta, Normal) - Bias) / (DistanceSquared + Epsilon), 0.0f);
+    }
+
+    const float RadiusPow6 = RadiusSquared * RadiusSquared * RadiusSquared;
+    HalfOcclusion[InThreadID.xy] = float2(saturate(1.0f - Obscurance * Intensity * 5.0f / (RadiusPow6 * SAMPLE_NUM)), Position.z);
+}
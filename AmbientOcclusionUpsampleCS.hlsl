@@ -0,0 +1,43 @@
+// Blurs the half resolution occlusion up to the viewport, one thread per pixel in 8x8 tiles. The 3x3 texels around the
+// pixel are weighed by a tent and by how close their view depth is to the pixel's, so occlusion stays on its surface.
+#include "AmbientOcclusion.hlsli"
+
+Texture2D<float> Depth : register(t0);
+Texture2D<float2> HalfOcclusion : register(t1);
+RWTexture2D<float> Occlusion : register(u0);
+
+// Relative depth difference at which a texel's weight falls to 1/e.
+static const float DepthTolerance = 0.05f;
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= ViewportSize))
+    {
+        return;
+    }
+
+    const float ViewDepth = LinearizeDepth(Depth[InThreadID.xy]);
+    const int2 Center = InThreadID.xy / 2u;
+
+    float Sum = 0.0f;
+    float WeightSum = 0.0f;
+
+    [unroll]
+    for (int Y = -1; Y <= 1; ++Y)
+    {
+        [unroll]
+        for (int X = -1; X <= 1; ++X)
+        {
+            const float2 Texel = HalfOcclusion[clamp(Center + int2(X, Y), 0, (int2) HalfSize - 1)];
+            const float Tent = (2.0f - abs(X)) * (2.0f - abs(Y));
+            const float Weight = Tent * exp(-abs(Texel.y - ViewDepth) / (ViewDepth * DepthTolerance));
+
+            Sum += Texel.x * Weight;
+            WeightSum += Weight;
+        }
+    }
+
+    // A pixel on a surface no neighbouring texel saw takes the nearest as it is.
+    Occlusion[InThreadID.xy] = WeightSum > 1e-4f ? Sum / WeightSum : HalfOcclusion[Center].x;
+}
@@ -0,0 +1,172 @@
+﻿#include "AnimationClip.h"
+#include <algorithm>
+#include <cassert>
+#include "Mesh.h"
+
+AnimationClip::AnimationClip(const MeshCache::AnimationEntry& InEntry, const MeshCache::NodeList& InNodes)
+	: Name(InEntry.Name), Duration(InEntry.Duration)
+{
+	Channels.reserve(InEntry.Channels.size());
+
+	for (const auto& Entry : InEntry.Channels)
+	{
+		assert(Entry.Node < InNodes.size() && "Channel of a node outside the hierarchy");
+
+		DirectX::XMVECTOR BaseScaling;
+		DirectX::XMVECTOR BaseRotation;
+		DirectX::XMVECTOR BaseTranslation;
+		DirectX::XMMatrixDecompose(&BaseScaling, &BaseRotation, &BaseTranslation, DirectX::XMLoadFloat4x4(&InNodes[Entry.Node].Transform));
+
+		auto& Target = Channels.emplace_back();
+		Target.Node = Entry.Node;
+		Target.Translation = AddVectorTrack(Entry.Translations, BaseTranslation);
+		Target.Rotation = AddRotationTrack(Entry.Rotations, BaseRotation);
+		Target.Scaling = AddVectorTrack(Entry.Scalings, BaseScaling);
+	}
+}
+
+void AnimationClip::Sample(const float InTime, const std::span<unsigned int> InOutCursors, NodeHierarchy& InOutHierarchy) const noexcept
+{
+	assert(InOutCursors.size() == GetCursorNum() && "Cursors of another clip");
+
+	for (size_t Index = 0u; Index < Channels.size(); ++Index)
+	{
+		const auto& [Node, Translation, Rotation, Scaling] = Channels[Index];
+		auto* const Cursors = &InOutCursors[Index * TrackNum];
+
+		InOutHierarchy.SetAnimatedTransform(Node, DirectX::XMMatrixScalingFromVector(SampleVector(Scaling, InTime, Cursors[2])) *
+		                                          DirectX::XMMatrixRotationQuaternion(SampleRotation(Rotation, InTime, Cursors[1])) *
+		                                          DirectX::XMMatrixTranslationFromVector(SampleVector(Translation, InTime, Cursors[0])));
+	}
+}
+
+AnimationClip::VectorTrack AnimationClip::AddVectorTrack(const std::vector<MeshCache::KeyEntry>& InKeys, DirectX::FXMVECTOR InDefault)
+{
+	VectorTrack Added {{static_cast<unsigned int>(Times.size()), static_cast<unsigned int>(Vectors.size()), 0u}, {}, {}};
+
+	std::vector<DirectX::XMVECTOR> Values;
+	Values.reserve(std::max<size_t>(InKeys.size(), 1u));
+
+	if (InKeys.empty())
+	{
+		Times.push_back(0.0f);
+		Values.push_back(InDefault);
+	}
+
+	for (const auto& Key : InKeys)
+	{
+		Times.push_back(Key.Time);
+		Values.push_back(DirectX::XMLoadFloat4(&Key.Value));
+	}
+
+	auto Minimum = Values.front();
+	auto Maximum = Values.front();
+
+	for (const auto Value : Values)
+	{
+		Minimum = DirectX::XMVectorMin(Minimum, Value);
+		Maximum = DirectX::XMVectorMax(Maximum, Value);
+	}
+
+	// A constant component keeps a zero extent and decodes to its minimum whatever was stored.
+	const auto Extent = DirectX::XMVectorSubtract(Maximum, Minimum);
+	const auto Scale = DirectX::XMVectorSelect(DirectX::XMVectorReciprocal(Extent), DirectX::XMVectorZero(),
+	                                           DirectX::XMVectorLessOrEqual(Extent, DirectX::XMVectorZero()));
+
+	for (const auto Value : Values)
+	{
+		DirectX::PackedVector::XMUSHORTN4 Packed;
+		DirectX::PackedVector::XMStoreUShortN4(&Packed, DirectX::XMVectorMultiply(DirectX::XMVectorSubtract(Value, Minimum), Scale));
+		Vectors.push_back(Packed);
+	}
+
+	DirectX::XMStoreFloat3(&Added.Minimum, Minimum);
+	DirectX::XMStoreFloat3(&Added.Extent, Extent);
+	Added.KeyNum = static_cast<unsigned int>(Values.size());
+
+	return Added;
+}
+
+AnimationClip::Track AnimationClip::AddRotationTrack(const std::vector<MeshCache::KeyEntry>& InKeys, DirectX::FXMVECTOR InDefault)
+{
+	Track Added {static_cast<unsigned int>(Times.size()), static_cast<unsigned int>(Rotations.size()), 0u};
+	auto Previous = DirectX::XMQuaternionIdentity();
+
+	const auto AddKey = [&](const float InTime, DirectX::FXMVECTOR InRotation)
+	{
+		auto Rotation = DirectX::XMQuaternionNormalize(InRotation);
+
+		// Neighbours in the same hemisphere, so blending them componentwise takes the short way round.
+		if (Added.KeyNum > 0u && DirectX::XMVectorGetX(DirectX::XMQuaternionDot(Previous, Rotation)) < 0.0f)
+		{
+			Rotation = DirectX::XMVectorNegate(Rotation);
+		}
+
+		DirectX::PackedVector::XMSHORTN4 Packed;
+		DirectX::PackedVector::XMStoreShortN4(&Packed, Rotation);
+		Times.push_back(InTime);
+		Rotations.push_back(Packed);
+		Previous = Rotation;
+		++Added.KeyNum;
+	};
+
+	if (InKeys.empty())
+	{
+		AddKey(0.0f, InDefault);
+	}
+
+	for (const auto& Key : InKeys)
+	{
+		AddKey(Key.Time, DirectX::XMLoadFloat4(&Key.Value));
+	}
+
+	return Added;
+}
+
+float AnimationClip::Advance(const Track& InTrack, const float InTime, unsigned int& InOutCursor) const noexcept
+{
+	const auto* const KeyTimes = &Times[InTrack.FirstKey];
+
+	// Looping wrapped around, or the cursors are new.
+	if (InOutCursor >= InTrack.KeyNum || KeyTimes[InOutCursor] > InTime)
+	{
+		InOutCursor = 0u;
+	}
+
+	// A frame usually moves a key or none, at most a handful.
+	while (InOutCursor + 1u < InTrack.KeyNum && KeyTimes[InOutCursor + 1u] <= InTime)
+	{
+		++InOutCursor;
+	}
+
+	if (InOutCursor + 1u >= InTrack.KeyNum || InTime <= KeyTimes[InOutCursor])
+	{
+		return 0.0f;
+	}
+
+	const auto Span = KeyTimes[InOutCursor + 1u] - KeyTimes[InOutCursor];
+	return Span > 0.0f ? (InTime - KeyTimes[InOutCursor]) / Span : 0.0f;
+}
+
+DirectX::XMVECTOR AnimationClip::SampleVector(const VectorTrack& InTrack, const float InTime, unsigned int& InOutCursor) const noexcept
+{
+	const auto Alpha = Advance(InTrack, InTime, InOutCursor);
+	const auto* const Values = &Vectors[InTrack.FirstValue];
+	const auto Next = std::min(InOutCursor + 1u, InTrack.KeyNum - 1u);
+
+	const auto Quantized = DirectX::XMVectorLerp(DirectX::PackedVector::XMLoadUShortN4(&Values[InOutCursor]),
+	                                             DirectX::PackedVector::XMLoadUShortN4(&Values[Next]), Alpha);
+
+	return DirectX::XMVectorMultiplyAdd(Quantized, DirectX::XMLoadFloat3(&InTrack.Extent), DirectX::XMLoadFloat3(&InTrack.Minimum));
+}
+
+DirectX::XMVECTOR AnimationClip::SampleRotation(const Track& InTrack, const float InTime, unsigned int& InOutCursor) const noexcept
+{
+	const auto Alpha = Advance(InTrack, InTime, InOutCursor);
+	const auto* const Values = &Rotations[InTrack.FirstValue];
+	const auto Next = std::min(InOutCursor + 1u, InTrack.KeyNum - 1u);
+
+	// Normalized lerp, close enough to slerp between keys a frame or so apart and renormalizes the quantization away.
+	return DirectX::XMQuaternionNormalize(DirectX::XMVectorLerp(DirectX::PackedVector::XMLoadShortN4(&Values[InOutCursor]),
+	                                                            DirectX::PackedVector::XMLoadShortN4(&Values[Next]), Alpha));
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <span>
+#include <string>
+#include <vector>
+#include "MeshCache.h"
+
+class NodeHierarchy;
+
+/**
+ * One animation of a model laid out for sampling many instances every frame, built once per asset from the cached clip.
+ * Every track's keys sit back to back in structure-of-arrays streams: one array of times, one of rotations quantized to
+ * 16 bits per quaternion component and one of translations and scalings quantized to 16 bits within each track's range.
+ * Sampling walks forward from a cursor per track that the caller keeps, so a clip played forward never searches its keys.
+ */
+class AnimationClip
+{
+public:
+	// What a channel doesn't key is filled in from the node's imported transform, every track has at least one key.
+	AnimationClip(const MeshCache::AnimationEntry& InEntry, const MeshCache::NodeList& InNodes);
+
+	// Cursors start zeroed and are only ever touched by Sample.
+	[[nodiscard]] size_t GetCursorNum() const noexcept
+	{
+		return Channels.size() * TrackNum;
+	}
+
+	// Replaces the local transform of every node the clip animates, InTime within [0, GetDuration()].
+	// Cursors belong to one playback, a time before the last one sampled starts them over.
+	void Sample(float InTime, std::span<unsigned int> InOutCursors, NodeHierarchy& InOutHierarchy) const noexcept;
+
+	[[nodiscard]] const std::string& GetName() const noexcept
+	{
+		return Name;
+	}
+
+	// In seconds.
+	[[nodiscard]] float GetDuration() const noexcept
+	{
+		return Duration;
+	}
+
+private:
+	static constexpr size_t TrackNum {3u};
+
+	// Keys [FirstKey, FirstKey + KeyNum) of the time stream and of the track's value stream from FirstValue on.
+	struct Track
+	{
+		unsigned int FirstKey;
+		unsigned int FirstValue;
+		unsigned int KeyNum;
+	};
+
+	// Translations and scalings decode to Minimum + Quantized * Extent.
+	struct VectorTrack : Track
+	{
+		DirectX::XMFLOAT3 Minimum;
+		DirectX::XMFLOAT3 Extent;
+	};
+
+	struct Channel
+	{
+		unsigned int Node;
+		VectorTrack Translation;
+		Track Rotation;
+		VectorTrack Scaling;
+	};
+
+	[[nodiscard]] VectorTrack AddVectorTrack(const std::vector<MeshCache::KeyEntry>& InKeys, DirectX::FXMVECTOR InDefault);
+	[[nodiscard]] Track AddRotationTrack(const std::vector<MeshCache::KeyEntry>& InKeys, DirectX::FXMVECTOR InDefault);
+	// Interpolation weight between the cursor's key and the next, after moving the cursor up to InTime.
+	[[nodiscard]] float Advance(const Track& InTrack, float InTime, unsigned int& InOutCursor) const noexcept;
+	[[nodiscard]] DirectX::XMVECTOR SampleVector(const VectorTrack& InTrack, float InTime, unsigned int& InOutCursor) const noexcept;
+	[[nodiscard]] DirectX::XMVECTOR SampleRotation(const Track& InTrack, float InTime, unsigned int& InOutCursor) const noexcept;
+
+private:
+	std::string Name;
+	float Duration;
+	std::vector<Channel> Channels;
+	std::vector<float> Times;
+	std::vector<DirectX::PackedVector::XMSHORTN4> Rotations;
+	// W is unused, four components keep every key one aligned load.
+	std::vector<DirectX::PackedVector::XMUSHORTN4> Vectors;
+};
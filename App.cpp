@@ -1,100 +1,1738 @@
 ﻿#include "App.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "AllocationTracker.h"
+#include "AssetArena.h"
+#include "BindManager.h"
+#include "FrameProfiler.h"
 #include "GDIPlusManager.h"
+#include "imgui/imgui.h"
+#include "Logger.h"
+#include "SceneFile.h"
+#include "StartupTimeline.h"
+#include "TelemetryServer.h"
 
 GDIPlusManager GDIPlus;
 
-App::App()
-	: MyWindow(1280, 720, WindowClass::GetName())
+namespace
 {
-	MyWindow.GetGraphics().SetCamera(MyCamera);
+	// The quality preset calibrated for this machine, measured first when there is none for its adapter, driver, CPU and target.
+	// Nothing for --benchmark, whose runs compare builds at the same settings.
+	std::optional<QualityCalibration::Preset> ReadQualityPreset(const std::string_view InCommandLine, const float InTargetMilliseconds,
+	                                                           const float InWindowPixels)
+	{
+		UINT AdapterIndex = 0u;
+		bool bIsCalibrating = false;
+		auto DisplayPixels = InWindowPixels;
+
+		// Malformed arguments are left to ReadSwapChainSettings to report.
+		std::istringstream Arguments {std::string(InCommandLine)};
+		for (std::string Argument; Arguments >> Argument;)
+		{
+			if (Argument == "--benchmark")
+			{
+				return std::nullopt;
+			}
+			else if (Argument == "--calibrate")
+			{
+				bIsCalibrating = true;
+			}
+			else if (Argument == "--adapter")
+			{
+				Arguments >> AdapterIndex;
+			}
+			else if (Argument == "--fullscreen")
+			{
+				DisplayPixels = static_cast<float>(GetSystemMetrics(SM_CXSCREEN)) * static_cast<float>(GetSystemMetrics(SM_CYSCREEN));
+			}
+		}
+
+		const auto Identity = Graphics::IdentifyAdapter(AdapterIndex);
+
+		if (!bIsCalibrating)
+		{
+			if (auto Loaded = QualityCalibration::Load(Identity, InTargetMilliseconds))
+			{
+				return Loaded;
+			}
+		}
+
+		STARTUP_PHASE("Quality calibration");
+
+		// A device of its own, gone before the window's is created.
+		Graphics::Prerequisites Prepared;
+		JobCounter PreparedDone;
+		Graphics::Prepare(AdapterIndex, Prepared, PreparedDone);
+		JobSystem::Get().Wait(PreparedDone);
+
+		QualityCalibration Calibration {Prepared.Device.Get(), Prepared.DeviceContext.Get(), *Prepared.Shaders};
+		const auto Measured = Calibration.Measure();
+
+		if (Measured.FillMilliseconds <= 0.0f)
+		{
+			LOG_WARNING("Calibration: the GPU timings were all disjoint, the default quality is kept");
+			return std::nullopt;
+		}
+
+		const auto Chosen = QualityCalibration::Choose(Measured, InTargetMilliseconds, DisplayPixels, Identity.DedicatedVideoBytes);
+
+		if (!QualityCalibration::Write(Chosen, Measured, Identity, InTargetMilliseconds))
+		{
+			LOG_WARNING("Could not write {}", QualityCalibration::PresetFileName);
+		}
+
+		return Chosen;
+	}
+
+	// What has to be known before the window creates its swap chain, the rest of the command line is read after.
+	// --msaa overrides the preset's samples.
+	SwapChainSettings ReadSwapChainSettings(const std::string_view InCommandLine, const std::optional<QualityCalibration::Preset>& InPreset)
+	{
+		SwapChainSettings Settings;
+
+		if (InPreset)
+		{
+			Settings.SampleNum = InPreset->SampleNum;
+		}
+
+		std::istringstream Arguments {std::string(InCommandLine)};
+		for (std::string Argument; Arguments >> Argument;)
+		{
+			if (Argument == "--msaa" && !(Arguments >> Settings.SampleNum))
+			{
+				throw std::runtime_error("--msaa needs a sample count");
+			}
+			else if (Argument == "--fullscreen")
+			{
+				std::string Mode;
+				Arguments >> Mode;
+
+				if (Mode == "borderless")
+				{
+					Settings.Fullscreen = FullscreenMode::Borderless;
+				}
+				else if (Mode == "exclusive")
+				{
+					Settings.Fullscreen = FullscreenMode::Exclusive;
+				}
+				else
+				{
+					throw std::runtime_error("--fullscreen needs borderless or exclusive");
+				}
+			}
+			else if (Argument == "--output" && !(Arguments >> Settings.OutputIndex))
+			{
+				throw std::runtime_error("--output needs an output index");
+			}
+			else if (Argument == "--refresh-rate" && !(Arguments >> Settings.RefreshRate))
+			{
+				throw std::runtime_error("--refresh-rate needs a rate in Hz");
+			}
+			else if (Argument == "--adapter" && !(Arguments >> Settings.AdapterIndex))
+			{
+				throw std::runtime_error("--adapter needs an adapter index");
+			}
+		}
+
+		return Settings;
+	}
+
+	const char* GetFullscreenModeName(const FullscreenMode InMode) noexcept
+	{
+		switch (InMode)
+		{
+		case FullscreenMode::Borderless:
+			return "Borderless fullscreen";
+		case FullscreenMode::Exclusive:
+			return "Exclusive fullscreen";
+		default:
+			return "Windowed";
+		}
+	}
+
+	const char* GetPresentationModeName(const PresentationMode InMode) noexcept
+	{
+		switch (InMode)
+		{
+		case PresentationMode::Composed:
+			return "composed by DWM";
+		case PresentationMode::Overlay:
+			return "hardware overlay";
+		case PresentationMode::IndependentFlip:
+			return "independent flip";
+		case PresentationMode::Exclusive:
+			return "presenting to the output";
+		default:
+			return "presentation mode unknown";
+		}
+	}
+}
+
+App::App(const std::string_view InCommandLine)
+	: MyQualityPreset(ReadQualityPreset(InCommandLine, DynamicResolutionTarget, static_cast<float>(WindowWidth * WindowHeight))),
+	  MyWindow(WindowWidth, WindowHeight, WindowClass::GetName(), true, ReadSwapChainSettings(InCommandLine, MyQualityPreset))
+{
+	std::istringstream Arguments {std::string(InCommandLine)};
+	ModelAsset::ImportOptions ImportOptions;
+	StressScene::Settings StressSettings;
+	bool bIsStressed = false;
+	std::unique_ptr<SceneFile> Scene;
+	unsigned int ViewNum = 0u;
+	float EyeSeparation = 0.0f;
+	// The suit's visor is exported opaque.
+	ImportOptions.MaterialOverrides.push_back({"Glass", 0.4f, false});
+
+	for (std::string Argument; Arguments >> Argument;)
+	{
+		if (Argument == "--benchmark")
+		{
+			std::string SceneFileName;
+
+			if (!(Arguments >> SceneFileName))
+			{
+				SceneFileName = Benchmark::DefaultSceneFileName;
+			}
+
+			MyBenchmark = std::make_unique<Benchmark>(SceneFileName);
+		}
+		else if (Argument == "--pack-textures")
+		{
+			ImportOptions.bPacksTextureArrays = true;
+		}
+		else if (Argument == "--cook-textures")
+		{
+			ImportOptions.bCooksTextures = true;
+		}
+		else if (Argument == "--bake-vertex-animation")
+		{
+			ImportOptions.bBakesVertexAnimation = true;
+		}
+		else if (Argument == "--no-late-latch")
+		{
+			bIsViewLatched = false;
+		}
+		else if (Argument == "--virtual-textures")
+		{
+			// Like --full-precision, before any material resolves its maps.
+			MyWindow.GetGraphics().EnableVirtualTextures();
+		}
+		else if (Argument == "--full-precision")
+		{
+			// Nothing has resolved a material yet, models only start loading once the whole command line is read.
+			MyWindow.GetGraphics().DisableHalfPrecision();
+		}
+		else if (Argument == "--large-pages")
+		{
+			// Also before any model loads, the arenas of their imports take large pages from then on.
+			AssetArena::EnableLargePages();
+		}
+		else if (Argument == "--max-fps")
+		{
+			float MaxFrameRate = 0.0f;
+
+			if (!(Arguments >> MaxFrameRate))
+			{
+				throw std::runtime_error("--max-fps needs a frame rate");
+			}
+
+			MyFrameLimiter.SetMaxFrameRate(MaxFrameRate);
+		}
+		else if (Argument == "--sample-allocations")
+		{
+			unsigned int Interval = 0u;
+
+			if (!(Arguments >> Interval) || Interval == 0u)
+			{
+				throw std::runtime_error("--sample-allocations needs an interval");
+			}
+
+			AllocationTracker::SetSampleInterval(Interval);
+		}
+		else if (Argument == "--telemetry")
+		{
+			unsigned short Port = 0u;
+
+			if (!(Arguments >> Port) || Port == 0u)
+			{
+				throw std::runtime_error("--telemetry needs a port");
+			}
+
+			MyTelemetry = std::make_unique<TelemetryServer>(Port);
+		}
+		else if (Argument == "--hitch")
+		{
+			auto& Settings = MyHitchDetector.GetSettings();
+
+			if (!(Arguments >> Settings.Threshold >> Settings.MedianScale) || Settings.Threshold < 0.0f || Settings.MedianScale < 0.0f)
+			{
+				throw std::runtime_error("--hitch needs a threshold in milliseconds and a multiple of the median");
+			}
+		}
+		else if (Argument == "--environment")
+		{
+			std::string CrossFileName;
+
+			if (!(Arguments >> CrossFileName))
+			{
+				throw std::runtime_error("--environment needs a cross image");
+			}
+
+			MyWindow.GetGraphics().GetImageBasedLighting().Load(MyWindow.GetGraphics(), CrossFileName);
+		}
+		else if (Argument == "--views")
+		{
+			if (!(Arguments >> ViewNum) || ViewNum < 2u || ViewNum > Graphics::MaxViewNum)
+			{
+				throw std::runtime_error("--views needs a view count from 2 to " + std::to_string(Graphics::MaxViewNum));
+			}
+		}
+		else if (Argument == "--stereo")
+		{
+			if (!(Arguments >> EyeSeparation) || EyeSeparation <= 0.0f)
+			{
+				throw std::runtime_error("--stereo needs an eye separation");
+			}
+		}
+		else if (Argument == "--crowd" && !(Arguments >> CrowdNum))
+		{
+			throw std::runtime_error("--crowd needs an instance count");
+		}
+		else if (Argument == "--ground")
+		{
+			float GroundSize = 0.0f;
+
+			if (!(Arguments >> GroundSize))
+			{
+				throw std::runtime_error("--ground needs a size");
+			}
+
+			// The plane faces -z, turned to face up it lies at the model's feet.
+			Ground = std::make_unique<Plane>(MyWindow.GetGraphics(), GroundSize, Displacement::Settings {});
+			Ground->SetPosition({0.0f, 0.0f, 0.0f});
+			Ground->SetRotation(0.0f, DirectX::XM_PIDIV2, 0.0f);
+		}
+		else if (Argument == "--decals")
+		{
+			unsigned int DecalNum = 0u;
+
+			if (!(Arguments >> DecalNum))
+			{
+				throw std::runtime_error("--decals needs a count");
+			}
+
+			SpawnDecals(DecalNum);
+		}
+		else if (Argument == "--fog")
+		{
+			float FogDensity = 0.0f;
+
+			if (!(Arguments >> FogDensity))
+			{
+				throw std::runtime_error("--fog needs a density");
+			}
+
+			auto& Fog = MyWindow.GetGraphics().GetVolumetricFog();
+			Fog.SetDensity(FogDensity);
+			Fog.Enable();
+		}
+		else if (Argument == "--hot-reload")
+		{
+			MyWindow.GetGraphics().EnableAssetHotReload();
+		}
+		else if (Argument == "--pipeline-statistics")
+		{
+			MyWindow.GetGraphics().GetGpuProfiler().EnablePipelineStatistics();
+		}
+		else if (Argument == "--stress")
+		{
+			if (!(Arguments >> StressSettings.DrawableNum))
+			{
+				throw std::runtime_error("--stress needs a drawable count");
+			}
+
+			bIsStressed = true;
+		}
+		else if (Argument == "--stress-lights")
+		{
+			if (!(Arguments >> StressSettings.LightNum))
+			{
+				throw std::runtime_error("--stress-lights needs a light count");
+			}
+
+			bIsStressed = true;
+		}
+		else if (Argument == "--particles")
+		{
+			ParticleSystem::Emitter Fountain;
+
+			if (!(Arguments >> Fountain.Rate))
+			{
+				throw std::runtime_error("--particles needs a rate");
+			}
+
+			// In front of the model, rising through the camera's view of it.
+			Fountain.Position = {0.0f, 0.0f, -2.0f};
+			if (MyWindow.GetGraphics().GetParticleSystem().AddEmitter(Fountain) == ParticleSystem::NoEmitter)
+			{
+				throw std::runtime_error("Too many --particles");
+			}
+		}
+		else if (Argument == "--capture")
+		{
+			std::string Prefix;
+			unsigned int FrameNum;
+
+			if (!(Arguments >> Prefix >> FrameNum))
+			{
+				throw std::runtime_error("--capture needs a file prefix and a frame count");
+			}
+
+			MyWindow.GetGraphics().GetFrameCapture().StartSequence(std::move(Prefix), FrameNum);
+		}
+		else if (Argument == "--record-trace")
+		{
+			std::string FileName;
+			unsigned int FrameNum;
+
+			if (!(Arguments >> FileName >> FrameNum))
+			{
+				throw std::runtime_error("--record-trace needs a file name and a frame count");
+			}
+
+			MyWindow.GetGraphics().GetCommandRecorder().Start(std::move(FileName), FrameNum);
+		}
+		else if (Argument == "--replay")
+		{
+			std::string FileName;
+
+			if (!(Arguments >> FileName))
+			{
+				throw std::runtime_error("--replay needs a trace file name");
+			}
+
+			MyReplay = std::make_unique<CommandReplay>(MyWindow.GetGraphics(), FileName);
+		}
+		else if (Argument == "--scene")
+		{
+			if (!(Arguments >> SceneFileName))
+			{
+				throw std::runtime_error("--scene needs a scene file name");
+			}
+
+			Scene = std::make_unique<SceneFile>(SceneFileName);
+
+			if (!Scene->IsValid() || Scene->GetInstanceNum() == 0u)
+			{
+				throw std::runtime_error("--scene could not read " + SceneFileName);
+			}
+		}
+		else if (Argument == "--world")
+		{
+			std::string FileName;
+
+			if (!(Arguments >> FileName))
+			{
+				throw std::runtime_error("--world needs a scene file name");
+			}
+
+			World = std::make_unique<WorldStreamer>(FileName, WorldStreamer::Settings {});
+
+			if (!World->IsValid())
+			{
+				throw std::runtime_error("--world could not read " + FileName);
+			}
+		}
+	}
+
+	if (bIsStressed)
+	{
+		Stress = std::make_unique<StressScene>(MyWindow.GetGraphics(), StressSettings);
+	}
+
+	MyWindow.GetGraphics().SetCamera(RenderCamera);
 	MyWindow.GetGraphics().SetProjectionMatrix(DirectX::XMMatrixPerspectiveLH(1.0f, 9.0f / 16.0f, 0.5f, 40.0f));
 
-	Light = std::make_unique<PointLight>(MyWindow.GetGraphics());
+	if (Scene)
+	{
+		const auto& [Position, Pitch, Yaw, Projection] = Scene->GetView();
+		MyCamera.SetPose(Position, Pitch, Yaw);
+		PreviousCameraPosition = Position;
+		MyWindow.GetGraphics().SetProjectionMatrix(DirectX::XMLoadFloat4x4(&Projection));
+	}
+
+	if (ViewNum > 0u && EyeSeparation > 0.0f)
+	{
+		throw std::runtime_error("--stereo renders two views of its own, it can't be combined with --views");
+	}
+
+	if (EyeSeparation > 0.0f)
+	{
+		MyWindow.GetGraphics().EnableStereo(EyeSeparation);
+	}
+
+	// Tiles in a grid, the camera in the first and the others fixed around the origin at its distance, all looking in at it.
+	if (ViewNum > 0u)
+	{
+		const auto ColumnNum = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(ViewNum))));
+		const auto RowNum = (ViewNum + ColumnNum - 1u) / ColumnNum;
+		const auto Start = MyCamera.GetPosition();
+		const auto Radius = std::max(std::sqrt(Start.x * Start.x + Start.z * Start.z), 1.0f);
+		std::vector<Graphics::View> Views;
+		FixedCameras.resize(ViewNum - 1u);
+
+		for (unsigned int Index = 0u; Index < ViewNum; ++Index)
+		{
+			const Camera* ViewCamera = &RenderCamera;
+
+			if (Index > 0u)
+			{
+				const auto Yaw = MyCamera.GetYaw() + DirectX::XM_2PI * static_cast<float>(Index) / static_cast<float>(ViewNum);
+				FixedCameras[Index - 1u].SetPose({-std::sin(Yaw) * Radius, Start.y, -std::cos(Yaw) * Radius}, std::atan2(Start.y, Radius), Yaw);
+				ViewCamera = &FixedCameras[Index - 1u];
+			}
+
+			Views.push_back({ViewCamera, static_cast<float>(Index % ColumnNum) / static_cast<float>(ColumnNum),
+			                 static_cast<float>(Index / ColumnNum) / static_cast<float>(RowNum), 1.0f / static_cast<float>(ColumnNum),
+			                 1.0f / static_cast<float>(RowNum)});
+		}
+
+		MyWindow.GetGraphics().SetViews(Views);
+	}
+
+	if (MyQualityPreset)
+	{
+		auto& Graphics = MyWindow.GetGraphics();
+		Graphics.GetDynamicResolution().SetMaxScale(MyQualityPreset->RenderScale);
+		Graphics.SetShadowMapSize(MyQualityPreset->ShadowMapSize);
+		Graphics.SetLodErrorScale(MyQualityPreset->LodErrorScale);
+		Graphics.GetTextureStreamer().SetBudget(MyQualityPreset->TextureBudgetBytes);
+
+		LOG_INFO("Quality: {} render scale, {}x MSAA, {} texel shadow maps, {} times the LOD error, {} MB of textures",
+		         MyQualityPreset->RenderScale, Graphics.GetSampleNum(), MyQualityPreset->ShadowMapSize, MyQualityPreset->LodErrorScale,
+		         MyQualityPreset->TextureBudgetBytes / (1024u * 1024u));
+	}
+
+	// Nothing but the scene is measured, and frames are not held back to the refresh rate or scaled to meet it.
+	if (MyBenchmark)
+	{
+		MyWindow.GetGraphics().DisableImGui();
+		MyWindow.GetGraphics().DisableVSync();
+	}
+	else
+	{
+		// The jittered history fills in what the scaled frames leave out, from the first frame on.
+		MyWindow.GetGraphics().EnableDynamicResolution(DynamicResolutionTarget);
+		MyWindow.GetGraphics().GetTemporalAntiAliasing().Enable();
+	}
+
+	// As the command line and the quality preset left the switches, which both configurations start from.
+	MyPerformanceToggles = std::make_unique<PerformanceToggles>(MyWindow.GetGraphics());
+	MyPerformanceToggles->Register("Pipelined simulation", [this] { return bIsSimulationPipelined; }, [this](const bool bInIsEnabled)
+	{
+		bIsSimulationPipelined = bInIsEnabled;
+	});
+
+	if (Scene)
+	{
+		SceneLights = Scene->CreateLights(MyWindow.GetGraphics());
+	}
+
+	if (!SceneLights.empty())
+	{
+		Light = std::move(SceneLights.front());
+		SceneLights.erase(SceneLights.begin());
+	}
+	else
+	{
+		Light = std::make_unique<PointLight>(MyWindow.GetGraphics());
+	}
+
+	// Started before the warmup, so the models import on the workers while the main thread compiles pipelines.
+	if (Scene)
+	{
+		// Every model is asked for at once, so they import side by side on the workers instead of one after another.
+		Crowd = Scene->LoadInstances(MyWindow.GetGraphics());
+		Nano = std::move(Crowd.front());
+		Crowd.erase(Crowd.begin());
+	}
+	else
+	{
+		Nano = ModelInstance::LoadAsync(MyWindow.GetGraphics(), MyBenchmark ? MyBenchmark->GetModelFileName() : "Models\\nanosuit_textured\\nanosuit.obj", ImportOptions);
+		// Models that come with animations play their first, the suit has none and stays in its pose.
+		Nano->PlayAnimation(0u);
+	}
+
+	// Before the first frame, what the last session drew is compiled while the window still shows nothing.
+	{
+		STARTUP_PHASE("Pipeline warmup");
+		MyWindow.GetGraphics().GetPipelineWarmup().WarmManifest();
+	}
+
+	AnimatedInstances.push_back(Nano.get());
+
+	for (const auto& Member : Crowd)
+	{
+		if (Member->GetPlayingAnimation() != ModelInstance::NoAnimation)
+		{
+			AnimatedInstances.push_back(Member.get());
+		}
+	}
+}
+
+App::~App()
+{
+	MyWindow.GetGraphics().GetPipelineWarmup().WriteManifest();
+}
+
+int App::Run()
+{
+	// Replays draw nothing to the window, only the messages keep it responsive.
+	while (MyReplay)
+	{
+		if (const auto ExitCode = MyWindow.ProcessMessages())
+		{
+			return ExitCode.value();
+		}
+
+		MyReplay->ReplayFrame();
+
+		if (MyReplay->IsDone())
+		{
+			return MyReplay->WriteReport() ? 0 : 1;
+		}
+	}
+
+	while (true)
+	{
+		// Nobody sees the frames of a minimized or covered window, so it sleeps on its messages until it shows again.
+		// Benchmarks keep measuring whatever the window does.
+		if (!MyBenchmark && (MyWindow.IsMinimized() || MyWindow.GetGraphics().CheckOccluded()))
+		{
+			if (const auto ExitCode = MyWindow.ProcessMessages(HiddenWaitTime))
+			{
+				return ExitCode.value();
+			}
+
+			// The frame that spans the sleep isn't a hitch.
+			MyHitchDetector.IgnoreNextFrame();
+			continue;
+		}
+
+		FrameProfiler::BeginFrame();
+		AllocationTracker::BeginFrame();
+		MyHitchDetector.Record();
+		MyPerformanceToggles->Record(MyWindow.GetGraphics());
+
+		if (MyBenchmark)
+		{
+			MyBenchmark->Record(MyWindow.GetGraphics());
+
+			if (MyBenchmark->IsDone())
+			{
+				return MyBenchmark->WriteReport() ? 0 : 1;
+			}
+		}
+
+		if (const auto ExitCode = MyWindow.ProcessMessages())
+		{
+			return ExitCode.value();
+		}
+
+		// The vertical field of view stays, the horizontal one widens or narrows with the window.
+		if (MyWindow.ApplyResize())
+		{
+			const auto& Display = MyWindow.GetGraphics().GetDisplayViewport();
+			DirectX::XMFLOAT4X4 Projection;
+			DirectX::XMStoreFloat4x4(&Projection, MyWindow.GetGraphics().GetProjectionMatrix());
+			Projection._11 = Projection._22 * Display.Height / Display.Width;
+			MyWindow.GetGraphics().SetProjectionMatrix(DirectX::XMLoadFloat4x4(&Projection));
+		}
+
+		// Benchmarks move the camera along their own fixed timestep, one per frame.
+		const auto bHadPipelinedStep = std::exchange(bHasPipelinedStep, false);
+		DoFrame(MyBenchmark ? 1.0f : bHadPipelinedStep ? PipelinedAlpha : StepSimulation());
+		MyFrameLimiter.Wait();
+
+		// Done before the messages are read, which write the input the steps read.
+		JobSystem::Get().Wait(SimulationDone);
+	}
+}
+
+void App::DoFrame(const float InAlpha)
+{
+	PROFILE_SCOPE("App::DoFrame");
+
+	// Before anything is submitted, so this frame already shows the input that arrived for it.
+	if (MyBenchmark)
+	{
+		MyBenchmark->Advance(MyCamera, Nano->IsReady());
+		PreviousCameraPosition = MyCamera.GetPosition();
+	}
+	else
+	{
+		ApplyMouseLook();
+	}
+
+	UpdateRenderCamera(InAlpha);
+
+	MyWindow.GetGraphics().BeginFrame();
+	MyStatsHistory.Record(MyWindow.GetGraphics());
+
+	if (MyTelemetry)
+	{
+		MyTelemetry->Publish(MyWindow.GetGraphics(), MyStatsHistory);
+		HandleTelemetryCommands();
+	}
+
+	// Picks come back a few frames after the click. The crowd only takes part so it hides the model behind it.
+	while (const auto Picked = MyWindow.GetGraphics().GetObjectPicker().TakeResult())
+	{
+		if (Picked->Owner == Nano.get())
+		{
+			Nano->SelectNode(Picked->Item);
+		}
+	}
+
+	Light->Bind(MyWindow.GetGraphics());
+
+	for (const auto& Lit : SceneLights)
+	{
+		Lit->Bind(MyWindow.GetGraphics());
+	}
+
+	for (const auto& Projector : Decals)
+	{
+		Projector.Bind(MyWindow.GetGraphics());
+	}
+
+	if (Stress)
+	{
+		Stress->Populate(MyWindow.GetGraphics());
+		Stress->Bind(MyWindow.GetGraphics());
+	}
+
+	const auto bWasReady = Nano->IsReady();
+	Nano->Update();
+	Nano->ApplyReload(MyWindow.GetGraphics());
+
+	// All of a model's pipelines are built in the frame it finishes loading, not one by one as its materials come into view.
+	if (!bWasReady && Nano->IsReady())
+	{
+		StartupTimeline::Mark("Model ready");
+		MyWindow.GetGraphics().GetPipelineWarmup().WarmCached();
+		SpawnCrowd();
+	}
+
+	Nano->Submit(MyWindow.GetGraphics());
+	Nano->SubmitShadowCasters(MyWindow.GetGraphics());
+	Nano->SubmitPickCandidates(MyWindow.GetGraphics());
+
+	for (const auto& Member : Crowd)
+	{
+		Member->Update();
+		Member->ApplyReload(MyWindow.GetGraphics());
+		Member->Submit(MyWindow.GetGraphics());
+		Member->SubmitShadowCasters(MyWindow.GetGraphics());
+		Member->SubmitPickCandidates(MyWindow.GetGraphics());
+	}
+
+	if (World)
+	{
+		World->Update(MyWindow.GetGraphics(), RenderCamera.GetPosition());
+		World->Submit(MyWindow.GetGraphics());
+	}
+
+	if (Ground)
+	{
+		Ground->Submit(MyWindow.GetGraphics());
+	}
+
+	if (Stress)
+	{
+		Stress->Submit(MyWindow.GetGraphics());
+	}
+
+	Nano->SubmitReflectionCaptures(MyWindow.GetGraphics());
+	Nano->SubmitIrradianceCaptures(MyWindow.GetGraphics());
+	Light->Submit(MyWindow.GetGraphics());
+
+	for (const auto& Lit : SceneLights)
+	{
+		Lit->Submit(MyWindow.GetGraphics());
+	}
+
+	if (MyWindow.GetGraphics().GetDebugDraw().IsEnabled())
+	{
+		DrawDebugLines();
+	}
+
+	// The message thread kept queueing mouse movement while the frame was submitted, the last of it still reaches this frame's
+	// view. Only the direction changes, the position stays as interpolated.
+	if (bIsViewLatched && !MyBenchmark)
+	{
+		ApplyMouseLook();
+		RenderCamera.SetPose(RenderCamera.GetPosition(), MyCamera.GetPitch(), MyCamera.GetYaw());
+		MyWindow.GetGraphics().LatchView();
+	}
+
+	MyWindow.GetGraphics().GetRenderQueue().Execute(MyWindow.GetGraphics());
+
+	if (MyWindow.GetGraphics().IsImGuiFrame())
+	{
+		ALLOCATION_SCOPE(Interface);
+		MyCamera.ShowControlWindow();
+		Light->ShowControlWindow();
+		MyWindow.GetGraphics().GetDirectionalLight().ShowControlWindow();
+		MyWindow.GetGraphics().GetDebugViews().ShowControlWindow();
+
+		if (Stress)
+		{
+			Stress->ShowControlWindow();
+		}
+
+		Nano->ShowWindow(MyWindow.GetGraphics(), "Model 1");
+		FrameProfiler::ShowWindow(&MyWindow.GetGraphics().GetGpuProfiler());
+		AllocationTracker::ShowWindow();
+		MyHitchDetector.ShowWindow();
+		MyPerformanceToggles->ShowWindow();
+		BindManager::ShowMemoryWindow();
+		ShowStatsOverlay();
+	}
+
+	while (const auto Event = ReadKey())
+	{
+		if (Event->IsPress() && Event->GetCode() == 'V')
+		{
+			if (MyWindow.GetGraphics().IsVSyncEnabled())
+			{
+				MyWindow.GetGraphics().DisableVSync();
+			}
+			else
+			{
+				MyWindow.GetGraphics().EnableVSync();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'E')
+		{
+			bIsSimulationPipelined = !bIsSimulationPipelined;
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'O')
+		{
+			if (auto& Culler = MyWindow.GetGraphics().GetOcclusionCuller(); Culler.IsEnabled())
+			{
+				Culler.Disable();
+			}
+			else
+			{
+				Culler.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'Q')
+		{
+			if (auto& Predication = MyWindow.GetGraphics().GetOcclusionPredication(); Predication.IsEnabled())
+			{
+				Predication.Disable();
+			}
+			else
+			{
+				Predication.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'Z')
+		{
+			if (auto& Temporal = MyWindow.GetGraphics().GetTemporalAntiAliasing(); Temporal.IsEnabled())
+			{
+				Temporal.Disable();
+			}
+			else
+			{
+				Temporal.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'G')
+		{
+			if (auto& Culler = MyWindow.GetGraphics().GetInstanceCuller(); Culler.IsEnabled())
+			{
+				Culler.Disable();
+			}
+			else
+			{
+				Culler.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'M')
+		{
+			if (auto& Culler = MyWindow.GetGraphics().GetMeshletCuller(); Culler.IsEnabled())
+			{
+				Culler.Disable();
+			}
+			else
+			{
+				Culler.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'P')
+		{
+			if (auto& Queue = MyWindow.GetGraphics().GetRenderQueue(); Queue.IsDepthPrepassEnabled())
+			{
+				Queue.DisableDepthPrepass();
+			}
+			else
+			{
+				Queue.EnableDepthPrepass();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'L')
+		{
+			if (auto& Deferred = MyWindow.GetGraphics().GetDeferredShading(); Deferred.IsEnabled())
+			{
+				Deferred.Disable();
+			}
+			else
+			{
+				Deferred.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'B')
+		{
+			if (auto& Post = MyWindow.GetGraphics().GetPostProcessor(); Post.IsBloomEnabled())
+			{
+				Post.DisableBloom();
+			}
+			else
+			{
+				Post.EnableBloom();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'X')
+		{
+			if (auto& Post = MyWindow.GetGraphics().GetPostProcessor(); Post.IsFxaaEnabled())
+			{
+				Post.DisableFxaa();
+			}
+			else
+			{
+				Post.EnableFxaa();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'C')
+		{
+			auto& Particles = MyWindow.GetGraphics().GetParticleSystem();
+			Particles.SetBlendMode(Particles.GetBlendMode() == ParticleSystem::BlendMode::AlphaBlend ? ParticleSystem::BlendMode::Additive
+			                                                                                         : ParticleSystem::BlendMode::AlphaBlend);
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'T')
+		{
+			if (auto& Lines = MyWindow.GetGraphics().GetDebugDraw(); Lines.IsEnabled())
+			{
+				Lines.Disable();
+			}
+			else
+			{
+				Lines.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'J')
+		{
+			if (auto& Environment = MyWindow.GetGraphics().GetImageBasedLighting(); Environment.IsEnabled())
+			{
+				Environment.Disable();
+			}
+			else
+			{
+				Environment.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'N')
+		{
+			if (auto& Baker = MyWindow.GetGraphics().GetImpostorBaker(); Baker.IsEnabled())
+			{
+				Baker.Disable();
+			}
+			else
+			{
+				Baker.Enable();
+			}
+		}
+
+		// A probe where the camera stands, past the fourth the oldest one moves.
+		if (Event->IsPress() && Event->GetCode() == 'Y')
+		{
+			MyWindow.GetGraphics().GetReflectionProbes().PlaceProbe(MyCamera.GetPosition(), 10.0f);
+		}
+
+		// Irradiance probes 4 m apart over 64 m by 16 m by 64 m around the camera, removed again on the next press.
+		if (Event->IsPress() && Event->GetCode() == VK_F6)
+		{
+			if (auto& Volume = MyWindow.GetGraphics().GetIrradianceVolume(); Volume.IsPlaced())
+			{
+				Volume.Clear();
+			}
+			else
+			{
+				Volume.Place(DirectX::BoundingBox(MyCamera.GetPosition(), {32.0f, 8.0f, 32.0f}), 4.0f);
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'K')
+		{
+			if (auto& Ssao = MyWindow.GetGraphics().GetAmbientOcclusion(); Ssao.IsEnabled())
+			{
+				Ssao.Disable();
+			}
+			else
+			{
+				Ssao.Enable();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == VK_F7)
+		{
+			if (auto& Fog = MyWindow.GetGraphics().GetVolumetricFog(); Fog.IsEnabled())
+			{
+				Fog.Disable();
+			}
+			else
+			{
+				Fog.Enable();
+			}
+		}
+
+		// ImGui off entirely, for measuring the scene alone.
+		if (Event->IsPress() && Event->GetCode() == 'I')
+		{
+			if (MyWindow.GetGraphics().IsImGuiEnabled())
+			{
+				MyWindow.GetGraphics().DisableImGui();
+			}
+			else
+			{
+				MyWindow.GetGraphics().EnableImGui();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'U')
+		{
+			auto& Graphics = MyWindow.GetGraphics();
+			Graphics.SetImGuiRefreshRate(Graphics.GetImGuiRefreshRate() > 0.0f ? 0.0f : CachedImGuiRefreshRate);
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'R')
+		{
+			if (auto& Graphics = MyWindow.GetGraphics(); Graphics.IsDynamicResolutionEnabled())
+			{
+				Graphics.DisableDynamicResolution();
+			}
+			else
+			{
+				Graphics.EnableDynamicResolution(DynamicResolutionTarget);
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == 'H')
+		{
+			if (MyWindow.GetGraphics().GetShaderReloader())
+			{
+				MyWindow.GetGraphics().DisableShaderHotReload();
+			}
+			else
+			{
+				MyWindow.GetGraphics().EnableShaderHotReload();
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == VK_F8)
+		{
+			if (MyWindow.GetGraphics().GetAssetReloader())
+			{
+				MyWindow.GetGraphics().DisableAssetHotReload();
+			}
+			else
+			{
+				MyWindow.GetGraphics().EnableAssetHotReload();
+			}
+		}
+
+		// Every thread's zones and the GPU scopes of the last ten seconds, for chrome://tracing or Perfetto.
+		if (Event->IsPress() && Event->GetCode() == VK_F9)
+		{
+			if (!FrameProfiler::ExportTrace("Trace.json", 10.0f))
+			{
+				LOG_ERROR("Could not write Trace.json");
+			}
+		}
+
+		// The instances that finished loading, the lights and the camera, for --scene to load the next session.
+		if (Event->IsPress() && Event->GetCode() == VK_F5)
+		{
+			std::vector<const ModelInstance*> SavedInstances {Nano.get()};
+			std::vector<const PointLight*> SavedLights {Light.get()};
+
+			for (const auto& Member : Crowd)
+			{
+				SavedInstances.push_back(Member.get());
+			}
+
+			for (const auto& Lit : SceneLights)
+			{
+				SavedLights.push_back(Lit.get());
+			}
+
+			if (!SceneFile::Write(SceneFileName, MyCamera, MyWindow.GetGraphics().GetProjectionMatrix(), SavedInstances, SavedLights))
+			{
+				LOG_ERROR("Could not write {}", SceneFileName);
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == VK_F12)
+		{
+			MyWindow.GetGraphics().GetFrameCapture().RequestScreenshot("Screenshot" + std::to_string(++ScreenshotNum) + ".png");
+		}
+
+		// Raw frames as fast as they are drawn, until pressed again or ten seconds at 60 fps were captured.
+		if (Event->IsPress() && Event->GetCode() == VK_F11)
+		{
+			if (auto& Capture = MyWindow.GetGraphics().GetFrameCapture(); Capture.GetStatistics().SequenceFramesLeft > 0u)
+			{
+				Capture.StopSequence();
+			}
+			else
+			{
+				Capture.StartSequence("Sequence", 600u);
+			}
+		}
+
+		if (Event->IsPress() && Event->GetCode() == VK_MENU)
+		{
+			if (MyWindow.IsCursorEnabled())
+			{
+				MyWindow.DisableCursor();
+				MyWindow.MyMouse.EnableRawInput();
+			}
+			else
+			{
+				MyWindow.EnableCursor();
+				MyWindow.MyMouse.DisableRawInput();
+			}
+		}
+	}
+
+	while (const auto MouseEvent = MyWindow.MyMouse.Read())
+	{
+		if (MouseEvent->GetType() == Mouse::Event::Type::LeftPress && MyWindow.IsCursorEnabled())
+		{
+			// Cursor coordinates are display pixels whatever the scene renders at, which is what the picker takes.
+			MyWindow.GetGraphics().GetObjectPicker().RequestPick(MouseEvent->GetPosX(), MouseEvent->GetPosY());
+		}
+	}
+
+	// Every draw has recorded its transforms by now and the render camera is this frame's copy, so what is left of the frame
+	// only talks to the GPU. The next frame's steps run meanwhile and the frame time tends towards the longer of the two.
+	if (!MyBenchmark && bIsSimulationPipelined)
+	{
+		bHasPipelinedStep = true;
+		JobSystem::Get().Run([this]
+		{
+			PipelinedAlpha = StepSimulation();
+		}, &SimulationDone);
+	}
+
+	MyWindow.GetGraphics().EndFrame();
+	StartupTimeline::MarkFirstFrame();
+}
+
+float App::StepSimulation()
+{
+	PROFILE_SCOPE("App::StepSimulation");
+
+	const auto Now = Keyboard::Clock::now();
+	unsigned int StepNum = 0u;
 
-	Nano = std::make_unique<Model>(MyWindow.GetGraphics(),"Models\\nanosuit_textured\\nanosuit.obj");
-	// Nano2 = std::make_unique<Model>(MyWindow.GetGraphics(),"Models\\nanosuit_textured\\nanosuit.obj");
+	while (Now - SimulatedTime >= SimulationStep && StepNum < MaxCatchUpStepNum)
+	{
+		PreviousCameraPosition = MyCamera.GetPosition();
+		Simulate(SimulatedTime, SimulatedTime + SimulationStep);
+		SimulatedTime += SimulationStep;
+		++StepNum;
+	}
+
+	// The whole steps still owed once the cap is hit are dropped, what is left of the current one is kept.
+	if (Now - SimulatedTime >= SimulationStep)
+	{
+		SimulatedTime = Now - (Now - SimulatedTime) % SimulationStep;
+	}
+
+	return std::chrono::duration<float>(Now - SimulatedTime) / std::chrono::duration<float>(SimulationStep);
 }
 
-int App::Run()
+void App::ApplyMouseLook()
 {
-	while (true)
+	// Looking around isn't stepped, it follows the mouse every frame, on the frame's own thread even when the steps were pipelined.
+	while (const auto RawDelta = MyWindow.MyMouse.ReadRawDelta())
 	{
-		if (const auto ExitCode = Window::ProcessMessages())
+		if (!MyWindow.IsCursorEnabled())
 		{
-			return ExitCode.value();
+			MyCamera.Rotate(static_cast<float>(RawDelta->DeltaX), static_cast<float>(RawDelta->DeltaY));
 		}
+	}
+}
+
+void App::Simulate(const Keyboard::Clock::time_point InFrom, const Keyboard::Clock::time_point InTo)
+{
+	ModelInstance::AnimateAll(AnimatedInstances, std::chrono::duration<float>(InTo - InFrom).count());
 
-		DoFrame();
+	if (Stress)
+	{
+		Stress->Update(std::chrono::duration<float>(InTo - InFrom).count());
+	}
+
+	if (!MyWindow.IsCursorEnabled())
+	{
+		// Integrated over how long each key was down within the step, not over the whole step whenever a key is down at its end.
+		const auto HeldSeconds = [&](const unsigned char InKeyCode)
+		{
+			return MyWindow.MyKeyboard.GetHeldSeconds(InKeyCode, InFrom, InTo) * SpeedFactor;
+		};
+
+		MyCamera.Translate({HeldSeconds('D') - HeldSeconds('A'), HeldSeconds('R') - HeldSeconds('F'), HeldSeconds('W') - HeldSeconds('S')});
 	}
 }
 
-void App::DoFrame()
+void App::SpawnCrowd()
 {
-	auto DeltaTime = MyTimer.Mark() * SpeedFactor;
+	// Rows of the loaded model's instances in front of it, sharing its asset. They stand in the imported pose, unless the import baked its
+	// animations, then each plays one of them out of step with its neighbours.
+	const auto RowLength = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(CrowdNum))));
+	const auto& Clips = Nano->GetAsset()->GetAnimations();
 
-	MyWindow.GetGraphics().BeginFrame();
+	for (unsigned int Index = 0u; Index < CrowdNum; ++Index)
+	{
+		auto& Member = Crowd.emplace_back(std::make_unique<ModelInstance>(MyWindow.GetGraphics(), Nano->GetAsset()));
+		const auto Column = static_cast<float>(Index % RowLength) - 0.5f * static_cast<float>(RowLength - 1u);
+		const auto Row = static_cast<float>(Index / RowLength + 1u);
+		Member->SetRootTransform(DirectX::XMMatrixTranslation(Column * CrowdSpacing, 0.0f, Row * CrowdSpacing));
+
+		if (!Clips.empty())
+		{
+			const auto Clip = Index % static_cast<unsigned int>(Clips.size());
+			Member->PlayVertexAnimation(Clip, Clips[Clip].GetDuration() * static_cast<float>(Index * 7u % 16u) / 16.0f);
+		}
+	}
+}
+
+void App::SpawnDecals(const unsigned int InNum)
+{
+	// Seeded, so the same count scatters the same decals every run.
+	std::mt19937 RandomGenerator {11u};
+	std::uniform_real_distribution<float> PositionDistribution {-DecalSpread, DecalSpread};
+	std::uniform_real_distribution<float> AngleDistribution {0.0f, 2.0f * DirectX::XM_PI};
+	std::uniform_real_distribution<float> SizeDistribution {0.25f, 1.5f};
+	std::uniform_real_distribution<float> ColorDistribution {0.5f, 1.0f};
+	Decals.reserve(Decals.size() + InNum);
 
-	Light->Bind(MyWindow.GetGraphics(), MyCamera.GetMatrix());
+	for (unsigned int Index = 0u; Index < InNum; ++Index)
+	{
+		auto& Projector = Decals.emplace_back(MyWindow.GetGraphics(), DecalImage);
+		const auto Size = SizeDistribution(RandomGenerator);
+		Projector.SetPosition({PositionDistribution(RandomGenerator), 0.0f, PositionDistribution(RandomGenerator)});
+		Projector.SetRotation(DirectX::XM_PIDIV2, AngleDistribution(RandomGenerator), 0.0f);
+		// Half a unit above and below the ground, enough for what stands on it to catch the edge too.
+		Projector.SetExtents({Size, Size, 0.5f});
+		Projector.SetColor({ColorDistribution(RandomGenerator), ColorDistribution(RandomGenerator), ColorDistribution(RandomGenerator)});
+	}
+}
 
-	Nano->Draw(MyWindow.GetGraphics());
-	Light->Draw(MyWindow.GetGraphics());
+void App::DrawDebugLines() const
+{
+	auto& Lines = MyWindow.GetGraphics().GetDebugDraw();
+	Nano->DrawBounds(MyWindow.GetGraphics());
 
-	MyCamera.ShowControlWindow();
-	Light->ShowControlWindow();
-	Nano->ShowWindow("Model 1");
+	for (const auto& Member : Crowd)
+	{
+		Member->DrawBounds(MyWindow.GetGraphics());
+	}
 
-	while (const auto Event = MyWindow.MyKeyboard.ReadKey())
+	if (World)
 	{
-		if (Event->IsPress() && Event->GetCode() == VK_MENU)
+		World->DrawBounds(MyWindow.GetGraphics());
+	}
+
+	for (const auto& Lit : MyWindow.GetGraphics().GetClusteredLighting().GetLights())
+	{
+		const auto& Color = Lit.DiffuseColor;
+		Lines.Sphere(Lit.WorldPosition, Lit.Range, {Color.x, Color.y, Color.z, 1.0f});
+	}
+}
+
+void App::UpdateRenderCamera(const float InAlpha)
+{
+	const auto Current = MyCamera.GetPosition();
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMStoreFloat3(&Position, DirectX::XMVectorLerp(DirectX::XMLoadFloat3(&PreviousCameraPosition), DirectX::XMLoadFloat3(&Current), InAlpha));
+
+	RenderCamera.SetPose(Position, MyCamera.GetPitch(), MyCamera.GetYaw());
+}
+
+std::optional<Keyboard::Event> App::ReadKey() noexcept
+{
+	if (auto Event = MyWindow.MyKeyboard.ReadKey())
+	{
+		return Event;
+	}
+
+	if (RemoteKeys.empty())
+	{
+		return std::nullopt;
+	}
+
+	const auto Code = RemoteKeys.front();
+	RemoteKeys.erase(RemoteKeys.begin());
+	return Keyboard::Event {Keyboard::Event::Type::Press, Code, Keyboard::Clock::now()};
+}
+
+void App::HandleTelemetryCommands()
+{
+	while (const auto Command = MyTelemetry->PollCommand())
+	{
+		std::istringstream Arguments {std::string(Command->data())};
+		std::string Name;
+		Arguments >> Name;
+
+		if (Name == "press")
 		{
-			if (MyWindow.IsCursorEnabled())
+			// A letter or digit, or F1 to F12, pressed as if on the keyboard, which is what switches the features.
+			std::string Key;
+			Arguments >> Key;
+			const auto FunctionKey = Key.size() > 1u && std::toupper(static_cast<unsigned char>(Key[0])) == 'F' ? std::atoi(Key.c_str() + 1) : 0;
+
+			if (Key.size() == 1u && std::isalnum(static_cast<unsigned char>(Key[0])))
 			{
-				MyWindow.DisableCursor();
-				MyWindow.MyMouse.EnableRawInput();
+				RemoteKeys.push_back(static_cast<unsigned char>(std::toupper(static_cast<unsigned char>(Key[0]))));
+				MyTelemetry->Reply("ok");
+			}
+			else if (FunctionKey >= 1 && FunctionKey <= 12)
+			{
+				RemoteKeys.push_back(static_cast<unsigned char>(VK_F1 + FunctionKey - 1u));
+				MyTelemetry->Reply("ok");
 			}
 			else
 			{
-				MyWindow.EnableCursor();
-				MyWindow.MyMouse.DisableRawInput();
+				MyTelemetry->Reply("error: press needs a letter, a digit or F1 to F12");
+			}
+		}
+		else if (Name == "trace")
+		{
+			float Seconds = 10.0f;
+			Arguments >> Seconds;
+
+			MyTelemetry->Reply(FrameProfiler::ExportTrace("Trace.json", Seconds) ? "ok: wrote Trace.json" : "error: could not write Trace.json");
+		}
+		else if (Name == "hitch")
+		{
+			auto& Settings = MyHitchDetector.GetSettings();
+			float Threshold = 0.0f;
+			float MedianScale = 0.0f;
+
+			if (Arguments >> Threshold >> MedianScale && Threshold >= 0.0f && MedianScale >= 0.0f)
+			{
+				Settings.Threshold = Threshold;
+				Settings.MedianScale = MedianScale;
+				MyTelemetry->Reply("ok");
+			}
+			else
+			{
+				MyTelemetry->Reply("error: hitch needs a threshold in milliseconds and a multiple of the median");
 			}
 		}
+		else
+		{
+			MyTelemetry->Reply("error: the commands are press <key>, trace [seconds] and hitch <ms> <multiple>");
+		}
 	}
+}
 
-	if (!MyWindow.IsCursorEnabled())
+void App::ShowStatsOverlay() const
+{
+	constexpr auto OverlayFlags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+								  ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoMove;
+
+	ImGui::SetNextWindowPos({10.0f, 10.0f});
+	ImGui::SetNextWindowBgAlpha(0.35f);
+
+	if (ImGui::Begin("Stats", nullptr, OverlayFlags))
 	{
-		if (MyWindow.MyKeyboard.IsKeyPressed('W'))
+		const auto& Capabilities = MyWindow.GetGraphics().GetCapabilities();
+		ImGui::Text("%s, feature level %d.%d", Capabilities.AdapterName.c_str(), Capabilities.FeatureLevel >> 12, (Capabilities.FeatureLevel >> 8) & 0xF);
+
+		const auto& [DrawnMeshNum, CulledMeshNum, DrawnTriangleNum, bIsImpostorDrawn] = Nano->GetCullingStatistics();
+		ImGui::Text("Meshes drawn %u, culled %u%s", DrawnMeshNum, CulledMeshNum, bIsImpostorDrawn ? ", impostor drawn" : "");
+		ImGui::Text("Triangles drawn %u", DrawnTriangleNum);
+
+		// What the middle of the screen shows, cast against the meshes' triangle trees.
+		const auto CameraToWorld = DirectX::XMMatrixInverse(nullptr, MyCamera.GetMatrix());
+
+		if (ModelInstance::RayHit Hit; Nano->IntersectRay(CameraToWorld.r[3], DirectX::XMVector3Normalize(CameraToWorld.r[2]), Hit))
+		{
+			ImGui::Text("Looking at node %u, triangle %u, %.1f units away", Hit.Node, Hit.Triangle, Hit.Distance);
+		}
+
+		if (const auto& Baker = MyWindow.GetGraphics().GetImpostorBaker(); Baker.IsEnabled())
 		{
-			MyCamera.Translate({0.0f, 0.0f, DeltaTime});
+			unsigned int ImpostorNum = 0u;
+
+			for (const auto& Member : Crowd)
+			{
+				ImpostorNum += Member->GetCullingStatistics().bIsImpostorDrawn ? 1u : 0u;
+			}
+
+			ImGui::Text("Impostors on (N), %u of %u crowd instances, %u models baked", ImpostorNum, static_cast<unsigned int>(Crowd.size()), Baker.GetBakedNum());
 		}
-		if (MyWindow.MyKeyboard.IsKeyPressed('A'))
+		else
 		{
-			MyCamera.Translate({-DeltaTime, 0.0f, 0.0f});
+			ImGui::Text("Impostors off (N)");
 		}
-		if (MyWindow.MyKeyboard.IsKeyPressed('S'))
+		// Occlusion results stay on the GPU, so the counts above are frustum culling only.
+		ImGui::Text("Occlusion culling %s (O)", MyWindow.GetGraphics().GetOcclusionCuller().IsEnabled() ? "on" : "off");
+
+		if (const auto& Predication = MyWindow.GetGraphics().GetOcclusionPredication(); Predication.IsEnabled())
 		{
-			MyCamera.Translate({0.0f, 0.0f, -DeltaTime});
+			ImGui::Text("Occlusion predicates on (Q), %u meshes of %u triangles or more", Predication.GetProxyNum(), Predication.GetMinTriangleNum());
 		}
-		if (MyWindow.MyKeyboard.IsKeyPressed('D'))
+		else
 		{
-			MyCamera.Translate({DeltaTime, 0.0f, 0.0f});
+			ImGui::Text("Occlusion predicates off (Q)");
 		}
-		if (MyWindow.MyKeyboard.IsKeyPressed('R'))
+
+		if (const auto& InstanceCulling = MyWindow.GetGraphics().GetInstanceCuller(); InstanceCulling.IsEnabled())
 		{
-			MyCamera.Translate({0.0f, DeltaTime, 0.0f});
+			ImGui::Text("GPU instance culling on (G), %u instances in %u draws", InstanceCulling.GetInstanceNum(), InstanceCulling.GetGroupNum());
+			const auto& SceneStatistics = MyWindow.GetGraphics().GetGpuScene().GetStatistics();
+			ImGui::Text("Scene transforms %u, %u changed, %u transient, %.1f KB uploaded", SceneStatistics.AllocatedNum, SceneStatistics.DeltaNum,
+			            SceneStatistics.TransientNum, static_cast<float>(SceneStatistics.UploadedBytes) / 1024.0f);
+			ImGui::Text("Propagated %u in %u levels", SceneStatistics.PropagatedNum, SceneStatistics.LevelNum);
 		}
-		if (MyWindow.MyKeyboard.IsKeyPressed('F'))
+		else
 		{
-			MyCamera.Translate({0.0f, -DeltaTime, 0.0f});
+			ImGui::Text("GPU instance culling off (G)");
 		}
-	}
 
-	while (const auto RawDelta = MyWindow.MyMouse.ReadRawDelta())
-	{
-		if (!MyWindow.IsCursorEnabled())
+		if (const auto& MeshletCulling = MyWindow.GetGraphics().GetMeshletCuller(); MeshletCulling.IsEnabled())
 		{
-			MyCamera.Rotate(static_cast<float>(RawDelta->DeltaX), static_cast<float>(RawDelta->DeltaY));
+			ImGui::Text("Meshlet culling on (M), %u meshlets in %u draws", MeshletCulling.GetMeshletNum(), MeshletCulling.GetMeshNum());
+		}
+		else
+		{
+			ImGui::Text("Meshlet culling off (M)");
+		}
+
+		if (const auto& Queue = MyWindow.GetGraphics().GetRenderQueue(); !Queue.IsDepthPrepassEnabled() && Queue.IsDepthPrepassActive(MyWindow.GetGraphics()))
+		{
+			ImGui::Text("Depth pre-pass on for SSAO (P)");
+		}
+		else
+		{
+			ImGui::Text("Depth pre-pass %s (P)", Queue.IsDepthPrepassEnabled() ? "on" : "off");
+		}
+
+		const auto SampleNum = MyWindow.GetGraphics().GetSampleNum();
+
+		if (MyWindow.GetGraphics().GetDeferredShading().IsEnabled() && SampleNum > 1u)
+		{
+			ImGui::Text("Forward shading (L), deferred needs MSAA off");
+		}
+		else
+		{
+			ImGui::Text("%s shading (L)", MyWindow.GetGraphics().GetDeferredShading().IsEnabled() ? "Deferred" : "Forward");
+		}
+
+		if (!MyWindow.GetGraphics().IsHalfPrecisionSupported())
+		{
+			ImGui::Text("Full precision lighting, the device has no 16-bit minimum precision");
+		}
+		else
+		{
+			ImGui::Text("%s precision forward lighting%s", MyWindow.GetGraphics().UsesHalfPrecision() ? "Half" : "Full",
+			            MyWindow.GetGraphics().UsesHalfPrecision() ? ", --full-precision turns it off" : "");
+		}
+
+		if (SampleNum > 1u)
+		{
+			// The resolves are the fixed cost, drawing every pass at more samples is the rest.
+			float ResolveMilliseconds = 0.0f;
+
+			for (const auto& [Name, Depth, Milliseconds] : MyWindow.GetGraphics().GetGpuProfiler().GetLastTimings())
+			{
+				ResolveMilliseconds += std::string_view {Name}.starts_with("MSAA") ? Milliseconds : 0.0f;
+			}
+
+			ImGui::Text("MSAA %ux, %.1f MB of targets, resolves %.2f ms GPU", SampleNum,
+			            static_cast<float>(MyWindow.GetGraphics().GetMultisampledBytes()) / (1024.0f * 1024.0f), ResolveMilliseconds);
+		}
+		else
+		{
+			ImGui::Text("MSAA off");
+		}
+
+		if (MyWindow.GetGraphics().GetAmbientOcclusion().IsEnabled())
+		{
+			// Both of its passes, the half resolution one and the upsample.
+			float SsaoMilliseconds = 0.0f;
+
+			for (const auto& [Name, Depth, Milliseconds] : MyWindow.GetGraphics().GetGpuProfiler().GetLastTimings())
+			{
+				SsaoMilliseconds += std::string_view {Name}.starts_with("SSAO") ? Milliseconds : 0.0f;
+			}
+
+			ImGui::Text("SSAO on (K), %.2f ms GPU", SsaoMilliseconds);
+		}
+		else
+		{
+			ImGui::Text("SSAO off (K)");
+		}
+
+		if (const auto& Fog = MyWindow.GetGraphics().GetVolumetricFog(); Fog.IsEnabled())
+		{
+			// Injection, integration and the fullscreen pass, the same whatever the resolution.
+			float FogMilliseconds = 0.0f;
+
+			for (const auto& [Name, Depth, Milliseconds] : MyWindow.GetGraphics().GetGpuProfiler().GetLastTimings())
+			{
+				FogMilliseconds += std::string_view {Name}.starts_with("Volumetric fog") ? Milliseconds : 0.0f;
+			}
+
+			ImGui::Text("Volumetric fog on (F7), density %.3f over %.0f m, %.2f ms GPU", Fog.GetDensity(), Fog.GetRange(), FogMilliseconds);
+		}
+		else
+		{
+			ImGui::Text("Volumetric fog off (F7), --fog sets its density");
+		}
+
+		if (const auto& Environment = MyWindow.GetGraphics().GetImageBasedLighting(); !Environment.HasEnvironment())
+		{
+			ImGui::Text("Constant ambient, --environment loads a cross");
+		}
+		else
+		{
+			ImGui::Text("Environment lighting %s (J), %u px x %u mips, %s in %.0f ms", Environment.IsEnabled() ? "on" : "off", Environment.GetFaceSize(),
+			            Environment.GetMipNum(), Environment.IsFromCache() ? "cached" : "prefiltered", Environment.GetLoadMilliseconds());
+		}
+
+		if (const auto& Probes = MyWindow.GetGraphics().GetReflectionProbes(); Probes.GetProbeNum() == 0u)
+		{
+			ImGui::Text("No reflection probes, Y places one");
+		}
+		else
+		{
+			ImGui::Text("%u reflection probes (Y), %u stale faces, %u drawables in this frame's face", Probes.GetProbeNum(), Probes.GetStaleFaceNum(),
+			            Probes.GetRenderedDrawableNum());
+		}
+
+		if (const auto& Volume = MyWindow.GetGraphics().GetIrradianceVolume(); !Volume.IsPlaced())
+		{
+			ImGui::Text("No irradiance volume, F6 places one");
+		}
+		else
+		{
+			ImGui::Text("Irradiance volume of %u x %u x %u probes (F6), %s, %u stale, %u drawables in this frame's cubes", Volume.GetCellNum().x,
+			            Volume.GetCellNum().y, Volume.GetCellNum().z, Volume.IsReady() ? "ready" : "filling", Volume.GetStaleProbeNum(),
+			            Volume.GetRenderedDrawableNum());
+		}
+
+		const auto& Post = MyWindow.GetGraphics().GetPostProcessor();
+		ImGui::Text("Bloom %s (B), FXAA %s (X)", Post.IsBloomEnabled() ? "on" : "off", Post.IsFxaaEnabled() ? "on" : "off");
+
+		if (MyWindow.GetGraphics().IsDynamicResolutionEnabled())
+		{
+			ImGui::Text("Resolution %.0f%% for %.1f ms GPU frames (R)", MyWindow.GetGraphics().GetResolutionScale() * 100.0f,
+			            MyWindow.GetGraphics().GetDynamicResolution().GetTargetFrameTime());
+		}
+		else
+		{
+			ImGui::Text("Resolution fixed at 100%% (R)");
+		}
+
+		if (const auto& Temporal = MyWindow.GetGraphics().GetTemporalAntiAliasing(); !Temporal.IsSupported())
+		{
+			ImGui::Text("Temporal AA needs MSAA off");
+		}
+		else if (Temporal.IsActive())
+		{
+			ImGui::Text("Temporal AA on (Z), %u moved meshes", Temporal.GetMovedDrawableNum());
+		}
+		else
+		{
+			ImGui::Text("Temporal AA off (Z)");
+		}
+
+		if (const auto MaxFrameRate = MyFrameLimiter.GetMaxFrameRate(); MaxFrameRate > 0.0f)
+		{
+			ImGui::Text("VSync %s (V), capped at %.0f fps", MyWindow.GetGraphics().IsVSyncEnabled() ? "on" : "off", MaxFrameRate);
+		}
+		else
+		{
+			ImGui::Text("VSync %s (V), uncapped", MyWindow.GetGraphics().IsVSyncEnabled() ? "on" : "off");
+		}
+
+		// Independent flip and overlays skip DWM's copy and its frame of latency.
+		ImGui::Text("%s, %s", GetFullscreenModeName(MyWindow.GetGraphics().GetFullscreenMode()),
+		            GetPresentationModeName(MyWindow.GetGraphics().QueryPresentationMode()));
+
+		if (const auto RefreshRate = MyWindow.GetGraphics().GetImGuiRefreshRate(); RefreshRate > 0.0f)
+		{
+			ImGui::Text("UI cached at %.0f Hz (U), hidden with I", RefreshRate);
+		}
+		else
+		{
+			ImGui::Text("UI drawn every frame (U), hidden with I");
+		}
+
+		// Only once something was lost, Engine.log has the rest.
+		if (const auto DroppedNum = Logger::GetDroppedNum(); DroppedNum > 0u)
+		{
+			ImGui::Text("%llu log messages dropped on full rings", static_cast<unsigned long long>(DroppedNum));
+		}
+		if (const auto& Lines = MyWindow.GetGraphics().GetDebugDraw(); Lines.IsEnabled())
+		{
+			ImGui::Text("Bounds and light ranges on (T), %u lines", Lines.GetLineNum());
+		}
+		else
+		{
+			ImGui::Text("Bounds and light ranges off (T)");
+		}
+
+		const auto& ParticleStatistics = MyWindow.GetGraphics().GetParticleSystem().GetStatistics();
+		ImGui::Text("Particles %u alive of %u, %u emitted by %u emitters, %s (C)", ParticleStatistics.AliveNum, ParticleSystem::MaxParticleNum,
+		            ParticleStatistics.EmittedNum, ParticleStatistics.EmitterNum, ParticleStatistics.bIsSorted ? "sorted alpha blend" : "additive");
+		ImGui::Text("Lights %u, %u on screen", MyWindow.GetGraphics().GetClusteredLighting().GetLightNum(),
+		            MyWindow.GetGraphics().GetClusteredLighting().GetVisibleLightNum());
+		ImGui::Text("Decals %u, %u on screen, %zu atlas images", MyWindow.GetGraphics().GetClusteredLighting().GetDecalNum(),
+		            MyWindow.GetGraphics().GetClusteredLighting().GetVisibleDecalNum(), MyWindow.GetGraphics().GetDecalAtlas().GetImageNum());
+
+		if (World)
+		{
+			const auto [CellNum, ResidentCellNum, LoadingCellNum, ResidentBytes] = World->GetStatistics();
+			ImGui::Text("World cells %u resident, %u loading of %u, %.1f MB", ResidentCellNum, LoadingCellNum, CellNum,
+			            static_cast<float>(ResidentBytes) / (1024.0f * 1024.0f));
+		}
+
+		const auto Captures = MyWindow.GetGraphics().GetFrameCapture().GetStatistics();
+		ImGui::Text("Captured %u frames (F12, F11), %u dropped, %u writing, %u failed, %u left in sequence", Captures.CapturedNum,
+		            Captures.DroppedNum, Captures.WritingNum, Captures.FailedNum, Captures.SequenceFramesLeft);
+
+		const auto Trace = MyWindow.GetGraphics().GetCommandRecorder().GetStatistics();
+		ImGui::Text("Trace %u frames left, %u objects, %.1f KB of contents, %zu command words%s", Trace.FramesLeft, Trace.ObjectNum,
+		            static_cast<float>(Trace.BlobBytes) / 1024.0f, Trace.CommandWordNum,
+		            Trace.bHasFailed ? ", failed to write" : Trace.bHasWritten ? ", written" : "");
+		ImGui::Text("Shadow faces drawn %u, atlas %.0f%% used", MyWindow.GetGraphics().GetPointLightShadows().GetRenderedFaceNum(),
+		            100.0f * MyWindow.GetGraphics().GetPointLightShadows().GetAtlasUsage());
+		ImGui::Text("Sun cascades drawn %u of %u", MyWindow.GetGraphics().GetDirectionalLight().GetRenderedCascadeNum(), DirectionalLight::CascadeNum);
+		ImGui::Text("Geometry pages %u", MyWindow.GetGraphics().GetGeometryPool().GetPageNum());
+
+		const auto& Uploads = MyWindow.GetGraphics().GetUploadManager().GetStatistics();
+		ImGui::Text("Uploaded %.1f KB, %u pending (%.1f KB), %u overflows", static_cast<float>(Uploads.CopiedBytes) / 1024.0f, Uploads.PendingNum,
+		            static_cast<float>(Uploads.PendingBytes) / 1024.0f, Uploads.OverflowNum);
+
+		const auto& Releases = MyWindow.GetGraphics().GetReleaseQueue().GetStatistics();
+		ImGui::Text("Deferred releases %u pending, %u released", Releases.PendingNum, Releases.ReleasedNum);
+
+		const auto& Graph = MyWindow.GetGraphics().GetRenderGraph().GetStatistics();
+		ImGui::Text("Render graph %u passes, %u culled", Graph.PassNum, Graph.CulledPassNum);
+		ImGui::Text("Transients %u in %u textures, %.1f of %.1f MB", Graph.TransientNum, Graph.TextureNum, static_cast<float>(Graph.AliasedBytes) / 1048576.0f,
+		            static_cast<float>(Graph.TransientBytes) / 1048576.0f);
+
+		const auto& [ArenaBytes, ArenaOverflowNum, HeapAllocationNum] = MyWindow.GetGraphics().GetFrameArenaStatistics();
+		ImGui::Text("Frame arena %.1f KB, %u overflows, %u heap allocations", static_cast<float>(ArenaBytes) / 1024.0f, ArenaOverflowNum, HeapAllocationNum);
+
+		const auto Statistics = MyWindow.GetGraphics().GetStateStatistics();
+		ImGui::Text("Draw calls %u, triangles submitted %llu", Statistics.DrawCalls, Statistics.Triangles);
+		ImGui::Text("State changes %u, %u redundant skipped", Statistics.IssuedCalls, Statistics.SavedCalls);
+		ImGui::Text("Constants uploaded %.1f KB, %u unchanged uploads skipped", static_cast<float>(Statistics.ConstantBytes) / 1024.0f, Statistics.SkippedUploads);
+
+		const auto [CreatedNum, DestroyedNum] = Bindable::GetLifetimes();
+		ImGui::Text("Resources live %llu, created %llu, destroyed %llu", CreatedNum - DestroyedNum, CreatedNum, DestroyedNum);
+
+		const auto& VideoMemory = MyStatsHistory.GetVideoMemory();
+		ImGui::Text("Video memory %.0f of %.0f MB budget", static_cast<float>(VideoMemory.CurrentUsage) / (1024.0f * 1024.0f),
+		            static_cast<float>(VideoMemory.Budget) / (1024.0f * 1024.0f));
+
+		const auto& Streamer = MyWindow.GetGraphics().GetTextureStreamer();
+		const auto& StreamingStatistics = Streamer.GetStatistics();
+		ImGui::Text("Streamed textures %u, %.1f of %.0f MB resident, %u loading", StreamingStatistics.TextureNum,
+		            static_cast<float>(StreamingStatistics.ResidentBytes) / (1024.0f * 1024.0f), static_cast<float>(Streamer.GetBudget()) / (1024.0f * 1024.0f),
+		            StreamingStatistics.PendingNum);
+
+		if (const auto* const VirtualTextures = MyWindow.GetGraphics().GetVirtualTextureCache())
+		{
+			const auto& PagingStatistics = VirtualTextures->GetStatistics();
+			ImGui::Text("Virtual textures %u, %u of %u pages resident, %u loading, %u paged in, %u evicted", PagingStatistics.TextureNum,
+			            PagingStatistics.ResidentPageNum, PagingStatistics.PageNum, PagingStatistics.PendingNum, PagingStatistics.LoadedNum,
+			            PagingStatistics.EvictedNum);
+		}
+
+		if (ImGui::TreeNode("State changes by type"))
+		{
+			for (size_t Index = 0u; Index < StateCache::StateTypeNum; ++Index)
+			{
+				ImGui::Text("%s %u", StateCache::GetStateTypeName(static_cast<StateCache::StateType>(Index)), Statistics.IssuedCallsByType[Index]);
+			}
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("History, per second"))
+		{
+			MyStatsHistory.Plot(StatsHistory::Series::DrawCalls, "Draw calls");
+			MyStatsHistory.Plot(StatsHistory::Series::Triangles, "Triangles");
+			MyStatsHistory.Plot(StatsHistory::Series::StateChanges, "State changes");
+			MyStatsHistory.Plot(StatsHistory::Series::ConstantKilobytes, "Constants KB");
+			MyStatsHistory.Plot(StatsHistory::Series::CreatedResources, "Created");
+			MyStatsHistory.Plot(StatsHistory::Series::DestroyedResources, "Destroyed");
+			MyStatsHistory.Plot(StatsHistory::Series::VideoMemoryMegabytes, "Video memory MB");
+			ImGui::TreePop();
+		}
+
+		if (const auto* Reloader = MyWindow.GetGraphics().GetShaderReloader())
+		{
+			const auto [ReloadedNum, FailedNum] = Reloader->GetStatistics();
+			ImGui::Text("Shader hot reload on (H), %u reloaded, %u failed", ReloadedNum, FailedNum);
+		}
+		else
+		{
+			ImGui::Text("Shader hot reload off (H)");
+		}
+
+		if (const auto* Reloader = MyWindow.GetGraphics().GetAssetReloader())
+		{
+			const auto [TextureNum, ModelNum, FailedNum] = Reloader->GetStatistics();
+			ImGui::Text("Asset hot reload on (F8), %u textures and %u models reloaded, %u failed", TextureNum, ModelNum, FailedNum);
+		}
+		else
+		{
+			ImGui::Text("Asset hot reload off (F8)");
 		}
 	}
 
-	MyWindow.GetGraphics().EndFrame();
+	ImGui::End();
 }
\ No newline at end of file
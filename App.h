@@ -1,28 +1,159 @@
 ﻿#pragma once
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AssetArchive.h"
+#include "Benchmark.h"
 #include "Camera.h"
-#include "EngineTimer.h"
+#include "CommandReplay.h"
+#include "Decal.h"
+#include "FrameLimiter.h"
+#include "HitchDetector.h"
 #include "ImguiManager.h"
+#include "IoService.h"
+#include "JobSystem.h"
+#include "Logger.h"
 #include "Mesh.h"
+#include "PerformanceToggles.h"
 #include "Plane.h"
 #include "PointLight.h"
+#include "QualityCalibration.h"
+#include "StatsHistory.h"
+#include "StressScene.h"
+#include "TelemetryServer.h"
 #include "Window.h"
+#include "WorldStreamer.h"
 
 class App
 {
 public:
-	App();
+	// --adapter <index> creates the device on that adapter of the ones the log lists, fastest first, instead of the fastest.
+	// --calibrate measures the machine again for the quality preset every start applies, render scale, MSAA, shadow map size,
+	// LOD error and texture budget. The first start measures it, as do those after the adapter, its driver or the CPU changed.
+	// --benchmark [scene file] runs the scripted benchmark instead of the interactive scene, at the default quality.
+	// --pack-textures imports the model with its maps packed into texture arrays.
+	// --cook-textures compresses the model's maps before the import reads them, colour maps to BC7 and the others to BC5.
+	// --virtual-textures pages the maps of opaque materials through tiled resources by what is on screen, where the device has tier 2.
+	// --bake-vertex-animation bakes the model's skinned meshes through its animations, which the --crowd instances then play on the GPU.
+	// --sample-allocations <interval> records the call stack of every that many allocations from the start, for the allocation window.
+	// --hitch <ms> <multiple> sets the frame time, and the multiple of the median frame time, past which a frame hitches.
+	// Either is off at zero. A hitch writes a trace of the frames around it to Hitch_<frame>.json.
+	// --telemetry <port> streams every frame's counters to a client on that TCP port, which can press keys and take traces.
+	// --no-late-latch keeps the view of the frame's start instead of taking the mouse again just before the scene draws.
+	// --max-fps <rate> caps the frame rate, which matters once vsync is off.
+	// --crowd <count> places that many more instances of the model once it has loaded.
+	// --ground <size> lays a tessellated, displaced brick floor of that size under the scene.
+	// --stress <count> and --stress-lights <count> open the stress scene with that many drawables and point lights,
+	// with --crowd for model instances among them.
+	// --particles <rate> adds a fountain emitting that many GPU particles per second.
+	// --capture <prefix> <count> writes that many frames from the first one on as raw files starting with the prefix.
+	// --record-trace <file> <count> traces that many frames from the first one on for --replay.
+	// --replay <file> times every draw of a trace instead of running the scene, and writes the report.
+	// --scene <file> loads the models, lights and camera F5 saved to it instead of the default scene, F5 then saves back to it.
+	// --world <file> streams the instances of a scene file in cells around the camera, next to the scene.
+	explicit App(std::string_view InCommandLine = {});
+	// Records the pipelines this session warmed for the next one.
+	~App();
 	int Run();
 
 private:
-	void DoFrame();
+	// Runs the simulation steps real time has caught up with and returns how far the next one is along, in [0, 1).
+	// Only touches simulated state on the CPU, so it may run as a job while the previous frame is presented.
+	float StepSimulation();
+	void ApplyMouseLook();
+	void Simulate(Keyboard::Clock::time_point InFrom, Keyboard::Clock::time_point InTo);
+	// InAlpha blends from the simulated state one step back to the current one.
+	void DoFrame(float InAlpha);
+	void UpdateRenderCamera(float InAlpha);
+	void SpawnCrowd();
+	// Scattered over the ground around the model, projecting down onto it.
+	void SpawnDecals(unsigned int InNum);
+	// The models' spatial indices and node bounds, and the range of every light of the frame, after everything is submitted.
+	void DrawDebugLines() const;
+	void ShowStatsOverlay() const;
+	// The keyboard's presses first, then what telemetry pressed.
+	[[nodiscard]] std::optional<Keyboard::Event> ReadKey() noexcept;
+	void HandleTelemetryCommands();
 
 private:
+	// What U switches the UI to, rebuilt this often or on input instead of every frame.
+	static constexpr float CachedImGuiRefreshRate {20.0f};
+	// GPU milliseconds per frame dynamic resolution aims for, a 60 Hz display's refresh.
+	static constexpr float DynamicResolutionTarget {1000.0f / 60.0f};
+	// The simulation advances in steps of this length whatever the frame rate, rendering interpolates between the last two.
+	static constexpr std::chrono::microseconds SimulationStep {16667};
+	// Steps one frame catches up on at most. Time beyond that is dropped, so a stall doesn't snowball into ever longer frames.
+	static constexpr unsigned int MaxCatchUpStepNum {5u};
+	// Of the window, and of the display the quality preset is picked for unless it goes fullscreen.
+	static constexpr int WindowWidth {1280};
+	static constexpr int WindowHeight {720};
+	// Milliseconds a minimized or covered window sleeps on its messages before checking whether it shows again.
+	static constexpr DWORD HiddenWaitTime {100u};
+	// World units between the crowd's instances.
+	static constexpr float CrowdSpacing {3.0f};
+	// World units from the origin decals are scattered within, and the image they show.
+	static constexpr float DecalSpread {20.0f};
+	static constexpr const char* DecalImage = "Images/cube.png";
+
 	static inline ImGuiManager ImGui;
 
+	// First, so everything below can log until it is gone, and the last messages are written as the app exits.
+	Logger MyLogger;
+	// Mapped before anything loads, and kept until the jobs that read from it are gone.
+	AssetArchive MyAssetArchive {"Assets.pak"};
+	// Declared before everything that schedules jobs so it outlives them.
+	JobSystem MyJobSystem;
+	// Outlives the window, whose texture streamer waits for the reads it started.
+	IoService MyIoService;
+	// Read or calibrated before the window, whose swap chain takes its MSAA. Nothing when --benchmark runs.
+	std::optional<QualityCalibration::Preset> MyQualityPreset;
 	Window MyWindow;
-	EngineTimer MyTimer;
+	// Real time the simulation has advanced to, at most one step behind now after StepSimulation.
+	Keyboard::Clock::time_point SimulatedTime {Keyboard::Clock::now()};
+	// The next frame's steps run while this one presents, once its draws have read everything simulated. E switches it.
+	bool bIsSimulationPipelined {true};
+	bool bHasPipelinedStep {false};
+	// Mouse look taken again once the frame is submitted, see Graphics::LatchView.
+	bool bIsViewLatched {true};
+	// What the pipelined steps returned, the next frame interpolates with it.
+	float PipelinedAlpha {0.0f};
+	JobCounter SimulationDone;
+	// Simulated, and edited by its control window.
 	Camera MyCamera;
+	DirectX::XMFLOAT3 PreviousCameraPosition {MyCamera.GetPosition()};
+	// Between the previous and current step, what the frame is rendered and picked from.
+	Camera RenderCamera;
+	// The viewpoints of --views past the first, which is the camera's. Graphics points at them, so they are never resized after.
+	std::vector<Camera> FixedCameras;
 	float SpeedFactor {1.0f};
 	std::unique_ptr<PointLight> Light;
-	std::unique_ptr<Model> Nano;
+	// A loaded scene's lights beyond the first, which takes Light's place.
+	std::vector<std::unique_ptr<PointLight>> SceneLights;
+	std::unique_ptr<ModelInstance> Nano;
+	// A loaded scene's instances beyond the first, which takes Nano's place, come first.
+	std::vector<std::unique_ptr<ModelInstance>> Crowd;
+	// Advanced each step, Nano and whatever a loaded scene has playing.
+	std::vector<ModelInstance*> AnimatedInstances;
+	std::string SceneFileName {"Scene.scene"};
+	unsigned int CrowdNum {0u};
+	// Numbers the screenshot files of this session.
+	unsigned int ScreenshotNum {0u};
+	std::unique_ptr<Plane> Ground;
+	std::vector<Decal> Decals;
+	std::unique_ptr<StressScene> Stress;
+	std::unique_ptr<WorldStreamer> World;
+	std::unique_ptr<Benchmark> MyBenchmark;
+	std::unique_ptr<CommandReplay> MyReplay;
+	// Switches the engine's optimizations and compares two configurations of them, see its window.
+	std::unique_ptr<PerformanceToggles> MyPerformanceToggles;
+	StatsHistory MyStatsHistory;
+	FrameLimiter MyFrameLimiter;
+	std::unique_ptr<TelemetryServer> MyTelemetry;
+	// Presses telemetry asked for, read after the keyboard's.
+	std::vector<unsigned char> RemoteKeys;
+	// Declared after the job system, which has to outlive the trace jobs it waits for.
+	HitchDetector MyHitchDetector;
 };
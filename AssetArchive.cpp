@@ -0,0 +1,574 @@
+﻿#define FULL_WINDOW
+#include "AssetArchive.h"
+#include "EngineWin.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include "JobSystem.h"
+#include "MappedFile.h"
+
+namespace
+{
+	constexpr size_t MinMatch {4u};
+
+	// Decodes one LZ4 block into exactly InOutput's size, refusing anything that would read or write outside either buffer.
+	bool DecompressBlock(const std::byte* InInput, const size_t InInputSize, std::byte* const InOutput, const size_t InOutputSize) noexcept
+	{
+		const auto* const InputEnd = InInput + InInputSize;
+		auto* Output = InOutput;
+		auto* const OutputEnd = InOutput + InOutputSize;
+
+		const auto ReadLength = [&](size_t& InOutLength)
+		{
+			if (InOutLength != 15u)
+			{
+				return true;
+			}
+
+			for (;;)
+			{
+				if (InInput == InputEnd)
+				{
+					return false;
+				}
+
+				const auto Extra = static_cast<size_t>(*InInput++);
+				InOutLength += Extra;
+
+				if (Extra != 255u)
+				{
+					return true;
+				}
+			}
+		};
+
+		while (InInput < InputEnd)
+		{
+			const auto Token = static_cast<size_t>(*InInput++);
+
+			auto LiteralLength = Token >> 4u;
+			if (!ReadLength(LiteralLength) || LiteralLength > static_cast<size_t>(InputEnd - InInput) || LiteralLength > static_cast<size_t>(OutputEnd - Output))
+			{
+				return false;
+			}
+
+			memcpy(Output, InInput, LiteralLength);
+			InInput += LiteralLength;
+			Output += LiteralLength;
+
+			// The last sequence is literals only.
+			if (InInput == InputEnd)
+			{
+				break;
+			}
+
+			if (InputEnd - InInput < 2)
+			{
+				return false;
+			}
+
+			const auto Distance = static_cast<size_t>(InInput[0]) | (static_cast<size_t>(InInput[1]) << 8u);
+			InInput += 2;
+
+			auto MatchLength = Token & 15u;
+			if (Distance == 0u || Distance > static_cast<size_t>(Output - InOutput) || !ReadLength(MatchLength))
+			{
+				return false;
+			}
+
+			MatchLength += MinMatch;
+			if (MatchLength > static_cast<size_t>(OutputEnd - Output))
+			{
+				return false;
+			}
+
+			// Matches may overlap what they write, so they're copied a byte at a time.
+			const auto* Match = Output - Distance;
+			for (size_t Index = 0u; Index < MatchLength; ++Index)
+			{
+				*Output++ = *Match++;
+			}
+		}
+
+		return Output == OutputEnd;
+	}
+
+	void WriteLength(std::vector<std::byte>& OutBytes, size_t InLength)
+	{
+		for (; InLength >= 255u; InLength -= 255u)
+		{
+			OutBytes.push_back(std::byte {255u});
+		}
+
+		OutBytes.push_back(static_cast<std::byte>(InLength));
+	}
+
+	uint32_t LoadWord(const std::byte* InData) noexcept
+	{
+		uint32_t Word;
+		memcpy(&Word, InData, sizeof(Word));
+		return Word;
+	}
+
+	// Greedy LZ4 block, keeping the format's rules that matches start 12 bytes and end 5 bytes before the end at the latest.
+	// A chunk that doesn't shrink is stored as it is, which the reader tells apart by its size.
+	std::vector<std::byte> CompressChunk(const std::span<const std::byte> InInput)
+	{
+		std::vector<std::byte> Output;
+		Output.reserve(InInput.size());
+
+		std::vector<ptrdiff_t> Table(size_t {1u} << 14u, -1);
+		const auto* const Begin = InInput.data();
+		const auto End = static_cast<ptrdiff_t>(InInput.size());
+		ptrdiff_t Anchor = 0;
+		ptrdiff_t Position = 0;
+
+		while (Position < End - 12)
+		{
+			const auto Sequence = LoadWord(Begin + Position);
+			const auto Hash = static_cast<size_t>((Sequence * 2654435761u) >> 18u);
+			const auto Candidate = Table[Hash];
+			Table[Hash] = Position;
+
+			if (Candidate < 0 || Position - Candidate > 65535 || LoadWord(Begin + Candidate) != Sequence)
+			{
+				++Position;
+				continue;
+			}
+
+			auto MatchEnd = Position + static_cast<ptrdiff_t>(MinMatch);
+			while (MatchEnd < End - 5 && Begin[MatchEnd] == Begin[Candidate + MatchEnd - Position])
+			{
+				++MatchEnd;
+			}
+
+			const auto LiteralLength = static_cast<size_t>(Position - Anchor);
+			const auto MatchLength = static_cast<size_t>(MatchEnd - Position) - MinMatch;
+			Output.push_back(static_cast<std::byte>(std::min<size_t>(LiteralLength, 15u) << 4u | std::min<size_t>(MatchLength, 15u)));
+
+			if (LiteralLength >= 15u)
+			{
+				WriteLength(Output, LiteralLength - 15u);
+			}
+
+			Output.insert(Output.end(), Begin + Anchor, Begin + Position);
+			const auto Distance = static_cast<size_t>(Position - Candidate);
+			Output.push_back(static_cast<std::byte>(Distance & 255u));
+			Output.push_back(static_cast<std::byte>(Distance >> 8u));
+
+			if (MatchLength >= 15u)
+			{
+				WriteLength(Output, MatchLength - 15u);
+			}
+
+			Position = MatchEnd;
+			Anchor = MatchEnd;
+		}
+
+		const auto LastLength = static_cast<size_t>(End - Anchor);
+		Output.push_back(static_cast<std::byte>(std::min<size_t>(LastLength, 15u) << 4u));
+
+		if (LastLength >= 15u)
+		{
+			WriteLength(Output, LastLength - 15u);
+		}
+
+		Output.insert(Output.end(), Begin + Anchor, Begin + End);
+
+		if (Output.size() >= InInput.size())
+		{
+			Output.assign(InInput.begin(), InInput.end());
+		}
+
+		return Output;
+	}
+}
+
+AssetArchive::AssetArchive(const std::filesystem::path& InFileName)
+	: Mapping(std::make_unique<MappedFile>(InFileName))
+{
+	assert(!Instance && "Only one AssetArchive may exist");
+	Instance = this;
+
+	if (!Validate())
+	{
+		Mapping.reset();
+		return;
+	}
+
+	const auto* const Data = Mapping->GetData();
+	const auto& ArchiveHeader = *reinterpret_cast<const Header*>(Data);
+
+	Entries = reinterpret_cast<const Entry*>(Data + sizeof(Header));
+	ChunkSizes = reinterpret_cast<const uint32_t*>(Entries + ArchiveHeader.EntryNum);
+	EntryNum = ArchiveHeader.EntryNum;
+
+	// Asks for the whole archive up front in large reads, so the first loads find it resident instead of faulting it in a page at a time.
+	WIN32_MEMORY_RANGE_ENTRY Range {const_cast<std::byte*>(Data), Mapping->GetSize()};
+	PrefetchVirtualMemory(GetCurrentProcess(), 1u, &Range, 0u);
+}
+
+AssetArchive::~AssetArchive()
+{
+	Instance = nullptr;
+}
+
+const AssetArchive& AssetArchive::Get() noexcept
+{
+	assert(Instance && "AssetArchive is used before App created it");
+	return *Instance;
+}
+
+bool AssetArchive::Write(const std::filesystem::path& InFileName, const std::span<const std::filesystem::path> InFiles)
+{
+	struct PackedFile
+	{
+		std::string Key;
+		uint64_t Size {0u};
+		int64_t WriteTime {0};
+		std::vector<std::vector<std::byte>> Chunks;
+		bool bIsRead {false};
+	};
+
+	std::vector<PackedFile> Files(InFiles.size());
+
+	JobSystem::Get().ParallelFor(InFiles.size(), 1u, [&](const size_t InIndex)
+	{
+		auto& File = Files[InIndex];
+		std::error_code ErrorCode;
+		const auto WriteTime = std::filesystem::last_write_time(InFiles[InIndex], ErrorCode);
+		std::ifstream Stream(InFiles[InIndex], std::ios::binary | std::ios::ate);
+
+		if (ErrorCode || !Stream)
+		{
+			return;
+		}
+
+		std::vector<std::byte> Bytes(static_cast<size_t>(Stream.tellg()));
+		Stream.seekg(0);
+		Stream.read(reinterpret_cast<char*>(Bytes.data()), static_cast<std::streamsize>(Bytes.size()));
+
+		if (static_cast<size_t>(Stream.gcount()) != Bytes.size())
+		{
+			return;
+		}
+
+		File.Key = MakeKey(InFiles[InIndex]);
+		File.Size = Bytes.size();
+		File.WriteTime = static_cast<int64_t>(WriteTime.time_since_epoch().count());
+
+		for (size_t First = 0u; First < Bytes.size(); First += ChunkSize)
+		{
+			File.Chunks.push_back(CompressChunk(std::span<const std::byte>(Bytes).subspan(First, std::min(ChunkSize, Bytes.size() - First))));
+		}
+
+		File.bIsRead = true;
+	});
+
+	if (!std::all_of(Files.begin(), Files.end(), [](const PackedFile& InFile) { return InFile.bIsRead; }))
+	{
+		return false;
+	}
+
+	std::sort(Files.begin(), Files.end(), [](const PackedFile& InLeft, const PackedFile& InRight)
+	{
+		return InLeft.Key < InRight.Key;
+	});
+
+	// Lookups binary search the paths, the same file listed twice would make them ambiguous.
+	if (std::adjacent_find(Files.begin(), Files.end(), [](const PackedFile& InLeft, const PackedFile& InRight) { return InLeft.Key == InRight.Key; }) != Files.end())
+	{
+		return false;
+	}
+
+	const auto Align = [](const uint64_t InOffset)
+	{
+		return (InOffset + EntryAlignment - 1u) / EntryAlignment * EntryAlignment;
+	};
+
+	uint32_t ChunkNum = 0u;
+	uint64_t PathOffset = sizeof(Header) + Files.size() * sizeof(Entry);
+
+	for (const auto& File : Files)
+	{
+		ChunkNum += static_cast<uint32_t>(File.Chunks.size());
+	}
+
+	PathOffset += ChunkNum * sizeof(uint32_t);
+	uint64_t DataOffset = PathOffset;
+
+	for (const auto& File : Files)
+	{
+		DataOffset += File.Key.size();
+	}
+
+	DataOffset = Align(DataOffset);
+
+	std::vector<Entry> ArchiveEntries;
+	ArchiveEntries.reserve(Files.size());
+	uint32_t FirstChunk = 0u;
+
+	for (const auto& File : Files)
+	{
+		ArchiveEntries.push_back({DataOffset, File.Size, File.WriteTime, static_cast<uint32_t>(PathOffset), static_cast<uint32_t>(File.Key.size()),
+		                          FirstChunk, static_cast<uint32_t>(File.Chunks.size())});
+
+		PathOffset += File.Key.size();
+		FirstChunk += static_cast<uint32_t>(File.Chunks.size());
+
+		for (const auto& Chunk : File.Chunks)
+		{
+			DataOffset += Chunk.size();
+		}
+
+		DataOffset = Align(DataOffset);
+	}
+
+	auto TemporaryPath = InFileName;
+	TemporaryPath += ".tmp";
+
+	std::error_code ErrorCode;
+
+	{
+		std::ofstream Stream(TemporaryPath, std::ios::binary | std::ios::trunc);
+		if (!Stream)
+		{
+			return false;
+		}
+
+		const Header ArchiveHeader {Magic, Version, static_cast<uint32_t>(Files.size()), ChunkNum};
+		Stream.write(reinterpret_cast<const char*>(&ArchiveHeader), sizeof(ArchiveHeader));
+		Stream.write(reinterpret_cast<const char*>(ArchiveEntries.data()), static_cast<std::streamsize>(ArchiveEntries.size() * sizeof(Entry)));
+
+		for (const auto& File : Files)
+		{
+			for (const auto& Chunk : File.Chunks)
+			{
+				const auto StoredSize = static_cast<uint32_t>(Chunk.size());
+				Stream.write(reinterpret_cast<const char*>(&StoredSize), sizeof(StoredSize));
+			}
+		}
+
+		for (const auto& File : Files)
+		{
+			Stream.write(File.Key.data(), static_cast<std::streamsize>(File.Key.size()));
+		}
+
+		const std::vector<char> Padding(EntryAlignment, '\0');
+
+		for (size_t Index = 0u; Index < Files.size(); ++Index)
+		{
+			const auto Position = static_cast<uint64_t>(Stream.tellp());
+			Stream.write(Padding.data(), static_cast<std::streamsize>(ArchiveEntries[Index].DataOffset - Position));
+
+			for (const auto& Chunk : Files[Index].Chunks)
+			{
+				Stream.write(reinterpret_cast<const char*>(Chunk.data()), static_cast<std::streamsize>(Chunk.size()));
+			}
+		}
+
+		if (!Stream.flush())
+		{
+			Stream.close();
+			std::filesystem::remove(TemporaryPath, ErrorCode);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(TemporaryPath, InFileName, ErrorCode);
+	if (ErrorCode)
+	{
+		std::filesystem::remove(TemporaryPath, ErrorCode);
+		return false;
+	}
+
+	return true;
+}
+
+bool AssetArchive::Validate() const noexcept
+{
+	if (!Mapping->IsValid() || Mapping->GetSize() < sizeof(Header))
+	{
+		return false;
+	}
+
+	const auto* const Data = Mapping->GetData();
+	const auto Size = static_cast<uint64_t>(Mapping->GetSize());
+	const auto& ArchiveHeader = *reinterpret_cast<const Header*>(Data);
+
+	if (ArchiveHeader.Magic != Magic || ArchiveHeader.Version != Version ||
+		ArchiveHeader.EntryNum > (Size - sizeof(Header)) / sizeof(Entry) ||
+		ArchiveHeader.ChunkNum > (Size - sizeof(Header) - ArchiveHeader.EntryNum * sizeof(Entry)) / sizeof(uint32_t))
+	{
+		return false;
+	}
+
+	const auto* const ArchiveEntries = reinterpret_cast<const Entry*>(Data + sizeof(Header));
+	const auto* const ArchiveChunkSizes = reinterpret_cast<const uint32_t*>(ArchiveEntries + ArchiveHeader.EntryNum);
+
+	const auto IsInside = [Size](const uint64_t InOffset, const uint64_t InSize)
+	{
+		return InOffset <= Size && InSize <= Size - InOffset;
+	};
+
+	const auto IsValidEntry = [&](const Entry& InEntry)
+	{
+		if (!IsInside(InEntry.PathOffset, InEntry.PathLength) || InEntry.DataOffset % EntryAlignment != 0u ||
+			InEntry.FirstChunk > ArchiveHeader.ChunkNum || InEntry.ChunkNum > ArchiveHeader.ChunkNum - InEntry.FirstChunk ||
+			InEntry.ChunkNum != (InEntry.Size + ChunkSize - 1u) / ChunkSize)
+		{
+			return false;
+		}
+
+		uint64_t StoredSize = 0u;
+		for (uint32_t Chunk = 0u; Chunk < InEntry.ChunkNum; ++Chunk)
+		{
+			StoredSize += ArchiveChunkSizes[InEntry.FirstChunk + Chunk];
+		}
+
+		return IsInside(InEntry.DataOffset, StoredSize);
+	};
+
+	if (!std::all_of(ArchiveEntries, ArchiveEntries + ArchiveHeader.EntryNum, IsValidEntry))
+	{
+		return false;
+	}
+
+	// Lookups binary search the entries, which only works on paths in strictly increasing order.
+	const auto GetEntryPath = [Data](const Entry& InEntry)
+	{
+		return std::string_view(reinterpret_cast<const char*>(Data + InEntry.PathOffset), InEntry.PathLength);
+	};
+
+	return std::adjacent_find(ArchiveEntries, ArchiveEntries + ArchiveHeader.EntryNum, [&](const Entry& InLeft, const Entry& InRight)
+	{
+		return GetEntryPath(InLeft) >= GetEntryPath(InRight);
+	}) == ArchiveEntries + ArchiveHeader.EntryNum;
+}
+
+std::string AssetArchive::MakeKey(const std::filesystem::path& InPath)
+{
+	auto Relative = InPath.lexically_normal();
+
+	if (Relative.is_absolute())
+	{
+		std::error_code ErrorCode;
+		Relative = Relative.lexically_proximate(std::filesystem::current_path(ErrorCode));
+	}
+
+	// Only ASCII is folded, so keys don't depend on the locale.
+	const auto Generic = Relative.generic_u8string();
+	std::string Key(Generic.begin(), Generic.end());
+
+	std::transform(Key.begin(), Key.end(), Key.begin(), [](const char InChar)
+	{
+		return InChar >= 'A' && InChar <= 'Z' ? static_cast<char>(InChar - 'A' + 'a') : InChar;
+	});
+
+	return Key;
+}
+
+std::string_view AssetArchive::GetPath(const Entry& InEntry) const noexcept
+{
+	return {reinterpret_cast<const char*>(Mapping->GetData() + InEntry.PathOffset), InEntry.PathLength};
+}
+
+const AssetArchive::Entry* AssetArchive::FindEntry(const std::filesystem::path& InPath) const
+{
+	if (EntryNum == 0u)
+	{
+		return nullptr;
+	}
+
+	const auto Key = MakeKey(InPath);
+	const auto* const Found = std::lower_bound(Entries, Entries + EntryNum, Key, [this](const Entry& InEntry, const std::string& InKey)
+	{
+		return GetPath(InEntry) < InKey;
+	});
+
+	return Found != Entries + EntryNum && GetPath(*Found) == Key ? Found : nullptr;
+}
+
+bool AssetArchive::Decompress(const Entry& InEntry, std::vector<std::byte>& OutBytes, const size_t InMaxSize) const
+{
+	const auto ReadSize = static_cast<size_t>(std::min<uint64_t>(InEntry.Size, InMaxSize));
+	const auto ReadChunkNum = static_cast<uint32_t>((ReadSize + ChunkSize - 1u) / ChunkSize);
+
+	// Chunks decode whole, the last one read may overhang what was asked for.
+	OutBytes.resize(static_cast<size_t>(std::min<uint64_t>(InEntry.Size, static_cast<uint64_t>(ReadChunkNum) * ChunkSize)));
+
+	const auto* Stored = Mapping->GetData() + InEntry.DataOffset;
+	auto* Output = OutBytes.data();
+
+	for (uint32_t Chunk = 0u; Chunk < ReadChunkNum; ++Chunk)
+	{
+		const auto StoredSize = static_cast<size_t>(ChunkSizes[InEntry.FirstChunk + Chunk]);
+		const auto RawSize = std::min(ChunkSize, static_cast<size_t>(InEntry.Size) - Chunk * ChunkSize);
+
+		if (StoredSize == RawSize)
+		{
+			memcpy(Output, Stored, RawSize);
+		}
+		else if (!DecompressBlock(Stored, StoredSize, Output, RawSize))
+		{
+			OutBytes.clear();
+			return false;
+		}
+
+		Stored += StoredSize;
+		Output += RawSize;
+	}
+
+	OutBytes.resize(ReadSize);
+	return true;
+}
+
+bool AssetArchive::Read(const std::filesystem::path& InPath, std::vector<std::byte>& OutBytes, const size_t InMaxSize) const
+{
+	if (const auto* const Found = FindEntry(InPath))
+	{
+		return Decompress(*Found, OutBytes, InMaxSize);
+	}
+
+	std::ifstream Stream(InPath, std::ios::binary | std::ios::ate);
+	if (!Stream)
+	{
+		return false;
+	}
+
+	OutBytes.resize(std::min(static_cast<size_t>(Stream.tellg()), InMaxSize));
+	Stream.seekg(0);
+	Stream.read(reinterpret_cast<char*>(OutBytes.data()), static_cast<std::streamsize>(OutBytes.size()));
+
+	return static_cast<size_t>(Stream.gcount()) == OutBytes.size();
+}
+
+bool AssetArchive::Exists(const std::filesystem::path& InPath) const
+{
+	std::error_code ErrorCode;
+	return FindEntry(InPath) || std::filesystem::is_regular_file(InPath, ErrorCode);
+}
+
+std::optional<AssetArchive::FileStatus> AssetArchive::GetStatus(const std::filesystem::path& InPath) const
+{
+	if (const auto* const Found = FindEntry(InPath))
+	{
+		return FileStatus {Found->Size, Found->WriteTime};
+	}
+
+	std::error_code ErrorCode;
+	const auto Size = std::filesystem::file_size(InPath, ErrorCode);
+	if (ErrorCode)
+	{
+		return std::nullopt;
+	}
+
+	const auto WriteTime = std::filesystem::last_write_time(InPath, ErrorCode);
+	if (ErrorCode)
+	{
+		return std::nullopt;
+	}
+
+	return FileStatus {static_cast<uint64_t>(Size), static_cast<int64_t>(WriteTime.time_since_epoch().count())};
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class MappedFile;
+
+/**
+ * Models, materials and images packed into one file by the cooker at build time and memory-mapped at startup, so a cold start reads them
+ * as a few large sequential reads instead of opening and seeking dozens of loose files. Files the archive doesn't hold are
+ * read loose, every reader that takes a path goes through Read, Exists and GetStatus to get either.
+ * Entries are found by their path relative to the working directory, lowercase with forward slashes.
+ *
+ * Layout, little endian: Header, Header::EntryNum Entry records sorted by path, Header::ChunkNum chunk sizes, the paths,
+ * then every entry's chunks back to back from its EntryAlignment aligned offset. A chunk is up to ChunkSize bytes of the file
+ * compressed as one LZ4 block, or stored as it is when its size is what it would decompress to.
+ * Owned by App, everything else reaches it through Get().
+ */
+class AssetArchive
+{
+public:
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t EntryNum;
+		uint32_t ChunkNum;
+	};
+
+	struct Entry
+	{
+		uint64_t DataOffset;
+		uint64_t Size;
+		// FILETIME ticks of the packed file, which is what std::filesystem::last_write_time counts.
+		int64_t WriteTime;
+		uint32_t PathOffset;
+		uint32_t PathLength;
+		uint32_t FirstChunk;
+		uint32_t ChunkNum;
+	};
+
+	// What caches validated against their source compare.
+	struct FileStatus
+	{
+		uint64_t Size;
+		int64_t WriteTime;
+	};
+
+	// "APAK"
+	static constexpr uint32_t Magic {0x4B415041u};
+	static constexpr uint32_t Version {1u};
+	static constexpr size_t ChunkSize {65536u};
+	static constexpr size_t EntryAlignment {65536u};
+
+	// A missing or malformed archive is left empty and everything is read from loose files.
+	explicit AssetArchive(const std::filesystem::path& InFileName);
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive(AssetArchive&&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+	AssetArchive& operator=(AssetArchive&&) = delete;
+	~AssetArchive();
+
+	[[nodiscard]] static const AssetArchive& Get() noexcept;
+
+	// Packs the loose files under their paths from the working directory, compressing them on the job system. Written aside and
+	// renamed, so a failed write leaves the previous archive in place.
+	static bool Write(const std::filesystem::path& InFileName, std::span<const std::filesystem::path> InFiles);
+	// The path an archived file is found by.
+	[[nodiscard]] static std::string MakeKey(const std::filesystem::path& InPath);
+
+	// False when the file is neither archived nor loose, or the archived chunks don't decompress.
+	// InMaxSize reads only the start of the file, an archived one decompressing just the chunks that cover it.
+	bool Read(const std::filesystem::path& InPath, std::vector<std::byte>& OutBytes, size_t InMaxSize = SIZE_MAX) const;
+	// Archived or loose.
+	[[nodiscard]] bool Exists(const std::filesystem::path& InPath) const;
+	// Archived only, for readers that map loose files themselves.
+	[[nodiscard]] bool Contains(const std::filesystem::path& InPath) const
+	{
+		return FindEntry(InPath) != nullptr;
+	}
+
+	[[nodiscard]] std::optional<FileStatus> GetStatus(const std::filesystem::path& InPath) const;
+
+	[[nodiscard]] size_t GetEntryNum() const noexcept
+	{
+		return EntryNum;
+	}
+
+private:
+	[[nodiscard]] bool Validate() const noexcept;
+	[[nodiscard]] const Entry* FindEntry(const std::filesystem::path& InPath) const;
+	[[nodiscard]] std::string_view GetPath(const Entry& InEntry) const noexcept;
+	[[nodiscard]] bool Decompress(const Entry& InEntry, std::vector<std::byte>& OutBytes, size_t InMaxSize) const;
+
+private:
+	static inline AssetArchive* Instance {nullptr};
+
+	std::unique_ptr<MappedFile> Mapping;
+	const Entry* Entries {nullptr};
+	const uint32_t* ChunkSizes {nullptr};
+	size_t EntryNum {0u};
+};
@@ -0,0 +1,138 @@
+﻿#include "AssetArena.h"
+#include "EngineWin.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include "Logger.h"
+
+namespace
+{
+	// Zero when large pages can't be used, the process lacking the privilege to lock memory or the system not having them.
+	size_t LargePageBytes {0u};
+
+	bool EnableLockMemoryPrivilege() noexcept
+	{
+		HANDLE Token;
+
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &Token))
+		{
+			return false;
+		}
+
+		TOKEN_PRIVILEGES Privileges {};
+		Privileges.PrivilegeCount = 1u;
+		Privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+		// AdjustTokenPrivileges succeeds without assigning what the account wasn't granted, which only the last error tells.
+		const bool bIsEnabled = LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &Privileges.Privileges[0].Luid) &&
+		                        AdjustTokenPrivileges(Token, FALSE, &Privileges, 0u, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+		CloseHandle(Token);
+		return bIsEnabled;
+	}
+}
+
+AssetArena::AssetArena(const size_t InBlockBytes) noexcept
+	: BlockBytes(InBlockBytes)
+{
+}
+
+AssetArena::~AssetArena()
+{
+	for (const auto& [Data, Size] : Blocks)
+	{
+		VirtualFree(Data, 0u, MEM_RELEASE);
+	}
+}
+
+void AssetArena::EnableLargePages() noexcept
+{
+	if (bAreLargePagesEnabled)
+	{
+		return;
+	}
+
+	bAreLargePagesEnabled = true;
+	LargePageBytes = EnableLockMemoryPrivilege() ? GetLargePageMinimum() : 0u;
+
+	if (LargePageBytes == 0u)
+	{
+		LOG_WARNING("Large pages are unavailable without the privilege to lock memory, asset arenas use regular pages");
+	}
+}
+
+std::string_view AssetArena::CopyString(const std::string_view InString)
+{
+	if (InString.empty())
+	{
+		return {};
+	}
+
+	auto* const Copy = static_cast<char*>(allocate(InString.size(), alignof(char)));
+	std::memcpy(Copy, InString.data(), InString.size());
+	return {Copy, InString.size()};
+}
+
+void* AssetArena::do_allocate(const size_t InBytes, const size_t InAlignment)
+{
+	const auto Align = [InAlignment](std::byte* InPointer)
+	{
+		const auto Address = reinterpret_cast<uintptr_t>(InPointer);
+		return reinterpret_cast<std::byte*>((Address + InAlignment - 1u) & ~(static_cast<uintptr_t>(InAlignment) - 1u));
+	};
+
+	auto* Aligned = Cursor ? Align(Cursor) : nullptr;
+
+	if (!Aligned || static_cast<size_t>(End - Aligned) < InBytes)
+	{
+		AddBlock(InBytes, InAlignment);
+		Aligned = Align(Cursor);
+	}
+
+	Cursor = Aligned + InBytes;
+	MyStatistics.UsedBytes += InBytes;
+	return Aligned;
+}
+
+void AssetArena::do_deallocate(void*, size_t, size_t) noexcept
+{
+	// Everything goes with the arena.
+}
+
+bool AssetArena::do_is_equal(const std::pmr::memory_resource& InOther) const noexcept
+{
+	return this == &InOther;
+}
+
+void AssetArena::AddBlock(const size_t InBytes, const size_t InAlignment)
+{
+	const auto PageBytes = bAreLargePagesEnabled && LargePageBytes ? LargePageBytes : size_t {0u};
+	auto Size = std::max(BlockBytes, InBytes + InAlignment);
+	void* Data = nullptr;
+
+	// Large pages come in whole pages, only blocks at least that large take them. They may be out even with the privilege,
+	// the memory being too fragmented.
+	if (PageBytes && Size >= PageBytes)
+	{
+		Size = (Size + PageBytes - 1u) / PageBytes * PageBytes;
+		Data = VirtualAlloc(nullptr, Size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		MyStatistics.LargePageBlockNum += Data ? 1u : 0u;
+	}
+
+	if (!Data)
+	{
+		Data = VirtualAlloc(nullptr, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	if (!Data)
+	{
+		throw std::bad_alloc();
+	}
+
+	Blocks.push_back({static_cast<std::byte*>(Data), Size});
+	Cursor = static_cast<std::byte*>(Data);
+	End = Cursor + Size;
+	MyStatistics.ReservedBytes += Size;
+	++MyStatistics.BlockNum;
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+/**
+ * Monotonic memory for what a model's import builds by the thousand, such as node entries, their names and mesh index lists.
+ * Allocations bump a pointer through blocks taken from the system a few at a time, frees do nothing, and everything goes at
+ * once with the arena: when the import's source data is dropped, or for the node names a hierarchy keeps, with the asset.
+ * Hands itself to std::pmr containers as their memory resource. One thread at a time, the import is serial where it uses it.
+ * With large pages enabled, blocks of a large page or more are taken as large pages where the process may lock memory, and as
+ * regular pages otherwise.
+ */
+class AssetArena : public std::pmr::memory_resource
+{
+public:
+	struct Statistics
+	{
+		size_t UsedBytes {0u};
+		size_t ReservedBytes {0u};
+		unsigned int BlockNum {0u};
+		unsigned int LargePageBlockNum {0u};
+	};
+
+	static constexpr size_t DefaultBlockBytes {1024u * 1024u};
+
+	explicit AssetArena(size_t InBlockBytes = DefaultBlockBytes) noexcept;
+	AssetArena(const AssetArena&) = delete;
+	AssetArena(AssetArena&&) = delete;
+	AssetArena& operator=(const AssetArena&) = delete;
+	AssetArena& operator=(AssetArena&&) = delete;
+	~AssetArena() override;
+
+	// Before any model loads, arenas made earlier keep regular pages. Asks for the privilege to lock memory once.
+	static void EnableLargePages() noexcept;
+
+	// A copy that lives as long as the arena.
+	[[nodiscard]] std::string_view CopyString(std::string_view InString);
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return MyStatistics;
+	}
+
+private:
+	struct Block
+	{
+		std::byte* Data;
+		size_t Size;
+	};
+
+	void* do_allocate(size_t InBytes, size_t InAlignment) override;
+	void do_deallocate(void* InPointer, size_t InBytes, size_t InAlignment) noexcept override;
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& InOther) const noexcept override;
+
+	// Large enough for InBytes at InAlignment on top of the usual block size.
+	void AddBlock(size_t InBytes, size_t InAlignment);
+
+private:
+	static inline bool bAreLargePagesEnabled {false};
+
+	size_t BlockBytes;
+	std::vector<Block> Blocks;
+	std::byte* Cursor {nullptr};
+	std::byte* End {nullptr};
+	Statistics MyStatistics {};
+};
@@ -0,0 +1,243 @@
+﻿#include "AssetReloader.h"
+#include <algorithm>
+#include <exception>
+#include "AssetArchive.h"
+#include "BindManager.h"
+#include "Graphics.h"
+#include "Logger.h"
+#include "Mesh.h"
+#include "Texture.h"
+
+struct AssetReloader::TextureReplacement
+{
+	std::shared_ptr<Texture> Target;
+	Texture::ReloadedLevels Levels;
+};
+
+namespace
+{
+	bool IsSameAsset(const std::weak_ptr<const ModelAsset>& InLeft, const std::shared_ptr<const ModelAsset>& InRight) noexcept
+	{
+		return !InLeft.owner_before(InRight) && !InRight.owner_before(InLeft);
+	}
+
+	void Report(const std::string& InMessage)
+	{
+		LOG_WARNING("Asset reload: {}", InMessage);
+	}
+}
+
+AssetReloader::AssetReloader(const Graphics& InGraphics)
+	: MyGraphics(InGraphics)
+{
+	// The first poll only records what is there.
+	Poll();
+	Watcher = std::thread(&AssetReloader::WatchLoop, this);
+}
+
+AssetReloader::~AssetReloader()
+{
+	{
+		std::lock_guard Lock(SleepMutex);
+		bIsStopping = true;
+	}
+
+	WakeCondition.notify_all();
+	Watcher.join();
+}
+
+void AssetReloader::Apply() noexcept
+{
+	std::unique_lock Lock(PassMutex, std::try_to_lock);
+
+	if (!Lock)
+	{
+		return;
+	}
+
+	const auto Applied = std::remove_if(PendingTextures.begin(), PendingTextures.end(), [this](TextureReplacement& InReplacement)
+	{
+		if (!InReplacement.Target->ApplyReload(InReplacement.Levels))
+		{
+			return false;
+		}
+
+		++PendingStatistics.ReloadedTextureNum;
+		return true;
+	});
+	PendingTextures.erase(Applied, PendingTextures.end());
+
+	// Instances pick theirs up later this frame, the entries go once nothing holds the asset they replace.
+	std::erase_if(Reloads, [](const ModelReplacement& InReplacement) { return InReplacement.Previous.expired(); });
+
+	for (auto& Replacement : PendingModels)
+	{
+		Reloads.push_back(std::move(Replacement));
+		++PendingStatistics.ReloadedModelNum;
+	}
+
+	PendingModels.clear();
+	LastStatistics = PendingStatistics;
+}
+
+std::shared_ptr<const ModelAsset> AssetReloader::FindReload(const ModelAsset& InAsset) const
+{
+	const ModelAsset* Current = &InAsset;
+	std::shared_ptr<const ModelAsset> Latest;
+
+	// Every reload of a file supersedes the one before, so the chain is followed to its end.
+	while (true)
+	{
+		const auto Found = std::find_if(Reloads.begin(), Reloads.end(), [Current](const ModelReplacement& InReplacement)
+		{
+			return InReplacement.Previous.lock().get() == Current;
+		});
+
+		if (Found == Reloads.end())
+		{
+			return Latest;
+		}
+
+		Latest = Found->Reloaded;
+		Current = Latest.get();
+	}
+}
+
+void AssetReloader::WatchLoop()
+{
+	// Imports spread their meshes over the background workers too.
+	JobSystem::Get().JoinLane(JobLane::Background);
+	std::unique_lock Lock(SleepMutex);
+
+	while (!WakeCondition.wait_for(Lock, PollInterval, [this] { return bIsStopping; }))
+	{
+		Lock.unlock();
+		Poll();
+		Lock.lock();
+	}
+}
+
+void AssetReloader::Poll()
+{
+	std::lock_guard Lock(PassMutex);
+
+	// Several textures and assets can read the same file, each is only asked about once per poll.
+	std::map<std::string, bool> Changed;
+	ReloadTextures(Changed);
+	ReloadModels(Changed);
+}
+
+bool AssetReloader::HasChanged(const std::filesystem::path& InPath)
+{
+	if (AssetArchive::Get().Contains(InPath))
+	{
+		return false;
+	}
+
+	// Editors often replace the file, which can briefly fail the query.
+	std::error_code Error;
+	const auto WriteTime = std::filesystem::last_write_time(InPath, Error);
+
+	if (Error)
+	{
+		return false;
+	}
+
+	const auto [Known, bIsNew] = FileTimes.try_emplace(InPath, WriteTime);
+
+	if (bIsNew || Known->second == WriteTime)
+	{
+		return false;
+	}
+
+	Known->second = WriteTime;
+	return true;
+}
+
+void AssetReloader::ReloadTextures(std::map<std::string, bool>& InOutChanged)
+{
+	for (const auto& Target : BindManager::GetAll<Texture>())
+	{
+		if (Target->IsVirtual())
+		{
+			continue;
+		}
+
+		const auto& FileName = Target->GetSourceFileName();
+
+		const auto [Known, bIsNew] = InOutChanged.try_emplace(FileName, false);
+
+		if (bIsNew)
+		{
+			Known->second = HasChanged(FileName);
+		}
+
+		if (!Known->second)
+		{
+			continue;
+		}
+
+		try
+		{
+			PendingTextures.push_back({Target, Target->Reload(MyGraphics)});
+		}
+		catch (const std::exception& Exception)
+		{
+			// Often a file still being written, the write that finishes it changes it again.
+			++PendingStatistics.FailedNum;
+			Report(FileName + " failed to load, " + Exception.what());
+		}
+	}
+}
+
+void AssetReloader::ReloadModels(std::map<std::string, bool>& InOutChanged)
+{
+	std::erase_if(Superseded, [](const std::weak_ptr<const ModelAsset>& InAsset) { return InAsset.expired(); });
+
+	for (const auto& Previous : ModelAsset::GetLoaded())
+	{
+		if (std::any_of(Superseded.begin(), Superseded.end(), [&Previous](const std::weak_ptr<const ModelAsset>& InAsset) { return IsSameAsset(InAsset, Previous); }))
+		{
+			continue;
+		}
+
+		const auto& FileName = Previous->GetSourcePath();
+
+		const auto [Known, bIsNew] = InOutChanged.try_emplace(FileName, false);
+
+		if (bIsNew)
+		{
+			Known->second = HasChanged(FileName);
+		}
+
+		if (!Known->second)
+		{
+			continue;
+		}
+
+		// A revision of its own gives the import buffers the old meshes don't share, the options are otherwise the same.
+		auto Options = Previous->GetOptions();
+		Options.Revision = NextRevision++;
+
+		try
+		{
+			auto Reloaded = ModelAsset::Resolve(MyGraphics, FileName, Options);
+
+			// Still watched, a later change may bring the nodes back.
+			if (Reloaded->GetNodes()->Names != Previous->GetNodes()->Names)
+			{
+				++PendingStatistics.FailedNum;
+				Report(FileName + " has other nodes now, restart to load it.");
+				continue;
+			}
+
+			Superseded.push_back(Previous);
+			PendingModels.push_back({Previous, std::move(Reloaded)});
+		}
+		catch (const std::exception& Exception)
+		{
+			++PendingStatistics.FailedNum;
+			Report(FileName + " failed to import, " + Exception.what());
+		}
+	}
+}
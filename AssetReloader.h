@@ -0,0 +1,98 @@
+﻿#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Graphics;
+class ModelAsset;
+class Texture;
+
+/**
+ * Watch mode for the textures and models the scene holds. A background thread polls the files every live Texture and ModelAsset
+ * was read from and, when one changes, reads only what came from it again: a texture is decoded and created anew, a model is
+ * imported again with the options it was imported with. Nothing else is rebuilt.
+ * A reloaded texture is swapped into the Texture object the BindManager already shares, so every material reading it sees the new
+ * one without resolving anything. A reimported model gets buffers of its own, and every ModelInstance of the old asset moves over
+ * to it through ModelInstance::ApplyReload, keeping its placement, its node transforms and its window.
+ * Swaps happen in Apply between frames, so recording threads never see a resource change halfway. Files read from the asset
+ * archive aren't watched, the archive wins over a loose copy anyway, and neither are virtual textures, whose tiles the cache laid
+ * out for the old file. A cooked map is watched through its .dds. A model whose nodes changed keeps its old import.
+ */
+class AssetReloader
+{
+public:
+	struct Statistics
+	{
+		unsigned int ReloadedTextureNum {0u};
+		unsigned int ReloadedModelNum {0u};
+		unsigned int FailedNum {0u};
+	};
+
+	explicit AssetReloader(const Graphics& InGraphics);
+	AssetReloader(const AssetReloader&) = delete;
+	AssetReloader(AssetReloader&&) = delete;
+	AssetReloader& operator=(const AssetReloader&) = delete;
+	AssetReloader& operator=(AssetReloader&&) = delete;
+	~AssetReloader();
+
+	// Swaps in what the watcher reloaded, on the main thread before anything records. Skipped while a poll is running.
+	void Apply() noexcept;
+
+	// The import that replaced InAsset once Apply took it over, the latest one when the file changed again since. Null otherwise.
+	// Main thread only.
+	[[nodiscard]] std::shared_ptr<const ModelAsset> FindReload(const ModelAsset& InAsset) const;
+
+	// Counted since the reloader was created, as of the last Apply.
+	[[nodiscard]] Statistics GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+private:
+	// Defined with the texture's reloaded levels.
+	struct TextureReplacement;
+
+	struct ModelReplacement
+	{
+		std::weak_ptr<const ModelAsset> Previous;
+		std::shared_ptr<const ModelAsset> Reloaded;
+	};
+
+	static constexpr auto PollInterval {std::chrono::milliseconds(500)};
+
+	void WatchLoop();
+	void Poll();
+	// The first time a file is seen only records its write time.
+	[[nodiscard]] bool HasChanged(const std::filesystem::path& InPath);
+	void ReloadTextures(std::map<std::string, bool>& InOutChanged);
+	void ReloadModels(std::map<std::string, bool>& InOutChanged);
+
+private:
+	const Graphics& MyGraphics;
+	std::map<std::filesystem::path, std::filesystem::file_time_type> FileTimes;
+	// Assets the watcher has reimported already, only their replacements are watched from then on.
+	std::vector<std::weak_ptr<const ModelAsset>> Superseded;
+	unsigned int NextRevision {1u};
+
+	// Held by a whole poll, Apply only swaps when it gets it without waiting.
+	std::mutex PassMutex;
+	// Textures with streamed levels in flight stay here until a later Apply.
+	std::vector<TextureReplacement> PendingTextures;
+	std::vector<ModelReplacement> PendingModels;
+	Statistics PendingStatistics;
+	Statistics LastStatistics;
+
+	// What Apply took over, kept while an instance may still hold the previous asset.
+	std::vector<ModelReplacement> Reloads;
+
+	std::mutex SleepMutex;
+	std::condition_variable WakeCondition;
+	bool bIsStopping {false};
+	std::thread Watcher;
+};
@@ -0,0 +1,90 @@
+﻿#include "AtlasAllocator.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+AtlasAllocator::AtlasAllocator(const unsigned int InSize, const unsigned int InMinTileSize)
+	: Size(InSize)
+{
+	assert(std::has_single_bit(InSize) && std::has_single_bit(InMinTileSize) && InMinTileSize <= InSize && "Tiles halve down to the smallest");
+
+	FreeNodes.resize(std::countr_zero(InSize) - std::countr_zero(InMinTileSize) + 1u);
+	FreeNodes.front().push_back({0u, 0u});
+}
+
+std::optional<AtlasAllocator::Tile> AtlasAllocator::Allocate(const unsigned int InTileSize)
+{
+	const auto Level = GetLevel(InTileSize);
+
+	// The smallest free node at least as large, split down to the size asked for.
+	auto FreeLevel = Level;
+
+	while (FreeNodes[FreeLevel].empty())
+	{
+		if (FreeLevel == 0u)
+		{
+			return std::nullopt;
+		}
+
+		--FreeLevel;
+	}
+
+	auto Allocated = FreeNodes[FreeLevel].back();
+	FreeNodes[FreeLevel].pop_back();
+
+	for (; FreeLevel < Level; ++FreeLevel)
+	{
+		const auto ChildSize = Size >> (FreeLevel + 1u);
+
+		FreeNodes[FreeLevel + 1u].push_back({Allocated.X + ChildSize, Allocated.Y});
+		FreeNodes[FreeLevel + 1u].push_back({Allocated.X, Allocated.Y + ChildSize});
+		FreeNodes[FreeLevel + 1u].push_back({Allocated.X + ChildSize, Allocated.Y + ChildSize});
+	}
+
+	const Tile Result {Allocated.X, Allocated.Y, Size >> Level};
+	AllocatedArea += static_cast<unsigned long long>(Result.Size) * Result.Size;
+	return Result;
+}
+
+void AtlasAllocator::Free(const Tile& InTile)
+{
+	assert(InTile.Size <= Size && InTile.X % InTile.Size == 0u && InTile.Y % InTile.Size == 0u && "Tile was not handed out by this allocator");
+
+	AllocatedArea -= static_cast<unsigned long long>(InTile.Size) * InTile.Size;
+
+	auto Level = GetLevel(InTile.Size);
+	Node Freed {InTile.X, InTile.Y};
+
+	// Merges upwards while all four siblings are free.
+	while (Level > 0u)
+	{
+		const auto NodeSize = Size >> Level;
+		const auto ParentX = Freed.X & ~(2u * NodeSize - 1u);
+		const auto ParentY = Freed.Y & ~(2u * NodeSize - 1u);
+		auto& LevelNodes = FreeNodes[Level];
+
+		const auto IsSibling = [&](const Node& InNode)
+		{
+			return (InNode.X & ~(2u * NodeSize - 1u)) == ParentX && (InNode.Y & ~(2u * NodeSize - 1u)) == ParentY;
+		};
+
+		if (std::count_if(LevelNodes.begin(), LevelNodes.end(), IsSibling) != 3)
+		{
+			break;
+		}
+
+		LevelNodes.erase(std::remove_if(LevelNodes.begin(), LevelNodes.end(), IsSibling), LevelNodes.end());
+		Freed = {ParentX, ParentY};
+		--Level;
+	}
+
+	FreeNodes[Level].push_back(Freed);
+}
+
+unsigned int AtlasAllocator::GetLevel(const unsigned int InTileSize) const noexcept
+{
+	const auto MaxLevel = static_cast<unsigned int>(FreeNodes.size()) - 1u;
+	const auto TileSize = std::bit_ceil(std::max(InTileSize, 1u));
+
+	return TileSize >= Size ? 0u : std::min(static_cast<unsigned int>(std::countr_zero(Size) - std::countr_zero(TileSize)), MaxLevel);
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+#include <optional>
+#include <vector>
+
+/**
+ * Quadtree allocator of square power of two tiles in a square atlas, also a power of two.
+ * Every node is either free, split into four children or handed out. Allocating splits the smallest free node that
+ * fits, freeing merges four free siblings back into their parent, so freed space becomes available for large tiles again.
+ */
+class AtlasAllocator
+{
+public:
+	struct Tile
+	{
+		unsigned int X {0u};
+		unsigned int Y {0u};
+		unsigned int Size {0u};
+	};
+
+	AtlasAllocator(unsigned int InSize, unsigned int InMinTileSize);
+
+	// A tile of InTileSize, rounded up to a power of two and to the smallest tile, none when no free node is that large.
+	[[nodiscard]] std::optional<Tile> Allocate(unsigned int InTileSize);
+	void Free(const Tile& InTile);
+
+	[[nodiscard]] unsigned int GetSize() const noexcept
+	{
+		return Size;
+	}
+
+	// Texels in tiles handed out.
+	[[nodiscard]] unsigned long long GetAllocatedArea() const noexcept
+	{
+		return AllocatedArea;
+	}
+
+private:
+	struct Node
+	{
+		unsigned int X;
+		unsigned int Y;
+	};
+
+	[[nodiscard]] unsigned int GetLevel(unsigned int InTileSize) const noexcept;
+
+	// Free nodes by level, level zero is the whole atlas and every further level halves the size.
+	std::vector<std::vector<Node>> FreeNodes;
+	unsigned int Size;
+	unsigned long long AllocatedArea {0u};
+};
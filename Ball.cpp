@@ -1,34 +1,26 @@
 ﻿#include "Ball.h"
-#include "Sphere.h"
 #include "Bindables.h"
+#include "GeometryCache.h"
 #include "TransformConstantBuffer.h"
 
-Ball::Ball(Graphics& InGraphics, std::mt19937& InRandomGenerator, std::uniform_real_distribution<float>& InA,
-           std::uniform_real_distribution<float>& InB, std::uniform_real_distribution<float>& InC,
-           std::uniform_real_distribution<float>& InD, std::uniform_int_distribution<int>& InLongitude,
-           std::uniform_int_distribution<int>& InLatitude)
-	: X(InD(InRandomGenerator)),
-	  Theta(InA(InRandomGenerator)), Phi(InA(InRandomGenerator)), Chi(InA(InRandomGenerator)),
-	  DeltaRoll(InB(InRandomGenerator)), DeltaPitch(InB(InRandomGenerator)), DeltaYaw(InB(InRandomGenerator)),
-	  DeltaTheta(InC(InRandomGenerator)), DeltaPhi(InC(InRandomGenerator)), DeltaChi(InC(InRandomGenerator))
+Ball::Ball(const Graphics& InGraphics, const EntityStore& InStore, const EntityStore::Entity InEntity, std::mt19937& InRandomGenerator,
+           std::uniform_int_distribution<int>& InLongitude, std::uniform_int_distribution<int>& InLatitude)
+	: Store(InStore), MyEntity(InEntity)
 {
-	struct Vertex
-	{
-		DirectX::XMFLOAT3 Position;
-	};
-
-	auto Model = Sphere::Make();
-	Model.Transform(DirectX::XMMatrixScaling(1.0f, 1.0f, 1.2f));
+	// Every tessellation the distributions pick is generated once, balls of the same one share its buffers.
+	const auto LatitudeDivisions = InLatitude(InRandomGenerator);
+	const auto LongitudeDivisions = InLongitude(InRandomGenerator);
+	const auto& Geometry = GeometryCache::Get(GeometryCache::Shape::Sphere, {DV::VertexLayout::ElementType::Position3D}, LatitudeDivisions, LongitudeDivisions);
 
-	Bind(std::make_shared<VertexBuffer>(InGraphics, Model.Vertices));
+	Bind(VertexBuffer::Resolve(InGraphics, Geometry.Tag, Geometry.Model.Vertices));
 
-	Bind(std::make_shared<IndexBuffer>(InGraphics, Model.Indices));
+	Bind(IndexBuffer::Resolve(InGraphics, Geometry.Tag, Geometry.Model.Indices));
 
-	auto ModelVertexShader = std::make_shared<VertexShader>(InGraphics, "ColorIndexVS.cso");
-	auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
+	auto ModelVertexShader = VertexShader::Resolve(InGraphics, "ColorIndexVS.cso");
+	Bind(InputLayout::Resolve(InGraphics, Geometry.Model.Vertices.GetLayout(), ModelVertexShader->GetByteCode()));
 	Bind(std::move(ModelVertexShader));
 
-	Bind(std::make_shared<PixelShader>(InGraphics, "ColorIndexPS.cso"));
+	Bind(PixelShader::Resolve(InGraphics, "ColorIndexPS.cso"));
 
 	struct PSColorConstants
 	{
@@ -55,31 +47,14 @@ Ball::Ball(Graphics& InGraphics, std::mt19937& InRandomGenerator, std::uniform_r
 		}
 	};
 
-	Bind(std::make_shared<PixelConstantBuffer<PSColorConstants>>(InGraphics, ModelColorConstants));
-
-	const std::vector<D3D11_INPUT_ELEMENT_DESC> ModelInputElementDescs =
-	{
-		{
-			"Position",
-			0,
-			DXGI_FORMAT_R32G32B32_FLOAT,
-			0,
-			0,
-			D3D11_INPUT_PER_VERTEX_DATA,
-			0
-		}
-	};
-
-	// Bind(std::make_shared<InputLayout>(InGraphics, ModelInputElementDescs, ModelVertexShaderBlob));
+	Bind(PixelConstantBuffer<PSColorConstants>::Resolve(InGraphics, ModelColorConstants));
 
-	Bind(std::make_shared<Topology>(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
+	Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
 
 	Bind(std::make_shared<TransformConstantBuffer>(InGraphics, *this, TransformConstantBuffer::Target::Vertex));
 }
 
 DirectX::XMMATRIX Ball::GetTransformMatrix() const noexcept
 {
-	return DirectX::XMMatrixRotationRollPitchYaw(Pitch, Yaw, Roll) *
-		   DirectX::XMMatrixTranslation(X, 0.0f, 0.0f) *
-		   DirectX::XMMatrixRotationRollPitchYaw(Theta, Phi, Chi);
+	return Store.GetTransform(MyEntity);
 }
@@ -1,29 +1,28 @@
 ﻿#pragma once
 #include <random>
 #include "Drawable.h"
+#include "EntityStore.h"
 
 class Ball : public Drawable
 {
 public:
-	Ball(Graphics& InGraphics, std::mt19937& InRandomGenerator, std::uniform_real_distribution<float>& InA,
-	    std::uniform_real_distribution<float>& InB, std::uniform_real_distribution<float>& InC,
-	    std::uniform_real_distribution<float>& InD, std::uniform_int_distribution<int>& InLongitude,
-		std::uniform_int_distribution<int>& InLatitude);
+	// Stretched along z by the entity's scale rather than in the mesh, which is the cached unit sphere.
+	static constexpr DirectX::XMFLOAT3 Scale {1.0f, 1.0f, 1.2f};
+	// Of the unit sphere, for the entity's bounds.
+	static constexpr DirectX::XMFLOAT3 Extents {1.0f, 1.0f, 1.0f};
+
+	// InEntity moves the ball, the store outlives it.
+	Ball(const Graphics& InGraphics, const EntityStore& InStore, EntityStore::Entity InEntity, std::mt19937& InRandomGenerator,
+	     std::uniform_int_distribution<int>& InLongitude, std::uniform_int_distribution<int>& InLatitude);
 
 	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept override;
 
+	[[nodiscard]] EntityStore::Entity GetEntity() const noexcept
+	{
+		return MyEntity;
+	}
+
 private:
-	float X;
-	float Roll = 0.0f;
-	float Pitch = 0.0f;
-	float Yaw = 0.0f;
-	float Theta;
-	float Phi;
-	float Chi;
-	float DeltaRoll;
-	float DeltaPitch;
-	float DeltaYaw;
-	float DeltaTheta;
-	float DeltaPhi;
-	float DeltaChi;
+	const EntityStore& Store;
+	EntityStore::Entity MyEntity;
 };
@@ -0,0 +1,285 @@
+﻿#include "Benchmark.h"
+#include "EngineWin.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <psapi.h>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include "Camera.h"
+#include "EngineMath.h"
+#include "Graphics.h"
+
+namespace
+{
+	// Nearest rank, so every reported value is a frame that actually happened.
+	float GetPercentile(const std::vector<float>& InSortedTimes, const float InPercentile) noexcept
+	{
+		const auto Rank = static_cast<size_t>(std::ceil(InPercentile * static_cast<float>(InSortedTimes.size())));
+		return InSortedTimes[std::clamp<size_t>(Rank, 1u, InSortedTimes.size()) - 1u];
+	}
+
+	std::string EscapeJson(const std::string_view InText)
+	{
+		std::string Escaped;
+		Escaped.reserve(InText.size());
+
+		for (const char Character : InText)
+		{
+			if (Character == '"' || Character == '\\')
+			{
+				Escaped.push_back('\\');
+			}
+
+			Escaped.push_back(Character);
+		}
+
+		return Escaped;
+	}
+}
+
+Benchmark::Benchmark(const std::string& InSceneFileName)
+	: SceneFileName(InSceneFileName)
+{
+	std::ifstream Stream(InSceneFileName);
+
+	if (!Stream)
+	{
+		throw std::runtime_error("Cannot open benchmark scene " + InSceneFileName);
+	}
+
+	Parse(Stream);
+
+	if (Keyframes.empty() || FrameNum == 0u || Timestep <= 0.0f)
+	{
+		throw std::runtime_error("Benchmark scene " + InSceneFileName + " needs at least one key, frames and a positive timestep");
+	}
+
+	FrameTimes.reserve(FrameNum);
+}
+
+void Benchmark::Parse(std::istream& InStream)
+{
+	std::string Line;
+
+	while (std::getline(InStream, Line))
+	{
+		std::istringstream LineStream(Line);
+		std::string Keyword;
+
+		// Blank lines and comments.
+		if (!(LineStream >> Keyword) || Keyword.front() == '#')
+		{
+			continue;
+		}
+
+		if (Keyword == "model")
+		{
+			std::getline(LineStream >> std::ws, ModelFileName);
+		}
+		else if (Keyword == "report")
+		{
+			std::getline(LineStream >> std::ws, ReportFileName);
+		}
+		else if (Keyword == "frames")
+		{
+			LineStream >> FrameNum;
+		}
+		else if (Keyword == "warmup")
+		{
+			LineStream >> WarmupFrameNum;
+		}
+		else if (Keyword == "timestep")
+		{
+			LineStream >> Timestep;
+		}
+		else if (Keyword == "key")
+		{
+			Keyframe Key {};
+			LineStream >> Key.Time >> Key.Position.x >> Key.Position.y >> Key.Position.z >> Key.Pitch >> Key.Yaw;
+			Keyframes.push_back(Key);
+		}
+		else
+		{
+			throw std::runtime_error("Unknown keyword " + Keyword + " in benchmark scene " + SceneFileName);
+		}
+
+		if (LineStream.fail())
+		{
+			throw std::runtime_error("Malformed line \"" + Line + "\" in benchmark scene " + SceneFileName);
+		}
+	}
+
+	std::stable_sort(Keyframes.begin(), Keyframes.end(), [](const Keyframe& InLeft, const Keyframe& InRight)
+	{
+		return InLeft.Time < InRight.Time;
+	});
+}
+
+void Benchmark::Advance(Camera& InCamera, const bool bInIsSceneReady) noexcept
+{
+	// Warmup frames hold the first pose, so the measured frames always cover the same stretch of the path.
+	const auto MeasuredIndex = AdvancedFrameNum >= WarmupFrameNum ? AdvancedFrameNum - WarmupFrameNum : 0u;
+	bIsMeasuring = bInIsSceneReady && AdvancedFrameNum >= WarmupFrameNum;
+
+	if (bInIsSceneReady)
+	{
+		++AdvancedFrameNum;
+	}
+
+	// Fixed steps instead of wall time, the path is the same however long a frame takes.
+	const auto Duration = Keyframes.back().Time - Keyframes.front().Time;
+	auto Time = Keyframes.front().Time + static_cast<float>(MeasuredIndex) * Timestep;
+
+	if (Duration > 0.0f)
+	{
+		Time = Keyframes.front().Time + std::fmod(Time - Keyframes.front().Time, Duration);
+	}
+
+	const auto Next = std::upper_bound(Keyframes.begin(), Keyframes.end(), Time, [](const float InTime, const Keyframe& InKey)
+	{
+		return InTime < InKey.Time;
+	});
+
+	const auto Last = Keyframes.size() - 1u;
+	const auto Index2 = std::min(static_cast<size_t>(Next - Keyframes.begin()), Last);
+	const auto Index1 = Index2 > 0u ? Index2 - 1u : 0u;
+	const auto Index0 = Index1 > 0u ? Index1 - 1u : 0u;
+	const auto Index3 = std::min(Index2 + 1u, Last);
+
+	const auto SegmentLength = Keyframes[Index2].Time - Keyframes[Index1].Time;
+	const auto Alpha = SegmentLength > 0.0f ? std::clamp((Time - Keyframes[Index1].Time) / SegmentLength, 0.0f, 1.0f) : 0.0f;
+
+	const auto Interpolate = [&](const auto& InSelect)
+	{
+		return DirectX::XMVectorCatmullRom(InSelect(Keyframes[Index0]), InSelect(Keyframes[Index1]), InSelect(Keyframes[Index2]), InSelect(Keyframes[Index3]), Alpha);
+	};
+
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMStoreFloat3(&Position, Interpolate([](const Keyframe& InKey)
+	{
+		return DirectX::XMLoadFloat3(&InKey.Position);
+	}));
+
+	DirectX::XMFLOAT2 Rotation;
+	DirectX::XMStoreFloat2(&Rotation, Interpolate([](const Keyframe& InKey)
+	{
+		return DirectX::XMVectorSet(InKey.Pitch, InKey.Yaw, 0.0f, 0.0f);
+	}));
+
+	InCamera.SetPose(Position, Math::DegreeToRadian(Rotation.x), Math::DegreeToRadian(Rotation.y));
+}
+
+void Benchmark::Record(const Graphics& InGraphics)
+{
+	if (!bIsMeasuring || IsDone())
+	{
+		return;
+	}
+
+	++RecordedFrameNum;
+	FrameTimes.push_back(FrameProfiler::GetLastFrameTime());
+
+	FrameProfiler::GetLastTimings(CpuTimings);
+
+	for (const auto& [Name, Depth, Milliseconds, CallNum] : CpuTimings)
+	{
+		Accumulate(CpuZones, Name, Depth, Milliseconds, CallNum);
+	}
+
+	// GPU timings, bindings and draws trail the frame by the readback latency or by one frame, over a whole run that evens out.
+	for (const auto& [Name, Depth, Milliseconds] : InGraphics.GetGpuProfiler().GetLastTimings())
+	{
+		Accumulate(GpuZones, Name, Depth, Milliseconds, 1u);
+	}
+
+	const auto Statistics = InGraphics.GetStateStatistics();
+	IssuedCallSum += Statistics.IssuedCalls;
+	SavedCallSum += Statistics.SavedCalls;
+	DrawCallSum += Statistics.DrawCalls;
+	MaxDrawCallNum = std::max(MaxDrawCallNum, Statistics.DrawCalls);
+
+	bIsHalfPrecision = InGraphics.UsesHalfPrecision();
+
+	const auto& [ArenaBytes, ArenaOverflowNum, HeapAllocationNum] = InGraphics.GetFrameArenaStatistics();
+	MaxFrameArenaBytes = std::max(MaxFrameArenaBytes, ArenaBytes);
+	HeapAllocationSum += HeapAllocationNum;
+}
+
+void Benchmark::Accumulate(std::vector<ZoneTotal>& InTotals, const char* InName, const unsigned int InDepth, const float InMilliseconds, const unsigned int InCallNum)
+{
+	// Zone names are string literals, so the pointer identifies the zone.
+	auto Total = std::find_if(InTotals.begin(), InTotals.end(), [InName](const ZoneTotal& InTotal)
+	{
+		return InTotal.Name == InName;
+	});
+
+	if (Total == InTotals.end())
+	{
+		Total = InTotals.insert(InTotals.end(), ZoneTotal {InName, InDepth});
+	}
+
+	Total->Milliseconds += InMilliseconds;
+	Total->MaxMilliseconds = std::max(Total->MaxMilliseconds, InMilliseconds);
+	Total->CallNum += InCallNum;
+}
+
+bool Benchmark::WriteReport() const
+{
+	std::ofstream Stream(ReportFileName);
+
+	if (!Stream || FrameTimes.empty())
+	{
+		return false;
+	}
+
+	auto SortedTimes = FrameTimes;
+	std::sort(SortedTimes.begin(), SortedTimes.end());
+
+	double TimeSum = 0.0;
+	for (const auto FrameTime : SortedTimes)
+	{
+		TimeSum += FrameTime;
+	}
+
+	const auto FrameCount = static_cast<double>(RecordedFrameNum);
+
+	PROCESS_MEMORY_COUNTERS MemoryCounters {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &MemoryCounters, sizeof(MemoryCounters));
+
+	const auto WriteZones = [&](const std::vector<ZoneTotal>& InZones)
+	{
+		for (size_t Index = 0u; Index < InZones.size(); ++Index)
+		{
+			const auto& [Name, Depth, Milliseconds, MaxMilliseconds, CallNum] = InZones[Index];
+			Stream << "\t\t{\"Name\": \"" << EscapeJson(Name) << "\", \"Depth\": " << Depth
+			       << ", \"AverageMilliseconds\": " << Milliseconds / FrameCount << ", \"MaxMilliseconds\": " << MaxMilliseconds
+			       << ", \"AverageCalls\": " << CallNum / FrameCount << '}' << (Index + 1u < InZones.size() ? "," : "") << '\n';
+		}
+	};
+
+	Stream << "{\n";
+	Stream << "\t\"Scene\": \"" << EscapeJson(SceneFileName) << "\",\n";
+	Stream << "\t\"Model\": \"" << EscapeJson(ModelFileName) << "\",\n";
+	Stream << "\t\"Frames\": " << RecordedFrameNum << ",\n";
+	Stream << "\t\"Timestep\": " << Timestep << ",\n";
+	// Runs with and without --full-precision are told apart by it.
+	Stream << "\t\"HalfPrecision\": " << (bIsHalfPrecision ? "true" : "false") << ",\n";
+	Stream << "\t\"FrameMilliseconds\": {\"Min\": " << SortedTimes.front() << ", \"Average\": " << TimeSum / FrameCount
+	       << ", \"P50\": " << GetPercentile(SortedTimes, 0.50f) << ", \"P95\": " << GetPercentile(SortedTimes, 0.95f)
+	       << ", \"P99\": " << GetPercentile(SortedTimes, 0.99f) << ", \"Max\": " << SortedTimes.back() << "},\n";
+	Stream << "\t\"CpuZones\": [\n";
+	WriteZones(CpuZones);
+	Stream << "\t],\n";
+	Stream << "\t\"GpuZones\": [\n";
+	WriteZones(GpuZones);
+	Stream << "\t],\n";
+	Stream << "\t\"DrawCalls\": {\"Average\": " << DrawCallSum / FrameCount << ", \"Max\": " << MaxDrawCallNum << "},\n";
+	Stream << "\t\"BindCalls\": {\"AverageIssued\": " << IssuedCallSum / FrameCount << ", \"AverageSaved\": " << SavedCallSum / FrameCount << "},\n";
+	Stream << "\t\"Memory\": {\"PeakWorkingSetBytes\": " << MemoryCounters.PeakWorkingSetSize << ", \"PeakCommitBytes\": " << MemoryCounters.PeakPagefileUsage
+	       << ", \"PeakFrameArenaBytes\": " << MaxFrameArenaBytes << ", \"AverageHeapAllocations\": " << HeapAllocationSum / FrameCount << "}\n";
+	Stream << "}\n";
+
+	return static_cast<bool>(Stream);
+}
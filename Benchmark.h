@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "FrameProfiler.h"
+
+class Camera;
+class Graphics;
+
+/**
+ * Repeatable performance run started with --benchmark, so builds are compared by numbers instead of by feel.
+ * The scene description names the model and camera keyframes, the camera follows a Catmull-Rom spline through them
+ * at a fixed timestep while frames render as fast as they can, and the collected statistics are written as JSON.
+ */
+class Benchmark
+{
+public:
+	explicit Benchmark(const std::string& InSceneFileName);
+	Benchmark(const Benchmark&) = delete;
+	Benchmark(Benchmark&&) = delete;
+	Benchmark& operator=(const Benchmark&) = delete;
+	Benchmark& operator=(Benchmark&&) = delete;
+	~Benchmark() = default;
+
+	// Poses the camera for the next frame, nothing is measured until the scene has loaded and the warmup frames are over.
+	void Advance(Camera& InCamera, bool bInIsSceneReady) noexcept;
+	// Collects the frame FrameProfiler::BeginFrame just closed, if it was a measured one.
+	void Record(const Graphics& InGraphics);
+	[[nodiscard]] bool WriteReport() const;
+
+	[[nodiscard]] const std::string& GetModelFileName() const noexcept
+	{
+		return ModelFileName;
+	}
+
+	[[nodiscard]] const std::string& GetReportFileName() const noexcept
+	{
+		return ReportFileName;
+	}
+
+	[[nodiscard]] bool IsDone() const noexcept
+	{
+		return RecordedFrameNum >= FrameNum;
+	}
+
+	static constexpr const char* DefaultSceneFileName = "Benchmark.txt";
+
+private:
+	struct Keyframe
+	{
+		float Time;
+		DirectX::XMFLOAT3 Position;
+		// Degrees, not wrapped, so a turn through more than half a circle interpolates the long way as written.
+		float Pitch;
+		float Yaw;
+	};
+
+	struct ZoneTotal
+	{
+		const char* Name;
+		unsigned int Depth;
+		double Milliseconds {0.0};
+		float MaxMilliseconds {0.0f};
+		unsigned int CallNum {0u};
+	};
+
+	void Parse(std::istream& InStream);
+	static void Accumulate(std::vector<ZoneTotal>& InTotals, const char* InName, unsigned int InDepth, float InMilliseconds, unsigned int InCallNum);
+
+private:
+	std::string SceneFileName;
+	std::string ModelFileName {"Models\\nanosuit_textured\\nanosuit.obj"};
+	std::string ReportFileName {"BenchmarkReport.json"};
+	std::vector<Keyframe> Keyframes;
+	unsigned int FrameNum {1000u};
+	unsigned int WarmupFrameNum {60u};
+	float Timestep {1.0f / 60.0f};
+
+	unsigned int AdvancedFrameNum {0u};
+	unsigned int RecordedFrameNum {0u};
+	bool bIsMeasuring {false};
+	bool bIsHalfPrecision {false};
+
+	std::vector<float> FrameTimes;
+	std::vector<FrameProfiler::Timing> CpuTimings;
+	std::vector<ZoneTotal> CpuZones;
+	std::vector<ZoneTotal> GpuZones;
+	unsigned long long DrawCallSum {0u};
+	unsigned int MaxDrawCallNum {0u};
+	unsigned long long IssuedCallSum {0u};
+	unsigned long long SavedCallSum {0u};
+	size_t MaxFrameArenaBytes {0u};
+	unsigned long long HeapAllocationSum {0u};
+};
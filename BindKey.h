@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include "StringAtom.h"
+
+/**
+ * 64-bit identity of a shared bindable, the FNV-1a hash of its type folded with each identifying parameter.
+ * Built without touching the heap so BindManager lookups stay cheap on hot paths.
+ */
+class BindKey
+{
+public:
+	template<typename T, typename... Params>
+	[[nodiscard]] static BindKey Make(const Params&... InParams) noexcept
+	{
+		BindKey Key;
+		Key.Combine(static_cast<uint64_t>(typeid(T).hash_code()));
+		(Key.Combine(InParams), ...);
+		return Key;
+	}
+
+	void Combine(const std::string_view InString) noexcept
+	{
+		// The length keeps ("ab", "c") and ("a", "bc") apart.
+		Combine(static_cast<uint64_t>(InString.size()));
+
+		for (const char Character : InString)
+		{
+			Mix(static_cast<uint8_t>(Character));
+		}
+	}
+
+	// Interned strings are folded as their atom, without reading the string again.
+	void Combine(const StringAtom InAtom) noexcept
+	{
+		Combine(InAtom.GetId());
+	}
+
+	// For plain data identified by its contents, such as blocks of constants. Padding has to be zeroed or equal blocks differ.
+	void CombineBytes(const void* InData, const size_t InSize) noexcept
+	{
+		Combine(static_cast<uint64_t>(InSize));
+
+		for (size_t Index = 0u; Index < InSize; ++Index)
+		{
+			Mix(static_cast<const uint8_t*>(InData)[Index]);
+		}
+	}
+
+	template<typename T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>, int> = 0>
+	void Combine(const T InValue) noexcept
+	{
+		const auto Bits = static_cast<uint64_t>(InValue);
+
+		for (unsigned int Shift = 0; Shift < 64u; Shift += 8u)
+		{
+			Mix(static_cast<uint8_t>(Bits >> Shift));
+		}
+	}
+
+	[[nodiscard]] uint64_t GetValue() const noexcept
+	{
+		return Value;
+	}
+
+	bool operator==(const BindKey&) const = default;
+
+private:
+	void Mix(const uint8_t InByte) noexcept
+	{
+		Value ^= InByte;
+		Value *= 1099511628211ull;
+	}
+
+private:
+	uint64_t Value {14695981039346656037ull};
+};
+
+template<>
+struct std::hash<BindKey>
+{
+	size_t operator()(const BindKey& InKey) const noexcept
+	{
+		return static_cast<size_t>(InKey.GetValue());
+	}
+};
@@ -1,7 +1,252 @@
 ﻿#include "BindManager.h"
+#include <algorithm>
+#include <fstream>
+#include "ReleaseQueue.h"
+#include "imgui/imgui.h"
 
 BindManager& BindManager::Get()
 {
 	static BindManager MyBindManager;
 	return MyBindManager;
-}
\ No newline at end of file
+}
+
+void BindManager::Trim()
+{
+	auto& Manager = Get();
+	const auto Now = Clock::now();
+	// Retired after the locks are let go, the GPU may still be drawing with them and releasing geometry takes locks of its own.
+	std::vector<std::shared_ptr<Bindable>> Expired;
+
+	for (auto& TargetShard : Manager.Shards)
+	{
+		std::lock_guard Lock(TargetShard.Mutex);
+
+		TargetShard.SharedBindables.ForEach([&](const auto InHandle, CachedBindable& InOutCached)
+		{
+			// Only this lock hands out new references, so a count of one can't go back up behind its back.
+			if (InOutCached.Target.use_count() > 1)
+			{
+				InOutCached.bIsIdle = false;
+			}
+			else if (!InOutCached.bIsIdle)
+			{
+				InOutCached.bIsIdle = true;
+				InOutCached.IdleSince = Now;
+			}
+			else if (Now - InOutCached.IdleSince >= Manager.GracePeriod)
+			{
+				TargetShard.Handles.erase(InOutCached.Key);
+#ifndef NDEBUG
+				TargetShard.DebugNames.erase(InOutCached.Key);
+#endif
+				Expired.push_back(TargetShard.SharedBindables.Remove(InHandle).Target);
+			}
+		});
+	}
+
+	for (auto& Released : Expired)
+	{
+		ReleaseQueue::Retire(std::move(Released));
+	}
+}
+
+void BindManager::Clear()
+{
+	auto& Manager = Get();
+	// Bindables still used elsewhere live on, just without a way to be shared again.
+	std::vector<std::shared_ptr<Bindable>> Released;
+
+	for (auto& TargetShard : Manager.Shards)
+	{
+		std::lock_guard Lock(TargetShard.Mutex);
+
+		TargetShard.SharedBindables.ForEach([&](const auto InHandle, CachedBindable&)
+		{
+			Released.push_back(TargetShard.SharedBindables.Remove(InHandle).Target);
+		});
+
+		TargetShard.Handles.clear();
+#ifndef NDEBUG
+		TargetShard.DebugNames.clear();
+#endif
+	}
+}
+
+std::vector<BindManager::MemoryRecord> BindManager::GetMemoryRecords()
+{
+	std::vector<MemoryRecord> Records;
+
+	for (auto& TargetShard : Get().Shards)
+	{
+		std::lock_guard Lock(TargetShard.Mutex);
+
+		TargetShard.SharedBindables.ForEach([&Records](auto, const CachedBindable& InCached)
+		{
+			const auto Bytes = InCached.Target->GetGpuByteSize();
+
+			if (Bytes == 0u)
+			{
+				return;
+			}
+
+			std::string Type = typeid(*InCached.Target).name();
+			auto Tag = InCached.Target->GetUniqueID();
+
+			// Unique IDs start with the same type name followed by a separator.
+			if (Tag.rfind(Type, 0u) == 0u && Tag.size() > Type.size())
+			{
+				Tag.erase(0u, Type.size() + 1u);
+			}
+
+			if (Type.rfind("class ", 0u) == 0u)
+			{
+				Type.erase(0u, std::char_traits<char>::length("class "));
+			}
+
+			Records.push_back({std::move(Type), std::move(Tag), Bytes, InCached.Target.use_count() - 1});
+		});
+	}
+
+	std::sort(Records.begin(), Records.end(), [](const MemoryRecord& InLeft, const MemoryRecord& InRight)
+	{
+		return InLeft.Bytes > InRight.Bytes;
+	});
+
+	return Records;
+}
+
+bool BindManager::WriteMemoryReport(const std::string& InFileName)
+{
+	std::ofstream Stream(InFileName);
+
+	if (!Stream)
+	{
+		return false;
+	}
+
+	const auto Quote = [](const std::string& InText)
+	{
+		std::string Quoted {'"'};
+
+		for (const char Character : InText)
+		{
+			Quoted.append(Character == '"' ? 2u : 1u, Character);
+		}
+
+		return Quoted + '"';
+	};
+
+	Stream << "Type,Tag,Bytes,References\n";
+
+	for (const auto& [Type, Tag, Bytes, ReferenceNum] : GetMemoryRecords())
+	{
+		Stream << Quote(Type) << ',' << Quote(Tag) << ',' << Bytes << ',' << ReferenceNum << '\n';
+	}
+
+	return static_cast<bool>(Stream);
+}
+
+void BindManager::ShowMemoryWindow()
+{
+	if (!ImGui::Begin("GPU Memory"))
+	{
+		ImGui::End();
+		return;
+	}
+
+	const auto Records = GetMemoryRecords();
+
+	struct Total
+	{
+		std::string Name;
+		size_t Bytes {0u};
+		unsigned int Num {0u};
+	};
+
+	const auto Summarize = [&Records](const auto InSelect)
+	{
+		std::vector<Total> Totals;
+
+		for (const auto& Record : Records)
+		{
+			const auto& Name = InSelect(Record);
+			auto Found = std::find_if(Totals.begin(), Totals.end(), [&Name](const Total& InTotal)
+			{
+				return InTotal.Name == Name;
+			});
+
+			if (Found == Totals.end())
+			{
+				Found = Totals.insert(Totals.end(), Total {Name});
+			}
+
+			Found->Bytes += Record.Bytes;
+			++Found->Num;
+		}
+
+		std::sort(Totals.begin(), Totals.end(), [](const Total& InLeft, const Total& InRight)
+		{
+			return InLeft.Bytes > InRight.Bytes;
+		});
+
+		return Totals;
+	};
+
+	const auto ShowTotals = [](const char* InId, const char* InNameHeader, const std::vector<Total>& InTotals)
+	{
+		constexpr auto TableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+
+		if (!ImGui::BeginTable(InId, 3, TableFlags, {0.0f, 200.0f}))
+		{
+			return;
+		}
+
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn(InNameHeader, ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Bindables");
+		ImGui::TableSetupColumn("KB");
+		ImGui::TableHeadersRow();
+
+		for (const auto& [Name, Bytes, Num] : InTotals)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(Name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", Num);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", static_cast<double>(Bytes) / 1024.0);
+		}
+
+		ImGui::EndTable();
+	};
+
+	size_t ByteSum = 0u;
+	for (const auto& Record : Records)
+	{
+		ByteSum += Record.Bytes;
+	}
+
+	ImGui::Text("%zu bindables, %.2f MB", Records.size(), static_cast<double>(ByteSum) / (1024.0 * 1024.0));
+
+	if (ImGui::Button("Write CSV"))
+	{
+		WriteMemoryReport(MemoryReportFileName);
+	}
+
+	ImGui::SameLine();
+	ImGui::TextUnformatted(MemoryReportFileName);
+
+	ShowTotals("ByType", "Type", Summarize([](const MemoryRecord& InRecord) -> const std::string&
+	{
+		return InRecord.Type;
+	}));
+
+	// A mesh shares its tag between the vertex and the index buffer, so a tag's total covers the whole mesh.
+	ShowTotals("ByTag", "Tag", Summarize([](const MemoryRecord& InRecord) -> const std::string&
+	{
+		return InRecord.Tag;
+	}));
+
+	ImGui::End();
+}
@@ -1,38 +1,203 @@
 ﻿#pragma once
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
 #include <unordered_map>
+#include <vector>
+#include "AllocationTracker.h"
+#include "BindKey.h"
 #include "Bindable.h"
+#include "ResourcePool.h"
 
+/**
+ * Process-wide cache of shared bindables, split into independently locked shards so loader threads rarely contend.
+ * Each shard keeps its bindables in a ResourcePool, the keys only map to handles, so the per-frame Trim sweeps one dense array.
+ * The cache holds a reference itself, a bindable nobody else uses any more is only destroyed once it stayed unused
+ * for the grace period, so a resource released and requested again shortly after is not created twice. It then goes through
+ * ReleaseQueue, the frames still in flight may be drawing with it.
+ */
 class BindManager
 {
 public:
+	using Clock = std::chrono::steady_clock;
+
 	template<typename T, typename... Params>
 	[[nodiscard]] static std::shared_ptr<T> Resolve(const Graphics& InGraphics, Params&&... InParams)
 	{
 		static_assert(std::is_base_of_v<Bindable, T>, "T is not derived from Bindable");
+		ALLOCATION_SCOPE(Bindables);
 		return Get().ResolveImpl<T>(InGraphics, std::forward<Params>(InParams)...);
 	}
 
+	// Every cached bindable of exactly type T, for passes over live resources such as shader reloading.
+	template<typename T>
+	[[nodiscard]] static std::vector<std::shared_ptr<T>> GetAll()
+	{
+		std::vector<std::shared_ptr<T>> Found;
+
+		for (auto& TargetShard : Get().Shards)
+		{
+			std::lock_guard Lock(TargetShard.Mutex);
+
+			TargetShard.SharedBindables.ForEach([&Found](auto, const CachedBindable& InCached)
+			{
+				if (typeid(*InCached.Target) == typeid(T))
+				{
+					Found.push_back(std::static_pointer_cast<T>(InCached.Target));
+				}
+			});
+		}
+
+		return Found;
+	}
+
+	struct MemoryRecord
+	{
+		std::string Type;
+		// The unique ID without the type, a file name or a mesh tag that starts with the model path.
+		std::string Tag;
+		size_t Bytes;
+		// Holders besides the cache, zero for a bindable waiting out its grace period.
+		long ReferenceNum;
+	};
+
+	// Every cached bindable that owns GPU memory, largest first.
+	[[nodiscard]] static std::vector<MemoryRecord> GetMemoryRecords();
+	// One row per record, for sorting and summing in a spreadsheet.
+	static bool WriteMemoryReport(const std::string& InFileName);
+	// Totals per type and per tag over the records, each sorted by size.
+	static void ShowMemoryWindow();
+
+	static constexpr const char* MemoryReportFileName = "GpuMemory.csv";
+
+	// Destroys bindables unused for longer than the grace period, call once per frame.
+	static void Trim();
+	// Drops every cached reference, before the device and the subsystems bindables refer to go away.
+	static void Clear();
+
+	static void SetGracePeriod(const Clock::duration InGracePeriod) noexcept
+	{
+		Get().GracePeriod = InGracePeriod;
+	}
+
+	[[nodiscard]] static Clock::duration GetGracePeriod() noexcept
+	{
+		return Get().GracePeriod;
+	}
+
 private:
+	static constexpr size_t ShardNum {16u};
+
+	struct CachedBindable
+	{
+		std::shared_ptr<Bindable> Target;
+		// To find the handle again when Trim drops it.
+		BindKey Key;
+		// Set by the first Trim that finds the cache holding the only reference.
+		Clock::time_point IdleSince {};
+		bool bIsIdle {false};
+	};
+
+	struct Shard
+	{
+		std::mutex Mutex;
+		ResourcePool<CachedBindable> SharedBindables;
+		std::unordered_map<BindKey, ResourcePool<CachedBindable>::Handle> Handles;
+		// Bindables being created right now.
+		std::unordered_map<BindKey, std::shared_future<std::shared_ptr<Bindable>>> InFlight;
+#ifndef NDEBUG
+		// The readable IDs behind each key, kept for diagnostics and to catch hash collisions.
+		std::unordered_map<BindKey, std::string> DebugNames;
+#endif
+	};
+
 	template<typename T, typename... Params>
 	[[nodiscard]] std::shared_ptr<T> ResolveImpl(const Graphics& InGraphics, Params&&... InParams)
 	{
-		const auto Key = T::GenerateUniqueID(std::forward<Params>(InParams)...);
+		const auto Key = T::GenerateKey(InParams...);
+#ifndef NDEBUG
+		auto DebugName = T::GenerateUniqueID(InParams...);
+#endif
+		auto& TargetShard = GetShard(Key);
+
+		std::promise<std::shared_ptr<Bindable>> Creation;
+		std::shared_future<std::shared_ptr<Bindable>> PendingCreation;
+
+		{
+			std::lock_guard Lock(TargetShard.Mutex);
+
+			if (const auto TargetIterator = TargetShard.Handles.find(Key); TargetIterator != TargetShard.Handles.end())
+			{
+				assert(TargetShard.DebugNames[Key] == DebugName && "BindKey collision");
+
+				auto* const Cached = TargetShard.SharedBindables.Find(TargetIterator->second);
+				Cached->bIsIdle = false;
+				return std::static_pointer_cast<T>(Cached->Target);
+			}
+
+			// Whoever asks first creates it, everyone else asking meanwhile waits for that one instead of decoding it again.
+			if (const auto PendingIterator = TargetShard.InFlight.find(Key); PendingIterator != TargetShard.InFlight.end())
+			{
+				PendingCreation = PendingIterator->second;
+			}
+			else
+			{
+				TargetShard.InFlight.emplace(Key, Creation.get_future().share());
+			}
+		}
+
+		// Blocking is fine, creating a bindable never waits on jobs, so the creator can't be stuck behind this thread.
+		if (PendingCreation.valid())
+		{
+			return std::static_pointer_cast<T>(PendingCreation.get());
+		}
+
+		// Created outside the lock so loader threads don't serialize on slow resources such as texture decoding.
+		std::shared_ptr<T> SharedBindable;
 
-		if (const auto TargetIterator = SharedBindables.find(Key); TargetIterator == SharedBindables.end() || TargetIterator->second.expired())
+		try
 		{
-			auto SharedBindable = std::make_shared<T>(InGraphics, std::forward<Params>(InParams)...);
-			SharedBindables[Key] = SharedBindable;
-			return SharedBindable;
+			SharedBindable = std::make_shared<T>(InGraphics, std::forward<Params>(InParams)...);
 		}
-		else
+		catch (...)
 		{
-			return std::static_pointer_cast<T>(TargetIterator->second.lock());
+			// The waiters get the same exception, the next Resolve tries again.
+			{
+				std::lock_guard Lock(TargetShard.Mutex);
+				TargetShard.InFlight.erase(Key);
+			}
+
+			Creation.set_exception(std::current_exception());
+			throw;
 		}
+
+		{
+			std::lock_guard Lock(TargetShard.Mutex);
+#ifndef NDEBUG
+			TargetShard.DebugNames[Key] = std::move(DebugName);
+#endif
+			TargetShard.Handles.emplace(Key, TargetShard.SharedBindables.Add({SharedBindable, Key}));
+			TargetShard.InFlight.erase(Key);
+		}
+
+		Creation.set_value(SharedBindable);
+		return SharedBindable;
 	}
 
 	static BindManager& Get();
 
+	[[nodiscard]] Shard& GetShard(const BindKey& InKey) noexcept
+	{
+		// The high bits, the low ones already pick the bucket inside the shard.
+		return Shards[static_cast<size_t>(InKey.GetValue() >> 32u) % ShardNum];
+	}
+
 private:
-	std::unordered_map<std::string, std::weak_ptr<Bindable>> SharedBindables;
+	std::array<Shard, ShardNum> Shards;
+	Clock::duration GracePeriod {std::chrono::seconds(5)};
 };
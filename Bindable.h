@@ -1,31 +1,93 @@
 ﻿#pragma once
+#include <atomic>
 #include "Graphics.h"
 
+struct DrawPacket;
+
 class Bindable
 {
 public:
-	Bindable() = default;
+	// Totals since startup, the stats overlay turns them into rates.
+	struct Lifetimes
+	{
+		unsigned long long CreatedNum {0u};
+		unsigned long long DestroyedNum {0u};
+	};
+
+	Bindable() noexcept
+	{
+		CreatedNum.fetch_add(1u, std::memory_order_relaxed);
+	}
+
 	Bindable(const Bindable&) = delete;
     Bindable(const Bindable&&) = delete;
     Bindable& operator=(const Bindable&) = delete;
     Bindable& operator=(const Bindable&&) = delete;
-	virtual ~Bindable() = default;
+	virtual ~Bindable()
+	{
+		DestroyedNum.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	// Binds through the given context, which may be a deferred context recording on a worker thread.
+	virtual void Bind(RenderContext& InContext) noexcept = 0;
+	// Writes what Bind would set into the packet, false for bindables that have to bind themselves on every draw.
+	virtual bool Bake(DrawPacket& InOutPacket) const noexcept
+	{
+		return false;
+	}
 
-	virtual void Bind(const Graphics& InGraphics) noexcept = 0;
 	virtual std::string GetUniqueID() const noexcept
 	{
 		assert(false);
 		return {};
 	}
 
+	// GPU memory the bindable allocated, from the descs it created its resources with, zero for pure state objects.
+	[[nodiscard]] virtual size_t GetGpuByteSize() const noexcept
+	{
+		return 0u;
+	}
+
+	// Called on the main thread by whatever replaces a view or shader a baked packet may hold, packets bake again on their next submit.
+	static void InvalidateBaked() noexcept
+	{
+		BakedRevision.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] static unsigned long long GetBakedRevision() noexcept
+	{
+		return BakedRevision.load(std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] static Lifetimes GetLifetimes() noexcept
+	{
+		return {CreatedNum.load(std::memory_order_relaxed), DestroyedNum.load(std::memory_order_relaxed)};
+	}
+
 protected:
-	static ID3D11DeviceContext* GetContext(const Graphics& InGraphics) noexcept
+	static ID3D11DeviceContext* GetContext(const RenderContext& InContext) noexcept
 	{
-		return InGraphics.DeviceContext.Get();
+		return InContext.GetDeviceContext();
 	}
 
 	static ID3D11Device* GetDevice(const Graphics& InGraphics) noexcept
 	{
 		return InGraphics.Device.Get();
 	}
+
+	static StateCache& GetStateCache(RenderContext& InContext) noexcept
+	{
+		return InContext.GetStateCache();
+	}
+
+	static ConstantBufferRing* GetConstantBufferRing(const RenderContext& InContext) noexcept
+	{
+		return InContext.GetConstantBufferRing();
+	}
+
+private:
+	// Bindables are created on loader threads too.
+	static inline std::atomic<unsigned long long> CreatedNum {0u};
+	static inline std::atomic<unsigned long long> DestroyedNum {0u};
+	static inline std::atomic<unsigned long long> BakedRevision {0u};
 };
@@ -1,11 +1,24 @@
 ﻿#pragma once
+#include "BonePalette.h"
+#include "ComputeShader.h"
 #include "ConstantBuffers.h"
+#include "DomainShader.h"
+#include "DynamicIndexBuffer.h"
+#include "DynamicVertexBuffer.h"
+#include "HullShader.h"
 #include "IndexBuffer.h"
 #include "InputLayout.h"
+#include "InstanceBuffer.h"
+#include "Material.h"
+#include "MorphTargets.h"
+#include "PipelineState.h"
 #include "PixelShader.h"
+#include "RWTexture.h"
+#include "StructuredBuffer.h"
 #include "Texture.h"
 #include "Topology.h"
 #include "TransformConstantBuffer.h"
+#include "VertexAnimation.h"
 #include "VertexBuffer.h"
 #include "VertexShader.h"
 #include "Sampler.h"
\ No newline at end of file
@@ -0,0 +1,93 @@
+// Every bloom mip from the scene in one dispatch. Each group filters a 32x32 block of the scene into its 16x16 texels of
+// mip 0, then halves them in shared memory down to the single texel of mip 4 the block ends in, so no level waits on
+// another dispatch or goes back through memory to be read.
+Texture2D<float3> Scene : register(t0);
+SamplerState LinearSampler : register(s0);
+RWTexture2D<float3> BloomMip0 : register(u0);
+RWTexture2D<float3> BloomMip1 : register(u1);
+RWTexture2D<float3> BloomMip2 : register(u2);
+RWTexture2D<float3> BloomMip3 : register(u3);
+RWTexture2D<float3> BloomMip4 : register(u4);
+
+cbuffer Bloom : register(b0)
+{
+    float2 SceneTexelSize;
+    // Half a texel inside the part of the scene rendered this frame.
+    float2 MaxSceneCoordinate;
+    // Texels of mip 0 covering that part, those past it are written black.
+    uint2 Mip0Size;
+    // Luminance below which nothing glows, and how softly the glow starts above it.
+    float Threshold;
+    float Knee;
+}
+
+#define GROUP_SIZE 16
+#define MIP_NUM 5
+
+groupshared float3 SharedTexels[GROUP_SIZE * GROUP_SIZE];
+
+void WriteMip(const uint InMip, const uint2 InTexel, const float3 InColor)
+{
+    // Unrolled by the caller, so every write names its view statically.
+    if (InMip == 1u)
+    {
+        BloomMip1[InTexel] = InColor;
+    }
+    else if (InMip == 2u)
+    {
+        BloomMip2[InTexel] = InColor;
+    }
+    else if (InMip == 3u)
+    {
+        BloomMip3[InTexel] = InColor;
+    }
+    else
+    {
+        BloomMip4[InTexel] = InColor;
+    }
+}
+
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main(const uint3 InGroupID : SV_GroupID, const uint3 InGroupThreadID : SV_GroupThreadID, const uint InGroupIndex : SV_GroupIndex)
+{
+    const uint2 Texel = InGroupID.xy * GROUP_SIZE + InGroupThreadID.xy;
+
+    // One bilinear tap on the shared corner of the 2x2 scene pixels below the texel averages all four.
+    const float2 Coordinate = min((Texel * 2u + 1u) * SceneTexelSize, MaxSceneCoordinate);
+    float3 Color = Scene.SampleLevel(LinearSampler, Coordinate, 0.0f);
+
+    // Soft threshold, a quadratic ramp over the knee below it keeps the glow from popping in.
+    const float Brightness = max(max(Color.r, Color.g), Color.b);
+    const float Ramp = clamp(Brightness - Threshold + Knee, 0.0f, 2.0f * Knee);
+    const float Contribution = max(Ramp * Ramp / (4.0f * Knee + 1e-4f), Brightness - Threshold) / max(Brightness, 1e-4f);
+    Color = any(Texel >= Mip0Size) ? float3(0.0f, 0.0f, 0.0f) : Color * Contribution;
+
+    BloomMip0[Texel] = Color;
+    SharedTexels[InGroupIndex] = Color;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint Mip = 1u; Mip < MIP_NUM; ++Mip)
+    {
+        // A quarter of the threads active in the last level average its 2x2 texels, read before any is overwritten.
+        const uint Size = GROUP_SIZE >> Mip;
+        const bool bIsActive = all(InGroupThreadID.xy < Size);
+        float3 Average = float3(0.0f, 0.0f, 0.0f);
+
+        if (bIsActive)
+        {
+            const uint Source = InGroupThreadID.y * 2u * GROUP_SIZE + InGroupThreadID.x * 2u;
+            Average = (SharedTexels[Source] + SharedTexels[Source + 1u] + SharedTexels[Source + GROUP_SIZE] + SharedTexels[Source + GROUP_SIZE + 1u]) * 0.25f;
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        if (bIsActive)
+        {
+            SharedTexels[InGroupThreadID.y * GROUP_SIZE + InGroupThreadID.x] = Average;
+            WriteMip(Mip, InGroupID.xy * Size + InGroupThreadID.xy, Average);
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
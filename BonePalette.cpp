@@ -0,0 +1,99 @@
+﻿#include "BonePalette.h"
+#include <cstring>
+#include <vector>
+#include "DrawPacket.h"
+#include "ExceptionMacros.h"
+
+BonePalette::BonePalette(const Graphics& InGraphics, const UINT InBoneNum, const UINT InSlot)
+	: BoneNum(InBoneNum), Slot(InSlot)
+{
+	assert(BoneNum > 0u && BoneNum <= MaxBoneNum && "Bone palette size out of range");
+
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC BoneBufferDesc {};
+	BoneBufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	BoneBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	BoneBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	BoneBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	BoneBufferDesc.ByteWidth = static_cast<UINT>(sizeof(DirectX::XMFLOAT4X4)) * BoneNum;
+	BoneBufferDesc.StructureByteStride = sizeof(DirectX::XMFLOAT4X4);
+
+	// Identity until the first update, the bind pose.
+	std::vector<DirectX::XMFLOAT4X4> Initial(BoneNum);
+	for (auto& Bone : Initial)
+	{
+		DirectX::XMStoreFloat4x4(&Bone, DirectX::XMMatrixIdentity());
+	}
+
+	D3D11_SUBRESOURCE_DATA SubresourceData {};
+	SubresourceData.pSysMem = Initial.data();
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer
+	(
+		&BoneBufferDesc,
+		&SubresourceData,
+		&MyBoneBuffer
+	))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC ResourceViewDesc {};
+	ResourceViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	ResourceViewDesc.Buffer.FirstElement = 0u;
+	ResourceViewDesc.Buffer.NumElements = BoneNum;
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateShaderResourceView
+	(
+		MyBoneBuffer.Get(),
+		&ResourceViewDesc,
+		&MyBoneView
+	))
+}
+
+void BonePalette::Update(RenderContext& InContext, const std::span<const DirectX::XMFLOAT4X4> InBones)
+{
+	assert(InBones.size() == BoneNum && "Palette updated with another skeleton");
+
+	auto& Cache = GetStateCache(InContext);
+	if (UploadedCache == &Cache && UploadedResetNum == Cache.GetResetNum() && std::memcmp(Uploaded.data(), InBones.data(), InBones.size_bytes()) == 0)
+	{
+		Cache.CountSkippedUpload();
+		return;
+	}
+
+	HRESULT ResultHandle;
+
+	D3D11_MAPPED_SUBRESOURCE MappedSubresource;
+	CHECK_HRESULT_EXCEPTION(GetContext(InContext)->Map
+	(
+		MyBoneBuffer.Get(),
+		0u,
+		D3D11_MAP_WRITE_DISCARD,
+		0u,
+		&MappedSubresource
+	))
+
+	memcpy(MappedSubresource.pData, InBones.data(), InBones.size_bytes());
+	GetContext(InContext)->Unmap(MyBoneBuffer.Get(), 0u);
+	Cache.CountUpload(InBones.size_bytes());
+
+	Uploaded.assign(InBones.begin(), InBones.end());
+	UploadedCache = &Cache;
+	UploadedResetNum = Cache.GetResetNum();
+}
+
+void BonePalette::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetVertexShaderResource(Slot, MyBoneView.Get());
+}
+
+bool BonePalette::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.AddVertexShaderResource(Slot, MyBoneView.Get());
+	return true;
+}
+
+size_t BonePalette::GetGpuByteSize() const noexcept
+{
+	return sizeof(DirectX::XMFLOAT4X4) * BoneNum;
+}
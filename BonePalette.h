@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <span>
+#include <vector>
+#include "Bindable.h"
+
+/**
+ * The bone matrices one skinned mesh is drawn with, a StructuredBuffer<matrix> the skinning vertex shaders read
+ * through the bone indices of each vertex. Every mesh has its own, it changes with the pose of its hierarchy.
+ * Baked into the draw packets like any other view, only its contents change from frame to frame.
+ */
+class BonePalette : public Bindable
+{
+public:
+	// Bone indices are a byte per influence.
+	static constexpr UINT MaxBoneNum {256u};
+	static constexpr UINT DefaultSlot {1u};
+
+	BonePalette(const Graphics& InGraphics, UINT InBoneNum, UINT InSlot = DefaultSlot);
+
+	// Transposed like every other matrix handed to the shaders, one per bone of the mesh.
+	// A pose equal to the last one written through the same context isn't uploaded again, such as a paused animation.
+	void Update(RenderContext& InContext, std::span<const DirectX::XMFLOAT4X4> InBones);
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] UINT GetBoneNum() const noexcept
+	{
+		return BoneNum;
+	}
+
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	UINT BoneNum;
+	UINT Slot;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> MyBoneBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyBoneView;
+	std::vector<DirectX::XMFLOAT4X4> Uploaded;
+	const StateCache* UploadedCache {nullptr};
+	unsigned int UploadedResetNum {0u};
+};
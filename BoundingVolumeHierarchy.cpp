@@ -0,0 +1,251 @@
+﻿#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+	float GetSurfaceArea(const DirectX::BoundingBox& InBounds) noexcept
+	{
+		const auto& [X, Y, Z] = InBounds.Extents;
+		return 8.0f * (X * Y + Y * Z + Z * X);
+	}
+
+	float GetAxis(const DirectX::XMFLOAT3& InVector, const unsigned int InAxis) noexcept
+	{
+		return InAxis == 0u ? InVector.x : InAxis == 1u ? InVector.y : InVector.z;
+	}
+
+	DirectX::BoundingBox Merge(const DirectX::BoundingBox& InLeft, const DirectX::BoundingBox& InRight) noexcept
+	{
+		DirectX::BoundingBox Merged;
+		DirectX::BoundingBox::CreateMerged(Merged, InLeft, InRight);
+		return Merged;
+	}
+}
+
+void BoundingVolumeHierarchy::Build(const std::span<const DirectX::BoundingBox> InItemBounds)
+{
+	const auto ItemNum = static_cast<unsigned int>(InItemBounds.size());
+
+	ItemBounds.assign(InItemBounds.begin(), InItemBounds.end());
+	ItemLeaves.assign(ItemNum, 0u);
+	Order.resize(ItemNum);
+	DirtyLeaves.clear();
+	Nodes.clear();
+
+	for (unsigned int Item = 0u; Item < ItemNum; ++Item)
+	{
+		Order[Item] = Item;
+	}
+
+	if (ItemNum == 0u)
+	{
+		return;
+	}
+
+	Nodes.reserve(2u * ItemNum);
+	BuildRange(NoItem, 0u, ItemNum, 0u);
+}
+
+unsigned int BoundingVolumeHierarchy::BuildRange(const unsigned int InParent, const unsigned int InFirst, const unsigned int InLast, const unsigned int InDepth)
+{
+	const auto NodeIndex = static_cast<unsigned int>(Nodes.size());
+	auto& NewNode = Nodes.emplace_back();
+	NewNode.Parent = InParent;
+
+	auto Bounds = ItemBounds[Order[InFirst]];
+	auto CentroidMin = Bounds.Center;
+	auto CentroidMax = Bounds.Center;
+
+	for (auto Index = InFirst + 1u; Index < InLast; ++Index)
+	{
+		const auto& ItemBox = ItemBounds[Order[Index]];
+		Bounds = Merge(Bounds, ItemBox);
+		DirectX::XMStoreFloat3(&CentroidMin, DirectX::XMVectorMin(DirectX::XMLoadFloat3(&CentroidMin), DirectX::XMLoadFloat3(&ItemBox.Center)));
+		DirectX::XMStoreFloat3(&CentroidMax, DirectX::XMVectorMax(DirectX::XMLoadFloat3(&CentroidMax), DirectX::XMLoadFloat3(&ItemBox.Center)));
+	}
+
+	NewNode.Bounds = Bounds;
+
+	const auto ItemNum = InLast - InFirst;
+
+	const auto MakeLeaf = [&]
+	{
+		auto& Leaf = Nodes[NodeIndex];
+		Leaf.RightChild = NoItem;
+		Leaf.FirstItem = InFirst;
+		Leaf.ItemNum = ItemNum;
+
+		for (auto Index = InFirst; Index < InLast; ++Index)
+		{
+			ItemLeaves[Order[Index]] = NodeIndex;
+		}
+
+		return NodeIndex;
+	};
+
+	if (ItemNum <= 1u || InDepth + 4u >= MaxDepth)
+	{
+		return MakeLeaf();
+	}
+
+	// Split along the widest axis of the centroids.
+	const DirectX::XMFLOAT3 CentroidExtent {CentroidMax.x - CentroidMin.x, CentroidMax.y - CentroidMin.y, CentroidMax.z - CentroidMin.z};
+	const auto Axis = CentroidExtent.x >= CentroidExtent.y && CentroidExtent.x >= CentroidExtent.z ? 0u : CentroidExtent.y >= CentroidExtent.z ? 1u : 2u;
+	const auto AxisMin = GetAxis(CentroidMin, Axis);
+	const auto AxisExtent = GetAxis(CentroidExtent, Axis);
+
+	auto Middle = InFirst + ItemNum / 2u;
+
+	if (AxisExtent <= 0.0f)
+	{
+		if (ItemNum <= MaxLeafItemNum)
+		{
+			return MakeLeaf();
+		}
+	}
+	else
+	{
+		const auto GetBin = [&](const unsigned int InItem)
+		{
+			const auto Offset = (GetAxis(ItemBounds[InItem].Center, Axis) - AxisMin) / AxisExtent;
+			return std::min(static_cast<unsigned int>(Offset * BinNum), BinNum - 1u);
+		};
+
+		struct Bin
+		{
+			DirectX::BoundingBox Bounds;
+			unsigned int ItemNum {0u};
+		};
+
+		std::array<Bin, BinNum> Bins;
+
+		for (auto Index = InFirst; Index < InLast; ++Index)
+		{
+			auto& Target = Bins[GetBin(Order[Index])];
+			Target.Bounds = Target.ItemNum ? Merge(Target.Bounds, ItemBounds[Order[Index]]) : ItemBounds[Order[Index]];
+			++Target.ItemNum;
+		}
+
+		// Sweep from the right once to get every right-hand side cost, then from the left to pick the split.
+		std::array<float, BinNum> RightCosts {};
+		DirectX::BoundingBox RightBounds;
+		unsigned int RightNum = 0u;
+
+		for (auto BinIndex = BinNum - 1u; BinIndex > 0u; --BinIndex)
+		{
+			if (Bins[BinIndex].ItemNum)
+			{
+				RightBounds = RightNum ? Merge(RightBounds, Bins[BinIndex].Bounds) : Bins[BinIndex].Bounds;
+				RightNum += Bins[BinIndex].ItemNum;
+			}
+
+			RightCosts[BinIndex] = RightNum ? GetSurfaceArea(RightBounds) * static_cast<float>(RightNum) : 0.0f;
+		}
+
+		auto BestCost = std::numeric_limits<float>::max();
+		unsigned int BestSplit = 0u;
+		DirectX::BoundingBox LeftBounds;
+		unsigned int LeftNum = 0u;
+
+		for (unsigned int Split = 1u; Split < BinNum; ++Split)
+		{
+			if (Bins[Split - 1u].ItemNum)
+			{
+				LeftBounds = LeftNum ? Merge(LeftBounds, Bins[Split - 1u].Bounds) : Bins[Split - 1u].Bounds;
+				LeftNum += Bins[Split - 1u].ItemNum;
+			}
+
+			if (LeftNum == 0u || LeftNum == ItemNum)
+			{
+				continue;
+			}
+
+			if (const auto Cost = GetSurfaceArea(LeftBounds) * static_cast<float>(LeftNum) + RightCosts[Split]; Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestSplit = Split;
+			}
+		}
+
+		// Traversing one leaf costs roughly testing all of its items against the parent box.
+		const auto LeafCost = GetSurfaceArea(Bounds) * static_cast<float>(ItemNum);
+
+		if (ItemNum <= MaxLeafItemNum && LeafCost <= BestCost)
+		{
+			return MakeLeaf();
+		}
+
+		if (BestSplit)
+		{
+			Middle = static_cast<unsigned int>(std::partition(Order.begin() + InFirst, Order.begin() + InLast, [&](const unsigned int InItem)
+			{
+				return GetBin(InItem) < BestSplit;
+			}) - Order.begin());
+		}
+	}
+
+	if (Middle == InFirst || Middle == InLast)
+	{
+		Middle = InFirst + ItemNum / 2u;
+	}
+
+	Nodes[NodeIndex].FirstItem = 0u;
+	Nodes[NodeIndex].ItemNum = 0u;
+	BuildRange(NodeIndex, InFirst, Middle, InDepth + 1u);
+	const auto RightChild = BuildRange(NodeIndex, Middle, InLast, InDepth + 1u);
+	Nodes[NodeIndex].RightChild = RightChild;
+
+	return NodeIndex;
+}
+
+void BoundingVolumeHierarchy::UpdateItem(const unsigned int InItem, const DirectX::BoundingBox& InBounds) noexcept
+{
+	assert(InItem < ItemBounds.size());
+
+	ItemBounds[InItem] = InBounds;
+	DirtyLeaves.push_back(ItemLeaves[InItem]);
+}
+
+void BoundingVolumeHierarchy::Refit() noexcept
+{
+	for (const auto Leaf : DirtyLeaves)
+	{
+		for (auto NodeIndex = Leaf; NodeIndex != NoItem; NodeIndex = Nodes[NodeIndex].Parent)
+		{
+			RefitNode(NodeIndex);
+		}
+	}
+
+	DirtyLeaves.clear();
+}
+
+void BoundingVolumeHierarchy::RefitNode(const unsigned int InNode) noexcept
+{
+	auto& Node = Nodes[InNode];
+
+	if (Node.ItemNum == 0u)
+	{
+		Node.Bounds = Merge(Nodes[InNode + 1u].Bounds, Nodes[Node.RightChild].Bounds);
+		return;
+	}
+
+	Node.Bounds = ItemBounds[Order[Node.FirstItem]];
+
+	for (auto Item = Node.FirstItem + 1u; Item < Node.FirstItem + Node.ItemNum; ++Item)
+	{
+		Node.Bounds = Merge(Node.Bounds, ItemBounds[Order[Item]]);
+	}
+}
+
+unsigned int BoundingVolumeHierarchy::QueryRay(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, float& OutDistance) const noexcept
+{
+	OutDistance = std::numeric_limits<float>::max();
+
+	// The distance to the box is the item's own.
+	return QueryRay(InOrigin, InDirection, OutDistance, [](unsigned int, float&) noexcept
+	{
+		return true;
+	});
+}
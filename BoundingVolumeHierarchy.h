@@ -0,0 +1,226 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+#include <DirectXCollision.h>
+#include <span>
+#include <vector>
+
+/**
+ * Binary tree of axis aligned boxes over a set of items, built with a binned surface area heuristic.
+ * Moving items are refit in place rather than rebuilt, so the tree stays valid but slowly loses quality.
+ * Items are identified by their index into the bounds passed to Build.
+ */
+class BoundingVolumeHierarchy
+{
+public:
+	static constexpr unsigned int NoItem {~0u};
+
+	void Build(std::span<const DirectX::BoundingBox> InItemBounds);
+	// Takes effect on the next Refit.
+	void UpdateItem(unsigned int InItem, const DirectX::BoundingBox& InBounds) noexcept;
+	void Refit() noexcept;
+
+	// Calls InVisit with every item whose box is not outside the frustum.
+	template<typename Function>
+	void QueryFrustum(const DirectX::BoundingFrustum& InFrustum, Function&& InVisit) const
+	{
+		Traverse
+		(
+			[&InFrustum](const DirectX::BoundingBox& InBounds)
+			{
+				return InFrustum.Contains(InBounds);
+			},
+			InVisit
+		);
+	}
+
+	// Calls InVisit once with every item whose box is not outside all of the frustums, the union of several views.
+	template<typename Function>
+	void QueryFrustums(std::span<const DirectX::BoundingFrustum> InFrustums, Function&& InVisit) const
+	{
+		Traverse
+		(
+			[InFrustums](const DirectX::BoundingBox& InBounds)
+			{
+				auto Containment = DirectX::DISJOINT;
+
+				// A box inside any one frustum is inside the union, whatever the others say.
+				for (const auto& Frustum : InFrustums)
+				{
+					if ((Containment = std::max(Containment, Frustum.Contains(InBounds))) == DirectX::CONTAINS)
+					{
+						break;
+					}
+				}
+
+				return Containment;
+			},
+			InVisit
+		);
+	}
+
+	// Calls InVisit with every item whose box touches the sphere, e.g. everything a point light reaches.
+	template<typename Function>
+	void QuerySphere(const DirectX::BoundingSphere& InSphere, Function&& InVisit) const
+	{
+		Traverse
+		(
+			[&InSphere](const DirectX::BoundingBox& InBounds)
+			{
+				return InSphere.Contains(InBounds);
+			},
+			InVisit
+		);
+	}
+
+	// Closest item whose box the ray hits, or NoItem. The direction must be normalized.
+	[[nodiscard]] unsigned int QueryRay(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, float& OutDistance) const noexcept;
+
+	// The same for items that are not their boxes, such as triangles, and only up to InOutDistance, which ends up at the hit.
+	// InIntersect(Item, Distance) is called for items whose box the ray hits in time, given the distance to the box, and narrows it
+	// to the item's own or returns false for a miss.
+	template<typename Function>
+	[[nodiscard]] unsigned int QueryRay(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, float& InOutDistance, Function&& InIntersect) const
+	{
+		auto ClosestItem = NoItem;
+
+		if (Nodes.empty())
+		{
+			return ClosestItem;
+		}
+
+		std::array<unsigned int, MaxDepth> Stack;
+		unsigned int StackSize = 0u;
+		Stack[StackSize++] = 0u;
+
+		while (StackSize)
+		{
+			const auto NodeIndex = Stack[--StackSize];
+			const auto& Node = Nodes[NodeIndex];
+
+			// Nothing behind the closest hit so far can win.
+			if (float Distance; !Node.Bounds.Intersects(InOrigin, InDirection, Distance) || Distance >= InOutDistance)
+			{
+				continue;
+			}
+
+			if (Node.ItemNum == 0u)
+			{
+				Stack[StackSize++] = Node.RightChild;
+				Stack[StackSize++] = NodeIndex + 1u;
+				continue;
+			}
+
+			for (auto Item = Node.FirstItem; Item < Node.FirstItem + Node.ItemNum; ++Item)
+			{
+				if (float Distance; ItemBounds[Order[Item]].Intersects(InOrigin, InDirection, Distance) && Distance < InOutDistance &&
+				    InIntersect(Order[Item], Distance) && Distance < InOutDistance)
+				{
+					InOutDistance = Distance;
+					ClosestItem = Order[Item];
+				}
+			}
+		}
+
+		return ClosestItem;
+	}
+
+	// Calls InVisit with every tree node's box as of the last Refit and whether it is a leaf, parents before their children.
+	template<typename Function>
+	void VisitNodes(Function&& InVisit) const
+	{
+		for (const auto& Node : Nodes)
+		{
+			InVisit(Node.Bounds, Node.ItemNum != 0u);
+		}
+	}
+
+	[[nodiscard]] bool IsEmpty() const noexcept
+	{
+		return Nodes.empty();
+	}
+
+	// Box around every item as of the last Refit, the tree must not be empty.
+	[[nodiscard]] const DirectX::BoundingBox& GetBounds() const noexcept
+	{
+		return Nodes.front().Bounds;
+	}
+
+	// The item's latest box, including updates the tree has not been refit to yet.
+	[[nodiscard]] const DirectX::BoundingBox& GetItemBounds(const unsigned int InItem) const noexcept
+	{
+		return ItemBounds[InItem];
+	}
+
+private:
+	struct TreeNode
+	{
+		DirectX::BoundingBox Bounds;
+		unsigned int Parent;
+		// The left child always follows its parent, so internal nodes only store the right one.
+		unsigned int RightChild;
+		// Leaves reference Order[FirstItem, FirstItem + ItemNum), internal nodes have no items.
+		unsigned int FirstItem;
+		unsigned int ItemNum;
+	};
+
+	unsigned int BuildRange(unsigned int InParent, unsigned int InFirst, unsigned int InLast, unsigned int InDepth);
+	void RefitNode(unsigned int InNode) noexcept;
+
+	// A subtree the test reports as fully contained is visited without testing it any further.
+	template<typename Test, typename Function>
+	void Traverse(Test&& InTest, Function&& InVisit) const
+	{
+		if (Nodes.empty())
+		{
+			return;
+		}
+
+		std::array<std::pair<unsigned int, bool>, MaxDepth> Stack;
+		unsigned int StackSize = 0u;
+		Stack[StackSize++] = {0u, false};
+
+		while (StackSize)
+		{
+			const auto [NodeIndex, bIsContained] = Stack[--StackSize];
+			const auto& Node = Nodes[NodeIndex];
+			auto Containment = DirectX::CONTAINS;
+
+			if (!bIsContained && (Containment = InTest(Node.Bounds)) == DirectX::DISJOINT)
+			{
+				continue;
+			}
+
+			const bool bIsChildContained = bIsContained || Containment == DirectX::CONTAINS;
+
+			if (Node.ItemNum)
+			{
+				for (auto Item = Node.FirstItem; Item < Node.FirstItem + Node.ItemNum; ++Item)
+				{
+					if (bIsChildContained || InTest(ItemBounds[Order[Item]]) != DirectX::DISJOINT)
+					{
+						InVisit(Order[Item]);
+					}
+				}
+
+				continue;
+			}
+
+			Stack[StackSize++] = {Node.RightChild, bIsChildContained};
+			Stack[StackSize++] = {NodeIndex + 1u, bIsChildContained};
+		}
+	}
+
+private:
+	static constexpr unsigned int MaxLeafItemNum {4u};
+	static constexpr unsigned int BinNum {12u};
+	// Traversal keeps at most one pending sibling per level, deeper ranges become a single large leaf instead.
+	static constexpr unsigned int MaxDepth {64u};
+
+	std::vector<TreeNode> Nodes;
+	std::vector<DirectX::BoundingBox> ItemBounds;
+	// Item indices grouped by leaf.
+	std::vector<unsigned int> Order;
+	std::vector<unsigned int> ItemLeaves;
+	std::vector<unsigned int> DirtyLeaves;
+};
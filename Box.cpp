@@ -1,76 +1,44 @@
 ﻿#include "Box.h"
 #include "Bindables.h"
-#include "Camera.h"
-#include "Cube.h"
+#include "GeometryCache.h"
 
-Box::Box(const Graphics& InGraphics, const DirectX::XMFLOAT3 InMaterialColor)
+Box::Box(const Graphics& InGraphics, const EntityStore& InStore, const EntityStore::Entity InEntity, const DirectX::XMFLOAT3 InMaterialColor)
+	: Store(InStore), MyEntity(InEntity)
 {
-	struct Vertex
-	{
-		DirectX::XMFLOAT3 Position;
-		DirectX::XMFLOAT3 Normal;
-	};
-
-	auto Model = Cube::MakeIndependent();
-	Model.SetNormalsIndependentFlat();
+	const auto& Geometry = GeometryCache::Get(GeometryCache::Shape::IndependentCube, {DV::VertexLayout::ElementType::Position3D, DV::VertexLayout::ElementType::Normal});
 
-	Bind(std::make_shared<VertexBuffer>(InGraphics, Model.Vertices));
+	Bind(VertexBuffer::Resolve(InGraphics, Geometry.Tag, Geometry.Model.Vertices));
 
-	Bind(std::make_shared<IndexBuffer>(InGraphics, Model.Indices));
+	Bind(IndexBuffer::Resolve(InGraphics, Geometry.Tag, Geometry.Model.Indices));
 
-	auto ModelVertexShader = std::make_shared<VertexShader>(InGraphics, "PhongVS.cso");
-	auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
+	auto ModelVertexShader = VertexShader::Resolve(InGraphics, "PhongVS.cso");
+	Bind(InputLayout::Resolve(InGraphics, Geometry.Model.Vertices.GetLayout(), ModelVertexShader->GetByteCode()));
 	Bind(std::move(ModelVertexShader));
 
-	Bind(std::make_shared<PixelShader>(InGraphics, "PhongPS.cso"));
+	Bind(PixelShader::Resolve(InGraphics, "PhongPS.cso"));
 
+	// Laid out like MaterialConstants.hlsli, PhongPS reads only the color and the specular terms.
 	struct PSMaterialConstants
 	{
-		alignas(16) DirectX::XMFLOAT3 Color;
+		DirectX::XMFLOAT4 Color;
 		float SpecularIntensity = 0.6f;
 		float SpecularPower = 10.0f;
-		float Padding[2];
+		float Opacity = 1.0f;
+		UINT Slices[3] {};
+		UINT PackedMaps = 0u;
+		float Padding[1] {};
 	} ModelMaterialConstants;
-	ModelMaterialConstants.Color = InMaterialColor;
-
-	struct PSCameraConstants
-	{
-		alignas(16) DirectX::XMFLOAT3 Position;
-	} ModelCameraConstants;
-
-	Bind(std::make_shared<PixelConstantBuffer<PSMaterialConstants>>(InGraphics, ModelMaterialConstants, 1u));
-	Bind(std::make_shared<PixelConstantBuffer<PSCameraConstants>>(InGraphics, ModelCameraConstants, 2u));
-
-	const std::vector<D3D11_INPUT_ELEMENT_DESC> ModelInputElementDescs =
-	{
-		{
-			"Position",
-			0,
-			DXGI_FORMAT_R32G32B32_FLOAT,
-			0,
-			0,
-			D3D11_INPUT_PER_VERTEX_DATA,
-			0
-		},
-		{
-			"Normal",
-			0,
-			DXGI_FORMAT_R32G32B32_FLOAT,
-			0,
-			12,
-			D3D11_INPUT_PER_VERTEX_DATA,
-			0
-		}
-	};
+	ModelMaterialConstants.Color = {InMaterialColor.x, InMaterialColor.y, InMaterialColor.z, 1.0f};
 
-	// Bind(std::make_shared<InputLayout>(InGraphics, ModelInputElementDescs, ModelVertexShaderBlob));
+	// Shared by boxes of the same color, the buffer is keyed by its contents.
+	Bind(PixelConstantBuffer<PSMaterialConstants>::Resolve(InGraphics, ModelMaterialConstants, 1u));
 
-	Bind(std::make_shared<Topology>(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
+	Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
 
 	Bind(std::make_shared<TransformConstantBuffer>(InGraphics, *this, TransformConstantBuffer::Target::Vertex));
 }
 
 DirectX::XMMATRIX Box::GetTransformMatrix() const noexcept
 {
-	return DirectX::XMMatrixTranslation(X, Y, Z);
+	return Store.GetTransform(MyEntity);
 }
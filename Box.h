@@ -1,14 +1,20 @@
 ﻿#pragma once
 #include "Drawable.h"
+#include "EntityStore.h"
 
 class Box : public Drawable
 {
 public:
-	Box(const Graphics& InGraphics, DirectX::XMFLOAT3 InMaterialColor);
+	// InEntity moves the box, the store outlives it.
+	Box(const Graphics& InGraphics, const EntityStore& InStore, EntityStore::Entity InEntity, DirectX::XMFLOAT3 InMaterialColor);
 	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept override;
 
+	[[nodiscard]] EntityStore::Entity GetEntity() const noexcept
+	{
+		return MyEntity;
+	}
+
 private:
-	float X {0.0f};
-	float Y {0.0f};
-	float Z {0.0f};
+	const EntityStore& Store;
+	EntityStore::Entity MyEntity;
 };
@@ -0,0 +1,21 @@
+// The quality calibration's ALU test, a loop of dependent arithmetic per pixel.
+cbuffer Calibration : register(b0)
+{
+    float Value;
+    uint IterationNum;
+    float2 Padding;
+}
+
+float4 main(const float4 InPosition : SV_Position) : SV_Target
+{
+    // Seeded per pixel and run for a count only known at draw time, so the compiler folds none of it away.
+    float3 Color = frac(InPosition.xyx * 0.001f + Value);
+
+    [loop]
+    for (uint Iteration = 0u; Iteration < IterationNum; ++Iteration)
+    {
+        Color = frac(Color * 1.618f + Color.yzx * 0.5f);
+    }
+
+    return float4(Color, 1.0f);
+}
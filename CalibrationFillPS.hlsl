@@ -0,0 +1,12 @@
+// A flat colour, what the quality calibration's fill test writes over the whole target.
+cbuffer Calibration : register(b0)
+{
+    float Value;
+    uint IterationNum;
+    float2 Padding;
+}
+
+float4 main() : SV_Target
+{
+    return float4(Value, 0.5f, 0.25f, 1.0f);
+}
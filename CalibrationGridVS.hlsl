@@ -0,0 +1,12 @@
+// Triangles of a fifth of a cell on a grid across the target, generated from the vertex index. At 1080p each is under a
+// pixel, so the quality calibration times the vertices with next to nothing rasterized.
+static const uint GridSize = 1024u;
+
+float4 main(const uint InVertexID : SV_VertexID) : SV_Position
+{
+    const uint Triangle = InVertexID / 3u;
+    const uint Corner = InVertexID % 3u;
+    const float2 Cell = float2(Triangle % GridSize, Triangle / GridSize) + 0.5f;
+    const float2 Position = (Cell + float2(Corner == 1u, Corner == 2u) * 0.2f) / GridSize;
+    return float4(Position * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+}
@@ -33,6 +33,13 @@ void Camera::Translate(DirectX::XMFLOAT3 InTranslation) noexcept
 	Position.z += InTranslation.z;
 }
 
+void Camera::SetPose(const DirectX::XMFLOAT3 InPosition, const float InPitch, const float InYaw) noexcept
+{
+	Position = InPosition;
+	Yaw = Math::WrapAngle(InYaw);
+	Pitch = std::clamp(InPitch, 0.995f * -Math::PI / 2.0f, 0.995f * Math::PI / 2.0f);
+}
+
 DirectX::XMMATRIX Camera::GetMatrix() const noexcept
 {
 	const auto ForwardBaseVector = DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
@@ -50,6 +57,16 @@ DirectX::XMFLOAT3 Camera::GetPosition() const
 	return Position;
 }
 
+float Camera::GetPitch() const noexcept
+{
+	return Pitch;
+}
+
+float Camera::GetYaw() const noexcept
+{
+	return Yaw;
+}
+
 void Camera::ShowControlWindow() noexcept
 {
 	if (ImGui::Begin("Camera"))
@@ -10,8 +10,11 @@ public:
 	void Reset() noexcept;
 	void Rotate(float InDeltaX, float InDeltaY) noexcept;
 	void Translate(DirectX::XMFLOAT3 InTranslation) noexcept;
+	void SetPose(DirectX::XMFLOAT3 InPosition, float InPitch, float InYaw) noexcept;
 	[[nodiscard]] DirectX::XMMATRIX GetMatrix() const noexcept;
 	[[nodiscard]] DirectX::XMFLOAT3 GetPosition() const;
+	[[nodiscard]] float GetPitch() const noexcept;
+	[[nodiscard]] float GetYaw() const noexcept;
 
 private:
 	static constexpr float TranslationSpeed = 12.0f;
@@ -0,0 +1,17 @@
+// Motion vectors of everything as if only the camera moved, from the frame's depth, one thread per pixel in 8x8 tiles.
+// What moved on its own is drawn over them by ObjectMotionPS.hlsl.
+#include "Motion.hlsli"
+
+Texture2D<float> Depth : register(t0);
+RWTexture2D<float2> Motion : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= (uint2) ViewportSize))
+    {
+        return;
+    }
+
+    Motion[InThreadID.xy] = GetMotion(InThreadID.xy + 0.5f, Depth[InThreadID.xy]);
+}
@@ -0,0 +1,116 @@
+#include "ClusteredLighting.hlsli"
+
+StructuredBuffer<PointLightData> Lights : register(t0);
+StructuredBuffer<DecalData> Decals : register(t1);
+RWStructuredBuffer<uint> ClusterLightCounts : register(u0);
+RWStructuredBuffer<uint> ClusterLightIndices : register(u1);
+RWStructuredBuffer<uint> ClusterDecalCounts : register(u2);
+RWStructuredBuffer<uint> ClusterDecalIndices : register(u3);
+
+#define GROUP_SIZE 64
+
+// View space spheres of the batch of lights or decals the group is testing, loaded once per group instead of once per cluster.
+groupshared float4 SharedLights[GROUP_SIZE];
+groupshared uint2 SharedBounds[GROUP_SIZE];
+
+// Against the clusters ClusteredLighting::Cull found the sphere's screen rectangle and depth range to span, cheaper than the sphere.
+bool IsInBounds(const uint3 InCluster, const uint2 InBounds)
+{
+    const uint3 Min = uint3(InBounds.x & 0xFFu, (InBounds.x >> 8u) & 0xFFu, InBounds.x >> 16u);
+    const uint3 Max = uint3(InBounds.y & 0xFFu, (InBounds.y >> 8u) & 0xFFu, InBounds.y >> 16u);
+    return all(InCluster >= Min) && all(InCluster <= Max);
+}
+
+bool Intersects(const float4 InSphere, const float3 InMin, const float3 InMax)
+{
+    const float3 Closest = clamp(InSphere.xyz, InMin, InMax);
+    const float3 Offset = Closest - InSphere.xyz;
+    return dot(Offset, Offset) <= InSphere.w * InSphere.w;
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID, const uint InGroupIndex : SV_GroupIndex)
+{
+    const uint ClusterIndex = InThreadID.x;
+    const bool bIsCluster = ClusterIndex < ClusterNum;
+    const uint3 Cluster = uint3(ClusterIndex % ClusterCountX, ClusterIndex / ClusterCountX % ClusterCountY, ClusterIndex / (ClusterCountX * ClusterCountY));
+
+    // View space box around the slice of the tile's frustum, screen Y points down while NDC Y points up.
+    const float2 NdcMin = float2(Cluster.x, ClusterCountY - Cluster.y - 1u) / float2(ClusterCountX, ClusterCountY) * 2.0f - 1.0f;
+    const float2 NdcMax = float2(Cluster.x + 1u, ClusterCountY - Cluster.y) / float2(ClusterCountX, ClusterCountY) * 2.0f - 1.0f;
+    const float SliceNear = NearZ * pow(FarZ / NearZ, (float) Cluster.z / ClusterCountZ);
+    const float SliceFar = NearZ * pow(FarZ / NearZ, (float) (Cluster.z + 1u) / ClusterCountZ);
+
+    const float2 NearMin = NdcMin * SliceNear / ProjectionScale;
+    const float2 NearMax = NdcMax * SliceNear / ProjectionScale;
+    const float2 FarMin = NdcMin * SliceFar / ProjectionScale;
+    const float2 FarMax = NdcMax * SliceFar / ProjectionScale;
+    const float3 BoxMin = float3(min(NearMin, FarMin), SliceNear);
+    const float3 BoxMax = float3(max(NearMax, FarMax), SliceFar);
+
+    uint Count = 0u;
+
+    // Every thread takes part in loading and both barriers, even past the last cluster.
+    for (uint First = 0u; First < LightNum; First += GROUP_SIZE)
+    {
+        if (First + InGroupIndex < LightNum)
+        {
+            const PointLightData Light = Lights[First + InGroupIndex];
+            SharedLights[InGroupIndex] = float4(mul(float4(Light.WorldPosition, 1.0f), ClusterView).xyz, Light.Range);
+            SharedBounds[InGroupIndex] = uint2(Light.ClusterMin, Light.ClusterMax);
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        const uint BatchNum = min(GROUP_SIZE, LightNum - First);
+
+        for (uint Index = 0u; Index < BatchNum && bIsCluster && Count < MaxLightsPerCluster; ++Index)
+        {
+            if (IsInBounds(Cluster, SharedBounds[Index]) && Intersects(SharedLights[Index], BoxMin, BoxMax))
+            {
+                ClusterLightIndices[ClusterIndex * MaxLightsPerCluster + Count] = First + Index;
+                ++Count;
+            }
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (bIsCluster)
+    {
+        ClusterLightCounts[ClusterIndex] = Count;
+    }
+
+    // The decals the same way into lists of their own, in the order they were added so the last one added draws on top.
+    Count = 0u;
+
+    for (uint First = 0u; First < DecalNum; First += GROUP_SIZE)
+    {
+        if (First + InGroupIndex < DecalNum)
+        {
+            const DecalData Decal = Decals[First + InGroupIndex];
+            SharedLights[InGroupIndex] = float4(mul(float4(Decal.WorldPosition, 1.0f), ClusterView).xyz, Decal.Range);
+            SharedBounds[InGroupIndex] = uint2(Decal.ClusterMin, Decal.ClusterMax);
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        const uint BatchNum = min(GROUP_SIZE, DecalNum - First);
+
+        for (uint Index = 0u; Index < BatchNum && bIsCluster && Count < MaxDecalsPerCluster; ++Index)
+        {
+            if (IsInBounds(Cluster, SharedBounds[Index]) && Intersects(SharedLights[Index], BoxMin, BoxMax))
+            {
+                ClusterDecalIndices[ClusterIndex * MaxDecalsPerCluster + Count] = First + Index;
+                ++Count;
+            }
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (bIsCluster)
+    {
+        ClusterDecalCounts[ClusterIndex] = Count;
+    }
+}
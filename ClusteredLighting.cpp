@@ -0,0 +1,375 @@
+﻿#include "ClusteredLighting.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include "ConstantBufferRing.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	constexpr UINT CullGroupSize {64u};
+	// Brightness an 8-bit target rounds to black.
+	constexpr float VisibleThreshold {1.0f / 256.0f};
+
+	void CreateStructuredBuffer(ID3D11Device* InDevice, const UINT InStride, const UINT InNum, const bool bIsWritable,
+	                            Microsoft::WRL::ComPtr<ID3D11Buffer>& OutBuffer, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& OutView,
+	                            Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>* OutUav)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC Desc {};
+		Desc.ByteWidth = InStride * InNum;
+		Desc.Usage = bIsWritable ? D3D11_USAGE_DEFAULT : D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | (bIsWritable ? D3D11_BIND_UNORDERED_ACCESS : 0u);
+		Desc.CPUAccessFlags = bIsWritable ? 0u : D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		Desc.StructureByteStride = InStride;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&Desc, nullptr, &OutBuffer))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(OutBuffer.Get(), nullptr, &OutView))
+
+		if (OutUav)
+		{
+			CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(OutBuffer.Get(), nullptr, OutUav->ReleaseAndGetAddressOf()))
+		}
+	}
+
+	// Normalized device range along one axis of a view space sphere in front of the eye, between the planes through the eye
+	// tangent to it. Solves (InOffset - Slope * InDepth)^2 = InRadius^2 * (1 + Slope^2) for the slopes.
+	std::pair<float, float> ProjectSphere(const float InOffset, const float InDepth, const float InRadius, const float InScale) noexcept
+	{
+		const auto Root = InRadius * std::sqrt(InOffset * InOffset + InDepth * InDepth - InRadius * InRadius);
+		const auto Denominator = InDepth * InDepth - InRadius * InRadius;
+		return {(InOffset * InDepth - Root) / Denominator * InScale, (InOffset * InDepth + Root) / Denominator * InScale};
+	}
+
+	void Upload(ID3D11DeviceContext* InContext, ID3D11Buffer* InBuffer, const void* InData, const size_t InByteSize)
+	{
+		HRESULT ResultHandle;
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+		CHECK_HRESULT_EXCEPTION(InContext->Map(InBuffer, 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		std::memcpy(MappedResource.pData, InData, InByteSize);
+		InContext->Unmap(InBuffer, 0u);
+	}
+}
+
+ClusteredLighting::ClusteredLighting(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+{
+	HRESULT ResultHandle;
+	const auto Blob = InShaderBundle.Load("ClusterLightCullCS.cso");
+
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &CullShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(ClusterConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &UnclusteredConstantBuffer))
+	ConstantBufferDesc.ByteWidth = sizeof(ObjectLightConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ObjectLightBuffer))
+
+	CreateStructuredBuffer(InDevice, sizeof(PointLightData), MaxLightNum, false, LightBuffer, LightView, nullptr);
+	CreateStructuredBuffer(InDevice, sizeof(UINT), ClusterNum, true, ClusterLightCounts, ClusterLightCountView, &ClusterLightCountUav);
+	CreateStructuredBuffer(InDevice, sizeof(UINT), ClusterNum * MaxLightsPerCluster, true, ClusterLightIndices, ClusterLightIndexView, &ClusterLightIndexUav);
+	CreateStructuredBuffer(InDevice, sizeof(DecalData), MaxDecalNum, false, DecalBuffer, DecalView, nullptr);
+	CreateStructuredBuffer(InDevice, sizeof(UINT), ClusterNum, true, ClusterDecalCounts, ClusterDecalCountView, &ClusterDecalCountUav);
+	CreateStructuredBuffer(InDevice, sizeof(UINT), ClusterNum * MaxDecalsPerCluster, true, ClusterDecalIndices, ClusterDecalIndexView, &ClusterDecalIndexUav);
+
+	Lights.reserve(MaxLightNum);
+	Decals.reserve(MaxDecalNum);
+}
+
+void ClusteredLighting::BeginFrame() noexcept
+{
+	Lights.clear();
+	Decals.clear();
+	AmbientColor = {0.0f, 0.0f, 0.0f};
+}
+
+void ClusteredLighting::AddLight(const PointLightData& InLight, const DirectX::XMFLOAT3& InAmbientColor) noexcept
+{
+	AmbientColor.x += InAmbientColor.x;
+	AmbientColor.y += InAmbientColor.y;
+	AmbientColor.z += InAmbientColor.z;
+
+	if (Lights.size() == MaxLightNum)
+	{
+		return;
+	}
+
+	auto& Light = Lights.emplace_back(InLight);
+	Light.Range = GetRange(InLight);
+}
+
+void ClusteredLighting::AddDecal(const DecalData& InDecal) noexcept
+{
+	if (Decals.size() == MaxDecalNum)
+	{
+		return;
+	}
+
+	auto& Decal = Decals.emplace_back(InDecal);
+	float RangeSquared = 0.0f;
+
+	// The box spans -1 to 1 in decal space, so the length of each row is one over the box's half size along that axis.
+	for (const auto& Row : Decal.WorldToDecal)
+	{
+		const auto HalfSize = 1.0f / DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat4(&Row)));
+		RangeSquared += HalfSize * HalfSize;
+	}
+
+	Decal.Range = std::sqrt(RangeSquared);
+}
+
+float ClusteredLighting::GetRange(const PointLightData& InLight) noexcept
+{
+	const auto& [Red, Green, Blue] = InLight.DiffuseColor;
+	const auto Peak = std::abs(InLight.DiffuseStrength) * std::max({Red, Green, Blue});
+
+	// Solves Peak / (Q * d^2 + L * d + C) = VisibleThreshold for d.
+	const auto Constant = InLight.ConstantAttenuation - Peak / VisibleThreshold;
+	const auto Linear = InLight.LinearAttenuation;
+	const auto Quadratic = InLight.QuadraticAttenuation;
+
+	if (Constant >= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	if (Quadratic > 0.0f)
+	{
+		return (-Linear + std::sqrt(Linear * Linear - 4.0f * Quadratic * Constant)) / (2.0f * Quadratic);
+	}
+
+	return Linear > 0.0f ? -Constant / Linear : std::numeric_limits<float>::max();
+}
+
+bool ClusteredLighting::BoundClusters(const DirectX::XMFLOAT3& InWorldPosition, const float InRadius, const ClusterConstants& InConstants,
+                                      const DirectX::FXMMATRIX InView, UINT& OutClusterMin, UINT& OutClusterMax) noexcept
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMStoreFloat3(&Center, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&InWorldPosition), InView));
+	const auto Radius = InRadius;
+
+	if (Radius <= 0.0f || Center.z + Radius <= InConstants.NearZ || Center.z - Radius >= InConstants.FarZ)
+	{
+		return false;
+	}
+
+	std::pair<float, float> NdcX {-1.0f, 1.0f};
+	std::pair<float, float> NdcY {-1.0f, 1.0f};
+
+	// A sphere reaching behind the near plane may cover any part of the screen.
+	if (Center.z - Radius > InConstants.NearZ)
+	{
+		NdcX = ProjectSphere(Center.x, Center.z, Radius, InConstants.ProjectionScale.x);
+		NdcY = ProjectSphere(Center.y, Center.z, Radius, InConstants.ProjectionScale.y);
+
+		const auto Width = (NdcX.second - NdcX.first) * 0.5f * InConstants.TileSize.x * ClusterCountX;
+		const auto Height = (NdcY.second - NdcY.first) * 0.5f * InConstants.TileSize.y * ClusterCountY;
+
+		if (NdcX.first >= 1.0f || NdcX.second <= -1.0f || NdcY.first >= 1.0f || NdcY.second <= -1.0f ||
+		    (Width < MinScreenSize && Height < MinScreenSize))
+		{
+			return false;
+		}
+	}
+
+	// Picked the way the pixel shaders pick theirs, screen Y points down while NDC Y points up.
+	const auto ToTile = [](const float InScreen, const UINT InCount)
+	{
+		return static_cast<UINT>(std::clamp(InScreen * static_cast<float>(InCount), 0.0f, static_cast<float>(InCount - 1u)));
+	};
+
+	const auto ToSlice = [&InConstants](const float InDepth)
+	{
+		const auto Slice = std::log(std::max(InDepth, InConstants.NearZ)) * InConstants.DepthSliceScale + InConstants.DepthSliceBias;
+		return static_cast<UINT>(std::clamp(Slice, 0.0f, static_cast<float>(ClusterCountZ - 1u)));
+	};
+
+	OutClusterMin = ToTile((NdcX.first + 1.0f) * 0.5f, ClusterCountX) | ToTile((1.0f - NdcY.second) * 0.5f, ClusterCountY) << 8u |
+	                        ToSlice(Center.z - Radius) << 16u;
+	OutClusterMax = ToTile((NdcX.second + 1.0f) * 0.5f, ClusterCountX) | ToTile((1.0f - NdcY.first) * 0.5f, ClusterCountY) << 8u |
+	                        ToSlice(Center.z + Radius) << 16u;
+	return true;
+}
+
+void ClusteredLighting::Cull(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Light culling");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	// The lists are about to be written, any pixel shader views left from last frame would make the runtime drop the UAVs.
+	Context.GetStateCache().SetPixelShaderResource(ClusterLightCountSlot, nullptr);
+	Context.GetStateCache().SetPixelShaderResource(ClusterLightIndexSlot, nullptr);
+	Context.GetStateCache().SetPixelShaderResource(ClusterDecalCountSlot, nullptr);
+	Context.GetStateCache().SetPixelShaderResource(ClusterDecalIndexSlot, nullptr);
+
+	const auto Projection = InGraphics.GetProjectionMatrix();
+	DirectX::XMFLOAT4X4 ProjectionValues;
+	DirectX::XMStoreFloat4x4(&ProjectionValues, Projection);
+
+	// Left handed perspective, _33 = f / (f - n) and _43 = -n * f / (f - n).
+	const auto NearZ = -ProjectionValues._43 / ProjectionValues._33;
+	const auto FarZ = ProjectionValues._43 / (1.0f - ProjectionValues._33);
+	const auto DepthRangeLog = std::log(FarZ / NearZ);
+
+	ClusterConstants Constants {};
+	Constants.View = DirectX::XMMatrixTranspose(InGraphics.GetViewMatrix());
+	Constants.TileSize = {InGraphics.GetViewport().Width / ClusterCountX, InGraphics.GetViewport().Height / ClusterCountY};
+	Constants.DepthSliceScale = ClusterCountZ / DepthRangeLog;
+	Constants.DepthSliceBias = -ClusterCountZ * std::log(NearZ) / DepthRangeLog;
+	Constants.AmbientColor = AmbientColor;
+	Constants.ProjectionScale = {ProjectionValues._11, ProjectionValues._22};
+	Constants.NearZ = NearZ;
+	Constants.FarZ = FarZ;
+
+	// The lights the camera sees go first and only those are culled against the clusters, the rest are still there for the
+	// unclustered views. Stable, so the lights added first keep their place in full clusters.
+	const auto View = InGraphics.GetViewMatrix();
+	const auto Visible = std::stable_partition(Lights.begin(), Lights.end(), [&Constants, &View](PointLightData& InOutLight)
+	{
+		return BoundClusters(InOutLight.WorldPosition, InOutLight.Range, Constants, View, InOutLight.ClusterMin, InOutLight.ClusterMax);
+	});
+
+	VisibleLightNum = static_cast<UINT>(Visible - Lights.begin());
+	Constants.LightNum = VisibleLightNum;
+
+	// Nothing but the clusters reads decals, the rest need not be uploaded. Stable, so they still draw in the order added.
+	const auto VisibleDecals = std::stable_partition(Decals.begin(), Decals.end(), [&Constants, &View](DecalData& InOutDecal)
+	{
+		return BoundClusters(InOutDecal.WorldPosition, InOutDecal.Range, Constants, View, InOutDecal.ClusterMin, InOutDecal.ClusterMax);
+	});
+
+	VisibleDecalNum = static_cast<UINT>(VisibleDecals - Decals.begin());
+	Constants.DecalNum = VisibleDecalNum;
+
+	Upload(DeviceContext, ConstantBuffer.Get(), &Constants, sizeof(Constants));
+	Constants.bIsUnclustered = 1u;
+	Upload(DeviceContext, UnclusteredConstantBuffer.Get(), &Constants, sizeof(Constants));
+	Upload(DeviceContext, LightBuffer.Get(), Lights.data(), Lights.size() * sizeof(PointLightData));
+	Upload(DeviceContext, DecalBuffer.Get(), Decals.data(), VisibleDecalNum * sizeof(DecalData));
+
+	ID3D11UnorderedAccessView* const Uavs[] = {ClusterLightCountUav.Get(), ClusterLightIndexUav.Get(), ClusterDecalCountUav.Get(), ClusterDecalIndexUav.Get()};
+	ID3D11ShaderResourceView* const Views[] = {LightView.Get(), DecalView.Get()};
+
+	DeviceContext->CSSetShader(CullShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(0u, static_cast<UINT>(std::size(Views)), Views);
+	DeviceContext->CSSetUnorderedAccessViews(0u, static_cast<UINT>(std::size(Uavs)), Uavs, nullptr);
+	DeviceContext->Dispatch((ClusterNum + CullGroupSize - 1u) / CullGroupSize, 1u, 1u);
+
+	// Unbound so the pixel shaders can read the lists.
+	ID3D11UnorderedAccessView* const NullUavs[std::size(Uavs)] {};
+	ID3D11ShaderResourceView* const NullViews[std::size(Views)] {};
+	DeviceContext->CSSetUnorderedAccessViews(0u, static_cast<UINT>(std::size(NullUavs)), NullUavs, nullptr);
+	DeviceContext->CSSetShaderResources(0u, static_cast<UINT>(std::size(NullViews)), NullViews);
+}
+
+void ClusteredLighting::Bind(RenderContext& InContext) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelShaderResource(LightSlot, LightView.Get());
+	Cache.SetPixelShaderResource(ClusterLightCountSlot, ClusterLightCountView.Get());
+	Cache.SetPixelShaderResource(ClusterLightIndexSlot, ClusterLightIndexView.Get());
+	Cache.SetPixelShaderResource(DecalSlot, DecalView.Get());
+	Cache.SetPixelShaderResource(ClusterDecalCountSlot, ClusterDecalCountView.Get());
+	Cache.SetPixelShaderResource(ClusterDecalIndexSlot, ClusterDecalIndexView.Get());
+}
+
+void ClusteredLighting::BindCompute(ID3D11DeviceContext* InContext) const noexcept
+{
+	ID3D11ShaderResourceView* const Views[] = {LightView.Get(), ClusterLightCountView.Get(), ClusterLightIndexView.Get()};
+	static_assert(ClusterLightCountSlot == LightSlot + 1u && ClusterLightIndexSlot == LightSlot + 2u, "Views are bound as one range");
+
+	InContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	InContext->CSSetShaderResources(LightSlot, static_cast<UINT>(std::size(Views)), Views);
+
+	ID3D11ShaderResourceView* const DecalViews[] = {DecalView.Get(), ClusterDecalCountView.Get(), ClusterDecalIndexView.Get()};
+	static_assert(ClusterDecalCountSlot == DecalSlot + 1u && ClusterDecalIndexSlot == DecalSlot + 2u, "Views are bound as one range");
+
+	InContext->CSSetShaderResources(DecalSlot, static_cast<UINT>(std::size(DecalViews)), DecalViews);
+}
+
+void ClusteredLighting::BindUnclustered(RenderContext& InContext) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+
+	Cache.SetPixelConstantBuffer(ConstantSlot, UnclusteredConstantBuffer.Get());
+	Cache.SetPixelShaderResource(LightSlot, LightView.Get());
+}
+
+void ClusteredLighting::BindObjectLights(RenderContext& InContext, const DirectX::BoundingBox* const InWorldBounds) const
+{
+	struct Candidate
+	{
+		float Brightness;
+		UINT Index;
+	};
+
+	std::array<Candidate, MaxLightNum> Candidates;
+	UINT CandidateNum = 0u;
+
+	for (UINT Index = 0u; Index < Lights.size(); ++Index)
+	{
+		const auto& Light = Lights[Index];
+		const auto Position = DirectX::XMLoadFloat3(&Light.WorldPosition);
+		float Distance = 0.0f;
+
+		if (InWorldBounds)
+		{
+			// Zero inside the box, otherwise to the closest point on it.
+			const auto Center = DirectX::XMLoadFloat3(&InWorldBounds->Center);
+			const auto Extents = DirectX::XMLoadFloat3(&InWorldBounds->Extents);
+			const auto Outside = DirectX::XMVectorMax(DirectX::XMVectorSubtract(DirectX::XMVectorAbs(DirectX::XMVectorSubtract(Position, Center)), Extents),
+			                                          DirectX::XMVectorZero());
+			Distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(Outside));
+
+			if (Distance >= Light.Range)
+			{
+				continue;
+			}
+		}
+
+		// The shaders' CalcAttenuate at that distance, scaled by the light's brightest channel.
+		const auto& [Red, Green, Blue] = Light.DiffuseColor;
+		const auto Attenuation = Light.QuadraticAttenuation * Distance * Distance + Light.LinearAttenuation * Distance + Light.ConstantAttenuation;
+		Candidates[CandidateNum++] = {std::abs(Light.DiffuseStrength) * std::max({Red, Green, Blue}) / std::max(Attenuation, 1e-6f), Index};
+	}
+
+	const auto LightNum = std::min(CandidateNum, MaxObjectLightNum);
+	std::partial_sort(Candidates.begin(), Candidates.begin() + LightNum, Candidates.begin() + CandidateNum, [](const Candidate& InLeft, const Candidate& InRight)
+	{
+		return InLeft.Brightness > InRight.Brightness;
+	});
+
+	ObjectLightConstants Constants {};
+	Constants.LightNum = LightNum;
+
+	for (UINT Index = 0u; Index < LightNum; ++Index)
+	{
+		reinterpret_cast<UINT*>(Constants.LightIndices)[Index] = Candidates[Index].Index;
+	}
+
+	if (ConstantBufferRing* const Ring = InContext.GetConstantBufferRing())
+	{
+		const auto Allocation = Ring->Allocate(&Constants, sizeof(Constants));
+		InContext.GetStateCache().SetPixelConstantBuffer(ObjectLightSlot, Allocation.Buffer, Allocation.FirstConstant, Allocation.ConstantNum);
+		return;
+	}
+
+	Upload(InContext.GetDeviceContext(), ObjectLightBuffer.Get(), &Constants, sizeof(Constants));
+	InContext.GetStateCache().SetPixelConstantBuffer(ObjectLightSlot, ObjectLightBuffer.Get());
+}
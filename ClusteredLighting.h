@@ -0,0 +1,213 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <span>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class RenderContext;
+class ShaderBundle;
+
+/**
+ * Clustered forward lighting. The view frustum is split into screen tiles and exponential depth slices, a compute
+ * pass lists the point lights touching each cluster and the Phong pixel shaders only loop over their cluster's list,
+ * so shading cost follows the local light density instead of the total light count. Each light's range is projected to a screen
+ * rectangle and depth range first, lights off screen or only a pixel or two across are left out of the lists entirely and the
+ * rest are only tested against the clusters inside their bounds. Views the clusters don't cover get a short
+ * list per draw instead, picked on the CPU from the lights whose range reaches the drawable's bounds.
+ * Decals are binned the same way into lists of their own, each a box projecting a region of the DecalAtlas onto the albedo of
+ * whatever lies inside it, so they cost no draws and only the pixels they overlap loop over them. Unclustered views show none.
+ * The layouts and grid size here mirror ClusteredLighting.hlsli.
+ */
+class ClusteredLighting
+{
+public:
+	struct PointLightData
+	{
+		DirectX::XMFLOAT3 WorldPosition;
+		// Filled in by AddLight.
+		float Range;
+		DirectX::XMFLOAT3 DiffuseColor;
+		float DiffuseStrength;
+		float QuadraticAttenuation;
+		float LinearAttenuation;
+		float ConstantAttenuation;
+		// Filled in by PointLightShadows::AddLight, negative when the light casts no shadows.
+		int ShadowIndex;
+		DirectX::XMFLOAT2 ShadowDepthTransform;
+		// Filled in by Cull for the lights the camera sees.
+		UINT ClusterMin;
+		UINT ClusterMax;
+	};
+
+	// Laid out like DecalData in ClusteredLighting.hlsli.
+	struct DecalData
+	{
+		DirectX::XMFLOAT3 WorldPosition;
+		// Filled in by AddDecal, around the box.
+		float Range;
+		// Rows of the world to decal transform, a point inside the box lands within -1 and 1 on every axis. The image spans x
+		// and y and is projected along z.
+		DirectX::XMFLOAT4 WorldToDecal[3];
+		// Corner and size in atlas coordinates, see DecalAtlas::Resolve.
+		DirectX::XMFLOAT4 AtlasRegion;
+		DirectX::XMFLOAT3 Color;
+		float Opacity;
+		// Filled in by Cull for the decals the camera sees.
+		UINT ClusterMin;
+		UINT ClusterMax;
+		float Padding[2];
+	};
+
+	static constexpr UINT ClusterCountX {16u};
+	static constexpr UINT ClusterCountY {9u};
+	static constexpr UINT ClusterCountZ {24u};
+	static constexpr UINT ClusterNum {ClusterCountX * ClusterCountY * ClusterCountZ};
+	static constexpr UINT MaxLightsPerCluster {64u};
+	static constexpr UINT MaxLightNum {1024u};
+	static constexpr UINT MaxDecalsPerCluster {32u};
+	static constexpr UINT MaxDecalNum {4096u};
+	// Lights each draw of an unclustered view is shaded by at most, a multiple of four.
+	static constexpr UINT MaxObjectLightNum {8u};
+
+	ClusteredLighting(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	ClusteredLighting(const ClusteredLighting&) = delete;
+	ClusteredLighting(ClusteredLighting&&) = delete;
+	ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+	ClusteredLighting& operator=(ClusteredLighting&&) = delete;
+	~ClusteredLighting() = default;
+
+	void BeginFrame() noexcept;
+	// Ambient light of every added light is summed into the scene ambient term. Lights past MaxLightNum are dropped.
+	void AddLight(const PointLightData& InLight, const DirectX::XMFLOAT3& InAmbientColor) noexcept;
+
+	// Decals past MaxDecalNum are dropped, clusters draw theirs in the order they were added, the last on top.
+	void AddDecal(const DecalData& InDecal) noexcept;
+
+	// Uploads the frame's lights and decals and rebuilds the cluster light lists, before anything is drawn.
+	// The tiles split the frame's viewport, whatever resolution the scene renders at.
+	void Cull(const Graphics& InGraphics);
+	// Light and decal lists and cluster lookup for the pixel shaders, bound on every context that records the frame.
+	void Bind(RenderContext& InContext) const noexcept;
+	// The same for compute shaders that shade, straight to the context like every compute binding.
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+	// For views other than the camera's the clusters don't cover, such as reflection probe faces. Each draw then needs BindObjectLights.
+	void BindUnclustered(RenderContext& InContext) const noexcept;
+	// The lights of the next unclustered draw: the MaxObjectLightNum of those reaching InWorldBounds that are brightest at its nearest
+	// point. Drawables without bounds get the brightest lights anywhere.
+	void BindObjectLights(RenderContext& InContext, const DirectX::BoundingBox* InWorldBounds) const;
+
+	[[nodiscard]] UINT GetLightNum() const noexcept
+	{
+		return static_cast<UINT>(Lights.size());
+	}
+
+	// Of the last Cull, the lights listed in any cluster at all.
+	[[nodiscard]] UINT GetVisibleLightNum() const noexcept
+	{
+		return VisibleLightNum;
+	}
+
+	[[nodiscard]] UINT GetDecalNum() const noexcept
+	{
+		return static_cast<UINT>(Decals.size());
+	}
+
+	// Of the last Cull, the decals in front of the camera and large enough on screen to be listed.
+	[[nodiscard]] UINT GetVisibleDecalNum() const noexcept
+	{
+		return VisibleDecalNum;
+	}
+
+	// This frame's lights so far, with their ranges. Cull moves the ones the camera sees to the front.
+	[[nodiscard]] std::span<const PointLightData> GetLights() const noexcept
+	{
+		return Lights;
+	}
+
+	// What the lights added so far sum to, the ambient term of surfaces nothing better lights.
+	[[nodiscard]] const DirectX::XMFLOAT3& GetAmbientColor() const noexcept
+	{
+		return AmbientColor;
+	}
+
+	// Distance where the light's attenuated brightness falls below what an 8-bit target can show.
+	[[nodiscard]] static float GetRange(const PointLightData& InLight) noexcept;
+
+private:
+	struct ClusterConstants
+	{
+		DirectX::XMMATRIX View;
+		DirectX::XMFLOAT2 TileSize;
+		float DepthSliceScale;
+		float DepthSliceBias;
+		DirectX::XMFLOAT3 AmbientColor;
+		UINT LightNum;
+		DirectX::XMFLOAT2 ProjectionScale;
+		float NearZ;
+		float FarZ;
+		UINT bIsUnclustered;
+		UINT DecalNum;
+		float Padding[2];
+	};
+
+	// Laid out like ObjectLights in ClusteredLighting.hlsli.
+	struct ObjectLightConstants
+	{
+		UINT LightNum;
+		UINT Padding[3];
+		// Four indices to an element, each element of a constant buffer array takes 16 bytes anyway.
+		DirectX::XMUINT4 LightIndices[MaxObjectLightNum / 4u];
+	};
+
+	// Shared by the cull shader and the pixel shaders, whose material and camera constants take slots one and two.
+	static constexpr UINT ConstantSlot {3u};
+	// Pixel shader slots, after the material textures.
+	static constexpr UINT LightSlot {8u};
+	static constexpr UINT ClusterLightCountSlot {9u};
+	static constexpr UINT ClusterLightIndexSlot {10u};
+	static constexpr UINT ObjectLightSlot {7u};
+	// After the irradiance volume's.
+	static constexpr UINT DecalSlot {19u};
+	static constexpr UINT ClusterDecalCountSlot {20u};
+	static constexpr UINT ClusterDecalIndexSlot {21u};
+	// Projected diameter in pixels a light has to reach on either axis to be listed.
+	static constexpr float MinScreenSize {2.0f};
+
+	// Fills in the cluster bounds of a light's or decal's sphere, false when the camera doesn't see it or it is too small on screen.
+	static bool BoundClusters(const DirectX::XMFLOAT3& InWorldPosition, float InRadius, const ClusterConstants& InConstants, DirectX::FXMMATRIX InView,
+	                          UINT& OutClusterMin, UINT& OutClusterMax) noexcept;
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> CullShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	// The same constants with the lists switched off.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> UnclusteredConstantBuffer;
+	// Rewritten per draw for contexts without a constant buffer ring.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ObjectLightBuffer;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> LightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LightView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ClusterLightCounts;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ClusterLightCountView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ClusterLightCountUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ClusterLightIndices;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ClusterLightIndexView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ClusterLightIndexUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> DecalBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DecalView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ClusterDecalCounts;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ClusterDecalCountView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ClusterDecalCountUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ClusterDecalIndices;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ClusterDecalIndexView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ClusterDecalIndexUav;
+
+	std::vector<PointLightData> Lights;
+	std::vector<DecalData> Decals;
+	DirectX::XMFLOAT3 AmbientColor {0.0f, 0.0f, 0.0f};
+	UINT VisibleLightNum {0u};
+	UINT VisibleDecalNum {0u};
+};
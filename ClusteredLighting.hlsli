@@ -0,0 +1,89 @@
+// Shared by the light culling shader and every pixel shader that reads the cluster light or decal lists.
+struct PointLightData
+{
+    float3 WorldPosition;
+    // Distance where the light falls below visible brightness, nothing beyond it is lit.
+    float Range;
+    float3 DiffuseColor;
+    float DiffuseStrength;
+    float QuadraticAttenuation;
+    float LinearAttenuation;
+    float ConstantAttenuation;
+    // Slot of the light's shadow faces in the atlas, negative when it casts no shadows.
+    int ShadowIndex;
+    // Depth of a view space distance in the shadow faces, Depth = x + y / Distance.
+    float2 ShadowDepthTransform;
+    // First and last cluster of the light's screen rectangle and depth range, tile x and y and slice a byte each from the lowest.
+    uint ClusterMin;
+    uint ClusterMax;
+};
+
+// A box projecting a region of the decal atlas onto the albedo of what lies inside it.
+struct DecalData
+{
+    // Centre and radius of the sphere around the box, culled like a light's range.
+    float3 WorldPosition;
+    float Range;
+    // Rows of the world to decal transform, dot(float4(Position, 1), Row) is within -1 and 1 inside the box. The image spans x
+    // and y and is projected along z.
+    float4 WorldToDecal[3];
+    // Corner and size in atlas coordinates.
+    float4 AtlasRegion;
+    float3 Color;
+    float Opacity;
+    uint ClusterMin;
+    uint ClusterMax;
+    float2 DecalPadding;
+};
+
+static const uint ClusterCountX = 16u;
+static const uint ClusterCountY = 9u;
+static const uint ClusterCountZ = 24u;
+static const uint ClusterNum = ClusterCountX * ClusterCountY * ClusterCountZ;
+// Lights past this in one cluster are dropped, the list is a fixed slice per cluster.
+static const uint MaxLightsPerCluster = 64u;
+static const uint MaxDecalsPerCluster = 32u;
+
+cbuffer ClusterConstants : register(b3)
+{
+    // The camera view the clusters were built for, named apart from the frame constants.
+    matrix ClusterView;
+    float2 TileSize;
+    // Depth slices are spaced exponentially, slice = log(ViewDepth) * DepthSliceScale + DepthSliceBias.
+    float DepthSliceScale;
+    float DepthSliceBias;
+    float3 AmbientColor;
+    uint LightNum;
+    float2 ProjectionScale;
+    float NearZ;
+    float FarZ;
+    // Set for views the clusters weren't built for, the draw's ObjectLights are looped over instead.
+    uint bIsUnclustered;
+    uint DecalNum;
+    float2 ClusterPadding;
+}
+
+static const uint MaxObjectLightNum = 8u;
+
+// The lights of the draw for views the clusters weren't built for, picked by ClusteredLighting::BindObjectLights.
+cbuffer ObjectLights : register(b7)
+{
+    uint ObjectLightNum;
+    uint3 ObjectLightPadding;
+    // Four indices into the light list to an element.
+    uint4 ObjectLightIndices[MaxObjectLightNum / 4u];
+}
+
+uint GetClusterIndex(const uint3 InCluster)
+{
+    return InCluster.x + ClusterCountX * (InCluster.y + ClusterCountY * InCluster.z);
+}
+
+// Of the cluster the pixel falls into, picked the way ClusteredLighting::BoundClusters bounds lights and decals.
+uint FindClusterIndex(const float2 InPixelPosition, const float3 InWorldPosition)
+{
+    const float ViewDepth = mul(float4(InWorldPosition, 1.0f), ClusterView).z;
+    const uint2 Tile = min(uint2(InPixelPosition / TileSize), uint2(ClusterCountX, ClusterCountY) - 1u);
+    const uint Slice = (uint) clamp(log(max(ViewDepth, NearZ)) * DepthSliceScale + DepthSliceBias, 0.0f, ClusterCountZ - 1.0f);
+    return GetClusterIndex(uint3(Tile, Slice));
+}
@@ -1,3 +1,5 @@
+#include "FrameConstants.hlsli"
+
 cbuffer CBuf
 {
     matrix transform;
@@ -5,5 +7,5 @@ cbuffer CBuf
 
 float4 main(float3 pos : Position) : SV_Position
 {
-    return mul(float4(pos, 1.0f), transform);
+    return mul(mul(float4(pos, 1.0f), transform), ViewProjection);
 }
\ No newline at end of file
@@ -0,0 +1,549 @@
+﻿#include "CommandRecorder.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include "BindManager.h"
+#include "DrawPacket.h"
+#include "FrameProfiler.h"
+#include "Graphics.h"
+#include "InputLayout.h"
+#include "PixelShader.h"
+#include "VertexShader.h"
+
+namespace
+{
+	// FNV-1a, only used to store identical contents once.
+	uint64_t HashBytes(const std::byte* InData, const size_t InSize) noexcept
+	{
+		uint64_t Hash {14695981039346656037ull};
+
+		for (size_t Index = 0; Index < InSize; ++Index)
+		{
+			Hash ^= static_cast<uint64_t>(InData[Index]);
+			Hash *= 1099511628211ull;
+		}
+
+		return Hash;
+	}
+
+	template<typename T>
+	void Append(std::vector<std::byte>& InOutBytes, const T& InValue)
+	{
+		const auto* const Bytes = reinterpret_cast<const std::byte*>(&InValue);
+		InOutBytes.insert(InOutBytes.end(), Bytes, Bytes + sizeof(T));
+	}
+
+	void AppendPadded(std::vector<std::byte>& InOutBytes, const void* InData, const size_t InSize)
+	{
+		const auto* const Bytes = static_cast<const std::byte*>(InData);
+		InOutBytes.insert(InOutBytes.end(), Bytes, Bytes + InSize);
+		InOutBytes.resize((InOutBytes.size() + 3u) & ~size_t {3u});
+	}
+
+	template<typename T>
+	std::vector<std::byte> ToBytes(const T& InDescription)
+	{
+		std::vector<std::byte> Bytes;
+		Append(Bytes, InDescription);
+		return Bytes;
+	}
+
+	template<typename T, typename DescriptionType>
+	bool Describe(IUnknown* InObject, DescriptionType& OutDescription)
+	{
+		Microsoft::WRL::ComPtr<T> Interface;
+
+		if (FAILED(InObject->QueryInterface(IID_PPV_ARGS(&Interface))))
+		{
+			return false;
+		}
+
+		Interface->GetDesc(&OutDescription);
+		return true;
+	}
+
+	// Block compressed formats store four rows of pixels per row of blocks.
+	UINT GetRowNum(const DXGI_FORMAT InFormat, const UINT InHeight) noexcept
+	{
+		const bool bIsBlockCompressed = (InFormat >= DXGI_FORMAT_BC1_TYPELESS && InFormat <= DXGI_FORMAT_BC5_SNORM) ||
+		                                (InFormat >= DXGI_FORMAT_BC6H_TYPELESS && InFormat <= DXGI_FORMAT_BC7_UNORM_SRGB);
+		return bIsBlockCompressed ? (InHeight + 3u) / 4u : InHeight;
+	}
+}
+
+void CommandRecorder::Start(std::string InFileName, const unsigned int InFrameNum)
+{
+	if (bIsRecording || InFrameNum == 0u)
+	{
+		return;
+	}
+
+	FileName = std::move(InFileName);
+	RequestedFrameNum = InFrameNum;
+}
+
+bool CommandRecorder::BeginFrame(const Graphics& InGraphics)
+{
+	if (bIsRecording || RequestedFrameNum == 0u)
+	{
+		return false;
+	}
+
+	bIsRecording = true;
+	FramesLeft = std::exchange(RequestedFrameNum, 0u);
+	RecordedFrameNum = 0u;
+
+	InGraphics.GetImmediateContext().GetStateCache().SetRecorder(this);
+
+	for (const auto& Context : InGraphics.GetDeferredContexts())
+	{
+		Context->GetStateCache().SetRecorder(this);
+	}
+
+	return true;
+}
+
+void CommandRecorder::EndFrame(const Graphics& InGraphics)
+{
+	if (!bIsRecording)
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("CommandRecorder::EndFrame");
+
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	auto* const Context = ImmediateContext.GetDeviceContext();
+	const auto FrameWords = ImmediateContext.GetStateCache().TakeRecorded();
+
+	// The recording threads are done with the frame, so nothing registers meanwhile.
+	std::scoped_lock Lock {ObjectMutex};
+	const auto FrameNewIds = std::exchange(NewIds, {});
+	// IDs are handed out in order, the frame's new objects are the last ones.
+	const auto FirstNewId = static_cast<uint32_t>(Objects.size() - FrameNewIds.size()) + 1u;
+
+	// Dynamic buffers seen before are written again each frame, only where the frame left different contents is that traced.
+	for (uint32_t Id = 1u; Id < FirstNewId; ++Id)
+	{
+		auto& Dynamic = Objects[Id - 1u];
+
+		if (!Dynamic.bIsDynamic)
+		{
+			continue;
+		}
+
+		if (const auto Blob = ReadBack(Context, Dynamic); Blob != CommandTrace::NoBlob && Blobs[Blob].Hash != Dynamic.Hash)
+		{
+			Dynamic.Hash = Blobs[Blob].Hash;
+			Commands.push_back(CommandTrace::MakeCommand(CommandTrace::Op::Upload, 2u));
+			Commands.push_back(Id);
+			Commands.push_back(Blob);
+		}
+	}
+
+	for (const auto Id : FrameNewIds)
+	{
+		auto& New = Objects[Id - 1u];
+
+		if (New.Kind == CommandTrace::ObjectKind::Buffer || New.Kind == CommandTrace::ObjectKind::Texture2D)
+		{
+			New.Blob = ReadBack(Context, New);
+			New.Hash = New.Blob != CommandTrace::NoBlob ? Blobs[New.Blob].Hash : 0u;
+		}
+	}
+
+	DescribeShaders(FrameNewIds);
+
+	Commands.insert(Commands.end(), FrameWords.begin(), FrameWords.end());
+	Commands.push_back(CommandTrace::MakeCommand(CommandTrace::Op::EndFrame, 0u));
+	++RecordedFrameNum;
+
+	if (--FramesLeft == 0u)
+	{
+		Finish(InGraphics);
+	}
+}
+
+uint32_t CommandRecorder::GetId(IUnknown* InObject)
+{
+	std::scoped_lock Lock {ObjectMutex};
+	return Register(InObject);
+}
+
+void CommandRecorder::AddCommandList(ID3D11CommandList* InCommandList, std::vector<uint32_t> InWords)
+{
+	std::scoped_lock Lock {CommandListMutex};
+	CommandLists[InCommandList] = std::move(InWords);
+}
+
+std::vector<uint32_t> CommandRecorder::TakeCommandList(ID3D11CommandList* InCommandList)
+{
+	std::scoped_lock Lock {CommandListMutex};
+
+	const auto Found = CommandLists.find(InCommandList);
+	if (Found == CommandLists.end())
+	{
+		return {};
+	}
+
+	auto Words = std::move(Found->second);
+	CommandLists.erase(Found);
+	return Words;
+}
+
+CommandRecorder::Statistics CommandRecorder::GetStatistics() const noexcept
+{
+	std::scoped_lock Lock {ObjectMutex};
+	return {FramesLeft, static_cast<unsigned int>(Objects.size()), BlobBytes, Commands.size(), bHasWritten, bHasFailed};
+}
+
+uint32_t CommandRecorder::Register(IUnknown* InObject)
+{
+	if (const auto Found = Ids.find(InObject); Found != Ids.end())
+	{
+		return Found->second;
+	}
+
+	using CommandTrace::ObjectKind;
+	Object New;
+	New.Held = InObject;
+
+	// Views name their resource, which is registered first and so always has the lower ID.
+	const auto DescribeView = [&](auto* InView, const ObjectKind InKind)
+	{
+		Microsoft::WRL::ComPtr<ID3D11Resource> Resource;
+		InView->GetResource(&Resource);
+		New.Parent = Register(Resource.Get());
+		New.Kind = InKind;
+	};
+
+	D3D11_BUFFER_DESC BufferDesc;
+	D3D11_TEXTURE1D_DESC Texture1DDesc;
+	D3D11_TEXTURE2D_DESC Texture2DDesc;
+	D3D11_TEXTURE3D_DESC Texture3DDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC ShaderResourceDesc;
+	D3D11_RENDER_TARGET_VIEW_DESC RenderTargetDesc;
+	D3D11_DEPTH_STENCIL_VIEW_DESC DepthStencilViewDesc;
+	D3D11_SAMPLER_DESC SamplerDesc;
+	D3D11_RASTERIZER_DESC RasterizerDesc;
+	D3D11_BLEND_DESC BlendDesc;
+	D3D11_DEPTH_STENCIL_DESC DepthStencilDesc;
+	Microsoft::WRL::ComPtr<IUnknown> Interface;
+
+	if (Describe<ID3D11Buffer>(InObject, BufferDesc))
+	{
+		New.Kind = ObjectKind::Buffer;
+		New.Description = ToBytes(BufferDesc);
+		New.bIsDynamic = BufferDesc.Usage == D3D11_USAGE_DYNAMIC;
+	}
+	else if (Describe<ID3D11Texture2D>(InObject, Texture2DDesc))
+	{
+		New.Kind = ObjectKind::Texture2D;
+		New.Description = ToBytes(Texture2DDesc);
+	}
+	else if (Describe<ID3D11Texture1D>(InObject, Texture1DDesc))
+	{
+		New.Kind = ObjectKind::Texture1D;
+		New.Description = ToBytes(Texture1DDesc);
+	}
+	else if (Describe<ID3D11Texture3D>(InObject, Texture3DDesc))
+	{
+		New.Kind = ObjectKind::Texture3D;
+		New.Description = ToBytes(Texture3DDesc);
+	}
+	else if (Describe<ID3D11ShaderResourceView>(InObject, ShaderResourceDesc))
+	{
+		DescribeView(static_cast<ID3D11ShaderResourceView*>(InObject), ObjectKind::ShaderResourceView);
+		New.Description = ToBytes(ShaderResourceDesc);
+	}
+	else if (Describe<ID3D11RenderTargetView>(InObject, RenderTargetDesc))
+	{
+		DescribeView(static_cast<ID3D11RenderTargetView*>(InObject), ObjectKind::RenderTargetView);
+		New.Description = ToBytes(RenderTargetDesc);
+	}
+	else if (Describe<ID3D11DepthStencilView>(InObject, DepthStencilViewDesc))
+	{
+		DescribeView(static_cast<ID3D11DepthStencilView*>(InObject), ObjectKind::DepthStencilView);
+		New.Description = ToBytes(DepthStencilViewDesc);
+	}
+	else if (Describe<ID3D11SamplerState>(InObject, SamplerDesc))
+	{
+		New.Kind = ObjectKind::Sampler;
+		New.Description = ToBytes(SamplerDesc);
+	}
+	else if (Describe<ID3D11RasterizerState>(InObject, RasterizerDesc))
+	{
+		New.Kind = ObjectKind::Rasterizer;
+		New.Description = ToBytes(RasterizerDesc);
+	}
+	else if (Describe<ID3D11BlendState>(InObject, BlendDesc))
+	{
+		New.Kind = ObjectKind::Blend;
+		New.Description = ToBytes(BlendDesc);
+	}
+	else if (Describe<ID3D11DepthStencilState>(InObject, DepthStencilDesc))
+	{
+		New.Kind = ObjectKind::DepthStencil;
+		New.Description = ToBytes(DepthStencilDesc);
+	}
+	else if (SUCCEEDED(InObject->QueryInterface(__uuidof(ID3D11VertexShader), &Interface)))
+	{
+		New.Kind = ObjectKind::VertexShader;
+	}
+	else if (SUCCEEDED(InObject->QueryInterface(__uuidof(ID3D11PixelShader), &Interface)))
+	{
+		New.Kind = ObjectKind::PixelShader;
+	}
+	else if (SUCCEEDED(InObject->QueryInterface(__uuidof(ID3D11HullShader), &Interface)))
+	{
+		New.Kind = ObjectKind::HullShader;
+	}
+	else if (SUCCEEDED(InObject->QueryInterface(__uuidof(ID3D11DomainShader), &Interface)))
+	{
+		New.Kind = ObjectKind::DomainShader;
+	}
+	else
+	{
+		// The state caches bind nothing else.
+		New.Kind = ObjectKind::InputLayout;
+	}
+
+	Objects.push_back(std::move(New));
+	const auto Id = static_cast<uint32_t>(Objects.size());
+	Ids.emplace(InObject, Id);
+	NewIds.push_back(Id);
+	return Id;
+}
+
+uint32_t CommandRecorder::ReadBack(ID3D11DeviceContext* InContext, const Object& InObject)
+{
+	Microsoft::WRL::ComPtr<ID3D11Device> Device;
+	InContext->GetDevice(&Device);
+
+	std::vector<std::byte> Bytes;
+	D3D11_MAPPED_SUBRESOURCE Mapped;
+
+	if (InObject.Kind == CommandTrace::ObjectKind::Buffer)
+	{
+		D3D11_BUFFER_DESC StagingDesc;
+		std::memcpy(&StagingDesc, InObject.Description.data(), sizeof(StagingDesc));
+		StagingDesc.Usage = D3D11_USAGE_STAGING;
+		StagingDesc.BindFlags = 0u;
+		StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		StagingDesc.MiscFlags = 0u;
+		StagingDesc.StructureByteStride = 0u;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Staging;
+		if (FAILED(Device->CreateBuffer(&StagingDesc, nullptr, &Staging)))
+		{
+			return CommandTrace::NoBlob;
+		}
+
+		InContext->CopyResource(Staging.Get(), static_cast<ID3D11Buffer*>(InObject.Held.Get()));
+
+		// Waits for the GPU, recording stalls anyway.
+		if (FAILED(InContext->Map(Staging.Get(), 0u, D3D11_MAP_READ, 0u, &Mapped)))
+		{
+			return CommandTrace::NoBlob;
+		}
+
+		const auto* const Data = static_cast<const std::byte*>(Mapped.pData);
+		Bytes.assign(Data, Data + StagingDesc.ByteWidth);
+		InContext->Unmap(Staging.Get(), 0u);
+		return AddBlob(std::move(Bytes));
+	}
+
+	D3D11_TEXTURE2D_DESC StagingDesc;
+	std::memcpy(&StagingDesc, InObject.Description.data(), sizeof(StagingDesc));
+
+	// Targets are drawn anew every frame and multisampled textures can't be copied to the CPU, both replay empty.
+	if ((StagingDesc.BindFlags & (D3D11_BIND_RENDER_TARGET | D3D11_BIND_DEPTH_STENCIL)) != 0u || StagingDesc.SampleDesc.Count > 1u)
+	{
+		return CommandTrace::NoBlob;
+	}
+
+	StagingDesc.Usage = D3D11_USAGE_STAGING;
+	StagingDesc.BindFlags = 0u;
+	StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	StagingDesc.MiscFlags = 0u;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Staging;
+	if (FAILED(Device->CreateTexture2D(&StagingDesc, nullptr, &Staging)))
+	{
+		return CommandTrace::NoBlob;
+	}
+
+	InContext->CopyResource(Staging.Get(), static_cast<ID3D11Texture2D*>(InObject.Held.Get()));
+
+	for (UINT Slice = 0u; Slice < StagingDesc.ArraySize; ++Slice)
+	{
+		for (UINT Mip = 0u; Mip < StagingDesc.MipLevels; ++Mip)
+		{
+			const auto Subresource = D3D11CalcSubresource(Mip, Slice, StagingDesc.MipLevels);
+
+			if (FAILED(InContext->Map(Staging.Get(), Subresource, D3D11_MAP_READ, 0u, &Mapped)))
+			{
+				return CommandTrace::NoBlob;
+			}
+
+			const auto Height = std::max(StagingDesc.Height >> Mip, 1u);
+			const CommandTrace::SubresourceRecord Record {Mapped.RowPitch, Mapped.DepthPitch, Mapped.RowPitch * GetRowNum(StagingDesc.Format, Height)};
+			Append(Bytes, Record);
+			AppendPadded(Bytes, Mapped.pData, Record.Size);
+			InContext->Unmap(Staging.Get(), Subresource);
+		}
+	}
+
+	return AddBlob(std::move(Bytes));
+}
+
+void CommandRecorder::DescribeShaders(const std::vector<uint32_t>& InNewIds)
+{
+	using CommandTrace::ObjectKind;
+
+	const auto IsShader = [this](const uint32_t InId)
+	{
+		const auto Kind = Objects[InId - 1u].Kind;
+		return Kind == ObjectKind::VertexShader || Kind == ObjectKind::PixelShader || Kind == ObjectKind::InputLayout;
+	};
+
+	if (std::none_of(InNewIds.begin(), InNewIds.end(), IsShader))
+	{
+		return;
+	}
+
+	// The bindables hand their raw objects out through Bake, the same way draw packets get them.
+	std::unordered_map<const void*, std::vector<std::byte>> Known;
+
+	for (const auto& Shader : BindManager::GetAll<VertexShader>())
+	{
+		DrawPacket Packet;
+		Shader->Bake(Packet);
+		const auto* const ByteCode = Shader->GetByteCode();
+		const auto* const Data = static_cast<const std::byte*>(ByteCode->GetBufferPointer());
+		Known[Packet.VertexShader].assign(Data, Data + ByteCode->GetBufferSize());
+	}
+
+	for (const auto& Shader : BindManager::GetAll<PixelShader>())
+	{
+		DrawPacket Packet;
+		Shader->Bake(Packet);
+		const auto* const ByteCode = Shader->GetByteCode();
+		const auto* const Data = static_cast<const std::byte*>(ByteCode->GetBufferPointer());
+		Known[Packet.PixelShader].assign(Data, Data + ByteCode->GetBufferSize());
+	}
+
+	for (const auto& Layout : BindManager::GetAll<InputLayout>())
+	{
+		DrawPacket Packet;
+		Layout->Bake(Packet);
+		const auto Elements = Layout->GetElements() == InputLayout::Elements::PositionOnly ? Layout->GetLayout().GetPositionD3D11Layout()
+		                                                                                 : Layout->GetLayout().GetD3D11Layout();
+		auto& Bytes = Known[Packet.InputLayout];
+
+		for (const auto& Element : Elements)
+		{
+			const auto NameLength = static_cast<uint32_t>(std::strlen(Element.SemanticName));
+			Append(Bytes, CommandTrace::ElementRecord {NameLength, Element.SemanticIndex, static_cast<uint32_t>(Element.Format), Element.InputSlot,
+			                                           Element.AlignedByteOffset, static_cast<uint32_t>(Element.InputSlotClass), Element.InstanceDataStepRate});
+			AppendPadded(Bytes, Element.SemanticName, NameLength);
+		}
+	}
+
+	for (const auto Id : InNewIds)
+	{
+		if (!IsShader(Id))
+		{
+			continue;
+		}
+
+		auto& New = Objects[Id - 1u];
+
+		if (const auto Found = Known.find(New.Held.Get()); Found != Known.end())
+		{
+			New.Blob = AddBlob(Found->second);
+		}
+	}
+}
+
+uint32_t CommandRecorder::AddBlob(std::vector<std::byte> InBytes)
+{
+	const auto Hash = HashBytes(InBytes.data(), InBytes.size());
+
+	if (const auto Found = BlobIndices.find(Hash); Found != BlobIndices.end())
+	{
+		return Found->second;
+	}
+
+	const auto Index = static_cast<uint32_t>(Blobs.size());
+	BlobBytes += InBytes.size();
+	Blobs.push_back({Hash, std::move(InBytes)});
+	BlobIndices.emplace(Hash, Index);
+	return Index;
+}
+
+bool CommandRecorder::Write() const
+{
+	std::ofstream File(FileName, std::ios::binary);
+
+	if (!File)
+	{
+		return false;
+	}
+
+	const auto WriteValue = [&File](const auto& InValue)
+	{
+		File.write(reinterpret_cast<const char*>(&InValue), sizeof(InValue));
+	};
+
+	constexpr char Padding[4] {};
+	const auto WritePadded = [&File, &Padding](const std::vector<std::byte>& InBytes)
+	{
+		File.write(reinterpret_cast<const char*>(InBytes.data()), static_cast<std::streamsize>(InBytes.size()));
+		File.write(Padding, static_cast<std::streamsize>((4u - InBytes.size() % 4u) % 4u));
+	};
+
+	WriteValue(CommandTrace::Header {CommandTrace::Magic, CommandTrace::Version, RecordedFrameNum, static_cast<uint32_t>(Objects.size()),
+	                                 static_cast<uint32_t>(Blobs.size()), static_cast<uint32_t>(Commands.size())});
+
+	for (const auto& Written : Objects)
+	{
+		WriteValue(CommandTrace::ObjectRecord {Written.Kind, Written.Parent, Written.Blob, static_cast<uint32_t>(Written.Description.size())});
+		WritePadded(Written.Description);
+	}
+
+	for (const auto& Written : Blobs)
+	{
+		WriteValue(CommandTrace::BlobRecord {Written.Hash, static_cast<uint32_t>(Written.Bytes.size()), 0u});
+		WritePadded(Written.Bytes);
+	}
+
+	File.write(reinterpret_cast<const char*>(Commands.data()), static_cast<std::streamsize>(Commands.size() * sizeof(uint32_t)));
+	return static_cast<bool>(File);
+}
+
+void CommandRecorder::Finish(const Graphics& InGraphics)
+{
+	InGraphics.GetImmediateContext().GetStateCache().SetRecorder(nullptr);
+
+	for (const auto& Context : InGraphics.GetDeferredContexts())
+	{
+		Context->GetStateCache().SetRecorder(nullptr);
+	}
+
+	bHasFailed = !Write();
+	bHasWritten = true;
+	bIsRecording = false;
+
+	Ids.clear();
+	Objects.clear();
+	NewIds.clear();
+	Blobs.clear();
+	BlobIndices.clear();
+	BlobBytes = 0u;
+	Commands.clear();
+
+	std::scoped_lock Lock {CommandListMutex};
+	CommandLists.clear();
+}
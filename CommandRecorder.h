@@ -0,0 +1,122 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <cstddef>
+#include <cstdint>
+#include <d3d11.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "wrl/client.h"
+#include "CommandTrace.h"
+
+class Graphics;
+
+/**
+ * Records what the state caches issue and the render contexts draw for a number of frames into a CommandTrace, so a slow
+ * frame can be taken away from the scene and the application that drew it and timed again by CommandReplay.
+ * Every object the calls name is described once from its own GetDesc. Buffers and textures the GPU doesn't render to are
+ * read back at the end of the frame they first appear in, and dynamic buffers again after every later frame, so their
+ * contents travel in the trace too, written once per distinct hash. Shaders and input layouts carry no description, theirs
+ * are taken from the bindables BindManager holds, the few created elsewhere are traced without.
+ * Only what goes through the state cache is seen: clears, copies, viewports, compute work and what ImGui binds itself are not.
+ * Readbacks stall, recording costs the frames it spans.
+ */
+class CommandRecorder
+{
+public:
+	struct Statistics
+	{
+		unsigned int FramesLeft {0u};
+		unsigned int ObjectNum {0u};
+		size_t BlobBytes {0u};
+		size_t CommandWordNum {0u};
+		// Of the last trace, false while the first one is still recording.
+		bool bHasWritten {false};
+		bool bHasFailed {false};
+	};
+
+	CommandRecorder() = default;
+	CommandRecorder(const CommandRecorder&) = delete;
+	CommandRecorder(CommandRecorder&&) = delete;
+	CommandRecorder& operator=(const CommandRecorder&) = delete;
+	CommandRecorder& operator=(CommandRecorder&&) = delete;
+	~CommandRecorder() = default;
+
+	// From the next frame on, written to InFileName after the last one. Ignored while a trace is recording.
+	void Start(std::string InFileName, unsigned int InFrameNum);
+
+	// Attaches to every context of InGraphics on the frame a requested trace starts and returns true then. The immediate
+	// context has to be cleared after, so nothing the trace replays depends on bindings made before it.
+	bool BeginFrame(const Graphics& InGraphics);
+	// After the frame's last draw and before bindables are trimmed. Writes the trace after its last frame.
+	void EndFrame(const Graphics& InGraphics);
+
+	[[nodiscard]] bool IsRecording() const noexcept
+	{
+		return bIsRecording;
+	}
+
+	// From the state caches on whichever thread records, the objects not seen yet are described on the way.
+	[[nodiscard]] uint32_t GetId(IUnknown* InObject);
+
+	// A deferred context's words until the command list is executed, when the immediate context takes them.
+	void AddCommandList(ID3D11CommandList* InCommandList, std::vector<uint32_t> InWords);
+	[[nodiscard]] std::vector<uint32_t> TakeCommandList(ID3D11CommandList* InCommandList);
+
+	[[nodiscard]] Statistics GetStatistics() const noexcept;
+
+private:
+	struct Object
+	{
+		// Held until the trace is written, so no later object can take the address and with it the ID.
+		Microsoft::WRL::ComPtr<IUnknown> Held;
+		CommandTrace::ObjectKind Kind;
+		uint32_t Parent {CommandTrace::NullId};
+		uint32_t Blob {CommandTrace::NoBlob};
+		std::vector<std::byte> Description;
+		// What the contents hashed to when last read back, dynamic buffers are uploaded again when it changes.
+		uint64_t Hash {0u};
+		bool bIsDynamic {false};
+	};
+
+	struct Blob
+	{
+		uint64_t Hash;
+		std::vector<std::byte> Bytes;
+	};
+
+	// With the object mutex held.
+	uint32_t Register(IUnknown* InObject);
+	// Contents of a buffer or texture the GPU doesn't render to, NoBlob for the others.
+	[[nodiscard]] uint32_t ReadBack(ID3D11DeviceContext* InContext, const Object& InObject);
+	// The bytecode and elements of this frame's new shaders and input layouts, from BindManager.
+	void DescribeShaders(const std::vector<uint32_t>& InNewIds);
+	uint32_t AddBlob(std::vector<std::byte> InBytes);
+	[[nodiscard]] bool Write() const;
+	void Finish(const Graphics& InGraphics);
+
+private:
+	std::string FileName;
+	unsigned int RequestedFrameNum {0u};
+	unsigned int RecordedFrameNum {0u};
+	unsigned int FramesLeft {0u};
+	bool bIsRecording {false};
+	bool bHasWritten {false};
+	bool bHasFailed {false};
+
+	mutable std::mutex ObjectMutex;
+	std::unordered_map<IUnknown*, uint32_t> Ids;
+	// Trace ID minus one.
+	std::vector<Object> Objects;
+	// Since the last EndFrame, not read back or resolved yet.
+	std::vector<uint32_t> NewIds;
+
+	std::mutex CommandListMutex;
+	std::unordered_map<ID3D11CommandList*, std::vector<uint32_t>> CommandLists;
+
+	std::vector<Blob> Blobs;
+	std::unordered_map<uint64_t, uint32_t> BlobIndices;
+	size_t BlobBytes {0u};
+	std::vector<uint32_t> Commands;
+};
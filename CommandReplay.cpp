@@ -0,0 +1,805 @@
+﻿#include "CommandReplay.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <d3dcompiler.h>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include "ExceptionMacros.h"
+#include "Graphics.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const char* GetDrawName(const CommandTrace::Op InOp) noexcept
+	{
+		switch (InOp)
+		{
+			case CommandTrace::Op::Draw:
+				return "Draw";
+			case CommandTrace::Op::DrawIndexed:
+				return "DrawIndexed";
+			case CommandTrace::Op::DrawIndexedInstanced:
+				return "DrawIndexedInstanced";
+			case CommandTrace::Op::DrawIndexedInstancedIndirect:
+				return "DrawIndexedInstancedIndirect";
+			case CommandTrace::Op::DrawInstancedIndirect:
+				return "DrawInstancedIndirect";
+			default:
+				return "";
+		}
+	}
+
+	constexpr size_t GetPaddedSize(const size_t InSize) noexcept
+	{
+		return (InSize + 3u) & ~size_t {3u};
+	}
+
+	Microsoft::WRL::ComPtr<ID3DBlob> CompileStandIn(const char* InSource, const char* InProfile)
+	{
+		HRESULT ResultHandle;
+		Microsoft::WRL::ComPtr<ID3DBlob> ByteCode;
+		Microsoft::WRL::ComPtr<ID3DBlob> Errors;
+
+		CHECK_HRESULT_EXCEPTION(D3DCompile(InSource, std::strlen(InSource), "StandIn", nullptr, nullptr, "main", InProfile, 0u, 0u, &ByteCode, &Errors))
+		return ByteCode;
+	}
+}
+
+CommandReplay::CommandReplay(const Graphics& InGraphics, const std::string& InFileName, const unsigned int InPassNum)
+	: FileName(InFileName)
+	, Context(InGraphics.GetImmediateContext().GetDeviceContext())
+	, PassNum(std::max(InPassNum, 1u))
+{
+	HRESULT ResultHandle;
+
+	Context->GetDevice(&Device);
+	Context.As(&Context1);
+
+	std::ifstream File(InFileName, std::ios::binary | std::ios::ate);
+	if (!File)
+	{
+		throw std::runtime_error("Can't open the trace " + InFileName);
+	}
+
+	Data.resize(static_cast<size_t>(File.tellg()));
+	File.seekg(0);
+
+	if (!File.read(reinterpret_cast<char*>(Data.data()), static_cast<std::streamsize>(Data.size())))
+	{
+		throw std::runtime_error("Can't read the trace " + InFileName);
+	}
+
+	Parse();
+	CreateStandIns();
+	CreateObjects();
+
+	size_t MaxDrawNum = 0u;
+	for (const auto& Replayed : Frames)
+	{
+		MaxDrawNum = std::max(MaxDrawNum, Replayed.Draws.size());
+	}
+
+	D3D11_QUERY_DESC QueryDesc {D3D11_QUERY_TIMESTAMP_DISJOINT, 0u};
+	CHECK_HRESULT_EXCEPTION(Device->CreateQuery(&QueryDesc, &DisjointQuery))
+
+	QueryDesc.Query = D3D11_QUERY_TIMESTAMP;
+	TimestampQueries.resize(MaxDrawNum + 1u);
+
+	for (auto& Query : TimestampQueries)
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateQuery(&QueryDesc, &Query))
+	}
+}
+
+void CommandReplay::Parse()
+{
+	size_t Cursor = 0u;
+
+	const auto Read = [this, &Cursor](const size_t InSize)
+	{
+		if (Data.size() - Cursor < InSize)
+		{
+			throw std::runtime_error("The trace " + FileName + " ends early");
+		}
+
+		const auto* const Bytes = Data.data() + Cursor;
+		Cursor += GetPaddedSize(InSize);
+		return Bytes;
+	};
+
+	CommandTrace::Header Header;
+	std::memcpy(&Header, Read(sizeof(Header)), sizeof(Header));
+
+	if (Header.Magic != CommandTrace::Magic || Header.Version != CommandTrace::Version)
+	{
+		throw std::runtime_error(FileName + " is not a command trace of this version");
+	}
+
+	for (uint32_t Index = 0u; Index < Header.ObjectNum; ++Index)
+	{
+		auto& Record = Records.emplace_back();
+		std::memcpy(&Record, Read(sizeof(Record)), sizeof(Record));
+		Descriptions.push_back(Read(Record.DescSize));
+	}
+
+	for (uint32_t Index = 0u; Index < Header.BlobNum; ++Index)
+	{
+		CommandTrace::BlobRecord Record;
+		std::memcpy(&Record, Read(sizeof(Record)), sizeof(Record));
+		Blobs.push_back({Read(Record.Size), Record.Size});
+	}
+
+	CommandWordNum = Header.CommandWordNum;
+	Commands = reinterpret_cast<const uint32_t*>(Read(CommandWordNum * sizeof(uint32_t)));
+
+	// Split into frames up front, with a timing slot for each draw.
+	Frame Current {0u, 0u, {}};
+
+	for (size_t Word = 0u; Word < CommandWordNum; Word += 1u + CommandTrace::GetOperandNum(Commands[Word]))
+	{
+		const auto Op = CommandTrace::GetOp(Commands[Word]);
+		const auto* const Operands = Commands + Word + 1u;
+
+		if (Word + CommandTrace::GetOperandNum(Commands[Word]) >= CommandWordNum)
+		{
+			throw std::runtime_error("The trace " + FileName + " ends inside a command");
+		}
+
+		if (Op == CommandTrace::Op::Draw || Op == CommandTrace::Op::DrawIndexed)
+		{
+			Current.Draws.push_back({Op, Operands[0]});
+		}
+		else if (Op == CommandTrace::Op::DrawIndexedInstanced)
+		{
+			Current.Draws.push_back({Op, Operands[0], Operands[1]});
+		}
+		else if (CommandTrace::IsDraw(Op))
+		{
+			Current.Draws.push_back({Op, 0u, 0u});
+		}
+		else if (Op == CommandTrace::Op::EndFrame)
+		{
+			Current.EndWord = Word + 1u;
+			Frames.push_back(std::move(Current));
+			Current = {Word + 1u, 0u, {}};
+		}
+	}
+
+	if (Frames.empty())
+	{
+		throw std::runtime_error("The trace " + FileName + " has no frames");
+	}
+}
+
+void CommandReplay::CreateStandIns()
+{
+	HRESULT ResultHandle;
+
+	const auto VertexByteCode = CompileStandIn("float4 main() : SV_Position { return float4(0.0f, 0.0f, 0.0f, 1.0f); }", "vs_5_0");
+	CHECK_HRESULT_EXCEPTION(Device->CreateVertexShader(VertexByteCode->GetBufferPointer(), VertexByteCode->GetBufferSize(), nullptr, &StandInVertexShader))
+
+	const auto PixelByteCode = CompileStandIn("float4 main() : SV_Target { return 0.0f; }", "ps_5_0");
+	CHECK_HRESULT_EXCEPTION(Device->CreatePixelShader(PixelByteCode->GetBufferPointer(), PixelByteCode->GetBufferSize(), nullptr, &StandInPixelShader))
+}
+
+void CommandReplay::CreateObjects()
+{
+	Objects.resize(Records.size());
+	TargetViewports.resize(Records.size());
+
+	// Parents always come first, so a view finds its resource already created.
+	for (size_t Index = 0u; Index < Records.size(); ++Index)
+	{
+		Objects[Index] = CreateObject(Records[Index], Descriptions[Index]);
+
+		if (!Objects[Index])
+		{
+			++MissingNum;
+		}
+	}
+}
+
+Microsoft::WRL::ComPtr<ID3D11DeviceChild> CommandReplay::CreateObject(const CommandTrace::ObjectRecord& InRecord, const std::byte* InDescription)
+{
+	using CommandTrace::ObjectKind;
+
+	const auto* const Contents = InRecord.Blob < Blobs.size() ? &Blobs[InRecord.Blob] : nullptr;
+
+	const auto Describe = [&]<typename T>(T& OutDesc)
+	{
+		if (InRecord.DescSize < sizeof(T))
+		{
+			return false;
+		}
+
+		std::memcpy(&OutDesc, InDescription, sizeof(T));
+		return true;
+	};
+
+	// Shared and GDI surfaces, such as the swap chain's, are plain textures here. Immutable ones need contents.
+	const auto MakeCreatable = [](auto& InOutDesc, const bool bInHasContents)
+	{
+		InOutDesc.MiscFlags &= ~static_cast<UINT>(D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX | D3D11_RESOURCE_MISC_GDI_COMPATIBLE |
+		                                          D3D11_RESOURCE_MISC_SHARED_NTHANDLE);
+
+		if (InOutDesc.Usage == D3D11_USAGE_IMMUTABLE && !bInHasContents)
+		{
+			InOutDesc.Usage = D3D11_USAGE_DEFAULT;
+		}
+	};
+
+	// The viewport a target binding sets, the whole mip the view starts at.
+	const auto SetTargetViewport = [&](const uint32_t InMip)
+	{
+		D3D11_TEXTURE2D_DESC ParentDesc;
+		auto* const Parent = Get<ID3D11Texture2D>(InRecord.Parent);
+
+		if (Parent && Records[InRecord.Parent - 1u].Kind == ObjectKind::Texture2D)
+		{
+			Parent->GetDesc(&ParentDesc);
+			TargetViewports[&InRecord - Records.data()] = {0.0f, 0.0f, static_cast<float>(std::max(ParentDesc.Width >> InMip, 1u)),
+			                                               static_cast<float>(std::max(ParentDesc.Height >> InMip, 1u)), 0.0f, 1.0f};
+		}
+	};
+
+	auto* const Resource = Get<ID3D11Resource>(InRecord.Parent);
+
+	switch (InRecord.Kind)
+	{
+		case ObjectKind::Buffer:
+		{
+			D3D11_BUFFER_DESC Desc;
+			if (!Describe(Desc))
+			{
+				return nullptr;
+			}
+
+			const bool bHasContents = Contents && Contents->Size == Desc.ByteWidth;
+			MakeCreatable(Desc, bHasContents);
+
+			const D3D11_SUBRESOURCE_DATA Initial {bHasContents ? Contents->Data : nullptr, 0u, 0u};
+			Microsoft::WRL::ComPtr<ID3D11Buffer> Created;
+
+			if (FAILED(Device->CreateBuffer(&Desc, bHasContents ? &Initial : nullptr, &Created)))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::Texture2D:
+		{
+			D3D11_TEXTURE2D_DESC Desc;
+			if (!Describe(Desc))
+			{
+				return nullptr;
+			}
+
+			std::vector<D3D11_SUBRESOURCE_DATA> Initial;
+
+			// Every subresource or none.
+			for (size_t Offset = 0u; Contents && Offset + sizeof(CommandTrace::SubresourceRecord) <= Contents->Size;)
+			{
+				CommandTrace::SubresourceRecord Subresource;
+				std::memcpy(&Subresource, Contents->Data + Offset, sizeof(Subresource));
+				Offset += sizeof(Subresource);
+				Initial.push_back({Contents->Data + Offset, Subresource.RowPitch, Subresource.DepthPitch});
+				Offset += GetPaddedSize(Subresource.Size);
+			}
+
+			const bool bHasContents = Initial.size() == static_cast<size_t>(Desc.MipLevels) * Desc.ArraySize;
+			MakeCreatable(Desc, bHasContents);
+
+			Microsoft::WRL::ComPtr<ID3D11Texture2D> Created;
+
+			if (FAILED(Device->CreateTexture2D(&Desc, bHasContents ? Initial.data() : nullptr, &Created)))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::Texture1D:
+		{
+			D3D11_TEXTURE1D_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11Texture1D> Created;
+
+			if (!Describe(Desc) || (MakeCreatable(Desc, false), FAILED(Device->CreateTexture1D(&Desc, nullptr, &Created))))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::Texture3D:
+		{
+			D3D11_TEXTURE3D_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11Texture3D> Created;
+
+			if (!Describe(Desc) || (MakeCreatable(Desc, false), FAILED(Device->CreateTexture3D(&Desc, nullptr, &Created))))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::ShaderResourceView:
+		{
+			D3D11_SHADER_RESOURCE_VIEW_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Created;
+
+			if (!Resource || !Describe(Desc) || FAILED(Device->CreateShaderResourceView(Resource, &Desc, &Created)))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::RenderTargetView:
+		{
+			D3D11_RENDER_TARGET_VIEW_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11RenderTargetView> Created;
+
+			if (!Resource || !Describe(Desc) || FAILED(Device->CreateRenderTargetView(Resource, &Desc, &Created)))
+			{
+				return nullptr;
+			}
+
+			SetTargetViewport(Desc.ViewDimension == D3D11_RTV_DIMENSION_TEXTURE2D ? Desc.Texture2D.MipSlice
+			                  : Desc.ViewDimension == D3D11_RTV_DIMENSION_TEXTURE2DARRAY ? Desc.Texture2DArray.MipSlice : 0u);
+			return Created;
+		}
+		case ObjectKind::DepthStencilView:
+		{
+			D3D11_DEPTH_STENCIL_VIEW_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11DepthStencilView> Created;
+
+			if (!Resource || !Describe(Desc) || FAILED(Device->CreateDepthStencilView(Resource, &Desc, &Created)))
+			{
+				return nullptr;
+			}
+
+			SetTargetViewport(Desc.ViewDimension == D3D11_DSV_DIMENSION_TEXTURE2D ? Desc.Texture2D.MipSlice
+			                  : Desc.ViewDimension == D3D11_DSV_DIMENSION_TEXTURE2DARRAY ? Desc.Texture2DArray.MipSlice : 0u);
+			return Created;
+		}
+		case ObjectKind::VertexShader:
+		{
+			Microsoft::WRL::ComPtr<ID3D11VertexShader> Created;
+
+			if (!Contents || FAILED(Device->CreateVertexShader(Contents->Data, Contents->Size, nullptr, &Created)))
+			{
+				return StandInVertexShader;
+			}
+
+			return Created;
+		}
+		case ObjectKind::PixelShader:
+		{
+			Microsoft::WRL::ComPtr<ID3D11PixelShader> Created;
+
+			if (!Contents || FAILED(Device->CreatePixelShader(Contents->Data, Contents->Size, nullptr, &Created)))
+			{
+				return StandInPixelShader;
+			}
+
+			return Created;
+		}
+		case ObjectKind::InputLayout:
+		{
+			std::vector<D3D11_INPUT_ELEMENT_DESC> Elements;
+
+			for (size_t Offset = 0u; Contents && Offset + sizeof(CommandTrace::ElementRecord) <= Contents->Size;)
+			{
+				CommandTrace::ElementRecord Element;
+				std::memcpy(&Element, Contents->Data + Offset, sizeof(Element));
+				Offset += sizeof(Element);
+
+				// The name's padding is zeros, but it may fill the padding exactly and so isn't terminated.
+				const auto* const Name = reinterpret_cast<const char*>(Contents->Data + Offset);
+				Offset += GetPaddedSize(Element.SemanticNameLength + 1u);
+				Elements.push_back({Name, Element.SemanticIndex, static_cast<DXGI_FORMAT>(Element.Format), Element.InputSlot, Element.AlignedByteOffset,
+				                    static_cast<D3D11_INPUT_CLASSIFICATION>(Element.InputSlotClass), Element.InstanceDataStepRate});
+			}
+
+			if (Elements.empty())
+			{
+				return nullptr;
+			}
+
+			// Input layouts are checked against a vertex shader's signature, any traced one whose inputs they fit will do.
+			for (size_t Index = 0u; Index < Records.size(); ++Index)
+			{
+				Microsoft::WRL::ComPtr<ID3D11InputLayout> Created;
+
+				if (Records[Index].Kind == ObjectKind::VertexShader && Records[Index].Blob < Blobs.size() &&
+				    SUCCEEDED(Device->CreateInputLayout(Elements.data(), static_cast<UINT>(Elements.size()), Blobs[Records[Index].Blob].Data,
+				                                        Blobs[Records[Index].Blob].Size, &Created)))
+				{
+					return Created;
+				}
+			}
+
+			return nullptr;
+		}
+		case ObjectKind::Sampler:
+		{
+			D3D11_SAMPLER_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11SamplerState> Created;
+
+			if (!Describe(Desc) || FAILED(Device->CreateSamplerState(&Desc, &Created)))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::Rasterizer:
+		{
+			D3D11_RASTERIZER_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11RasterizerState> Created;
+
+			if (!Describe(Desc) || FAILED(Device->CreateRasterizerState(&Desc, &Created)))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::Blend:
+		{
+			D3D11_BLEND_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11BlendState> Created;
+
+			if (!Describe(Desc) || FAILED(Device->CreateBlendState(&Desc, &Created)))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		case ObjectKind::DepthStencil:
+		{
+			D3D11_DEPTH_STENCIL_DESC Desc;
+			Microsoft::WRL::ComPtr<ID3D11DepthStencilState> Created;
+
+			if (!Describe(Desc) || FAILED(Device->CreateDepthStencilState(&Desc, &Created)))
+			{
+				return nullptr;
+			}
+
+			return Created;
+		}
+		default:
+			// Hull and domain shaders were never traced with their bytecode.
+			return nullptr;
+	}
+}
+
+void CommandReplay::ReplayFrame()
+{
+	HRESULT ResultHandle;
+	auto& Replayed = Frames[FrameIndex];
+
+	// Each frame cleared what it drew to in ways the trace doesn't show, so every target starts it cleared.
+	constexpr float ClearColor[] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+	for (size_t Index = 0u; Index < Records.size(); ++Index)
+	{
+		if (Records[Index].Kind == CommandTrace::ObjectKind::RenderTargetView && Objects[Index])
+		{
+			Context->ClearRenderTargetView(static_cast<ID3D11RenderTargetView*>(Objects[Index].Get()), ClearColor);
+		}
+		else if (Records[Index].Kind == CommandTrace::ObjectKind::DepthStencilView && Objects[Index])
+		{
+			Context->ClearDepthStencilView(static_cast<ID3D11DepthStencilView*>(Objects[Index].Get()), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0u);
+		}
+	}
+
+	auto Word = Replayed.FirstWord;
+
+	// Uploads lead the frame and are left out of its timings.
+	for (; CommandTrace::GetOp(Commands[Word]) == CommandTrace::Op::Upload; Word += 3u)
+	{
+		Execute(CommandTrace::Op::Upload, Commands + Word + 1u, 2u);
+	}
+
+	Context->Begin(DisjointQuery.Get());
+	Context->End(TimestampQueries[0].Get());
+
+	size_t DrawIndex = 0u;
+	auto Mark = Clock::now();
+
+	for (; Word < Replayed.EndWord; Word += 1u + CommandTrace::GetOperandNum(Commands[Word]))
+	{
+		const auto Op = CommandTrace::GetOp(Commands[Word]);
+		const bool bIsDrawn = Execute(Op, Commands + Word + 1u, CommandTrace::GetOperandNum(Commands[Word]));
+
+		if (!CommandTrace::IsDraw(Op))
+		{
+			continue;
+		}
+
+		const auto Now = Clock::now();
+		auto& Timing = Replayed.Draws[DrawIndex];
+		Timing.CpuSeconds += std::chrono::duration<double>(Now - Mark).count();
+		Timing.bIsSkipped = !bIsDrawn;
+
+		Context->End(TimestampQueries[++DrawIndex].Get());
+		Mark = Clock::now();
+	}
+
+	Context->End(DisjointQuery.Get());
+
+	// Waits for the GPU, frames are timed one at a time so their timestamps don't overlap.
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT Disjoint;
+	while ((ResultHandle = Context->GetData(DisjointQuery.Get(), &Disjoint, sizeof(Disjoint), 0u)) == S_FALSE)
+	{
+		std::this_thread::yield();
+	}
+
+	if (SUCCEEDED(ResultHandle) && !Disjoint.Disjoint)
+	{
+		UINT64 Previous = 0u;
+
+		for (size_t Index = 0u; Index <= DrawIndex; ++Index)
+		{
+			UINT64 Timestamp = 0u;
+			if (Context->GetData(TimestampQueries[Index].Get(), &Timestamp, sizeof(Timestamp), 0u) != S_OK)
+			{
+				break;
+			}
+
+			if (Index > 0u)
+			{
+				Replayed.Draws[Index - 1u].GpuSeconds += static_cast<double>(Timestamp - Previous) / static_cast<double>(Disjoint.Frequency);
+			}
+
+			Previous = Timestamp;
+		}
+	}
+
+	if (++FrameIndex == Frames.size())
+	{
+		FrameIndex = 0u;
+		++PassIndex;
+	}
+}
+
+bool CommandReplay::Execute(const CommandTrace::Op InOp, const uint32_t* InOperands, const uint32_t InOperandNum)
+{
+	using CommandTrace::Op;
+
+	switch (InOp)
+	{
+		case Op::Reset:
+			Context->ClearState();
+			bIsPatchListBound = false;
+			bIsHullShaderBound = false;
+			break;
+		case Op::Topology:
+		{
+			const auto Topology = static_cast<D3D11_PRIMITIVE_TOPOLOGY>(InOperands[0]);
+			bIsPatchListBound = Topology >= D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST;
+			Context->IASetPrimitiveTopology(Topology);
+			break;
+		}
+		case Op::InputLayout:
+			Context->IASetInputLayout(Get<ID3D11InputLayout>(InOperands[0]));
+			break;
+		case Op::VertexBuffer:
+		{
+			auto* const Buffer = Get<ID3D11Buffer>(InOperands[1]);
+			Context->IASetVertexBuffers(InOperands[0], 1u, &Buffer, &InOperands[2], &InOperands[3]);
+			break;
+		}
+		case Op::IndexBuffer:
+			Context->IASetIndexBuffer(Get<ID3D11Buffer>(InOperands[0]), static_cast<DXGI_FORMAT>(InOperands[1]), InOperands[2]);
+			break;
+		case Op::VertexShader:
+			Context->VSSetShader(Get<ID3D11VertexShader>(InOperands[0]), nullptr, 0u);
+			break;
+		case Op::PixelShader:
+			Context->PSSetShader(Get<ID3D11PixelShader>(InOperands[0]), nullptr, 0u);
+			break;
+		case Op::HullShader:
+			bIsHullShaderBound = Get<ID3D11HullShader>(InOperands[0]) != nullptr;
+			Context->HSSetShader(Get<ID3D11HullShader>(InOperands[0]), nullptr, 0u);
+			break;
+		case Op::DomainShader:
+			Context->DSSetShader(Get<ID3D11DomainShader>(InOperands[0]), nullptr, 0u);
+			break;
+		case Op::VertexConstantBuffer:
+		case Op::PixelConstantBuffer:
+		{
+			auto* const Buffer = Get<ID3D11Buffer>(InOperands[1]);
+			const bool bIsVertex = InOp == Op::VertexConstantBuffer;
+
+			// A constant count of zero is the whole buffer.
+			if (InOperands[3] != 0u && Context1 && bIsVertex)
+			{
+				Context1->VSSetConstantBuffers1(InOperands[0], 1u, &Buffer, &InOperands[2], &InOperands[3]);
+			}
+			else if (InOperands[3] != 0u && Context1)
+			{
+				Context1->PSSetConstantBuffers1(InOperands[0], 1u, &Buffer, &InOperands[2], &InOperands[3]);
+			}
+			else if (bIsVertex)
+			{
+				Context->VSSetConstantBuffers(InOperands[0], 1u, &Buffer);
+			}
+			else
+			{
+				Context->PSSetConstantBuffers(InOperands[0], 1u, &Buffer);
+			}
+			break;
+		}
+		case Op::HullConstantBuffer:
+		{
+			auto* const Buffer = Get<ID3D11Buffer>(InOperands[1]);
+			Context->HSSetConstantBuffers(InOperands[0], 1u, &Buffer);
+			break;
+		}
+		case Op::DomainConstantBuffer:
+		{
+			auto* const Buffer = Get<ID3D11Buffer>(InOperands[1]);
+			Context->DSSetConstantBuffers(InOperands[0], 1u, &Buffer);
+			break;
+		}
+		case Op::VertexShaderResource:
+		{
+			auto* const View = Get<ID3D11ShaderResourceView>(InOperands[1]);
+			Context->VSSetShaderResources(InOperands[0], 1u, &View);
+			break;
+		}
+		case Op::PixelShaderResource:
+		{
+			auto* const View = Get<ID3D11ShaderResourceView>(InOperands[1]);
+			Context->PSSetShaderResources(InOperands[0], 1u, &View);
+			break;
+		}
+		case Op::DomainShaderResource:
+		{
+			auto* const View = Get<ID3D11ShaderResourceView>(InOperands[1]);
+			Context->DSSetShaderResources(InOperands[0], 1u, &View);
+			break;
+		}
+		case Op::PixelSampler:
+		{
+			auto* const Sampler = Get<ID3D11SamplerState>(InOperands[1]);
+			Context->PSSetSamplers(InOperands[0], 1u, &Sampler);
+			break;
+		}
+		case Op::DomainSampler:
+		{
+			auto* const Sampler = Get<ID3D11SamplerState>(InOperands[1]);
+			Context->DSSetSamplers(InOperands[0], 1u, &Sampler);
+			break;
+		}
+		case Op::Rasterizer:
+			Context->RSSetState(Get<ID3D11RasterizerState>(InOperands[0]));
+			break;
+		case Op::Blend:
+			Context->OMSetBlendState(Get<ID3D11BlendState>(InOperands[0]), nullptr, 0xFFFFFFFFu);
+			break;
+		case Op::DepthStencil:
+			Context->OMSetDepthStencilState(Get<ID3D11DepthStencilState>(InOperands[0]), InOperands[1]);
+			break;
+		case Op::RenderTargets:
+		{
+			ID3D11RenderTargetView* Views[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] {};
+			const auto ViewNum = std::min<uint32_t>(InOperandNum - 1u, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
+
+			for (uint32_t Index = 0u; Index < ViewNum; ++Index)
+			{
+				Views[Index] = Get<ID3D11RenderTargetView>(InOperands[Index + 1u]);
+			}
+
+			Context->OMSetRenderTargets(ViewNum, Views, Get<ID3D11DepthStencilView>(InOperands[0]));
+
+			const auto SizedBy = ViewNum > 0u && InOperands[1] != CommandTrace::NullId ? InOperands[1] : InOperands[0];
+			if (SizedBy != CommandTrace::NullId && SizedBy <= TargetViewports.size())
+			{
+				Context->RSSetViewports(1u, &TargetViewports[SizedBy - 1u]);
+			}
+			break;
+		}
+		case Op::Draw:
+			if (bIsPatchListBound && !bIsHullShaderBound)
+			{
+				return false;
+			}
+			Context->Draw(InOperands[0], InOperands[1]);
+			break;
+		case Op::DrawIndexed:
+			if (bIsPatchListBound && !bIsHullShaderBound)
+			{
+				return false;
+			}
+			Context->DrawIndexed(InOperands[0], InOperands[1], static_cast<INT>(InOperands[2]));
+			break;
+		case Op::DrawIndexedInstanced:
+			if (bIsPatchListBound && !bIsHullShaderBound)
+			{
+				return false;
+			}
+			Context->DrawIndexedInstanced(InOperands[0], InOperands[1], InOperands[2], static_cast<INT>(InOperands[3]), 0u);
+			break;
+		case Op::DrawIndexedInstancedIndirect:
+		case Op::DrawInstancedIndirect:
+		{
+			auto* const Arguments = Get<ID3D11Buffer>(InOperands[0]);
+
+			if (!Arguments || (bIsPatchListBound && !bIsHullShaderBound))
+			{
+				return false;
+			}
+
+			if (InOp == Op::DrawIndexedInstancedIndirect)
+			{
+				Context->DrawIndexedInstancedIndirect(Arguments, InOperands[1]);
+			}
+			else
+			{
+				Context->DrawInstancedIndirect(Arguments, InOperands[1]);
+			}
+			break;
+		}
+		case Op::Upload:
+		{
+			auto* const Buffer = Get<ID3D11Buffer>(InOperands[0]);
+			D3D11_MAPPED_SUBRESOURCE Mapped;
+
+			if (Buffer && InOperands[1] < Blobs.size() && SUCCEEDED(Context->Map(Buffer, 0u, D3D11_MAP_WRITE_DISCARD, 0u, &Mapped)))
+			{
+				std::memcpy(Mapped.pData, Blobs[InOperands[1]].Data, Blobs[InOperands[1]].Size);
+				Context->Unmap(Buffer, 0u);
+			}
+			break;
+		}
+		default:
+			// EndFrame and ops of later versions, which the operand count lets the replay step over.
+			break;
+	}
+
+	return true;
+}
+
+bool CommandReplay::WriteReport() const
+{
+	std::ofstream Stream(ReportFileName);
+
+	if (!Stream)
+	{
+		return false;
+	}
+
+	const auto PassCount = static_cast<double>(PassNum);
+	Stream << "Frame,Draw,Type,Elements,Instances,CpuMicroseconds,GpuMicroseconds\n";
+
+	for (size_t Index = 0u; Index < Frames.size(); ++Index)
+	{
+		double CpuSum = 0.0;
+		double GpuSum = 0.0;
+
+		for (size_t DrawIndex = 0u; DrawIndex < Frames[Index].Draws.size(); ++DrawIndex)
+		{
+			const auto& Timing = Frames[Index].Draws[DrawIndex];
+			CpuSum += Timing.CpuSeconds;
+			GpuSum += Timing.GpuSeconds;
+
+			Stream << Index << ',' << DrawIndex << ',' << GetDrawName(Timing.Type) << (Timing.bIsSkipped ? " (skipped)" : "") << ',' << Timing.ElementNum
+			       << ',' << Timing.InstanceNum << ',' << Timing.CpuSeconds * 1e6 / PassCount << ',' << Timing.GpuSeconds * 1e6 / PassCount << '\n';
+		}
+
+		// The frame's whole submission, its draws summed.
+		Stream << Index << ",All,Frame,,," << CpuSum * 1e6 / PassCount << ',' << GpuSum * 1e6 / PassCount << '\n';
+	}
+
+	// Objects that couldn't be created replayed as null, different hardware than the trace's can be short of formats.
+	Stream << "Missing objects," << MissingNum << '\n';
+	return static_cast<bool>(Stream);
+}
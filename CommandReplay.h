@@ -0,0 +1,117 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <cstddef>
+#include <cstdint>
+#include <d3d11_1.h>
+#include <string>
+#include <vector>
+#include "wrl/client.h"
+#include "CommandTrace.h"
+
+class Graphics;
+
+/**
+ * Plays a trace CommandRecorder wrote against this device, started with --replay instead of the scene, to time every draw
+ * of a captured frame apart from the application logic that produced it.
+ * Each object the trace describes is created again with the contents it carries. Shaders it has no bytecode for are
+ * replaced by stand-ins that draw nothing, tessellated draws without their hull shader are skipped, and input layouts are
+ * created against the first traced vertex shader they fit. Targets are cleared at the start of every frame and each
+ * target binding sets the viewport to the whole target, since neither is traced.
+ * The frames are replayed in order a number of passes over. Per draw, the CPU time is what the state changes since the
+ * previous draw and the draw itself took to submit, and the GPU time what passed between a timestamp after the previous
+ * draw and one after this draw. Both are averaged over the passes and written as CSV.
+ */
+class CommandReplay
+{
+public:
+	static constexpr const char* ReportFileName = "ReplayReport.csv";
+
+	// Throws when the trace can't be read, objects that can't be created on this device are replayed as null.
+	CommandReplay(const Graphics& InGraphics, const std::string& InFileName, unsigned int InPassNum = 10u);
+	CommandReplay(const CommandReplay&) = delete;
+	CommandReplay(CommandReplay&&) = delete;
+	CommandReplay& operator=(const CommandReplay&) = delete;
+	CommandReplay& operator=(CommandReplay&&) = delete;
+	~CommandReplay() = default;
+
+	// The next frame of the trace, returns once its timestamps are back.
+	void ReplayFrame();
+
+	[[nodiscard]] bool IsDone() const noexcept
+	{
+		return PassIndex >= PassNum;
+	}
+
+	[[nodiscard]] bool WriteReport() const;
+
+private:
+	struct DrawTiming
+	{
+		CommandTrace::Op Type;
+		// Vertices or indices, zero for indirect draws.
+		uint32_t ElementNum {0u};
+		uint32_t InstanceNum {1u};
+		double CpuSeconds {0.0};
+		double GpuSeconds {0.0};
+		bool bIsSkipped {false};
+	};
+
+	struct Frame
+	{
+		// Into Commands, up to and including the frame's EndFrame.
+		size_t FirstWord;
+		size_t EndWord;
+		std::vector<DrawTiming> Draws;
+	};
+
+	struct Blob
+	{
+		const std::byte* Data;
+		uint32_t Size;
+	};
+
+	void Parse();
+	void CreateObjects();
+	Microsoft::WRL::ComPtr<ID3D11DeviceChild> CreateObject(const CommandTrace::ObjectRecord& InRecord, const std::byte* InDescription);
+	void CreateStandIns();
+	// False for draws skipped.
+	bool Execute(CommandTrace::Op InOp, const uint32_t* InOperands, uint32_t InOperandNum);
+
+	template<typename T>
+	[[nodiscard]] T* Get(const uint32_t InId) const noexcept
+	{
+		return InId == CommandTrace::NullId || InId > Objects.size() ? nullptr : static_cast<T*>(Objects[InId - 1u].Get());
+	}
+
+private:
+	std::string FileName;
+	std::vector<std::byte> Data;
+	std::vector<CommandTrace::ObjectRecord> Records;
+	std::vector<const std::byte*> Descriptions;
+	std::vector<Blob> Blobs;
+	const uint32_t* Commands {nullptr};
+	size_t CommandWordNum {0u};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> Device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> Context;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> Context1;
+	// Trace ID minus one, null where the object couldn't be created.
+	std::vector<Microsoft::WRL::ComPtr<ID3D11DeviceChild>> Objects;
+	// Of render target and depth-stencil views, the whole of the mip they view.
+	std::vector<D3D11_VIEWPORT> TargetViewports;
+	unsigned int MissingNum {0u};
+
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> StandInVertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> StandInPixelShader;
+	bool bIsPatchListBound {false};
+	bool bIsHullShaderBound {false};
+
+	Microsoft::WRL::ComPtr<ID3D11Query> DisjointQuery;
+	// One before the frame's first draw and one after each draw.
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> TimestampQueries;
+
+	std::vector<Frame> Frames;
+	size_t FrameIndex {0u};
+	unsigned int PassNum;
+	unsigned int PassIndex {0u};
+};
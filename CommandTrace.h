@@ -0,0 +1,148 @@
+﻿#pragma once
+#include <cstdint>
+
+/**
+ * The binary trace CommandRecorder writes and CommandReplay reads, little endian and in whole 32 bit words throughout.
+ * Layout: Header, Header::ObjectNum objects, Header::BlobNum blobs, then Header::CommandWordNum words of commands.
+ * An object is an ObjectRecord followed by the D3D11 description its kind names, a blob a BlobRecord followed by its bytes,
+ * both padded to whole words. Trace IDs number the objects in file order from one, zero stands for null.
+ * A command is a word holding its Op in the low byte and its operand count in the next, followed by the operands.
+ */
+namespace CommandTrace
+{
+	// "CMTR"
+	constexpr uint32_t Magic {0x52544D43u};
+	constexpr uint32_t Version {1u};
+	constexpr uint32_t NullId {0u};
+	constexpr uint32_t NoBlob {0xFFFFFFFFu};
+
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t FrameNum;
+		uint32_t ObjectNum;
+		uint32_t BlobNum;
+		uint32_t CommandWordNum;
+	};
+
+	enum class ObjectKind : uint32_t
+	{
+		// D3D11_BUFFER_DESC, D3D11_TEXTURE1D_DESC and so on.
+		Buffer,
+		Texture1D,
+		Texture2D,
+		Texture3D,
+		// D3D11_SHADER_RESOURCE_VIEW_DESC and so on, the parent is the viewed resource.
+		ShaderResourceView,
+		RenderTargetView,
+		DepthStencilView,
+		// No description, the blob holds the bytecode or elements when the recorder could find them.
+		VertexShader,
+		PixelShader,
+		HullShader,
+		DomainShader,
+		InputLayout,
+		// D3D11_SAMPLER_DESC and so on.
+		Sampler,
+		Rasterizer,
+		Blend,
+		DepthStencil,
+		Num
+	};
+
+	struct ObjectRecord
+	{
+		ObjectKind Kind;
+		uint32_t Parent;
+		// Contents of buffers and textures, bytecode of shaders, elements of input layouts.
+		uint32_t Blob;
+		uint32_t DescSize;
+	};
+
+	// Identical contents are written once, however many objects or uploads name them.
+	struct BlobRecord
+	{
+		uint64_t Hash;
+		uint32_t Size;
+		uint32_t Padding;
+	};
+
+	// Texture contents are their subresources in D3D11CalcSubresource order, each one a SubresourceRecord and its padded bytes.
+	struct SubresourceRecord
+	{
+		uint32_t RowPitch;
+		uint32_t DepthPitch;
+		uint32_t Size;
+	};
+
+	// Input layout elements are an ElementRecord and the padded characters of its semantic name each.
+	struct ElementRecord
+	{
+		uint32_t SemanticNameLength;
+		uint32_t SemanticIndex;
+		uint32_t Format;
+		uint32_t InputSlot;
+		uint32_t AlignedByteOffset;
+		uint32_t InputSlotClass;
+		uint32_t InstanceDataStepRate;
+	};
+
+	// Operands in the order of the StateCache and RenderContext parameters they were recorded from, objects as trace IDs.
+	enum class Op : uint8_t
+	{
+		// The context went back to default state, after a command list or when a deferred context starts recording.
+		Reset,
+		Topology,
+		InputLayout,
+		VertexBuffer,
+		IndexBuffer,
+		VertexShader,
+		PixelShader,
+		HullShader,
+		DomainShader,
+		VertexConstantBuffer,
+		PixelConstantBuffer,
+		HullConstantBuffer,
+		DomainConstantBuffer,
+		VertexShaderResource,
+		PixelShaderResource,
+		DomainShaderResource,
+		PixelSampler,
+		DomainSampler,
+		Rasterizer,
+		Blend,
+		DepthStencil,
+		// The depth-stencil view, then one view per target.
+		RenderTargets,
+		Draw,
+		DrawIndexed,
+		DrawIndexedInstanced,
+		DrawIndexedInstancedIndirect,
+		DrawInstancedIndirect,
+		// A dynamic buffer and the blob of what it held at the end of the frame, ahead of that frame's commands.
+		Upload,
+		EndFrame,
+		Num
+	};
+
+	[[nodiscard]] constexpr uint32_t MakeCommand(const Op InOp, const uint32_t InOperandNum) noexcept
+	{
+		return static_cast<uint32_t>(InOp) | InOperandNum << 8u;
+	}
+
+	[[nodiscard]] constexpr Op GetOp(const uint32_t InCommand) noexcept
+	{
+		return static_cast<Op>(InCommand & 0xFFu);
+	}
+
+	[[nodiscard]] constexpr uint32_t GetOperandNum(const uint32_t InCommand) noexcept
+	{
+		return InCommand >> 8u & 0xFFu;
+	}
+
+	[[nodiscard]] constexpr bool IsDraw(const Op InOp) noexcept
+	{
+		return InOp >= Op::Draw && InOp <= Op::DrawInstancedIndirect;
+	}
+}
@@ -0,0 +1,55 @@
+﻿#include "ComputeShader.h"
+#include "BindManager.h"
+#include "ExceptionMacros.h"
+
+ComputeShader::ComputeShader(const Graphics& InGraphics, const std::string_view InFileName)
+	: FileName(InFileName)
+	, ByteCodeBlob(InGraphics.GetShaderBundle().Load(InFileName))
+	, Reflection(ByteCodeBlob.Get())
+{
+	HRESULT ResultHandle;
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateComputeShader
+	(
+		ByteCodeBlob->GetBufferPointer(),
+		ByteCodeBlob->GetBufferSize(),
+		nullptr,
+		&MyComputeShader
+	))
+}
+
+void ComputeShader::Bind(RenderContext& InContext) noexcept
+{
+	GetContext(InContext)->CSSetShader(MyComputeShader.Get(), nullptr, 0u);
+}
+
+UINT ComputeShader::GetGroupNum(const UINT InThreadNum, const unsigned int InAxis) const noexcept
+{
+	assert(InAxis < 3u);
+
+	const auto GroupSize = Reflection.GetThreadGroupSize()[InAxis];
+	assert(GroupSize > 0u && "Not a compute shader");
+
+	return (InThreadNum + GroupSize - 1u) / GroupSize;
+}
+
+std::shared_ptr<ComputeShader> ComputeShader::Resolve(const Graphics& InGraphics, const std::string_view InFileName)
+{
+	return BindManager::Resolve<ComputeShader>(InGraphics, InFileName);
+}
+
+std::string ComputeShader::GenerateUniqueID(const std::string_view InFileName)
+{
+	using namespace std::string_literals;
+	return typeid(ComputeShader).name() + "#"s + std::string(InFileName);
+}
+
+BindKey ComputeShader::GenerateKey(const std::string_view InFileName)
+{
+	return BindKey::Make<ComputeShader>(InFileName);
+}
+
+std::string ComputeShader::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(FileName);
+}
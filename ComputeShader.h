@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <memory>
+#include <string_view>
+#include "BindKey.h"
+#include "Bindable.h"
+#include "ShaderReflection.h"
+
+/**
+ * A compute shader from the bundle, bound for Graphics::Dispatch.
+ * Compute bindings go straight to the context instead of through the state cache: dispatches are few, and Dispatch
+ * clears what they bound once it has run so nothing is left bound as inputs to the draws after it.
+ */
+class ComputeShader : public Bindable
+{
+public:
+	ComputeShader(const Graphics& InGraphics, std::string_view InFileName);
+
+	void Bind(RenderContext& InContext) noexcept override;
+
+	// Groups to dispatch so every one of InThreadNum threads along the axis runs, from the shader's numthreads.
+	[[nodiscard]] UINT GetGroupNum(UINT InThreadNum, unsigned int InAxis = 0u) const noexcept;
+
+	[[nodiscard]] ID3DBlob* GetByteCode() const noexcept
+	{
+		return ByteCodeBlob.Get();
+	}
+
+	[[nodiscard]] const std::string& GetFileName() const noexcept
+	{
+		return FileName;
+	}
+
+	[[nodiscard]] const ShaderReflection& GetReflection() const noexcept
+	{
+		return Reflection;
+	}
+
+	[[nodiscard]] static std::shared_ptr<ComputeShader> Resolve(const Graphics& InGraphics, std::string_view InFileName);
+	[[nodiscard]] static std::string GenerateUniqueID(std::string_view InFileName);
+	[[nodiscard]] static BindKey GenerateKey(std::string_view InFileName);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+
+protected:
+	std::string FileName;
+	Microsoft::WRL::ComPtr<ID3DBlob> ByteCodeBlob;
+	ShaderReflection Reflection;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> MyComputeShader;
+};
@@ -0,0 +1,73 @@
+﻿#include "ConstantBufferRing.h"
+#include <cassert>
+#include <cstring>
+#include "DXGIInfoManager.h"
+#include "ExceptionMacros.h"
+
+ConstantBufferRing::ConstantBufferRing(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, const UINT InByteSize)
+	: Context(InContext)
+	, ByteSize(InByteSize / AllocationAlignment * AllocationAlignment)
+{
+	assert(Context);
+	assert(ByteSize > 0u);
+
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC RingBufferDesc {};
+	RingBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	RingBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	RingBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	RingBufferDesc.MiscFlags = 0u;
+	RingBufferDesc.ByteWidth = ByteSize;
+	RingBufferDesc.StructureByteStride = 0u;
+
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer
+	(
+		&RingBufferDesc,
+		nullptr,
+		&MyBuffer
+	))
+}
+
+ConstantBufferRing::Allocation ConstantBufferRing::Allocate(const void* InData, const UINT InByteSize)
+{
+	const UINT AlignedSize = (InByteSize + AllocationAlignment - 1u) / AllocationAlignment * AllocationAlignment;
+	assert(AlignedSize <= ByteSize);
+
+	if (Cursor + AlignedSize > ByteSize)
+	{
+		Cursor = 0u;
+		bShouldDiscard = true;
+	}
+
+	HRESULT ResultHandle;
+
+	D3D11_MAPPED_SUBRESOURCE MappedSubresource;
+	CHECK_HRESULT_EXCEPTION(Context->Map
+	(
+		MyBuffer.Get(),
+		0u,
+		bShouldDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+		0u,
+		&MappedSubresource
+	))
+
+	memcpy(static_cast<char*>(MappedSubresource.pData) + Cursor, InData, InByteSize);
+	Context->Unmap(MyBuffer.Get(), 0u);
+
+	const Allocation Result {MyBuffer.Get(), Cursor / ConstantSize, AlignedSize / ConstantSize};
+
+	Cursor += AlignedSize;
+	FrameBytes += AlignedSize;
+	bShouldDiscard = false;
+
+	return Result;
+}
+
+void ConstantBufferRing::BeginFrame() noexcept
+{
+	LastFrameBytes = FrameBytes;
+	FrameBytes = 0u;
+	Cursor = 0u;
+	bShouldDiscard = true;
+}
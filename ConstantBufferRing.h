@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <d3d11_1.h>
+#include "wrl/client.h"
+
+/**
+ * One large dynamic constant buffer shared by every per-draw constant upload of a frame.
+ * Allocations are appended with MAP_WRITE_NO_OVERWRITE and bound as ranges through *SetConstantBuffers1,
+ * so the driver only has to rename the buffer once per frame (or when the ring wraps).
+ * https://learn.microsoft.com/en-us/windows/win32/api/d3d11_1/nf-d3d11_1-id3d11devicecontext1-vssetconstantbuffers1
+ */
+class ConstantBufferRing
+{
+public:
+	struct Allocation
+	{
+		ID3D11Buffer* Buffer {nullptr};
+		UINT FirstConstant {0u};
+		UINT ConstantNum {0u};
+	};
+
+	ConstantBufferRing(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, UINT InByteSize = 4u * 1024u * 1024u);
+	ConstantBufferRing(const ConstantBufferRing&) = delete;
+	ConstantBufferRing(ConstantBufferRing&&) = delete;
+	ConstantBufferRing& operator=(const ConstantBufferRing&) = delete;
+	ConstantBufferRing& operator=(ConstantBufferRing&&) = delete;
+	~ConstantBufferRing() = default;
+
+	[[nodiscard]] Allocation Allocate(const void* InData, UINT InByteSize);
+	void BeginFrame() noexcept;
+
+	[[nodiscard]] UINT GetLastFrameBytes() const noexcept
+	{
+		return LastFrameBytes;
+	}
+
+private:
+	// FirstConstant and NumConstants are counted in 16-byte constants and must be multiples of 16.
+	static constexpr UINT ConstantSize {16u};
+	static constexpr UINT AllocationAlignment {ConstantSize * 16u};
+
+	ID3D11DeviceContext* Context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> MyBuffer;
+	UINT ByteSize;
+	UINT Cursor {0u};
+	UINT FrameBytes {0u};
+	UINT LastFrameBytes {0u};
+	bool bShouldDiscard {true};
+};
@@ -1,21 +1,41 @@
 ﻿#pragma once
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "BindKey.h"
 #include "Bindable.h"
 #include "BindManager.h"
+#include "DrawPacket.h"
 #include "ExceptionMacros.h"
+#include "ShaderReflection.h"
+#include "StateCache.h"
 
+/**
+ * Constants of type T in one slot. Made from initial constants the buffer is immutable and the Resolve overloads taking
+ * constants share it by a hash of their bytes, so equal parameter blocks use one buffer and different ones never alias.
+ * Made from a slot alone it is dynamic and written with Update, for data that changes while it is bound. Update keeps what
+ * it last wrote and skips the map when the same constants are written again through the same context.
+ */
 template<typename T>
 class ConstantBuffer : public Bindable
 {
+	static_assert(std::is_trivially_copyable_v<T>, "Constants are uploaded and hashed as bytes");
+
 public:
 	ConstantBuffer(const Graphics& InGraphics, const T& InConstants, const UINT InSlot = 0u)
 		: Slot(InSlot)
+		, bIsImmutable(true)
+		, ContentHash(HashConstants(InConstants))
 	{
 		HRESULT ResultHandle;
 
 		D3D11_BUFFER_DESC ConstantBufferDescription;
 		ConstantBufferDescription.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		ConstantBufferDescription.Usage = D3D11_USAGE_DYNAMIC;
-		ConstantBufferDescription.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ConstantBufferDescription.Usage = D3D11_USAGE_IMMUTABLE;
+		ConstantBufferDescription.CPUAccessFlags = 0u;
 		ConstantBufferDescription.MiscFlags = 0u;
 		ConstantBufferDescription.ByteWidth = sizeof(InConstants);
 		ConstantBufferDescription.StructureByteStride = 0u;
@@ -52,12 +72,21 @@ public:
 			))
 	}
 
-	void Update(const Graphics& InGraphics, const T& InConstants)
+	void Update(RenderContext& InContext, const T& InConstants)
 	{
+		assert(!bIsImmutable && "Constant buffers made from initial constants are immutable and may be shared");
+
+		auto& Cache = GetStateCache(InContext);
+		if (UploadedCache == &Cache && UploadedResetNum == Cache.GetResetNum() && std::memcmp(&Uploaded, &InConstants, sizeof(T)) == 0)
+		{
+			Cache.CountSkippedUpload();
+			return;
+		}
+
 		HRESULT ResultHandle;
 
 		D3D11_MAPPED_SUBRESOURCE MappedSubresource;
-		CHECK_HRESULT_EXCEPTION(GetContext(InGraphics)->Map
+		CHECK_HRESULT_EXCEPTION(GetContext(InContext)->Map
 		(
 			MyConstantBuffer.Get(), 
 			0u,
@@ -67,12 +96,54 @@ public:
 		))
 
 		memcpy(MappedSubresource.pData, &InConstants, sizeof(InConstants));
-		GetContext(InGraphics)->Unmap(MyConstantBuffer.Get(), 0u);
+		GetContext(InContext)->Unmap(MyConstantBuffer.Get(), 0u);
+		Cache.CountUpload(sizeof(InConstants));
+
+		Uploaded = InConstants;
+		UploadedCache = &Cache;
+		UploadedResetNum = Cache.GetResetNum();
+	}
+
+	// ByteWidth of the buffer both constructors create.
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override
+	{
+		return sizeof(T);
+	}
+
+protected:
+	// Null when the shader doesn't read the named buffer, a struct that drifted from its cbuffer is caught here.
+	[[nodiscard]] static const ShaderReflection::Binding* FindBinding(const ShaderReflection& InReflection, const std::string_view InName) noexcept
+	{
+		const auto* Binding = InReflection.FindConstantBuffer(InName);
+		assert((!Binding || Binding->Size == sizeof(T)) && "Constant buffer struct doesn't match the size of its cbuffer");
+		return Binding;
+	}
+
+	// Identifies immutable buffers by their contents in the keys of the derived classes.
+	[[nodiscard]] static uint64_t HashConstants(const T& InConstants) noexcept
+	{
+		BindKey Key;
+		Key.CombineBytes(&InConstants, sizeof(T));
+		return Key.GetValue();
+	}
+
+	[[nodiscard]] static std::string MakeUniqueID(const char* InTypeName, const UINT InSlot, const bool bInIsImmutable, const uint64_t InContentHash)
+	{
+		using namespace std::string_literals;
+		return InTypeName + "#"s + std::to_string(InSlot) + (bInIsImmutable ? "#"s + std::to_string(InContentHash) : ""s);
 	}
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> MyConstantBuffer;
 	UINT Slot;
+	bool bIsImmutable {false};
+	uint64_t ContentHash {0u};
+
+private:
+	// What the last Update wrote and through which context, no context yet means the next update always maps.
+	T Uploaded {};
+	const StateCache* UploadedCache {nullptr};
+	unsigned int UploadedResetNum {0u};
 };
 
 template<typename T>
@@ -81,16 +152,22 @@ class VertexConstantBuffer final : public ConstantBuffer<T>
 public:
 	using ConstantBuffer<T>::ConstantBuffer;
 
-	void Bind(const Graphics& InGraphics) noexcept override
+	void Bind(RenderContext& InContext) noexcept override
 	{
-		ConstantBuffer<T>::GetContext(InGraphics)->VSSetConstantBuffers
+		ConstantBuffer<T>::GetStateCache(InContext).SetVertexConstantBuffer
 		(
 			ConstantBuffer<T>::Slot,
-			1u,
-			ConstantBuffer<T>::MyConstantBuffer.GetAddressOf()
+			ConstantBuffer<T>::MyConstantBuffer.Get()
 		);
 	}
 
+	// Updates write into the same buffer, so a baked packet still binds the latest contents.
+	bool Bake(DrawPacket& InOutPacket) const noexcept override
+	{
+		InOutPacket.AddVertexConstantBuffer(ConstantBuffer<T>::Slot, ConstantBuffer<T>::MyConstantBuffer.Get());
+		return true;
+	}
+
 	[[nodiscard]] static std::shared_ptr<VertexConstantBuffer> Resolve(const Graphics& InGraphics, const T& InConstants, UINT InSlot = 0)
 	{
 		return BindManager::Resolve<VertexConstantBuffer>(InGraphics, InConstants, InSlot);
@@ -101,20 +178,37 @@ public:
 		return BindManager::Resolve<VertexConstantBuffer>(InGraphics, InSlot);
 	}
 
+	// In the slot the shader reads the named cbuffer from, null when it doesn't read it so there is nothing to upload or bind.
+	[[nodiscard]] static std::shared_ptr<VertexConstantBuffer> Resolve(const Graphics& InGraphics, const T& InConstants, const ShaderReflection& InReflection,
+	                                                                   const std::string_view InName)
+	{
+		const auto* Binding = ConstantBuffer<T>::FindBinding(InReflection, InName);
+		return Binding ? Resolve(InGraphics, InConstants, Binding->Slot) : nullptr;
+	}
+
 	[[nodiscard]] static std::string GenerateUniqueID(const T& InConstants, const UINT InSlot)
 	{
-		return GenerateUniqueID(InSlot);
+		return ConstantBuffer<T>::MakeUniqueID(typeid(VertexConstantBuffer).name(), InSlot, true, ConstantBuffer<T>::HashConstants(InConstants));
 	}
 
 	[[nodiscard]] static std::string GenerateUniqueID(const UINT InSlot = 0)
 	{
-		using namespace std::string_literals;
-		return typeid(VertexConstantBuffer).name() + "#"s + std::to_string(InSlot);
+		return ConstantBuffer<T>::MakeUniqueID(typeid(VertexConstantBuffer).name(), InSlot, false, 0u);
+	}
+
+	[[nodiscard]] static BindKey GenerateKey(const T& InConstants, const UINT InSlot)
+	{
+		return BindKey::Make<VertexConstantBuffer>(InSlot, true, ConstantBuffer<T>::HashConstants(InConstants));
+	}
+
+	[[nodiscard]] static BindKey GenerateKey(const UINT InSlot = 0)
+	{
+		return BindKey::Make<VertexConstantBuffer>(InSlot, false);
 	}
 
 	[[nodiscard]] std::string GetUniqueID() const noexcept override
 	{
-		return GenerateUniqueID(ConstantBuffer<T>::Slot);
+		return ConstantBuffer<T>::MakeUniqueID(typeid(VertexConstantBuffer).name(), ConstantBuffer<T>::Slot, ConstantBuffer<T>::bIsImmutable, ConstantBuffer<T>::ContentHash);
 	}
 };
 
@@ -124,16 +218,21 @@ class PixelConstantBuffer final : public ConstantBuffer<T>
 public:
 	using ConstantBuffer<T>::ConstantBuffer;
 
-	void Bind(const Graphics& InGraphics) noexcept override
+	void Bind(RenderContext& InContext) noexcept override
 	{
-		ConstantBuffer<T>::GetContext(InGraphics)->PSSetConstantBuffers
+		ConstantBuffer<T>::GetStateCache(InContext).SetPixelConstantBuffer
 		(
 			ConstantBuffer<T>::Slot,
-			1u,
-			ConstantBuffer<T>::MyConstantBuffer.GetAddressOf()
+			ConstantBuffer<T>::MyConstantBuffer.Get()
 		);
 	}
 
+	bool Bake(DrawPacket& InOutPacket) const noexcept override
+	{
+		InOutPacket.AddPixelConstantBuffer(ConstantBuffer<T>::Slot, ConstantBuffer<T>::MyConstantBuffer.Get());
+		return true;
+	}
+
 	[[nodiscard]] static std::shared_ptr<PixelConstantBuffer> Resolve(const Graphics& InGraphics, const T& InConstants, UINT InSlot = 0)
 	{
 		return BindManager::Resolve<PixelConstantBuffer>(InGraphics, InConstants, InSlot);
@@ -144,19 +243,84 @@ public:
 		return BindManager::Resolve<PixelConstantBuffer>(InGraphics, InSlot);
 	}
 
+	// In the slot the shader reads the named cbuffer from, null when it doesn't read it so there is nothing to upload or bind.
+	[[nodiscard]] static std::shared_ptr<PixelConstantBuffer> Resolve(const Graphics& InGraphics, const T& InConstants, const ShaderReflection& InReflection,
+	                                                                  const std::string_view InName)
+	{
+		const auto* Binding = ConstantBuffer<T>::FindBinding(InReflection, InName);
+		return Binding ? Resolve(InGraphics, InConstants, Binding->Slot) : nullptr;
+	}
+
 	[[nodiscard]] static std::string GenerateUniqueID(const T& InConstants, const UINT InSlot)
 	{
-		return GenerateUniqueID(InSlot);
+		return ConstantBuffer<T>::MakeUniqueID(typeid(PixelConstantBuffer).name(), InSlot, true, ConstantBuffer<T>::HashConstants(InConstants));
 	}
 
 	[[nodiscard]] static std::string GenerateUniqueID(const UINT InSlot = 0)
 	{
-		using namespace std::string_literals;
-		return typeid(PixelConstantBuffer).name() + "#"s + std::to_string(InSlot);
+		return ConstantBuffer<T>::MakeUniqueID(typeid(PixelConstantBuffer).name(), InSlot, false, 0u);
+	}
+
+	[[nodiscard]] static BindKey GenerateKey(const T& InConstants, const UINT InSlot)
+	{
+		return BindKey::Make<PixelConstantBuffer>(InSlot, true, ConstantBuffer<T>::HashConstants(InConstants));
+	}
+
+	[[nodiscard]] static BindKey GenerateKey(const UINT InSlot = 0)
+	{
+		return BindKey::Make<PixelConstantBuffer>(InSlot, false);
+	}
+
+	[[nodiscard]] std::string GetUniqueID() const noexcept override
+	{
+		return ConstantBuffer<T>::MakeUniqueID(typeid(PixelConstantBuffer).name(), ConstantBuffer<T>::Slot, ConstantBuffer<T>::bIsImmutable, ConstantBuffer<T>::ContentHash);
+	}
+};
+
+// Bound straight to the context like the rest of the compute state, see ComputeShader.
+template<typename T>
+class ComputeConstantBuffer final : public ConstantBuffer<T>
+{
+public:
+	using ConstantBuffer<T>::ConstantBuffer;
+
+	void Bind(RenderContext& InContext) noexcept override
+	{
+		ConstantBuffer<T>::GetContext(InContext)->CSSetConstantBuffers(ConstantBuffer<T>::Slot, 1u, ConstantBuffer<T>::MyConstantBuffer.GetAddressOf());
+	}
+
+	[[nodiscard]] static std::shared_ptr<ComputeConstantBuffer> Resolve(const Graphics& InGraphics, const T& InConstants, UINT InSlot = 0)
+	{
+		return BindManager::Resolve<ComputeConstantBuffer>(InGraphics, InConstants, InSlot);
+	}
+
+	[[nodiscard]] static std::shared_ptr<ComputeConstantBuffer> Resolve(const Graphics& InGraphics, UINT InSlot = 0)
+	{
+		return BindManager::Resolve<ComputeConstantBuffer>(InGraphics, InSlot);
+	}
+
+	[[nodiscard]] static std::string GenerateUniqueID(const T& InConstants, const UINT InSlot)
+	{
+		return ConstantBuffer<T>::MakeUniqueID(typeid(ComputeConstantBuffer).name(), InSlot, true, ConstantBuffer<T>::HashConstants(InConstants));
+	}
+
+	[[nodiscard]] static std::string GenerateUniqueID(const UINT InSlot = 0)
+	{
+		return ConstantBuffer<T>::MakeUniqueID(typeid(ComputeConstantBuffer).name(), InSlot, false, 0u);
+	}
+
+	[[nodiscard]] static BindKey GenerateKey(const T& InConstants, const UINT InSlot)
+	{
+		return BindKey::Make<ComputeConstantBuffer>(InSlot, true, ConstantBuffer<T>::HashConstants(InConstants));
+	}
+
+	[[nodiscard]] static BindKey GenerateKey(const UINT InSlot = 0)
+	{
+		return BindKey::Make<ComputeConstantBuffer>(InSlot, false);
 	}
 
 	[[nodiscard]] std::string GetUniqueID() const noexcept override
 	{
-		return GenerateUniqueID(ConstantBuffer<T>::Slot);
+		return ConstantBuffer<T>::MakeUniqueID(typeid(ComputeConstantBuffer).name(), ConstantBuffer<T>::Slot, ConstantBuffer<T>::bIsImmutable, ConstantBuffer<T>::ContentHash);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,264 @@
+﻿#include "EngineWin.h"
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "AssetArchive.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "TextureCooker.h"
+#include "assimp/Importer.hpp"
+
+/**
+ * Offline cooker the build runs after the engine: imports every model into its mesh cache, block compresses the maps the models use
+ * and packs what the engine reads into the asset archive. Only inputs whose contents changed since the last run are cooked again,
+ * their hashes are kept in a manifest beside the archive.
+ *
+ * Usage: Cooker [content directories...] [--output Assets.pak] [--fast]
+ * The directories default to Models and Images, --fast cooks colour maps to BC1 instead of BC7.
+ */
+namespace
+{
+	using Manifest = std::unordered_map<std::string, uint64_t>;
+
+	// FNV-1a, the same as the mesh caches keep of their source.
+	uint64_t HashFile(const std::filesystem::path& InPath)
+	{
+		uint64_t Hash {14695981039346656037ull};
+
+		if (const MappedFile File(InPath); File.IsValid())
+		{
+			const auto* const Data = File.GetData();
+
+			for (size_t Index = 0u; Index < File.GetSize(); ++Index)
+			{
+				Hash ^= static_cast<uint64_t>(Data[Index]);
+				Hash *= 1099511628211ull;
+			}
+		}
+
+		return Hash;
+	}
+
+	// One line per input, its hash in hex and its archive key.
+	Manifest ReadManifest(const std::filesystem::path& InPath)
+	{
+		Manifest Hashes;
+		std::ifstream Stream(InPath);
+		uint64_t Hash;
+		std::string Key;
+
+		while (Stream >> std::hex >> Hash && std::getline(Stream >> std::ws, Key))
+		{
+			Hashes.insert_or_assign(Key, Hash);
+		}
+
+		return Hashes;
+	}
+
+	void WriteManifest(const std::filesystem::path& InPath, const Manifest& InHashes)
+	{
+		std::ofstream Stream(InPath, std::ios::trunc);
+
+		for (const auto& [Key, Hash] : InHashes)
+		{
+			Stream << std::hex << Hash << ' ' << Key << '\n';
+		}
+	}
+
+	// Hand authored ".dds" files are inputs like any other, the cooked ones are found again from their image.
+	[[nodiscard]] bool IsCookedOutput(const std::filesystem::path& InPath)
+	{
+		const auto Extension = InPath.extension();
+		return Extension == ".meshcache" || Extension == ".tmp";
+	}
+
+	// Drops an output of an input that changed, so the cook below can't keep it for being newer than the input.
+	void RemoveStale(const std::filesystem::path& InOutputPath)
+	{
+		std::error_code ErrorCode;
+		std::filesystem::remove(InOutputPath, ErrorCode);
+	}
+}
+
+int main(const int InArgumentNum, char** InArguments)
+{
+	try
+	{
+		std::vector<std::filesystem::path> Directories;
+		std::filesystem::path OutputPath {"Assets.pak"};
+		auto Quality = TextureCooker::Quality::High;
+
+		for (int Index = 1; Index < InArgumentNum; ++Index)
+		{
+			const std::string_view Argument {InArguments[Index]};
+
+			if (Argument == "--output" && Index + 1 < InArgumentNum)
+			{
+				OutputPath = InArguments[++Index];
+			}
+			else if (Argument == "--fast")
+			{
+				Quality = TextureCooker::Quality::Fast;
+			}
+			else
+			{
+				Directories.emplace_back(Argument);
+			}
+		}
+
+		if (Directories.empty())
+		{
+			Directories = {"Models", "Images"};
+		}
+
+		// Everything is read loose, an archive from the last run must not stand in for the inputs it was packed from.
+		// GDI+ is started by the global App.cpp keeps for Surface.
+		JobSystem MyJobSystem;
+		AssetArchive MyAssetArchive {std::filesystem::path {}};
+
+		auto ManifestPath = OutputPath;
+		ManifestPath.replace_extension(".manifest");
+		const auto LastHashes = ReadManifest(ManifestPath);
+		Manifest Hashes;
+
+		std::vector<std::filesystem::path> Inputs;
+		std::vector<std::filesystem::path> Models;
+		const Assimp::Importer Importer;
+
+		for (const auto& Directory : Directories)
+		{
+			std::error_code ErrorCode;
+
+			for (const auto& DirectoryEntry : std::filesystem::recursive_directory_iterator(Directory, ErrorCode))
+			{
+				if (!DirectoryEntry.is_regular_file() || IsCookedOutput(DirectoryEntry.path()))
+				{
+					continue;
+				}
+
+				Inputs.push_back(DirectoryEntry.path());
+
+				if (Importer.IsExtensionSupported(DirectoryEntry.path().extension().string()))
+				{
+					Models.push_back(DirectoryEntry.path());
+				}
+			}
+		}
+
+		const auto bIsChanged = [&](const std::filesystem::path& InPath)
+		{
+			const auto Key = AssetArchive::MakeKey(InPath);
+			const auto Hash = HashFile(InPath);
+			Hashes.insert_or_assign(Key, Hash);
+
+			const auto Last = LastHashes.find(Key);
+			return Last == LastHashes.end() || Last->second != Hash;
+		};
+
+		// Maps go into the archive only as what they were cooked to, the rest of the inputs as they are.
+		std::set<std::filesystem::path> CookedMaps;
+		unsigned int CookedNum {0u};
+		bool bHasFailed {false};
+
+		for (const auto& Model : Models)
+		{
+			if (bIsChanged(Model))
+			{
+				RemoveStale(std::filesystem::path {Model} += ".meshcache");
+			}
+
+			std::vector<ModelAsset::CookedMap> Maps;
+
+			try
+			{
+				Maps = ModelAsset::ImportForCooking(Model);
+			}
+			catch (const std::exception& InException)
+			{
+				std::fprintf(stderr, "%s: %s\n", Model.string().c_str(), InException.what());
+				bHasFailed = true;
+				continue;
+			}
+
+			// Maps shared with a model cooked before are already done. Unchanged ones are skipped by Cook itself while their ".dds" is there.
+			std::vector<ModelAsset::CookedMap> NewMaps;
+			size_t ChangedNum {0u};
+
+			for (auto& Map : Maps)
+			{
+				if (CookedMaps.insert(std::filesystem::path {Map.FileName}.lexically_normal()).second)
+				{
+					if (bIsChanged(Map.FileName))
+					{
+						RemoveStale(std::filesystem::path {Map.FileName}.replace_extension(".dds"));
+						++ChangedNum;
+					}
+
+					NewMaps.push_back(std::move(Map));
+				}
+			}
+
+			ModelAsset::CookTextures(NewMaps, Quality);
+			CookedNum += static_cast<unsigned int>(ChangedNum);
+			std::printf("%s: %zu maps, %zu changed\n", Model.string().c_str(), Maps.size(), ChangedNum);
+		}
+
+		// Ordered and unique, a hand authored ".dds" is both an input and the cooked form of its image.
+		std::set<std::filesystem::path> PackedFiles;
+
+		for (const auto& Input : Inputs)
+		{
+			auto CachePath = Input;
+			CachePath += ".meshcache";
+			const auto CookedPath = std::filesystem::path {Input}.replace_extension(".dds");
+
+			// A map that failed to cook is packed as it is, Texture falls back to the image the same way.
+			if (!CookedMaps.contains(Input.lexically_normal()))
+			{
+				PackedFiles.insert(Input);
+			}
+			else if (std::filesystem::exists(CookedPath))
+			{
+				PackedFiles.insert(CookedPath);
+			}
+			else
+			{
+				PackedFiles.insert(Input);
+			}
+
+			if (std::filesystem::exists(CachePath))
+			{
+				PackedFiles.insert(CachePath);
+			}
+		}
+
+		std::printf("%u maps changed, packing %zu files into %s\n", CookedNum, PackedFiles.size(), OutputPath.string().c_str());
+
+		if (const std::vector<std::filesystem::path> Files(PackedFiles.begin(), PackedFiles.end()); !AssetArchive::Write(OutputPath, Files))
+		{
+			std::fprintf(stderr, "Failed to write %s\n", OutputPath.string().c_str());
+			return 1;
+		}
+
+		// Only a complete cook is remembered, so whatever failed is tried again next time.
+		if (!bHasFailed)
+		{
+			WriteManifest(ManifestPath, Hashes);
+		}
+
+		return bHasFailed ? 1 : 0;
+	}
+	catch (const std::exception& InException)
+	{
+		std::fprintf(stderr, "%s\n", InException.what());
+	}
+
+	return -1;
+}
@@ -0,0 +1,25 @@
+﻿#include "CpuFeatures.h"
+#include <immintrin.h>
+#include <intrin.h>
+
+bool CpuFeatures::HasAvx2() noexcept
+{
+	static const bool bHasAvx2 = []
+	{
+		int Registers[4];
+		__cpuid(Registers, 0);
+
+		if (Registers[0] < 7)
+		{
+			return false;
+		}
+
+		__cpuid(Registers, 1);
+		const bool bHasOsAvx = (Registers[2] & (1 << 27)) && (Registers[2] & (1 << 28)) && (_xgetbv(0) & 6u) == 6u;
+
+		__cpuidex(Registers, 7, 0);
+		return bHasOsAvx && (Registers[1] & (1 << 5));
+	}();
+
+	return bHasAvx2;
+}
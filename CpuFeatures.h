@@ -0,0 +1,8 @@
+﻿#pragma once
+
+// Instruction sets past the SSE2 every x64 processor has, for kernels that pick their path at run time. Asked once each.
+namespace CpuFeatures
+{
+	// The processor has it and the system saves the upper halves of the registers.
+	[[nodiscard]] bool HasAvx2() noexcept;
+}
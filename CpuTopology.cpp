@@ -0,0 +1,89 @@
+﻿#include "CpuTopology.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace
+{
+	CpuTopology::CoreSet ChooseGroup(const std::map<WORD, KAFFINITY>& InMasks) noexcept
+	{
+		CpuTopology::CoreSet Chosen;
+
+		for (const auto& [Group, Mask] : InMasks)
+		{
+			if (const auto ThreadNum = static_cast<unsigned int>(std::popcount(Mask)); ThreadNum > Chosen.ThreadNum)
+			{
+				Chosen.Affinity.Group = Group;
+				Chosen.Affinity.Mask = Mask;
+				Chosen.ThreadNum = ThreadNum;
+			}
+		}
+
+		return Chosen;
+	}
+}
+
+const CpuTopology::Layout& CpuTopology::Get() noexcept
+{
+	static const Layout Found = []
+	{
+		Layout Result;
+		DWORD ByteNum = 0u;
+		GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &ByteNum);
+
+		if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+		{
+			return Result;
+		}
+
+		std::vector<std::byte> Buffer(ByteNum);
+		if (!GetLogicalProcessorInformationEx(RelationProcessorCore, reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(Buffer.data()), &ByteNum))
+		{
+			return Result;
+		}
+
+		// Records are of varying size, each says how far the next one is.
+		std::vector<const PROCESSOR_RELATIONSHIP*> Cores;
+		for (DWORD Offset = 0u; Offset < ByteNum;)
+		{
+			const auto* const Record = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(Buffer.data() + Offset);
+			Cores.push_back(&Record->Processor);
+			Offset += Record->Size;
+		}
+
+		BYTE HighestClass = 0u;
+		for (const auto* const Core : Cores)
+		{
+			HighestClass = std::max(HighestClass, Core->EfficiencyClass);
+		}
+
+		std::map<WORD, KAFFINITY> PerformanceMasks;
+		std::map<WORD, KAFFINITY> EfficiencyMasks;
+
+		for (const auto* const Core : Cores)
+		{
+			auto& Masks = Core->EfficiencyClass == HighestClass ? PerformanceMasks : EfficiencyMasks;
+
+			for (WORD Index = 0u; Index < Core->GroupCount; ++Index)
+			{
+				Masks[Core->GroupMask[Index].Group] |= Core->GroupMask[Index].Mask;
+			}
+		}
+
+		Result.Performance = ChooseGroup(PerformanceMasks);
+		Result.Efficiency = ChooseGroup(EfficiencyMasks);
+		return Result;
+	}();
+
+	return Found;
+}
+
+void CpuTopology::Pin(const CoreSet& InSet) noexcept
+{
+	if (InSet.ThreadNum > 0u)
+	{
+		SetThreadGroupAffinity(GetCurrentThread(), &InSet.Affinity, nullptr);
+	}
+}
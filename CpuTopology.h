@@ -0,0 +1,31 @@
+﻿#pragma once
+#include "EngineWin.h"
+
+// Which logical processors sit on the fast cores of a hybrid processor and which on the efficient ones, read once from
+// GetLogicalProcessorInformationEx. The cores of the highest EfficiencyClass are the performance cores, a processor whose cores
+// all report the same class has no efficiency set. A set spanning processor groups keeps the group holding most of it, a thread
+// runs in one group at a time.
+namespace CpuTopology
+{
+	struct CoreSet
+	{
+		GROUP_AFFINITY Affinity {};
+		// Logical processors in the affinity.
+		unsigned int ThreadNum {0u};
+	};
+
+	struct Layout
+	{
+		CoreSet Performance;
+		CoreSet Efficiency;
+
+		[[nodiscard]] bool IsHybrid() const noexcept
+		{
+			return Performance.ThreadNum > 0u && Efficiency.ThreadNum > 0u;
+		}
+	};
+
+	[[nodiscard]] const Layout& Get() noexcept;
+	// Keeps the calling thread on the set's processors, an empty set leaves it where it may run.
+	void Pin(const CoreSet& InSet) noexcept;
+}
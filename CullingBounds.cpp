@@ -0,0 +1,161 @@
+﻿#include "CullingBounds.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <immintrin.h>
+#include "CpuFeatures.h"
+#include "FrameProfiler.h"
+#include "JobSystem.h"
+
+namespace
+{
+	constexpr size_t PlaneNum {6u};
+}
+
+void CullingBounds::Resize(const size_t InNum)
+{
+	Groups.resize((InNum + GroupSize - 1u) / GroupSize);
+	Num = InNum;
+}
+
+void CullingBounds::Set(const size_t InIndex, const DirectX::FXMVECTOR InCenter, const DirectX::FXMVECTOR InExtents) noexcept
+{
+	assert(InIndex < Num);
+
+	auto& Target = Groups[InIndex / GroupSize];
+	const auto Lane = InIndex % GroupSize;
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Extents;
+	DirectX::XMStoreFloat3(&Center, InCenter);
+	DirectX::XMStoreFloat3(&Extents, InExtents);
+
+	Target.CenterX[Lane] = Center.x;
+	Target.CenterY[Lane] = Center.y;
+	Target.CenterZ[Lane] = Center.z;
+	Target.ExtentX[Lane] = Extents.x;
+	Target.ExtentY[Lane] = Extents.y;
+	Target.ExtentZ[Lane] = Extents.z;
+}
+
+void CullingBounds::Cull(const std::span<const DirectX::BoundingFrustum> InFrustums, std::vector<uint8_t>& OutVisibleMasks) const
+{
+	PROFILE_SCOPE("CullingBounds::Cull");
+
+	std::vector<Plane> Planes;
+	Planes.reserve(InFrustums.size() * PlaneNum);
+
+	for (const auto& Frustum : InFrustums)
+	{
+		std::array<DirectX::XMVECTOR, PlaneNum> Vectors;
+		Frustum.GetPlanes(&Vectors[0], &Vectors[1], &Vectors[2], &Vectors[3], &Vectors[4], &Vectors[5]);
+
+		for (const auto& Vector : Vectors)
+		{
+			DirectX::XMFLOAT4 Values;
+			DirectX::XMStoreFloat4(&Values, Vector);
+			Planes.push_back({Values.x, Values.y, Values.z, Values.w, std::abs(Values.x), std::abs(Values.y), std::abs(Values.z), 0.0f});
+		}
+	}
+
+	OutVisibleMasks.resize(Groups.size());
+
+	const auto FrustumNum = InFrustums.size();
+	const auto bHasAvx2 = CpuFeatures::HasAvx2();
+	const auto BatchNum = (Groups.size() + GroupsPerJob - 1u) / GroupsPerJob;
+
+	// A box is outside a plane when its centre lies farther out than its extents reach along the normal. Each frustum's planes
+	// mark the boxes outside it, and a box stays visible when some frustum marked nothing.
+	JobSystem::Get().ParallelFor(BatchNum, 1u, [&](const size_t InBatch)
+	{
+		const auto First = InBatch * GroupsPerJob;
+		const auto Last = std::min(Groups.size(), First + GroupsPerJob);
+
+		if (bHasAvx2)
+		{
+			for (auto Index = First; Index < Last; ++Index)
+			{
+				const auto& Source = Groups[Index];
+				const auto CenterX = _mm256_load_ps(Source.CenterX);
+				const auto CenterY = _mm256_load_ps(Source.CenterY);
+				const auto CenterZ = _mm256_load_ps(Source.CenterZ);
+				const auto ExtentX = _mm256_load_ps(Source.ExtentX);
+				const auto ExtentY = _mm256_load_ps(Source.ExtentY);
+				const auto ExtentZ = _mm256_load_ps(Source.ExtentZ);
+				unsigned int Visible = 0u;
+
+				for (size_t Frustum = 0u; Frustum < FrustumNum && Visible != 0xFFu; ++Frustum)
+				{
+					auto Outside = _mm256_setzero_ps();
+
+					for (size_t PlaneIndex = 0u; PlaneIndex < PlaneNum; ++PlaneIndex)
+					{
+						const auto& Face = Planes[Frustum * PlaneNum + PlaneIndex];
+						auto Distance = _mm256_add_ps(_mm256_mul_ps(CenterX, _mm256_broadcast_ss(&Face.NormalX)), _mm256_broadcast_ss(&Face.Distance));
+						Distance = _mm256_add_ps(Distance, _mm256_mul_ps(CenterY, _mm256_broadcast_ss(&Face.NormalY)));
+						Distance = _mm256_add_ps(Distance, _mm256_mul_ps(CenterZ, _mm256_broadcast_ss(&Face.NormalZ)));
+						auto Reach = _mm256_mul_ps(ExtentX, _mm256_broadcast_ss(&Face.AbsNormalX));
+						Reach = _mm256_add_ps(Reach, _mm256_mul_ps(ExtentY, _mm256_broadcast_ss(&Face.AbsNormalY)));
+						Reach = _mm256_add_ps(Reach, _mm256_mul_ps(ExtentZ, _mm256_broadcast_ss(&Face.AbsNormalZ)));
+						Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(Distance, Reach, _CMP_GT_OQ));
+					}
+
+					Visible |= ~static_cast<unsigned int>(_mm256_movemask_ps(Outside)) & 0xFFu;
+				}
+
+				OutVisibleMasks[Index] = static_cast<uint8_t>(Visible);
+			}
+
+			// The SSE code after it doesn't pay for the transition.
+			_mm256_zeroupper();
+		}
+		else
+		{
+			for (auto Index = First; Index < Last; ++Index)
+			{
+				const auto& Source = Groups[Index];
+				unsigned int Visible = 0u;
+
+				for (size_t Half = 0u; Half < GroupSize; Half += 4u)
+				{
+					const auto CenterX = _mm_load_ps(Source.CenterX + Half);
+					const auto CenterY = _mm_load_ps(Source.CenterY + Half);
+					const auto CenterZ = _mm_load_ps(Source.CenterZ + Half);
+					const auto ExtentX = _mm_load_ps(Source.ExtentX + Half);
+					const auto ExtentY = _mm_load_ps(Source.ExtentY + Half);
+					const auto ExtentZ = _mm_load_ps(Source.ExtentZ + Half);
+					unsigned int HalfVisible = 0u;
+
+					for (size_t Frustum = 0u; Frustum < FrustumNum && HalfVisible != 0xFu; ++Frustum)
+					{
+						auto Outside = _mm_setzero_ps();
+
+						for (size_t PlaneIndex = 0u; PlaneIndex < PlaneNum; ++PlaneIndex)
+						{
+							const auto& Face = Planes[Frustum * PlaneNum + PlaneIndex];
+							auto Distance = _mm_add_ps(_mm_mul_ps(CenterX, _mm_set1_ps(Face.NormalX)), _mm_set1_ps(Face.Distance));
+							Distance = _mm_add_ps(Distance, _mm_mul_ps(CenterY, _mm_set1_ps(Face.NormalY)));
+							Distance = _mm_add_ps(Distance, _mm_mul_ps(CenterZ, _mm_set1_ps(Face.NormalZ)));
+							auto Reach = _mm_mul_ps(ExtentX, _mm_set1_ps(Face.AbsNormalX));
+							Reach = _mm_add_ps(Reach, _mm_mul_ps(ExtentY, _mm_set1_ps(Face.AbsNormalY)));
+							Reach = _mm_add_ps(Reach, _mm_mul_ps(ExtentZ, _mm_set1_ps(Face.AbsNormalZ)));
+							Outside = _mm_or_ps(Outside, _mm_cmpgt_ps(Distance, Reach));
+						}
+
+						HalfVisible |= ~static_cast<unsigned int>(_mm_movemask_ps(Outside)) & 0xFu;
+					}
+
+					Visible |= HalfVisible << Half;
+				}
+
+				OutVisibleMasks[Index] = static_cast<uint8_t>(Visible);
+			}
+		}
+	});
+
+	// The lanes past the last box hold nothing.
+	if (const auto Tail = Num % GroupSize; Tail != 0u)
+	{
+		OutVisibleMasks.back() &= static_cast<uint8_t>((1u << Tail) - 1u);
+	}
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <cstdint>
+#include <DirectXCollision.h>
+#include <span>
+#include <vector>
+
+/**
+ * World space boxes of many instances, kept for frustum culling in groups of GroupSize with every field its own aligned array
+ * of lanes, so a kernel loads eight centres or extents along one axis in a single move. Cull tests whole groups against all six
+ * planes of every frustum at once, with AVX2 where the processor has it and two SSE halves otherwise, split into jobs on the
+ * JobSystem, and writes one bit per box.
+ * A box is culled when it lies wholly outside one of the planes, boxes near a frustum's corner that are outside it but
+ * outside no single plane are kept, which only ever draws a little more.
+ */
+class CullingBounds
+{
+public:
+	static constexpr size_t GroupSize {8u};
+
+	// Boxes past the old count start out empty at the origin.
+	void Resize(size_t InNum);
+
+	// Boxes of different groups may be set from different threads at once.
+	void Set(size_t InIndex, DirectX::FXMVECTOR InCenter, DirectX::FXMVECTOR InExtents) noexcept;
+
+	// One byte per group in OutVisibleMasks, bit n of it set when box n of the group touches any of the frustums.
+	void Cull(std::span<const DirectX::BoundingFrustum> InFrustums, std::vector<uint8_t>& OutVisibleMasks) const;
+
+	[[nodiscard]] static bool IsVisible(const std::span<const uint8_t> InVisibleMasks, const size_t InIndex) noexcept
+	{
+		return (InVisibleMasks[InIndex / GroupSize] >> (InIndex % GroupSize)) & 1u;
+	}
+
+	[[nodiscard]] size_t GetNum() const noexcept
+	{
+		return Num;
+	}
+
+private:
+	// Groups a job tests at least, a few thousand boxes cull on one thread.
+	static constexpr size_t GroupsPerJob {1024u};
+
+	struct alignas(32) Group
+	{
+		float CenterX[GroupSize];
+		float CenterY[GroupSize];
+		float CenterZ[GroupSize];
+		float ExtentX[GroupSize];
+		float ExtentY[GroupSize];
+		float ExtentZ[GroupSize];
+	};
+
+	// Pointing out of the frustum, with the normal's magnitudes alongside for the extents.
+	struct Plane
+	{
+		float NormalX;
+		float NormalY;
+		float NormalZ;
+		float Distance;
+		float AbsNormalX;
+		float AbsNormalY;
+		float AbsNormalZ;
+		float Padding;
+	};
+
+	std::vector<Group> Groups;
+	size_t Num {0u};
+};
@@ -0,0 +1,58 @@
+﻿#pragma once
+#include <cstdint>
+#include <dxgiformat.h>
+
+/** https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header */
+struct DDSPixelFormat
+{
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t FourCC;
+	uint32_t RGBBitCount;
+	uint32_t RBitMask;
+	uint32_t GBitMask;
+	uint32_t BBitMask;
+	uint32_t ABitMask;
+};
+
+struct DDSHeader
+{
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t Height;
+	uint32_t Width;
+	uint32_t PitchOrLinearSize;
+	uint32_t Depth;
+	uint32_t MipMapCount;
+	uint32_t Reserved1[11];
+	DDSPixelFormat PixelFormat;
+	uint32_t Caps;
+	uint32_t Caps2;
+	uint32_t Caps3;
+	uint32_t Caps4;
+	uint32_t Reserved2;
+};
+
+struct DDSHeaderDXT10
+{
+	DXGI_FORMAT Format;
+	uint32_t ResourceDimension;
+	uint32_t MiscFlag;
+	uint32_t ArraySize;
+	uint32_t MiscFlags2;
+};
+
+constexpr uint32_t MakeFourCC(const char InA, const char InB, const char InC, const char InD) noexcept
+{
+	return static_cast<uint32_t>(InA) | static_cast<uint32_t>(InB) << 8u | static_cast<uint32_t>(InC) << 16u | static_cast<uint32_t>(InD) << 24u;
+}
+
+constexpr uint32_t DDSMagic {MakeFourCC('D', 'D', 'S', ' ')};
+constexpr uint32_t DDSFourCCFlag {0x4u};
+// What a written header sets besides the mip count: caps, height, width, pixel format and linear size.
+constexpr uint32_t DDSRequiredFlags {0x1u | 0x2u | 0x4u | 0x1000u | 0x80000u};
+constexpr uint32_t DDSMipMapCountFlag {0x20000u};
+constexpr uint32_t DDSCubeMapFlag {0x200u};
+// Texture, mip map and complex.
+constexpr uint32_t DDSMipMappedCaps {0x1000u | 0x400000u | 0x8u};
+constexpr uint32_t DDSResourceDimensionTexture2D {3u};
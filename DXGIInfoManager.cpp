@@ -1,6 +1,7 @@
 ﻿#include "DXGIInfoManager.h"
 #include <memory>
 #include "Exception.h"
+#include "Logger.h"
 #pragma comment(lib, "dxguid.lib")
 
 DXGIInfoManager::DXGIInfoManager()
@@ -34,12 +35,89 @@ void DXGIInfoManager::Set() noexcept
 
 std::vector<std::string> DXGIInfoManager::GetMessages()
 {
-	std::vector<std::string> Messages;
+#ifndef NDEBUG
+	return GetMessages(Next, DXGIInfoQueue->GetNumStoredMessages(DXGI_DEBUG_ALL));
+#else
+	return {};
+#endif
+}
 
+void DXGIInfoManager::ReportMessages(const char* InFile, const int InLine)
+{
+#ifndef NDEBUG
+	ReportMessages(Next, DXGIInfoQueue->GetNumStoredMessages(DXGI_DEBUG_ALL), InFile, InLine);
+#endif
+}
+
+void DXGIInfoManager::SetDrawValidationInterval(const unsigned int InInterval) noexcept
+{
+	DrawValidationInterval.store(InInterval, std::memory_order_relaxed);
+}
+
+bool DXGIInfoManager::ShouldValidateDraw() noexcept
+{
+	const auto Interval = DrawValidationInterval.load(std::memory_order_relaxed);
+
+	if (Interval == 0u || ++DrawsSinceValidation < Interval)
+	{
+		return false;
+	}
+
+	DrawsSinceValidation = 0u;
+	return true;
+}
+
+void DXGIInfoManager::ReportDrawMessages(const char* InFile, const int InLine)
+{
 #ifndef NDEBUG
 	const auto End = DXGIInfoQueue->GetNumStoredMessages(DXGI_DEBUG_ALL);
+	ReportMessages(DrawNext.exchange(End, std::memory_order_relaxed), End, InFile, InLine);
+#endif
+}
 
-	for (auto Index = Next; Index < End; Index++)
+void DXGIInfoManager::SkipDrawMessages() noexcept
+{
+#ifndef NDEBUG
+	DrawNext.store(DXGIInfoQueue->GetNumStoredMessages(DXGI_DEBUG_ALL), std::memory_order_relaxed);
+#endif
+}
+
+std::vector<std::string> DXGIInfoManager::GetMessages(const unsigned long long InFirst, const unsigned long long InEnd)
+{
+	std::vector<std::string> Messages;
+
+	VisitMessages(InFirst, InEnd, [&Messages](const DXGI_INFO_QUEUE_MESSAGE& InMessage)
+	{
+		Messages.emplace_back(InMessage.pDescription);
+	});
+
+	return Messages;
+}
+
+void DXGIInfoManager::ReportMessages(const unsigned long long InFirst, const unsigned long long InEnd, const char* InFile, const int InLine)
+{
+	VisitMessages(InFirst, InEnd, [InFile, InLine](const DXGI_INFO_QUEUE_MESSAGE& InMessage)
+	{
+		switch (InMessage.Severity)
+		{
+		case DXGI_INFO_QUEUE_MESSAGE_SEVERITY_CORRUPTION:
+		case DXGI_INFO_QUEUE_MESSAGE_SEVERITY_ERROR:
+			Logger::Write(LogLevel::Error, InFile, InLine, "Debug layer: {}", InMessage.pDescription);
+			break;
+		case DXGI_INFO_QUEUE_MESSAGE_SEVERITY_WARNING:
+			Logger::Write(LogLevel::Warning, InFile, InLine, "Debug layer: {}", InMessage.pDescription);
+			break;
+		default:
+			Logger::Write(LogLevel::Info, InFile, InLine, "Debug layer: {}", InMessage.pDescription);
+			break;
+		}
+	});
+}
+
+template <typename TVisitor>
+void DXGIInfoManager::VisitMessages(const unsigned long long InFirst, const unsigned long long InEnd, const TVisitor& InVisitor)
+{
+	for (auto Index = InFirst; Index < InEnd; Index++)
 	{
 		size_t MessageLength;
 
@@ -56,9 +134,6 @@ std::vector<std::string> DXGIInfoManager::GetMessages()
 			throw ResultHandleException(__LINE__, __FILE__, ResultHandle);
 		}
 
-		Messages.emplace_back(MessageBuffer->pDescription);
+		InVisitor(*MessageBuffer);
 	}
-#endif
-
-	return Messages;
 }
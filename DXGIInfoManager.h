@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include <atomic>
 #include <dxgidebug.h>
 #include <string>
 #include <vector>
@@ -16,8 +17,28 @@ public:
 
 	static void Set() noexcept;
 	[[nodiscard]] static std::vector<std::string> GetMessages();
+	// Logs what the calling thread added to the queue since Set at each message's severity, as if from InFile at InLine.
+	static void ReportMessages(const char* InFile, int InLine);
+
+	// Draws check the queue every InInterval draws per thread, zero leaves it to the check once per frame.
+	static void SetDrawValidationInterval(unsigned int InInterval) noexcept;
+	[[nodiscard]] static bool ShouldValidateDraw() noexcept;
+	// Logs everything queued since the last draw validation on any thread, so skipped draws still get reported.
+	static void ReportDrawMessages(const char* InFile, int InLine);
+	// Drops what ReportDrawMessages would log, after draws that leave resources unbound on purpose.
+	static void SkipDrawMessages() noexcept;
+
+private:
+	[[nodiscard]] static std::vector<std::string> GetMessages(unsigned long long InFirst, unsigned long long InEnd);
+	static void ReportMessages(unsigned long long InFirst, unsigned long long InEnd, const char* InFile, int InLine);
+	// Calls InVisitor with every stored message from InFirst up to InEnd.
+	template <typename TVisitor>
+	static void VisitMessages(unsigned long long InFirst, unsigned long long InEnd, const TVisitor& InVisitor);
 
 private:
-	static inline unsigned long long Next = 0u;
+	static inline thread_local unsigned long long Next = 0u;
+	static inline thread_local unsigned int DrawsSinceValidation = 0u;
+	static inline std::atomic<unsigned long long> DrawNext = 0u;
+	static inline std::atomic<unsigned int> DrawValidationInterval = 8u;
 	static inline Microsoft::WRL::ComPtr<IDXGIInfoQueue> DXGIInfoQueue;
 };
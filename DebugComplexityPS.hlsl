@@ -0,0 +1,17 @@
+// The colour of the replaced pixel shader's instruction count, which DebugViews passes as a fraction of twice
+// DebugViews::ExpensiveInstructionNum. Green for none, red at the expensive count, white from twice it on.
+cbuffer Complexity : register(b0)
+{
+    float Cost;
+    float3 Padding;
+};
+
+float4 main() : SV_Target
+{
+    const float Scaled = saturate(Cost) * 2.0f;
+    const float3 Cheap = float3(0.0f, 0.6f, 0.0f);
+    const float3 Expensive = float3(1.0f, 0.0f, 0.0f);
+    const float3 Color = Scaled < 1.0f ? lerp(Cheap, Expensive, Scaled) : lerp(Expensive, float3(1.0f, 1.0f, 1.0f), Scaled - 1.0f);
+
+    return float4(Color, 1.0f);
+}
@@ -0,0 +1,244 @@
+﻿#include "DebugDraw.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	UINT PackColor(const DirectX::XMFLOAT4& InColor) noexcept
+	{
+		const auto Channel = [](const float InValue, const unsigned int InShift)
+		{
+			return static_cast<UINT>(std::lround(std::clamp(InValue, 0.0f, 1.0f) * 255.0f)) << InShift;
+		};
+
+		return Channel(InColor.x, 0u) | Channel(InColor.y, 8u) | Channel(InColor.z, 16u) | Channel(InColor.w, 24u);
+	}
+}
+
+DebugDraw::DebugDraw(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+{
+	HRESULT ResultHandle;
+
+	const auto VertexBlob = InShaderBundle.Load("DebugDrawVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &VertexShader))
+
+	const auto PixelBlob = InShaderBundle.Load("DebugDrawPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(PixelBlob->GetBufferPointer(), PixelBlob->GetBufferSize(), nullptr, &PixelShader))
+
+	const D3D11_INPUT_ELEMENT_DESC Elements[] =
+	{
+		{"Position", 0u, DXGI_FORMAT_R32G32B32_FLOAT, 0u, offsetof(Vertex, Position), D3D11_INPUT_PER_VERTEX_DATA, 0u},
+		{"Color", 0u, DXGI_FORMAT_R8G8B8A8_UNORM, 0u, offsetof(Vertex, Color), D3D11_INPUT_PER_VERTEX_DATA, 0u}
+	};
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateInputLayout(Elements, static_cast<UINT>(std::size(Elements)), VertexBlob->GetBufferPointer(),
+	                                                    VertexBlob->GetBufferSize(), &InputLayout))
+
+	D3D11_BUFFER_DESC VertexDesc {};
+	VertexDesc.ByteWidth = MaxVertexNum * sizeof(Vertex);
+	VertexDesc.Usage = D3D11_USAGE_DYNAMIC;
+	VertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	VertexDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&VertexDesc, nullptr, &VertexBuffer))
+
+	// Lines on a surface pass where they touch it, none of them write depth for the scene after.
+	D3D11_DEPTH_STENCIL_DESC DepthDesc {};
+	DepthDesc.DepthEnable = TRUE;
+	DepthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DepthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&DepthDesc, &TestedDepthState))
+
+	DepthDesc.DepthEnable = FALSE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&DepthDesc, &OnTopDepthState))
+}
+
+void DebugDraw::Line(const DirectX::XMFLOAT3& InFrom, const DirectX::XMFLOAT3& InTo, const DirectX::XMFLOAT4& InColor, const bool bInIsOnTop)
+{
+	if (!bIsEnabled)
+	{
+		return;
+	}
+
+	auto& Vertices = bInIsOnTop ? OnTopVertices : TestedVertices;
+	const auto Color = PackColor(InColor);
+	Vertices.push_back({InFrom, Color});
+	Vertices.push_back({InTo, Color});
+}
+
+void DebugDraw::Box(const DirectX::BoundingBox& InBox, const DirectX::XMFLOAT4& InColor, const bool bInIsOnTop)
+{
+	// Such as the bounds of nodes without meshes.
+	if (!bIsEnabled || InBox.Extents.x < 0.0f)
+	{
+		return;
+	}
+
+	DirectX::XMFLOAT3 Corners[DirectX::BoundingBox::CORNER_COUNT];
+	InBox.GetCorners(Corners);
+	AddEdges(Corners, InColor, bInIsOnTop);
+}
+
+void DebugDraw::Box(const DirectX::BoundingOrientedBox& InBox, const DirectX::XMFLOAT4& InColor, const bool bInIsOnTop)
+{
+	if (!bIsEnabled)
+	{
+		return;
+	}
+
+	DirectX::XMFLOAT3 Corners[DirectX::BoundingOrientedBox::CORNER_COUNT];
+	InBox.GetCorners(Corners);
+	AddEdges(Corners, InColor, bInIsOnTop);
+}
+
+void DebugDraw::Sphere(const DirectX::XMFLOAT3& InCenter, const float InRadius, const DirectX::XMFLOAT4& InColor, const bool bInIsOnTop)
+{
+	if (!bIsEnabled)
+	{
+		return;
+	}
+
+	auto& Vertices = bInIsOnTop ? OnTopVertices : TestedVertices;
+	const auto Color = PackColor(InColor);
+
+	// Around z, y and x in turn, each point one segment along its circle.
+	const auto PointAt = [&](const unsigned int InAxis, const unsigned int InSegment)
+	{
+		const auto Angle = DirectX::XM_2PI * static_cast<float>(InSegment) / static_cast<float>(CircleSegmentNum);
+		const auto Cosine = InRadius * std::cos(Angle);
+		const auto Sine = InRadius * std::sin(Angle);
+
+		switch (InAxis)
+		{
+			case 0u:
+				return DirectX::XMFLOAT3 {InCenter.x + Cosine, InCenter.y + Sine, InCenter.z};
+			case 1u:
+				return DirectX::XMFLOAT3 {InCenter.x + Cosine, InCenter.y, InCenter.z + Sine};
+			default:
+				return DirectX::XMFLOAT3 {InCenter.x, InCenter.y + Cosine, InCenter.z + Sine};
+		}
+	};
+
+	for (unsigned int Axis = 0u; Axis < 3u; ++Axis)
+	{
+		for (unsigned int Segment = 0u; Segment < CircleSegmentNum; ++Segment)
+		{
+			Vertices.push_back({PointAt(Axis, Segment), Color});
+			Vertices.push_back({PointAt(Axis, Segment + 1u), Color});
+		}
+	}
+}
+
+void DebugDraw::Frustum(DirectX::FXMMATRIX InViewProjection, const DirectX::XMFLOAT4& InColor, const bool bInIsOnTop)
+{
+	if (!bIsEnabled)
+	{
+		return;
+	}
+
+	// The clip space box in the corner order of BoundingBox, near at depth zero.
+	constexpr float CornerSigns[DirectX::BoundingBox::CORNER_COUNT][3] =
+	{
+		{-1.0f, -1.0f, 1.0f}, {1.0f, -1.0f, 1.0f}, {1.0f, 1.0f, 1.0f}, {-1.0f, 1.0f, 1.0f},
+		{-1.0f, -1.0f, 0.0f}, {1.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {-1.0f, 1.0f, 0.0f}
+	};
+
+	const auto InverseViewProjection = DirectX::XMMatrixInverse(nullptr, InViewProjection);
+	DirectX::XMFLOAT3 Corners[DirectX::BoundingBox::CORNER_COUNT];
+
+	for (size_t Index = 0u; Index < std::size(Corners); ++Index)
+	{
+		const auto ClipCorner = DirectX::XMVectorSet(CornerSigns[Index][0], CornerSigns[Index][1], CornerSigns[Index][2], 1.0f);
+		DirectX::XMStoreFloat3(&Corners[Index], DirectX::XMVector3TransformCoord(ClipCorner, InverseViewProjection));
+	}
+
+	AddEdges(Corners, InColor, bInIsOnTop);
+}
+
+void DebugDraw::AddEdges(const DirectX::XMFLOAT3* InCorners, const DirectX::XMFLOAT4& InColor, const bool bInIsOnTop)
+{
+	// Around the positive z face, around the negative z face, then the four joining them.
+	constexpr unsigned char Edges[12][2] =
+	{
+		{0u, 1u}, {1u, 2u}, {2u, 3u}, {3u, 0u},
+		{4u, 5u}, {5u, 6u}, {6u, 7u}, {7u, 4u},
+		{0u, 4u}, {1u, 5u}, {2u, 6u}, {3u, 7u}
+	};
+
+	auto& Vertices = bInIsOnTop ? OnTopVertices : TestedVertices;
+	const auto Color = PackColor(InColor);
+
+	for (const auto& [From, To] : Edges)
+	{
+		Vertices.push_back({InCorners[From], Color});
+		Vertices.push_back({InCorners[To], Color});
+	}
+}
+
+void DebugDraw::Flush(const Graphics& InGraphics)
+{
+	// Whole lines only, the depth tested ones keep their place when the frame has more than fits.
+	const auto TestedNum = static_cast<UINT>(std::min<size_t>(TestedVertices.size(), MaxVertexNum));
+	const auto OnTopNum = static_cast<UINT>(std::min<size_t>(OnTopVertices.size(), MaxVertexNum - TestedNum));
+	LastLineNum = (TestedNum + OnTopNum) / 2u;
+
+	if (TestedNum + OnTopNum == 0u)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Debug lines");
+
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	auto* const Context = ImmediateContext.GetDeviceContext();
+	auto& Cache = ImmediateContext.GetStateCache();
+
+	// Behind what earlier flushes wrote, which the GPU may still be drawing from, and only discarded once that runs out.
+	D3D11_MAP MapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	if (WriteCursor + TestedNum + OnTopNum > MaxVertexNum)
+	{
+		MapType = D3D11_MAP_WRITE_DISCARD;
+		WriteCursor = 0u;
+	}
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	CHECK_HRESULT_EXCEPTION(Context->Map(VertexBuffer.Get(), 0u, MapType, 0u, &MappedResource))
+
+	auto* const Destination = static_cast<Vertex*>(MappedResource.pData) + WriteCursor;
+	std::memcpy(Destination, TestedVertices.data(), TestedNum * sizeof(Vertex));
+	std::memcpy(Destination + TestedNum, OnTopVertices.data(), OnTopNum * sizeof(Vertex));
+	Context->Unmap(VertexBuffer.Get(), 0u);
+	Cache.CountUpload((TestedNum + OnTopNum) * sizeof(Vertex));
+
+	InGraphics.BindFrameState(ImmediateContext);
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+	Cache.SetInputLayout(InputLayout.Get());
+	Cache.SetVertexBuffer(0u, VertexBuffer.Get(), sizeof(Vertex));
+	Cache.SetVertexShader(VertexShader.Get());
+	Cache.SetHullShader(nullptr);
+	Cache.SetDomainShader(nullptr);
+	Cache.SetPixelShader(PixelShader.Get());
+	Cache.SetBlendState(nullptr);
+	Cache.SetRasterizerState(nullptr);
+
+	if (TestedNum > 0u)
+	{
+		Cache.SetDepthStencilState(TestedDepthState.Get());
+		ImmediateContext.Draw(TestedNum, WriteCursor);
+	}
+
+	if (OnTopNum > 0u)
+	{
+		Cache.SetDepthStencilState(OnTopDepthState.Get());
+		ImmediateContext.Draw(OnTopNum, WriteCursor + TestedNum);
+	}
+
+	WriteCursor += TestedNum + OnTopNum;
+	TestedVertices.clear();
+	OnTopVertices.clear();
+}
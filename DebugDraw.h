@@ -0,0 +1,101 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Immediate mode lines for looking at bounds, light ranges and frusta, called from anywhere on the main thread during the
+ * frame instead of building a drawable per shape. Every call appends line vertices on the CPU, Flush copies the frame's
+ * vertices in one map behind what the GPU may still read in one dynamic vertex buffer, starting over at its front with a
+ * discard once it is full, and draws them in at most two draws, depth tested first and then drawn over everything.
+ * Colors are linear and go through post-processing with the scene. Off until enabled, calls while disabled return straight away.
+ */
+class DebugDraw
+{
+public:
+	// Of one frame, lines past it are dropped.
+	static constexpr UINT MaxVertexNum {131072u};
+
+	DebugDraw(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	DebugDraw(const DebugDraw&) = delete;
+	DebugDraw(DebugDraw&&) = delete;
+	DebugDraw& operator=(const DebugDraw&) = delete;
+	DebugDraw& operator=(DebugDraw&&) = delete;
+	~DebugDraw() = default;
+
+	// Hidden by what the scene drew in front of them unless bInIsOnTop.
+	void Line(const DirectX::XMFLOAT3& InFrom, const DirectX::XMFLOAT3& InTo, const DirectX::XMFLOAT4& InColor, bool bInIsOnTop = false);
+	void Box(const DirectX::BoundingBox& InBox, const DirectX::XMFLOAT4& InColor, bool bInIsOnTop = false);
+	void Box(const DirectX::BoundingOrientedBox& InBox, const DirectX::XMFLOAT4& InColor, bool bInIsOnTop = false);
+	// Its three great circles around the axes.
+	void Sphere(const DirectX::XMFLOAT3& InCenter, float InRadius, const DirectX::XMFLOAT4& InColor, bool bInIsOnTop = false);
+	// The volume a view projection matrix sees, such as a shadow face's or a frozen camera's.
+	void Frustum(DirectX::FXMMATRIX InViewProjection, const DirectX::XMFLOAT4& InColor, bool bInIsOnTop = false);
+
+	// Draws and forgets the frame's lines into the scene target with the frame's depth, after everything else.
+	void Flush(const Graphics& InGraphics);
+
+	[[nodiscard]] bool HasLines() const noexcept
+	{
+		return !TestedVertices.empty() || !OnTopVertices.empty();
+	}
+
+	// Of the last frame that had any.
+	[[nodiscard]] UINT GetLineNum() const noexcept
+	{
+		return LastLineNum;
+	}
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	// Forgets what was added this frame.
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+		TestedVertices.clear();
+		OnTopVertices.clear();
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+private:
+	struct Vertex
+	{
+		DirectX::XMFLOAT3 Position;
+		// RGBA8, red in the low byte.
+		UINT Color;
+	};
+
+	// Segments of the sphere's circles.
+	static constexpr unsigned int CircleSegmentNum {32u};
+
+	// The twelve edges of the eight corners of a box, in the order DirectXCollision's GetCorners returns them.
+	void AddEdges(const DirectX::XMFLOAT3* InCorners, const DirectX::XMFLOAT4& InColor, bool bInIsOnTop);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> PixelShader;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> InputLayout;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> VertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> TestedDepthState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> OnTopDepthState;
+
+	std::vector<Vertex> TestedVertices;
+	std::vector<Vertex> OnTopVertices;
+	// First vertex of the buffer no flush wrote since its last discard.
+	UINT WriteCursor {0u};
+	UINT LastLineNum {0u};
+	bool bIsEnabled {false};
+};
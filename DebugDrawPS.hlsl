@@ -0,0 +1,4 @@
+float4 main(const float4 InColor : Color) : SV_Target
+{
+    return InColor;
+}
@@ -0,0 +1,16 @@
+#include "FrameConstants.hlsli"
+
+struct VSOut
+{
+    float4 Color : Color;
+    float4 Position : SV_Position;
+};
+
+// Already in world space, appended by DebugDraw over the frame.
+VSOut main(const float3 InPosition : Position, const float4 InColor : Color)
+{
+    VSOut Out;
+    Out.Color = InColor;
+    Out.Position = mul(float4(InPosition, 1.0f), ViewProjection);
+    return Out;
+}
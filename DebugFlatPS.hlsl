@@ -0,0 +1,10 @@
+// The same colour all over, the wireframe's edges and the surfaces a debug view has nothing to show for.
+cbuffer Flat : register(b0)
+{
+    float4 Color;
+};
+
+float4 main() : SV_Target
+{
+    return Color;
+}
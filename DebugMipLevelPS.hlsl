@@ -0,0 +1,51 @@
+// Which level of its diffuse map a surface is sampled at, drawn by DebugViews in place of the material's pixel shader.
+// The inputs are MaterialVS.hlsl's up to the texture coordinate, like MaterialFeedbackPS.hlsl's. Every build is
+// DIFFUSE_MAPPED, NORMAL_MAPPED ones also get the tangents and TEXTURE_ARRAYS ones read the size of the array's slices.
+// Blue where texels are magnified, then green at the finest level bound through yellow and orange to red three levels
+// coarser and beyond, where the finer levels are never seen.
+#if TEXTURE_ARRAYS
+Texture2DArray DiffuseMap : register(t0);
+#else
+Texture2D DiffuseMap : register(t0);
+#endif
+
+float4 main(const float3 InWorldPosition : Position,
+            const float3 InWorldNormal : Normal,
+#if NORMAL_MAPPED
+            const float3 InWorldTangent : Tangent,
+            const float3 InWorldBitangent : Bitangent,
+#endif
+            const float2 InTextureCoordinate : TexCoord) : SV_Target
+{
+    uint Width;
+    uint Height;
+#if TEXTURE_ARRAYS
+    uint SliceNum;
+    DiffuseMap.GetDimensions(Width, Height, SliceNum);
+#else
+    DiffuseMap.GetDimensions(Width, Height);
+#endif
+
+    // Of the coarser axis, like the hardware picks the level for an isotropic sample.
+    const float2 Texels = InTextureCoordinate * float2(Width, Height);
+    const float Footprint = max(length(ddx(Texels)), length(ddy(Texels)));
+    const float Level = log2(max(Footprint, 1.0e-7f));
+
+    const float3 Colors[] =
+    {
+        float3(0.0f, 0.2f, 1.0f),
+        float3(0.0f, 0.8f, 0.0f),
+        float3(1.0f, 1.0f, 0.0f),
+        float3(1.0f, 0.5f, 0.0f),
+        float3(1.0f, 0.0f, 0.0f)
+    };
+
+    // One colour per level from a level magnified on, blended between them.
+    const float Position = clamp(Level + 1.0f, 0.0f, 4.0f);
+    const uint Lower = min((uint)Position, 3u);
+    const float3 Color = lerp(Colors[Lower], Colors[Lower + 1u], Position - Lower);
+
+    // Shaded a little by the normal, so the shapes stay readable under flat colours.
+    const float Light = 0.6f + 0.4f * saturate(normalize(InWorldNormal).y * 0.5f + 0.5f);
+    return float4(Color * Light, 1.0f);
+}
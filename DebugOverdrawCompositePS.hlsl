@@ -0,0 +1,36 @@
+// The layers DebugOverdrawPS.hlsl counted under each pixel as a heatmap over the scene: black for none, then blue, green
+// at two, yellow at four, red at six and white from eight on.
+// MULTISAMPLED builds run once per sample and read the sample they write, the counter has the scene's sample count.
+#if MULTISAMPLED
+Texture2DMS<float> Counter : register(t0);
+#else
+Texture2D<float> Counter : register(t0);
+#endif
+
+float4 main(const float4 InPosition : SV_Position
+#if MULTISAMPLED
+            , const uint InSampleIndex : SV_SampleIndex
+#endif
+            ) : SV_Target
+{
+#if MULTISAMPLED
+    const float Layers = Counter.Load(int2(InPosition.xy), InSampleIndex);
+#else
+    const float Layers = Counter.Load(int3(InPosition.xy, 0));
+#endif
+
+    const float3 Colors[] =
+    {
+        float3(0.0f, 0.0f, 0.0f),
+        float3(0.0f, 0.1f, 0.8f),
+        float3(0.0f, 0.8f, 0.0f),
+        float3(1.0f, 1.0f, 0.0f),
+        float3(1.0f, 0.0f, 0.0f),
+        float3(1.0f, 1.0f, 1.0f)
+    };
+
+    // A colour at zero and one layer, then every second layer up to eight.
+    const float Position = Layers <= 1.0f ? Layers : min(1.0f + (Layers - 1.0f) * 0.5f, 5.0f);
+    const uint Lower = min((uint)Position, 4u);
+    return float4(lerp(Colors[Lower], Colors[Lower + 1u], Position - Lower), 1.0f);
+}
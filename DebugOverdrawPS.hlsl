@@ -0,0 +1,5 @@
+// One more layer under the pixel, added onto the overdraw counter by DebugViews' additive blend.
+float main() : SV_Target
+{
+    return 1.0f;
+}
@@ -0,0 +1,282 @@
+﻿#include "DebugViews.h"
+#include <algorithm>
+#include <DirectXMath.h>
+#include <iterator>
+#include "BindManager.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "Material.h"
+#include "PixelShader.h"
+#include "ShaderBundle.h"
+#include "imgui/imgui.h"
+
+namespace
+{
+	// The bundle's MULTISAMPLED build of DebugOverdrawCompositePS.hlsl, see the ShaderVariant items in Engine.vcxproj.
+	constexpr unsigned int MultisampledComposite {1u};
+
+	// What the views' shaders read from their ConstantSlot, see DebugFlatPS.hlsl and DebugComplexityPS.hlsl.
+	struct ViewConstants
+	{
+		DirectX::XMFLOAT4 Value;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CreateConstants(ID3D11Device* InDevice, const DirectX::XMFLOAT4& InValue)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC BufferDesc {};
+		BufferDesc.ByteWidth = sizeof(ViewConstants);
+		BufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		BufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+		const ViewConstants Constants {InValue};
+		D3D11_SUBRESOURCE_DATA InitialData {};
+		InitialData.pSysMem = &Constants;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&BufferDesc, &InitialData, &Buffer))
+		return Buffer;
+	}
+
+	constexpr const char* ModeNames[] = {"None", "Overdraw", "Shader complexity", "Wireframe", "Mip level"};
+}
+
+DebugViews::DebugViews(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, const UINT InWidth, const UINT InHeight, const UINT InSampleNum)
+	: SampleNum(InSampleNum)
+{
+	HRESULT ResultHandle;
+
+	CreateCounter(InDevice, InWidth, InHeight);
+
+	const auto OverdrawBlob = InShaderBundle.Load("DebugOverdrawPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(OverdrawBlob->GetBufferPointer(), OverdrawBlob->GetBufferSize(), nullptr, &OverdrawShader))
+
+	const auto ComplexityBlob = InShaderBundle.Load("DebugComplexityPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(ComplexityBlob->GetBufferPointer(), ComplexityBlob->GetBufferSize(), nullptr, &ComplexityShader))
+
+	const auto FlatBlob = InShaderBundle.Load("DebugFlatPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(FlatBlob->GetBufferPointer(), FlatBlob->GetBufferSize(), nullptr, &FlatShader))
+
+	// Indexed like Find picks them, every build is DIFFUSE_MAPPED.
+	constexpr unsigned int MipLevelFeatures[] =
+	{
+		Material::DiffuseMapped,
+		Material::DiffuseMapped | Material::NormalMapped,
+		Material::DiffuseMapped | Material::TextureArrays,
+		Material::DiffuseMapped | Material::NormalMapped | Material::TextureArrays
+	};
+	static_assert(std::size(MipLevelFeatures) == MipLevelVariantNum, "One feature set per variant");
+
+	for (unsigned int Variant = 0u; Variant < MipLevelVariantNum; ++Variant)
+	{
+		const auto MipLevelBlob = InShaderBundle.Load("DebugMipLevelPS", MipLevelFeatures[Variant]);
+		CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(MipLevelBlob->GetBufferPointer(), MipLevelBlob->GetBufferSize(), nullptr, &MipLevelShaders[Variant]))
+	}
+
+	const auto VertexBlob = InShaderBundle.Load("FullscreenVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &CompositeVertexShader))
+
+	// Multisampled counters are read per sample, each one counts the layers that covered it.
+	const auto CompositeBlob = InShaderBundle.Load("DebugOverdrawCompositePS", InSampleNum > 1u ? MultisampledComposite : ShaderBundle::NoFeatures);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(CompositeBlob->GetBufferPointer(), CompositeBlob->GetBufferSize(), nullptr, &CompositeShader))
+
+	// Each level the middle of its step, the shader maps zero to one onto the colours.
+	for (unsigned int Level = 0u; Level < CostLevelNum; ++Level)
+	{
+		CostConstants[Level] = CreateConstants(InDevice, {(static_cast<float>(Level) + 0.5f) / CostLevelNum, 0.0f, 0.0f, 0.0f});
+	}
+
+	UnmappedConstants = CreateConstants(InDevice, {0.25f, 0.25f, 0.25f, 1.0f});
+	EdgeConstants = CreateConstants(InDevice, {0.9f, 0.9f, 0.9f, 1.0f});
+
+	D3D11_BLEND_DESC BlendDesc {};
+	auto& Target = BlendDesc.RenderTarget[0];
+	Target.BlendEnable = TRUE;
+	Target.SrcBlend = D3D11_BLEND_ONE;
+	Target.DestBlend = D3D11_BLEND_ONE;
+	Target.BlendOp = D3D11_BLEND_OP_ADD;
+	Target.SrcBlendAlpha = D3D11_BLEND_ONE;
+	Target.DestBlendAlpha = D3D11_BLEND_ONE;
+	Target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	Target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBlendState(&BlendDesc, &AdditiveBlendState))
+
+	// Pulled towards the camera, so the edges pass the depth test against the surfaces they outline. Both sides, the depth
+	// test hides the back faces' edges anyway.
+	D3D11_RASTERIZER_DESC RasterizerDesc {};
+	RasterizerDesc.FillMode = D3D11_FILL_WIREFRAME;
+	RasterizerDesc.CullMode = D3D11_CULL_NONE;
+	RasterizerDesc.DepthBias = -100;
+	RasterizerDesc.SlopeScaledDepthBias = -1.0f;
+	RasterizerDesc.DepthClipEnable = TRUE;
+	RasterizerDesc.AntialiasedLineEnable = TRUE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateRasterizerState(&RasterizerDesc, &WireframeState))
+
+	D3D11_DEPTH_STENCIL_DESC DepthStencilDesc {};
+	DepthStencilDesc.DepthEnable = FALSE;
+	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DepthStencilDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&DepthStencilDesc, &CompositeDepthState))
+}
+
+void DebugViews::Resize(ID3D11Device* InDevice, const UINT InWidth, const UINT InHeight)
+{
+	CreateCounter(InDevice, InWidth, InHeight);
+}
+
+void DebugViews::CreateCounter(ID3D11Device* InDevice, const UINT InWidth, const UINT InHeight)
+{
+	HRESULT ResultHandle;
+
+	// Drawn with the frame's depth, so with the scene's sample count.
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = InWidth;
+	TextureDesc.Height = InHeight;
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = CounterFormat;
+	TextureDesc.SampleDesc.Count = SampleNum;
+	TextureDesc.SampleDesc.Quality = 0u;
+	TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	TextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, nullptr, &Texture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(Texture.Get(), nullptr, &OwnedCounterTargetView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Texture.Get(), nullptr, &CounterView))
+	CounterTargetView = OwnedCounterTargetView.Get();
+}
+
+void DebugViews::Prepare()
+{
+	Substitutions.clear();
+
+	if (Mode != DebugViewMode::ShaderComplexity && Mode != DebugViewMode::MipLevel)
+	{
+		return;
+	}
+
+	// Every frame while the view is on, so shaders that were loaded or reloaded since are looked up too.
+	for (const auto& Shader : BindManager::GetAll<PixelShader>())
+	{
+		if (Mode == DebugViewMode::ShaderComplexity)
+		{
+			const auto Level = std::min(Shader->GetReflection().GetInstructionNum() * CostLevelNum / (2u * ExpensiveInstructionNum), CostLevelNum - 1u);
+			Substitutions.emplace(Shader->GetShader(), Substitution {ComplexityShader.Get(), CostConstants[Level].Get()});
+			continue;
+		}
+
+		// Only the material shaders draw behind its vertex shader, whose outputs the mip level builds read. Those without
+		// a diffuse map have no texture coordinates.
+		const auto Features = Shader->GetFeatures();
+		const bool bIsMaterial = Shader->GetFileName() == Material::PixelShaderName || Shader->GetFileName() == Material::TransparentPixelShaderName;
+
+		if (bIsMaterial && (Features & Material::DiffuseMapped))
+		{
+			const auto Variant = (Features & Material::NormalMapped ? 1u : 0u) | (Features & Material::TextureArrays ? 2u : 0u);
+			Substitutions.emplace(Shader->GetShader(), Substitution {MipLevelShaders[Variant].Get(), nullptr});
+		}
+	}
+}
+
+DebugViews::Substitution DebugViews::Find(ID3D11PixelShader* InShader) const noexcept
+{
+	switch (Mode)
+	{
+	case DebugViewMode::Overdraw:
+		return {OverdrawShader.Get(), nullptr};
+	case DebugViewMode::Wireframe:
+		return {FlatShader.Get(), EdgeConstants.Get()};
+	default:
+		break;
+	}
+
+	const auto Found = Substitutions.find(InShader);
+	return Found == Substitutions.end() ? Substitution {FlatShader.Get(), UnmappedConstants.Get()} : Found->second;
+}
+
+void DebugViews::Substitute(StateCache& InOutCache, ID3D11PixelShader* InShader, ID3D11RasterizerState* InRasterizerState) const noexcept
+{
+	const auto [Shader, Constants] = Find(InShader);
+
+	InOutCache.SetPixelShader(Shader);
+
+	if (Constants)
+	{
+		InOutCache.SetPixelConstantBuffer(ConstantSlot, Constants);
+	}
+
+	// Two-sided surfaces stay two-sided, and only the counted layers blend.
+	InOutCache.SetRasterizerState(Mode == DebugViewMode::Wireframe ? WireframeState.Get() : InRasterizerState);
+	InOutCache.SetBlendState(Mode == DebugViewMode::Overdraw ? AdditiveBlendState.Get() : nullptr);
+}
+
+void DebugViews::Clear(const Graphics& InGraphics) const noexcept
+{
+	constexpr float Empty[] = {0.0f, 0.0f, 0.0f, 0.0f};
+	InGraphics.GetImmediateContext().GetDeviceContext()->ClearRenderTargetView(CounterTargetView, Empty);
+}
+
+void DebugViews::Composite(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Overdraw heatmap");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+
+	// Over the whole scene target, background included, which counts no layers.
+	InGraphics.BindSceneTarget(Context);
+	Cache.SetBlendState(nullptr);
+	Cache.SetDepthStencilState(CompositeDepthState.Get());
+	Cache.SetRasterizerState(nullptr);
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	Cache.SetInputLayout(nullptr);
+	Cache.SetVertexShader(CompositeVertexShader.Get());
+	Cache.SetHullShader(nullptr);
+	Cache.SetDomainShader(nullptr);
+	Cache.SetPixelShader(CompositeShader.Get());
+	Cache.SetPixelShaderResource(CounterSlot, CounterView.Get());
+
+	Context.GetDeviceContext()->Draw(3u, 0u);
+	Cache.CountDraw(3u, 1u);
+
+	// The material maps share the slot, and the counter is drawn into again next frame.
+	Cache.SetPixelShaderResource(CounterSlot, nullptr);
+	InGraphics.BindFrameState(Context);
+}
+
+void DebugViews::ShowControlWindow() noexcept
+{
+	if (ImGui::Begin("Debug view"))
+	{
+		auto Selected = static_cast<int>(Mode);
+
+		for (int Index = 0; Index < static_cast<int>(std::size(ModeNames)); ++Index)
+		{
+			ImGui::RadioButton(ModeNames[Index], &Selected, Index);
+		}
+
+		Mode = static_cast<DebugViewMode>(Selected);
+
+		switch (Mode)
+		{
+		case DebugViewMode::Overdraw:
+			ImGui::TextUnformatted("Layers shaded per pixel: 1 blue, 2 green, 4 yellow, 6 red, 8 and more white");
+			ImGui::TextUnformatted("A depth pre-pass keeps opaque surfaces at one layer");
+			break;
+		case DebugViewMode::ShaderComplexity:
+			ImGui::Text("Pixel shader instructions: green none, red %u, white %u and more", ExpensiveInstructionNum, 2u * ExpensiveInstructionNum);
+			ImGui::TextUnformatted("Grey for shaders not loaded through the bind manager");
+			break;
+		case DebugViewMode::MipLevel:
+			ImGui::TextUnformatted("Diffuse map level: blue magnified, green 0, yellow 1, orange 2, red 3 and coarser");
+			ImGui::TextUnformatted("Counted from the finest level resident, grey without a diffuse map");
+			break;
+		default:
+			break;
+		}
+	}
+
+	ImGui::End();
+}
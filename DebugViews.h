@@ -0,0 +1,146 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <cstdint>
+#include <d3d11.h>
+#include <span>
+#include <unordered_map>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+class StateCache;
+
+enum class DebugViewMode : uint8_t
+{
+	None,
+	// Layers of pixel shading per pixel, added into a counter target and drawn as a heatmap over the scene.
+	Overdraw,
+	// Each surface in the colour of its pixel shader's instruction count, from the green of cheap shaders to the white of the
+	// most expensive.
+	ShaderComplexity,
+	// The shaded scene with every edge drawn over it.
+	Wireframe,
+	// Each diffuse mapped surface in the colour of the mip level its map is sampled at, magnified texels blue.
+	MipLevel
+};
+
+/**
+ * Views of the scene for finding expensive content, drawn through the regular submission of every drawable. While one is on,
+ * the render queue records the shaded draws with the view's pixel shader in place of their own, depth-only and alpha test
+ * draws keep theirs so cut-outs stay cut out. The views that replace the shading draw every surface forward and skip the
+ * order-independent targets and the fog, the wireframe draws the queue a second time over the finished scene.
+ * Particles and debug lines draw over every view as usual. Nothing is drawn differently while the mode is None.
+ */
+class DebugViews
+{
+public:
+	static constexpr DXGI_FORMAT CounterFormat {DXGI_FORMAT_R16_FLOAT};
+	// The shader complexity view turns white from twice this on.
+	static constexpr unsigned int ExpensiveInstructionNum {400u};
+
+	DebugViews(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, UINT InWidth, UINT InHeight, UINT InSampleNum);
+	DebugViews(const DebugViews&) = delete;
+	DebugViews(DebugViews&&) = delete;
+	DebugViews& operator=(const DebugViews&) = delete;
+	DebugViews& operator=(DebugViews&&) = delete;
+	~DebugViews() = default;
+
+	// The counter again at InWidth by InHeight, with the sample count it was created with.
+	void Resize(ID3D11Device* InDevice, UINT InWidth, UINT InHeight);
+
+	void SetMode(const DebugViewMode InMode) noexcept
+	{
+		Mode = InMode;
+	}
+
+	[[nodiscard]] DebugViewMode GetMode() const noexcept
+	{
+		return Mode;
+	}
+
+	// Whether the frame's shaded draws are recorded with the view's pixel shaders instead of lit.
+	[[nodiscard]] bool ReplacesShading() const noexcept
+	{
+		return Mode == DebugViewMode::Overdraw || Mode == DebugViewMode::ShaderComplexity || Mode == DebugViewMode::MipLevel;
+	}
+
+	// Whether draws recorded right now substitute, the wireframe only does during its own pass.
+	[[nodiscard]] bool IsSubstituting() const noexcept
+	{
+		return ReplacesShading() || bIsDrawingWireframe;
+	}
+
+	// Looks up what replaces each pixel shader the loaded materials and pipelines use, on the main thread before anything
+	// records. Does nothing while no view substitutes.
+	void Prepare();
+
+	// Binds the view's pixel shader and states for a draw that would have used InShader with InRasterizerState. Recording
+	// threads call it, only the lookup Prepare built is read.
+	void Substitute(StateCache& InOutCache, ID3D11PixelShader* InShader, ID3D11RasterizerState* InRasterizerState) const noexcept;
+
+	// The counter the shaded passes draw into instead of the scene, empty unless the overdraw view is on.
+	[[nodiscard]] std::span<ID3D11RenderTargetView* const> GetTargets() const noexcept
+	{
+		return Mode == DebugViewMode::Overdraw ? std::span<ID3D11RenderTargetView* const> {&CounterTargetView, 1u} : std::span<ID3D11RenderTargetView* const> {};
+	}
+
+	// No layers yet, on the immediate context before the frame's draws.
+	void Clear(const Graphics& InGraphics) const noexcept;
+	// Draws the counted layers over the scene as a heatmap on the immediate context, then binds the frame state again.
+	void Composite(const Graphics& InGraphics);
+
+	// Draws the commands InDraw records again, as edges over what is there already.
+	template<typename Function>
+	void DrawWireframe(Function&& InDraw)
+	{
+		bIsDrawingWireframe = true;
+		InDraw();
+		bIsDrawingWireframe = false;
+	}
+
+	void ShowControlWindow() noexcept;
+
+private:
+	struct Substitution
+	{
+		ID3D11PixelShader* Shader;
+		// Bound to ConstantSlot, null when the shader reads none.
+		ID3D11Buffer* Constants;
+	};
+
+	// Registers in the Debug*PS.hlsl shaders.
+	static constexpr UINT ConstantSlot {0u};
+	static constexpr UINT CounterSlot {0u};
+	// Complexity colours are told apart in this many steps from no instructions to twice ExpensiveInstructionNum.
+	static constexpr unsigned int CostLevelNum {32u};
+	// Variants of DebugMipLevelPS.hlsl, by whether the material is normal mapped and whether its maps are array slices.
+	static constexpr unsigned int MipLevelVariantNum {4u};
+
+	void CreateCounter(ID3D11Device* InDevice, UINT InWidth, UINT InHeight);
+	[[nodiscard]] Substitution Find(ID3D11PixelShader* InShader) const noexcept;
+
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> OverdrawShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> ComplexityShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> FlatShader;
+	std::array<Microsoft::WRL::ComPtr<ID3D11PixelShader>, MipLevelVariantNum> MipLevelShaders;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> CompositeVertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> CompositeShader;
+	std::array<Microsoft::WRL::ComPtr<ID3D11Buffer>, CostLevelNum> CostConstants;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> UnmappedConstants;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> EdgeConstants;
+	// Adds every layer's one onto the counter.
+	Microsoft::WRL::ComPtr<ID3D11BlendState> AdditiveBlendState;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> WireframeState;
+	// The composite covers the screen, it neither tests nor writes depth.
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> CompositeDepthState;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> OwnedCounterTargetView;
+	ID3D11RenderTargetView* CounterTargetView {nullptr};
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CounterView;
+	UINT SampleNum;
+
+	// Built by Prepare for the views that depend on the shader replaced, shaders it doesn't know are drawn flat grey.
+	std::unordered_map<ID3D11PixelShader*, Substitution> Substitutions;
+	DebugViewMode Mode {DebugViewMode::None};
+	bool bIsDrawingWireframe {false};
+};
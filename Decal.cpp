@@ -0,0 +1,59 @@
+﻿#include "Decal.h"
+#include "Graphics.h"
+
+Decal::Decal(const Graphics& InGraphics, const std::string& InFileName)
+	: AtlasRegion(InGraphics.GetDecalAtlas().Resolve(InGraphics.GetImmediateContext().GetDeviceContext(), InFileName))
+{
+}
+
+void Decal::SetPosition(const DirectX::XMFLOAT3 InPosition) noexcept
+{
+	Position = InPosition;
+}
+
+void Decal::SetRotation(const float InPitch, const float InYaw, const float InRoll) noexcept
+{
+	Pitch = InPitch;
+	Yaw = InYaw;
+	Roll = InRoll;
+}
+
+void Decal::SetExtents(const DirectX::XMFLOAT3 InExtents) noexcept
+{
+	Extents = InExtents;
+}
+
+void Decal::SetColor(const DirectX::XMFLOAT3 InColor) noexcept
+{
+	Color = InColor;
+}
+
+void Decal::SetOpacity(const float InOpacity) noexcept
+{
+	Opacity = InOpacity;
+}
+
+void Decal::Bind(const Graphics& InGraphics) const noexcept
+{
+	if (!AtlasRegion)
+	{
+		return;
+	}
+
+	// The rows the shaders take dot products with are the columns of the inverse.
+	const auto DecalToWorld = DirectX::XMMatrixScaling(Extents.x, Extents.y, Extents.z) *
+	                          DirectX::XMMatrixRotationRollPitchYaw(Pitch, Yaw, Roll) *
+	                          DirectX::XMMatrixTranslation(Position.x, Position.y, Position.z);
+	const auto WorldToDecal = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, DecalToWorld));
+
+	ClusteredLighting::DecalData Data {};
+	Data.WorldPosition = Position;
+	DirectX::XMStoreFloat4(&Data.WorldToDecal[0], WorldToDecal.r[0]);
+	DirectX::XMStoreFloat4(&Data.WorldToDecal[1], WorldToDecal.r[1]);
+	DirectX::XMStoreFloat4(&Data.WorldToDecal[2], WorldToDecal.r[2]);
+	Data.AtlasRegion = *AtlasRegion;
+	Data.Color = Color;
+	Data.Opacity = Opacity;
+
+	InGraphics.GetClusteredLighting().AddDecal(Data);
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <optional>
+#include <string>
+
+class Graphics;
+
+/**
+ * A box projecting an image along its z axis onto the albedo of whatever lies inside it, drawn by the clustered decals instead
+ * of as geometry of its own, so it has no draw and nothing to fight the surface's depth. The image spans the box's x and y,
+ * upright when y points up.
+ */
+class Decal
+{
+public:
+	// The image is put into the DecalAtlas right away, a decal whose image didn't fit is never added.
+	Decal(const Graphics& InGraphics, const std::string& InFileName);
+
+	void SetPosition(DirectX::XMFLOAT3 InPosition) noexcept;
+	// About x, y and z, the projection looks down -y after a pitch of a quarter turn.
+	void SetRotation(float InPitch, float InYaw, float InRoll) noexcept;
+	// Half the box along each of its axes, z is how far in front of and behind the position it reaches surfaces.
+	void SetExtents(DirectX::XMFLOAT3 InExtents) noexcept;
+	// Multiplies the image, which is blended over the surface by its alpha times the opacity.
+	void SetColor(DirectX::XMFLOAT3 InColor) noexcept;
+	void SetOpacity(float InOpacity) noexcept;
+
+	// Adds the decal to the frame's clustered decal list, call between BeginFrame and executing the render queue.
+	void Bind(const Graphics& InGraphics) const noexcept;
+
+private:
+	std::optional<DirectX::XMFLOAT4> AtlasRegion;
+	DirectX::XMFLOAT3 Position {0.0f, 0.0f, 0.0f};
+	float Pitch {0.0f};
+	float Yaw {0.0f};
+	float Roll {0.0f};
+	DirectX::XMFLOAT3 Extents {0.5f, 0.5f, 0.5f};
+	DirectX::XMFLOAT3 Color {1.0f, 1.0f, 1.0f};
+	float Opacity {1.0f};
+};
@@ -0,0 +1,96 @@
+﻿#include "DecalAtlas.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "ExceptionMacros.h"
+#include "RenderContext.h"
+#include "Surface.h"
+#include "SurfaceKernels.h"
+
+DecalAtlas::DecalAtlas(ID3D11Device* const InDevice)
+{
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = Size;
+	TextureDesc.Height = Size;
+	TextureDesc.MipLevels = MipLevels;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// Cleared, coarse levels of images that don't fill their tile filter in what lies beside them.
+	const std::vector<Surface::Color> Cleared(static_cast<size_t>(Size) * Size);
+	std::array<D3D11_SUBRESOURCE_DATA, MipLevels> InitialData;
+
+	for (UINT Level = 0u; Level < MipLevels; ++Level)
+	{
+		InitialData[Level] = {Cleared.data(), (Size >> Level) * static_cast<UINT>(sizeof(Surface::Color)), 0u};
+	}
+
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, InitialData.data(), &Texture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Texture.Get(), nullptr, &View))
+
+	// Lookups stay inside their region, clamping only matters for the edges of the atlas.
+	D3D11_SAMPLER_DESC SamplerDesc {};
+	SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateSamplerState(&SamplerDesc, &Sampler))
+}
+
+std::optional<DirectX::XMFLOAT4> DecalAtlas::Resolve(ID3D11DeviceContext* const InContext, const std::string& InFileName)
+{
+	if (const auto Found = Regions.find(InFileName); Found != Regions.end())
+	{
+		return Found->second;
+	}
+
+	auto Image = Surface::FromFile(InFileName);
+
+	while (std::max(Image.GetWidth(), Image.GetHeight()) > MaxTileSize)
+	{
+		Image = SurfaceKernels::DownsampleBox(Image, true);
+	}
+
+	const auto Tile = Allocator.Allocate(std::max(Image.GetWidth(), Image.GetHeight()));
+	auto& Region = Regions[InFileName];
+
+	if (!Tile)
+	{
+		return Region;
+	}
+
+	// The image sits in the tile's corner, what it leaves of a tile that isn't square stays unused.
+	Region = DirectX::XMFLOAT4 {static_cast<float>(Tile->X) / Size, static_cast<float>(Tile->Y) / Size,
+	                            static_cast<float>(Image.GetWidth()) / Size, static_cast<float>(Image.GetHeight()) / Size};
+
+	for (UINT Level = 0u; Level < MipLevels; ++Level)
+	{
+		if (Level > 0u)
+		{
+			Image = SurfaceKernels::DownsampleBox(Image, true);
+		}
+
+		const D3D11_BOX Box {Tile->X >> Level, Tile->Y >> Level, 0u, (Tile->X >> Level) + Image.GetWidth(), (Tile->Y >> Level) + Image.GetHeight(), 1u};
+		InContext->UpdateSubresource(Texture.Get(), Level, &Box, Image.GetBufferPtrConst(), Image.GetWidth() * sizeof(Surface::Color), 0u);
+	}
+
+	return Region;
+}
+
+void DecalAtlas::Bind(RenderContext& InContext) const noexcept
+{
+	InContext.GetStateCache().SetPixelShaderResource(AtlasSlot, View.Get());
+	InContext.GetStateCache().SetPixelSampler(SamplerSlot, Sampler.Get());
+}
+
+void DecalAtlas::BindCompute(ID3D11DeviceContext* const InContext) const noexcept
+{
+	InContext->CSSetShaderResources(AtlasSlot, 1u, View.GetAddressOf());
+	InContext->CSSetSamplers(SamplerSlot, 1u, Sampler.GetAddressOf());
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "wrl/client.h"
+#include "AtlasAllocator.h"
+
+class RenderContext;
+
+/**
+ * Every decal image in one texture, for the clustered decals to sample without a binding per decal. Each image takes a
+ * power of two tile of the atlas the first time it is asked for, with a mip chain of its own filtered on the CPU into the
+ * tile's part of every level, down to where the smallest tiles are a texel, so no level mixes two images.
+ * Images larger than MaxTileSize are halved until they fit. Colour stays in sRGB, Decals.hlsli decodes it.
+ */
+class DecalAtlas
+{
+public:
+	// Decals.hlsli names the same size.
+	static constexpr UINT Size {2048u};
+	static constexpr UINT MinTileSize {64u};
+	static constexpr UINT MaxTileSize {512u};
+	static constexpr UINT MipLevels {7u};
+	static_assert(MinTileSize >> (MipLevels - 1u) == 1u, "The last level has a texel per smallest tile");
+
+	explicit DecalAtlas(ID3D11Device* InDevice);
+	DecalAtlas(const DecalAtlas&) = delete;
+	DecalAtlas(DecalAtlas&&) = delete;
+	DecalAtlas& operator=(const DecalAtlas&) = delete;
+	DecalAtlas& operator=(DecalAtlas&&) = delete;
+	~DecalAtlas() = default;
+
+	// The image's corner and size in atlas coordinates, decoded and uploaded the first time, none once the atlas is full.
+	// Throws what Surface::FromFile throws for images that can't be read.
+	[[nodiscard]] std::optional<DirectX::XMFLOAT4> Resolve(ID3D11DeviceContext* InContext, const std::string& InFileName);
+
+	void Bind(RenderContext& InContext) const noexcept;
+	// The same slots for compute shaders that shade, straight to the context like every compute binding.
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+
+	[[nodiscard]] size_t GetImageNum() const noexcept
+	{
+		return Regions.size();
+	}
+
+private:
+	// Registers in Decals.hlsli.
+	static constexpr UINT AtlasSlot {22u};
+	static constexpr UINT SamplerSlot {3u};
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> Sampler;
+	AtlasAllocator Allocator {Size, MinTileSize};
+	// By file name, images that didn't fit are remembered as none.
+	std::unordered_map<std::string, std::optional<DirectX::XMFLOAT4>> Regions;
+};
@@ -0,0 +1,62 @@
+// Clustered decals, see ClusteredLighting and DecalAtlas. After PointLight.hlsli and ShaderOperations.hlsli, it reads the cluster
+// constants of the one and decodes sRGB like the other.
+StructuredBuffer<DecalData> Decals : register(t19);
+StructuredBuffer<uint> ClusterDecalCounts : register(t20);
+StructuredBuffer<uint> ClusterDecalIndices : register(t21);
+// Colour in sRGB and coverage in alpha, the same size as DecalAtlas::Size.
+Texture2D DecalAtlas : register(t22);
+SamplerState DecalSampler : register(s3);
+
+static const float DecalAtlasSize = 2048.0f;
+// Surfaces the projection meets at a slant fade out between these cosines, those it grazes or that face away get nothing.
+static const float DecalMinFacing = 0.1f;
+static const float DecalFullFacing = 0.4f;
+// The last part of the box along the projection fades out, so the decal doesn't end in a hard line across the surface.
+static const float DecalDepthFade = 0.25f;
+
+// Blends the decals of the pixel's cluster over the linear albedo, in the order they were added. The world position's
+// gradients across the pixel pick the atlas level, compute shaders work them out from their neighbours.
+float3 ApplyDecals(float3 InAlbedo, const float2 InPixelPosition, const float3 InWorldPosition, const float3 InWorldNormal,
+                   const float3 InWorldPositionDx, const float3 InWorldPositionDy)
+{
+    if (bIsUnclustered || DecalNum == 0u)
+    {
+        return InAlbedo;
+    }
+
+    const uint ClusterIndex = FindClusterIndex(InPixelPosition, InWorldPosition);
+    const uint First = ClusterIndex * MaxDecalsPerCluster;
+    const uint Num = ClusterDecalCounts[ClusterIndex];
+    const float4 Position = float4(InWorldPosition, 1.0f);
+
+    for (uint Index = 0u; Index < Num; ++Index)
+    {
+        const DecalData Decal = Decals[ClusterDecalIndices[First + Index]];
+        const float3 Local = float3(dot(Position, Decal.WorldToDecal[0]), dot(Position, Decal.WorldToDecal[1]), dot(Position, Decal.WorldToDecal[2]));
+
+        if (any(abs(Local) > 1.0f))
+        {
+            continue;
+        }
+
+        const float Facing = smoothstep(DecalMinFacing, DecalFullFacing, -dot(InWorldNormal, normalize(Decal.WorldToDecal[2].xyz)));
+        const float Fade = Facing * saturate((1.0f - abs(Local.z)) / DecalDepthFade);
+
+        if (Fade <= 0.0f)
+        {
+            continue;
+        }
+
+        // Image y points down while decal y points up, kept half a texel inside the region so filtering doesn't reach its neighbours.
+        const float2 Scale = float2(0.5f, -0.5f) * Decal.AtlasRegion.zw;
+        const float2 HalfTexel = 0.5f / DecalAtlasSize;
+        const float2 Coordinate = clamp(Decal.AtlasRegion.xy + 0.5f * Decal.AtlasRegion.zw + Local.xy * Scale, Decal.AtlasRegion.xy + HalfTexel, Decal.AtlasRegion.xy + Decal.AtlasRegion.zw - HalfTexel);
+        const float2 CoordinateDx = float2(dot(InWorldPositionDx, Decal.WorldToDecal[0].xyz), dot(InWorldPositionDx, Decal.WorldToDecal[1].xyz)) * Scale;
+        const float2 CoordinateDy = float2(dot(InWorldPositionDy, Decal.WorldToDecal[0].xyz), dot(InWorldPositionDy, Decal.WorldToDecal[1].xyz)) * Scale;
+        const float4 Sample = DecalAtlas.SampleGrad(DecalSampler, Coordinate, CoordinateDx, CoordinateDy);
+
+        InAlbedo = lerp(InAlbedo, SrgbToLinear(Sample.rgb) * Decal.Color, Sample.a * Decal.Opacity * Fade);
+    }
+
+    return InAlbedo;
+}
@@ -0,0 +1,102 @@
+// Lights what the G-buffer pass wrote, one thread per pixel in 8x8 tiles, with the same cluster light lists and shading as MaterialPS.hlsl.
+// Pixels no G-buffer draw covered keep what the scene holds, the forward passes after it still draw there. Decals are blended
+// over the decoded albedo here, as the forward build of MaterialPS.hlsl blends them before lighting.
+#include "GBuffer.hlsli"
+#include "PointLight.hlsli"
+#include "ShaderOperations.hlsli"
+#include "DirectionalLight.hlsli"
+#include "Decals.hlsli"
+
+Texture2D<float4> AlbedoSpecular : register(t0);
+Texture2D<float4> NormalPower : register(t1);
+Texture2D<float> Depth : register(t2);
+RWTexture2D<float4> Scene : register(u0);
+
+cbuffer Deferred : register(b0)
+{
+    matrix InverseViewProjection;
+    float3 CameraPosition;
+    float DeferredPadding;
+    // The part of the targets this frame renders to, from their top left.
+    float2 ViewportSize;
+    float2 ViewportPadding;
+}
+
+// Back from the depth buffer to where the pixel shader saw the surface, through the pixel's center.
+float3 LoadWorldPosition(const uint2 InPixel)
+{
+    const float2 PixelPosition = InPixel + 0.5f;
+    const float2 Ndc = float2(PixelPosition.x / ViewportSize.x * 2.0f - 1.0f, 1.0f - PixelPosition.y / ViewportSize.y * 2.0f);
+    const float4 HomogeneousPosition = mul(float4(Ndc, Depth[InPixel], 1.0f), InverseViewProjection);
+    return HomogeneousPosition.xyz / HomogeneousPosition.w;
+}
+
+// What ddx or ddy would have given the pixel shader, from the neighbour on the side closer in depth so edges don't pick the
+// decal atlas's coarsest level.
+float3 GetWorldPositionDelta(const float3 InWorldPosition, const uint2 InPixel, const uint2 InStep)
+{
+    const uint2 Last = (uint2) ViewportSize - 1u;
+    const float3 Forward = LoadWorldPosition(min(InPixel + InStep, Last)) - InWorldPosition;
+    const float3 Backward = InWorldPosition - LoadWorldPosition(InPixel - min(InPixel, InStep));
+    return dot(Forward, Forward) < dot(Backward, Backward) ? Forward : Backward;
+}
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= (uint2) ViewportSize))
+    {
+        return;
+    }
+
+    const GBufferSurface Surface = DecodeGBuffer(AlbedoSpecular[InThreadID.xy], NormalPower[InThreadID.xy]);
+
+    if (Surface.SpecularMode == SpecularModeEmpty)
+    {
+        return;
+    }
+
+    const float2 PixelPosition = InThreadID.xy + 0.5f;
+    const float3 WorldPosition = LoadWorldPosition(InThreadID.xy);
+    float3 Albedo = Surface.Albedo;
+
+    if (DecalNum != 0u)
+    {
+        Albedo = ApplyDecals(Albedo, PixelPosition, WorldPosition, Surface.WorldNormal, GetWorldPositionDelta(WorldPosition, InThreadID.xy, uint2(1u, 0u)),
+                             GetWorldPositionDelta(WorldPosition, InThreadID.xy, uint2(0u, 1u)));
+    }
+
+    const float3 VectorToCamera = CameraPosition - WorldPosition;
+
+    float3 Diffuse = float3(0.0f, 0.0f, 0.0f);
+    float3 Specular = float3(0.0f, 0.0f, 0.0f);
+
+    const ClusterLights Cluster = GetClusterLights(PixelPosition, WorldPosition);
+
+    for (uint Index = 0u; Index < Cluster.Num; ++Index)
+    {
+        const PointLightData Light = GetClusterLight(Cluster, Index);
+
+        const float3 VectorToLight = Light.WorldPosition - WorldPosition;
+        const float DistanceToLight = length(VectorToLight);
+
+        if (DistanceToLight >= Light.Range)
+        {
+            continue;
+        }
+
+        const float3 DirectionToLight = VectorToLight / DistanceToLight;
+        const float Attenuation = GetShadowFactor(Light, VectorToLight) * CalcAttenuate(Light.QuadraticAttenuation, Light.LinearAttenuation, Light.ConstantAttenuation, DistanceToLight);
+        const float3 SpecularColor = Surface.SpecularMode == SpecularModeTinted ? float3(1.0f, 1.0f, 1.0f) : Light.DiffuseColor * Light.DiffuseStrength;
+
+        Diffuse += CalcDiffuse(Light.DiffuseColor, Light.DiffuseStrength, Attenuation, DirectionToLight, Surface.WorldNormal);
+        Specular += CalcSpeculate(SpecularColor, Surface.SpecularIntensity, Surface.WorldNormal, VectorToLight, VectorToCamera, Attenuation, Surface.SpecularPower);
+    }
+
+    AddSunLight(WorldPosition, Surface.WorldNormal, VectorToCamera, Surface.SpecularMode == SpecularModeTinted ? float3(1.0f, 1.0f, 1.0f) : SunColor,
+                Surface.SpecularIntensity, Surface.SpecularPower, Diffuse, Specular);
+
+    Specular += Surface.SpecularIntensity * CalcReflection(WorldPosition, Surface.WorldNormal, VectorToCamera, Surface.SpecularPower, PixelPosition);
+
+    Scene[InThreadID.xy] = float4((Diffuse + CalcAmbient(AmbientColor, WorldPosition, Surface.WorldNormal, PixelPosition)) * Albedo + Specular, 1.0f);
+}
@@ -0,0 +1,78 @@
+﻿#include "DeferredShading.h"
+#include <cstring>
+#include <iterator>
+#include "Camera.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+DeferredShading::DeferredShading(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView,
+                                 ID3D11UnorderedAccessView* InSceneUav, const UINT InWidth, const UINT InHeight)
+	: DepthView(InDepthView), SceneUav(InSceneUav), Width(InWidth), Height(InHeight)
+{
+	HRESULT ResultHandle;
+
+	const auto Blob = InShaderBundle.Load("DeferredLightingCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &LightShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(DeferredConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+}
+
+void DeferredShading::Clear(const Graphics& InGraphics, ID3D11RenderTargetView* InNormalTarget) const noexcept
+{
+	constexpr float Empty[] = {0.0f, 0.0f, 0.0f, 0.0f};
+	InGraphics.GetImmediateContext().GetDeviceContext()->ClearRenderTargetView(InNormalTarget, Empty);
+}
+
+void DeferredShading::Light(const Graphics& InGraphics, ID3D11ShaderResourceView* InAlbedoView, ID3D11ShaderResourceView* InNormalView)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Deferred lighting");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+	const auto& Viewport = InGraphics.GetViewport();
+
+	DeferredConstants Constants {};
+	Constants.InverseViewProjection = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewProjectionMatrix()));
+	Constants.CameraPosition = InGraphics.GetCamera().GetPosition();
+	Constants.ViewportSize = {Viewport.Width, Viewport.Height};
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	// Depth is read and the scene written here, neither can stay bound to the output merger meanwhile.
+	Context.GetStateCache().SetRenderTarget(nullptr, nullptr);
+
+	ID3D11ShaderResourceView* const Views[] = {InAlbedoView, InNormalView, DepthView};
+	static_assert(AlbedoSlot == 0u && NormalSlot == AlbedoSlot + 1u && DepthSlot == NormalSlot + 1u, "Views are bound as one range");
+
+	DeviceContext->CSSetShader(LightShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(AlbedoSlot, static_cast<UINT>(std::size(Views)), Views);
+	DeviceContext->CSSetUnorderedAccessViews(SceneSlot, 1u, &SceneUav, nullptr);
+	InGraphics.GetClusteredLighting().BindCompute(DeviceContext);
+	InGraphics.GetDecalAtlas().BindCompute(DeviceContext);
+	InGraphics.GetPointLightShadows().BindCompute(DeviceContext);
+	InGraphics.GetDirectionalLight().BindCompute(DeviceContext);
+	InGraphics.GetAmbientOcclusion().BindCompute(DeviceContext);
+	InGraphics.GetImageBasedLighting().BindCompute(DeviceContext);
+	InGraphics.GetReflectionProbes().BindCompute(DeviceContext);
+	InGraphics.GetIrradianceVolume().BindCompute(DeviceContext);
+
+	const auto GroupNumX = (static_cast<UINT>(Viewport.Width) + GroupSize - 1u) / GroupSize;
+	const auto GroupNumY = (static_cast<UINT>(Viewport.Height) + GroupSize - 1u) / GroupSize;
+	InGraphics.Dispatch(GroupNumX, GroupNumY);
+
+	InGraphics.BindFrameState(Context);
+}
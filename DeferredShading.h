@@ -0,0 +1,99 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include "wrl/client.h"
+#include "RenderGraph.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Deferred shading for scenes with more lights than forward shading copes with. Opaque material draws write their
+ * surface into a compact G-buffer of two 32-bit targets, then one compute pass lights every covered pixel once from the
+ * cluster light lists, so the cost of the lights no longer grows with how much the scene overdraws.
+ * The layout is in GBuffer.hlsli. Blended draws, draws without a material and the occlusion retest stay forward,
+ * drawn over the lit scene afterwards.
+ */
+class DeferredShading
+{
+public:
+	static constexpr DXGI_FORMAT AlbedoFormat {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB};
+	static constexpr DXGI_FORMAT NormalFormat {DXGI_FORMAT_R10G10B10A2_UNORM};
+
+	// The depth view and the scene's UAV are Graphics', the G-buffer targets are render graph transients of InWidth by InHeight.
+	DeferredShading(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView,
+	                ID3D11UnorderedAccessView* InSceneUav, UINT InWidth, UINT InHeight);
+	DeferredShading(const DeferredShading&) = delete;
+	DeferredShading(DeferredShading&&) = delete;
+	DeferredShading& operator=(const DeferredShading&) = delete;
+	DeferredShading& operator=(DeferredShading&&) = delete;
+	~DeferredShading() = default;
+
+	// The G-buffer descs follow, the render graph hands out transients of the new size from the next frame.
+	void Resize(ID3D11ShaderResourceView* InDepthView, ID3D11UnorderedAccessView* InSceneUav, const UINT InWidth, const UINT InHeight) noexcept
+	{
+		DepthView = InDepthView;
+		SceneUav = InSceneUav;
+		Width = InWidth;
+		Height = InHeight;
+	}
+
+	[[nodiscard]] RenderGraph::TextureDesc GetAlbedoDesc() const noexcept
+	{
+		return {Width, Height, AlbedoFormat, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE};
+	}
+
+	[[nodiscard]] RenderGraph::TextureDesc GetNormalDesc() const noexcept
+	{
+		return {Width, Height, NormalFormat, D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE};
+	}
+
+	// The normal target has to start cleared, its zero alpha marks pixels no G-buffer draw covered.
+	void Clear(const Graphics& InGraphics, ID3D11RenderTargetView* InNormalTarget) const noexcept;
+	// Lights the frame's viewport into the scene on the immediate context, then binds the frame state again.
+	void Light(const Graphics& InGraphics, ID3D11ShaderResourceView* InAlbedoView, ID3D11ShaderResourceView* InNormalView);
+
+	// Takes effect from the next frame the render queue executes.
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+private:
+	struct DeferredConstants
+	{
+		DirectX::XMMATRIX InverseViewProjection;
+		DirectX::XMFLOAT3 CameraPosition;
+		float Padding;
+		DirectX::XMFLOAT2 ViewportSize;
+		DirectX::XMFLOAT2 ViewportPadding;
+	};
+
+	// Registers in DeferredLightingCS.hlsl, the cluster lists and shadow atlas keep those of PointLight.hlsli.
+	static constexpr UINT ConstantSlot {0u};
+	static constexpr UINT AlbedoSlot {0u};
+	static constexpr UINT NormalSlot {1u};
+	static constexpr UINT DepthSlot {2u};
+	static constexpr UINT SceneSlot {0u};
+	static constexpr UINT GroupSize {8u};
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> LightShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+
+	ID3D11ShaderResourceView* DepthView;
+	ID3D11UnorderedAccessView* SceneUav;
+	UINT Width;
+	UINT Height;
+	bool bIsEnabled {false};
+};
@@ -0,0 +1,19 @@
+#include "FrameConstants.hlsli"
+#include "Instancing.hlsli"
+
+struct VSOutput
+{
+    float4 Position : SV_Position;
+    float ClipDistance : SV_ClipDistance0;
+};
+
+VSOutput main(const float3 InModelPosition : Position, const uint InInstanceID : SV_InstanceID)
+{
+    const float4 WorldPosition = mul(float4(InModelPosition, 1.0f), InstanceTransforms[GetDrawnInstance(InInstanceID)].Model);
+    const EyePosition Projected = ProjectToEye(WorldPosition, InInstanceID);
+
+    VSOutput VSOutput;
+    VSOutput.Position = Projected.Position;
+    VSOutput.ClipDistance = Projected.ClipDistance;
+    return VSOutput;
+}
@@ -0,0 +1,28 @@
+#include "FrameConstants.hlsli"
+#include "Morphing.hlsli"
+
+cbuffer Transform
+{
+    matrix Model;
+};
+
+struct VSOutput
+{
+    float4 Position : SV_Position;
+    float ClipDistance : SV_ClipDistance0;
+};
+
+// Morphs in the same order MaterialVS does, the main pass only shades where depth is equal.
+VSOutput main(const float3 InModelPosition : Position, const uint InVertexID : SV_VertexID, const uint InInstanceID : SV_InstanceID)
+{
+    float3 MorphedPosition = InModelPosition;
+    float3 UnusedNormal = 0.0f;
+    ApplyMorphTargets(InVertexID, MorphedPosition, UnusedNormal);
+
+    const EyePosition Projected = ProjectToEye(mul(float4(MorphedPosition, 1.0f), Model), InInstanceID);
+
+    VSOutput VSOutput;
+    VSOutput.Position = Projected.Position;
+    VSOutput.ClipDistance = Projected.ClipDistance;
+    return VSOutput;
+}
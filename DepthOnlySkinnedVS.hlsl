@@ -0,0 +1,26 @@
+#include "FrameConstants.hlsli"
+#include "Skinning.hlsli"
+
+cbuffer Transform
+{
+    matrix Model;
+};
+
+struct VSOutput
+{
+    float4 Position : SV_Position;
+    float ClipDistance : SV_ClipDistance0;
+};
+
+// Skins in the same order MaterialVS does, the main pass only shades where depth is equal.
+VSOutput main(const float3 InModelPosition : Position, const uint4 InBoneIndices : BlendIndices, const float4 InBoneWeights : BlendWeight,
+              const uint InInstanceID : SV_InstanceID)
+{
+    const float4 SkinnedPosition = mul(float4(InModelPosition, 1.0f), GetSkinTransform(InBoneIndices, InBoneWeights));
+    const EyePosition Projected = ProjectToEye(mul(SkinnedPosition, Model), InInstanceID);
+
+    VSOutput VSOutput;
+    VSOutput.Position = Projected.Position;
+    VSOutput.ClipDistance = Projected.ClipDistance;
+    return VSOutput;
+}
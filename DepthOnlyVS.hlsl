@@ -0,0 +1,23 @@
+#include "FrameConstants.hlsli"
+
+cbuffer Transform
+{
+    matrix Model;
+};
+
+struct VSOutput
+{
+    float4 Position : SV_Position;
+    float ClipDistance : SV_ClipDistance0;
+};
+
+// Must transform exactly like the shading vertex shaders, the main pass only shades where depth is equal.
+VSOutput main(const float3 InModelPosition : Position, const uint InInstanceID : SV_InstanceID)
+{
+    const EyePosition Projected = ProjectToEye(mul(float4(InModelPosition, 1.0f), Model), InInstanceID);
+
+    VSOutput VSOutput;
+    VSOutput.Position = Projected.Position;
+    VSOutput.ClipDistance = Projected.ClipDistance;
+    return VSOutput;
+}
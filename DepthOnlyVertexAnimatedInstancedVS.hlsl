@@ -0,0 +1,22 @@
+#include "FrameConstants.hlsli"
+#include "Instancing.hlsli"
+#include "VertexAnimation.hlsli"
+
+struct VSOutput
+{
+    float4 Position : SV_Position;
+    float ClipDistance : SV_ClipDistance0;
+};
+
+// Every instance plays its own clip and time offset from the instance buffer.
+VSOutput main(const float3 InModelPosition : Position, const uint InVertexID : SV_VertexID, const uint InInstanceID : SV_InstanceID)
+{
+    const InstanceTransform Instance = InstanceTransforms[GetDrawnInstance(InInstanceID)];
+    const AnimatedVertex Animated = SampleVertexAnimation(InVertexID, Instance.Animation);
+    const EyePosition Projected = ProjectToEye(mul(float4(Animated.Position, 1.0f), Instance.Model), InInstanceID);
+
+    VSOutput VSOutput;
+    VSOutput.Position = Projected.Position;
+    VSOutput.ClipDistance = Projected.ClipDistance;
+    return VSOutput;
+}
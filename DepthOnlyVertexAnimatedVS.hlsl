@@ -0,0 +1,27 @@
+#include "FrameConstants.hlsli"
+#include "VertexAnimation.hlsli"
+
+cbuffer Transform
+{
+    matrix Model;
+    uint MaterialIndex;
+    uint Animation;
+};
+
+struct VSOutput
+{
+    float4 Position : SV_Position;
+    float ClipDistance : SV_ClipDistance0;
+};
+
+// Samples the same frames MaterialVS does, the main pass only shades where depth is equal.
+VSOutput main(const float3 InModelPosition : Position, const uint InVertexID : SV_VertexID, const uint InInstanceID : SV_InstanceID)
+{
+    const AnimatedVertex Animated = SampleVertexAnimation(InVertexID, Animation);
+    const EyePosition Projected = ProjectToEye(mul(float4(Animated.Position, 1.0f), Model), InInstanceID);
+
+    VSOutput VSOutput;
+    VSOutput.Position = Projected.Position;
+    VSOutput.ClipDistance = Projected.ClipDistance;
+    return VSOutput;
+}
@@ -0,0 +1,27 @@
+// The farthest of each pixel's depth samples, for what reads multisampled depth as a plain texture. The farthest keeps
+// the Hi-Z pyramid built from it conservative, it never holds a pixel covered nearer than any of its samples is.
+Texture2DMS<float> MultisampledDepth : register(t0);
+RWTexture2D<float> Depth : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    uint Width;
+    uint Height;
+    uint SampleNum;
+    MultisampledDepth.GetDimensions(Width, Height, SampleNum);
+
+    if (any(InThreadID.xy >= uint2(Width, Height)))
+    {
+        return;
+    }
+
+    float Farthest = 0.0f;
+
+    for (uint Sample = 0u; Sample < SampleNum; ++Sample)
+    {
+        Farthest = max(Farthest, MultisampledDepth.Load(InThreadID.xy, Sample));
+    }
+
+    Depth[InThreadID.xy] = Farthest;
+}
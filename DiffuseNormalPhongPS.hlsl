@@ -1,29 +1,11 @@
-cbuffer Light
-{
-    float3 Position;
-    float3 AmbientColor;
-    float3 DiffuseColor;
-    float DiffuseStrength;
-    float QuadraticAttenuation;
-    float LinearAttenuation;
-    float ConstantAttenuation;
-}
-
-cbuffer Material
-{
-    float SpecularIntensity;
-    float SpecularPower;
-    bool bIsNormalMapEnabled;
-    float Padding[1];
-}
-
-cbuffer Camera
-{
-    float3 CameraPosition;
-}
+#include "FrameConstants.hlsli"
+#include "MaterialConstants.hlsli"
+#include "PointLight.hlsli"
+#include "ShaderOperations.hlsli"
+#include "Decals.hlsli"
 
 Texture2D Texture;
-Texture2D NormalMap : register(t2);
+Texture2D NormalMap : register(t1);
 
 SamplerState Sampler;
 
@@ -31,31 +13,51 @@ float4 main(const float3 InWorldPosition : Position,
 			float3 InWorldNormal : Normal,
 			const float3 InTangent : Tangent,
 			const float3 InBitangent : Bitangent,
-            const float2 InTextureCoordinate : TexCoord) : SV_TARGET
+            const float2 InTextureCoordinate : TexCoord,
+            const float4 InPixelPosition : SV_Position) : SV_TARGET
 {
-    if (bIsNormalMapEnabled)
+    const float3x3 TangentToWorld = float3x3(normalize(InTangent), normalize(InBitangent), normalize(InWorldNormal));
+    const float2 NormalSample = NormalMap.Sample(Sampler, InTextureCoordinate).xy * 2.0f - 1.0f;
+    InWorldNormal = float3(NormalSample.x, -NormalSample.y, sqrt(saturate(1.0f - dot(NormalSample, NormalSample))));
+    InWorldNormal = normalize(mul(InWorldNormal, TangentToWorld));
+
+    const float3 DirectionToCamera = normalize(CameraPosition - InWorldPosition);
+
+    float3 Diffuse = float3(0.0f, 0.0f, 0.0f);
+    float3 Specular = float3(0.0f, 0.0f, 0.0f);
+
+    const ClusterLights Cluster = GetClusterLights(InPixelPosition.xy, InWorldPosition);
+
+    for (uint Index = 0u; Index < Cluster.Num; ++Index)
     {
-        const float3x3 TangentToWorld = float3x3(normalize(InTangent), normalize(InBitangent), normalize(InWorldNormal));
-        const float3 NormalSample = NormalMap.Sample(Sampler, InTextureCoordinate).xyz;
-        InWorldNormal = NormalSample * 2.0f - 1.0f;
-        InWorldNormal.y = -InWorldNormal.y;
-        InWorldNormal = normalize(mul(InWorldNormal, TangentToWorld));
-    }
+        const PointLightData Light = GetClusterLight(Cluster, Index);
 
-    const float3 VectorToLight = Position - InWorldPosition;
-    const float DistanceToLight = length(VectorToLight);
-    const float3 DirectionToLight = VectorToLight / DistanceToLight;
+        const float3 VectorToLight = Light.WorldPosition - InWorldPosition;
+        const float DistanceToLight = length(VectorToLight);
 
-    const float Attenuation = 1.0f / (QuadraticAttenuation * (DistanceToLight * DistanceToLight) +
-							  LinearAttenuation * DistanceToLight +
-							  ConstantAttenuation);
+        if (DistanceToLight >= Light.Range)
+        {
+            continue;
+        }
 
-    const float3 Diffuse = DiffuseColor * DiffuseStrength * Attenuation * max(0.0f, dot(DirectionToLight, InWorldNormal));
+        const float3 DirectionToLight = VectorToLight / DistanceToLight;
 
-    const float3 VectorToLightProjectedToNormal = InWorldNormal * dot(VectorToLight, InWorldNormal);
-    // R = 2 * (L  N) - L
-    const float3 VectorToLightReflected = -VectorToLight + 2.0f * VectorToLightProjectedToNormal;
-    const float3 Specular = Attenuation * (DiffuseColor * DiffuseStrength) * SpecularIntensity * pow(max(0.0f, dot(normalize(VectorToLightReflected), normalize(CameraPosition - InWorldPosition))), SpecularPower);
+        const float Attenuation = GetShadowFactor(Light, VectorToLight) / (Light.QuadraticAttenuation * (DistanceToLight * DistanceToLight) +
+								  Light.LinearAttenuation * DistanceToLight +
+								  Light.ConstantAttenuation);
 
-    return float4(saturate((Diffuse + AmbientColor) * Texture.Sample(Sampler, InTextureCoordinate).rgb + Specular), 1.0f);
-}
\ No newline at end of file
+        Diffuse += Light.DiffuseColor * Light.DiffuseStrength * Attenuation * max(0.0f, dot(DirectionToLight, InWorldNormal));
+
+        const float3 VectorToLightProjectedToNormal = InWorldNormal * dot(VectorToLight, InWorldNormal);
+        // R = 2 * (L  N) - L
+        const float3 VectorToLightReflected = -VectorToLight + 2.0f * VectorToLightProjectedToNormal;
+        Specular += Attenuation * (Light.DiffuseColor * Light.DiffuseStrength) * SpecularIntensity * pow(max(0.0f, dot(normalize(VectorToLightReflected), DirectionToCamera)), SpecularPower);
+    }
+
+    Specular += SpecularIntensity * CalcReflection(InWorldPosition, InWorldNormal, DirectionToCamera, SpecularPower, InPixelPosition.xy);
+
+    const float3 Albedo = ApplyDecals(SrgbToLinear(Texture.Sample(Sampler, InTextureCoordinate).rgb), InPixelPosition.xy, InWorldPosition, InWorldNormal,
+                                      ddx(InWorldPosition), ddy(InWorldPosition));
+
+    return float4((Diffuse + CalcAmbient(AmbientColor, InWorldPosition, InWorldNormal, InPixelPosition.xy)) * Albedo + Specular, 1.0f);
+}
@@ -1,7 +1,9 @@
+#include "FrameConstants.hlsli"
+#include "VertexPacking.hlsli"
+
 cbuffer Transform
 {
     matrix Model;
-    matrix ModelViewProjection;
 };
 
 struct VSOutput
@@ -14,16 +16,22 @@ struct VSOutput
     float4 VertexPosition : SV_Position;
 };
 
-VSOutput main(const float3 InModelPosition : Position, const float3 InNormal : Normal,
-              const float3 InTangent : Tangent, const float3 InBitangent : Bitangent,
-			  const float2 InTextureCoordinate : TexCoord)
+VSOutput main(const float3 InModelPosition : Position, const float2 InNormal : Normal,
+              const float4 InTangentFrame : Tangent, const float2 InTextureCoordinate : TexCoord)
 {
+    const float3 Normal = DecodeOctahedralNormal(InNormal);
+    float3 Tangent;
+    float3 Bitangent;
+    DecodeTangentFrame(InTangentFrame, Normal, Tangent, Bitangent);
+
+    const float4 WorldPosition = mul(float4(InModelPosition, 1.0f), Model);
+
     VSOutput VSOutput;
-    VSOutput.VertexWorldPosition = (float3) mul(float4(InModelPosition, 1.0f), Model);
-    VSOutput.NormalWorldPosition = mul(InNormal, (float3x3) Model);
-    VSOutput.TangentWorldPosition = mul(InTangent, (float3x3) Model);
-    VSOutput.BitangentWorldPosition = mul(InBitangent, (float3x3) Model);
-    VSOutput.VertexPosition = mul(float4(InModelPosition, 1.0f), ModelViewProjection);
+    VSOutput.VertexWorldPosition = (float3) WorldPosition;
+    VSOutput.NormalWorldPosition = mul(Normal, (float3x3) Model);
+    VSOutput.TangentWorldPosition = mul(Tangent, (float3x3) Model);
+    VSOutput.BitangentWorldPosition = mul(Bitangent, (float3x3) Model);
+    VSOutput.VertexPosition = mul(WorldPosition, ViewProjection);
     VSOutput.TextureCoordinate = InTextureCoordinate;
 
     return VSOutput;
@@ -0,0 +1,349 @@
+﻿#include "DirectionalLight.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "imgui/imgui.h"
+
+namespace
+{
+	// Of the slice's radius, how far the camera may move before a kept cascade no longer covers its slice.
+	constexpr float CascadeMargin {0.25f};
+}
+
+DirectionalLight::DirectionalLight(ID3D11Device* InDevice)
+{
+	HRESULT ResultHandle;
+
+	CreateMap(InDevice);
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(Constants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+}
+
+void DirectionalLight::CreateMap(ID3D11Device* InDevice)
+{
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC MapDesc {};
+	MapDesc.Width = MapSize;
+	MapDesc.Height = MapSize;
+	MapDesc.MipLevels = 1u;
+	MapDesc.ArraySize = CascadeNum;
+	// Typeless so the cascades are written as depth and sampled as R32_FLOAT.
+	MapDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	MapDesc.SampleDesc.Count = 1u;
+	MapDesc.Usage = D3D11_USAGE_DEFAULT;
+	MapDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> MapTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&MapDesc, nullptr, &MapTexture))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC MapViewDesc {};
+	MapViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	MapViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	MapViewDesc.Texture2DArray.MipLevels = 1u;
+	MapViewDesc.Texture2DArray.ArraySize = CascadeNum;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(MapTexture.Get(), &MapViewDesc, &MapView))
+
+	for (UINT Index = 0u; Index < CascadeNum; ++Index)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC DepthViewDesc {};
+		DepthViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		DepthViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		DepthViewDesc.Texture2DArray.FirstArraySlice = Index;
+		DepthViewDesc.Texture2DArray.ArraySize = 1u;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilView(MapTexture.Get(), &DepthViewDesc, &CascadeDepthViews[Index]))
+	}
+}
+
+void DirectionalLight::SetMapSize(ID3D11Device* InDevice, const UINT InSize)
+{
+	const auto Size = std::clamp(InSize, MinMapSize, MaxMapSize);
+
+	if (Size == MapSize)
+	{
+		return;
+	}
+
+	MapSize = Size;
+	CreateMap(InDevice);
+
+	// The texel snapping of every cascade changes with the size, and the new map holds nothing yet.
+	for (auto& Cascade : Cascades)
+	{
+		Cascade.bIsStale = true;
+	}
+}
+
+void DirectionalLight::BeginFrame(const Graphics& InGraphics) noexcept
+{
+	RenderedCascadeNum = 0u;
+
+	for (auto& Cascade : Cascades)
+	{
+		Cascade.Casters.clear();
+	}
+
+	if (!bIsEnabled)
+	{
+		return;
+	}
+
+	DirectX::XMFLOAT4X4 ProjectionValues;
+	DirectX::XMStoreFloat4x4(&ProjectionValues, InGraphics.GetProjectionMatrix());
+
+	// Left handed perspective, _33 = f / (f - n) and _43 = -n * f / (f - n).
+	const auto NearZ = -ProjectionValues._43 / ProjectionValues._33;
+	const auto FarZ = std::min(ProjectionValues._43 / (1.0f - ProjectionValues._33), MaxShadowDistance);
+	// Squared tangent of the half diagonal angle, a slice's corners are that far off the view axis per unit of depth.
+	const auto DiagonalSquared = 1.0f / (ProjectionValues._11 * ProjectionValues._11) + 1.0f / (ProjectionValues._22 * ProjectionValues._22);
+	const auto InverseView = DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewMatrix());
+
+	auto SliceNear = NearZ;
+
+	for (UINT Index = 0u; Index < CascadeNum; ++Index)
+	{
+		auto& Cascade = Cascades[Index];
+		const auto Fraction = static_cast<float>(Index + 1u) / CascadeNum;
+		const auto SliceFar = std::lerp(NearZ + (FarZ - NearZ) * Fraction, NearZ * std::pow(FarZ / NearZ, Fraction), SplitBlend);
+
+		// The smallest sphere around the slice lies on the view axis, as far from the near corners as from the far ones,
+		// unless that is past the far cap. Rounded up so it doesn't change size with the float noise of the camera turning.
+		const auto Depth = std::min(0.5f * (1.0f + DiagonalSquared) * (SliceNear + SliceFar), SliceFar);
+		const auto NearDistance = std::sqrt((Depth - SliceNear) * (Depth - SliceNear) + SliceNear * SliceNear * DiagonalSquared);
+		const auto FarDistance = std::sqrt((SliceFar - Depth) * (SliceFar - Depth) + SliceFar * SliceFar * DiagonalSquared);
+		const auto Radius = std::ceil(std::max(NearDistance, FarDistance) * 16.0f) / 16.0f;
+		SliceNear = SliceFar;
+
+		DirectX::XMFLOAT3 Center;
+		DirectX::XMStoreFloat3(&Center, DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(0.0f, 0.0f, Depth, 1.0f), InverseView));
+
+		++Cascade.FramesSinceDrawn;
+
+		if (Index == 0u)
+		{
+			FitCascade(Cascade, Center, Radius, 0.0f);
+			continue;
+		}
+
+		// Kept while the slice is inside what the cascade covers and it isn't due, the far ones are due less often.
+		const auto Moved = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Center),
+		                                                                                           DirectX::XMLoadFloat3(&Cascade.Center))));
+		const auto bHasLeft = Moved + Radius > Cascade.Radius + Cascade.Margin;
+		const auto bIsDue = Cascade.FramesSinceDrawn >= static_cast<UINT>(RefreshInterval) * Index;
+
+		if (Cascade.bIsStale || bHasLeft || bIsDue)
+		{
+			FitCascade(Cascade, Center, Radius, Radius * CascadeMargin);
+		}
+	}
+}
+
+void DirectionalLight::AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept
+{
+	for (auto& Cascade : Cascades)
+	{
+		Cascade.bIsStale = Cascade.bIsStale || Cascade.Bounds.Intersects(InBounds);
+	}
+}
+
+void DirectionalLight::AddCaster(const UINT InCascade, const Drawable& InCaster, const DirectX::BoundingBox& InWorldBounds)
+{
+	assert(IsUpdatePending(InCascade) && "Caster added for a cascade that isn't drawn this frame");
+	assert(InCaster.IsDepthOnlySupported() && "Shadow casters are drawn depth only");
+
+	auto& Cascade = Cascades[InCascade];
+
+	if (!Cascade.Bounds.Intersects(InWorldBounds))
+	{
+		return;
+	}
+
+	// Casters may not be submitted to the queue this frame, culled from the camera but not from the light.
+	InCaster.Prepare();
+
+	Cascade.Casters.emplace_back(&InCaster, InWorldBounds);
+}
+
+void DirectionalLight::Render(const Graphics& InGraphics)
+{
+	UploadConstants(InGraphics);
+
+	const auto bHasStaleCascades = std::any_of(Cascades.begin(), Cascades.end(), [](const Cascade& InCascade)
+	{
+		return InCascade.bIsStale;
+	});
+
+	if (!bIsEnabled || !bHasStaleCascades)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Sun shadow cascades");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	// The map cannot stay bound for reading while its cascades are drawn.
+	Cache.SetPixelShaderResource(ShadowSlot, nullptr);
+
+	const D3D11_VIEWPORT MapViewport {0.0f, 0.0f, static_cast<float>(MapSize), static_cast<float>(MapSize), 0.0f, 1.0f};
+
+	for (UINT Index = 0u; Index < CascadeNum; ++Index)
+	{
+		auto& Cascade = Cascades[Index];
+
+		if (!Cascade.bIsStale)
+		{
+			continue;
+		}
+
+		Cache.SetRenderTarget(nullptr, CascadeDepthViews[Index].Get());
+		DeviceContext->ClearDepthStencilView(CascadeDepthViews[Index].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+		DeviceContext->RSSetViewports(1u, &MapViewport);
+
+		InGraphics.BindDepthTest(Context, DepthTest::Less);
+		InGraphics.OverrideViewConstants(Context, DirectX::XMLoadFloat4x4(&Cascade.View), DirectX::XMLoadFloat4x4(&Cascade.Projection));
+
+		for (const auto& [Caster, Bounds] : Cascade.Casters)
+		{
+			Caster->Draw(Context, DrawStage::DepthOnly);
+		}
+
+		Cascade.bIsStale = false;
+		++RenderedCascadeNum;
+	}
+
+	InGraphics.RestoreViewConstants(Context);
+	InGraphics.BindFrameState(Context);
+}
+
+void DirectionalLight::Bind(RenderContext& InContext) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+
+	// Sampled through PointLightShadows' comparison sampler, which is bound wherever this is.
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelShaderResource(ShadowSlot, MapView.Get());
+}
+
+void DirectionalLight::BindCompute(ID3D11DeviceContext* InContext) const noexcept
+{
+	InContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	InContext->CSSetShaderResources(ShadowSlot, 1u, MapView.GetAddressOf());
+}
+
+void DirectionalLight::ShowControlWindow() noexcept
+{
+	if (ImGui::Begin("Sun"))
+	{
+		// Anything that moves the cascades or their shadows draws all of them again, the colour only changes the constants.
+		auto bIsChanged = ImGui::Checkbox("Enabled", &bIsEnabled);
+		bIsChanged |= ImGui::SliderAngle("Elevation", &Pitch, 5.0f, 90.0f);
+		bIsChanged |= ImGui::SliderAngle("Azimuth", &Yaw, -180.0f, 180.0f);
+		bIsChanged |= ImGui::SliderFloat("Split blend", &SplitBlend, 0.0f, 1.0f);
+		ImGui::ColorEdit3("Color", &Color.x);
+		ImGui::SliderFloat("Strength", &Strength, 0.0f, 2.0f);
+		ImGui::SliderInt("Refresh interval", &RefreshInterval, 1, 60);
+		ImGui::SliderFloat("Depth bias", &DepthBias, 0.0f, 0.01f, "%.4f");
+		ImGui::Text("%u cascades drawn into %u texel maps", RenderedCascadeNum, MapSize);
+
+		if (bIsChanged)
+		{
+			for (auto& Cascade : Cascades)
+			{
+				Cascade.bIsStale = true;
+			}
+		}
+	}
+
+	ImGui::End();
+}
+
+DirectX::BoundingSphere DirectionalLight::GetCasterBounds(const UINT InCascade) const noexcept
+{
+	const auto& Bounds = Cascades[InCascade].Bounds;
+	return {Bounds.Center, DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&Bounds.Extents)))};
+}
+
+DirectX::XMVECTOR DirectionalLight::GetDirection() const noexcept
+{
+	return DirectX::XMVectorSet(std::cos(Pitch) * std::sin(Yaw), std::sin(Pitch), std::cos(Pitch) * std::cos(Yaw), 0.0f);
+}
+
+DirectX::XMMATRIX DirectionalLight::GetLightRotation() const noexcept
+{
+	// Straight down the up vector would be parallel to the view direction.
+	const auto Up = Pitch > 0.49f * DirectX::XM_PI ? DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	return DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorNegate(GetDirection()), Up);
+}
+
+void DirectionalLight::FitCascade(Cascade& InOutCascade, const DirectX::XMFLOAT3& InCenter, const float InRadius, const float InMargin) const noexcept
+{
+	const auto Extent = InRadius + InMargin;
+	const auto TexelSize = 2.0f * Extent / MapSize;
+	const auto Rotation = GetLightRotation();
+
+	// Whole texels across the light's view, so the same caster always lands on the same texels while the cascade keeps its size.
+	DirectX::XMFLOAT3 LightCenter;
+	DirectX::XMStoreFloat3(&LightCenter, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&InCenter), Rotation));
+	LightCenter.x = std::floor(LightCenter.x / TexelSize) * TexelSize;
+	LightCenter.y = std::floor(LightCenter.y / TexelSize) * TexelSize;
+
+	const auto View = Rotation * DirectX::XMMatrixTranslation(-LightCenter.x, -LightCenter.y, -LightCenter.z);
+	const auto Projection = DirectX::XMMatrixOrthographicOffCenterLH(-Extent, Extent, -Extent, Extent, -Extent - CasterDistance, Extent);
+	DirectX::XMStoreFloat4x4(&InOutCascade.View, View);
+	DirectX::XMStoreFloat4x4(&InOutCascade.Projection, Projection);
+
+	const DirectX::BoundingOrientedBox LightBounds({0.0f, 0.0f, -0.5f * CasterDistance}, {Extent, Extent, Extent + 0.5f * CasterDistance}, {0.0f, 0.0f, 0.0f, 1.0f});
+	LightBounds.Transform(InOutCascade.Bounds, DirectX::XMMatrixInverse(nullptr, View));
+
+	InOutCascade.Center = InCenter;
+	InOutCascade.Radius = InRadius;
+	InOutCascade.Margin = InMargin;
+	InOutCascade.FramesSinceDrawn = 0u;
+	InOutCascade.bIsStale = true;
+}
+
+void DirectionalLight::UploadConstants(const Graphics& InGraphics)
+{
+	Constants Data {};
+	DirectX::XMStoreFloat3(&Data.Direction, GetDirection());
+	Data.bIsEnabled = bIsEnabled ? 1u : 0u;
+	Data.Color = {Color.x * Strength, Color.y * Strength, Color.z * Strength};
+	Data.DepthBias = DepthBias;
+
+	// Normalized device coordinates to texture coordinates, whose Y points down.
+	const auto ToTexture = DirectX::XMMatrixScaling(0.5f, -0.5f, 1.0f) * DirectX::XMMatrixTranslation(0.5f, 0.5f, 0.0f);
+
+	for (UINT Index = 0u; Index < CascadeNum; ++Index)
+	{
+		const auto& Cascade = Cascades[Index];
+
+		// Transposed like every other matrix handed to the shaders.
+		Data.ShadowTransforms[Index] = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&Cascade.View) * DirectX::XMLoadFloat4x4(&Cascade.Projection) * ToTexture);
+		Data.TexelSizes[Index] = 2.0f * (Cascade.Radius + Cascade.Margin) / MapSize;
+	}
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Data, sizeof(Data));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Data));
+}
@@ -0,0 +1,137 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <utility>
+#include <vector>
+#include "wrl/client.h"
+
+class Drawable;
+class Graphics;
+class RenderContext;
+
+/**
+ * The sun, a light from one direction everywhere with cascaded shadow maps. The camera's view up to the shadow distance is split
+ * into cascades, each shadowed by an orthographic depth map fit around the bounding sphere of its slice, so a cascade keeps its
+ * size as the camera turns, and moved in whole texels, so edges don't crawl as the camera moves.
+ * The near cascade is drawn every frame. The far ones cover a margin past their slice and are kept while the camera stays
+ * inside it, up to a number of frames growing with the cascade, or until bounds reported as moved reach into them.
+ * Each frame models hand over casters for the cascades about to be drawn, like they do for the point light shadow faces.
+ */
+class DirectionalLight
+{
+public:
+	static constexpr UINT CascadeNum {4u};
+	// Texels along each side of a cascade's map, until a quality preset picks otherwise.
+	static constexpr UINT DefaultMapSize {2048u};
+	static constexpr UINT MinMapSize {256u};
+	static constexpr UINT MaxMapSize {8192u};
+	// Shadows end here or at the camera's far plane, whichever is closer.
+	static constexpr float MaxShadowDistance {60.0f};
+	// World units behind a cascade toward the sun that casters are still drawn from.
+	static constexpr float CasterDistance {100.0f};
+
+	DirectionalLight(ID3D11Device* InDevice);
+	DirectionalLight(const DirectionalLight&) = delete;
+	DirectionalLight(DirectionalLight&&) = delete;
+	DirectionalLight& operator=(const DirectionalLight&) = delete;
+	DirectionalLight& operator=(DirectionalLight&&) = delete;
+	~DirectionalLight() = default;
+
+	// Fits the cascades to the camera as InGraphics has it this frame and picks which of them are drawn again.
+	void BeginFrame(const Graphics& InGraphics) noexcept;
+	// World space region whose casters changed since last frame, covering both where they were and where they are.
+	void AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept;
+	// Drawn into the cascade if its bounds reach into it.
+	void AddCaster(UINT InCascade, const Drawable& InCaster, const DirectX::BoundingBox& InWorldBounds);
+
+	// Draws the stale cascades, before anything samples them.
+	void Render(const Graphics& InGraphics);
+	void Bind(RenderContext& InContext) const noexcept;
+	// The same slots for compute shaders that shade, straight to the context like every compute binding.
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+	void ShowControlWindow() noexcept;
+	// Creates the map again at InSize texels a side, clamped to the limits, and draws every cascade into it anew.
+	void SetMapSize(ID3D11Device* InDevice, UINT InSize);
+
+	[[nodiscard]] UINT GetMapSize() const noexcept
+	{
+		return MapSize;
+	}
+
+	[[nodiscard]] bool IsUpdatePending(const UINT InCascade) const noexcept
+	{
+		return bIsEnabled && Cascades[InCascade].bIsStale;
+	}
+
+	// Everything that can cast into the cascade, for querying casters before AddCaster tests them exactly.
+	[[nodiscard]] DirectX::BoundingSphere GetCasterBounds(UINT InCascade) const noexcept;
+
+	// Cascades drawn by the last Render.
+	[[nodiscard]] UINT GetRenderedCascadeNum() const noexcept
+	{
+		return RenderedCascadeNum;
+	}
+
+private:
+	// Pixel shader slots, after the object light lists and before the point lights.
+	static constexpr UINT ConstantSlot {8u};
+	static constexpr UINT ShadowSlot {7u};
+
+	struct Constants
+	{
+		// Normalized, from surfaces toward the sun.
+		DirectX::XMFLOAT3 Direction;
+		UINT bIsEnabled;
+		DirectX::XMFLOAT3 Color;
+		float DepthBias;
+		// World space to the map's texture coordinates and depth, per cascade.
+		std::array<DirectX::XMMATRIX, CascadeNum> ShadowTransforms;
+		// World units a texel of each cascade covers, a float4 in the shaders.
+		std::array<float, CascadeNum> TexelSizes;
+	};
+
+	struct Cascade
+	{
+		DirectX::XMFLOAT4X4 View {};
+		DirectX::XMFLOAT4X4 Projection {};
+		// Light space box drawn into the map, turned back into world space.
+		DirectX::BoundingOrientedBox Bounds;
+		// Of the slice the cascade was last drawn for, and what was added around it.
+		DirectX::XMFLOAT3 Center {};
+		float Radius {0.0f};
+		float Margin {0.0f};
+		UINT FramesSinceDrawn {0u};
+		bool bIsStale {true};
+		std::vector<std::pair<const Drawable*, DirectX::BoundingBox>> Casters;
+	};
+
+	// Toward the sun from the angles.
+	[[nodiscard]] DirectX::XMVECTOR GetDirection() const noexcept;
+	// Light space rotation, for the current direction.
+	[[nodiscard]] DirectX::XMMATRIX GetLightRotation() const noexcept;
+	void FitCascade(Cascade& InOutCascade, const DirectX::XMFLOAT3& InCenter, float InRadius, float InMargin) const noexcept;
+	void UploadConstants(const Graphics& InGraphics);
+	void CreateMap(ID3D11Device* InDevice);
+
+	UINT MapSize {DefaultMapSize};
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MapView;
+	std::array<Microsoft::WRL::ComPtr<ID3D11DepthStencilView>, CascadeNum> CascadeDepthViews;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+
+	std::array<Cascade, CascadeNum> Cascades;
+	// The direction is kept as the angles the control window edits.
+	float Pitch {0.9f};
+	float Yaw {0.6f};
+	DirectX::XMFLOAT3 Color {1.0f, 0.95f, 0.85f};
+	float Strength {0.6f};
+	bool bIsEnabled {true};
+	// Between a split spaced evenly and one spaced logarithmically, how far the near cascades crowd toward the camera.
+	float SplitBlend {0.75f};
+	// Frames the second cascade is kept at most, the ones after it multiples of this.
+	int RefreshInterval {8};
+	float DepthBias {0.002f};
+	UINT RenderedCascadeNum {0u};
+};
@@ -0,0 +1,51 @@
+// Laid out like DirectionalLight::Constants, shadows come through PointLight.hlsli's comparison sampler.
+cbuffer DirectionalLight : register(b8)
+{
+    // Normalized, from surfaces toward the sun.
+    float3 SunDirection;
+    uint bIsSunEnabled;
+    // Already scaled by the sun's strength.
+    float3 SunColor;
+    float SunDepthBias;
+    // World space to each cascade's texture coordinates and depth.
+    matrix SunShadowTransforms[4];
+    // World units a texel of each cascade covers.
+    float4 SunTexelSizes;
+}
+
+Texture2DArray<float> SunShadowMap : register(t7);
+
+static const uint SunCascadeNum = 4u;
+
+// Fraction of the sun that reaches the surface, from the first cascade that covers it. Past the last one it is lit.
+float GetSunShadowFactor(const float3 InWorldPosition, const float3 InWorldNormal)
+{
+    for (uint Cascade = 0u; Cascade < SunCascadeNum; ++Cascade)
+    {
+        // Pushed out along the normal by about a texel, so a surface doesn't shadow itself where it slopes away from the sun.
+        const float3 Position = InWorldPosition + InWorldNormal * SunTexelSizes[Cascade] * 1.5f;
+        const float3 MapPosition = mul(float4(Position, 1.0f), SunShadowTransforms[Cascade]).xyz;
+
+        if (all(MapPosition.xy > 0.0f) && all(MapPosition.xy < 1.0f))
+        {
+            return SunShadowMap.SampleCmpLevelZero(ShadowSampler, float3(MapPosition.xy, Cascade), saturate(MapPosition.z) - SunDepthBias);
+        }
+    }
+
+    return 1.0f;
+}
+
+// Adds the sun's diffuse and specular light at the surface to InOutDiffuse and InOutSpecular, like one more point light.
+void AddSunLight(const float3 InWorldPosition, const float3 InWorldNormal, const float3 InVectorToCamera, const float3 InSpecularColor,
+                 const float InSpecularIntensity, const float InSpecularPower, inout float3 InOutDiffuse, inout float3 InOutSpecular)
+{
+    if (!bIsSunEnabled)
+    {
+        return;
+    }
+
+    const float Shadow = GetSunShadowFactor(InWorldPosition, InWorldNormal);
+
+    InOutDiffuse += CalcDiffuse(SunColor, 1.0f, Shadow, SunDirection, InWorldNormal);
+    InOutSpecular += CalcSpeculate(InSpecularColor, InSpecularIntensity, InWorldNormal, SunDirection, InVectorToCamera, Shadow, InSpecularPower);
+}
@@ -0,0 +1,46 @@
+﻿#include "Displacement.h"
+#include <algorithm>
+#include "ExceptionMacros.h"
+#include "Sampler.h"
+#include "Texture.h"
+
+Displacement::Displacement(const Graphics& InGraphics, std::shared_ptr<Texture> InHeightMap, const Settings& InSettings)
+	: HeightMap(std::move(InHeightMap))
+{
+	HRESULT ResultHandle;
+	auto* const Device = GetDevice(InGraphics);
+
+	// The swap chain is never resized, so the viewport's height is written once with the rest.
+	const DisplacementConstants Constants {InSettings.Scale, InSettings.TargetEdgePixels,
+	                                       std::clamp(InSettings.MaxFactor, 1.0f, static_cast<float>(D3D11_TESSELLATOR_MAX_TESSELLATION_FACTOR)),
+	                                       InGraphics.GetViewport().Height};
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(DisplacementConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA ConstantData {};
+	ConstantData.pSysMem = &Constants;
+	CHECK_HRESULT_EXCEPTION(Device->CreateBuffer(&ConstantBufferDesc, &ConstantData, &ConstantBuffer))
+
+	// Trilinear, the domain shader picks the level from the tessellation factor itself.
+	const auto SamplerDesc = Sampler::MakeDesc(Sampler::Linear);
+	CHECK_HRESULT_EXCEPTION(Device->CreateSamplerState(&SamplerDesc, &HeightSampler))
+}
+
+void Displacement::Bind(RenderContext& InContext) noexcept
+{
+	auto& Cache = GetStateCache(InContext);
+
+	Cache.SetHullConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetDomainConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetDomainShaderResource(HeightMapSlot, HeightMap->GetView());
+	Cache.SetDomainSampler(SamplerSlot, HeightSampler.Get());
+}
+
+size_t Displacement::GetGpuByteSize() const noexcept
+{
+	// The height map is counted by its own texture, it is usually shared with the surface's material.
+	return sizeof(DisplacementConstants);
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <memory>
+#include "wrl/client.h"
+#include "Bindable.h"
+
+class Texture;
+
+/**
+ * What a tessellated surface needs besides its shaders, the height map the domain shader lifts the generated vertices by and
+ * the constants both stages read, see Displacement.hlsli. The draw packets carry no hull or domain bindings, so it binds
+ * itself on every draw, which also keeps up with the height map's streamed levels.
+ */
+class Displacement : public Bindable
+{
+public:
+	struct Settings
+	{
+		// World units the brightest height lifts the surface along its normal, the darkest leaves it in place.
+		float Scale {0.05f};
+		// Edges are split until their pieces are about this many pixels long on screen.
+		float TargetEdgePixels {8.0f};
+		// Up to D3D11_TESSELLATOR_MAX_TESSELLATION_FACTOR, how finely a patch right in front of the camera is split at most.
+		float MaxFactor {32.0f};
+	};
+
+	Displacement(const Graphics& InGraphics, std::shared_ptr<Texture> InHeightMap, const Settings& InSettings);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	// Registers in Displacement.hlsli.
+	static constexpr UINT ConstantSlot {2u};
+	static constexpr UINT HeightMapSlot {0u};
+	static constexpr UINT SamplerSlot {0u};
+
+	struct DisplacementConstants
+	{
+		float Scale;
+		float TargetEdgePixels;
+		float MaxFactor;
+		float ViewportHeight;
+	};
+
+	std::shared_ptr<Texture> HeightMap;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> HeightSampler;
+};
@@ -0,0 +1,24 @@
+// Laid out like Displacement::DisplacementConstants, bound to the hull and domain stages of tessellated surfaces.
+cbuffer Displacement : register(b2)
+{
+    float DisplacementScale;
+    float TargetEdgePixels;
+    float MaxTessellationFactor;
+    float ViewportHeight;
+}
+
+// In world space from DisplacementVS.hlsl on, the factors and the displacement are both measured there.
+struct PatchVertex
+{
+    float3 WorldPosition : Position;
+    float3 WorldNormal : Normal;
+    float3 WorldTangent : Tangent;
+    float3 WorldBitangent : Bitangent;
+    float2 TextureCoordinate : TexCoord;
+};
+
+struct PatchFactors
+{
+    float EdgeFactors[3] : SV_TessFactor;
+    float InsideFactor : SV_InsideTessFactor;
+};
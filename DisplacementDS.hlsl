@@ -0,0 +1,53 @@
+// Places the tessellated vertices on the patch and lifts them along the normal by the height map.
+// The output is what DiffuseNormalPhongVS.hlsl writes, the pixel shader shades the displaced surface unchanged.
+#include "Displacement.hlsli"
+#include "FrameConstants.hlsli"
+
+// Grey height maps and colour images alike, the latter stand in through their luminance.
+Texture2D<float4> HeightMap : register(t0);
+SamplerState HeightSampler : register(s0);
+
+struct DSOutput
+{
+    float3 VertexWorldPosition : Position;
+    float3 NormalWorldPosition : Normal;
+    float3 TangentWorldPosition : Tangent;
+    float3 BitangentWorldPosition : Bitangent;
+    float2 TextureCoordinate : TexCoord;
+    float4 VertexPosition : SV_Position;
+};
+
+// The level whose texels are about as far apart as the generated vertices, finer ones would shimmer as the factors change.
+float GetHeightLevel(OutputPatch<PatchVertex, 3> InPatch, const float InInsideFactor)
+{
+    uint Width;
+    uint Height;
+    uint LevelNum;
+    HeightMap.GetDimensions(0u, Width, Height, LevelNum);
+
+    const float2 MinCoordinate = min(min(InPatch[0].TextureCoordinate, InPatch[1].TextureCoordinate), InPatch[2].TextureCoordinate);
+    const float2 MaxCoordinate = max(max(InPatch[0].TextureCoordinate, InPatch[1].TextureCoordinate), InPatch[2].TextureCoordinate);
+    const float2 PatchTexels = (MaxCoordinate - MinCoordinate) * float2(Width, Height);
+    return log2(max(max(PatchTexels.x, PatchTexels.y) / max(InInsideFactor, 1.0f), 1.0f));
+}
+
+[domain("tri")]
+DSOutput main(const PatchFactors InFactors, const float3 InLocation : SV_DomainLocation, OutputPatch<PatchVertex, 3> InPatch)
+{
+    const float3 WorldPosition = InLocation.x * InPatch[0].WorldPosition + InLocation.y * InPatch[1].WorldPosition + InLocation.z * InPatch[2].WorldPosition;
+    const float3 WorldNormal = normalize(InLocation.x * InPatch[0].WorldNormal + InLocation.y * InPatch[1].WorldNormal + InLocation.z * InPatch[2].WorldNormal);
+    const float2 TextureCoordinate = InLocation.x * InPatch[0].TextureCoordinate + InLocation.y * InPatch[1].TextureCoordinate + InLocation.z * InPatch[2].TextureCoordinate;
+
+    const float3 HeightSample = HeightMap.SampleLevel(HeightSampler, TextureCoordinate, GetHeightLevel(InPatch, InFactors.InsideFactor)).rgb;
+    const float3 DisplacedPosition = WorldPosition + WorldNormal * dot(HeightSample, float3(0.2126f, 0.7152f, 0.0722f)) * DisplacementScale;
+
+    DSOutput Output;
+    Output.VertexWorldPosition = DisplacedPosition;
+    Output.NormalWorldPosition = WorldNormal;
+    Output.TangentWorldPosition = InLocation.x * InPatch[0].WorldTangent + InLocation.y * InPatch[1].WorldTangent + InLocation.z * InPatch[2].WorldTangent;
+    Output.BitangentWorldPosition = InLocation.x * InPatch[0].WorldBitangent + InLocation.y * InPatch[1].WorldBitangent + InLocation.z * InPatch[2].WorldBitangent;
+    Output.TextureCoordinate = TextureCoordinate;
+    Output.VertexPosition = mul(float4(DisplacedPosition, 1.0f), ViewProjection);
+
+    return Output;
+}
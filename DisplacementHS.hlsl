@@ -0,0 +1,70 @@
+// Splits every triangle of the surface by how long its edges are on screen, patches out of view are dropped before the tessellator.
+#include "Displacement.hlsli"
+#include "FrameConstants.hlsli"
+
+// From the edge's own end points only, so the two patches sharing it agree and no cracks open between them.
+float GetEdgeFactor(const float3 InFrom, const float3 InTo)
+{
+    const float Distance = max(distance(0.5f * (InFrom + InTo), CameraPosition), 0.001f);
+    // Projection[1][1] is how many half viewport heights a unit spans at unit distance.
+    const float EdgePixels = distance(InFrom, InTo) * Projection[1][1] * 0.5f * ViewportHeight / Distance;
+    return clamp(EdgePixels / TargetEdgePixels, 1.0f, MaxTessellationFactor);
+}
+
+// True when every corner, lifted by the full displacement or not, lies beyond the same clip plane.
+bool IsPatchOutsideView(InputPatch<PatchVertex, 3> InPatch)
+{
+    uint OutsideMask = 0x3fu;
+
+    for (uint Index = 0u; Index < 6u; ++Index)
+    {
+        const PatchVertex Corner = InPatch[Index % 3u];
+        const float3 Lift = Index >= 3u ? normalize(Corner.WorldNormal) * DisplacementScale : float3(0.0f, 0.0f, 0.0f);
+        const float4 ClipPosition = mul(float4(Corner.WorldPosition + Lift, 1.0f), ViewProjection);
+
+        uint Outside = 0u;
+        Outside |= ClipPosition.x < -ClipPosition.w ? 0x01u : 0u;
+        Outside |= ClipPosition.x > ClipPosition.w ? 0x02u : 0u;
+        Outside |= ClipPosition.y < -ClipPosition.w ? 0x04u : 0u;
+        Outside |= ClipPosition.y > ClipPosition.w ? 0x08u : 0u;
+        Outside |= ClipPosition.z < 0.0f ? 0x10u : 0u;
+        Outside |= ClipPosition.z > ClipPosition.w ? 0x20u : 0u;
+        OutsideMask &= Outside;
+    }
+
+    return OutsideMask != 0u;
+}
+
+PatchFactors GetPatchFactors(InputPatch<PatchVertex, 3> InPatch)
+{
+    PatchFactors Factors;
+
+    if (IsPatchOutsideView(InPatch))
+    {
+        // Zero factors discard the patch.
+        Factors.EdgeFactors[0] = 0.0f;
+        Factors.EdgeFactors[1] = 0.0f;
+        Factors.EdgeFactors[2] = 0.0f;
+        Factors.InsideFactor = 0.0f;
+        return Factors;
+    }
+
+    // Edge N lies opposite control point N.
+    Factors.EdgeFactors[0] = GetEdgeFactor(InPatch[1].WorldPosition, InPatch[2].WorldPosition);
+    Factors.EdgeFactors[1] = GetEdgeFactor(InPatch[2].WorldPosition, InPatch[0].WorldPosition);
+    Factors.EdgeFactors[2] = GetEdgeFactor(InPatch[0].WorldPosition, InPatch[1].WorldPosition);
+    Factors.InsideFactor = max(max(Factors.EdgeFactors[0], Factors.EdgeFactors[1]), Factors.EdgeFactors[2]);
+    return Factors;
+}
+
+// Fractional factors blend new vertices in as the camera approaches instead of popping them in whole.
+[domain("tri")]
+[partitioning("fractional_odd")]
+[outputtopology("triangle_cw")]
+[outputcontrolpoints(3)]
+[patchconstantfunc("GetPatchFactors")]
+[maxtessfactor(64.0f)]
+PatchVertex main(InputPatch<PatchVertex, 3> InPatch, const uint InIndex : SV_OutputControlPointID)
+{
+    return InPatch[InIndex];
+}
@@ -0,0 +1,26 @@
+// Hands the control points of DisplacementHS.hlsl over in world space, projecting waits for the domain shader.
+#include "Displacement.hlsli"
+#include "VertexPacking.hlsli"
+
+cbuffer Transform
+{
+    matrix Model;
+};
+
+PatchVertex main(const float3 InModelPosition : Position, const float2 InNormal : Normal,
+                 const float4 InTangentFrame : Tangent, const float2 InTextureCoordinate : TexCoord)
+{
+    const float3 Normal = DecodeOctahedralNormal(InNormal);
+    float3 Tangent;
+    float3 Bitangent;
+    DecodeTangentFrame(InTangentFrame, Normal, Tangent, Bitangent);
+
+    PatchVertex Output;
+    Output.WorldPosition = (float3) mul(float4(InModelPosition, 1.0f), Model);
+    Output.WorldNormal = mul(Normal, (float3x3) Model);
+    Output.WorldTangent = mul(Tangent, (float3x3) Model);
+    Output.WorldBitangent = mul(Bitangent, (float3x3) Model);
+    Output.TextureCoordinate = InTextureCoordinate;
+
+    return Output;
+}
@@ -0,0 +1,51 @@
+﻿#include "DomainShader.h"
+#include "BindManager.h"
+#include "DrawPacket.h"
+#include "ExceptionMacros.h"
+
+DomainShader::DomainShader(const Graphics& InGraphics, const std::string_view InFileName)
+	: FileName(InFileName)
+{
+	HRESULT ResultHandle;
+	const auto ByteCodeBlob = InGraphics.GetShaderBundle().Load(InFileName);
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateDomainShader
+	(
+		ByteCodeBlob->GetBufferPointer(),
+		ByteCodeBlob->GetBufferSize(),
+		nullptr,
+		&MyDomainShader
+	))
+}
+
+void DomainShader::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetDomainShader(MyDomainShader.Get());
+}
+
+bool DomainShader::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.DomainShader = MyDomainShader.Get();
+	return true;
+}
+
+std::shared_ptr<DomainShader> DomainShader::Resolve(const Graphics& InGraphics, const std::string_view InFileName)
+{
+	return BindManager::Resolve<DomainShader>(InGraphics, InFileName);
+}
+
+std::string DomainShader::GenerateUniqueID(const std::string_view InFileName)
+{
+	using namespace std::string_literals;
+	return typeid(DomainShader).name() + "#"s + std::string(InFileName);
+}
+
+BindKey DomainShader::GenerateKey(const std::string_view InFileName)
+{
+	return BindKey::Make<DomainShader>(InFileName);
+}
+
+std::string DomainShader::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(FileName);
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <memory>
+#include <string_view>
+#include "BindKey.h"
+#include "Bindable.h"
+
+// Places the vertices tessellation generates inside each patch, bound only while a patch list draws.
+class DomainShader : public Bindable
+{
+public:
+	DomainShader(const Graphics& InGraphics, std::string_view InFileName);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] const std::string& GetFileName() const noexcept
+	{
+		return FileName;
+	}
+
+	[[nodiscard]] static std::shared_ptr<DomainShader> Resolve(const Graphics& InGraphics, std::string_view InFileName);
+	[[nodiscard]] static std::string GenerateUniqueID(std::string_view InFileName);
+	[[nodiscard]] static BindKey GenerateKey(std::string_view InFileName);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+
+protected:
+	std::string FileName;
+	Microsoft::WRL::ComPtr<ID3D11DomainShader> MyDomainShader;
+};
@@ -0,0 +1,126 @@
+﻿#include "DrawPacket.h"
+#include <cassert>
+#include "Bindable.h"
+#include "DebugViews.h"
+#include "RenderContext.h"
+
+namespace
+{
+	template<typename T, size_t N>
+	void AddSlotBinding(std::array<DrawPacket::SlotBinding<T>, N>& InOutBindings, unsigned char& InOutNum, const UINT InSlot, T* InResource) noexcept
+	{
+		for (unsigned char Index = 0u; Index < InOutNum; ++Index)
+		{
+			if (InOutBindings[Index].Slot == InSlot)
+			{
+				InOutBindings[Index].Resource = InResource;
+				return;
+			}
+		}
+
+		assert(InOutNum < N && "Draw packet is out of slots, raise its limit");
+		InOutBindings[InOutNum++] = {InSlot, InResource};
+	}
+}
+
+void DrawPacket::AddVertexConstantBuffer(const UINT InSlot, ID3D11Buffer* InBuffer) noexcept
+{
+	AddSlotBinding(VertexConstantBuffers, VertexConstantBufferNum, InSlot, InBuffer);
+}
+
+void DrawPacket::AddVertexShaderResource(const UINT InSlot, ID3D11ShaderResourceView* InView) noexcept
+{
+	AddSlotBinding(VertexShaderResources, VertexShaderResourceNum, InSlot, InView);
+}
+
+void DrawPacket::AddPixelConstantBuffer(const UINT InSlot, ID3D11Buffer* InBuffer) noexcept
+{
+	AddSlotBinding(PixelConstantBuffers, PixelConstantBufferNum, InSlot, InBuffer);
+}
+
+void DrawPacket::AddPixelShaderResource(const UINT InSlot, ID3D11ShaderResourceView* InView) noexcept
+{
+	AddSlotBinding(PixelShaderResources, PixelShaderResourceNum, InSlot, InView);
+}
+
+void DrawPacket::AddPixelSampler(const UINT InSlot, ID3D11SamplerState* InSampler) noexcept
+{
+	AddSlotBinding(PixelSamplers, PixelSamplerNum, InSlot, InSampler);
+}
+
+void DrawPacket::AddDynamic(Bindable* InBindable) noexcept
+{
+	assert(DynamicNum < MaxDynamicNum && "Draw packet is out of dynamic bindables, raise its limit");
+	Dynamics[DynamicNum++] = InBindable;
+}
+
+void DrawPacket::Apply(RenderContext& InContext, const bool bIsInstanced) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+	const auto* const Views = InContext.GetDebugViews();
+	const bool bIsSubstituted = Views && PixelShader;
+
+	Cache.SetPrimitiveTopology(Topology);
+	Cache.SetInputLayout(InputLayout);
+	for (UINT Stream = 0u; Stream < DV::VertexLayout::StreamNum; ++Stream)
+	{
+		Cache.SetVertexBuffer(Stream, VertexBuffers[Stream], VertexStrides[Stream]);
+	}
+	Cache.SetIndexBuffer(IndexBuffer, IndexFormat);
+	Cache.SetVertexShader(bIsInstanced ? InstancedVertexShader : VertexShader);
+	Cache.SetHullShader(HullShader);
+	Cache.SetDomainShader(DomainShader);
+
+	if (!bIsSubstituted)
+	{
+		Cache.SetPixelShader(PixelShader);
+		Cache.SetRasterizerState(RasterizerState);
+		Cache.SetBlendState(BlendState);
+	}
+
+	if (DepthStencilState)
+	{
+		Cache.SetDepthStencilState(DepthStencilState, 1u);
+	}
+
+	for (unsigned char Index = 0u; Index < VertexConstantBufferNum; ++Index)
+	{
+		Cache.SetVertexConstantBuffer(VertexConstantBuffers[Index].Slot, VertexConstantBuffers[Index].Resource);
+	}
+
+	for (unsigned char Index = 0u; Index < VertexShaderResourceNum; ++Index)
+	{
+		Cache.SetVertexShaderResource(VertexShaderResources[Index].Slot, VertexShaderResources[Index].Resource);
+	}
+
+	for (unsigned char Index = 0u; Index < PixelConstantBufferNum; ++Index)
+	{
+		Cache.SetPixelConstantBuffer(PixelConstantBuffers[Index].Slot, PixelConstantBuffers[Index].Resource);
+	}
+
+	for (unsigned char Index = 0u; Index < PixelShaderResourceNum; ++Index)
+	{
+		Cache.SetPixelShaderResource(PixelShaderResources[Index].Slot, PixelShaderResources[Index].Resource);
+	}
+
+	for (unsigned char Index = 0u; Index < PixelSamplerNum; ++Index)
+	{
+		Cache.SetPixelSampler(PixelSamplers[Index].Slot, PixelSamplers[Index].Resource);
+	}
+
+	if (TransformConstants && !bIsInstanced)
+	{
+		TransformConstants->Bind(InContext);
+	}
+
+	for (unsigned char Index = 0u; Index < DynamicNum; ++Index)
+	{
+		Dynamics[Index]->Bind(InContext);
+	}
+
+	// Last, the view's constants may share a slot with the packet's own. Depth-only packets have no pixel shader to replace.
+	if (bIsSubstituted)
+	{
+		Views->Substitute(Cache, PixelShader, RasterizerState);
+	}
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <array>
+#include <d3d11.h>
+#include "DynamicVertex.h"
+
+class Bindable;
+class RenderContext;
+
+/**
+ * Everything a drawable's bindables set for one stage, flattened once into raw views and state objects.
+ * Applying it reads one contiguous block instead of calling Bind on each separately allocated bindable, and the calls
+ * still go through the state cache, so those the previous draw already made are skipped as before.
+ * Bindables that set something different every draw, like the transform constants, are kept and bind themselves.
+ */
+struct DrawPacket
+{
+	template<typename T>
+	struct SlotBinding
+	{
+		UINT Slot;
+		T* Resource;
+	};
+
+	static constexpr size_t MaxConstantBufferNum {4u};
+	static constexpr size_t MaxShaderResourceNum {8u};
+	static constexpr size_t MaxVertexShaderResourceNum {4u};
+	static constexpr size_t MaxSamplerNum {4u};
+	static constexpr size_t MaxDynamicNum {4u};
+
+	// A later binding to a slot replaces the earlier one, as it would have when both were bound in order.
+	void AddVertexConstantBuffer(UINT InSlot, ID3D11Buffer* InBuffer) noexcept;
+	void AddVertexShaderResource(UINT InSlot, ID3D11ShaderResourceView* InView) noexcept;
+	void AddPixelConstantBuffer(UINT InSlot, ID3D11Buffer* InBuffer) noexcept;
+	void AddPixelShaderResource(UINT InSlot, ID3D11ShaderResourceView* InView) noexcept;
+	void AddPixelSampler(UINT InSlot, ID3D11SamplerState* InSampler) noexcept;
+	void AddDynamic(Bindable* InBindable) noexcept;
+
+	// Instanced draws take the instanced vertex shader and leave the transform constants out, instances carry their own.
+	void Apply(RenderContext& InContext, bool bIsInstanced) const noexcept;
+
+	D3D11_PRIMITIVE_TOPOLOGY Topology {D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED};
+	ID3D11InputLayout* InputLayout {nullptr};
+	// Per stream of DV::VertexLayout, position-only input layouts never read past the first.
+	std::array<ID3D11Buffer*, DV::VertexLayout::StreamNum> VertexBuffers {};
+	std::array<UINT, DV::VertexLayout::StreamNum> VertexStrides {};
+	ID3D11Buffer* IndexBuffer {nullptr};
+	DXGI_FORMAT IndexFormat {DXGI_FORMAT_UNKNOWN};
+	ID3D11VertexShader* VertexShader {nullptr};
+	ID3D11VertexShader* InstancedVertexShader {nullptr};
+	// Null for depth only packets, which unbind the pixel shader.
+	ID3D11PixelShader* PixelShader {nullptr};
+	// Null unless the topology is a patch list, the tessellation stages are unbound then.
+	ID3D11HullShader* HullShader {nullptr};
+	ID3D11DomainShader* DomainShader {nullptr};
+	// Null for the defaults, and the depth-stencil state of the pass is kept when it is null.
+	ID3D11RasterizerState* RasterizerState {nullptr};
+	ID3D11BlendState* BlendState {nullptr};
+	ID3D11DepthStencilState* DepthStencilState {nullptr};
+	Bindable* TransformConstants {nullptr};
+
+	UINT IndexCount {0u};
+	UINT StartIndex {0u};
+	INT BaseVertex {0};
+
+	unsigned char VertexConstantBufferNum {0u};
+	unsigned char VertexShaderResourceNum {0u};
+	unsigned char PixelConstantBufferNum {0u};
+	unsigned char PixelShaderResourceNum {0u};
+	unsigned char PixelSamplerNum {0u};
+	unsigned char DynamicNum {0u};
+	std::array<SlotBinding<ID3D11Buffer>, MaxConstantBufferNum> VertexConstantBuffers {};
+	std::array<SlotBinding<ID3D11ShaderResourceView>, MaxVertexShaderResourceNum> VertexShaderResources {};
+	std::array<SlotBinding<ID3D11Buffer>, MaxConstantBufferNum> PixelConstantBuffers {};
+	std::array<SlotBinding<ID3D11ShaderResourceView>, MaxShaderResourceNum> PixelShaderResources {};
+	std::array<SlotBinding<ID3D11SamplerState>, MaxSamplerNum> PixelSamplers {};
+	std::array<Bindable*, MaxDynamicNum> Dynamics {};
+};
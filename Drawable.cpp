@@ -1,26 +1,499 @@
 ﻿#include "Drawable.h"
+#include <algorithm>
+#include <functional>
 #include "Bindable.h"
+#include "DynamicIndexBuffer.h"
+#include "DynamicVertexBuffer.h"
+#include "FrameProfiler.h"
 #include "IndexBuffer.h"
+#include "InputLayout.h"
+#include "InstanceBuffer.h"
+#include "Material.h"
+#include "PipelineState.h"
+#include "PixelShader.h"
+#include "ReleaseQueue.h"
+#include "RenderContext.h"
+#include "Texture.h"
+#include "Topology.h"
+#include "TransformConstantBuffer.h"
+#include "VertexBuffer.h"
+#include "VertexShader.h"
 
-Drawable::~Drawable() = default;
+namespace
+{
+	uint32_t HashPointer(const void* InPointer) noexcept
+	{
+		return static_cast<uint32_t>(std::hash<const void*>{}(InPointer));
+	}
+}
+
+Drawable::~Drawable()
+{
+	// Packets recorded this frame still point into them, and the GPU may still be drawing the last few.
+	for (auto& Held : Bindables)
+	{
+		ReleaseQueue::Retire(std::move(Held));
+	}
+
+	ReleaseQueue::Retire(std::move(InstancedVertexShader));
+	ReleaseQueue::Retire(std::move(MyInstanceBuffer));
+	ReleaseQueue::Retire(std::move(DepthVertexShader));
+	ReleaseQueue::Retire(std::move(DepthInstancedVertexShader));
+	ReleaseQueue::Retire(std::move(DepthInputLayout));
+}
 
 void Drawable::Bind(std::shared_ptr<Bindable> InBindable)
 {
-	if (typeid(*InBindable) == typeid(IndexBuffer))
+	// Resolving against shader reflection gives null for resources the shaders never read.
+	if (!InBindable)
+	{
+		return;
+	}
+
+	const auto& BindableType = typeid(*InBindable);
+
+	if (BindableType == typeid(IndexBuffer) || BindableType == typeid(DynamicIndexBuffer))
 	{
 		assert(BoundIndexBuffer == nullptr && "Binding multiple indexbuffers!");
 		BoundIndexBuffer = static_cast<const IndexBuffer*>(InBindable.get());
 	}
+	else if (BindableType == typeid(VertexBuffer) || BindableType == typeid(DynamicVertexBuffer))
+	{
+		BoundVertexBuffer = static_cast<const VertexBuffer*>(InBindable.get());
+	}
+	else if (BindableType == typeid(Topology))
+	{
+		BoundTopology = InBindable.get();
+	}
+	else if (BindableType == typeid(VertexShader))
+	{
+		BoundVertexShader = InBindable.get();
+	}
+	else if (BindableType == typeid(PixelShader))
+	{
+		BoundPixelShader = InBindable.get();
+	}
+	else if (BindableType == typeid(InputLayout))
+	{
+		BoundInputLayout = InBindable.get();
+	}
+	else if (BindableType == typeid(Material))
+	{
+		// The material binds its own pixel shader, the sort key still has to tell shaders apart.
+		BoundMaterial = static_cast<const Material*>(InBindable.get());
+		BoundPixelShader = BoundMaterial->GetPixelShader().get();
+	}
+	else if (BindableType == typeid(PipelineState))
+	{
+		// Stands in for the bindables it bundles, the sort key and the depth-only path still read them one by one.
+		BoundPipelineState = static_cast<const PipelineState*>(InBindable.get());
+		BoundVertexShader = BoundPipelineState->GetVertexShader();
+		BoundPixelShader = BoundPipelineState->GetPixelShader();
+		BoundInputLayout = BoundPipelineState->GetInputLayout();
+		BoundTopology = BoundPipelineState->GetTopology();
+	}
+	else if (BindableType == typeid(Texture))
+	{
+		TextureSetHash = TextureSetHash * 31u + HashPointer(InBindable.get());
+	}
+	else if (BindableType == typeid(TextureBinding))
+	{
+		// The same file read through another slot is another set of textures.
+		const auto* Binding = static_cast<const TextureBinding*>(InBindable.get());
+		TextureSetHash = (TextureSetHash * 31u + HashPointer(&Binding->GetTexture())) * 31u + Binding->GetSlot();
+	}
+	else if (BindableType == typeid(TransformConstantBuffer))
+	{
+		BoundTransformConstantBuffer = InBindable.get();
+	}
 
 	Bindables.push_back(std::move(InBindable));
+	BakedRevision = NotBaked;
+}
+
+void Drawable::Prepare() const
+{
+	if (BakedRevision != Bindable::GetBakedRevision())
+	{
+		Bake();
+	}
 }
 
-void Drawable::Draw(const Graphics& InGraphics) const
+void Drawable::Submit(const Graphics& InGraphics, const RenderPass InPass, const unsigned int InOcclusionSlot) const
 {
-	for (const auto& Bindable : Bindables)
+	Prepare();
+
+	// The local origin lands on the world matrix's translation row, which saves building the full world view projection.
+	const auto ClipPosition = DirectX::XMVector3TransformCoord(GetTransformMatrix().r[3], InGraphics.GetViewProjectionMatrix());
+
+	const auto NormalizedDepth = DirectX::XMVectorGetZ(ClipPosition);
+	auto& Queue = InGraphics.GetRenderQueue();
+	auto Pass = InPass;
+
+	const auto MakeStateKey = [this](const RenderPass InKeyPass, const float InDepth)
+	{
+		return RenderQueue::MakeKey
+			   (
+				   InKeyPass,
+				   HashPointer(BoundVertexShader) ^ HashPointer(BoundPixelShader) * 31u,
+				   BoundMaterial ? BoundMaterial->GetBatchId() : static_cast<uint32_t>(TextureSetHash),
+				   HashPointer(BoundInputLayout),
+				   InDepth
+			   );
+	};
+
+	// Blended surfaces neither fill the pre-pass nor occlude, they are drawn after everything opaque. The occlusion retest
+	// only draws opaque surfaces again, so they are never occlusion culled either.
+	if (BoundPipelineState && BoundPipelineState->IsBlended())
 	{
-		Bindable->Bind(InGraphics);
+		// Weighted ones sum to the same whatever their order, so they sort by state and batch like opaque draws.
+		const auto Key = BoundPipelineState->IsOrderIndependent() ? MakeStateKey(RenderPass::OrderIndependent, NormalizedDepth)
+		                                                          : RenderQueue::MakeKey(RenderPass::Transparent, 0u, 0u, 0u, 1.0f - NormalizedDepth);
+		Queue.Submit(Key, *this);
+		return;
 	}
 
-	InGraphics.DrawIndexed(BoundIndexBuffer->GetCount());
-}
\ No newline at end of file
+	// Cut-out surfaces lay down their clipped depth in a pass of their own whether or not the pre-pass is enabled, then are
+	// shaded after the opaque ones where it left their depth, so no shaded pixel of theirs clips and loses early depth rejection.
+	if (Pass == RenderPass::Opaque && IsAlphaTestSupported())
+	{
+		const auto AlphaTestKey = RenderQueue::MakeKey
+								  (
+									  RenderPass::AlphaTestedPrepass,
+									  HashPointer(BoundVertexShader) ^ HashPointer(BoundMaterial->GetAlphaTestPixelShader().get()) * 31u,
+									  BoundMaterial->GetBatchId(),
+									  HashPointer(BoundInputLayout),
+									  NormalizedDepth
+								  );
+
+		Queue.Submit(AlphaTestKey, *this, InOcclusionSlot);
+		Queue.Submit(MakeStateKey(RenderPass::AlphaTested, NormalizedDepth), *this, InOcclusionSlot);
+		return;
+	}
+
+	if (Pass == RenderPass::Opaque && Queue.IsDepthPrepassActive(InGraphics))
+	{
+		// Without a depth-only path the drawable is drawn in full during the pre-pass, the equal test would reject it later.
+		if (!IsDepthOnlySupported())
+		{
+			Pass = RenderPass::DepthPrepass;
+		}
+		else
+		{
+			const auto DepthKey = RenderQueue::MakeKey
+								  (
+									  RenderPass::DepthPrepass,
+									  HashPointer(DepthVertexShader.get()),
+									  0u,
+									  HashPointer(DepthInputLayout.get()),
+									  NormalizedDepth
+								  );
+
+			Queue.Submit(DepthKey, *this, InOcclusionSlot);
+		}
+	}
+
+	Queue.Submit(MakeStateKey(Pass, NormalizedDepth), *this, InOcclusionSlot);
+}
+
+void Drawable::Draw(RenderContext& InContext, const DrawStage InStage) const
+{
+	PROFILE_SCOPE("Drawable::Draw");
+	const RenderContext::EventScope Event {InContext, EventName};
+
+	const auto& Packet = GetPacket(InStage);
+	Packet.Apply(InContext, false);
+	InContext.DrawIndexed(Packet.IndexCount, Packet.StartIndex, Packet.BaseVertex);
+}
+
+void Drawable::DrawWithPixelShader(RenderContext& InContext, ID3D11PixelShader* InPixelShader, const DrawStage InStage) const
+{
+	PROFILE_SCOPE("Drawable::DrawWithPixelShader");
+	const RenderContext::EventScope Event {InContext, EventName};
+
+	const auto& Packet = GetPacket(InStage);
+	Packet.Apply(InContext, false);
+	InContext.GetStateCache().SetPixelShader(InPixelShader);
+	InContext.DrawIndexed(Packet.IndexCount, Packet.StartIndex, Packet.BaseVertex);
+}
+
+void Drawable::DrawIndirect(RenderContext& InContext, ID3D11Buffer* InArguments, const UINT InArgumentsOffset, const DrawStage InStage) const
+{
+	PROFILE_SCOPE("Drawable::DrawIndirect");
+	const RenderContext::EventScope Event {InContext, EventName};
+
+	GetPacket(InStage).Apply(InContext, false);
+	InContext.DrawIndexedInstancedIndirect(InArguments, InArgumentsOffset);
+}
+
+void Drawable::DrawInstancedIndirect(RenderContext& InContext, ID3D11Buffer* InArguments, const UINT InArgumentsOffset,
+                                     ID3D11ShaderResourceView* InInstanceView, const DrawStage InStage) const
+{
+	PROFILE_SCOPE("Drawable::DrawInstancedIndirect");
+	const RenderContext::EventScope Event {InContext, EventName};
+
+	assert(GetInstanceGroup() && "Drawable has no instanced vertex shader");
+
+	GetPacket(InStage).Apply(InContext, true);
+	InContext.GetStateCache().SetVertexShaderResource(MyInstanceBuffer->GetSlot(), InInstanceView);
+	InContext.DrawIndexedInstancedIndirect(InArguments, InArgumentsOffset);
+}
+
+void Drawable::DrawCompacted(RenderContext& InContext, ID3D11Buffer* InArguments, const UINT InArgumentsOffset, ID3D11Buffer* InIndices,
+                             const DrawStage InStage) const
+{
+	PROFILE_SCOPE("Drawable::DrawCompacted");
+	const RenderContext::EventScope Event {InContext, EventName};
+
+	GetPacket(InStage).Apply(InContext, false);
+	InContext.GetStateCache().SetIndexBuffer(InIndices, DXGI_FORMAT_R32_UINT);
+	InContext.DrawIndexedInstancedIndirect(InArguments, InArgumentsOffset);
+}
+
+void Drawable::DrawInstanced(RenderContext& InContext, const std::span<const Drawable* const> InInstances, const DrawStage InStage) const
+{
+	PROFILE_SCOPE("Drawable::DrawInstanced");
+	const RenderContext::EventScope Event {InContext, EventName};
+
+	assert(GetInstanceGroup() && "Drawable has no instanced vertex shader");
+
+	const auto& Packet = GetPacket(InStage);
+	Packet.Apply(InContext, true);
+	MyInstanceBuffer->Bind(InContext);
+
+	for (size_t First = 0; First < InInstances.size(); First += InstanceBuffer::Capacity)
+	{
+		const auto Last = std::min(First + InstanceBuffer::Capacity, InInstances.size());
+		// Dynamic buffers are write combined, so the transforms go in one sequential pass without a staging copy.
+		auto* const Transforms = MyInstanceBuffer->Map(InContext);
+
+		for (size_t InstanceIndex = First; InstanceIndex < Last; ++InstanceIndex)
+		{
+			auto& Written = Transforms[InstanceIndex - First];
+			Written.World = DirectX::XMMatrixTranspose(InInstances[InstanceIndex]->GetTransformMatrix());
+			Written.MaterialIndex = InInstances[InstanceIndex]->GetMaterialIndex();
+			Written.Animation = InInstances[InstanceIndex]->GetPlayedAnimation();
+		}
+
+		MyInstanceBuffer->Unmap(InContext);
+		InContext.DrawIndexedInstanced(Packet.IndexCount, static_cast<UINT>(Last - First), Packet.StartIndex, Packet.BaseVertex);
+	}
+}
+
+const void* Drawable::GetInstanceGroup() const noexcept
+{
+	// Offset by the range number so every range of a buffer groups apart, still within the index buffer object.
+	return InstancedVertexShader ? reinterpret_cast<const char*>(BoundIndexBuffer) + IndexRange : nullptr;
+}
+
+UINT Drawable::GetIndexCount() const noexcept
+{
+	return RangeIndexCount ? RangeIndexCount : BoundIndexBuffer->GetCount();
+}
+
+UINT Drawable::GetStartIndex() const noexcept
+{
+	return BoundIndexBuffer->GetStartIndex() + RangeFirstIndex;
+}
+
+INT Drawable::GetBaseVertex() const noexcept
+{
+	return BoundVertexBuffer->GetBaseVertex();
+}
+
+unsigned int Drawable::GetMaterialIndex() const noexcept
+{
+	return BoundMaterial ? BoundMaterial->GetId() : 0u;
+}
+
+bool Drawable::IsBackFaceCulled() const noexcept
+{
+	return !BoundPipelineState || BoundPipelineState->IsBackFaceCulled();
+}
+
+bool Drawable::IsOrderIndependent() const noexcept
+{
+	return BoundPipelineState && BoundPipelineState->IsOrderIndependent();
+}
+
+bool Drawable::IsGBufferSupported() const noexcept
+{
+	return BoundMaterial && BoundMaterial->GetGBufferPixelShader() && BoundPixelShader == BoundMaterial->GetPixelShader().get() &&
+	       !(BoundPipelineState && BoundPipelineState->IsBlended());
+}
+
+bool Drawable::IsAlphaTestSupported() const noexcept
+{
+	return BoundMaterial && BoundMaterial->GetAlphaTestPixelShader() && BoundPixelShader == BoundMaterial->GetPixelShader().get() &&
+	       !(BoundPipelineState && BoundPipelineState->IsBlended());
+}
+
+void Drawable::BindInstanced(const Graphics& InGraphics, std::shared_ptr<Bindable> InInstancedVertexShader)
+{
+	InstancedVertexShader = std::move(InInstancedVertexShader);
+	MyInstanceBuffer = InstanceBuffer::Resolve(InGraphics);
+	BakedRevision = NotBaked;
+}
+
+void Drawable::BindDepthOnly(const Graphics& InGraphics, const bool bInIsMorphed, const bool bInIsVertexAnimated)
+{
+	assert(BoundInputLayout && BoundVertexBuffer && BoundIndexBuffer && "Depth-only drawing needs the geometry bound first");
+
+	const auto& Layout = static_cast<const InputLayout*>(BoundInputLayout)->GetLayout();
+	// Skinned vertices move by their bones in the depth pass too, the position-only layout keeps their influences.
+	const auto bIsSkinned = Layout.Has<DV::VertexLayout::ElementType::BoneIndices>();
+	// Vertex animated ones sample their baked frames by vertex ID instead.
+	auto DepthShader = bInIsVertexAnimated ? VertexShader::Resolve(InGraphics, "DepthOnlyVertexAnimatedVS.cso")
+	                 : bInIsMorphed ? VertexShader::Resolve(InGraphics, bIsSkinned ? "DepthOnlyMorphedSkinnedVS.cso" : "DepthOnlyMorphedVS.cso")
+	                                : VertexShader::Resolve(InGraphics, bIsSkinned ? "DepthOnlySkinnedVS.cso" : "DepthOnlyVS.cso");
+
+	DepthInputLayout = InputLayout::Resolve(InGraphics, Layout, DepthShader->GetByteCode(), InputLayout::Elements::PositionOnly);
+	DepthVertexShader = std::move(DepthShader);
+	DepthInstancedVertexShader = VertexShader::Resolve(InGraphics, bInIsVertexAnimated ? "DepthOnlyVertexAnimatedInstancedVS.cso" : "DepthOnlyInstancedVS.cso");
+	BakedRevision = NotBaked;
+}
+
+void Drawable::SetIndexRange(const unsigned int InRange, const UINT InFirstIndex, const UINT InIndexCount) const noexcept
+{
+	IndexRange = InRange;
+	RangeFirstIndex = InFirstIndex;
+	RangeIndexCount = InIndexCount;
+
+	// Switching levels of detail happens every few frames, so the range is patched in rather than baking again.
+	if (BakedRevision != NotBaked)
+	{
+		for (auto* Packet : {&ShadedPacket, &DepthPacket, &GBufferPacket, &AlphaTestPacket})
+		{
+			Packet->IndexCount = GetIndexCount();
+			Packet->StartIndex = GetStartIndex();
+		}
+	}
+}
+
+void Drawable::UpdateGeometryRange() const noexcept
+{
+	if (BakedRevision != NotBaked)
+	{
+		for (auto* Packet : {&ShadedPacket, &DepthPacket, &GBufferPacket, &AlphaTestPacket})
+		{
+			Packet->IndexCount = GetIndexCount();
+			Packet->StartIndex = GetStartIndex();
+			Packet->BaseVertex = GetBaseVertex();
+		}
+	}
+}
+
+void Drawable::Bake() const
+{
+	assert(BoundVertexBuffer && BoundIndexBuffer && "Drawables need geometry bound before they are drawn");
+
+	// Read first, anything invalidating while baking then bakes again next time.
+	const auto Revision = Bindable::GetBakedRevision();
+
+	// Only the vertex shader is taken from the instanced and depth-only variants.
+	const auto BakeVertexShader = [](const Bindable& InShader)
+	{
+		DrawPacket Scratch;
+		InShader.Bake(Scratch);
+		return Scratch.VertexShader;
+	};
+
+	ShadedPacket = {};
+	Bindable* TransformConstants = nullptr;
+
+	for (const auto& Target : Bindables)
+	{
+		if (Target.get() == BoundTransformConstantBuffer)
+		{
+			TransformConstants = Target.get();
+		}
+		else if (!Target->Bake(ShadedPacket))
+		{
+			ShadedPacket.AddDynamic(Target.get());
+		}
+	}
+
+	ShadedPacket.TransformConstants = TransformConstants;
+
+	if (InstancedVertexShader)
+	{
+		ShadedPacket.InstancedVertexShader = BakeVertexShader(*InstancedVertexShader);
+	}
+
+	DepthPacket = {};
+
+	if (IsDepthOnlySupported())
+	{
+		BoundTopology->Bake(DepthPacket);
+		BoundVertexBuffer->Bake(DepthPacket);
+		BoundIndexBuffer->Bake(DepthPacket);
+		DepthInputLayout->Bake(DepthPacket);
+		DepthVertexShader->Bake(DepthPacket);
+		DepthPacket.InstancedVertexShader = BakeVertexShader(*DepthInstancedVertexShader);
+		DepthPacket.TransformConstants = TransformConstants;
+		// Two-sided surfaces lay down depth from both sides too.
+		DepthPacket.RasterizerState = ShadedPacket.RasterizerState;
+		// Only bone palettes, morph targets and their weights are read by the vertex shaders besides the transforms, the depth-only ones
+		// deform with the same.
+		DepthPacket.VertexShaderResources = ShadedPacket.VertexShaderResources;
+		DepthPacket.VertexShaderResourceNum = ShadedPacket.VertexShaderResourceNum;
+		DepthPacket.VertexConstantBuffers = ShadedPacket.VertexConstantBuffers;
+		DepthPacket.VertexConstantBufferNum = ShadedPacket.VertexConstantBufferNum;
+	}
+
+	GBufferPacket = {};
+
+	if (IsGBufferSupported())
+	{
+		// Everything else the material and mesh bind stays, only what the pixel shader writes changes.
+		DrawPacket Scratch;
+		BoundMaterial->GetGBufferPixelShader()->Bake(Scratch);
+		GBufferPacket = ShadedPacket;
+		GBufferPacket.PixelShader = Scratch.PixelShader;
+	}
+
+	AlphaTestPacket = {};
+
+	if (IsAlphaTestSupported())
+	{
+		// The shaded vertex shader hands the pixel shader the texture coordinate, the maps and sampler it reads are bound already.
+		DrawPacket Scratch;
+		BoundMaterial->GetAlphaTestPixelShader()->Bake(Scratch);
+		AlphaTestPacket = ShadedPacket;
+		AlphaTestPacket.PixelShader = Scratch.PixelShader;
+	}
+
+	for (auto* Packet : {&ShadedPacket, &DepthPacket, &GBufferPacket, &AlphaTestPacket})
+	{
+		Packet->IndexCount = GetIndexCount();
+		Packet->StartIndex = GetStartIndex();
+		Packet->BaseVertex = GetBaseVertex();
+	}
+
+	BakedRevision = Revision;
+}
+
+const DrawPacket& Drawable::GetPacket(const DrawStage InStage) const noexcept
+{
+	assert(BakedRevision != NotBaked && "Drawable is drawn without being submitted or prepared");
+
+	if (InStage == DrawStage::DepthOnly)
+	{
+		assert(IsDepthOnlySupported() && "Drawable has no depth-only path");
+		return DepthPacket;
+	}
+
+	if (InStage == DrawStage::GBuffer)
+	{
+		assert(IsGBufferSupported() && "Drawable has no G-buffer path");
+		return GBufferPacket;
+	}
+
+	if (InStage == DrawStage::AlphaTest)
+	{
+		assert(IsAlphaTestSupported() && "Drawable has no alpha test path");
+		return AlphaTestPacket;
+	}
+
+	return ShadedPacket;
+}
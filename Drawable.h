@@ -1,12 +1,24 @@
 ﻿#pragma once
 #include "EngineWin.h"
+#include <DirectXCollision.h>
 #include <DirectXMath.h>
 #include <memory>
+#include <span>
+#include <string>
 #include <vector>
+#include "DrawPacket.h"
+#include "GpuScene.h"
+#include "MeshOptimizer.h"
+#include "RenderQueue.h"
 
 class Graphics;
 class Bindable;
+class RenderContext;
 class IndexBuffer;
+class InstanceBuffer;
+class Material;
+class PipelineState;
+class VertexBuffer;
 
 class Drawable
 {
@@ -19,11 +31,156 @@ public:
 	virtual ~Drawable();
 
 	[[nodiscard]] virtual DirectX::XMMATRIX GetTransformMatrix() const noexcept = 0;
+	// Bounds of the drawn geometry before the transform, null when unknown so instances are never culled on the GPU.
+	[[nodiscard]] virtual const DirectX::BoundingBox* GetLocalBounds() const noexcept
+	{
+		return nullptr;
+	}
 
+	// ID of the transform GetTransformMatrix returns in the GpuScene, NoIndex for drawables that aren't kept there.
+	[[nodiscard]] virtual unsigned int GetSceneIndex() const noexcept
+	{
+		return GpuScene::NoIndex;
+	}
+
+	// Clusters of the range drawn right now with indices relative to GetStartIndex, empty when there are none to cull apart.
+	[[nodiscard]] virtual std::span<const MeshOptimizer::Meshlet> GetMeshlets() const noexcept
+	{
+		return {};
+	}
+
+	// Clip and time offset the vertex animated shaders play, packed by VertexAnimation::Pack. Instances carry it like their material.
+	[[nodiscard]] virtual UINT GetPlayedAnimation() const noexcept
+	{
+		return 0u;
+	}
+
+	// Draws are skipped by the GPU when this is set and false, null to draw unconditionally.
+	[[nodiscard]] virtual ID3D11Predicate* GetPredicate() const noexcept
+	{
+		return nullptr;
+	}
+
+	// Null is ignored.
 	void Bind(std::shared_ptr<Bindable> InBindable);
-	void Draw(const Graphics& InGraphics) const;
+	// Bakes the draw packets again when bindables were added or changed since, on the main thread before anything records.
+	// Submit calls it, so does anything else that queues the drawable to be drawn this frame.
+	void Prepare() const;
+	// Opaque submissions also go through the depth pre-pass when the render queue has it enabled, alpha-tested ones go to the alpha-tested passes instead.
+	// Drawables with a blended pipeline go to one of the blended passes whatever pass is asked for.
+	void Submit(const Graphics& InGraphics, RenderPass InPass = RenderPass::Opaque, unsigned int InOcclusionSlot = OcclusionCuller::NoSlot) const;
+	void Draw(RenderContext& InContext, DrawStage InStage = DrawStage::Shaded) const;
+	// The depth only state with InPixelShader in place of none, such as one writing IDs. Its constants are the caller's to bind.
+	// Another stage's state keeps its vertex shader outputs, for pixel shaders reading more than the position.
+	void DrawWithPixelShader(RenderContext& InContext, ID3D11PixelShader* InPixelShader, DrawStage InStage = DrawStage::DepthOnly) const;
+	void DrawInstanced(RenderContext& InContext, std::span<const Drawable* const> InInstances, DrawStage InStage = DrawStage::Shaded) const;
+	// Same state as Draw, with the index and instance counts taken from a GPU written argument buffer.
+	void DrawIndirect(RenderContext& InContext, ID3D11Buffer* InArguments, UINT InArgumentsOffset, DrawStage InStage = DrawStage::Shaded) const;
+	// Instanced, with the transforms read from InInstanceView in place of the instance buffer, such as the instance culler's survivors.
+	void DrawInstancedIndirect(RenderContext& InContext, ID3D11Buffer* InArguments, UINT InArgumentsOffset, ID3D11ShaderResourceView* InInstanceView,
+	                           DrawStage InStage = DrawStage::Shaded) const;
+	// Same state as Draw, with InIndices in place of the bound index buffer, such as the meshlet culler's compacted triangles.
+	void DrawCompacted(RenderContext& InContext, ID3D11Buffer* InArguments, UINT InArgumentsOffset, ID3D11Buffer* InIndices,
+	                   DrawStage InStage = DrawStage::Shaded) const;
+
+	// Drawables sharing the same geometry and state report the same group, null when instancing is unsupported.
+	[[nodiscard]] const void* GetInstanceGroup() const noexcept;
+	[[nodiscard]] UINT GetIndexCount() const noexcept;
+	// Where the geometry sits in the shared pages, indirect arguments have to carry the same values.
+	[[nodiscard]] UINT GetStartIndex() const noexcept;
+	[[nodiscard]] INT GetBaseVertex() const noexcept;
+	// Where the material shaders find the bound material's parameters in the MaterialTable, zero without a material.
+	[[nodiscard]] unsigned int GetMaterialIndex() const noexcept;
+	[[nodiscard]] const IndexBuffer* GetIndexBuffer() const noexcept
+	{
+		return BoundIndexBuffer;
+	}
+
+	// False for pipelines drawing both sides, whose back faces can't be culled before the rasterizer either.
+	[[nodiscard]] bool IsBackFaceCulled() const noexcept;
+
+	[[nodiscard]] bool IsDepthOnlySupported() const noexcept
+	{
+		return DepthVertexShader != nullptr;
+	}
+
+	// Blended by weight into the order-independent transparency targets, the only targets its pixel shader writes.
+	[[nodiscard]] bool IsOrderIndependent() const noexcept;
+
+	// Opaque drawables shaded by their material's own pixel shader, which has a G-buffer build.
+	[[nodiscard]] bool IsGBufferSupported() const noexcept;
+
+	// Opaque drawables shaded by their alpha-tested material's own pixel shader, which are drawn in the alpha-tested passes.
+	[[nodiscard]] bool IsAlphaTestSupported() const noexcept;
+
+	// Whose vertex shaders, the depth-only ones too, draw both eyes of the instanced stereo pass, see FrameConstants.hlsli.
+	[[nodiscard]] bool IsStereoInstanced() const noexcept
+	{
+		return bIsStereoInstanced;
+	}
+
+	// The event its draws are wrapped in for capture tools, none while empty.
+	void SetEventName(std::wstring InName) noexcept
+	{
+		EventName = std::move(InName);
+	}
+
+	[[nodiscard]] const std::wstring& GetEventName() const noexcept
+	{
+		return EventName;
+	}
+
+protected:
+	void BindInstanced(const Graphics& InGraphics, std::shared_ptr<Bindable> InInstancedVertexShader);
+	// Derives a position-only input layout from the bound one, so the depth pre-pass reads only the position stream of the same vertex buffer.
+	// Morphed drawables take the depth-only shaders that add their blend shapes, from the morph targets they bind, vertex animated ones
+	// those that sample the frames they bind.
+	void BindDepthOnly(const Graphics& InGraphics, bool bInIsMorphed = false, bool bInIsVertexAnimated = false);
+
+	void EnableStereoInstancing() noexcept
+	{
+		bIsStereoInstanced = true;
+	}
+
+	// Draws InIndexCount indices from InFirstIndex on instead of the whole buffer, e.g. one level of detail.
+	// Ranges are numbered so instances only group with others drawing the same one.
+	void SetIndexRange(unsigned int InRange, UINT InFirstIndex, UINT InIndexCount) const noexcept;
+	// After writing the DynamicVertexBuffer or DynamicIndexBuffer it binds, moves the baked draws onto what was written.
+	void UpdateGeometryRange() const noexcept;
+
+private:
+	static constexpr unsigned long long NotBaked {~0ull};
+
+	void Bake() const;
+	[[nodiscard]] const DrawPacket& GetPacket(DrawStage InStage) const noexcept;
 
 private:
 	const IndexBuffer* BoundIndexBuffer = nullptr;
+	const VertexBuffer* BoundVertexBuffer = nullptr;
+	const Bindable* BoundTopology = nullptr;
+	const Bindable* BoundTransformConstantBuffer = nullptr;
+	const Bindable* BoundVertexShader = nullptr;
+	const Bindable* BoundPixelShader = nullptr;
+	const Bindable* BoundInputLayout = nullptr;
+	const Material* BoundMaterial = nullptr;
+	const PipelineState* BoundPipelineState = nullptr;
+	size_t TextureSetHash = 0u;
 	std::vector<std::shared_ptr<Bindable>> Bindables;
+	std::shared_ptr<Bindable> InstancedVertexShader;
+	std::shared_ptr<InstanceBuffer> MyInstanceBuffer;
+	std::shared_ptr<Bindable> DepthVertexShader;
+	std::shared_ptr<Bindable> DepthInstancedVertexShader;
+	std::shared_ptr<Bindable> DepthInputLayout;
+	// Relative to the start of the index buffer, a zero count draws all of it.
+	mutable unsigned int IndexRange = 0u;
+	mutable UINT RangeFirstIndex = 0u;
+	mutable UINT RangeIndexCount = 0u;
+	mutable DrawPacket ShadedPacket;
+	mutable DrawPacket DepthPacket;
+	mutable DrawPacket GBufferPacket;
+	mutable DrawPacket AlphaTestPacket;
+	// The bindable revision the packets were baked at.
+	mutable unsigned long long BakedRevision = NotBaked;
+	std::wstring EventName;
+	bool bIsStereoInstanced = false;
 };
@@ -0,0 +1,87 @@
+﻿#include "DynamicIndexBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include "ExceptionMacros.h"
+
+namespace
+{
+	UINT GetIndexSize(const DXGI_FORMAT InFormat) noexcept
+	{
+		return InFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+}
+
+DynamicIndexBuffer::DynamicIndexBuffer(const Graphics& InGraphics, const std::string& InTag, const UINT InCapacity, const DXGI_FORMAT InFormat)
+	: IndexBuffer(InGraphics, StringAtom(InTag), InFormat)
+	, Capacity(InCapacity)
+{
+	assert(Capacity > 0u && "Dynamic index buffers need room for at least one index");
+
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC IndexDesc {};
+	IndexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	IndexDesc.Usage = D3D11_USAGE_DYNAMIC;
+	IndexDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	IndexDesc.ByteWidth = Capacity * GetIndexSize(Format);
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer(&IndexDesc, nullptr, &MyBuffer))
+
+	MyAllocation.Buffer = MyBuffer.Get();
+}
+
+DynamicIndexBuffer::~DynamicIndexBuffer()
+{
+	// The buffer is this one's own, there is nothing to hand back to the pool.
+	MyAllocation = {};
+}
+
+void DynamicIndexBuffer::Write(RenderContext& InContext, const std::span<const unsigned int> InIndices)
+{
+	assert(InIndices.size() <= Capacity && "More indices than the dynamic index buffer holds");
+
+	const auto IndexNum = static_cast<UINT>(InIndices.size());
+	auto MapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	if (WriteCursor + IndexNum > Capacity)
+	{
+		MapType = D3D11_MAP_WRITE_DISCARD;
+		WriteCursor = 0u;
+	}
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	CHECK_HRESULT_EXCEPTION(GetContext(InContext)->Map(MyBuffer.Get(), 0u, MapType, 0u, &MappedResource))
+
+	if (Format == DXGI_FORMAT_R16_UINT)
+	{
+		assert(std::all_of(InIndices.begin(), InIndices.end(), [](const unsigned int InIndex)
+		{
+			return InIndex <= std::numeric_limits<uint16_t>::max();
+		}) && "Index past what a 16 bit dynamic index buffer holds");
+
+		std::transform(InIndices.begin(), InIndices.end(), static_cast<uint16_t*>(MappedResource.pData) + WriteCursor, [](const unsigned int InIndex)
+		{
+			return static_cast<uint16_t>(InIndex);
+		});
+	}
+	else
+	{
+		std::memcpy(static_cast<uint32_t*>(MappedResource.pData) + WriteCursor, InIndices.data(), InIndices.size_bytes());
+	}
+
+	GetContext(InContext)->Unmap(MyBuffer.Get(), 0u);
+
+	GetStateCache(InContext).CountUpload(static_cast<size_t>(IndexNum) * GetIndexSize(Format));
+	MyAllocation.Offset = WriteCursor;
+	MyAllocation.Num = IndexNum;
+	Count = IndexNum;
+	WriteCursor += IndexNum;
+}
+
+size_t DynamicIndexBuffer::GetGpuByteSize() const noexcept
+{
+	return static_cast<size_t>(Capacity) * GetIndexSize(Format);
+}
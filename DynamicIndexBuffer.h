@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <span>
+#include "wrl/client.h"
+#include "IndexBuffer.h"
+
+/**
+ * The indices of a DynamicVertexBuffer's geometry, written the same way: appended behind what the GPU may still read and
+ * discarded once full. The format is fixed at creation, 16 bit ones are narrowed as they are written. Without a raw view, so
+ * compute passes such as the meshlet culler never read it.
+ */
+class DynamicIndexBuffer : public IndexBuffer
+{
+public:
+	DynamicIndexBuffer(const Graphics& InGraphics, const std::string& InTag, UINT InCapacity, DXGI_FORMAT InFormat = DXGI_FORMAT_R16_UINT);
+	~DynamicIndexBuffer() override;
+
+	// Through the immediate context, before the frame's draws. At most the capacity's indices, each within the format.
+	void Write(RenderContext& InContext, std::span<const unsigned int> InIndices);
+
+	[[nodiscard]] UINT GetCapacity() const noexcept
+	{
+		return Capacity;
+	}
+
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> MyBuffer;
+	UINT Capacity;
+	// First index no write used since the last discard.
+	UINT WriteCursor {0u};
+};
@@ -0,0 +1,54 @@
+﻿#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+float DynamicResolution::Update(const float InGpuMilliseconds) noexcept
+{
+	if (HoldMeasurementsLeft > 0u)
+	{
+		--HoldMeasurementsLeft;
+		return Scale;
+	}
+
+	if (InGpuMilliseconds <= 0.0f)
+	{
+		return Scale;
+	}
+
+	const auto IdealScale = Scale * std::sqrt(TargetMilliseconds * Headroom / InGpuMilliseconds);
+	const auto NextScale = std::clamp(Scale + (IdealScale - Scale) * Damping, MinScale, MaxScale);
+
+	if (NextScale == Scale || (std::abs(NextScale - Scale) < MinStep && NextScale != MinScale && NextScale != MaxScale))
+	{
+		return Scale;
+	}
+
+	Scale = NextScale;
+	HoldMeasurementsLeft = HoldMeasurementNum;
+
+	return Scale;
+}
+
+void DynamicResolution::Reset() noexcept
+{
+	Scale = MaxScale;
+	HoldMeasurementsLeft = 0u;
+}
+
+void DynamicResolution::SetTargetFrameTime(const float InMilliseconds) noexcept
+{
+	TargetMilliseconds = std::max(InMilliseconds, 0.1f);
+}
+
+void DynamicResolution::SetMinScale(const float InMinScale) noexcept
+{
+	MinScale = std::clamp(InMinScale, 0.1f, 1.0f);
+	MaxScale = std::max(MaxScale, MinScale);
+	Scale = std::max(Scale, MinScale);
+}
+
+void DynamicResolution::SetMaxScale(const float InMaxScale) noexcept
+{
+	MaxScale = std::clamp(InMaxScale, MinScale, 1.0f);
+	Scale = std::min(Scale, MaxScale);
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+/**
+ * Picks the scale the scene renders at from measured GPU frame times, so scenes too heavy for the GPU lose resolution
+ * instead of frame rate.
+ * Pixel cost follows the square of the scale. Each measurement moves the scale part of the way to where it would have
+ * met the target, then holds it while the timings still trail from frames at the old scale.
+ */
+class DynamicResolution
+{
+public:
+	// One measurement of a whole frame, returns the scale for the frames from now on.
+	float Update(float InGpuMilliseconds) noexcept;
+	// Back to the highest scale, with the history of the last scale forgotten.
+	void Reset() noexcept;
+
+	void SetTargetFrameTime(float InMilliseconds) noexcept;
+
+	[[nodiscard]] float GetTargetFrameTime() const noexcept
+	{
+		return TargetMilliseconds;
+	}
+
+	// The scale never drops below this for either axis, at a quarter of the pixels by default.
+	void SetMinScale(float InMinScale) noexcept;
+
+	[[nodiscard]] float GetMinScale() const noexcept
+	{
+		return MinScale;
+	}
+
+	// Nor rises above this, what a machine's quality preset caps it at. Full resolution by default.
+	void SetMaxScale(float InMaxScale) noexcept;
+
+	[[nodiscard]] float GetMaxScale() const noexcept
+	{
+		return MaxScale;
+	}
+
+	[[nodiscard]] float GetScale() const noexcept
+	{
+		return Scale;
+	}
+
+private:
+	// Aims a little under the target, so ordinary noise doesn't push frames over it.
+	static constexpr float Headroom {0.9f};
+	// Of the way to the ideal scale each change covers, so single spikes don't swing it.
+	static constexpr float Damping {0.5f};
+	// Smaller changes are ignored unless they reach a bound, each one costs a few frames of hold.
+	static constexpr float MinStep {0.02f};
+	// Measurements skipped after a change, the GPU profiler's readback latency, as they were still rendered at the old scale.
+	static constexpr unsigned int HoldMeasurementNum {4u};
+
+private:
+	float TargetMilliseconds {1000.0f / 60.0f};
+	float MinScale {0.5f};
+	float MaxScale {1.0f};
+	float Scale {1.0f};
+	unsigned int HoldMeasurementsLeft {0u};
+};
@@ -1,7 +1,13 @@
 ﻿#pragma once
 #include <d3d11.h>
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace DV
@@ -14,6 +20,71 @@ namespace DV
 		unsigned char B;
 	};
 
+	// Octahedral mapping of a unit normal onto the [-1, 1] square, even precision over the whole sphere in two components.
+	inline DirectX::PackedVector::XMSHORTN2 EncodeOctahedralNormal(const DirectX::XMFLOAT3& InNormal) noexcept
+	{
+		const auto Length = std::max(std::abs(InNormal.x) + std::abs(InNormal.y) + std::abs(InNormal.z), 1e-8f);
+		auto X = InNormal.x / Length;
+		auto Y = InNormal.y / Length;
+
+		// The lower hemisphere is folded over the diagonals.
+		if (InNormal.z < 0.0f)
+		{
+			const auto FoldedX = (1.0f - std::abs(Y)) * (X >= 0.0f ? 1.0f : -1.0f);
+			Y = (1.0f - std::abs(X)) * (Y >= 0.0f ? 1.0f : -1.0f);
+			X = FoldedX;
+		}
+
+		return {X, Y};
+	}
+
+	// Inverse of EncodeOctahedralNormal, for code that has to move packed vertices on the CPU.
+	inline DirectX::XMFLOAT3 DecodeOctahedralNormal(const DirectX::PackedVector::XMSHORTN2& InPacked) noexcept
+	{
+		DirectX::XMFLOAT2 Encoded;
+		DirectX::XMStoreFloat2(&Encoded, DirectX::PackedVector::XMLoadShortN2(&InPacked));
+
+		auto X = Encoded.x;
+		auto Y = Encoded.y;
+		const auto Z = 1.0f - std::abs(X) - std::abs(Y);
+
+		if (Z < 0.0f)
+		{
+			const auto UnfoldedX = (1.0f - std::abs(Y)) * (X >= 0.0f ? 1.0f : -1.0f);
+			Y = (1.0f - std::abs(X)) * (Y >= 0.0f ? 1.0f : -1.0f);
+			X = UnfoldedX;
+		}
+
+		DirectX::XMFLOAT3 Normal;
+		DirectX::XMStoreFloat3(&Normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(X, Y, Z, 0.0f)));
+		return Normal;
+	}
+
+	// Only the tangent and the sign of the bitangent are kept, the shaders rebuild the bitangent as cross(N, T).
+	inline DirectX::PackedVector::XMUDECN4 EncodeTangentFrame(const DirectX::XMFLOAT3& InNormal, const DirectX::XMFLOAT3& InTangent,
+	                                                         const DirectX::XMFLOAT3& InBitangent) noexcept
+	{
+		const auto Normal = DirectX::XMLoadFloat3(&InNormal);
+		const auto Tangent = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&InTangent));
+		const auto bIsMirrored = DirectX::XMVectorGetX(DirectX::XMVector3Dot(DirectX::XMVector3Cross(Normal, Tangent), DirectX::XMLoadFloat3(&InBitangent))) < 0.0f;
+
+		DirectX::PackedVector::XMUDECN4 Packed;
+		DirectX::PackedVector::XMStoreUDecN4(&Packed, DirectX::XMVectorSetW(DirectX::XMVectorMultiplyAdd(Tangent, DirectX::g_XMOneHalf, DirectX::g_XMOneHalf), bIsMirrored ? 0.0f : 1.0f));
+		return Packed;
+	}
+
+	// The tangent and the bitangent EncodeTangentFrame was given, the bitangent rebuilt from the normal the way the shaders do.
+	inline void DecodeTangentFrame(const DirectX::PackedVector::XMUDECN4& InPacked, const DirectX::XMFLOAT3& InNormal, DirectX::XMFLOAT3& OutTangent,
+	                               DirectX::XMFLOAT3& OutBitangent) noexcept
+	{
+		const auto Unpacked = DirectX::PackedVector::XMLoadUDecN4(&InPacked);
+		const auto Tangent = DirectX::XMVector3Normalize(DirectX::XMVectorMultiplyAdd(Unpacked, DirectX::g_XMTwo, DirectX::g_XMNegativeOne));
+		const auto Handedness = DirectX::XMVectorGetW(Unpacked) < 0.5f ? -1.0f : 1.0f;
+
+		DirectX::XMStoreFloat3(&OutTangent, Tangent);
+		DirectX::XMStoreFloat3(&OutBitangent, DirectX::XMVectorScale(DirectX::XMVector3Cross(DirectX::XMLoadFloat3(&InNormal), Tangent), Handedness));
+	}
+
 	class VertexLayout
 	{
 	public:
@@ -27,7 +98,18 @@ namespace DV
 			Bitangent,
 			Float3Color,
 			Float4Color,
-			BGRAColor
+			BGRAColor,
+			// Compact encodings decoded in the vertex shaders, see VertexPacking.hlsli.
+			OctahedralNormal,
+			TangentFrame,
+			HalfTexture2D,
+			// Four bones per vertex into the mesh's bone palette, and how much each of them moves it.
+			BoneIndices,
+			BoneWeights,
+			// Ambient occlusion baked at import, see ImportProfile.
+			Occlusion,
+			// Where the vertex lies in its mesh's lightmap, unwrapped at import, see Lightmapper.
+			LightmapTexture2D
 		};
 
 		template<ElementType> struct TypeMap;
@@ -104,39 +186,122 @@ namespace DV
 			static constexpr const char* Code = "RGBA8";
 		};
 
+		template<> struct TypeMap<ElementType::OctahedralNormal>
+		{
+			using SystemType = DirectX::PackedVector::XMSHORTN2;
+			static constexpr DXGI_FORMAT DxgiFormat = DXGI_FORMAT_R16G16_SNORM;
+			static constexpr const char* Semantic = "Normal";
+			static constexpr const char* Code = "Nq";
+		};
+
+		// Tangent remapped to [0, 1] in XYZ, bitangent handedness in W.
+		template<> struct TypeMap<ElementType::TangentFrame>
+		{
+			using SystemType = DirectX::PackedVector::XMUDECN4;
+			static constexpr DXGI_FORMAT DxgiFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
+			static constexpr const char* Semantic = "Tangent";
+			static constexpr const char* Code = "Ntq";
+		};
+
+		template<> struct TypeMap<ElementType::HalfTexture2D>
+		{
+			using SystemType = DirectX::PackedVector::XMHALF2;
+			static constexpr DXGI_FORMAT DxgiFormat = DXGI_FORMAT_R16G16_FLOAT;
+			static constexpr const char* Semantic = "TexCoord";
+			static constexpr const char* Code = "T2h";
+		};
+
+		template<> struct TypeMap<ElementType::BoneIndices>
+		{
+			using SystemType = DirectX::PackedVector::XMUBYTE4;
+			static constexpr DXGI_FORMAT DxgiFormat = DXGI_FORMAT_R8G8B8A8_UINT;
+			static constexpr const char* Semantic = "BlendIndices";
+			static constexpr const char* Code = "Bi";
+		};
+
+		// Sum to one, unused influences have zero weight.
+		template<> struct TypeMap<ElementType::BoneWeights>
+		{
+			using SystemType = DirectX::PackedVector::XMUBYTEN4;
+			static constexpr DXGI_FORMAT DxgiFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+			static constexpr const char* Semantic = "BlendWeight";
+			static constexpr const char* Code = "Bw";
+		};
+
+		// Only the first component is used, four bytes keep the elements after it aligned.
+		template<> struct TypeMap<ElementType::Occlusion>
+		{
+			using SystemType = DirectX::PackedVector::XMUBYTEN4;
+			static constexpr DXGI_FORMAT DxgiFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+			static constexpr const char* Semantic = "Occlusion";
+			static constexpr const char* Code = "Ao";
+		};
+
+		// Sixteen bits resolve a texel of the largest atlas many times over, half floats would not near one.
+		template<> struct TypeMap<ElementType::LightmapTexture2D>
+		{
+			using SystemType = DirectX::PackedVector::XMUSHORTN2;
+			static constexpr DXGI_FORMAT DxgiFormat = DXGI_FORMAT_R16G16_UNORM;
+			static constexpr const char* Semantic = "LightmapTexCoord";
+			static constexpr const char* Code = "Tl";
+		};
+
+		// On the GPU the position is a stream of its own, so passes that only need it fetch a quarter of the bytes or less.
+		// Everything else is interleaved in the attribute stream, on the CPU vertices stay interleaved as laid out.
+		static constexpr UINT PositionStream {0u};
+		static constexpr UINT AttributeStream {1u};
+		static constexpr UINT StreamNum {2u};
+
 		class Element
 		{
 		private:
 			ElementType Type;
 			size_t ByteOffset;
+			size_t StreamOffset;
 
 		public:
-			Element(const ElementType InType, const size_t InByteOffset)
-				: Type(InType), ByteOffset(InByteOffset)
+			Element(const ElementType InType, const size_t InByteOffset, const size_t InStreamOffset)
+				: Type(InType), ByteOffset(InByteOffset), StreamOffset(InStreamOffset)
 			{}
 
 			[[nodiscard]] D3D11_INPUT_ELEMENT_DESC GetDesc() const
 			{
+				const auto Stream = GetStream();
+
 				switch (Type)
 				{
 				case ElementType::Position2D:
-					return GenerateDesc<ElementType::Position2D>(GetByteOffset());
+					return GenerateDesc<ElementType::Position2D>(Stream, StreamOffset);
 				case ElementType::Position3D:
-					return GenerateDesc<ElementType::Position3D>(GetByteOffset());
+					return GenerateDesc<ElementType::Position3D>(Stream, StreamOffset);
 				case ElementType::Texture2D:
-					return GenerateDesc<ElementType::Texture2D>(GetByteOffset());
+					return GenerateDesc<ElementType::Texture2D>(Stream, StreamOffset);
 				case ElementType::Normal:
-					return GenerateDesc<ElementType::Normal>(GetByteOffset());
+					return GenerateDesc<ElementType::Normal>(Stream, StreamOffset);
 				case ElementType::Tangent:
-					return GenerateDesc<ElementType::Tangent>(GetByteOffset());
+					return GenerateDesc<ElementType::Tangent>(Stream, StreamOffset);
 				case ElementType::Bitangent:
-					return GenerateDesc<ElementType::Bitangent>(GetByteOffset());
+					return GenerateDesc<ElementType::Bitangent>(Stream, StreamOffset);
 				case ElementType::Float3Color:
-					return GenerateDesc<ElementType::Float3Color>(GetByteOffset());;
+					return GenerateDesc<ElementType::Float3Color>(Stream, StreamOffset);
 				case ElementType::Float4Color:
-					return GenerateDesc<ElementType::Float4Color>(GetByteOffset());
+					return GenerateDesc<ElementType::Float4Color>(Stream, StreamOffset);
 				case ElementType::BGRAColor:
-					return GenerateDesc<ElementType::BGRAColor>(GetByteOffset());
+					return GenerateDesc<ElementType::BGRAColor>(Stream, StreamOffset);
+				case ElementType::OctahedralNormal:
+					return GenerateDesc<ElementType::OctahedralNormal>(Stream, StreamOffset);
+				case ElementType::TangentFrame:
+					return GenerateDesc<ElementType::TangentFrame>(Stream, StreamOffset);
+				case ElementType::HalfTexture2D:
+					return GenerateDesc<ElementType::HalfTexture2D>(Stream, StreamOffset);
+				case ElementType::BoneIndices:
+					return GenerateDesc<ElementType::BoneIndices>(Stream, StreamOffset);
+				case ElementType::BoneWeights:
+					return GenerateDesc<ElementType::BoneWeights>(Stream, StreamOffset);
+				case ElementType::Occlusion:
+					return GenerateDesc<ElementType::Occlusion>(Stream, StreamOffset);
+				case ElementType::LightmapTexture2D:
+					return GenerateDesc<ElementType::LightmapTexture2D>(Stream, StreamOffset);
 				default:
 					assert(false && "Invalid element type");
 					return {"INVALID", 0, DXGI_FORMAT_UNKNOWN, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0};
@@ -148,11 +313,28 @@ namespace DV
 				return Type;
 			}
 
+			// In the interleaved vertex.
 			[[nodiscard]] size_t GetByteOffset() const
 			{
 				return ByteOffset;
 			}
 
+			[[nodiscard]] UINT GetStream() const noexcept
+			{
+				return StreamOf(Type);
+			}
+
+			// In the vertex of its stream.
+			[[nodiscard]] size_t GetStreamOffset() const noexcept
+			{
+				return StreamOffset;
+			}
+
+			static constexpr UINT StreamOf(const ElementType InType) noexcept
+			{
+				return InType == ElementType::Position2D || InType == ElementType::Position3D ? PositionStream : AttributeStream;
+			}
+
 			[[nodiscard]] const char* GetCode() const noexcept
 			{
 				switch (Type)
@@ -175,6 +357,20 @@ namespace DV
 					return TypeMap<ElementType::Float4Color>::Code;
 				case ElementType::BGRAColor:
 					return TypeMap<ElementType::BGRAColor>::Code;
+				case ElementType::OctahedralNormal:
+					return TypeMap<ElementType::OctahedralNormal>::Code;
+				case ElementType::TangentFrame:
+					return TypeMap<ElementType::TangentFrame>::Code;
+				case ElementType::HalfTexture2D:
+					return TypeMap<ElementType::HalfTexture2D>::Code;
+				case ElementType::BoneIndices:
+					return TypeMap<ElementType::BoneIndices>::Code;
+				case ElementType::BoneWeights:
+					return TypeMap<ElementType::BoneWeights>::Code;
+				case ElementType::Occlusion:
+					return TypeMap<ElementType::Occlusion>::Code;
+				case ElementType::LightmapTexture2D:
+					return TypeMap<ElementType::LightmapTexture2D>::Code;
 				default:
 					assert(false && "Invalid Element Type");
 					return nullptr;
@@ -208,6 +404,20 @@ namespace DV
 					return sizeof(TypeMap<ElementType::Float4Color>::SystemType);
 				case ElementType::BGRAColor:
 					return sizeof(TypeMap<ElementType::BGRAColor>::SystemType);
+				case ElementType::OctahedralNormal:
+					return sizeof(TypeMap<ElementType::OctahedralNormal>::SystemType);
+				case ElementType::TangentFrame:
+					return sizeof(TypeMap<ElementType::TangentFrame>::SystemType);
+				case ElementType::HalfTexture2D:
+					return sizeof(TypeMap<ElementType::HalfTexture2D>::SystemType);
+				case ElementType::BoneIndices:
+					return sizeof(TypeMap<ElementType::BoneIndices>::SystemType);
+				case ElementType::BoneWeights:
+					return sizeof(TypeMap<ElementType::BoneWeights>::SystemType);
+				case ElementType::Occlusion:
+					return sizeof(TypeMap<ElementType::Occlusion>::SystemType);
+				case ElementType::LightmapTexture2D:
+					return sizeof(TypeMap<ElementType::LightmapTexture2D>::SystemType);
 				default:
 					assert(false && "Invalid Element Type");
 					return NULL;
@@ -216,11 +426,11 @@ namespace DV
 
 		private:
 			template<ElementType T>
-			static constexpr D3D11_INPUT_ELEMENT_DESC GenerateDesc(const size_t InOffset) noexcept
+			static constexpr D3D11_INPUT_ELEMENT_DESC GenerateDesc(const UINT InStream, const size_t InOffset) noexcept
 			{
 				using ElementType = TypeMap<T>;
 				return {ElementType::Semantic,0, ElementType::DxgiFormat,
-						   0, static_cast<UINT>(InOffset),
+						   InStream, static_cast<UINT>(InOffset),
 				 		   D3D11_INPUT_PER_VERTEX_DATA, 0};
 			}
 		};
@@ -233,13 +443,13 @@ namespace DV
 		{
 			for (const auto ElementType : InElementTypeList)
 			{
-				Elements.emplace_back(ElementType, Size());
+				Append(ElementType);
 			}
 		}
 
 		VertexLayout& Append(ElementType InElementType)
 		{
-			Elements.emplace_back(InElementType, Size());
+			Elements.emplace_back(InElementType, Size(), GetStreamStride(Element::StreamOf(InElementType)));
 			return *this;
 		}
 
@@ -260,6 +470,15 @@ namespace DV
 			}
 		}
 
+		template<ElementType T>
+		[[nodiscard]] bool Has() const noexcept
+		{
+			return std::any_of(Elements.begin(), Elements.end(), [](const Element& InElement)
+			{
+				return InElement.GetType() == T;
+			});
+		}
+
 		[[nodiscard]] std::vector<D3D11_INPUT_ELEMENT_DESC> GetD3D11Layout() const
 		{
 			std::vector<D3D11_INPUT_ELEMENT_DESC> InputElementDescs;
@@ -273,6 +492,29 @@ namespace DV
 			return InputElementDescs;
 		}
 
+		// Only the position stream, so depth-only shaders fetch nothing else from the same buffers.
+		// Bone influences are kept as well from the attribute stream, skinned depth has to move the same way the shaded vertices do.
+		[[nodiscard]] std::vector<D3D11_INPUT_ELEMENT_DESC> GetPositionD3D11Layout() const
+		{
+			std::vector<D3D11_INPUT_ELEMENT_DESC> InputElementDescs;
+			bool bHasPosition = false;
+
+			for (const auto& Element : Elements)
+			{
+				const auto Type = Element.GetType();
+
+				if ((!bHasPosition && (Type == ElementType::Position2D || Type == ElementType::Position3D)) ||
+				    Type == ElementType::BoneIndices || Type == ElementType::BoneWeights)
+				{
+					bHasPosition |= Type == ElementType::Position2D || Type == ElementType::Position3D;
+					InputElementDescs.push_back(Element.GetDesc());
+				}
+			}
+
+			assert(bHasPosition && "Layout has no position");
+			return InputElementDescs;
+		}
+
 		[[nodiscard]] std::string GetCode() const
 		{
 			std::string AccumulatedCode;
@@ -307,6 +549,42 @@ namespace DV
 		{
 			return Elements.size();
 		}
+
+		// Zero for a stream without elements, which draws leave unbound.
+		[[nodiscard]] size_t GetStreamStride(const UINT InStream) const noexcept
+		{
+			size_t Stride = 0u;
+
+			for (const auto& Element : Elements)
+			{
+				if (Element.GetStream() == InStream)
+				{
+					Stride += Element.Size();
+				}
+			}
+
+			return Stride;
+		}
+
+		// Gathers InStream's elements of InVertexNum interleaved vertices, OutStream holds GetStreamStride bytes per vertex.
+		void CopyStream(const UINT InStream, const void* InVertices, const size_t InVertexNum, void* OutStream) const noexcept
+		{
+			const auto Stride = Size();
+			const auto StreamStride = GetStreamStride(InStream);
+			const auto* Source = static_cast<const char*>(InVertices);
+			auto* Destination = static_cast<char*>(OutStream);
+
+			for (size_t Index = 0u; Index < InVertexNum; ++Index, Source += Stride, Destination += StreamStride)
+			{
+				for (const auto& Element : Elements)
+				{
+					if (Element.GetStream() == InStream)
+					{
+						std::memcpy(Destination + Element.GetStreamOffset(), Source + Element.GetByteOffset(), Element.Size());
+					}
+				}
+			}
+		}
 	};
 
 	class Vertex
@@ -360,6 +638,27 @@ namespace DV
 			case VertexLayout::ElementType::BGRAColor:
 				SetAttribute<VertexLayout::ElementType::BGRAColor>(Attribute, std::forward<T>(InValue));
 				break;
+			case VertexLayout::ElementType::OctahedralNormal:
+				SetAttribute<VertexLayout::ElementType::OctahedralNormal>(Attribute, std::forward<T>(InValue));
+				break;
+			case VertexLayout::ElementType::TangentFrame:
+				SetAttribute<VertexLayout::ElementType::TangentFrame>(Attribute, std::forward<T>(InValue));
+				break;
+			case VertexLayout::ElementType::HalfTexture2D:
+				SetAttribute<VertexLayout::ElementType::HalfTexture2D>(Attribute, std::forward<T>(InValue));
+				break;
+			case VertexLayout::ElementType::BoneIndices:
+				SetAttribute<VertexLayout::ElementType::BoneIndices>(Attribute, std::forward<T>(InValue));
+				break;
+			case VertexLayout::ElementType::BoneWeights:
+				SetAttribute<VertexLayout::ElementType::BoneWeights>(Attribute, std::forward<T>(InValue));
+				break;
+			case VertexLayout::ElementType::Occlusion:
+				SetAttribute<VertexLayout::ElementType::Occlusion>(Attribute, std::forward<T>(InValue));
+				break;
+			case VertexLayout::ElementType::LightmapTexture2D:
+				SetAttribute<VertexLayout::ElementType::LightmapTexture2D>(Attribute, std::forward<T>(InValue));
+				break;
 			default: assert(false && "Invalid Element Type");
 			}
 		}
@@ -406,11 +705,23 @@ namespace DV
 			: Layout(std::move(InLayout))
 		{}
 
+		// Adopts vertices already packed in the layout, e.g. by a StaticVertexBuffer.
+		VertexBuffer(VertexLayout&& InLayout, std::vector<byte>&& InBuffer)
+			: Buffer(std::move(InBuffer)), Layout(std::move(InLayout))
+		{
+			assert(Layout.Size() && Buffer.size() % Layout.Size() == 0u && "Buffer is not a whole number of vertices");
+		}
+
 		[[nodiscard]] const byte* GetData() const
 		{
 			return Buffer.data();
 		}
 
+		[[nodiscard]] byte* GetData()
+		{
+			return Buffer.data();
+		}
+
 		[[nodiscard]] const VertexLayout& GetLayout() const
 		{
 			return Layout;
@@ -426,6 +737,38 @@ namespace DV
 			return Buffer.size();
 		}
 
+		void Reserve(const size_t InNum)
+		{
+			Buffer.reserve(InNum * Layout.Size());
+		}
+
+		// New vertices are zeroed, ready for FillAttribute.
+		void Resize(const size_t InNum)
+		{
+			Buffer.resize(InNum * Layout.Size());
+		}
+
+		/**
+		 * Writes one element of consecutive vertices from a contiguous stream, starting at InFirst, in a single strided pass.
+		 * Only the leading bytes of each value are copied, so a wider source such as a 3D texture coordinate fills a 2D one.
+		 */
+		template<VertexLayout::ElementType ElementType, typename T>
+		void FillAttribute(const std::span<const T> InValues, const size_t InFirst = 0u)
+		{
+			using SystemType = typename VertexLayout::TypeMap<ElementType>::SystemType;
+			static_assert(std::is_trivially_copyable_v<T> && sizeof(T) >= sizeof(SystemType), "Source values cannot fill the element");
+			assert(InFirst + InValues.size() <= Num() && "Resize the buffer before filling it");
+
+			const auto Stride = Layout.Size();
+			auto* Destination = Buffer.data() + InFirst * Stride + Layout.Resolve<ElementType>().GetByteOffset();
+
+			for (const auto& Value : InValues)
+			{
+				std::memcpy(Destination, &Value, sizeof(SystemType));
+				Destination += Stride;
+			}
+		}
+
 		template<typename ...Params>
 		void Emplace(Params&&... InParams)
 		{
@@ -452,4 +795,180 @@ namespace DV
 			return Vertex{Buffer.data() + Layout.Size() * InIndex, Layout};
 		}
 	};
+
+	/**
+	 * VertexLayout fixed at compile time. Offsets and stride are constants, so attribute access is a plain offset with no lookup.
+	 * Converts to a VertexLayout wherever bindables take one and reports the same code and input element descs.
+	 */
+	template<VertexLayout::ElementType... Types>
+	class StaticLayout
+	{
+	public:
+		template<VertexLayout::ElementType T>
+		using SystemType = typename VertexLayout::TypeMap<T>::SystemType;
+
+		class Vertex
+		{
+		public:
+			explicit Vertex(byte* InData) noexcept
+				: Data(InData)
+			{
+				assert(InData);
+			}
+
+			template<VertexLayout::ElementType T>
+			[[nodiscard]] SystemType<T>& Attribute() const noexcept
+			{
+				return *reinterpret_cast<SystemType<T>*>(Data + OffsetOf<T>());
+			}
+
+		private:
+			byte* Data;
+		};
+
+		template<VertexLayout::ElementType T>
+		[[nodiscard]] static constexpr bool Has() noexcept
+		{
+			return ((Types == T) || ...);
+		}
+
+		template<VertexLayout::ElementType T>
+		[[nodiscard]] static constexpr size_t OffsetOf() noexcept
+		{
+			static_assert(((Types == T) + ... + 0) == 1, "Element type must appear exactly once in the layout");
+
+			size_t Offset = 0u;
+			bool bIsFound = false;
+			((bIsFound = bIsFound || Types == T, Offset += bIsFound ? 0u : VertexLayout::Element::SizeOf(Types)), ...);
+
+			return Offset;
+		}
+
+		[[nodiscard]] static constexpr size_t Size() noexcept
+		{
+			return (VertexLayout::Element::SizeOf(Types) + ... + 0u);
+		}
+
+		[[nodiscard]] static constexpr size_t Num() noexcept
+		{
+			return sizeof...(Types);
+		}
+
+		// Writes one value per element, in layout order.
+		static void Write(byte* InData, const SystemType<Types>&... InValues) noexcept
+		{
+			((*reinterpret_cast<SystemType<Types>*>(InData + OffsetOf<Types>()) = InValues), ...);
+		}
+
+		[[nodiscard]] static VertexLayout GetDynamicLayout()
+		{
+			return {Types...};
+		}
+
+		operator VertexLayout() const
+		{
+			return GetDynamicLayout();
+		}
+
+		[[nodiscard]] static std::vector<D3D11_INPUT_ELEMENT_DESC> GetD3D11Layout()
+		{
+			return GetDynamicLayout().GetD3D11Layout();
+		}
+
+		[[nodiscard]] static std::string GetCode()
+		{
+			return (std::string{} + ... + VertexLayout::TypeMap<Types>::Code);
+		}
+	};
+
+	// Tightly packed vertices of a StaticLayout, handed to the bindables as a VertexBuffer once filled.
+	template<typename Layout>
+	class StaticVertexBuffer
+	{
+	public:
+		StaticVertexBuffer() = default;
+
+		explicit StaticVertexBuffer(const size_t InNum)
+			: Buffer(InNum * Layout::Size())
+		{}
+
+		void Reserve(const size_t InNum)
+		{
+			Buffer.reserve(InNum * Layout::Size());
+		}
+
+		void Resize(const size_t InNum)
+		{
+			Buffer.resize(InNum * Layout::Size());
+		}
+
+		// Same as VertexBuffer::FillAttribute, with the element offset known at compile time.
+		template<VertexLayout::ElementType ElementType, typename T>
+		void FillAttribute(const std::span<const T> InValues, const size_t InFirst = 0u)
+		{
+			using SystemType = typename Layout::template SystemType<ElementType>;
+			static_assert(std::is_trivially_copyable_v<T> && sizeof(T) >= sizeof(SystemType), "Source values cannot fill the element");
+			assert(InFirst + InValues.size() <= Num() && "Resize the buffer before filling it");
+
+			auto* Destination = Buffer.data() + InFirst * Layout::Size() + Layout::template OffsetOf<ElementType>();
+
+			for (const auto& Value : InValues)
+			{
+				std::memcpy(Destination, &Value, sizeof(SystemType));
+				Destination += Layout::Size();
+			}
+		}
+
+		// Writes InGenerator(VertexIndex) into the element of every vertex, for values encoded from several source streams.
+		template<VertexLayout::ElementType ElementType, typename Generator>
+		void GenerateAttribute(Generator&& InGenerator)
+		{
+			auto* Destination = Buffer.data() + Layout::template OffsetOf<ElementType>();
+
+			for (size_t VertexIndex = 0u; VertexIndex < Num(); ++VertexIndex)
+			{
+				const typename Layout::template SystemType<ElementType> Value = InGenerator(VertexIndex);
+				std::memcpy(Destination, &Value, sizeof(Value));
+				Destination += Layout::Size();
+			}
+		}
+
+		template<typename ...Params>
+		void Emplace(Params&&... InParams)
+		{
+			static_assert(sizeof...(InParams) == Layout::Num(), "Parameter count doesn't match the layout's element count");
+
+			Buffer.resize(Buffer.size() + Layout::Size());
+			Layout::Write(Buffer.data() + Buffer.size() - Layout::Size(), std::forward<Params>(InParams)...);
+		}
+
+		[[nodiscard]] typename Layout::Vertex operator[](const size_t InIndex)
+		{
+			assert(InIndex < Num());
+			return typename Layout::Vertex{Buffer.data() + Layout::Size() * InIndex};
+		}
+
+		[[nodiscard]] const byte* GetData() const noexcept
+		{
+			return Buffer.data();
+		}
+
+		[[nodiscard]] size_t Num() const noexcept
+		{
+			return Buffer.size() / Layout::Size();
+		}
+
+		[[nodiscard]] size_t Size() const noexcept
+		{
+			return Buffer.size();
+		}
+
+		[[nodiscard]] VertexBuffer ToDynamic() &&
+		{
+			return VertexBuffer{Layout::GetDynamicLayout(), std::move(Buffer)};
+		}
+
+	private:
+		std::vector<byte> Buffer;
+	};
 }
\ No newline at end of file
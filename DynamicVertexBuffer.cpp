@@ -0,0 +1,93 @@
+﻿#include "DynamicVertexBuffer.h"
+#include <cassert>
+#include <utility>
+#include "ExceptionMacros.h"
+
+DynamicVertexBuffer::DynamicVertexBuffer(const Graphics& InGraphics, const std::string& InTag, const DV::VertexLayout& InLayout,
+                                         const UINT InCapacity)
+	: VertexBuffer(InGraphics, StringAtom(InTag), InLayout)
+	, Layout(InLayout)
+	, Capacity(InCapacity)
+{
+	assert(Capacity > 0u && "Dynamic vertex buffers need room for at least one vertex");
+
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC StreamDesc {};
+	StreamDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	StreamDesc.Usage = D3D11_USAGE_DYNAMIC;
+	StreamDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	// A stream the layout has no elements in stays unbound, like a pool allocation's.
+	if (PositionStride)
+	{
+		StreamDesc.ByteWidth = Capacity * PositionStride;
+		CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer(&StreamDesc, nullptr, &PositionBuffer))
+	}
+
+	if (AttributeStride)
+	{
+		StreamDesc.ByteWidth = Capacity * AttributeStride;
+		CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer(&StreamDesc, nullptr, &AttributeBuffer))
+	}
+
+	MyAllocation.Buffer = PositionBuffer.Get();
+	MyAllocation.AttributeBuffer = AttributeBuffer.Get();
+}
+
+DynamicVertexBuffer::~DynamicVertexBuffer()
+{
+	// The buffers are this one's own, there is nothing to hand back to the pool.
+	MyAllocation = {};
+}
+
+void DynamicVertexBuffer::Write(RenderContext& InContext, const DV::VertexBuffer& InVertices)
+{
+	assert(InVertices.GetLayout().GetCode() == Layout.GetCode() && "Vertices of another layout than the buffer's");
+	Write(InContext, InVertices.GetData(), InVertices.Size());
+}
+
+void DynamicVertexBuffer::Write(RenderContext& InContext, const void* InVertices, const size_t InSize)
+{
+	const auto Stride = Layout.Size();
+	assert(InSize % Stride == 0u && "Vertex data is not a whole number of vertices");
+	assert(InSize / Stride <= Capacity && "More vertices than the dynamic vertex buffer holds");
+
+	const auto VertexNum = static_cast<UINT>(InSize / Stride);
+	auto MapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	if (WriteCursor + VertexNum > Capacity)
+	{
+		MapType = D3D11_MAP_WRITE_DISCARD;
+		WriteCursor = 0u;
+	}
+
+	HRESULT ResultHandle;
+	const std::pair<ID3D11Buffer*, UINT> Streams[] = {{PositionBuffer.Get(), PositionStride}, {AttributeBuffer.Get(), AttributeStride}};
+
+	for (UINT Stream = 0u; Stream < DV::VertexLayout::StreamNum; ++Stream)
+	{
+		const auto [Buffer, StreamStride] = Streams[Stream];
+
+		if (!Buffer)
+		{
+			continue;
+		}
+
+		// Split into the stream straight from the interleaved vertices, there is no copy in between.
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+		CHECK_HRESULT_EXCEPTION(GetContext(InContext)->Map(Buffer, 0u, MapType, 0u, &MappedResource))
+		Layout.CopyStream(Stream, InVertices, VertexNum, static_cast<char*>(MappedResource.pData) + static_cast<size_t>(WriteCursor) * StreamStride);
+		GetContext(InContext)->Unmap(Buffer, 0u);
+	}
+
+	GetStateCache(InContext).CountUpload(InSize);
+	MyAllocation.Offset = WriteCursor;
+	MyAllocation.Num = VertexNum;
+	WriteCursor += VertexNum;
+}
+
+size_t DynamicVertexBuffer::GetGpuByteSize() const noexcept
+{
+	return static_cast<size_t>(Capacity) * (PositionStride + AttributeStride);
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "wrl/client.h"
+#include "VertexBuffer.h"
+
+/**
+ * Vertices written again every frame, such as UI meshes, trails or procedural geometry, in dynamic buffers of its own rather
+ * than a page of the geometry pool. Each Write appends behind what the GPU may still read with WRITE_NO_OVERWRITE and starts
+ * over at the front with a discard once the rest doesn't fit, a map per stream. The base vertex follows the last write, the
+ * drawables binding it pick the new range up through Drawable::UpdateGeometryRange. Not shared, so never resolved.
+ */
+class DynamicVertexBuffer : public VertexBuffer
+{
+public:
+	DynamicVertexBuffer(const Graphics& InGraphics, const std::string& InTag, const DV::VertexLayout& InLayout, UINT InCapacity);
+	~DynamicVertexBuffer() override;
+
+	// Through the immediate context, before the frame's draws. The vertices have this buffer's layout and at most its capacity.
+	void Write(RenderContext& InContext, const DV::VertexBuffer& InVertices);
+	void Write(RenderContext& InContext, const void* InVertices, size_t InSize);
+
+	[[nodiscard]] UINT GetCapacity() const noexcept
+	{
+		return Capacity;
+	}
+
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	DV::VertexLayout Layout;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> PositionBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> AttributeBuffer;
+	UINT Capacity;
+	// First vertex no write used since the last discard.
+	UINT WriteCursor {0u};
+};
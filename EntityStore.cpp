@@ -0,0 +1,132 @@
+﻿#include "EntityStore.h"
+#include <algorithm>
+#include <cassert>
+#include "FrameProfiler.h"
+#include "JobSystem.h"
+
+EntityStore::Entity EntityStore::Add(std::mt19937& InRandomGenerator, std::uniform_real_distribution<float>& InAngle,
+                                     std::uniform_real_distribution<float>& InSpin, std::uniform_real_distribution<float>& InTravel,
+                                     std::uniform_real_distribution<float>& InRadius, const DirectX::XMFLOAT3 InScale,
+                                     const DirectX::XMFLOAT3 InExtents)
+{
+	// Drawn in the order the orbits always were, so the seeded scene stays the same.
+	const auto Radius = InRadius(InRandomGenerator);
+	const auto Theta = InAngle(InRandomGenerator);
+	const auto Phi = InAngle(InRandomGenerator);
+	const auto Chi = InAngle(InRandomGenerator);
+	const auto DeltaRoll = InSpin(InRandomGenerator);
+	const auto DeltaPitch = InSpin(InRandomGenerator);
+	const auto DeltaYaw = InSpin(InRandomGenerator);
+	const auto DeltaTheta = InTravel(InRandomGenerator);
+	const auto DeltaPhi = InTravel(InRandomGenerator);
+	const auto DeltaChi = InTravel(InRandomGenerator);
+
+	while (!FreeEntities.empty() && FreeEntities.back() >= Transforms.size())
+	{
+		FreeEntities.pop_back();
+	}
+
+	Entity NewEntity;
+
+	if (!FreeEntities.empty())
+	{
+		NewEntity = FreeEntities.back();
+		FreeEntities.pop_back();
+		--FreeNum;
+	}
+	else
+	{
+		NewEntity = static_cast<Entity>(Transforms.size());
+		Transforms.emplace_back();
+		Scales.emplace_back();
+		Extents.emplace_back();
+		Spins.emplace_back();
+		SpinRates.emplace_back();
+		Travels.emplace_back();
+		TravelRates.emplace_back();
+		Radii.emplace_back();
+		bIsAlive.emplace_back();
+		Bounds.Resize(Transforms.size());
+	}
+
+	Scales[NewEntity] = InScale;
+	Extents[NewEntity] = InExtents;
+	Spins[NewEntity] = {0.0f, 0.0f, 0.0f, 0.0f};
+	SpinRates[NewEntity] = {DeltaRoll, DeltaPitch, DeltaYaw, 0.0f};
+	Travels[NewEntity] = {Theta, Phi, Chi, 0.0f};
+	TravelRates[NewEntity] = {DeltaTheta, DeltaPhi, DeltaChi, 0.0f};
+	Radii[NewEntity] = Radius;
+	bIsAlive[NewEntity] = 1u;
+	UpdateTransform(NewEntity);
+
+	return NewEntity;
+}
+
+void EntityStore::Remove(const Entity InEntity) noexcept
+{
+	assert(InEntity < bIsAlive.size() && bIsAlive[InEntity] && "Entity was removed already");
+
+	bIsAlive[InEntity] = 0u;
+	FreeEntities.push_back(InEntity);
+	++FreeNum;
+
+	// Removed entities at the end aren't swept any more.
+	while (!bIsAlive.empty() && !bIsAlive.back())
+	{
+		Transforms.pop_back();
+		Scales.pop_back();
+		Extents.pop_back();
+		Spins.pop_back();
+		SpinRates.pop_back();
+		Travels.pop_back();
+		TravelRates.pop_back();
+		Radii.pop_back();
+		bIsAlive.pop_back();
+		--FreeNum;
+	}
+
+	Bounds.Resize(Transforms.size());
+}
+
+void EntityStore::Update(const float InDeltaTime)
+{
+	PROFILE_SCOPE("EntityStore::Update");
+
+	const auto DeltaTime = DirectX::XMVectorReplicate(InDeltaTime);
+	const auto BatchNum = (Transforms.size() + BatchSize - 1u) / BatchSize;
+
+	JobSystem::Get().ParallelFor(BatchNum, 1u, [&](const size_t InBatch)
+	{
+		const auto Last = std::min(Transforms.size(), (InBatch + 1u) * BatchSize);
+
+		for (auto Index = InBatch * BatchSize; Index < Last; ++Index)
+		{
+			// All three angles at once, wrapped so they keep their precision however long the scene runs. Removed slots move
+			// along as well, which costs less than testing for them.
+			const auto Spin = DirectX::XMVectorMultiplyAdd(DirectX::XMLoadFloat4(&SpinRates[Index]), DeltaTime, DirectX::XMLoadFloat4(&Spins[Index]));
+			const auto Travel = DirectX::XMVectorMultiplyAdd(DirectX::XMLoadFloat4(&TravelRates[Index]), DeltaTime, DirectX::XMLoadFloat4(&Travels[Index]));
+			DirectX::XMStoreFloat4(&Spins[Index], DirectX::XMVectorModAngles(Spin));
+			DirectX::XMStoreFloat4(&Travels[Index], DirectX::XMVectorModAngles(Travel));
+			UpdateTransform(Index);
+		}
+	});
+}
+
+void EntityStore::UpdateTransform(const size_t InIndex) noexcept
+{
+	const auto& Spin = Spins[InIndex];
+	const auto& Travel = Travels[InIndex];
+
+	const auto Transform = DirectX::XMMatrixScaling(Scales[InIndex].x, Scales[InIndex].y, Scales[InIndex].z) *
+	                       DirectX::XMMatrixRotationRollPitchYaw(Spin.y, Spin.z, Spin.x) *
+	                       DirectX::XMMatrixTranslation(Radii[InIndex], 0.0f, 0.0f) *
+	                       DirectX::XMMatrixRotationRollPitchYaw(Travel.x, Travel.y, Travel.z);
+	DirectX::XMStoreFloat4x4(&Transforms[InIndex], Transform);
+
+	// The box around the rotated one, each world axis reaches as far as the local extents do along it.
+	const auto& Extent = Extents[InIndex];
+	auto WorldExtents = DirectX::XMVectorScale(DirectX::XMVectorAbs(Transform.r[0]), Extent.x);
+	WorldExtents = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorAbs(Transform.r[1]), DirectX::XMVectorReplicate(Extent.y), WorldExtents);
+	WorldExtents = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorAbs(Transform.r[2]), DirectX::XMVectorReplicate(Extent.z), WorldExtents);
+	Bounds.Set(InIndex, Transform.r[3], WorldExtents);
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <cstdint>
+#include <DirectXMath.h>
+#include <random>
+#include <vector>
+#include "CullingBounds.h"
+
+/**
+ * The stress scene's moving bodies kept as components in contiguous arrays, one per field, instead of as members of their
+ * drawables. Every entity has a transform, a scale and an orbit motion: spinning about its own axes while it circles the origin.
+ * Update sweeps the arrays in batches on the job system and writes the transforms, which the drawables read back by entity,
+ * so a step is one linear pass whatever kind of drawable each entity renders as. The same pass writes each entity's world box,
+ * from extents given in its own space, into CullingBounds for the scene to cull against.
+ * Entities keep their index while they live, removed ones are reused by the next Add.
+ */
+class EntityStore
+{
+public:
+	using Entity = uint32_t;
+
+	EntityStore() = default;
+	EntityStore(const EntityStore&) = delete;
+	EntityStore(EntityStore&&) = delete;
+	EntityStore& operator=(const EntityStore&) = delete;
+	EntityStore& operator=(EntityStore&&) = delete;
+	~EntityStore() = default;
+
+	// InAngle picks the starting angles, InSpin and InTravel the radians per second about the body's own axes and about the
+	// origin, InRadius the distance from the origin. InExtents are half the size of the body before scaling, the unit cube's by
+	// default. The transform and the bounds are current right away.
+	Entity Add(std::mt19937& InRandomGenerator, std::uniform_real_distribution<float>& InAngle, std::uniform_real_distribution<float>& InSpin,
+	           std::uniform_real_distribution<float>& InTravel, std::uniform_real_distribution<float>& InRadius,
+	           DirectX::XMFLOAT3 InScale = {1.0f, 1.0f, 1.0f}, DirectX::XMFLOAT3 InExtents = {0.5f, 0.5f, 0.5f});
+	void Remove(Entity InEntity) noexcept;
+
+	// Once per simulation step.
+	void Update(float InDeltaTime);
+
+	[[nodiscard]] DirectX::XMMATRIX GetTransform(const Entity InEntity) const noexcept
+	{
+		return DirectX::XMLoadFloat4x4(&Transforms[InEntity]);
+	}
+
+	// By entity, removed ones included.
+	[[nodiscard]] const CullingBounds& GetBounds() const noexcept
+	{
+		return Bounds;
+	}
+
+	[[nodiscard]] size_t GetEntityNum() const noexcept
+	{
+		return Transforms.size() - FreeNum;
+	}
+
+private:
+	// Entities a job updates at least, a step of a few thousand stays on one thread. Whole groups of the bounds, so no two jobs
+	// write the same one.
+	static constexpr size_t BatchSize {2048u};
+	static_assert(BatchSize % CullingBounds::GroupSize == 0u);
+
+	void UpdateTransform(size_t InIndex) noexcept;
+
+private:
+	std::vector<DirectX::XMFLOAT4X4> Transforms;
+	std::vector<DirectX::XMFLOAT3> Scales;
+	std::vector<DirectX::XMFLOAT3> Extents;
+	// Roll, pitch and yaw about the body's own axes, and their rates, w unused.
+	std::vector<DirectX::XMFLOAT4> Spins;
+	std::vector<DirectX::XMFLOAT4> SpinRates;
+	// Theta, phi and chi of the circle about the origin, and their rates, w unused.
+	std::vector<DirectX::XMFLOAT4> Travels;
+	std::vector<DirectX::XMFLOAT4> TravelRates;
+	std::vector<float> Radii;
+	CullingBounds Bounds;
+	std::vector<uint8_t> bIsAlive;
+	// May hold entities past the end after the arrays shrank, Add skips those.
+	std::vector<Entity> FreeEntities;
+	size_t FreeNum {0u};
+};
@@ -0,0 +1,71 @@
+// Prefilters one mip of ImageBasedLighting's specular cube, one thread per texel in 8x8 tiles and one Z per face.
+// The Phong lobe of the mip's power around the texel's direction is importance sampled, each sample reading the
+// source mip whose texels cover about as much as the sample does, so few samples integrate wide lobes without noise.
+TextureCube<float4> Source : register(t0);
+SamplerState Sampler : register(s0);
+RWTexture2DArray<float4> Output : register(u0);
+
+cbuffer Prefilter : register(b0)
+{
+    uint FaceSize;
+    float SpecularPower;
+    float SourceTexelSolidAngle;
+    float PrefilterPadding;
+}
+
+#define SAMPLE_NUM 64
+
+static const float Pi = 3.14159265359f;
+
+// D3D's cube face order, +X, -X, +Y, -Y, +Z, -Z, with InCoordinate from -1 to 1 across the face, Y down.
+float3 GetFaceDirection(const uint InFace, const float2 InCoordinate)
+{
+    switch (InFace)
+    {
+    case 0u: return float3(1.0f, -InCoordinate.y, -InCoordinate.x);
+    case 1u: return float3(-1.0f, -InCoordinate.y, InCoordinate.x);
+    case 2u: return float3(InCoordinate.x, 1.0f, InCoordinate.y);
+    case 3u: return float3(InCoordinate.x, -1.0f, -InCoordinate.y);
+    case 4u: return float3(InCoordinate.x, -InCoordinate.y, 1.0f);
+    default: return float3(-InCoordinate.x, -InCoordinate.y, -1.0f);
+    }
+}
+
+float2 Hammersley(const uint InIndex)
+{
+    return float2((InIndex + 0.5f) / SAMPLE_NUM, reversebits(InIndex) * 2.3283064365386963e-10f);
+}
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= FaceSize))
+    {
+        return;
+    }
+
+    const float3 Direction = normalize(GetFaceDirection(InThreadID.z, (InThreadID.xy + 0.5f) / FaceSize * 2.0f - 1.0f));
+    const float3 Up = abs(Direction.y) < 0.999f ? float3(0.0f, 1.0f, 0.0f) : float3(1.0f, 0.0f, 0.0f);
+    const float3 TangentX = normalize(cross(Up, Direction));
+    const float3 TangentY = cross(Direction, TangentX);
+
+    float3 Sum = float3(0.0f, 0.0f, 0.0f);
+
+    for (uint Index = 0u; Index < SAMPLE_NUM; ++Index)
+    {
+        const float2 Random = Hammersley(Index);
+        const float CosTheta = pow(Random.x, 1.0f / (SpecularPower + 1.0f));
+        const float SinTheta = sqrt(saturate(1.0f - CosTheta * CosTheta));
+        const float Phi = 2.0f * Pi * Random.y;
+        const float3 SampleDirection = TangentX * (SinTheta * cos(Phi)) + TangentY * (SinTheta * sin(Phi)) + Direction * CosTheta;
+
+        // The solid angle a sample stands for is one over its count and density.
+        const float Density = (SpecularPower + 1.0f) / (2.0f * Pi) * pow(CosTheta, SpecularPower);
+        const float SampleSolidAngle = 1.0f / (SAMPLE_NUM * Density + 1e-6f);
+        const float Mip = max(0.5f * log2(SampleSolidAngle / SourceTexelSolidAngle) + 1.0f, 0.0f);
+
+        Sum += Source.SampleLevel(Sampler, SampleDirection, Mip).rgb;
+    }
+
+    Output[InThreadID] = float4(Sum / SAMPLE_NUM, 1.0f);
+}
@@ -7,16 +7,28 @@
 #define INFO_EXCEPTION(InMessages)																	\
 	InfoException{__LINE__, __FILE__, InMessages}
 
+#ifdef NDEBUG
+// Release builds have no debug layer to ask, only the call is left.
+#define CHECK_INFO_EXCEPTION(InFunction)															\
+	(InFunction);
+
+#define CHECK_DRAW_INFO_EXCEPTION(InFunction)														\
+	(InFunction);
+#else
+// What the debug layer says about the call goes to the log instead of throwing, the frame carries on.
 #define CHECK_INFO_EXCEPTION(InFunction)															\
 	DXGIInfoManager::Set();																			\
 	(InFunction);																					\
+	DXGIInfoManager::ReportMessages(__FILE__, __LINE__);
+
+// For calls issued thousands of times a frame, the queue is only read at the draw validation interval.
+#define CHECK_DRAW_INFO_EXCEPTION(InFunction)														\
+	(InFunction);																					\
+	if (DXGIInfoManager::ShouldValidateDraw())														\
 	{																								\
-		auto InfoMessages = DXGIInfoManager::GetMessages();										\
-		if (!InfoMessages.empty())																	\
-		{																							\
-			throw INFO_EXCEPTION(InfoMessages);														\
-		}																							\
+		DXGIInfoManager::ReportDrawMessages(__FILE__, __LINE__);									\
 	}
+#endif
 
 #define HRESULT_EXCEPTION(InResultHandle)															\
 	ResultHandleException{__LINE__, __FILE__, (InResultHandle), DXGIInfoManager::GetMessages()}
@@ -0,0 +1,112 @@
+﻿#include "FrameArena.h"
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<unsigned int> HeapAllocationNum {0u};
+}
+
+// Replaced for the whole program only to count, the array and nothrow forms forward here.
+void* operator new(const size_t InSize)
+{
+	HeapAllocationNum.fetch_add(1u, std::memory_order_relaxed);
+
+	if (void* const Pointer = std::malloc(InSize ? InSize : 1u))
+	{
+		return Pointer;
+	}
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* const InPointer) noexcept
+{
+	std::free(InPointer);
+}
+
+FrameArena::FrameArena(const size_t InCapacity)
+	: Capacity(InCapacity)
+{
+	assert(!Instance && "Only one FrameArena may exist");
+	Instance = this;
+
+	for (auto& Block : Blocks)
+	{
+		Block = std::make_unique<std::byte[]>(Capacity);
+	}
+
+	FrameStartHeapAllocationNum = HeapAllocationNum.load(std::memory_order_relaxed);
+}
+
+FrameArena::~FrameArena()
+{
+	Instance = nullptr;
+}
+
+FrameArena& FrameArena::Get() noexcept
+{
+	assert(Instance && "FrameArena is used before Graphics created it");
+	return *Instance;
+}
+
+void FrameArena::BeginFrame() noexcept
+{
+	const auto CurrentHeapAllocationNum = HeapAllocationNum.load(std::memory_order_relaxed);
+
+	LastFrameStatistics = {Offset.load(std::memory_order_relaxed), OverflowNum.exchange(0u, std::memory_order_relaxed),
+	                       CurrentHeapAllocationNum - FrameStartHeapAllocationNum};
+	FrameStartHeapAllocationNum = CurrentHeapAllocationNum;
+
+	CurrentBlock ^= 1u;
+	Offset.store(0u, std::memory_order_relaxed);
+}
+
+void* FrameArena::Allocate(const size_t InSize, const size_t InAlignment)
+{
+	const auto Base = reinterpret_cast<uintptr_t>(Blocks[CurrentBlock].get());
+	auto Current = Offset.load(std::memory_order_relaxed);
+
+	for (;;)
+	{
+		const auto Aligned = ((Base + Current + InAlignment - 1u) & ~(InAlignment - 1u)) - Base;
+
+		if (Aligned + InSize > Capacity)
+		{
+			break;
+		}
+
+		if (Offset.compare_exchange_weak(Current, Aligned + InSize, std::memory_order_relaxed))
+		{
+			return Blocks[CurrentBlock].get() + Aligned;
+		}
+	}
+
+	OverflowNum.fetch_add(1u, std::memory_order_relaxed);
+	return ::operator new(InSize, std::align_val_t {InAlignment});
+}
+
+void FrameArena::Deallocate(void* const InPointer, const size_t InAlignment) noexcept
+{
+	if (InPointer && !Owns(InPointer))
+	{
+		::operator delete(InPointer, std::align_val_t {InAlignment});
+	}
+}
+
+bool FrameArena::Owns(const void* const InPointer) const noexcept
+{
+	const auto* const Pointer = static_cast<const std::byte*>(InPointer);
+
+	for (const auto& Block : Blocks)
+	{
+		if (Pointer >= Block.get() && Pointer < Block.get() + Capacity)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
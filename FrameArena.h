@@ -0,0 +1,99 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Linear allocator for transient data that lives no longer than the frame after the one it was made in.
+ * Two blocks take turns, BeginFrame forgets everything in the block the frame before last used,
+ * so the previous frame's allocations stay valid through the current one. Deallocation is a no-op.
+ * Requests a block can't hold fall back to the heap and are counted, a nonzero count means the capacity is too small.
+ * Owned by Graphics, everything else reaches it through Get().
+ */
+class FrameArena
+{
+public:
+	struct Statistics
+	{
+		size_t UsedBytes;
+		unsigned int OverflowNum;
+		// Every operator new in the process during the frame, not only the arena's fallbacks. Zero in a steady state.
+		unsigned int HeapAllocationNum;
+	};
+
+	static constexpr size_t DefaultCapacity {4u * 1024u * 1024u};
+
+	explicit FrameArena(size_t InCapacity = DefaultCapacity);
+	FrameArena(const FrameArena&) = delete;
+	FrameArena(FrameArena&&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+	FrameArena& operator=(FrameArena&&) = delete;
+	~FrameArena();
+
+	[[nodiscard]] static FrameArena& Get() noexcept;
+
+	// Nothing allocated two frames ago may be used after this.
+	void BeginFrame() noexcept;
+
+	// Safe to call from any thread.
+	[[nodiscard]] void* Allocate(size_t InSize, size_t InAlignment);
+	void Deallocate(void* InPointer, size_t InAlignment) noexcept;
+
+	[[nodiscard]] const Statistics& GetLastFrameStatistics() const noexcept
+	{
+		return LastFrameStatistics;
+	}
+
+private:
+	[[nodiscard]] bool Owns(const void* InPointer) const noexcept;
+
+private:
+	static inline FrameArena* Instance {nullptr};
+
+	size_t Capacity;
+	std::array<std::unique_ptr<std::byte[]>, 2u> Blocks;
+	unsigned int CurrentBlock {0u};
+	std::atomic<size_t> Offset {0u};
+	std::atomic<unsigned int> OverflowNum {0u};
+	unsigned int FrameStartHeapAllocationNum {0u};
+	Statistics LastFrameStatistics {};
+};
+
+// Stateless STL allocator drawing from FrameArena::Get(), containers using it must not outlive the next frame.
+template<typename T>
+class FrameAllocator
+{
+public:
+	using value_type = T;
+
+	FrameAllocator() noexcept = default;
+
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>&) noexcept
+	{}
+
+	[[nodiscard]] T* allocate(const size_t InCount)
+	{
+		return static_cast<T*>(FrameArena::Get().Allocate(InCount * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* const InPointer, size_t) noexcept
+	{
+		FrameArena::Get().Deallocate(InPointer, alignof(T));
+	}
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>&) const noexcept
+	{
+		return true;
+	}
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+template<typename Key, typename Value>
+using FrameUnorderedMap = std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>, FrameAllocator<std::pair<const Key, Value>>>;
@@ -0,0 +1,184 @@
+﻿#include "FrameCapture.h"
+#include <cstring>
+#include <memory>
+#include <utility>
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "Surface.h"
+
+FrameCapture::FrameCapture(ID3D11Device* InDevice, ID3D11Texture2D* InDisplayTarget)
+	: DisplayTarget(InDisplayTarget)
+{
+	CreateStaging(InDevice);
+}
+
+FrameCapture::~FrameCapture()
+{
+	JobSystem::Get().Wait(Writes);
+}
+
+void FrameCapture::RequestScreenshot(std::string InFileName, const Format InFormat)
+{
+	ScreenshotFileName = std::move(InFileName);
+	ScreenshotFormat = InFormat;
+}
+
+void FrameCapture::StartSequence(std::string InPrefix, const unsigned int InFrameNum, const Format InFormat)
+{
+	SequencePrefix = std::move(InPrefix);
+	SequenceFormat = InFormat;
+	SequenceFramesLeft = InFrameNum;
+	SequenceFrameIndex = 0u;
+}
+
+void FrameCapture::StopSequence() noexcept
+{
+	SequenceFramesLeft = 0u;
+}
+
+void FrameCapture::ReleaseDisplayTarget()
+{
+	// The write jobs read the size, it can only change once they are done.
+	JobSystem::Get().Wait(Writes);
+
+	for (auto& Pending : Slots)
+	{
+		DroppedNum += Pending.bIsPending ? 1u : 0u;
+		Pending.bIsPending = false;
+		Pending.Staging.Reset();
+	}
+
+	DisplayTarget.Reset();
+}
+
+void FrameCapture::SetDisplayTarget(ID3D11Device* InDevice, ID3D11Texture2D* InDisplayTarget)
+{
+	DisplayTarget = InDisplayTarget;
+	CreateStaging(InDevice);
+}
+
+void FrameCapture::EndFrame(ID3D11DeviceContext* InContext)
+{
+	PROFILE_SCOPE("FrameCapture::EndFrame");
+
+	ReadBack(InContext);
+
+	if (!ScreenshotFileName.empty())
+	{
+		Capture(InContext, std::exchange(ScreenshotFileName, {}), ScreenshotFormat);
+	}
+	else if (SequenceFramesLeft > 0u)
+	{
+		// Numbered by the frames of the sequence, so a dropped frame leaves a gap instead of shifting the rest.
+		auto Number = std::to_string(SequenceFrameIndex++);
+		Number.insert(0u, Number.size() < 5u ? 5u - Number.size() : 0u, '0');
+		Capture(InContext, SequencePrefix + Number + (SequenceFormat == Format::Png ? ".png" : ".raw"), SequenceFormat);
+		--SequenceFramesLeft;
+	}
+}
+
+FrameCapture::Statistics FrameCapture::GetStatistics() const noexcept
+{
+	return {CapturedNum, DroppedNum, WritingNum.load(std::memory_order_relaxed), FailedNum.load(std::memory_order_relaxed), SequenceFramesLeft};
+}
+
+void FrameCapture::CreateStaging(ID3D11Device* InDevice)
+{
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC StagingDesc;
+	DisplayTarget->GetDesc(&StagingDesc);
+	StagingDesc.Usage = D3D11_USAGE_STAGING;
+	StagingDesc.BindFlags = 0u;
+	StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	StagingDesc.MiscFlags = 0u;
+	Width = StagingDesc.Width;
+	Height = StagingDesc.Height;
+
+	for (auto& Pending : Slots)
+	{
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&StagingDesc, nullptr, &Pending.Staging))
+	}
+}
+
+void FrameCapture::ReadBack(ID3D11DeviceContext* InContext)
+{
+	// Oldest first, the GPU finishes the copies in order, so the first one still in flight holds up the others too.
+	for (unsigned int Offset = 0u; Offset < SlotNum; ++Offset)
+	{
+		auto& Pending = Slots[(NextSlot + Offset) % SlotNum];
+
+		if (!Pending.bIsPending)
+		{
+			continue;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE Mapped;
+
+		if (FAILED(InContext->Map(Pending.Staging.Get(), 0u, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &Mapped)))
+		{
+			break;
+		}
+
+		// Only the rows are copied here, the map has to end on this thread. B8G8R8A8 is the Surface::Color layout.
+		auto Frame = std::make_shared<Surface>(Width, Height);
+		const auto RowBytes = Width * sizeof(Surface::Color);
+
+		for (UINT Row = 0u; Row < Height; ++Row)
+		{
+			std::memcpy(Frame->GetBufferPtr() + static_cast<size_t>(Row) * Width, static_cast<const BYTE*>(Mapped.pData) + static_cast<size_t>(Row) * Mapped.RowPitch, RowBytes);
+		}
+
+		InContext->Unmap(Pending.Staging.Get(), 0u);
+		Pending.bIsPending = false;
+
+		WritingNum.fetch_add(1u, std::memory_order_relaxed);
+		JobSystem::Get().Run([this, Frame, FileName = std::move(Pending.FileName), FileFormat = Pending.FileFormat]
+		{
+			try
+			{
+				// Post-processing leaves the display's alpha undefined, images are opaque as they were shown.
+				auto* const Pixels = Frame->GetBufferPtr();
+
+				for (size_t Index = 0u; Index < static_cast<size_t>(Width) * Height; ++Index)
+				{
+					Pixels[Index].SetA(0xFFu);
+				}
+
+				if (FileFormat == Format::Png)
+				{
+					Frame->Save(FileName);
+				}
+				else
+				{
+					Frame->SaveRaw(FileName);
+				}
+			}
+			catch (...)
+			{
+				// A capture is never worth taking the frame loop down, it is counted instead.
+				FailedNum.fetch_add(1u, std::memory_order_relaxed);
+			}
+
+			WritingNum.fetch_sub(1u, std::memory_order_relaxed);
+		}, JobLane::Background, &Writes);
+	}
+}
+
+void FrameCapture::Capture(ID3D11DeviceContext* InContext, std::string InFileName, const Format InFormat)
+{
+	auto& Free = Slots[NextSlot];
+
+	if (Free.bIsPending)
+	{
+		++DroppedNum;
+		return;
+	}
+
+	InContext->CopyResource(Free.Staging.Get(), DisplayTarget.Get());
+	Free.FileName = std::move(InFileName);
+	Free.FileFormat = InFormat;
+	Free.bIsPending = true;
+	NextSlot = (NextSlot + 1u) % SlotNum;
+	++CapturedNum;
+}
@@ -0,0 +1,105 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <atomic>
+#include <d3d11.h>
+#include <string>
+#include "wrl/client.h"
+#include "JobSystem.h"
+
+/**
+ * Screenshots and frame sequences of what the display shows, UI included, without waiting on the GPU for them.
+ * A captured frame is copied into one of a ring of staging textures and only mapped a few frames later, once the GPU is
+ * done with it, and the pixels are then encoded and written on the job system. A frame that finds the whole ring still
+ * in flight is dropped rather than waited for.
+ */
+class FrameCapture
+{
+public:
+	enum class Format : unsigned char
+	{
+		// Through Surface::Save.
+		Png,
+		// The B8G8R8A8 rows as they are, preceded by the width and height as two 32 bit integers. Cheap enough for sequences
+		// at full frame rate.
+		Raw
+	};
+
+	struct Statistics
+	{
+		unsigned int CapturedNum {0u};
+		unsigned int DroppedNum {0u};
+		// Read back and still being encoded or written.
+		unsigned int WritingNum {0u};
+		unsigned int FailedNum {0u};
+		// Frames the running sequence still has to capture.
+		unsigned int SequenceFramesLeft {0u};
+	};
+
+	FrameCapture(ID3D11Device* InDevice, ID3D11Texture2D* InDisplayTarget);
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture(FrameCapture&&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+	FrameCapture& operator=(FrameCapture&&) = delete;
+	// Waits for the files still being written, frames not yet read back are lost.
+	~FrameCapture();
+
+	// The next frame, written to InFileName.
+	void RequestScreenshot(std::string InFileName, Format InFormat = Format::Png);
+	// The next InFrameNum frames, written to InPrefix followed by the frame's number. Replaces a running sequence.
+	void StartSequence(std::string InPrefix, unsigned int InFrameNum, Format InFormat = Format::Raw);
+	void StopSequence() noexcept;
+
+	// Lets go of the display, which the swap chain can't resize while it is still held. Frames not read back are dropped.
+	void ReleaseDisplayTarget();
+	// The resized display, the staging ring is created again at its size.
+	void SetDisplayTarget(ID3D11Device* InDevice, ID3D11Texture2D* InDisplayTarget);
+
+	// Reads back what the GPU finished and copies the display if this frame is captured, once the frame is complete.
+	void EndFrame(ID3D11DeviceContext* InContext);
+
+	[[nodiscard]] bool IsCapturing() const noexcept
+	{
+		return !ScreenshotFileName.empty() || SequenceFramesLeft > 0u;
+	}
+
+	[[nodiscard]] Statistics GetStatistics() const noexcept;
+
+private:
+	struct Slot
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Staging;
+		std::string FileName;
+		Format FileFormat {Format::Png};
+		bool bIsPending {false};
+	};
+
+	// Frames in flight between the copy and the read back, one more than the swap chain's usual latency.
+	static constexpr unsigned int SlotNum {3u};
+
+	void CreateStaging(ID3D11Device* InDevice);
+	void ReadBack(ID3D11DeviceContext* InContext);
+	void Capture(ID3D11DeviceContext* InContext, std::string InFileName, Format InFormat);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> DisplayTarget;
+	UINT Width {0u};
+	UINT Height {0u};
+	std::array<Slot, SlotNum> Slots;
+	// Where the next frame is copied, the oldest still pending when every slot is.
+	unsigned int NextSlot {0u};
+
+	std::string ScreenshotFileName;
+	Format ScreenshotFormat {Format::Png};
+	std::string SequencePrefix;
+	Format SequenceFormat {Format::Raw};
+	unsigned int SequenceFramesLeft {0u};
+	unsigned int SequenceFrameIndex {0u};
+
+	unsigned int CapturedNum {0u};
+	unsigned int DroppedNum {0u};
+	// Counted by the write jobs as they finish.
+	std::atomic<unsigned int> WritingNum {0u};
+	std::atomic<unsigned int> FailedNum {0u};
+	JobCounter Writes;
+};
@@ -0,0 +1,50 @@
+// Laid out like Graphics::FrameConstants, written once per frame and bound to every shading stage in the same register.
+// Passes drawing from another viewpoint, such as the shadow faces, rewrite the view members for their draws.
+cbuffer Frame : register(b13)
+{
+    matrix View;
+    matrix Projection;
+    matrix ViewProjection;
+    float3 CameraPosition;
+    // Seconds since the graphics device was created.
+    float Time;
+    // Only while the instanced stereo pass draws, see Graphics::EnableStereo. Every instance is drawn once per eye then,
+    // the eye its ID modulo EyeNum. EyeNum is one everywhere else.
+    matrix EyeViewProjections[2];
+    uint EyeNum;
+    float3 FramePadding;
+}
+
+struct EyePosition
+{
+    float4 Position;
+    // Keeps each eye on its own half of the viewport.
+    float ClipDistance;
+};
+
+// The instance of the draw InInstanceID is a copy of, the same ID outside the stereo pass.
+uint GetDrawnInstance(const uint InInstanceID)
+{
+    return InInstanceID / max(EyeNum, 1u);
+}
+
+// Projects a world position like ViewProjection does, into the eye of its instance in the stereo pass. The shading and
+// depth-only shaders share it, so the depth they write stays exactly equal.
+EyePosition ProjectToEye(const float4 InWorldPosition, const uint InInstanceID)
+{
+    EyePosition Projected;
+
+    if (EyeNum < 2u)
+    {
+        Projected.Position = mul(InWorldPosition, ViewProjection);
+        Projected.ClipDistance = 1.0f;
+        return Projected;
+    }
+
+    // Squeezed into the left or right half of the viewport, and cut off where the other half starts.
+    const uint Eye = InInstanceID % EyeNum;
+    Projected.Position = mul(InWorldPosition, EyeViewProjections[Eye]);
+    Projected.Position.x = Projected.Position.x * 0.5f + (Eye == 0u ? -0.5f : 0.5f) * Projected.Position.w;
+    Projected.ClipDistance = Eye == 0u ? -Projected.Position.x : Projected.Position.x;
+    return Projected;
+}
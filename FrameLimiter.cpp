@@ -0,0 +1,77 @@
+﻿#include "FrameLimiter.h"
+#include <thread>
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+
+FrameLimiter::FrameLimiter()
+{
+	// https://learn.microsoft.com/en-us/windows/win32/api/synchapi/nf-synchapi-createwaitabletimerexw
+	Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	bIsHighResolution = Timer != nullptr;
+
+	if (!Timer)
+	{
+		Timer = CreateWaitableTimerExW(nullptr, nullptr, 0u, TIMER_ALL_ACCESS);
+	}
+
+	if (!Timer)
+	{
+		throw HRESULT_LAST_EXCEPTION();
+	}
+}
+
+FrameLimiter::~FrameLimiter()
+{
+	CloseHandle(Timer);
+}
+
+void FrameLimiter::Wait()
+{
+	if (Interval == Clock::duration::zero())
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("FrameLimiter::Wait");
+
+	Deadline += Interval;
+	const auto Now = Clock::now();
+
+	if (Deadline <= Now)
+	{
+		Deadline = Now;
+		return;
+	}
+
+	const auto Spin = bIsHighResolution ? Clock::duration(HighResolutionSpin) : Clock::duration(LowResolutionSpin);
+
+	if (const auto Sleep = Deadline - Now - Spin; Sleep > Clock::duration::zero())
+	{
+		// Negative due times are relative, in 100 nanosecond units.
+		LARGE_INTEGER DueTime;
+		DueTime.QuadPart = -std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10'000'000>>>(Sleep).count();
+
+		if (SetWaitableTimerEx(Timer, &DueTime, 0, nullptr, nullptr, nullptr, 0u))
+		{
+			WaitForSingleObject(Timer, INFINITE);
+		}
+	}
+
+	while (Clock::now() < Deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void FrameLimiter::SetMaxFrameRate(const float InMaxFrameRate) noexcept
+{
+	MaxFrameRate = InMaxFrameRate > 0.0f ? InMaxFrameRate : 0.0f;
+	Interval = Clock::duration::zero();
+
+	if (MaxFrameRate > 0.0f)
+	{
+		Interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / MaxFrameRate));
+	}
+
+	Deadline = Clock::now();
+}
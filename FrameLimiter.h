@@ -0,0 +1,51 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <chrono>
+
+/**
+ * Holds the render loop to a frame rate cap without burning a core on it.
+ * A high resolution waitable timer sleeps until just short of the frame's deadline and the rest is spun out, which
+ * lands within a few microseconds of it. Windows before the timer flag existed fall back to an ordinary timer and a
+ * longer spin, as it may wake up a whole scheduler tick late.
+ */
+class FrameLimiter
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	FrameLimiter();
+	FrameLimiter(const FrameLimiter&) = delete;
+	FrameLimiter(FrameLimiter&&) = delete;
+	FrameLimiter& operator=(const FrameLimiter&) = delete;
+	FrameLimiter& operator=(FrameLimiter&&) = delete;
+	~FrameLimiter();
+
+	// Until one frame at the cap has passed since the last call returned, on the frame schedule rather than from now so
+	// that waking late doesn't add up. A frame that ran past its deadline starts the schedule again instead of rushing.
+	void Wait();
+
+	// Zero removes the cap.
+	void SetMaxFrameRate(float InMaxFrameRate) noexcept;
+
+	[[nodiscard]] float GetMaxFrameRate() const noexcept
+	{
+		return MaxFrameRate;
+	}
+
+	[[nodiscard]] bool IsHighResolution() const noexcept
+	{
+		return bIsHighResolution;
+	}
+
+private:
+	// What is left to the deadline when the timer wakes, spun out because no sleep is that precise.
+	static constexpr std::chrono::microseconds HighResolutionSpin {200};
+	static constexpr std::chrono::microseconds LowResolutionSpin {2000};
+
+private:
+	HANDLE Timer {nullptr};
+	bool bIsHighResolution {false};
+	float MaxFrameRate {0.0f};
+	Clock::duration Interval {Clock::duration::zero()};
+	Clock::time_point Deadline {Clock::now()};
+};
@@ -0,0 +1,571 @@
+﻿#include "FrameProfiler.h"
+#include "EngineWin.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#if PROFILE_MARKERS_ENABLED
+	#include <TraceLoggingProvider.h>
+	#include <winmeta.h>
+#endif
+#include "GpuProfiler.h"
+#include "imgui/imgui.h"
+
+#if PROFILE_MARKERS_ENABLED
+// {6E3B5C14-2F0A-4C8D-9B71-3A5D2E8F4C60}
+TRACELOGGING_DEFINE_PROVIDER(ProfilerProvider, "Engine.Profiler", (0x6e3b5c14, 0x2f0a, 0x4c8d, 0x9b, 0x71, 0x3a, 0x5d, 0x2e, 0x8f, 0x4c, 0x60));
+#endif
+
+namespace
+{
+	using Clock = FrameProfiler::Clock;
+
+#if PROFILE_MARKERS_ENABLED
+	// Registered for the whole process, events cost a flag test unless a session listens.
+	struct ProviderRegistration
+	{
+		ProviderRegistration() noexcept
+		{
+			TraceLoggingRegister(ProfilerProvider);
+		}
+
+		ProviderRegistration(const ProviderRegistration&) = delete;
+		ProviderRegistration(ProviderRegistration&&) = delete;
+		ProviderRegistration& operator=(const ProviderRegistration&) = delete;
+		ProviderRegistration& operator=(ProviderRegistration&&) = delete;
+
+		~ProviderRegistration()
+		{
+			TraceLoggingUnregister(ProfilerProvider);
+		}
+	};
+
+	const ProviderRegistration Registration;
+#endif
+	using History = std::array<float, FrameProfiler::WindowFrameNum>;
+
+	struct Event
+	{
+		const char* Name;
+		unsigned int Depth;
+		Clock::time_point Start;
+		Clock::time_point End;
+	};
+
+	struct Zone
+	{
+		const char* Name;
+		unsigned int Depth;
+		History Times {};
+		float CurrentTime {0.0f};
+		unsigned int CurrentCallNum {0u};
+		unsigned int LastCallNum {0u};
+	};
+
+	struct Summary
+	{
+		float Min;
+		float Average;
+		float Max;
+	};
+
+	struct ProfilerState
+	{
+		ProfilerState()
+		{
+			CurrentEvents.reserve(FrameProfiler::MaxEventNum);
+			LastEvents.reserve(FrameProfiler::MaxEventNum);
+		}
+
+		// Zones keep the order they were first entered in, which follows the call hierarchy.
+		std::vector<Zone> Zones;
+		std::vector<Event> CurrentEvents;
+		std::vector<Event> LastEvents;
+		unsigned int DroppedEventNum {0u};
+		unsigned int LastDroppedEventNum {0u};
+		unsigned int Depth {0u};
+
+		Clock::time_point CurrentFrameStart {Clock::now()};
+		Clock::time_point LastFrameStart {};
+		Clock::time_point LastFrameEnd {};
+		History FrameTimes {};
+		unsigned int Cursor {0u};
+		unsigned int RecordedFrameNum {0u};
+		bool bIsPaused {false};
+	};
+
+	// Only the thread driving BeginFrame records, zones entered on worker threads are ignored.
+	thread_local bool bIsProfilingThread {false};
+
+	struct TraceEvent
+	{
+		const char* Name;
+		Clock::time_point Start;
+		Clock::time_point End;
+		// Zero outside jobs.
+		unsigned long long JobId;
+	};
+
+	// Written by its own thread alone, readers copy it and drop whatever the writer may have overwritten meanwhile.
+	struct ThreadTrace
+	{
+		void Push(const TraceEvent& InEvent) noexcept
+		{
+			const auto Index = WrittenNum.load(std::memory_order_relaxed);
+			Events[Index % Events.size()] = InEvent;
+			WrittenNum.store(Index + 1u, std::memory_order_release);
+		}
+
+		std::array<TraceEvent, FrameProfiler::TraceEventNum> Events;
+		std::atomic<unsigned long long> WrittenNum {0u};
+		// In the order threads first traced, zero is the GPU.
+		unsigned int ThreadId {0u};
+		std::atomic<const char*> ThreadName {"Thread"};
+	};
+
+	struct TraceRegistry
+	{
+		// Only taken when a thread traces its first zone and while exporting.
+		std::mutex Mutex;
+		// Kept after their threads exit, so what they did stays in the trace.
+		std::vector<std::unique_ptr<ThreadTrace>> Threads;
+		ThreadTrace Gpu;
+	};
+
+	thread_local ThreadTrace* CurrentTrace {nullptr};
+	thread_local unsigned long long CurrentJobId {0u};
+
+	TraceRegistry& GetTraceRegistry() noexcept
+	{
+		static TraceRegistry Registry;
+		return Registry;
+	}
+
+	ThreadTrace& GetThreadTrace()
+	{
+		if (!CurrentTrace)
+		{
+			auto& Registry = GetTraceRegistry();
+			std::lock_guard Lock(Registry.Mutex);
+			CurrentTrace = Registry.Threads.emplace_back(std::make_unique<ThreadTrace>()).get();
+			CurrentTrace->ThreadId = static_cast<unsigned int>(Registry.Threads.size());
+		}
+
+		return *CurrentTrace;
+	}
+
+	// The events of InTrace that ended after InSince and are sure not to have been overwritten while copying.
+	void CopyTrace(const ThreadTrace& InTrace, const Clock::time_point InSince, std::vector<TraceEvent>& OutEvents)
+	{
+		constexpr auto Capacity = static_cast<unsigned long long>(FrameProfiler::TraceEventNum);
+		const auto WrittenNum = InTrace.WrittenNum.load(std::memory_order_acquire);
+		const auto First = WrittenNum > Capacity ? WrittenNum - Capacity : 0u;
+		const auto CopiedFrom = OutEvents.size();
+
+		for (auto Index = First; Index < WrittenNum; ++Index)
+		{
+			OutEvents.push_back(InTrace.Events[Index % Capacity]);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const auto WrittenAfterNum = InTrace.WrittenNum.load(std::memory_order_relaxed);
+		// The slot being written right now counts as overwritten too.
+		const auto OverwrittenNum = WrittenAfterNum + 1u > First + Capacity ? std::min(WrittenAfterNum + 1u - First - Capacity, WrittenNum - First) : 0u;
+
+		OutEvents.erase(OutEvents.begin() + static_cast<std::ptrdiff_t>(CopiedFrom),
+		                OutEvents.begin() + static_cast<std::ptrdiff_t>(CopiedFrom + OverwrittenNum));
+		OutEvents.erase(std::remove_if(OutEvents.begin() + static_cast<std::ptrdiff_t>(CopiedFrom), OutEvents.end(), [InSince](const TraceEvent& InEvent)
+		{
+			return InEvent.End < InSince;
+		}), OutEvents.end());
+	}
+
+	void WriteTraceString(std::ostream& InStream, const char* InText)
+	{
+		InStream << '"';
+
+		for (; *InText; ++InText)
+		{
+			if (*InText == '"' || *InText == '\\')
+			{
+				InStream << '\\';
+			}
+
+			InStream << *InText;
+		}
+
+		InStream << '"';
+	}
+
+	ProfilerState& GetState() noexcept
+	{
+		static ProfilerState State;
+		return State;
+	}
+
+	float ToMilliseconds(const Clock::duration InDuration) noexcept
+	{
+		return std::chrono::duration<float, std::milli>(InDuration).count();
+	}
+
+	Summary Summarize(const History& InTimes, const unsigned int InRecordedNum) noexcept
+	{
+		if (InRecordedNum == 0u)
+		{
+			return {0.0f, 0.0f, 0.0f};
+		}
+
+		const auto Begin = InTimes.begin();
+		const auto End = Begin + InRecordedNum;
+		const auto [Min, Max] = std::minmax_element(Begin, End);
+
+		float Sum = 0.0f;
+		for (auto Iterator = Begin; Iterator != End; ++Iterator)
+		{
+			Sum += *Iterator;
+		}
+
+		return {*Min, Sum / static_cast<float>(InRecordedNum), *Max};
+	}
+
+	ImU32 GetZoneColor(const char* InName) noexcept
+	{
+		const auto Hash = std::hash<const void*>{}(InName);
+		const auto Hue = static_cast<float>(Hash % 360u) / 360.0f;
+		return ImColor::HSV(Hue, 0.55f, 0.65f);
+	}
+
+	void ShowFlameChart(const ProfilerState& InState)
+	{
+		const auto FrameTime = ToMilliseconds(InState.LastFrameEnd - InState.LastFrameStart);
+
+		if (InState.LastEvents.empty() || FrameTime <= 0.0f)
+		{
+			return;
+		}
+
+		unsigned int MaxDepth = 0u;
+		for (const auto& Event : InState.LastEvents)
+		{
+			MaxDepth = std::max(MaxDepth, Event.Depth);
+		}
+
+		const auto RowHeight = ImGui::GetTextLineHeightWithSpacing();
+		const auto Origin = ImGui::GetCursorScreenPos();
+		const auto Width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+
+		ImGui::InvisibleButton("FlameChart", {Width, RowHeight * static_cast<float>(MaxDepth + 1u)});
+		const auto bIsHovered = ImGui::IsItemHovered();
+		auto* const DrawList = ImGui::GetWindowDrawList();
+
+		for (const auto& Event : InState.LastEvents)
+		{
+			const auto Left = Origin.x + Width * ToMilliseconds(Event.Start - InState.LastFrameStart) / FrameTime;
+			const auto Right = std::max(Left + 1.0f, Origin.x + Width * ToMilliseconds(Event.End - InState.LastFrameStart) / FrameTime);
+			const auto Top = Origin.y + RowHeight * static_cast<float>(Event.Depth);
+			const ImVec2 Min {Left, Top};
+			const ImVec2 Max {Right, Top + RowHeight - 1.0f};
+
+			DrawList->AddRectFilled(Min, Max, GetZoneColor(Event.Name));
+
+			if (Right - Left > ImGui::CalcTextSize(Event.Name).x + 4.0f)
+			{
+				DrawList->AddText({Left + 2.0f, Top}, IM_COL32_WHITE, Event.Name);
+			}
+
+			if (bIsHovered && ImGui::IsMouseHoveringRect(Min, Max))
+			{
+				ImGui::SetTooltip("%s: %.3f ms", Event.Name, ToMilliseconds(Event.End - Event.Start));
+			}
+		}
+	}
+}
+
+FrameProfiler::Scope::Scope(const char* InName)
+	: Name(InName), Depth(0u), ZoneIndex(NotRecorded)
+{
+#if PROFILE_MARKERS_ENABLED
+	TraceLoggingWrite(ProfilerProvider, "Zone", TraceLoggingOpcode(WINEVENT_OPCODE_START), TraceLoggingString(Name, "Name"));
+#endif
+
+	if (!bIsProfilingThread)
+	{
+		Start = Clock::now();
+		return;
+	}
+
+	Depth = GetState().Depth++;
+	auto& Zones = GetState().Zones;
+	const auto ZoneIterator = std::find_if(Zones.begin(), Zones.end(), [this](const Zone& InZone)
+	{
+		return InZone.Name == Name;
+	});
+
+	ZoneIndex = static_cast<size_t>(ZoneIterator - Zones.begin());
+
+	if (ZoneIterator == Zones.end())
+	{
+		Zones.push_back({Name, Depth});
+	}
+
+	Start = Clock::now();
+}
+
+FrameProfiler::Scope::~Scope()
+{
+#if PROFILE_MARKERS_ENABLED
+	TraceLoggingWrite(ProfilerProvider, "Zone", TraceLoggingOpcode(WINEVENT_OPCODE_STOP), TraceLoggingString(Name, "Name"));
+#endif
+
+	const auto End = Clock::now();
+	GetThreadTrace().Push({Name, Start, End, CurrentJobId});
+
+	if (ZoneIndex == NotRecorded)
+	{
+		return;
+	}
+
+	auto& State = GetState();
+	auto& Zone = State.Zones[ZoneIndex];
+	--State.Depth;
+
+	Zone.CurrentTime += ToMilliseconds(End - Start);
+	++Zone.CurrentCallNum;
+
+	// The reserved capacity is never exceeded so recording does not allocate mid-frame.
+	if (State.CurrentEvents.size() < MaxEventNum)
+	{
+		State.CurrentEvents.push_back({Name, Depth, Start, End});
+	}
+	else
+	{
+		++State.DroppedEventNum;
+	}
+}
+
+void FrameProfiler::BeginFrame() noexcept
+{
+	auto& State = GetState();
+	const auto Now = Clock::now();
+
+	if (!bIsProfilingThread)
+	{
+		SetThreadName("Main");
+		bIsProfilingThread = true;
+	}
+
+	State.FrameTimes[State.Cursor] = ToMilliseconds(Now - State.CurrentFrameStart);
+
+	for (auto& Zone : State.Zones)
+	{
+		Zone.Times[State.Cursor] = Zone.CurrentTime;
+		Zone.LastCallNum = Zone.CurrentCallNum;
+		Zone.CurrentTime = 0.0f;
+		Zone.CurrentCallNum = 0u;
+	}
+
+	State.Cursor = (State.Cursor + 1u) % WindowFrameNum;
+	State.RecordedFrameNum = std::min(State.RecordedFrameNum + 1u, WindowFrameNum);
+
+	if (!State.bIsPaused)
+	{
+		std::swap(State.CurrentEvents, State.LastEvents);
+		State.LastFrameStart = State.CurrentFrameStart;
+		State.LastFrameEnd = Now;
+	}
+
+	State.CurrentEvents.clear();
+	State.LastDroppedEventNum = State.DroppedEventNum;
+	State.DroppedEventNum = 0u;
+	State.CurrentFrameStart = Now;
+}
+
+float FrameProfiler::GetLastFrameTime() noexcept
+{
+	const auto& State = GetState();
+	return State.FrameTimes[(State.Cursor + WindowFrameNum - 1u) % WindowFrameNum];
+}
+
+void FrameProfiler::GetLastTimings(std::vector<Timing>& OutTimings)
+{
+	const auto& State = GetState();
+	const auto LastIndex = (State.Cursor + WindowFrameNum - 1u) % WindowFrameNum;
+
+	OutTimings.clear();
+
+	for (const auto& Zone : State.Zones)
+	{
+		OutTimings.push_back({Zone.Name, Zone.Depth, Zone.Times[LastIndex], Zone.LastCallNum});
+	}
+}
+
+FrameProfiler::JobScope::JobScope(const unsigned long long InJobId) noexcept
+	: PreviousJobId(CurrentJobId), Start(Clock::now())
+{
+	CurrentJobId = InJobId;
+}
+
+FrameProfiler::JobScope::~JobScope()
+{
+	GetThreadTrace().Push({"Job", Start, Clock::now(), CurrentJobId});
+	CurrentJobId = PreviousJobId;
+}
+
+void FrameProfiler::SetThreadName(const char* InName) noexcept
+{
+	GetThreadTrace().ThreadName.store(InName, std::memory_order_relaxed);
+}
+
+void FrameProfiler::AddGpuZone(const char* InName, const Clock::time_point InStart, const Clock::time_point InEnd) noexcept
+{
+	GetTraceRegistry().Gpu.Push({InName, InStart, InEnd, 0u});
+}
+
+void FrameProfiler::PauseTimeline() noexcept
+{
+	GetState().bIsPaused = true;
+}
+
+bool FrameProfiler::ExportTrace(const std::string& InFileName, const float InSeconds)
+{
+	return ExportTrace(InFileName, Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(InSeconds)));
+}
+
+bool FrameProfiler::ExportTrace(const std::string& InFileName, const Clock::time_point InSince, const std::span<const Counter> InCounters)
+{
+	struct TracedThread
+	{
+		unsigned int ThreadId;
+		const char* Name;
+		std::vector<TraceEvent> Events;
+	};
+
+	std::vector<TracedThread> Threads;
+	{
+		auto& Registry = GetTraceRegistry();
+		std::lock_guard Lock(Registry.Mutex);
+
+		Threads.push_back({0u, "GPU", {}});
+		CopyTrace(Registry.Gpu, InSince, Threads.back().Events);
+
+		for (const auto& Thread : Registry.Threads)
+		{
+			Threads.push_back({Thread->ThreadId, Thread->ThreadName.load(std::memory_order_relaxed), {}});
+			CopyTrace(*Thread, InSince, Threads.back().Events);
+		}
+	}
+
+	std::ofstream Stream(InFileName);
+
+	if (!Stream)
+	{
+		return false;
+	}
+
+	// Complete events in microseconds from the start of the window, one track per thread.
+	const auto ToMicroseconds = [InSince](const Clock::time_point InTime)
+	{
+		return std::chrono::duration<double, std::micro>(InTime - InSince).count();
+	};
+
+	Stream << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool bIsFirst = true;
+
+	for (const auto& [ThreadId, Name, Events] : Threads)
+	{
+		Stream << (bIsFirst ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ThreadId << ",\"args\":{\"name\":";
+		WriteTraceString(Stream, Name);
+		Stream << "}}";
+		bIsFirst = false;
+
+		for (const auto& Event : Events)
+		{
+			Stream << ",\n{\"name\":";
+			WriteTraceString(Stream, Event.Name);
+			Stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ThreadId << ",\"ts\":" << ToMicroseconds(Event.Start)
+			       << ",\"dur\":" << ToMicroseconds(Event.End) - ToMicroseconds(Event.Start);
+
+			if (Event.JobId)
+			{
+				Stream << ",\"args\":{\"job\":" << Event.JobId << '}';
+			}
+
+			Stream << '}';
+		}
+	}
+
+	for (const auto& [Name, Time, Value] : InCounters)
+	{
+		if (Time < InSince)
+		{
+			continue;
+		}
+
+		Stream << ",\n{\"name\":";
+		WriteTraceString(Stream, Name);
+		Stream << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << ToMicroseconds(Time) << ",\"args\":{\"value\":" << Value << "}}";
+	}
+
+	Stream << "\n]}\n";
+	return static_cast<bool>(Stream);
+}
+
+void FrameProfiler::ShowWindow(GpuProfiler* InGpuProfiler)
+{
+	auto& State = GetState();
+
+	if (ImGui::Begin("Profiler"))
+	{
+		const auto Frame = Summarize(State.FrameTimes, State.RecordedFrameNum);
+		ImGui::Text("Frame %.2f ms (min %.2f, max %.2f) over %u frames", Frame.Average, Frame.Min, Frame.Max, State.RecordedFrameNum);
+		ImGui::Checkbox("Pause timeline", &State.bIsPaused);
+
+		if (ImGui::BeginTable("Zones", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Zone");
+			ImGui::TableSetupColumn("Calls");
+			ImGui::TableSetupColumn("Min ms");
+			ImGui::TableSetupColumn("Avg ms");
+			ImGui::TableSetupColumn("Max ms");
+			ImGui::TableHeadersRow();
+
+			for (const auto& Zone : State.Zones)
+			{
+				const auto ZoneSummary = Summarize(Zone.Times, State.RecordedFrameNum);
+
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%*s%s", static_cast<int>(Zone.Depth * 2u), "", Zone.Name);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", Zone.LastCallNum);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", ZoneSummary.Min);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", ZoneSummary.Average);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.3f", ZoneSummary.Max);
+			}
+
+			ImGui::EndTable();
+		}
+
+		if (State.LastDroppedEventNum)
+		{
+			ImGui::Text("%u events over the per-frame limit were not recorded", State.LastDroppedEventNum);
+		}
+
+		ShowFlameChart(State);
+
+		if (InGpuProfiler && ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen))
+		{
+			InGpuProfiler->ShowTimings();
+		}
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,109 @@
+﻿#pragma once
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+class GpuProfiler;
+
+// Shipping builds leave out the GPU event markers and ETW zone events that external profilers read.
+#ifdef SHIPPING
+	#define PROFILE_MARKERS_ENABLED 0
+#else
+	#define PROFILE_MARKERS_ENABLED 1
+#endif
+
+#define PROFILE_CONCAT_IMPL(InLeft, InRight) InLeft##InRight
+#define PROFILE_CONCAT(InLeft, InRight) PROFILE_CONCAT_IMPL(InLeft, InRight)
+// Times the enclosing block as a zone of the current frame, the name must be a string literal.
+#define PROFILE_SCOPE(InName) const FrameProfiler::Scope PROFILE_CONCAT(ProfileScope, __LINE__) {InName}
+
+/**
+ * Hierarchical CPU zone timer for the thread that calls BeginFrame.
+ * Zones are aggregated per frame and kept over a rolling window, the last frame is also shown as a flame chart.
+ * Every thread's zones are also written as ETW start and stop events of the Engine.Profiler TraceLogging provider, so
+ * WPA and PIX timing captures show them alongside the GPU events.
+ * Independently of the frame, every thread keeps its last TraceEventNum zones in a ring only it writes to, which
+ * ExportTrace turns into Chrome trace JSON together with the GPU scopes placed on the CPU timeline.
+ */
+class FrameProfiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Timing
+	{
+		const char* Name;
+		unsigned int Depth;
+		float Milliseconds;
+		unsigned int CallNum;
+	};
+
+	// A value traced on a counter track of its own, such as the bytes allocated in a frame.
+	struct Counter
+	{
+		const char* Name;
+		Clock::time_point Time;
+		double Value;
+	};
+
+	class Scope
+	{
+	public:
+		explicit Scope(const char* InName);
+		Scope(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		Scope& operator=(Scope&&) = delete;
+		~Scope();
+
+	private:
+		static constexpr size_t NotRecorded {~size_t{0u}};
+
+		const char* Name;
+		unsigned int Depth;
+		size_t ZoneIndex;
+		Clock::time_point Start;
+	};
+
+	// Traces the job as a zone of its own, and the zones entered while it runs as part of it.
+	class JobScope
+	{
+	public:
+		explicit JobScope(unsigned long long InJobId) noexcept;
+		JobScope(const JobScope&) = delete;
+		JobScope(JobScope&&) = delete;
+		JobScope& operator=(const JobScope&) = delete;
+		JobScope& operator=(JobScope&&) = delete;
+		~JobScope();
+
+	private:
+		unsigned long long PreviousJobId;
+		Clock::time_point Start;
+	};
+
+	// Closes the frame being recorded and starts the next one.
+	static void BeginFrame() noexcept;
+	// GPU scope timings are shown under the CPU zones when a profiler is given.
+	static void ShowWindow(GpuProfiler* InGpuProfiler = nullptr);
+	// Keeps the flame chart on the frame closed by the last BeginFrame until unpaused in the window.
+	static void PauseTimeline() noexcept;
+
+	// The frame closed by the last BeginFrame, zones that were not entered in it report zero.
+	[[nodiscard]] static float GetLastFrameTime() noexcept;
+	static void GetLastTimings(std::vector<Timing>& OutTimings);
+
+	// What the trace shows the calling thread as, the name must be a string literal.
+	static void SetThreadName(const char* InName) noexcept;
+	// A resolved GPU scope in CPU time, traced on a track of its own. Only from the thread driving BeginFrame.
+	static void AddGpuZone(const char* InName, Clock::time_point InStart, Clock::time_point InEnd) noexcept;
+	// The zones of every thread that ended in the last InSeconds, for chrome://tracing and Perfetto.
+	[[nodiscard]] static bool ExportTrace(const std::string& InFileName, float InSeconds);
+	// The zones that ended since InSince, with the counters on tracks of their own.
+	[[nodiscard]] static bool ExportTrace(const std::string& InFileName, Clock::time_point InSince, std::span<const Counter> InCounters = {});
+
+	static constexpr unsigned int WindowFrameNum {120u};
+	static constexpr unsigned int MaxEventNum {4096u};
+	static constexpr unsigned int TraceEventNum {16384u};
+};
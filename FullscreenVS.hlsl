@@ -0,0 +1,6 @@
+// One triangle covering the screen, generated from the vertex index so the pass needs no vertex buffer.
+float4 main(const uint InVertexID : SV_VertexID) : SV_Position
+{
+    const float2 TextureCoordinate = float2((InVertexID << 1) & 2, InVertexID & 2);
+    return float4(TextureCoordinate * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+}
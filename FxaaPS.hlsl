@@ -0,0 +1,159 @@
+// The last post-processing step, draws the tonemapped image to the display, upscaled when the scene renders below it.
+// With FXAA on, the quality variant of Lottes' FXAA 3.11 first smooths the edges it finds along the luma ToneMapCS.hlsl left in alpha.
+Texture2D<float4> Image : register(t0);
+SamplerState LinearSampler : register(s0);
+
+cbuffer Fxaa : register(b0)
+{
+    // Display pixel to image texture coordinate, and half a texel inside the part this frame rendered.
+    float2 SceneScale;
+    float2 MaxSceneCoordinate;
+    // One texel of the image in texture coordinates.
+    float2 RcpFrame;
+    uint bIsFxaaEnabled;
+    float Padding;
+}
+
+// Contrast below which a neighbourhood isn't an edge, relative to its brightest luma and in absolute terms for dark ones.
+static const float EdgeThreshold = 0.125f;
+static const float EdgeThresholdMin = 0.0312f;
+// How much of the subpixel aliasing to remove, one blurs away thin details along with it.
+static const float SubpixelQuality = 0.75f;
+
+#define SEARCH_STEP_NUM 10
+// Texels advanced per step along the edge, growing so long edges end the search early.
+static const float SearchSteps[SEARCH_STEP_NUM] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.5f, 2.0f, 2.0f, 4.0f, 8.0f};
+
+float SampleLuma(const float2 InCoordinate)
+{
+    return Image.SampleLevel(LinearSampler, min(InCoordinate, MaxSceneCoordinate), 0.0f).a;
+}
+
+float3 Antialias(const float2 InCoordinate, const float4 InCenter)
+{
+    const float LumaCenter = InCenter.a;
+    const float LumaNorth = SampleLuma(InCoordinate + float2(0.0f, -RcpFrame.y));
+    const float LumaSouth = SampleLuma(InCoordinate + float2(0.0f, RcpFrame.y));
+    const float LumaWest = SampleLuma(InCoordinate + float2(-RcpFrame.x, 0.0f));
+    const float LumaEast = SampleLuma(InCoordinate + float2(RcpFrame.x, 0.0f));
+
+    const float LumaMin = min(LumaCenter, min(min(LumaNorth, LumaSouth), min(LumaWest, LumaEast)));
+    const float LumaMax = max(LumaCenter, max(max(LumaNorth, LumaSouth), max(LumaWest, LumaEast)));
+    const float LumaRange = LumaMax - LumaMin;
+
+    if (LumaRange < max(EdgeThresholdMin, LumaMax * EdgeThreshold))
+    {
+        return InCenter.rgb;
+    }
+
+    const float LumaNorthWest = SampleLuma(InCoordinate - RcpFrame);
+    const float LumaSouthEast = SampleLuma(InCoordinate + RcpFrame);
+    const float LumaNorthEast = SampleLuma(InCoordinate + float2(RcpFrame.x, -RcpFrame.y));
+    const float LumaSouthWest = SampleLuma(InCoordinate + float2(-RcpFrame.x, RcpFrame.y));
+
+    const float LumaNorthSouth = LumaNorth + LumaSouth;
+    const float LumaWestEast = LumaWest + LumaEast;
+    const float LumaWestCorners = LumaNorthWest + LumaSouthWest;
+    const float LumaEastCorners = LumaNorthEast + LumaSouthEast;
+    const float LumaNorthCorners = LumaNorthWest + LumaNorthEast;
+    const float LumaSouthCorners = LumaSouthWest + LumaSouthEast;
+
+    // Whichever way the luma changes more across the 3x3 block, the edge runs the other way.
+    const float EdgeHorizontal = abs(LumaWestCorners - 2.0f * LumaWest) + 2.0f * abs(LumaNorthSouth - 2.0f * LumaCenter) + abs(LumaEastCorners - 2.0f * LumaEast);
+    const float EdgeVertical = abs(LumaNorthCorners - 2.0f * LumaNorth) + 2.0f * abs(LumaWestEast - 2.0f * LumaCenter) + abs(LumaSouthCorners - 2.0f * LumaSouth);
+    const bool bIsHorizontal = EdgeHorizontal >= EdgeVertical;
+
+    // The side of the pixel the edge lies on is the one with the steeper gradient.
+    const float LumaBefore = bIsHorizontal ? LumaNorth : LumaWest;
+    const float LumaAfter = bIsHorizontal ? LumaSouth : LumaEast;
+    const float GradientBefore = LumaBefore - LumaCenter;
+    const float GradientAfter = LumaAfter - LumaCenter;
+    const bool bIsBeforeSteepest = abs(GradientBefore) >= abs(GradientAfter);
+    const float GradientScaled = 0.25f * max(abs(GradientBefore), abs(GradientAfter));
+
+    float StepLength = bIsHorizontal ? RcpFrame.y : RcpFrame.x;
+    float LumaLocalAverage;
+
+    if (bIsBeforeSteepest)
+    {
+        StepLength = -StepLength;
+        LumaLocalAverage = 0.5f * (LumaBefore + LumaCenter);
+    }
+    else
+    {
+        LumaLocalAverage = 0.5f * (LumaAfter + LumaCenter);
+    }
+
+    // Walks both ways along the edge, half a texel over onto it, until the luma there no longer matches the edge's average.
+    float2 EdgeCoordinate = InCoordinate;
+
+    if (bIsHorizontal)
+    {
+        EdgeCoordinate.y += StepLength * 0.5f;
+    }
+    else
+    {
+        EdgeCoordinate.x += StepLength * 0.5f;
+    }
+
+    const float2 Offset = bIsHorizontal ? float2(RcpFrame.x, 0.0f) : float2(0.0f, RcpFrame.y);
+    float2 CoordinateNegative = EdgeCoordinate;
+    float2 CoordinatePositive = EdgeCoordinate;
+    float LumaEndNegative = 0.0f;
+    float LumaEndPositive = 0.0f;
+    bool bReachedNegative = false;
+    bool bReachedPositive = false;
+
+    for (uint Step = 0u; Step < SEARCH_STEP_NUM && !(bReachedNegative && bReachedPositive); ++Step)
+    {
+        if (!bReachedNegative)
+        {
+            CoordinateNegative -= Offset * SearchSteps[Step];
+            LumaEndNegative = SampleLuma(CoordinateNegative) - LumaLocalAverage;
+            bReachedNegative = abs(LumaEndNegative) >= GradientScaled;
+        }
+
+        if (!bReachedPositive)
+        {
+            CoordinatePositive += Offset * SearchSteps[Step];
+            LumaEndPositive = SampleLuma(CoordinatePositive) - LumaLocalAverage;
+            bReachedPositive = abs(LumaEndPositive) >= GradientScaled;
+        }
+    }
+
+    const float DistanceNegative = bIsHorizontal ? InCoordinate.x - CoordinateNegative.x : InCoordinate.y - CoordinateNegative.y;
+    const float DistancePositive = bIsHorizontal ? CoordinatePositive.x - InCoordinate.x : CoordinatePositive.y - InCoordinate.y;
+    const bool bIsNegativeCloser = DistanceNegative < DistancePositive;
+
+    // Shifts the sample toward the edge by how near its closer end the pixel is, unless the luma there moves the other way.
+    const float PixelOffset = 0.5f - min(DistanceNegative, DistancePositive) / (DistanceNegative + DistancePositive);
+    const bool bIsCenterSmaller = LumaCenter < LumaLocalAverage;
+    const bool bIsVariationCorrect = ((bIsNegativeCloser ? LumaEndNegative : LumaEndPositive) < 0.0f) != bIsCenterSmaller;
+    const float EdgeOffset = bIsVariationCorrect ? PixelOffset : 0.0f;
+
+    // Features thinner than a pixel have no edge to walk, they blend by how far the pixel stands out from its neighbourhood.
+    const float LumaAverage = (2.0f * (LumaNorthSouth + LumaWestEast) + LumaWestCorners + LumaEastCorners) / 12.0f;
+    const float SubpixelContrast = saturate(abs(LumaAverage - LumaCenter) / LumaRange);
+    const float SubpixelSmooth = (-2.0f * SubpixelContrast + 3.0f) * SubpixelContrast * SubpixelContrast;
+    const float FinalOffset = max(EdgeOffset, SubpixelSmooth * SubpixelSmooth * SubpixelQuality);
+
+    float2 FinalCoordinate = InCoordinate;
+
+    if (bIsHorizontal)
+    {
+        FinalCoordinate.y += FinalOffset * StepLength;
+    }
+    else
+    {
+        FinalCoordinate.x += FinalOffset * StepLength;
+    }
+
+    return Image.SampleLevel(LinearSampler, min(FinalCoordinate, MaxSceneCoordinate), 0.0f).rgb;
+}
+
+float4 main(const float4 InPosition : SV_Position) : SV_Target
+{
+    const float2 Coordinate = min(InPosition.xy * SceneScale, MaxSceneCoordinate);
+    const float4 Center = Image.SampleLevel(LinearSampler, Coordinate, 0.0f);
+    return float4(bIsFxaaEnabled ? Antialias(Coordinate, Center) : Center.rgb, 1.0f);
+}
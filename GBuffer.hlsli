@@ -0,0 +1,71 @@
+// G-buffer layout written by the GBUFFER build of MaterialPS.hlsl and read by DeferredLightingCS.hlsl, the formats are DeferredShading's.
+// Target 0, R8G8B8A8_UNORM_SRGB: albedo, and in alpha the specular intensity.
+// Target 1, R10G10B10A2_UNORM: octahedral normal, log2 of the specular power over its range, and the specular mode in alpha.
+
+// Powers of two up to this are stored, what a specular map's alpha can reach.
+static const float MaxSpecularPowerLog2 = 13.0f;
+
+// Zero is what the normal target is cleared to, pixels no G-buffer draw covered are left for the forward passes.
+static const uint SpecularModeEmpty = 0u;
+// Highlights take the colour of the light, surfaces without a specular map.
+static const uint SpecularModeLightColored = 1u;
+// Highlights are white scaled by the intensity, the luminance of a specular map's squared tint folded into it.
+static const uint SpecularModeTinted = 2u;
+
+struct GBufferTargets
+{
+    float4 AlbedoSpecular : SV_Target0;
+    float4 NormalPower : SV_Target1;
+};
+
+struct GBufferSurface
+{
+    float3 Albedo;
+    float SpecularIntensity;
+    float3 WorldNormal;
+    float SpecularPower;
+    uint SpecularMode;
+};
+
+float2 OctahedronWrap(const float2 InValue)
+{
+    return (1.0f - abs(InValue.yx)) * (InValue >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Unit normal to two values in [0, 1], the lower hemisphere folded over the diagonals of the upper one.
+float2 EncodeNormal(float3 InNormal)
+{
+    InNormal /= abs(InNormal.x) + abs(InNormal.y) + abs(InNormal.z);
+    const float2 Folded = InNormal.z >= 0.0f ? InNormal.xy : OctahedronWrap(InNormal.xy);
+    return Folded * 0.5f + 0.5f;
+}
+
+float3 DecodeNormal(const float2 InEncoded)
+{
+    const float2 Folded = InEncoded * 2.0f - 1.0f;
+    float3 Normal = float3(Folded, 1.0f - abs(Folded.x) - abs(Folded.y));
+    const float Unfold = saturate(-Normal.z);
+    Normal.xy += (Normal.xy >= 0.0f ? -Unfold : Unfold);
+    return normalize(Normal);
+}
+
+GBufferTargets EncodeGBuffer(const GBufferSurface InSurface)
+{
+    GBufferTargets Targets;
+    // Linear, the sRGB view encodes it.
+    Targets.AlbedoSpecular = float4(saturate(InSurface.Albedo), saturate(InSurface.SpecularIntensity));
+    Targets.NormalPower = float4(EncodeNormal(InSurface.WorldNormal), saturate(log2(max(InSurface.SpecularPower, 1.0f)) / MaxSpecularPowerLog2),
+                                 InSurface.SpecularMode / 3.0f);
+    return Targets;
+}
+
+GBufferSurface DecodeGBuffer(const float4 InAlbedoSpecular, const float4 InNormalPower)
+{
+    GBufferSurface Surface;
+    Surface.Albedo = InAlbedoSpecular.rgb;
+    Surface.SpecularIntensity = InAlbedoSpecular.a;
+    Surface.WorldNormal = DecodeNormal(InNormalPower.xy);
+    Surface.SpecularPower = exp2(InNormalPower.z * MaxSpecularPowerLog2);
+    Surface.SpecularMode = (uint) round(InNormalPower.w * 3.0f);
+    return Surface;
+}
@@ -1,9 +1,11 @@
 ﻿#include "GDIPlusManager.h"
 #include <gdiplus.h>
+#include "StartupTimeline.h"
 #pragma comment(lib, "gdiplus.lib")
 
 GDIPlusManager::GDIPlusManager()
 {
+	STARTUP_PHASE("GDI+");
 	if (RefCount++ == 0)
 	{
 		Gdiplus::GdiplusStartupInput StartupInput;
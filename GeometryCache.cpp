@@ -0,0 +1,99 @@
+﻿#include "GeometryCache.h"
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Cube.h"
+#include "PlaneGeometry.h"
+#include "Sphere.h"
+
+namespace
+{
+	struct ShapeDefaults
+	{
+		const char* Name;
+		int XDivisions;
+		int YDivisions;
+	};
+
+	ShapeDefaults GetDefaults(const GeometryCache::Shape InShape) noexcept
+	{
+		switch (InShape)
+		{
+			case GeometryCache::Shape::Cube:
+				return {"cube", 0, 0};
+			case GeometryCache::Shape::TexturedCube:
+				return {"cube.textured", 0, 0};
+			case GeometryCache::Shape::IndependentCube:
+				return {"cube.independent", 0, 0};
+			case GeometryCache::Shape::Sphere:
+				// What Sphere::Make divides by.
+				return {"sphere", 12, 24};
+			case GeometryCache::Shape::Plane:
+				return {"plane", 1, 1};
+			default:
+				assert(false && "Unknown shape");
+				return {"", 0, 0};
+		}
+	}
+
+	IndexedTriangleList Generate(const GeometryCache::Shape InShape, DV::VertexLayout InLayout, const int InXDivisions, const int InYDivisions)
+	{
+		switch (InShape)
+		{
+			case GeometryCache::Shape::Cube:
+				return Cube::Make(std::move(InLayout));
+			case GeometryCache::Shape::TexturedCube:
+				return Cube::MakeTextured(std::move(InLayout));
+			case GeometryCache::Shape::IndependentCube:
+			{
+				const auto bHasNormals = InLayout.Has<DV::VertexLayout::ElementType::Normal>();
+				auto Model = Cube::MakeIndependent(std::move(InLayout));
+
+				if (bHasNormals)
+				{
+					Model.SetNormalsIndependentFlat();
+				}
+
+				return Model;
+			}
+			case GeometryCache::Shape::Sphere:
+				return Sphere::MakeTessellated(std::move(InLayout), InXDivisions, InYDivisions);
+			case GeometryCache::Shape::Plane:
+				if (InLayout.Has<DV::VertexLayout::ElementType::TangentFrame>())
+				{
+					auto Model = PlaneGeometry::MakeTesselatedPacked(InXDivisions, InYDivisions);
+					assert(Model.Vertices.GetLayout().GetCode() == InLayout.GetCode() && "Packed planes come in one layout only");
+					return Model;
+				}
+
+				return PlaneGeometry::MakeTesselatedTextured(std::move(InLayout), InXDivisions, InYDivisions);
+			default:
+				assert(false && "Unknown shape");
+				return Cube::Make();
+		}
+	}
+
+	std::mutex EntriesMutex;
+	// Held by pointer, Get hands out references that have to survive the map growing.
+	std::unordered_map<std::string, std::unique_ptr<GeometryCache::Entry>> Entries;
+}
+
+const GeometryCache::Entry& GeometryCache::Get(const Shape InShape, const DV::VertexLayout& InLayout, const int InXDivisions, const int InYDivisions)
+{
+	const auto Defaults = GetDefaults(InShape);
+	const auto XDivisions = InXDivisions ? InXDivisions : Defaults.XDivisions;
+	const auto YDivisions = InYDivisions ? InYDivisions : Defaults.YDivisions;
+	auto Tag = "$" + std::string(Defaults.Name) + "." + std::to_string(XDivisions) + "x" + std::to_string(YDivisions) + "." + InLayout.GetCode();
+
+	std::lock_guard Lock(EntriesMutex);
+
+	if (const auto Found = Entries.find(Tag); Found != Entries.end())
+	{
+		return *Found->second;
+	}
+
+	// Rare enough, a handful of shapes per run, that generating under the lock costs nothing.
+	auto Generated = std::make_unique<Entry>(Entry {Generate(InShape, InLayout, XDivisions, YDivisions), Tag});
+	return *Entries.emplace(std::move(Tag), std::move(Generated)).first->second;
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <string>
+#include "DynamicVertex.h"
+#include "IndexedTriangleList.h"
+
+/**
+ * Procedural meshes generated once per shape, tessellation and vertex layout and kept for the rest of the run.
+ * They are all generated at unit size and drawables scale them in their world matrix, so every drawable of the same shape
+ * shares one list here and, resolved under its tag, one vertex and index buffer.
+ */
+class GeometryCache
+{
+public:
+	enum class Shape : unsigned char
+	{
+		// Eight shared corners, positions are all they can carry.
+		Cube,
+		// Corners split where the cross shaped unwrap of the texture needs them.
+		TexturedCube,
+		// Four corners per face, with flat normals when the layout has them.
+		IndependentCube,
+		// Of radius one, divided by latitude and longitude.
+		Sphere,
+		// Two units across facing -z, divided along x and y. Packed when the layout has the tangent frame.
+		Plane
+	};
+
+	struct Entry
+	{
+		IndexedTriangleList Model;
+		// What VertexBuffer::Resolve and IndexBuffer::Resolve share the buffers under.
+		std::string Tag;
+	};
+
+	// Zero divisions take the shape's defaults, cubes ignore them. Any thread, entries never move once generated.
+	[[nodiscard]] static const Entry& Get(Shape InShape, const DV::VertexLayout& InLayout, int InXDivisions = 0, int InYDivisions = 0);
+};
@@ -0,0 +1,236 @@
+﻿#include "GeometryPool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <optional>
+#include "DynamicVertex.h"
+#include "ExceptionMacros.h"
+#include "UploadManager.h"
+
+namespace
+{
+	// First fit over the free ranges of a page, neighbours are merged again when a range is freed.
+	class RangeAllocator
+	{
+	public:
+		explicit RangeAllocator(const UINT InCapacity)
+		{
+			FreeRanges.emplace(0u, InCapacity);
+		}
+
+		[[nodiscard]] std::optional<UINT> Allocate(const UINT InNum)
+		{
+			for (auto Range = FreeRanges.begin(); Range != FreeRanges.end(); ++Range)
+			{
+				if (const auto [Offset, Num] = *Range; Num >= InNum)
+				{
+					FreeRanges.erase(Range);
+
+					if (Num > InNum)
+					{
+						FreeRanges.emplace(Offset + InNum, Num - InNum);
+					}
+
+					return Offset;
+				}
+			}
+
+			return std::nullopt;
+		}
+
+		void Free(UINT InOffset, UINT InNum)
+		{
+			auto Next = FreeRanges.lower_bound(InOffset);
+
+			if (Next != FreeRanges.begin())
+			{
+				if (const auto Previous = std::prev(Next); Previous->first + Previous->second == InOffset)
+				{
+					InOffset = Previous->first;
+					InNum += Previous->second;
+					FreeRanges.erase(Previous);
+				}
+			}
+
+			if (Next != FreeRanges.end() && InOffset + InNum == Next->first)
+			{
+				InNum += Next->second;
+				FreeRanges.erase(Next);
+			}
+
+			FreeRanges.emplace(InOffset, InNum);
+		}
+
+	private:
+		// Offset to length, both in elements.
+		std::map<UINT, UINT> FreeRanges;
+	};
+}
+
+struct GeometryPool::Page
+{
+	std::string Key;
+	UINT ElementSize;
+	UINT AttributeSize;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> AttributeBuffer;
+	RangeAllocator Ranges;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+};
+
+GeometryPool::GeometryPool(ID3D11Device* InDevice, UploadManager& InUploads)
+	: Device(InDevice), Uploads(InUploads)
+{}
+
+GeometryPool::~GeometryPool() = default;
+
+GeometryPool::Allocation GeometryPool::AllocateVertices(const DV::VertexLayout& InLayout, const void* InVertices, const size_t InSize)
+{
+	using Layout = DV::VertexLayout;
+
+	const auto Stride = static_cast<UINT>(InLayout.Size());
+	assert(Stride && InSize % Stride == 0u && "Vertex data is not a whole number of vertices");
+
+	const auto VertexNum = static_cast<UINT>(InSize / Stride);
+	const UINT StreamStrides[] = {static_cast<UINT>(InLayout.GetStreamStride(Layout::PositionStream)),
+	                              static_cast<UINT>(InLayout.GetStreamStride(Layout::AttributeStream))};
+	const auto NewAllocation = Allocate(InLayout.GetCode(), StreamStrides[Layout::PositionStream], StreamStrides[Layout::AttributeStream],
+	                                    D3D11_BIND_VERTEX_BUFFER, 0u, VertexNum);
+
+	ID3D11Buffer* const StreamBuffers[] = {NewAllocation.Buffer, NewAllocation.AttributeBuffer};
+	std::vector<char> StreamData;
+
+	for (UINT Stream = 0u; Stream < Layout::StreamNum; ++Stream)
+	{
+		if (!StreamStrides[Stream])
+		{
+			continue;
+		}
+
+		// Copied before the upload returns, so one scratch buffer serves both streams.
+		StreamData.resize(static_cast<size_t>(VertexNum) * StreamStrides[Stream]);
+		InLayout.CopyStream(Stream, InVertices, VertexNum, StreamData.data());
+		Uploads.UploadBuffer(StreamBuffers[Stream], NewAllocation.Offset * StreamStrides[Stream], StreamData.data(), VertexNum * StreamStrides[Stream]);
+	}
+
+	return NewAllocation;
+}
+
+GeometryPool::Allocation GeometryPool::AllocateIndices(const DXGI_FORMAT InFormat, const void* InIndices, const UINT InNum)
+{
+	assert((InFormat == DXGI_FORMAT_R16_UINT || InFormat == DXGI_FORMAT_R32_UINT) && "Index pages only hold 16 or 32 bit indices");
+
+	const UINT IndexSize = InFormat == DXGI_FORMAT_R16_UINT ? 2u : 4u;
+	const auto NewAllocation = Allocate(IndexSize == 2u ? "$index16" : "$index32", IndexSize, 0u, D3D11_BIND_INDEX_BUFFER | D3D11_BIND_SHADER_RESOURCE,
+	                                    D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS, InNum);
+
+	// Copied before this returns, the source may be a mapped cache or import storage that goes away before the next Flush.
+	Uploads.UploadBuffer(NewAllocation.Buffer, NewAllocation.Offset * IndexSize, InIndices, InNum * IndexSize);
+
+	return NewAllocation;
+}
+
+GeometryPool::Allocation GeometryPool::Allocate(const std::string& InKey, const UINT InElementSize, const UINT InAttributeSize, const UINT InBindFlags,
+                                                const UINT InMiscFlags, const UINT InNum)
+{
+	assert(InNum && "Empty geometry");
+
+	std::lock_guard Lock(Mutex);
+
+	Allocation NewAllocation;
+	NewAllocation.Num = InNum;
+
+	const auto FindRange = [&]
+	{
+		for (unsigned int PageIndex = 0u; PageIndex < Pages.size(); ++PageIndex)
+		{
+			if (auto& Target = *Pages[PageIndex]; Target.Key == InKey && Target.ElementSize == InElementSize && Target.AttributeSize == InAttributeSize)
+			{
+				if (const auto Offset = Target.Ranges.Allocate(InNum))
+				{
+					NewAllocation.Buffer = Target.Buffer.Get();
+					NewAllocation.AttributeBuffer = Target.AttributeBuffer.Get();
+					NewAllocation.Offset = *Offset;
+					NewAllocation.PageIndex = PageIndex;
+					NewAllocation.View = Target.View.Get();
+					return true;
+				}
+			}
+		}
+
+		return false;
+	};
+
+	if (!FindRange())
+	{
+		HRESULT ResultHandle;
+
+		const auto bIsRaw = (InMiscFlags & D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS) != 0u;
+		auto Capacity = std::max(PageBytes / (InElementSize + InAttributeSize), InNum);
+
+		// Raw views address whole 32 bit words.
+		if (bIsRaw)
+		{
+			Capacity = (Capacity * InElementSize + 3u) / 4u * 4u / InElementSize;
+		}
+
+		D3D11_BUFFER_DESC PageDesc {};
+		PageDesc.ByteWidth = Capacity * InElementSize;
+		PageDesc.Usage = D3D11_USAGE_DEFAULT;
+		PageDesc.BindFlags = InBindFlags;
+		PageDesc.MiscFlags = InMiscFlags;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> PageBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> AttributePageBuffer;
+
+		if (InElementSize)
+		{
+			CHECK_HRESULT_EXCEPTION(Device->CreateBuffer(&PageDesc, nullptr, &PageBuffer))
+		}
+
+		if (InAttributeSize)
+		{
+			D3D11_BUFFER_DESC AttributeDesc = PageDesc;
+			AttributeDesc.ByteWidth = Capacity * InAttributeSize;
+			CHECK_HRESULT_EXCEPTION(Device->CreateBuffer(&AttributeDesc, nullptr, &AttributePageBuffer))
+		}
+
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> PageView;
+
+		if (bIsRaw)
+		{
+			D3D11_SHADER_RESOURCE_VIEW_DESC ViewDesc {};
+			ViewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+			ViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+			ViewDesc.BufferEx.NumElements = PageDesc.ByteWidth / 4u;
+			ViewDesc.BufferEx.Flags = D3D11_BUFFEREX_SRV_FLAG_RAW;
+			CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(PageBuffer.Get(), &ViewDesc, &PageView))
+		}
+
+		Pages.push_back(std::make_unique<Page>(Page {InKey, InElementSize, InAttributeSize, std::move(PageBuffer), std::move(AttributePageBuffer),
+		                                             RangeAllocator(Capacity), std::move(PageView)}));
+
+		[[maybe_unused]] const auto bIsFound = FindRange();
+		assert(bIsFound);
+	}
+
+	return NewAllocation;
+}
+
+void GeometryPool::Free(const Allocation& InAllocation) noexcept
+{
+	if (!InAllocation.Buffer && !InAllocation.AttributeBuffer)
+	{
+		return;
+	}
+
+	std::lock_guard Lock(Mutex);
+	Pages[InAllocation.PageIndex]->Ranges.Free(InAllocation.Offset, InAllocation.Num);
+}
+
+unsigned int GeometryPool::GetPageNum() const noexcept
+{
+	std::lock_guard Lock(Mutex);
+	return static_cast<unsigned int>(Pages.size());
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "wrl/client.h"
+
+class UploadManager;
+
+namespace DV
+{
+	class VertexLayout;
+}
+
+/**
+ * Large shared vertex and index buffers that geometry sub-allocates from, drawn with a base vertex and start index.
+ * Vertices go to pages per layout code and indices to pages per format, so everything with the same layout and index
+ * format shares input assembler state until a page fills up and another one is opened. Vertex pages hold one buffer per stream
+ * of the layout with the same ranges in each, so one base vertex addresses the position and the attributes alike.
+ * Allocating is safe from loader threads, the data goes through UploadManager and is in place for the draws after its next Flush.
+ * Index pages can also be read as raw buffers, 16 bit ones hold two indices per 32 bit word.
+ */
+class GeometryPool
+{
+public:
+	// A page is at least this big, larger single allocations get a page of their own.
+	static constexpr UINT PageBytes {32u << 20u};
+
+	struct Allocation
+	{
+		// Of the index page, or the vertex page's position stream. Null for a stream the layout has no elements in.
+		ID3D11Buffer* Buffer {nullptr};
+		// The vertex page's attribute stream, everything but the position.
+		ID3D11Buffer* AttributeBuffer {nullptr};
+		// In vertices or indices from the start of the page.
+		UINT Offset {0u};
+		UINT Num {0u};
+		unsigned int PageIndex {0u};
+		// Raw view of the whole page for compute passes reading the geometry, index pages only.
+		ID3D11ShaderResourceView* View {nullptr};
+	};
+
+	GeometryPool(ID3D11Device* InDevice, UploadManager& InUploads);
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool(GeometryPool&&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+	GeometryPool& operator=(GeometryPool&&) = delete;
+	~GeometryPool();
+
+	[[nodiscard]] Allocation AllocateVertices(const DV::VertexLayout& InLayout, const void* InVertices, size_t InSize);
+	[[nodiscard]] Allocation AllocateIndices(DXGI_FORMAT InFormat, const void* InIndices, UINT InNum);
+	void Free(const Allocation& InAllocation) noexcept;
+
+	[[nodiscard]] unsigned int GetPageNum() const noexcept;
+
+private:
+	struct Page;
+
+	// The range is in place in every buffer of the page, its contents are the caller's to upload.
+	Allocation Allocate(const std::string& InKey, UINT InElementSize, UINT InAttributeSize, UINT InBindFlags, UINT InMiscFlags, UINT InNum);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> Device;
+	UploadManager& Uploads;
+	mutable std::mutex Mutex;
+	std::vector<std::unique_ptr<Page>> Pages;
+};
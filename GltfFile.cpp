@@ -0,0 +1,1144 @@
+﻿#include "GltfFile.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include "AssetArchive.h"
+#include "MappedFile.h"
+
+namespace
+{
+	constexpr unsigned int NoIndex {~0u};
+
+	constexpr unsigned int ComponentByte {5120u};
+	constexpr unsigned int ComponentUnsignedByte {5121u};
+	constexpr unsigned int ComponentShort {5122u};
+	constexpr unsigned int ComponentUnsignedShort {5123u};
+	constexpr unsigned int ComponentUnsignedInt {5125u};
+	constexpr unsigned int ComponentFloat {5126u};
+	constexpr unsigned int ModeTriangles {4u};
+
+	constexpr uint32_t GlbMagic {0x46546C67u};
+	constexpr uint32_t GlbJsonChunk {0x4E4F534Au};
+	constexpr uint32_t GlbBinaryChunk {0x004E4942u};
+
+	// Just enough of a JSON document model for glTF, objects keep their members in file order.
+	struct JsonValue
+	{
+		enum class Kind
+		{
+			Null,
+			Boolean,
+			Number,
+			String,
+			Array,
+			Object
+		};
+
+		[[nodiscard]] const JsonValue* Find(const std::string_view InKey) const noexcept
+		{
+			for (size_t Index = 0u; Index < Keys.size(); ++Index)
+			{
+				if (Keys[Index] == InKey)
+				{
+					return &Elements[Index];
+				}
+			}
+
+			return nullptr;
+		}
+
+		[[nodiscard]] double GetNumber(const std::string_view InKey, const double InDefault) const noexcept
+		{
+			const auto* Found = Find(InKey);
+			return Found && Found->Type == Kind::Number ? Found->Number : InDefault;
+		}
+
+		// NoIndex when missing or not a non-negative integer.
+		[[nodiscard]] unsigned int GetIndex(const std::string_view InKey) const noexcept
+		{
+			const auto* Found = Find(InKey);
+			return Found ? Found->AsIndex() : NoIndex;
+		}
+
+		[[nodiscard]] unsigned int AsIndex() const noexcept
+		{
+			if (Type != Kind::Number || Number < 0.0 || Number >= static_cast<double>(NoIndex) || Number != static_cast<double>(static_cast<unsigned int>(Number)))
+			{
+				return NoIndex;
+			}
+
+			return static_cast<unsigned int>(Number);
+		}
+
+		[[nodiscard]] std::string_view GetString(const std::string_view InKey) const noexcept
+		{
+			const auto* Found = Find(InKey);
+			return Found && Found->Type == Kind::String ? std::string_view(Found->String) : std::string_view();
+		}
+
+		[[nodiscard]] bool GetBoolean(const std::string_view InKey, const bool bInDefault) const noexcept
+		{
+			const auto* Found = Find(InKey);
+			return Found && Found->Type == Kind::Boolean ? Found->bBoolean : bInDefault;
+		}
+
+		// Elements of an array member, none when missing or not an array.
+		[[nodiscard]] const std::vector<JsonValue>& GetArray(const std::string_view InKey) const noexcept
+		{
+			static const std::vector<JsonValue> None;
+			const auto* Found = Find(InKey);
+			return Found && Found->Type == Kind::Array ? Found->Elements : None;
+		}
+
+		Kind Type {Kind::Null};
+		bool bBoolean {false};
+		double Number {0.0};
+		std::string String;
+		// Array elements, or object member values with their names in Keys.
+		std::vector<JsonValue> Elements;
+		std::vector<std::string> Keys;
+	};
+
+	class JsonParser
+	{
+	public:
+		explicit JsonParser(const std::string_view InText) noexcept
+			: Cursor(InText.data()), End(InText.data() + InText.size())
+		{
+		}
+
+		// False for anything but one well-formed value.
+		bool Parse(JsonValue& OutValue)
+		{
+			if (!ParseValue(OutValue, 0u))
+			{
+				return false;
+			}
+
+			SkipWhitespace();
+			return Cursor == End;
+		}
+
+	private:
+		static constexpr unsigned int MaxDepth {64u};
+
+		void SkipWhitespace() noexcept
+		{
+			while (Cursor != End && (*Cursor == ' ' || *Cursor == '\t' || *Cursor == '\n' || *Cursor == '\r'))
+			{
+				++Cursor;
+			}
+		}
+
+		bool Consume(const char InCharacter) noexcept
+		{
+			SkipWhitespace();
+
+			if (Cursor == End || *Cursor != InCharacter)
+			{
+				return false;
+			}
+
+			++Cursor;
+			return true;
+		}
+
+		bool ConsumeLiteral(const std::string_view InLiteral) noexcept
+		{
+			if (static_cast<size_t>(End - Cursor) < InLiteral.size() || std::string_view(Cursor, InLiteral.size()) != InLiteral)
+			{
+				return false;
+			}
+
+			Cursor += InLiteral.size();
+			return true;
+		}
+
+		bool ParseValue(JsonValue& OutValue, const unsigned int InDepth)
+		{
+			SkipWhitespace();
+
+			if (Cursor == End || InDepth > MaxDepth)
+			{
+				return false;
+			}
+
+			switch (*Cursor)
+			{
+			case '{':
+				return ParseObject(OutValue, InDepth);
+			case '[':
+				return ParseArray(OutValue, InDepth);
+			case '"':
+				OutValue.Type = JsonValue::Kind::String;
+				return ParseString(OutValue.String);
+			case 't':
+				OutValue.Type = JsonValue::Kind::Boolean;
+				OutValue.bBoolean = true;
+				return ConsumeLiteral("true");
+			case 'f':
+				OutValue.Type = JsonValue::Kind::Boolean;
+				return ConsumeLiteral("false");
+			case 'n':
+				return ConsumeLiteral("null");
+			default:
+				OutValue.Type = JsonValue::Kind::Number;
+				return ParseNumber(OutValue.Number);
+			}
+		}
+
+		bool ParseObject(JsonValue& OutValue, const unsigned int InDepth)
+		{
+			++Cursor;
+			OutValue.Type = JsonValue::Kind::Object;
+
+			if (Consume('}'))
+			{
+				return true;
+			}
+
+			do
+			{
+				SkipWhitespace();
+
+				if (Cursor == End || *Cursor != '"' || !ParseString(OutValue.Keys.emplace_back()) || !Consume(':') ||
+					!ParseValue(OutValue.Elements.emplace_back(), InDepth + 1u))
+				{
+					return false;
+				}
+			}
+			while (Consume(','));
+
+			return Consume('}');
+		}
+
+		bool ParseArray(JsonValue& OutValue, const unsigned int InDepth)
+		{
+			++Cursor;
+			OutValue.Type = JsonValue::Kind::Array;
+
+			if (Consume(']'))
+			{
+				return true;
+			}
+
+			do
+			{
+				if (!ParseValue(OutValue.Elements.emplace_back(), InDepth + 1u))
+				{
+					return false;
+				}
+			}
+			while (Consume(','));
+
+			return Consume(']');
+		}
+
+		bool ParseHex(uint32_t& OutCode) noexcept
+		{
+			if (End - Cursor < 4)
+			{
+				return false;
+			}
+
+			const auto [Last, Error] = std::from_chars(Cursor, Cursor + 4, OutCode, 16);
+			if (Error != std::errc() || Last != Cursor + 4)
+			{
+				return false;
+			}
+
+			Cursor += 4;
+			return true;
+		}
+
+		// At the opening quote, escapes are decoded to UTF-8.
+		bool ParseString(std::string& OutString)
+		{
+			++Cursor;
+
+			while (Cursor != End)
+			{
+				const auto Character = *Cursor++;
+
+				if (Character == '"')
+				{
+					return true;
+				}
+
+				if (static_cast<unsigned char>(Character) < 0x20u)
+				{
+					return false;
+				}
+
+				if (Character != '\\')
+				{
+					OutString.push_back(Character);
+					continue;
+				}
+
+				if (Cursor == End)
+				{
+					return false;
+				}
+
+				switch (const auto Escaped = *Cursor++)
+				{
+				case '"':
+				case '\\':
+				case '/':
+					OutString.push_back(Escaped);
+					break;
+				case 'b':
+					OutString.push_back('\b');
+					break;
+				case 'f':
+					OutString.push_back('\f');
+					break;
+				case 'n':
+					OutString.push_back('\n');
+					break;
+				case 'r':
+					OutString.push_back('\r');
+					break;
+				case 't':
+					OutString.push_back('\t');
+					break;
+				case 'u':
+				{
+					uint32_t Code;
+					if (!ParseHex(Code))
+					{
+						return false;
+					}
+
+					// A surrogate pair spans two escapes.
+					if (Code >= 0xD800u && Code < 0xDC00u)
+					{
+						uint32_t Low;
+						if (!ConsumeLiteral("\\u") || !ParseHex(Low) || Low < 0xDC00u || Low >= 0xE000u)
+						{
+							return false;
+						}
+
+						Code = 0x10000u + ((Code - 0xD800u) << 10u) + (Low - 0xDC00u);
+					}
+
+					if (Code < 0x80u)
+					{
+						OutString.push_back(static_cast<char>(Code));
+					}
+					else if (Code < 0x800u)
+					{
+						OutString.push_back(static_cast<char>(0xC0u | Code >> 6u));
+						OutString.push_back(static_cast<char>(0x80u | (Code & 0x3Fu)));
+					}
+					else if (Code < 0x10000u)
+					{
+						OutString.push_back(static_cast<char>(0xE0u | Code >> 12u));
+						OutString.push_back(static_cast<char>(0x80u | (Code >> 6u & 0x3Fu)));
+						OutString.push_back(static_cast<char>(0x80u | (Code & 0x3Fu)));
+					}
+					else
+					{
+						OutString.push_back(static_cast<char>(0xF0u | Code >> 18u));
+						OutString.push_back(static_cast<char>(0x80u | (Code >> 12u & 0x3Fu)));
+						OutString.push_back(static_cast<char>(0x80u | (Code >> 6u & 0x3Fu)));
+						OutString.push_back(static_cast<char>(0x80u | (Code & 0x3Fu)));
+					}
+
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+
+			return false;
+		}
+
+		bool ParseNumber(double& OutNumber) noexcept
+		{
+			const auto [Last, Error] = std::from_chars(Cursor, End, OutNumber);
+			if (Error != std::errc() || Last == Cursor)
+			{
+				return false;
+			}
+
+			Cursor = Last;
+			return true;
+		}
+
+	private:
+		const char* Cursor;
+		const char* End;
+	};
+
+	bool DecodeBase64(const std::string_view InText, std::vector<std::byte>& OutBytes)
+	{
+		const auto Decode = [](const char InCharacter) -> int
+		{
+			if (InCharacter >= 'A' && InCharacter <= 'Z')
+			{
+				return InCharacter - 'A';
+			}
+
+			if (InCharacter >= 'a' && InCharacter <= 'z')
+			{
+				return InCharacter - 'a' + 26;
+			}
+
+			if (InCharacter >= '0' && InCharacter <= '9')
+			{
+				return InCharacter - '0' + 52;
+			}
+
+			return InCharacter == '+' ? 62 : InCharacter == '/' ? 63 : -1;
+		};
+
+		auto Text = InText;
+		while (!Text.empty() && Text.back() == '=')
+		{
+			Text.remove_suffix(1u);
+		}
+
+		OutBytes.clear();
+		OutBytes.reserve(Text.size() * 3u / 4u);
+		uint32_t Bits = 0u;
+		unsigned int BitNum = 0u;
+
+		for (const auto Character : Text)
+		{
+			const auto Value = Decode(Character);
+			if (Value < 0)
+			{
+				return false;
+			}
+
+			Bits = Bits << 6u | static_cast<uint32_t>(Value);
+			BitNum += 6u;
+
+			if (BitNum >= 8u)
+			{
+				BitNum -= 8u;
+				OutBytes.push_back(static_cast<std::byte>(Bits >> BitNum & 0xFFu));
+			}
+		}
+
+		return true;
+	}
+
+	// Relative URIs escape what isn't allowed in them, file names are stored unescaped.
+	std::string DecodeUri(const std::string_view InUri)
+	{
+		std::string Decoded;
+		Decoded.reserve(InUri.size());
+
+		for (size_t Index = 0u; Index < InUri.size(); ++Index)
+		{
+			uint32_t Code;
+
+			if (InUri[Index] == '%' && Index + 2u < InUri.size() &&
+				std::from_chars(InUri.data() + Index + 1u, InUri.data() + Index + 3u, Code, 16).ptr == InUri.data() + Index + 3u)
+			{
+				Decoded.push_back(static_cast<char>(Code));
+				Index += 2u;
+				continue;
+			}
+
+			Decoded.push_back(InUri[Index]);
+		}
+
+		return Decoded;
+	}
+
+	std::filesystem::path ToPath(const std::string& InUtf8)
+	{
+		return std::filesystem::path(std::u8string(InUtf8.begin(), InUtf8.end()));
+	}
+
+	size_t GetComponentSize(const unsigned int InComponentType) noexcept
+	{
+		switch (InComponentType)
+		{
+		case ComponentByte:
+		case ComponentUnsignedByte:
+			return 1u;
+		case ComponentShort:
+		case ComponentUnsignedShort:
+			return 2u;
+		case ComponentUnsignedInt:
+		case ComponentFloat:
+			return 4u;
+		default:
+			return 0u;
+		}
+	}
+
+	unsigned int GetComponentNum(const std::string_view InType) noexcept
+	{
+		if (InType == "SCALAR")
+		{
+			return 1u;
+		}
+
+		if (InType.size() == 4u && InType.starts_with("VEC") && InType[3] >= '2' && InType[3] <= '4')
+		{
+			return static_cast<unsigned int>(InType[3] - '0');
+		}
+
+		return 0u;
+	}
+
+	struct BufferView
+	{
+		const std::byte* Data;
+		size_t Size;
+		size_t Stride;
+	};
+
+	// Everything a primitive refers to is looked up and bounds-checked here.
+	class Document
+	{
+	public:
+		Document(const JsonValue& InRoot, std::vector<std::pair<const std::byte*, size_t>> InBuffers)
+			: Root(InRoot)
+		{
+			for (const auto& View : InRoot.GetArray("bufferViews"))
+			{
+				const auto Buffer = View.GetIndex("buffer");
+				const auto Offset = View.GetNumber("byteOffset", 0.0);
+				const auto Size = View.GetNumber("byteLength", -1.0);
+				const auto Stride = View.GetNumber("byteStride", 0.0);
+
+				if (Buffer >= InBuffers.size() || Offset < 0.0 || Size < 0.0 || Offset + Size > static_cast<double>(InBuffers[Buffer].second) ||
+					Stride < 0.0 || Stride > 252.0)
+				{
+					bIsValid = false;
+					return;
+				}
+
+				BufferViews.push_back({InBuffers[Buffer].first + static_cast<size_t>(Offset), static_cast<size_t>(Size), static_cast<size_t>(Stride)});
+			}
+		}
+
+		[[nodiscard]] bool IsValid() const noexcept
+		{
+			return bIsValid;
+		}
+
+		// Empty views for NoIndex, false for anything out of range or of another type.
+		bool GetAccessor(const unsigned int InIndex, const std::initializer_list<unsigned int> InComponentTypes, const unsigned int InComponentNum,
+		                 GltfFile::AccessorView& OutView) const
+		{
+			OutView = {};
+
+			if (InIndex == NoIndex)
+			{
+				return true;
+			}
+
+			const auto& Accessors = Root.GetArray("accessors");
+			if (InIndex >= Accessors.size())
+			{
+				return false;
+			}
+
+			const auto& Accessor = Accessors[InIndex];
+			const auto ViewIndex = Accessor.GetIndex("bufferView");
+			const auto Offset = Accessor.GetNumber("byteOffset", 0.0);
+			const auto Num = Accessor.GetIndex("count");
+
+			OutView.ComponentType = Accessor.GetIndex("componentType");
+			OutView.ComponentNum = GetComponentNum(Accessor.GetString("type"));
+			OutView.bIsNormalized = Accessor.GetBoolean("normalized", false);
+
+			if (Accessor.Find("sparse") || ViewIndex >= BufferViews.size() || Offset < 0.0 || Offset > static_cast<double>(BufferViews[ViewIndex].Size) ||
+				Num == NoIndex || OutView.ComponentNum != InComponentNum ||
+				std::find(InComponentTypes.begin(), InComponentTypes.end(), OutView.ComponentType) == InComponentTypes.end())
+			{
+				return false;
+			}
+
+			const auto& View = BufferViews[ViewIndex];
+			const auto ElementSize = GetComponentSize(OutView.ComponentType) * OutView.ComponentNum;
+			OutView.Stride = View.Stride ? View.Stride : ElementSize;
+			OutView.Num = Num;
+
+			if (Num > 0u && static_cast<size_t>(Offset) + OutView.Stride * (Num - 1u) + ElementSize > View.Size)
+			{
+				return false;
+			}
+
+			OutView.Data = View.Data + static_cast<size_t>(Offset);
+			return true;
+		}
+
+		// The image's file name, empty for a missing texture or one embedded in the file.
+		[[nodiscard]] std::string GetTextureFileName(const JsonValue* InTextureInfo) const
+		{
+			if (!InTextureInfo)
+			{
+				return {};
+			}
+
+			const auto& Textures = Root.GetArray("textures");
+			const auto& Images = Root.GetArray("images");
+			const auto Texture = InTextureInfo->GetIndex("index");
+
+			if (Texture >= Textures.size())
+			{
+				return {};
+			}
+
+			const auto Image = Textures[Texture].GetIndex("source");
+			if (Image >= Images.size())
+			{
+				return {};
+			}
+
+			const auto Uri = Images[Image].GetString("uri");
+			return Uri.empty() || Uri.starts_with("data:") ? std::string() : DecodeUri(Uri);
+		}
+
+	private:
+		const JsonValue& Root;
+		std::vector<BufferView> BufferViews;
+		bool bIsValid {true};
+	};
+
+	// Fields the Assimp import would take from the same material, shininess the way its glTF importer derives it from roughness.
+	void ReadMaterial(const Document& InDocument, const JsonValue* InMaterial, MeshCache::MeshEntry& OutMesh)
+	{
+		if (!InMaterial)
+		{
+			return;
+		}
+
+		OutMesh.MaterialName = InMaterial->GetString("name");
+		OutMesh.bIsTwoSided = InMaterial->GetBoolean("doubleSided", false);
+		OutMesh.bIsAlphaTested = InMaterial->GetString("alphaMode") == "MASK";
+		OutMesh.NormalMap = InDocument.GetTextureFileName(InMaterial->Find("normalTexture"));
+
+		if (const auto* Pbr = InMaterial->Find("pbrMetallicRoughness"))
+		{
+			OutMesh.DiffuseMap = InDocument.GetTextureFileName(Pbr->Find("baseColorTexture"));
+
+			if (Pbr->Find("roughnessFactor"))
+			{
+				const auto Smoothness = 1.0 - Pbr->GetNumber("roughnessFactor", 1.0);
+				OutMesh.Shininess = static_cast<float>(Smoothness * Smoothness * 1000.0);
+			}
+
+			if (const auto& BaseColor = Pbr->GetArray("baseColorFactor"); BaseColor.size() == 4u && InMaterial->GetString("alphaMode") == "BLEND")
+			{
+				OutMesh.Opacity = static_cast<float>(BaseColor[3].Number);
+			}
+		}
+	}
+
+	bool ReadPrimitive(const Document& InDocument, const JsonValue& InRoot, const JsonValue& InPrimitive, GltfFile::Primitive& OutPrimitive)
+	{
+		if (InPrimitive.GetNumber("mode", static_cast<double>(ModeTriangles)) != static_cast<double>(ModeTriangles))
+		{
+			return false;
+		}
+
+		const auto& Materials = InRoot.GetArray("materials");
+		const auto MaterialIndex = InPrimitive.GetIndex("material");
+		ReadMaterial(InDocument, MaterialIndex < Materials.size() ? &Materials[MaterialIndex] : nullptr, OutPrimitive.Mesh);
+
+		const auto* Attributes = InPrimitive.Find("attributes");
+		if (!Attributes)
+		{
+			return false;
+		}
+
+		if (!InDocument.GetAccessor(Attributes->GetIndex("POSITION"), {ComponentFloat}, 3u, OutPrimitive.Positions) ||
+			!InDocument.GetAccessor(Attributes->GetIndex("NORMAL"), {ComponentFloat}, 3u, OutPrimitive.Normals) ||
+			!InDocument.GetAccessor(Attributes->GetIndex("TANGENT"), {ComponentFloat}, 4u, OutPrimitive.Tangents) ||
+			!InDocument.GetAccessor(Attributes->GetIndex("TEXCOORD_0"), {ComponentFloat, ComponentUnsignedByte, ComponentUnsignedShort}, 2u,
+			                        OutPrimitive.Texcoords) ||
+			!InDocument.GetAccessor(InPrimitive.GetIndex("indices"), {ComponentUnsignedByte, ComponentUnsignedShort, ComponentUnsignedInt}, 1u,
+			                        OutPrimitive.Indices))
+		{
+			return false;
+		}
+
+		const auto VertexNum = OutPrimitive.Positions.Num;
+
+		// Integer coordinates are only texture coordinates when normalized.
+		if (!OutPrimitive.Texcoords.IsEmpty() && OutPrimitive.Texcoords.ComponentType != ComponentFloat && !OutPrimitive.Texcoords.bIsNormalized)
+		{
+			return false;
+		}
+
+		// Maps without coordinates to sample them with would pick a layout the vertices can't fill.
+		if (OutPrimitive.Texcoords.Num != VertexNum)
+		{
+			OutPrimitive.Mesh.DiffuseMap.clear();
+			OutPrimitive.Mesh.NormalMap.clear();
+			OutPrimitive.Texcoords = {};
+		}
+
+		// Assimp generates what is missing, this path only reads.
+		if (VertexNum == 0u || OutPrimitive.Normals.Num != VertexNum ||
+			(!OutPrimitive.Mesh.NormalMap.empty() && OutPrimitive.Tangents.Num != VertexNum))
+		{
+			return false;
+		}
+
+		if (OutPrimitive.Mesh.NormalMap.empty())
+		{
+			OutPrimitive.Tangents = {};
+		}
+
+		const auto& Indices = OutPrimitive.Indices;
+		if ((Indices.IsEmpty() ? VertexNum : Indices.Num) % 3u != 0u)
+		{
+			return false;
+		}
+
+		for (size_t Index = 0u; Index < Indices.Num; ++Index)
+		{
+			if (Indices.LoadIndex(Index) >= VertexNum)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	DirectX::XMMATRIX ReadNodeTransform(const JsonValue& InNode)
+	{
+		// Column-major with column vectors, which is the row-major row vector matrix DirectXMath uses.
+		if (const auto& Matrix = InNode.GetArray("matrix"); Matrix.size() == 16u)
+		{
+			DirectX::XMFLOAT4X4 Transform;
+
+			for (size_t Index = 0u; Index < 16u; ++Index)
+			{
+				Transform.m[Index / 4u][Index % 4u] = static_cast<float>(Matrix[Index].Number);
+			}
+
+			return DirectX::XMLoadFloat4x4(&Transform);
+		}
+
+		const auto LoadVector = [&InNode](const std::string_view InKey, DirectX::FXMVECTOR InDefault)
+		{
+			const auto& Values = InNode.GetArray(InKey);
+			if (Values.size() < 3u)
+			{
+				return InDefault;
+			}
+
+			return DirectX::XMVectorSet(static_cast<float>(Values[0].Number), static_cast<float>(Values[1].Number), static_cast<float>(Values[2].Number),
+			                            Values.size() > 3u ? static_cast<float>(Values[3].Number) : 0.0f);
+		};
+
+		return DirectX::XMMatrixScalingFromVector(LoadVector("scale", DirectX::XMVectorSplatOne())) *
+		       DirectX::XMMatrixRotationQuaternion(DirectX::XMQuaternionNormalize(LoadVector("rotation", DirectX::XMQuaternionIdentity()))) *
+		       DirectX::XMMatrixTranslationFromVector(LoadVector("translation", DirectX::XMVectorZero()));
+	}
+
+	struct NodeContext
+	{
+		const std::vector<JsonValue>& Nodes;
+		// Primitives of glTF mesh N are [PrimitiveOffsets[N], PrimitiveOffsets[N + 1]).
+		const std::vector<unsigned int>& PrimitiveOffsets;
+		std::vector<bool> bIsVisited;
+	};
+
+	// Converted the way Assimp's left-handed conversion does, mirrored on Z on both sides.
+	void StoreNodeTransform(DirectX::FXMMATRIX InTransform, MeshCache::NodeEntry& OutEntry)
+	{
+		const auto Mirror = DirectX::XMMatrixScaling(1.0f, 1.0f, -1.0f);
+		DirectX::XMStoreFloat4x4(&OutEntry.Transform, Mirror * InTransform * Mirror);
+	}
+
+	// False for a node that is out of range or reached twice, the nodes have to form trees.
+	bool FlattenNode(const unsigned int InIndex, NodeContext& InContext, MeshCache::NodeList& OutNodes)
+	{
+		if (InIndex >= InContext.Nodes.size() || InContext.bIsVisited[InIndex])
+		{
+			return false;
+		}
+
+		InContext.bIsVisited[InIndex] = true;
+		const auto& Node = InContext.Nodes[InIndex];
+		const auto& Children = Node.GetArray("children");
+
+		{
+			auto& Entry = OutNodes.emplace_back();
+			Entry.Name = Node.GetString("name");
+			if (Entry.Name.empty())
+			{
+				Entry.Name = "node" + std::to_string(InIndex);
+			}
+
+			StoreNodeTransform(ReadNodeTransform(Node), Entry);
+			Entry.ChildNum = static_cast<unsigned int>(Children.size());
+
+			if (const auto MeshIndex = Node.GetIndex("mesh"); MeshIndex != NoIndex)
+			{
+				if (MeshIndex + 1u >= InContext.PrimitiveOffsets.size())
+				{
+					return false;
+				}
+
+				for (auto Primitive = InContext.PrimitiveOffsets[MeshIndex]; Primitive < InContext.PrimitiveOffsets[MeshIndex + 1u]; ++Primitive)
+				{
+					Entry.MeshIndices.push_back(Primitive);
+				}
+			}
+		}
+
+		for (const auto& Child : Children)
+		{
+			if (!FlattenNode(Child.AsIndex(), InContext, OutNodes))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// The JSON and, for a .glb, its binary chunk.
+	bool SplitGlb(const std::byte* InData, const size_t InSize, std::string_view& OutJson, std::pair<const std::byte*, size_t>& OutBinary)
+	{
+		uint32_t Header[3];
+		if (InSize < sizeof(Header))
+		{
+			return false;
+		}
+
+		memcpy(Header, InData, sizeof(Header));
+		if (Header[0] != GlbMagic || Header[1] != 2u || Header[2] > InSize)
+		{
+			return false;
+		}
+
+		auto Offset = sizeof(Header);
+
+		while (Offset + 8u <= Header[2])
+		{
+			uint32_t Chunk[2];
+			memcpy(Chunk, InData + Offset, sizeof(Chunk));
+			Offset += sizeof(Chunk);
+
+			if (Chunk[0] > Header[2] - Offset)
+			{
+				return false;
+			}
+
+			if (Chunk[1] == GlbJsonChunk && OutJson.empty())
+			{
+				OutJson = std::string_view(reinterpret_cast<const char*>(InData + Offset), Chunk[0]);
+			}
+			else if (Chunk[1] == GlbBinaryChunk && !OutBinary.first)
+			{
+				OutBinary = {InData + Offset, Chunk[0]};
+			}
+
+			Offset += Chunk[0];
+		}
+
+		return !OutJson.empty();
+	}
+}
+
+DirectX::XMVECTOR GltfFile::AccessorView::Load(const size_t InIndex) const noexcept
+{
+	const auto* Element = Data + InIndex * Stride;
+	std::array<float, 4u> Values {};
+
+	for (unsigned int Component = 0u; Component < ComponentNum; ++Component)
+	{
+		auto& Value = Values[Component];
+
+		switch (ComponentType)
+		{
+		case ComponentFloat:
+			memcpy(&Value, Element + Component * 4u, 4u);
+			break;
+		case ComponentUnsignedByte:
+			Value = static_cast<float>(static_cast<uint8_t>(Element[Component])) / (bIsNormalized ? 255.0f : 1.0f);
+			break;
+		case ComponentByte:
+			Value = static_cast<float>(static_cast<int8_t>(Element[Component]));
+			Value = bIsNormalized ? std::max(Value / 127.0f, -1.0f) : Value;
+			break;
+		case ComponentUnsignedShort:
+		{
+			uint16_t Short;
+			memcpy(&Short, Element + Component * 2u, 2u);
+			Value = static_cast<float>(Short) / (bIsNormalized ? 65535.0f : 1.0f);
+			break;
+		}
+		case ComponentShort:
+		{
+			int16_t Short;
+			memcpy(&Short, Element + Component * 2u, 2u);
+			Value = static_cast<float>(Short);
+			Value = bIsNormalized ? std::max(Value / 32767.0f, -1.0f) : Value;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	return DirectX::XMVectorSet(Values[0], Values[1], Values[2], Values[3]);
+}
+
+unsigned int GltfFile::AccessorView::LoadIndex(const size_t InIndex) const noexcept
+{
+	const auto* Element = Data + InIndex * Stride;
+
+	switch (ComponentType)
+	{
+	case ComponentUnsignedByte:
+		return static_cast<uint8_t>(*Element);
+	case ComponentUnsignedShort:
+	{
+		uint16_t Index;
+		memcpy(&Index, Element, sizeof(Index));
+		return Index;
+	}
+	default:
+	{
+		uint32_t Index;
+		memcpy(&Index, Element, sizeof(Index));
+		return Index;
+	}
+	}
+}
+
+GltfFile::~GltfFile() = default;
+
+std::unique_ptr<GltfFile> GltfFile::Open(const std::filesystem::path& InPath)
+{
+	std::unique_ptr<GltfFile> File {new GltfFile};
+
+	// Loose files are mapped, archived ones decompressed once, either way they stay alive as long as the views into them.
+	const auto LoadFile = [&File](const std::filesystem::path& InFilePath) -> std::pair<const std::byte*, size_t>
+	{
+		if (AssetArchive::Get().Contains(InFilePath))
+		{
+			// Moving the outer vector as it grows keeps every inner buffer where it is.
+			auto& Bytes = File->DecodedBuffers.emplace_back();
+			if (!AssetArchive::Get().Read(InFilePath, Bytes) || Bytes.empty())
+			{
+				return {nullptr, 0u};
+			}
+
+			return {Bytes.data(), Bytes.size()};
+		}
+
+		const auto& Mapping = *File->Mappings.emplace_back(std::make_unique<MappedFile>(InFilePath));
+		return {Mapping.GetData(), Mapping.GetSize()};
+	};
+
+	const auto Source = LoadFile(InPath);
+	if (!Source.first)
+	{
+		return nullptr;
+	}
+
+	// A .glb starts with its magic, anything else is taken for the JSON of a .gltf.
+	std::string_view Json;
+	std::pair<const std::byte*, size_t> GlbBinary {nullptr, 0u};
+	uint32_t Magic = 0u;
+	memcpy(&Magic, Source.first, std::min(Source.second, sizeof(Magic)));
+
+	if (Magic == GlbMagic)
+	{
+		if (!SplitGlb(Source.first, Source.second, Json, GlbBinary))
+		{
+			return nullptr;
+		}
+	}
+	else
+	{
+		Json = std::string_view(reinterpret_cast<const char*>(Source.first), Source.second);
+	}
+
+	// A byte order mark isn't allowed, some exporters write one anyway.
+	if (Json.starts_with("\xEF\xBB\xBF"))
+	{
+		Json.remove_prefix(3u);
+	}
+
+	JsonValue Root;
+	if (!JsonParser(Json).Parse(Root) || Root.Type != JsonValue::Kind::Object || !Root.Find("asset") || Root.Find("asset")->GetString("version") != "2.0")
+	{
+		return nullptr;
+	}
+
+	// Compressed or otherwise extended geometry, bones and animations are Assimp's to import.
+	if (!Root.GetArray("extensionsRequired").empty() || !Root.GetArray("skins").empty() || !Root.GetArray("animations").empty())
+	{
+		return nullptr;
+	}
+
+	std::vector<std::pair<const std::byte*, size_t>> Buffers;
+	const auto& BufferEntries = Root.GetArray("buffers");
+
+	for (size_t Index = 0u; Index < BufferEntries.size(); ++Index)
+	{
+		const auto& Entry = BufferEntries[Index];
+		const auto Size = Entry.GetNumber("byteLength", -1.0);
+		const auto Uri = Entry.GetString("uri");
+		std::pair<const std::byte*, size_t> Buffer {nullptr, 0u};
+
+		if (Uri.empty())
+		{
+			// Only the first buffer of a .glb can be its binary chunk.
+			if (Index != 0u || !GlbBinary.first)
+			{
+				return nullptr;
+			}
+
+			Buffer = GlbBinary;
+		}
+		else if (Uri.starts_with("data:"))
+		{
+			const auto Separator = Uri.find(";base64,");
+			auto& Decoded = File->DecodedBuffers.emplace_back();
+
+			if (Separator == std::string_view::npos || !DecodeBase64(Uri.substr(Separator + 8u), Decoded))
+			{
+				return nullptr;
+			}
+
+			Buffer = {Decoded.data(), Decoded.size()};
+		}
+		else
+		{
+			Buffer = LoadFile(InPath.parent_path() / ToPath(DecodeUri(Uri)));
+			if (!Buffer.first)
+			{
+				return nullptr;
+			}
+		}
+
+		if (Size < 0.0 || Size > static_cast<double>(Buffer.second))
+		{
+			return nullptr;
+		}
+
+		Buffers.emplace_back(Buffer.first, static_cast<size_t>(Size));
+	}
+
+	const Document SourceDocument(Root, std::move(Buffers));
+	if (!SourceDocument.IsValid())
+	{
+		return nullptr;
+	}
+
+	// Names tag the GPU buffers, so every primitive gets its own: the mesh's, numbered after it when it has several.
+	const auto& Meshes = Root.GetArray("meshes");
+	std::vector<unsigned int> PrimitiveOffsets {0u};
+	std::unordered_set<std::string> UsedNames;
+
+	for (size_t MeshIndex = 0u; MeshIndex < Meshes.size(); ++MeshIndex)
+	{
+		const auto& Primitives = Meshes[MeshIndex].GetArray("primitives");
+		auto MeshName = std::string(Meshes[MeshIndex].GetString("name"));
+
+		if (MeshName.empty())
+		{
+			MeshName = "mesh" + std::to_string(MeshIndex);
+		}
+
+		for (size_t PrimitiveIndex = 0u; PrimitiveIndex < Primitives.size(); ++PrimitiveIndex)
+		{
+			auto& Added = File->Primitives.emplace_back();
+			if (!ReadPrimitive(SourceDocument, Root, Primitives[PrimitiveIndex], Added))
+			{
+				return nullptr;
+			}
+
+			Added.Mesh.Name = Primitives.size() > 1u ? MeshName + "-" + std::to_string(PrimitiveIndex) : MeshName;
+
+			while (!UsedNames.insert(Added.Mesh.Name).second)
+			{
+				Added.Mesh.Name += "#" + std::to_string(MeshIndex);
+			}
+		}
+
+		PrimitiveOffsets.push_back(static_cast<unsigned int>(File->Primitives.size()));
+	}
+
+	// The scene's roots, every node without a parent when the file names no scene.
+	const auto& SourceNodes = Root.GetArray("nodes");
+	std::vector<unsigned int> Roots;
+
+	if (const auto& Scenes = Root.GetArray("scenes"); !Scenes.empty())
+	{
+		const auto Scene = Root.Find("scene") ? Root.GetIndex("scene") : 0u;
+		if (Scene >= Scenes.size())
+		{
+			return nullptr;
+		}
+
+		for (const auto& Node : Scenes[Scene].GetArray("nodes"))
+		{
+			Roots.push_back(Node.AsIndex());
+		}
+	}
+	else
+	{
+		std::vector<bool> bIsChild(SourceNodes.size(), false);
+
+		for (const auto& Node : SourceNodes)
+		{
+			for (const auto& Child : Node.GetArray("children"))
+			{
+				if (const auto ChildIndex = Child.AsIndex(); ChildIndex < bIsChild.size())
+				{
+					bIsChild[ChildIndex] = true;
+				}
+			}
+		}
+
+		for (unsigned int Index = 0u; Index < SourceNodes.size(); ++Index)
+		{
+			if (!bIsChild[Index])
+			{
+				Roots.push_back(Index);
+			}
+		}
+	}
+
+	if (Roots.empty())
+	{
+		return nullptr;
+	}
+
+	NodeContext Context {SourceNodes, PrimitiveOffsets, std::vector<bool>(SourceNodes.size(), false)};
+
+	// One root is the hierarchy's root as it is, several hang off an added one as Assimp's glTF importer does.
+	if (Roots.size() > 1u)
+	{
+		auto& Entry = File->Nodes.emplace_back();
+		Entry.Name = "ROOT";
+		StoreNodeTransform(DirectX::XMMatrixIdentity(), Entry);
+		Entry.ChildNum = static_cast<unsigned int>(Roots.size());
+	}
+
+	for (const auto RootIndex : Roots)
+	{
+		if (!FlattenNode(RootIndex, Context, File->Nodes))
+		{
+			return nullptr;
+		}
+	}
+
+	return File;
+}
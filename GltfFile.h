@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <cstddef>
+#include <DirectXMath.h>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include "MeshCache.h"
+
+class MappedFile;
+
+/**
+ * glTF 2.0 models read without going through Assimp, a .gltf with its buffers or a single .glb.
+ * Binary buffers are memory-mapped, or decoded once when embedded as base64 or packed in the asset archive, and every accessor is a strided view straight into them,
+ * so a primitive's attributes are encoded into the engine's vertex layouts in one pass over the file's own bytes.
+ * Nodes come out in the engine's left-handed space like the Assimp import's, accessors stay as stored and are mirrored on Z when read.
+ */
+class GltfFile
+{
+public:
+	// Elements of one accessor, inside the buffer it was read from.
+	struct AccessorView
+	{
+		const std::byte* Data {nullptr};
+		size_t Stride {0u};
+		size_t Num {0u};
+		// As in the file, 5120 through 5126.
+		unsigned int ComponentType {0u};
+		unsigned int ComponentNum {0u};
+		bool bIsNormalized {false};
+
+		[[nodiscard]] bool IsEmpty() const noexcept
+		{
+			return Num == 0u;
+		}
+
+		// Unused components are zero, normalized integers map to [0, 1] or [-1, 1].
+		[[nodiscard]] DirectX::XMVECTOR Load(size_t InIndex) const noexcept;
+		[[nodiscard]] unsigned int LoadIndex(size_t InIndex) const noexcept;
+	};
+
+	// One triangle list with one material, what the engine draws as a mesh.
+	struct Primitive
+	{
+		// Name and material filled in, the geometry is left to whoever encodes the views.
+		MeshCache::MeshEntry Mesh;
+		AccessorView Positions;
+		AccessorView Normals;
+		// XYZ and the bitangent sign in W, empty unless the material is normal mapped.
+		AccessorView Tangents;
+		// Empty when the material has no maps.
+		AccessorView Texcoords;
+		// Empty for primitives that draw their vertices in order.
+		AccessorView Indices;
+	};
+
+	GltfFile(const GltfFile&) = delete;
+	GltfFile(GltfFile&&) = delete;
+	GltfFile& operator=(const GltfFile&) = delete;
+	GltfFile& operator=(GltfFile&&) = delete;
+	~GltfFile();
+
+	/**
+	 * Returns null when the file can't be read or needs what only the Assimp import does: skins, animations, sparse accessors,
+	 * required extensions such as compressed meshes, primitives other than triangle lists and normals or tangents to generate.
+	 */
+	[[nodiscard]] static std::unique_ptr<GltfFile> Open(const std::filesystem::path& InPath);
+
+	[[nodiscard]] const std::vector<Primitive>& GetPrimitives() const noexcept
+	{
+		return Primitives;
+	}
+
+	// Mesh indices of the nodes are into GetPrimitives.
+	[[nodiscard]] const MeshCache::NodeList& GetNodes() const noexcept
+	{
+		return Nodes;
+	}
+
+private:
+	GltfFile() = default;
+
+private:
+	std::vector<std::unique_ptr<MappedFile>> Mappings;
+	// Base64 buffers and files read out of the asset archive.
+	std::vector<std::vector<std::byte>> DecodedBuffers;
+	std::vector<Primitive> Primitives;
+	MeshCache::NodeList Nodes;
+};
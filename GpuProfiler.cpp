@@ -0,0 +1,417 @@
+﻿#include "GpuProfiler.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <initializer_list>
+#include <thread>
+#include "DXGIInfoManager.h"
+#include "ExceptionMacros.h"
+#include "imgui/imgui.h"
+
+namespace
+{
+	// Scope names are ASCII literals, the annotation interface only takes wide strings.
+	void BeginEvent(ID3DUserDefinedAnnotation* InAnnotation, const char* InName) noexcept
+	{
+		std::array<wchar_t, 64u> Name;
+		size_t Length = 0u;
+
+		for (; InName[Length] && Length + 1u < Name.size(); ++Length)
+		{
+			Name[Length] = static_cast<wchar_t>(InName[Length]);
+		}
+
+		Name[Length] = L'\0';
+		InAnnotation->BeginEvent(Name.data());
+	}
+}
+
+GpuProfiler::Scope::Scope(GpuProfiler& InProfiler, const char* InName) noexcept
+	: Profiler(InProfiler)
+{
+	Profiler.BeginScope(InName);
+}
+
+GpuProfiler::Scope::~Scope()
+{
+	Profiler.EndScope();
+}
+
+GpuProfiler::GpuProfiler(ID3D11Device* InDevice, ID3D11DeviceContext* InContext)
+	: Context(InContext)
+{
+	assert(Context);
+
+	HRESULT ResultHandle;
+
+	D3D11_QUERY_DESC DisjointDesc {};
+	DisjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+
+	D3D11_QUERY_DESC TimestampDesc {};
+	TimestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+
+	D3D11_QUERY_DESC StatisticsDesc {};
+	StatisticsDesc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+
+	for (auto& Frame : Frames)
+	{
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateQuery(&DisjointDesc, &Frame.Disjoint))
+
+		for (auto& Scope : Frame.Scopes)
+		{
+			CHECK_HRESULT_EXCEPTION(InDevice->CreateQuery(&TimestampDesc, &Scope.Begin))
+			CHECK_HRESULT_EXCEPTION(InDevice->CreateQuery(&TimestampDesc, &Scope.End))
+			CHECK_HRESULT_EXCEPTION(InDevice->CreateQuery(&StatisticsDesc, &Scope.Statistics))
+		}
+	}
+
+	for (auto& Timings : History)
+	{
+		Timings.reserve(MaxScopeNum);
+	}
+
+	PendingTimings.reserve(MaxScopeNum);
+	LastStatistics.reserve(MaxScopeNum);
+	PendingStatistics.reserve(MaxScopeNum);
+
+#if PROFILE_MARKERS_ENABLED
+	Context->QueryInterface(IID_PPV_ARGS(&Annotation));
+#endif
+
+	Calibrate(InDevice);
+}
+
+void GpuProfiler::Calibrate(ID3D11Device* InDevice)
+{
+	HRESULT ResultHandle;
+
+	D3D11_QUERY_DESC TimestampDesc {};
+	TimestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+
+	Microsoft::WRL::ComPtr<ID3D11Query> Timestamp;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateQuery(&TimestampDesc, &Timestamp))
+
+	// Nothing else is queued yet, so the timestamp is taken about as soon as it is flushed.
+	const auto Issued = FrameProfiler::Clock::now();
+	Context->Begin(Frames[0].Disjoint.Get());
+	Context->End(Timestamp.Get());
+	Context->End(Frames[0].Disjoint.Get());
+
+	while ((ResultHandle = Context->GetData(Timestamp.Get(), &CalibrationTick, sizeof(CalibrationTick), 0u)) == S_FALSE)
+	{
+		std::this_thread::yield();
+	}
+
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT Disjoint;
+	while (Context->GetData(Frames[0].Disjoint.Get(), &Disjoint, sizeof(Disjoint), 0u) == S_FALSE)
+	{
+		std::this_thread::yield();
+	}
+
+	CalibrationTime = Issued + (FrameProfiler::Clock::now() - Issued) / 2;
+	bIsCalibrated = ResultHandle == S_OK && !Disjoint.Disjoint;
+}
+
+void GpuProfiler::BeginFrame() noexcept
+{
+	FrameIndex = (FrameIndex + 1u) % LatencyFrameNum;
+	auto& Frame = Frames[FrameIndex];
+
+	if (Frame.bIsPending)
+	{
+		Resolve(Frame);
+	}
+
+	if (!bIsStatisticsEnabled)
+	{
+		LastStatistics.clear();
+	}
+
+	Frame.ScopeNum = 0u;
+	Frame.PixelNum = 0u;
+	Frame.bIsPending = true;
+	Frame.bHasStatistics = bIsStatisticsEnabled;
+	OpenScopeNum = 0u;
+
+	Context->Begin(Frame.Disjoint.Get());
+	BeginScope("Frame");
+}
+
+void GpuProfiler::EndFrame() noexcept
+{
+	while (OpenScopeNum)
+	{
+		EndScope();
+	}
+
+	Context->End(Frames[FrameIndex].Disjoint.Get());
+}
+
+void GpuProfiler::BeginScope(const char* InName) noexcept
+{
+	auto& Frame = Frames[FrameIndex];
+
+	if (OpenScopeNum == MaxScopeNum)
+	{
+		return;
+	}
+
+	if (Annotation)
+	{
+		BeginEvent(Annotation.Get(), InName);
+	}
+
+	if (Frame.ScopeNum == MaxScopeNum)
+	{
+		OpenScopes[OpenScopeNum++] = DroppedScope;
+		return;
+	}
+
+	auto& Scope = Frame.Scopes[Frame.ScopeNum];
+	Scope.Name = InName;
+	Scope.Depth = OpenScopeNum;
+	Context->End(Scope.Begin.Get());
+
+	if (Frame.bHasStatistics)
+	{
+		Context->Begin(Scope.Statistics.Get());
+	}
+
+	OpenScopes[OpenScopeNum++] = Frame.ScopeNum++;
+}
+
+void GpuProfiler::EndScope() noexcept
+{
+	if (OpenScopeNum == 0u)
+	{
+		return;
+	}
+
+	if (Annotation)
+	{
+		Annotation->EndEvent();
+	}
+
+	if (const auto ScopeIndex = OpenScopes[--OpenScopeNum]; ScopeIndex != DroppedScope)
+	{
+		const auto& Frame = Frames[FrameIndex];
+		const auto& Scope = Frame.Scopes[ScopeIndex];
+
+		if (Frame.bHasStatistics)
+		{
+			Context->End(Scope.Statistics.Get());
+		}
+
+		Context->End(Scope.End.Get());
+	}
+}
+
+void GpuProfiler::Resolve(FrameQueries& InFrame) noexcept
+{
+	InFrame.bIsPending = false;
+
+	if (InFrame.bHasStatistics)
+	{
+		ResolveStatistics(InFrame);
+	}
+
+	// Never flush or wait, a frame whose queries are not done yet after the ring latency is skipped.
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT Disjoint;
+	if (Context->GetData(InFrame.Disjoint.Get(), &Disjoint, sizeof(Disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK || Disjoint.Disjoint)
+	{
+		++SkippedFrameNum;
+		return;
+	}
+
+	PendingTimings.clear();
+	std::array<std::pair<UINT64, UINT64>, MaxScopeNum> ScopeTicks;
+
+	for (unsigned int Index = 0u; Index < InFrame.ScopeNum; ++Index)
+	{
+		const auto& Scope = InFrame.Scopes[Index];
+		UINT64 Begin;
+		UINT64 End;
+
+		if (Context->GetData(Scope.Begin.Get(), &Begin, sizeof(Begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+			Context->GetData(Scope.End.Get(), &End, sizeof(End), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			++SkippedFrameNum;
+			return;
+		}
+
+		const auto Ticks = End > Begin ? End - Begin : 0u;
+		ScopeTicks[Index] = {Begin, End};
+		PendingTimings.push_back({Scope.Name, Scope.Depth, static_cast<float>(static_cast<double>(Ticks) * 1000.0 / static_cast<double>(Disjoint.Frequency))});
+	}
+
+	// Ticks from before the calibration mean the counter was reset, the trace goes without them.
+	const auto ToTime = [this, &Disjoint](const UINT64 InTick)
+	{
+		return CalibrationTime + std::chrono::duration_cast<FrameProfiler::Clock::duration>(
+			std::chrono::duration<double>(static_cast<double>(InTick - CalibrationTick) / static_cast<double>(Disjoint.Frequency)));
+	};
+
+	for (unsigned int Index = 0u; bIsCalibrated && Index < InFrame.ScopeNum; ++Index)
+	{
+		if (const auto [Begin, End] = ScopeTicks[Index]; Begin >= CalibrationTick && End >= Begin)
+		{
+			FrameProfiler::AddGpuZone(InFrame.Scopes[Index].Name, ToTime(Begin), ToTime(End));
+		}
+	}
+
+	// Swapped in only once complete so a skipped frame never clobbers the oldest history entry.
+	std::swap(History[HistoryCursor], PendingTimings);
+	LastResolvedIndex = HistoryCursor;
+	HistoryCursor = (HistoryCursor + 1u) % HistoryFrameNum;
+	ResolvedFrameNum = std::min(ResolvedFrameNum + 1u, HistoryFrameNum);
+	++TotalResolvedFrameNum;
+}
+
+void GpuProfiler::ResolveStatistics(const FrameQueries& InFrame) noexcept
+{
+	PendingStatistics.clear();
+
+	for (unsigned int Index = 0u; Index < InFrame.ScopeNum; ++Index)
+	{
+		const auto& Scope = InFrame.Scopes[Index];
+		D3D11_QUERY_DATA_PIPELINE_STATISTICS Data;
+
+		// The last complete counts stay up meanwhile.
+		if (Context->GetData(Scope.Statistics.Get(), &Data, sizeof(Data), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			return;
+		}
+
+		PendingStatistics.push_back({Scope.Name, Scope.Depth, Data.IAVertices, Data.IAPrimitives, Data.VSInvocations, Data.PSInvocations, Data.CInvocations, Data.CPrimitives});
+	}
+
+	std::swap(LastStatistics, PendingStatistics);
+	LastStatisticsPixelNum = InFrame.PixelNum;
+}
+
+bool GpuProfiler::ExportCsv(const std::string& InFileName) const
+{
+	std::ofstream Stream(InFileName);
+
+	if (!Stream)
+	{
+		return false;
+	}
+
+	Stream << "Frame,Scope,Depth,Milliseconds\n";
+
+	// Oldest frame first.
+	const auto First = (HistoryCursor + HistoryFrameNum - ResolvedFrameNum) % HistoryFrameNum;
+	for (unsigned int Frame = 0u; Frame < ResolvedFrameNum; ++Frame)
+	{
+		for (const auto& [Name, Depth, Milliseconds] : History[(First + Frame) % HistoryFrameNum])
+		{
+			Stream << Frame << ',' << Name << ',' << Depth << ',' << Milliseconds << '\n';
+		}
+	}
+
+	return static_cast<bool>(Stream);
+}
+
+void GpuProfiler::ShowTimings()
+{
+	if (ResolvedFrameNum == 0u)
+	{
+		ImGui::TextUnformatted("Waiting for GPU timestamps");
+		return;
+	}
+
+	if (ImGui::BeginTable("GpuScopes", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Scope");
+		ImGui::TableSetupColumn("GPU ms");
+		ImGui::TableHeadersRow();
+
+		for (const auto& [Name, Depth, Milliseconds] : GetLastTimings())
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%*s%s", static_cast<int>(Depth * 2u), "", Name);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", Milliseconds);
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::Text("%u frames skipped (disjoint or not ready)", SkippedFrameNum);
+
+	ImGui::Checkbox("Pipeline statistics", &bIsStatisticsEnabled);
+
+	if (bIsStatisticsEnabled)
+	{
+		ShowStatistics();
+	}
+
+	if (ImGui::Button("Export CSV"))
+	{
+		using namespace std::string_literals;
+		constexpr auto FileName = "GpuProfile.csv";
+		ExportStatus = ExportCsv(FileName) ? "Wrote "s + FileName : "Failed to write "s + FileName;
+	}
+
+	if (!ExportStatus.empty())
+	{
+		ImGui::SameLine();
+		ImGui::TextUnformatted(ExportStatus.c_str());
+	}
+}
+
+void GpuProfiler::ShowStatistics() const
+{
+	if (LastStatistics.empty())
+	{
+		ImGui::TextUnformatted("Waiting for pipeline statistics");
+		return;
+	}
+
+	if (ImGui::BeginTable("GpuStatistics", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Scope");
+		ImGui::TableSetupColumn("IA vertices");
+		ImGui::TableSetupColumn("IA primitives");
+		ImGui::TableSetupColumn("VS");
+		ImGui::TableSetupColumn("PS");
+		ImGui::TableSetupColumn("Rasterized");
+		ImGui::TableSetupColumn("Rendered");
+		ImGui::TableSetupColumn("Overdraw");
+		ImGui::TableSetupColumn("Culled");
+		ImGui::TableHeadersRow();
+
+		for (const auto& Statistics : LastStatistics)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%*s%s", static_cast<int>(Statistics.Depth * 2u), "", Statistics.Name);
+
+			for (const auto Count : {Statistics.InputVertexNum, Statistics.InputPrimitiveNum, Statistics.VertexInvocationNum,
+				Statistics.PixelInvocationNum, Statistics.RasterizedPrimitiveNum, Statistics.RenderedPrimitiveNum})
+			{
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", Count);
+			}
+
+			// Pixel shader runs per pixel of the render viewport, counting those of the scopes nested inside too.
+			ImGui::TableNextColumn();
+			if (LastStatisticsPixelNum)
+			{
+				ImGui::Text("%.2fx", static_cast<double>(Statistics.PixelInvocationNum) / LastStatisticsPixelNum);
+			}
+
+			// Of the primitives sent to the rasterizer, the share clipping and culling rejected.
+			ImGui::TableNextColumn();
+			if (Statistics.RasterizedPrimitiveNum)
+			{
+				const auto Rejected = Statistics.RasterizedPrimitiveNum - std::min(Statistics.RenderedPrimitiveNum, Statistics.RasterizedPrimitiveNum);
+				ImGui::Text("%.1f%%", static_cast<double>(Rejected) * 100.0 / static_cast<double>(Statistics.RasterizedPrimitiveNum));
+			}
+		}
+
+		ImGui::EndTable();
+	}
+}
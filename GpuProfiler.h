@@ -0,0 +1,177 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <d3d11_1.h>
+#include "wrl/client.h"
+#include "FrameProfiler.h"
+
+// Times the enclosing block on the GPU, the name must be a string literal.
+#define PROFILE_GPU_SCOPE(InGraphics, InName) const GpuProfiler::Scope PROFILE_CONCAT(GpuProfileScope, __LINE__) {(InGraphics).GetGpuProfiler(), InName}
+
+/**
+ * Named GPU timestamp scopes inside a disjoint query per frame.
+ * Queries are read back a few frames late from a ring so the CPU never waits on the GPU.
+ * Resolved scopes are also handed to the CPU profiler's trace, placed by a timestamp taken against the CPU clock at startup.
+ * Every scope is also a user defined annotation event, the regions PIX and RenderDoc captures group their calls under.
+ * Scopes can also count what went down the pipeline inside them, read back from the same ring. Off by default, every scope then
+ * keeps one more query running.
+ * https://learn.microsoft.com/en-us/windows/win32/api/d3d11/ne-d3d11-d3d11_query
+ */
+class GpuProfiler
+{
+public:
+	struct Timing
+	{
+		const char* Name;
+		unsigned int Depth;
+		float Milliseconds;
+	};
+
+	// D3D11_QUERY_DATA_PIPELINE_STATISTICS for a scope, nested scopes' counts included.
+	struct PassStatistics
+	{
+		const char* Name;
+		unsigned int Depth;
+		UINT64 InputVertexNum;
+		UINT64 InputPrimitiveNum;
+		UINT64 VertexInvocationNum;
+		UINT64 PixelInvocationNum;
+		// Sent to the rasterizer, and of those the ones left after clipping and culling.
+		UINT64 RasterizedPrimitiveNum;
+		UINT64 RenderedPrimitiveNum;
+	};
+
+	class Scope
+	{
+	public:
+		Scope(GpuProfiler& InProfiler, const char* InName) noexcept;
+		Scope(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		Scope& operator=(Scope&&) = delete;
+		~Scope();
+
+	private:
+		GpuProfiler& Profiler;
+	};
+
+	GpuProfiler(ID3D11Device* InDevice, ID3D11DeviceContext* InContext);
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler(GpuProfiler&&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(GpuProfiler&&) = delete;
+	~GpuProfiler() = default;
+
+	// Reads back the oldest frame in the ring and opens the whole-frame scope of the next one.
+	void BeginFrame() noexcept;
+	void EndFrame() noexcept;
+	void BeginScope(const char* InName) noexcept;
+	void EndScope() noexcept;
+
+	// The render viewport's size this frame, what the pixel invocations are measured against.
+	void SetPixelNum(const unsigned int InPixelNum) noexcept
+	{
+		Frames[FrameIndex].PixelNum = InPixelNum;
+	}
+
+	// Takes effect from the next frame on, a scope's queries are only ever all begun or none.
+	void EnablePipelineStatistics() noexcept
+	{
+		bIsStatisticsEnabled = true;
+	}
+
+	void DisablePipelineStatistics() noexcept
+	{
+		bIsStatisticsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsPipelineStatisticsEnabled() const noexcept
+	{
+		return bIsStatisticsEnabled;
+	}
+
+	// Writes every resolved frame in the history as Frame,Scope,Depth,Milliseconds rows.
+	[[nodiscard]] bool ExportCsv(const std::string& InFileName) const;
+	void ShowTimings();
+
+	[[nodiscard]] const std::vector<Timing>& GetLastTimings() const noexcept
+	{
+		return History[LastResolvedIndex];
+	}
+
+	// One per scope of the last frame whose counts were all ready, empty while the statistics are off.
+	// Can be a frame older than GetLastTimings.
+	[[nodiscard]] const std::vector<PassStatistics>& GetLastStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+	// Since startup, tells new GetLastTimings apart from ones already seen.
+	[[nodiscard]] unsigned long long GetTotalResolvedFrameNum() const noexcept
+	{
+		return TotalResolvedFrameNum;
+	}
+
+	static constexpr unsigned int LatencyFrameNum {4u};
+	static constexpr unsigned int MaxScopeNum {32u};
+	static constexpr unsigned int HistoryFrameNum {FrameProfiler::WindowFrameNum};
+
+private:
+	struct ScopeQueries
+	{
+		const char* Name {nullptr};
+		unsigned int Depth {0u};
+		Microsoft::WRL::ComPtr<ID3D11Query> Begin;
+		Microsoft::WRL::ComPtr<ID3D11Query> End;
+		Microsoft::WRL::ComPtr<ID3D11Query> Statistics;
+	};
+
+	struct FrameQueries
+	{
+		Microsoft::WRL::ComPtr<ID3D11Query> Disjoint;
+		std::array<ScopeQueries, MaxScopeNum> Scopes;
+		unsigned int ScopeNum {0u};
+		unsigned int PixelNum {0u};
+		bool bIsPending {false};
+		bool bHasStatistics {false};
+	};
+
+	void Resolve(FrameQueries& InFrame) noexcept;
+	// Kept apart from the timings, a frame whose counts aren't ready yet still has its timings shown.
+	void ResolveStatistics(const FrameQueries& InFrame) noexcept;
+	void ShowStatistics() const;
+	// Waits for one timestamp, so GPU ticks can be placed on the CPU clock without drifting more than the clocks do.
+	void Calibrate(ID3D11Device* InDevice);
+
+private:
+	static constexpr unsigned int DroppedScope {~0u};
+
+	ID3D11DeviceContext* Context;
+	// Null in shipping builds and where the runtime has no annotations.
+	Microsoft::WRL::ComPtr<ID3DUserDefinedAnnotation> Annotation;
+	std::array<FrameQueries, LatencyFrameNum> Frames;
+	unsigned int FrameIndex {0u};
+
+	std::array<unsigned int, MaxScopeNum> OpenScopes {};
+	unsigned int OpenScopeNum {0u};
+
+	std::array<std::vector<Timing>, HistoryFrameNum> History;
+	std::vector<Timing> PendingTimings;
+	unsigned int HistoryCursor {0u};
+	unsigned int ResolvedFrameNum {0u};
+	unsigned int LastResolvedIndex {0u};
+	unsigned int SkippedFrameNum {0u};
+	unsigned long long TotalResolvedFrameNum {0u};
+	std::string ExportStatus;
+
+	std::vector<PassStatistics> LastStatistics;
+	std::vector<PassStatistics> PendingStatistics;
+	unsigned int LastStatisticsPixelNum {0u};
+	bool bIsStatisticsEnabled {false};
+
+	UINT64 CalibrationTick {0u};
+	FrameProfiler::Clock::time_point CalibrationTime;
+	bool bIsCalibrated {false};
+};
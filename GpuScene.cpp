@@ -0,0 +1,394 @@
+﻿#include "GpuScene.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	constexpr UINT ScatterGroupSize {64u};
+	constexpr UINT PropagateGroupSize {64u};
+}
+
+GpuScene::GpuScene(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+{
+	HRESULT ResultHandle;
+	const auto Blob = InShaderBundle.Load("GpuSceneScatterCS.cso");
+
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &ScatterShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(ScatterConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ScatterConstantBuffer))
+
+	// Only the matrices, the instance culler adds what else the instanced vertex shaders read.
+	D3D11_BUFFER_DESC TransformDesc {};
+	TransformDesc.ByteWidth = (MaxTransformNum + MaxTransientNum) * sizeof(DirectX::XMFLOAT4X4);
+	TransformDesc.Usage = D3D11_USAGE_DEFAULT;
+	TransformDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	TransformDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	TransformDesc.StructureByteStride = sizeof(DirectX::XMFLOAT4X4);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&TransformDesc, nullptr, &Transforms))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Transforms.Get(), nullptr, &TransformView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(Transforms.Get(), nullptr, &TransformUav))
+
+	D3D11_BUFFER_DESC DeltaDesc {};
+	DeltaDesc.ByteWidth = MaxDeltaNum * sizeof(Delta);
+	DeltaDesc.Usage = D3D11_USAGE_DYNAMIC;
+	DeltaDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	DeltaDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	DeltaDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	DeltaDesc.StructureByteStride = sizeof(Delta);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&DeltaDesc, nullptr, &DeltaBuffer))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(DeltaBuffer.Get(), nullptr, &DeltaView))
+
+	const auto PropagateBlob = InShaderBundle.Load("GpuScenePropagateCS.cso");
+
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(PropagateBlob->GetBufferPointer(), PropagateBlob->GetBufferSize(), nullptr, &PropagateShader))
+
+	ConstantBufferDesc.ByteWidth = sizeof(PropagateConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &PropagateConstantBuffer))
+
+	// Persistent IDs only, the scatter writes hierarchies' local transforms here instead of into Transforms.
+	TransformDesc.ByteWidth = MaxTransformNum * sizeof(DirectX::XMFLOAT4X4);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&TransformDesc, nullptr, &LocalTransforms))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(LocalTransforms.Get(), nullptr, &LocalTransformView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(LocalTransforms.Get(), nullptr, &LocalTransformUav))
+
+	D3D11_BUFFER_DESC NodeDesc {};
+	NodeDesc.ByteWidth = MaxTransformNum * sizeof(PropagatedNode);
+	NodeDesc.Usage = D3D11_USAGE_DEFAULT;
+	NodeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	NodeDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	NodeDesc.StructureByteStride = sizeof(PropagatedNode);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&NodeDesc, nullptr, &NodeBuffer))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(NodeBuffer.Get(), nullptr, &NodeView))
+
+	FreeRanges.push_back({0u, MaxTransformNum});
+	PendingDeltas.assign(MaxTransformNum, NoIndex);
+	TransientDeltas.reserve(MaxTransientNum);
+}
+
+void GpuScene::BeginFrame() noexcept
+{
+	// Only the instance culler hands out transient IDs, and it flushes them along with its own pass.
+	TransientDeltas.clear();
+}
+
+unsigned int GpuScene::Allocate(const unsigned int InNum)
+{
+	assert(InNum > 0u && "Allocating an empty range of scene transforms");
+
+	const auto Found = std::find_if(FreeRanges.begin(), FreeRanges.end(), [InNum](const FreeRange& InRange)
+	{
+		return InRange.Num >= InNum;
+	});
+
+	if (Found == FreeRanges.end())
+	{
+		return NoIndex;
+	}
+
+	const auto First = Found->First;
+	Found->First += InNum;
+	Found->Num -= InNum;
+
+	if (Found->Num == 0u)
+	{
+		FreeRanges.erase(Found);
+	}
+
+	AllocatedNum += InNum;
+	return First;
+}
+
+void GpuScene::Free(const unsigned int InFirst, const unsigned int InNum)
+{
+	assert(InFirst + InNum <= MaxTransformNum && "Freeing scene transforms that were never allocated");
+
+	const auto Next = std::lower_bound(FreeRanges.begin(), FreeRanges.end(), InFirst, [](const FreeRange& InRange, const unsigned int InIndex)
+	{
+		return InRange.First < InIndex;
+	});
+
+	auto Freed = FreeRanges.insert(Next, {InFirst, InNum});
+
+	if (const auto After = std::next(Freed); After != FreeRanges.end() && Freed->First + Freed->Num == After->First)
+	{
+		Freed->Num += After->Num;
+		FreeRanges.erase(After);
+	}
+
+	if (Freed != FreeRanges.begin())
+	{
+		if (const auto Before = std::prev(Freed); Before->First + Before->Num == Freed->First)
+		{
+			Before->Num += Freed->Num;
+			FreeRanges.erase(Freed);
+		}
+	}
+
+	AllocatedNum -= InNum;
+
+	if (const auto Found = std::find_if(Hierarchies.begin(), Hierarchies.end(), [InFirst](const Hierarchy& InHierarchy)
+	{
+		return InHierarchy.First == InFirst;
+	}); Found != Hierarchies.end())
+	{
+		Hierarchies.erase(Found);
+	}
+}
+
+void GpuScene::AddHierarchy(const unsigned int InFirst, const std::span<const unsigned int> InParents)
+{
+	assert(InFirst + InParents.size() <= MaxTransformNum && "Hierarchy outside of the scene transforms");
+
+	const auto NodeNum = static_cast<unsigned int>(InParents.size());
+
+	if (NodeNum == 0u)
+	{
+		return;
+	}
+
+	// Parents precede their children, so one pass finds every depth and a counting sort orders the nodes by it.
+	std::vector<unsigned int> Depths(NodeNum);
+	std::vector<unsigned int> LevelEnds;
+
+	for (unsigned int Index = 0u; Index < NodeNum; ++Index)
+	{
+		const auto Parent = InParents[Index];
+		assert((Parent == NoIndex || Parent < Index) && "Hierarchy parents have to precede their children");
+
+		Depths[Index] = Parent != NoIndex ? Depths[Parent] + 1u : 0u;
+
+		if (Depths[Index] >= LevelEnds.size())
+		{
+			LevelEnds.resize(Depths[Index] + 1u, 0u);
+		}
+
+		++LevelEnds[Depths[Index]];
+	}
+
+	std::vector<unsigned int> LevelCursors(LevelEnds.size());
+
+	for (size_t Level = 0u, Offset = 0u; Level < LevelEnds.size(); ++Level)
+	{
+		LevelCursors[Level] = static_cast<unsigned int>(Offset);
+		Offset += LevelEnds[Level];
+		LevelEnds[Level] = static_cast<unsigned int>(Offset);
+	}
+
+	Hierarchy Added {InFirst, std::vector<PropagatedNode>(NodeNum), std::move(LevelEnds)};
+
+	for (unsigned int Index = 0u; Index < NodeNum; ++Index)
+	{
+		const auto Parent = InParents[Index];
+		Added.Nodes[LevelCursors[Depths[Index]]++] = {InFirst + Index, Parent != NoIndex ? InFirst + Parent : NoIndex};
+	}
+
+	const auto Next = std::lower_bound(Hierarchies.begin(), Hierarchies.end(), InFirst, [](const Hierarchy& InHierarchy, const unsigned int InIndex)
+	{
+		return InHierarchy.First < InIndex;
+	});
+
+	Hierarchies.insert(Next, std::move(Added));
+}
+
+void GpuScene::SetTransform(const unsigned int InIndex, DirectX::FXMMATRIX InTransform)
+{
+	assert(InIndex < MaxTransformNum && "Scene transform ID out of range");
+
+	auto& Pending = PendingDeltas[InIndex];
+
+	if (Pending == NoIndex)
+	{
+		Pending = static_cast<unsigned int>(Deltas.size());
+		Deltas.push_back({{}, InIndex, {}});
+	}
+
+	DirectX::XMStoreFloat4x4(&Deltas[Pending].Model, DirectX::XMMatrixTranspose(InTransform));
+}
+
+void GpuScene::SetLocalTransform(const unsigned int InIndex, DirectX::FXMMATRIX InTransform)
+{
+	auto* const Found = FindHierarchy(InIndex);
+	assert(Found && "Local transform of an ID outside of any hierarchy");
+
+	Found->bIsDirty = true;
+	auto& Pending = PendingDeltas[InIndex];
+
+	if (Pending == NoIndex)
+	{
+		Pending = static_cast<unsigned int>(LocalDeltas.size());
+		LocalDeltas.push_back({{}, InIndex, {}});
+	}
+
+	DirectX::XMStoreFloat4x4(&LocalDeltas[Pending].Model, DirectX::XMMatrixTranspose(InTransform));
+}
+
+unsigned int GpuScene::AddTransient(DirectX::FXMMATRIX InTransform)
+{
+	if (TransientDeltas.size() == MaxTransientNum)
+	{
+		return NoIndex;
+	}
+
+	const auto Index = MaxTransformNum + static_cast<unsigned int>(TransientDeltas.size());
+	auto& Added = TransientDeltas.emplace_back();
+	DirectX::XMStoreFloat4x4(&Added.Model, DirectX::XMMatrixTranspose(InTransform));
+	Added.Index = Index;
+
+	return Index;
+}
+
+void GpuScene::Flush(const Graphics& InGraphics)
+{
+	LastStatistics = {AllocatedNum, static_cast<unsigned int>(Deltas.size() + LocalDeltas.size()), static_cast<unsigned int>(TransientDeltas.size()),
+	                  0u, 0u, (Deltas.size() + TransientDeltas.size() + LocalDeltas.size()) * sizeof(Delta)};
+
+	const bool bHasDirtyHierarchy = std::any_of(Hierarchies.begin(), Hierarchies.end(), [](const Hierarchy& InHierarchy)
+	{
+		return InHierarchy.bIsDirty;
+	});
+
+	if (Deltas.empty() && TransientDeltas.empty() && !bHasDirtyHierarchy)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Scene transforms");
+
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	auto* const Context = ImmediateContext.GetDeviceContext();
+
+	Context->CSSetShader(ScatterShader.Get(), nullptr, 0u);
+	Context->CSSetConstantBuffers(0u, 1u, ScatterConstantBuffer.GetAddressOf());
+	Context->CSSetUnorderedAccessViews(0u, 1u, TransformUav.GetAddressOf(), nullptr);
+
+	Scatter(Context, Deltas);
+	Scatter(Context, TransientDeltas);
+
+	ID3D11ShaderResourceView* const NullViews[2] {};
+	ID3D11UnorderedAccessView* const NullUav = nullptr;
+
+	if (bHasDirtyHierarchy)
+	{
+		Context->CSSetUnorderedAccessViews(0u, 1u, LocalTransformUav.GetAddressOf(), nullptr);
+		Scatter(Context, LocalDeltas);
+
+		// Unbound first, the locals are read as a resource from here on.
+		Context->CSSetUnorderedAccessViews(0u, 1u, &NullUav, nullptr);
+		Context->CSSetShader(PropagateShader.Get(), nullptr, 0u);
+		Context->CSSetConstantBuffers(0u, 1u, PropagateConstantBuffer.GetAddressOf());
+		const std::array Views {NodeView.Get(), LocalTransformView.Get()};
+		Context->CSSetShaderResources(0u, static_cast<UINT>(Views.size()), Views.data());
+		Context->CSSetUnorderedAccessViews(0u, 1u, TransformUav.GetAddressOf(), nullptr);
+
+		for (auto& Dirty : Hierarchies)
+		{
+			if (Dirty.bIsDirty)
+			{
+				Propagate(Context, Dirty);
+			}
+		}
+	}
+
+	Context->CSSetShaderResources(0u, 2u, NullViews);
+	Context->CSSetUnorderedAccessViews(0u, 1u, &NullUav, nullptr);
+
+	ImmediateContext.GetStateCache().CountUpload(LastStatistics.UploadedBytes);
+
+	for (const auto& Written : Deltas)
+	{
+		PendingDeltas[Written.Index] = NoIndex;
+	}
+
+	for (const auto& Written : LocalDeltas)
+	{
+		PendingDeltas[Written.Index] = NoIndex;
+	}
+
+	Deltas.clear();
+	TransientDeltas.clear();
+	LocalDeltas.clear();
+}
+
+void GpuScene::Scatter(ID3D11DeviceContext* InContext, const std::vector<Delta>& InDeltas)
+{
+	HRESULT ResultHandle;
+
+	for (size_t First = 0u; First < InDeltas.size(); First += MaxDeltaNum)
+	{
+		const auto DeltaNum = static_cast<UINT>(std::min<size_t>(MaxDeltaNum, InDeltas.size() - First));
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+		CHECK_HRESULT_EXCEPTION(InContext->Map(DeltaBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		std::memcpy(MappedResource.pData, InDeltas.data() + First, DeltaNum * sizeof(Delta));
+		InContext->Unmap(DeltaBuffer.Get(), 0u);
+
+		CHECK_HRESULT_EXCEPTION(InContext->Map(ScatterConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		const ScatterConstants Constants {DeltaNum, {}};
+		std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+		InContext->Unmap(ScatterConstantBuffer.Get(), 0u);
+
+		InContext->CSSetShaderResources(0u, 1u, DeltaView.GetAddressOf());
+		InContext->Dispatch((DeltaNum + ScatterGroupSize - 1u) / ScatterGroupSize, 1u, 1u);
+	}
+}
+
+GpuScene::Hierarchy* GpuScene::FindHierarchy(const unsigned int InIndex) noexcept
+{
+	const auto Next = std::upper_bound(Hierarchies.begin(), Hierarchies.end(), InIndex, [](const unsigned int InSearched, const Hierarchy& InHierarchy)
+	{
+		return InSearched < InHierarchy.First;
+	});
+
+	if (Next == Hierarchies.begin())
+	{
+		return nullptr;
+	}
+
+	auto& Found = *std::prev(Next);
+	return InIndex - Found.First < Found.Nodes.size() ? &Found : nullptr;
+}
+
+void GpuScene::Propagate(ID3D11DeviceContext* InContext, Hierarchy& InHierarchy)
+{
+	HRESULT ResultHandle;
+	const auto NodeNum = static_cast<UINT>(InHierarchy.Nodes.size());
+
+	if (!InHierarchy.bIsUploaded)
+	{
+		const D3D11_BOX Box {InHierarchy.First * static_cast<UINT>(sizeof(PropagatedNode)), 0u, 0u,
+		                     (InHierarchy.First + NodeNum) * static_cast<UINT>(sizeof(PropagatedNode)), 1u, 1u};
+		InContext->UpdateSubresource(NodeBuffer.Get(), 0u, &Box, InHierarchy.Nodes.data(), 0u, 0u);
+		LastStatistics.UploadedBytes += NodeNum * sizeof(PropagatedNode);
+		InHierarchy.bIsUploaded = true;
+	}
+
+	// Each level reads the one written before it, which D3D11 orders between dispatches on the same view.
+	for (size_t Level = 0u; Level < InHierarchy.LevelEnds.size(); ++Level)
+	{
+		const auto LevelFirst = Level > 0u ? InHierarchy.LevelEnds[Level - 1u] : 0u;
+		const auto LevelNum = InHierarchy.LevelEnds[Level] - LevelFirst;
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+		CHECK_HRESULT_EXCEPTION(InContext->Map(PropagateConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		const PropagateConstants Constants {InHierarchy.First + LevelFirst, LevelNum, {}};
+		std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+		InContext->Unmap(PropagateConstantBuffer.Get(), 0u);
+
+		InContext->Dispatch((LevelNum + PropagateGroupSize - 1u) / PropagateGroupSize, 1u, 1u);
+	}
+
+	LastStatistics.PropagatedNum += NodeNum;
+	LastStatistics.LevelNum += static_cast<unsigned int>(InHierarchy.LevelEnds.size());
+	InHierarchy.bIsDirty = false;
+}
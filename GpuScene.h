@@ -0,0 +1,164 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <span>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * World matrices of everything placed in the scene, in one persistent structured buffer on the GPU indexed by stable IDs.
+ * Owners allocate a range of IDs once and only report the transforms that changed, which are collected as a delta list
+ * and scattered into the buffer by a small compute pass, so the upload grows with what moves rather than with the scene.
+ * Drawables without IDs of their own get a transient one for the frame, written the same way.
+ * Large hierarchies can hand their structure over instead, their IDs then take local transforms and the world matrices
+ * are propagated from them on the GPU a depth level per dispatch, so moving a parent uploads one matrix, not its subtree.
+ * The instance culler reads instance transforms from here by ID and compacts the visible ones for the instanced vertex shaders.
+ */
+class GpuScene
+{
+public:
+	static constexpr unsigned int NoIndex {~0u};
+	static constexpr unsigned int MaxTransformNum {1u << 18u};
+	static constexpr unsigned int MaxTransientNum {16384u};
+	// Scattered per dispatch, more changes in a frame take several.
+	static constexpr unsigned int MaxDeltaNum {4096u};
+	// Hierarchies smaller than this are cheaper to keep sending world matrices for.
+	static constexpr unsigned int MinPropagatedNum {4096u};
+
+	struct Statistics
+	{
+		unsigned int AllocatedNum {0u};
+		unsigned int DeltaNum {0u};
+		unsigned int TransientNum {0u};
+		// World matrices derived on the GPU and the dispatches it took, a depth level of one hierarchy each.
+		unsigned int PropagatedNum {0u};
+		unsigned int LevelNum {0u};
+		size_t UploadedBytes {0u};
+	};
+
+	GpuScene(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	GpuScene(const GpuScene&) = delete;
+	GpuScene(GpuScene&&) = delete;
+	GpuScene& operator=(const GpuScene&) = delete;
+	GpuScene& operator=(GpuScene&&) = delete;
+	~GpuScene() = default;
+
+	void BeginFrame() noexcept;
+
+	// First of InNum consecutive IDs, NoIndex when the buffer has no such range left. Their transforms are undefined until set.
+	[[nodiscard]] unsigned int Allocate(unsigned int InNum);
+	// Drops the hierarchy added at InFirst, if there is one.
+	void Free(unsigned int InFirst, unsigned int InNum);
+	// Derives the world matrices of an allocated range from local transforms from now on. InParents holds the parent of
+	// each ID in the range as an offset from InFirst, NoIndex for top level ones, and parents precede their children.
+	void AddHierarchy(unsigned int InFirst, std::span<const unsigned int> InParents);
+
+	// On the main thread, setting the same ID again before the next flush only replaces the pending change.
+	void SetTransform(unsigned int InIndex, DirectX::FXMMATRIX InTransform);
+	// The same for IDs of a hierarchy, relative to the parent, or the whole placement for top level ones. Its world matrices
+	// are propagated again on the next flush.
+	void SetLocalTransform(unsigned int InIndex, DirectX::FXMMATRIX InTransform);
+	// An ID valid until the end of the frame, NoIndex once the frame's transient IDs are used up.
+	[[nodiscard]] unsigned int AddTransient(DirectX::FXMMATRIX InTransform);
+
+	[[nodiscard]] unsigned int GetTransientSpace() const noexcept
+	{
+		return MaxTransientNum - static_cast<unsigned int>(TransientDeltas.size());
+	}
+
+	// Writes the pending changes on the immediate context, before anything reads the transforms this frame.
+	void Flush(const Graphics& InGraphics);
+
+	// Persistent IDs first, the transient ones after MaxTransformNum.
+	[[nodiscard]] ID3D11ShaderResourceView* GetTransformView() const noexcept
+	{
+		return TransformView.Get();
+	}
+
+	// Of the last flush, the allocated count is current.
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+private:
+	struct Delta
+	{
+		// Transposed like every other matrix handed to the shaders.
+		DirectX::XMFLOAT4X4 Model;
+		UINT Index;
+		UINT Padding[3];
+	};
+
+	struct ScatterConstants
+	{
+		UINT DeltaNum;
+		UINT Padding[3];
+	};
+
+	struct FreeRange
+	{
+		unsigned int First;
+		unsigned int Num;
+	};
+
+	struct PropagatedNode
+	{
+		UINT Index;
+		UINT Parent;
+	};
+
+	struct PropagateConstants
+	{
+		UINT FirstNode;
+		UINT NodeNum;
+		UINT Padding[2];
+	};
+
+	struct Hierarchy
+	{
+		unsigned int First;
+		// Nodes by depth, stored at the hierarchy's own IDs in the node buffer. Level L is [LevelEnds[L - 1], LevelEnds[L]).
+		std::vector<PropagatedNode> Nodes;
+		std::vector<unsigned int> LevelEnds;
+		bool bIsUploaded {false};
+		bool bIsDirty {true};
+	};
+
+	void Scatter(ID3D11DeviceContext* InContext, const std::vector<Delta>& InDeltas);
+	// Of the hierarchy holding the ID, nullptr for an ID outside of them.
+	[[nodiscard]] Hierarchy* FindHierarchy(unsigned int InIndex) noexcept;
+	void Propagate(ID3D11DeviceContext* InContext, Hierarchy& InHierarchy);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> ScatterShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ScatterConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Transforms;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TransformView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> TransformUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> DeltaBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DeltaView;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> PropagateShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> PropagateConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> LocalTransforms;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LocalTransformView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> LocalTransformUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> NodeBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> NodeView;
+
+	// Sorted by First and never adjacent, neighbours are merged as they are freed.
+	std::vector<FreeRange> FreeRanges;
+	std::vector<Delta> Deltas;
+	std::vector<Delta> TransientDeltas;
+	std::vector<Delta> LocalDeltas;
+	// Where each persistent ID's pending change is in Deltas, or LocalDeltas for IDs of a hierarchy, NoIndex without one.
+	std::vector<unsigned int> PendingDeltas;
+	// Sorted by First.
+	std::vector<Hierarchy> Hierarchies;
+	unsigned int AllocatedNum {0u};
+	Statistics LastStatistics {};
+};
@@ -0,0 +1,41 @@
+// One level of a hierarchy whose world matrices are derived on the GPU, a node per thread. Its parent is a level up and was
+// written by the dispatch before, so the node's world matrix is its local one on top of that. Top level nodes carry the
+// placement of the hierarchy in their local matrix and are copied.
+struct PropagatedNode
+{
+    uint Index;
+    uint Parent;
+};
+
+struct SceneTransform
+{
+    matrix Model;
+};
+
+static const uint NoParent = 0xFFFFFFFF;
+
+StructuredBuffer<PropagatedNode> Nodes : register(t0);
+StructuredBuffer<SceneTransform> LocalTransforms : register(t1);
+RWStructuredBuffer<SceneTransform> Transforms : register(u0);
+
+cbuffer Propagate : register(b0)
+{
+    uint FirstNode;
+    uint NodeNum;
+}
+
+[numthreads(64, 1, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (InThreadID.x >= NodeNum)
+    {
+        return;
+    }
+
+    const PropagatedNode Node = Nodes[FirstNode + InThreadID.x];
+    const matrix Local = LocalTransforms[Node.Index].Model;
+
+    SceneTransform Written;
+    Written.Model = Node.Parent != NoParent ? mul(Local, Transforms[Node.Parent].Model) : Local;
+    Transforms[Node.Index] = Written;
+}
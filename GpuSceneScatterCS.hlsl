@@ -0,0 +1,35 @@
+// One changed world matrix of the scene per thread, written to its ID in the persistent transforms.
+struct Delta
+{
+    matrix Model;
+    uint Index;
+    uint3 Padding;
+};
+
+struct SceneTransform
+{
+    matrix Model;
+};
+
+StructuredBuffer<Delta> Deltas : register(t0);
+RWStructuredBuffer<SceneTransform> Transforms : register(u0);
+
+cbuffer Scatter : register(b0)
+{
+    uint DeltaNum;
+}
+
+[numthreads(64, 1, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (InThreadID.x >= DeltaNum)
+    {
+        return;
+    }
+
+    const Delta Changed = Deltas[InThreadID.x];
+
+    SceneTransform Written;
+    Written.Model = Changed.Model;
+    Transforms[Changed.Index] = Written;
+}
@@ -1,52 +1,65 @@
 ﻿#include "Graphics.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 #include <d3dcompiler.h>
+#include <dxgi1_6.h>
+#include <thread>
+#include "BindManager.h"
+#include "Camera.h"
 #include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "ImGuiManager.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include "StartupTimeline.h"
 #include "imgui/imgui_impl_dx11.h"
 #include "imgui/imgui_impl_win32.h"
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "D3DCompiler.lib")
+#pragma comment(lib, "dxgi.lib")
 
-Graphics::Graphics(HWND InWindowHandle, int InWidth, int InHeight)
+namespace
 {
-	DXGI_SWAP_CHAIN_DESC SwapChainDesc {};
-	SwapChainDesc.BufferDesc.Width = InWidth;
-	SwapChainDesc.BufferDesc.Height = InHeight;
-	SwapChainDesc.BufferDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-	SwapChainDesc.BufferDesc.RefreshRate.Numerator = 0;
-	SwapChainDesc.BufferDesc.RefreshRate.Denominator = 0;
-	SwapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
-	SwapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
-	SwapChainDesc.SampleDesc.Count = 1;
-	SwapChainDesc.SampleDesc.Quality = 0;
-	SwapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	SwapChainDesc.BufferCount = 1;
-	SwapChainDesc.OutputWindow = InWindowHandle;
-	SwapChainDesc.Windowed = TRUE;
-	SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-	SwapChainDesc.Flags = 0;
-	
-	UINT CreateFlags = 0u;
-#ifndef NDEBUG
-	CreateFlags |= D3D11_CREATE_DEVICE_DEBUG;
-#endif
+	std::string ToAdapterName(const WCHAR* InDescription)
+	{
+		std::string Name;
+
+		for (; *InDescription; ++InDescription)
+		{
+			Name += *InDescription < 0x80 ? static_cast<char>(*InDescription) : '?';
+		}
+
+		return Name;
+	}
+}
+
+void Graphics::Prepare(const UINT InAdapterIndex, Prerequisites& OutPrerequisites, JobCounter& InOutDone)
+{
+	// The debug layer's queue the checks below read from, the Graphics made later reuses it.
+	const DXGIInfoManager DebugMessages;
+
+	JobSystem::Get().Run([InAdapterIndex, &OutPrerequisites]
+	{
+		STARTUP_PHASE("Device");
+		CreateDevice(D3D_DRIVER_TYPE_HARDWARE, InAdapterIndex, OutPrerequisites);
+	}, &InOutDone);
+
+	JobSystem::Get().Run([&OutPrerequisites]
+	{
+		STARTUP_PHASE("Shader bundle");
+		OutPrerequisites.Shaders = std::make_unique<ShaderBundle>(ShaderBundleFileName);
+	}, &InOutDone);
+}
 
+Graphics::Graphics(HWND InWindowHandle, int InWidth, int InHeight, const SwapChainSettings& InSettings, Prerequisites InPrerequisites)
+	: Device(std::move(InPrerequisites.Device)), DeviceContext(std::move(InPrerequisites.DeviceContext))
+{
 	HRESULT ResultHandle;
 
-	CHECK_HRESULT_EXCEPTION(D3D11CreateDeviceAndSwapChain
-	(
-		nullptr,
-		D3D_DRIVER_TYPE_HARDWARE,
-		nullptr,
-		CreateFlags,
-		nullptr,
-		0,
-		D3D11_SDK_VERSION,
-		&SwapChainDesc,
-		&SwapChain,
-		&Device,
-		nullptr,
-		&DeviceContext
-	))
+	CreateSwapChain(InWindowHandle, InWidth, InHeight, InSettings);
 
 	Microsoft::WRL::ComPtr<ID3D11Resource> BackBuffer;
 
@@ -57,22 +70,408 @@ Graphics::Graphics(HWND InWindowHandle, int InWidth, int InHeight)
 		&BackBuffer
 	))
 
-	CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView
-	(
-		BackBuffer.Get(),
-		nullptr,
-		&RenderTargetView
-	))
+	Initialize(BackBuffer.Get(), InWidth, InHeight, InSettings.SceneFormat, InSettings.SampleNum, std::move(InPrerequisites.Shaders));
+	ImGui_ImplDX11_Init(Device.Get(), DeviceContext.Get());
+
+	// The window makes itself borderless, exclusive mode is the swap chain's.
+	MyFullscreenMode = InSettings.Fullscreen;
+
+	if (InSettings.Fullscreen == FullscreenMode::Exclusive)
+	{
+		EnterExclusiveFullscreen(InSettings);
+	}
+
+	// Nothing reads the atlas before the first UI frame, which waits for it in BeginFrame.
+	JobSystem::Get().Run([]
+	{
+		STARTUP_PHASE("Font atlas");
+		ImGui::GetIO().Fonts->Build();
+	}, &FontAtlasBuilt);
+}
+
+Graphics::Graphics(const int InWidth, const int InHeight, const OffscreenSettings& InSettings)
+{
+	HRESULT ResultHandle;
+
+	Prerequisites Created;
+	CreateDevice(InSettings.bShouldUseWarp ? D3D_DRIVER_TYPE_WARP : D3D_DRIVER_TYPE_HARDWARE, InSettings.AdapterIndex, Created);
+	Device = std::move(Created.Device);
+	DeviceContext = std::move(Created.DeviceContext);
+
+	D3D11_TEXTURE2D_DESC RenderTargetDesc {};
+	RenderTargetDesc.Width = InWidth;
+	RenderTargetDesc.Height = InHeight;
+	RenderTargetDesc.MipLevels = 1u;
+	RenderTargetDesc.ArraySize = 1u;
+	// The swap chain's format, so both modes render the same pixels. Post-processing does the sRGB encoding.
+	RenderTargetDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	RenderTargetDesc.SampleDesc.Count = 1u;
+	RenderTargetDesc.SampleDesc.Quality = 0u;
+	RenderTargetDesc.Usage = D3D11_USAGE_DEFAULT;
+	RenderTargetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&RenderTargetDesc, nullptr, &OffscreenTarget))
+
+	D3D11_QUERY_DESC FenceDesc {};
+	FenceDesc.Query = D3D11_QUERY_EVENT;
+	FrameFences.resize(std::max(InSettings.MaximumFrameLatency, 1u));
+
+	for (auto& Fence : FrameFences)
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateQuery(&FenceDesc, &Fence))
+	}
+
+	Initialize(OffscreenTarget.Get(), InWidth, InHeight, InSettings.SceneFormat, InSettings.SampleNum, std::make_unique<ShaderBundle>(ShaderBundleFileName));
+
+	// There is no window for ImGui to take input from.
+	bIsImGuiEnabled = false;
+}
+
+AdapterIdentity Graphics::IdentifyAdapter(const UINT InAdapterIndex)
+{
+	AdapterIdentity Identity;
+	Identity.ThreadNum = std::thread::hardware_concurrency();
+
+	const auto Adapter = SelectAdapter(InAdapterIndex, false);
+	DXGI_ADAPTER_DESC1 Desc;
+
+	if (!Adapter || FAILED(Adapter->GetDesc1(&Desc)))
+	{
+		return Identity;
+	}
+
+	Identity.VendorId = Desc.VendorId;
+	Identity.DeviceId = Desc.DeviceId;
+	Identity.Revision = Desc.Revision;
+	Identity.DedicatedVideoBytes = Desc.DedicatedVideoMemory;
+
+	// Only the user mode driver version is reported, asked for through the one interface DXGI still answers it for.
+	LARGE_INTEGER DriverVersion;
+	if (SUCCEEDED(Adapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &DriverVersion)))
+	{
+		Identity.DriverVersion = static_cast<unsigned long long>(DriverVersion.QuadPart);
+	}
+
+	return Identity;
+}
+
+Microsoft::WRL::ComPtr<IDXGIAdapter1> Graphics::SelectAdapter(const UINT InIndex, const bool bInIsLogging)
+{
+	HRESULT ResultHandle;
+
+	Microsoft::WRL::ComPtr<IDXGIFactory1> Factory;
+	CHECK_HRESULT_EXCEPTION(CreateDXGIFactory1(IID_PPV_ARGS(&Factory)))
+
+	// Without the ranking, before Windows 10 1803, the adapter driving the primary display comes first.
+	Microsoft::WRL::ComPtr<IDXGIFactory6> Factory6;
+	Factory.As(&Factory6);
+
+	std::vector<Microsoft::WRL::ComPtr<IDXGIAdapter1>> Adapters;
+	Microsoft::WRL::ComPtr<IDXGIAdapter1> Adapter;
+
+	for (UINT Index = 0u; (Factory6 ? Factory6->EnumAdapterByGpuPreference(Index, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&Adapter))
+	                                : Factory->EnumAdapters1(Index, &Adapter)) != DXGI_ERROR_NOT_FOUND; ++Index)
+	{
+		DXGI_ADAPTER_DESC1 Desc;
+
+		// The Basic Render Driver is WARP, which OffscreenSettings ask for by name.
+		if (SUCCEEDED(Adapter->GetDesc1(&Desc)) && !(Desc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE))
+		{
+			if (bInIsLogging)
+			{
+				LOG_INFO("Adapter {}: {}, {} MB of video memory", Adapters.size(), ToAdapterName(Desc.Description), Desc.DedicatedVideoMemory / (1024u * 1024u));
+			}
+
+			Adapters.push_back(Adapter);
+		}
+	}
+
+	if (Adapters.empty())
+	{
+		return nullptr;
+	}
+
+	if (InIndex >= Adapters.size())
+	{
+		if (bInIsLogging)
+		{
+			LOG_WARNING("There is no adapter {}, the device is created on adapter 0", InIndex);
+		}
+
+		return Adapters.front();
+	}
+
+	return Adapters[InIndex];
+}
+
+void Graphics::CreateDevice(const D3D_DRIVER_TYPE InDriverType, const UINT InAdapterIndex, Prerequisites& OutPrerequisites)
+{
+	UINT CreateFlags = 0u;
+#ifndef NDEBUG
+	CreateFlags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+
+	HRESULT ResultHandle;
+
+	// A null adapter would be the default one, on hybrid laptops often the integrated GPU. WARP is left to the driver type.
+	Microsoft::WRL::ComPtr<IDXGIAdapter1> Adapter;
+
+	if (InDriverType == D3D_DRIVER_TYPE_HARDWARE)
+	{
+		Adapter = SelectAdapter(InAdapterIndex);
+	}
+
+	// A D3D11.0 runtime rejects the whole list for knowing no 11_1, it is asked again for 11_0 alone.
+	constexpr std::array FeatureLevels {D3D_FEATURE_LEVEL_11_1, D3D_FEATURE_LEVEL_11_0};
+
+	const auto Create = [&](const std::span<const D3D_FEATURE_LEVEL> InFeatureLevels)
+	{
+		return D3D11CreateDevice
+		(
+			Adapter.Get(),
+			Adapter ? D3D_DRIVER_TYPE_UNKNOWN : InDriverType,
+			nullptr,
+			CreateFlags,
+			InFeatureLevels.data(),
+			static_cast<UINT>(InFeatureLevels.size()),
+			D3D11_SDK_VERSION,
+			&OutPrerequisites.Device,
+			nullptr,
+			&OutPrerequisites.DeviceContext
+		);
+	};
+
+	const auto CreateAnyLevel = [&]
+	{
+		const auto Created = Create(FeatureLevels);
+		return Created == E_INVALIDARG ? Create(std::span(FeatureLevels).subspan(1u)) : Created;
+	};
+
+	CHECK_HRESULT_EXCEPTION(CreateAnyLevel())
+}
+
+void Graphics::ProbeCapabilities()
+{
+	Microsoft::WRL::ComPtr<IDXGIDevice> DXGIDevice;
+	Microsoft::WRL::ComPtr<IDXGIAdapter> Adapter;
+	DXGI_ADAPTER_DESC AdapterDesc;
+
+	if (SUCCEEDED(Device.As(&DXGIDevice)) && SUCCEEDED(DXGIDevice->GetAdapter(&Adapter)))
+	{
+		Adapter.As(&Adapter3);
+
+		if (SUCCEEDED(Adapter->GetDesc(&AdapterDesc)))
+		{
+			Capabilities.AdapterName = ToAdapterName(AdapterDesc.Description);
+			Capabilities.DedicatedVideoBytes = AdapterDesc.DedicatedVideoMemory;
+		}
+	}
+
+	Capabilities.FeatureLevel = Device->GetFeatureLevel();
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS Options {};
+	if (SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &Options, sizeof(Options))))
+	{
+		Capabilities.bHasConstantBufferOffsetting = Options.ConstantBufferOffsetting && Options.MapNoOverwriteOnDynamicConstantBuffer;
+	}
+
+	D3D11_FEATURE_DATA_THREADING Threading {};
+	if (SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &Threading, sizeof(Threading))))
+	{
+		Capabilities.bHasDriverCommandLists = Threading.DriverCommandLists != FALSE;
+	}
+
+	D3D11_FEATURE_DATA_SHADER_MIN_PRECISION_SUPPORT MinPrecision {};
+	if (SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_SHADER_MIN_PRECISION_SUPPORT, &MinPrecision, sizeof(MinPrecision))))
+	{
+		Capabilities.bHasHalfPrecisionPixel = (MinPrecision.PixelShaderMinPrecision & D3D11_SHADER_MIN_PRECISION_16_BIT) != 0u;
+		Capabilities.bHasHalfPrecisionOther = (MinPrecision.AllOtherShaderStagesMinPrecision & D3D11_SHADER_MIN_PRECISION_16_BIT) != 0u;
+	}
+
+	// Each of the later options fails on runtimes that predate it, leaving what it reports off.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS1 Options1 {};
+	if (SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS1, &Options1, sizeof(Options1))))
+	{
+		Capabilities.TiledResourcesTier = Options1.TiledResourcesTier;
+	}
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS2 Options2 {};
+	if (SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS2, &Options2, sizeof(Options2))))
+	{
+		Capabilities.TiledResourcesTier = std::max(Capabilities.TiledResourcesTier, Options2.TiledResourcesTier);
+		Capabilities.bHasTypedUavLoadAdditionalFormats = Options2.TypedUAVLoadAdditionalFormats != FALSE;
+		Capabilities.bHasRasterizerOrderedViews = Options2.ROVsSupported != FALSE;
+		Capabilities.ConservativeRasterizationTier = Options2.ConservativeRasterizationTier;
+		Capabilities.bHasUnifiedMemory = Options2.UnifiedMemoryArchitecture != FALSE;
+	}
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS3 Options3 {};
+	if (SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS3, &Options3, sizeof(Options3))))
+	{
+		Capabilities.bHasViewportIndexFromVertexShader = Options3.VPAndRTArrayIndexFromAnyShaderFeedingRasterizer != FALSE;
+	}
+
+	// The additional formats are only the ones the format support also reports typed UAV loads for.
+	Capabilities.bHasSceneUavLoads = Capabilities.bHasTypedUavLoadAdditionalFormats;
+
+	for (const auto Format : {DXGI_FORMAT_R11G11B10_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT})
+	{
+		D3D11_FEATURE_DATA_FORMAT_SUPPORT2 FormatSupport {Format, 0u};
+		Capabilities.bHasSceneUavLoads = Capabilities.bHasSceneUavLoads &&
+		                                 SUCCEEDED(Device->CheckFeatureSupport(D3D11_FEATURE_FORMAT_SUPPORT2, &FormatSupport, sizeof(FormatSupport))) &&
+		                                 (FormatSupport.OutFormatSupport2 & D3D11_FORMAT_SUPPORT2_UAV_TYPED_LOAD) != 0u;
+	}
+
+	LOG_INFO("Rendering on {} at feature level {}.{}, tiled resources tier {}, typed UAV loads {}, ROVs {}, 16-bit pixel shaders {}",
+	         Capabilities.AdapterName, Capabilities.FeatureLevel >> 12, (Capabilities.FeatureLevel >> 8) & 0xF,
+	         static_cast<int>(Capabilities.TiledResourcesTier), Capabilities.bHasTypedUavLoadAdditionalFormats ? "yes" : "no",
+	         Capabilities.bHasRasterizerOrderedViews ? "yes" : "no", Capabilities.bHasHalfPrecisionPixel ? "yes" : "no");
+}
+
+void Graphics::Initialize(ID3D11Resource* InDisplayTarget, const int InWidth, const int InHeight, const DXGI_FORMAT InSceneFormat, const UINT InSampleNum,
+                          std::unique_ptr<ShaderBundle> InShaderBundle)
+{
+	STARTUP_PHASE("Graphics subsystems");
+	HRESULT ResultHandle;
+
+	ProbeCapabilities();
+
+	// Constant buffer offsetting needs a D3D11.1 runtime and driver support, otherwise keep one buffer per bindable.
+	bIsConstantBufferRingSupported = Capabilities.bHasConstantBufferOffsetting;
+
+	ImmediateContext = CreateRenderContext(DeviceContext);
+	MyReleaseQueue = std::make_unique<ReleaseQueue>(Device.Get(), DeviceContext.Get());
+
+	// Without driver command lists the runtime emulates them, which rarely beats recording on one thread.
+	bIsDriverCommandListSupported = Capabilities.bHasDriverCommandLists;
+
+	if (!bIsDriverCommandListSupported)
+	{
+		MyRenderQueue->DisableMultithreadedRecording();
+	}
+
+	// Desktop drivers mostly report 32-bit only and run min16float at full precision anyway, the variants only pay off elsewhere.
+	bIsHalfPrecisionSupported = Capabilities.bHasHalfPrecisionPixel;
+	bUsesHalfPrecision = bIsHalfPrecisionSupported;
+
+	// One slice for every job system worker and one for the main thread helping while it waits.
+	const auto DeferredContextNum = std::clamp(JobSystem::Get().GetWorkerNum() + 1u, 1u, MaxDeferredContextNum);
+	for (unsigned int Index = 0u; Index < DeferredContextNum; ++Index)
+	{
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> DeferredContext;
+		CHECK_HRESULT_EXCEPTION(Device->CreateDeferredContext(0u, &DeferredContext))
+		DeferredContexts.push_back(CreateRenderContext(DeferredContext));
+	}
+
+	// One read for every shader up front, instead of a file open on each first use.
+	MyShaderBundle = std::move(InShaderBundle);
+	MyGpuProfiler = std::make_unique<GpuProfiler>(Device.Get(), DeviceContext.Get());
+
+	assert((InSceneFormat == DXGI_FORMAT_R11G11B10_FLOAT || InSceneFormat == DXGI_FORMAT_R16G16B16A16_FLOAT) && "The scene target needs a float format");
+
+	SceneFormat = InSceneFormat;
+	SampleNum = SelectSampleNum(InSceneFormat, InSampleNum);
 
 	D3D11_DEPTH_STENCIL_DESC DepthStencilDesc {};
 	DepthStencilDesc.DepthEnable = TRUE;
 	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
 	DepthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
 
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> DepthStencilState;
 	CHECK_HRESULT_EXCEPTION(Device->CreateDepthStencilState(&DepthStencilDesc, &DepthStencilState));
 
-	DeviceContext->OMSetDepthStencilState(DepthStencilState.Get(), 1u);
+	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DepthStencilDesc.DepthFunc = D3D11_COMPARISON_EQUAL;
+
+	CHECK_HRESULT_EXCEPTION(Device->CreateDepthStencilState(&DepthStencilDesc, &EqualDepthStencilState));
+
+	CreateTargets(InDisplayTarget, InWidth, InHeight);
+
+	if (SampleNum > 1u)
+	{
+		const auto DepthResolveBlob = MyShaderBundle->Load("DepthResolveCS.cso");
+		CHECK_HRESULT_EXCEPTION(Device->CreateComputeShader(DepthResolveBlob->GetBufferPointer(), DepthResolveBlob->GetBufferSize(), nullptr, &DepthResolveShader));
+	}
+
+	MyOcclusionCuller = std::make_unique<OcclusionCuller>(Device.Get(), *MyShaderBundle, DepthShaderResourceView.Get(), InWidth, InHeight);
+	MyOcclusionPredication = std::make_unique<OcclusionPredication>(Device.Get(), *MyShaderBundle);
+	MyGpuScene = std::make_unique<GpuScene>(Device.Get(), *MyShaderBundle);
+	MyMaterialTable = std::make_unique<MaterialTable>(Device.Get());
+	MyInstanceCuller = std::make_unique<InstanceCuller>(Device.Get(), *MyShaderBundle, *MyGpuScene);
+	MyMeshletCuller = std::make_unique<MeshletCuller>(Device.Get(), *MyShaderBundle);
+	MyParticleSystem = std::make_unique<ParticleSystem>(Device.Get(), *MyShaderBundle);
+	MyDebugDraw = std::make_unique<DebugDraw>(Device.Get(), *MyShaderBundle);
+	MyObjectPicker = std::make_unique<ObjectPicker>(Device.Get(), *MyShaderBundle);
+	MyClusteredLighting = std::make_unique<ClusteredLighting>(Device.Get(), *MyShaderBundle);
+	MyDecalAtlas = std::make_unique<DecalAtlas>(Device.Get());
+	MyPointLightShadows = std::make_unique<PointLightShadows>(Device.Get(), *MyShaderBundle);
+	MyDirectionalLight = std::make_unique<DirectionalLight>(Device.Get());
+	MyPipelineWarmup = std::make_unique<PipelineWarmup>(*this, Device.Get());
+	MyUploadManager = std::make_unique<UploadManager>(Device.Get(), DeviceContext.Get());
+	MyGeometryPool = std::make_unique<GeometryPool>(Device.Get(), *MyUploadManager);
+	MyTextureStreamer = std::make_unique<TextureStreamer>(Device.Get(), DeviceContext.Get(), *MyUploadManager);
+	MyPostProcessor = std::make_unique<PostProcessor>(Device.Get(), *MyShaderBundle, InWidth, InHeight);
+	MyTemporalAntiAliasing = std::make_unique<TemporalAntiAliasing>(Device.Get(), *MyShaderBundle, DepthShaderResourceView.Get(), SceneView.Get(),
+	                                                                SceneFormat, InWidth, InHeight, SampleNum);
+	MyRenderGraph = std::make_unique<RenderGraph>(Device.Get());
+	MyDeferredShading = std::make_unique<DeferredShading>(Device.Get(), *MyShaderBundle, DepthShaderResourceView.Get(), SceneUav.Get(), InWidth, InHeight);
+	MyOrderIndependentTransparency = std::make_unique<OrderIndependentTransparency>(Device.Get(), *MyShaderBundle, InWidth, InHeight, SampleNum);
+	MyDebugViews = std::make_unique<DebugViews>(Device.Get(), *MyShaderBundle, InWidth, InHeight, SampleNum);
+	MyAmbientOcclusion = std::make_unique<AmbientOcclusion>(Device.Get(), *MyShaderBundle, DepthShaderResourceView.Get(), InWidth, InHeight);
+	MyVolumetricFog = std::make_unique<VolumetricFog>(Device.Get(), *MyShaderBundle, DepthShaderResourceView.Get());
+	MyImageBasedLighting = std::make_unique<ImageBasedLighting>(Device.Get(), *MyShaderBundle);
+	MyReflectionProbes = std::make_unique<ReflectionProbes>(Device.Get());
+	MyIrradianceVolume = std::make_unique<IrradianceVolume>(Device.Get(), *MyShaderBundle);
+	MyImpostorBaker = std::make_unique<ImpostorBaker>();
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> DisplayTexture;
+	CHECK_HRESULT_EXCEPTION(InDisplayTarget->QueryInterface(IID_PPV_ARGS(&DisplayTexture)))
+	MyFrameCapture = std::make_unique<FrameCapture>(Device.Get(), DisplayTexture.Get());
+	MyCommandRecorder = std::make_unique<CommandRecorder>();
+
+	D3D11_BUFFER_DESC FrameConstantBufferDesc {};
+	FrameConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	FrameConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	FrameConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	FrameConstantBufferDesc.ByteWidth = sizeof(FrameConstants);
+	CHECK_HRESULT_EXCEPTION(Device->CreateBuffer(&FrameConstantBufferDesc, nullptr, &FrameConstantBuffer))
+
+	BindFrameState(*ImmediateContext);
+}
+
+void Graphics::CreateTargets(ID3D11Resource* InDisplayTarget, const int InWidth, const int InHeight)
+{
+	HRESULT ResultHandle;
+
+	// The post-processing chain encodes to sRGB itself, the flip model back buffer is written as it is.
+	CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView(InDisplayTarget, nullptr, &DisplayTargetView))
+
+	D3D11_TEXTURE2D_DESC SceneTextureDesc {};
+	SceneTextureDesc.Width = InWidth;
+	SceneTextureDesc.Height = InHeight;
+	SceneTextureDesc.MipLevels = 1u;
+	SceneTextureDesc.ArraySize = 1u;
+	SceneTextureDesc.Format = SceneFormat;
+	SceneTextureDesc.SampleDesc.Count = 1u;
+	SceneTextureDesc.SampleDesc.Quality = 0u;
+	SceneTextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	// Deferred lighting writes it from a compute shader.
+	SceneTextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&SceneTextureDesc, nullptr, &SceneTexture))
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(SceneTexture.Get(), nullptr, &SceneView))
+	CHECK_HRESULT_EXCEPTION(Device->CreateUnorderedAccessView(SceneTexture.Get(), nullptr, &SceneUav))
+
+	if (SampleNum > 1u)
+	{
+		// Only ever drawn into, ResolveScene hands it to post-processing.
+		auto MultisampledSceneDesc = SceneTextureDesc;
+		MultisampledSceneDesc.SampleDesc.Count = SampleNum;
+		MultisampledSceneDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+		CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&MultisampledSceneDesc, nullptr, &MultisampledSceneTexture))
+		CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView(MultisampledSceneTexture.Get(), nullptr, &RenderTargetView))
+	}
+	else
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView(SceneTexture.Get(), nullptr, &RenderTargetView))
+	}
 
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> DepthStencilTexture;
 	D3D11_TEXTURE2D_DESC DepthStencilTextureDesc {};
@@ -80,75 +479,1122 @@ Graphics::Graphics(HWND InWindowHandle, int InWidth, int InHeight)
 	DepthStencilTextureDesc.Height = InHeight;
 	DepthStencilTextureDesc.MipLevels = 1u;
 	DepthStencilTextureDesc.ArraySize = 1u;
-	DepthStencilTextureDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	DepthStencilTextureDesc.SampleDesc.Count = 1u;
+	// Typeless so the occlusion culler can read it back as R32_FLOAT.
+	DepthStencilTextureDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	DepthStencilTextureDesc.SampleDesc.Count = SampleNum;
 	DepthStencilTextureDesc.SampleDesc.Quality = 0u;
 	DepthStencilTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	DepthStencilTextureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	DepthStencilTextureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&DepthStencilTextureDesc, nullptr, &DepthStencilTexture));
 
 	D3D11_DEPTH_STENCIL_VIEW_DESC DepthStencilViewDesc {};
 	DepthStencilViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	DepthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	DepthStencilViewDesc.ViewDimension = SampleNum > 1u ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
 	DepthStencilViewDesc.Texture2D.MipSlice = 0u;
 	CHECK_HRESULT_EXCEPTION(Device->CreateDepthStencilView(DepthStencilTexture.Get(), &DepthStencilViewDesc, &DepthStencilView));
 
-	DeviceContext->OMSetRenderTargets(1u, RenderTargetView.GetAddressOf(), DepthStencilView.Get());
+	D3D11_SHADER_RESOURCE_VIEW_DESC DepthShaderResourceViewDesc {};
+	DepthShaderResourceViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	DepthShaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	DepthShaderResourceViewDesc.Texture2D.MipLevels = 1u;
 
-	D3D11_VIEWPORT Viewport;
-	Viewport.Width = static_cast<float>(InWidth);
-	Viewport.Height = static_cast<float>(InHeight);
-	Viewport.MinDepth = 0.0f;
-	Viewport.MaxDepth = 1.0f;
-	Viewport.TopLeftX = 0.0f;
-	Viewport.TopLeftY = 0.0f;
-	DeviceContext->RSSetViewports(1u, &Viewport);
+	if (SampleNum > 1u)
+	{
+		// Depth can't go through ResolveSubresource, DepthResolveCS.hlsl resolves it into a plain R32_FLOAT copy.
+		D3D11_SHADER_RESOURCE_VIEW_DESC MultisampledDepthViewDesc {};
+		MultisampledDepthViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		MultisampledDepthViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DMS;
+		CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(DepthStencilTexture.Get(), &MultisampledDepthViewDesc, &MultisampledDepthView));
 
-	ImGui_ImplDX11_Init(Device.Get(), DeviceContext.Get());
+		D3D11_TEXTURE2D_DESC ResolvedDepthDesc = DepthStencilTextureDesc;
+		ResolvedDepthDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		ResolvedDepthDesc.SampleDesc.Count = 1u;
+		ResolvedDepthDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> ResolvedDepthTexture;
+		CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&ResolvedDepthDesc, nullptr, &ResolvedDepthTexture));
+		CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(ResolvedDepthTexture.Get(), &DepthShaderResourceViewDesc, &DepthShaderResourceView));
+		CHECK_HRESULT_EXCEPTION(Device->CreateUnorderedAccessView(ResolvedDepthTexture.Get(), nullptr, &ResolvedDepthUav));
+
+		const size_t SceneBytesPerSample = SceneFormat == DXGI_FORMAT_R16G16B16A16_FLOAT ? 8u : 4u;
+		MultisampledBytes = static_cast<size_t>(InWidth) * InHeight * SampleNum * (SceneBytesPerSample + sizeof(float));
+	}
+	else
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(DepthStencilTexture.Get(), &DepthShaderResourceViewDesc, &DepthShaderResourceView));
+	}
+
+	DisplayViewport.Width = static_cast<float>(InWidth);
+	DisplayViewport.Height = static_cast<float>(InHeight);
+	DisplayViewport.MinDepth = 0.0f;
+	DisplayViewport.MaxDepth = 1.0f;
+	DisplayViewport.TopLeftX = 0.0f;
+	DisplayViewport.TopLeftY = 0.0f;
+	Viewport = DisplayViewport;
 }
 
 Graphics::~Graphics()
 {
-	ImGui_ImplDX11_Shutdown();
+	// Stopped first, a running pass holds references to cached shaders.
+	MyShaderReloader.reset();
+	// Likewise for the textures and the reimported models' buffers.
+	MyAssetReloader.reset();
+	// Cached bindables refer to the geometry pool and other subsystems destroyed along with this.
+	BindManager::Clear();
+	// So do the ones waiting for the GPU, it's idle by now.
+	MyReleaseQueue.reset();
+
+	if (SwapChain)
+	{
+		JobSystem::Get().Wait(FontAtlasBuilt);
+		ImGui_ImplDX11_Shutdown();
+		// A swap chain can't be released while it holds the output.
+		SwapChain->SetFullscreenState(FALSE, nullptr);
+	}
+
+	if (FrameLatencyWaitableObject)
+	{
+		CloseHandle(FrameLatencyWaitableObject);
+	}
 }
 
-void Graphics::EndFrame()
+UINT Graphics::SelectSampleNum(const DXGI_FORMAT InSceneFormat, const UINT InSampleNum) const
 {
-	if (bIsImGuiEnabled)
+	// Counts are powers of two, a count the device lacks falls back to the next lower one.
+	for (UINT Count = std::bit_floor(std::clamp(InSampleNum, 1u, static_cast<UINT>(D3D11_MAX_MULTISAMPLE_SAMPLE_COUNT))); Count > 1u; Count /= 2u)
 	{
-		ImGui::Render();
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		UINT SceneQualityNum = 0u;
+		UINT DepthQualityNum = 0u;
+
+		if (SUCCEEDED(Device->CheckMultisampleQualityLevels(InSceneFormat, Count, &SceneQualityNum)) && SceneQualityNum > 0u &&
+			SUCCEEDED(Device->CheckMultisampleQualityLevels(DXGI_FORMAT_D32_FLOAT, Count, &DepthQualityNum)) && DepthQualityNum > 0u)
+		{
+			return Count;
+		}
 	}
 
-	if (const HRESULT ResultHandle = SwapChain->Present(1u, 0u); FAILED(ResultHandle))
+	return 1u;
+}
+
+void Graphics::CreateSwapChain(HWND InWindowHandle, const int InWidth, const int InHeight, const SwapChainSettings& InSettings)
+{
+	STARTUP_PHASE("Swap chain");
+	HRESULT ResultHandle;
+
+	Microsoft::WRL::ComPtr<IDXGIDevice1> DXGIDevice;
+	Microsoft::WRL::ComPtr<IDXGIAdapter> Adapter;
+	Microsoft::WRL::ComPtr<IDXGIFactory2> Factory;
+	CHECK_HRESULT_EXCEPTION(Device.As(&DXGIDevice))
+	CHECK_HRESULT_EXCEPTION(DXGIDevice->GetAdapter(&Adapter))
+	EnumerateOutputs(Adapter.Get());
+
+	// Without it the output would stay in the desktop's mode, and the back buffers get stretched to it.
+	const UINT ModeSwitchFlag = InSettings.Fullscreen == FullscreenMode::Exclusive ? DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH : 0u;
+
+	/**
+	 * Flip model presents without the extra blit of DISCARD and is what tearing and the waitable object need.
+	 * https://learn.microsoft.com/en-us/windows/win32/direct3ddxgi/for-best-performance--use-dxgi-flip-model
+	 */
+	if (InSettings.bShouldUseFlipModel && SUCCEEDED(Adapter->GetParent(IID_PPV_ARGS(&Factory))))
 	{
-		
-		if (ResultHandle == DXGI_ERROR_DEVICE_REMOVED)
+		Microsoft::WRL::ComPtr<IDXGIFactory5> Factory5;
+		BOOL bAllowsTearing = FALSE;
+		bIsTearingSupported = SUCCEEDED(Factory.As(&Factory5)) &&
+							  SUCCEEDED(Factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &bAllowsTearing, sizeof(bAllowsTearing))) &&
+							  bAllowsTearing;
+
+		DXGI_SWAP_CHAIN_DESC1 SwapChainDesc {};
+		SwapChainDesc.Width = InWidth;
+		SwapChainDesc.Height = InHeight;
+		SwapChainDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+		SwapChainDesc.SampleDesc.Count = 1;
+		SwapChainDesc.SampleDesc.Quality = 0;
+		SwapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		SwapChainDesc.BufferCount = std::clamp(InSettings.BufferNum, 2u, static_cast<UINT>(DXGI_MAX_SWAP_CHAIN_BUFFERS));
+		SwapChainDesc.Scaling = DXGI_SCALING_STRETCH;
+		SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+		SwapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+		SwapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT | ModeSwitchFlag;
+
+		if (bIsTearingSupported)
 		{
-			throw HRESULT_EXCEPTION(Device->GetDeviceRemovedReason());
+			SwapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
 		}
-		else
+
+		Microsoft::WRL::ComPtr<IDXGISwapChain1> SwapChain1;
+		Microsoft::WRL::ComPtr<IDXGISwapChain2> SwapChain2;
+
+		// FLIP_DISCARD needs Windows 10, older systems fall back to the blit model below.
+		if (SUCCEEDED(Factory->CreateSwapChainForHwnd(Device.Get(), InWindowHandle, &SwapChainDesc, nullptr, nullptr, &SwapChain1)) &&
+			SUCCEEDED(SwapChain1.As(&SwapChain2)))
 		{
-			throw HRESULT_EXCEPTION(ResultHandle);
+			CHECK_HRESULT_EXCEPTION(SwapChain2->SetMaximumFrameLatency(std::max(InSettings.MaximumFrameLatency, 1u)))
+			FrameLatencyWaitableObject = SwapChain2->GetFrameLatencyWaitableObject();
+			SwapChain = SwapChain1;
+
+			// Tearing in a window needs DXGI to stay out of fullscreen transitions.
+			Factory->MakeWindowAssociation(InWindowHandle, DXGI_MWA_NO_ALT_ENTER);
+			return;
 		}
+
+		bIsTearingSupported = false;
 	}
+
+	Microsoft::WRL::ComPtr<IDXGIFactory> LegacyFactory;
+	CHECK_HRESULT_EXCEPTION(Adapter->GetParent(IID_PPV_ARGS(&LegacyFactory)))
+
+	DXGI_SWAP_CHAIN_DESC SwapChainDesc {};
+	SwapChainDesc.BufferDesc.Width = InWidth;
+	SwapChainDesc.BufferDesc.Height = InHeight;
+	// Post-processing encodes to sRGB itself, so the blit model's back buffer is as plain as the flip model's.
+	SwapChainDesc.BufferDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	SwapChainDesc.BufferDesc.RefreshRate.Numerator = 0;
+	SwapChainDesc.BufferDesc.RefreshRate.Denominator = 0;
+	SwapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
+	SwapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
+	SwapChainDesc.SampleDesc.Count = 1;
+	SwapChainDesc.SampleDesc.Quality = 0;
+	SwapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	SwapChainDesc.BufferCount = 1;
+	SwapChainDesc.OutputWindow = InWindowHandle;
+	SwapChainDesc.Windowed = TRUE;
+	SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+	SwapChainDesc.Flags = ModeSwitchFlag;
+
+	CHECK_HRESULT_EXCEPTION(LegacyFactory->CreateSwapChain(Device.Get(), &SwapChainDesc, &SwapChain))
+	CHECK_HRESULT_EXCEPTION(DXGIDevice->SetMaximumFrameLatency(std::max(InSettings.MaximumFrameLatency, 1u)))
 }
 
-void Graphics::BeginFrame(const float InRed, const float InGreen, const float InBlue) const noexcept
+void Graphics::EnumerateOutputs(IDXGIAdapter* InAdapter)
 {
-	if (bIsImGuiEnabled)
+	Microsoft::WRL::ComPtr<IDXGIOutput> Output;
+
+	// https://learn.microsoft.com/en-us/windows/win32/api/dxgi/nf-dxgi-idxgiadapter-enumoutputs
+	for (UINT Index = 0u; InAdapter->EnumOutputs(Index, &Output) != DXGI_ERROR_NOT_FOUND; ++Index)
 	{
-		ImGui_ImplDX11_NewFrame();
-		ImGui_ImplWin32_NewFrame();
-		ImGui::NewFrame();
-	}
+		DXGI_OUTPUT_DESC OutputDesc;
+		UINT ModeNum = 0u;
 
-	const float Color[] = {InRed, InGreen, InBlue, 1.0f};
-	DeviceContext->ClearRenderTargetView(RenderTargetView.Get(), Color);
-	DeviceContext->ClearDepthStencilView(DepthStencilView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+		if (FAILED(Output->GetDesc(&OutputDesc)) || FAILED(Output->GetDisplayModeList(DXGI_FORMAT_B8G8R8A8_UNORM, 0u, &ModeNum, nullptr)))
+		{
+			continue;
+		}
+
+		auto& Listed = Outputs.emplace_back(DisplayOutput {Output, OutputDesc.DesktopCoordinates, std::vector<DXGI_MODE_DESC>(ModeNum)});
+
+		// A mode change between the two calls leaves the list empty, exclusive mode then stays windowed on it.
+		if (FAILED(Output->GetDisplayModeList(DXGI_FORMAT_B8G8R8A8_UNORM, 0u, &ModeNum, Listed.Modes.data())))
+		{
+			ModeNum = 0u;
+		}
+
+		Listed.Modes.resize(ModeNum);
+	}
 }
 
-void Graphics::DrawIndexed(UINT InCount) const
+void Graphics::EnterExclusiveFullscreen(const SwapChainSettings& InSettings)
 {
-	CHECK_INFO_EXCEPTION(DeviceContext->DrawIndexed(InCount, 0u, 0u))
+	MyFullscreenMode = FullscreenMode::Windowed;
+
+	if (InSettings.OutputIndex >= Outputs.size())
+	{
+		return;
+	}
+
+	const auto& Target = Outputs[InSettings.OutputIndex];
+	const auto DesktopWidth = static_cast<UINT>(Target.DesktopRect.right - Target.DesktopRect.left);
+	const auto DesktopHeight = static_cast<UINT>(Target.DesktopRect.bottom - Target.DesktopRect.top);
+	const DXGI_MODE_DESC* Chosen = nullptr;
+	float ChosenError = 0.0f;
+
+	for (const auto& Mode : Target.Modes)
+	{
+		if (Mode.Width != DesktopWidth || Mode.Height != DesktopHeight || Mode.RefreshRate.Denominator == 0u)
+		{
+			continue;
+		}
+
+		const auto Rate = static_cast<float>(Mode.RefreshRate.Numerator) / static_cast<float>(Mode.RefreshRate.Denominator);
+		const auto Error = InSettings.RefreshRate > 0.0f ? std::abs(Rate - InSettings.RefreshRate) : -Rate;
+
+		if (!Chosen || Error < ChosenError)
+		{
+			Chosen = &Mode;
+			ChosenError = Error;
+		}
+	}
+
+	if (!Chosen)
+	{
+		return;
+	}
+
+	/**
+	 * The mode goes first so the output only switches once, the WM_SIZE that follows has the window resize the buffers.
+	 * https://learn.microsoft.com/en-us/windows/win32/direct3darticles/dxgi-best-practices#full-screen-issues
+	 */
+	if (SUCCEEDED(SwapChain->ResizeTarget(Chosen)) && SUCCEEDED(SwapChain->SetFullscreenState(TRUE, Target.Output.Get())))
+	{
+		MyFullscreenMode = FullscreenMode::Exclusive;
+	}
+}
+
+FullscreenMode Graphics::GetFullscreenMode() const
+{
+	BOOL bIsFullscreen = FALSE;
+
+	if (MyFullscreenMode == FullscreenMode::Exclusive && (FAILED(SwapChain->GetFullscreenState(&bIsFullscreen, nullptr)) || !bIsFullscreen))
+	{
+		return FullscreenMode::Windowed;
+	}
+
+	return MyFullscreenMode;
+}
+
+PresentationMode Graphics::QueryPresentationMode() const
+{
+	if (!SwapChain)
+	{
+		return PresentationMode::Unknown;
+	}
+
+	if (GetFullscreenMode() == FullscreenMode::Exclusive)
+	{
+		return PresentationMode::Exclusive;
+	}
+
+	// Only the flip model has the waitable object, the blit model always goes through DWM.
+	if (!FrameLatencyWaitableObject)
+	{
+		return PresentationMode::Composed;
+	}
+
+	// https://learn.microsoft.com/en-us/windows/win32/api/dxgi1_3/nf-dxgi1_3-idxgiswapchainmedia-getframestatisticsmedia
+	Microsoft::WRL::ComPtr<IDXGISwapChainMedia> Media;
+	DXGI_FRAME_STATISTICS_MEDIA Statistics {};
+
+	if (FAILED(SwapChain.As(&Media)) || FAILED(Media->GetFrameStatisticsMedia(&Statistics)))
+	{
+		return PresentationMode::Unknown;
+	}
+
+	switch (Statistics.CompositionMode)
+	{
+	case DXGI_FRAME_PRESENTATION_MODE_COMPOSED:
+		return PresentationMode::Composed;
+	case DXGI_FRAME_PRESENTATION_MODE_OVERLAY:
+		return PresentationMode::Overlay;
+	case DXGI_FRAME_PRESENTATION_MODE_NONE:
+		return PresentationMode::IndependentFlip;
+	default:
+		return PresentationMode::Unknown;
+	}
+}
+
+void Graphics::EndFrame()
+{
+	PROFILE_SCOPE("Graphics::EndFrame");
+
+	ResolveScene();
+
+	// Resolved into the history at the display's resolution, which is then all post-processing sees of the frame.
+	if (MyTemporalAntiAliasing->IsActive())
+	{
+		MyTemporalAntiAliasing->Resolve(*this);
+		MyPostProcessor->Apply(*this, DisplayTargetView.Get(), MyTemporalAntiAliasing->GetOutput(), DisplayViewport);
+	}
+	else
+	{
+		MyPostProcessor->Apply(*this, DisplayTargetView.Get(), SceneView.Get(), Viewport);
+	}
+
+	if (bIsImGuiFrame)
+	{
+		PROFILE_GPU_SCOPE(*this, "ImGui");
+		ImGui::Render();
+
+		if (MyImGuiOverlay)
+		{
+			MyImGuiOverlay->BeginRefresh(*this);
+			bIsImGuiCacheValid = true;
+		}
+		else
+		{
+			ImmediateContext->GetStateCache().SetRenderTarget(DisplayTargetView.Get(), nullptr);
+		}
+
+		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		bIsImGuiFrame = false;
+	}
+
+	if (bIsImGuiEnabled && MyImGuiOverlay && bIsImGuiCacheValid)
+	{
+		MyImGuiOverlay->Composite(*this, DisplayTargetView.Get());
+	}
+
+	// What the display shows from here on, UI and all.
+	MyFrameCapture->EndFrame(DeviceContext.Get());
+
+	// ImGui restores what it changes, only the targets differ from what the next frame expects.
+	BindFrameState(*ImmediateContext);
+
+	MyGpuProfiler->EndFrame();
+	// Reads back while the frame's bindables are still alive.
+	MyCommandRecorder->EndFrame(*this);
+	BindManager::Trim();
+	// Fenced after the frame's last command, including the releases Trim just retired.
+	MyReleaseQueue->EndFrame();
+
+#ifndef NDEBUG
+	// Whatever validation the sampled draws skipped over is reported here at the latest.
+	DXGIInfoManager::ReportDrawMessages(__FILE__, __LINE__);
+#endif
+
+	if (!SwapChain)
+	{
+		WaitForOffscreenFrame();
+		return;
+	}
+
+	// Tearing is only legal with a sync interval of zero, and not at all in exclusive mode, where that interval tears anyway.
+	const UINT SyncInterval = bIsVSyncEnabled ? 1u : 0u;
+	const UINT PresentFlags = !bIsVSyncEnabled && bIsTearingSupported && GetFullscreenMode() != FullscreenMode::Exclusive ? DXGI_PRESENT_ALLOW_TEARING : 0u;
+
+	const HRESULT ResultHandle = SwapChain->Present(SyncInterval, PresentFlags);
+
+	if (FAILED(ResultHandle))
+	{
+		if (ResultHandle == DXGI_ERROR_DEVICE_REMOVED)
+		{
+			throw HRESULT_EXCEPTION(Device->GetDeviceRemovedReason());
+		}
+		else
+		{
+			throw HRESULT_EXCEPTION(ResultHandle);
+		}
+	}
+
+	// A success code, the frame was simply not shown.
+	bIsOccluded = ResultHandle == DXGI_STATUS_OCCLUDED;
+}
+
+bool Graphics::CheckOccluded()
+{
+	if (!bIsOccluded || !SwapChain)
+	{
+		return false;
+	}
+
+	// https://learn.microsoft.com/en-us/windows/win32/direct3ddxgi/dxgi-present
+	const HRESULT ResultHandle = SwapChain->Present(0u, DXGI_PRESENT_TEST);
+
+	if (FAILED(ResultHandle))
+	{
+		throw HRESULT_EXCEPTION(ResultHandle == DXGI_ERROR_DEVICE_REMOVED ? Device->GetDeviceRemovedReason() : ResultHandle);
+	}
+
+	bIsOccluded = ResultHandle == DXGI_STATUS_OCCLUDED;
+	return bIsOccluded;
+}
+
+void Graphics::Resize(const int InWidth, const int InHeight)
+{
+	assert(SwapChain && "Only a swap chain's display can be resized");
+
+	if (static_cast<float>(InWidth) == DisplayViewport.Width && static_cast<float>(InHeight) == DisplayViewport.Height)
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("Graphics::Resize");
+
+	HRESULT ResultHandle;
+
+	// ResizeBuffers fails while anything still refers to the back buffers, including views bound to the context.
+	DeviceContext->ClearState();
+	DisplayTargetView.Reset();
+	MyFrameCapture->ReleaseDisplayTarget();
+
+	// The caches would skip binding new views that happen to reuse an old one's address.
+	for (const auto& Context : DeferredContexts)
+	{
+		Context->GetStateCache().Reset();
+	}
+
+	// Released objects are only destroyed once the context flushes, the old back buffers among them.
+	DeviceContext->Flush();
+
+	// https://learn.microsoft.com/en-us/windows/win32/api/dxgi/nf-dxgi-idxgiswapchain-resizebuffers
+	// Zero keeps the buffer count and unknown the format, the flags have to stay the ones the swap chain was created with.
+	DXGI_SWAP_CHAIN_DESC SwapChainDesc;
+	CHECK_HRESULT_EXCEPTION(SwapChain->GetDesc(&SwapChainDesc))
+	CHECK_HRESULT_EXCEPTION(SwapChain->ResizeBuffers(0u, InWidth, InHeight, DXGI_FORMAT_UNKNOWN, SwapChainDesc.Flags))
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> BackBuffer;
+	CHECK_HRESULT_EXCEPTION(SwapChain->GetBuffer(0u, __uuidof(ID3D11Resource), &BackBuffer))
+	CreateTargets(BackBuffer.Get(), InWidth, InHeight);
+
+	// Whatever the subsystems sized after the display, the rest doesn't depend on it.
+	const auto Width = static_cast<UINT>(InWidth);
+	const auto Height = static_cast<UINT>(InHeight);
+	MyOcclusionCuller->Resize(Device.Get(), DepthShaderResourceView.Get(), Width, Height);
+	MyPostProcessor->Resize(Device.Get(), Width, Height);
+	MyTemporalAntiAliasing->Resize(Device.Get(), DepthShaderResourceView.Get(), SceneView.Get(), Width, Height);
+	MyDeferredShading->Resize(DepthShaderResourceView.Get(), SceneUav.Get(), Width, Height);
+	MyOrderIndependentTransparency->Resize(Device.Get(), Width, Height);
+	MyDebugViews->Resize(Device.Get(), Width, Height);
+	MyAmbientOcclusion->Resize(Device.Get(), DepthShaderResourceView.Get(), Width, Height);
+	MyVolumetricFog->Resize(DepthShaderResourceView.Get());
+
+	if (MyVirtualTextureCache)
+	{
+		MyVirtualTextureCache->Resize(Width, Height);
+	}
+
+	// The G-buffer and the other transients are acquired at the new size from the next frame, the old ones would only wait to be trimmed.
+	MyRenderGraph->ReleasePool();
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> DisplayTexture;
+	CHECK_HRESULT_EXCEPTION(BackBuffer.As(&DisplayTexture))
+	MyFrameCapture->SetDisplayTarget(Device.Get(), DisplayTexture.Get());
+
+	if (MyImGuiOverlay)
+	{
+		MyImGuiOverlay = std::make_unique<ImGuiOverlay>(Device.Get(), *MyShaderBundle, Width, Height);
+		bIsImGuiCacheValid = false;
+	}
+
+	RestoreFrameState();
+}
+
+void Graphics::WaitForOffscreenFrame()
+{
+	// Without Present nothing stops the CPU from queueing frames, the event queries hold it to the same latency a swap chain would.
+	DeviceContext->End(FrameFences[OffscreenFrameNum % FrameFences.size()].Get());
+	++OffscreenFrameNum;
+
+	if (OffscreenFrameNum < FrameFences.size())
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("Graphics::WaitForFrameLatency");
+	auto* const OldestFence = FrameFences[OffscreenFrameNum % FrameFences.size()].Get();
+
+	while (DeviceContext->GetData(OldestFence, nullptr, 0u, 0u) == S_FALSE)
+	{
+		std::this_thread::yield();
+	}
+}
+
+Surface Graphics::CaptureFrame() const
+{
+	assert(OffscreenTarget && "Only offscreen frames can be captured");
+
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC StagingDesc;
+	OffscreenTarget->GetDesc(&StagingDesc);
+	StagingDesc.Usage = D3D11_USAGE_STAGING;
+	StagingDesc.BindFlags = 0u;
+	StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> StagingTexture;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&StagingDesc, nullptr, &StagingTexture))
+	DeviceContext->CopyResource(StagingTexture.Get(), OffscreenTarget.Get());
+
+	// Blocks until the GPU has finished the frame, captures are for golden images and not for the measured loop.
+	D3D11_MAPPED_SUBRESOURCE Mapped;
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(StagingTexture.Get(), 0u, D3D11_MAP_READ, 0u, &Mapped))
+
+	// B8G8R8A8 is the Surface::Color layout, only the row pitch differs. The bytes are sRGB encoded, as they would be shown.
+	Surface Frame {StagingDesc.Width, StagingDesc.Height};
+	const auto RowBytes = StagingDesc.Width * sizeof(Surface::Color);
+
+	for (UINT Row = 0u; Row < StagingDesc.Height; ++Row)
+	{
+		std::memcpy(Frame.GetBufferPtr() + static_cast<size_t>(Row) * StagingDesc.Width, static_cast<const BYTE*>(Mapped.pData) + static_cast<size_t>(Row) * Mapped.RowPitch, RowBytes);
+	}
+
+	DeviceContext->Unmap(StagingTexture.Get(), 0u);
+
+	return Frame;
+}
+
+void Graphics::SetImGuiRefreshRate(const float InRefreshRate)
+{
+	ImGuiRefreshRate = std::max(InRefreshRate, 0.0f);
+
+	if (ImGuiRefreshRate == 0.0f)
+	{
+		MyImGuiOverlay.reset();
+		return;
+	}
+
+	if (!MyImGuiOverlay)
+	{
+		MyImGuiOverlay = std::make_unique<ImGuiOverlay>(Device.Get(), *MyShaderBundle, static_cast<UINT>(DisplayViewport.Width), static_cast<UINT>(DisplayViewport.Height));
+		bIsImGuiCacheValid = false;
+	}
+}
+
+bool Graphics::IsImGuiRefreshDue() noexcept
+{
+	if (!MyImGuiOverlay)
+	{
+		return true;
+	}
+
+	if (ImGuiManager::ConsumeInput())
+	{
+		ImGuiSettleFramesLeft = ImGuiSettleFrameNum;
+	}
+
+	if (bIsImGuiCacheValid && ImGuiSettleFramesLeft == 0u && ImGuiRefreshTimer.Peek() * ImGuiRefreshRate < 1.0f)
+	{
+		return false;
+	}
+
+	ImGuiSettleFramesLeft -= ImGuiSettleFramesLeft > 0u ? 1u : 0u;
+	ImGuiRefreshTimer.Mark();
+	return true;
+}
+
+void Graphics::EnableDynamicResolution(const float InTargetMilliseconds) noexcept
+{
+	MyDynamicResolution.SetTargetFrameTime(InTargetMilliseconds);
+	bIsDynamicResolutionEnabled = true;
+}
+
+void Graphics::EnableVirtualTextures()
+{
+	if (MyVirtualTextureCache)
+	{
+		return;
+	}
+
+	// Tier 1 has no way to clamp a sample to the resident levels.
+	Microsoft::WRL::ComPtr<ID3D11Device2> Device2;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext2> DeviceContext2;
+
+	if (Capabilities.TiledResourcesTier < D3D11_TILED_RESOURCES_TIER_2 || FAILED(Device.As(&Device2)) || FAILED(DeviceContext.As(&DeviceContext2)))
+	{
+		LOG_WARNING("Virtual textures need tiled resources tier 2, the device has tier {}, textures stream whole levels instead",
+		            static_cast<int>(Capabilities.TiledResourcesTier));
+		return;
+	}
+
+	MyVirtualTextureCache = std::make_unique<VirtualTextureCache>(Device2.Get(), DeviceContext2.Get(), *MyTextureStreamer,
+	                                                              static_cast<UINT>(DisplayViewport.Width), static_cast<UINT>(DisplayViewport.Height));
+}
+
+void Graphics::SetLodErrorScale(const float InScale) noexcept
+{
+	LodErrorScale = std::max(InScale, 0.1f);
+}
+
+void Graphics::EnableStateFiltering() noexcept
+{
+	ImmediateContext->GetStateCache().EnableFiltering();
+
+	for (const auto& Context : DeferredContexts)
+	{
+		Context->GetStateCache().EnableFiltering();
+	}
+}
+
+void Graphics::DisableStateFiltering() noexcept
+{
+	ImmediateContext->GetStateCache().DisableFiltering();
+
+	for (const auto& Context : DeferredContexts)
+	{
+		Context->GetStateCache().DisableFiltering();
+	}
+}
+
+void Graphics::EnableConstantBufferRing() noexcept
+{
+	ImmediateContext->SetConstantBufferRingEnabled(true);
+
+	for (const auto& Context : DeferredContexts)
+	{
+		Context->SetConstantBufferRingEnabled(true);
+	}
+}
+
+void Graphics::DisableConstantBufferRing() noexcept
+{
+	ImmediateContext->SetConstantBufferRingEnabled(false);
+
+	for (const auto& Context : DeferredContexts)
+	{
+		Context->SetConstantBufferRingEnabled(false);
+	}
+}
+
+void Graphics::SetShadowMapSize(const UINT InSize)
+{
+	MyDirectionalLight->SetMapSize(Device.Get(), InSize);
+}
+
+void Graphics::DisableDynamicResolution() noexcept
+{
+	bIsDynamicResolutionEnabled = false;
+	MyDynamicResolution.Reset();
+}
+
+void Graphics::UpdateResolutionScale() noexcept
+{
+	const auto ResolvedFrameNum = MyGpuProfiler->GetTotalResolvedFrameNum();
+
+	// The whole-frame scope is always the first one.
+	if (bIsDynamicResolutionEnabled && ResolvedFrameNum != MeasuredGpuFrameNum && !MyGpuProfiler->GetLastTimings().empty())
+	{
+		MyDynamicResolution.Update(MyGpuProfiler->GetLastTimings().front().Milliseconds);
+	}
+
+	MeasuredGpuFrameNum = ResolvedFrameNum;
+
+	// Whole pixels, so the upscale maps the same texels onto the display from frame to frame.
+	const auto Scale = MyDynamicResolution.GetScale();
+	Viewport.Width = std::max(std::round(DisplayViewport.Width * Scale), 1.0f);
+	Viewport.Height = std::max(std::round(DisplayViewport.Height * Scale), 1.0f);
+}
+
+void Graphics::BeginFrame(const float InRed, const float InGreen, const float InBlue)
+{
+	PROFILE_SCOPE("Graphics::BeginFrame");
+
+	// Blocks until the swap chain can queue another frame, so input is sampled as late as the frame latency allows.
+	if (FrameLatencyWaitableObject)
+	{
+		PROFILE_SCOPE("Graphics::WaitForFrameLatency");
+		WaitForSingleObjectEx(FrameLatencyWaitableObject, 1000u, TRUE);
+	}
+
+	MyGpuProfiler->BeginFrame();
+	MyFrameArena->BeginFrame();
+
+	// Last frame's EndFrame bound the frame state with the old viewport.
+	UpdateResolutionScale();
+	DeviceContext->RSSetViewports(1u, &Viewport);
+	MyGpuProfiler->SetPixelNum(static_cast<unsigned int>(Viewport.Width * Viewport.Height));
+
+	// Nothing is recording yet, so shaders can change under the bindables.
+	if (MyShaderReloader)
+	{
+		MyShaderReloader->Apply();
+	}
+
+	// And the textures reloaded from changed files, the instances of reimported models swap during the frame.
+	if (MyAssetReloader)
+	{
+		MyAssetReloader->Apply();
+	}
+
+	// Likewise for the texture views streamed levels are swapped into, and the tiles paged in.
+	MyTextureStreamer->Update();
+
+	if (MyVirtualTextureCache)
+	{
+		MyVirtualTextureCache->Update();
+	}
+
+	bIsImGuiFrame = bIsImGuiEnabled && IsImGuiRefreshDue();
+
+	if (bIsImGuiFrame)
+	{
+		JobSystem::Get().Wait(FontAtlasBuilt);
+		ImGui_ImplDX11_NewFrame();
+
+		// The window procedure can be queueing events on the message thread meanwhile.
+		std::scoped_lock Lock {ImGuiManager::GetInputMutex()};
+		ImGui_ImplWin32_NewFrame();
+		ImGui::NewFrame();
+	}
+
+	ImmediateContext->GetStateCache().BeginFrame();
+
+	for (const auto& Context : DeferredContexts)
+	{
+		Context->GetStateCache().BeginFrame();
+	}
+
+	// A trace starts from default state, everything it replays is bound within it.
+	if (MyCommandRecorder->BeginFrame(*this))
+	{
+		DeviceContext->ClearState();
+		RestoreFrameState();
+	}
+
+	MyOcclusionCuller->BeginFrame();
+	MyGpuScene->BeginFrame();
+	MyInstanceCuller->BeginFrame();
+	MyMeshletCuller->BeginFrame();
+	MyClusteredLighting->BeginFrame();
+	MyPointLightShadows->BeginFrame();
+	MyImageBasedLighting->BeginFrame(*this);
+	MyReflectionProbes->BeginFrame(*this);
+	MyIrradianceVolume->BeginFrame(*this);
+	MyImpostorBaker->BeginFrame();
+
+	if (auto* const Ring = ImmediateContext->GetConstantBufferRing())
+	{
+		Ring->BeginFrame();
+	}
+
+	CameraMatrix = GetCamera().GetMatrix();
+	// Picks this frame's jitter, which only what is drawn sees. Culling, picking and LODs keep the projection as it was set.
+	MyTemporalAntiAliasing->BeginFrame(*this);
+	const auto DrawnProjection = MyTemporalAntiAliasing->Jitter(ProjectionMatrix);
+	ViewProjectionMatrix = CameraMatrix * DrawnProjection;
+	// Narrows the camera's view, so only once this frame's is known.
+	MyObjectPicker->BeginFrame(*this);
+	// Fits the cascades to this frame's view before models hand over casters for them.
+	MyDirectionalLight->BeginFrame(*this);
+	// Before models queue this frame's proxies.
+	MyOcclusionPredication->BeginFrame(*this);
+
+	// Transposed like every other matrix handed to the shaders.
+	MyFrameConstants.View = DirectX::XMMatrixTranspose(CameraMatrix);
+	MyFrameConstants.Projection = DirectX::XMMatrixTranspose(DrawnProjection);
+	MyFrameConstants.ViewProjection = DirectX::XMMatrixTranspose(ViewProjectionMatrix);
+	MyFrameConstants.CameraPosition = GetCamera().GetPosition();
+	MyFrameConstants.Time = StartTimer.Peek();
+	MyFrameConstants.EyeNum = 1u;
+	UploadFrameConstants(*ImmediateContext, MyFrameConstants);
+
+	// Parallel, apart along the camera's right.
+	if (bIsStereo)
+	{
+		const auto& Head = GetCamera();
+		const auto Right = DirectX::XMVector3Transform(DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f),
+		                                               DirectX::XMMatrixRotationRollPitchYaw(Head.GetPitch(), Head.GetYaw(), 0.0f));
+		const auto HeadPosition = Head.GetPosition();
+
+		for (size_t Eye = 0u; Eye < Eyes.size(); ++Eye)
+		{
+			DirectX::XMFLOAT3 EyePosition;
+			const auto Offset = (Eye == 0u ? -0.5f : 0.5f) * EyeSeparation;
+			DirectX::XMStoreFloat3(&EyePosition, DirectX::XMVectorMultiplyAdd(Right, DirectX::XMVectorReplicate(Offset), DirectX::XMLoadFloat3(&HeadPosition)));
+			Eyes[Eye].SetPose(EyePosition, Head.GetPitch(), Head.GetYaw());
+		}
+	}
+
+	ViewStates.resize(Views.size());
+	ViewFrustums.resize(Views.size());
+
+	for (size_t Index = 0u; Index < Views.size(); ++Index)
+	{
+		const auto& [ViewCamera, Left, Top, Width, Height] = Views[Index];
+		auto& [Constants, TileViewport] = ViewStates[Index];
+		TileViewport = {Viewport.TopLeftX + Left * Viewport.Width, Viewport.TopLeftY + Top * Viewport.Height, Width * Viewport.Width,
+		                Height * Viewport.Height, 0.0f, 1.0f};
+
+		// The camera's projection, only widened or narrowed to the tile's aspect.
+		DirectX::XMFLOAT4X4 Projection;
+		DirectX::XMStoreFloat4x4(&Projection, ProjectionMatrix);
+		Projection._11 = Projection._22 * TileViewport.Height / TileViewport.Width;
+		const auto TileProjection = DirectX::XMLoadFloat4x4(&Projection);
+		const auto ViewMatrix = ViewCamera->GetMatrix();
+
+		Constants = MyFrameConstants;
+		Constants.View = DirectX::XMMatrixTranspose(ViewMatrix);
+		Constants.Projection = DirectX::XMMatrixTranspose(TileProjection);
+		Constants.ViewProjection = DirectX::XMMatrixTranspose(ViewMatrix * TileProjection);
+		Constants.CameraPosition = ViewCamera->GetPosition();
+
+		ViewFrustums[Index] = DirectX::BoundingFrustum(TileProjection);
+		ViewFrustums[Index].Transform(ViewFrustums[Index], DirectX::XMMatrixInverse(nullptr, ViewMatrix));
+	}
+
+	if (bIsStereo)
+	{
+		StereoState.Constants = MyFrameConstants;
+		StereoState.Constants.EyeViewProjections[0] = ViewStates[0].Constants.ViewProjection;
+		StereoState.Constants.EyeViewProjections[1] = ViewStates[1].Constants.ViewProjection;
+		StereoState.Constants.EyeNum = 2u;
+		StereoState.Viewport = Viewport;
+	}
+
+	PROFILE_GPU_SCOPE(*this, "Clear");
+	const float Color[] = {InRed, InGreen, InBlue, 1.0f};
+	DeviceContext->ClearRenderTargetView(RenderTargetView.Get(), Color);
+	DeviceContext->ClearDepthStencilView(DepthStencilView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+}
+
+void Graphics::LatchView()
+{
+	if (IsMultiView())
+	{
+		return;
+	}
+
+	// The jitter BeginFrame picked, only the view moves.
+	CameraMatrix = GetCamera().GetMatrix();
+	ViewProjectionMatrix = CameraMatrix * MyTemporalAntiAliasing->Jitter(ProjectionMatrix);
+	MyTemporalAntiAliasing->LatchView(*this);
+
+	MyFrameConstants.View = DirectX::XMMatrixTranspose(CameraMatrix);
+	MyFrameConstants.ViewProjection = DirectX::XMMatrixTranspose(ViewProjectionMatrix);
+	MyFrameConstants.CameraPosition = GetCamera().GetPosition();
+	UploadFrameConstants(*ImmediateContext, MyFrameConstants);
+}
+
+void Graphics::BindFrameState(RenderContext& InContext) const noexcept
+{
+	InContext.GetStateCache().SetRasterizerState(nullptr);
+	InContext.GetStateCache().SetBlendState(nullptr);
+	InContext.GetStateCache().SetDepthStencilState(DepthStencilState.Get(), 1u);
+	InContext.GetStateCache().SetRenderTarget(RenderTargetView.Get(), DepthStencilView.Get());
+	const auto* const Active = GetActiveViewState();
+	InContext.GetDeviceContext()->RSSetViewports(1u, Active ? &Active->Viewport : &Viewport);
+	InContext.GetStateCache().SetVertexConstantBuffer(FrameConstantSlot, FrameConstantBuffer.Get());
+	InContext.GetStateCache().SetPixelConstantBuffer(FrameConstantSlot, FrameConstantBuffer.Get());
+	InContext.GetStateCache().SetHullConstantBuffer(FrameConstantSlot, FrameConstantBuffer.Get());
+	InContext.GetStateCache().SetDomainConstantBuffer(FrameConstantSlot, FrameConstantBuffer.Get());
+	MyMaterialTable->Bind(InContext);
+}
+
+void Graphics::BindRenderTargets(RenderContext& InContext, const std::span<ID3D11RenderTargetView* const> InTargets) const noexcept
+{
+	InContext.GetStateCache().SetRenderTargets(InTargets, DepthStencilView.Get());
+}
+
+void Graphics::BindSceneTarget(RenderContext& InContext) const noexcept
+{
+	InContext.GetStateCache().SetRenderTarget(RenderTargetView.Get(), nullptr);
+}
+
+void Graphics::OverrideViewConstants(RenderContext& InContext, DirectX::FXMMATRIX InView, DirectX::CXMMATRIX InProjection) const
+{
+	auto Constants = MyFrameConstants;
+	Constants.View = DirectX::XMMatrixTranspose(InView);
+	Constants.Projection = DirectX::XMMatrixTranspose(InProjection);
+	Constants.ViewProjection = DirectX::XMMatrixTranspose(InView * InProjection);
+	UploadFrameConstants(InContext, Constants);
+}
+
+void Graphics::OverrideViewConstants(RenderContext& InContext, DirectX::FXMMATRIX InView, DirectX::CXMMATRIX InProjection,
+                                     const DirectX::XMFLOAT3& InCameraPosition) const
+{
+	auto Constants = MyFrameConstants;
+	Constants.View = DirectX::XMMatrixTranspose(InView);
+	Constants.Projection = DirectX::XMMatrixTranspose(InProjection);
+	Constants.ViewProjection = DirectX::XMMatrixTranspose(InView * InProjection);
+	Constants.CameraPosition = InCameraPosition;
+	UploadFrameConstants(InContext, Constants);
+}
+
+void Graphics::RestoreViewConstants(RenderContext& InContext) const
+{
+	const auto* const Active = GetActiveViewState();
+	UploadFrameConstants(InContext, Active ? Active->Constants : MyFrameConstants);
+}
+
+void Graphics::SetViews(const std::span<const View> InViews)
+{
+	assert(InViews.size() <= MaxViewNum && "Each view needs a bit of the view masks");
+	Views.assign(InViews.begin(), InViews.end());
+	bIsStereo = false;
+}
+
+void Graphics::EnableStereo(const float InEyeSeparation)
+{
+	const View EyeViews[] {{&Eyes[0], 0.0f, 0.0f, 0.5f, 1.0f}, {&Eyes[1], 0.5f, 0.0f, 0.5f, 1.0f}};
+	Views.assign(std::begin(EyeViews), std::end(EyeViews));
+	EyeSeparation = InEyeSeparation;
+	bIsStereo = true;
+}
+
+void Graphics::DisableStereo() noexcept
+{
+	if (bIsStereo)
+	{
+		Views.clear();
+		bIsStereo = false;
+	}
+}
+
+uint32_t Graphics::GetViewMask(const DirectX::BoundingBox& InWorldBounds) const noexcept
+{
+	uint32_t Mask = 0u;
+
+	for (size_t Index = 0u; Index < ViewFrustums.size(); ++Index)
+	{
+		if (ViewFrustums[Index].Intersects(InWorldBounds))
+		{
+			Mask |= 1u << Index;
+		}
+	}
+
+	return Mask;
+}
+
+void Graphics::BeginView(const unsigned int InView) const
+{
+	ActiveView = InView;
+	UploadFrameConstants(*ImmediateContext, ViewStates[InView].Constants);
+	DeviceContext->RSSetViewports(1u, &ViewStates[InView].Viewport);
+}
+
+void Graphics::BeginStereo() const
+{
+	assert(bIsStereo && "Only stereo frames have both eyes' matrices");
+
+	ActiveView = StereoView;
+	UploadFrameConstants(*ImmediateContext, StereoState.Constants);
+	DeviceContext->RSSetViewports(1u, &StereoState.Viewport);
+}
+
+void Graphics::EndViews() const
+{
+	ActiveView = NoView;
+	UploadFrameConstants(*ImmediateContext, MyFrameConstants);
+	DeviceContext->RSSetViewports(1u, &Viewport);
+}
+
+const Graphics::ViewState* Graphics::GetActiveViewState() const noexcept
+{
+	if (ActiveView == NoView)
+	{
+		return nullptr;
+	}
+
+	return ActiveView == StereoView ? &StereoState : &ViewStates[ActiveView];
+}
+
+void Graphics::UploadFrameConstants(RenderContext& InContext, const FrameConstants& InConstants) const
+{
+	HRESULT ResultHandle;
+
+	D3D11_MAPPED_SUBRESOURCE MappedSubresource;
+	CHECK_HRESULT_EXCEPTION(InContext.GetDeviceContext()->Map(FrameConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedSubresource))
+
+	memcpy(MappedSubresource.pData, &InConstants, sizeof(InConstants));
+	InContext.GetDeviceContext()->Unmap(FrameConstantBuffer.Get(), 0u);
+	InContext.GetStateCache().CountUpload(sizeof(InConstants));
+}
+
+void Graphics::BindDepthTest(RenderContext& InContext, const DepthTest InDepthTest) const noexcept
+{
+	InContext.GetStateCache().SetDepthStencilState(InDepthTest == DepthTest::Equal ? EqualDepthStencilState.Get() : DepthStencilState.Get(), 1u);
+}
+
+void Graphics::ExecuteCommandList(ID3D11CommandList* InCommandList) const
+{
+	CHECK_INFO_EXCEPTION(DeviceContext->ExecuteCommandList(InCommandList, FALSE))
+
+	// The list's words go where it executes, ahead of the Reset restoring records.
+	if (MyCommandRecorder->IsRecording())
+	{
+		ImmediateContext->GetStateCache().AppendRecorded(MyCommandRecorder->TakeCommandList(InCommandList));
+	}
+
+	// Not restoring state is cheaper, the immediate context is left in default state instead.
+	RestoreFrameState();
+}
+
+void Graphics::Dispatch(const UINT InGroupNumX, const UINT InGroupNumY, const UINT InGroupNumZ) const noexcept
+{
+	DeviceContext->Dispatch(InGroupNumX, InGroupNumY, InGroupNumZ);
+	ClearComputeBindings();
+}
+
+void Graphics::DispatchIndirect(ID3D11Buffer* InArguments, const UINT InByteOffset) const noexcept
+{
+	DeviceContext->DispatchIndirect(InArguments, InByteOffset);
+	ClearComputeBindings();
+}
+
+void Graphics::ClearComputeBindings() const noexcept
+{
+	// A resource still bound as a compute UAV can't be read anywhere, and one still bound as an input can't be a target.
+	ID3D11ShaderResourceView* const NullViews[ComputeResourceSlotNum] {};
+	ID3D11UnorderedAccessView* const NullUavs[D3D11_PS_CS_UAV_REGISTER_COUNT] {};
+	DeviceContext->CSSetShaderResources(0u, ComputeResourceSlotNum, NullViews);
+	DeviceContext->CSSetUnorderedAccessViews(0u, D3D11_PS_CS_UAV_REGISTER_COUNT, NullUavs, nullptr);
+}
+
+void Graphics::RestoreFrameState() const noexcept
+{
+	ImmediateContext->GetStateCache().Reset();
+	BindFrameState(*ImmediateContext);
+}
+
+void Graphics::ResolveDepth() const
+{
+	if (SampleNum == 1u)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(*this, "MSAA depth resolve");
+
+	// Only the viewport's part was drawn this frame.
+	constexpr UINT GroupSize {8u};
+	const auto GroupNumX = (static_cast<UINT>(Viewport.Width) + GroupSize - 1u) / GroupSize;
+	const auto GroupNumY = (static_cast<UINT>(Viewport.Height) + GroupSize - 1u) / GroupSize;
+
+	ImmediateContext->GetStateCache().SetRenderTarget(nullptr, nullptr);
+	DeviceContext->CSSetShader(DepthResolveShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetShaderResources(0u, 1u, MultisampledDepthView.GetAddressOf());
+	DeviceContext->CSSetUnorderedAccessViews(0u, 1u, ResolvedDepthUav.GetAddressOf(), nullptr);
+	Dispatch(GroupNumX, GroupNumY);
+}
+
+void Graphics::ResolveScene() const
+{
+	if (SampleNum == 1u)
+	{
+		return;
+	}
+
+	// The hardware resolve averages the samples, fine for the lit values the scene holds.
+	PROFILE_GPU_SCOPE(*this, "MSAA resolve");
+	DeviceContext->ResolveSubresource(SceneTexture.Get(), 0u, MultisampledSceneTexture.Get(), 0u, SceneFormat);
+}
+
+StateCache::Statistics Graphics::GetStateStatistics() const noexcept
+{
+	auto Statistics = ImmediateContext->GetStateCache().GetStatistics();
+
+	for (const auto& Context : DeferredContexts)
+	{
+		Statistics += Context->GetStateCache().GetStatistics();
+	}
+
+	Statistics.ConstantBytes += GetFrameConstantBytes();
+	return Statistics;
+}
+
+DXGI_QUERY_VIDEO_MEMORY_INFO Graphics::QueryVideoMemory() const noexcept
+{
+	DXGI_QUERY_VIDEO_MEMORY_INFO Info {};
+
+	if (Adapter3)
+	{
+		Adapter3->QueryVideoMemoryInfo(0u, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &Info);
+	}
+
+	return Info;
+}
+
+std::unique_ptr<RenderContext> Graphics::CreateRenderContext(Microsoft::WRL::ComPtr<ID3D11DeviceContext> InContext) const
+{
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> Context1;
+	std::unique_ptr<ConstantBufferRing> Ring;
+
+	// Every context gets its own ring so workers never race on the ring cursor.
+	if (bIsConstantBufferRingSupported && SUCCEEDED(InContext.As(&Context1)))
+	{
+		Ring = std::make_unique<ConstantBufferRing>(Device.Get(), InContext.Get());
+	}
+	else
+	{
+		Context1.Reset();
+	}
+
+	return std::make_unique<RenderContext>(*this, std::move(InContext), std::move(Context1), std::move(Ring));
 }
@@ -1,30 +1,243 @@
 ﻿#pragma once
-#include <d3d11.h>
+#include "EngineWin.h"
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <d3d11_1.h>
+#include <DirectXCollision.h>
 #include <DirectXMath.h>
+#include <dxgi1_4.h>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
 #include "wrl/client.h"
+#include "AmbientOcclusion.h"
+#include "AssetReloader.h"
+#include "Camera.h"
+#include "ClusteredLighting.h"
+#include "CommandRecorder.h"
+#include "DebugDraw.h"
+#include "DebugViews.h"
+#include "DecalAtlas.h"
+#include "DeferredShading.h"
+#include "DirectionalLight.h"
 #include "DXGIInfoManager.h"
+#include "DynamicResolution.h"
+#include "EngineTimer.h"
+#include "FrameCapture.h"
+#include "FrameArena.h"
+#include "GeometryPool.h"
+#include "GpuProfiler.h"
+#include "GpuScene.h"
+#include "ImageBasedLighting.h"
+#include "IrradianceVolume.h"
+#include "ImGuiOverlay.h"
+#include "ImpostorBaker.h"
+#include "InstanceCuller.h"
+#include "JobSystem.h"
+#include "MaterialTable.h"
+#include "MeshletCuller.h"
+#include "ObjectPicker.h"
+#include "OcclusionCuller.h"
+#include "OcclusionPredication.h"
+#include "OrderIndependentTransparency.h"
+#include "ParticleSystem.h"
+#include "PipelineWarmup.h"
+#include "PointLightShadows.h"
+#include "PostProcessor.h"
+#include "QualityCalibration.h"
+#include "ReflectionProbes.h"
+#include "ReleaseQueue.h"
+#include "RenderGraph.h"
+#include "RenderContext.h"
+#include "RenderQueue.h"
+#include "ShaderBundle.h"
+#include "ShaderReloader.h"
+#include "Surface.h"
+#include "TemporalAntiAliasing.h"
+#include "TextureStreamer.h"
+#include "UploadManager.h"
+#include "VirtualTextureCache.h"
+#include "VolumetricFog.h"
 
-class Camera;
+enum class FullscreenMode : unsigned char
+{
+	Windowed,
+	// A popup covering the output. DXGI promotes a flip model swap chain to independent flip once nothing draws over it.
+	Borderless,
+	// Takes over the output in a mode of its list, which is how a refresh rate other than the desktop's is chosen.
+	Exclusive
+};
+
+// How the last presented frames reached the screen, as DXGI reports it for flip model swap chains.
+enum class PresentationMode : unsigned char
+{
+	// Not reported yet, or offscreen.
+	Unknown,
+	// Copied into the desktop by DWM, a frame of latency behind.
+	Composed,
+	// Scanned out of a hardware overlay plane over the desktop.
+	Overlay,
+	// Scanned out of the back buffers directly, without DWM.
+	IndependentFlip,
+	Exclusive
+};
+
+struct SwapChainSettings
+{
+	// Flip model buffers, clamped to at least two.
+	UINT BufferNum {3u};
+	UINT MaximumFrameLatency {1u};
+	bool bShouldUseFlipModel {true};
+	// What lighting renders into before post-processing, R11G11B10_FLOAT or R16G16B16A16_FLOAT for twice the bandwidth.
+	DXGI_FORMAT SceneFormat {DXGI_FORMAT_R11G11B10_FLOAT};
+	// MSAA samples per scene pixel, 1 for none or 2, 4 or 8. Lowered to the most the device supports for the scene and depth formats.
+	UINT SampleNum {1u};
+	FullscreenMode Fullscreen {FullscreenMode::Windowed};
+	// Of the adapter's outputs, which fullscreen covers.
+	UINT OutputIndex {0u};
+	// Exclusive mode picks the output's mode at its desktop resolution closest to this many Hz, the fastest while zero.
+	float RefreshRate {0.0f};
+	// Of the hardware adapters as DXGI ranks them for performance, the discrete GPU of a hybrid laptop first.
+	UINT AdapterIndex {0u};
+};
+
+struct OffscreenSettings
+{
+	// The software rasterizer, for machines without a GPU such as build agents.
+	bool bShouldUseWarp {false};
+	// Frames the CPU may queue ahead of the GPU, what the swap chain would otherwise enforce.
+	UINT MaximumFrameLatency {1u};
+	DXGI_FORMAT SceneFormat {DXGI_FORMAT_R11G11B10_FLOAT};
+	UINT SampleNum {1u};
+	// Ignored by WARP.
+	UINT AdapterIndex {0u};
+};
+
+/**
+ * What the device supports past the feature level 11_0 everything relies on, probed once as Graphics is created so each
+ * feature that needs more checks here and stays off where the hardware lacks it.
+ */
+struct DeviceCapabilities
+{
+	// Past ASCII, characters show as question marks.
+	std::string AdapterName;
+	SIZE_T DedicatedVideoBytes {0u};
+	D3D_FEATURE_LEVEL FeatureLevel {D3D_FEATURE_LEVEL_11_0};
+	// Integrated GPUs sharing system memory, and WARP.
+	bool bHasUnifiedMemory {false};
+	// D3D11.1: binding ranges of a constant buffer, and mapping dynamic ones with no-overwrite, what the constant ring needs.
+	bool bHasConstantBufferOffsetting {false};
+	bool bHasDriverCommandLists {false};
+	// 16-bit minimum precision, in pixel shaders and in every other stage.
+	bool bHasHalfPrecisionPixel {false};
+	bool bHasHalfPrecisionOther {false};
+	// D3D11.2.
+	D3D11_TILED_RESOURCES_TIER TiledResourcesTier {D3D11_TILED_RESOURCES_NOT_SUPPORTED};
+	// D3D11.3: loads from typed UAVs past R32_FLOAT, R32_UINT and R32_SINT.
+	bool bHasTypedUavLoadAdditionalFormats {false};
+	bool bHasRasterizerOrderedViews {false};
+	D3D11_CONSERVATIVE_RASTERIZATION_TIER ConservativeRasterizationTier {D3D11_CONSERVATIVE_RASTERIZATION_NOT_SUPPORTED};
+	// SV_RenderTargetArrayIndex and SV_ViewportArrayIndex from the vertex shader, without a geometry shader.
+	bool bHasViewportIndexFromVertexShader {false};
+	// Typed UAV loads of the two scene formats, reading the scene target in place.
+	bool bHasSceneUavLoads {false};
+};
 
 class Graphics
 {
 	friend class Bindable;
 
 public:
-	Graphics(HWND InWindowHandle, int InWidth, int InHeight);
+	// Register of cbuffer Frame in FrameConstants.hlsli, kept clear of the slots shaders number themselves.
+	static constexpr UINT FrameConstantSlot {13u};
+	// Compute shader resource slots Dispatch clears after each dispatch, compute bindables only bind below it. Past the
+	// decal atlas, the last slot deferred lighting reads.
+	static constexpr UINT ComputeResourceSlotNum {23u};
+	// Views are told apart by a bit each in a view mask.
+	static constexpr unsigned int MaxViewNum {16u};
+	static constexpr unsigned int NoView {~0u};
+	// What BeginStereo makes the active view.
+	static constexpr unsigned int StereoView {NoView - 1u};
+
+	// One viewpoint of a multi-view frame and the tile of the scene viewport it renders into.
+	struct View
+	{
+		const ::Camera* Camera;
+		// Fractions of the scene viewport, so tiles follow resizes and the resolution scale.
+		float Left;
+		float Top;
+		float Width;
+		float Height;
+	};
+
+	// What a window's Graphics needs that doesn't need the window, made on workers while the window is created, see Prepare.
+	struct Prerequisites
+	{
+		Microsoft::WRL::ComPtr<ID3D11Device> Device;
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> DeviceContext;
+		std::unique_ptr<ShaderBundle> Shaders;
+	};
+
+	// Creates the hardware device on the adapter InAdapterIndex selects and reads the shader bundle, as two jobs signalling
+	// InOutDone, which is waited on before OutPrerequisites are read or go out of scope.
+	static void Prepare(UINT InAdapterIndex, Prerequisites& OutPrerequisites, JobCounter& InOutDone);
+	// The adapter and driver Prepare would create the device on, and the CPU, without creating anything.
+	[[nodiscard]] static AdapterIdentity IdentifyAdapter(UINT InAdapterIndex);
+
+	Graphics(HWND InWindowHandle, int InWidth, int InHeight, const SwapChainSettings& InSettings, Prerequisites InPrerequisites);
+	// Renders into a texture of the given size instead of a window, with nothing presented and ImGui off.
+	Graphics(int InWidth, int InHeight, const OffscreenSettings& InSettings);
 	Graphics(const Graphics&) = delete;
 	Graphics(Graphics&&) = delete;
 	Graphics& operator=(const Graphics&) = delete;
 	Graphics& operator=(Graphics&&) = delete;
 	~Graphics();
 
+	// Post-processes the scene to the display, then draws ImGui over it.
 	void EndFrame();
-	void BeginFrame(float InRed = 0.0f, float InGreen = 0.0f, float InBlue = 0.0f) const noexcept;
-	void DrawIndexed(UINT InCount) const;
+	// Also writes the camera into the frame constants, read by every draw of the frame. The clear color is linear.
+	void BeginFrame(float InRed = 0.0f, float InGreen = 0.0f, float InBlue = 0.0f);
+	// Rebuilds the view from the camera as it is now and uploads it again, after submission and before the render queue
+	// draws, so the frame shows input that arrived while it was submitted. What was culled and fitted at BeginFrame stays.
+	// Multi-view frames keep the poses of BeginFrame.
+	void LatchView();
+	// Render target, depth state, viewport and frame constants every context needs before drawing the frame.
+	void BindFrameState(RenderContext& InContext) const noexcept;
+	// Other targets in place of the scene with the frame's depth, such as the G-buffer, until the next BindFrameState.
+	void BindRenderTargets(RenderContext& InContext, std::span<ID3D11RenderTargetView* const> InTargets) const noexcept;
+	// The scene target without depth, for fullscreen passes over the scene that read the depth view, until the next BindFrameState.
+	void BindSceneTarget(RenderContext& InContext) const noexcept;
+	// Points the frame constants at another viewpoint, such as a shadow face, until RestoreViewConstants.
+	void OverrideViewConstants(RenderContext& InContext, DirectX::FXMMATRIX InView, DirectX::CXMMATRIX InProjection) const;
+	// The same for viewpoints that are shaded, which also need the camera position to be theirs.
+	void OverrideViewConstants(RenderContext& InContext, DirectX::FXMMATRIX InView, DirectX::CXMMATRIX InProjection,
+	                           const DirectX::XMFLOAT3& InCameraPosition) const;
+	// Back to the camera's, or to the current view's between BeginView and EndViews.
+	void RestoreViewConstants(RenderContext& InContext) const;
+	void BindDepthTest(RenderContext& InContext, DepthTest InDepthTest) const noexcept;
+	void ExecuteCommandList(ID3D11CommandList* InCommandList) const;
+	// Runs the bound compute shader on the immediate context, then clears the compute resources and UAVs it used so
+	// draws can read what it wrote.
+	void Dispatch(UINT InGroupNumX, UINT InGroupNumY = 1u, UINT InGroupNumZ = 1u) const noexcept;
+	// The group counts are read from InArguments, a D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS buffer an earlier pass may have
+	// filled on the GPU.
+	void DispatchIndirect(ID3D11Buffer* InArguments, UINT InByteOffset = 0u) const noexcept;
+	// Forgets the immediate context's tracked state and binds the frame state again, after anything that bypassed it.
+	void RestoreFrameState() const noexcept;
+	// With MSAA, writes the farthest of each pixel's depth samples into the single sampled copy the depth view reads, on
+	// the immediate context with the output merger unbound. Does nothing without MSAA, where the view reads depth itself.
+	void ResolveDepth() const;
+	// Reads back what the last frame rendered offscreen, for comparing against golden images.
+	[[nodiscard]] Surface CaptureFrame() const;
 
+	// Takes effect from the next BeginFrame.
 	void EnableImGui() noexcept
 	{
+		assert(SwapChain && "ImGui needs a window");
 		bIsImGuiEnabled = true;
+		bIsImGuiCacheValid = false;
 	}
 
 	void DisableImGui() noexcept
@@ -37,6 +250,70 @@ public:
 		return bIsImGuiEnabled;
 	}
 
+	// Whether this frame builds the UI, ImGui windows may only be shown then. Every frame unless the UI is cached.
+	[[nodiscard]] bool IsImGuiFrame() const noexcept
+	{
+		return bIsImGuiFrame;
+	}
+
+	// Zero builds and draws ImGui every frame. Otherwise the UI is rendered into a cached overlay, rebuilt at this rate
+	// or right after input reaches ImGui, and composited over the frames in between.
+	void SetImGuiRefreshRate(float InRefreshRate);
+
+	[[nodiscard]] float GetImGuiRefreshRate() const noexcept
+	{
+		return ImGuiRefreshRate;
+	}
+
+	void EnableVSync() noexcept
+	{
+		bIsVSyncEnabled = true;
+	}
+
+	// Presents immediately, tearing when the flip model swap chain supports it.
+	void DisableVSync() noexcept
+	{
+		bIsVSyncEnabled = false;
+	}
+
+	[[nodiscard]] bool IsVSyncEnabled() const noexcept
+	{
+		return bIsVSyncEnabled;
+	}
+
+	[[nodiscard]] bool IsTearingSupported() const noexcept
+	{
+		return bIsTearingSupported;
+	}
+
+	// Whether the last Present found none of the window visible, so frames would be drawn for nothing. Once one has,
+	// each call tests again with a Present that shows nothing, and clears it when the window is visible.
+	[[nodiscard]] bool CheckOccluded();
+
+	struct DisplayOutput
+	{
+		Microsoft::WRL::ComPtr<IDXGIOutput> Output;
+		// In desktop coordinates, what a borderless window covers.
+		RECT DesktopRect;
+		// Of the back buffer format, from GetDisplayModeList in its order of ascending resolution and refresh rate.
+		std::vector<DXGI_MODE_DESC> Modes;
+	};
+
+	// The adapter's outputs as of creation, none offscreen.
+	[[nodiscard]] const std::vector<DisplayOutput>& GetOutputs() const noexcept
+	{
+		return Outputs;
+	}
+
+	// Exclusive only while the swap chain still holds the output, DXGI leaves it on its own when the window loses focus.
+	[[nodiscard]] FullscreenMode GetFullscreenMode() const;
+	// Asks DXGI each call, it only knows once a few frames were presented.
+	[[nodiscard]] PresentationMode QueryPresentationMode() const;
+
+	// Resizes the swap chain's buffers in place and recreates only the targets sized after the display, between frames on
+	// the main thread. Temporal history and the occlusion pyramid start over, everything else is kept.
+	void Resize(int InWidth, int InHeight);
+
 	void SetProjectionMatrix(const DirectX::FXMMATRIX& InProjectionMatrix)
 	{
 		ProjectionMatrix = InProjectionMatrix;
@@ -47,6 +324,68 @@ public:
 		return ProjectionMatrix;
 	}
 
+	// The camera as of BeginFrame or the last LatchView, so it is built once per frame instead of once per caller.
+	[[nodiscard]] DirectX::XMMATRIX GetViewMatrix() const noexcept
+	{
+		return CameraMatrix;
+	}
+
+	// With this frame's jitter while temporal anti-aliasing is active, like the matrices the shaders get.
+	[[nodiscard]] DirectX::XMMATRIX GetViewProjectionMatrix() const noexcept
+	{
+		return ViewProjectionMatrix;
+	}
+
+	// Where the scene renders this frame, the top left of the display's size scaled by the resolution scale.
+	[[nodiscard]] const D3D11_VIEWPORT& GetViewport() const noexcept
+	{
+		return Viewport;
+	}
+
+	// The whole display, what window coordinates and ImGui are in.
+	[[nodiscard]] const D3D11_VIEWPORT& GetDisplayViewport() const noexcept
+	{
+		return DisplayViewport;
+	}
+
+	// From the next BeginFrame the scene renders at a scale of the display resolution chosen to keep the GPU frame near
+	// InTargetMilliseconds, and post-processing upscales it. ImGui always draws at the display's resolution.
+	void EnableDynamicResolution(float InTargetMilliseconds) noexcept;
+	// Back to rendering at the display's resolution.
+	void DisableDynamicResolution() noexcept;
+
+	[[nodiscard]] bool IsDynamicResolutionEnabled() const noexcept
+	{
+		return bIsDynamicResolutionEnabled;
+	}
+
+	// MSAA samples per pixel of the scene and depth targets, one without MSAA.
+	[[nodiscard]] UINT GetSampleNum() const noexcept
+	{
+		return SampleNum;
+	}
+
+	// Video memory of the multisampled scene and depth targets, zero without MSAA.
+	[[nodiscard]] size_t GetMultisampledBytes() const noexcept
+	{
+		return MultisampledBytes;
+	}
+
+	[[nodiscard]] DynamicResolution& GetDynamicResolution() noexcept
+	{
+		return MyDynamicResolution;
+	}
+
+	[[nodiscard]] const DynamicResolution& GetDynamicResolution() const noexcept
+	{
+		return MyDynamicResolution;
+	}
+
+	[[nodiscard]] float GetResolutionScale() const noexcept
+	{
+		return Viewport.Width / DisplayViewport.Width;
+	}
+
 	void SetCamera(const Camera& InCamera)
 	{
 		Camera = &InCamera;
@@ -58,15 +397,569 @@ public:
 		return *Camera;
 	}
 
+	// From the next BeginFrame the scene renders once from every view into its tile instead of from the camera, none to go
+	// back. The camera still decides levels of detail, shadow cascades, picking and streaming. Temporal anti-aliasing, ambient
+	// occlusion, deferred shading and the GPU cullers all work in the camera's screen space, so they are skipped meanwhile.
+	void SetViews(std::span<const View> InViews);
+
+	[[nodiscard]] bool IsMultiView() const noexcept
+	{
+		return !Views.empty();
+	}
+
+	[[nodiscard]] unsigned int GetViewNum() const noexcept
+	{
+		return static_cast<unsigned int>(Views.size());
+	}
+
+	// In world space as of BeginFrame, what models cull against at once.
+	[[nodiscard]] std::span<const DirectX::BoundingFrustum> GetViewFrustums() const noexcept
+	{
+		return ViewFrustums;
+	}
+
+	// Two views of eyes InEyeSeparation apart around the camera, side by side. Stereo instanced drawables draw both in one
+	// instanced draw from the BeginStereo pass, everything else once per eye like any multi-view frame. Replaces the views set.
+	void EnableStereo(float InEyeSeparation);
+	// Back to the camera alone, or to SetViews.
+	void DisableStereo() noexcept;
+
+	[[nodiscard]] bool IsStereo() const noexcept
+	{
+		return bIsStereo;
+	}
+
+	// A bit per view whose frustum InWorldBounds reaches.
+	[[nodiscard]] uint32_t GetViewMask(const DirectX::BoundingBox& InWorldBounds) const noexcept;
+	// Uploads InView's matrices and sets its tile on the immediate context. Every BindFrameState and RestoreViewConstants
+	// until EndViews keeps to the view, command lists recorded meanwhile included.
+	void BeginView(unsigned int InView) const;
+	// The same over the whole scene viewport with both eyes' matrices, for draws instanced once per eye.
+	void BeginStereo() const;
+	void EndViews() const;
+
+	[[nodiscard]] RenderQueue& GetRenderQueue() const noexcept
+	{
+		return *MyRenderQueue;
+	}
+
+	[[nodiscard]] RenderContext& GetImmediateContext() const noexcept
+	{
+		return *ImmediateContext;
+	}
+
+	[[nodiscard]] const std::vector<std::unique_ptr<RenderContext>>& GetDeferredContexts() const noexcept
+	{
+		return DeferredContexts;
+	}
+
+	[[nodiscard]] const DeviceCapabilities& GetCapabilities() const noexcept
+	{
+		return Capabilities;
+	}
+
+	[[nodiscard]] bool IsDriverCommandListSupported() const noexcept
+	{
+		return bIsDriverCommandListSupported;
+	}
+
+	[[nodiscard]] bool IsHalfPrecisionSupported() const noexcept
+	{
+		return bIsHalfPrecisionSupported;
+	}
+
+	// Whether materials resolve their Material::HalfPrecision pixel shaders, on by default where the device has them.
+	[[nodiscard]] bool UsesHalfPrecision() const noexcept
+	{
+		return bUsesHalfPrecision;
+	}
+
+	// Before the first material is resolved, those already resolved keep the build they have.
+	void DisableHalfPrecision() noexcept
+	{
+		bUsesHalfPrecision = false;
+	}
+
+	// Pages the streamed maps of materials resolved from now on through a VirtualTextureCache, where the device has
+	// tiled resources tier 2. Otherwise they keep streaming whole levels.
+	void EnableVirtualTextures();
+
+	// Scales the pixels of error Mesh::MaxScreenError allows a LOD, above one coarser levels are drawn closer to the camera.
+	void SetLodErrorScale(float InScale) noexcept;
+
+	[[nodiscard]] float GetLodErrorScale() const noexcept
+	{
+		return LodErrorScale;
+	}
+
+	// Off draws every mesh at its finest level unless it is submitted with one forced.
+	void EnableLodSelection() noexcept
+	{
+		bIsLodSelectionEnabled = true;
+	}
+
+	void DisableLodSelection() noexcept
+	{
+		bIsLodSelectionEnabled = false;
+	}
+
+	[[nodiscard]] bool IsLodSelectionEnabled() const noexcept
+	{
+		return bIsLodSelectionEnabled;
+	}
+
+	// On every context, see StateCache::DisableFiltering. While nothing records.
+	void EnableStateFiltering() noexcept;
+	void DisableStateFiltering() noexcept;
+
+	[[nodiscard]] bool IsStateFilteringEnabled() const noexcept
+	{
+		return ImmediateContext->GetStateCache().IsFilteringEnabled();
+	}
+
+	// Per-draw constants through every context's ring where the device binds constant ranges, mapped into buffers of their
+	// own otherwise. While nothing records.
+	void EnableConstantBufferRing() noexcept;
+	void DisableConstantBufferRing() noexcept;
+
+	[[nodiscard]] bool IsConstantBufferRingEnabled() const noexcept
+	{
+		return ImmediateContext->GetConstantBufferRing() != nullptr;
+	}
+
+	// Texels a side of each sun shadow cascade, the map is created again at the new size.
+	void SetShadowMapSize(UINT InSize);
+
+	// Summed over the immediate and every deferred context for the last frame.
+	[[nodiscard]] StateCache::Statistics GetStateStatistics() const noexcept;
+
+	[[nodiscard]] const ShaderBundle& GetShaderBundle() const noexcept
+	{
+		return *MyShaderBundle;
+	}
+
+	// Watches the shader sources and swaps recompiled shaders into the live bindables, for iterating on shaders while running.
+	void EnableShaderHotReload()
+	{
+		if (!MyShaderReloader)
+		{
+			MyShaderReloader = std::make_unique<ShaderReloader>(*this);
+		}
+	}
+
+	void DisableShaderHotReload() noexcept
+	{
+		MyShaderReloader.reset();
+	}
+
+	// Null while hot reload is off.
+	[[nodiscard]] const ShaderReloader* GetShaderReloader() const noexcept
+	{
+		return MyShaderReloader.get();
+	}
+
+	// Watches the files of the live textures and models and swaps what is read again from them into the scene, for iterating on
+	// assets while running.
+	void EnableAssetHotReload()
+	{
+		if (!MyAssetReloader)
+		{
+			MyAssetReloader = std::make_unique<AssetReloader>(*this);
+		}
+	}
+
+	void DisableAssetHotReload() noexcept
+	{
+		MyAssetReloader.reset();
+	}
+
+	// Null while asset hot reload is off.
+	[[nodiscard]] const AssetReloader* GetAssetReloader() const noexcept
+	{
+		return MyAssetReloader.get();
+	}
+
+	[[nodiscard]] const FrameArena::Statistics& GetFrameArenaStatistics() const noexcept
+	{
+		return MyFrameArena->GetLastFrameStatistics();
+	}
+
+	[[nodiscard]] GpuProfiler& GetGpuProfiler() const noexcept
+	{
+		return *MyGpuProfiler;
+	}
+
+	[[nodiscard]] OcclusionCuller& GetOcclusionCuller() const noexcept
+	{
+		return *MyOcclusionCuller;
+	}
+
+	[[nodiscard]] OcclusionPredication& GetOcclusionPredication() const noexcept
+	{
+		return *MyOcclusionPredication;
+	}
+
+	[[nodiscard]] TemporalAntiAliasing& GetTemporalAntiAliasing() const noexcept
+	{
+		return *MyTemporalAntiAliasing;
+	}
+
+	[[nodiscard]] GpuScene& GetGpuScene() const noexcept
+	{
+		return *MyGpuScene;
+	}
+
+	[[nodiscard]] MaterialTable& GetMaterialTable() const noexcept
+	{
+		return *MyMaterialTable;
+	}
+
+	[[nodiscard]] InstanceCuller& GetInstanceCuller() const noexcept
+	{
+		return *MyInstanceCuller;
+	}
+
+	[[nodiscard]] MeshletCuller& GetMeshletCuller() const noexcept
+	{
+		return *MyMeshletCuller;
+	}
+
+	[[nodiscard]] DebugDraw& GetDebugDraw() const noexcept
+	{
+		return *MyDebugDraw;
+	}
+
+	[[nodiscard]] ObjectPicker& GetObjectPicker() const noexcept
+	{
+		return *MyObjectPicker;
+	}
+
+	[[nodiscard]] ParticleSystem& GetParticleSystem() const noexcept
+	{
+		return *MyParticleSystem;
+	}
+
+	[[nodiscard]] ClusteredLighting& GetClusteredLighting() const noexcept
+	{
+		return *MyClusteredLighting;
+	}
+
+	[[nodiscard]] DecalAtlas& GetDecalAtlas() const noexcept
+	{
+		return *MyDecalAtlas;
+	}
+
+	[[nodiscard]] PointLightShadows& GetPointLightShadows() const noexcept
+	{
+		return *MyPointLightShadows;
+	}
+
+	[[nodiscard]] DirectionalLight& GetDirectionalLight() const noexcept
+	{
+		return *MyDirectionalLight;
+	}
+
+	[[nodiscard]] PipelineWarmup& GetPipelineWarmup() const noexcept
+	{
+		return *MyPipelineWarmup;
+	}
+
+	[[nodiscard]] const ReleaseQueue& GetReleaseQueue() const noexcept
+	{
+		return *MyReleaseQueue;
+	}
+
+	[[nodiscard]] UploadManager& GetUploadManager() const noexcept
+	{
+		return *MyUploadManager;
+	}
+
+	[[nodiscard]] GeometryPool& GetGeometryPool() const noexcept
+	{
+		return *MyGeometryPool;
+	}
+
+	[[nodiscard]] TextureStreamer& GetTextureStreamer() const noexcept
+	{
+		return *MyTextureStreamer;
+	}
+
+	// Null unless EnableVirtualTextures found the device could page textures.
+	[[nodiscard]] VirtualTextureCache* GetVirtualTextureCache() const noexcept
+	{
+		return MyVirtualTextureCache.get();
+	}
+
+	[[nodiscard]] PostProcessor& GetPostProcessor() const noexcept
+	{
+		return *MyPostProcessor;
+	}
+
+	[[nodiscard]] RenderGraph& GetRenderGraph() const noexcept
+	{
+		return *MyRenderGraph;
+	}
+
+	// Off switches the opaque pass back to forward shading.
+	[[nodiscard]] DeferredShading& GetDeferredShading() const noexcept
+	{
+		return *MyDeferredShading;
+	}
+
+	// Where blended material draws accumulate, composited over the scene after the opaque pass.
+	[[nodiscard]] OrderIndependentTransparency& GetOrderIndependentTransparency() const noexcept
+	{
+		return *MyOrderIndependentTransparency;
+	}
+
+	// None by default, the render queue draws the scene through the selected view otherwise.
+	[[nodiscard]] DebugViews& GetDebugViews() const noexcept
+	{
+		return *MyDebugViews;
+	}
+
+	// Off leaves the ambient term unoccluded.
+	[[nodiscard]] AmbientOcclusion& GetAmbientOcclusion() const noexcept
+	{
+		return *MyAmbientOcclusion;
+	}
+
+	// Off by default, the scene is drawn in clear air.
+	[[nodiscard]] VolumetricFog& GetVolumetricFog() const noexcept
+	{
+		return *MyVolumetricFog;
+	}
+
+	// Without a loaded environment shading keeps the constant ambient colour.
+	[[nodiscard]] ImageBasedLighting& GetImageBasedLighting() const noexcept
+	{
+		return *MyImageBasedLighting;
+	}
+
+	// Empty until probes are placed, surfaces then reflect the environment.
+	[[nodiscard]] ReflectionProbes& GetReflectionProbes() const noexcept
+	{
+		return *MyReflectionProbes;
+	}
+
+	// Not placed until Place is called, surfaces then take the ambient light from the environment or the lights.
+	[[nodiscard]] IrradianceVolume& GetIrradianceVolume() const noexcept
+	{
+		return *MyIrradianceVolume;
+	}
+
+	// Screenshots and frame sequences of the display, read back without stalling.
+	[[nodiscard]] FrameCapture& GetFrameCapture() const noexcept
+	{
+		return *MyFrameCapture;
+	}
+
+	// Traces of what the state caches issue, for CommandReplay to time draw by draw.
+	[[nodiscard]] CommandRecorder& GetCommandRecorder() const noexcept
+	{
+		return *MyCommandRecorder;
+	}
+
+	// Bakes the impostors far model instances are drawn as, one model per frame.
+	[[nodiscard]] ImpostorBaker& GetImpostorBaker() const noexcept
+	{
+		return *MyImpostorBaker;
+	}
+
+	// The lit frame before tonemapping, for passes such as bloom that need its full range. Readable once nothing draws into it.
+	[[nodiscard]] ID3D11ShaderResourceView* GetSceneView() const noexcept
+	{
+		return SceneView.Get();
+	}
+
+	// Local video memory this process uses and the budget the OS currently grants it, zeros where DXGI 1.4 is missing.
+	[[nodiscard]] DXGI_QUERY_VIDEO_MEMORY_INFO QueryVideoMemory() const noexcept;
+
+	// Bytes of per-draw constants streamed through the ring last frame, zero when the ring is unavailable.
+	[[nodiscard]] UINT GetFrameConstantBytes() const noexcept
+	{
+		const auto* Ring = ImmediateContext->GetConstantBufferRing();
+		return Ring ? Ring->GetLastFrameBytes() : 0u;
+	}
+
+private:
+	struct FrameConstants
+	{
+		DirectX::XMMATRIX View;
+		DirectX::XMMATRIX Projection;
+		DirectX::XMMATRIX ViewProjection;
+		DirectX::XMFLOAT3 CameraPosition;
+		float Time;
+		DirectX::XMMATRIX EyeViewProjections[2];
+		// One outside the stereo pass.
+		UINT EyeNum;
+		float Padding[3];
+	};
+
+	struct ViewState
+	{
+		FrameConstants Constants;
+		D3D11_VIEWPORT Viewport;
+	};
+
+	// Every hardware adapter in order of performance, logged if asked, returns the InIndex-th, or the first when there are fewer.
+	[[nodiscard]] static Microsoft::WRL::ComPtr<IDXGIAdapter1> SelectAdapter(UINT InIndex, bool bInIsLogging = true);
+	static void CreateDevice(D3D_DRIVER_TYPE InDriverType, UINT InAdapterIndex, Prerequisites& OutPrerequisites);
+	void ProbeCapabilities();
+	void CreateSwapChain(HWND InWindowHandle, int InWidth, int InHeight, const SwapChainSettings& InSettings);
+	void EnumerateOutputs(IDXGIAdapter* InAdapter);
+	// Switches to the mode InSettings ask for, staying windowed when the output has none or DXGI refuses the switch.
+	void EnterExclusiveFullscreen(const SwapChainSettings& InSettings);
+	// Everything past the device and the display target, shared by both modes.
+	void Initialize(ID3D11Resource* InDisplayTarget, int InWidth, int InHeight, DXGI_FORMAT InSceneFormat, UINT InSampleNum,
+	                std::unique_ptr<ShaderBundle> InShaderBundle);
+	// The display's view, the scene and depth targets and the viewports, everything of Graphics' own a resize recreates.
+	void CreateTargets(ID3D11Resource* InDisplayTarget, int InWidth, int InHeight);
+	// The most samples up to InSampleNum both the scene and the depth format support, one when none do.
+	[[nodiscard]] UINT SelectSampleNum(DXGI_FORMAT InSceneFormat, UINT InSampleNum) const;
+	// The multisampled scene into the single sampled texture post-processing reads.
+	void ResolveScene() const;
+	void WaitForOffscreenFrame();
+	void ClearComputeBindings() const noexcept;
+	[[nodiscard]] std::unique_ptr<RenderContext> CreateRenderContext(Microsoft::WRL::ComPtr<ID3D11DeviceContext> InContext) const;
+	void UploadFrameConstants(RenderContext& InContext, const FrameConstants& InConstants) const;
+	// Null outside a view.
+	[[nodiscard]] const ViewState* GetActiveViewState() const noexcept;
+	// Whether a cached UI needs building this frame, always true when it isn't cached.
+	[[nodiscard]] bool IsImGuiRefreshDue() noexcept;
+	// Feeds a newly resolved GPU frame time to the scale and sizes the scene viewport by it.
+	void UpdateResolutionScale() noexcept;
+
+private:
+	static constexpr unsigned int MaxDeferredContextNum {8u};
+	static constexpr const wchar_t* ShaderBundleFileName {L"Shaders.bundle"};
+	// ImGui takes a few frames to settle after input, such as hover highlights following the cursor and windows fitting their contents.
+	static constexpr unsigned int ImGuiSettleFrameNum {3u};
+
 private:
 	DXGIInfoManager InfoManager;
+	// First so everything else can draw from it during construction and is gone before it on destruction.
+	std::unique_ptr<FrameArena> MyFrameArena {std::make_unique<FrameArena>()};
 	DirectX::XMMATRIX ProjectionMatrix;
 	DirectX::XMMATRIX CameraMatrix;
+	DirectX::XMMATRIX ViewProjectionMatrix;
 	const Camera* Camera;
 	Microsoft::WRL::ComPtr<ID3D11Device> Device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> DeviceContext;
+	// Null before Windows 10.
+	Microsoft::WRL::ComPtr<IDXGIAdapter3> Adapter3;
+	DeviceCapabilities Capabilities;
+	// Null when rendering offscreen.
 	Microsoft::WRL::ComPtr<IDXGISwapChain> SwapChain;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> OffscreenTarget;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> FrameFences;
+	unsigned long long OffscreenFrameNum {0u};
+	// The HDR scene target every draw of the frame renders into. With MSAA it views the multisampled texture, which is
+	// resolved into the single sampled one the scene's shader views read.
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RenderTargetView;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> SceneTexture;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> MultisampledSceneTexture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SceneView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> SceneUav;
+	DXGI_FORMAT SceneFormat {DXGI_FORMAT_R11G11B10_FLOAT};
+	// The back buffer or offscreen target, post-processing and ImGui both write colors that are already encoded.
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> DisplayTargetView;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthStencilView;
+	// With MSAA the depth stencil view is multisampled, and the shader resource view reads its resolved copy.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DepthShaderResourceView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MultisampledDepthView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ResolvedDepthUav;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> DepthResolveShader;
+	UINT SampleNum {1u};
+	size_t MultisampledBytes {0u};
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> DepthStencilState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> EqualDepthStencilState;
+	D3D11_VIEWPORT Viewport {};
+	D3D11_VIEWPORT DisplayViewport {};
+	DynamicResolution MyDynamicResolution;
+	unsigned long long MeasuredGpuFrameNum {0u};
+	float LodErrorScale {1.0f};
+	bool bIsLodSelectionEnabled {true};
+	// One buffer for all contexts, command lists read what it holds when they execute.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> FrameConstantBuffer;
+	FrameConstants MyFrameConstants {};
+	std::vector<View> Views;
+	// Per view as of BeginFrame.
+	std::vector<ViewState> ViewStates;
+	std::vector<DirectX::BoundingFrustum> ViewFrustums;
+	// Posed from the camera every BeginFrame while stereo.
+	std::array<::Camera, 2u> Eyes;
+	ViewState StereoState {};
+	float EyeSeparation {0.0f};
+	// Set only on the main thread between passes, before any worker records.
+	mutable unsigned int ActiveView {NoView};
+	// Never marked, so it measures from device creation.
+	EngineTimer StartTimer;
+	std::unique_ptr<RenderContext> ImmediateContext;
+	// Reset before the subsystems in the destructor, what it holds refers to them.
+	std::unique_ptr<ReleaseQueue> MyReleaseQueue;
+	std::vector<std::unique_ptr<RenderContext>> DeferredContexts;
+	std::unique_ptr<ShaderBundle> MyShaderBundle;
+	// ImGui's fonts are rasterized on a worker from construction on, the first UI frame waits for them.
+	JobCounter FontAtlasBuilt;
+	std::unique_ptr<ShaderReloader> MyShaderReloader;
+	std::unique_ptr<AssetReloader> MyAssetReloader;
+	std::unique_ptr<GpuProfiler> MyGpuProfiler;
+	std::unique_ptr<OcclusionCuller> MyOcclusionCuller;
+	std::unique_ptr<OcclusionPredication> MyOcclusionPredication;
+	std::unique_ptr<GpuScene> MyGpuScene;
+	std::unique_ptr<MaterialTable> MyMaterialTable;
+	std::unique_ptr<InstanceCuller> MyInstanceCuller;
+	std::unique_ptr<MeshletCuller> MyMeshletCuller;
+	std::unique_ptr<ParticleSystem> MyParticleSystem;
+	std::unique_ptr<DebugDraw> MyDebugDraw;
+	std::unique_ptr<ObjectPicker> MyObjectPicker;
+	std::unique_ptr<ClusteredLighting> MyClusteredLighting;
+	std::unique_ptr<DecalAtlas> MyDecalAtlas;
+	std::unique_ptr<PointLightShadows> MyPointLightShadows;
+	std::unique_ptr<DirectionalLight> MyDirectionalLight;
+	std::unique_ptr<PipelineWarmup> MyPipelineWarmup;
+	// Before what uploads through it, so it outlives them.
+	std::unique_ptr<UploadManager> MyUploadManager;
+	std::unique_ptr<GeometryPool> MyGeometryPool;
+	std::unique_ptr<TextureStreamer> MyTextureStreamer;
+	// After the streamer, it hands textures it can't page over to it.
+	std::unique_ptr<VirtualTextureCache> MyVirtualTextureCache;
+	std::unique_ptr<PostProcessor> MyPostProcessor;
+	std::unique_ptr<TemporalAntiAliasing> MyTemporalAntiAliasing;
+	std::unique_ptr<RenderGraph> MyRenderGraph;
+	std::unique_ptr<DeferredShading> MyDeferredShading;
+	std::unique_ptr<OrderIndependentTransparency> MyOrderIndependentTransparency;
+	std::unique_ptr<DebugViews> MyDebugViews;
+	std::unique_ptr<AmbientOcclusion> MyAmbientOcclusion;
+	std::unique_ptr<VolumetricFog> MyVolumetricFog;
+	std::unique_ptr<ImageBasedLighting> MyImageBasedLighting;
+	std::unique_ptr<ReflectionProbes> MyReflectionProbes;
+	std::unique_ptr<IrradianceVolume> MyIrradianceVolume;
+	std::unique_ptr<ImpostorBaker> MyImpostorBaker;
+	std::unique_ptr<FrameCapture> MyFrameCapture;
+	std::unique_ptr<CommandRecorder> MyCommandRecorder;
+	// Only while the UI is cached.
+	std::unique_ptr<ImGuiOverlay> MyImGuiOverlay;
+	EngineTimer ImGuiRefreshTimer;
+	float ImGuiRefreshRate {0.0f};
+	unsigned int ImGuiSettleFramesLeft {0u};
+	HANDLE FrameLatencyWaitableObject {nullptr};
+	std::vector<DisplayOutput> Outputs;
+	FullscreenMode MyFullscreenMode {FullscreenMode::Windowed};
+	std::unique_ptr<RenderQueue> MyRenderQueue {std::make_unique<RenderQueue>()};
+
 	bool bIsImGuiEnabled {true};
+	bool bIsImGuiFrame {false};
+	// Whether the overlay holds a UI built since it was created or ImGui was enabled.
+	bool bIsImGuiCacheValid {false};
+	bool bIsVSyncEnabled {true};
+	bool bIsTearingSupported {false};
+	bool bIsOccluded {false};
+	bool bIsDynamicResolutionEnabled {false};
+	bool bIsConstantBufferRingSupported {false};
+	bool bIsDriverCommandListSupported {false};
+	bool bIsHalfPrecisionSupported {false};
+	bool bUsesHalfPrecision {false};
+	bool bIsStereo {false};
 };
@@ -0,0 +1,42 @@
+// Hi-Z pyramid test shared by the occlusion and instance cull shaders.
+// Mip 0 of the pyramid is half the depth resolution and every texel keeps the farthest depth below it.
+
+// True unless the whole world space box is behind what the pyramid saw, InPyramidSize is the part of mip 0 last built.
+bool IsBoxUnoccluded(const Texture2D<float> InPyramid, const float3 InCenter, const float3 InExtents, const matrix InViewProjection,
+                     const float2 InPyramidSize, const uint InPyramidMipNum)
+{
+    float3 MinPosition = float3(1.0f, 1.0f, 1.0f);
+    float3 MaxPosition = float3(-1.0f, -1.0f, -1.0f);
+
+    for (uint Corner = 0u; Corner < 8u; ++Corner)
+    {
+        const float3 Direction = float3(Corner & 1u ? 1.0f : -1.0f, Corner & 2u ? 1.0f : -1.0f, Corner & 4u ? 1.0f : -1.0f);
+        const float4 ClipPosition = mul(float4(InCenter + InExtents * Direction, 1.0f), InViewProjection);
+
+        // A box crossing the near plane cannot be projected, it is close enough to draw anyway.
+        if (ClipPosition.w <= 0.0f)
+        {
+            return true;
+        }
+
+        const float3 NdcPosition = ClipPosition.xyz / ClipPosition.w;
+        MinPosition = min(MinPosition, NdcPosition);
+        MaxPosition = max(MaxPosition, NdcPosition);
+    }
+
+    const float2 MinUV = saturate(float2(MinPosition.x, -MaxPosition.y) * 0.5f + 0.5f);
+    const float2 MaxUV = saturate(float2(MaxPosition.x, -MinPosition.y) * 0.5f + 0.5f);
+
+    // The mip where the box spans at most two texels per axis, so four loads cover it.
+    const float2 Size = (MaxUV - MinUV) * InPyramidSize;
+    const uint Mip = min((uint) ceil(log2(max(max(Size.x, Size.y), 1.0f))), InPyramidMipNum - 1u);
+    const uint2 MipSize = max(uint2(InPyramidSize) >> Mip, 1u);
+
+    const uint2 First = min(uint2(MinUV * MipSize), MipSize - 1u);
+    const uint2 Last = min(uint2(MaxUV * MipSize), MipSize - 1u);
+
+    const float OccluderDepth = max(max(InPyramid.Load(int3(First, Mip)), InPyramid.Load(int3(Last.x, First.y, Mip))),
+                                    max(InPyramid.Load(int3(First.x, Last.y, Mip)), InPyramid.Load(int3(Last, Mip))));
+
+    return MinPosition.z <= OccluderDepth;
+}
@@ -0,0 +1,29 @@
+// Each texel keeps the farthest depth of the 2x2 texels below it, so a test against it is conservative.
+Texture2D<float> Source : register(t0);
+RWTexture2D<float> Destination : register(u0);
+
+cbuffer Downsample : register(b0)
+{
+    uint2 SourceSize;
+    uint2 DestinationSize;
+}
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= DestinationSize))
+    {
+        return;
+    }
+
+    // Odd source sizes clamp onto the last row or column, which the rounded up destination still covers.
+    const uint2 Base = InThreadID.xy * 2u;
+    const uint2 Last = SourceSize - 1u;
+
+    const float Depth00 = Source.Load(int3(min(Base, Last), 0));
+    const float Depth10 = Source.Load(int3(min(Base + uint2(1u, 0u), Last), 0));
+    const float Depth01 = Source.Load(int3(min(Base + uint2(0u, 1u), Last), 0));
+    const float Depth11 = Source.Load(int3(min(Base + uint2(1u, 1u), Last), 0));
+
+    Destination[InThreadID.xy] = max(max(Depth00, Depth10), max(Depth01, Depth11));
+}
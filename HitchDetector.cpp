@@ -0,0 +1,191 @@
+﻿#include "HitchDetector.h"
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include "AllocationTracker.h"
+#include "Logger.h"
+#include "imgui/imgui.h"
+
+HitchDetector::~HitchDetector()
+{
+	// A failed capture was logged by its job, nobody is left to tell.
+	try
+	{
+		JobSystem::Get().Wait(CaptureWritten);
+	}
+	catch (...)
+	{
+	}
+}
+
+unsigned int HitchDetector::GetBucket(const float InMilliseconds) noexcept
+{
+	return std::min(static_cast<unsigned int>(std::max(InMilliseconds, 0.0f) / BucketMilliseconds), BucketNum - 1u);
+}
+
+void HitchDetector::Record()
+{
+	const auto Now = Clock::now();
+	const auto Activity = IoService::Get().GetActivity();
+
+	FrameRecord Recorded {LastFrameEnd, Now, FrameProfiler::GetLastFrameTime(), 0u, 0u, Activity.FinishedNum - LastActivity.FinishedNum,
+	                      Activity.Bytes - LastActivity.Bytes, Activity.QueuedNum + Activity.InFlightNum};
+
+	for (unsigned char Tag = 0u; Tag < static_cast<unsigned char>(AllocationTracker::Tag::Num); ++Tag)
+	{
+		const auto Allocated = AllocationTracker::GetLastFrame(static_cast<AllocationTracker::Tag>(Tag));
+		Recorded.AllocationNum += Allocated.FrameAllocationNum;
+		Recorded.AllocatedBytes += Allocated.FrameBytes;
+	}
+
+	LastFrameEnd = Now;
+	LastActivity = Activity;
+
+	if (bIsNextIgnored)
+	{
+		bIsNextIgnored = false;
+		return;
+	}
+
+	auto& Slot = Frames[RecordedNum % HistoryFrameNum];
+
+	if (RecordedNum >= HistoryFrameNum)
+	{
+		--Buckets[GetBucket(Slot.Milliseconds)];
+	}
+
+	Slot = Recorded;
+	++Buckets[GetBucket(Recorded.Milliseconds)];
+	++RecordedNum;
+
+	// Judged against the frames before it, a run of hitches doesn't raise the bar for itself.
+	const auto Milliseconds = Recorded.Milliseconds;
+	const auto bIsOverThreshold = MySettings.Threshold > 0.0f && Milliseconds > MySettings.Threshold;
+	const auto bIsOverMedian = MySettings.MedianScale > 0.0f && Median > 0.0f && Milliseconds > Median * MySettings.MedianScale;
+	UpdatePercentiles();
+
+	if (bIsOverThreshold || bIsOverMedian)
+	{
+		++HitchNum;
+		LastHitchTime = Milliseconds;
+		LOG_WARNING("Frame {} hitched for {} ms against a median of {} ms", RecordedNum, Milliseconds, Median);
+
+		if (MySettings.bIsFreezingTimeline)
+		{
+			FrameProfiler::PauseTimeline();
+		}
+
+		// Hitches while one is pending land in its capture.
+		if (MySettings.bIsCapturing && !PendingHitchFrame && CaptureNum < MaxCaptureNum)
+		{
+			PendingHitchFrame = RecordedNum;
+		}
+	}
+
+	const auto ContextFrameNum = std::min(MySettings.ContextFrameNum, MaxContextFrameNum);
+
+	if (PendingHitchFrame && RecordedNum >= PendingHitchFrame + ContextFrameNum)
+	{
+		// Early on there are fewer frames before the hitch to write.
+		const auto OldestFrame = RecordedNum > HistoryFrameNum ? RecordedNum - HistoryFrameNum + 1u : 1u;
+		WriteCapture(std::max(PendingHitchFrame > ContextFrameNum ? PendingHitchFrame - ContextFrameNum : 1u, OldestFrame));
+		PendingHitchFrame = 0u;
+	}
+}
+
+void HitchDetector::UpdatePercentiles() noexcept
+{
+	const auto FrameNum = static_cast<unsigned int>(std::min<unsigned long long>(RecordedNum, HistoryFrameNum));
+
+	if (FrameNum < MinMedianFrameNum)
+	{
+		return;
+	}
+
+	for (unsigned int Index = 0u; Index < FrameNum; ++Index)
+	{
+		Sorted[Index] = Frames[Index].Milliseconds;
+	}
+
+	const auto End = Sorted.begin() + FrameNum;
+	const auto Middle = Sorted.begin() + FrameNum / 2u;
+	std::nth_element(Sorted.begin(), Middle, End);
+	Median = *Middle;
+
+	// Everything past the middle is at least the median, so the 99th percentile is among it.
+	const auto Slow = Sorted.begin() + FrameNum * 99u / 100u;
+	std::nth_element(Middle, Slow, End);
+	SlowPercentile = *Slow;
+}
+
+void HitchDetector::WriteCapture(const unsigned long long InFirstFrame)
+{
+	const auto FileName = "Hitch_" + std::to_string(PendingHitchFrame) + ".json";
+	const auto& First = Frames[(InFirstFrame - 1u) % HistoryFrameNum];
+
+	// Values are traced at the end of their frame, the trace starts at the beginning of the first.
+	std::vector<FrameProfiler::Counter> Counters;
+	Counters.reserve(static_cast<size_t>(RecordedNum - InFirstFrame + 1u) * 6u);
+
+	for (auto Frame = InFirstFrame; Frame <= RecordedNum; ++Frame)
+	{
+		const auto& Recorded = Frames[(Frame - 1u) % HistoryFrameNum];
+		Counters.push_back({"Frame ms", Recorded.End, Recorded.Milliseconds});
+		Counters.push_back({"Allocations", Recorded.End, static_cast<double>(Recorded.AllocationNum)});
+		Counters.push_back({"Allocated KB", Recorded.End, static_cast<double>(Recorded.AllocatedBytes) / 1024.0});
+		Counters.push_back({"Reads finished", Recorded.End, static_cast<double>(Recorded.FinishedReadNum)});
+		Counters.push_back({"Read KB", Recorded.End, static_cast<double>(Recorded.ReadBytes) / 1024.0});
+		Counters.push_back({"Reads pending", Recorded.End, static_cast<double>(Recorded.PendingReadNum)});
+	}
+
+	++CaptureNum;
+	LastCaptureFileName = FileName;
+	LOG_INFO("Writing frames {} to {} around the hitch to {}", InFirstFrame, RecordedNum, FileName);
+
+	JobSystem::Get().Run([FileName, Since = First.Start, Counters = std::move(Counters)]
+	{
+		if (!FrameProfiler::ExportTrace(FileName, Since, Counters))
+		{
+			LOG_ERROR("Could not write {}", FileName);
+		}
+	}, JobLane::Background, &CaptureWritten);
+}
+
+void HitchDetector::ShowWindow()
+{
+	if (ImGui::Begin("Hitches"))
+	{
+		const auto FrameNum = static_cast<unsigned int>(std::min<unsigned long long>(RecordedNum, HistoryFrameNum));
+		ImGui::Text("Median %.2f ms, 99th percentile %.2f ms over %u frames", Median, SlowPercentile, FrameNum);
+
+		const auto Overlay = "0 to " + std::to_string(static_cast<unsigned int>(BucketNum * BucketMilliseconds)) + " ms";
+		ImGui::PlotHistogram("##Frame times", [](void* InData, const int InIndex)
+		{
+			return static_cast<float>(static_cast<const unsigned int*>(InData)[InIndex]);
+		}, Buckets.data(), static_cast<int>(BucketNum), 0, Overlay.c_str(), 0.0f, FLT_MAX, {0.0f, 80.0f});
+
+		ImGui::InputFloat("Threshold ms", &MySettings.Threshold, 1.0f, 10.0f, "%.1f");
+		ImGui::InputFloat("Times the median", &MySettings.MedianScale, 0.5f, 1.0f, "%.1f");
+		MySettings.Threshold = std::max(MySettings.Threshold, 0.0f);
+		MySettings.MedianScale = std::max(MySettings.MedianScale, 0.0f);
+
+		auto ContextFrameNum = static_cast<int>(MySettings.ContextFrameNum);
+		if (ImGui::SliderInt("Frames around", &ContextFrameNum, 0, static_cast<int>(MaxContextFrameNum)))
+		{
+			MySettings.ContextFrameNum = static_cast<unsigned int>(ContextFrameNum);
+		}
+
+		ImGui::Checkbox("Write traces", &MySettings.bIsCapturing);
+		ImGui::SameLine();
+		ImGui::Checkbox("Freeze timeline", &MySettings.bIsFreezingTimeline);
+
+		ImGui::Text("%u hitches, the last %.2f ms", HitchNum, LastHitchTime);
+
+		if (!LastCaptureFileName.empty())
+		{
+			ImGui::Text("%u of %u traces written, the last to %s", CaptureNum, MaxCaptureNum, LastCaptureFileName.c_str());
+		}
+	}
+
+	ImGui::End();
+}
@@ -0,0 +1,110 @@
+﻿#pragma once
+#include <array>
+#include <string>
+#include "FrameProfiler.h"
+#include "IoService.h"
+#include "JobSystem.h"
+
+/**
+ * Catches the frames that hitch, ones longer than a fixed threshold or than a multiple of the median of the recent frames,
+ * and keeps the rolling histogram of frame times its window shows. A hitch freezes the profiler's flame chart on itself and,
+ * ContextFrameNum frames later, writes a Chrome trace of every thread's zones and the GPU scopes from ContextFrameNum frames
+ * before it on, with the frame time, allocations and I/O of each frame as counters. The trace is written by a job, so the
+ * capture isn't a hitch of its own, and the frame it fired on names the file.
+ */
+class HitchDetector
+{
+public:
+	using Clock = FrameProfiler::Clock;
+
+	struct Settings
+	{
+		// Milliseconds a frame hitches past whatever the median, zero disables it.
+		float Threshold {100.0f};
+		// How many times the median a frame hitches past, zero disables it.
+		float MedianScale {3.0f};
+		// Recorded on either side of a hitch.
+		unsigned int ContextFrameNum {30u};
+		bool bIsCapturing {true};
+		bool bIsFreezingTimeline {true};
+	};
+
+	HitchDetector() = default;
+	HitchDetector(const HitchDetector&) = delete;
+	HitchDetector(HitchDetector&&) = delete;
+	HitchDetector& operator=(const HitchDetector&) = delete;
+	HitchDetector& operator=(HitchDetector&&) = delete;
+	// Waits for the capture being written.
+	~HitchDetector();
+
+	// Once per frame after FrameProfiler::BeginFrame and AllocationTracker::BeginFrame, for the frame they closed.
+	void Record();
+	// The next frame is only recorded, for frames known to be long, such as the first after the window was hidden.
+	void IgnoreNextFrame() noexcept
+	{
+		bIsNextIgnored = true;
+	}
+
+	void ShowWindow();
+
+	[[nodiscard]] Settings& GetSettings() noexcept
+	{
+		return MySettings;
+	}
+
+	// Of the frames in the history, zero until there are MinMedianFrameNum.
+	[[nodiscard]] float GetMedian() const noexcept
+	{
+		return Median;
+	}
+
+	static constexpr unsigned int HistoryFrameNum {600u};
+	// Below it the median is too noisy to judge by.
+	static constexpr unsigned int MinMedianFrameNum {60u};
+	static constexpr unsigned int MaxContextFrameNum {120u};
+	// Written per session at most, a machine that hitches constantly shouldn't fill its disk with traces.
+	static constexpr unsigned int MaxCaptureNum {16u};
+	static constexpr unsigned int BucketNum {80u};
+	// The last bucket also counts every frame longer than the others cover.
+	static constexpr float BucketMilliseconds {0.5f};
+
+private:
+	struct FrameRecord
+	{
+		Clock::time_point Start;
+		Clock::time_point End;
+		float Milliseconds;
+		unsigned long long AllocationNum;
+		unsigned long long AllocatedBytes;
+		unsigned long long FinishedReadNum;
+		unsigned long long ReadBytes;
+		unsigned int PendingReadNum;
+	};
+
+	[[nodiscard]] static unsigned int GetBucket(float InMilliseconds) noexcept;
+	void UpdatePercentiles() noexcept;
+	// Frames from InFirstFrame to the last recorded one.
+	void WriteCapture(unsigned long long InFirstFrame);
+
+	Settings MySettings;
+	std::array<FrameRecord, HistoryFrameNum> Frames {};
+	// Frames recorded since startup, the latest is at (RecordedNum - 1) % HistoryFrameNum.
+	unsigned long long RecordedNum {0u};
+	std::array<unsigned int, BucketNum> Buckets {};
+	// Scratch for the percentiles, kept so recording doesn't allocate.
+	std::array<float, HistoryFrameNum> Sorted {};
+	float Median {0.0f};
+	float SlowPercentile {0.0f};
+	Clock::time_point LastFrameEnd {};
+	IoService::Activity LastActivity {};
+	// The first frame has nothing before it to be measured against.
+	bool bIsNextIgnored {true};
+
+	unsigned int HitchNum {0u};
+	float LastHitchTime {0.0f};
+	// The hitch whose capture is still recording its frames after, zero when none is.
+	unsigned long long PendingHitchFrame {0u};
+	unsigned int CaptureNum {0u};
+	std::string LastCaptureFileName;
+	JobCounter CaptureWritten;
+};
@@ -0,0 +1,51 @@
+﻿#include "HullShader.h"
+#include "BindManager.h"
+#include "DrawPacket.h"
+#include "ExceptionMacros.h"
+
+HullShader::HullShader(const Graphics& InGraphics, const std::string_view InFileName)
+	: FileName(InFileName)
+{
+	HRESULT ResultHandle;
+	const auto ByteCodeBlob = InGraphics.GetShaderBundle().Load(InFileName);
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateHullShader
+	(
+		ByteCodeBlob->GetBufferPointer(),
+		ByteCodeBlob->GetBufferSize(),
+		nullptr,
+		&MyHullShader
+	))
+}
+
+void HullShader::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetHullShader(MyHullShader.Get());
+}
+
+bool HullShader::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.HullShader = MyHullShader.Get();
+	return true;
+}
+
+std::shared_ptr<HullShader> HullShader::Resolve(const Graphics& InGraphics, const std::string_view InFileName)
+{
+	return BindManager::Resolve<HullShader>(InGraphics, InFileName);
+}
+
+std::string HullShader::GenerateUniqueID(const std::string_view InFileName)
+{
+	using namespace std::string_literals;
+	return typeid(HullShader).name() + "#"s + std::string(InFileName);
+}
+
+BindKey HullShader::GenerateKey(const std::string_view InFileName)
+{
+	return BindKey::Make<HullShader>(InFileName);
+}
+
+std::string HullShader::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(FileName);
+}
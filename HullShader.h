@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <memory>
+#include <string_view>
+#include "BindKey.h"
+#include "Bindable.h"
+
+// Picks how finely each patch is tessellated and passes its control points on, bound only while a patch list draws.
+class HullShader : public Bindable
+{
+public:
+	HullShader(const Graphics& InGraphics, std::string_view InFileName);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] const std::string& GetFileName() const noexcept
+	{
+		return FileName;
+	}
+
+	[[nodiscard]] static std::shared_ptr<HullShader> Resolve(const Graphics& InGraphics, std::string_view InFileName);
+	[[nodiscard]] static std::string GenerateUniqueID(std::string_view InFileName);
+	[[nodiscard]] static BindKey GenerateKey(std::string_view InFileName);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+
+protected:
+	std::string FileName;
+	Microsoft::WRL::ComPtr<ID3D11HullShader> MyHullShader;
+};
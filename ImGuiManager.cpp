@@ -1,8 +1,10 @@
 ﻿#include "ImguiManager.h"
+#include "StartupTimeline.h"
 #include "imgui/imgui.h"
 
 ImGuiManager::ImGuiManager()
 {
+	STARTUP_PHASE("ImGui context");
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
 	ImGui::StyleColorsDark();
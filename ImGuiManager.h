@@ -1,8 +1,35 @@
 ﻿#pragma once
+#include <atomic>
+#include <mutex>
 
 class ImGuiManager
 {
 public:
 	ImGuiManager();
 	~ImGuiManager();
+
+	/**
+	 * Held while the window procedure feeds events to ImGui and while a frame starts, which may happen on different threads.
+	 * Recursive because ImGui's own calls such as SetCapture send messages straight back into the window procedure.
+	 */
+	[[nodiscard]] static std::recursive_mutex& GetInputMutex() noexcept
+	{
+		return InputMutex;
+	}
+
+	// Called by the window procedure for input ImGui reacts to, so a cached UI knows to rebuild.
+	static void NotifyInput() noexcept
+	{
+		bHasPendingInput.store(true, std::memory_order_relaxed);
+	}
+
+	// Whether any input arrived since the last call.
+	[[nodiscard]] static bool ConsumeInput() noexcept
+	{
+		return bHasPendingInput.exchange(false, std::memory_order_relaxed);
+	}
+
+private:
+	static inline std::recursive_mutex InputMutex;
+	static inline std::atomic<bool> bHasPendingInput {false};
 };
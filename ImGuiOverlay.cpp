@@ -0,0 +1,78 @@
+﻿#include "ImGuiOverlay.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+ImGuiOverlay::ImGuiOverlay(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, const UINT InWidth, const UINT InHeight)
+{
+	HRESULT ResultHandle;
+
+	// ImGui's colors are already encoded, so the texture stores them as they are, like the display view it draws through otherwise.
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = InWidth;
+	TextureDesc.Height = InHeight;
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.SampleDesc.Quality = 0u;
+	TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	TextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, nullptr, &Texture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(Texture.Get(), nullptr, &TargetView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Texture.Get(), nullptr, &TextureView))
+
+	// The same screen covering triangle the last post-processing pass draws.
+	const auto VertexBlob = InShaderBundle.Load("FullscreenVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &VertexShader))
+
+	const auto PixelBlob = InShaderBundle.Load("ImGuiOverlayPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(PixelBlob->GetBufferPointer(), PixelBlob->GetBufferSize(), nullptr, &PixelShader))
+
+	D3D11_BLEND_DESC BlendDesc {};
+	auto& Target = BlendDesc.RenderTarget[0];
+	Target.BlendEnable = TRUE;
+	Target.SrcBlend = D3D11_BLEND_ONE;
+	Target.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	Target.BlendOp = D3D11_BLEND_OP_ADD;
+	Target.SrcBlendAlpha = D3D11_BLEND_ONE;
+	Target.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	Target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	Target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBlendState(&BlendDesc, &BlendState))
+}
+
+void ImGuiOverlay::BeginRefresh(const Graphics& InGraphics)
+{
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+
+	Cache.SetRenderTarget(TargetView.Get(), nullptr);
+
+	constexpr float Transparent[4] {0.0f, 0.0f, 0.0f, 0.0f};
+	Context.GetDeviceContext()->ClearRenderTargetView(TargetView.Get(), Transparent);
+}
+
+void ImGuiOverlay::Composite(const Graphics& InGraphics, ID3D11RenderTargetView* InTarget)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "ImGui composite");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+
+	Cache.SetRenderTarget(InTarget, nullptr);
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	Cache.SetInputLayout(nullptr);
+	Cache.SetRasterizerState(nullptr);
+	Cache.SetBlendState(BlendState.Get());
+	Cache.SetVertexShader(VertexShader.Get());
+	Cache.SetPixelShader(PixelShader.Get());
+	Cache.SetPixelShaderResource(OverlaySlot, TextureView.Get());
+
+	Context.GetDeviceContext()->Draw(3u, 0u);
+	Cache.CountDraw(3u, 1u);
+
+	Cache.SetPixelShaderResource(OverlaySlot, nullptr);
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * ImGui rendered into a texture of the display's size, so frames between refreshes composite the cached UI in one
+ * fullscreen pass instead of building and drawing every window again.
+ * ImGui blends onto a cleared transparent target, which leaves the texture premultiplied by its coverage.
+ */
+class ImGuiOverlay
+{
+public:
+	ImGuiOverlay(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, UINT InWidth, UINT InHeight);
+	ImGuiOverlay(const ImGuiOverlay&) = delete;
+	ImGuiOverlay(ImGuiOverlay&&) = delete;
+	ImGuiOverlay& operator=(const ImGuiOverlay&) = delete;
+	ImGuiOverlay& operator=(ImGuiOverlay&&) = delete;
+	~ImGuiOverlay() = default;
+
+	// Clears the cached UI and leaves its texture bound for ImGui to draw into.
+	void BeginRefresh(const Graphics& InGraphics);
+	// Blends the cached UI over InTarget, which is left bound without depth.
+	void Composite(const Graphics& InGraphics, ID3D11RenderTargetView* InTarget);
+
+private:
+	// Register of the overlay texture in ImGuiOverlayPS.hlsl.
+	static constexpr UINT OverlaySlot {0u};
+
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> TargetView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> TextureView;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> PixelShader;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> BlendState;
+};
@@ -0,0 +1,8 @@
+// The cached UI, premultiplied by its coverage and blended with ONE, INV_SRC_ALPHA.
+Texture2D<float4> Overlay : register(t0);
+
+// Same size as the display, so every pixel reads exactly its own texel.
+float4 main(const float4 InPosition : SV_Position) : SV_Target
+{
+    return Overlay.Load(int3(InPosition.xy, 0));
+}
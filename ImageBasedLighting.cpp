@@ -0,0 +1,529 @@
+﻿#include "ImageBasedLighting.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include "AssetArchive.h"
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "Graphics.h"
+#include "MappedFile.h"
+#include "ShaderBundle.h"
+#include "Surface.h"
+
+namespace
+{
+	constexpr char Magic[4] {'I', 'B', 'L', 'C'};
+	// Bump whenever the projection, the prefiltering, the specular format or the file layout change.
+	constexpr uint32_t Version {1u};
+	constexpr UINT FaceNum {6u};
+	// Four channels of half floats.
+	constexpr size_t TexelBytes {8u};
+
+	struct Header
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint64_t SourceSize;
+		int64_t SourceWriteTime;
+		uint64_t SourceHash;
+		uint32_t FaceSize;
+		uint32_t MipNum;
+	};
+
+	std::filesystem::path GetCachePath(const std::filesystem::path& InSourcePath)
+	{
+		auto CachePath = InSourcePath;
+		CachePath += ".iblcache";
+		return CachePath;
+	}
+
+	// FNV-1a, only used to notice edits that keep the size and timestamp.
+	uint64_t HashBytes(const std::byte* InData, const size_t InSize) noexcept
+	{
+		uint64_t Hash {14695981039346656037ull};
+
+		for (size_t Index = 0; Index < InSize; ++Index)
+		{
+			Hash ^= static_cast<uint64_t>(InData[Index]);
+			Hash *= 1099511628211ull;
+		}
+
+		return Hash;
+	}
+
+	size_t GetTexelBytes(const UINT InFaceSize, const UINT InMipNum) noexcept
+	{
+		size_t Bytes = 0u;
+
+		for (UINT Mip = 0u; Mip < InMipNum; ++Mip)
+		{
+			const size_t MipSize = InFaceSize >> Mip;
+			Bytes += MipSize * MipSize * TexelBytes;
+		}
+
+		return Bytes * FaceNum;
+	}
+
+	// The same faces and orientation as GetFaceDirection in EnvironmentPrefilterCS.hlsl.
+	DirectX::XMVECTOR GetFaceDirection(const UINT InFace, const float InX, const float InY) noexcept
+	{
+		switch (InFace)
+		{
+		case 0u: return DirectX::XMVectorSet(1.0f, -InY, -InX, 0.0f);
+		case 1u: return DirectX::XMVectorSet(-1.0f, -InY, InX, 0.0f);
+		case 2u: return DirectX::XMVectorSet(InX, 1.0f, InY, 0.0f);
+		case 3u: return DirectX::XMVectorSet(InX, -1.0f, -InY, 0.0f);
+		case 4u: return DirectX::XMVectorSet(InX, -InY, 1.0f, 0.0f);
+		default: return DirectX::XMVectorSet(-InX, -InY, -1.0f, 0.0f);
+		}
+	}
+
+	// Column and row of each face in the horizontal cross, +Y above +Z and -Y below, -X, +Z, +X and -Z across the middle.
+	constexpr UINT FaceColumns[FaceNum] {2u, 0u, 1u, 1u, 1u, 3u};
+	constexpr UINT FaceRows[FaceNum] {1u, 1u, 0u, 2u, 1u, 1u};
+
+	bool ReadCache(const std::filesystem::path& InSourcePath, const Header& InSourceHeader, Header& OutHeader,
+	               std::array<DirectX::XMFLOAT4, ImageBasedLighting::CoefficientNum>& OutIrradiance, std::vector<std::byte>& OutTexels)
+	{
+		const MappedFile Cache(GetCachePath(InSourcePath));
+		if (!Cache.IsValid() || Cache.GetSize() < sizeof(Header) + sizeof(OutIrradiance))
+		{
+			return false;
+		}
+
+		std::memcpy(&OutHeader, Cache.GetData(), sizeof(Header));
+		if (std::memcmp(OutHeader.Magic, Magic, sizeof(Magic)) != 0 ||
+			OutHeader.Version != Version ||
+			OutHeader.SourceSize != InSourceHeader.SourceSize ||
+			OutHeader.SourceWriteTime != InSourceHeader.SourceWriteTime ||
+			OutHeader.SourceHash != InSourceHeader.SourceHash ||
+			OutHeader.FaceSize == 0u || OutHeader.FaceSize > ImageBasedLighting::MaxFaceSize ||
+			OutHeader.MipNum == 0u || OutHeader.MipNum > ImageBasedLighting::MaxMipNum || (OutHeader.FaceSize >> (OutHeader.MipNum - 1u)) == 0u ||
+			Cache.GetSize() != sizeof(Header) + sizeof(OutIrradiance) + GetTexelBytes(OutHeader.FaceSize, OutHeader.MipNum))
+		{
+			return false;
+		}
+
+		std::memcpy(OutIrradiance.data(), Cache.GetData() + sizeof(Header), sizeof(OutIrradiance));
+		OutTexels.assign(Cache.GetData() + sizeof(Header) + sizeof(OutIrradiance), Cache.GetData() + Cache.GetSize());
+		return true;
+	}
+
+	bool WriteCache(const std::filesystem::path& InSourcePath, const Header& InHeader,
+	                const std::array<DirectX::XMFLOAT4, ImageBasedLighting::CoefficientNum>& InIrradiance, const std::vector<std::byte>& InTexels)
+	{
+		const auto CachePath = GetCachePath(InSourcePath);
+		auto TemporaryPath = CachePath;
+		TemporaryPath += ".tmp";
+
+		std::error_code ErrorCode;
+
+		{
+			std::ofstream Stream(TemporaryPath, std::ios::binary | std::ios::trunc);
+			if (!Stream)
+			{
+				return false;
+			}
+
+			Stream.write(reinterpret_cast<const char*>(&InHeader), sizeof(InHeader));
+			Stream.write(reinterpret_cast<const char*>(InIrradiance.data()), sizeof(InIrradiance));
+			Stream.write(reinterpret_cast<const char*>(InTexels.data()), static_cast<std::streamsize>(InTexels.size()));
+
+			if (!Stream.flush())
+			{
+				Stream.close();
+				std::filesystem::remove(TemporaryPath, ErrorCode);
+				return false;
+			}
+		}
+
+		// Written aside and renamed so a crash never leaves a truncated cache behind.
+		std::filesystem::rename(TemporaryPath, CachePath, ErrorCode);
+		if (ErrorCode)
+		{
+			std::filesystem::remove(TemporaryPath, ErrorCode);
+			return false;
+		}
+
+		return true;
+	}
+}
+
+ImageBasedLighting::ImageBasedLighting(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+	: Device(InDevice)
+{
+	HRESULT ResultHandle;
+
+	const auto Blob = InShaderBundle.Load("EnvironmentPrefilterCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &PrefilterShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(LightingConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	ConstantBufferDesc.ByteWidth = sizeof(PrefilterConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &PrefilterConstantBuffer))
+
+	// Trilinear across the mips, and seamless across the faces as cubes always are in D3D11.
+	D3D11_SAMPLER_DESC SamplerDesc {};
+	SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateSamplerState(&SamplerDesc, &Sampler))
+}
+
+void ImageBasedLighting::Load(const Graphics& InGraphics, const std::filesystem::path& InCrossPath)
+{
+	PROFILE_SCOPE("ImageBasedLighting::Load");
+
+	const auto LoadStart = std::chrono::steady_clock::now();
+
+	// The archive keeps the packed file's size and write time, so a cache written from the loose image still matches.
+	const auto& Archive = AssetArchive::Get();
+	const auto Status = Archive.GetStatus(InCrossPath);
+	std::vector<std::byte> SourceBytes;
+
+	if (!Status || !Archive.Read(InCrossPath, SourceBytes) || SourceBytes.empty())
+	{
+		throw INFO_EXCEPTION({"Loading environment [" + InCrossPath.string() + "]: failed to read."});
+	}
+
+	Header SourceHeader {};
+	std::memcpy(SourceHeader.Magic, Magic, sizeof(Magic));
+	SourceHeader.Version = Version;
+	SourceHeader.SourceSize = SourceBytes.size();
+	SourceHeader.SourceWriteTime = Status->WriteTime;
+	SourceHeader.SourceHash = HashBytes(SourceBytes.data(), SourceBytes.size());
+
+	Header CacheHeader {};
+	std::vector<std::byte> Texels;
+	bIsFromCache = ReadCache(InCrossPath, SourceHeader, CacheHeader, Irradiance, Texels);
+
+	if (bIsFromCache)
+	{
+		FaceSize = CacheHeader.FaceSize;
+		MipNum = CacheHeader.MipNum;
+		CreateSpecular(Texels);
+	}
+	else
+	{
+		const auto Cross = Surface::FromMemory(InCrossPath.string(), SourceBytes);
+		const auto SourceFaceSize = Cross.GetWidth() / 4u;
+
+		if (SourceFaceSize == 0u || Cross.GetWidth() != SourceFaceSize * 4u || Cross.GetHeight() != SourceFaceSize * 3u)
+		{
+			throw INFO_EXCEPTION({"Loading environment [" + InCrossPath.string() + "]: not a horizontal cross of square faces."});
+		}
+
+		Irradiance = ProjectIrradiance(Cross, SourceFaceSize);
+		Texels = Prefilter(InGraphics, Cross, SourceFaceSize);
+
+		SourceHeader.FaceSize = FaceSize;
+		SourceHeader.MipNum = MipNum;
+		// A read-only asset directory only costs the next load the precomputation again.
+		WriteCache(InCrossPath, SourceHeader, Irradiance, Texels);
+	}
+
+	LoadMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - LoadStart).count();
+	bIsConstantBufferStale = true;
+}
+
+std::array<DirectX::XMFLOAT4, ImageBasedLighting::CoefficientNum> ImageBasedLighting::ProjectIrradiance(const Surface& InCross, const UINT InSourceFaceSize)
+{
+	// Every texel of a small face, a grid of them on a large one, the lowest bands don't need more.
+	const auto Step = std::max(InSourceFaceSize / MaxFaceSize, 1u);
+	const auto* const Pixels = InCross.GetBufferPtrConst();
+	const auto Width = InCross.GetWidth();
+
+	std::array<float, 256> SrgbToLinear;
+
+	for (size_t Value = 0u; Value < SrgbToLinear.size(); ++Value)
+	{
+		const auto Encoded = static_cast<float>(Value) / 255.0f;
+		SrgbToLinear[Value] = Encoded <= 0.04045f ? Encoded / 12.92f : std::pow((Encoded + 0.055f) / 1.055f, 2.4f);
+	}
+
+	std::array<DirectX::XMVECTOR, CoefficientNum> Sums;
+	Sums.fill(DirectX::XMVectorZero());
+	float WeightSum = 0.0f;
+
+	for (UINT Face = 0u; Face < FaceNum; ++Face)
+	{
+		for (UINT Y = Step / 2u; Y < InSourceFaceSize; Y += Step)
+		{
+			for (UINT X = Step / 2u; X < InSourceFaceSize; X += Step)
+			{
+				const auto FaceX = (static_cast<float>(X) + 0.5f) / static_cast<float>(InSourceFaceSize) * 2.0f - 1.0f;
+				const auto FaceY = (static_cast<float>(Y) + 0.5f) / static_cast<float>(InSourceFaceSize) * 2.0f - 1.0f;
+				// Texels toward a face's edges cover less of the sphere, the constant factor cancels in the normalization.
+				const auto Weight = 1.0f / std::pow(1.0f + FaceX * FaceX + FaceY * FaceY, 1.5f);
+
+				DirectX::XMFLOAT3 Direction;
+				DirectX::XMStoreFloat3(&Direction, DirectX::XMVector3Normalize(GetFaceDirection(Face, FaceX, FaceY)));
+
+				const auto Pixel = Pixels[(FaceRows[Face] * InSourceFaceSize + Y) * Width + FaceColumns[Face] * InSourceFaceSize + X];
+				const auto Radiance = DirectX::XMVectorScale(DirectX::XMVectorSet(SrgbToLinear[Pixel.GetR()], SrgbToLinear[Pixel.GetG()], SrgbToLinear[Pixel.GetB()], 0.0f), Weight);
+
+				const auto [DX, DY, DZ] = Direction;
+				const float Basis[CoefficientNum]
+				{
+					0.282095f,
+					0.488603f * DY,
+					0.488603f * DZ,
+					0.488603f * DX,
+					1.092548f * DX * DY,
+					1.092548f * DY * DZ,
+					0.315392f * (3.0f * DZ * DZ - 1.0f),
+					1.092548f * DX * DZ,
+					0.546274f * (DX * DX - DY * DY)
+				};
+
+				for (UINT Index = 0u; Index < CoefficientNum; ++Index)
+				{
+					Sums[Index] = DirectX::XMVectorMultiplyAdd(Radiance, DirectX::XMVectorReplicate(Basis[Index]), Sums[Index]);
+				}
+
+				WeightSum += Weight;
+			}
+		}
+	}
+
+	// The weights sum to the whole sphere, and each band is convolved with the cosine lobe, pi, 2 pi / 3 and pi / 4,
+	// then divided by pi so a white surface reflects what the shader evaluates.
+	constexpr float BandScales[CoefficientNum] {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+	const auto SphereScale = 4.0f * std::numbers::pi_v<float> / WeightSum;
+
+	std::array<DirectX::XMFLOAT4, CoefficientNum> Coefficients;
+
+	for (UINT Index = 0u; Index < CoefficientNum; ++Index)
+	{
+		DirectX::XMStoreFloat4(&Coefficients[Index], DirectX::XMVectorScale(Sums[Index], SphereScale * BandScales[Index]));
+	}
+
+	return Coefficients;
+}
+
+std::vector<std::byte> ImageBasedLighting::Prefilter(const Graphics& InGraphics, const Surface& InCross, const UINT InSourceFaceSize)
+{
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+	HRESULT ResultHandle;
+
+	// The source keeps its 8-bit sRGB texels, with a full mip chain for the wide lobes to sample from.
+	D3D11_TEXTURE2D_DESC SourceDesc {};
+	SourceDesc.Width = InSourceFaceSize;
+	SourceDesc.Height = InSourceFaceSize;
+	SourceDesc.MipLevels = 0u;
+	SourceDesc.ArraySize = FaceNum;
+	SourceDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	SourceDesc.SampleDesc.Count = 1u;
+	SourceDesc.Usage = D3D11_USAGE_DEFAULT;
+	SourceDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	SourceDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE | D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> SourceTexture;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&SourceDesc, nullptr, &SourceTexture))
+	SourceTexture->GetDesc(&SourceDesc);
+
+	const auto* const Pixels = InCross.GetBufferPtrConst();
+	const auto RowPitch = static_cast<UINT>(InCross.GetWidth() * sizeof(Surface::Color));
+
+	for (UINT Face = 0u; Face < FaceNum; ++Face)
+	{
+		const auto* const FacePixels = Pixels + FaceRows[Face] * InSourceFaceSize * InCross.GetWidth() + FaceColumns[Face] * InSourceFaceSize;
+		DeviceContext->UpdateSubresource(SourceTexture.Get(), D3D11CalcSubresource(0u, Face, SourceDesc.MipLevels), nullptr, FacePixels, RowPitch, 0u);
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SourceViewDesc {};
+	SourceViewDesc.Format = SourceDesc.Format;
+	SourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	SourceViewDesc.TextureCube.MipLevels = SourceDesc.MipLevels;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SourceView;
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(SourceTexture.Get(), &SourceViewDesc, &SourceView))
+	DeviceContext->GenerateMips(SourceView.Get());
+
+	FaceSize = std::bit_floor(std::min(InSourceFaceSize, MaxFaceSize));
+	MipNum = std::min(static_cast<UINT>(std::bit_width(FaceSize)), MaxMipNum);
+
+	D3D11_TEXTURE2D_DESC SpecularDesc {};
+	SpecularDesc.Width = FaceSize;
+	SpecularDesc.Height = FaceSize;
+	SpecularDesc.MipLevels = MipNum;
+	SpecularDesc.ArraySize = FaceNum;
+	SpecularDesc.Format = SpecularFormat;
+	SpecularDesc.SampleDesc.Count = 1u;
+	SpecularDesc.Usage = D3D11_USAGE_DEFAULT;
+	SpecularDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	SpecularDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> SpecularTexture;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&SpecularDesc, nullptr, &SpecularTexture))
+
+	PrefilterConstants Constants {};
+	Constants.SourceTexelSolidAngle = 4.0f * std::numbers::pi_v<float> / (static_cast<float>(FaceNum) * static_cast<float>(InSourceFaceSize * InSourceFaceSize));
+
+	DeviceContext->CSSetShader(PrefilterShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(PrefilterConstantSlot, 1u, PrefilterConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetSamplers(PrefilterSamplerSlot, 1u, Sampler.GetAddressOf());
+
+	for (UINT Mip = 0u; Mip < MipNum; ++Mip)
+	{
+		D3D11_UNORDERED_ACCESS_VIEW_DESC UavDesc {};
+		UavDesc.Format = SpecularFormat;
+		UavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2DARRAY;
+		UavDesc.Texture2DArray.MipSlice = Mip;
+		UavDesc.Texture2DArray.ArraySize = FaceNum;
+
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> MipUav;
+		CHECK_HRESULT_EXCEPTION(Device->CreateUnorderedAccessView(SpecularTexture.Get(), &UavDesc, &MipUav))
+
+		Constants.FaceSize = FaceSize >> Mip;
+		Constants.SpecularPower = std::exp2(SpecularMip0PowerLog2 - static_cast<float>(Mip) * SpecularPowerLog2PerMip);
+
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+		CHECK_HRESULT_EXCEPTION(DeviceContext->Map(PrefilterConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+		DeviceContext->Unmap(PrefilterConstantBuffer.Get(), 0u);
+
+		DeviceContext->CSSetShaderResources(SourceSlot, 1u, SourceView.GetAddressOf());
+		DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, MipUav.GetAddressOf(), nullptr);
+
+		const auto GroupNum = (Constants.FaceSize + GroupSize - 1u) / GroupSize;
+		InGraphics.Dispatch(GroupNum, GroupNum, FaceNum);
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SpecularViewDesc {};
+	SpecularViewDesc.Format = SpecularFormat;
+	SpecularViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	SpecularViewDesc.TextureCube.MipLevels = MipNum;
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(SpecularTexture.Get(), &SpecularViewDesc, &SpecularView))
+
+	// Read back for the cache, mapping waits for the dispatches.
+	D3D11_TEXTURE2D_DESC StagingDesc = SpecularDesc;
+	StagingDesc.Usage = D3D11_USAGE_STAGING;
+	StagingDesc.BindFlags = 0u;
+	StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> StagingTexture;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&StagingDesc, nullptr, &StagingTexture))
+	DeviceContext->CopyResource(StagingTexture.Get(), SpecularTexture.Get());
+
+	std::vector<std::byte> Texels(GetTexelBytes(FaceSize, MipNum));
+	auto* Destination = Texels.data();
+
+	for (UINT Face = 0u; Face < FaceNum; ++Face)
+	{
+		for (UINT Mip = 0u; Mip < MipNum; ++Mip)
+		{
+			const auto Subresource = D3D11CalcSubresource(Mip, Face, MipNum);
+			const size_t MipSize = FaceSize >> Mip;
+
+			D3D11_MAPPED_SUBRESOURCE MappedResource;
+			CHECK_HRESULT_EXCEPTION(DeviceContext->Map(StagingTexture.Get(), Subresource, D3D11_MAP_READ, 0u, &MappedResource))
+
+			for (size_t Row = 0u; Row < MipSize; ++Row)
+			{
+				std::memcpy(Destination, static_cast<const std::byte*>(MappedResource.pData) + Row * MappedResource.RowPitch, MipSize * TexelBytes);
+				Destination += MipSize * TexelBytes;
+			}
+
+			DeviceContext->Unmap(StagingTexture.Get(), Subresource);
+		}
+	}
+
+	return Texels;
+}
+
+void ImageBasedLighting::CreateSpecular(const std::vector<std::byte>& InTexels)
+{
+	D3D11_TEXTURE2D_DESC SpecularDesc {};
+	SpecularDesc.Width = FaceSize;
+	SpecularDesc.Height = FaceSize;
+	SpecularDesc.MipLevels = MipNum;
+	SpecularDesc.ArraySize = FaceNum;
+	SpecularDesc.Format = SpecularFormat;
+	SpecularDesc.SampleDesc.Count = 1u;
+	SpecularDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	SpecularDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	SpecularDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	// Packed face by face, each with its mips, the order of the subresources.
+	std::array<D3D11_SUBRESOURCE_DATA, FaceNum * MaxMipNum> InitialData {};
+	const auto* Source = InTexels.data();
+
+	for (UINT Face = 0u; Face < FaceNum; ++Face)
+	{
+		for (UINT Mip = 0u; Mip < MipNum; ++Mip)
+		{
+			const size_t MipSize = FaceSize >> Mip;
+			auto& Data = InitialData[D3D11CalcSubresource(Mip, Face, MipNum)];
+			Data.pSysMem = Source;
+			Data.SysMemPitch = static_cast<UINT>(MipSize * TexelBytes);
+			Source += MipSize * MipSize * TexelBytes;
+		}
+	}
+
+	HRESULT ResultHandle;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> SpecularTexture;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&SpecularDesc, InitialData.data(), &SpecularTexture))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC SpecularViewDesc {};
+	SpecularViewDesc.Format = SpecularFormat;
+	SpecularViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	SpecularViewDesc.TextureCube.MipLevels = MipNum;
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(SpecularTexture.Get(), &SpecularViewDesc, &SpecularView))
+}
+
+void ImageBasedLighting::BeginFrame(const Graphics& InGraphics)
+{
+	if (!bIsConstantBufferStale)
+	{
+		return;
+	}
+
+	LightingConstants Constants {};
+	Constants.Irradiance = Irradiance;
+	Constants.Intensity = Intensity;
+	Constants.SpecularMipNum = static_cast<float>(MipNum);
+	Constants.bHasEnvironment = bIsEnabled && HasEnvironment();
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	bIsConstantBufferStale = false;
+}
+
+void ImageBasedLighting::Bind(RenderContext& InContext) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelShaderResource(SpecularSlot, SpecularView.Get());
+	Cache.SetPixelSampler(SamplerSlot, Sampler.Get());
+}
+
+void ImageBasedLighting::BindCompute(ID3D11DeviceContext* InContext) const noexcept
+{
+	InContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	InContext->CSSetShaderResources(SpecularSlot, 1u, SpecularView.GetAddressOf());
+	InContext->CSSetSamplers(SamplerSlot, 1u, Sampler.GetAddressOf());
+}
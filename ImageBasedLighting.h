@@ -0,0 +1,153 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <cstddef>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <filesystem>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class RenderContext;
+class ShaderBundle;
+class Surface;
+
+/**
+ * Ambient light and reflections from an environment, in place of the one constant ambient colour.
+ * An environment is loaded once from a horizontal cross image, four faces wide and three high, and turned into L2
+ * spherical harmonics of its diffuse irradiance and a cube whose mips are prefiltered for ever wider specular lobes.
+ * Both are cached next to the image as "<file>.iblcache" and only computed again when the image changes, so shading
+ * reads nine coefficients and one cube sample per pixel. The layout and the lobe each mip holds are in ImageBasedLighting.hlsli.
+ */
+class ImageBasedLighting
+{
+public:
+	static constexpr DXGI_FORMAT SpecularFormat {DXGI_FORMAT_R16G16B16A16_FLOAT};
+	static constexpr UINT MaxFaceSize {128u};
+	static constexpr UINT MaxMipNum {6u};
+	static constexpr UINT CoefficientNum {9u};
+
+	ImageBasedLighting(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	ImageBasedLighting(const ImageBasedLighting&) = delete;
+	ImageBasedLighting(ImageBasedLighting&&) = delete;
+	ImageBasedLighting& operator=(const ImageBasedLighting&) = delete;
+	ImageBasedLighting& operator=(ImageBasedLighting&&) = delete;
+	~ImageBasedLighting() = default;
+
+	// Replaces the current environment. Prefiltering runs on the GPU and waits for it, reading the result back for the cache.
+	void Load(const Graphics& InGraphics, const std::filesystem::path& InCrossPath);
+
+	void Bind(RenderContext& InContext) const noexcept;
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+
+	// Off falls back to the constant ambient colour without reflections, which is also what shading sees before a Load.
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+		bIsConstantBufferStale = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+		bIsConstantBufferStale = true;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+	// Scales both the ambient and the reflections the environment gives.
+	void SetIntensity(const float InIntensity) noexcept
+	{
+		Intensity = InIntensity;
+		bIsConstantBufferStale = true;
+	}
+
+	[[nodiscard]] bool HasEnvironment() const noexcept
+	{
+		return SpecularView != nullptr;
+	}
+
+	[[nodiscard]] UINT GetFaceSize() const noexcept
+	{
+		return FaceSize;
+	}
+
+	[[nodiscard]] UINT GetMipNum() const noexcept
+	{
+		return MipNum;
+	}
+
+	// Whether the environment came from its cache rather than being computed, and how long loading it took.
+	[[nodiscard]] bool IsFromCache() const noexcept
+	{
+		return bIsFromCache;
+	}
+
+	[[nodiscard]] float GetLoadMilliseconds() const noexcept
+	{
+		return LoadMilliseconds;
+	}
+
+	// Writes the constants when something they hold changed, before the frame's first bind.
+	void BeginFrame(const Graphics& InGraphics);
+
+private:
+	struct LightingConstants
+	{
+		std::array<DirectX::XMFLOAT4, CoefficientNum> Irradiance;
+		float Intensity;
+		float SpecularMipNum;
+		UINT bHasEnvironment;
+		float Padding;
+	};
+
+	struct PrefilterConstants
+	{
+		UINT FaceSize;
+		float SpecularPower;
+		// Of a texel of the source's first mip, sampling picks a mip from what each sample covers against it.
+		float SourceTexelSolidAngle;
+		float Padding;
+	};
+
+	// Nine RGB coefficients of what the cross's faces see, convolved with the cosine lobe and over pi.
+	static std::array<DirectX::XMFLOAT4, CoefficientNum> ProjectIrradiance(const Surface& InCross, UINT InSourceFaceSize);
+
+	// Fills the specular cube from the cross and returns its texels packed in subresource order, for the cache.
+	[[nodiscard]] std::vector<std::byte> Prefilter(const Graphics& InGraphics, const Surface& InCross, UINT InSourceFaceSize);
+	void CreateSpecular(const std::vector<std::byte>& InTexels);
+
+	// Registers in ImageBasedLighting.hlsli, the shading passes keep the rest of theirs.
+	static constexpr UINT ConstantSlot {4u};
+	static constexpr UINT SpecularSlot {13u};
+	static constexpr UINT SamplerSlot {2u};
+	// Registers in EnvironmentPrefilterCS.hlsl.
+	static constexpr UINT PrefilterConstantSlot {0u};
+	static constexpr UINT SourceSlot {0u};
+	static constexpr UINT PrefilterSamplerSlot {0u};
+	static constexpr UINT OutputSlot {0u};
+	static constexpr UINT GroupSize {8u};
+	// The lobes ImageBasedLighting.hlsli expects in each mip.
+	static constexpr float SpecularMip0PowerLog2 {13.0f};
+	static constexpr float SpecularPowerLog2PerMip {2.0f};
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> PrefilterShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> PrefilterConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> Sampler;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SpecularView;
+
+	ID3D11Device* Device;
+	std::array<DirectX::XMFLOAT4, CoefficientNum> Irradiance {};
+	UINT FaceSize {0u};
+	UINT MipNum {0u};
+	float Intensity {1.0f};
+	float LoadMilliseconds {0.0f};
+	bool bIsEnabled {true};
+	bool bIsFromCache {false};
+	bool bIsConstantBufferStale {true};
+};
@@ -0,0 +1,46 @@
+// Ambient and reflected light from ImageBasedLighting's environment, laid out like ImageBasedLighting::LightingConstants.
+// Without an environment the constant ambient colour stands in and nothing is reflected.
+cbuffer ImageBasedLighting : register(b4)
+{
+    // L2 spherical harmonics of the irradiance over pi, what a white diffuse surface facing that way reflects.
+    float4 IrradianceCoefficients[9];
+    float EnvironmentIntensity;
+    float SpecularMipNum;
+    uint bHasEnvironment;
+    float EnvironmentPadding;
+}
+
+TextureCube<float3> SpecularEnvironment : register(t13);
+SamplerState EnvironmentSampler : register(s2);
+
+// Mip 0 of the specular cube holds the Phong lobe of this power, every further mip one of a quarter of the last.
+// The same as ImageBasedLighting's, which prefilters them.
+static const float SpecularMip0PowerLog2 = 13.0f;
+static const float SpecularPowerLog2PerMip = 2.0f;
+
+float3 CalcIrradiance(const float3 InNormal)
+{
+    float3 Irradiance = IrradianceCoefficients[0].rgb * 0.282095f;
+    Irradiance += IrradianceCoefficients[1].rgb * 0.488603f * InNormal.y;
+    Irradiance += IrradianceCoefficients[2].rgb * 0.488603f * InNormal.z;
+    Irradiance += IrradianceCoefficients[3].rgb * 0.488603f * InNormal.x;
+    Irradiance += IrradianceCoefficients[4].rgb * 1.092548f * InNormal.x * InNormal.y;
+    Irradiance += IrradianceCoefficients[5].rgb * 1.092548f * InNormal.y * InNormal.z;
+    Irradiance += IrradianceCoefficients[6].rgb * 0.315392f * (3.0f * InNormal.z * InNormal.z - 1.0f);
+    Irradiance += IrradianceCoefficients[7].rgb * 1.092548f * InNormal.x * InNormal.z;
+    Irradiance += IrradianceCoefficients[8].rgb * 0.546274f * (InNormal.x * InNormal.x - InNormal.y * InNormal.y);
+    return max(Irradiance, 0.0f) * EnvironmentIntensity;
+}
+
+// What the environment reflects towards the camera along a Phong lobe of InSpecularPower around the mirror direction.
+float3 CalcEnvironmentSpecular(const float3 InNormal, const float3 InVectorToCamera, const float InSpecularPower)
+{
+    if (!bHasEnvironment)
+    {
+        return float3(0.0f, 0.0f, 0.0f);
+    }
+
+    const float3 Reflected = reflect(-normalize(InVectorToCamera), InNormal);
+    const float Mip = clamp((SpecularMip0PowerLog2 - log2(max(InSpecularPower, 1.0f))) / SpecularPowerLog2PerMip, 0.0f, SpecularMipNum - 1.0f);
+    return SpecularEnvironment.SampleLevel(EnvironmentSampler, Reflected, Mip) * EnvironmentIntensity;
+}
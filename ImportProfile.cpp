@@ -0,0 +1,226 @@
+﻿#include "ImportProfile.h"
+#include <array>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include "AssetArchive.h"
+#include "assimp/config.h"
+#include "assimp/Importer.hpp"
+#include "assimp/mesh.h"
+#include "assimp/postprocess.h"
+
+namespace
+{
+	// The vertex extraction reads triangles in left-handed space.
+	constexpr unsigned int RequiredSteps {aiProcess_Triangulate | aiProcess_ConvertToLeftHanded};
+
+	// Point and line primitives are sorted out and dropped, so every mesh left is triangles. OptimizeGraph and FindInstances are
+	// left to the sidecar, the first collapses nodes the static merge and levels of detail look up by name. ImproveCacheLocality
+	// is too since the mesh optimizer reorders for the vertex cache on its own.
+	constexpr unsigned int DefaultSteps {RequiredSteps | aiProcess_JoinIdenticalVertices | aiProcess_GenNormals | aiProcess_LimitBoneWeights |
+	                                     aiProcess_SortByPType};
+
+	struct NamedStep
+	{
+		std::string_view Name;
+		unsigned int Step;
+	};
+
+	constexpr std::array NamedSteps
+	{
+		NamedStep {"JoinIdenticalVertices", aiProcess_JoinIdenticalVertices},
+		NamedStep {"GenNormals", aiProcess_GenNormals},
+		NamedStep {"GenSmoothNormals", aiProcess_GenSmoothNormals},
+		NamedStep {"LimitBoneWeights", aiProcess_LimitBoneWeights},
+		NamedStep {"ImproveCacheLocality", aiProcess_ImproveCacheLocality},
+		NamedStep {"SortByPType", aiProcess_SortByPType},
+		NamedStep {"FindInstances", aiProcess_FindInstances},
+		NamedStep {"OptimizeGraph", aiProcess_OptimizeGraph},
+		NamedStep {"OptimizeMeshes", aiProcess_OptimizeMeshes},
+		NamedStep {"RemoveRedundantMaterials", aiProcess_RemoveRedundantMaterials},
+		NamedStep {"FindDegenerates", aiProcess_FindDegenerates},
+		NamedStep {"FindInvalidData", aiProcess_FindInvalidData},
+		NamedStep {"FixInfacingNormals", aiProcess_FixInfacingNormals},
+		NamedStep {"ValidateDataStructure", aiProcess_ValidateDataStructure}
+	};
+
+	unsigned int FindStep(const std::string_view InName)
+	{
+		for (const auto& [Name, Step] : NamedSteps)
+		{
+			if (Name == InName)
+			{
+				return Step;
+			}
+		}
+
+		return 0u;
+	}
+
+	void HashBytes(uint64_t& InOutHash, const void* InData, const size_t InSize) noexcept
+	{
+		for (size_t Index = 0u; Index < InSize; ++Index)
+		{
+			InOutHash ^= static_cast<uint64_t>(static_cast<const unsigned char*>(InData)[Index]);
+			InOutHash *= 1099511628211ull;
+		}
+	}
+}
+
+ImportProfile::ImportProfile() noexcept
+	: Steps(DefaultSteps)
+{
+}
+
+ImportProfile ImportProfile::Load(const std::filesystem::path& InModelPath)
+{
+	ImportProfile Profile;
+
+	auto SidecarPath = InModelPath;
+	SidecarPath += ".import";
+
+	if (std::vector<std::byte> Bytes; AssetArchive::Get().Read(SidecarPath, Bytes))
+	{
+		Profile.Parse({reinterpret_cast<const char*>(Bytes.data()), Bytes.size()}, SidecarPath);
+	}
+
+	return Profile;
+}
+
+void ImportProfile::Configure(Assimp::Importer& InImporter) const
+{
+	InImporter.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+	InImporter.SetPropertyInteger(AI_CONFIG_PP_ICL_PTCACHE_SIZE, VertexCacheSize);
+	InImporter.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, SmoothingAngle);
+	InImporter.SetPropertyInteger(AI_CONFIG_PP_LBW_MAX_WEIGHTS, MaxBoneWeights);
+}
+
+uint64_t ImportProfile::GetHash() const noexcept
+{
+	// FNV-1a over the fields one by one, so padding never takes part.
+	uint64_t Hash {14695981039346656037ull};
+	HashBytes(Hash, &Steps, sizeof(Steps));
+	HashBytes(Hash, &VertexCacheSize, sizeof(VertexCacheSize));
+	HashBytes(Hash, &SmoothingAngle, sizeof(SmoothingAngle));
+	HashBytes(Hash, &MaxBoneWeights, sizeof(MaxBoneWeights));
+
+	// Only a bake takes part, so profiles without one keep the hash their caches were written with.
+	if (OcclusionRayNum > 0)
+	{
+		HashBytes(Hash, &OcclusionRayNum, sizeof(OcclusionRayNum));
+		HashBytes(Hash, &OcclusionDistance, sizeof(OcclusionDistance));
+	}
+
+	if (LightmapSettings.TexelsPerUnit > 0.0f)
+	{
+		HashBytes(Hash, &LightmapSettings.TexelsPerUnit, sizeof(LightmapSettings.TexelsPerUnit));
+		HashBytes(Hash, &LightmapSettings.IndirectRayNum, sizeof(LightmapSettings.IndirectRayNum));
+
+		for (const auto& [Position, Color, Range] : LightmapSettings.Lights)
+		{
+			HashBytes(Hash, &Position, sizeof(Position));
+			HashBytes(Hash, &Color, sizeof(Color));
+			HashBytes(Hash, &Range, sizeof(Range));
+		}
+	}
+
+	return Hash;
+}
+
+void ImportProfile::Parse(const std::string& InText, const std::filesystem::path& InFileName)
+{
+	std::istringstream Stream(InText);
+	std::string Line;
+
+	while (std::getline(Stream, Line))
+	{
+		std::istringstream LineStream(Line);
+		std::string Keyword;
+
+		// Blank lines and comments.
+		if (!(LineStream >> Keyword) || Keyword.front() == '#')
+		{
+			continue;
+		}
+
+		if (Keyword == "enable" || Keyword == "disable")
+		{
+			std::string Name;
+			LineStream >> Name;
+
+			const auto Step = FindStep(Name);
+			if (Step == 0u)
+			{
+				throw std::runtime_error("Unknown post-processing step " + Name + " in import profile " + InFileName.string());
+			}
+
+			if (Keyword == "enable")
+			{
+				// The two normal generators exclude each other, the last one enabled wins.
+				constexpr unsigned int NormalSteps {aiProcess_GenNormals | aiProcess_GenSmoothNormals};
+				Steps = (Step & NormalSteps ? Steps & ~NormalSteps : Steps) | Step;
+			}
+			else
+			{
+				Steps &= ~Step;
+			}
+		}
+		else if (Keyword == "vertexcache")
+		{
+			LineStream >> VertexCacheSize;
+		}
+		else if (Keyword == "smoothingangle")
+		{
+			LineStream >> SmoothingAngle;
+		}
+		else if (Keyword == "boneweights")
+		{
+			LineStream >> MaxBoneWeights;
+		}
+		else if (Keyword == "occlusion")
+		{
+			LineStream >> OcclusionRayNum;
+
+			// The distance is optional, a line may still end in whitespace such as a carriage return.
+			if (!LineStream.eof() && !(LineStream >> std::ws).eof())
+			{
+				LineStream >> OcclusionDistance;
+			}
+		}
+		else if (Keyword == "lightmap")
+		{
+			LineStream >> LightmapSettings.TexelsPerUnit;
+
+			if (!LineStream.eof() && !(LineStream >> std::ws).eof())
+			{
+				LineStream >> LightmapSettings.IndirectRayNum;
+			}
+
+			if (LightmapSettings.TexelsPerUnit <= 0.0f || LightmapSettings.IndirectRayNum < 0 || LightmapSettings.IndirectRayNum > 4096)
+			{
+				LineStream.setstate(std::ios::failbit);
+			}
+		}
+		else if (Keyword == "light")
+		{
+			auto& [Position, Color, Range] = LightmapSettings.Lights.emplace_back();
+			LineStream >> Position.x >> Position.y >> Position.z >> Color.x >> Color.y >> Color.z >> Range;
+
+			if (Range <= 0.0f || Color.x < 0.0f || Color.y < 0.0f || Color.z < 0.0f)
+			{
+				LineStream.setstate(std::ios::failbit);
+			}
+		}
+		else
+		{
+			throw std::runtime_error("Unknown keyword " + Keyword + " in import profile " + InFileName.string());
+		}
+
+		if (LineStream.fail() || VertexCacheSize <= 0 || SmoothingAngle < 0.0f || SmoothingAngle > 175.0f || MaxBoneWeights < 1 || MaxBoneWeights > 4 ||
+		    OcclusionRayNum < 0 || OcclusionRayNum > 1024 || OcclusionDistance <= 0.0f)
+		{
+			throw std::runtime_error("Malformed line \"" + Line + "\" in import profile " + InFileName.string());
+		}
+	}
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include "Lightmapper.h"
+
+namespace Assimp
+{
+	class Importer;
+}
+
+/**
+ * Which of Assimp's post-processing steps a model's import runs and how they are configured, so an import does only the work its
+ * materials need. Tangents are never asked for up front, ImportScene generates them after the read when a material has a normal map.
+ * The defaults suit every model, "<model>.import" beside one overrides them a line at a time:
+ *
+ *   # comment
+ *   enable OptimizeGraph
+ *   disable JoinIdenticalVertices
+ *   vertexcache 24
+ *   smoothingangle 60
+ *   boneweights 4
+ *   occlusion 64 0.1
+ *   lightmap 8 64
+ *   light 0 12 0  4 3.6 3  40
+ *
+ * occlusion bakes ambient occlusion into the vertices of meshes without bones, from that many rays per vertex reaching that fraction
+ * of the mesh's bounding box diagonal. Off by default, zero rays turn it off again.
+ * lightmap bakes the light of the light lines into lightmaps of the meshes without bones, at that many texels per unit and with that
+ * many rays per texel for the bounced light, zero for direct light only. Each light line is a point light in the model's space, its
+ * position, its colour times its strength and its range. The lightmaps replace the vertex occlusion bake, see Lightmapper.
+ * Steps the vertex extraction depends on, triangulation and the left-handed conversion, can't be disabled.
+ * The profile is hashed into the mesh cache, editing the sidecar imports the model again.
+ */
+class ImportProfile
+{
+public:
+	// Defaults for a model without a sidecar, throws when the sidecar is malformed.
+	[[nodiscard]] static ImportProfile Load(const std::filesystem::path& InModelPath);
+
+	// Sets the properties the steps read, before the importer reads the file.
+	void Configure(Assimp::Importer& InImporter) const;
+
+	// aiPostProcessSteps, without aiProcess_CalcTangentSpace.
+	[[nodiscard]] unsigned int GetSteps() const noexcept
+	{
+		return Steps;
+	}
+
+	// Zero when nothing is baked.
+	[[nodiscard]] int GetOcclusionRayNum() const noexcept
+	{
+		return OcclusionRayNum;
+	}
+
+	// Of the mesh's bounding box diagonal.
+	[[nodiscard]] float GetOcclusionDistance() const noexcept
+	{
+		return OcclusionDistance;
+	}
+
+	// Nothing is baked while its TexelsPerUnit is zero.
+	[[nodiscard]] const Lightmapper::Settings& GetLightmapSettings() const noexcept
+	{
+		return LightmapSettings;
+	}
+
+	[[nodiscard]] uint64_t GetHash() const noexcept;
+
+private:
+	ImportProfile() noexcept;
+
+	void Parse(const std::string& InText, const std::filesystem::path& InFileName);
+
+private:
+	unsigned int Steps;
+	// Entries of the cache ImproveCacheLocality optimizes for.
+	int VertexCacheSize {12};
+	// GenSmoothNormals only, in degrees.
+	float SmoothingAngle {175.0f};
+	// The skinned layouts carry four influences, fewer are allowed.
+	int MaxBoneWeights {4};
+	int OcclusionRayNum {0};
+	float OcclusionDistance {0.1f};
+	Lightmapper::Settings LightmapSettings;
+};
@@ -0,0 +1,118 @@
+﻿#include "Impostor.h"
+#include <array>
+#include "Bindables.h"
+#include "DeferredShading.h"
+#include "ExceptionMacros.h"
+
+ImpostorAtlas::ImpostorAtlas(const Graphics& InGraphics)
+{
+	HRESULT ResultHandle;
+	auto* const Device = GetDevice(InGraphics);
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(AtlasConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(Device->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	// The G-buffer's layout, so the material shaders' G-buffer builds draw the cells unchanged.
+	D3D11_TEXTURE2D_DESC AtlasDesc {};
+	AtlasDesc.Width = AtlasSize;
+	AtlasDesc.Height = AtlasSize;
+	AtlasDesc.MipLevels = 1u;
+	AtlasDesc.ArraySize = 1u;
+	AtlasDesc.SampleDesc.Count = 1u;
+	AtlasDesc.Usage = D3D11_USAGE_DEFAULT;
+	AtlasDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Albedo;
+	AtlasDesc.Format = DeferredShading::AlbedoFormat;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&AtlasDesc, nullptr, &Albedo))
+	CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView(Albedo.Get(), nullptr, &AlbedoTarget))
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(Albedo.Get(), nullptr, &AlbedoView))
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Normal;
+	AtlasDesc.Format = DeferredShading::NormalFormat;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&AtlasDesc, nullptr, &Normal))
+	CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView(Normal.Get(), nullptr, &NormalTarget))
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(Normal.Get(), nullptr, &NormalView))
+
+	// Orthographic, so the stored depth is linear across the sphere.
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Depth;
+	AtlasDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	AtlasDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&AtlasDesc, nullptr, &Depth))
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC DepthTargetDesc {};
+	DepthTargetDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	DepthTargetDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	CHECK_HRESULT_EXCEPTION(Device->CreateDepthStencilView(Depth.Get(), &DepthTargetDesc, &DepthTarget))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC DepthViewDesc {};
+	DepthViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	DepthViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	DepthViewDesc.Texture2D.MipLevels = 1u;
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(Depth.Get(), &DepthViewDesc, &DepthView))
+
+	const auto QuadLayout = DV::VertexLayout {}.Append(DV::VertexLayout::ElementType::Position2D);
+	constexpr std::array<DirectX::XMFLOAT2, 4u> Corners {{{-1.0f, 1.0f}, {1.0f, 1.0f}, {-1.0f, -1.0f}, {1.0f, -1.0f}}};
+	constexpr std::array<unsigned int, 6u> Indices {0u, 1u, 2u, 2u, 1u, 3u};
+	const StringAtom ImpostorTag {"$impostor"};
+
+	QuadVertices = std::make_shared<VertexBuffer>(InGraphics, ImpostorTag, QuadLayout, Corners.data(), sizeof(Corners));
+	QuadIndices = std::make_shared<IndexBuffer>(InGraphics, ImpostorTag, Indices.data(), Indices.size());
+}
+
+void ImpostorAtlas::Bind(RenderContext& InContext) noexcept
+{
+	auto& Cache = GetStateCache(InContext);
+
+	Cache.SetVertexConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelShaderResource(AlbedoSlot, AlbedoView.Get());
+	Cache.SetPixelShaderResource(NormalSlot, NormalView.Get());
+	Cache.SetPixelShaderResource(DepthSlot, DepthView.Get());
+}
+
+size_t ImpostorAtlas::GetGpuByteSize() const noexcept
+{
+	// Four bytes a texel in each of the three.
+	return 3u * 4u * static_cast<size_t>(AtlasSize) * AtlasSize + sizeof(AtlasConstants);
+}
+
+Impostor::Impostor(const Graphics& InGraphics, std::shared_ptr<ImpostorAtlas> InAtlas)
+	: Atlas(std::move(InAtlas))
+{
+	DirectX::XMStoreFloat4x4(&Transform, DirectX::XMMatrixIdentity());
+
+	Bind(Atlas->GetQuadVertices());
+	Bind(Atlas->GetQuadIndices());
+
+	auto ImpostorVertexShader = VertexShader::Resolve(InGraphics, "ImpostorVS.cso");
+	auto ImpostorVertexShaderBlob = ImpostorVertexShader->GetByteCode();
+	Bind(std::move(ImpostorVertexShader));
+
+	Bind(PixelShader::Resolve(InGraphics, "ImpostorPS.cso"));
+
+	Bind(InputLayout::Resolve(InGraphics, DV::VertexLayout {}.Append(DV::VertexLayout::ElementType::Position2D), ImpostorVertexShaderBlob));
+
+	Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
+
+	Bind(Atlas);
+
+	Bind(std::make_shared<TransformConstantBuffer>(InGraphics, *this, TransformConstantBuffer::Target::Vertex));
+
+	BindInstanced(InGraphics, VertexShader::Resolve(InGraphics, "ImpostorInstancedVS.cso"));
+}
+
+void Impostor::SetTransform(DirectX::FXMMATRIX InTransform, const float InFade) noexcept
+{
+	DirectX::XMStoreFloat4x4(&Transform, InTransform);
+	Transform._14 = InFade;
+}
+
+DirectX::XMMATRIX Impostor::GetTransformMatrix() const noexcept
+{
+	return DirectX::XMLoadFloat4x4(&Transform);
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <memory>
+#include "wrl/client.h"
+#include "Bindable.h"
+#include "Drawable.h"
+
+/**
+ * A model baked into an octahedral grid of orthographic views, albedo, normal and depth per cell, so from far away two
+ * triangles stand in for all of its meshes. ImpostorBaker draws the cells, every instance of the model then shares them.
+ * Binds the cells and their constants to the impostor shaders, see Impostor.hlsli.
+ */
+class ImpostorAtlas : public Bindable
+{
+	friend class ImpostorBaker;
+
+public:
+	// Cells across and down, their directions the centres of an octahedral map of the sphere.
+	static constexpr UINT GridSize {16u};
+	// Instances switch to the impostor once they are drawn this small, so the cells are never magnified.
+	static constexpr UINT CellSize {64u};
+	static constexpr UINT AtlasSize {GridSize * CellSize};
+
+	explicit ImpostorAtlas(const Graphics& InGraphics);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+	// False until ImpostorBaker drew the cells, nothing should draw it before.
+	[[nodiscard]] bool IsBaked() const noexcept
+	{
+		return bIsBaked;
+	}
+
+	// The quad every instance draws, its own so instances of different models never group into one draw.
+	[[nodiscard]] const std::shared_ptr<Bindable>& GetQuadVertices() const noexcept
+	{
+		return QuadVertices;
+	}
+
+	[[nodiscard]] const std::shared_ptr<Bindable>& GetQuadIndices() const noexcept
+	{
+		return QuadIndices;
+	}
+
+private:
+	// Registers in Impostor.hlsli and ImpostorPS.hlsl.
+	static constexpr UINT ConstantSlot {1u};
+	static constexpr UINT AlbedoSlot {0u};
+	static constexpr UINT NormalSlot {1u};
+	static constexpr UINT DepthSlot {2u};
+
+	struct AtlasConstants
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		DirectX::XMMATRIX BakedToModel;
+		UINT GridSize;
+		float AtlasSize;
+		float Padding[2];
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> AlbedoTarget;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> NormalTarget;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthTarget;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AlbedoView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> NormalView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DepthView;
+	std::shared_ptr<Bindable> QuadVertices;
+	std::shared_ptr<Bindable> QuadIndices;
+	bool bIsBaked {false};
+};
+
+/**
+ * One instance of a model drawn as its impostor, a quad facing the atlas cell closest to the camera's direction.
+ * Instances of the same model group into one instanced draw like any other drawable.
+ */
+class Impostor : public Drawable
+{
+public:
+	Impostor(const Graphics& InGraphics, std::shared_ptr<ImpostorAtlas> InAtlas);
+
+	// InFade runs from zero, all mesh, to one, all impostor. The impostor dithers in ahead of the mesh while it is below one.
+	void SetTransform(DirectX::FXMMATRIX InTransform, float InFade) noexcept;
+	// The first row carries the fade in its w, see Impostor.hlsli.
+	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept override;
+
+	[[nodiscard]] const std::shared_ptr<ImpostorAtlas>& GetAtlas() const noexcept
+	{
+		return Atlas;
+	}
+
+private:
+	std::shared_ptr<ImpostorAtlas> Atlas;
+	DirectX::XMFLOAT4X4 Transform {};
+};
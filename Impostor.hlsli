@@ -0,0 +1,73 @@
+// Octahedral impostors, shared by ImpostorVS.hlsl, ImpostorInstancedVS.hlsl and ImpostorPS.hlsl.
+// The atlas is a grid of cells, each an orthographic view of the model's bounding sphere from one direction. The directions are
+// the cell centres of an octahedral map of the whole sphere, in the model's space, as GBuffer.hlsli encodes normals.
+#include "FrameConstants.hlsli"
+#include "GBuffer.hlsli"
+
+// Laid out like ImpostorAtlas::AtlasConstants.
+cbuffer ImpostorAtlas : register(b1)
+{
+    // The bounding sphere the cells were drawn around, in the model's space.
+    float3 ImpostorCenter;
+    float ImpostorRadius;
+    // Takes the world normals the G-buffer build wrote back into the model's space, the bake's model transform undone.
+    matrix BakedToModel;
+    uint ImpostorGridSize;
+    float ImpostorAtlasSize;
+    float2 ImpostorPadding;
+}
+
+struct ImpostorVertex
+{
+    // On the plane through the sphere's centre facing the cell's direction.
+    float3 WorldPosition : Position;
+    float2 AtlasCoordinate : TexCoord;
+    // From the cell's plane to the sphere's near side, stored depth zero is there and one the far side.
+    nointerpolation float3 WorldDepthAxis : DepthAxis;
+    nointerpolation float3 ModelRight : ModelRight;
+    nointerpolation float3 ModelUp : ModelUp;
+    nointerpolation float3 ModelForward : ModelForward;
+    // Of the mesh to the impostor, dithered in over the transition.
+    nointerpolation float Fade : Fade;
+    float4 Position : SV_Position;
+};
+
+// Right and up of the cell looking along -InDirection, matching XMMatrixLookToLH with y up unless the view is along it.
+void GetImpostorCellFrame(const float3 InDirection, out float3 OutRight, out float3 OutUp)
+{
+    const float3 ReferenceUp = abs(InDirection.y) > 0.999f ? float3(0.0f, 0.0f, 1.0f) : float3(0.0f, 1.0f, 0.0f);
+    OutRight = normalize(cross(ReferenceUp, -InDirection));
+    OutUp = cross(-InDirection, OutRight);
+}
+
+// InCorner is one of the quad's corners in [-1, 1]. The fade rides in the model matrix's first row, whose w no affine transform uses.
+ImpostorVertex MakeImpostorVertex(const float2 InCorner, matrix InModel)
+{
+    const float Fade = InModel._14;
+    InModel._14 = 0.0f;
+
+    const float3 WorldCenter = mul(float4(ImpostorCenter, 1.0f), InModel).xyz;
+    // Rows scaled alike, the direction to the camera goes back through their transpose and only needs normalizing.
+    const float3 ModelToCamera = normalize(mul((float3x3) InModel, CameraPosition - WorldCenter));
+
+    // The cell whose direction is closest, every vertex of the quad picks the same one.
+    const uint2 Cell = min((uint2) (EncodeNormal(ModelToCamera) * ImpostorGridSize), ImpostorGridSize - 1u);
+    const float3 CellDirection = DecodeNormal((Cell + 0.5f) / ImpostorGridSize);
+
+    float3 CellRight;
+    float3 CellUp;
+    GetImpostorCellFrame(CellDirection, CellRight, CellUp);
+
+    const float3 ModelPosition = ImpostorCenter + (CellRight * InCorner.x + CellUp * InCorner.y) * ImpostorRadius;
+
+    ImpostorVertex Vertex;
+    Vertex.WorldPosition = mul(float4(ModelPosition, 1.0f), InModel).xyz;
+    Vertex.AtlasCoordinate = (Cell + float2(InCorner.x, -InCorner.y) * 0.5f + 0.5f) / ImpostorGridSize;
+    Vertex.WorldDepthAxis = mul(CellDirection * ImpostorRadius, (float3x3) InModel);
+    Vertex.ModelRight = InModel._11_12_13;
+    Vertex.ModelUp = InModel._21_22_23;
+    Vertex.ModelForward = InModel._31_32_33;
+    Vertex.Fade = Fade;
+    Vertex.Position = mul(float4(Vertex.WorldPosition, 1.0f), ViewProjection);
+    return Vertex;
+}
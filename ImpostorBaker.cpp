@@ -0,0 +1,143 @@
+﻿#include "ImpostorBaker.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "Impostor.h"
+
+namespace
+{
+	// The cell's direction, DecodeNormal of GBuffer.hlsli at the cell's centre.
+	DirectX::XMVECTOR GetCellDirection(const UINT InX, const UINT InY) noexcept
+	{
+		const auto FoldedX = (static_cast<float>(InX) + 0.5f) / ImpostorAtlas::GridSize * 2.0f - 1.0f;
+		const auto FoldedY = (static_cast<float>(InY) + 0.5f) / ImpostorAtlas::GridSize * 2.0f - 1.0f;
+		DirectX::XMFLOAT3 Direction {FoldedX, FoldedY, 1.0f - std::abs(FoldedX) - std::abs(FoldedY)};
+
+		const auto Unfold = std::clamp(-Direction.z, 0.0f, 1.0f);
+		Direction.x += Direction.x >= 0.0f ? -Unfold : Unfold;
+		Direction.y += Direction.y >= 0.0f ? -Unfold : Unfold;
+		return DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&Direction));
+	}
+
+	// GetImpostorCellFrame's reference up, the view's up follows from it as XMMatrixLookToLH builds it.
+	DirectX::XMVECTOR GetCellReferenceUp(DirectX::FXMVECTOR InDirection) noexcept
+	{
+		return std::abs(DirectX::XMVectorGetY(InDirection)) > 0.999f ? DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	}
+}
+
+void ImpostorBaker::BeginFrame() noexcept
+{
+	Pending.reset();
+	Drawables.clear();
+}
+
+bool ImpostorBaker::RequestBake(std::shared_ptr<ImpostorAtlas> InAtlas, DirectX::FXMMATRIX InModelTransform, const DirectX::BoundingBox& InWorldBounds)
+{
+	if (Pending || !bIsEnabled || InAtlas->IsBaked())
+	{
+		return false;
+	}
+
+	Pending = std::move(InAtlas);
+	DirectX::XMStoreFloat4x4(&ModelTransform, InModelTransform);
+
+	// Back into the model's space, where the cells are laid out.
+	DirectX::BoundingBox ModelBox;
+	InWorldBounds.Transform(ModelBox, DirectX::XMMatrixInverse(nullptr, InModelTransform));
+	DirectX::BoundingSphere::CreateFromBoundingBox(ModelBounds, ModelBox);
+
+	return true;
+}
+
+void ImpostorBaker::AddDrawable(const Drawable& InDrawable)
+{
+	assert(Pending && "Drawables are only handed over for a requested bake");
+
+	if (InDrawable.IsGBufferSupported())
+	{
+		InDrawable.Prepare();
+		Drawables.push_back(&InDrawable);
+	}
+}
+
+void ImpostorBaker::Render(const Graphics& InGraphics)
+{
+	if (!Pending)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Impostor bake");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	// Cleared normals have zero alpha, SpecularModeEmpty, which is where the impostor is discarded.
+	constexpr float ClearColor[] = {0.0f, 0.0f, 0.0f, 0.0f};
+	ID3D11RenderTargetView* const Targets[] = {Pending->AlbedoTarget.Get(), Pending->NormalTarget.Get()};
+	Cache.SetRenderTargets(Targets, Pending->DepthTarget.Get());
+	DeviceContext->ClearRenderTargetView(Targets[0], ClearColor);
+	DeviceContext->ClearRenderTargetView(Targets[1], ClearColor);
+	DeviceContext->ClearDepthStencilView(Pending->DepthTarget.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+	InGraphics.BindDepthTest(Context, DepthTest::Less);
+
+	// Every cell looks at the sphere from outside it along the cell's direction, the depth range spans the sphere exactly.
+	const auto Transform = DirectX::XMLoadFloat4x4(&ModelTransform);
+	const auto Scale = DirectX::XMVectorGetX(DirectX::XMVector3Length(Transform.r[0]));
+	const auto WorldRadius = ModelBounds.Radius * Scale;
+	const auto Projection = DirectX::XMMatrixOrthographicLH(2.0f * WorldRadius, 2.0f * WorldRadius, 0.0f, 2.0f * WorldRadius);
+	const auto Center = DirectX::XMLoadFloat3(&ModelBounds.Center);
+
+	for (UINT CellY = 0u; CellY < ImpostorAtlas::GridSize; ++CellY)
+	{
+		for (UINT CellX = 0u; CellX < ImpostorAtlas::GridSize; ++CellX)
+		{
+			const auto Direction = GetCellDirection(CellX, CellY);
+			const auto Eye = DirectX::XMVector3TransformCoord(DirectX::XMVectorMultiplyAdd(Direction, DirectX::XMVectorReplicate(ModelBounds.Radius), Center), Transform);
+			const auto Forward = DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMVectorNegate(Direction), Transform));
+			const auto Up = DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(GetCellReferenceUp(Direction), Transform));
+
+			DirectX::XMFLOAT3 EyePosition;
+			DirectX::XMStoreFloat3(&EyePosition, Eye);
+
+			const D3D11_VIEWPORT CellViewport {static_cast<float>(CellX * ImpostorAtlas::CellSize), static_cast<float>(CellY * ImpostorAtlas::CellSize),
+			                                   static_cast<float>(ImpostorAtlas::CellSize), static_cast<float>(ImpostorAtlas::CellSize), 0.0f, 1.0f};
+			DeviceContext->RSSetViewports(1u, &CellViewport);
+			InGraphics.OverrideViewConstants(Context, DirectX::XMMatrixLookToLH(Eye, Forward, Up), Projection, EyePosition);
+
+			for (const auto* const Baked : Drawables)
+			{
+				Baked->Draw(Context, DrawStage::GBuffer);
+			}
+		}
+	}
+
+	InGraphics.RestoreViewConstants(Context);
+	InGraphics.BindFrameState(Context);
+
+	ImpostorAtlas::AtlasConstants Constants {};
+	Constants.Center = ModelBounds.Center;
+	Constants.Radius = ModelBounds.Radius;
+	// Transposed like every other matrix handed to the shaders.
+	Constants.BakedToModel = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, Transform));
+	Constants.GridSize = ImpostorAtlas::GridSize;
+	Constants.AtlasSize = static_cast<float>(ImpostorAtlas::AtlasSize);
+
+	HRESULT ResultHandle;
+
+	D3D11_MAPPED_SUBRESOURCE Mapped;
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(Pending->ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &Mapped))
+	std::memcpy(Mapped.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(Pending->ConstantBuffer.Get(), 0u);
+	Cache.CountUpload(sizeof(Constants));
+
+	Pending->bIsBaked = true;
+	++BakedNum;
+}
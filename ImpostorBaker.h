@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+class Drawable;
+class Graphics;
+class ImpostorAtlas;
+
+/**
+ * Draws models into their impostor atlases, one model per frame at most and each model once. The meshes are drawn through
+ * their G-buffer packets into every cell, so the impostor stores the same surface deferred shading would light.
+ * The model is baked in the pose and under the transform of the instance that asked first, the atlas stores the cells
+ * relative to that transform so any other instance can draw them under its own.
+ */
+class ImpostorBaker
+{
+public:
+	ImpostorBaker() = default;
+	ImpostorBaker(const ImpostorBaker&) = delete;
+	ImpostorBaker(ImpostorBaker&&) = delete;
+	ImpostorBaker& operator=(const ImpostorBaker&) = delete;
+	ImpostorBaker& operator=(ImpostorBaker&&) = delete;
+	~ImpostorBaker() = default;
+
+	void BeginFrame() noexcept;
+
+	// Takes the atlas for this frame's bake unless another one already is, the model's drawables then follow with AddDrawable.
+	// InWorldBounds hold all of the model under InModelTransform.
+	[[nodiscard]] bool RequestBake(std::shared_ptr<ImpostorAtlas> InAtlas, DirectX::FXMMATRIX InModelTransform, const DirectX::BoundingBox& InWorldBounds);
+	// Drawn into every cell, at the world transform it holds when the bake renders. Drawables without a G-buffer build are left out.
+	void AddDrawable(const Drawable& InDrawable);
+
+	// Bakes the requested atlas before anything draws it, the impostor of the model that asked shows in the same frame.
+	void Render(const Graphics& InGraphics);
+
+	// Off keeps every instance on its meshes, atlases already baked stay.
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+	// Atlases baked since startup.
+	[[nodiscard]] unsigned int GetBakedNum() const noexcept
+	{
+		return BakedNum;
+	}
+
+private:
+	std::shared_ptr<ImpostorAtlas> Pending;
+	DirectX::XMFLOAT4X4 ModelTransform {};
+	DirectX::BoundingSphere ModelBounds;
+	std::vector<const Drawable*> Drawables;
+	unsigned int BakedNum {0u};
+	bool bIsEnabled {true};
+};
@@ -0,0 +1,7 @@
+#include "Impostor.hlsli"
+#include "Instancing.hlsli"
+
+ImpostorVertex main(const float2 InCorner : Position, const uint InInstanceID : SV_InstanceID)
+{
+    return MakeImpostorVertex(InCorner, InstanceTransforms[InInstanceID].Model);
+}
@@ -0,0 +1,89 @@
+// Lights the surface an impostor cell stored, with the same cluster light lists and shading as DeferredLightingCS.hlsl.
+// The stored depth puts the surface back where the model would be, so it depth tests, shadows and occludes like one.
+#include "Impostor.hlsli"
+#include "PointLight.hlsli"
+#include "ShaderOperations.hlsli"
+#include "DirectionalLight.hlsli"
+
+Texture2D<float4> ImpostorAlbedoSpecular : register(t0);
+Texture2D<float4> ImpostorNormalPower : register(t1);
+Texture2D<float> ImpostorDepth : register(t2);
+
+// Fraction of the radius the impostor is drawn ahead of the mesh while they fade, so where both cover a pixel the impostor wins.
+static const float ImpostorFadeBias = 0.05f;
+
+// Ordered thresholds over 4x4 pixels, the fade shows that share of them.
+static const float DitherThresholds[16] =
+{
+    0.5f / 16.0f, 8.5f / 16.0f, 2.5f / 16.0f, 10.5f / 16.0f,
+    12.5f / 16.0f, 4.5f / 16.0f, 14.5f / 16.0f, 6.5f / 16.0f,
+    3.5f / 16.0f, 11.5f / 16.0f, 1.5f / 16.0f, 9.5f / 16.0f,
+    15.5f / 16.0f, 7.5f / 16.0f, 13.5f / 16.0f, 5.5f / 16.0f
+};
+
+struct ImpostorOutput
+{
+    float4 Color : SV_Target;
+    float Depth : SV_Depth;
+};
+
+ImpostorOutput main(const ImpostorVertex InVertex)
+{
+    const uint2 PixelIndex = (uint2) InVertex.Position.xy;
+    clip(InVertex.Fade - DitherThresholds[(PixelIndex.y % 4u) * 4u + PixelIndex.x % 4u]);
+
+    // The nearest texel, filtering would blend surfaces at different depths along the silhouette.
+    const int3 Texel = int3(min(InVertex.AtlasCoordinate * ImpostorAtlasSize, ImpostorAtlasSize - 1.0f), 0);
+    GBufferSurface Surface = DecodeGBuffer(ImpostorAlbedoSpecular.Load(Texel), ImpostorNormalPower.Load(Texel));
+
+    if (Surface.SpecularMode == SpecularModeEmpty)
+    {
+        discard;
+    }
+
+    // Into the model's space, then out through this instance's transform.
+    const float3 ModelNormal = mul(Surface.WorldNormal, (float3x3) BakedToModel);
+    Surface.WorldNormal = normalize(ModelNormal.x * InVertex.ModelRight + ModelNormal.y * InVertex.ModelUp + ModelNormal.z * InVertex.ModelForward);
+
+    const float DepthOffset = 1.0f - 2.0f * ImpostorDepth.Load(Texel) + (InVertex.Fade < 1.0f ? ImpostorFadeBias : 0.0f);
+    const float3 WorldPosition = InVertex.WorldPosition + InVertex.WorldDepthAxis * DepthOffset;
+    const float2 PixelPosition = InVertex.Position.xy;
+    const float3 VectorToCamera = CameraPosition - WorldPosition;
+
+    float3 Diffuse = float3(0.0f, 0.0f, 0.0f);
+    float3 Specular = float3(0.0f, 0.0f, 0.0f);
+
+    const ClusterLights Cluster = GetClusterLights(PixelPosition, WorldPosition);
+
+    for (uint Index = 0u; Index < Cluster.Num; ++Index)
+    {
+        const PointLightData Light = GetClusterLight(Cluster, Index);
+
+        const float3 VectorToLight = Light.WorldPosition - WorldPosition;
+        const float DistanceToLight = length(VectorToLight);
+
+        if (DistanceToLight >= Light.Range)
+        {
+            continue;
+        }
+
+        const float3 DirectionToLight = VectorToLight / DistanceToLight;
+        const float Attenuation = GetShadowFactor(Light, VectorToLight) * CalcAttenuate(Light.QuadraticAttenuation, Light.LinearAttenuation, Light.ConstantAttenuation, DistanceToLight);
+        const float3 SpecularColor = Surface.SpecularMode == SpecularModeTinted ? float3(1.0f, 1.0f, 1.0f) : Light.DiffuseColor * Light.DiffuseStrength;
+
+        Diffuse += CalcDiffuse(Light.DiffuseColor, Light.DiffuseStrength, Attenuation, DirectionToLight, Surface.WorldNormal);
+        Specular += CalcSpeculate(SpecularColor, Surface.SpecularIntensity, Surface.WorldNormal, VectorToLight, VectorToCamera, Attenuation, Surface.SpecularPower);
+    }
+
+    AddSunLight(WorldPosition, Surface.WorldNormal, VectorToCamera, Surface.SpecularMode == SpecularModeTinted ? float3(1.0f, 1.0f, 1.0f) : SunColor,
+                Surface.SpecularIntensity, Surface.SpecularPower, Diffuse, Specular);
+
+    Specular += Surface.SpecularIntensity * CalcReflection(WorldPosition, Surface.WorldNormal, VectorToCamera, Surface.SpecularPower, PixelPosition);
+
+    const float4 ClipPosition = mul(float4(WorldPosition, 1.0f), ViewProjection);
+
+    ImpostorOutput Output;
+    Output.Color = float4((Diffuse + CalcAmbient(AmbientColor, WorldPosition, Surface.WorldNormal, PixelPosition)) * Surface.Albedo + Specular, 1.0f);
+    Output.Depth = ClipPosition.z / ClipPosition.w;
+    return Output;
+}
@@ -0,0 +1,11 @@
+#include "Impostor.hlsli"
+
+cbuffer Transform : register(b0)
+{
+    matrix Model;
+};
+
+ImpostorVertex main(const float2 InCorner : Position)
+{
+    return MakeImpostorVertex(InCorner, Model);
+}
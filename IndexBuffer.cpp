@@ -1,63 +1,111 @@
 ﻿#include "IndexBuffer.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include "BindManager.h"
-#include "ExceptionMacros.h"
+#include "DrawPacket.h"
 
 IndexBuffer::IndexBuffer(const Graphics& InGraphics, const std::vector<unsigned int>& InIndices)
-	: IndexBuffer(InGraphics, "?", InIndices)
+	: IndexBuffer(InGraphics, StringAtom("?"), InIndices)
 {
 }
 
-IndexBuffer::IndexBuffer(const Graphics& InGraphics, const std::string& InTag, const std::vector<unsigned>& InIndices)
+IndexBuffer::IndexBuffer(const Graphics& InGraphics, const StringAtom InTag, const std::vector<unsigned>& InIndices)
+	: IndexBuffer(InGraphics, InTag, InIndices.data(), InIndices.size())
+{
+}
+
+IndexBuffer::IndexBuffer(const Graphics& InGraphics, const StringAtom InTag, const unsigned int* InIndices, const size_t InCount)
 	: Tag(InTag)
-	, Count(static_cast<UINT>(InIndices.size()))
+	, Count(static_cast<UINT>(InCount))
+	, Pool(InGraphics.GetGeometryPool())
 {
-	HRESULT ResultHandle;
+	// Narrowed to 16 bits whenever the mesh allows it, halving index memory and fetch bandwidth. Draws don't care either way.
+	const auto bIsShort = InCount && *std::max_element(InIndices, InIndices + InCount) <= std::numeric_limits<uint16_t>::max();
+	std::vector<uint16_t> ShortIndices;
 
-	D3D11_BUFFER_DESC IndexBufferDesc {};
-	IndexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	IndexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	IndexBufferDesc.CPUAccessFlags = 0u;
-	IndexBufferDesc.MiscFlags = 0u;
-	IndexBufferDesc.ByteWidth = static_cast<UINT>(Count * sizeof(unsigned int));
-	IndexBufferDesc.StructureByteStride = sizeof(unsigned int);
+	if (bIsShort)
+	{
+		ShortIndices.assign(InIndices, InIndices + InCount);
+	}
 
-	D3D11_SUBRESOURCE_DATA SubresourceData {};
-	SubresourceData.pSysMem = InIndices.data();
+	Format = bIsShort ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	MyAllocation = Pool.AllocateIndices(Format, bIsShort ? static_cast<const void*>(ShortIndices.data()) : InIndices, Count);
+}
 
-	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer
-	(
-		&IndexBufferDesc,
-		&SubresourceData,
-		&MyIndexBuffer)
-	)
+IndexBuffer::IndexBuffer(const Graphics& InGraphics, const StringAtom InTag, const DXGI_FORMAT InFormat)
+	: Tag(InTag)
+	, Count(0u)
+	, Format(InFormat)
+	, Pool(InGraphics.GetGeometryPool())
+{
 }
 
-void IndexBuffer::Bind(const Graphics& InGraphics) noexcept
+IndexBuffer::~IndexBuffer()
 {
-	GetContext(InGraphics)->IASetIndexBuffer
+	Pool.Free(MyAllocation);
+}
+
+void IndexBuffer::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetIndexBuffer
 	(
-		MyIndexBuffer.Get(),
-		DXGI_FORMAT_R32_UINT,
+		MyAllocation.Buffer,
+		Format,
 		0u
 	);
 }
 
+bool IndexBuffer::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.IndexBuffer = MyAllocation.Buffer;
+	InOutPacket.IndexFormat = Format;
+	return true;
+}
+
 UINT IndexBuffer::GetCount() const noexcept
 {
 	return Count;
 }
 
+UINT IndexBuffer::GetStartIndex() const noexcept
+{
+	return MyAllocation.Offset;
+}
+
+size_t IndexBuffer::GetGpuByteSize() const noexcept
+{
+	return static_cast<size_t>(MyAllocation.Num) * (Format == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int));
+}
+
+DXGI_FORMAT IndexBuffer::GetFormat() const noexcept
+{
+	return Format;
+}
+
+ID3D11ShaderResourceView* IndexBuffer::GetShaderResourceView() const noexcept
+{
+	return MyAllocation.View;
+}
+
 std::shared_ptr<IndexBuffer> IndexBuffer::Resolve(const Graphics& InGraphics, const std::string& InTag,
                                                   const std::vector<unsigned>& InIndices)
 {
 	assert(InTag != "?");
-	return BindManager::Resolve<IndexBuffer>(InGraphics, InTag, InIndices);
+	return BindManager::Resolve<IndexBuffer>(InGraphics, StringAtom(InTag), InIndices);
+}
+
+std::shared_ptr<IndexBuffer> IndexBuffer::Resolve(const Graphics& InGraphics, const std::string& InTag,
+                                                  const unsigned int* InIndices, const size_t InCount)
+{
+	assert(InTag != "?");
+	return BindManager::Resolve<IndexBuffer>(InGraphics, StringAtom(InTag), InIndices, InCount);
 }
 
-std::string IndexBuffer::GenerateUniqueIDImpl(const std::string& InTag)
+std::string IndexBuffer::GenerateUniqueIDImpl(const StringAtom InTag)
 {
 	using namespace std::string_literals;
-	return typeid(IndexBuffer).name() + "#"s + InTag;
+	return typeid(IndexBuffer).name() + "#"s + std::string(InTag.GetString());
 }
 
 std::string IndexBuffer::GetUniqueID() const noexcept
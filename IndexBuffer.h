@@ -1,31 +1,58 @@
 ﻿#pragma once
 #include <memory>
+#include "BindKey.h"
 #include "Bindable.h"
+#include "GeometryPool.h"
+#include "StringAtom.h"
 
 class IndexBuffer : public Bindable
 {
 public:
 	IndexBuffer(const Graphics& InGraphics, const std::vector<unsigned int>& InIndices);
-	IndexBuffer(const Graphics& InGraphics, const std::string& InTag, const std::vector<unsigned int>& InIndices);
+	IndexBuffer(const Graphics& InGraphics, StringAtom InTag, const std::vector<unsigned int>& InIndices);
+	IndexBuffer(const Graphics& InGraphics, StringAtom InTag, const unsigned int* InIndices, size_t InCount);
+	~IndexBuffer() override;
 
-	void Bind(const Graphics& InGraphics) noexcept override;
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
 	[[nodiscard]] UINT GetCount() const noexcept;
+	// Where the indices start in the shared page, passed to the draw as the start index.
+	[[nodiscard]] UINT GetStartIndex() const noexcept;
+	// R16_UINT whenever every index fits, R32_UINT otherwise.
+	[[nodiscard]] DXGI_FORMAT GetFormat() const noexcept;
+	// Raw view of the whole shared page, for compute passes reading the indices from GetStartIndex on.
+	[[nodiscard]] ID3D11ShaderResourceView* GetShaderResourceView() const noexcept;
 
 	[[nodiscard]] static std::shared_ptr<IndexBuffer> Resolve(const Graphics& InGraphics, const std::string& InTag, const std::vector<unsigned int>& InIndices);
+	[[nodiscard]] static std::shared_ptr<IndexBuffer> Resolve(const Graphics& InGraphics, const std::string& InTag, const unsigned int* InIndices, size_t InCount);
 
 	template<typename... IgnoredParams>
-	[[nodiscard]] static std::string GenerateUniqueID(const std::string& InTag, IgnoredParams&&... InIgnoredParams)
+	[[nodiscard]] static std::string GenerateUniqueID(StringAtom InTag, IgnoredParams&&... InIgnoredParams)
 	{
 		return GenerateUniqueIDImpl(InTag);
 	}
 
+	template<typename... IgnoredParams>
+	[[nodiscard]] static BindKey GenerateKey(StringAtom InTag, IgnoredParams&&... InIgnoredParams)
+	{
+		return BindKey::Make<IndexBuffer>(InTag);
+	}
+
 	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+	// The range this buffer holds in the shared page, the pages themselves are the geometry pool's.
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+protected:
+	// For buffers owning their storage such as DynamicIndexBuffer, which leave the allocation empty for the pool and fill it in themselves.
+	IndexBuffer(const Graphics& InGraphics, StringAtom InTag, DXGI_FORMAT InFormat);
 
 private:
-	[[nodiscard]] static std::string GenerateUniqueIDImpl(const std::string& InTag);
+	[[nodiscard]] static std::string GenerateUniqueIDImpl(StringAtom InTag);
 
 protected:
-	std::string Tag;
+	StringAtom Tag;
 	UINT Count;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> MyIndexBuffer;
+	DXGI_FORMAT Format;
+	GeometryPool& Pool;
+	GeometryPool::Allocation MyAllocation;
 };
@@ -1,6 +1,8 @@
 ﻿#pragma once
-#include <vector>
+#include <cstddef>
 #include <DirectXMath.h>
+#include <vector>
+#include "DynamicVertex.h"
 
 class IndexedTriangleList
 {
@@ -13,37 +15,97 @@ public:
 		assert(!(Indices.size() % 3));
 	}
 
+	// Positions as points, and normals when the layout has them through the inverse transpose, each element in one strided pass.
 	void Transform(const DirectX::FXMMATRIX& InMatrix)
 	{
-		using Element = DV::VertexLayout::ElementType;
+		const auto Stride = Vertices.GetLayout().Size();
+		auto* const Positions = GetStream<Element::Position3D>();
+		DirectX::XMVector3TransformCoordStream(Positions, Stride, Positions, Stride, Vertices.Num(), InMatrix);
+
+		if (Vertices.GetLayout().Has<Element::Normal>())
+		{
+			auto* const Normals = GetStream<Element::Normal>();
+			const auto NormalMatrix = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, InMatrix));
+			DirectX::XMVector3TransformNormalStream(Normals, Stride, Normals, Stride, Vertices.Num(), NormalMatrix);
+			NormalizeNormals();
+		}
+	}
+
+	void NormalizeNormals()
+	{
+		const auto Stride = Vertices.GetLayout().Size();
+		auto* Normal = reinterpret_cast<std::byte*>(GetStream<Element::Normal>());
 
-		for (int VertexIndex = 0; VertexIndex < Vertices.Num(); ++VertexIndex)
+		for (size_t VertexIndex = 0u; VertexIndex < Vertices.Num(); ++VertexIndex, Normal += Stride)
 		{
-			auto& Position = Vertices[VertexIndex].Attribute<Element::Position3D>();
-			DirectX::XMStoreFloat3(&Position, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&Position), InMatrix));
+			auto* const Value = reinterpret_cast<DirectX::XMFLOAT3*>(Normal);
+			DirectX::XMStoreFloat3(Value, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(Value)));
 		}
 	}
 
+	// Every triangle's own normal on its three corners, for vertices no two triangles share.
 	void SetNormalsIndependentFlat()
 	{
-		using Element = DV::VertexLayout::ElementType;
+		const auto Stride = Vertices.GetLayout().Size();
+		auto* const Positions = reinterpret_cast<std::byte*>(GetStream<Element::Position3D>());
+		auto* const Normals = reinterpret_cast<std::byte*>(GetStream<Element::Normal>());
+
+		for (size_t Index = 0u; Index < Indices.size(); Index += 3u)
+		{
+			const auto Normal = DirectX::XMVector3Normalize(GetFaceNormal(Positions, Stride, Index));
+
+			for (size_t Corner = 0u; Corner < 3u; ++Corner)
+			{
+				DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(Normals + Indices[Index + Corner] * Stride), Normal);
+			}
+		}
+	}
+
+	// The normals of the triangles around each vertex, weighted by their area, which the unnormalized cross product already is.
+	void SetNormalsSmooth()
+	{
+		const auto Stride = Vertices.GetLayout().Size();
+		auto* const Positions = reinterpret_cast<std::byte*>(GetStream<Element::Position3D>());
+		auto* const Normals = reinterpret_cast<std::byte*>(GetStream<Element::Normal>());
+		std::vector<DirectX::XMFLOAT3> Sums(Vertices.Num(), DirectX::XMFLOAT3 {0.0f, 0.0f, 0.0f});
 
-		for (size_t i = 0; i < Indices.size(); i += 3)
+		for (size_t Index = 0u; Index < Indices.size(); Index += 3u)
 		{
-			DV::Vertex Vertex_0 {Vertices[Indices[i]]};
-			DV::Vertex Vertex_1 {Vertices[Indices[i + 1]]};
-			DV::Vertex Vertex_2 {Vertices[Indices[i + 2]]};
-			
-			const DirectX::XMVECTOR Position_0 = DirectX::XMLoadFloat3(&Vertex_0.Attribute<Element::Position3D>());
-			const DirectX::XMVECTOR Position_1 = DirectX::XMLoadFloat3(&Vertex_1.Attribute<Element::Position3D>());
-			const DirectX::XMVECTOR Position_2 = DirectX::XMLoadFloat3(&Vertex_2.Attribute<Element::Position3D>());
-
-			const auto Normal = DirectX::XMVector3Normalize(DirectX::XMVector3Cross(DirectX::XMVectorSubtract(Position_1, Position_0), DirectX::XMVectorSubtract(Position_2, Position_0)));
-
-			DirectX::XMStoreFloat3(&Vertex_0.Attribute<Element::Normal>(), Normal);
-			DirectX::XMStoreFloat3(&Vertex_1.Attribute<Element::Normal>(), Normal);
-			DirectX::XMStoreFloat3(&Vertex_2.Attribute<Element::Normal>(), Normal);
+			const auto FaceNormal = GetFaceNormal(Positions, Stride, Index);
+
+			for (size_t Corner = 0u; Corner < 3u; ++Corner)
+			{
+				auto& Sum = Sums[Indices[Index + Corner]];
+				DirectX::XMStoreFloat3(&Sum, DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&Sum), FaceNormal));
+			}
 		}
+
+		for (size_t VertexIndex = 0u; VertexIndex < Sums.size(); ++VertexIndex)
+		{
+			DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(Normals + VertexIndex * Stride), DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&Sums[VertexIndex])));
+		}
+	}
+
+private:
+	using Element = DV::VertexLayout::ElementType;
+
+	// The element of the first vertex, the same element of the next one is a stride further. Resolved once per pass.
+	template<Element ElementType>
+	[[nodiscard]] DirectX::XMFLOAT3* GetStream()
+	{
+		return reinterpret_cast<DirectX::XMFLOAT3*>(Vertices.GetData() + Vertices.GetLayout().Resolve<ElementType>().GetByteOffset());
+	}
+
+	// Unnormalized, twice the area of the triangle starting at InFirstIndex.
+	[[nodiscard]] DirectX::XMVECTOR GetFaceNormal(const std::byte* InPositions, const size_t InStride, const size_t InFirstIndex) const
+	{
+		const auto Load = [InPositions, InStride](const unsigned int InVertex)
+		{
+			return DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(InPositions + InVertex * InStride));
+		};
+
+		const auto Position_0 = Load(Indices[InFirstIndex]);
+		return DirectX::XMVector3Cross(DirectX::XMVectorSubtract(Load(Indices[InFirstIndex + 1u]), Position_0), DirectX::XMVectorSubtract(Load(Indices[InFirstIndex + 2u]), Position_0));
 	}
 
 public:
@@ -1,13 +1,15 @@
 ﻿#include "InputLayout.h"
 #include "BindManager.h"
+#include "DrawPacket.h"
 #include "ExceptionMacros.h"
 
-InputLayout::InputLayout(const Graphics& InGraphics, DV::VertexLayout InLayout, ID3DBlob* InVertexShaderByteCode)
+InputLayout::InputLayout(const Graphics& InGraphics, DV::VertexLayout InLayout, ID3DBlob* InVertexShaderByteCode, const Elements InElements)
 	: DynamicVertexLayout(std::move(InLayout))
+	, MyElements(InElements)
 {
     HRESULT ResultHandle;
 
-	const auto& InputElementDescs = DynamicVertexLayout.GetD3D11Layout();
+	const auto& InputElementDescs = MyElements == Elements::PositionOnly ? DynamicVertexLayout.GetPositionD3D11Layout() : DynamicVertexLayout.GetD3D11Layout();
 
     CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateInputLayout
 	(
@@ -19,24 +21,57 @@ InputLayout::InputLayout(const Graphics& InGraphics, DV::VertexLayout InLayout,
 	))
 }
 
-void InputLayout::Bind(const Graphics& InGraphics) noexcept
+bool InputLayout::Accepts(const Graphics& InGraphics, ID3DBlob* InVertexShaderByteCode) const
 {
-	GetContext(InGraphics)->IASetInputLayout(MyInputLayout.Get());
+	const auto& InputElementDescs = MyElements == Elements::PositionOnly ? DynamicVertexLayout.GetPositionD3D11Layout() : DynamicVertexLayout.GetD3D11Layout();
+
+	// Without an output the device checks the elements against the shader's input signature and reports S_FALSE when they fit.
+	return GetDevice(InGraphics)->CreateInputLayout
+	(
+		InputElementDescs.data(),
+		static_cast<UINT>(InputElementDescs.size()),
+		InVertexShaderByteCode->GetBufferPointer(),
+		InVertexShaderByteCode->GetBufferSize(),
+		nullptr
+	) == S_FALSE;
+}
+
+void InputLayout::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetInputLayout(MyInputLayout.Get());
+}
+
+bool InputLayout::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.InputLayout = MyInputLayout.Get();
+	return true;
 }
 
 std::shared_ptr<InputLayout> InputLayout::Resolve(const Graphics& InGraphics, const DV::VertexLayout& InLayout,
-                                               ID3DBlob* InVertexShaderByteCode)
+                                               ID3DBlob* InVertexShaderByteCode, const Elements InElements)
 {
-	return BindManager::Resolve<InputLayout>(InGraphics, InLayout, InVertexShaderByteCode);
+	return BindManager::Resolve<InputLayout>(InGraphics, InLayout, InVertexShaderByteCode, InElements);
 }
 
-std::string InputLayout::GenerateUniqueID(const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode)
+std::string InputLayout::GenerateUniqueID(const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode, const Elements InElements)
 {
 	using namespace std::string_literals;
-	return typeid(InputLayout).name() + "#"s + InLayout.GetCode();
+	return typeid(InputLayout).name() + "#"s + InLayout.GetCode() + (InElements == Elements::PositionOnly ? "#PositionOnly"s : ""s);
+}
+
+BindKey InputLayout::GenerateKey(const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode, const Elements InElements)
+{
+	// Element types identify the layout just as its code string does, without building the string.
+	auto Key = BindKey::Make<InputLayout>(InElements);
+	for (size_t Index = 0; Index < InLayout.Num(); ++Index)
+	{
+		Key.Combine(InLayout.ResolveByIndex(Index).GetType());
+	}
+
+	return Key;
 }
 
 std::string InputLayout::GetUniqueID() const noexcept
 {
-	return GenerateUniqueID(DynamicVertexLayout);
+	return GenerateUniqueID(DynamicVertexLayout, nullptr, MyElements);
 }
\ No newline at end of file
@@ -1,20 +1,46 @@
 ﻿#pragma once
 #include <memory>
+#include "BindKey.h"
 #include "Bindable.h"
 #include "DynamicVertex.h"
 
 class InputLayout : public Bindable
 {
 public:
-	InputLayout(const Graphics& InGraphics, DV::VertexLayout InLayout, ID3DBlob* InVertexShaderByteCode);
+	enum class Elements
+	{
+		All,
+		PositionOnly
+	};
 
-	void Bind(const Graphics& InGraphics) noexcept override;
+	InputLayout(const Graphics& InGraphics, DV::VertexLayout InLayout, ID3DBlob* InVertexShaderByteCode, Elements InElements = Elements::All);
 
-	[[nodiscard]] static std::shared_ptr<InputLayout> Resolve(const Graphics& InGraphics, const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode);
-	[[nodiscard]] static std::string GenerateUniqueID(const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode = nullptr);
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] const DV::VertexLayout& GetLayout() const noexcept
+	{
+		return DynamicVertexLayout;
+	}
+
+	[[nodiscard]] Elements GetElements() const noexcept
+	{
+		return MyElements;
+	}
+
+	// Only validates, so reloaded vertex shaders can be checked against the layouts already in use.
+	[[nodiscard]] bool Accepts(const Graphics& InGraphics, ID3DBlob* InVertexShaderByteCode) const;
+
+	[[nodiscard]] static std::shared_ptr<InputLayout> Resolve(const Graphics& InGraphics, const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode,
+	                                                          Elements InElements = Elements::All);
+	[[nodiscard]] static std::string GenerateUniqueID(const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode = nullptr,
+	                                                  Elements InElements = Elements::All);
+	[[nodiscard]] static BindKey GenerateKey(const DV::VertexLayout& InLayout, ID3DBlob* InVertexShaderByteCode = nullptr,
+	                                         Elements InElements = Elements::All);
 	[[nodiscard]] std::string GetUniqueID() const noexcept override;
 
 protected:
 	DV::VertexLayout DynamicVertexLayout;
+	Elements MyElements;
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> MyInputLayout;
 };
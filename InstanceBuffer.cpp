@@ -0,0 +1,90 @@
+﻿#include "InstanceBuffer.h"
+#include "BindManager.h"
+#include "ExceptionMacros.h"
+
+InstanceBuffer::InstanceBuffer(const Graphics& InGraphics, const UINT InSlot)
+	: Slot(InSlot)
+{
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC InstanceBufferDesc {};
+	InstanceBufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	InstanceBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	InstanceBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	InstanceBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	InstanceBufferDesc.ByteWidth = static_cast<UINT>(sizeof(InstanceTransforms) * Capacity);
+	InstanceBufferDesc.StructureByteStride = sizeof(InstanceTransforms);
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer
+	(
+		&InstanceBufferDesc,
+		nullptr,
+		&MyInstanceBuffer
+	))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC ResourceViewDesc {};
+	ResourceViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+	ResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	ResourceViewDesc.Buffer.FirstElement = 0u;
+	ResourceViewDesc.Buffer.NumElements = Capacity;
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateShaderResourceView
+	(
+		MyInstanceBuffer.Get(),
+		&ResourceViewDesc,
+		&MyInstanceView
+	))
+}
+
+InstanceBuffer::InstanceTransforms* InstanceBuffer::Map(RenderContext& InContext)
+{
+	HRESULT ResultHandle;
+
+	D3D11_MAPPED_SUBRESOURCE MappedSubresource;
+	CHECK_HRESULT_EXCEPTION(GetContext(InContext)->Map
+	(
+		MyInstanceBuffer.Get(),
+		0u,
+		D3D11_MAP_WRITE_DISCARD,
+		0u,
+		&MappedSubresource
+	))
+
+	return static_cast<InstanceTransforms*>(MappedSubresource.pData);
+}
+
+void InstanceBuffer::Unmap(RenderContext& InContext) noexcept
+{
+	GetContext(InContext)->Unmap(MyInstanceBuffer.Get(), 0u);
+}
+
+void InstanceBuffer::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetVertexShaderResource(Slot, MyInstanceView.Get());
+}
+
+std::shared_ptr<InstanceBuffer> InstanceBuffer::Resolve(const Graphics& InGraphics, const UINT InSlot)
+{
+	return BindManager::Resolve<InstanceBuffer>(InGraphics, InSlot);
+}
+
+std::string InstanceBuffer::GenerateUniqueID(const UINT InSlot)
+{
+	using namespace std::string_literals;
+	return typeid(InstanceBuffer).name() + "#"s + std::to_string(InSlot);
+}
+
+BindKey InstanceBuffer::GenerateKey(const UINT InSlot)
+{
+	return BindKey::Make<InstanceBuffer>(InSlot);
+}
+
+std::string InstanceBuffer::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(Slot);
+}
+
+size_t InstanceBuffer::GetGpuByteSize() const noexcept
+{
+	return sizeof(InstanceTransforms) * Capacity;
+}
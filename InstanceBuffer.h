@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <memory>
+#include "BindKey.h"
+#include "Bindable.h"
+
+class InstanceBuffer : public Bindable
+{
+public:
+	// View and projection come from the frame constants, laid out like InstanceTransform in Instancing.hlsli.
+	struct InstanceTransforms
+	{
+		DirectX::XMMATRIX World;
+		// Into the MaterialTable, so instances of one group can each have their own material.
+		UINT MaterialIndex;
+		// Clip and time offset of the vertex animation, see Drawable::GetPlayedAnimation.
+		UINT Animation;
+		UINT Padding[2];
+	};
+
+	static constexpr UINT Capacity {512u};
+
+	explicit InstanceBuffer(const Graphics& InGraphics, UINT InSlot = 0u);
+
+	// Write up to Capacity transforms straight into the mapped buffer, then Unmap before drawing.
+	[[nodiscard]] InstanceTransforms* Map(RenderContext& InContext);
+	void Unmap(RenderContext& InContext) noexcept;
+	void Bind(RenderContext& InContext) noexcept override;
+
+	[[nodiscard]] UINT GetSlot() const noexcept
+	{
+		return Slot;
+	}
+
+	[[nodiscard]] static std::shared_ptr<InstanceBuffer> Resolve(const Graphics& InGraphics, UINT InSlot = 0u);
+	[[nodiscard]] static std::string GenerateUniqueID(UINT InSlot = 0u);
+	[[nodiscard]] static BindKey GenerateKey(UINT InSlot = 0u);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	UINT Slot;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> MyInstanceBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyInstanceView;
+};
@@ -0,0 +1,111 @@
+#include "HiZ.hlsli"
+
+// One per instanced draw, its visible instances are compacted from FirstInstance on.
+struct Group
+{
+    float3 Center;
+    uint IndexCount;
+    float3 Extents;
+    uint StartIndex;
+    int BaseVertex;
+    uint FirstInstance;
+    uint2 Padding;
+};
+
+struct Instance
+{
+    // Into the scene transforms.
+    uint Transform;
+    uint Group;
+    uint Material;
+    uint Animation;
+};
+
+struct SceneTransform
+{
+    matrix Model;
+};
+
+// Laid out like Instancing.hlsli, whose buffer is in a slot taken here.
+struct InstanceTransform
+{
+    matrix Model;
+    uint MaterialIndex;
+    uint Animation;
+    uint2 Padding;
+};
+
+StructuredBuffer<Group> Groups : register(t0);
+StructuredBuffer<Instance> Instances : register(t1);
+Texture2D<float> Pyramid : register(t2);
+StructuredBuffer<SceneTransform> SceneTransforms : register(t3);
+RWByteAddressBuffer Arguments : register(u0);
+RWStructuredBuffer<InstanceTransform> VisibleInstances : register(u1);
+
+cbuffer Cull : register(b0)
+{
+    matrix ViewProjection;
+    // Clip space planes facing inwards, not normalized.
+    float4 FrustumPlanes[6];
+    float2 PyramidSize;
+    uint PyramidMipNum;
+    uint InstanceNum;
+    uint bHasPyramid;
+}
+
+// D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, the instance count is the second value.
+static const uint ArgumentStride = 20u;
+
+bool IsInFrustum(const float3 InCenter, const float3 InExtents)
+{
+    [unroll]
+    for (uint Plane = 0u; Plane < 6u; ++Plane)
+    {
+        // The corner farthest along the plane normal is still behind it.
+        if (dot(FrustumPlanes[Plane].xyz, InCenter) + FrustumPlanes[Plane].w + dot(abs(FrustumPlanes[Plane].xyz), InExtents) < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+[numthreads(64, 1, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    const uint Index = InThreadID.x;
+
+    if (Index >= InstanceNum)
+    {
+        return;
+    }
+
+    const Instance Target = Instances[Index];
+    const Group Owner = Groups[Target.Group];
+    const matrix Model = SceneTransforms[Target.Transform].Model;
+
+    // The box around the transformed local bounds.
+    const float3 Center = mul(float4(Owner.Center, 1.0f), Model).xyz;
+    const float3 Extents = mul(Owner.Extents, abs((float3x3) Model));
+
+    if (!IsInFrustum(Center, Extents))
+    {
+        return;
+    }
+
+    if (bHasPyramid && !IsBoxUnoccluded(Pyramid, Center, Extents, ViewProjection, PyramidSize, PyramidMipNum))
+    {
+        return;
+    }
+
+    uint Position;
+    Arguments.InterlockedAdd(Target.Group * ArgumentStride + 4u, 1u, Position);
+
+    InstanceTransform Visible;
+    Visible.Model = Model;
+    Visible.MaterialIndex = Target.Material;
+    Visible.Animation = Target.Animation;
+    Visible.Padding = uint2(0u, 0u);
+    VisibleInstances[Owner.FirstInstance + Position] = Visible;
+}
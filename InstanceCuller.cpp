@@ -0,0 +1,232 @@
+﻿#include "InstanceCuller.h"
+#include <algorithm>
+#include <cstring>
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "GpuScene.h"
+#include "Graphics.h"
+#include "InstanceBuffer.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	constexpr UINT CullGroupSize {64u};
+	// Where the instanced vertex shaders read their transforms from.
+	constexpr UINT InstanceTransformSlot {0u};
+
+	void CreateDynamicStructuredBuffer(ID3D11Device* InDevice, const UINT InStride, const UINT InNum, Microsoft::WRL::ComPtr<ID3D11Buffer>& OutBuffer,
+	                                   Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& OutView)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC Desc {};
+		Desc.ByteWidth = InStride * InNum;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		Desc.StructureByteStride = InStride;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&Desc, nullptr, &OutBuffer))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(OutBuffer.Get(), nullptr, &OutView))
+	}
+
+	void Upload(ID3D11DeviceContext* InContext, ID3D11Buffer* InBuffer, const void* InData, const size_t InByteSize)
+	{
+		HRESULT ResultHandle;
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+		CHECK_HRESULT_EXCEPTION(InContext->Map(InBuffer, 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		std::memcpy(MappedResource.pData, InData, InByteSize);
+		InContext->Unmap(InBuffer, 0u);
+	}
+}
+
+InstanceCuller::InstanceCuller(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, GpuScene& InScene)
+	: Device(InDevice)
+	, Scene(InScene)
+{
+	HRESULT ResultHandle;
+	const auto Blob = InShaderBundle.Load("InstanceCullCS.cso");
+
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &CullShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(CullConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &CullConstantBuffer))
+
+	CreateDynamicStructuredBuffer(InDevice, sizeof(Group), MaxGroupNum, GroupBuffer, GroupBufferView);
+	CreateDynamicStructuredBuffer(InDevice, sizeof(Instance), MaxInstanceNum, InstanceData, InstanceDataView);
+
+	// Laid out like InstanceBuffer::InstanceTransforms, the instanced vertex shaders read it in its place.
+	D3D11_BUFFER_DESC VisibleDesc {};
+	VisibleDesc.ByteWidth = MaxInstanceNum * sizeof(InstanceBuffer::InstanceTransforms);
+	VisibleDesc.Usage = D3D11_USAGE_DEFAULT;
+	VisibleDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	VisibleDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	VisibleDesc.StructureByteStride = sizeof(InstanceBuffer::InstanceTransforms);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&VisibleDesc, nullptr, &VisibleInstances))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(VisibleInstances.Get(), nullptr, &VisibleInstancesUav))
+
+	// Raw views let the cull shader count instances into the arguments the input assembler later reads.
+	constexpr auto ArgumentsByteWidth = MaxGroupNum * ArgumentStride;
+
+	D3D11_BUFFER_DESC ArgumentsDesc {};
+	ArgumentsDesc.ByteWidth = ArgumentsByteWidth;
+	ArgumentsDesc.Usage = D3D11_USAGE_DEFAULT;
+	ArgumentsDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	ArgumentsDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ArgumentsDesc, nullptr, &Arguments))
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC ArgumentsUavDesc {};
+	ArgumentsUavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	ArgumentsUavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	ArgumentsUavDesc.Buffer.NumElements = ArgumentsByteWidth / sizeof(UINT);
+	ArgumentsUavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(Arguments.Get(), &ArgumentsUavDesc, &ArgumentsUav))
+
+	Groups.reserve(MaxGroupNum);
+	InitialArguments.reserve(MaxGroupNum);
+}
+
+void InstanceCuller::BeginFrame() noexcept
+{
+	LastGroupNum = static_cast<unsigned int>(Groups.size());
+	LastInstanceNum = static_cast<unsigned int>(Instances.size());
+
+	Groups.clear();
+	Instances.clear();
+	InitialArguments.clear();
+}
+
+unsigned int InstanceCuller::AddGroup(const DirectX::BoundingBox& InLocalBounds, const UINT InIndexCount, const UINT InStartIndex, const INT InBaseVertex,
+                                      const std::span<const Drawable* const> InInstances)
+{
+	if (!bIsEnabled || InInstances.empty() || Groups.size() == MaxGroupNum || Instances.size() + InInstances.size() > MaxInstanceNum)
+	{
+		return NoSlot;
+	}
+
+	const auto TransientNum = std::count_if(InInstances.begin(), InInstances.end(), [](const Drawable* const InMember)
+	{
+		return InMember->GetSceneIndex() == GpuScene::NoIndex;
+	});
+
+	if (static_cast<unsigned int>(TransientNum) > Scene.GetTransientSpace())
+	{
+		return NoSlot;
+	}
+
+	const auto Slot = static_cast<unsigned int>(Groups.size());
+	const auto FirstInstance = static_cast<UINT>(Instances.size());
+	const auto InstanceNum = static_cast<UINT>(InInstances.size());
+
+	Groups.push_back({InLocalBounds.Center, InIndexCount, InLocalBounds.Extents, InStartIndex, InBaseVertex, FirstInstance, {}});
+	InitialArguments.push_back({InIndexCount, 0u, InStartIndex, static_cast<UINT>(InBaseVertex), 0u});
+
+	for (const auto* const Member : InInstances)
+	{
+		const auto SceneIndex = Member->GetSceneIndex();
+		Instances.push_back({SceneIndex != GpuScene::NoIndex ? SceneIndex : Scene.AddTransient(Member->GetTransformMatrix()), Slot,
+		                     Member->GetMaterialIndex(), Member->GetPlayedAnimation()});
+	}
+
+	if (GroupViews.size() <= Slot)
+	{
+		GroupViews.resize(Slot + 1u);
+	}
+
+	if (auto& Cached = GroupViews[Slot]; !Cached.View || Cached.FirstInstance != FirstInstance || Cached.InstanceNum != InstanceNum)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC ViewDesc {};
+		ViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		ViewDesc.Buffer.FirstElement = FirstInstance;
+		ViewDesc.Buffer.NumElements = InstanceNum;
+		CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(VisibleInstances.Get(), &ViewDesc, Cached.View.ReleaseAndGetAddressOf()))
+
+		Cached.FirstInstance = FirstInstance;
+		Cached.InstanceNum = InstanceNum;
+	}
+
+	return Slot;
+}
+
+void InstanceCuller::Cull(const Graphics& InGraphics)
+{
+	if (Groups.empty())
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Instance cull");
+
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	auto* const Context = ImmediateContext.GetDeviceContext();
+
+	// Whatever instanced draw came last is still reading the visible instances, they cannot be written meanwhile.
+	ImmediateContext.GetStateCache().SetVertexShaderResource(InstanceTransformSlot, nullptr);
+
+	Scene.Flush(InGraphics);
+
+	Upload(Context, GroupBuffer.Get(), Groups.data(), Groups.size() * sizeof(Group));
+	Upload(Context, InstanceData.Get(), Instances.data(), Instances.size() * sizeof(Instance));
+
+	const D3D11_BOX ArgumentsBox {0u, 0u, 0u, static_cast<UINT>(InitialArguments.size()) * ArgumentStride, 1u, 1u};
+	Context->UpdateSubresource(Arguments.Get(), 0u, &ArgumentsBox, InitialArguments.data(), 0u, 0u);
+
+	const auto Transposed = DirectX::XMMatrixTranspose(InGraphics.GetViewProjectionMatrix());
+
+	CullConstants Constants {};
+	Constants.ViewProjection = Transposed;
+	Constants.InstanceNum = static_cast<UINT>(Instances.size());
+
+	// Rows of the transposed matrix are the clip space axes, w + x >= 0 and so on for the sides, z >= 0 for the near plane.
+	const DirectX::XMVECTOR Planes[] =
+	{
+		DirectX::XMVectorAdd(Transposed.r[3], Transposed.r[0]),
+		DirectX::XMVectorSubtract(Transposed.r[3], Transposed.r[0]),
+		DirectX::XMVectorAdd(Transposed.r[3], Transposed.r[1]),
+		DirectX::XMVectorSubtract(Transposed.r[3], Transposed.r[1]),
+		Transposed.r[2],
+		DirectX::XMVectorSubtract(Transposed.r[3], Transposed.r[2])
+	};
+
+	for (size_t Index = 0u; Index < std::size(Planes); ++Index)
+	{
+		DirectX::XMStoreFloat4(&Constants.FrustumPlanes[Index], Planes[Index]);
+	}
+
+	const auto& Occlusion = InGraphics.GetOcclusionCuller();
+	ID3D11ShaderResourceView* Pyramid = nullptr;
+
+	if (Occlusion.IsEnabled() && Occlusion.HasPyramid())
+	{
+		Pyramid = Occlusion.GetPyramidView();
+		Constants.PyramidSize = Occlusion.GetPyramidSize();
+		Constants.PyramidMipNum = Occlusion.GetPyramidMipNum();
+		Constants.bHasPyramid = true;
+	}
+
+	Upload(Context, CullConstantBuffer.Get(), &Constants, sizeof(Constants));
+
+	ID3D11ShaderResourceView* const Views[] = {GroupBufferView.Get(), InstanceDataView.Get(), Pyramid, Scene.GetTransformView()};
+	ID3D11UnorderedAccessView* const Uavs[] = {ArgumentsUav.Get(), VisibleInstancesUav.Get()};
+
+	Context->CSSetShader(CullShader.Get(), nullptr, 0u);
+	Context->CSSetConstantBuffers(0u, 1u, CullConstantBuffer.GetAddressOf());
+	Context->CSSetShaderResources(0u, static_cast<UINT>(std::size(Views)), Views);
+	Context->CSSetUnorderedAccessViews(0u, static_cast<UINT>(std::size(Uavs)), Uavs, nullptr);
+	Context->Dispatch((Constants.InstanceNum + CullGroupSize - 1u) / CullGroupSize, 1u, 1u);
+
+	// Unbound so the arguments can feed the input assembler and the vertex shaders read the instances.
+	ID3D11ShaderResourceView* const NullViews[std::size(Views)] {};
+	ID3D11UnorderedAccessView* const NullUavs[std::size(Uavs)] {};
+	Context->CSSetShaderResources(0u, static_cast<UINT>(std::size(NullViews)), NullViews);
+	Context->CSSetUnorderedAccessViews(0u, static_cast<UINT>(std::size(NullUavs)), NullUavs, nullptr);
+}
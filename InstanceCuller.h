@@ -0,0 +1,156 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <span>
+#include <vector>
+#include "wrl/client.h"
+
+class Drawable;
+class GpuScene;
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Optional GPU culling of instanced draws, one thread per instance instead of a CPU test per drawable.
+ * Every instance of a group is uploaded as its group, its material and the ID of its transform in the GpuScene, which only uploads what
+ * moved, instances placed outside the scene get a transient ID for the frame. A compute pass tests each against the frustum
+ * and, while the occlusion culler has one, last frame's Hi-Z pyramid, and compacts the survivors into the group's
+ * range of a visible instance buffer. The instance count is appended to straight in the group's indirect arguments,
+ * so however many instances a group has it is one indirect draw and nothing is read back on the CPU.
+ * Instances that just came out from behind an occluder show up a frame late, there is no second phase as for meshes.
+ */
+class InstanceCuller
+{
+public:
+	static constexpr unsigned int NoSlot {~0u};
+	static constexpr unsigned int MaxGroupNum {4096u};
+	static constexpr unsigned int MaxInstanceNum {131072u};
+	// Byte size of D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS.
+	static constexpr UINT ArgumentStride {5u * sizeof(UINT)};
+
+	InstanceCuller(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, GpuScene& InScene);
+	InstanceCuller(const InstanceCuller&) = delete;
+	InstanceCuller(InstanceCuller&&) = delete;
+	InstanceCuller& operator=(const InstanceCuller&) = delete;
+	InstanceCuller& operator=(InstanceCuller&&) = delete;
+	~InstanceCuller() = default;
+
+	void BeginFrame() noexcept;
+	// Slot of the group's arguments and visible instances, NoSlot when disabled or full so the caller draws it from the CPU.
+	// On the main thread, InInstances share the geometry drawn with the given range and InLocalBounds surrounds it with their transforms left out.
+	[[nodiscard]] unsigned int AddGroup(const DirectX::BoundingBox& InLocalBounds, UINT InIndexCount, UINT InStartIndex, INT InBaseVertex,
+	                                    std::span<const Drawable* const> InInstances);
+
+	// Before anything draws from the slots handed out this frame.
+	void Cull(const Graphics& InGraphics);
+
+	[[nodiscard]] ID3D11Buffer* GetArguments() const noexcept
+	{
+		return Arguments.Get();
+	}
+
+	// Only the slot's range of the visible instances, to bind where the instanced vertex shaders read their transforms.
+	[[nodiscard]] ID3D11ShaderResourceView* GetInstanceView(const unsigned int InSlot) const noexcept
+	{
+		return GroupViews[InSlot].View.Get();
+	}
+
+	[[nodiscard]] bool HasGroups() const noexcept
+	{
+		return !Groups.empty();
+	}
+
+	// Of the last frame, this one's groups are only known once the render queue executes.
+	[[nodiscard]] unsigned int GetGroupNum() const noexcept
+	{
+		return LastGroupNum;
+	}
+
+	[[nodiscard]] unsigned int GetInstanceNum() const noexcept
+	{
+		return LastInstanceNum;
+	}
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+private:
+	struct Group
+	{
+		DirectX::XMFLOAT3 Center;
+		UINT IndexCount;
+		DirectX::XMFLOAT3 Extents;
+		UINT StartIndex;
+		INT BaseVertex;
+		UINT FirstInstance;
+		UINT Padding[2];
+	};
+
+	struct Instance
+	{
+		// Into the scene transforms.
+		UINT Transform;
+		UINT Group;
+		// Passed on with the transform of a visible instance.
+		UINT Material;
+		// Passed on the same way, see Drawable::GetPlayedAnimation.
+		UINT Animation;
+	};
+
+	struct CullConstants
+	{
+		DirectX::XMMATRIX ViewProjection;
+		std::array<DirectX::XMFLOAT4, 6> FrustumPlanes;
+		DirectX::XMFLOAT2 PyramidSize;
+		UINT PyramidMipNum;
+		UINT InstanceNum;
+		UINT bHasPyramid;
+		UINT Padding[3];
+	};
+
+	// Views only change when the compacted ranges move, which they rarely do while the same groups are drawn.
+	struct GroupView
+	{
+		UINT FirstInstance {0u};
+		UINT InstanceNum {0u};
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+	};
+
+private:
+	ID3D11Device* Device;
+	GpuScene& Scene;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> CullShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CullConstantBuffer;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GroupBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GroupBufferView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> InstanceData;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> InstanceDataView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> VisibleInstances;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> VisibleInstancesUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Arguments;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ArgumentsUav;
+
+	std::vector<Group> Groups;
+	std::vector<Instance> Instances;
+	// What each group's arguments start the frame as, with no instances yet.
+	std::vector<std::array<UINT, 5>> InitialArguments;
+	std::vector<GroupView> GroupViews;
+	unsigned int LastGroupNum {0u};
+	unsigned int LastInstanceNum {0u};
+	bool bIsEnabled {false};
+};
@@ -0,0 +1,12 @@
+// Laid out like InstanceBuffer::InstanceTransforms.
+struct InstanceTransform
+{
+    matrix Model;
+    // Into the material table.
+    uint MaterialIndex;
+    // What the vertex animated shaders play, see VertexAnimation.hlsli.
+    uint Animation;
+    uint2 Padding;
+};
+
+StructuredBuffer<InstanceTransform> InstanceTransforms : register(t0);
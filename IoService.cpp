@@ -0,0 +1,384 @@
+﻿#define FULL_WINDOW
+#include "IoService.h"
+#include "EngineWin.h"
+#include <algorithm>
+#include <cassert>
+#include "AssetArchive.h"
+
+namespace
+{
+	// Completion keys, wake-ups carry no OVERLAPPED.
+	constexpr ULONG_PTR WakeKey {0u};
+	constexpr ULONG_PTR FileKey {1u};
+	constexpr ULONG_PTR DecodedKey {2u};
+	constexpr ULONG_PTR FailedKey {3u};
+
+	// Standard layout, so the OVERLAPPED a completion hands back converts to its operation.
+	struct Operation
+	{
+		OVERLAPPED Overlapped;
+		IoService::RequestId Id;
+	};
+}
+
+struct IoService::Request
+{
+	Operation Io {};
+	std::filesystem::path Path;
+	IoPriority Priority;
+	Completion OnComplete;
+	JobCounter* Signal;
+	std::vector<std::byte> Buffer;
+	HANDLE File {INVALID_HANDLE_VALUE};
+	bool bIsInFlight {false};
+	bool bIsCancelled {false};
+};
+
+IoService::IoService()
+{
+	assert(!Instance && "Only one IoService may exist");
+	Instance = this;
+
+	Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0u, 1u);
+	assert(Port && "Creating the I/O completion port failed");
+
+	FreeBuffers.resize(PooledBufferNum);
+	for (auto& Buffer : FreeBuffers)
+	{
+		Buffer.reserve(PooledBufferBytes);
+	}
+
+	Thread = std::thread(&IoService::ThreadLoop, this);
+}
+
+IoService::~IoService()
+{
+	std::vector<std::unique_ptr<Request>> Cancelled;
+	{
+		std::lock_guard Lock(Mutex);
+		bIsStopping = true;
+
+		for (auto& Queue : Queues)
+		{
+			for (auto* Queued : Queue)
+			{
+				Cancelled.push_back(std::move(Requests.at(Queued->Io.Id)));
+				Requests.erase(Queued->Io.Id);
+			}
+
+			Queue.clear();
+		}
+
+		for (auto& [Id, InFlight] : Requests)
+		{
+			InFlight->bIsCancelled = true;
+
+			if (InFlight->File != INVALID_HANDLE_VALUE)
+			{
+				CancelIoEx(InFlight->File, &InFlight->Io.Overlapped);
+			}
+		}
+	}
+
+	for (auto& Queued : Cancelled)
+	{
+		Finish(std::move(Queued), IoStatus::Cancelled);
+	}
+
+	// The thread leaves once the reads in flight have come back.
+	PostQueuedCompletionStatus(Port, 0u, WakeKey, nullptr);
+	Thread.join();
+
+	// Completions still queued capture this service. Whatever they threw belonged to their signals.
+	try
+	{
+		JobSystem::Get().Wait(Completions);
+	}
+	catch (...)
+	{
+	}
+
+	CloseHandle(Port);
+	Instance = nullptr;
+}
+
+IoService& IoService::Get() noexcept
+{
+	assert(Instance && "IoService is used before App created it");
+	return *Instance;
+}
+
+IoService::RequestId IoService::Read(const std::filesystem::path& InPath, const IoPriority InPriority, Completion InCompletion, JobCounter* InSignal)
+{
+	auto NewRequest = std::make_unique<Request>();
+	NewRequest->Path = InPath;
+	NewRequest->Priority = InPriority;
+	NewRequest->OnComplete = std::move(InCompletion);
+	NewRequest->Signal = InSignal;
+
+	if (InSignal)
+	{
+		JobSystem::Get().Hold(*InSignal);
+	}
+
+	RequestId Id;
+	{
+		std::lock_guard Lock(Mutex);
+		assert(!bIsStopping && "IoService is read from while it shuts down");
+
+		Id = NextRequest++;
+		NewRequest->Io.Id = Id;
+		Queues[static_cast<size_t>(InPriority)].push_back(NewRequest.get());
+		Requests.emplace(Id, std::move(NewRequest));
+	}
+
+	PostQueuedCompletionStatus(Port, 0u, WakeKey, nullptr);
+	return Id;
+}
+
+void IoService::Cancel(const RequestId InRequest)
+{
+	std::unique_ptr<Request> Cancelled;
+	{
+		std::lock_guard Lock(Mutex);
+
+		const auto Found = Requests.find(InRequest);
+		if (Found == Requests.end())
+		{
+			return;
+		}
+
+		auto& Cancelling = *Found->second;
+		Cancelling.bIsCancelled = true;
+
+		if (Cancelling.bIsInFlight)
+		{
+			// A read still being issued is aborted by Start once it has a file to abort.
+			if (Cancelling.File != INVALID_HANDLE_VALUE)
+			{
+				CancelIoEx(Cancelling.File, &Cancelling.Io.Overlapped);
+			}
+
+			return;
+		}
+
+		auto& Queue = Queues[static_cast<size_t>(Cancelling.Priority)];
+		Queue.erase(std::find(Queue.begin(), Queue.end(), &Cancelling));
+		Cancelled = std::move(Found->second);
+		Requests.erase(Found);
+	}
+
+	Finish(std::move(Cancelled), IoStatus::Cancelled);
+}
+
+void IoService::ThreadLoop()
+{
+	// Only waits on the port and starts reads, nothing it does is worth a performance core.
+	JobSystem::Get().JoinLane(JobLane::Background);
+
+	for (;;)
+	{
+		std::vector<Request*> Starting;
+		{
+			std::lock_guard Lock(Mutex);
+
+			if (bIsStopping && Requests.empty())
+			{
+				return;
+			}
+
+			// Highest priority first, oldest first within one.
+			for (auto& Queue : Queues)
+			{
+				while (InFlightNum < MaxInFlightNum && !Queue.empty())
+				{
+					auto* Next = Queue.front();
+					Queue.pop_front();
+
+					Next->bIsInFlight = true;
+					Next->Buffer = AcquireBuffer();
+					Starting.push_back(Next);
+					++InFlightNum;
+				}
+			}
+		}
+
+		for (auto* Next : Starting)
+		{
+			Start(*Next);
+		}
+
+		DWORD TransferredBytes = 0u;
+		ULONG_PTR Key = WakeKey;
+		OVERLAPPED* Overlapped = nullptr;
+		const auto bSucceeded = GetQueuedCompletionStatus(Port, &TransferredBytes, &Key, &Overlapped, INFINITE);
+
+		if (!Overlapped)
+		{
+			continue;
+		}
+
+		std::unique_ptr<Request> Completed;
+		{
+			std::lock_guard Lock(Mutex);
+
+			const auto Found = Requests.find(reinterpret_cast<Operation*>(Overlapped)->Id);
+			assert(Found != Requests.end());
+
+			Completed = std::move(Found->second);
+			Requests.erase(Found);
+			--InFlightNum;
+		}
+
+		if (Completed->File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(Completed->File);
+			Completed->File = INVALID_HANDLE_VALUE;
+		}
+
+		auto Status = IoStatus::Failed;
+		if (Completed->bIsCancelled)
+		{
+			Status = IoStatus::Cancelled;
+		}
+		else if (Key == DecodedKey || (Key == FileKey && bSucceeded && TransferredBytes == Completed->Buffer.size()))
+		{
+			Status = IoStatus::Done;
+		}
+
+		Finish(std::move(Completed), Status);
+	}
+}
+
+void IoService::Start(Request& InRequest)
+{
+	// Archived files are already mapped, reading one is decompressing it.
+	if (AssetArchive::Get().Contains(InRequest.Path))
+	{
+		JobSystem::Get().Run([this, &InRequest]
+		{
+			bool bIsRead = false;
+			try
+			{
+				bIsRead = AssetArchive::Get().Read(InRequest.Path, InRequest.Buffer);
+			}
+			catch (...)
+			{
+			}
+
+			PostQueuedCompletionStatus(Port, 0u, bIsRead ? DecodedKey : FailedKey, &InRequest.Io.Overlapped);
+		}, JobLane::Background);
+
+		return;
+	}
+
+	const auto File = CreateFileW(InRequest.Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                              FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	LARGE_INTEGER FileSize {};
+	if (File == INVALID_HANDLE_VALUE || !GetFileSizeEx(File, &FileSize) || FileSize.QuadPart > MAXDWORD ||
+		!CreateIoCompletionPort(File, Port, FileKey, 0u))
+	{
+		if (File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(File);
+		}
+
+		PostQueuedCompletionStatus(Port, 0u, FailedKey, &InRequest.Io.Overlapped);
+		return;
+	}
+
+	InRequest.Buffer.resize(static_cast<size_t>(FileSize.QuadPart));
+	{
+		std::lock_guard Lock(Mutex);
+		InRequest.File = File;
+	}
+
+	// Completes on the port even when the data was cached and ReadFile returns at once.
+	if (!ReadFile(File, InRequest.Buffer.data(), static_cast<DWORD>(InRequest.Buffer.size()), nullptr, &InRequest.Io.Overlapped) &&
+		GetLastError() != ERROR_IO_PENDING)
+	{
+		PostQueuedCompletionStatus(Port, 0u, FailedKey, &InRequest.Io.Overlapped);
+		return;
+	}
+
+	std::lock_guard Lock(Mutex);
+	if (InRequest.bIsCancelled)
+	{
+		CancelIoEx(File, &InRequest.Io.Overlapped);
+	}
+}
+
+IoService::Activity IoService::GetActivity()
+{
+	std::lock_guard Lock(Mutex);
+
+	unsigned int QueuedNum = 0u;
+	for (const auto& Queue : Queues)
+	{
+		QueuedNum += static_cast<unsigned int>(Queue.size());
+	}
+
+	return {NextRequest - 1u, FinishedNum.load(std::memory_order_relaxed), FinishedBytes.load(std::memory_order_relaxed), QueuedNum, InFlightNum};
+}
+
+void IoService::Finish(std::unique_ptr<Request> InRequest, const IoStatus InStatus)
+{
+	if (InStatus == IoStatus::Done)
+	{
+		FinishedBytes.fetch_add(InRequest->Buffer.size(), std::memory_order_relaxed);
+	}
+
+	FinishedNum.fetch_add(1u, std::memory_order_relaxed);
+
+	// Jobs are copied around, the request isn't.
+	JobSystem::Get().Run([this, Finished = std::shared_ptr<Request>(std::move(InRequest)), InStatus]
+	{
+		std::exception_ptr Exception;
+		try
+		{
+			Finished->OnComplete(InStatus, InStatus == IoStatus::Done ? std::span<const std::byte>(Finished->Buffer) : std::span<const std::byte> {});
+		}
+		catch (...)
+		{
+			Exception = std::current_exception();
+		}
+
+		ReleaseBuffer(std::move(Finished->Buffer));
+
+		// A request nobody waits on has nowhere to report its failure.
+		assert((Finished->Signal || !Exception) && "An unsignalled read's completion threw");
+		if (Finished->Signal)
+		{
+			JobSystem::Get().Release(*Finished->Signal, std::move(Exception));
+		}
+	}, JobLane::Background, &Completions);
+}
+
+std::vector<std::byte> IoService::AcquireBuffer()
+{
+	if (FreeBuffers.empty())
+	{
+		return {};
+	}
+
+	auto Buffer = std::move(FreeBuffers.back());
+	FreeBuffers.pop_back();
+	return Buffer;
+}
+
+void IoService::ReleaseBuffer(std::vector<std::byte>&& InBuffer)
+{
+	if (InBuffer.capacity() == 0u || InBuffer.capacity() > MaxPooledBytes)
+	{
+		return;
+	}
+
+	InBuffer.clear();
+
+	std::lock_guard Lock(Mutex);
+	if (FreeBuffers.size() < PooledBufferNum)
+	{
+		FreeBuffers.push_back(std::move(InBuffer));
+	}
+}
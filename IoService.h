@@ -0,0 +1,117 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.h"
+
+enum class IoPriority : uint8_t
+{
+	// What the current frame is waiting on.
+	Visible,
+	// Likely needed soon, such as detail for what is just out of view.
+	Prefetch,
+	Background
+};
+
+inline constexpr size_t IoPriorityNum {3u};
+
+enum class IoStatus : uint8_t
+{
+	Done,
+	Failed,
+	Cancelled
+};
+
+/**
+ * Reads whole files without blocking the workers: loose files with overlapped reads completing on an I/O completion port
+ * that one thread of its own waits on, archived ones by decompressing them in a job. Requests wait in one queue per priority
+ * and only a few are in flight at once, so what the frame needs isn't stuck behind a long prefetch.
+ * Reads land in buffers kept from earlier requests where one is free, and each completion runs as a job with the bytes.
+ * Owned by App, everything else reaches it through Get().
+ */
+class IoService
+{
+public:
+	using RequestId = uint64_t;
+	// Runs exactly once per request as a job, the bytes are empty unless the read is done and only valid during the call.
+	using Completion = std::function<void(IoStatus InStatus, std::span<const std::byte> InBytes)>;
+
+	static constexpr RequestId NoRequest {0u};
+
+	// Totals since startup, except for what is pending right now.
+	struct Activity
+	{
+		unsigned long long RequestedNum;
+		unsigned long long FinishedNum;
+		// Read by the requests that finished Done.
+		unsigned long long Bytes;
+		unsigned int QueuedNum;
+		unsigned int InFlightNum;
+	};
+
+	IoService();
+	IoService(const IoService&) = delete;
+	IoService(IoService&&) = delete;
+	IoService& operator=(const IoService&) = delete;
+	IoService& operator=(IoService&&) = delete;
+	// Cancels what is left and waits for every completion.
+	~IoService();
+
+	[[nodiscard]] static IoService& Get() noexcept;
+
+	// The signal counts the read with its completion as one job, and reports what the completion throws.
+	RequestId Read(const std::filesystem::path& InPath, IoPriority InPriority, Completion InCompletion, JobCounter* InSignal = nullptr);
+	// Queued requests never start and reads in flight are aborted where they still can be, either completes as Cancelled.
+	// Requests that already finished are left alone.
+	void Cancel(RequestId InRequest);
+
+	[[nodiscard]] Activity GetActivity();
+
+private:
+	struct Request;
+
+	// Enough to keep the disk busy, few enough that a new Visible request is next in line.
+	static constexpr unsigned int MaxInFlightNum {4u};
+	// Preallocated at startup, most textures and materials fit without growing them.
+	static constexpr size_t PooledBufferNum {MaxInFlightNum};
+	static constexpr size_t PooledBufferBytes {4u * 1024u * 1024u};
+	// Buffers grown past this by a large file go back to the heap instead of the pool.
+	static constexpr size_t MaxPooledBytes {64u * 1024u * 1024u};
+
+	void ThreadLoop();
+	void Start(Request& InRequest);
+	void Finish(std::unique_ptr<Request> InRequest, IoStatus InStatus);
+	// With the mutex held, empty when the pool is.
+	std::vector<std::byte> AcquireBuffer();
+	void ReleaseBuffer(std::vector<std::byte>&& InBuffer);
+
+private:
+	static inline IoService* Instance {nullptr};
+
+	// Win32 handle of the completion port, so includers don't need the file APIs the lean Windows headers leave out.
+	void* Port {nullptr};
+
+	std::mutex Mutex;
+	std::unordered_map<RequestId, std::unique_ptr<Request>> Requests;
+	std::array<std::deque<Request*>, IoPriorityNum> Queues;
+	std::vector<std::vector<std::byte>> FreeBuffers;
+	RequestId NextRequest {1u};
+	unsigned int InFlightNum {0u};
+	bool bIsStopping {false};
+	std::atomic<unsigned long long> FinishedNum {0u};
+	std::atomic<unsigned long long> FinishedBytes {0u};
+
+	JobCounter Completions;
+	// Started last, once everything it uses exists.
+	std::thread Thread;
+};
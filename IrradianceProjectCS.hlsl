@@ -0,0 +1,106 @@
+// Projects the cubes IrradianceVolume drew this frame onto first order spherical harmonics, one group per probe and one
+// thread per texel position of its faces, summed over all six and then across the group. Texels the geometry left at the
+// far plane see the sky, the environment when there is one and the lights' ambient colour otherwise.
+#include "ImageBasedLighting.hlsli"
+
+Texture2DArray<float4> Faces : register(t0);
+Texture2DArray<float> FaceDepths : register(t1);
+RWTexture3D<float4> OutputRed : register(u0);
+RWTexture3D<float4> OutputGreen : register(u1);
+RWTexture3D<float4> OutputBlue : register(u2);
+
+// Laid out like IrradianceVolume::ProjectConstants.
+cbuffer Project : register(b0)
+{
+    // The volume texel of each probe, in the order of the cubes in Faces.
+    uint4 ProbeCells[8];
+    float3 SkyColor;
+    float ProjectPadding;
+}
+
+// IrradianceVolume::FaceSize and FaceNum.
+#define FACE_SIZE 16
+#define FACE_NUM 6
+#define THREAD_NUM (FACE_SIZE * FACE_SIZE)
+
+static const float Pi = 3.14159265359f;
+
+groupshared float4 SharedRed[THREAD_NUM];
+groupshared float4 SharedGreen[THREAD_NUM];
+groupshared float4 SharedBlue[THREAD_NUM];
+groupshared float SharedWeight[THREAD_NUM];
+
+// D3D's cube face order, +X, -X, +Y, -Y, +Z, -Z, with InCoordinate from -1 to 1 across the face, Y down.
+float3 GetFaceDirection(const uint InFace, const float2 InCoordinate)
+{
+    switch (InFace)
+    {
+    case 0u: return float3(1.0f, -InCoordinate.y, -InCoordinate.x);
+    case 1u: return float3(-1.0f, -InCoordinate.y, InCoordinate.x);
+    case 2u: return float3(InCoordinate.x, 1.0f, InCoordinate.y);
+    case 3u: return float3(InCoordinate.x, -1.0f, -InCoordinate.y);
+    case 4u: return float3(InCoordinate.x, -InCoordinate.y, 1.0f);
+    default: return float3(-InCoordinate.x, -InCoordinate.y, -1.0f);
+    }
+}
+
+[numthreads(FACE_SIZE, FACE_SIZE, 1)]
+void main(const uint3 InGroupID : SV_GroupID, const uint3 InThreadID : SV_GroupThreadID, const uint InThreadIndex : SV_GroupIndex)
+{
+    const float2 Coordinate = (InThreadID.xy + 0.5f) / FACE_SIZE * 2.0f - 1.0f;
+    // Texels toward a face's edges cover less of the sphere, the constant factor cancels in the normalization.
+    const float Weight = 1.0f / pow(1.0f + dot(Coordinate, Coordinate), 1.5f);
+
+    float4 Red = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 Green = float4(0.0f, 0.0f, 0.0f, 0.0f);
+    float4 Blue = float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    for (uint Face = 0u; Face < FACE_NUM; ++Face)
+    {
+        const uint3 Texel = uint3(InThreadID.xy, InGroupID.x * FACE_NUM + Face);
+        const float3 Direction = normalize(GetFaceDirection(Face, Coordinate));
+
+        float3 Radiance = Faces[Texel].rgb;
+
+        if (FaceDepths[Texel] >= 1.0f)
+        {
+            Radiance = bHasEnvironment ? SpecularEnvironment.SampleLevel(EnvironmentSampler, Direction, 0.0f) * EnvironmentIntensity : SkyColor;
+        }
+
+        const float4 Basis = float4(0.282095f, 0.488603f * Direction.y, 0.488603f * Direction.z, 0.488603f * Direction.x) * Weight;
+        Red += Radiance.r * Basis;
+        Green += Radiance.g * Basis;
+        Blue += Radiance.b * Basis;
+    }
+
+    SharedRed[InThreadIndex] = Red;
+    SharedGreen[InThreadIndex] = Green;
+    SharedBlue[InThreadIndex] = Blue;
+    SharedWeight[InThreadIndex] = Weight * FACE_NUM;
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint Stride = THREAD_NUM / 2u; Stride > 0u; Stride >>= 1u)
+    {
+        if (InThreadIndex < Stride)
+        {
+            SharedRed[InThreadIndex] += SharedRed[InThreadIndex + Stride];
+            SharedGreen[InThreadIndex] += SharedGreen[InThreadIndex + Stride];
+            SharedBlue[InThreadIndex] += SharedBlue[InThreadIndex + Stride];
+            SharedWeight[InThreadIndex] += SharedWeight[InThreadIndex + Stride];
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (InThreadIndex == 0u)
+    {
+        // The weights sum to the whole sphere, and each band is convolved with the cosine lobe, pi and 2 pi / 3, then
+        // divided by pi like ImageBasedLighting's coefficients.
+        const float4 Scale = 4.0f * Pi / SharedWeight[0] * float4(1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f);
+        const uint3 Cell = ProbeCells[InGroupID.x].xyz;
+
+        OutputRed[Cell] = SharedRed[0] * Scale;
+        OutputGreen[Cell] = SharedGreen[0] * Scale;
+        OutputBlue[Cell] = SharedBlue[0] * Scale;
+    }
+}
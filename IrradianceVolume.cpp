@@ -0,0 +1,490 @@
+﻿#include "IrradianceVolume.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "AmbientOcclusion.h"
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	// Left handed cube face order and orientation, +X -X +Y -Y +Z -Z, the same as the reflection probes'.
+	constexpr DirectX::XMVECTORF32 FaceDirections[] =
+	{
+		{{{1.0f, 0.0f, 0.0f, 0.0f}}},
+		{{{-1.0f, 0.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, -1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 0.0f, 1.0f, 0.0f}}},
+		{{{0.0f, 0.0f, -1.0f, 0.0f}}}
+	};
+
+	constexpr DirectX::XMVECTORF32 FaceUps[] =
+	{
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 0.0f, -1.0f, 0.0f}}},
+		{{{0.0f, 0.0f, 1.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}}
+	};
+
+	// The cells along one axis whose probes lie within InReach of the range, empty when InLast ends up below InFirst.
+	void GetCellRange(const float InMin, const float InMax, const float InReach, const float InBoundsMin, const float InCellSize, const UINT InCellNum,
+	                  int& OutFirst, int& OutLast) noexcept
+	{
+		// Probe I sits at the centre of its cell, InBoundsMin plus I and a half cells.
+		OutFirst = std::max(static_cast<int>(std::ceil((InMin - InReach - InBoundsMin) / InCellSize - 0.5f)), 0);
+		OutLast = std::min(static_cast<int>(std::floor((InMax + InReach - InBoundsMin) / InCellSize - 0.5f)), static_cast<int>(InCellNum) - 1);
+	}
+}
+
+IrradianceVolume::IrradianceVolume(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+	: Device(InDevice)
+{
+	static_assert(FaceSize <= AmbientOcclusion::UnoccludedSize, "Faces are drawn without occlusion");
+
+	HRESULT ResultHandle;
+
+	const auto Blob = InShaderBundle.Load("IrradianceProjectCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &ProjectShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(VolumeConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	ConstantBufferDesc.ByteWidth = sizeof(ProjectConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ProjectConstantBuffer))
+
+	const VolumeConstants CaptureConstants {};
+	const D3D11_SUBRESOURCE_DATA CaptureData {&CaptureConstants, 0u, 0u};
+
+	ConstantBufferDesc.ByteWidth = sizeof(VolumeConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ConstantBufferDesc.CPUAccessFlags = 0u;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, &CaptureData, &CaptureConstantBuffer))
+
+	D3D11_TEXTURE2D_DESC FacesDesc {};
+	FacesDesc.Width = FaceSize;
+	FacesDesc.Height = FaceSize;
+	FacesDesc.MipLevels = 1u;
+	FacesDesc.ArraySize = ProbesPerFrame * FaceNum;
+	FacesDesc.Format = Format;
+	FacesDesc.SampleDesc.Count = 1u;
+	FacesDesc.Usage = D3D11_USAGE_DEFAULT;
+	FacesDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Faces;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&FacesDesc, nullptr, &Faces))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Faces.Get(), nullptr, &FacesView))
+
+	// Read back as floats by the projection, which takes the texels left at the far plane for sky.
+	D3D11_TEXTURE2D_DESC DepthDesc = FacesDesc;
+	DepthDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	DepthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Depths;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&DepthDesc, nullptr, &Depths))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC DepthViewDesc {};
+	DepthViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	DepthViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	DepthViewDesc.Texture2DArray.MipLevels = 1u;
+	DepthViewDesc.Texture2DArray.ArraySize = ProbesPerFrame * FaceNum;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Depths.Get(), &DepthViewDesc, &FaceDepthsView))
+
+	for (UINT Slice = 0u; Slice < ProbesPerFrame * FaceNum; ++Slice)
+	{
+		D3D11_RENDER_TARGET_VIEW_DESC FaceViewDesc {};
+		FaceViewDesc.Format = Format;
+		FaceViewDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+		FaceViewDesc.Texture2DArray.FirstArraySlice = Slice;
+		FaceViewDesc.Texture2DArray.ArraySize = 1u;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(Faces.Get(), &FaceViewDesc, &FaceViews[Slice]))
+
+		D3D11_DEPTH_STENCIL_VIEW_DESC FaceDepthViewDesc {};
+		FaceDepthViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		FaceDepthViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		FaceDepthViewDesc.Texture2DArray.FirstArraySlice = Slice;
+		FaceDepthViewDesc.Texture2DArray.ArraySize = 1u;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilView(Depths.Get(), &FaceDepthViewDesc, &FaceDepthViews[Slice]))
+	}
+
+	DirectX::XMStoreFloat4x4(&Projection, DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 1.0f, NearZ, FarZ));
+}
+
+void IrradianceVolume::BeginFrame(const Graphics& InGraphics)
+{
+	Captures.clear();
+	CaptureProbes.clear();
+
+	const auto ProbeNum = GetProbeNum();
+
+	for (unsigned int Step = 0u; Step < ProbeNum && StaleProbeNum > 0u && CaptureProbes.size() < ProbesPerFrame; ++Step)
+	{
+		if (const auto Probe = (NextProbe + Step) % ProbeNum; Probes[Probe] & StaleFlag)
+		{
+			CaptureProbes.push_back(Probe);
+		}
+	}
+
+	// The rest of the frame's probes continue the round-robin.
+	for (unsigned int Step = 0u; bIsContinuousUpdateEnabled && Step < ProbeNum && CaptureProbes.size() < ProbesPerFrame; ++Step)
+	{
+		if (const auto Probe = (NextProbe + Step) % ProbeNum; std::find(CaptureProbes.begin(), CaptureProbes.end(), Probe) == CaptureProbes.end())
+		{
+			CaptureProbes.push_back(Probe);
+		}
+	}
+
+	// Cleared now, so whatever moves before the probes are drawn marks them stale again for a later frame.
+	for (size_t Index = 0u; Index < CaptureProbes.size(); ++Index)
+	{
+		auto& Captured = Probes[CaptureProbes[Index]];
+		StaleProbeNum -= Captured & StaleFlag;
+		Captured &= static_cast<uint8_t>(~StaleFlag);
+
+		const auto Position = GetProbePosition(CaptureProbes[Index]);
+		const DirectX::BoundingSphere Reach(Position, FarZ);
+
+		if (Index == 0u)
+		{
+			CaptureSphere = Reach;
+		}
+		else
+		{
+			DirectX::BoundingSphere::CreateMerged(CaptureSphere, CaptureSphere, Reach);
+		}
+	}
+
+	if (!CaptureProbes.empty())
+	{
+		NextProbe = (CaptureProbes.back() + 1u) % ProbeNum;
+	}
+
+	if (bIsConstantBufferStale)
+	{
+		UploadConstants(InGraphics);
+	}
+}
+
+void IrradianceVolume::Place(const DirectX::BoundingBox& InBounds, const float InSpacing)
+{
+	assert(InSpacing > 0.0f && InBounds.Extents.x > 0.0f && InBounds.Extents.y > 0.0f && InBounds.Extents.z > 0.0f && "Probes need a box to fill");
+
+	const auto GetCellNumAlong = [InSpacing](const float InExtent)
+	{
+		return std::clamp(static_cast<UINT>(std::ceil(2.0f * InExtent / InSpacing)), 1u, MaxCellNum);
+	};
+
+	Bounds = InBounds;
+	CellNum = {GetCellNumAlong(InBounds.Extents.x), GetCellNumAlong(InBounds.Extents.y), GetCellNumAlong(InBounds.Extents.z)};
+	CellSize = {2.0f * InBounds.Extents.x / static_cast<float>(CellNum.x), 2.0f * InBounds.Extents.y / static_cast<float>(CellNum.y),
+	            2.0f * InBounds.Extents.z / static_cast<float>(CellNum.z)};
+
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE3D_DESC VolumeDesc {};
+	VolumeDesc.Width = CellNum.x;
+	VolumeDesc.Height = CellNum.y;
+	VolumeDesc.Depth = CellNum.z;
+	VolumeDesc.MipLevels = 1u;
+	VolumeDesc.Format = Format;
+	VolumeDesc.Usage = D3D11_USAGE_DEFAULT;
+	VolumeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	for (UINT Channel = 0u; Channel < ChannelNum; ++Channel)
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture3D> Volume;
+		CHECK_HRESULT_EXCEPTION(Device->CreateTexture3D(&VolumeDesc, nullptr, &Volume))
+		CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(Volume.Get(), nullptr, &VolumeViews[Channel]))
+		CHECK_HRESULT_EXCEPTION(Device->CreateUnorderedAccessView(Volume.Get(), nullptr, &VolumeUavs[Channel]))
+	}
+
+	Probes.assign(static_cast<size_t>(CellNum.x) * CellNum.y * CellNum.z, StaleFlag);
+	StaleProbeNum = GetProbeNum();
+	DrawnProbeNum = 0u;
+	NextProbe = 0u;
+	bIsConstantBufferStale = true;
+}
+
+void IrradianceVolume::Clear() noexcept
+{
+	Probes.clear();
+	CaptureProbes.clear();
+	Captures.clear();
+	VolumeViews = {};
+	VolumeUavs = {};
+	CellNum = {0u, 0u, 0u};
+	StaleProbeNum = 0u;
+	DrawnProbeNum = 0u;
+	NextProbe = 0u;
+	bIsConstantBufferStale = true;
+}
+
+void IrradianceVolume::Invalidate() noexcept
+{
+	for (auto& Probe : Probes)
+	{
+		Probe |= StaleFlag;
+	}
+
+	StaleProbeNum = GetProbeNum();
+}
+
+void IrradianceVolume::AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept
+{
+	if (Probes.empty() || StaleProbeNum == Probes.size())
+	{
+		return;
+	}
+
+	const float Min[] = {InBounds.Center.x - InBounds.Extents.x, InBounds.Center.y - InBounds.Extents.y, InBounds.Center.z - InBounds.Extents.z};
+	const float Max[] = {InBounds.Center.x + InBounds.Extents.x, InBounds.Center.y + InBounds.Extents.y, InBounds.Center.z + InBounds.Extents.z};
+	const float BoundsMin[] = {Bounds.Center.x - Bounds.Extents.x, Bounds.Center.y - Bounds.Extents.y, Bounds.Center.z - Bounds.Extents.z};
+	const float Sizes[] = {CellSize.x, CellSize.y, CellSize.z};
+	const UINT Nums[] = {CellNum.x, CellNum.y, CellNum.z};
+
+	// Every probe whose cube reaches the box, which also covers those it would reach by a corner.
+	int First[3];
+	int Last[3];
+
+	for (int Axis = 0; Axis < 3; ++Axis)
+	{
+		GetCellRange(Min[Axis], Max[Axis], FarZ, BoundsMin[Axis], Sizes[Axis], Nums[Axis], First[Axis], Last[Axis]);
+
+		if (Last[Axis] < First[Axis])
+		{
+			return;
+		}
+	}
+
+	for (int Z = First[2]; Z <= Last[2]; ++Z)
+	{
+		for (int Y = First[1]; Y <= Last[1]; ++Y)
+		{
+			for (int X = First[0]; X <= Last[0]; ++X)
+			{
+				auto& Moved = Probes[(static_cast<size_t>(Z) * CellNum.y + Y) * CellNum.x + X];
+				StaleProbeNum += (~Moved & StaleFlag) != 0u;
+				Moved |= StaleFlag;
+			}
+		}
+	}
+}
+
+const DirectX::BoundingSphere* IrradianceVolume::GetCaptureSphere() const noexcept
+{
+	return !CaptureProbes.empty() ? &CaptureSphere : nullptr;
+}
+
+void IrradianceVolume::AddCapture(const Drawable& InDrawable)
+{
+	assert(!CaptureProbes.empty() && "Capture added on a frame no probe is drawn");
+
+	// A cube has no transparency targets to accumulate into, the probes only see what is opaque.
+	if (InDrawable.IsOrderIndependent())
+	{
+		return;
+	}
+
+	// Drawables may not be submitted to the queue this frame, culled from the camera but not from the probes.
+	InDrawable.Prepare();
+
+	Captures.push_back(&InDrawable);
+}
+
+void IrradianceVolume::Render(const Graphics& InGraphics)
+{
+	RenderedDrawableNum = 0u;
+
+	if (CaptureProbes.empty())
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Irradiance probes");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	// Shaded like the reflection probes' faces, and with the volume itself unbound, its textures are written below.
+	InGraphics.BindDepthTest(Context, DepthTest::Less);
+	InGraphics.GetClusteredLighting().BindUnclustered(Context);
+	InGraphics.GetPointLightShadows().Bind(Context);
+	InGraphics.GetDirectionalLight().Bind(Context);
+	InGraphics.GetAmbientOcclusion().BindUnoccluded(Context);
+	InGraphics.GetImageBasedLighting().Bind(Context);
+	InGraphics.GetReflectionProbes().Bind(Context);
+	Cache.SetPixelConstantBuffer(ConstantSlot, CaptureConstantBuffer.Get());
+
+	for (UINT Channel = 0u; Channel < ChannelNum; ++Channel)
+	{
+		Cache.SetPixelShaderResource(VolumeSlot + Channel, nullptr);
+	}
+
+	const D3D11_VIEWPORT FaceViewport {0.0f, 0.0f, static_cast<float>(FaceSize), static_cast<float>(FaceSize), 0.0f, 1.0f};
+	DeviceContext->RSSetViewports(1u, &FaceViewport);
+
+	const auto& Lighting = InGraphics.GetClusteredLighting();
+	const auto FaceProjection = DirectX::XMLoadFloat4x4(&Projection);
+	const DirectX::BoundingFrustum ViewFrustum(FaceProjection);
+
+	std::vector<DirectX::BoundingBox> CaptureBounds(Captures.size());
+
+	for (size_t Index = 0u; Index < Captures.size(); ++Index)
+	{
+		if (const auto* const LocalBounds = Captures[Index]->GetLocalBounds())
+		{
+			LocalBounds->Transform(CaptureBounds[Index], Captures[Index]->GetTransformMatrix());
+		}
+	}
+
+	ProjectConstants Constants {};
+	Constants.SkyColor = Lighting.GetAmbientColor();
+
+	for (UINT CaptureIndex = 0u; CaptureIndex < CaptureProbes.size(); ++CaptureIndex)
+	{
+		const auto Probe = CaptureProbes[CaptureIndex];
+		const auto Position = GetProbePosition(Probe);
+		const auto Eye = DirectX::XMLoadFloat3(&Position);
+		const DirectX::BoundingSphere Reach(Position, FarZ);
+
+		Constants.Cells[CaptureIndex] = {Probe % CellNum.x, Probe / CellNum.x % CellNum.y, Probe / (CellNum.x * CellNum.y), 0u};
+
+		for (UINT Face = 0u; Face < FaceNum; ++Face)
+		{
+			const auto View = DirectX::XMMatrixLookToLH(Eye, FaceDirections[Face], FaceUps[Face]);
+			DirectX::BoundingFrustum FaceFrustum;
+			ViewFrustum.Transform(FaceFrustum, DirectX::XMMatrixInverse(nullptr, View));
+
+			// Black behind the geometry like the reflection probes, the projection puts the sky there by depth.
+			const auto Slice = CaptureIndex * FaceNum + Face;
+			constexpr float ClearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
+			Cache.SetRenderTarget(FaceViews[Slice].Get(), FaceDepthViews[Slice].Get());
+			DeviceContext->ClearRenderTargetView(FaceViews[Slice].Get(), ClearColor);
+			DeviceContext->ClearDepthStencilView(FaceDepthViews[Slice].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+			InGraphics.OverrideViewConstants(Context, View, FaceProjection, Position);
+
+			for (size_t Index = 0u; Index < Captures.size(); ++Index)
+			{
+				const auto bHasBounds = Captures[Index]->GetLocalBounds() != nullptr;
+
+				// The capture sphere is around all of the frame's probes, each face only draws what reaches into it.
+				if (bHasBounds && (!Reach.Intersects(CaptureBounds[Index]) || !FaceFrustum.Intersects(CaptureBounds[Index])))
+				{
+					continue;
+				}
+
+				Lighting.BindObjectLights(Context, bHasBounds ? &CaptureBounds[Index] : nullptr);
+				Captures[Index]->Draw(Context, DrawStage::Shaded);
+				RenderedDrawableNum += Face == 0u;
+			}
+		}
+	}
+
+	InGraphics.RestoreViewConstants(Context);
+	InGraphics.BindFrameState(Context);
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ProjectConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ProjectConstantBuffer.Get(), 0u);
+	Cache.CountUpload(sizeof(Constants));
+
+	// The volume may still be bound for the deferred lighting of the last frame, and the faces are targets again next frame.
+	ID3D11ShaderResourceView* const NullViews[ChannelNum] {};
+	ID3D11UnorderedAccessView* const NullUavs[ChannelNum] {};
+	ID3D11ShaderResourceView* const FaceInputs[] = {FacesView.Get(), FaceDepthsView.Get()};
+	ID3D11UnorderedAccessView* const Outputs[] = {VolumeUavs[0].Get(), VolumeUavs[1].Get(), VolumeUavs[2].Get()};
+	static_assert(FaceDepthSlot == FaceSlot + 1u, "Faces are bound as one range");
+
+	DeviceContext->CSSetShaderResources(VolumeSlot, ChannelNum, NullViews);
+	DeviceContext->CSSetShader(ProjectShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ProjectConstantSlot, 1u, ProjectConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(FaceSlot, static_cast<UINT>(std::size(FaceInputs)), FaceInputs);
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, ChannelNum, Outputs, nullptr);
+	InGraphics.GetImageBasedLighting().BindCompute(DeviceContext);
+
+	InGraphics.Dispatch(static_cast<UINT>(CaptureProbes.size()));
+
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, ChannelNum, NullUavs, nullptr);
+	DeviceContext->CSSetShaderResources(FaceSlot, static_cast<UINT>(std::size(FaceInputs)), NullViews);
+
+	// Surfaces only see the volume once every probe holds the scene.
+	const auto bWasReady = IsReady();
+
+	for (const auto Probe : CaptureProbes)
+	{
+		DrawnProbeNum += (~Probes[Probe] & DrawnFlag) != 0u;
+		Probes[Probe] |= DrawnFlag;
+	}
+
+	bIsConstantBufferStale |= !bWasReady && IsReady();
+}
+
+void IrradianceVolume::Bind(RenderContext& InContext) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+
+	for (UINT Channel = 0u; Channel < ChannelNum; ++Channel)
+	{
+		Cache.SetPixelShaderResource(VolumeSlot + Channel, VolumeViews[Channel].Get());
+	}
+}
+
+void IrradianceVolume::BindCompute(ID3D11DeviceContext* InContext) const noexcept
+{
+	ID3D11ShaderResourceView* const Views[] = {VolumeViews[0].Get(), VolumeViews[1].Get(), VolumeViews[2].Get()};
+
+	InContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	InContext->CSSetShaderResources(VolumeSlot, ChannelNum, Views);
+}
+
+void IrradianceVolume::UploadConstants(const Graphics& InGraphics)
+{
+	VolumeConstants Constants {};
+	Constants.bIsReady = IsReady() ? 1u : 0u;
+
+	if (IsPlaced())
+	{
+		Constants.BoundsMin = {Bounds.Center.x - Bounds.Extents.x, Bounds.Center.y - Bounds.Extents.y, Bounds.Center.z - Bounds.Extents.z};
+		Constants.InverseSize = {0.5f / Bounds.Extents.x, 0.5f / Bounds.Extents.y, 0.5f / Bounds.Extents.z};
+		Constants.FadeDistance = {0.5f * CellSize.x, 0.5f * CellSize.y, 0.5f * CellSize.z};
+	}
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	bIsConstantBufferStale = false;
+}
+
+DirectX::XMFLOAT3 IrradianceVolume::GetProbePosition(const unsigned int InProbe) const noexcept
+{
+	const auto X = static_cast<float>(InProbe % CellNum.x) + 0.5f;
+	const auto Y = static_cast<float>(InProbe / CellNum.x % CellNum.y) + 0.5f;
+	const auto Z = static_cast<float>(InProbe / (CellNum.x * CellNum.y)) + 0.5f;
+
+	return {Bounds.Center.x - Bounds.Extents.x + X * CellSize.x, Bounds.Center.y - Bounds.Extents.y + Y * CellSize.y,
+	        Bounds.Center.z - Bounds.Extents.z + Z * CellSize.z};
+}
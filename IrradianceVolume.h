@@ -0,0 +1,182 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <cstdint>
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include "wrl/client.h"
+
+class Drawable;
+class Graphics;
+class RenderContext;
+class ShaderBundle;
+
+/**
+ * Indirect diffuse light for whatever has no lightmap, from a grid of probes placed over a box of the world. A few probes
+ * a frame draw the scene into small cubes through the drawables' regular shaded path, and a compute pass projects each cube
+ * onto first order spherical harmonics, written to the probe's texel of three volume textures, one per colour channel.
+ * Surfaces inside the box sample them trilinearly in place of the flat ambient colour or the environment's irradiance.
+ * Probes whose reach moved bounds fall into go first, otherwise they are refreshed round-robin so lighting changes show up too.
+ * Directions that see no geometry see the environment, or the lights' ambient colour without one.
+ */
+class IrradianceVolume
+{
+public:
+	// Probes along each side of the box at most.
+	static constexpr UINT MaxCellNum {16u};
+	static constexpr UINT ProbesPerFrame {8u};
+	static constexpr UINT FaceNum {6u};
+	static constexpr UINT FaceSize {16u};
+	static constexpr DXGI_FORMAT Format {DXGI_FORMAT_R16G16B16A16_FLOAT};
+	static constexpr float NearZ {0.1f};
+	// Geometry farther from a probe is left out of its cube.
+	static constexpr float FarZ {30.0f};
+
+	IrradianceVolume(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	IrradianceVolume(const IrradianceVolume&) = delete;
+	IrradianceVolume(IrradianceVolume&&) = delete;
+	IrradianceVolume& operator=(const IrradianceVolume&) = delete;
+	IrradianceVolume& operator=(IrradianceVolume&&) = delete;
+	~IrradianceVolume() = default;
+
+	// Picks the probes drawn this frame and writes the constants when the volume changed, before the frame's first bind.
+	void BeginFrame(const Graphics& InGraphics);
+
+	// Fills the box with probes InSpacing apart, fewer when that would take more than MaxCellNum along a side. Surfaces
+	// keep the ambient light they had until every probe is drawn.
+	void Place(const DirectX::BoundingBox& InBounds, float InSpacing);
+	void Clear() noexcept;
+	// Draws every probe again ahead of the round-robin, such as after the lights changed.
+	void Invalidate() noexcept;
+	// World space region whose drawables changed since last frame, covering both where they were and where they are.
+	void AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept;
+
+	// Around every probe drawn this frame, null when none is due.
+	[[nodiscard]] const DirectX::BoundingSphere* GetCaptureSphere() const noexcept;
+	// The drawable is drawn into the cubes of this frame's probes whose faces it falls into, it should touch the capture sphere.
+	void AddCapture(const Drawable& InDrawable);
+
+	// Draws and projects this frame's probes once the lights are culled, before anything samples the volume.
+	void Render(const Graphics& InGraphics);
+	void Bind(RenderContext& InContext) const noexcept;
+	// The same slots for compute shaders that shade, straight to the context like every compute binding.
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+
+	// Off only draws probes that moved bounds reach, a static scene then costs nothing.
+	void EnableContinuousUpdate() noexcept
+	{
+		bIsContinuousUpdateEnabled = true;
+	}
+
+	void DisableContinuousUpdate() noexcept
+	{
+		bIsContinuousUpdateEnabled = false;
+	}
+
+	[[nodiscard]] bool IsContinuousUpdateEnabled() const noexcept
+	{
+		return bIsContinuousUpdateEnabled;
+	}
+
+	[[nodiscard]] bool IsPlaced() const noexcept
+	{
+		return !Probes.empty();
+	}
+
+	[[nodiscard]] const DirectX::XMUINT3& GetCellNum() const noexcept
+	{
+		return CellNum;
+	}
+
+	[[nodiscard]] unsigned int GetProbeNum() const noexcept
+	{
+		return static_cast<unsigned int>(Probes.size());
+	}
+
+	// Probes still waiting to be drawn again.
+	[[nodiscard]] unsigned int GetStaleProbeNum() const noexcept
+	{
+		return StaleProbeNum;
+	}
+
+	// True once every probe was drawn and surfaces sample the volume.
+	[[nodiscard]] bool IsReady() const noexcept
+	{
+		return !Probes.empty() && DrawnProbeNum == Probes.size();
+	}
+
+	// Drawables drawn into the cubes by the last Render, counted once per probe.
+	[[nodiscard]] unsigned int GetRenderedDrawableNum() const noexcept
+	{
+		return RenderedDrawableNum;
+	}
+
+private:
+	static constexpr uint8_t StaleFlag {1u << 0u};
+	static constexpr uint8_t DrawnFlag {1u << 1u};
+	// Registers in IrradianceVolume.hlsli, after the material table's.
+	static constexpr UINT ConstantSlot {9u};
+	static constexpr UINT VolumeSlot {16u};
+	static constexpr UINT ChannelNum {3u};
+	// Registers in IrradianceProjectCS.hlsl.
+	static constexpr UINT ProjectConstantSlot {0u};
+	static constexpr UINT FaceSlot {0u};
+	static constexpr UINT FaceDepthSlot {1u};
+	static constexpr UINT OutputSlot {0u};
+
+	// Laid out like the IrradianceVolume cbuffer.
+	struct VolumeConstants
+	{
+		DirectX::XMFLOAT3 BoundsMin;
+		UINT bIsReady;
+		// One over the size of the box, mapping it onto the volume textures.
+		DirectX::XMFLOAT3 InverseSize;
+		float Padding0;
+		// Half a cell, over which the volume fades into the ambient light outside it.
+		DirectX::XMFLOAT3 FadeDistance;
+		float Padding1;
+	};
+
+	// Laid out like the Project cbuffer.
+	struct ProjectConstants
+	{
+		std::array<DirectX::XMUINT4, ProbesPerFrame> Cells;
+		DirectX::XMFLOAT3 SkyColor;
+		float Padding;
+	};
+
+	void UploadConstants(const Graphics& InGraphics);
+	[[nodiscard]] DirectX::XMFLOAT3 GetProbePosition(unsigned int InProbe) const noexcept;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> Device;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> ProjectShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	// Not ready, bound while the cubes are drawn so nothing samples the volume being written.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CaptureConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ProjectConstantBuffer;
+	// The volume textures, made by Place for its grid.
+	std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, ChannelNum> VolumeViews;
+	std::array<Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>, ChannelNum> VolumeUavs;
+	// One cube per probe drawn in a frame, the colour faces and their depth, read by the projection.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> FacesView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> FaceDepthsView;
+	std::array<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>, ProbesPerFrame * FaceNum> FaceViews;
+	std::array<Microsoft::WRL::ComPtr<ID3D11DepthStencilView>, ProbesPerFrame * FaceNum> FaceDepthViews;
+
+	DirectX::BoundingBox Bounds;
+	DirectX::XMUINT3 CellNum {0u, 0u, 0u};
+	DirectX::XMFLOAT3 CellSize {0.0f, 0.0f, 0.0f};
+	// StaleFlag and DrawnFlag per probe, X fastest, then Y, then Z.
+	std::vector<uint8_t> Probes;
+	DirectX::XMFLOAT4X4 Projection {};
+	std::vector<unsigned int> CaptureProbes;
+	DirectX::BoundingSphere CaptureSphere;
+	std::vector<const Drawable*> Captures;
+	unsigned int NextProbe {0u};
+	unsigned int StaleProbeNum {0u};
+	unsigned int DrawnProbeNum {0u};
+	unsigned int RenderedDrawableNum {0u};
+	bool bIsContinuousUpdateEnabled {true};
+	bool bIsConstantBufferStale {true};
+};
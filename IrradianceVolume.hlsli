@@ -0,0 +1,37 @@
+// Indirect diffuse light from IrradianceVolume's probes, laid out like IrradianceVolume::VolumeConstants.
+// Sampled with the environment's sampler, so ImageBasedLighting.hlsli comes first.
+cbuffer IrradianceVolume : register(b9)
+{
+    float3 VolumeMin;
+    uint bIsVolumeReady;
+    float3 VolumeInverseSize;
+    float VolumePadding0;
+    float3 VolumeFadeDistance;
+    float VolumePadding1;
+}
+
+// First order spherical harmonics of the irradiance over pi, one texture per colour channel, the coefficients in the
+// order of ImageBasedLighting's first four. Each texel is the probe at its centre, so sampling interpolates between them.
+Texture3D<float4> VolumeRed : register(t16);
+Texture3D<float4> VolumeGreen : register(t17);
+Texture3D<float4> VolumeBlue : register(t18);
+
+// The volume's irradiance at InWorldPosition in place of InFallback, which it fades into over the outer half cell of its box.
+float3 CalcVolumeIrradiance(const float3 InWorldPosition, const float3 InNormal, const float3 InFallback)
+{
+    const float3 Coordinate = (InWorldPosition - VolumeMin) * VolumeInverseSize;
+
+    if (!bIsVolumeReady || any(Coordinate < 0.0f) || any(Coordinate > 1.0f))
+    {
+        return InFallback;
+    }
+
+    const float4 Basis = float4(0.282095f, 0.488603f * InNormal.y, 0.488603f * InNormal.z, 0.488603f * InNormal.x);
+    const float3 Irradiance = float3(dot(VolumeRed.SampleLevel(EnvironmentSampler, Coordinate, 0.0f), Basis),
+                                     dot(VolumeGreen.SampleLevel(EnvironmentSampler, Coordinate, 0.0f), Basis),
+                                     dot(VolumeBlue.SampleLevel(EnvironmentSampler, Coordinate, 0.0f), Basis));
+
+    const float3 DistanceInside = min(Coordinate, 1.0f - Coordinate) / VolumeInverseSize;
+    const float3 Fade = saturate(DistanceInside / VolumeFadeDistance);
+    return lerp(InFallback, max(Irradiance, 0.0f), min(Fade.x, min(Fade.y, Fade.z)));
+}
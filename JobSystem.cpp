@@ -0,0 +1,381 @@
+﻿#include "JobSystem.h"
+#include "EngineWin.h"
+#include <cassert>
+#include "CpuTopology.h"
+#include "FrameProfiler.h"
+#include "Logger.h"
+#include "StartupTimeline.h"
+
+namespace
+{
+	// Queue owned by the current thread, threads outside the pool share the last queue.
+	thread_local unsigned int ThreadQueueIndex {~0u};
+	thread_local JobLane ThreadLane {JobLane::Frame};
+
+	// Lets the system run the thread at the efficient clocks the cores it is on allow, at the cost of latency.
+	void ThrottlePower() noexcept
+	{
+		THREAD_POWER_THROTTLING_STATE State {};
+		State.Version = THREAD_POWER_THROTTLING_CURRENT_VERSION;
+		State.ControlMask = THREAD_POWER_THROTTLING_EXECUTION_SPEED;
+		State.StateMask = THREAD_POWER_THROTTLING_EXECUTION_SPEED;
+		SetThreadInformation(GetCurrentThread(), ThreadPowerThrottling, &State, sizeof(State));
+	}
+}
+
+JobSystem::JobSystem(const unsigned int InWorkerNum)
+{
+	STARTUP_PHASE("Job system");
+	assert(!Instance && "Only one JobSystem may exist");
+	Instance = this;
+
+	const auto& Topology = CpuTopology::Get();
+	const auto HardwareThreadNum = Topology.IsHybrid() ? Topology.Performance.ThreadNum : std::thread::hardware_concurrency();
+	const auto WorkerNum = InWorkerNum ? InWorkerNum : std::max(HardwareThreadNum, 2u) - 1u;
+	const auto BackgroundWorkerNum = Topology.IsHybrid() ? Topology.Efficiency.ThreadNum : WorkerNum;
+
+	// The main thread records and submits the frames.
+	JoinLane(JobLane::Frame);
+
+	for (unsigned int Index = 0u; Index <= WorkerNum; ++Index)
+	{
+		Queues.push_back(std::make_unique<TaskQueue>());
+	}
+
+	Workers.reserve(WorkerNum);
+	for (unsigned int Index = 0u; Index < WorkerNum; ++Index)
+	{
+		Workers.emplace_back(&JobSystem::WorkerLoop, this, Index);
+	}
+
+	BackgroundWorkers.reserve(BackgroundWorkerNum);
+	for (unsigned int Index = 0u; Index < BackgroundWorkerNum; ++Index)
+	{
+		BackgroundWorkers.emplace_back(&JobSystem::BackgroundLoop, this);
+	}
+
+	LOG_INFO("Job system: {} frame and {} background workers{}", WorkerNum, BackgroundWorkerNum,
+	         Topology.IsHybrid() ? ", on the performance and efficiency cores" : "");
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard Lock(SleepMutex);
+		bIsStopping = true;
+	}
+
+	WakeCondition.notify_all();
+	BackgroundWakeCondition.notify_all();
+
+	for (auto& Worker : Workers)
+	{
+		Worker.join();
+	}
+
+	for (auto& Worker : BackgroundWorkers)
+	{
+		Worker.join();
+	}
+
+	Instance = nullptr;
+}
+
+JobSystem& JobSystem::Get() noexcept
+{
+	assert(Instance && "JobSystem is used before App created it");
+	return *Instance;
+}
+
+void JobSystem::Run(Job InJob, JobCounter* InSignal, JobCounter* InDependency)
+{
+	Run(std::move(InJob), ThreadLane, InSignal, InDependency);
+}
+
+void JobSystem::Run(Job InJob, const JobLane InLane, JobCounter* InSignal, JobCounter* InDependency)
+{
+	// Jobs run from untagged code count as the job system's own, like the queues they are kept in.
+	const auto Caller = AllocationTracker::GetCurrentTag();
+	const auto Owner = Caller == AllocationTracker::Tag::Untagged ? AllocationTracker::Tag::Jobs : Caller;
+	ALLOCATION_SCOPE(Jobs);
+
+	if (InSignal)
+	{
+		InSignal->Count.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	if (InDependency)
+	{
+		// Checked under the lock Complete takes before releasing continuations, so none is lost.
+		std::lock_guard Lock(InDependency->Mutex);
+
+		if (!InDependency->IsDone())
+		{
+			InDependency->Continuations.push_back({std::move(InJob), InSignal, Owner, InLane});
+			return;
+		}
+	}
+
+	Schedule({std::move(InJob), InSignal, Owner, InLane});
+}
+
+void JobSystem::Wait(JobCounter& InCounter)
+{
+	while (!InCounter.IsDone())
+	{
+		if (!TryRunOne())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr Exception;
+	{
+		std::lock_guard Lock(InCounter.Mutex);
+		std::swap(Exception, InCounter.Exception);
+	}
+
+	if (Exception)
+	{
+		std::rethrow_exception(Exception);
+	}
+}
+
+void JobSystem::JoinLane(const JobLane InLane) const noexcept
+{
+	ThreadLane = InLane;
+	const auto& Topology = CpuTopology::Get();
+
+	if (InLane == JobLane::Frame)
+	{
+		if (Topology.IsHybrid())
+		{
+			CpuTopology::Pin(Topology.Performance);
+		}
+
+		return;
+	}
+
+	if (Topology.IsHybrid())
+	{
+		CpuTopology::Pin(Topology.Efficiency);
+	}
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+	ThrottlePower();
+}
+
+bool JobSystem::IsHybrid() const noexcept
+{
+	return CpuTopology::Get().IsHybrid();
+}
+
+void JobSystem::Hold(JobCounter& InSignal) noexcept
+{
+	InSignal.Count.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void JobSystem::Release(JobCounter& InSignal, std::exception_ptr InException)
+{
+	Complete(&InSignal, std::move(InException));
+}
+
+void JobSystem::Schedule(Task InTask)
+{
+	if (InTask.Lane == JobLane::Background)
+	{
+		InTask.Id = NextJobId.fetch_add(1u, std::memory_order_relaxed);
+
+		{
+			std::lock_guard Lock(BackgroundQueue.Mutex);
+			BackgroundQueue.Tasks.push_back(std::move(InTask));
+		}
+
+		BackgroundQueuedNum.fetch_add(1u, std::memory_order_release);
+
+		{
+			std::lock_guard Lock(SleepMutex);
+		}
+
+		BackgroundWakeCondition.notify_one();
+		return;
+	}
+
+	const auto QueueIndex = ThreadQueueIndex < Workers.size() ? ThreadQueueIndex : static_cast<unsigned int>(Workers.size());
+	InTask.Id = NextJobId.fetch_add(1u, std::memory_order_relaxed);
+
+	{
+		std::lock_guard Lock(Queues[QueueIndex]->Mutex);
+		Queues[QueueIndex]->Tasks.push_back(std::move(InTask));
+	}
+
+	QueuedNum.fetch_add(1u, std::memory_order_release);
+
+	// Taking the lock orders the wake-up after a sleeping worker's check of QueuedNum.
+	{
+		std::lock_guard Lock(SleepMutex);
+	}
+
+	WakeCondition.notify_one();
+}
+
+bool JobSystem::TryPopFrame(Task& OutTask)
+{
+	const auto QueueNum = static_cast<unsigned int>(Queues.size());
+	const auto OwnIndex = ThreadQueueIndex < Workers.size() ? ThreadQueueIndex : QueueNum - 1u;
+
+	// Own queue newest first for locality, then steal the oldest job from everyone else.
+	for (unsigned int Offset = 0u; Offset < QueueNum; ++Offset)
+	{
+		auto& Queue = *Queues[(OwnIndex + Offset) % QueueNum];
+		std::lock_guard Lock(Queue.Mutex);
+
+		if (Queue.Tasks.empty())
+		{
+			continue;
+		}
+
+		if (Offset == 0u)
+		{
+			OutTask = std::move(Queue.Tasks.back());
+			Queue.Tasks.pop_back();
+		}
+		else
+		{
+			OutTask = std::move(Queue.Tasks.front());
+			Queue.Tasks.pop_front();
+		}
+
+		QueuedNum.fetch_sub(1u, std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::TryPopBackground(Task& OutTask)
+{
+	std::lock_guard Lock(BackgroundQueue.Mutex);
+
+	if (BackgroundQueue.Tasks.empty())
+	{
+		return false;
+	}
+
+	OutTask = std::move(BackgroundQueue.Tasks.front());
+	BackgroundQueue.Tasks.pop_front();
+	BackgroundQueuedNum.fetch_sub(1u, std::memory_order_relaxed);
+	return true;
+}
+
+bool JobSystem::TryRunOne()
+{
+	Task NextTask;
+
+	if (!(ThreadLane == JobLane::Background ? TryPopBackground(NextTask) : TryPopFrame(NextTask)))
+	{
+		return false;
+	}
+
+	std::exception_ptr Exception;
+	try
+	{
+		const FrameProfiler::JobScope TracedJob {NextTask.Id};
+		const AllocationTracker::Scope TaggedJob {NextTask.Owner};
+		NextTask.Function();
+	}
+	catch (...)
+	{
+		Exception = std::current_exception();
+	}
+
+	// A job nobody waits on has nowhere to report its failure.
+	assert((NextTask.Signal || !Exception) && "An unsignalled job threw");
+	Complete(NextTask.Signal, std::move(Exception));
+
+	return true;
+}
+
+void JobSystem::Complete(JobCounter* InSignal, std::exception_ptr InException)
+{
+	if (!InSignal)
+	{
+		return;
+	}
+
+	std::vector<JobCounter::Continuation> Continuations;
+	{
+		std::lock_guard Lock(InSignal->Mutex);
+
+		if (InException && !InSignal->Exception)
+		{
+			InSignal->Exception = std::move(InException);
+		}
+
+		if (InSignal->Count.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+		{
+			std::swap(Continuations, InSignal->Continuations);
+		}
+	}
+
+	for (auto& [Function, Signal, Owner, Lane] : Continuations)
+	{
+		Schedule({std::move(Function), Signal, Owner, Lane});
+	}
+}
+
+unsigned int JobSystem::GetThreadIndex() const noexcept
+{
+	return ThreadQueueIndex < Workers.size() ? ThreadQueueIndex : GetWorkerNum();
+}
+
+void JobSystem::WorkerLoop(const unsigned int InQueueIndex)
+{
+	ThreadQueueIndex = InQueueIndex;
+	JoinLane(JobLane::Frame);
+	FrameProfiler::SetThreadName("Job worker");
+
+	while (true)
+	{
+		if (TryRunOne())
+		{
+			continue;
+		}
+
+		std::unique_lock Lock(SleepMutex);
+		WakeCondition.wait(Lock, [this]
+		{
+			return bIsStopping || QueuedNum.load(std::memory_order_acquire) > 0u;
+		});
+
+		if (bIsStopping)
+		{
+			return;
+		}
+	}
+}
+
+void JobSystem::BackgroundLoop()
+{
+	JoinLane(JobLane::Background);
+	FrameProfiler::SetThreadName("Background worker");
+
+	while (true)
+	{
+		if (TryRunOne())
+		{
+			continue;
+		}
+
+		std::unique_lock Lock(SleepMutex);
+		BackgroundWakeCondition.wait(Lock, [this]
+		{
+			return bIsStopping || BackgroundQueuedNum.load(std::memory_order_acquire) > 0u;
+		});
+
+		if (bIsStopping)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,180 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AllocationTracker.h"
+
+class JobSystem;
+
+// Which workers run a job. Frame jobs are what the frame being built waits for. Background ones, imports, decodes, cooking and
+// file writes, only have to finish eventually and never hold up a frame worker.
+enum class JobLane : uint8_t
+{
+	Frame,
+	Background
+};
+
+// Tracks unfinished jobs, jobs that depend on it are only scheduled once it reaches zero.
+class JobCounter
+{
+	friend class JobSystem;
+
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter(JobCounter&&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+	JobCounter& operator=(JobCounter&&) = delete;
+	~JobCounter() = default;
+
+	[[nodiscard]] bool IsDone() const noexcept
+	{
+		return Count.load(std::memory_order_acquire) == 0u;
+	}
+
+private:
+	struct Continuation
+	{
+		std::function<void()> Function;
+		JobCounter* Signal;
+		AllocationTracker::Tag Owner;
+		JobLane Lane;
+	};
+
+	std::atomic<unsigned int> Count {0u};
+	std::mutex Mutex;
+	std::vector<Continuation> Continuations;
+	// The first exception thrown by a job signalling this counter, rethrown by JobSystem::Wait.
+	std::exception_ptr Exception;
+};
+
+/**
+ * Engine-wide worker pool in two lanes. Frame workers have one deque each, pop their own newest job first and steal the oldest
+ * jobs of others when they run dry. Background workers share one queue, oldest job first, run below normal priority and power
+ * throttled. Neither lane runs the other's jobs, waiting included, so a long decode never lands on a thread the frame waits for.
+ * On a hybrid processor the frame workers and the constructing thread, the main one, are kept on the performance cores and the
+ * background workers on the efficiency cores, a worker per logical processor. Elsewhere nothing is pinned and there are as many
+ * background workers as frame workers, for the scheduler to preempt.
+ * Owned by App, everything else reaches it through Get().
+ */
+class JobSystem
+{
+public:
+	using Job = std::function<void()>;
+
+	// Zero frame workers means one per performance thread besides the calling one, every hardware thread on other processors.
+	explicit JobSystem(unsigned int InWorkerNum = 0u);
+	JobSystem(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+	~JobSystem();
+
+	[[nodiscard]] static JobSystem& Get() noexcept;
+
+	// The signal counter is raised now and lowered when the job finishes, the dependency delays the job until it is done.
+	// In the lane of the calling thread, so the jobs a background job spreads out stay in the background.
+	void Run(Job InJob, JobCounter* InSignal = nullptr, JobCounter* InDependency = nullptr);
+	void Run(Job InJob, JobLane InLane, JobCounter* InSignal = nullptr, JobCounter* InDependency = nullptr);
+	// Runs other jobs of the caller's lane while waiting, so it is safe to call from inside a job.
+	void Wait(JobCounter& InCounter);
+	// Places and prioritizes the calling thread like the lane's workers, and makes the lane the one its jobs go to. For long-lived
+	// threads outside the pool, such as the I/O thread, those that never join are frame threads.
+	void JoinLane(JobLane InLane) const noexcept;
+	// Counts work finishing outside the pool, such as a file read, as one job on the counter until Release.
+	void Hold(JobCounter& InSignal) noexcept;
+	// Releases what Hold counted, the exception is reported by Wait as one a job threw would be.
+	void Release(JobCounter& InSignal, std::exception_ptr InException = nullptr);
+
+	template<typename Function>
+	void ParallelFor(const size_t InCount, const size_t InBatchSize, Function&& InBody)
+	{
+		const auto BatchSize = std::max<size_t>(InBatchSize, 1u);
+		JobCounter Counter;
+
+		for (size_t First = 0u; First < InCount; First += BatchSize)
+		{
+			const auto Last = std::min(First + BatchSize, InCount);
+
+			Run([&InBody, First, Last]
+			{
+				for (auto Index = First; Index < Last; ++Index)
+				{
+					InBody(Index);
+				}
+			}, &Counter);
+		}
+
+		Wait(Counter);
+	}
+
+	// Frame workers only, what per thread state for the frame is sized by.
+	[[nodiscard]] unsigned int GetWorkerNum() const noexcept
+	{
+		return static_cast<unsigned int>(Workers.size());
+	}
+
+	[[nodiscard]] unsigned int GetBackgroundWorkerNum() const noexcept
+	{
+		return static_cast<unsigned int>(BackgroundWorkers.size());
+	}
+
+	// Whether the lanes are pinned to cores of their own.
+	[[nodiscard]] bool IsHybrid() const noexcept;
+
+	// Of the frame worker running the caller, GetWorkerNum() for other threads, background workers included, which share it.
+	// For state kept per thread, such as the render queue's draw lists.
+	[[nodiscard]] unsigned int GetThreadIndex() const noexcept;
+
+private:
+	struct Task
+	{
+		Job Function;
+		JobCounter* Signal;
+		// What the job allocates is counted under the tag of the code that ran it, see Run.
+		AllocationTracker::Tag Owner {AllocationTracker::Tag::Jobs};
+		JobLane Lane {JobLane::Frame};
+		// Numbers the job in profiler traces, assigned once it is scheduled.
+		unsigned long long Id {0u};
+	};
+
+	struct TaskQueue
+	{
+		std::mutex Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	void Schedule(Task InTask);
+	[[nodiscard]] bool TryPopFrame(Task& OutTask);
+	[[nodiscard]] bool TryPopBackground(Task& OutTask);
+	// Of the calling thread's lane.
+	[[nodiscard]] bool TryRunOne();
+	void Complete(JobCounter* InSignal, std::exception_ptr InException);
+	void WorkerLoop(unsigned int InQueueIndex);
+	void BackgroundLoop();
+
+private:
+	static inline JobSystem* Instance {nullptr};
+
+	// One queue per worker, the last one takes jobs from threads outside the pool.
+	std::vector<std::unique_ptr<TaskQueue>> Queues;
+	std::vector<std::thread> Workers;
+	TaskQueue BackgroundQueue;
+	std::vector<std::thread> BackgroundWorkers;
+
+	std::mutex SleepMutex;
+	std::condition_variable WakeCondition;
+	std::condition_variable BackgroundWakeCondition;
+	std::atomic<unsigned int> QueuedNum {0u};
+	std::atomic<unsigned int> BackgroundQueuedNum {0u};
+	std::atomic<unsigned long long> NextJobId {1u};
+	bool bIsStopping {false};
+};
@@ -1,26 +1,16 @@
 ﻿#include "Keyboard.h"
+#include <algorithm>
 
 std::optional<Keyboard::Event> Keyboard::ReadKey() noexcept
 {
-	if (!KeyBuffer.empty())
-	{
-		const Event Event = KeyBuffer.front();
-		KeyBuffer.pop();
-		return std::optional{Event};
-	}
-	else
-	{
-		return std::nullopt;
-	}
+	return KeyBuffer.Pop();
 }
 
 std::optional<char> Keyboard::ReadChar() noexcept
 {
-	if (!CharBuffer.empty())
+	if (const auto CharCode = CharBuffer.Pop())
 	{
-		const unsigned char CharCode = CharBuffer.front();
-		CharBuffer.pop();
-		return std::optional{CharCode};
+		return std::optional{static_cast<char>(*CharCode)};
 	}
 	else
 	{
@@ -28,22 +18,54 @@ std::optional<char> Keyboard::ReadChar() noexcept
 	}
 }
 
+float Keyboard::GetHeldSeconds(const unsigned char InKeyCode, const Clock::time_point InFrom, const Clock::time_point InTo) const noexcept
+{
+	// Acquiring the state first makes the transition times stored before it visible.
+	const bool bIsPressed = KeyStates[InKeyCode].load(std::memory_order_acquire);
+	const auto Start = std::max(PressTimes[InKeyCode].load(std::memory_order_relaxed), InFrom);
+	const auto End = bIsPressed ? InTo : std::min(ReleaseTimes[InKeyCode].load(std::memory_order_relaxed), InTo);
+
+	return End > Start ? std::chrono::duration<float>(End - Start).count() : 0.0f;
+}
+
 void Keyboard::OnKeyPressed(unsigned char InKeyCode) noexcept
 {
-	KeyStates[InKeyCode] = true;
-	KeyBuffer.emplace(Event::Type::Press, InKeyCode);
-	TrimBuffer(KeyBuffer);
+	const auto Now = Clock::now();
+
+	if (!KeyStates[InKeyCode].load(std::memory_order_relaxed))
+	{
+		PressTimes[InKeyCode].store(Now, std::memory_order_relaxed);
+	}
+
+	KeyStates[InKeyCode].store(true, std::memory_order_release);
+	KeyBuffer.Push(Event::Type::Press, InKeyCode, Now);
 }
 
 void Keyboard::OnKeyReleased(unsigned char InKeyCode) noexcept
 {
-	KeyStates[InKeyCode] = false;
-	KeyBuffer.emplace(Event::Type::Release, InKeyCode);
-	TrimBuffer(KeyBuffer);
+	const auto Now = Clock::now();
+
+	ReleaseTimes[InKeyCode].store(Now, std::memory_order_relaxed);
+	KeyStates[InKeyCode].store(false, std::memory_order_release);
+	KeyBuffer.Push(Event::Type::Release, InKeyCode, Now);
 }
 
 void Keyboard::OnChar(unsigned char InCharacter) noexcept
 {
-	CharBuffer.emplace(InCharacter);
-	TrimBuffer(CharBuffer);
+	CharBuffer.Push(InCharacter);
+}
+
+void Keyboard::ClearState() noexcept
+{
+	const auto Now = Clock::now();
+
+	// Losing focus releases everything, held time stops counting here.
+	for (unsigned int KeyCode = 0u; KeyCode < KeyNum; ++KeyCode)
+	{
+		if (KeyStates[KeyCode].load(std::memory_order_relaxed))
+		{
+			ReleaseTimes[KeyCode].store(Now, std::memory_order_relaxed);
+			KeyStates[KeyCode].store(false, std::memory_order_release);
+		}
+	}
 }
\ No newline at end of file
@@ -1,13 +1,18 @@
 ﻿#pragma once
-#include <queue>
-#include <bitset>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <optional>
+#include "SpscQueue.h"
 
 class Keyboard
 {
 	friend class Window;
 
 public:
+	// std::chrono::steady_clock reads the performance counter, fine enough to place events within a frame.
+	using Clock = std::chrono::steady_clock;
+
 	class Event
 	{
 		public:
@@ -22,8 +27,8 @@ public:
 				: Type(Type::Invalid), Code(0u)
 			{}
 
-			Event(const Type InType, const unsigned char InCode) noexcept
-				: Type(InType), Code(InCode)
+			Event(const Type InType, const unsigned char InCode, const Clock::time_point InTimestamp) noexcept
+				: Type(InType), Code(InCode), Timestamp(InTimestamp)
 			{}
 
 			[[nodiscard]] bool IsPress() const noexcept
@@ -46,9 +51,16 @@ public:
 				return Code;
 			}
 
+			// When the message reached the window procedure.
+			[[nodiscard]] Clock::time_point GetTimestamp() const noexcept
+			{
+				return Timestamp;
+			}
+
 		private:
 			Type Type;
 			unsigned char Code;
+			Clock::time_point Timestamp {};
 	};
 
 	Keyboard() = default;
@@ -63,12 +75,12 @@ public:
 
 	void FlushKey() noexcept
 	{
-		KeyBuffer = std::queue<Event>{};
+		KeyBuffer.Clear();
 	}
 
 	void FlushChar() noexcept
 	{
-		CharBuffer = std::queue<unsigned char>{};
+		CharBuffer.Clear();
 	}
 
 	void Flush() noexcept
@@ -89,17 +101,20 @@ public:
 
 	[[nodiscard]] bool IsKeyPressed(const unsigned char InKeyCode) const noexcept
 	{
-		return KeyStates[InKeyCode];
+		return KeyStates[InKeyCode].load(std::memory_order_acquire);
 	}
 
+	// Seconds the key was down between the two points, so a tap shorter than a frame or a release halfway through one moves the right amount.
+	[[nodiscard]] float GetHeldSeconds(unsigned char InKeyCode, Clock::time_point InFrom, Clock::time_point InTo) const noexcept;
+
 	[[nodiscard]] bool IsKeyEmpty() const noexcept
 	{
-		return KeyBuffer.empty();
+		return KeyBuffer.IsEmpty();
 	}
 
 	[[nodiscard]] bool IsCharEmpty() const noexcept
 	{
-		return CharBuffer.empty();
+		return CharBuffer.IsEmpty();
 	}
 
 	[[nodiscard]] bool IsAutoRepeatEnabled() const noexcept
@@ -108,30 +123,27 @@ public:
 	}
 
 private:
+	static constexpr unsigned int BufferSize {16u};
+
+	// Filled by the window procedure and drained by the render loop, which may run on another thread.
 	template<typename T>
-	static void TrimBuffer(std::queue<T>& InBuffer) noexcept
-	{
-		while (InBuffer.size() > BufferSize)
-		{
-			InBuffer.pop();
-		}
-	}
+	using EventQueue = SpscQueue<T, BufferSize>;
 
 	void OnKeyPressed(unsigned char InKeyCode) noexcept;
 	void OnKeyReleased(unsigned char InKeyCode) noexcept;
 	void OnChar(unsigned char InCharacter) noexcept;
 
-	void ClearState() noexcept
-	{
-		KeyStates.reset();
-	}
+	void ClearState() noexcept;
 
 private:
 	static constexpr unsigned int KeyNum {256u};
-	static constexpr unsigned int BufferSize {16u};
 
-	bool bIsAutoRepeatEnabled = false;
-	std::bitset<KeyNum> KeyStates;
-	std::queue<Event> KeyBuffer;
-	std::queue<unsigned char> CharBuffer;
+	std::atomic<bool> bIsAutoRepeatEnabled {false};
+	// Latest state snapshot, written by the window procedure and read at any time by the render loop.
+	std::array<std::atomic<bool>, KeyNum> KeyStates {};
+	// The last transition each way, only the first press of an auto-repeating key counts.
+	std::array<std::atomic<Clock::time_point>, KeyNum> PressTimes {};
+	std::array<std::atomic<Clock::time_point>, KeyNum> ReleaseTimes {};
+	EventQueue<Event> KeyBuffer;
+	EventQueue<unsigned char> CharBuffer;
 };
\ No newline at end of file
@@ -0,0 +1,632 @@
+﻿#include "Lightmapper.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <DirectXCollision.h>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include "JobSystem.h"
+#include "TextureCooker.h"
+
+namespace
+{
+	// Triangles join a chart while they face within about 45 degrees of its first one, steep enough that the flat projection
+	// doesn't fold them over each other.
+	constexpr float ChartNormalCosine {0.7f};
+	// The bounce takes every surface for mid grey, the bake doesn't sample the maps.
+	constexpr float BounceAlbedo {0.5f};
+	// Atlases shrink by this much while their charts don't fit MaxAtlasSize, and never start below MinAtlasSize.
+	constexpr float ShrinkFactor {0.75f};
+	constexpr unsigned int MinAtlasSize {32u};
+	// Below it the charts are down to their padding and a texel, shelves of that many still not fitting won't fit at all.
+	constexpr float MinScale {1e-4f};
+	// Texels whose centre is this close to a triangle take their sample from its nearest point, so charts thinner than a texel
+	// still cover the texels they pass through.
+	constexpr float ConservativeDistance {0.75f};
+	constexpr unsigned int NoChart {~0u};
+
+	struct Chart
+	{
+		std::vector<unsigned int> Triangles;
+		DirectX::XMFLOAT3 U;
+		DirectX::XMFLOAT3 V;
+		// Projected, in texels at the requested density.
+		float MinU {std::numeric_limits<float>::max()};
+		float MinV {std::numeric_limits<float>::max()};
+		float MaxU {std::numeric_limits<float>::lowest()};
+		float MaxV {std::numeric_limits<float>::lowest()};
+		// Placed in the atlas, padding included.
+		unsigned int X {0u};
+		unsigned int Y {0u};
+		unsigned int Width {0u};
+		unsigned int Height {0u};
+	};
+
+	// What a texel shows of the surface, in the scene's space.
+	struct Sample
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Normal;
+		// In texels from the triangle it was taken from, zero inside it.
+		float Distance {std::numeric_limits<float>::max()};
+	};
+
+	// Indices of the positions with every duplicate mapped to its first, so charts grow across the seams the source splits its
+	// vertices at for normals or texture coordinates.
+	std::vector<unsigned int> WeldPositions(const std::span<const DirectX::XMFLOAT3> InPositions)
+	{
+		std::map<std::tuple<float, float, float>, unsigned int> FirstIndices;
+		std::vector<unsigned int> Welded(InPositions.size());
+
+		for (unsigned int Index = 0u; Index < InPositions.size(); ++Index)
+		{
+			const auto& [X, Y, Z] = InPositions[Index];
+			Welded[Index] = FirstIndices.try_emplace({X, Y, Z}, Index).first->second;
+		}
+
+		return Welded;
+	}
+
+	uint64_t MakeEdgeKey(const unsigned int InFirst, const unsigned int InSecond) noexcept
+	{
+		return static_cast<uint64_t>(std::min(InFirst, InSecond)) << 32u | std::max(InFirst, InSecond);
+	}
+
+	// Any frame around the normal will do.
+	void MakeBasis(DirectX::FXMVECTOR InNormal, DirectX::XMFLOAT3& OutU, DirectX::XMFLOAT3& OutV) noexcept
+	{
+		const auto Helper = std::abs(DirectX::XMVectorGetX(InNormal)) > 0.9f ? DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+		const auto U = DirectX::XMVector3Normalize(DirectX::XMVector3Cross(Helper, InNormal));
+		DirectX::XMStoreFloat3(&OutU, U);
+		DirectX::XMStoreFloat3(&OutV, DirectX::XMVector3Cross(InNormal, U));
+	}
+
+	// Tallest first on shelves across the atlas, false when they run out of rows.
+	bool PackCharts(std::vector<Chart>& InOutCharts, const std::vector<unsigned int>& InOrder, const float InScale, const unsigned int InSize)
+	{
+		unsigned int ShelfX = 0u;
+		unsigned int ShelfY = 0u;
+		unsigned int ShelfHeight = 0u;
+
+		for (const auto Index : InOrder)
+		{
+			auto& Placed = InOutCharts[Index];
+			Placed.Width = static_cast<unsigned int>(std::ceil((Placed.MaxU - Placed.MinU) * InScale)) + 1u + 2u * Lightmapper::ChartPadding;
+			Placed.Height = static_cast<unsigned int>(std::ceil((Placed.MaxV - Placed.MinV) * InScale)) + 1u + 2u * Lightmapper::ChartPadding;
+
+			if (ShelfX + Placed.Width > InSize)
+			{
+				ShelfX = 0u;
+				ShelfY += ShelfHeight;
+				ShelfHeight = 0u;
+			}
+
+			if (Placed.Width > InSize || ShelfY + Placed.Height > InSize)
+			{
+				return false;
+			}
+
+			Placed.X = ShelfX;
+			Placed.Y = ShelfY;
+			ShelfX += Placed.Width;
+			ShelfHeight = std::max(ShelfHeight, Placed.Height);
+		}
+
+		return true;
+	}
+
+	// Of the point nearest InPoint in the triangle, with how far that is.
+	std::array<float, 3> FindNearestBarycentrics(const DirectX::XMFLOAT2& InPoint, const std::array<DirectX::XMFLOAT2, 3>& InCorners, float& OutDistance) noexcept
+	{
+		const auto& [A, B, C] = InCorners;
+		const auto Area = (B.x - A.x) * (C.y - A.y) - (B.y - A.y) * (C.x - A.x);
+
+		if (std::abs(Area) > 1e-12f)
+		{
+			const auto WeightB = ((InPoint.x - A.x) * (C.y - A.y) - (InPoint.y - A.y) * (C.x - A.x)) / Area;
+			const auto WeightC = ((B.x - A.x) * (InPoint.y - A.y) - (B.y - A.y) * (InPoint.x - A.x)) / Area;
+
+			if (WeightB >= 0.0f && WeightC >= 0.0f && WeightB + WeightC <= 1.0f)
+			{
+				OutDistance = 0.0f;
+				return {1.0f - WeightB - WeightC, WeightB, WeightC};
+			}
+		}
+
+		// Outside, or degenerate: the nearest point of the nearest edge.
+		std::array Nearest {1.0f, 0.0f, 0.0f};
+		OutDistance = std::numeric_limits<float>::max();
+
+		for (unsigned int Edge = 0u; Edge < 3u; ++Edge)
+		{
+			const auto& From = InCorners[Edge];
+			const auto& To = InCorners[(Edge + 1u) % 3u];
+			const DirectX::XMFLOAT2 Along {To.x - From.x, To.y - From.y};
+			const auto LengthSquared = Along.x * Along.x + Along.y * Along.y;
+			const auto T = LengthSquared > 0.0f ? std::clamp(((InPoint.x - From.x) * Along.x + (InPoint.y - From.y) * Along.y) / LengthSquared, 0.0f, 1.0f) : 0.0f;
+			const auto DeltaX = From.x + T * Along.x - InPoint.x;
+			const auto DeltaY = From.y + T * Along.y - InPoint.y;
+
+			if (const auto Distance = std::sqrt(DeltaX * DeltaX + DeltaY * DeltaY); Distance < OutDistance)
+			{
+				OutDistance = Distance;
+				Nearest = {0.0f, 0.0f, 0.0f};
+				Nearest[Edge] = 1.0f - T;
+				Nearest[(Edge + 1u) % 3u] = T;
+			}
+		}
+
+		return Nearest;
+	}
+
+	// Bits reversed over the binary point, the second coordinate of a Hammersley point.
+	float RadicalInverse(unsigned int InBits) noexcept
+	{
+		InBits = (InBits << 16u) | (InBits >> 16u);
+		InBits = ((InBits & 0x55555555u) << 1u) | ((InBits & 0xAAAAAAAAu) >> 1u);
+		InBits = ((InBits & 0x33333333u) << 2u) | ((InBits & 0xCCCCCCCCu) >> 2u);
+		InBits = ((InBits & 0x0F0F0F0Fu) << 4u) | ((InBits & 0xF0F0F0F0u) >> 4u);
+		InBits = ((InBits & 0x00FF00FFu) << 8u) | ((InBits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(InBits) * 2.3283064365386963e-10f;
+	}
+
+	// The light reaching a surface at InOrigin, already off it along InNormal, from every light that isn't shadowed.
+	DirectX::XMVECTOR GatherDirect(const Lightmapper::Scene& InScene, const Lightmapper::Settings& InSettings, DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InNormal)
+	{
+		auto Sum = DirectX::XMVectorZero();
+
+		for (const auto& [Position, Color, Range] : InSettings.Lights)
+		{
+			const auto ToLight = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Position), InOrigin);
+			const auto Distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(ToLight));
+
+			if (Distance >= Range || Distance <= 0.0f)
+			{
+				continue;
+			}
+
+			const auto Direction = DirectX::XMVectorScale(ToLight, 1.0f / Distance);
+			const auto Cosine = DirectX::XMVectorGetX(DirectX::XMVector3Dot(InNormal, Direction));
+
+			if (Cosine <= 0.0f || InScene.IsOccluded(InOrigin, Direction, Distance))
+			{
+				continue;
+			}
+
+			const auto Ratio = Distance / Range;
+			const auto Window = std::clamp(1.0f - Ratio * Ratio * Ratio * Ratio, 0.0f, 1.0f);
+			const auto Falloff = Window * Window / (Distance * Distance + 1.0f);
+			Sum = DirectX::XMVectorMultiplyAdd(DirectX::XMLoadFloat3(&Color), DirectX::XMVectorReplicate(Cosine * Falloff), Sum);
+		}
+
+		return Sum;
+	}
+
+	// Direct light and one bounce, from InRayNum cosine distributed rays turned by InTurn so neighbouring texels don't band alike.
+	DirectX::XMVECTOR BakeTexel(const Lightmapper::Scene& InScene, const Lightmapper::Settings& InSettings, const Sample& InSample, const float InOffset, const float InTurn)
+	{
+		const auto Normal = DirectX::XMLoadFloat3(&InSample.Normal);
+		const auto Origin = DirectX::XMVectorMultiplyAdd(Normal, DirectX::XMVectorReplicate(InOffset), DirectX::XMLoadFloat3(&InSample.Position));
+		const auto Direct = GatherDirect(InScene, InSettings, Origin, Normal);
+
+		if (InSettings.IndirectRayNum <= 0)
+		{
+			return Direct;
+		}
+
+		DirectX::XMFLOAT3 Tangent;
+		DirectX::XMFLOAT3 Bitangent;
+		MakeBasis(Normal, Tangent, Bitangent);
+
+		auto Bounced = DirectX::XMVectorZero();
+
+		for (auto Ray = 0; Ray < InSettings.IndirectRayNum; ++Ray)
+		{
+			// A Hammersley point, its first coordinate the squared radius on the disc below the hemisphere.
+			const auto RadiusSquared = (static_cast<float>(Ray) + 0.5f) / static_cast<float>(InSettings.IndirectRayNum);
+			const auto Angle = DirectX::XM_2PI * (RadicalInverse(static_cast<unsigned int>(Ray)) + InTurn);
+			const auto Radius = std::sqrt(RadiusSquared);
+			const auto Direction = DirectX::XMVector3Normalize(DirectX::XMVectorAdd(
+				DirectX::XMVectorAdd(DirectX::XMVectorScale(DirectX::XMLoadFloat3(&Tangent), Radius * std::cos(Angle)),
+				                     DirectX::XMVectorScale(DirectX::XMLoadFloat3(&Bitangent), Radius * std::sin(Angle))),
+				DirectX::XMVectorScale(Normal, std::sqrt(std::max(1.0f - RadiusSquared, 0.0f)))));
+
+			auto Distance = InScene.GetDiagonal();
+			const auto Hit = InScene.Trace(Origin, Direction, Distance);
+
+			if (Hit == TriangleBvh::NoTriangle)
+			{
+				continue;
+			}
+
+			// Lit from whichever side the ray arrives at, back faces of open meshes included.
+			auto HitNormal = InScene.GetNormal(Hit);
+			if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(HitNormal, Direction)) > 0.0f)
+			{
+				HitNormal = DirectX::XMVectorNegate(HitNormal);
+			}
+
+			const auto HitPosition = DirectX::XMVectorMultiplyAdd(Direction, DirectX::XMVectorReplicate(Distance), Origin);
+			const auto HitOrigin = DirectX::XMVectorMultiplyAdd(HitNormal, DirectX::XMVectorReplicate(InOffset), HitPosition);
+			Bounced = DirectX::XMVectorAdd(Bounced, GatherDirect(InScene, InSettings, HitOrigin, HitNormal));
+		}
+
+		// Cosine distributed rays weigh themselves, the average is the bounced share of the irradiance.
+		return DirectX::XMVectorMultiplyAdd(Bounced, DirectX::XMVectorReplicate(BounceAlbedo / static_cast<float>(InSettings.IndirectRayNum)), Direct);
+	}
+
+	// The strongest channel sets a shared multiplier in alpha, rounded up so the others never clip.
+	TextureCooker::Texel EncodeRGBM(const DirectX::XMFLOAT3& InColor) noexcept
+	{
+		const auto Peak = std::max({InColor.x, InColor.y, InColor.z, 0.0f}) / Lightmapper::MaxValue;
+		const auto Multiplier = std::ceil(std::clamp(Peak, 1.0f / 255.0f, 1.0f) * 255.0f) / 255.0f;
+		const auto Scale = 1.0f / (Multiplier * Lightmapper::MaxValue);
+
+		const auto Quantize = [](const float InValue)
+		{
+			return static_cast<unsigned char>(std::lround(std::clamp(InValue, 0.0f, 1.0f) * 255.0f));
+		};
+
+		return {Quantize(InColor.x * Scale), Quantize(InColor.y * Scale), Quantize(InColor.z * Scale), Quantize(Multiplier)};
+	}
+}
+
+Lightmapper::Unwrap Lightmapper::UnwrapMesh(const std::span<const DirectX::XMFLOAT3> InPositions, const std::span<const unsigned int> InIndices, const float InTexelsPerUnit)
+{
+	const auto TriangleNum = static_cast<unsigned int>(InIndices.size() / 3u);
+	const auto Welded = WeldPositions(InPositions);
+
+	std::vector<DirectX::XMFLOAT3> Normals(TriangleNum);
+	std::vector<float> Areas(TriangleNum);
+	std::vector<std::pair<uint64_t, unsigned int>> Edges;
+	Edges.reserve(InIndices.size());
+
+	for (unsigned int Triangle = 0u; Triangle < TriangleNum; ++Triangle)
+	{
+		const auto A = DirectX::XMLoadFloat3(&InPositions[InIndices[Triangle * 3u]]);
+		const auto Cross = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&InPositions[InIndices[Triangle * 3u + 1u]]), A),
+		                                           DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&InPositions[InIndices[Triangle * 3u + 2u]]), A));
+		Areas[Triangle] = DirectX::XMVectorGetX(DirectX::XMVector3Length(Cross));
+		DirectX::XMStoreFloat3(&Normals[Triangle], DirectX::XMVector3Normalize(Cross));
+
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			Edges.emplace_back(MakeEdgeKey(Welded[InIndices[Triangle * 3u + Corner]], Welded[InIndices[Triangle * 3u + (Corner + 1u) % 3u]]), Triangle);
+		}
+	}
+
+	std::sort(Edges.begin(), Edges.end());
+
+	// Largest first, so charts start from the triangles that matter most and small ones collect around them.
+	std::vector<unsigned int> SeedOrder(TriangleNum);
+	for (unsigned int Triangle = 0u; Triangle < TriangleNum; ++Triangle)
+	{
+		SeedOrder[Triangle] = Triangle;
+	}
+
+	std::stable_sort(SeedOrder.begin(), SeedOrder.end(), [&Areas](const unsigned int InLeft, const unsigned int InRight)
+	{
+		return Areas[InLeft] > Areas[InRight];
+	});
+
+	std::vector<unsigned int> TriangleCharts(TriangleNum, NoChart);
+	std::vector<Chart> Charts;
+	std::vector<unsigned int> Pending;
+
+	for (const auto Seed : SeedOrder)
+	{
+		if (TriangleCharts[Seed] != NoChart)
+		{
+			continue;
+		}
+
+		const auto ChartIndex = static_cast<unsigned int>(Charts.size());
+		auto& Grown = Charts.emplace_back();
+		const auto Axis = DirectX::XMLoadFloat3(&Normals[Seed]);
+		MakeBasis(Axis, Grown.U, Grown.V);
+
+		TriangleCharts[Seed] = ChartIndex;
+		Pending.push_back(Seed);
+
+		while (!Pending.empty())
+		{
+			const auto Triangle = Pending.back();
+			Pending.pop_back();
+			Grown.Triangles.push_back(Triangle);
+
+			for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+			{
+				const auto Key = MakeEdgeKey(Welded[InIndices[Triangle * 3u + Corner]], Welded[InIndices[Triangle * 3u + (Corner + 1u) % 3u]]);
+				auto Neighbour = std::lower_bound(Edges.begin(), Edges.end(), std::pair {Key, 0u});
+
+				for (; Neighbour != Edges.end() && Neighbour->first == Key; ++Neighbour)
+				{
+					const auto Candidate = Neighbour->second;
+
+					// Degenerate triangles have no normal of their own and go along with any neighbour.
+					if (TriangleCharts[Candidate] != NoChart ||
+					    (Areas[Candidate] > 0.0f && DirectX::XMVectorGetX(DirectX::XMVector3Dot(DirectX::XMLoadFloat3(&Normals[Candidate]), Axis)) < ChartNormalCosine))
+					{
+						continue;
+					}
+
+					TriangleCharts[Candidate] = ChartIndex;
+					Pending.push_back(Candidate);
+				}
+			}
+		}
+
+		for (const auto Triangle : Grown.Triangles)
+		{
+			for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+			{
+				const auto Position = DirectX::XMLoadFloat3(&InPositions[InIndices[Triangle * 3u + Corner]]);
+				const auto ProjectedU = DirectX::XMVectorGetX(DirectX::XMVector3Dot(Position, DirectX::XMLoadFloat3(&Grown.U))) * InTexelsPerUnit;
+				const auto ProjectedV = DirectX::XMVectorGetX(DirectX::XMVector3Dot(Position, DirectX::XMLoadFloat3(&Grown.V))) * InTexelsPerUnit;
+				Grown.MinU = std::min(Grown.MinU, ProjectedU);
+				Grown.MinV = std::min(Grown.MinV, ProjectedV);
+				Grown.MaxU = std::max(Grown.MaxU, ProjectedU);
+				Grown.MaxV = std::max(Grown.MaxV, ProjectedV);
+			}
+		}
+	}
+
+	Unwrap Result;
+	Result.ChartNum = static_cast<unsigned int>(Charts.size());
+
+	// However far they shrink, every chart keeps a texel and its padding.
+	constexpr auto MinChartSize = 1u + 2u * ChartPadding;
+	if (Charts.empty() || static_cast<unsigned long long>(Charts.size()) * MinChartSize * MinChartSize > static_cast<unsigned long long>(MaxAtlasSize) * MaxAtlasSize)
+	{
+		return Result;
+	}
+
+	std::vector<unsigned int> PackOrder(Charts.size());
+	double ChartArea = 0.0;
+
+	for (unsigned int Index = 0u; Index < PackOrder.size(); ++Index)
+	{
+		PackOrder[Index] = Index;
+		ChartArea += (Charts[Index].MaxU - Charts[Index].MinU + 1.0f + 2.0f * ChartPadding) * (Charts[Index].MaxV - Charts[Index].MinV + 1.0f + 2.0f * ChartPadding);
+	}
+
+	std::sort(PackOrder.begin(), PackOrder.end(), [&Charts](const unsigned int InLeft, const unsigned int InRight)
+	{
+		return Charts[InLeft].MaxV - Charts[InLeft].MinV > Charts[InRight].MaxV - Charts[InRight].MinV;
+	});
+
+	// Shelves waste some of every row, the atlas starts a little larger than the charts and doubles until they fit, then the charts shrink.
+	auto Scale = 1.0f;
+	auto Size = std::max(MinAtlasSize, std::bit_ceil(static_cast<unsigned int>(std::ceil(std::sqrt(ChartArea * 1.25)))));
+
+	while (!PackCharts(Charts, PackOrder, Scale, std::min(Size, MaxAtlasSize)))
+	{
+		if (Size < MaxAtlasSize)
+		{
+			Size *= 2u;
+		}
+		else if (Scale > MinScale)
+		{
+			Scale *= ShrinkFactor;
+		}
+		else
+		{
+			return Result;
+		}
+	}
+
+	Result.Size = std::min(Size, MaxAtlasSize);
+
+	// A vertex in several charts is split into one for each.
+	std::unordered_map<uint64_t, unsigned int> SplitVertices;
+	Result.Indices.resize(InIndices.size());
+
+	for (unsigned int ChartIndex = 0u; ChartIndex < Charts.size(); ++ChartIndex)
+	{
+		const auto& Placed = Charts[ChartIndex];
+
+		for (const auto Triangle : Placed.Triangles)
+		{
+			for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+			{
+				const auto Source = InIndices[Triangle * 3u + Corner];
+				const auto [Found, bIsNew] = SplitVertices.try_emplace(static_cast<uint64_t>(ChartIndex) << 32u | Source, static_cast<unsigned int>(Result.SourceVertices.size()));
+
+				if (bIsNew)
+				{
+					const auto Position = DirectX::XMLoadFloat3(&InPositions[Source]);
+					const auto ProjectedU = DirectX::XMVectorGetX(DirectX::XMVector3Dot(Position, DirectX::XMLoadFloat3(&Placed.U))) * InTexelsPerUnit;
+					const auto ProjectedV = DirectX::XMVectorGetX(DirectX::XMVector3Dot(Position, DirectX::XMLoadFloat3(&Placed.V))) * InTexelsPerUnit;
+					Result.SourceVertices.push_back(Source);
+					Result.Texcoords.push_back({(static_cast<float>(Placed.X + ChartPadding) + 0.5f + (ProjectedU - Placed.MinU) * Scale) / static_cast<float>(Result.Size),
+					                            (static_cast<float>(Placed.Y + ChartPadding) + 0.5f + (ProjectedV - Placed.MinV) * Scale) / static_cast<float>(Result.Size)});
+				}
+
+				Result.Indices[Triangle * 3u + Corner] = Found->second;
+			}
+		}
+	}
+
+	return Result;
+}
+
+void Lightmapper::Scene::AddMesh(const std::span<const DirectX::XMFLOAT3> InPositions, const std::span<const unsigned int> InIndices, DirectX::FXMMATRIX InTransform)
+{
+	Corners.reserve(Corners.size() + InIndices.size());
+
+	for (const auto Index : InIndices)
+	{
+		DirectX::XMStoreFloat3(&Corners.emplace_back(), DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&InPositions[Index]), InTransform));
+	}
+}
+
+void Lightmapper::Scene::Build()
+{
+	// Every triangle has corners of its own, hits then name the triangle GetNormal reads.
+	std::vector<unsigned int> Indices(Corners.size());
+	std::iota(Indices.begin(), Indices.end(), 0u);
+	Triangles = TriangleBvh(Indices, Corners.data(), Corners.size(), sizeof(DirectX::XMFLOAT3));
+
+	if (!Corners.empty())
+	{
+		DirectX::BoundingBox SceneBounds;
+		DirectX::BoundingBox::CreateFromPoints(SceneBounds, Corners.size(), Corners.data(), sizeof(DirectX::XMFLOAT3));
+		Diagonal = 2.0f * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&SceneBounds.Extents)));
+	}
+}
+
+unsigned int Lightmapper::Scene::Trace(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, float& InOutDistance) const noexcept
+{
+	TriangleBvh::Hit Closest;
+	Closest.Distance = InOutDistance;
+
+	if (!Triangles.Intersect(InOrigin, InDirection, Closest))
+	{
+		return TriangleBvh::NoTriangle;
+	}
+
+	InOutDistance = Closest.Distance;
+	return Closest.Triangle;
+}
+
+bool Lightmapper::Scene::IsOccluded(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, const float InDistance) const noexcept
+{
+	return Triangles.IsOccluded(InOrigin, InDirection, InDistance);
+}
+
+DirectX::XMVECTOR Lightmapper::Scene::GetNormal(const unsigned int InTriangle) const noexcept
+{
+	const auto A = DirectX::XMLoadFloat3(&Corners[InTriangle * 3u]);
+	return DirectX::XMVector3Normalize(DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Corners[InTriangle * 3u + 1u]), A),
+	                                                           DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Corners[InTriangle * 3u + 2u]), A)));
+}
+
+bool Lightmapper::Bake(const Scene& InScene, const std::span<const DirectX::XMFLOAT3> InPositions, const std::span<const DirectX::XMFLOAT3> InNormals,
+                       const Unwrap& InUnwrap, const Settings& InSettings, const std::filesystem::path& InFileName)
+{
+	const auto Size = InUnwrap.Size;
+	const auto TexelNum = static_cast<size_t>(Size) * Size;
+	std::vector<Sample> Samples(TexelNum);
+
+	// Every triangle claims the texels around it, the one a texel's centre lies in or is nearest to wins.
+	for (size_t Triangle = 0u; Triangle < InUnwrap.Indices.size() / 3u; ++Triangle)
+	{
+		std::array<unsigned int, 3> Vertices;
+		std::array<DirectX::XMFLOAT2, 3> Corners;
+
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			Vertices[Corner] = InUnwrap.Indices[Triangle * 3u + Corner];
+			Corners[Corner] = {InUnwrap.Texcoords[Vertices[Corner]].x * static_cast<float>(Size), InUnwrap.Texcoords[Vertices[Corner]].y * static_cast<float>(Size)};
+		}
+
+		const auto FirstColumn = static_cast<int>(std::floor(std::min({Corners[0].x, Corners[1].x, Corners[2].x}) - ConservativeDistance));
+		const auto LastColumn = static_cast<int>(std::ceil(std::max({Corners[0].x, Corners[1].x, Corners[2].x}) + ConservativeDistance));
+		const auto FirstRow = static_cast<int>(std::floor(std::min({Corners[0].y, Corners[1].y, Corners[2].y}) - ConservativeDistance));
+		const auto LastRow = static_cast<int>(std::ceil(std::max({Corners[0].y, Corners[1].y, Corners[2].y}) + ConservativeDistance));
+
+		for (auto Row = std::max(FirstRow, 0); Row <= std::min(LastRow, static_cast<int>(Size) - 1); ++Row)
+		{
+			for (auto Column = std::max(FirstColumn, 0); Column <= std::min(LastColumn, static_cast<int>(Size) - 1); ++Column)
+			{
+				float Distance;
+				const auto Weights = FindNearestBarycentrics({static_cast<float>(Column) + 0.5f, static_cast<float>(Row) + 0.5f}, Corners, Distance);
+				auto& Claimed = Samples[static_cast<size_t>(Row) * Size + Column];
+
+				if (Distance > ConservativeDistance || Distance >= Claimed.Distance)
+				{
+					continue;
+				}
+
+				auto Position = DirectX::XMVectorZero();
+				auto Normal = DirectX::XMVectorZero();
+
+				for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+				{
+					const auto Weight = DirectX::XMVectorReplicate(Weights[Corner]);
+					Position = DirectX::XMVectorMultiplyAdd(DirectX::XMLoadFloat3(&InPositions[Vertices[Corner]]), Weight, Position);
+					Normal = DirectX::XMVectorMultiplyAdd(DirectX::XMLoadFloat3(&InNormals[Vertices[Corner]]), Weight, Normal);
+				}
+
+				DirectX::XMStoreFloat3(&Claimed.Position, Position);
+				DirectX::XMStoreFloat3(&Claimed.Normal, DirectX::XMVector3Normalize(Normal));
+				Claimed.Distance = Distance;
+			}
+		}
+	}
+
+	// Off the surface by a tenth of a texel, or the scene's own precision where that is coarser, so rays don't hit where they start.
+	const auto Offset = std::max(0.1f / InSettings.TexelsPerUnit, 1e-4f * InScene.GetDiagonal());
+	std::vector<DirectX::XMFLOAT3> Light(TexelNum, {0.0f, 0.0f, 0.0f});
+	std::vector<bool> Covered(TexelNum);
+
+	for (size_t Texel = 0u; Texel < TexelNum; ++Texel)
+	{
+		Covered[Texel] = Samples[Texel].Distance <= ConservativeDistance;
+	}
+
+	JobSystem::Get().ParallelFor(Size, 1u, [&](const size_t InRow)
+	{
+		for (size_t Texel = InRow * Size; Texel < (InRow + 1u) * Size; ++Texel)
+		{
+			if (Covered[Texel])
+			{
+				const auto Turn = static_cast<float>((static_cast<uint32_t>(Texel) * 2654435769u) >> 8u) / 16777216.0f;
+				DirectX::XMStoreFloat3(&Light[Texel], BakeTexel(InScene, InSettings, Samples[Texel], Offset, Turn));
+			}
+		}
+	});
+
+	// The padding takes the average of its covered neighbours, a ring at a time.
+	for (unsigned int Ring = 0u; Ring < ChartPadding; ++Ring)
+	{
+		auto Grown = Covered;
+
+		for (unsigned int Row = 0u; Row < Size; ++Row)
+		{
+			for (unsigned int Column = 0u; Column < Size; ++Column)
+			{
+				const auto Texel = static_cast<size_t>(Row) * Size + Column;
+
+				if (Covered[Texel])
+				{
+					continue;
+				}
+
+				auto Sum = DirectX::XMVectorZero();
+				auto NeighbourNum = 0u;
+
+				for (auto NeighbourRow = Row > 0u ? Row - 1u : 0u; NeighbourRow <= std::min(Row + 1u, Size - 1u); ++NeighbourRow)
+				{
+					for (auto NeighbourColumn = Column > 0u ? Column - 1u : 0u; NeighbourColumn <= std::min(Column + 1u, Size - 1u); ++NeighbourColumn)
+					{
+						if (const auto Neighbour = static_cast<size_t>(NeighbourRow) * Size + NeighbourColumn; Covered[Neighbour])
+						{
+							Sum = DirectX::XMVectorAdd(Sum, DirectX::XMLoadFloat3(&Light[Neighbour]));
+							++NeighbourNum;
+						}
+					}
+				}
+
+				if (NeighbourNum > 0u)
+				{
+					DirectX::XMStoreFloat3(&Light[Texel], DirectX::XMVectorScale(Sum, 1.0f / static_cast<float>(NeighbourNum)));
+					Grown[Texel] = true;
+				}
+			}
+		}
+
+		Covered = std::move(Grown);
+	}
+
+	std::vector<TextureCooker::Texel> Encoded(TexelNum);
+	std::transform(Light.begin(), Light.end(), Encoded.begin(), EncodeRGBM);
+
+	return TextureCooker::WriteColorMap(InFileName, Size, Size, Encoded);
+}
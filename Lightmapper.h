@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <filesystem>
+#include <span>
+#include <vector>
+#include "TriangleBvh.h"
+
+/**
+ * Baked lighting of static meshes at import, from point lights the model's import profile places, see ImportProfile.
+ * Each mesh is unwrapped into charts of connected triangles facing about the same way, each projected flat along its first
+ * triangle's normal and packed into the mesh's own atlas at a fixed number of texels per unit. The direct light of every texel is
+ * traced against every static mesh of the model, the bounced light from rays over its hemisphere lit the same way where they hit, and
+ * the sum is written RGBM encoded as BC7 beside the source, which the Lightmapped material variants add to their dynamic lights.
+ */
+namespace Lightmapper
+{
+	// Falls off with the inverse square of the distance, smoothly down to nothing at Range.
+	struct Light
+	{
+		DirectX::XMFLOAT3 Position;
+		// Premultiplied by its strength.
+		DirectX::XMFLOAT3 Color;
+		float Range;
+	};
+
+	struct Settings
+	{
+		// Nothing is baked while zero.
+		float TexelsPerUnit {0.0f};
+		// Zero bakes the direct light only.
+		int IndirectRayNum {64};
+		std::vector<Light> Lights;
+	};
+
+	// The RGBM range, the brightest light a lightmap holds before it clips. The material shaders decode with the same.
+	constexpr float MaxValue {8.0f};
+	// Charts lie this many texels apart and the empty texels between them are filled from their edges, so filtering never reads the background.
+	constexpr unsigned int ChartPadding {2u};
+	constexpr unsigned int MaxAtlasSize {2048u};
+
+	// Second texture coordinates of one mesh, over vertices split where charts meet.
+	struct Unwrap
+	{
+		// The source vertex every vertex of the unwrap was split from.
+		std::vector<unsigned int> SourceVertices;
+		// In [0, 1] of the atlas.
+		std::vector<DirectX::XMFLOAT2> Texcoords;
+		std::vector<unsigned int> Indices;
+		unsigned int Size {0u};
+		unsigned int ChartNum {0u};
+	};
+
+	// Charts are scaled down together when they don't fit MaxAtlasSize at InTexelsPerUnit. A mesh of too many charts to fit
+	// at all is left without, at a Size of zero.
+	[[nodiscard]] Unwrap UnwrapMesh(std::span<const DirectX::XMFLOAT3> InPositions, std::span<const unsigned int> InIndices, float InTexelsPerUnit);
+
+	/** The triangles of a model's static meshes in its own space, which the baked light is cast onto and bounces between. */
+	class Scene
+	{
+	public:
+		void AddMesh(std::span<const DirectX::XMFLOAT3> InPositions, std::span<const unsigned int> InIndices, DirectX::FXMMATRIX InTransform);
+		// After every mesh is added.
+		void Build();
+
+		// The closest triangle ahead within InOutDistance, which ends up at the hit, or TriangleBvh::NoTriangle.
+		[[nodiscard]] unsigned int Trace(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, float& InOutDistance) const noexcept;
+		// Whether any triangle lies ahead within InDistance, cheaper than finding the closest.
+		[[nodiscard]] bool IsOccluded(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, float InDistance) const noexcept;
+
+		[[nodiscard]] DirectX::XMVECTOR GetNormal(unsigned int InTriangle) const noexcept;
+
+		// Of the box around every triangle, what offsets and ray lengths are measured against.
+		[[nodiscard]] float GetDiagonal() const noexcept
+		{
+			return Diagonal;
+		}
+
+	private:
+		std::vector<DirectX::XMFLOAT3> Corners;
+		TriangleBvh Triangles;
+		float Diagonal {0.0f};
+	};
+
+	// InPositions and InNormals per vertex of the unwrap, already in the scene's space. False when the map couldn't be written.
+	bool Bake(const Scene& InScene, std::span<const DirectX::XMFLOAT3> InPositions, std::span<const DirectX::XMFLOAT3> InNormals, const Unwrap& InUnwrap,
+	          const Settings& InSettings, const std::filesystem::path& InFileName);
+}
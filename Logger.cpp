@@ -0,0 +1,442 @@
+﻿#include "Logger.h"
+#include "EngineWin.h"
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	// Written at the start of every message, its arguments follow.
+	struct Record
+	{
+		// Null where the rest of the ring was skipped because the message didn't fit before its end.
+		const char* Format;
+		const char* File;
+		Logger::Clock::rep Time;
+		uint32_t Line;
+		// Of the whole message, rounded up to RecordAlignment.
+		uint32_t Bytes;
+		LogLevel Level;
+		uint8_t ArgumentNum;
+	};
+
+	constexpr size_t RecordAlignment {alignof(Record)};
+	constexpr size_t RingMask {Logger::RingBytes - 1u};
+	static_assert((Logger::RingBytes & RingMask) == 0u, "Ring positions wrap with a mask");
+	static_assert(sizeof(Record::Format) <= RecordAlignment, "A skipped end always has room for the null format");
+
+	// Longest wait between drains when nothing wakes the writer sooner.
+	constexpr std::chrono::milliseconds DrainInterval {100};
+
+	// Written by its own thread alone, read by the writer, both positions only grow.
+	struct ThreadRing
+	{
+		std::unique_ptr<std::byte[]> Bytes {std::make_unique<std::byte[]>(Logger::RingBytes)};
+		alignas(64) std::atomic<uint64_t> Written {0u};
+		alignas(64) std::atomic<uint64_t> Read {0u};
+		// The writer's position as the logging thread last saw it, reloaded only once the ring looks full.
+		uint64_t KnownRead {0u};
+		std::atomic<uint64_t> DroppedNum {0u};
+		// In the order threads first logged.
+		unsigned int ThreadId {0u};
+	};
+
+	struct RingRegistry
+	{
+		// Only taken when a thread logs for the first time and by the writer.
+		std::mutex Mutex;
+		// Kept after their threads exit, so what they logged last is still written.
+		std::vector<std::unique_ptr<ThreadRing>> Rings;
+	};
+
+	thread_local ThreadRing* CurrentRing {nullptr};
+
+	RingRegistry& GetRingRegistry() noexcept
+	{
+		static RingRegistry Registry;
+		return Registry;
+	}
+
+	ThreadRing& GetThreadRing()
+	{
+		if (!CurrentRing)
+		{
+			auto& Registry = GetRingRegistry();
+			std::lock_guard Lock(Registry.Mutex);
+			CurrentRing = Registry.Rings.emplace_back(std::make_unique<ThreadRing>()).get();
+			CurrentRing->ThreadId = static_cast<unsigned int>(Registry.Rings.size());
+		}
+
+		return *CurrentRing;
+	}
+
+	[[nodiscard]] size_t GetArgumentBytes(const Logger::Argument& InArgument) noexcept
+	{
+		return sizeof(Logger::Argument::Type) + (InArgument.ArgumentType == Logger::Argument::Type::String ? sizeof(uint32_t) + InArgument.Length : sizeof(uint64_t));
+	}
+
+	template <typename TValue>
+	void AppendNumber(std::string& InOutText, const TValue InValue, const int InBase = 10)
+	{
+		char Digits[32];
+		std::to_chars_result Result;
+
+		if constexpr (std::is_floating_point_v<TValue>)
+		{
+			Result = std::to_chars(Digits, Digits + sizeof(Digits), InValue);
+		}
+		else
+		{
+			Result = std::to_chars(Digits, Digits + sizeof(Digits), InValue, InBase);
+		}
+
+		InOutText.append(Digits, Result.ptr);
+	}
+
+	// Reads the argument at InBytes onto the end of InOutText, returns the bytes it took.
+	size_t AppendArgument(std::string& InOutText, const std::byte* InBytes)
+	{
+		using Type = Logger::Argument::Type;
+
+		Type ArgumentType;
+		std::memcpy(&ArgumentType, InBytes, sizeof(ArgumentType));
+		InBytes += sizeof(ArgumentType);
+
+		if (ArgumentType == Type::String)
+		{
+			uint32_t Length;
+			std::memcpy(&Length, InBytes, sizeof(Length));
+			InOutText.append(reinterpret_cast<const char*>(InBytes + sizeof(Length)), Length);
+			return sizeof(ArgumentType) + sizeof(Length) + Length;
+		}
+
+		uint64_t Bits;
+		std::memcpy(&Bits, InBytes, sizeof(Bits));
+
+		switch (ArgumentType)
+		{
+		case Type::Signed:
+			AppendNumber(InOutText, static_cast<int64_t>(Bits));
+			break;
+		case Type::Unsigned:
+			AppendNumber(InOutText, Bits);
+			break;
+		case Type::Float:
+			AppendNumber(InOutText, std::bit_cast<float>(static_cast<uint32_t>(Bits)));
+			break;
+		case Type::Double:
+			AppendNumber(InOutText, std::bit_cast<double>(Bits));
+			break;
+		case Type::Bool:
+			InOutText += Bits ? "true" : "false";
+			break;
+		case Type::Pointer:
+			InOutText += "0x";
+			AppendNumber(InOutText, Bits, 16);
+			break;
+		default:
+			break;
+		}
+
+		return sizeof(ArgumentType) + sizeof(Bits);
+	}
+
+	// Replaces each {} with the next argument, placeholders past the last argument are kept as they are.
+	void AppendMessage(std::string& InOutText, const Record& InRecord, const std::byte* InArguments)
+	{
+		unsigned int ArgumentIndex = 0u;
+
+		for (const char* Character = InRecord.Format; *Character; ++Character)
+		{
+			if ((Character[0] == '{' && Character[1] == '{') || (Character[0] == '}' && Character[1] == '}'))
+			{
+				InOutText += *Character++;
+			}
+			else if (Character[0] == '{' && Character[1] == '}' && ArgumentIndex < InRecord.ArgumentNum)
+			{
+				InArguments += AppendArgument(InOutText, InArguments);
+				++ArgumentIndex;
+				++Character;
+			}
+			else
+			{
+				InOutText += *Character;
+			}
+		}
+	}
+
+	[[nodiscard]] const char* GetLevelName(const LogLevel InLevel) noexcept
+	{
+		switch (InLevel)
+		{
+		case LogLevel::Warning:
+			return "warning";
+		case LogLevel::Error:
+			return "error";
+		default:
+			return "info";
+		}
+	}
+}
+
+Logger::Logger(const char* InFileName)
+	: File(InFileName, std::ios::trunc)
+{
+	assert(!Instance.load() && "Only one Logger may exist");
+	Thread = std::thread(&Logger::ThreadLoop, this);
+	Instance.store(this, std::memory_order_release);
+}
+
+Logger::~Logger()
+{
+	Instance.store(nullptr, std::memory_order_release);
+
+	{
+		std::lock_guard Lock(Mutex);
+		bIsStopping = true;
+	}
+
+	WakeUp.notify_one();
+	Thread.join();
+}
+
+void Logger::Flush()
+{
+	auto* const Current = Instance.load(std::memory_order_acquire);
+
+	if (!Current)
+	{
+		return;
+	}
+
+	std::unique_lock Lock(Current->Mutex);
+	const auto Ticket = ++Current->RequestedFlushNum;
+	Current->bIsWakeRequested = true;
+	Current->WakeUp.notify_one();
+	Current->Flushed.wait(Lock, [Current, Ticket]
+	{
+		return Current->CompletedFlushNum >= Ticket;
+	});
+}
+
+uint64_t Logger::GetDroppedNum() noexcept
+{
+	auto& Registry = GetRingRegistry();
+	std::lock_guard Lock(Registry.Mutex);
+	uint64_t DroppedNum = 0u;
+
+	for (const auto& Ring : Registry.Rings)
+	{
+		DroppedNum += Ring->DroppedNum.load(std::memory_order_relaxed);
+	}
+
+	return DroppedNum;
+}
+
+void Logger::Push(const LogLevel InLevel, const char* InFile, const int InLine, const char* InFormat, const std::span<const Argument> InArguments) noexcept
+{
+	auto& Ring = GetThreadRing();
+
+	size_t Bytes = sizeof(Record);
+
+	for (const auto& Captured : InArguments)
+	{
+		Bytes += GetArgumentBytes(Captured);
+	}
+
+	Bytes = (Bytes + RecordAlignment - 1u) & ~(RecordAlignment - 1u);
+
+	// Positions are bytes, a message that doesn't fit before the ring's end starts over at its beginning.
+	const auto Written = Ring.Written.load(std::memory_order_relaxed);
+	const auto Offset = static_cast<size_t>(Written & RingMask);
+	const auto SkippedBytes = Logger::RingBytes - Offset < Bytes ? Logger::RingBytes - Offset : 0u;
+	const auto End = Written + SkippedBytes + Bytes;
+
+	if (End - Ring.KnownRead > Logger::RingBytes)
+	{
+		Ring.KnownRead = Ring.Read.load(std::memory_order_acquire);
+
+		if (End - Ring.KnownRead > Logger::RingBytes)
+		{
+			Ring.DroppedNum.store(Ring.DroppedNum.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	auto* const RingBytes = Ring.Bytes.get();
+
+	if (SkippedBytes > 0u)
+	{
+		constexpr const char* Skipped {nullptr};
+		std::memcpy(RingBytes + Offset, &Skipped, sizeof(Skipped));
+	}
+
+	auto* Destination = RingBytes + ((Written + SkippedBytes) & RingMask);
+	const Record Header {InFormat, InFile, Clock::now().time_since_epoch().count(), static_cast<uint32_t>(InLine), static_cast<uint32_t>(Bytes), InLevel,
+	                     static_cast<uint8_t>(InArguments.size())};
+	std::memcpy(Destination, &Header, sizeof(Header));
+	Destination += sizeof(Header);
+
+	for (const auto& Captured : InArguments)
+	{
+		std::memcpy(Destination, &Captured.ArgumentType, sizeof(Captured.ArgumentType));
+		Destination += sizeof(Captured.ArgumentType);
+
+		if (Captured.ArgumentType == Argument::Type::String)
+		{
+			std::memcpy(Destination, &Captured.Length, sizeof(Captured.Length));
+			std::memcpy(Destination + sizeof(Captured.Length), Captured.Text, Captured.Length);
+			Destination += sizeof(Captured.Length) + Captured.Length;
+		}
+		else
+		{
+			std::memcpy(Destination, &Captured.Bits, sizeof(Captured.Bits));
+			Destination += sizeof(Captured.Bits);
+		}
+	}
+
+	Ring.Written.store(End, std::memory_order_release);
+
+	// Errors are rare enough to pay for the lock.
+	if (InLevel == LogLevel::Error)
+	{
+		{
+			std::lock_guard Lock(Mutex);
+			bIsWakeRequested = true;
+		}
+
+		WakeUp.notify_one();
+	}
+}
+
+void Logger::ThreadLoop()
+{
+	std::unique_lock Lock(Mutex);
+
+	while (true)
+	{
+		WakeUp.wait_for(Lock, DrainInterval, [this]
+		{
+			return bIsWakeRequested || bIsStopping;
+		});
+
+		// Whatever was logged before these were asked for is in the rings by now.
+		const auto FlushNum = RequestedFlushNum;
+		const auto bWasStopping = bIsStopping;
+		bIsWakeRequested = false;
+
+		Lock.unlock();
+		Drain();
+		Lock.lock();
+
+		CompletedFlushNum = FlushNum;
+		Flushed.notify_all();
+
+		if (bWasStopping)
+		{
+			return;
+		}
+	}
+}
+
+void Logger::Drain()
+{
+	struct Line
+	{
+		Clock::rep Time;
+		size_t First;
+		size_t Length;
+	};
+
+	std::vector<ThreadRing*> Rings;
+	{
+		auto& Registry = GetRingRegistry();
+		std::lock_guard Lock(Registry.Mutex);
+
+		for (const auto& Ring : Registry.Rings)
+		{
+			Rings.push_back(Ring.get());
+		}
+	}
+
+	Output.clear();
+	std::vector<Line> Lines;
+	uint64_t DroppedNum = 0u;
+	char TimeDigits[32];
+
+	for (auto* const Ring : Rings)
+	{
+		auto Read = Ring->Read.load(std::memory_order_relaxed);
+		const auto Written = Ring->Written.load(std::memory_order_acquire);
+		const auto* const RingBytes = Ring->Bytes.get();
+
+		while (Read < Written)
+		{
+			const auto* const Source = RingBytes + (Read & RingMask);
+			const char* Format;
+			std::memcpy(&Format, Source, sizeof(Format));
+
+			if (!Format)
+			{
+				Read += Logger::RingBytes - (Read & RingMask);
+				continue;
+			}
+
+			Record Header;
+			std::memcpy(&Header, Source, sizeof(Header));
+
+			// Laid out like the compiler's own diagnostics, so the debugger's output window jumps to the source.
+			const auto First = Output.size();
+			const std::chrono::duration<double> Since = Clock::time_point {Clock::duration {Header.Time}} - Start;
+			Output += Header.File;
+			Output += '(';
+			AppendNumber(Output, Header.Line);
+			Output += "): ";
+			Output += GetLevelName(Header.Level);
+			Output += " [";
+			const auto Seconds = std::to_chars(TimeDigits, TimeDigits + sizeof(TimeDigits), Since.count(), std::chars_format::fixed, 3);
+			Output.append(TimeDigits, Seconds.ptr);
+			Output += " s, thread ";
+			AppendNumber(Output, Ring->ThreadId);
+			Output += "] ";
+			AppendMessage(Output, Header, Source + sizeof(Header));
+			Output += '\n';
+			Lines.push_back({Header.Time, First, Output.size() - First});
+
+			Read += Header.Bytes;
+		}
+
+		// The logging thread may reuse the bytes once this is stored, everything was copied out of them above.
+		Ring->Read.store(Read, std::memory_order_release);
+		DroppedNum += Ring->DroppedNum.load(std::memory_order_relaxed);
+	}
+
+	// Each ring is in order already, across threads the lines go by the time they were logged at.
+	std::stable_sort(Lines.begin(), Lines.end(), [](const Line& InLeft, const Line& InRight)
+	{
+		return InLeft.Time < InRight.Time;
+	});
+
+	std::string Text;
+
+	for (const auto& [Time, First, Length] : Lines)
+	{
+		Text.assign(Output, First, Length);
+		File << Text;
+		OutputDebugStringA(Text.c_str());
+	}
+
+	if (DroppedNum > ReportedDroppedNum)
+	{
+		Text = "Logger: ";
+		AppendNumber(Text, DroppedNum - ReportedDroppedNum);
+		Text += " messages dropped on full rings\n";
+		File << Text;
+		OutputDebugStringA(Text.c_str());
+		ReportedDroppedNum = DroppedNum;
+	}
+
+	File.flush();
+}
@@ -0,0 +1,185 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// Each {} in the format, which must be a string literal, is replaced by the next argument. {{ and }} stand for braces.
+#define LOG_INFO(...) Logger::Write(LogLevel::Info, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_WARNING(...) Logger::Write(LogLevel::Warning, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_ERROR(...) Logger::Write(LogLevel::Error, __FILE__, __LINE__, __VA_ARGS__)
+
+enum class LogLevel : uint8_t
+{
+	Info,
+	Warning,
+	// Also wakes the writer, so it is on disk soon after even if the process dies right after.
+	Error
+};
+
+/**
+ * Asynchronous log, so logging on the render thread or a worker never waits on the console, the debugger or the disk.
+ * A message is only its format, its source location and its arguments in binary, copied into a ring only the logging
+ * thread writes to. Strings are copied too, everything else is formatted later by the writer thread, which drains every
+ * thread's ring a few times a second, orders what it found by time and writes it to Engine.log and the debugger output.
+ * A full ring drops the message and counts it instead of blocking, the writer reports how many were lost.
+ * Owned by App and declared before everything else there, so it outlives whatever logs. Without one, messages are dropped.
+ */
+class Logger
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Per thread, messages beyond it before the writer's next drain are dropped.
+	static constexpr size_t RingBytes {256u * 1024u};
+	// Longer strings are cut, so one message never takes over a ring.
+	static constexpr size_t MaxStringBytes {2048u};
+
+	// A string literal, checked at compile time, so the writer can still read it long after the call.
+	class Format
+	{
+	public:
+		template <size_t TLength>
+		consteval Format(const char (&InText)[TLength]) noexcept
+			: Text(InText)
+		{
+		}
+
+		[[nodiscard]] const char* Get() const noexcept
+		{
+			return Text;
+		}
+
+	private:
+		const char* Text;
+	};
+
+	// What the writer needs to format one argument, taken apart from its type on the logging thread.
+	struct Argument
+	{
+		enum class Type : uint8_t
+		{
+			Signed,
+			Unsigned,
+			Float,
+			Double,
+			Bool,
+			Pointer,
+			String
+		};
+
+		Type ArgumentType {Type::Unsigned};
+		uint64_t Bits {0u};
+		const char* Text {nullptr};
+		uint32_t Length {0u};
+	};
+
+	explicit Logger(const char* InFileName = "Engine.log");
+	Logger(const Logger&) = delete;
+	Logger(Logger&&) = delete;
+	Logger& operator=(const Logger&) = delete;
+	Logger& operator=(Logger&&) = delete;
+	// Writes whatever is still queued.
+	~Logger();
+
+	// Through the LOG_ macros, which fill in the source location.
+	template <typename... TArguments>
+	static void Write(const LogLevel InLevel, const char* InFile, const int InLine, const Format InFormat, const TArguments&... InArguments) noexcept
+	{
+		if (auto* const Current = Instance.load(std::memory_order_acquire))
+		{
+			// One spare, so the array isn't empty for messages without arguments.
+			const Argument Arguments[] = {Capture(InArguments)..., Argument {}};
+			Current->Push(InLevel, InFile, InLine, InFormat.Get(), std::span(Arguments, sizeof...(TArguments)));
+		}
+	}
+
+	// Waits until everything logged before the call is written, before showing an error or on a crash's way out.
+	static void Flush();
+
+	// Messages dropped so far because a ring was full.
+	[[nodiscard]] static uint64_t GetDroppedNum() noexcept;
+
+private:
+	template <typename TValue>
+	[[nodiscard]] static Argument Capture(const TValue& InValue) noexcept
+	{
+		using Type = Argument::Type;
+
+		if constexpr (std::is_same_v<TValue, bool>)
+		{
+			return {Type::Bool, InValue ? 1u : 0u};
+		}
+		else if constexpr (std::is_enum_v<TValue>)
+		{
+			return Capture(static_cast<std::underlying_type_t<TValue>>(InValue));
+		}
+		else if constexpr (std::signed_integral<TValue>)
+		{
+			return {Type::Signed, static_cast<uint64_t>(static_cast<int64_t>(InValue))};
+		}
+		else if constexpr (std::unsigned_integral<TValue>)
+		{
+			return {Type::Unsigned, static_cast<uint64_t>(InValue)};
+		}
+		else if constexpr (std::is_same_v<TValue, float>)
+		{
+			return {Type::Float, std::bit_cast<uint32_t>(InValue)};
+		}
+		else if constexpr (std::is_same_v<TValue, double>)
+		{
+			return {Type::Double, std::bit_cast<uint64_t>(InValue)};
+		}
+		else if constexpr (std::is_convertible_v<const TValue&, const char*>)
+		{
+			const char* const Text = InValue;
+			return Text ? Capture(std::string_view {Text}) : Argument {Type::Pointer, 0u};
+		}
+		else if constexpr (std::is_convertible_v<const TValue&, std::string_view>)
+		{
+			const std::string_view Text {InValue};
+			return {Type::String, 0u, Text.data(), static_cast<uint32_t>(std::min(Text.size(), MaxStringBytes))};
+		}
+		else
+		{
+			static_assert(std::is_pointer_v<TValue>, "Logged arguments are numbers, enums, strings or pointers");
+			return {Type::Pointer, reinterpret_cast<uintptr_t>(InValue)};
+		}
+	}
+
+	void Push(LogLevel InLevel, const char* InFile, int InLine, const char* InFormat, std::span<const Argument> InArguments) noexcept;
+	void ThreadLoop();
+	// Formats and writes everything the rings hold, on the writer thread.
+	void Drain();
+
+private:
+	static inline std::atomic<Logger*> Instance {nullptr};
+
+	std::ofstream File;
+	Clock::time_point Start {Clock::now()};
+	// Only touched by the writer thread.
+	std::string Output;
+	uint64_t ReportedDroppedNum {0u};
+
+	std::mutex Mutex;
+	std::condition_variable WakeUp;
+	std::condition_variable Flushed;
+	// Flushes asked for and done, each drain completes every flush asked for before it began.
+	uint64_t RequestedFlushNum {0u};
+	uint64_t CompletedFlushNum {0u};
+	bool bIsWakeRequested {false};
+	bool bIsStopping {false};
+
+	// Started last, once everything it uses exists.
+	std::thread Thread;
+};
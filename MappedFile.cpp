@@ -0,0 +1,47 @@
+﻿#define FULL_WINDOW
+#include "MappedFile.h"
+#include "EngineWin.h"
+
+MappedFile::MappedFile(const std::filesystem::path& InPath) noexcept
+{
+	const auto OpenedHandle = CreateFileW(InPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (OpenedHandle == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	FileHandle = OpenedHandle;
+
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(FileHandle, &FileSize) || FileSize.QuadPart == 0)
+	{
+		return;
+	}
+
+	MappingHandle = CreateFileMappingW(FileHandle, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+	if (!MappingHandle)
+	{
+		return;
+	}
+
+	Data = static_cast<const std::byte*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0u, 0u, 0u));
+	Size = Data ? static_cast<size_t>(FileSize.QuadPart) : 0u;
+}
+
+MappedFile::~MappedFile()
+{
+	if (Data)
+	{
+		UnmapViewOfFile(Data);
+	}
+
+	if (MappingHandle)
+	{
+		CloseHandle(MappingHandle);
+	}
+
+	if (FileHandle)
+	{
+		CloseHandle(FileHandle);
+	}
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <cstddef>
+#include <filesystem>
+
+// Read-only view of a whole file, empty when the file is missing or zero-sized.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::filesystem::path& InPath) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile&&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile& operator=(MappedFile&&) = delete;
+	~MappedFile();
+
+	[[nodiscard]] bool IsValid() const noexcept
+	{
+		return Data != nullptr;
+	}
+
+	[[nodiscard]] const std::byte* GetData() const noexcept
+	{
+		return Data;
+	}
+
+	[[nodiscard]] size_t GetSize() const noexcept
+	{
+		return Size;
+	}
+
+private:
+	// Win32 handles, null when not open, so includers don't need the file APIs the lean Windows headers leave out.
+	void* FileHandle {nullptr};
+	void* MappingHandle {nullptr};
+	const std::byte* Data {nullptr};
+	size_t Size {0u};
+};
@@ -0,0 +1,322 @@
+﻿#include "Material.h"
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <iterator>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include "BindManager.h"
+#include "DrawPacket.h"
+#include "Graphics.h"
+#include "MaterialTable.h"
+#include "PixelShader.h"
+#include "Texture.h"
+#include "VirtualTextureCache.h"
+
+namespace
+{
+	// Richest first, FindPermutation takes the first one whose features are all present.
+	// Only these variants are compiled into the shader bundle, see the ShaderVariant items in Engine.vcxproj.
+	constexpr Material::Permutation Permutations[] =
+	{
+		{Material::DiffuseMapped | Material::NormalMapped | Material::SpecularMapped | Material::PackedSpecular | Material::TextureArrays,
+		 Material::DiffuseMapped | Material::NormalMapped, 1.0f},
+		{Material::DiffuseMapped | Material::NormalMapped | Material::SpecularMapped | Material::PackedSpecular, Material::DiffuseMapped | Material::NormalMapped, 1.0f},
+		{Material::DiffuseMapped | Material::NormalMapped | Material::SpecularMapped | Material::TextureArrays, Material::DiffuseMapped | Material::NormalMapped, 1.0f},
+		{Material::DiffuseMapped | Material::NormalMapped | Material::SpecularMapped, Material::DiffuseMapped | Material::NormalMapped, 1.0f},
+		{Material::DiffuseMapped | Material::NormalMapped | Material::TextureArrays, Material::DiffuseMapped | Material::NormalMapped, 0.18f},
+		{Material::DiffuseMapped | Material::NormalMapped, Material::DiffuseMapped | Material::NormalMapped, 0.18f},
+		{Material::DiffuseMapped | Material::TextureArrays, Material::DiffuseMapped, 1.0f},
+		{Material::DiffuseMapped, Material::DiffuseMapped, 1.0f},
+		{0u, 0u, 0.18f}
+	};
+
+	std::atomic<unsigned int> NextId {0u};
+
+	UINT GetMapPacking(const DXGI_FORMAT InFormat) noexcept
+	{
+		switch (InFormat)
+		{
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_R16_FLOAT:
+			return MaterialTable::MapPackedGrey;
+		case DXGI_FORMAT_R8G8_UNORM:
+			return MaterialTable::MapPackedGreyAlpha;
+		default:
+			return MaterialTable::MapUnpacked;
+		}
+	}
+
+	// The ID of the first material created with each set of bound state, see Material::GetBatchId.
+	std::mutex BatchMutex;
+	std::unordered_map<uint64_t, unsigned int> BatchIds;
+}
+
+Material::Material(const Graphics& InGraphics, const Description& InDescription)
+	: MyDescription(InDescription)
+	, MyPermutation(&FindPermutation(GetFeatures(InDescription)))
+	, Id(NextId++)
+{
+	// Blended materials only ever draw weighted into the transparency targets. Every build samples the same maps through
+	// the same slots, so the bindings below serve them all.
+	// The G-buffer build only writes the surface, the lighting it would narrow runs in the deferred pass.
+	const auto LightingFeatures = MyPermutation->Features | (InGraphics.UsesHalfPrecision() ? HalfPrecision : 0u) | (IsLightmapped() ? Lightmapped : 0u);
+	MyPixelShader = PixelShader::Resolve(InGraphics, IsBlended() ? TransparentPixelShaderName : PixelShaderName, LightingFeatures);
+
+	// Cut-out texels are clipped in the depth pass alone, the shaded builds only draw where it left their depth.
+	if (InDescription.bIsAlphaTested && !IsBlended() && (MyPermutation->Features & DiffuseMapped))
+	{
+		const auto AlphaTestFeatures = MyPermutation->Features & (DiffuseMapped | NormalMapped | TextureArrays);
+		MyAlphaTestPixelShader = PixelShader::Resolve(InGraphics, AlphaTestPixelShaderName, AlphaTestFeatures | (IsLightmapped() ? Lightmapped : 0u));
+	}
+
+	if (!IsBlended() && !IsLightmapped() && !IsAlphaTested())
+	{
+		MyGBufferPixelShader = PixelShader::Resolve(InGraphics, GBufferPixelShaderName, MyPermutation->Features);
+	}
+
+	const auto& Reflection = MyPixelShader->GetReflection();
+
+	// Maps the variant doesn't sample were stripped from it and are never loaded.
+	const std::tuple<const char*, const std::string*, const std::vector<std::string>*> Maps[]
+	{
+		{"DiffuseMap", &InDescription.DiffuseMap, &InDescription.DiffuseArray},
+		{"NormalMap", &InDescription.NormalMap, &InDescription.NormalArray},
+		{"SpecularMap", &InDescription.SpecularMap, &InDescription.SpecularArray}
+	};
+
+	UINT Slices[std::size(Maps)] {};
+	UINT PackedMaps = 0u;
+	const bool bUsesTextureArrays = MyPermutation->Features & TextureArrays;
+	// The forward and G-buffer builds of opaque diffuse mapped materials have a VIRTUAL_TEXTURED variant.
+	auto* const Cache = InGraphics.GetVirtualTextureCache();
+	const bool bIsVirtual = Cache && MyGBufferPixelShader && !bUsesTextureArrays && (MyPermutation->Features & DiffuseMapped);
+
+	for (size_t Index = 0u; Index < std::size(Maps); ++Index)
+	{
+		const auto& [Name, FileName, ArrayFileNames] = Maps[Index];
+		const auto* Binding = Reflection.FindTexture(Name);
+
+		if (!Binding)
+		{
+			continue;
+		}
+
+		if (bUsesTextureArrays)
+		{
+			assert(!ArrayFileNames->empty() && "Packed materials need an array for every map");
+
+			const auto& [Array, Slot] = MapArrays.emplace_back(TextureArray::Resolve(InGraphics, *ArrayFileNames), Binding->Slot);
+			Slices[Index] = Array->FindSlice(*FileName);
+			PackedMaps |= GetMapPacking(Array->GetFormat()) << (static_cast<UINT>(Index) * 2u);
+		}
+		else
+		{
+			const auto& [MapTexture, Slot] = Textures.emplace_back(Texture::Resolve(InGraphics, *FileName, true, bIsVirtual, true), Binding->Slot);
+			PackedMaps |= GetMapPacking(MapTexture->GetFormat()) << (static_cast<UINT>(Index) * 2u);
+		}
+	}
+
+	// The variants read the same maps through the same slots, so the reflection above holds for them too.
+	if (bIsVirtual)
+	{
+		std::vector<Texture*> VirtualMaps;
+
+		for (const auto& [MaterialTexture, Slot] : Textures)
+		{
+			if (MaterialTexture->IsVirtual())
+			{
+				VirtualMaps.push_back(MaterialTexture.get());
+			}
+		}
+
+		if (!VirtualMaps.empty())
+		{
+			MyPixelShader = PixelShader::Resolve(InGraphics, PixelShaderName, LightingFeatures | VirtualTextured);
+			MyGBufferPixelShader = PixelShader::Resolve(InGraphics, GBufferPixelShaderName, MyPermutation->Features | VirtualTextured);
+			MyFeedbackPixelShader = PixelShader::Resolve(InGraphics, FeedbackPixelShaderName, MyPermutation->Features & (DiffuseMapped | NormalMapped));
+			VirtualTextures = Cache;
+			VirtualTextures->RegisterMaterial(Id, std::move(VirtualMaps));
+		}
+	}
+
+	// Baked for the whole mesh at its full size, there is nothing to stream.
+	if (const auto* Binding = Reflection.FindTexture("Lightmap"); Binding && IsLightmapped())
+	{
+		Textures.emplace_back(Texture::Resolve(InGraphics, InDescription.LightmapMap), Binding->Slot);
+	}
+
+	if (const auto* Binding = Reflection.FindSampler("Sampler"))
+	{
+		MySampler = Sampler::Resolve(InGraphics, InDescription.Sampling);
+		SamplerSlot = Binding->Slot;
+	}
+
+	const MaterialTable::Record MaterialRecord
+	{
+		InDescription.Color,
+		MyPermutation->SpecularIntensity,
+		InDescription.SpecularPower,
+		InDescription.Opacity,
+		{Slices[0], Slices[1], Slices[2]},
+		PackedMaps
+	};
+
+	InGraphics.GetMaterialTable().Register(Id, MaterialRecord);
+
+	// Everything Bind sets, the parameters are read from the table by ID.
+	auto BatchKey = BindKey::Make<Material>(reinterpret_cast<uintptr_t>(MyPixelShader.get()), reinterpret_cast<uintptr_t>(MyGBufferPixelShader.get()),
+	                                        reinterpret_cast<uintptr_t>(MyAlphaTestPixelShader.get()), reinterpret_cast<uintptr_t>(MySampler.get()), SamplerSlot);
+
+	for (const auto& [MaterialTexture, Slot] : Textures)
+	{
+		BatchKey.Combine(reinterpret_cast<uintptr_t>(MaterialTexture.get()));
+		BatchKey.Combine(Slot);
+	}
+
+	for (const auto& [MapArray, Slot] : MapArrays)
+	{
+		BatchKey.Combine(reinterpret_cast<uintptr_t>(MapArray.get()));
+		BatchKey.Combine(Slot);
+	}
+
+	std::lock_guard Lock(BatchMutex);
+	BatchId = BatchIds.try_emplace(BatchKey.GetValue(), Id).first->second;
+}
+
+Material::~Material()
+{
+	if (VirtualTextures)
+	{
+		VirtualTextures->UnregisterMaterial(Id);
+	}
+}
+
+void Material::Bind(RenderContext& InContext) noexcept
+{
+	MyPixelShader->Bind(InContext);
+
+	for (const auto& [MaterialTexture, Slot] : Textures)
+	{
+		MaterialTexture->BindTo(InContext, Slot);
+
+		if (VirtualTextures && MaterialTexture->IsVirtual())
+		{
+			MaterialTexture->BindResidencyTo(InContext, Slot + Texture::ResidencySlotOffset);
+		}
+	}
+
+	// Every material of a packed model binds the same arrays, the state cache skips all but the first.
+	for (const auto& [MapArray, Slot] : MapArrays)
+	{
+		MapArray->BindTo(InContext, Slot);
+	}
+
+	if (MySampler)
+	{
+		MySampler->BindTo(InContext, SamplerSlot);
+	}
+}
+
+bool Material::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	MyPixelShader->Bake(InOutPacket);
+
+	for (const auto& [MaterialTexture, Slot] : Textures)
+	{
+		MaterialTexture->BakeTo(InOutPacket, Slot);
+
+		if (VirtualTextures && MaterialTexture->IsVirtual())
+		{
+			MaterialTexture->BakeResidencyTo(InOutPacket, Slot + Texture::ResidencySlotOffset);
+		}
+	}
+
+	for (const auto& [MapArray, Slot] : MapArrays)
+	{
+		MapArray->BakeTo(InOutPacket, Slot);
+	}
+
+	if (MySampler)
+	{
+		MySampler->BakeTo(InOutPacket, SamplerSlot);
+	}
+
+	return true;
+}
+
+void Material::RequestDetail(const float InPixelsPerTexcoord) const noexcept
+{
+	for (const auto& [MaterialTexture, Slot] : Textures)
+	{
+		MaterialTexture->RequestDetail(InPixelsPerTexcoord);
+	}
+}
+
+const Material::Permutation& Material::FindPermutation(const unsigned int InFeatures) noexcept
+{
+	for (const auto& Candidate : Permutations)
+	{
+		if ((Candidate.Features & InFeatures) == Candidate.Features)
+		{
+			return Candidate;
+		}
+	}
+
+	// Unreachable, the last permutation needs no features.
+	return Permutations[std::size(Permutations) - 1u];
+}
+
+unsigned int Material::GetFeatures(const Description& InDescription) noexcept
+{
+	return (InDescription.DiffuseMap.empty() ? 0u : DiffuseMapped) |
+		   (InDescription.NormalMap.empty() || !InDescription.bIsNormalMapEnabled ? 0u : NormalMapped) |
+		   (InDescription.SpecularMap.empty() ? 0u : SpecularMapped) |
+		   (InDescription.SpecularMap.empty() || !InDescription.bIsSpecularPacked ? 0u : PackedSpecular) |
+		   (InDescription.DiffuseArray.empty() ? 0u : TextureArrays);
+}
+
+std::shared_ptr<Material> Material::Resolve(const Graphics& InGraphics, const Description& InDescription)
+{
+	return BindManager::Resolve<Material>(InGraphics, InDescription);
+}
+
+std::string Material::GenerateUniqueID(const Description& InDescription)
+{
+	using namespace std::string_literals;
+
+	const auto& [R, G, B, A] = InDescription.Color;
+	return typeid(Material).name() + "#"s + InDescription.DiffuseMap + "#"s + InDescription.NormalMap + "#"s + InDescription.SpecularMap +
+		   "#"s + InDescription.LightmapMap +
+		   "#"s + std::to_string(R) + ","s + std::to_string(G) + ","s + std::to_string(B) + ","s + std::to_string(A) +
+		   "#"s + std::to_string(InDescription.SpecularPower) + "#"s + (InDescription.bIsNormalMapEnabled ? "1"s : "0"s) +
+		   (InDescription.bIsSpecularPacked ? "1"s : "0"s) +
+		   "#"s + std::to_string(InDescription.Opacity) + "#"s + (InDescription.bIsTwoSided ? "1"s : "0"s) + (InDescription.bIsAlphaTested ? "1"s : "0"s) +
+		   "#"s + (InDescription.DiffuseArray.empty() ? "0"s : "1"s) + "#"s + Sampler::GenerateUniqueID(InDescription.Sampling);
+}
+
+BindKey Material::GenerateKey(const Description& InDescription)
+{
+	auto Key = BindKey::Make<Material>(InDescription.DiffuseMap, InDescription.NormalMap, InDescription.SpecularMap, InDescription.LightmapMap,
+	                                   InDescription.bIsNormalMapEnabled, InDescription.bIsSpecularPacked, InDescription.bIsTwoSided,
+	                                   InDescription.bIsAlphaTested);
+
+	for (const auto Value : {InDescription.Color.x, InDescription.Color.y, InDescription.Color.z, InDescription.Color.w, InDescription.SpecularPower,
+	                         InDescription.Opacity})
+	{
+		Key.Combine(std::bit_cast<uint32_t>(Value));
+	}
+
+	// Any arrays holding the maps sample the same, so only whether there are arrays tells two materials apart.
+	Key.Combine(!InDescription.DiffuseArray.empty());
+	Key.Combine(Sampler::GenerateKey(InDescription.Sampling).GetValue());
+
+	return Key;
+}
+
+std::string Material::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(MyDescription);
+}
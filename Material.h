@@ -0,0 +1,194 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BindKey.h"
+#include "Bindable.h"
+#include "Sampler.h"
+
+class PixelShader;
+class Texture;
+class TextureArray;
+class VirtualTextureCache;
+
+/**
+ * Everything about a surface that doesn't depend on the mesh: the pixel shader, the texture set and one record of the MaterialTable.
+ * Shaders are variants of the material uber shaders picked by which maps the material has, and meshes with identical maps
+ * and parameters resolve the same material, so it is created once for all of them. Its parameters are only read from the table,
+ * so materials whose shaders and maps are the same bind the same state and the render queue sorts them together by batch.
+ */
+class Material : public Bindable
+{
+public:
+	enum Feature : unsigned int
+	{
+		DiffuseMapped = 1u << 0u,
+		NormalMapped = 1u << 1u,
+		SpecularMapped = 1u << 2u,
+		// Maps are sampled from slices of shared texture arrays, only the pixel shader changes.
+		TextureArrays = 1u << 3u,
+		// The specular map is the cooked two-channel kind, the grey level of its tint and its power, see TextureCooker.
+		PackedSpecular = 1u << 4u,
+		// Vertex shaders only, set by meshes whose vertices carry baked ambient occlusion rather than by the material.
+		VertexOcclusion = 1u << 5u,
+		// Forward and transparent pixel shaders only, lighting at 16-bit minimum precision where Graphics::UsesHalfPrecision.
+		HalfPrecision = 1u << 6u,
+		// Static vertex shaders and the forward pixel shader, set for materials of meshes baked with a lightmap, see Lightmapper.
+		Lightmapped = 1u << 7u,
+		// Forward and G-buffer pixel shaders only, set for materials whose maps the VirtualTextureCache pages. Samples are
+		// clamped to each map's resident levels.
+		VirtualTextured = 1u << 8u
+	};
+
+	struct Description
+	{
+		// Full paths, empty for maps the material doesn't have.
+		std::string DiffuseMap;
+		std::string NormalMap;
+		std::string SpecularMap;
+		// Of the mesh rather than its surface, RGBM encoded. Opaque materials with one always draw forward, the G-buffer has no room for it.
+		std::string LightmapMap;
+		// Only used without a diffuse map.
+		DirectX::XMFLOAT4 Color {0.65f, 0.65f, 0.85f, 1.0f};
+		// A specular map supplies the power per texel instead.
+		float SpecularPower {35.0f};
+		// Off picks a variant built without normal mapping, the map is then neither bound nor sampled.
+		bool bIsNormalMapEnabled {true};
+		// Set by the import for BC5 specular maps, which can only be packed ones.
+		bool bIsSpecularPacked {false};
+		// Below one the surface is blended by it, into the order-independent transparency targets.
+		float Opacity {1.0f};
+		// Drawn without back-face culling.
+		bool bIsTwoSided {false};
+		// Set by the import for maps whose alpha cuts the surface out. Only opaque diffuse mapped materials are, and they
+		// draw in the alpha-tested passes after the opaque ones.
+		bool bIsAlphaTested {false};
+		// Every map is read through it, the slot comes from the shader.
+		Sampler::Description Sampling;
+		// Set by texture packing for every map the material has, the files of the array its map is a slice of.
+		std::vector<std::string> DiffuseArray;
+		std::vector<std::string> NormalArray;
+		std::vector<std::string> SpecularArray;
+	};
+
+	// One variant of the material uber shaders, meshes take their vertex shaders and layout from it as well.
+	struct Permutation
+	{
+		unsigned int Features;
+		// Specular maps only change the pixel shader.
+		unsigned int VertexFeatures;
+		float SpecularIntensity;
+	};
+
+	// Bundle names of MaterialVS.hlsl, its INSTANCED, SKINNED, MORPHED and VERTEX_ANIMATED builds, MaterialPS.hlsl and its GBUFFER and TRANSPARENT builds
+	// MaterialFeedbackPS.hlsl and MaterialAlphaTestPS.hlsl, the variants are looked up by features.
+	static constexpr std::string_view VertexShaderName {"MaterialVS"};
+	static constexpr std::string_view InstancedVertexShaderName {"MaterialInstancedVS"};
+	static constexpr std::string_view SkinnedVertexShaderName {"MaterialSkinnedVS"};
+	static constexpr std::string_view MorphedVertexShaderName {"MaterialMorphedVS"};
+	static constexpr std::string_view MorphedSkinnedVertexShaderName {"MaterialMorphedSkinnedVS"};
+	static constexpr std::string_view VertexAnimatedVertexShaderName {"MaterialVertexAnimatedVS"};
+	static constexpr std::string_view VertexAnimatedInstancedVertexShaderName {"MaterialVertexAnimatedInstancedVS"};
+	static constexpr std::string_view PixelShaderName {"MaterialPS"};
+	static constexpr std::string_view GBufferPixelShaderName {"MaterialGBufferPS"};
+	static constexpr std::string_view TransparentPixelShaderName {"MaterialTransparentPS"};
+	static constexpr std::string_view FeedbackPixelShaderName {"MaterialFeedbackPS"};
+	static constexpr std::string_view AlphaTestPixelShaderName {"MaterialAlphaTestPS"};
+
+	Material(const Graphics& InGraphics, const Description& InDescription);
+	~Material() override;
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+	// Forwarded to the streamed maps, see Texture::RequestDetail.
+	void RequestDetail(float InPixelsPerTexcoord) const noexcept;
+
+	// The richest permutation whose features are all present, maps beyond what it uses are ignored.
+	[[nodiscard]] static const Permutation& FindPermutation(unsigned int InFeatures) noexcept;
+	[[nodiscard]] static unsigned int GetFeatures(const Description& InDescription) noexcept;
+
+	[[nodiscard]] static std::shared_ptr<Material> Resolve(const Graphics& InGraphics, const Description& InDescription);
+	[[nodiscard]] static std::string GenerateUniqueID(const Description& InDescription);
+	[[nodiscard]] static BindKey GenerateKey(const Description& InDescription);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+
+	[[nodiscard]] const Permutation& GetPermutation() const noexcept
+	{
+		return *MyPermutation;
+	}
+
+	[[nodiscard]] const std::shared_ptr<PixelShader>& GetPixelShader() const noexcept
+	{
+		return MyPixelShader;
+	}
+
+	// Writes the surface into the G-buffer instead of lighting it, null for blended, lightmapped and alpha-tested materials, which are always drawn forward.
+	[[nodiscard]] const std::shared_ptr<PixelShader>& GetGBufferPixelShader() const noexcept
+	{
+		return MyGBufferPixelShader;
+	}
+
+	// Writes which pages of its virtual maps a pixel needs, null unless the VirtualTextureCache pages any of them.
+	[[nodiscard]] const std::shared_ptr<PixelShader>& GetFeedbackPixelShader() const noexcept
+	{
+		return MyFeedbackPixelShader;
+	}
+
+	// Clips the diffuse map's cut-out texels and writes nothing but depth, null unless the material is alpha-tested.
+	[[nodiscard]] const std::shared_ptr<PixelShader>& GetAlphaTestPixelShader() const noexcept
+	{
+		return MyAlphaTestPixelShader;
+	}
+
+	[[nodiscard]] bool IsAlphaTested() const noexcept
+	{
+		return MyAlphaTestPixelShader != nullptr;
+	}
+
+	[[nodiscard]] bool IsBlended() const noexcept
+	{
+		return MyDescription.Opacity < 1.0f;
+	}
+
+	[[nodiscard]] bool IsTwoSided() const noexcept
+	{
+		return MyDescription.bIsTwoSided;
+	}
+
+	// Blended materials ignore the lightmap, their transparent shaders have no such variant.
+	[[nodiscard]] bool IsLightmapped() const noexcept
+	{
+		return !MyDescription.LightmapMap.empty() && !IsBlended();
+	}
+
+	// Small and dense in creation order, its record in the MaterialTable.
+	[[nodiscard]] unsigned int GetId() const noexcept
+	{
+		return Id;
+	}
+
+	// Shared by every material binding the same shaders, maps and sampler, the ID of the first of them.
+	// Unlike a hash it fits the render queue's sort key without collisions.
+	[[nodiscard]] unsigned int GetBatchId() const noexcept
+	{
+		return BatchId;
+	}
+
+private:
+	Description MyDescription;
+	const Permutation* MyPermutation;
+	unsigned int Id;
+	unsigned int BatchId {0u};
+	std::shared_ptr<PixelShader> MyPixelShader;
+	std::shared_ptr<PixelShader> MyGBufferPixelShader;
+	std::shared_ptr<PixelShader> MyFeedbackPixelShader;
+	std::shared_ptr<PixelShader> MyAlphaTestPixelShader;
+	VirtualTextureCache* VirtualTextures {nullptr};
+	// Each with the slot the pixel shader reads it from, the textures themselves are shared by file whatever the slot.
+	std::vector<std::pair<std::shared_ptr<Texture>, UINT>> Textures;
+	std::vector<std::pair<std::shared_ptr<TextureArray>, UINT>> MapArrays;
+	std::shared_ptr<Sampler> MySampler;
+	UINT SamplerSlot {0u};
+};
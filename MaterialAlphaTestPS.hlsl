@@ -0,0 +1,40 @@
+// Depth of alpha-tested materials, drawn in their own pre-pass with the shaded vertex shader of the mesh and no target. Texels of
+// the diffuse map below half alpha are clipped, so the shading pass after it tests for equal depth and never clips itself.
+// The inputs are MaterialVS.hlsl's, every build is DIFFUSE_MAPPED and NORMAL_MAPPED ones also get the tangents. TEXTURE_ARRAYS
+// builds read the slice from the material table, LIGHTMAPPED ones skip the lightmap coordinate on the way to the material index.
+// Packed R8G8 diffuse maps keep their alpha in green, see UnpackMap.
+#include "MaterialTable.hlsli"
+
+#if TEXTURE_ARRAYS
+Texture2DArray DiffuseMap : register(t0);
+#else
+Texture2D DiffuseMap : register(t0);
+#endif
+
+SamplerState Sampler;
+
+static const float AlphaCutoff = 0.5f;
+
+void main(const float3 InWorldPosition : Position,
+          const float3 InWorldNormal : Normal,
+#if NORMAL_MAPPED
+          const float3 InWorldTangent : Tangent,
+          const float3 InWorldBitangent : Bitangent,
+#endif
+          const float2 InTextureCoordinate : TexCoord,
+          const float InOcclusion : Occlusion,
+#if LIGHTMAPPED
+          const float2 InLightmapTexCoord : LightmapTexCoord,
+#endif
+          nointerpolation const uint InMaterialIndex : MaterialIndex)
+{
+    const MaterialRecord Parameters = Materials[InMaterialIndex];
+#if TEXTURE_ARRAYS
+    const float4 Sample = DiffuseMap.Sample(Sampler, float3(InTextureCoordinate, Parameters.DiffuseSlice));
+#else
+    const float4 Sample = DiffuseMap.Sample(Sampler, InTextureCoordinate);
+#endif
+    const float Alpha = UnpackMap(Sample, Parameters.PackedMaps, DiffuseMapIndex).a;
+
+    clip(Alpha - AlphaCutoff);
+}
@@ -0,0 +1,15 @@
+// Laid out like MaterialTable::Record, for pixel shaders of drawables without a Material that bind their own constants.
+cbuffer Material : register(b1)
+{
+    float4 MaterialColor;
+    float SpecularIntensity;
+    float SpecularPower;
+    // One for opaque materials, blended ones are drawn with it as their alpha.
+    float Opacity;
+    // Slices of the maps in their texture arrays, only read by TEXTURE_ARRAYS variants.
+    uint DiffuseSlice;
+    uint NormalSlice;
+    uint SpecularSlice;
+    // Zero, these drawables bind their maps as they are.
+    uint PackedMaps;
+}
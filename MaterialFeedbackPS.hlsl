@@ -0,0 +1,22 @@
+// Which pages of its virtual maps a material needs under each pixel, drawn by VirtualTextureCache at an eighth of the scene's
+// size with the shaded vertex shader of the mesh. Red gets the material's index plus one, none where nothing is drawn, and
+// green the wrapped texture coordinate at 12 bits a side with the log2 of its footprint per pixel in eighths above -24.
+// The inputs are MaterialVS.hlsl's, every build is DIFFUSE_MAPPED and NORMAL_MAPPED ones also get the tangents.
+uint2 main(const float3 InWorldPosition : Position,
+           const float3 InWorldNormal : Normal,
+#if NORMAL_MAPPED
+           const float3 InWorldTangent : Tangent,
+           const float3 InWorldBitangent : Bitangent,
+#endif
+           const float2 InTextureCoordinate : TexCoord,
+           const float InOcclusion : Occlusion,
+           nointerpolation const uint InMaterialIndex : MaterialIndex) : SV_Target
+{
+    const uint2 Coordinate = min(uint2(frac(InTextureCoordinate) * 4096.0f), 4095u);
+
+    // Of the coarser axis, like the hardware picks the level for an isotropic sample.
+    const float Footprint = max(length(ddx(InTextureCoordinate)), length(ddy(InTextureCoordinate)));
+    const uint Lod = (uint)clamp((log2(max(Footprint, 1.0e-7f)) + 24.0f) * 8.0f, 0.0f, 255.0f);
+
+    return uint2(InMaterialIndex + 1u, Coordinate.x | (Coordinate.y << 12u) | (Lod << 24u));
+}
@@ -0,0 +1,204 @@
+// Pixel shader of every material permutation, compiled once per variant into the shader bundle.
+// Each of DIFFUSE_MAPPED, NORMAL_MAPPED and SPECULAR_MAPPED samples one more map in the slot of its Material::Feature bit,
+// without a map the material's record in the material table supplies the value instead. TEXTURE_ARRAYS samples every map from its slice of a shared array.
+// PACKED_SPECULAR specular maps are cooked BC5, which keeps the grey level of the tint in red and the power in green.
+// Maps Texture packed into fewer channels are expanded again per material, see UnpackMap in MaterialTable.hlsli.
+// GBUFFER builds write the surface into the G-buffer for deferred shading instead of lighting it, it has no room for baked occlusion.
+// TRANSPARENT builds light the surface like the forward build and write it weighted into the order-independent transparency targets.
+// HALF_PRECISION forward and transparent builds light at min16float, see ShaderOperations.hlsli, the G-buffer build has none.
+// LIGHTMAPPED forward builds add the light an import baked into the mesh's lightmap to the dynamic lights, see Lightmapper.
+// VIRTUAL_TEXTURED forward and G-buffer builds clamp every sample to the levels the VirtualTextureCache has resident there.
+// Forward and transparent builds blend the clustered decals over the albedo, G-buffer builds leave them to DeferredLightingCS.hlsl.
+#include "FrameConstants.hlsli"
+#include "GBuffer.hlsli"
+#include "MaterialTable.hlsli"
+#include "PointLight.hlsli"
+#include "ShaderOperations.hlsli"
+#include "Transparency.hlsli"
+// After both, it samples with PointLight.hlsli's comparison sampler and shades like ShaderOperations.hlsli.
+#include "DirectionalLight.hlsli"
+#include "Decals.hlsli"
+
+#if TEXTURE_ARRAYS
+#define MaterialMap Texture2DArray
+#define SAMPLE_MAP(InMap, InSlice) InMap.Sample(Sampler, float3(InTextureCoordinate, InSlice))
+#elif VIRTUAL_TEXTURED
+#define MaterialMap Texture2D
+#define SAMPLE_MAP(InMap, InSlice) InMap.Sample(Sampler, InTextureCoordinate, int2(0, 0), LoadResidency(InMap##Residency, InTextureCoordinate))
+#else
+#define MaterialMap Texture2D
+#define SAMPLE_MAP(InMap, InSlice) InMap.Sample(Sampler, InTextureCoordinate)
+#endif
+
+#if GBUFFER
+#define PixelOutput GBufferTargets
+#define PIXEL_OUTPUT_SEMANTIC
+#elif TRANSPARENT
+#define PixelOutput TransparencyTargets
+#define PIXEL_OUTPUT_SEMANTIC
+#else
+#define PixelOutput float4
+#define PIXEL_OUTPUT_SEMANTIC : SV_TARGET
+#endif
+
+#if DIFFUSE_MAPPED
+MaterialMap DiffuseMap : register(t0);
+#endif
+#if NORMAL_MAPPED
+MaterialMap NormalMap : register(t1);
+#endif
+#if SPECULAR_MAPPED
+MaterialMap SpecularMap : register(t2);
+#endif
+
+#if VIRTUAL_TEXTURED
+// The finest level resident per tile of each map's finest level, Texture::ResidencySlotOffset slots after the map.
+#if DIFFUSE_MAPPED
+Texture2D<uint> DiffuseMapResidency : register(t4);
+#endif
+#if NORMAL_MAPPED
+Texture2D<uint> NormalMapResidency : register(t5);
+#endif
+#if SPECULAR_MAPPED
+Texture2D<uint> SpecularMapResidency : register(t6);
+#endif
+
+// Maps the cache hasn't paged yet have no residency bound, which reads as zero and samples them at full detail.
+float LoadResidency(const Texture2D<uint> InResidency, const float2 InTextureCoordinate)
+{
+    uint Width;
+    uint Height;
+    InResidency.GetDimensions(Width, Height);
+
+    const uint2 Tile = min(uint2(frac(InTextureCoordinate) * float2(Width, Height)), uint2(Width, Height) - 1u);
+    return (float)InResidency.Load(int3(Tile, 0));
+}
+#endif
+
+#if LIGHTMAPPED
+// RGBM up to the same range as Lightmapper::MaxValue.
+Texture2D Lightmap : register(t3);
+static const float LightmapRange = 8.0f;
+#endif
+
+SamplerState Sampler;
+
+PixelOutput main(const float3 InWorldPosition : Position,
+            float3 InWorldNormal : Normal,
+#if NORMAL_MAPPED
+            const float3 InWorldTangent : Tangent,
+            const float3 InWorldBitangent : Bitangent,
+#endif
+#if DIFFUSE_MAPPED
+            const float2 InTextureCoordinate : TexCoord,
+#endif
+            const float InOcclusion : Occlusion,
+#if LIGHTMAPPED
+            const float2 InLightmapTexCoord : LightmapTexCoord,
+#endif
+            nointerpolation const uint InMaterialIndex : MaterialIndex,
+            const float4 InPixelPosition : SV_Position) PIXEL_OUTPUT_SEMANTIC
+{
+    const MaterialRecord Parameters = Materials[InMaterialIndex];
+    InWorldNormal = normalize(InWorldNormal);
+
+#if NORMAL_MAPPED
+    InWorldNormal = NormalSampleToWorldSpace(normalize(InWorldTangent), normalize(InWorldBitangent), InWorldNormal,
+                                             UnpackMap(SAMPLE_MAP(NormalMap, Parameters.NormalSlice), Parameters.PackedMaps, NormalMapIndex).xy);
+#endif
+
+#if SPECULAR_MAPPED && PACKED_SPECULAR
+    // Lit the same as its source, the tint only ever reaches the G-buffer as its luminance anyway.
+    const float2 SpecularSample = SAMPLE_MAP(SpecularMap, Parameters.SpecularSlice).rg;
+    const float3 SpecularReflectionColor = SpecularSample.rrr;
+    const float SurfaceSpecularPower = pow(2.0f, SpecularSample.g * 13.0f);
+#elif SPECULAR_MAPPED
+    const float4 SpecularSample = UnpackMap(SAMPLE_MAP(SpecularMap, Parameters.SpecularSlice), Parameters.PackedMaps, SpecularMapIndex);
+    const float3 SpecularReflectionColor = SpecularSample.rgb;
+    const float SurfaceSpecularPower = pow(2.0f, SpecularSample.a * 13.0f);
+#else
+    const float SurfaceSpecularPower = Parameters.SpecularPower;
+#endif
+
+#if DIFFUSE_MAPPED
+    const float3 SurfaceAlbedo = SrgbToLinear(UnpackMap(SAMPLE_MAP(DiffuseMap, Parameters.DiffuseSlice), Parameters.PackedMaps, DiffuseMapIndex).rgb);
+#else
+    const float3 SurfaceAlbedo = Parameters.Color.rgb;
+#endif
+
+#if GBUFFER
+    GBufferSurface Surface;
+    Surface.Albedo = SurfaceAlbedo;
+    Surface.WorldNormal = InWorldNormal;
+    Surface.SpecularPower = SurfaceSpecularPower;
+#if SPECULAR_MAPPED
+    // Forward shading multiplies highlights by the tint twice, the G-buffer only has room for the luminance of that.
+    Surface.SpecularIntensity = Parameters.SpecularIntensity * dot(SpecularReflectionColor * SpecularReflectionColor, float3(0.2126f, 0.7152f, 0.0722f));
+    Surface.SpecularMode = SpecularModeTinted;
+#else
+    Surface.SpecularIntensity = Parameters.SpecularIntensity;
+    Surface.SpecularMode = SpecularModeLightColored;
+#endif
+    return EncodeGBuffer(Surface);
+#else
+    const float3 Albedo = ApplyDecals(SurfaceAlbedo, InPixelPosition.xy, InWorldPosition, InWorldNormal, ddx(InWorldPosition), ddy(InWorldPosition));
+    const float3 VectorToCamera = CameraPosition - InWorldPosition;
+
+    float3 Diffuse = float3(0.0f, 0.0f, 0.0f);
+    float3 Specular = float3(0.0f, 0.0f, 0.0f);
+
+    const ClusterLights Cluster = GetClusterLights(InPixelPosition.xy, InWorldPosition);
+
+    for (uint Index = 0u; Index < Cluster.Num; ++Index)
+    {
+        const PointLightData Light = GetClusterLight(Cluster, Index);
+
+        const float3 VectorToLight = Light.WorldPosition - InWorldPosition;
+        const float DistanceToLight = length(VectorToLight);
+
+        if (DistanceToLight >= Light.Range)
+        {
+            continue;
+        }
+
+        const float3 DirectionToLight = VectorToLight / DistanceToLight;
+        const float Attenuation = GetShadowFactor(Light, VectorToLight) * CalcAttenuate(Light.QuadraticAttenuation, Light.LinearAttenuation, Light.ConstantAttenuation, DistanceToLight);
+
+#if SPECULAR_MAPPED
+        const float3 SpecularColor = SpecularReflectionColor;
+#else
+        const float3 SpecularColor = Light.DiffuseColor * Light.DiffuseStrength;
+#endif
+
+        Diffuse += CalcDiffuse(Light.DiffuseColor, Light.DiffuseStrength, Attenuation, DirectionToLight, InWorldNormal);
+        Specular += CalcSpeculate(SpecularColor, Parameters.SpecularIntensity, InWorldNormal, VectorToLight, VectorToCamera, Attenuation, SurfaceSpecularPower);
+    }
+
+#if SPECULAR_MAPPED
+    AddSunLight(InWorldPosition, InWorldNormal, VectorToCamera, SpecularReflectionColor, Parameters.SpecularIntensity, SurfaceSpecularPower, Diffuse, Specular);
+#else
+    AddSunLight(InWorldPosition, InWorldNormal, VectorToCamera, SunColor, Parameters.SpecularIntensity, SurfaceSpecularPower, Diffuse, Specular);
+#endif
+
+#if LIGHTMAPPED
+    // Baked lights are static and already shadowed, as much diffuse light as any dynamic one.
+    const float4 LightmapSample = Lightmap.Sample(Sampler, InLightmapTexCoord);
+    Diffuse += LightmapSample.rgb * LightmapSample.a * LightmapRange;
+#endif
+
+    // Baked occlusion darkens the indirect light on top of the screen space kind, the direct light is shadowed instead.
+    Specular += Parameters.SpecularIntensity * InOcclusion * CalcReflection(InWorldPosition, InWorldNormal, VectorToCamera, SurfaceSpecularPower, InPixelPosition.xy);
+
+#if SPECULAR_MAPPED
+    Specular *= SpecularReflectionColor;
+#endif
+
+    // Unclamped, highlights past one are for the tonemap pass to compress.
+    const float3 Color = (Diffuse + InOcclusion * CalcAmbient(AmbientColor, InWorldPosition, InWorldNormal, InPixelPosition.xy)) * Albedo + Specular;
+#if TRANSPARENT
+    return EncodeTransparency(Color, Parameters.Opacity, length(VectorToCamera));
+#else
+    return float4(Color, Parameters.Opacity);
+#endif
+#endif
+}
@@ -0,0 +1,59 @@
+﻿#include "MaterialTable.h"
+#include <algorithm>
+#include <stdexcept>
+#include "ExceptionMacros.h"
+#include "Graphics.h"
+#include "RenderContext.h"
+
+MaterialTable::MaterialTable(ID3D11Device* InDevice)
+	: Records(MaxMaterialNum)
+{
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC RecordDesc {};
+	RecordDesc.ByteWidth = MaxMaterialNum * sizeof(Record);
+	RecordDesc.Usage = D3D11_USAGE_DEFAULT;
+	RecordDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	RecordDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	RecordDesc.StructureByteStride = sizeof(Record);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&RecordDesc, nullptr, &RecordBuffer))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(RecordBuffer.Get(), nullptr, &RecordView))
+}
+
+void MaterialTable::Register(const unsigned int InId, const Record& InRecord)
+{
+	if (InId >= MaxMaterialNum)
+	{
+		throw std::runtime_error("Material table is full");
+	}
+
+	std::lock_guard Lock(RecordMutex);
+	Records[InId] = InRecord;
+	StaleFirst = std::min(StaleFirst, InId);
+	StaleLast = std::max(StaleLast, InId);
+	RecordNum = std::max(RecordNum, InId + 1u);
+}
+
+void MaterialTable::Flush(const Graphics& InGraphics)
+{
+	std::lock_guard Lock(RecordMutex);
+
+	if (StaleFirst > StaleLast)
+	{
+		return;
+	}
+
+	// Materials are created in bursts as models load, so one range covers them, unchanged records in it are written again.
+	const D3D11_BOX Box {StaleFirst * static_cast<UINT>(sizeof(Record)), 0u, 0u, (StaleLast + 1u) * static_cast<UINT>(sizeof(Record)), 1u, 1u};
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	ImmediateContext.GetDeviceContext()->UpdateSubresource(RecordBuffer.Get(), 0u, &Box, Records.data() + StaleFirst, 0u, 0u);
+	ImmediateContext.GetStateCache().CountUpload(Box.right - Box.left);
+
+	StaleFirst = MaxMaterialNum;
+	StaleLast = 0u;
+}
+
+void MaterialTable::Bind(RenderContext& InContext) const noexcept
+{
+	InContext.GetStateCache().SetPixelShaderResource(Slot, RecordView.Get());
+}
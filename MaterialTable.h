@@ -0,0 +1,71 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <mutex>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class RenderContext;
+
+/**
+ * The parameters of every material in one structured buffer, indexed by Material::GetId, instead of a constant buffer per material.
+ * The material vertex shaders pass the index on to the pixel shaders, read per draw from the transform constants and per instance
+ * from the instance transforms. Materials with the same pixel shader and maps then bind nothing when the next one is drawn,
+ * and instances of the same geometry can each be drawn with their own material.
+ */
+class MaterialTable
+{
+public:
+	static constexpr unsigned int MaxMaterialNum {4096u};
+	// Of the pixel shaders, bound with the frame state.
+	static constexpr UINT Slot {15u};
+	// How the material shaders expand the samples of a map again, see Record::PackedMaps.
+	static constexpr UINT MapUnpacked {0u};
+	static constexpr UINT MapPackedGrey {1u};
+	static constexpr UINT MapPackedGreyAlpha {2u};
+
+	// Laid out like MaterialRecord in MaterialTable.hlsli.
+	struct Record
+	{
+		DirectX::XMFLOAT4 Color;
+		float SpecularIntensity;
+		float SpecularPower;
+		float Opacity;
+		// Array slices of the diffuse, normal and specular maps, zero without texture arrays.
+		UINT Slices[3];
+		// Two bits per map in the same order, MapPackedGreyAlpha for R8G8 maps and MapPackedGrey for the other single
+		// channel ones Texture packs images into.
+		UINT PackedMaps;
+	};
+
+	explicit MaterialTable(ID3D11Device* InDevice);
+	MaterialTable(const MaterialTable&) = delete;
+	MaterialTable(MaterialTable&&) = delete;
+	MaterialTable& operator=(const MaterialTable&) = delete;
+	MaterialTable& operator=(MaterialTable&&) = delete;
+	~MaterialTable() = default;
+
+	// From any thread, the record reaches the buffer with the next flush. Materials never change, so each ID is written once.
+	void Register(unsigned int InId, const Record& InRecord);
+	// Writes the records registered since the last flush on the immediate context, before anything draws their materials.
+	void Flush(const Graphics& InGraphics);
+	void Bind(RenderContext& InContext) const noexcept;
+
+	[[nodiscard]] unsigned int GetRecordNum() const noexcept
+	{
+		return RecordNum;
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> RecordBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> RecordView;
+
+	std::mutex RecordMutex;
+	std::vector<Record> Records;
+	// The range of IDs registered since the last flush, empty while the first is past the last.
+	unsigned int StaleFirst {MaxMaterialNum};
+	unsigned int StaleLast {0u};
+	unsigned int RecordNum {0u};
+};
@@ -0,0 +1,31 @@
+// Laid out like MaterialTable::Record, one per material indexed by its ID.
+struct MaterialRecord
+{
+    float4 Color;
+    float SpecularIntensity;
+    float SpecularPower;
+    // One for opaque materials, blended ones are drawn with it as their alpha.
+    float Opacity;
+    // Slices of the maps in their texture arrays, only read by TEXTURE_ARRAYS variants.
+    uint DiffuseSlice;
+    uint NormalSlice;
+    uint SpecularSlice;
+    // Two bits per map in the order of the slices, set for maps Texture packed into fewer channels, see UnpackMap.
+    uint PackedMaps;
+};
+
+StructuredBuffer<MaterialRecord> Materials : register(t15);
+
+// MaterialTable::MapPackedGrey and MapPackedGreyAlpha, and the maps in the order of PackedMaps.
+static const uint MapPackedGrey = 1u;
+static const uint MapPackedGreyAlpha = 2u;
+static const uint DiffuseMapIndex = 0u;
+static const uint NormalMapIndex = 1u;
+static const uint SpecularMapIndex = 2u;
+
+// A sample of a packed map as the image it was packed from, whose red, green and blue were its grey level.
+float4 UnpackMap(const float4 InSample, const uint InPackedMaps, const uint InMapIndex)
+{
+    const uint Packing = (InPackedMaps >> (InMapIndex * 2u)) & 3u;
+    return Packing == MapPackedGrey ? float4(InSample.rrr, 1.0f) : Packing == MapPackedGreyAlpha ? InSample.rrrg : InSample;
+}
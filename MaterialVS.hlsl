@@ -0,0 +1,155 @@
+// Vertex shader of every material permutation, compiled once per variant into the shader bundle.
+// DIFFUSE_MAPPED adds texture coordinates and reads packed normals, NORMAL_MAPPED adds the tangent frame,
+// INSTANCED takes the transforms and materials from the instance buffer instead of the Transform constants,
+// SKINNED blends the vertex by its bones before the Model transform, MORPHED adds its weighted blend shapes before that,
+// VERTEX_ANIMATED takes the vertex from its baked animation instead of skinning it, at the clip and time of its instance,
+// VERTEX_OCCLUSION passes on the ambient occlusion an import baked into the vertices, LIGHTMAPPED the coordinates into the mesh's lightmap.
+#include "FrameConstants.hlsli"
+#include "VertexPacking.hlsli"
+
+#if SKINNED
+#include "Skinning.hlsli"
+#endif
+
+#if MORPHED
+#include "Morphing.hlsli"
+#endif
+
+#if VERTEX_ANIMATED
+#include "VertexAnimation.hlsli"
+#endif
+
+#if INSTANCED
+#include "Instancing.hlsli"
+#else
+cbuffer Transform
+{
+    matrix Model;
+    uint MaterialIndex;
+    uint Animation;
+};
+#endif
+
+struct VSOutput
+{
+    float3 VertexWorldPosition : Position;
+    float3 NormalWorldPosition : Normal;
+#if NORMAL_MAPPED
+    float3 TangentWorldPosition : Tangent;
+    float3 BitangentWorldPosition : Bitangent;
+#endif
+#if DIFFUSE_MAPPED
+    float2 TextureCoordinate : TexCoord;
+#endif
+    // Ambient occlusion baked into the vertices, one without a bake.
+    float Occlusion : Occlusion;
+#if LIGHTMAPPED
+    float2 LightmapTexCoord : LightmapTexCoord;
+#endif
+    // Into the material table, for the pixel shader.
+    nointerpolation uint MaterialIndex : MaterialIndex;
+    float4 VertexPosition : SV_Position;
+    float ClipDistance : SV_ClipDistance0;
+};
+
+VSOutput main(const float3 InModelPosition : Position,
+#if DIFFUSE_MAPPED
+              const float2 InNormal : Normal,
+#else
+              const float3 InNormal : Normal,
+#endif
+#if NORMAL_MAPPED
+              const float4 InTangentFrame : Tangent,
+#endif
+#if DIFFUSE_MAPPED
+              const float2 InTextureCoordinate : TexCoord,
+#endif
+#if SKINNED
+              const uint4 InBoneIndices : BlendIndices,
+              const float4 InBoneWeights : BlendWeight,
+#endif
+#if VERTEX_OCCLUSION
+              const float InOcclusion : Occlusion,
+#endif
+#if LIGHTMAPPED
+              const float2 InLightmapTexCoord : LightmapTexCoord,
+#endif
+#if MORPHED || VERTEX_ANIMATED
+              const uint InVertexID : SV_VertexID,
+#endif
+              const uint InInstanceID : SV_InstanceID)
+{
+#if INSTANCED
+    const matrix Model = InstanceTransforms[GetDrawnInstance(InInstanceID)].Model;
+    const uint MaterialIndex = InstanceTransforms[GetDrawnInstance(InInstanceID)].MaterialIndex;
+    const uint Animation = InstanceTransforms[GetDrawnInstance(InInstanceID)].Animation;
+#endif
+
+#if DIFFUSE_MAPPED
+    const float3 DecodedNormal = DecodeOctahedralNormal(InNormal);
+#else
+    const float3 DecodedNormal = InNormal;
+#endif
+
+#if VERTEX_ANIMATED
+    const AnimatedVertex Animated = SampleVertexAnimation(InVertexID, Animation);
+    const float3 ModelPosition = Animated.Position;
+    const float3 Normal = RotateByQuaternion(DecodedNormal, Animated.Rotation);
+#elif MORPHED
+    float3 ModelPosition = InModelPosition;
+    float3 MorphedNormal = DecodedNormal;
+    ApplyMorphTargets(InVertexID, ModelPosition, MorphedNormal);
+    const float3 Normal = normalize(MorphedNormal);
+#else
+    const float3 ModelPosition = InModelPosition;
+    const float3 Normal = DecodedNormal;
+#endif
+
+#if SKINNED
+    const matrix Skin = GetSkinTransform(InBoneIndices, InBoneWeights);
+    const float4 SkinnedPosition = mul(float4(ModelPosition, 1.0f), Skin);
+    const float3x3 ModelRotation = mul((float3x3) Skin, (float3x3) Model);
+#else
+    const float4 SkinnedPosition = float4(ModelPosition, 1.0f);
+    const float3x3 ModelRotation = (float3x3) Model;
+#endif
+
+    const float4 WorldPosition = mul(SkinnedPosition, Model);
+    const EyePosition Projected = ProjectToEye(WorldPosition, InInstanceID);
+
+    VSOutput VSOutput;
+    VSOutput.VertexWorldPosition = (float3) WorldPosition;
+    VSOutput.NormalWorldPosition = mul(Normal, ModelRotation);
+    VSOutput.VertexPosition = Projected.Position;
+    VSOutput.ClipDistance = Projected.ClipDistance;
+    VSOutput.MaterialIndex = MaterialIndex;
+
+#if NORMAL_MAPPED
+    float3 Tangent;
+    float3 Bitangent;
+#if VERTEX_ANIMATED
+    // The frame is decoded as imported and turned with the normal.
+    DecodeTangentFrame(InTangentFrame, DecodedNormal, Tangent, Bitangent);
+    Tangent = RotateByQuaternion(Tangent, Animated.Rotation);
+    Bitangent = RotateByQuaternion(Bitangent, Animated.Rotation);
+#else
+    DecodeTangentFrame(InTangentFrame, Normal, Tangent, Bitangent);
+#endif
+
+    VSOutput.TangentWorldPosition = mul(Tangent, ModelRotation);
+    VSOutput.BitangentWorldPosition = mul(Bitangent, ModelRotation);
+#endif
+#if DIFFUSE_MAPPED
+    VSOutput.TextureCoordinate = InTextureCoordinate;
+#endif
+#if VERTEX_OCCLUSION
+    VSOutput.Occlusion = InOcclusion;
+#else
+    VSOutput.Occlusion = 1.0f;
+#endif
+#if LIGHTMAPPED
+    VSOutput.LightmapTexCoord = InLightmapTexCoord;
+#endif
+
+    return VSOutput;
+}
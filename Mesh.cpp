@@ -1,558 +1,3826 @@
 ﻿#include "Mesh.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "AllocationTracker.h"
+#include "AssetArchive.h"
 #include "Bindables.h"
-#include "Camera.h"
+#include "ExceptionMacros.h"
+#include "FrameArena.h"
+#include "FrameProfiler.h"
+#include "GltfFile.h"
+#include "ImportProfile.h"
+#include "Impostor.h"
+#include "JobSystem.h"
+#include "Lightmapper.h"
+#include "Logger.h"
+#include "MeshOptimizer.h"
 #include "PointLight.h"
+#include "SolidSphere.h"
 #include "Surface.h"
+#include "TriangleBvh.h"
+#include "assimp/DefaultIOSystem.h"
 #include "assimp/Importer.hpp"
+#include "assimp/MemoryIOWrapper.h"
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
 #include "imgui/imgui.h"
 
-Mesh::Mesh(const Graphics& InGraphics, std::vector<std::shared_ptr<Bindable>>&& InBindables)
+Mesh::Mesh(const Graphics& InGraphics, const Description& InDescription)
+	: Bounds(InDescription.Bounds), Lods(InDescription.Lods), Meshlets(InDescription.Meshlets), Triangles(InDescription.Triangles), Bones(InDescription.Bones),
+	  Morphs(InDescription.Morphs), BakedAnimation(InDescription.BakedAnimation), UnitsPerTexcoord(InDescription.UnitsPerTexcoord)
 {
-	Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
+	assert(!Lods.empty() && "Meshes need at least their full detail level");
 
-	for (auto& Bindable : InBindables)
+	SetEventName({InDescription.Name.begin(), InDescription.Name.end()});
+
+	for (const auto& Bindable : InDescription.Bindables)
 	{
-		Bind(std::move(Bindable));
+		if (const auto* BoundMaterial = dynamic_cast<const Material*>(Bindable.get()))
+		{
+			MyMaterial = BoundMaterial;
+		}
+
+		Bind(Bindable);
 	}
 
 	Bind(std::make_unique<TransformConstantBuffer>(InGraphics, *this, TransformConstantBuffer::Target::Vertex));
+	// The material and depth-only vertex shaders it is drawn with both place each copy of an instance in its eye.
+	EnableStereoInstancing();
+
+	if (Bones)
+	{
+		MyBonePalette = std::make_shared<BonePalette>(InGraphics, static_cast<UINT>(Bones->size()));
+		BoneTransforms.resize(Bones->size());
+		Bind(MyBonePalette);
+	}
+
+	if (Morphs)
+	{
+		MyMorphWeights = std::make_shared<VertexConstantBuffer<MorphTargets::Weights>>(InGraphics, MorphTargets::WeightSlot);
+		Bind(Morphs);
+		Bind(MyMorphWeights);
+	}
+
+	if (BakedAnimation)
+	{
+		Bind(BakedAnimation);
+	}
+
+	if (InDescription.InstancedVertexShader)
+	{
+		BindInstanced(InGraphics, InDescription.InstancedVertexShader);
+	}
+
+	BindDepthOnly(InGraphics, IsMorphed(), IsVertexAnimated());
+	ApplyLod(0u);
+}
+
+void Mesh::Submit(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, const int InForcedLod, const unsigned int InSceneIndex) const
+{
+	Place(InAccumulatedTransform, InSceneIndex);
+
+	const auto PixelsPerMeshUnit = GetPixelsPerMeshUnit(InGraphics, InAccumulatedTransform);
+	// Errors measured against fewer pixels are as if the error allowed were larger.
+	SelectLod(PixelsPerMeshUnit / InGraphics.GetLodErrorScale(), InForcedLod == AutomaticLod && !InGraphics.IsLodSelectionEnabled() ? 0 : InForcedLod);
+	RequestTextureDetail(PixelsPerMeshUnit);
+
+	// Drawn again at a fraction of the size, for which pages of its material's virtual maps are on screen.
+	if (auto* const VirtualTextures = InGraphics.GetVirtualTextureCache(); VirtualTextures && MyMaterial && MyMaterial->GetFeedbackPixelShader())
+	{
+		VirtualTextures->AddCandidate(*this, *MyMaterial->GetFeedbackPixelShader());
+	}
+
+	auto OcclusionSlot = OcclusionCuller::NoSlot;
+	// Meshes split into meshlets are then tested per meshlet by the meshlet culler and instanced ones per instance by the
+	// instance culler, both against the same pyramid. It is of the camera's view alone, nothing of a multi-view frame is culled on the GPU.
+	const auto bIsGpuCulled = !InGraphics.IsMultiView();
+	const auto bIsCulledPerMeshlet = bIsGpuCulled && InGraphics.GetMeshletCuller().IsEnabled() && !GetMeshlets().empty();
+	const auto bIsCulledPerInstance = bIsGpuCulled && !bIsCulledPerMeshlet && InGraphics.GetInstanceCuller().IsEnabled() &&
+	                                  InGraphics.GetRenderQueue().IsInstancingEnabled() && GetInstanceGroup();
+
+	if (auto& Culler = InGraphics.GetOcclusionCuller(); bIsGpuCulled && Culler.IsEnabled() && !bIsCulledPerMeshlet && !bIsCulledPerInstance)
+	{
+		DirectX::BoundingBox WorldBounds;
+		Bounds.Transform(WorldBounds, InAccumulatedTransform);
+		OcclusionSlot = Culler.AddCandidate(WorldBounds, GetIndexCount(), GetStartIndex(), GetBaseVertex());
+	}
+
+	// Meshlet culled draws already skip what is hidden, and an instanced group is drawn by whichever member comes first.
+	DrawPredicate = nullptr;
+	const auto bIsInstanced = InGraphics.GetRenderQueue().IsInstancingEnabled() && GetInstanceGroup();
+
+	if (auto& Predication = InGraphics.GetOcclusionPredication();
+	    bIsGpuCulled && Predication.IsEligible(Lods.front().IndexNum / 3u) && !bIsCulledPerMeshlet && !bIsInstanced)
+	{
+		DirectX::BoundingBox WorldBounds;
+		Bounds.Transform(WorldBounds, InAccumulatedTransform);
+		DrawPredicate = Predication.AddCandidate(PredicationHistory, WorldBounds);
+	}
+
+	// A mesh that moved since its last submit needs motion of its own, the camera's alone would leave it smeared.
+	if (auto& Temporal = InGraphics.GetTemporalAntiAliasing(); Temporal.IsActive() && IsDepthOnlySupported() && bHasSubmitted &&
+	    std::memcmp(&SubmittedTransform, &TransformMatrix, sizeof(TransformMatrix)) != 0)
+	{
+		Temporal.AddMovedDrawable(*this, DirectX::XMLoadFloat4x4(&SubmittedTransform));
+	}
+
+	SubmittedTransform = TransformMatrix;
+	bHasSubmitted = true;
+
+	Drawable::Submit(InGraphics, RenderPass::Opaque, OcclusionSlot);
+}
+
+void Mesh::SubmitShadowCaster(const Graphics& InGraphics, const unsigned int InShadowIndex, const DirectX::XMMATRIX& InAccumulatedTransform,
+                              const unsigned int InSceneIndex) const
+{
+	Place(InAccumulatedTransform, InSceneIndex);
+
+	DirectX::BoundingBox WorldBounds;
+	Bounds.Transform(WorldBounds, InAccumulatedTransform);
+	InGraphics.GetPointLightShadows().AddCaster(InShadowIndex, *this, WorldBounds);
+}
+
+void Mesh::SubmitSunCaster(const Graphics& InGraphics, const unsigned int InCascade, const DirectX::XMMATRIX& InAccumulatedTransform,
+                           const unsigned int InSceneIndex) const
+{
+	Place(InAccumulatedTransform, InSceneIndex);
+
+	DirectX::BoundingBox WorldBounds;
+	Bounds.Transform(WorldBounds, InAccumulatedTransform);
+	InGraphics.GetDirectionalLight().AddCaster(InCascade, *this, WorldBounds);
+}
+
+void Mesh::SubmitReflectionCapture(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, const unsigned int InSceneIndex) const
+{
+	Place(InAccumulatedTransform, InSceneIndex);
+	InGraphics.GetReflectionProbes().AddCapture(*this);
+}
+
+void Mesh::SubmitIrradianceCapture(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, const unsigned int InSceneIndex) const
+{
+	Place(InAccumulatedTransform, InSceneIndex);
+	InGraphics.GetIrradianceVolume().AddCapture(*this);
+}
+
+void Mesh::SubmitPickCandidate(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, const void* InOwner,
+                               const unsigned int InItem, const unsigned int InSceneIndex) const
+{
+	Place(InAccumulatedTransform, InSceneIndex);
+	InGraphics.GetObjectPicker().AddCandidate(*this, InOwner, InItem);
+}
+
+void Mesh::SubmitImpostorBake(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, const unsigned int InSceneIndex) const
+{
+	Place(InAccumulatedTransform, InSceneIndex);
+	ApplyLod(0u);
+	InGraphics.GetImpostorBaker().AddDrawable(*this);
+}
+
+DirectX::XMMATRIX Mesh::GetTransformMatrix() const noexcept
+{
+	return DirectX::XMLoadFloat4x4(&TransformMatrix);
+}
+
+void Mesh::Place(DirectX::FXMMATRIX InAccumulatedTransform, const unsigned int InSceneIndex) const noexcept
+{
+	DirectX::XMStoreFloat4x4(&TransformMatrix, InAccumulatedTransform);
+	SceneIndex = InSceneIndex;
+}
+
+void Mesh::UpdateSkin(const Graphics& InGraphics, const NodeHierarchy& InHierarchy, DirectX::FXMMATRIX InMeshTransform)
+{
+	assert(IsSkinned() && "Only skinned meshes have bones to pose");
+
+	// Bind pose into bone space, out into the world along the bone, and back into the mesh's node so Model can follow as usual.
+	const auto WorldToMesh = DirectX::XMMatrixInverse(nullptr, InMeshTransform);
+
+	for (size_t Index = 0u; Index < Bones->size(); ++Index)
+	{
+		const auto& [Node, Offset] = (*Bones)[Index];
+		const auto Bone = DirectX::XMLoadFloat4x4(&Offset) * InHierarchy.GetWorldTransform(Node) * WorldToMesh;
+		DirectX::XMStoreFloat4x4(&BoneTransforms[Index], DirectX::XMMatrixTranspose(Bone));
+	}
+
+	MyBonePalette->Update(InGraphics.GetImmediateContext(), BoneTransforms);
+}
+
+void Mesh::SetMorphWeight(const std::string_view InTarget, const float InWeight) noexcept
+{
+	assert(IsMorphed() && "Only morphed meshes have blend shapes to weight");
+
+	if (const auto Target = Morphs->FindTarget(InTarget); Target < Morphs->GetTargetNum() && MorphWeights.Values[Target] != InWeight)
+	{
+		MorphWeights.Values[Target] = InWeight;
+		bAreMorphWeightsStale = true;
+	}
+}
+
+bool Mesh::UpdateMorphWeights(const Graphics& InGraphics)
+{
+	assert(IsMorphed() && "Only morphed meshes have blend shapes to weight");
+
+	if (!bAreMorphWeightsStale)
+	{
+		return false;
+	}
+
+	// A face at rest has every target at zero, its vertices then skip their deltas.
+	MorphWeights.ActiveNum = static_cast<UINT>(std::count_if(std::begin(MorphWeights.Values), std::end(MorphWeights.Values), [](const float InWeight)
+	{
+		return InWeight != 0.0f;
+	}));
+
+	MyMorphWeights->Update(InGraphics.GetImmediateContext(), MorphWeights);
+	bAreMorphWeightsStale = false;
+	return true;
+}
+
+std::span<const MeshOptimizer::Meshlet> Mesh::GetMeshlets() const noexcept
+{
+	if (!Meshlets || CurrentLod != 0u)
+	{
+		return {};
+	}
+
+	return *Meshlets;
+}
+
+float Mesh::GetPixelsPerMeshUnit(const Graphics& InGraphics, DirectX::FXMMATRIX InAccumulatedTransform) const noexcept
+{
+	DirectX::BoundingSphere LocalSphere;
+	DirectX::BoundingSphere::CreateFromBoundingBox(LocalSphere, Bounds);
+	DirectX::BoundingSphere WorldSphere;
+	LocalSphere.Transform(WorldSphere, InAccumulatedTransform);
+
+	const auto ViewCenter = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&WorldSphere.Center), InGraphics.GetViewMatrix());
+	const auto Distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(ViewCenter)) - WorldSphere.Radius;
+
+	// Inside the bounds any part of the mesh could be right in front of the camera.
+	if (Distance <= 0.0f)
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+
+	// The projection's vertical scale turns a world space length at Distance into pixels.
+	const auto MeshScale = LocalSphere.Radius > 0.0f ? WorldSphere.Radius / LocalSphere.Radius : 1.0f;
+	const auto PixelsPerUnit = DirectX::XMVectorGetY(InGraphics.GetProjectionMatrix().r[1]) * 0.5f * InGraphics.GetViewport().Height / Distance;
+
+	return MeshScale * PixelsPerUnit;
+}
+
+void Mesh::SelectLod(const float InPixelsPerMeshUnit, const int InForcedLod) const noexcept
+{
+	const auto LodNum = static_cast<unsigned int>(Lods.size());
+
+	if (InForcedLod != AutomaticLod)
+	{
+		ApplyLod(std::min(static_cast<unsigned int>(InForcedLod), LodNum - 1u));
+		return;
+	}
+
+	// Any simplification could be right in front of the camera.
+	if (std::isinf(InPixelsPerMeshUnit))
+	{
+		ApplyLod(0u);
+		return;
+	}
+
+	// Errors are stored in mesh units.
+	const auto GetScreenError = [&](const unsigned int InLod)
+	{
+		return Lods[InLod].Error * InPixelsPerMeshUnit;
+	};
+
+	auto Lod = std::min(CurrentLod, LodNum - 1u);
+
+	while (Lod + 1u < LodNum && GetScreenError(Lod + 1u) <= MaxScreenError * LodHysteresis)
+	{
+		++Lod;
+	}
+
+	while (Lod > 0u && GetScreenError(Lod) > MaxScreenError)
+	{
+		--Lod;
+	}
+
+	ApplyLod(Lod);
+}
+
+void Mesh::ApplyLod(const unsigned int InLod) const noexcept
+{
+	CurrentLod = InLod;
+	SetIndexRange(InLod, Lods[InLod].FirstIndex, Lods[InLod].IndexNum);
+}
+
+void Mesh::RequestTextureDetail(const float InPixelsPerMeshUnit) const noexcept
+{
+	if (!MyMaterial)
+	{
+		return;
+	}
+
+	// Without a measured density the finest level is the only safe guess.
+	const auto PixelsPerTexcoord = UnitsPerTexcoord > 0.0f ? UnitsPerTexcoord * InPixelsPerMeshUnit : std::numeric_limits<float>::infinity();
+	MyMaterial->RequestDetail(PixelsPerTexcoord);
+}
+
+namespace
+{
+	constexpr DirectX::BoundingBox EmptyBounds {{0.0f, 0.0f, 0.0f}, {-1.0f, -1.0f, -1.0f}};
+
+	bool IsEmpty(const DirectX::BoundingBox& InBounds) noexcept
+	{
+		return InBounds.Extents.x < 0.0f;
+	}
+
+	void MergeBounds(DirectX::BoundingBox& InOutBounds, const DirectX::BoundingBox& InOther) noexcept
+	{
+		if (IsEmpty(InOther))
+		{
+			return;
+		}
+
+		if (IsEmpty(InOutBounds))
+		{
+			InOutBounds = InOther;
+			return;
+		}
+
+		DirectX::BoundingBox::CreateMerged(InOutBounds, InOutBounds, InOther);
+	}
+}
+
+NodeHierarchy::Structure::Structure(const MeshCache::NodeList& InNodes, const std::span<const DirectX::BoundingBox> InMeshBounds)
+{
+	const auto NodeNum = InNodes.size();
+	Names.reserve(NodeNum);
+	Parents.resize(NodeNum, NoParent);
+	SubtreeEnds.resize(NodeNum, static_cast<unsigned int>(NodeNum));
+	MeshOffsets.reserve(NodeNum + 1u);
+	BaseTransforms.reserve(NodeNum);
+	NodeBounds.resize(NodeNum, EmptyBounds);
+
+	// Nodes whose children are still being read, with the number of children left.
+	std::vector<std::pair<unsigned int, unsigned int>> OpenNodes;
+
+	for (unsigned int Index = 0u; Index < NodeNum; ++Index)
+	{
+		const auto& Entry = InNodes[Index];
+
+		Names.emplace_back(Entry.Name);
+		MeshOffsets.push_back(static_cast<unsigned int>(MeshIndices.size()));
+		MeshIndices.insert(MeshIndices.end(), Entry.MeshIndices.begin(), Entry.MeshIndices.end());
+		BaseTransforms.emplace_back(&Entry.Transform._11);
+
+		for (const auto MeshIndex : Entry.MeshIndices)
+		{
+			MergeBounds(NodeBounds[Index], InMeshBounds[MeshIndex]);
+		}
+
+		if (!OpenNodes.empty())
+		{
+			Parents[Index] = OpenNodes.back().first;
+			--OpenNodes.back().second;
+		}
+
+		OpenNodes.emplace_back(Index, Entry.ChildNum);
+
+		while (!OpenNodes.empty() && OpenNodes.back().second == 0u)
+		{
+			SubtreeEnds[OpenNodes.back().first] = Index + 1u;
+			OpenNodes.pop_back();
+		}
+	}
+
+	MeshOffsets.push_back(static_cast<unsigned int>(MeshIndices.size()));
+}
+
+NodeHierarchy::NodeHierarchy(std::shared_ptr<const Structure> InStructure)
+	: MyStructure(std::move(InStructure)), LocalTransforms(MyStructure->BaseTransforms)
+{
+	const auto NodeNum = GetNodeNum();
+	DirectX::XMStoreFloat4x4A(&RootTransform, DirectX::XMMatrixIdentity());
+	WorldTransforms.resize(NodeNum);
+	DirtyFlags.resize(NodeNum, 1u);
+	WorldBounds.resize(NodeNum, EmptyBounds);
+	UpdatedNodes.reserve(NodeNum);
+	ChangedNodes.reserve(NodeNum);
+}
+
+void NodeHierarchy::SetAppliedTransform(const unsigned int InIndex, DirectX::FXMMATRIX InTransform) noexcept
+{
+	DirectX::XMStoreFloat4x4A(&LocalTransforms[InIndex], InTransform * DirectX::XMLoadFloat4x4A(&MyStructure->BaseTransforms[InIndex]));
+	DirtyFlags[InIndex] = 1u;
+}
+
+void NodeHierarchy::SetAnimatedTransform(const unsigned int InIndex, DirectX::FXMMATRIX InTransform) noexcept
+{
+	DirectX::XMStoreFloat4x4A(&LocalTransforms[InIndex], InTransform);
+	DirtyFlags[InIndex] = 1u;
+}
+
+void NodeHierarchy::CopyAppliedTransforms(const NodeHierarchy& InOther) noexcept
+{
+	assert(InOther.GetNodeNum() == GetNodeNum() && "Hierarchies are over different nodes");
+
+	// The imported transforms are the same, so the local ones carry what was applied on top of them.
+	LocalTransforms = InOther.LocalTransforms;
+	std::fill(DirtyFlags.begin(), DirtyFlags.end(), 1u);
+}
+
+void NodeHierarchy::SetRootTransform(DirectX::FXMMATRIX InTransform) noexcept
+{
+	DirectX::XMStoreFloat4x4A(&RootTransform, InTransform);
+
+	// Every top level node, their subtrees follow them.
+	for (unsigned int Index = 0u; Index < GetNodeNum(); Index = GetSubtreeEnd(Index))
+	{
+		DirtyFlags[Index] = 1u;
+	}
+}
+
+void NodeHierarchy::UpdateWorldTransforms() noexcept
+{
+	PROFILE_SCOPE("NodeHierarchy::UpdateWorldTransforms");
+
+	const auto NodeNum = GetNodeNum();
+	const auto& Parents = MyStructure->Parents;
+	const auto& SubtreeEnds = MyStructure->SubtreeEnds;
+	const auto& NodeBounds = MyStructure->NodeBounds;
+	const auto Root = DirectX::XMLoadFloat4x4A(&RootTransform);
+	UpdatedNodes.clear();
+	ChangedNodes.clear();
+
+	for (unsigned int Index = 0u; Index < NodeNum;)
+	{
+		if (!DirtyFlags[Index])
+		{
+			++Index;
+			continue;
+		}
+
+		// Everything below a dirty node is stale as well and follows it contiguously.
+		for (const auto End = SubtreeEnds[Index]; Index < End; ++Index)
+		{
+			auto World = DirectX::XMLoadFloat4x4A(&LocalTransforms[Index]);
+
+			const auto Parent = Parents[Index];
+			World = DirectX::XMMatrixMultiply(World, Parent != NoParent ? DirectX::XMLoadFloat4x4A(&WorldTransforms[Parent]) : Root);
+
+			DirectX::XMStoreFloat4x4A(&WorldTransforms[Index], World);
+
+			if (DirtyFlags[Index])
+			{
+				ChangedNodes.push_back(Index);
+				DirtyFlags[Index] = 0u;
+			}
+
+			if (!IsEmpty(NodeBounds[Index]))
+			{
+				NodeBounds[Index].Transform(WorldBounds[Index], World);
+			}
+
+			UpdatedNodes.push_back(Index);
+		}
+	}
 }
 
-void Mesh::Draw(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform) const
-{
-	DirectX::XMStoreFloat4x4(&TransformMatrix, InAccumulatedTransform);
-	Drawable::Draw(InGraphics);
-}
+class ModelWindow
+{
+public:
+	struct TransformParameters
+	{
+		float Roll = 0.0f;
+		float Pitch = 0.0f;
+		float Yaw = 0.0f;
+		float X = 0.0f;
+		float Y = 0.0f;
+		float Z = 0.0f;
+	};
+
+	// True when the selected node was asked to be frozen.
+	[[nodiscard]] bool Show(const std::string_view InWindowName, NodeHierarchy& InHierarchy) noexcept
+	{
+		const auto WindowName = !InWindowName.empty() ? InWindowName : "Model";
+		bool bIsFreezeRequested = false;
+
+		if (ImGui::Begin(WindowName.data()))
+		{
+			if (NodeTransforms.size() != InHierarchy.GetNodeNum())
+			{
+				Attach(InHierarchy);
+			}
+
+			ImGui::Columns(2, nullptr, true);
+
+			if (ImGui::InputTextWithHint("##Filter", "Search nodes", Filter, sizeof(Filter)))
+			{
+				bAreRowsStale = true;
+			}
+
+			if (bAreRowsStale)
+			{
+				BuildRows(InHierarchy);
+			}
+
+			ShowTree(InHierarchy);
+
+			ImGui::NextColumn();
+
+			auto& [Roll, Pitch, Yaw, X, Y, Z] = NodeTransforms[SelectedNodeIndex];
+			bool bIsChanged = false;
+
+			ImGui::Text("Orientation");
+			bIsChanged |= ImGui::SliderAngle("Roll", &Roll, -180.0f, 180.0f);
+			bIsChanged |= ImGui::SliderAngle("Pitch", &Pitch, -180.0f, 180.0f);
+			bIsChanged |= ImGui::SliderAngle("Yaw", &Yaw, -180.0f, 180.0f);
+			ImGui::Text("Position");
+			bIsChanged |= ImGui::SliderFloat("X", &X, -20.0f, 20.0f);
+			bIsChanged |= ImGui::SliderFloat("Y", &Y, -20.0f, 20.0f);
+			bIsChanged |= ImGui::SliderFloat("Z", &Z, -20.0f, 20.0f);
+
+			// Only an edit dirties the node, an untouched hierarchy costs nothing to update.
+			if (bIsChanged)
+			{
+				InHierarchy.SetAppliedTransform(SelectedNodeIndex, GetTransformMatrix());
+			}
+
+			ImGui::Text("Level of detail");
+			ImGui::SliderInt("Forced", &ForcedLod, Mesh::AutomaticLod, static_cast<int>(Mesh::MaxLodNum) - 1, ForcedLod == Mesh::AutomaticLod ? "Automatic" : "%d");
+
+			// Merges the meshes below into a draw per material, the nodes below stop moving them.
+			bIsFreezeRequested = ImGui::Button("Freeze subtree");
+		}
+
+		ImGui::End();
+		return bIsFreezeRequested;
+	}
+
+	// The node is revealed, its ancestors expanded and the tree scrolled to it, the next time the window is shown.
+	void Select(const unsigned int InIndex)
+	{
+		SelectedNodeIndex = InIndex;
+		bIsRevealPending = true;
+		bAreRowsStale = true;
+	}
+
+	// Forgets what was set for the nodes in [InFirst, InEnd), their sliders start from the imported transform again.
+	void Reset(const unsigned int InFirst, const unsigned int InEnd)
+	{
+		for (auto Index = InFirst; Index < std::min(InEnd, static_cast<unsigned int>(NodeTransforms.size())); ++Index)
+		{
+			NodeTransforms[Index] = {};
+		}
+	}
+
+	// As if the node's sliders had been dragged there.
+	void SetTransform(NodeHierarchy& InHierarchy, const unsigned int InIndex, const TransformParameters& InParameters)
+	{
+		if (NodeTransforms.size() != InHierarchy.GetNodeNum())
+		{
+			Attach(InHierarchy);
+		}
+
+		NodeTransforms[InIndex] = InParameters;
+		InHierarchy.SetAppliedTransform(InIndex, MakeTransformMatrix(InParameters));
+	}
+
+	// Indexed by node, empty until the window was shown or a transform set.
+	[[nodiscard]] const std::vector<TransformParameters>& GetTransforms() const noexcept
+	{
+		return NodeTransforms;
+	}
+
+	[[nodiscard]] unsigned int GetSelectedNode() const noexcept
+	{
+		return SelectedNodeIndex;
+	}
+
+	// Applies to every mesh of the model, meshes with fewer levels draw their coarsest.
+	[[nodiscard]] int GetForcedLod() const noexcept
+	{
+		return ForcedLod;
+	}
+
+	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept
+	{
+		return MakeTransformMatrix(NodeTransforms[SelectedNodeIndex]);
+	}
+
+	[[nodiscard]] static DirectX::XMMATRIX MakeTransformMatrix(const TransformParameters& InParameters) noexcept
+	{
+		const auto& [Roll, Pitch, Yaw, X, Y, Z] = InParameters;
+		return DirectX::XMMatrixRotationRollPitchYaw(Roll, Pitch, Yaw) *
+			   DirectX::XMMatrixTranslation(X, Y, Z);
+	}
+
+private:
+	struct Row
+	{
+		unsigned int NodeIndex;
+		unsigned int Depth;
+	};
+
+	// Per node state sized to the hierarchy, only the top level starts expanded.
+	void Attach(const NodeHierarchy& InHierarchy)
+	{
+		const auto NodeNum = InHierarchy.GetNodeNum();
+		NodeTransforms.assign(NodeNum, {});
+		ExpandedFlags.assign(NodeNum, 0u);
+		Depths.assign(NodeNum, 0u);
+
+		for (unsigned int Index = 0u; Index < NodeNum; ++Index)
+		{
+			if (const auto Parent = InHierarchy.GetParent(Index); Parent != NodeHierarchy::NoParent)
+			{
+				Depths[Index] = Depths[Parent] + 1u;
+			}
+		}
+
+		SelectedNodeIndex = std::min(SelectedNodeIndex, NodeNum - 1u);
+		bAreRowsStale = true;
+	}
+
+	// The rows the tree shows, every node whose ancestors are all expanded, or with a filter every match and its ancestors.
+	// Only rebuilt when a node is expanded or collapsed or the filter changes, drawing the tree never walks the hierarchy.
+	void BuildRows(const NodeHierarchy& InHierarchy)
+	{
+		const auto NodeNum = InHierarchy.GetNodeNum();
+		Rows.clear();
+
+		if (bIsRevealPending)
+		{
+			for (auto Ancestor = InHierarchy.GetParent(SelectedNodeIndex); Ancestor != NodeHierarchy::NoParent; Ancestor = InHierarchy.GetParent(Ancestor))
+			{
+				ExpandedFlags[Ancestor] = 1u;
+			}
+		}
+
+		if (Filter[0] == '\0')
+		{
+			for (unsigned int Index = 0u; Index < NodeNum;)
+			{
+				Rows.push_back({Index, Depths[Index]});
+				Index = ExpandedFlags[Index] ? Index + 1u : InHierarchy.GetSubtreeEnd(Index);
+			}
+		}
+		else
+		{
+			// Children follow their parents, so walking back to front sees a whole subtree before its root.
+			std::vector<unsigned char> ShownFlags(NodeNum, 0u);
+
+			for (auto Index = NodeNum; Index-- > 0u;)
+			{
+				ShownFlags[Index] |= Contains(InHierarchy.GetName(Index), Filter) ? 1u : 0u;
+
+				if (const auto Parent = InHierarchy.GetParent(Index); ShownFlags[Index] && Parent != NodeHierarchy::NoParent)
+				{
+					ShownFlags[Parent] = 1u;
+				}
+			}
+
+			for (unsigned int Index = 0u; Index < NodeNum;)
+			{
+				if (!ShownFlags[Index])
+				{
+					Index = InHierarchy.GetSubtreeEnd(Index);
+					continue;
+				}
+
+				Rows.push_back({Index, Depths[Index]});
+				++Index;
+			}
+		}
+
+		bAreRowsStale = false;
+	}
+
+	// Only the rows in view are submitted, the cost follows the window height instead of the hierarchy size.
+	void ShowTree(const NodeHierarchy& InHierarchy)
+	{
+		if (!ImGui::BeginChild("Nodes"))
+		{
+			ImGui::EndChild();
+			return;
+		}
+
+		const auto bIsFiltered = Filter[0] != '\0';
+		const auto IndentWidth = ImGui::GetStyle().IndentSpacing;
+		auto RevealRow = -1;
+
+		if (bIsRevealPending)
+		{
+			for (size_t RowIndex = 0u; RowIndex < Rows.size(); ++RowIndex)
+			{
+				if (Rows[RowIndex].NodeIndex == SelectedNodeIndex)
+				{
+					RevealRow = static_cast<int>(RowIndex);
+					break;
+				}
+			}
+
+			bIsRevealPending = false;
+		}
+
+		ImGuiListClipper Clipper;
+		Clipper.Begin(static_cast<int>(Rows.size()));
+
+		if (RevealRow >= 0)
+		{
+			Clipper.IncludeItemByIndex(RevealRow);
+		}
+
+		while (Clipper.Step())
+		{
+			for (auto RowIndex = Clipper.DisplayStart; RowIndex < Clipper.DisplayEnd; ++RowIndex)
+			{
+				const auto [Index, Depth] = Rows[RowIndex];
+				const int IsCurrentNodeSelected = Index == SelectedNodeIndex;
+				const int IsCurrentNodeLeaf = InHierarchy.GetSubtreeEnd(Index) == Index + 1u;
+
+				const auto NodeFlags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_NoTreePushOnOpen |
+									   (IsCurrentNodeSelected ? ImGuiTreeNodeFlags_Selected : 0) |
+									   (IsCurrentNodeLeaf ? ImGuiTreeNodeFlags_Leaf : 0);
+
+				// Rows are laid out flat, the depth only indents them.
+				ImGui::SetCursorPosX(ImGui::GetCursorPosX() + static_cast<float>(Depth) * IndentWidth);
+
+				// A filtered tree shows every ancestor of a match open.
+				const auto Name = InHierarchy.GetName(Index);
+				ImGui::SetNextItemOpen(bIsFiltered || ExpandedFlags[Index]);
+				ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<intptr_t>(Index)), NodeFlags, "%.*s", static_cast<int>(Name.size()), Name.data());
+
+				if (ImGui::IsItemToggledOpen())
+				{
+					if (!bIsFiltered)
+					{
+						ExpandedFlags[Index] ^= 1u;
+						bAreRowsStale = true;
+					}
+				}
+				else if (ImGui::IsItemClicked())
+				{
+					SelectedNodeIndex = Index;
+				}
+
+				if (RowIndex == RevealRow)
+				{
+					ImGui::SetScrollHereY();
+				}
+			}
+		}
+
+		ImGui::EndChild();
+	}
+
+	[[nodiscard]] static bool Contains(const std::string_view InText, const char* InPattern) noexcept
+	{
+		const std::string_view Pattern(InPattern);
+		return std::search(InText.begin(), InText.end(), Pattern.begin(), Pattern.end(), [](const char InLeft, const char InRight)
+		{
+			return std::tolower(static_cast<unsigned char>(InLeft)) == std::tolower(static_cast<unsigned char>(InRight));
+		}) != InText.end();
+	}
+
+private:
+	unsigned int SelectedNodeIndex {0u};
+	// Indexed by node, sized when the window is first shown with a hierarchy.
+	std::vector<TransformParameters> NodeTransforms;
+	std::vector<unsigned char> ExpandedFlags;
+	std::vector<unsigned int> Depths;
+	std::vector<Row> Rows;
+	char Filter[128] {};
+	bool bAreRowsStale {true};
+	bool bIsRevealPending {false};
+	int ForcedLod {Mesh::AutomaticLod};
+};
+
+namespace
+{
+	// The vertex layout written to the cache has to carry what the shaders of the mesh's material read.
+	unsigned int GetMaterialFeatures(const MeshCache::MeshEntry& InMesh) noexcept
+	{
+		const auto Features = (InMesh.DiffuseMap.empty() ? 0u : Material::DiffuseMapped) |
+							  (InMesh.NormalMap.empty() ? 0u : Material::NormalMapped) |
+							  (InMesh.SpecularMap.empty() ? 0u : Material::SpecularMapped);
+
+		return Material::FindPermutation(Features).Features;
+	}
+
+	// Cut-out maps keep their alpha at either end with some of it below half, like foliage and fences. Soft alpha, such as a mask
+	// reused for something else, has too much in between. False for maps that don't decode, the mesh is drawn opaque.
+	bool IsAlphaCutout(const std::string& InFileName) noexcept
+	{
+		try
+		{
+			const auto Map = Surface::FromFile(InFileName);
+			const auto* const Pixels = Map.GetBufferPtrConst();
+			const size_t PixelNum = static_cast<size_t>(Map.GetWidth()) * Map.GetHeight();
+			size_t CutNum = 0u;
+			size_t HardNum = 0u;
+
+			for (size_t Index = 0u; Index < PixelNum; ++Index)
+			{
+				const auto Alpha = Pixels[Index].GetA();
+				CutNum += Alpha < 128u ? 1u : 0u;
+				HardNum += Alpha <= 16u || Alpha >= 239u ? 1u : 0u;
+			}
+
+			// At least half a percent cut out, nine tenths at either end.
+			return PixelNum > 0u && CutNum * 200u >= PixelNum && HardNum * 10u >= PixelNum * 9u;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+
+	// Holds the mesh at any weights in [0, 1]: each vertex reaches furthest along an axis with every target moving it that way at full weight.
+	DirectX::BoundingBox GetMorphedBounds(const DirectX::BoundingBox& InBounds, const char* InPositions, const size_t InStride,
+	                                      const std::vector<MeshCache::MorphDeltaEntry>& InDeltas) noexcept
+	{
+		const auto Center = DirectX::XMLoadFloat3(&InBounds.Center);
+		const auto Extents = DirectX::XMLoadFloat3(&InBounds.Extents);
+		auto Minimum = DirectX::XMVectorSubtract(Center, Extents);
+		auto Maximum = DirectX::XMVectorAdd(Center, Extents);
+
+		for (size_t First = 0u; First < InDeltas.size();)
+		{
+			const auto Vertex = InDeltas[First].Vertex;
+			const auto Position = DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(InPositions + Vertex * InStride));
+			auto Low = Position;
+			auto High = Position;
+
+			for (; First < InDeltas.size() && InDeltas[First].Vertex == Vertex; ++First)
+			{
+				const auto Delta = DirectX::XMLoadFloat3(&InDeltas[First].Position);
+				Low = DirectX::XMVectorAdd(Low, DirectX::XMVectorMin(Delta, DirectX::XMVectorZero()));
+				High = DirectX::XMVectorAdd(High, DirectX::XMVectorMax(Delta, DirectX::XMVectorZero()));
+			}
+
+			Minimum = DirectX::XMVectorMin(Minimum, Low);
+			Maximum = DirectX::XMVectorMax(Maximum, High);
+		}
+
+		DirectX::BoundingBox Bounds;
+		DirectX::BoundingBox::CreateFromPoints(Bounds, Minimum, Maximum);
+		return Bounds;
+	}
+
+	// Square root of the full detail surface area over its texture coordinate area, what texture streaming scales screen size by.
+	float GetUnitsPerTexcoord(const MeshCache::MeshEntry& InMesh) noexcept
+	{
+		using ElementType = DV::VertexLayout::ElementType;
+
+		const auto Stride = InMesh.Layout.Size();
+		const DV::VertexLayout::Element* TexcoordElement = nullptr;
+
+		for (size_t Index = 0u; Index < InMesh.Layout.Num(); ++Index)
+		{
+			if (const auto& Element = InMesh.Layout.ResolveByIndex(Index);
+				Element.GetType() == ElementType::Texture2D || Element.GetType() == ElementType::HalfTexture2D)
+			{
+				TexcoordElement = &Element;
+				break;
+			}
+		}
+
+		if (!TexcoordElement || InMesh.Lods.empty() || !Stride)
+		{
+			return 0.0f;
+		}
+
+		const auto* Vertices = static_cast<const char*>(InMesh.Vertices);
+		const auto PositionOffset = InMesh.Layout.Resolve<ElementType::Position3D>().GetByteOffset();
+		const auto TexcoordOffset = TexcoordElement->GetByteOffset();
+		const auto bIsHalf = TexcoordElement->GetType() == ElementType::HalfTexture2D;
+		const auto VertexNum = InMesh.VertexBytes / Stride;
+
+		const auto LoadPosition = [&](const unsigned int InVertex)
+		{
+			return DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(Vertices + InVertex * Stride + PositionOffset));
+		};
+
+		const auto LoadTexcoord = [&](const unsigned int InVertex)
+		{
+			const auto* Texcoord = Vertices + InVertex * Stride + TexcoordOffset;
+			return bIsHalf ? DirectX::PackedVector::XMLoadHalf2(reinterpret_cast<const DirectX::PackedVector::XMHALF2*>(Texcoord))
+			               : DirectX::XMLoadFloat2(reinterpret_cast<const DirectX::XMFLOAT2*>(Texcoord));
+		};
+
+		float SurfaceArea = 0.0f;
+		float TexcoordArea = 0.0f;
+		const auto& FullDetail = InMesh.Lods.front();
+
+		for (unsigned int Index = FullDetail.FirstIndex; Index + 2u < FullDetail.FirstIndex + FullDetail.IndexNum; Index += 3u)
+		{
+			const auto First = InMesh.Indices[Index];
+			const auto Second = InMesh.Indices[Index + 1u];
+			const auto Third = InMesh.Indices[Index + 2u];
+
+			if (First >= VertexNum || Second >= VertexNum || Third >= VertexNum)
+			{
+				continue;
+			}
+
+			const auto Origin = LoadPosition(First);
+			SurfaceArea += DirectX::XMVectorGetX(DirectX::XMVector3Length(
+				DirectX::XMVector3Cross(DirectX::XMVectorSubtract(LoadPosition(Second), Origin), DirectX::XMVectorSubtract(LoadPosition(Third), Origin))));
+
+			const auto TexcoordOrigin = LoadTexcoord(First);
+			TexcoordArea += std::abs(DirectX::XMVectorGetZ(DirectX::XMVector2Cross(
+				DirectX::XMVectorSubtract(LoadTexcoord(Second), TexcoordOrigin), DirectX::XMVectorSubtract(LoadTexcoord(Third), TexcoordOrigin))));
+		}
+
+		// Both are twice the triangle areas, the factor cancels.
+		return TexcoordArea > 0.0f ? std::sqrt(SurfaceArea / TexcoordArea) : 0.0f;
+	}
+
+	// 24 bytes instead of 56 with a float normal, tangent, bitangent and texture coordinate.
+	using NormalMappedLayout = DV::StaticLayout
+	<
+		DV::VertexLayout::ElementType::Position3D,
+		DV::VertexLayout::ElementType::OctahedralNormal,
+		DV::VertexLayout::ElementType::TangentFrame,
+		DV::VertexLayout::ElementType::HalfTexture2D
+	>;
+
+	using TexturedLayout = DV::StaticLayout
+	<
+		DV::VertexLayout::ElementType::Position3D,
+		DV::VertexLayout::ElementType::OctahedralNormal,
+		DV::VertexLayout::ElementType::HalfTexture2D
+	>;
+
+	// Untextured MaterialVS variants read float normals.
+	using SolidLayout = DV::StaticLayout
+	<
+		DV::VertexLayout::ElementType::Position3D,
+		DV::VertexLayout::ElementType::Normal
+	>;
+
+	// The same with four bone influences appended, for the SKINNED variants.
+	using NormalMappedSkinnedLayout = DV::StaticLayout
+	<
+		DV::VertexLayout::ElementType::Position3D,
+		DV::VertexLayout::ElementType::OctahedralNormal,
+		DV::VertexLayout::ElementType::TangentFrame,
+		DV::VertexLayout::ElementType::HalfTexture2D,
+		DV::VertexLayout::ElementType::BoneIndices,
+		DV::VertexLayout::ElementType::BoneWeights
+	>;
+
+	using TexturedSkinnedLayout = DV::StaticLayout
+	<
+		DV::VertexLayout::ElementType::Position3D,
+		DV::VertexLayout::ElementType::OctahedralNormal,
+		DV::VertexLayout::ElementType::HalfTexture2D,
+		DV::VertexLayout::ElementType::BoneIndices,
+		DV::VertexLayout::ElementType::BoneWeights
+	>;
+
+	using SolidSkinnedLayout = DV::StaticLayout
+	<
+		DV::VertexLayout::ElementType::Position3D,
+		DV::VertexLayout::ElementType::Normal,
+		DV::VertexLayout::ElementType::BoneIndices,
+		DV::VertexLayout::ElementType::BoneWeights
+	>;
+
+	// The four heaviest bones of a vertex, as indices into the mesh's bones.
+	struct SkinInfluence
+	{
+		DirectX::PackedVector::XMUBYTE4 Bones;
+		DirectX::PackedVector::XMUBYTEN4 Weights;
+	};
+
+	// Empty for meshes without bones or with more than a palette holds, those are drawn rigidly in their bind pose.
+	std::vector<SkinInfluence> GatherInfluences(const aiMesh& InMesh)
+	{
+		if (InMesh.mNumBones == 0u || InMesh.mNumBones > BonePalette::MaxBoneNum)
+		{
+			return {};
+		}
+
+		struct Heaviest
+		{
+			std::array<unsigned int, 4> Bones {};
+			std::array<float, 4> Weights {};
+		};
+
+		std::vector<Heaviest> Heaviests(InMesh.mNumVertices);
+
+		for (unsigned int BoneIndex = 0u; BoneIndex < InMesh.mNumBones; ++BoneIndex)
+		{
+			const auto& Bone = *InMesh.mBones[BoneIndex];
+
+			for (unsigned int WeightIndex = 0u; WeightIndex < Bone.mNumWeights; ++WeightIndex)
+			{
+				const auto Weight = static_cast<float>(Bone.mWeights[WeightIndex].mWeight);
+				auto& [Bones, Weights] = Heaviests[Bone.mWeights[WeightIndex].mVertexId];
+
+				// Kept heaviest first, a heavier influence pushes the lightest one out.
+				if (Weight <= Weights[3])
+				{
+					continue;
+				}
+
+				auto Slot = 3u;
+				for (; Slot > 0u && Weights[Slot - 1u] < Weight; --Slot)
+				{
+					Bones[Slot] = Bones[Slot - 1u];
+					Weights[Slot] = Weights[Slot - 1u];
+				}
+
+				Bones[Slot] = BoneIndex;
+				Weights[Slot] = Weight;
+			}
+		}
+
+		std::vector<SkinInfluence> Influences;
+		Influences.reserve(Heaviests.size());
+
+		for (auto& [Bones, Weights] : Heaviests)
+		{
+			auto Sum = Weights[0] + Weights[1] + Weights[2] + Weights[3];
+
+			// A vertex no bone reaches follows the first one instead of collapsing to the origin.
+			if (Sum <= 0.0f)
+			{
+				Weights[0] = Sum = 1.0f;
+			}
+
+			// Quantized to bytes that still sum to exactly one, the rounding goes to the heaviest influence.
+			std::array<int, 4> Quantized;
+			auto Total = 0;
+
+			for (size_t Index = 0u; Index < Quantized.size(); ++Index)
+			{
+				Quantized[Index] = static_cast<int>(std::lround(Weights[Index] / Sum * 255.0f));
+				Total += Quantized[Index];
+			}
+
+			Quantized[0] += 255 - Total;
+
+			Influences.push_back
+			({
+				DirectX::PackedVector::XMUBYTE4(static_cast<uint8_t>(Bones[0]), static_cast<uint8_t>(Bones[1]), static_cast<uint8_t>(Bones[2]),
+				                                static_cast<uint8_t>(Bones[3])),
+				DirectX::PackedVector::XMUBYTEN4(static_cast<uint8_t>(Quantized[0]), static_cast<uint8_t>(Quantized[1]), static_cast<uint8_t>(Quantized[2]),
+				                                 static_cast<uint8_t>(Quantized[3]))
+			});
+		}
+
+		return Influences;
+	}
+
+	DirectX::XMFLOAT3 ToFloat3(const aiVector3D& InVector) noexcept
+	{
+		return {InVector.x, InVector.y, InVector.z};
+	}
+
+	// Assimp holds every target's positions and normals in full, only the vertices a target moves keep a delta of it.
+	void ExtractMorphTargets(const aiMesh& InMesh, MeshCache::MeshEntry& OutEntry)
+	{
+		// Closer than this to the base mesh is rounding left over from the exporter.
+		constexpr float MinDeltaSquared {1.0e-12f};
+
+		if (InMesh.mNumAnimMeshes > MorphTargets::MaxTargetNum)
+		{
+			LOG_WARNING("'{}' has {} morph targets, only the first {} are kept", InMesh.mName.C_Str(), InMesh.mNumAnimMeshes, MorphTargets::MaxTargetNum);
+		}
+
+		const auto TargetNum = std::min(InMesh.mNumAnimMeshes, MorphTargets::MaxTargetNum);
+
+		for (unsigned int Target = 0u; Target < TargetNum; ++Target)
+		{
+			const auto& AnimMesh = *InMesh.mAnimMeshes[Target];
+			OutEntry.MorphTargetNames.emplace_back(AnimMesh.mName.length > 0u ? AnimMesh.mName.C_Str() : std::to_string(Target));
+		}
+
+		// Vertex by vertex, so the deltas come out in the order the vertex shaders look them up in.
+		for (unsigned int Vertex = 0u; Vertex < InMesh.mNumVertices; ++Vertex)
+		{
+			for (unsigned int Target = 0u; Target < TargetNum; ++Target)
+			{
+				const auto& AnimMesh = *InMesh.mAnimMeshes[Target];
+
+				if (!AnimMesh.HasPositions() || AnimMesh.mNumVertices != InMesh.mNumVertices)
+				{
+					continue;
+				}
+
+				const auto Position = AnimMesh.mVertices[Vertex] - InMesh.mVertices[Vertex];
+				const auto Normal = AnimMesh.HasNormals() && InMesh.HasNormals() ? AnimMesh.mNormals[Vertex] - InMesh.mNormals[Vertex] : aiVector3D {};
+
+				if (Position.SquareLength() > MinDeltaSquared || Normal.SquareLength() > MinDeltaSquared)
+				{
+					OutEntry.MorphDeltas.push_back({Vertex, Target, ToFloat3(Position), ToFloat3(Normal)});
+				}
+			}
+		}
+
+		// Targets that move nothing leave the mesh as static as it was.
+		if (OutEntry.MorphDeltas.empty())
+		{
+			OutEntry.MorphTargetNames.clear();
+		}
+	}
+
+	// Sized once, then every attribute is copied or encoded from its contiguous Assimp streams in one strided pass.
+	template<typename Layout>
+	DV::VertexBuffer ExtractVertices(const aiMesh& InMesh, const std::span<const SkinInfluence> InInfluences = {})
+	{
+		using ElementType = DV::VertexLayout::ElementType;
+
+		DV::StaticVertexBuffer<Layout> Vertices(InMesh.mNumVertices);
+		Vertices.template FillAttribute<ElementType::Position3D>(std::span<const aiVector3D>(InMesh.mVertices, InMesh.mNumVertices));
+
+		if constexpr (Layout::template Has<ElementType::Normal>())
+		{
+			Vertices.template FillAttribute<ElementType::Normal>(std::span<const aiVector3D>(InMesh.mNormals, InMesh.mNumVertices));
+		}
+
+		if constexpr (Layout::template Has<ElementType::OctahedralNormal>())
+		{
+			Vertices.template GenerateAttribute<ElementType::OctahedralNormal>([&InMesh](const size_t InIndex)
+			{
+				return DV::EncodeOctahedralNormal(ToFloat3(InMesh.mNormals[InIndex]));
+			});
+		}
+
+		if constexpr (Layout::template Has<ElementType::TangentFrame>())
+		{
+			Vertices.template GenerateAttribute<ElementType::TangentFrame>([&InMesh](const size_t InIndex)
+			{
+				return DV::EncodeTangentFrame(ToFloat3(InMesh.mNormals[InIndex]), ToFloat3(InMesh.mTangents[InIndex]), ToFloat3(InMesh.mBitangents[InIndex]));
+			});
+		}
+
+		if constexpr (Layout::template Has<ElementType::HalfTexture2D>())
+		{
+			Vertices.template GenerateAttribute<ElementType::HalfTexture2D>([&InMesh](const size_t InIndex)
+			{
+				const auto& TextureCoordinate = InMesh.mTextureCoords[0][InIndex];
+				return DirectX::PackedVector::XMHALF2(TextureCoordinate.x, TextureCoordinate.y);
+			});
+		}
+
+		if constexpr (Layout::template Has<ElementType::BoneIndices>())
+		{
+			assert(InInfluences.size() == InMesh.mNumVertices && "Skinned layouts need an influence per vertex");
+
+			Vertices.template GenerateAttribute<ElementType::BoneIndices>([InInfluences](const size_t InIndex)
+			{
+				return InInfluences[InIndex].Bones;
+			});
+
+			Vertices.template GenerateAttribute<ElementType::BoneWeights>([InInfluences](const size_t InIndex)
+			{
+				return InInfluences[InIndex].Weights;
+			});
+		}
+
+		return std::move(Vertices).ToDynamic();
+	}
+
+	// glTF is right-handed, mirroring Z matches what Assimp's left-handed conversion does to the same file.
+	DirectX::XMFLOAT3 LoadMirrored(const GltfFile::AccessorView& InView, const size_t InIndex) noexcept
+	{
+		DirectX::XMFLOAT3 Mirrored;
+		DirectX::XMStoreFloat3(&Mirrored, DirectX::XMVectorMultiply(InView.Load(InIndex), DirectX::XMVectorSet(1.0f, 1.0f, -1.0f, 1.0f)));
+		return Mirrored;
+	}
+
+	// The same straight from the file's accessors, every attribute encoded in one strided pass without an intermediate copy.
+	template<typename Layout>
+	DV::VertexBuffer ExtractVertices(const GltfFile::Primitive& InPrimitive, const std::span<const DirectX::XMFLOAT3> InPositions)
+	{
+		using ElementType = DV::VertexLayout::ElementType;
+
+		DV::StaticVertexBuffer<Layout> Vertices(InPositions.size());
+		Vertices.template FillAttribute<ElementType::Position3D>(InPositions);
+
+		if constexpr (Layout::template Has<ElementType::Normal>())
+		{
+			Vertices.template GenerateAttribute<ElementType::Normal>([&InPrimitive](const size_t InIndex)
+			{
+				return LoadMirrored(InPrimitive.Normals, InIndex);
+			});
+		}
+
+		if constexpr (Layout::template Has<ElementType::OctahedralNormal>())
+		{
+			Vertices.template GenerateAttribute<ElementType::OctahedralNormal>([&InPrimitive](const size_t InIndex)
+			{
+				return DV::EncodeOctahedralNormal(LoadMirrored(InPrimitive.Normals, InIndex));
+			});
+		}
+
+		if constexpr (Layout::template Has<ElementType::TangentFrame>())
+		{
+			Vertices.template GenerateAttribute<ElementType::TangentFrame>([&InPrimitive](const size_t InIndex)
+			{
+				const auto Normal = LoadMirrored(InPrimitive.Normals, InIndex);
+				const auto Tangent = LoadMirrored(InPrimitive.Tangents, InIndex);
+
+				// The bitangent is cross(N, T) * W in the file, the mirror flips which side of the cross product it is on.
+				DirectX::XMFLOAT3 Bitangent;
+				DirectX::XMStoreFloat3(&Bitangent, DirectX::XMVectorScale(DirectX::XMVector3Cross(DirectX::XMLoadFloat3(&Normal), DirectX::XMLoadFloat3(&Tangent)),
+				                                                          -DirectX::XMVectorGetW(InPrimitive.Tangents.Load(InIndex))));
+
+				return DV::EncodeTangentFrame(Normal, Tangent, Bitangent);
+			});
+		}
+
+		if constexpr (Layout::template Has<ElementType::HalfTexture2D>())
+		{
+			// Both put the origin at the top left, the coordinates are taken as they are.
+			Vertices.template GenerateAttribute<ElementType::HalfTexture2D>([&InPrimitive](const size_t InIndex)
+			{
+				DirectX::PackedVector::XMHALF2 Packed;
+				DirectX::PackedVector::XMStoreHalf2(&Packed, InPrimitive.Texcoords.Load(InIndex));
+				return Packed;
+			});
+		}
+
+		return std::move(Vertices).ToDynamic();
+	}
+
+	// CPU side of a model: either views into a current MeshCache or freshly imported data backed by the storage vectors.
+	struct SourceData
+	{
+		std::unique_ptr<MeshCache> Cache;
+		std::vector<DV::VertexBuffer> VertexStorage;
+		std::vector<std::vector<unsigned int>> IndexStorage;
+		// Meshes of static subtrees, built from the others after the source is read.
+		std::vector<std::vector<char>> MergedVertexStorage;
+		std::vector<std::vector<unsigned int>> MergedIndexStorage;
+		std::vector<MeshCache::MeshEntry> Meshes;
+		// The nodes of fresh imports, names and mesh indices included, dropped in one go with the source.
+		std::unique_ptr<AssetArena> Arena {std::make_unique<AssetArena>()};
+		MeshCache::NodeList Nodes {Arena.get()};
+		std::vector<MeshCache::AnimationEntry> Animations;
+	};
+
+	// Hands Assimp the archived copy of the model and everything it opens alongside it, such as an .obj's materials.
+	class ArchiveIOSystem : public Assimp::DefaultIOSystem
+	{
+	public:
+		bool Exists(const char* InFile) const override
+		{
+			return AssetArchive::Get().Contains(InFile) || DefaultIOSystem::Exists(InFile);
+		}
+
+		Assimp::IOStream* Open(const char* InFile, const char* InMode) override
+		{
+			if (std::string_view(InMode).find_first_of("wa+") != std::string_view::npos || !AssetArchive::Get().Contains(InFile))
+			{
+				return DefaultIOSystem::Open(InFile, InMode);
+			}
+
+			std::vector<std::byte> Bytes;
+			return AssetArchive::Get().Read(InFile, Bytes) ? new Stream(std::move(Bytes)) : nullptr;
+		}
+
+	private:
+		class Stream : public Assimp::MemoryIOStream
+		{
+		public:
+			explicit Stream(std::vector<std::byte>&& InBytes)
+				: MemoryIOStream(reinterpret_cast<const uint8_t*>(InBytes.data()), InBytes.size()), Bytes(std::move(InBytes))
+			{
+			}
+
+		private:
+			// The base only reads, moving the vector in keeps the buffer it was given.
+			std::vector<std::byte> Bytes;
+		};
+	};
+
+	// Only materials with a normal map get vertices with a tangent frame.
+	bool HasNormalMaps(const aiScene& InScene) noexcept
+	{
+		for (unsigned int MaterialIndex = 0u; MaterialIndex < InScene.mNumMaterials; ++MaterialIndex)
+		{
+			if (InScene.mMaterials[MaterialIndex]->GetTextureCount(aiTextureType_NORMALS) > 0u)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const aiScene& ImportScene(Assimp::Importer& InImporter, const std::string& InPath, const ImportProfile& InProfile)
+	{
+		// The importer owns its IO handler.
+		InImporter.SetIOHandler(new ArchiveIOSystem);
+		InProfile.Configure(InImporter);
+
+		const auto* Scene = InImporter.ReadFile(InPath, InProfile.GetSteps());
+
+		// Tangents only depend on positions and texture coordinates, generating them after the left-handed conversion gives the same frames.
+		if (Scene && HasNormalMaps(*Scene))
+		{
+			Scene = InImporter.ApplyPostProcessing(aiProcess_CalcTangentSpace);
+		}
+
+		if (!Scene)
+		{
+			throw INFO_EXCEPTION({InImporter.GetErrorString()});
+		}
+
+		return *Scene;
+	}
+
+	std::vector<MeshCache::MeshletEntry> BuildMeshlets(const DV::VertexLayout& InLayout, const void* InVertices, const size_t InVertexBytes,
+	                                                   const std::span<const unsigned int> InIndices)
+	{
+		const auto Stride = InLayout.Size();
+		const auto* const Positions = static_cast<const char*>(InVertices) + InLayout.Resolve<DV::VertexLayout::ElementType::Position3D>().GetByteOffset();
+
+		return MeshOptimizer::BuildMeshlets(InIndices, Positions, InVertexBytes / Stride, Stride);
+	}
+
+	std::shared_ptr<const TriangleBvh> BuildTriangles(const DV::VertexLayout& InLayout, const void* InVertices, const size_t InVertexBytes,
+	                                                  const std::span<const unsigned int> InIndices)
+	{
+		const auto Stride = InLayout.Size();
+		const auto* const Positions = static_cast<const char*>(InVertices) + InLayout.Resolve<DV::VertexLayout::ElementType::Position3D>().GetByteOffset();
+
+		return std::make_shared<const TriangleBvh>(InIndices, Positions, InVertexBytes / Stride, Stride);
+	}
+
+	// Unknown names resolve to the root, which moves nothing on its own.
+	unsigned int FindNode(const std::unordered_map<std::string, unsigned int>& InNodeIndices, const aiString& InName)
+	{
+		const auto Found = InNodeIndices.find(InName.C_Str());
+		return Found != InNodeIndices.end() ? Found->second : 0u;
+	}
+
+	// Bits reversed over the binary point, the second coordinate of a Hammersley point.
+	float RadicalInverse(unsigned int InBits) noexcept
+	{
+		InBits = (InBits << 16u) | (InBits >> 16u);
+		InBits = ((InBits & 0x55555555u) << 1u) | ((InBits & 0xAAAAAAAAu) >> 1u);
+		InBits = ((InBits & 0x33333333u) << 2u) | ((InBits & 0xCCCCCCCCu) >> 2u);
+		InBits = ((InBits & 0x0F0F0F0Fu) << 4u) | ((InBits & 0xF0F0F0F0u) >> 4u);
+		InBits = ((InBits & 0x00FF00FFu) << 8u) | ((InBits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(InBits) * 2.3283064365386963e-10f;
+	}
+
+	/**
+	 * Ambient occlusion of every vertex from InRayNum rays over its hemisphere against the mesh's own triangles, traced through their
+	 * TriangleBvh a packet at a time, the rays of one vertex all start at the same point. The rays are cosine distributed, so the share that escapes within InDistance times the mesh's bounding
+	 * box diagonal is how much of a uniform ambient light reaches the vertex. The vertices are baked in parallel and returned with an
+	 * Occlusion element appended to their layout.
+	 */
+	DV::VertexBuffer BakeVertexOcclusion(const std::span<const DirectX::XMFLOAT3> InPositions, const std::span<const unsigned int> InIndices,
+	                                     const DV::VertexBuffer& InVertices, const int InRayNum, const float InDistance)
+	{
+		using ElementType = DV::VertexLayout::ElementType;
+
+		constexpr auto PacketSize = TriangleBvh::PacketSize;
+		const TriangleBvh Triangles(InIndices, InPositions.data(), InPositions.size(), sizeof(DirectX::XMFLOAT3));
+
+		DirectX::BoundingBox MeshBounds;
+		DirectX::BoundingBox::CreateFromPoints(MeshBounds, InPositions.size(), InPositions.data(), sizeof(DirectX::XMFLOAT3));
+		const auto Diagonal = 2.0f * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&MeshBounds.Extents)));
+		const auto MaxDistance = InDistance * Diagonal;
+		// Rays start this far off the surface, so they don't hit the triangles around the vertex they start from.
+		const auto SurfaceOffset = 1e-4f * Diagonal;
+
+		const auto& SourceLayout = InVertices.GetLayout();
+		const auto bHasFloatNormal = SourceLayout.Has<ElementType::Normal>();
+		assert((bHasFloatNormal || SourceLayout.Has<ElementType::OctahedralNormal>()) && "Occlusion is baked around the vertex normals");
+		const auto NormalOffset = bHasFloatNormal ? SourceLayout.Resolve<ElementType::Normal>().GetByteOffset()
+		                                          : SourceLayout.Resolve<ElementType::OctahedralNormal>().GetByteOffset();
+		const auto SourceStride = SourceLayout.Size();
+
+		std::vector<DirectX::PackedVector::XMUBYTEN4> Occlusion(InVertices.Num());
+
+		JobSystem::Get().ParallelFor(Occlusion.size(), 64u, [&](const size_t InVertex)
+		{
+			const auto* const Vertex = InVertices.GetData() + InVertex * SourceStride;
+			const auto NormalValue = bHasFloatNormal ? *reinterpret_cast<const DirectX::XMFLOAT3*>(Vertex + NormalOffset)
+			                                         : DV::DecodeOctahedralNormal(*reinterpret_cast<const DirectX::PackedVector::XMSHORTN2*>(Vertex + NormalOffset));
+			const auto Normal = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&NormalValue));
+
+			// Any frame around the normal will do. Each vertex turns its rays by another angle, so neighbours don't band alike.
+			const auto Helper = std::abs(NormalValue.x) > 0.9f ? DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : DirectX::XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+			const auto Tangent = DirectX::XMVector3Normalize(DirectX::XMVector3Cross(Helper, Normal));
+			const auto Bitangent = DirectX::XMVector3Cross(Normal, Tangent);
+			const auto Turn = static_cast<float>((static_cast<uint32_t>(InVertex) * 2654435769u) >> 8u) / 16777216.0f;
+			DirectX::XMFLOAT3 Origin;
+			DirectX::XMStoreFloat3(&Origin, DirectX::XMVectorMultiplyAdd(Normal, DirectX::XMVectorReplicate(SurfaceOffset), DirectX::XMLoadFloat3(&InPositions[InVertex])));
+
+			TriangleBvh::RayPacket Rays;
+			Rays.Origins.fill(Origin);
+			Rays.Directions.fill(NormalValue);
+			std::array<float, PacketSize> Distances;
+			Distances.fill(MaxDistance);
+
+			auto EscapedNum = 0;
+
+			for (auto Ray = 0; Ray < InRayNum; ++Ray)
+			{
+				// A Hammersley point, its first coordinate the squared radius on the disc below the hemisphere.
+				const auto RadiusSquared = (static_cast<float>(Ray) + 0.5f) / static_cast<float>(InRayNum);
+				const auto Angle = DirectX::XM_2PI * (RadicalInverse(static_cast<unsigned int>(Ray)) + Turn);
+				const auto Radius = std::sqrt(RadiusSquared);
+				const auto Direction = DirectX::XMVector3Normalize(DirectX::XMVectorAdd(
+					DirectX::XMVectorAdd(DirectX::XMVectorScale(Tangent, Radius * std::cos(Angle)), DirectX::XMVectorScale(Bitangent, Radius * std::sin(Angle))),
+					DirectX::XMVectorScale(Normal, std::sqrt(std::max(1.0f - RadiusSquared, 0.0f)))));
+
+				const auto Lane = static_cast<unsigned int>(Ray) % PacketSize;
+				DirectX::XMStoreFloat3(&Rays.Directions[Lane], Direction);
+
+				// A full packet, or the last rays on their own.
+				if (Lane + 1u == PacketSize || Ray + 1 == InRayNum)
+				{
+					const auto RayMask = (1u << (Lane + 1u)) - 1u;
+					EscapedNum += std::popcount(RayMask & ~Triangles.GetOccludedMask(Rays, Distances, RayMask));
+				}
+			}
+
+			Occlusion[InVertex] = DirectX::PackedVector::XMUBYTEN4(static_cast<float>(EscapedNum) / static_cast<float>(InRayNum), 0.0f, 0.0f, 0.0f);
+		});
+
+		// Appended last, every other element keeps its offset and the vertices are copied over as they are.
+		auto Layout = SourceLayout;
+		Layout.Append(ElementType::Occlusion);
+		DV::VertexBuffer Baked(std::move(Layout));
+		Baked.Resize(InVertices.Num());
+
+		const auto Stride = Baked.GetLayout().Size();
+
+		for (size_t Index = 0u; Index < InVertices.Num(); ++Index)
+		{
+			std::memcpy(Baked.GetData() + Index * Stride, InVertices.GetData() + Index * SourceStride, SourceStride);
+		}
+
+		Baked.FillAttribute<ElementType::Occlusion>(std::span<const DirectX::PackedVector::XMUBYTEN4>(Occlusion));
+		return Baked;
+	}
+
+	// What the static meshes of a model are lit by, when its import profile bakes lightmaps.
+	struct LightmapBake
+	{
+		Lightmapper::Scene Scene;
+		// Into the model's space, from the first node holding each mesh. Meshes several nodes hold share the light of the first.
+		std::vector<DirectX::XMFLOAT4X4> MeshTransforms;
+		std::filesystem::path SourcePath;
+	};
+
+	// The scene of every mesh InGetTriangles fills in the positions and indices of, all of them unless it returns false for a skinned one.
+	template<typename T>
+	std::unique_ptr<LightmapBake> PrepareLightmapBake(const std::filesystem::path& InPath, const MeshCache::NodeList& InNodes, const size_t InMeshNum,
+	                                                  const T& InGetTriangles)
+	{
+		auto Bake = std::make_unique<LightmapBake>();
+		Bake->SourcePath = InPath;
+		Bake->MeshTransforms.resize(InMeshNum);
+		std::vector<bool> bIsPlaced(InMeshNum, false);
+
+		for (auto& Transform : Bake->MeshTransforms)
+		{
+			DirectX::XMStoreFloat4x4(&Transform, DirectX::XMMatrixIdentity());
+		}
+
+		std::vector<DirectX::XMFLOAT4X4> WorldTransforms(InNodes.size());
+		std::vector<std::pair<unsigned int, unsigned int>> OpenNodes;
+
+		for (unsigned int Index = 0u; Index < InNodes.size(); ++Index)
+		{
+			auto World = DirectX::XMLoadFloat4x4(&InNodes[Index].Transform);
+
+			if (!OpenNodes.empty())
+			{
+				World *= DirectX::XMLoadFloat4x4(&WorldTransforms[OpenNodes.back().first]);
+				--OpenNodes.back().second;
+			}
+
+			DirectX::XMStoreFloat4x4(&WorldTransforms[Index], World);
+
+			for (const auto MeshIndex : InNodes[Index].MeshIndices)
+			{
+				if (MeshIndex < InMeshNum && !bIsPlaced[MeshIndex])
+				{
+					Bake->MeshTransforms[MeshIndex] = WorldTransforms[Index];
+					bIsPlaced[MeshIndex] = true;
+				}
+			}
+
+			OpenNodes.emplace_back(Index, InNodes[Index].ChildNum);
+
+			while (!OpenNodes.empty() && OpenNodes.back().second == 0u)
+			{
+				OpenNodes.pop_back();
+			}
+		}
+
+		std::vector<DirectX::XMFLOAT3> Positions;
+		std::vector<unsigned int> Indices;
+
+		for (size_t MeshIndex = 0u; MeshIndex < InMeshNum; ++MeshIndex)
+		{
+			Positions.clear();
+			Indices.clear();
+
+			if (InGetTriangles(MeshIndex, Positions, Indices))
+			{
+				Bake->Scene.AddMesh(Positions, Indices, DirectX::XMLoadFloat4x4(&Bake->MeshTransforms[MeshIndex]));
+			}
+		}
+
+		Bake->Scene.Build();
+		return Bake;
+	}
+
+	/**
+	 * Unwraps the mesh and bakes its lightmap beside the source, named after it and the mesh's index. The vertices are split where charts
+	 * meet and come back with a LightmapTexture2D element appended, OutPositions and InOutIndices following the split. False, with
+	 * everything left as it was, for a mesh with too many charts to fit an atlas. A map that couldn't be written leaves the entry without.
+	 */
+	bool BakeLightmap(const LightmapBake& InBake, const Lightmapper::Settings& InSettings, const size_t InMeshIndex, const std::span<const DirectX::XMFLOAT3> InPositions,
+	                  DV::VertexBuffer& InOutVertices, std::vector<unsigned int>& InOutIndices, std::vector<DirectX::XMFLOAT3>& OutPositions, MeshCache::MeshEntry& InOutEntry)
+	{
+		using ElementType = DV::VertexLayout::ElementType;
+
+		auto Unwrap = Lightmapper::UnwrapMesh(InPositions, InOutIndices, InSettings.TexelsPerUnit);
+
+		if (Unwrap.Size == 0u)
+		{
+			LOG_WARNING("'{}' has too many charts for a lightmap and keeps its vertex lighting", InOutEntry.Name);
+			return false;
+		}
+
+		const auto& SourceLayout = InOutVertices.GetLayout();
+		const auto bHasFloatNormal = SourceLayout.Has<ElementType::Normal>();
+		assert((bHasFloatNormal || SourceLayout.Has<ElementType::OctahedralNormal>()) && "Lightmaps are baked around the vertex normals");
+		const auto NormalOffset = bHasFloatNormal ? SourceLayout.Resolve<ElementType::Normal>().GetByteOffset()
+		                                          : SourceLayout.Resolve<ElementType::OctahedralNormal>().GetByteOffset();
+		const auto SourceStride = SourceLayout.Size();
+
+		// Appended last like the occlusion, the split vertices are copied over as they are.
+		auto Layout = SourceLayout;
+		Layout.Append(ElementType::LightmapTexture2D);
+		DV::VertexBuffer Split(std::move(Layout));
+		const auto VertexNum = Unwrap.SourceVertices.size();
+		Split.Resize(VertexNum);
+
+		const auto Stride = Split.GetLayout().Size();
+		const auto Transform = DirectX::XMLoadFloat4x4(&InBake.MeshTransforms[InMeshIndex]);
+		const auto NormalTransform = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, Transform));
+		std::vector<DirectX::XMFLOAT3> ScenePositions(VertexNum);
+		std::vector<DirectX::XMFLOAT3> SceneNormals(VertexNum);
+		std::vector<DirectX::PackedVector::XMUSHORTN2> Texcoords(VertexNum);
+		OutPositions.resize(VertexNum);
+
+		for (size_t Index = 0u; Index < VertexNum; ++Index)
+		{
+			const auto Source = Unwrap.SourceVertices[Index];
+			const auto* const Vertex = InOutVertices.GetData() + Source * SourceStride;
+			std::memcpy(Split.GetData() + Index * Stride, Vertex, SourceStride);
+
+			const auto NormalValue = bHasFloatNormal ? *reinterpret_cast<const DirectX::XMFLOAT3*>(Vertex + NormalOffset)
+			                                         : DV::DecodeOctahedralNormal(*reinterpret_cast<const DirectX::PackedVector::XMSHORTN2*>(Vertex + NormalOffset));
+			OutPositions[Index] = InPositions[Source];
+			DirectX::XMStoreFloat3(&ScenePositions[Index], DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&InPositions[Source]), Transform));
+			DirectX::XMStoreFloat3(&SceneNormals[Index], DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&NormalValue), NormalTransform)));
+			Texcoords[Index] = DirectX::PackedVector::XMUSHORTN2(Unwrap.Texcoords[Index].x, Unwrap.Texcoords[Index].y);
+		}
+
+		Split.FillAttribute<ElementType::LightmapTexture2D>(std::span<const DirectX::PackedVector::XMUSHORTN2>(Texcoords));
+
+		// Beside the source and named relative to it, like the maps its materials name.
+		const auto FileName = InBake.SourcePath.filename().string() + "." + std::to_string(InMeshIndex) + ".lightmap.dds";
+
+		if (Lightmapper::Bake(InBake.Scene, ScenePositions, SceneNormals, Unwrap, InSettings, InBake.SourcePath.parent_path() / FileName))
+		{
+			InOutEntry.LightmapMap = FileName;
+		}
+		else
+		{
+			LOG_WARNING("The lightmap of '{}' couldn't be written", InOutEntry.Name);
+		}
+
+		InOutVertices = std::move(Split);
+		InOutIndices = std::move(Unwrap.Indices);
+		return true;
+	}
+
+	// The order is baked into the cache, so this only runs when the source is imported.
+	// Levels of detail are appended to InOutIndices, and the entry ends up viewing both.
+	void OptimizeMesh(const std::span<const DirectX::XMFLOAT3> InPositions, DV::VertexBuffer& InOutVertices, std::vector<unsigned int>& InOutIndices,
+	                  MeshCache::MeshEntry& InOutEntry)
+	{
+		MeshOptimizer::OptimizeVertexCache(InOutIndices, InOutVertices.Num());
+		MeshOptimizer::OptimizeOverdraw(InOutIndices, InPositions);
+
+		// Every level is simplified from the full mesh to about half the triangles of the one before, and appended after it.
+		const auto FullIndexNum = InOutIndices.size();
+		InOutEntry.Lods.push_back({0u, static_cast<unsigned int>(FullIndexNum), 0.0f});
+
+		while (InOutEntry.Lods.size() < Mesh::MaxLodNum)
+		{
+			const auto PreviousIndexNum = InOutEntry.Lods.back().IndexNum;
+			float Error;
+			auto LodIndices = MeshOptimizer::Simplify(std::span(InOutIndices.data(), FullIndexNum), InPositions, PreviousIndexNum / 6u * 3u, Error);
+
+			// Seams and boundaries can stop the simplifier early, a level that barely shrinks isn't worth switching to.
+			if (LodIndices.empty() || LodIndices.size() * 4u > PreviousIndexNum * 3u)
+			{
+				break;
+			}
+
+			MeshOptimizer::OptimizeVertexCache(LodIndices, InOutVertices.Num());
+			InOutEntry.Lods.push_back({static_cast<unsigned int>(InOutIndices.size()), static_cast<unsigned int>(LodIndices.size()), Error});
+			InOutIndices.insert(InOutIndices.end(), LodIndices.begin(), LodIndices.end());
+		}
+
+		std::vector<unsigned int> Remap;
+		InOutVertices.Resize(MeshOptimizer::OptimizeVertexFetch(InOutIndices, InOutVertices.GetData(), InOutVertices.Num(), InOutVertices.GetLayout().Size(), &Remap));
+
+		// Deltas follow their vertices, those of vertices no triangle uses go with them.
+		if (!InOutEntry.MorphDeltas.empty())
+		{
+			for (auto& Delta : InOutEntry.MorphDeltas)
+			{
+				Delta.Vertex = Remap[Delta.Vertex];
+			}
+
+			std::erase_if(InOutEntry.MorphDeltas, [](const MeshCache::MorphDeltaEntry& InDelta)
+			{
+				return InDelta.Vertex == MeshOptimizer::UnusedVertex;
+			});
+
+			std::sort(InOutEntry.MorphDeltas.begin(), InOutEntry.MorphDeltas.end(), [](const MeshCache::MorphDeltaEntry& InA, const MeshCache::MorphDeltaEntry& InB)
+			{
+				return std::tie(InA.Vertex, InA.Target) < std::tie(InB.Vertex, InB.Target);
+			});
+		}
+
+		// Skinned and morphed meshes leave their bind pose, meshlet bounds and cones taken from it would cull what is in view, and
+		// rays cast against it would hit where the mesh no longer is.
+		if (InOutEntry.Bones.empty() && InOutEntry.MorphDeltas.empty())
+		{
+			InOutEntry.Meshlets = BuildMeshlets(InOutVertices.GetLayout(), InOutVertices.GetData(), InOutVertices.Size(), std::span(InOutIndices.data(), FullIndexNum));
+			InOutEntry.Triangles = BuildTriangles(InOutVertices.GetLayout(), InOutVertices.GetData(), InOutVertices.Size(), std::span(InOutIndices.data(), FullIndexNum));
+		}
+
+		InOutEntry.Layout = InOutVertices.GetLayout();
+		InOutEntry.Vertices = InOutVertices.GetData();
+		InOutEntry.VertexBytes = InOutVertices.Size();
+		InOutEntry.Indices = InOutIndices.data();
+		InOutEntry.IndexNum = InOutIndices.size();
+	}
+
+	MeshCache::MeshEntry ExtractMesh(const aiMesh& InMesh, const aiMaterial& InMaterial, const std::unordered_map<std::string, unsigned int>& InNodeIndices,
+	                                 const ImportProfile& InProfile, const LightmapBake* InBake, const size_t InMeshIndex, SourceData& OutSource)
+	{
+		MeshCache::MeshEntry Entry;
+		Entry.Name = InMesh.mName.C_Str();
+
+		aiString TextureFileName;
+
+		if (InMaterial.GetTexture(aiTextureType_DIFFUSE, 0, &TextureFileName) == aiReturn_SUCCESS)
+		{
+			Entry.DiffuseMap = TextureFileName.C_Str();
+		}
+
+		if (InMaterial.GetTexture(aiTextureType_NORMALS, 0, &TextureFileName) == aiReturn_SUCCESS)
+		{
+			Entry.NormalMap = TextureFileName.C_Str();
+		}
+
+		if (InMaterial.GetTexture(aiTextureType_SPECULAR, 0, &TextureFileName) == aiReturn_SUCCESS)
+		{
+			Entry.SpecularMap = TextureFileName.C_Str();
+		}
+		else
+		{
+			InMaterial.Get(AI_MATKEY_SHININESS, Entry.Shininess);
+		}
+
+		Entry.MaterialName = InMaterial.GetName().C_Str();
+		InMaterial.Get(AI_MATKEY_OPACITY, Entry.Opacity);
+
+		if (int bIsTwoSided = 0; InMaterial.Get(AI_MATKEY_TWOSIDED, bIsTwoSided) == aiReturn_SUCCESS)
+		{
+			Entry.bIsTwoSided = bIsTwoSided != 0;
+		}
+
+		const auto Influences = GatherInfluences(InMesh);
+
+		if (!Influences.empty())
+		{
+			Entry.Bones.reserve(InMesh.mNumBones);
+
+			for (unsigned int BoneIndex = 0u; BoneIndex < InMesh.mNumBones; ++BoneIndex)
+			{
+				const auto& Bone = *InMesh.mBones[BoneIndex];
+				auto& BoneEntry = Entry.Bones.emplace_back();
+				BoneEntry.Node = FindNode(InNodeIndices, Bone.mName);
+				DirectX::XMStoreFloat4x4
+				(
+					&BoneEntry.Offset,
+					DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&Bone.mOffsetMatrix)))
+				);
+			}
+		}
+
+		ExtractMorphTargets(InMesh, Entry);
+
+		auto& Vertices = OutSource.VertexStorage.emplace_back([&]
+		{
+			const auto Features = GetMaterialFeatures(Entry);
+
+			if (!Influences.empty())
+			{
+				if (Features & Material::NormalMapped)
+				{
+					return ExtractVertices<NormalMappedSkinnedLayout>(InMesh, Influences);
+				}
+				else if (Features & Material::DiffuseMapped)
+				{
+					return ExtractVertices<TexturedSkinnedLayout>(InMesh, Influences);
+				}
+
+				return ExtractVertices<SolidSkinnedLayout>(InMesh, Influences);
+			}
+
+			if (Features & Material::NormalMapped)
+			{
+				return ExtractVertices<NormalMappedLayout>(InMesh);
+			}
+			else if (Features & Material::DiffuseMapped)
+			{
+				return ExtractVertices<TexturedLayout>(InMesh);
+			}
+
+			return ExtractVertices<SolidLayout>(InMesh);
+		}());
+
+		auto& Indices = OutSource.IndexStorage.emplace_back();
+		Indices.reserve(InMesh.mNumFaces * 3);
+		for (unsigned int FaceIndex = 0; FaceIndex < InMesh.mNumFaces; ++FaceIndex)
+		{
+			const auto& Face = InMesh.mFaces[FaceIndex];
+			assert(Face.mNumIndices == 3);
+
+			for (unsigned int Index = 0; Index < Face.mNumIndices; ++Index)
+			{
+				Indices.push_back(Face.mIndices[Index]);
+			}
+		}
+
+		std::span Positions(reinterpret_cast<const DirectX::XMFLOAT3*>(InMesh.mVertices), InMesh.mNumVertices);
+		std::vector<DirectX::XMFLOAT3> SplitPositions;
+
+		// Skinned and morphed meshes move out from under what would be baked. A lightmap holds the occlusion too, the vertices don't bake it again.
+		const auto bIsDeformed = !Entry.Bones.empty() || InMesh.mNumAnimMeshes > 0u;
+
+		if (InBake && !bIsDeformed && !Indices.empty() &&
+		    BakeLightmap(*InBake, InProfile.GetLightmapSettings(), InMeshIndex, Positions, Vertices, Indices, SplitPositions, Entry))
+		{
+			Positions = SplitPositions;
+		}
+		else if (InProfile.GetOcclusionRayNum() > 0 && !bIsDeformed && !Indices.empty())
+		{
+			Vertices = BakeVertexOcclusion(Positions, Indices, Vertices, InProfile.GetOcclusionRayNum(), InProfile.GetOcclusionDistance());
+		}
+
+		OptimizeMesh(Positions, Vertices, Indices, Entry);
+
+		return Entry;
+	}
+
+	MeshCache::MeshEntry ExtractMesh(const GltfFile::Primitive& InPrimitive, const ImportProfile& InProfile, const LightmapBake* InBake, const size_t InMeshIndex,
+	                                 SourceData& OutSource)
+	{
+		auto Entry = InPrimitive.Mesh;
+
+		// Mirrored once here, the optimizer and the simplifier read the positions as the vertices end up with them.
+		std::vector<DirectX::XMFLOAT3> Positions(InPrimitive.Positions.Num);
+		for (size_t Index = 0u; Index < Positions.size(); ++Index)
+		{
+			Positions[Index] = LoadMirrored(InPrimitive.Positions, Index);
+		}
+
+		auto& Vertices = OutSource.VertexStorage.emplace_back([&]
+		{
+			const auto Features = GetMaterialFeatures(Entry);
+
+			if (Features & Material::NormalMapped)
+			{
+				return ExtractVertices<NormalMappedLayout>(InPrimitive, Positions);
+			}
+			else if (Features & Material::DiffuseMapped)
+			{
+				return ExtractVertices<TexturedLayout>(InPrimitive, Positions);
+			}
+
+			return ExtractVertices<SolidLayout>(InPrimitive, Positions);
+		}());
+
+		// Mirroring turns front faces around, every triangle is wound the other way to keep them in front.
+		const auto& SourceIndices = InPrimitive.Indices;
+		const auto IndexNum = SourceIndices.IsEmpty() ? Positions.size() : SourceIndices.Num;
+		auto& Indices = OutSource.IndexStorage.emplace_back(IndexNum);
+
+		for (size_t Index = 0u; Index < IndexNum; Index += 3u)
+		{
+			for (size_t Corner = 0u; Corner < 3u; ++Corner)
+			{
+				const auto Source = Index + (3u - Corner) % 3u;
+				Indices[Index + Corner] = SourceIndices.IsEmpty() ? static_cast<unsigned int>(Source) : SourceIndices.LoadIndex(Source);
+			}
+		}
+
+		if (std::vector<DirectX::XMFLOAT3> SplitPositions;
+		    InBake && !Indices.empty() && BakeLightmap(*InBake, InProfile.GetLightmapSettings(), InMeshIndex, Positions, Vertices, Indices, SplitPositions, Entry))
+		{
+			Positions = std::move(SplitPositions);
+		}
+		else if (InProfile.GetOcclusionRayNum() > 0 && !Indices.empty())
+		{
+			Vertices = BakeVertexOcclusion(Positions, Indices, Vertices, InProfile.GetOcclusionRayNum(), InProfile.GetOcclusionDistance());
+		}
+
+		OptimizeMesh(Positions, Vertices, Indices, Entry);
+
+		return Entry;
+	}
+
+	void FlattenNode(const aiNode& InNode, MeshCache::NodeList& OutNodes)
+	{
+		{
+			auto& Entry = OutNodes.emplace_back();
+			Entry.Name = InNode.mName.C_Str();
+			DirectX::XMStoreFloat4x4
+			(
+				&Entry.Transform,
+				DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&InNode.mTransformation)))
+			);
+			Entry.MeshIndices.assign(InNode.mMeshes, InNode.mMeshes + InNode.mNumMeshes);
+			Entry.ChildNum = InNode.mNumChildren;
+		}
+
+		for (unsigned int ChildIndex = 0; ChildIndex < InNode.mNumChildren; ++ChildIndex)
+		{
+			FlattenNode(*InNode.mChildren[ChildIndex], OutNodes);
+		}
+	}
+
+	// Keys come in ticks, sources that leave the tick rate out are taken to run at 25 a second.
+	std::vector<MeshCache::AnimationEntry> ExtractAnimations(const aiScene& InScene, const std::unordered_map<std::string, unsigned int>& InNodeIndices)
+	{
+		std::vector<MeshCache::AnimationEntry> Animations;
+		Animations.reserve(InScene.mNumAnimations);
+
+		for (unsigned int AnimationIndex = 0u; AnimationIndex < InScene.mNumAnimations; ++AnimationIndex)
+		{
+			const auto& SceneAnimation = *InScene.mAnimations[AnimationIndex];
+			const auto SecondsPerTick = 1.0 / (SceneAnimation.mTicksPerSecond > 0.0 ? SceneAnimation.mTicksPerSecond : 25.0);
+
+			auto& Entry = Animations.emplace_back();
+			Entry.Name = SceneAnimation.mName.C_Str();
+			Entry.Duration = static_cast<float>(SceneAnimation.mDuration * SecondsPerTick);
+			Entry.Channels.reserve(SceneAnimation.mNumChannels);
+
+			for (unsigned int ChannelIndex = 0u; ChannelIndex < SceneAnimation.mNumChannels; ++ChannelIndex)
+			{
+				const auto& SceneChannel = *SceneAnimation.mChannels[ChannelIndex];
+
+				// A channel for a node the hierarchy doesn't have would move the root instead.
+				if (!InNodeIndices.contains(SceneChannel.mNodeName.C_Str()))
+				{
+					continue;
+				}
+
+				auto& Channel = Entry.Channels.emplace_back();
+				Channel.Node = FindNode(InNodeIndices, SceneChannel.mNodeName);
+
+				const auto ToSeconds = [SecondsPerTick](const double InTime)
+				{
+					return static_cast<float>(InTime * SecondsPerTick);
+				};
+
+				for (unsigned int KeyIndex = 0u; KeyIndex < SceneChannel.mNumPositionKeys; ++KeyIndex)
+				{
+					const auto& Key = SceneChannel.mPositionKeys[KeyIndex];
+					Channel.Translations.push_back({ToSeconds(Key.mTime), {Key.mValue.x, Key.mValue.y, Key.mValue.z, 0.0f}});
+				}
+
+				for (unsigned int KeyIndex = 0u; KeyIndex < SceneChannel.mNumRotationKeys; ++KeyIndex)
+				{
+					const auto& Key = SceneChannel.mRotationKeys[KeyIndex];
+					Channel.Rotations.push_back({ToSeconds(Key.mTime), {Key.mValue.x, Key.mValue.y, Key.mValue.z, Key.mValue.w}});
+				}
+
+				for (unsigned int KeyIndex = 0u; KeyIndex < SceneChannel.mNumScalingKeys; ++KeyIndex)
+				{
+					const auto& Key = SceneChannel.mScalingKeys[KeyIndex];
+					Channel.Scalings.push_back({ToSeconds(Key.mTime), {Key.mValue.x, Key.mValue.y, Key.mValue.z, 0.0f}});
+				}
+
+				// Sampling searches the keys by time, the formats don't all promise them in order.
+				for (auto* Keys : {&Channel.Translations, &Channel.Rotations, &Channel.Scalings})
+				{
+					std::stable_sort(Keys->begin(), Keys->end(), [](const MeshCache::KeyEntry& InLeft, const MeshCache::KeyEntry& InRight)
+					{
+						return InLeft.Time < InRight.Time;
+					});
+				}
+			}
+		}
+
+		return Animations;
+	}
+
+	bool IsGltf(const std::filesystem::path& InPath)
+	{
+		auto Extension = InPath.extension().string();
+		std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](const char InCharacter)
+		{
+			return static_cast<char>(std::tolower(static_cast<unsigned char>(InCharacter)));
+		});
+
+		return Extension == ".gltf" || Extension == ".glb";
+	}
+
+	bool OpenCachedSource(const std::filesystem::path& InPath, const uint64_t InImportHash, SourceData& OutSource)
+	{
+		if (OutSource.Cache = MeshCache::Open(InPath, InImportHash); !OutSource.Cache)
+		{
+			return false;
+		}
+
+		OutSource.Meshes = OutSource.Cache->GetMeshes();
+		OutSource.Nodes = OutSource.Cache->GetNodes();
+		OutSource.Animations = OutSource.Cache->GetAnimations();
+		return true;
+	}
+
+	/**
+	 * Extracts InMeshNum meshes into the cache one at a time, each dropped as soon as it is written, then reads the whole source back
+	 * from the cache's mapping. However large the model, the import holds its source and one extracted mesh, and the GPU buffers are
+	 * created from pages the system can evict. False when the cache can't be written, the caller then keeps every mesh in memory.
+	 */
+	template<typename T>
+	bool StreamSource(const std::filesystem::path& InPath, const uint64_t InImportHash, const size_t InMeshNum, const T& InExtractMesh, SourceData& InOutSource)
+	{
+		MeshCache::StreamWriter CacheWriter(InPath, InImportHash);
+
+		for (size_t MeshIndex = 0u; MeshIndex < InMeshNum && CacheWriter.IsValid(); ++MeshIndex)
+		{
+			SourceData MeshSource;
+			CacheWriter.AddMesh(InExtractMesh(MeshIndex, MeshSource));
+		}
+
+		return CacheWriter.Finish(InOutSource.Nodes, InOutSource.Animations) && OpenCachedSource(InPath, InImportHash, InOutSource);
+	}
+
+	SourceData ReadSource(const std::filesystem::path& InPath)
+	{
+		SourceData Source;
+		const auto Profile = ImportProfile::Load(InPath);
+
+		if (OpenCachedSource(InPath, Profile.GetHash(), Source))
+		{
+			return Source;
+		}
+
+		// glTF is read natively where it can be, every mesh straight from the mapped buffers instead of through Assimp's copies.
+		if (IsGltf(InPath))
+		{
+			if (const auto Gltf = GltfFile::Open(InPath))
+			{
+				const auto& Primitives = Gltf->GetPrimitives();
+				Source.Nodes = Gltf->GetNodes();
+
+				// Winding doesn't matter to the rays, the primitives are only mirrored like their vertices will be.
+				std::unique_ptr<LightmapBake> Bake;
+
+				if (Profile.GetLightmapSettings().TexelsPerUnit > 0.0f)
+				{
+					Bake = PrepareLightmapBake(InPath, Source.Nodes, Primitives.size(), [&Primitives](const size_t InIndex, std::vector<DirectX::XMFLOAT3>& OutPositions,
+					                                                                                 std::vector<unsigned int>& OutIndices)
+					{
+						const auto& Primitive = Primitives[InIndex];
+						OutPositions.resize(Primitive.Positions.Num);
+
+						for (size_t Index = 0u; Index < OutPositions.size(); ++Index)
+						{
+							OutPositions[Index] = LoadMirrored(Primitive.Positions, Index);
+						}
+
+						OutIndices.resize(Primitive.Indices.IsEmpty() ? OutPositions.size() : Primitive.Indices.Num);
+
+						for (size_t Index = 0u; Index < OutIndices.size(); ++Index)
+						{
+							OutIndices[Index] = Primitive.Indices.IsEmpty() ? static_cast<unsigned int>(Index) : Primitive.Indices.LoadIndex(Index);
+						}
+
+						return true;
+					});
+				}
+
+				const auto ExtractPrimitive = [&Primitives, &Profile, &Bake](const size_t InIndex, SourceData& OutSource)
+				{
+					return ExtractMesh(Primitives[InIndex], Profile, Bake.get(), InIndex, OutSource);
+				};
+
+				if (StreamSource(InPath, Profile.GetHash(), Primitives.size(), ExtractPrimitive, Source))
+				{
+					return Source;
+				}
+
+				// Reserved up front so the entries' views into the storage never move.
+				Source.VertexStorage.reserve(Primitives.size());
+				Source.IndexStorage.reserve(Primitives.size());
+				Source.Meshes.reserve(Primitives.size());
+
+				for (size_t Index = 0u; Index < Primitives.size(); ++Index)
+				{
+					Source.Meshes.push_back(ExtractPrimitive(Index, Source));
+				}
+
+				return Source;
+			}
+		}
+
+		Assimp::Importer Importer;
+		const auto& Scene = ImportScene(Importer, InPath.string(), Profile);
+
+		// Bones and animation channels name their nodes, they are stored by index.
+		FlattenNode(*Scene.mRootNode, Source.Nodes);
+		std::unordered_map<std::string, unsigned int> NodeIndices;
+
+		for (unsigned int Index = 0u; Index < Source.Nodes.size(); ++Index)
+		{
+			NodeIndices.try_emplace(std::string(Source.Nodes[Index].Name), Index);
+		}
+
+		Source.Animations = ExtractAnimations(Scene, NodeIndices);
+
+		std::unique_ptr<LightmapBake> Bake;
+
+		if (Profile.GetLightmapSettings().TexelsPerUnit > 0.0f)
+		{
+			Bake = PrepareLightmapBake(InPath, Source.Nodes, Scene.mNumMeshes, [&Scene](const size_t InIndex, std::vector<DirectX::XMFLOAT3>& OutPositions,
+			                                                                         std::vector<unsigned int>& OutIndices)
+			{
+				const auto& SceneMesh = *Scene.mMeshes[InIndex];
+
+				// The same meshes ExtractMesh skins, those with more bones than a palette holds are imported static, and those it morphs.
+				if ((SceneMesh.mNumBones > 0u && SceneMesh.mNumBones <= BonePalette::MaxBoneNum) || SceneMesh.mNumAnimMeshes > 0u)
+				{
+					return false;
+				}
+
+				OutPositions.assign(reinterpret_cast<const DirectX::XMFLOAT3*>(SceneMesh.mVertices),
+				                    reinterpret_cast<const DirectX::XMFLOAT3*>(SceneMesh.mVertices) + SceneMesh.mNumVertices);
+
+				for (unsigned int FaceIndex = 0u; FaceIndex < SceneMesh.mNumFaces; ++FaceIndex)
+				{
+					const auto& Face = SceneMesh.mFaces[FaceIndex];
+					OutIndices.insert(OutIndices.end(), Face.mIndices, Face.mIndices + Face.mNumIndices);
+				}
+
+				return true;
+			});
+		}
+
+		// Assimp's materials don't say whether they are cut out, the diffuse map's alpha does. Meshes sharing a map decode it once.
+		std::unordered_map<std::string, bool> CutoutMaps;
+		const auto RootPath = InPath.parent_path().string() + "\\";
+
+		const auto ExtractSceneMesh = [&Scene, &NodeIndices, &Profile, &Bake, &CutoutMaps, &RootPath](const size_t InIndex, SourceData& OutSource)
+		{
+			const auto& SceneMesh = *Scene.mMeshes[InIndex];
+			auto Entry = ExtractMesh(SceneMesh, *Scene.mMaterials[SceneMesh.mMaterialIndex], NodeIndices, Profile, Bake.get(), InIndex, OutSource);
+
+			if (!Entry.DiffuseMap.empty())
+			{
+				auto [Found, bIsNew] = CutoutMaps.try_emplace(Entry.DiffuseMap, false);
+
+				if (bIsNew)
+				{
+					Found->second = IsAlphaCutout(RootPath + Entry.DiffuseMap);
+				}
+
+				Entry.bIsAlphaTested = Found->second;
+			}
+
+			return Entry;
+		};
+
+		// The scene is freed along with the importer on return, before anything is uploaded.
+		if (StreamSource(InPath, Profile.GetHash(), Scene.mNumMeshes, ExtractSceneMesh, Source))
+		{
+			return Source;
+		}
+
+		// Without a cache every mesh is kept until the model is built, as e.g. from a read-only directory.
+		Source.VertexStorage.reserve(Scene.mNumMeshes);
+		Source.IndexStorage.reserve(Scene.mNumMeshes);
+		Source.Meshes.reserve(Scene.mNumMeshes);
+
+		for (unsigned int MeshIndex = 0; MeshIndex < Scene.mNumMeshes; ++MeshIndex)
+		{
+			Source.Meshes.push_back(ExtractSceneMesh(MeshIndex, Source));
+		}
+
+		return Source;
+	}
+
+	// Meshes that would be drawn with the same material, pipeline and vertex layout can share one range.
+	bool IsSameMaterial(const MeshCache::MeshEntry& InLeft, const MeshCache::MeshEntry& InRight)
+	{
+		return InLeft.DiffuseMap == InRight.DiffuseMap && InLeft.NormalMap == InRight.NormalMap && InLeft.SpecularMap == InRight.SpecularMap &&
+		       InLeft.LightmapMap == InRight.LightmapMap &&
+		       InLeft.Shininess == InRight.Shininess && InLeft.MaterialName == InRight.MaterialName && InLeft.Opacity == InRight.Opacity &&
+		       InLeft.bIsTwoSided == InRight.bIsTwoSided && InLeft.bIsAlphaTested == InRight.bIsAlphaTested && InLeft.Layout.GetCode() == InRight.Layout.GetCode();
+	}
+
+	// Positions by the transform, normals by its inverse transpose and tangent frames along with them, re-encoded in place.
+	void TransformVertices(const DV::VertexLayout& InLayout, char* InOutVertices, const size_t InVertexNum, DirectX::FXMMATRIX InTransform)
+	{
+		using ElementType = DV::VertexLayout::ElementType;
+
+		const auto NormalTransform = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, InTransform));
+		const auto Stride = InLayout.Size();
+		const auto bHasFloatNormal = InLayout.Has<ElementType::Normal>();
+		const auto bHasPackedNormal = InLayout.Has<ElementType::OctahedralNormal>();
+		const auto bHasTangentFrame = InLayout.Has<ElementType::TangentFrame>();
+
+		for (size_t Index = 0u; Index < InVertexNum; ++Index)
+		{
+			auto* const Vertex = InOutVertices + Index * Stride;
+
+			auto* const Position = reinterpret_cast<DirectX::XMFLOAT3*>(Vertex + InLayout.Resolve<ElementType::Position3D>().GetByteOffset());
+			DirectX::XMStoreFloat3(Position, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(Position), InTransform));
+
+			if (bHasFloatNormal)
+			{
+				auto* const Normal = reinterpret_cast<DirectX::XMFLOAT3*>(Vertex + InLayout.Resolve<ElementType::Normal>().GetByteOffset());
+				DirectX::XMStoreFloat3(Normal, DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(Normal), NormalTransform)));
+			}
+
+			if (!bHasPackedNormal)
+			{
+				continue;
+			}
+
+			auto* const PackedNormal = reinterpret_cast<DirectX::PackedVector::XMSHORTN2*>(Vertex + InLayout.Resolve<ElementType::OctahedralNormal>().GetByteOffset());
+			const auto SourceNormal = DV::DecodeOctahedralNormal(*PackedNormal);
+
+			DirectX::XMFLOAT3 Normal;
+			DirectX::XMStoreFloat3(&Normal, DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&SourceNormal), NormalTransform)));
+			*PackedNormal = DV::EncodeOctahedralNormal(Normal);
+
+			if (bHasTangentFrame)
+			{
+				// Both lie in the surface and move with it, a mirroring transform flips the handedness the encoding stores.
+				auto* const TangentFrame = reinterpret_cast<DirectX::PackedVector::XMUDECN4*>(Vertex + InLayout.Resolve<ElementType::TangentFrame>().GetByteOffset());
+				DirectX::XMFLOAT3 Tangent;
+				DirectX::XMFLOAT3 Bitangent;
+				DV::DecodeTangentFrame(*TangentFrame, SourceNormal, Tangent, Bitangent);
+
+				DirectX::XMStoreFloat3(&Tangent, DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&Tangent), InTransform));
+				DirectX::XMStoreFloat3(&Bitangent, DirectX::XMVector3TransformNormal(DirectX::XMLoadFloat3(&Bitangent), InTransform));
+				*TangentFrame = DV::EncodeTangentFrame(Normal, Tangent, Bitangent);
+			}
+		}
+	}
+
+	/**
+	 * Bakes the imported transforms of every subtree rooted at one of InStaticNodes into its vertices, relative to the root, and merges
+	 * the meshes sharing a material into one. Levels of detail are merged level by level, meshes with fewer levels repeat their coarsest.
+	 * The merged meshes hang off the root, the nodes below keep their names and transforms but lose their meshes.
+	 */
+	void MergeStaticSubtrees(SourceData& InOutSource, const std::vector<std::string>& InStaticNodes)
+	{
+		struct MergedPart
+		{
+			unsigned int MeshIndex;
+			DirectX::XMFLOAT4X4 Transform;
+		};
+
+		struct StaticSubtree
+		{
+			unsigned int Root;
+			std::vector<std::vector<MergedPart>> Groups;
+		};
+
+		auto& Nodes = InOutSource.Nodes;
+		auto& SourceMeshes = InOutSource.Meshes;
+		const auto NodeNum = static_cast<unsigned int>(Nodes.size());
+
+		std::vector<unsigned int> Parents(NodeNum, NodeHierarchy::NoParent);
+		std::vector<unsigned int> SubtreeEnds(NodeNum);
+		std::vector<std::pair<unsigned int, unsigned int>> OpenNodes;
+
+		for (unsigned int Index = 0u; Index < NodeNum; ++Index)
+		{
+			if (!OpenNodes.empty())
+			{
+				Parents[Index] = OpenNodes.back().first;
+				--OpenNodes.back().second;
+			}
+
+			OpenNodes.emplace_back(Index, Nodes[Index].ChildNum);
+
+			while (!OpenNodes.empty() && OpenNodes.back().second == 0u)
+			{
+				SubtreeEnds[OpenNodes.back().first] = Index + 1u;
+				OpenNodes.pop_back();
+			}
+		}
+
+		std::vector<StaticSubtree> Subtrees;
+		std::vector<DirectX::XMFLOAT4X4> RelativeTransforms(NodeNum);
+
+		for (unsigned int Root = 0u; Root < NodeNum;)
+		{
+			if (std::find(InStaticNodes.begin(), InStaticNodes.end(), std::string_view(Nodes[Root].Name)) == InStaticNodes.end())
+			{
+				++Root;
+				continue;
+			}
+
+			auto& Subtree = Subtrees.emplace_back(StaticSubtree {Root, {}});
+			DirectX::XMStoreFloat4x4(&RelativeTransforms[Root], DirectX::XMMatrixIdentity());
+
+			for (auto Index = Root; Index < SubtreeEnds[Root]; ++Index)
+			{
+				if (Index != Root)
+				{
+					DirectX::XMStoreFloat4x4(&RelativeTransforms[Index],
+						DirectX::XMLoadFloat4x4(&Nodes[Index].Transform) * DirectX::XMLoadFloat4x4(&RelativeTransforms[Parents[Index]]));
+				}
+
+				// Skinned meshes follow their bones rather than the subtree and morphed ones are weighted on their own, they stay on their nodes.
+				std::vector<unsigned int> DeformedMeshIndices;
+
+				for (const auto MeshIndex : Nodes[Index].MeshIndices)
+				{
+					if (!SourceMeshes[MeshIndex].Bones.empty() || !SourceMeshes[MeshIndex].MorphDeltas.empty())
+					{
+						DeformedMeshIndices.push_back(MeshIndex);
+						continue;
+					}
+
+					auto Group = std::find_if(Subtree.Groups.begin(), Subtree.Groups.end(), [&](const std::vector<MergedPart>& InGroup)
+					{
+						return IsSameMaterial(SourceMeshes[InGroup.front().MeshIndex], SourceMeshes[MeshIndex]);
+					});
+
+					if (Group == Subtree.Groups.end())
+					{
+						Group = Subtree.Groups.insert(Subtree.Groups.end(), std::vector<MergedPart> {});
+					}
+
+					Group->push_back({MeshIndex, RelativeTransforms[Index]});
+				}
+
+				Nodes[Index].MeshIndices.assign(DeformedMeshIndices.begin(), DeformedMeshIndices.end());
+			}
+
+			// Static roots nested in this subtree are merged along with it.
+			Root = SubtreeEnds[Root];
+		}
+
+		size_t GroupNum = 0u;
+		for (const auto& Subtree : Subtrees)
+		{
+			GroupNum += Subtree.Groups.size();
+		}
+
+		// Reserved up front so the merged entries' views into the storage never move.
+		InOutSource.MergedVertexStorage.reserve(GroupNum);
+		InOutSource.MergedIndexStorage.reserve(GroupNum);
+
+		for (const auto& [Root, Groups] : Subtrees)
+		{
+			for (size_t GroupIndex = 0u; GroupIndex < Groups.size(); ++GroupIndex)
+			{
+				const auto& Parts = Groups[GroupIndex];
+				const auto Stride = SourceMeshes[Parts.front().MeshIndex].Layout.Size();
+
+				// Named after the root's position too, nodes of the same name must not share buffers.
+				auto Entry = SourceMeshes[Parts.front().MeshIndex];
+				Entry.Name = std::string(Nodes[Root].Name) + "$Static" + std::to_string(Root) + "_" + std::to_string(GroupIndex);
+				Entry.Lods.clear();
+
+				auto& Vertices = InOutSource.MergedVertexStorage.emplace_back();
+				auto& Indices = InOutSource.MergedIndexStorage.emplace_back();
+				size_t LodNum = 0u;
+
+				for (const auto& Part : Parts)
+				{
+					const auto& Source = SourceMeshes[Part.MeshIndex];
+					const auto FirstByte = Vertices.size();
+					const auto* const SourceVertices = static_cast<const char*>(Source.Vertices);
+
+					Vertices.insert(Vertices.end(), SourceVertices, SourceVertices + Source.VertexBytes);
+					TransformVertices(Source.Layout, Vertices.data() + FirstByte, Source.VertexBytes / Stride, DirectX::XMLoadFloat4x4(&Part.Transform));
+					LodNum = std::max(LodNum, Source.Lods.size());
+				}
+
+				for (size_t Lod = 0u; Lod < LodNum; ++Lod)
+				{
+					MeshCache::LodEntry Merged {static_cast<unsigned int>(Indices.size()), 0u, 0.0f};
+					unsigned int BaseVertex = 0u;
+
+					for (const auto& Part : Parts)
+					{
+						const auto& Source = SourceMeshes[Part.MeshIndex];
+						const auto& [FirstIndex, IndexNum, Error] = Source.Lods[std::min(Lod, Source.Lods.size() - 1u)];
+
+						for (auto Index = FirstIndex; Index < FirstIndex + IndexNum; ++Index)
+						{
+							Indices.push_back(Source.Indices[Index] + BaseVertex);
+						}
+
+						Merged.IndexNum += IndexNum;
+						Merged.Error = std::max(Merged.Error, Error);
+						BaseVertex += static_cast<unsigned int>(Source.VertexBytes / Stride);
+					}
+
+					Entry.Lods.push_back(Merged);
+				}
+
+				// The parts' own meshlets and triangle trees are in their node spaces, built again from the merged level.
+				Entry.Meshlets = BuildMeshlets(Entry.Layout, Vertices.data(), Vertices.size(), std::span(Indices.data(), Entry.Lods.front().IndexNum));
+				Entry.Triangles = BuildTriangles(Entry.Layout, Vertices.data(), Vertices.size(), std::span(Indices.data(), Entry.Lods.front().IndexNum));
+
+				Entry.Vertices = Vertices.data();
+				Entry.VertexBytes = Vertices.size();
+				Entry.Indices = Indices.data();
+				Entry.IndexNum = Indices.size();
+
+				Nodes[Root].MeshIndices.push_back(static_cast<unsigned int>(SourceMeshes.size()));
+				SourceMeshes.push_back(std::move(Entry));
+			}
+		}
+
+		// Meshes only static subtrees drew live on in the merged ones, they are not built at all.
+		constexpr auto Unused = ~0u;
+		std::vector<unsigned int> Remapped(SourceMeshes.size(), Unused);
+		std::vector<MeshCache::MeshEntry> UsedMeshes;
+
+		for (auto& Node : Nodes)
+		{
+			for (auto& MeshIndex : Node.MeshIndices)
+			{
+				if (Remapped[MeshIndex] == Unused)
+				{
+					Remapped[MeshIndex] = static_cast<unsigned int>(UsedMeshes.size());
+					UsedMeshes.push_back(std::move(SourceMeshes[MeshIndex]));
+				}
+
+				MeshIndex = Remapped[MeshIndex];
+			}
+		}
+
+		SourceMeshes = std::move(UsedMeshes);
+	}
+}
+
+namespace
+{
+	// Imports under way or done, by file and options. An entry outlives its asset, it is only a path and a lock.
+	struct CachedAsset
+	{
+		// Held through an import, so a second resolve of the same file waits for it instead of importing again.
+		std::mutex ImportMutex;
+		std::weak_ptr<const ModelAsset> Asset;
+	};
+
+	std::mutex AssetCacheMutex;
+	std::unordered_map<std::string, std::unique_ptr<CachedAsset>> AssetCache;
+
+	std::string GenerateAssetKey(const std::string_view InPath, const ModelAsset::ImportOptions& InOptions)
+	{
+		using namespace std::string_literals;
+		auto Key = std::string(InPath) + "#"s + (InOptions.bPacksTextureArrays ? "1"s : "0"s) + "#"s +
+		           (InOptions.bCooksTextures ? "1"s : "0"s) + "#"s + Sampler::GenerateUniqueID(InOptions.MaterialSampling);
+
+		for (const auto& [MaterialName, Opacity, bIsTwoSided] : InOptions.MaterialOverrides)
+		{
+			Key += "#"s + MaterialName + ","s + std::to_string(Opacity) + ","s + (bIsTwoSided ? "1"s : "0"s);
+		}
+
+		for (const auto& NodeName : InOptions.StaticNodes)
+		{
+			Key += "#static:"s + NodeName;
+		}
+
+		if (InOptions.bBakesVertexAnimation)
+		{
+			Key += "#vertex-animation"s;
+		}
+
+		if (InOptions.Revision > 0u)
+		{
+			Key += "#revision:"s + std::to_string(InOptions.Revision);
+		}
+
+		return Key;
+	}
+}
+
+ModelAsset::ModelAsset(const Graphics& InGraphics, const std::string_view InPath, const ImportOptions& InOptions, ImportProgress* InProgress)
+	: SourcePath(InPath), Options(InOptions)
+{
+	ALLOCATION_SCOPE(Assets);
+	auto Source = ReadSource(InPath);
+
+	// The cache keeps the meshes as imported, so freezing other subtrees later reads the same file.
+	if (!InOptions.StaticNodes.empty())
+	{
+		MergeStaticSubtrees(Source, InOptions.StaticNodes);
+	}
+
+	const std::filesystem::path Path(InPath);
+
+	if (InOptions.bCooksTextures)
+	{
+		CookTextures(FindCookedMaps(Source.Meshes, Path));
+	}
+
+	const auto Packing = InOptions.bPacksTextureArrays ? PackTextures(Source.Meshes, Path) : TexturePacking {};
+	const auto MeshNum = static_cast<unsigned int>(Source.Meshes.size());
+
+	if (InProgress)
+	{
+		InProgress->TotalSteps = MeshNum + 1u;
+		++InProgress->CompletedSteps;
+	}
+
+	// Before the meshes, their vertex animations are baked from the clips.
+	Animations.reserve(Source.Animations.size());
+
+	for (const auto& Entry : Source.Animations)
+	{
+		Animations.emplace_back(Entry, Source.Nodes);
+	}
+
+	// Over nodes without bounds, the bake only reads their transforms.
+	std::unique_ptr<NodeHierarchy> BindPose;
+	std::vector<unsigned int> MeshNodes;
+
+	if (InOptions.bBakesVertexAnimation && !Animations.empty())
+	{
+		const std::vector<DirectX::BoundingBox> NoBounds(MeshNum, EmptyBounds);
+		BindPose = std::make_unique<NodeHierarchy>(std::make_shared<const NodeHierarchy::Structure>(Source.Nodes, NoBounds));
+		MeshNodes.assign(MeshNum, NodeHierarchy::NoParent);
+
+		for (auto Node = BindPose->GetNodeNum(); Node-- > 0u;)
+		{
+			for (const auto MeshIndex : BindPose->GetMeshIndices(Node))
+			{
+				MeshNodes[MeshIndex] = Node;
+			}
+		}
+	}
+
+	// One mesh per job, texture decoding makes their cost too uneven to batch.
+	// The BindManager makes sure textures shared between meshes are still only decoded once.
+	Meshes.resize(MeshNum);
+	JobSystem::Get().ParallelFor(MeshNum, 1u, [&](const size_t MeshIndex)
+	{
+		const auto bIsBaked = BindPose && MeshNodes[MeshIndex] != NodeHierarchy::NoParent;
+		const AnimationBake Bake {Animations, BindPose.get(), bIsBaked ? MeshNodes[MeshIndex] : 0u};
+		Meshes[MeshIndex] = ParseMesh(InGraphics, Source.Meshes[MeshIndex], Path, InOptions.bPacksTextureArrays ? &Packing : nullptr, InOptions,
+		                              bIsBaked ? &Bake : nullptr);
+
+		if (InProgress)
+		{
+			++InProgress->CompletedSteps;
+		}
+	});
+
+	std::vector<DirectX::BoundingBox> MeshBounds;
+	MeshBounds.reserve(Meshes.size());
+
+	for (const auto& Description : Meshes)
+	{
+		MeshBounds.push_back(Description.Bounds);
+	}
+
+	Nodes = std::make_shared<const NodeHierarchy::Structure>(Source.Nodes, MeshBounds);
+}
+
+std::shared_ptr<const ModelAsset> ModelAsset::Resolve(const Graphics& InGraphics, const std::string_view InPath, const ImportOptions& InOptions,
+                                                      ImportProgress* InProgress)
+{
+	CachedAsset* Entry;
+	{
+		std::lock_guard Lock(AssetCacheMutex);
+		auto& Cached = AssetCache[GenerateAssetKey(InPath, InOptions)];
+
+		if (!Cached)
+		{
+			Cached = std::make_unique<CachedAsset>();
+		}
+
+		Entry = Cached.get();
+	}
+
+	// Imports of other files go on meanwhile, only this one is serialized.
+	std::lock_guard ImportLock(Entry->ImportMutex);
+
+	if (auto Asset = Entry->Asset.lock())
+	{
+		return Asset;
+	}
+
+	auto Asset = std::make_shared<const ModelAsset>(InGraphics, InPath, InOptions, InProgress);
+	Entry->Asset = Asset;
+
+	return Asset;
+}
+
+std::vector<std::shared_ptr<const ModelAsset>> ModelAsset::GetLoaded()
+{
+	std::vector<std::shared_ptr<const ModelAsset>> Loaded;
+	std::lock_guard Lock(AssetCacheMutex);
+
+	for (const auto& [Key, Entry] : AssetCache)
+	{
+		// An import holding the lock sets the asset when it is done.
+		if (std::unique_lock ImportLock(Entry->ImportMutex, std::try_to_lock); ImportLock)
+		{
+			if (auto Asset = Entry->Asset.lock())
+			{
+				Loaded.push_back(std::move(Asset));
+			}
+		}
+	}
+
+	return Loaded;
+}
+
+size_t ModelAsset::GetGpuByteSize() const
+{
+	std::unordered_set<const Bindable*> Counted;
+	size_t Bytes = 0u;
+
+	for (const auto& Described : Meshes)
+	{
+		for (const auto& Bound : Described.Bindables)
+		{
+			if (Counted.insert(Bound.get()).second)
+			{
+				Bytes += Bound->GetGpuByteSize();
+			}
+		}
+
+		if (Described.Morphs)
+		{
+			Bytes += Described.Morphs->GetGpuByteSize();
+		}
+
+		if (Described.BakedAnimation)
+		{
+			Bytes += Described.BakedAnimation->GetGpuByteSize();
+		}
+	}
+
+	return Bytes;
+}
+
+const std::shared_ptr<ImpostorAtlas>& ModelAsset::GetImpostor(const Graphics& InGraphics) const
+{
+	if (!MyImpostorAtlas)
+	{
+		MyImpostorAtlas = std::make_shared<ImpostorAtlas>(InGraphics);
+	}
+
+	return MyImpostorAtlas;
+}
+
+struct ModelInstance::AsyncLoad
+{
+	std::string Path;
+	ModelAsset::ImportOptions Options;
+	ModelAsset::ImportProgress Progress;
+	std::shared_ptr<const ModelAsset> Asset;
+	std::vector<std::unique_ptr<Mesh>> Meshes;
+	ProgressCallback OnProgress;
+	float ReportedProgress {-1.0f};
+	JobCounter Done;
+
+	~AsyncLoad()
+	{
+		// The jobs write into this load, so an abandoned one is still waited for. Its failure no longer matters.
+		try
+		{
+			JobSystem::Get().Wait(Done);
+		}
+		catch (...)
+		{
+		}
+	}
+};
+
+ModelInstance::ModelInstance()
+{
+	DirectX::XMStoreFloat4x4(&RootTransform, DirectX::XMMatrixIdentity());
+}
+
+ModelInstance::ModelInstance(const Graphics& InGraphics, std::shared_ptr<const ModelAsset> InAsset)
+	: ModelInstance()
+{
+	Asset = std::move(InAsset);
+	Meshes = CreateMeshes(InGraphics, *Asset);
+	BuildHierarchy();
+}
+
+ModelInstance::ModelInstance(const Graphics& InGraphics, const std::string_view InPath, const ModelAsset::ImportOptions& InOptions)
+	: ModelInstance(InGraphics, ModelAsset::Resolve(InGraphics, InPath, InOptions))
+{
+}
+
+ModelInstance::~ModelInstance()
+{
+	if (SceneFirst != GpuScene::NoIndex)
+	{
+		Scene->Free(SceneFirst, SceneNum);
+	}
+}
+
+std::unique_ptr<ModelInstance> ModelInstance::LoadAsync(const Graphics& InGraphics, const std::string_view InPath, const ModelAsset::ImportOptions& InOptions,
+                                                        ProgressCallback InOnProgress)
+{
+	std::unique_ptr<ModelInstance> NewInstance {new ModelInstance};
+	NewInstance->Placeholder = std::make_unique<SolidSphere>(InGraphics, 0.5f);
+	NewInstance->Placeholder->SetPosition({0.0f, 0.0f, 0.0f});
+	NewInstance->PendingLoad = std::make_unique<AsyncLoad>();
+	NewInstance->PendingLoad->Path = InPath;
+	NewInstance->PendingLoad->Options = InOptions;
+	NewInstance->PendingLoad->OnProgress = std::move(InOnProgress);
+
+	// Resources are created on the free-threaded ID3D11Device, only the immediate context stays on the main thread.
+	// In the background lane, so are the jobs the import spreads its meshes over.
+	auto* const Load = NewInstance->PendingLoad.get();
+	JobSystem::Get().Run([&InGraphics, Load]
+	{
+		Load->Asset = ModelAsset::Resolve(InGraphics, Load->Path, Load->Options, &Load->Progress);
+		Load->Meshes = CreateMeshes(InGraphics, *Load->Asset);
+	}, JobLane::Background, &Load->Done);
+
+	return NewInstance;
+}
+
+std::unique_ptr<ModelInstance> ModelInstance::LoadShared(const Graphics& InGraphics) const
+{
+	if (!PendingLoad)
+	{
+		return std::make_unique<ModelInstance>(InGraphics, Asset);
+	}
+
+	std::unique_ptr<ModelInstance> NewInstance {new ModelInstance};
+	NewInstance->Placeholder = std::make_unique<SolidSphere>(InGraphics, 0.5f);
+	NewInstance->Placeholder->SetPosition({0.0f, 0.0f, 0.0f});
+	NewInstance->PendingLoad = std::make_unique<AsyncLoad>();
+	NewInstance->PendingLoad->Path = PendingLoad->Path;
+	NewInstance->PendingLoad->Options = PendingLoad->Options;
+
+	// Once the import is done Resolve finds it cached, while it runs no worker is held on its lock.
+	auto* const Load = NewInstance->PendingLoad.get();
+	JobSystem::Get().Run([&InGraphics, Load]
+	{
+		Load->Asset = ModelAsset::Resolve(InGraphics, Load->Path, Load->Options, &Load->Progress);
+		Load->Meshes = CreateMeshes(InGraphics, *Load->Asset);
+	}, JobLane::Background, &Load->Done, &PendingLoad->Done);
+
+	return NewInstance;
+}
+
+void ModelInstance::Update()
+{
+	if (!PendingLoad)
+	{
+		return;
+	}
+
+	if (const auto Progress = GetLoadProgress(); PendingLoad->OnProgress && Progress != PendingLoad->ReportedProgress)
+	{
+		PendingLoad->ReportedProgress = Progress;
+		PendingLoad->OnProgress(Progress);
+	}
+
+	if (!PendingLoad->Done.IsDone())
+	{
+		return;
+	}
+
+	// Returns at once and rethrows anything the loader jobs failed with on the main thread.
+	JobSystem::Get().Wait(PendingLoad->Done);
+
+	Asset = std::move(PendingLoad->Asset);
+	Meshes = std::move(PendingLoad->Meshes);
+	BuildHierarchy();
+
+	for (const auto& Pending : std::exchange(PendingNodeTransforms, {}))
+	{
+		SetNodeTransform(Pending);
+	}
+
+	PendingLoad.reset();
+	Placeholder.reset();
+}
+
+float ModelInstance::GetLoadProgress() const noexcept
+{
+	if (!PendingLoad)
+	{
+		return 1.0f;
+	}
+
+	// Completed is read first, TotalSteps is always published before the step it accounts for.
+	const auto CompletedSteps = PendingLoad->Progress.CompletedSteps.load();
+	return static_cast<float>(CompletedSteps) / static_cast<float>(PendingLoad->Progress.TotalSteps.load());
+}
+
+void ModelInstance::SetRootTransform(DirectX::FXMMATRIX InTransform) noexcept
+{
+	DirectX::XMStoreFloat4x4(&RootTransform, InTransform);
+
+	if (Hierarchy)
+	{
+		Hierarchy->SetRootTransform(InTransform);
+	}
+	else if (Placeholder)
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMStoreFloat3(&Position, InTransform.r[3]);
+		Placeholder->SetPosition(Position);
+	}
+}
+
+void ModelInstance::SetNodeTransform(const NodeTransform& InTransform)
+{
+	if (!IsReady())
+	{
+		PendingNodeTransforms.push_back(InTransform);
+		return;
+	}
+
+	if (InTransform.Node < Hierarchy->GetNodeNum())
+	{
+		const auto& [Node, Roll, Pitch, Yaw, Position] = InTransform;
+		GetWindow().SetTransform(*Hierarchy, Node, {Roll, Pitch, Yaw, Position.x, Position.y, Position.z});
+	}
+}
+
+void ModelInstance::SetMorphWeight(const std::string_view InTarget, const float InWeight)
+{
+	const auto Found = std::find_if(MorphWeights.begin(), MorphWeights.end(), [InTarget](const std::pair<std::string, float>& InEntry)
+	{
+		return InEntry.first == InTarget;
+	});
+
+	if (Found != MorphWeights.end())
+	{
+		Found->second = InWeight;
+	}
+	else
+	{
+		MorphWeights.emplace_back(InTarget, InWeight);
+	}
+
+	for (const auto& [Node, MeshIndex] : MorphedMeshes)
+	{
+		Meshes[MeshIndex]->SetMorphWeight(InTarget, InWeight);
+	}
+}
+
+void ModelInstance::PlayVertexAnimation(const unsigned int InIndex, const float InTimeOffset) noexcept
+{
+	PlayedVertexAnimation = VertexAnimation::Pack(InIndex, InTimeOffset);
+
+	for (const auto& [Node, MeshIndex] : VertexAnimatedMeshes)
+	{
+		Meshes[MeshIndex]->SetPlayedAnimation(PlayedVertexAnimation);
+	}
+}
+
+std::vector<ModelInstance::NodeTransform> ModelInstance::GetNodeTransforms() const
+{
+	std::vector<NodeTransform> Transforms;
+
+	if (!Window)
+	{
+		return Transforms;
+	}
+
+	const auto& Parameters = Window->GetTransforms();
+
+	for (unsigned int Index = 0u; Index < static_cast<unsigned int>(Parameters.size()); ++Index)
+	{
+		if (const auto& [Roll, Pitch, Yaw, X, Y, Z] = Parameters[Index]; Roll != 0.0f || Pitch != 0.0f || Yaw != 0.0f || X != 0.0f || Y != 0.0f || Z != 0.0f)
+		{
+			Transforms.push_back({Index, Roll, Pitch, Yaw, {X, Y, Z}});
+		}
+	}
+
+	return Transforms;
+}
+
+void ModelInstance::PlayAnimation(const unsigned int InIndex, const bool bInIsLooping) noexcept
+{
+	PlayingAnimation = InIndex;
+	AnimationCursors.clear();
+	AnimationTime = 0.0f;
+	bIsAnimationLooping = bInIsLooping;
+}
+
+void ModelInstance::StopAnimation() noexcept
+{
+	PlayingAnimation = NoAnimation;
+}
+
+void ModelInstance::Animate(const float InDeltaSeconds) noexcept
+{
+	PROFILE_SCOPE("ModelInstance::Animate");
+
+	if (!IsReady() || PlayingAnimation >= Asset->GetAnimations().size())
+	{
+		return;
+	}
+
+	const auto& Animation = Asset->GetAnimations()[PlayingAnimation];
+	const auto Duration = Animation.GetDuration();
+	AnimationTime += InDeltaSeconds;
+	bool bIsFinished = false;
+
+	if (AnimationTime >= Duration)
+	{
+		bIsFinished = !bIsAnimationLooping;
+		AnimationTime = bIsAnimationLooping && Duration > 0.0f ? std::fmod(AnimationTime, Duration) : Duration;
+	}
+
+	// Sized once the asset is there, playback can be asked for before it loads.
+	AnimationCursors.resize(Animation.GetCursorNum(), 0u);
+	Animation.Sample(AnimationTime, AnimationCursors, *Hierarchy);
+
+	// A clip played once holds its last pose, without dirtying the nodes again every frame.
+	if (bIsFinished)
+	{
+		PlayingAnimation = NoAnimation;
+	}
+}
+
+void ModelInstance::AnimateAll(const std::span<ModelInstance* const> InInstances, const float InDeltaSeconds)
+{
+	PROFILE_SCOPE("ModelInstance::AnimateAll");
+
+	JobSystem::Get().ParallelFor(InInstances.size(), 1u, [&](const size_t InIndex)
+	{
+		InInstances[InIndex]->Animate(InDeltaSeconds);
+	});
+}
+
+std::vector<std::unique_ptr<Mesh>> ModelInstance::CreateMeshes(const Graphics& InGraphics, const ModelAsset& InAsset)
+{
+	std::vector<std::unique_ptr<Mesh>> NewMeshes;
+	NewMeshes.reserve(InAsset.GetMeshes().size());
+
+	for (const auto& Description : InAsset.GetMeshes())
+	{
+		NewMeshes.push_back(std::make_unique<Mesh>(InGraphics, Description));
+	}
+
+#if PROFILE_MARKERS_ENABLED
+	// Prefixed by the node the mesh hangs off, widened as is since imported names are ASCII in practice.
+	const auto& Nodes = *InAsset.GetNodes();
+
+	for (size_t Node = 0u; Node < Nodes.Names.size(); ++Node)
+	{
+		for (auto Index = Nodes.MeshOffsets[Node]; Index < Nodes.MeshOffsets[Node + 1u]; ++Index)
+		{
+			const auto Name = std::string(Nodes.Names[Node].GetString()) + "/" + InAsset.GetMeshes()[Nodes.MeshIndices[Index]].Name;
+			NewMeshes[Nodes.MeshIndices[Index]]->SetEventName({Name.begin(), Name.end()});
+		}
+	}
+#endif
+
+	return NewMeshes;
+}
+
+void ModelInstance::ApplyReload(const Graphics& InGraphics)
+{
+	const auto* const Reloader = InGraphics.GetAssetReloader();
+
+	if (!Reloader || !IsReady())
+	{
+		return;
+	}
+
+	auto ReloadedAsset = Reloader->FindReload(*Asset);
+
+	if (!ReloadedAsset)
+	{
+		return;
+	}
+
+	auto ReloadedMeshes = CreateMeshes(InGraphics, *ReloadedAsset);
+	const auto PreviousHierarchy = std::move(Hierarchy);
+
+	// The reloader only hands out imports with the same nodes, so the window's sliders still point at the right ones.
+	Asset = std::move(ReloadedAsset);
+	Meshes = std::move(ReloadedMeshes);
+	BuildHierarchy();
+	Hierarchy->CopyAppliedTransforms(*PreviousHierarchy);
+	AnimationCursors.clear();
+	AnimationTime = 0.0f;
+
+	// The cached shadow faces were drawn from the old meshes.
+	bHasReportedShadowBounds = false;
+}
+
+void ModelInstance::Freeze(const Graphics& InGraphics, const unsigned int InNodeIndex)
+{
+	assert(IsReady() && "Only a loaded model can be frozen");
+
+	auto Options = Asset->GetOptions();
+
+	// Nothing to do inside a subtree that is frozen already.
+	for (unsigned int Index = 0u; Index <= InNodeIndex; ++Index)
+	{
+		if (InNodeIndex < Hierarchy->GetSubtreeEnd(Index) &&
+		    std::find(Options.StaticNodes.begin(), Options.StaticNodes.end(), Hierarchy->GetName(Index)) != Options.StaticNodes.end())
+		{
+			return;
+		}
+	}
+
+	const auto FrozenName = Hierarchy->GetNameAtom(InNodeIndex);
+	Options.StaticNodes.emplace_back(FrozenName.GetString());
+
+	auto FrozenAsset = ModelAsset::Resolve(InGraphics, Asset->GetSourcePath(), Options);
+	auto FrozenMeshes = CreateMeshes(InGraphics, *FrozenAsset);
+	const auto PreviousHierarchy = std::move(Hierarchy);
+
+	Asset = std::move(FrozenAsset);
+	Meshes = std::move(FrozenMeshes);
+	BuildHierarchy();
+	Hierarchy->CopyAppliedTransforms(*PreviousHierarchy);
+
+	// Every node of the name was frozen, and the vertices below each hold the imported transforms.
+	for (unsigned int Root = 0u; Root < Hierarchy->GetNodeNum(); ++Root)
+	{
+		if (Hierarchy->GetNameAtom(Root) != FrozenName)
+		{
+			continue;
+		}
+
+		for (auto Index = Root + 1u; Index < Hierarchy->GetSubtreeEnd(Root); ++Index)
+		{
+			Hierarchy->SetAppliedTransform(Index, DirectX::XMMatrixIdentity());
+		}
+
+		if (Window)
+		{
+			Window->Reset(Root + 1u, Hierarchy->GetSubtreeEnd(Root));
+		}
+	}
+
+	// The cached shadow faces were drawn from the old meshes.
+	bHasReportedShadowBounds = false;
+}
+
+void ModelInstance::BuildHierarchy()
+{
+	Hierarchy = std::make_unique<NodeHierarchy>(Asset->GetNodes());
+	bIsSceneStale = true;
+	Hierarchy->SetRootTransform(DirectX::XMLoadFloat4x4(&RootTransform));
+	Hierarchy->UpdateWorldTransforms();
+
+	std::vector<DirectX::BoundingBox> ItemBounds;
+	NodeItems.assign(Hierarchy->GetNodeNum(), BoundingVolumeHierarchy::NoItem);
+	IndexedNodes.clear();
+	IndexedMeshNum = 0u;
+	SkinnedMeshes.clear();
+	MorphedMeshes.clear();
+	VertexAnimatedMeshes.clear();
+	bArePalettesStale = true;
+
+	for (unsigned int Index = 0u; Index < Hierarchy->GetNodeNum(); ++Index)
+	{
+		if (const auto& Bounds = Hierarchy->GetWorldBounds(Index); !IsEmpty(Bounds))
+		{
+			NodeItems[Index] = static_cast<unsigned int>(IndexedNodes.size());
+			IndexedNodes.push_back(Index);
+			ItemBounds.push_back(Bounds);
+			IndexedMeshNum += static_cast<unsigned int>(Hierarchy->GetMeshIndices(Index).size());
+		}
+
+		for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
+		{
+			if (Meshes[MeshIndex]->IsSkinned())
+			{
+				SkinnedMeshes.push_back({Index, MeshIndex});
+			}
+
+			if (Meshes[MeshIndex]->IsMorphed())
+			{
+				MorphedMeshes.push_back({Index, MeshIndex});
+
+				for (const auto& [Target, Weight] : MorphWeights)
+				{
+					Meshes[MeshIndex]->SetMorphWeight(Target, Weight);
+				}
+			}
+
+			if (Meshes[MeshIndex]->IsVertexAnimated())
+			{
+				VertexAnimatedMeshes.push_back({Index, MeshIndex});
+				Meshes[MeshIndex]->SetPlayedAnimation(PlayedVertexAnimation);
+			}
+		}
+	}
+
+	SpatialIndex.Build(ItemBounds);
+}
+
+void ModelInstance::UpdateSceneTransforms(const Graphics& InGraphics) const
+{
+	if (!bIsSceneStale)
+	{
+		if (bIsScenePropagated)
+		{
+			for (const auto Index : Hierarchy->GetChangedNodes())
+			{
+				Scene->SetLocalTransform(SceneFirst + Index, Hierarchy->GetPlacedLocalTransform(Index));
+			}
+		}
+		else if (SceneFirst != GpuScene::NoIndex)
+		{
+			for (const auto Index : Hierarchy->GetUpdatedNodes())
+			{
+				Scene->SetTransform(SceneFirst + Index, Hierarchy->GetWorldTransform(Index));
+			}
+		}
+
+		return;
+	}
+
+	if (SceneFirst != GpuScene::NoIndex)
+	{
+		Scene->Free(SceneFirst, SceneNum);
+	}
+
+	// When the scene is full the meshes fall back to transient IDs.
+	Scene = &InGraphics.GetGpuScene();
+	SceneNum = Hierarchy->GetNodeNum();
+	SceneFirst = SceneNum > 0u ? Scene->Allocate(SceneNum) : GpuScene::NoIndex;
+	bIsSceneStale = false;
+	bIsScenePropagated = SceneFirst != GpuScene::NoIndex && SceneNum >= GpuScene::MinPropagatedNum;
+
+	if (bIsScenePropagated)
+	{
+		Scene->AddHierarchy(SceneFirst, Hierarchy->GetParents());
+
+		for (unsigned int Index = 0u; Index < SceneNum; ++Index)
+		{
+			Scene->SetLocalTransform(SceneFirst + Index, Hierarchy->GetPlacedLocalTransform(Index));
+		}
+	}
+	else if (SceneFirst != GpuScene::NoIndex)
+	{
+		for (unsigned int Index = 0u; Index < SceneNum; ++Index)
+		{
+			Scene->SetTransform(SceneFirst + Index, Hierarchy->GetWorldTransform(Index));
+		}
+	}
+}
+
+ModelWindow& ModelInstance::GetWindow()
+{
+	if (!Window)
+	{
+		Window = std::make_unique<ModelWindow>();
+	}
+
+	return *Window;
+}
+
+std::vector<ModelAsset::CookedMap> ModelAsset::ImportForCooking(const std::filesystem::path& InPath)
+{
+	return FindCookedMaps(ReadSource(InPath).Meshes, InPath);
+}
+
+std::vector<ModelAsset::CookedMap> ModelAsset::FindCookedMaps(const std::vector<MeshCache::MeshEntry>& InMeshes, const std::filesystem::path& InPath)
+{
+	const std::string RootPath {InPath.parent_path().string() + "\\"};
+	// A map two meshes use differently is cooked for whichever usage came first.
+	std::map<std::string, TextureCooker::Usage> Maps;
+
+	for (const auto& Entry : InMeshes)
+	{
+		for (const auto& [Map, Usage] : {std::pair {&Entry.DiffuseMap, TextureCooker::Usage::ColorMap},
+		                                 std::pair {&Entry.NormalMap, TextureCooker::Usage::NormalMap},
+		                                 std::pair {&Entry.SpecularMap, TextureCooker::Usage::SpecularMap}})
+		{
+			if (!Map->empty())
+			{
+				Maps.try_emplace(RootPath + *Map, Usage);
+			}
+		}
+	}
+
+	std::vector<CookedMap> CookedMaps;
+	CookedMaps.reserve(Maps.size());
+
+	for (const auto& [FileName, Usage] : Maps)
+	{
+		CookedMaps.push_back({FileName, Usage});
+	}
+
+	return CookedMaps;
+}
+
+void ModelAsset::CookTextures(const std::vector<CookedMap>& InMaps, const TextureCooker::Quality InQuality)
+{
+	// A map that fails to cook is only loaded as it is.
+	JobSystem::Get().ParallelFor(InMaps.size(), 1u, [&InMaps, InQuality](const size_t InIndex)
+	{
+		TextureCooker::Cook(InMaps[InIndex].FileName, InMaps[InIndex].Usage, InQuality);
+	});
+}
+
+ModelAsset::TexturePacking ModelAsset::PackTextures(const std::vector<MeshCache::MeshEntry>& InMeshes, const std::filesystem::path& InPath)
+{
+	const std::string RootPath {InPath.parent_path().string() + "\\"};
+	TexturePacking Packing;
+
+	const auto Pack = [&](std::string MeshCache::MeshEntry::* const InMap, std::unordered_map<std::string, std::vector<std::string>>& OutArrays)
+	{
+		// Arrays are keyed by everything that has to match across their slices.
+		std::map<std::tuple<UINT, UINT, UINT, DXGI_FORMAT>, std::vector<std::string>> Groups;
+
+		for (const auto& Entry : InMeshes)
+		{
+			if (const auto& Map = Entry.*InMap; !Map.empty() && !OutArrays.contains(RootPath + Map))
+			{
+				auto FileName = RootPath + Map;
+				const auto Desc = TextureArray::ReadDesc(FileName);
+				Groups[{Desc.Width, Desc.Height, Desc.MipLevels, Desc.Format}].push_back(FileName);
+				OutArrays.emplace(std::move(FileName), std::vector<std::string> {});
+			}
+		}
+
+		for (auto& [Shape, FileNames] : Groups)
+		{
+			// Sorted so the same set of maps always makes the same array, whichever mesh came first.
+			std::sort(FileNames.begin(), FileNames.end());
+
+			for (const auto& FileName : FileNames)
+			{
+				OutArrays[FileName] = FileNames;
+			}
+		}
+	};
+
+	Pack(&MeshCache::MeshEntry::DiffuseMap, Packing.DiffuseArrays);
+	Pack(&MeshCache::MeshEntry::NormalMap, Packing.NormalArrays);
+	Pack(&MeshCache::MeshEntry::SpecularMap, Packing.SpecularArrays);
 
-DirectX::XMMATRIX Mesh::GetTransformMatrix() const noexcept
-{
-	return DirectX::XMLoadFloat4x4(&TransformMatrix);
+	return Packing;
 }
 
-Node::Node(int InID, std::string_view InName, std::vector<Mesh*>&& InMeshes, const DirectX::XMMATRIX& InTransformMatrix)
-	: Name(InName), ID(InID), Meshes(std::move(InMeshes))
+Mesh::Description ModelAsset::ParseMesh(const Graphics& InGraphics, const MeshCache::MeshEntry& InMesh, const std::filesystem::path& InPath,
+                                        const TexturePacking* InPacking, const ImportOptions& InOptions, const AnimationBake* InBake)
 {
-	DirectX::XMStoreFloat4x4(&BaseTransform, InTransformMatrix);
-	DirectX::XMStoreFloat4x4(&AppliedTransform, DirectX::XMMatrixIdentity());
-}
+	ALLOCATION_SCOPE(Geometry);
+	const std::string& RootPath {InPath.parent_path().string() + "\\"};
 
-void Node::Draw(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransformMatrix) const
-{
-	const auto MyTransformMatrix = DirectX::XMLoadFloat4x4(&AppliedTransform) *
-										   DirectX::XMLoadFloat4x4(&BaseTransform)*
-										   InAccumulatedTransformMatrix;
+	Material::Description MaterialDescription;
+	MaterialDescription.SpecularPower = InMesh.Shininess;
+	MaterialDescription.Opacity = InMesh.Opacity;
+	MaterialDescription.bIsTwoSided = InMesh.bIsTwoSided;
+	MaterialDescription.bIsAlphaTested = InMesh.bIsAlphaTested;
+	MaterialDescription.Sampling = InOptions.MaterialSampling;
 
-	for (const auto* Mesh : Meshes)
+	for (const auto& [MaterialName, Opacity, bIsTwoSided] : InOptions.MaterialOverrides)
 	{
-		Mesh->Draw(InGraphics, MyTransformMatrix);
+		if (MaterialName == InMesh.MaterialName)
+		{
+			MaterialDescription.Opacity = Opacity;
+			MaterialDescription.bIsTwoSided = bIsTwoSided;
+		}
 	}
 
-	for (const auto& Child : Children)
+	if (!InMesh.DiffuseMap.empty())
 	{
-		Child->Draw(InGraphics, MyTransformMatrix);
+		MaterialDescription.DiffuseMap = RootPath + InMesh.DiffuseMap;
 	}
-}
-
-void Node::SetAppliedTransform(DirectX::FXMMATRIX InTransform)
-{
-	DirectX::XMStoreFloat4x4(&AppliedTransform, InTransform);
-}
-
-int Node::GetID() const noexcept
-{
-	return ID;
-}
-
-void Node::AddChild(std::unique_ptr<Node>&& InNode)
-{
-	Children.push_back(std::move(InNode));
-}
 
-void Node::ShowTree(const Node** InSelectedNode) const
-{
-	const int IsCurrentNodeSelected = GetID() == (*InSelectedNode)->GetID();
-	const int IsCurrentNodeLeaf = Children.empty();
-
-	const auto NodeFlags = ImGuiTreeNodeFlags_OpenOnArrow |
-							   (IsCurrentNodeSelected ? ImGuiTreeNodeFlags_Selected : 0) |
-							   (IsCurrentNodeLeaf ? ImGuiTreeNodeFlags_Leaf : 0);
+	if (!InMesh.NormalMap.empty())
+	{
+		MaterialDescription.NormalMap = RootPath + InMesh.NormalMap;
+	}
 
-	const auto IsExpanded = ImGui::TreeNodeEx
-								 (
-									reinterpret_cast<void*>(static_cast<intptr_t>(GetID())),
-									NodeFlags,
-									Name.c_str()
-								 );
+	if (!InMesh.SpecularMap.empty())
+	{
+		MaterialDescription.SpecularMap = RootPath + InMesh.SpecularMap;
+		// Two channels can't hold a tint and a power, so only the cooker writes them.
+		MaterialDescription.bIsSpecularPacked = TextureArray::ReadDesc(MaterialDescription.SpecularMap).Format == DXGI_FORMAT_BC5_UNORM;
+	}
 
-	if (ImGui::IsItemClicked())
+	if (!InMesh.LightmapMap.empty())
 	{
-		*InSelectedNode = this;
+		MaterialDescription.LightmapMap = RootPath + InMesh.LightmapMap;
 	}
 
-	if (IsExpanded)
+	if (InPacking)
 	{
-		for (const auto& Child : Children)
+		const auto AssignArray = [](const std::string& InFileName, const std::unordered_map<std::string, std::vector<std::string>>& InArrays,
+		                            std::vector<std::string>& OutArray)
 		{
-			Child->ShowTree(InSelectedNode);
-		}
+			if (const auto Found = InArrays.find(InFileName); Found != InArrays.end())
+			{
+				OutArray = Found->second;
+			}
+		};
 
-		ImGui::TreePop();
+		AssignArray(MaterialDescription.DiffuseMap, InPacking->DiffuseArrays, MaterialDescription.DiffuseArray);
+		AssignArray(MaterialDescription.NormalMap, InPacking->NormalArrays, MaterialDescription.NormalArray);
+		AssignArray(MaterialDescription.SpecularMap, InPacking->SpecularArrays, MaterialDescription.SpecularArray);
 	}
-}
 
-class ModelWindow
-{
-public:
-	ModelWindow(const int InDefaultSelectedNodeIndex, Node* InDefaultSelectedNode)
-		: SelectedNodeIndex(InDefaultSelectedNodeIndex), SelectedNode(InDefaultSelectedNode)
+	auto MeshMaterial = Material::Resolve(InGraphics, MaterialDescription);
+	const auto& Permutation = MeshMaterial->GetPermutation();
+	const auto bIsMorphed = !InMesh.MorphDeltas.empty();
+	std::shared_ptr<VertexAnimation> BakedAnimation;
+
+	// Blend shapes can't be baked along, the frames only hold what the bones do.
+	if (InBake && !InMesh.Bones.empty() && !bIsMorphed)
 	{
-		NodeTransforms[SelectedNode->GetID()] = {};
+		if (const auto Frames = VertexAnimation::SampleSkin(InMesh, InBake->Clips, *InBake->BindPose, InBake->MeshNode); Frames.Table.ClipNum > 0u)
+		{
+			BakedAnimation = std::make_shared<VertexAnimation>(InGraphics, Frames);
+		}
 	}
 
-	void Show(const std::string_view InWindowName, const Node& InRoot) noexcept
+	const auto bIsSkinned = !InMesh.Bones.empty() && !BakedAnimation;
+	// Only static meshes are baked, the skinned and morphed vertex shaders have no such variant. A mesh with a lightmap never has its vertices baked too.
+	const auto VertexFeatures = Permutation.VertexFeatures | (InMesh.Layout.Has<DV::VertexLayout::ElementType::Occlusion>() ? Material::VertexOcclusion : 0u) |
+	                            (MeshMaterial->IsLightmapped() ? Material::Lightmapped : 0u);
+	const auto VertexShaderName = BakedAnimation ? Material::VertexAnimatedVertexShaderName
+	                            : bIsMorphed ? (bIsSkinned ? Material::MorphedSkinnedVertexShaderName : Material::MorphedVertexShaderName)
+	                                         : (bIsSkinned ? Material::SkinnedVertexShaderName : Material::VertexShaderName);
+	auto ModelVertexShader = VertexShader::Resolve(InGraphics, VertexShaderName, VertexFeatures);
+	std::shared_ptr<Bindable> InstancedVertexShader;
+
+	// Baked meshes instance like static ones, every instance brings its own clip and time.
+	if (BakedAnimation)
 	{
-		const auto WindowName = !InWindowName.empty() ? InWindowName : "Model";
+		InstancedVertexShader = VertexShader::Resolve(InGraphics, Material::VertexAnimatedInstancedVertexShaderName, VertexFeatures);
+	}
+	else if (!bIsSkinned && !bIsMorphed)
+	{
+		InstancedVertexShader = VertexShader::Resolve(InGraphics, Material::InstancedVertexShaderName, VertexFeatures);
+	}
 
-		if (ImGui::Begin(WindowName.data()))
-		{
-			ImGui::Columns(2, nullptr, true);
-			InRoot.ShowTree(const_cast<const Node**>(&SelectedNode));
+	const auto MeshTag {RootPath + "$" + InMesh.Name};
+	// A reimport's buffers live alongside the ones the instances still draw until they swap.
+	const auto BufferTag = InOptions.Revision > 0u ? MeshTag + "#" + std::to_string(InOptions.Revision) : MeshTag;
 
-			ImGui::NextColumn();
+	Mesh::Description Description;
+	Description.Name = MeshTag;
+	auto& Bindables = Description.Bindables;
+	Bindables.push_back(VertexBuffer::Resolve(InGraphics, BufferTag, InMesh.Layout, InMesh.Vertices, InMesh.VertexBytes));
+	Bindables.push_back(IndexBuffer::Resolve(InGraphics, BufferTag, InMesh.Indices, InMesh.IndexNum));
 
-			if (SelectedNode)
-			{
-				auto& [Roll, Pitch, Yaw, X, Y, Z] = NodeTransforms[SelectedNode->GetID()];
-				ImGui::Text("Orientation");
-				ImGui::SliderAngle("Roll", &Roll, -180.0f, 180.0f);
-				ImGui::SliderAngle("Pitch", &Pitch, -180.0f, 180.0f);
-				ImGui::SliderAngle("Yaw", &Yaw, -180.0f, 180.0f);
-				ImGui::Text("Position");
-				ImGui::SliderFloat("X", &X, -20.0f, 20.0f);
-				ImGui::SliderFloat("Y", &Y, -20.0f, 20.0f);
-				ImGui::SliderFloat("Z", &Z, -20.0f, 20.0f);
-			}
-		}
+	PipelineState::Description Pipeline;
+	Pipeline.Layout = InputLayout::Resolve(InGraphics, InMesh.Layout, ModelVertexShader->GetByteCode());
+	Pipeline.Vertex = std::move(ModelVertexShader);
+	Pipeline.Pixel = MeshMaterial->GetPixelShader();
+	Pipeline.CullMode = MeshMaterial->IsTwoSided() ? D3D11_CULL_NONE : D3D11_CULL_BACK;
+	Pipeline.Blending = MeshMaterial->IsBlended() ? PipelineState::BlendMode::WeightedBlended : PipelineState::BlendMode::Opaque;
 
-		ImGui::End();
-	}
+	Bindables.push_back(PipelineState::Resolve(InGraphics, Pipeline));
+	Bindables.push_back(std::move(MeshMaterial));
 
-	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept
+	Description.Bounds = EmptyBounds;
+	if (const auto Stride = InMesh.Layout.Size(); Stride && InMesh.VertexBytes >= Stride)
 	{
-		const auto& [Roll, Pitch, Yaw, X, Y, Z] = NodeTransforms.at(SelectedNode->GetID());
-		return DirectX::XMMatrixRotationRollPitchYaw(Roll, Pitch, Yaw) *
-			   DirectX::XMMatrixTranslation(X, Y, Z);
+		const auto* Positions = static_cast<const char*>(InMesh.Vertices) + InMesh.Layout.Resolve<DV::VertexLayout::ElementType::Position3D>().GetByteOffset();
+		DirectX::BoundingBox::CreateFromPoints(Description.Bounds, InMesh.VertexBytes / Stride, reinterpret_cast<const DirectX::XMFLOAT3*>(Positions), Stride);
+
+		if (bIsMorphed)
+		{
+			Description.Bounds = GetMorphedBounds(Description.Bounds, Positions, Stride, InMesh.MorphDeltas);
+			Description.Morphs = std::make_shared<MorphTargets>(InGraphics, InMesh.MorphTargetNames, InMesh.MorphDeltas, InMesh.VertexBytes / Stride);
+		}
 	}
 
-	[[nodiscard]] Node* GetSelectedNode() const
+	// The bind pose may lie outside every frame, the frames are what is drawn.
+	if (BakedAnimation)
 	{
-		return SelectedNode;
+		Description.Bounds = BakedAnimation->GetBounds();
+		Description.BakedAnimation = std::move(BakedAnimation);
 	}
 
-private:
-	struct TransformParameters
-	{
-		float Roll = 0.0f;
-		float Pitch = 0.0f;
-		float Yaw = 0.0f;
-		float X = 0.0f;
-		float Y = 0.0f;
-		float Z = 0.0f;
-	};
+	Description.Lods = InMesh.Lods;
 
-	int SelectedNodeIndex;
-	Node* SelectedNode;
-	std::unordered_map<int, TransformParameters> NodeTransforms;
-};
+	if (!InMesh.Meshlets.empty())
+	{
+		Description.Meshlets = std::make_shared<const std::vector<MeshCache::MeshletEntry>>(InMesh.Meshlets);
+	}
 
-Model::Model(const Graphics& InGraphics, const std::string_view InPath)
-{
-	Assimp::Importer Importer;
-	const auto* Scene = Importer.ReadFile
-	(
-		InPath.data(),
-		aiProcess_Triangulate |
-		aiProcess_JoinIdenticalVertices |
-		aiProcess_ConvertToLeftHanded |
-		aiProcess_GenNormals |
-		aiProcess_CalcTangentSpace
-	);
+	if (InMesh.Triangles && !InMesh.Triangles->IsEmpty())
+	{
+		Description.Triangles = InMesh.Triangles;
+	}
 
-	for (size_t MeshIndex = 0; MeshIndex < Scene->mNumMeshes; ++MeshIndex)
+	if (bIsSkinned)
 	{
-		Meshes.push_back(ParseMesh(InGraphics, *Scene->mMeshes[MeshIndex], Scene->mMaterials, InPath));
+		Description.Bones = std::make_shared<const std::vector<MeshCache::BoneEntry>>(InMesh.Bones);
 	}
 
-	int NextID = 0;
-	Root = ParseNode(NextID, *Scene->mRootNode);
-	Window = std::make_unique<ModelWindow>(0, Root.get());
-}
+	Description.UnitsPerTexcoord = GetUnitsPerTexcoord(InMesh);
+	Description.InstancedVertexShader = std::move(InstancedVertexShader);
 
-Model::~Model() = default;
+	return Description;
+}
 
-std::unique_ptr<Mesh> Model::ParseMesh(const Graphics& InGraphics, const aiMesh& InMesh, aiMaterial const* const* InMaterials, const std::filesystem::path& InPath)
+void ModelInstance::Submit(const Graphics& InGraphics) const
 {
-	const std::string& RootPath {InPath.parent_path().string() + "\\"};
+	PROFILE_SCOPE("ModelInstance::Submit");
+
+	if (!IsReady())
+	{
+		if (Placeholder)
+		{
+			Placeholder->Submit(InGraphics);
+		}
+
+		return;
+	}
 
-	std::vector<std::shared_ptr<Bindable>> Bindables;
-	bool bHasDiffuseMap {false};
-	bool bHasNormalMap {false};
-	bool bHasSpecularMap {false};
-	float Shininess {35.0f};
+	Hierarchy->UpdateWorldTransforms();
+	UpdateSceneTransforms(InGraphics);
 
-	auto& Material = *InMaterials[InMesh.mMaterialIndex];
-	aiString TextureFileName;
+	auto& Shadows = InGraphics.GetPointLightShadows();
+	auto& Sun = InGraphics.GetDirectionalLight();
+	auto& Probes = InGraphics.GetReflectionProbes();
+	auto& Volume = InGraphics.GetIrradianceVolume();
 
-	if (Material.GetTexture(aiTextureType_DIFFUSE, 0, &TextureFileName) == aiReturn_SUCCESS)
+	if (!bHasReportedShadowBounds && !SpatialIndex.IsEmpty())
 	{
-		Bindables.push_back(Texture::Resolve(InGraphics, RootPath + TextureFileName.C_Str()));
-		bHasDiffuseMap = true;
+		Shadows.AddMovedBounds(SpatialIndex.GetBounds());
+		Sun.AddMovedBounds(SpatialIndex.GetBounds());
+		Probes.AddMovedBounds(SpatialIndex.GetBounds());
+		Volume.AddMovedBounds(SpatialIndex.GetBounds());
+		bHasReportedShadowBounds = true;
 	}
 
-	if (Material.GetTexture(aiTextureType_NORMALS, 0, &TextureFileName) == aiReturn_SUCCESS)
+	for (const auto Index : Hierarchy->GetUpdatedNodes())
 	{
-		Bindables.push_back(Texture::Resolve(InGraphics, RootPath + TextureFileName.C_Str(), 1));
-		bHasNormalMap = true;
+		if (const auto Item = NodeItems[Index]; Item != BoundingVolumeHierarchy::NoItem)
+		{
+			// The shadow it used to cast has to go as well as the new one appear.
+			DirectX::BoundingBox MovedBounds;
+			DirectX::BoundingBox::CreateMerged(MovedBounds, SpatialIndex.GetItemBounds(Item), Hierarchy->GetWorldBounds(Index));
+			Shadows.AddMovedBounds(MovedBounds);
+			Sun.AddMovedBounds(MovedBounds);
+			Probes.AddMovedBounds(MovedBounds);
+			Volume.AddMovedBounds(MovedBounds);
+
+			SpatialIndex.UpdateItem(Item, Hierarchy->GetWorldBounds(Index));
+		}
 	}
 
-	if (Material.GetTexture(aiTextureType_SPECULAR, 0, &TextureFileName) == aiReturn_SUCCESS)
+	// Skinned meshes are posed by bones anywhere in the hierarchy, not only by the node they hang off.
+	if (bArePalettesStale || !Hierarchy->GetUpdatedNodes().empty())
 	{
-		Bindables.push_back(Texture::Resolve(InGraphics, RootPath + TextureFileName.C_Str(), 2));
-		bHasSpecularMap = true;
+		for (const auto& [Node, MeshIndex] : SkinnedMeshes)
+		{
+			Meshes[MeshIndex]->UpdateSkin(InGraphics, *Hierarchy, Hierarchy->GetWorldTransform(Node));
+			// A new pose casts another shadow even where the node itself stayed put.
+			Shadows.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+			Sun.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+			Probes.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+			Volume.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+		}
+
+		bArePalettesStale = false;
 	}
-	else
+
+	for (const auto& [Node, MeshIndex] : MorphedMeshes)
 	{
-		Material.Get(AI_MATKEY_SHININESS, Shininess);
+		// Reshaped meshes cast other shadows too.
+		if (Meshes[MeshIndex]->UpdateMorphWeights(InGraphics))
+		{
+			Shadows.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+			Sun.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+			Probes.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+			Volume.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+		}
 	}
 
-	if (bHasDiffuseMap || bHasNormalMap || bHasSpecularMap)
+	// Baked animations play on whenever a frame is drawn, nothing on the CPU tells when their shadows changed.
+	for (const auto& [Node, MeshIndex] : VertexAnimatedMeshes)
 	{
-		Bindables.push_back(Sampler::Resolve(InGraphics));
+		Shadows.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+		Sun.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+		Probes.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
+		Volume.AddMovedBounds(Hierarchy->GetWorldBounds(Node));
 	}
 
-	const auto MeshTag {RootPath + "$" + InMesh.mName.C_Str()};
-	constexpr float Scale {1.0f};
+	SpatialIndex.Refit();
 
-	if (bHasDiffuseMap && bHasNormalMap && bHasSpecularMap)
+	// The view space frustum of the projection, moved into world space by the inverse view.
+	DirectX::BoundingFrustum Frustum(InGraphics.GetProjectionMatrix());
+	Frustum.Transform(Frustum, DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewMatrix()));
+
+	// A multi-view frame draws what any of its views sees.
+	const auto IsInAnyView = [&InGraphics, &Frustum](const DirectX::BoundingSphere& InSphere)
 	{
-		DV::VertexBuffer ModelVertexBuffer
+		const auto ViewFrustums = InGraphics.GetViewFrustums();
+
+		return InGraphics.IsMultiView() ? std::any_of(ViewFrustums.begin(), ViewFrustums.end(), [&InSphere](const DirectX::BoundingFrustum& InView)
 		{
-			{
-				DV::VertexLayout::ElementType::Position3D,
-				DV::VertexLayout::ElementType::Normal,
-				DV::VertexLayout::ElementType::Tangent,
-				DV::VertexLayout::ElementType::Bitangent,
-				DV::VertexLayout::ElementType::Texture2D
-			}
-		};
+			return InView.Intersects(InSphere);
+		}) : Frustum.Intersects(InSphere);
+	};
+
+	LastCullingStatistics = {};
+	const auto ForcedLod = Window ? Window->GetForcedLod() : Mesh::AutomaticLod;
+	float ImpostorFade = 0.0f;
+	bool bIsBakingImpostor = false;
+
+	// An edited model keeps its meshes, its window may force a level of detail.
+	if (auto& Baker = InGraphics.GetImpostorBaker(); Baker.IsEnabled() && ForcedLod == Mesh::AutomaticLod && !SpatialIndex.IsEmpty())
+	{
+		DirectX::BoundingSphere WorldSphere;
+		DirectX::BoundingSphere::CreateFromBoundingBox(WorldSphere, SpatialIndex.GetBounds());
+
+		const auto ViewCenter = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&WorldSphere.Center), InGraphics.GetViewMatrix());
+		const auto Distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(ViewCenter)) - WorldSphere.Radius;
 
-		for (unsigned int VertexIndex = 0; VertexIndex < InMesh.mNumVertices; ++VertexIndex)
+		if (Distance > 0.0f)
 		{
-			ModelVertexBuffer.Emplace
-			(
-				DirectX::XMFLOAT3
-				{
-					InMesh.mVertices[VertexIndex].x * Scale,
-					InMesh.mVertices[VertexIndex].y * Scale,
-					InMesh.mVertices[VertexIndex].z * Scale,
-				},
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mNormals[VertexIndex]),
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mTangents[VertexIndex]),
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mBitangents[VertexIndex]),
-				*reinterpret_cast<DirectX::XMFLOAT2*>(&InMesh.mTextureCoords[0][VertexIndex])
-			);
+			const auto DrawnHeight = DirectX::XMVectorGetY(InGraphics.GetProjectionMatrix().r[1]) * InGraphics.GetViewport().Height * WorldSphere.Radius / Distance;
+			constexpr auto CellSize = static_cast<float>(ImpostorAtlas::CellSize);
+			ImpostorFade = std::clamp((ImpostorFadeStart * CellSize - DrawnHeight) / ((ImpostorFadeStart - 1.0f) * CellSize), 0.0f, 1.0f);
 		}
 
-		std::vector<unsigned int> Indices;
-		Indices.reserve(InMesh.mNumFaces * 3);
-		for (unsigned int FaceIndex = 0; FaceIndex < InMesh.mNumFaces; ++FaceIndex)
+		if (ImpostorFade > 0.0f)
 		{
-			const auto& Face = InMesh.mFaces[FaceIndex];
-			assert(Face.mNumIndices == 3);
+			const auto& Atlas = Asset->GetImpostor(InGraphics);
+			// Baked before the opaque passes, so the impostor already shows in the frame that asked for it.
+			bIsBakingImpostor = !Atlas->IsBaked() && Baker.RequestBake(Atlas, DirectX::XMLoadFloat4x4(&RootTransform), SpatialIndex.GetBounds());
 
-			for (unsigned int Index = 0; Index < Face.mNumIndices; ++Index)
+			if (Atlas->IsBaked() || bIsBakingImpostor)
 			{
-				Indices.push_back(Face.mIndices[Index]);
+				if (!MyImpostor || MyImpostor->GetAtlas() != Atlas)
+				{
+					MyImpostor = std::make_unique<Impostor>(InGraphics, Atlas);
+				}
+
+				if (IsInAnyView(WorldSphere))
+				{
+					MyImpostor->SetTransform(DirectX::XMLoadFloat4x4(&RootTransform), ImpostorFade);
+					MyImpostor->Submit(InGraphics);
+					LastCullingStatistics.DrawnTriangleNum += 2u;
+					LastCullingStatistics.bIsImpostorDrawn = true;
+				}
+			}
+			else
+			{
+				// Another model bakes this frame, this one stays on its meshes until its own turn.
+				ImpostorFade = 0.0f;
 			}
 		}
+	}
 
-		Bindables.push_back(VertexBuffer::Resolve(InGraphics, MeshTag, ModelVertexBuffer));
-		Bindables.push_back(IndexBuffer::Resolve(InGraphics, MeshTag, Indices));
-
-		auto ModelVertexShader = VertexShader::Resolve(InGraphics, "DiffuseNormalPhongVS.cso");
-		auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
-		Bindables.push_back(std::move(ModelVertexShader));
-
-		Bindables.push_back(PixelShader::Resolve(InGraphics, "DiffuseNormalSpecularPhongPS.cso"));
-
-		struct PSDiffuseNormalSpecularConstants
+	if (ImpostorFade < 1.0f)
+	{
+		FrameVector<unsigned int> VisibleItems;
+		const auto AddItem = [&VisibleItems](const unsigned int InItem)
 		{
-			BOOL bIsNormalMapEnabled {TRUE};
-			float Padding[3];
-		} DiffuseNormalSpecularConstants;
-
-		Bindables.push_back(PixelConstantBuffer<PSDiffuseNormalSpecularConstants>::Resolve(InGraphics, DiffuseNormalSpecularConstants, 1u));
+			VisibleItems.push_back(InItem);
+		};
 
-		struct PSCameraConstants
+		// One walk for every view, the render queue then tells which views each draw reaches.
+		if (InGraphics.IsMultiView())
+		{
+			SpatialIndex.QueryFrustums(InGraphics.GetViewFrustums(), AddItem);
+		}
+		else
 		{
-			alignas(16) DirectX::XMFLOAT3 Position;
-		} CameraConstants;
-		CameraConstants.Position = InGraphics.GetCamera().GetPosition();
+			SpatialIndex.QueryFrustum(Frustum, AddItem);
+		}
 
-		Bindables.push_back(PixelConstantBuffer<PSCameraConstants>::Resolve(InGraphics, CameraConstants, 2u));
+		// Levels of detail, sort keys and the culling candidates are made per mesh, as jobs over batches of the visible nodes
+		// once there are enough of them. Each job appends to its own thread's draw list.
+		std::atomic<unsigned int> DrawnMeshNum {0u};
+		std::atomic<unsigned int> DrawnTriangleNum {0u};
 
-		Bindables.push_back(InputLayout::Resolve(InGraphics, ModelVertexBuffer.GetLayout(), ModelVertexShaderBlob));
-	}
-	else if (bHasDiffuseMap && bHasNormalMap)
-	{
-		DV::VertexBuffer ModelVertexBuffer
+		const auto SubmitBatch = [&](const size_t InBatch)
 		{
+			unsigned int BatchMeshNum = 0u;
+			unsigned int BatchTriangleNum = 0u;
+
+			for (auto Visible = InBatch * SubmitBatchSize, Last = std::min(Visible + SubmitBatchSize, VisibleItems.size()); Visible < Last; ++Visible)
 			{
-				DV::VertexLayout::ElementType::Position3D,
-				DV::VertexLayout::ElementType::Normal,
-				DV::VertexLayout::ElementType::Tangent,
-				DV::VertexLayout::ElementType::Bitangent,
-				DV::VertexLayout::ElementType::Texture2D
+				const auto Index = IndexedNodes[VisibleItems[Visible]];
+				const auto WorldTransform = Hierarchy->GetWorldTransform(Index);
+
+				for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
+				{
+					Meshes[MeshIndex]->Submit(InGraphics, WorldTransform, ForcedLod, GetSceneIndex(Index));
+					++BatchMeshNum;
+					BatchTriangleNum += Meshes[MeshIndex]->GetIndexCount() / 3u;
+				}
 			}
+
+			DrawnMeshNum.fetch_add(BatchMeshNum, std::memory_order_relaxed);
+			DrawnTriangleNum.fetch_add(BatchTriangleNum, std::memory_order_relaxed);
 		};
 
-		for (unsigned int VertexIndex = 0; VertexIndex < InMesh.mNumVertices; ++VertexIndex)
+		const auto BatchNum = (VisibleItems.size() + SubmitBatchSize - 1u) / SubmitBatchSize;
+
+		if (BatchNum > 1u)
 		{
-			ModelVertexBuffer.Emplace
-			(
-				DirectX::XMFLOAT3
-				{
-					InMesh.mVertices[VertexIndex].x * Scale,
-					InMesh.mVertices[VertexIndex].y * Scale,
-					InMesh.mVertices[VertexIndex].z * Scale,
-				},
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mNormals[VertexIndex]),
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mTangents[VertexIndex]),
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mBitangents[VertexIndex]),
-				*reinterpret_cast<DirectX::XMFLOAT2*>(&InMesh.mTextureCoords[0][VertexIndex])
-			);
+			JobSystem::Get().ParallelFor(BatchNum, 1u, SubmitBatch);
 		}
-
-		std::vector<unsigned int> Indices;
-		Indices.reserve(InMesh.mNumFaces * 3);
-		for (unsigned int FaceIndex = 0; FaceIndex < InMesh.mNumFaces; ++FaceIndex)
+		else if (BatchNum == 1u)
 		{
-			const auto& Face = InMesh.mFaces[FaceIndex];
-			assert(Face.mNumIndices == 3);
+			SubmitBatch(0u);
+		}
 
-			for (unsigned int Index = 0; Index < Face.mNumIndices; ++Index)
+		LastCullingStatistics.DrawnMeshNum += DrawnMeshNum.load(std::memory_order_relaxed);
+		LastCullingStatistics.DrawnTriangleNum += DrawnTriangleNum.load(std::memory_order_relaxed);
+	}
+
+	// After the regular submits, whose levels of detail would replace the finest one the bake draws.
+	if (bIsBakingImpostor)
+	{
+		for (const auto Index : IndexedNodes)
+		{
+			for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
 			{
-				Indices.push_back(Face.mIndices[Index]);
+				Meshes[MeshIndex]->SubmitImpostorBake(InGraphics, Hierarchy->GetWorldTransform(Index), GetSceneIndex(Index));
 			}
 		}
+	}
 
-		Bindables.push_back(VertexBuffer::Resolve(InGraphics, MeshTag, ModelVertexBuffer));
+	LastCullingStatistics.CulledMeshNum = IndexedMeshNum - LastCullingStatistics.DrawnMeshNum;
+}
 
-		Bindables.push_back(IndexBuffer::Resolve(InGraphics, MeshTag, Indices));
+void ModelInstance::SubmitShadowCasters(const Graphics& InGraphics) const
+{
+	PROFILE_SCOPE("ModelInstance::SubmitShadowCasters");
 
-		auto ModelVertexShader = VertexShader::Resolve(InGraphics, "DiffuseNormalPhongVS.cso");
-		auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
-		Bindables.push_back(std::move(ModelVertexShader));
+	if (!IsReady())
+	{
+		return;
+	}
 
-		Bindables.push_back(PixelShader::Resolve(InGraphics, "DiffuseNormalPhongPS.cso"));
+	const auto& Shadows = InGraphics.GetPointLightShadows();
 
-		struct PSDiffuseNormalConstants
+	for (unsigned int ShadowIndex = 0u; ShadowIndex < Shadows.GetLightNum(); ++ShadowIndex)
+	{
+		// Cached faces are not drawn again, so their casters are not needed either.
+		if (!Shadows.IsUpdatePending(ShadowIndex))
 		{
-			float SpecularIntensity {0.18f};
-			float SpecularPower;
-			BOOL bIsNormalMapEnabled {TRUE};
-			float Padding[1];
-		} DiffuseNormalConstants;
-		DiffuseNormalConstants.SpecularPower = Shininess;
-
-		Bindables.push_back(PixelConstantBuffer<PSDiffuseNormalConstants>::Resolve(InGraphics, DiffuseNormalConstants, 1u));
+			continue;
+		}
 
-		struct PSCameraConstants
+		SpatialIndex.QuerySphere(Shadows.GetLightBounds(ShadowIndex), [&](const unsigned int InItem)
 		{
-			alignas(16) DirectX::XMFLOAT3 Position;
-		} CameraConstants;
+			const auto Index = IndexedNodes[InItem];
+			const auto WorldTransform = Hierarchy->GetWorldTransform(Index);
 
-		CameraConstants.Position = InGraphics.GetCamera().GetPosition();
-		Bindables.push_back(PixelConstantBuffer<PSCameraConstants>::Resolve(InGraphics, CameraConstants, 2u));
-
-		Bindables.push_back(InputLayout::Resolve(InGraphics, ModelVertexBuffer.GetLayout(), ModelVertexShaderBlob));
-	}
-	else if (bHasDiffuseMap)
-	{
-		DV::VertexBuffer ModelVertexBuffer
-		{
+			for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
 			{
-				DV::VertexLayout::ElementType::Position3D,
-				DV::VertexLayout::ElementType::Normal,
-				DV::VertexLayout::ElementType::Texture2D
+				Meshes[MeshIndex]->SubmitShadowCaster(InGraphics, ShadowIndex, WorldTransform, GetSceneIndex(Index));
 			}
-		};
+		});
+	}
 
-		for (unsigned int VertexIndex = 0; VertexIndex < InMesh.mNumVertices; ++VertexIndex)
+	const auto& Sun = InGraphics.GetDirectionalLight();
+
+	for (UINT Cascade = 0u; Cascade < DirectionalLight::CascadeNum; ++Cascade)
+	{
+		if (!Sun.IsUpdatePending(Cascade))
 		{
-			ModelVertexBuffer.Emplace
-			(
-				DirectX::XMFLOAT3
-				{
-					InMesh.mVertices[VertexIndex].x * Scale,
-					InMesh.mVertices[VertexIndex].y * Scale,
-					InMesh.mVertices[VertexIndex].z * Scale,
-				},
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mNormals[VertexIndex]),
-				*reinterpret_cast<DirectX::XMFLOAT2*>(&InMesh.mTextureCoords[0][VertexIndex])
-			);
+			continue;
 		}
 
-		std::vector<unsigned int> Indices;
-		Indices.reserve(InMesh.mNumFaces * 3);
-		for (unsigned int FaceIndex = 0; FaceIndex < InMesh.mNumFaces; ++FaceIndex)
+		SpatialIndex.QuerySphere(Sun.GetCasterBounds(Cascade), [&](const unsigned int InItem)
 		{
-			const auto& Face = InMesh.mFaces[FaceIndex];
-			assert(Face.mNumIndices == 3);
+			const auto Index = IndexedNodes[InItem];
+			const auto WorldTransform = Hierarchy->GetWorldTransform(Index);
 
-			for (unsigned int Index = 0; Index < Face.mNumIndices; ++Index)
+			for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
 			{
-				Indices.push_back(Face.mIndices[Index]);
+				Meshes[MeshIndex]->SubmitSunCaster(InGraphics, Cascade, WorldTransform, GetSceneIndex(Index));
 			}
-		}
-
-		Bindables.push_back(VertexBuffer::Resolve(InGraphics, MeshTag, ModelVertexBuffer));
-		Bindables.push_back(IndexBuffer::Resolve(InGraphics, MeshTag, Indices));
-
-		auto ModelVertexShader = VertexShader::Resolve(InGraphics, "DiffusePhongVS.cso");
-		auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
-		Bindables.push_back(std::move(ModelVertexShader));
-
-		Bindables.push_back(PixelShader::Resolve(InGraphics, "DiffusePhongPS.cso"));
-
-		struct PSDiffuseMaterialConstants
-		{
-			float SpecularIntensity {0.01f};
-			float SpecularPower;
-			float Padding[2];
-		} DiffuseMaterialConstants;
-		DiffuseMaterialConstants.SpecularPower = Shininess;
+		});
+	}
+}
 
-		Bindables.push_back(PixelConstantBuffer<PSDiffuseMaterialConstants>::Resolve(InGraphics, DiffuseMaterialConstants, 1u));
+void ModelInstance::SubmitReflectionCaptures(const Graphics& InGraphics) const
+{
+	PROFILE_SCOPE("ModelInstance::SubmitReflectionCaptures");
 
-		struct PSCameraConstants
-		{
-			alignas(16) DirectX::XMFLOAT3 Position;
-		} CameraConstants;
+	if (!IsReady())
+	{
+		return;
+	}
 
-		CameraConstants.Position = InGraphics.GetCamera().GetPosition();
-		Bindables.push_back(PixelConstantBuffer<PSCameraConstants>::Resolve(InGraphics, CameraConstants, 2u));
+	const auto* const Frustum = InGraphics.GetReflectionProbes().GetCaptureFrustum();
 
-		Bindables.push_back(InputLayout::Resolve(InGraphics, ModelVertexBuffer.GetLayout(), ModelVertexShaderBlob));
+	if (!Frustum)
+	{
+		return;
 	}
-	else if (!bHasDiffuseMap && !bHasNormalMap && !bHasSpecularMap)
+
+	SpatialIndex.QueryFrustum(*Frustum, [&](const unsigned int InItem)
 	{
-		DV::VertexBuffer ModelVertexBuffer
-		{
-			{
-				DV::VertexLayout::ElementType::Position3D,
-				DV::VertexLayout::ElementType::Normal,
-			}
-		};
+		const auto Index = IndexedNodes[InItem];
+		const auto WorldTransform = Hierarchy->GetWorldTransform(Index);
 
-		for (unsigned int VertexIndex = 0; VertexIndex < InMesh.mNumVertices; ++VertexIndex)
+		for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
 		{
-			ModelVertexBuffer.Emplace
-			(
-				DirectX::XMFLOAT3
-				{
-					InMesh.mVertices[VertexIndex].x * Scale,
-					InMesh.mVertices[VertexIndex].y * Scale,
-					InMesh.mVertices[VertexIndex].z * Scale,
-				},
-				*reinterpret_cast<DirectX::XMFLOAT3*>(&InMesh.mNormals[VertexIndex])
-			);
+			Meshes[MeshIndex]->SubmitReflectionCapture(InGraphics, WorldTransform, GetSceneIndex(Index));
 		}
+	});
+}
 
-		std::vector<unsigned int> Indices;
-		Indices.reserve(InMesh.mNumFaces * 3);
-		for (unsigned int FaceIndex = 0; FaceIndex < InMesh.mNumFaces; ++FaceIndex)
-		{
-			const auto& Face = InMesh.mFaces[FaceIndex];
-			assert(Face.mNumIndices == 3);
+void ModelInstance::SubmitIrradianceCaptures(const Graphics& InGraphics) const
+{
+	PROFILE_SCOPE("ModelInstance::SubmitIrradianceCaptures");
 
-			for (unsigned int Index = 0; Index < Face.mNumIndices; ++Index)
-			{
-				Indices.push_back(Face.mIndices[Index]);
-			}
-		}
+	if (!IsReady())
+	{
+		return;
+	}
 
-		Bindables.push_back(VertexBuffer::Resolve(InGraphics, MeshTag, ModelVertexBuffer));
-		Bindables.push_back(IndexBuffer::Resolve(InGraphics, MeshTag, Indices));
+	const auto* const Sphere = InGraphics.GetIrradianceVolume().GetCaptureSphere();
 
-		auto ModelVertexShader = VertexShader::Resolve(InGraphics, "PhongVS.cso");
-		auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
-		Bindables.push_back(std::move(ModelVertexShader));
+	if (!Sphere)
+	{
+		return;
+	}
 
-		Bindables.push_back(PixelShader::Resolve(InGraphics, "PhongPS.cso"));
+	SpatialIndex.QuerySphere(*Sphere, [&](const unsigned int InItem)
+	{
+		const auto Index = IndexedNodes[InItem];
+		const auto WorldTransform = Hierarchy->GetWorldTransform(Index);
 
-		struct PSConstants
+		for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
 		{
-			DirectX::XMFLOAT4 MaterialColor {0.65f, 0.65f, 0.85f, 1.0f};
-			float SpecularIntensity {0.18f};
-			float SpecularPower;
-			float Padding[2];
-		} MaterialConstants;
-		MaterialConstants.SpecularPower = Shininess;
+			Meshes[MeshIndex]->SubmitIrradianceCapture(InGraphics, WorldTransform, GetSceneIndex(Index));
+		}
+	});
+}
 
-		Bindables.push_back(PixelConstantBuffer<PSConstants>::Resolve(InGraphics, MaterialConstants, 1u));
+void ModelInstance::DrawBounds(const Graphics& InGraphics) const
+{
+	if (!IsReady())
+	{
+		return;
+	}
+
+	auto& Lines = InGraphics.GetDebugDraw();
 
-		struct PSCameraConstants
+	SpatialIndex.VisitNodes([&Lines](const DirectX::BoundingBox& InBounds, const bool bInIsLeaf)
+	{
+		if (!bInIsLeaf)
 		{
-			alignas(16) DirectX::XMFLOAT3 Position;
-		} CameraConstants;
+			Lines.Box(InBounds, {0.2f, 0.3f, 0.8f, 1.0f});
+		}
+	});
 
-		CameraConstants.Position = InGraphics.GetCamera().GetPosition();
-		Bindables.push_back(PixelConstantBuffer<PSCameraConstants>::Resolve(InGraphics, CameraConstants, 2u));
+	// The same frustum Submit tested against.
+	DirectX::BoundingFrustum Frustum(InGraphics.GetProjectionMatrix());
+	Frustum.Transform(Frustum, DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewMatrix()));
 
-		Bindables.push_back(InputLayout::Resolve(InGraphics, ModelVertexBuffer.GetLayout(), ModelVertexShaderBlob));
+	for (unsigned int Item = 0u; Item < IndexedNodes.size(); ++Item)
+	{
+		const auto& Bounds = SpatialIndex.GetItemBounds(Item);
+		const bool bIsInside = Frustum.Contains(Bounds) != DirectX::DISJOINT;
+		Lines.Box(Bounds, bIsInside ? DirectX::XMFLOAT4 {0.1f, 0.9f, 0.2f, 1.0f} : DirectX::XMFLOAT4 {0.9f, 0.1f, 0.1f, 1.0f});
 	}
-
-	return std::make_unique<Mesh>(InGraphics, std::move(Bindables));
 }
 
-std::unique_ptr<Node> Model::ParseNode(int& InNextID, const aiNode& InNode)
+void ModelInstance::SubmitPickCandidates(const Graphics& InGraphics) const
 {
-	const auto NodeTransformMatrix = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(reinterpret_cast<const DirectX::XMFLOAT4X4*>(&InNode.mTransformation)));
+	if (!IsReady())
+	{
+		return;
+	}
 
-	std::vector<Mesh*> NodeMeshes;
-	NodeMeshes.reserve(InNode.mNumMeshes);
+	const auto* const Frustum = InGraphics.GetObjectPicker().GetPickFrustum();
 
-	for (size_t NodeMeshIndex = 0; NodeMeshIndex < InNode.mNumMeshes; ++NodeMeshIndex)
+	if (!Frustum)
 	{
-		const auto ModelMeshIndex = InNode.mMeshes[NodeMeshIndex];
-		NodeMeshes.push_back(Meshes.at(ModelMeshIndex).get());
+		return;
 	}
 
-	auto NewNode = std::make_unique<Node>(InNextID++, InNode.mName.C_Str(), std::move(NodeMeshes), NodeTransformMatrix);
+	SpatialIndex.QueryFrustum(*Frustum, [&](const unsigned int InItem)
+	{
+		const auto Index = IndexedNodes[InItem];
+		const auto WorldTransform = Hierarchy->GetWorldTransform(Index);
+
+		for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
+		{
+			Meshes[MeshIndex]->SubmitPickCandidate(InGraphics, WorldTransform, this, Index, GetSceneIndex(Index));
+		}
+	});
+}
 
-	for (size_t ChildrenIndex = 0; ChildrenIndex < InNode.mNumChildren; ++ChildrenIndex)
+bool ModelInstance::IntersectRay(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, RayHit& InOutHit) const
+{
+	if (!IsReady())
 	{
-		NewNode->AddChild(ParseNode(InNextID, *InNode.mChildren[ChildrenIndex]));
+		return false;
 	}
 
-	return NewNode;
+	auto Distance = InOutHit.Distance;
+
+	const auto Item = SpatialIndex.QueryRay(InOrigin, InDirection, Distance, [&](const unsigned int InItem, float& InOutItemDistance)
+	{
+		const auto Index = IndexedNodes[InItem];
+
+		// Taken into the node's space unnormalized, the meshes' distances along it are the world's.
+		const auto WorldToNode = DirectX::XMMatrixInverse(nullptr, Hierarchy->GetWorldTransform(Index));
+		const auto Origin = DirectX::XMVector3TransformCoord(InOrigin, WorldToNode);
+		const auto Direction = DirectX::XMVector3TransformNormal(InDirection, WorldToNode);
+
+		TriangleBvh::Hit Closest;
+		Closest.Distance = Distance;
+		auto bIsHit = false;
+
+		for (const auto MeshIndex : Hierarchy->GetMeshIndices(Index))
+		{
+			if (const auto* const Triangles = Meshes[MeshIndex]->GetTriangles(); Triangles && Triangles->Intersect(Origin, Direction, Closest))
+			{
+				InOutHit = {Index, MeshIndex, Closest.Triangle, Closest.Distance};
+				bIsHit = true;
+			}
+		}
+
+		InOutItemDistance = Closest.Distance;
+		return bIsHit;
+	});
+
+	return Item != BoundingVolumeHierarchy::NoItem;
 }
 
-void Model::Draw(const Graphics& InGraphics) const
+void ModelInstance::SelectNode(const unsigned int InNodeIndex)
 {
-	if (auto* const SelectedNode = Window->GetSelectedNode())
+	if (IsReady() && InNodeIndex < Hierarchy->GetNodeNum())
 	{
-		SelectedNode->SetAppliedTransform(Window->GetTransformMatrix());
+		GetWindow().Select(InNodeIndex);
 	}
-
-	Root->Draw(InGraphics, DirectX::XMMatrixIdentity());
 }
 
-void Model::ShowWindow(const std::string_view InWindowName) const
+void ModelInstance::ShowWindow(const Graphics& InGraphics, const std::string_view InWindowName)
 {
-	Window->Show(InWindowName, *Root);
+	if (!IsReady())
+	{
+		const auto WindowName = !InWindowName.empty() ? InWindowName : "Model";
+
+		if (ImGui::Begin(WindowName.data()))
+		{
+			ImGui::ProgressBar(GetLoadProgress());
+		}
+
+		ImGui::End();
+		return;
+	}
+
+	if (auto& ShownWindow = GetWindow(); ShownWindow.Show(InWindowName, *Hierarchy))
+	{
+		Freeze(InGraphics, ShownWindow.GetSelectedNode());
+	}
 }
@@ -1,63 +1,663 @@
-#pragma once
+﻿#pragma once
+#include <DirectXCollision.h>
 #include <filesystem>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <span>
+#include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
+#include "AnimationClip.h"
+#include "BoundingVolumeHierarchy.h"
 #include "Drawable.h"
+#include "MeshCache.h"
+#include "MorphTargets.h"
+#include "OcclusionPredication.h"
+#include "Sampler.h"
+#include "StringAtom.h"
+#include "TextureCooker.h"
 
-struct aiMaterial;
-struct aiMesh;
-struct aiNode;
+class BonePalette;
 class Graphics;
+class Impostor;
+class ImpostorAtlas;
+class Material;
+class NodeHierarchy;
 class ModelWindow;
+class SolidSphere;
+class VertexAnimation;
+template<typename T>
+class VertexConstantBuffer;
 
 class Mesh : public Drawable
 {
 public:
-	Mesh(const Graphics& InGraphics, std::vector<std::shared_ptr<Bindable>>&& InBindables);
-	void Draw(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform) const;
+	static constexpr int AutomaticLod {-1};
+	// Import stops simplifying at this many levels, or earlier once a level barely removes anything.
+	static constexpr unsigned int MaxLodNum {4u};
+	// The coarsest level whose error projects to at most this many pixels is drawn, times Graphics::GetLodErrorScale.
+	static constexpr float MaxScreenError {1.0f};
+
+	// What an import builds once per mesh, every instance of the model creates its mesh from the same one.
+	struct Description
+	{
+		// The tag its buffers are shared under, what capture tools show its draws as.
+		std::string Name;
+		std::vector<std::shared_ptr<Bindable>> Bindables;
+		DirectX::BoundingBox Bounds;
+		std::vector<MeshCache::LodEntry> Lods;
+		// Of the finest level, null when the cache has none.
+		std::shared_ptr<const std::vector<MeshCache::MeshletEntry>> Meshlets;
+		// Of the finest level, null when the cache has none or the mesh has no triangle a ray could hit.
+		std::shared_ptr<const TriangleBvh> Triangles;
+		// Null unless the mesh is skinned, its bones then pose it from the hierarchy it is drawn with.
+		std::shared_ptr<const std::vector<MeshCache::BoneEntry>> Bones;
+		// Null unless the mesh has blend shapes, every instance weights them with constants of its own.
+		std::shared_ptr<MorphTargets> Morphs;
+		// Null unless the import baked the skinned mesh's animations, it is drawn without bones then, see VertexAnimation.
+		std::shared_ptr<VertexAnimation> BakedAnimation;
+		// Average mesh units one texture coordinate unit spans, zero without texture coordinates.
+		float UnitsPerTexcoord {0.0f};
+		// Null for skinned and morphed meshes, every one of them has its own palette or weights to draw with. Vertex animated ones have one.
+		std::shared_ptr<Bindable> InstancedVertexShader;
+	};
+
+	// Only the transform constants, the bone palette and the morph weights are its own, everything else is shared with the description.
+	Mesh(const Graphics& InGraphics, const Description& InDescription);
+
+	// Picks the level of detail from the projected size unless InForcedLod names one, occlusion candidates get the same range.
+	// Every submit takes the ID the owner keeps InAccumulatedTransform under in the GpuScene, if it keeps it there.
+	void Submit(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, int InForcedLod = AutomaticLod,
+	            unsigned int InSceneIndex = GpuScene::NoIndex) const;
+	// Hands the mesh to a shadowed light's cube, at the same world transform and level of detail the camera sees it with.
+	void SubmitShadowCaster(const Graphics& InGraphics, unsigned int InShadowIndex, const DirectX::XMMATRIX& InAccumulatedTransform,
+	                        unsigned int InSceneIndex = GpuScene::NoIndex) const;
+	// Hands the mesh to a sun cascade drawn this frame, the same way.
+	void SubmitSunCaster(const Graphics& InGraphics, unsigned int InCascade, const DirectX::XMMATRIX& InAccumulatedTransform,
+	                     unsigned int InSceneIndex = GpuScene::NoIndex) const;
+	// Hands the mesh to the reflection probe face drawn this frame, the same way.
+	void SubmitReflectionCapture(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, unsigned int InSceneIndex = GpuScene::NoIndex) const;
+	// Hands the mesh to the irradiance probes drawn this frame, the same way.
+	void SubmitIrradianceCapture(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, unsigned int InSceneIndex = GpuScene::NoIndex) const;
+	// Hands the mesh to this frame's pick, which reports InOwner and InItem when it is in front under the cursor.
+	void SubmitPickCandidate(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, const void* InOwner, unsigned int InItem,
+	                         unsigned int InSceneIndex = GpuScene::NoIndex) const;
+	// Hands the mesh to this frame's impostor bake at its finest level of detail, which a Submit in the same frame draws too.
+	void SubmitImpostorBake(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransform, unsigned int InSceneIndex = GpuScene::NoIndex) const;
 	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept override;
+	// Uploads the bones' current pose relative to the node the mesh hangs off, InMeshTransform is that node's world transform.
+	// On the main thread before the mesh is drawn, only for skinned meshes.
+	void UpdateSkin(const Graphics& InGraphics, const NodeHierarchy& InHierarchy, DirectX::FXMMATRIX InMeshTransform);
+	// Of the blend shape named InTarget, nothing happens when the mesh has none of that name. Zero leaves it out, one moves the
+	// vertices all the way, weights outside [0, 1] overshoot the bounds. Only for morphed meshes.
+	void SetMorphWeight(std::string_view InTarget, float InWeight) noexcept;
+	// Uploads the weights if any changed since the last call, on the main thread before the mesh is drawn. True when they did.
+	bool UpdateMorphWeights(const Graphics& InGraphics);
+
+	// Which baked clip the mesh plays and how far ahead, see VertexAnimation::Pack. Only for vertex animated meshes.
+	void SetPlayedAnimation(const UINT InAnimation) noexcept
+	{
+		PlayedAnimation = InAnimation;
+	}
+
+	[[nodiscard]] bool IsSkinned() const noexcept
+	{
+		return Bones != nullptr;
+	}
+
+	[[nodiscard]] bool IsMorphed() const noexcept
+	{
+		return Morphs != nullptr;
+	}
+
+	[[nodiscard]] bool IsVertexAnimated() const noexcept
+	{
+		return BakedAnimation != nullptr;
+	}
+
+	[[nodiscard]] UINT GetPlayedAnimation() const noexcept override
+	{
+		return PlayedAnimation;
+	}
+
+	[[nodiscard]] const DirectX::BoundingBox* GetLocalBounds() const noexcept override
+	{
+		return &Bounds;
+	}
+
+	[[nodiscard]] unsigned int GetSceneIndex() const noexcept override
+	{
+		return SceneIndex;
+	}
+
+	// Only the finest level is split into meshlets.
+	[[nodiscard]] std::span<const MeshOptimizer::Meshlet> GetMeshlets() const noexcept override;
+
+	[[nodiscard]] ID3D11Predicate* GetPredicate() const noexcept override
+	{
+		return DrawPredicate;
+	}
+
+	// In the space of the node the mesh hangs off.
+	[[nodiscard]] const DirectX::BoundingBox& GetBounds() const noexcept
+	{
+		return Bounds;
+	}
+
+	[[nodiscard]] unsigned int GetLod() const noexcept
+	{
+		return CurrentLod;
+	}
+
+	[[nodiscard]] unsigned int GetLodNum() const noexcept
+	{
+		return static_cast<unsigned int>(Lods.size());
+	}
+
+	// In the space of the node the mesh hangs off, null unless the mesh is static. Always the finest level, whichever is drawn.
+	[[nodiscard]] const TriangleBvh* GetTriangles() const noexcept
+	{
+		return Triangles.get();
+	}
+
+private:
+	// A coarser level is only taken once its error is this far below the limit, so a mesh near the switch distance doesn't flicker.
+	static constexpr float LodHysteresis {0.75f};
+
+	// How many pixels a mesh unit covers at the nearest point of the bounds, infinite with the camera inside them.
+	[[nodiscard]] float GetPixelsPerMeshUnit(const Graphics& InGraphics, DirectX::FXMMATRIX InAccumulatedTransform) const noexcept;
+	void SelectLod(float InPixelsPerMeshUnit, int InForcedLod) const noexcept;
+	void RequestTextureDetail(float InPixelsPerMeshUnit) const noexcept;
+	void ApplyLod(unsigned int InLod) const noexcept;
+	void Place(DirectX::FXMMATRIX InAccumulatedTransform, unsigned int InSceneIndex) const noexcept;
 
 private:
 	mutable DirectX::XMFLOAT4X4 TransformMatrix;
+	// Set along with the transform by every submit, so the two always belong to the same node.
+	mutable unsigned int SceneIndex {GpuScene::NoIndex};
+	DirectX::BoundingBox Bounds;
+	std::vector<MeshCache::LodEntry> Lods;
+	std::shared_ptr<const std::vector<MeshCache::MeshletEntry>> Meshlets;
+	std::shared_ptr<const TriangleBvh> Triangles;
+	std::shared_ptr<const std::vector<MeshCache::BoneEntry>> Bones;
+	std::shared_ptr<BonePalette> MyBonePalette;
+	std::vector<DirectX::XMFLOAT4X4> BoneTransforms;
+	std::shared_ptr<MorphTargets> Morphs;
+	std::shared_ptr<VertexConstantBuffer<MorphTargets::Weights>> MyMorphWeights;
+	MorphTargets::Weights MorphWeights {};
+	// Set by every weight change and by the constructor, the buffer is created without contents.
+	bool bAreMorphWeightsStale {true};
+	std::shared_ptr<VertexAnimation> BakedAnimation;
+	UINT PlayedAnimation {0u};
+	mutable unsigned int CurrentLod {0u};
+	// Heavy meshes are drawn under last frame's occlusion predicate, set by every submit and null when there's none.
+	mutable OcclusionPredication::History PredicationHistory;
+	mutable ID3D11Predicate* DrawPredicate {nullptr};
+	// Where the last opaque submit placed the mesh, which motion vectors reproject from. The other submits place it too.
+	mutable DirectX::XMFLOAT4X4 SubmittedTransform {};
+	mutable bool bHasSubmitted {false};
+	// Null for meshes drawn without one, streamed maps are refined through it.
+	const Material* MyMaterial {nullptr};
+	// Average mesh units one texture coordinate unit spans, zero without texture coordinates.
+	float UnitsPerTexcoord;
 };
 
-class Node
+/**
+ * Model nodes stored as parallel arrays in depth-first order.
+ * Parents always precede their children and every subtree is a contiguous range, so world transforms are
+ * updated in one linear pass that only touches subtrees whose local transform changed.
+ * What the import decided is a Structure shared by every instance, only the transforms are per hierarchy.
+ */
+class NodeHierarchy
 {
-	friend class Model;
-
 public:
-	Node(int InID, std::string_view InName, std::vector<Mesh*>&& InMeshes, const DirectX::XMMATRIX& InTransformMatrix);
-	void Draw(const Graphics& InGraphics, const DirectX::XMMATRIX& InAccumulatedTransformMatrix) const;
-	void SetAppliedTransform(DirectX::FXMMATRIX InTransform);
-	void ShowTree(const Node** InSelectedNode) const;
-	[[nodiscard]] int GetID() const noexcept;
+	static constexpr unsigned int NoParent {~0u};
+
+	struct Structure
+	{
+		Structure(const MeshCache::NodeList& InNodes, std::span<const DirectX::BoundingBox> InMeshBounds);
+
+		// Interned, instances of one model and the files sharing node names share the strings too.
+		std::vector<StringAtom> Names;
+		std::vector<unsigned int> Parents;
+		std::vector<unsigned int> SubtreeEnds;
+		// Mesh indices of node N are MeshIndices[MeshOffsets[N], MeshOffsets[N + 1]).
+		std::vector<unsigned int> MeshOffsets;
+		std::vector<unsigned int> MeshIndices;
+		std::vector<DirectX::XMFLOAT4X4A> BaseTransforms;
+		// Own meshes in node space, negative extents when it has none.
+		std::vector<DirectX::BoundingBox> NodeBounds;
+	};
+
+	explicit NodeHierarchy(std::shared_ptr<const Structure> InStructure);
+
+	// Applied on top of the imported transform, the subtree picks it up on the next UpdateWorldTransforms.
+	void SetAppliedTransform(unsigned int InIndex, DirectX::FXMMATRIX InTransform) noexcept;
+	// Replaces the local transform with a pose sampled from an animation, which gives it in full.
+	void SetAnimatedTransform(unsigned int InIndex, DirectX::FXMMATRIX InTransform) noexcept;
+	// Takes over what is applied to a hierarchy over the same nodes, such as one of the same file imported with other options.
+	void CopyAppliedTransforms(const NodeHierarchy& InOther) noexcept;
+	// Places the whole hierarchy, on top of whatever is applied to the root.
+	void SetRootTransform(DirectX::FXMMATRIX InTransform) noexcept;
+	// World bounds are refreshed along with the transforms, GetUpdatedNodes lists every node that moved and GetChangedNodes
+	// those of them whose own local transform or placement changed.
+	void UpdateWorldTransforms() noexcept;
+
+	[[nodiscard]] unsigned int GetNodeNum() const noexcept
+	{
+		return static_cast<unsigned int>(MyStructure->Names.size());
+	}
+
+	// One past the last descendant of the node.
+	[[nodiscard]] unsigned int GetSubtreeEnd(const unsigned int InIndex) const noexcept
+	{
+		return MyStructure->SubtreeEnds[InIndex];
+	}
+
+	[[nodiscard]] std::string_view GetName(const unsigned int InIndex) const noexcept
+	{
+		return MyStructure->Names[InIndex].GetString();
+	}
+
+	// For comparing names without reading them.
+	[[nodiscard]] StringAtom GetNameAtom(const unsigned int InIndex) const noexcept
+	{
+		return MyStructure->Names[InIndex];
+	}
+
+	// NoParent for top level nodes.
+	[[nodiscard]] unsigned int GetParent(const unsigned int InIndex) const noexcept
+	{
+		return MyStructure->Parents[InIndex];
+	}
+
+	[[nodiscard]] std::span<const unsigned int> GetMeshIndices(const unsigned int InIndex) const noexcept
+	{
+		const auto* const Indices = MyStructure->MeshIndices.data();
+		return {Indices + MyStructure->MeshOffsets[InIndex], Indices + MyStructure->MeshOffsets[InIndex + 1u]};
+	}
+
+	[[nodiscard]] std::span<const unsigned int> GetParents() const noexcept
+	{
+		return MyStructure->Parents;
+	}
+
+	[[nodiscard]] DirectX::XMMATRIX GetWorldTransform(const unsigned int InIndex) const noexcept
+	{
+		return DirectX::XMLoadFloat4x4A(&WorldTransforms[InIndex]);
+	}
+
+	// Relative to the parent, top level nodes get the root transform on top of it.
+	[[nodiscard]] DirectX::XMMATRIX GetPlacedLocalTransform(const unsigned int InIndex) const noexcept
+	{
+		const auto Local = DirectX::XMLoadFloat4x4A(&LocalTransforms[InIndex]);
+		return GetParent(InIndex) != NoParent ? Local : DirectX::XMMatrixMultiply(Local, DirectX::XMLoadFloat4x4A(&RootTransform));
+	}
+
+	// World space box around the node's own meshes, negative extents when it has none.
+	[[nodiscard]] const DirectX::BoundingBox& GetWorldBounds(const unsigned int InIndex) const noexcept
+	{
+		return WorldBounds[InIndex];
+	}
+
+	[[nodiscard]] std::span<const unsigned int> GetUpdatedNodes() const noexcept
+	{
+		return UpdatedNodes;
+	}
+
+	[[nodiscard]] std::span<const unsigned int> GetChangedNodes() const noexcept
+	{
+		return ChangedNodes;
+	}
 
 private:
-	void AddChild(std::unique_ptr<Node>&& InNode);
+	std::shared_ptr<const Structure> MyStructure;
+	DirectX::XMFLOAT4X4A RootTransform;
+	std::vector<DirectX::XMFLOAT4X4A> LocalTransforms;
+	std::vector<DirectX::XMFLOAT4X4A> WorldTransforms;
+	std::vector<unsigned char> DirtyFlags;
+	std::vector<DirectX::BoundingBox> WorldBounds;
+	std::vector<unsigned int> UpdatedNodes;
+	std::vector<unsigned int> ChangedNodes;
+};
+
+/**
+ * Everything imported from a model file that doesn't change per placement: the meshes' geometry and materials and
+ * the node structure. Immutable once built and shared by every ModelInstance of the file, so placing a model again
+ * costs its transforms instead of another import.
+ */
+class ModelAsset
+{
+public:
+	// Applied to the materials of that name, for what the source format can't say, like glass exported fully opaque.
+	struct MaterialOverride
+	{
+		std::string MaterialName;
+		float Opacity {1.0f};
+		bool bIsTwoSided {false};
+	};
+
+	struct ImportOptions
+	{
+		// Maps of the same kind, size and format become slices of one texture array, so materials stop switching textures.
+		// Arrays are resident in full, the maps are not streamed.
+		bool bPacksTextureArrays {false};
+		// Maps are block compressed into a ".dds" beside them first, unless a current one is already there.
+		bool bCooksTextures {false};
+		// How the model's materials sample their maps.
+		Sampler::Description MaterialSampling;
+		std::vector<MaterialOverride> MaterialOverrides;
+		// Roots of subtrees that never move apart, every node of the name. Their meshes are baked into the root's space and merged
+		// per material into one vertex and index range, the nodes below keep their names but no meshes, so only the root can still move.
+		std::vector<std::string> StaticNodes;
+		// Skinned meshes of a model with animations bake every clip into a VertexAnimation, and are drawn instanced without bones from then
+		// on. Instances pick a clip with ModelInstance::PlayVertexAnimation, playing it costs the CPU nothing.
+		bool bBakesVertexAnimation {false};
+		// Counted up by hot reload for every import of a changed file, which then creates buffers of its own instead of finding
+		// those of the import it replaces.
+		unsigned int Revision {0u};
+	};
+
+	// What ParseMesh bakes a skinned mesh's vertex animation from.
+	struct AnimationBake
+	{
+		std::span<const AnimationClip> Clips;
+		// The imported pose, clips are sampled on copies of it.
+		const NodeHierarchy* BindPose;
+		// The first node the mesh hangs off.
+		unsigned int MeshNode;
+	};
+
+	// A map of the model and what it is cooked as.
+	struct CookedMap
+	{
+		std::string FileName;
+		TextureCooker::Usage Usage;
+	};
+
+	// Per map file with its full path, the files of the array it was packed into.
+	struct TexturePacking
+	{
+		std::unordered_map<std::string, std::vector<std::string>> DiffuseArrays;
+		std::unordered_map<std::string, std::vector<std::string>> NormalArrays;
+		std::unordered_map<std::string, std::vector<std::string>> SpecularArrays;
+	};
+
+	// Advanced by the import from worker threads. Reading the source counts as one step, each built mesh as another.
+	struct ImportProgress
+	{
+		std::atomic<unsigned int> CompletedSteps {0u};
+		std::atomic<unsigned int> TotalSteps {1u};
+	};
+
+	// Imports on the calling thread and parses meshes in parallel, prefer Resolve so the file is imported once.
+	ModelAsset(const Graphics& InGraphics, std::string_view InPath, const ImportOptions& InOptions = {}, ImportProgress* InProgress = nullptr);
+	ModelAsset(const ModelAsset&) = delete;
+	ModelAsset(ModelAsset&&) = delete;
+	ModelAsset& operator=(const ModelAsset&) = delete;
+	ModelAsset& operator=(ModelAsset&&) = delete;
+	~ModelAsset() = default;
+
+	// The asset of the file imported with the same options while any instance still holds it, a new import otherwise.
+	// Resolving a file whose import is running from another thread waits for that import.
+	[[nodiscard]] static std::shared_ptr<const ModelAsset> Resolve(const Graphics& InGraphics, std::string_view InPath, const ImportOptions& InOptions = {},
+	                                                               ImportProgress* InProgress = nullptr);
+	// Every asset some instance still holds, those being imported left out.
+	[[nodiscard]] static std::vector<std::shared_ptr<const ModelAsset>> GetLoaded();
+	// Reads the model the way an import does without creating anything, which leaves its mesh cache current, and returns its maps.
+	[[nodiscard]] static std::vector<CookedMap> ImportForCooking(const std::filesystem::path& InPath);
+	// Every distinct map of the meshes, by full path.
+	[[nodiscard]] static std::vector<CookedMap> FindCookedMaps(const std::vector<MeshCache::MeshEntry>& InMeshes, const std::filesystem::path& InPath);
+	// Cooks the maps on the job system, before anything reads their headers.
+	static void CookTextures(const std::vector<CookedMap>& InMaps, TextureCooker::Quality InQuality = TextureCooker::Quality::High);
+	// Reads only the headers of the maps, the arrays are created once the first material using them is.
+	[[nodiscard]] static TexturePacking PackTextures(const std::vector<MeshCache::MeshEntry>& InMeshes, const std::filesystem::path& InPath);
+	// Packed maps are sampled from the arrays InPacking assigns them, null keeps separate textures. Skinned meshes are baked from InBake
+	// when it is set and their frames fit, they keep their bones otherwise.
+	[[nodiscard]] static Mesh::Description ParseMesh(const Graphics& InGraphics, const MeshCache::MeshEntry& InMesh, const std::filesystem::path& InPath,
+	                                                 const TexturePacking* InPacking = nullptr, const ImportOptions& InOptions = {},
+	                                                 const AnimationBake* InBake = nullptr);
+
+	[[nodiscard]] const std::vector<Mesh::Description>& GetMeshes() const noexcept
+	{
+		return Meshes;
+	}
+
+	[[nodiscard]] const std::shared_ptr<const NodeHierarchy::Structure>& GetNodes() const noexcept
+	{
+		return Nodes;
+	}
+
+	// Channels index the nodes.
+	[[nodiscard]] const std::vector<AnimationClip>& GetAnimations() const noexcept
+	{
+		return Animations;
+	}
+
+	[[nodiscard]] const std::string& GetSourcePath() const noexcept
+	{
+		return SourcePath;
+	}
+
+	[[nodiscard]] const ImportOptions& GetOptions() const noexcept
+	{
+		return Options;
+	}
+
+	// What the meshes' buffers and maps hold on the GPU right now, a map streaming in mips grows it. Bindables the meshes share count once.
+	[[nodiscard]] size_t GetGpuByteSize() const;
+
+	// Created on the first call, on the main thread, and baked by the first instance drawn as it. Every instance shares it.
+	[[nodiscard]] const std::shared_ptr<ImpostorAtlas>& GetImpostor(const Graphics& InGraphics) const;
 
 private:
-	std::string Name;
-	int ID;
-	std::vector<std::unique_ptr<Node>> Children;
-	std::vector<Mesh*> Meshes;
-	DirectX::XMFLOAT4X4 BaseTransform;
-	DirectX::XMFLOAT4X4 AppliedTransform;
+	std::string SourcePath;
+	ImportOptions Options;
+	std::vector<Mesh::Description> Meshes;
+	std::shared_ptr<const NodeHierarchy::Structure> Nodes;
+	std::vector<AnimationClip> Animations;
+	mutable std::shared_ptr<ImpostorAtlas> MyImpostorAtlas;
 };
 
-class Model
+/**
+ * One placement of a ModelAsset: a root transform, the transforms applied to its nodes and the drawables
+ * submitting the shared meshes at them. The editor window is only created once the instance is shown or picked.
+ */
+class ModelInstance
 {
 public:
-	Model(const Graphics& InGraphics, std::string_view InPath);
-	~Model();
+	using ProgressCallback = std::function<void(float InProgress)>;
+
+	struct CullingStatistics
+	{
+		unsigned int DrawnMeshNum {0u};
+		unsigned int CulledMeshNum {0u};
+		// At the levels of detail the meshes were drawn with, the impostor's two included.
+		unsigned int DrawnTriangleNum {0u};
+		// Drawn as its impostor, all of it or fading in over the meshes.
+		bool bIsImpostorDrawn {false};
+	};
+
+	// What the model window's sliders set for a node, on top of its imported transform.
+	struct NodeTransform
+	{
+		unsigned int Node;
+		float Roll;
+		float Pitch;
+		float Yaw;
+		DirectX::XMFLOAT3 Position;
+	};
+
+	// Where a ray cast against the instance came out.
+	struct RayHit
+	{
+		unsigned int Node {~0u};
+		unsigned int MeshIndex {0u};
+		// Of the mesh's finest level.
+		unsigned int Triangle {TriangleBvh::NoTriangle};
+		// How far to search going in, in world units.
+		float Distance {FLT_MAX};
+	};
+
+	static constexpr unsigned int NoAnimation {~0u};
+
+	ModelInstance(const Graphics& InGraphics, std::shared_ptr<const ModelAsset> InAsset);
+	ModelInstance(const Graphics& InGraphics, std::string_view InPath, const ModelAsset::ImportOptions& InOptions = {});
+	~ModelInstance();
+
+	// Resolves the asset on a worker thread, a placeholder is submitted until Update sees the load finish.
+	[[nodiscard]] static std::unique_ptr<ModelInstance> LoadAsync(const Graphics& InGraphics, std::string_view InPath,
+	                                                              const ModelAsset::ImportOptions& InOptions = {}, ProgressCallback InOnProgress = {});
+	// Another instance of the asset, loaded as this one is. While this one's import is pending the new one waits for it to finish
+	// instead of queueing a second import of the same file, which would hold a worker on the import's lock.
+	[[nodiscard]] std::unique_ptr<ModelInstance> LoadShared(const Graphics& InGraphics) const;
+	// Reports progress and finishes a pending asynchronous load, call once per frame on the main thread.
+	void Update();
+	// Only submits nodes the spatial index finds inside the camera frustum, and reports moved nodes to the shadow faces,
+	// the sun cascades, the reflection probes and the irradiance volume. Once the model is drawn no taller than an impostor
+	// cell the impostor stands in for the meshes, dithering in over them from ImpostorFadeStart times that size down.
+	void Submit(const Graphics& InGraphics) const;
+	// Nodes within reach of every shadowed light with stale faces and of every sun cascade drawn again, call after Submit.
+	void SubmitShadowCasters(const Graphics& InGraphics) const;
+	// Nodes inside the reflection probe face drawn this frame, if there is one, call after Submit.
+	void SubmitReflectionCaptures(const Graphics& InGraphics) const;
+	// Nodes within reach of the irradiance probes drawn this frame, if there are some, call after Submit.
+	void SubmitIrradianceCaptures(const Graphics& InGraphics) const;
+	// Debug lines of the spatial index's branches and of every node's bounds, green inside the camera frustum and red when
+	// Submit culled it, call after Submit.
+	void DrawBounds(const Graphics& InGraphics) const;
+	// Nodes inside the pick frustum on a frame with a pick, each tagged with the instance and its node, call after Submit.
+	void SubmitPickCandidates(const Graphics& InGraphics) const;
+	// The closest triangle of a static mesh within InOutHit.Distance along the world space ray, which must be normalized. Nodes come
+	// from the spatial index and are searched through their meshes' triangle trees, false on a miss or while loading.
+	bool IntersectRay(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, RayHit& InOutHit) const;
+	// What a pick tagged when the instance came out in front.
+	void SelectNode(unsigned int InNodeIndex);
+	// The window can freeze the selected node, which needs the device to create the merged meshes.
+	void ShowWindow(const Graphics& InGraphics, std::string_view InWindowName = {});
+	// Swaps the asset for the one hot reload imported again from its changed file, if there is one, keeping the transforms applied to
+	// the nodes and the window's sliders. The playing animation starts over. Call once per frame on the main thread, after Update.
+	void ApplyReload(const Graphics& InGraphics);
+	// Swaps the asset for one with the node's subtree merged as ImportOptions::StaticNodes does, keeping the transforms applied
+	// outside it. Edits below the node are dropped, the vertices hold its imported transforms.
+	void Freeze(const Graphics& InGraphics, unsigned int InNodeIndex);
+	// Can be set while loading, the instance appears where it was last placed.
+	void SetRootTransform(DirectX::FXMMATRIX InTransform) noexcept;
+	// Shown in the model window as if its sliders were dragged there. Can be set while loading, nodes the asset doesn't have are ignored.
+	void SetNodeTransform(const NodeTransform& InTransform);
+	// Every node the window or SetNodeTransform moved, in node order, empty while loading.
+	[[nodiscard]] std::vector<NodeTransform> GetNodeTransforms() const;
+	// Starts one of the asset's animations over, replacing the one playing. Can be asked for while loading, an index the asset
+	// doesn't have plays nothing.
+	void PlayAnimation(unsigned int InIndex, bool bInIsLooping = true) noexcept;
+	// Keeps the pose the animation was stopped in.
+	void StopAnimation() noexcept;
+	// Weights the blend shape named InTarget on every mesh that has one, the next Submit uploads it. Can be set while loading.
+	void SetMorphWeight(std::string_view InTarget, float InWeight);
+	// Loops one of the asset's animations on its vertex animated meshes, InTimeOffset seconds ahead of the frame time so a crowd doesn't move
+	// in step. The shaders play it, the nodes don't move. Can be set while loading, every instance starts on the first clip.
+	void PlayVertexAnimation(unsigned int InIndex, float InTimeOffset = 0.0f) noexcept;
+	// Advances the playing animation and poses the nodes it has channels for, before Submit. Touches nothing outside the instance.
+	void Animate(float InDeltaSeconds) noexcept;
+	// Instances share nothing they write while animating, so they are advanced across the job system, one job each.
+	static void AnimateAll(std::span<ModelInstance* const> InInstances, float InDeltaSeconds);
+
+	[[nodiscard]] bool IsReady() const noexcept
+	{
+		return Hierarchy != nullptr;
+	}
+
+	[[nodiscard]] float GetLoadProgress() const noexcept;
+
+	// Null until the load finishes.
+	[[nodiscard]] const std::shared_ptr<const ModelAsset>& GetAsset() const noexcept
+	{
+		return Asset;
+	}
+
+	[[nodiscard]] const CullingStatistics& GetCullingStatistics() const noexcept
+	{
+		return LastCullingStatistics;
+	}
+
+	[[nodiscard]] DirectX::XMMATRIX GetRootTransform() const noexcept
+	{
+		return DirectX::XMLoadFloat4x4(&RootTransform);
+	}
+
+	// NoAnimation when stopped or never started.
+	[[nodiscard]] unsigned int GetPlayingAnimation() const noexcept
+	{
+		return PlayingAnimation;
+	}
+
+private:
+	static constexpr float ImpostorFadeStart {1.5f};
+	// Visible nodes each submitting job takes, a model seeing fewer submits them on the calling thread.
+	static constexpr size_t SubmitBatchSize {64u};
+
+	struct AsyncLoad;
+
+	// A skinned, morphed or vertex animated mesh and the node it hangs off.
+	struct DeformedMesh
+	{
+		unsigned int Node;
+		unsigned int MeshIndex;
+	};
+
+	ModelInstance();
+	[[nodiscard]] static std::vector<std::unique_ptr<Mesh>> CreateMeshes(const Graphics& InGraphics, const ModelAsset& InAsset);
+	void BuildHierarchy();
+	ModelWindow& GetWindow();
+	// Gives every node of the hierarchy a transform in the GpuScene, then keeps the ones that moved up to date.
+	void UpdateSceneTransforms(const Graphics& InGraphics) const;
 
-	static std::unique_ptr<Mesh> ParseMesh(const Graphics& InGraphics, const aiMesh& InMesh,
-	                                       aiMaterial const* const* InMaterials, const std::filesystem::path& InPath);
-	std::unique_ptr<Node> ParseNode(int& InNextID, const aiNode& InNode);
-	void Draw(const Graphics& InGraphics) const;
-	void ShowWindow(std::string_view InWindowName = {}) const;
+	[[nodiscard]] unsigned int GetSceneIndex(const unsigned int InNodeIndex) const noexcept
+	{
+		return SceneFirst != GpuScene::NoIndex ? SceneFirst + InNodeIndex : GpuScene::NoIndex;
+	}
 
 private:
-	std::unique_ptr<Node> Root;
+	std::shared_ptr<const ModelAsset> Asset;
+	std::unique_ptr<AsyncLoad> PendingLoad;
+	std::unique_ptr<SolidSphere> Placeholder;
+	std::unique_ptr<NodeHierarchy> Hierarchy;
 	std::vector<std::unique_ptr<Mesh>> Meshes;
 	std::unique_ptr<ModelWindow> Window;
+	// Set before the hierarchy was built, applied by Update once it is.
+	std::vector<NodeTransform> PendingNodeTransforms;
+	// Created the first time the instance is far enough away, again after Freeze swaps the asset.
+	mutable std::unique_ptr<Impostor> MyImpostor;
+	DirectX::XMFLOAT4X4 RootTransform;
+	// Items are the nodes that own meshes, refit whenever their transforms change.
+	mutable BoundingVolumeHierarchy SpatialIndex;
+	std::vector<unsigned int> IndexedNodes;
+	std::vector<unsigned int> NodeItems;
+	unsigned int IndexedMeshNum {0u};
+	std::vector<DeformedMesh> SkinnedMeshes;
+	std::vector<DeformedMesh> MorphedMeshes;
+	std::vector<DeformedMesh> VertexAnimatedMeshes;
+	// Every weight SetMorphWeight was given, by target name. Applied again to the meshes of a new hierarchy.
+	std::vector<std::pair<std::string, float>> MorphWeights;
+	// What PlayVertexAnimation packed, applied again to the meshes of a new hierarchy.
+	UINT PlayedVertexAnimation {0u};
+	unsigned int PlayingAnimation {NoAnimation};
+	// One per track of the playing clip, where its keys were last sampled.
+	std::vector<unsigned int> AnimationCursors;
+	float AnimationTime {0.0f};
+	bool bIsAnimationLooping {true};
+	// Palettes are uploaded whenever a node moved, and once after the hierarchy is built.
+	mutable bool bArePalettesStale {true};
+	mutable CullingStatistics LastCullingStatistics;
+	// A freshly loaded model was never drawn into the cached shadow faces.
+	mutable bool bHasReportedShadowBounds {false};
+	// One transform per node from SceneFirst on, allocated on the first submit after the hierarchy is built.
+	mutable GpuScene* Scene {nullptr};
+	mutable unsigned int SceneFirst {GpuScene::NoIndex};
+	mutable unsigned int SceneNum {0u};
+	mutable bool bIsSceneStale {true};
+	// Large hierarchies only send the local transforms that changed and leave the world matrices to the GpuScene.
+	mutable bool bIsScenePropagated {false};
 };
@@ -0,0 +1,783 @@
+﻿#include "MeshCache.h"
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "AssetArchive.h"
+#include "MappedFile.h"
+#include "MeshCodec.h"
+
+namespace
+{
+	constexpr char Magic[4] {'M', 'C', 'H', 'E'};
+	// Bump whenever the import flags, the vertex layouts chosen per material, the mesh optimization, the simplification or the file layout change.
+	constexpr uint32_t Version {14u};
+	constexpr size_t DataAlignment {16u};
+
+	struct Header
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint64_t SourceSize;
+		int64_t SourceWriteTime;
+		uint64_t SourceHash;
+		uint64_t ImportHash;
+		uint32_t MeshNum;
+		uint32_t NodeNum;
+		uint32_t AnimationNum;
+	};
+
+	std::filesystem::path GetCachePath(const std::filesystem::path& InSourcePath)
+	{
+		auto CachePath = InSourcePath;
+		CachePath += ".meshcache";
+		return CachePath;
+	}
+
+	// FNV-1a, only used to notice edits that keep the size and timestamp.
+	uint64_t HashBytes(const std::byte* InData, const size_t InSize) noexcept
+	{
+		uint64_t Hash {14695981039346656037ull};
+
+		for (size_t Index = 0; Index < InSize; ++Index)
+		{
+			Hash ^= static_cast<uint64_t>(InData[Index]);
+			Hash *= 1099511628211ull;
+		}
+
+		return Hash;
+	}
+
+	template<DV::VertexLayout::ElementType T>
+	constexpr std::pair<std::string_view, DV::VertexLayout::ElementType> MakeElementCode() noexcept
+	{
+		return {DV::VertexLayout::TypeMap<T>::Code, T};
+	}
+
+	std::optional<DV::VertexLayout> LayoutFromCode(std::string_view InCode)
+	{
+		using ElementType = DV::VertexLayout::ElementType;
+
+		constexpr std::array ElementCodes
+		{
+			MakeElementCode<ElementType::Position2D>(),
+			MakeElementCode<ElementType::Position3D>(),
+			MakeElementCode<ElementType::Texture2D>(),
+			MakeElementCode<ElementType::Normal>(),
+			MakeElementCode<ElementType::Tangent>(),
+			MakeElementCode<ElementType::Bitangent>(),
+			MakeElementCode<ElementType::Float3Color>(),
+			MakeElementCode<ElementType::Float4Color>(),
+			MakeElementCode<ElementType::BGRAColor>(),
+			MakeElementCode<ElementType::OctahedralNormal>(),
+			MakeElementCode<ElementType::TangentFrame>(),
+			MakeElementCode<ElementType::HalfTexture2D>(),
+			MakeElementCode<ElementType::BoneIndices>(),
+			MakeElementCode<ElementType::BoneWeights>(),
+			MakeElementCode<ElementType::Occlusion>(),
+			MakeElementCode<ElementType::LightmapTexture2D>()
+		};
+
+		DV::VertexLayout Layout {};
+
+		// Codes share prefixes ("N", "Nq", "Nt", "Ntq", "Nbt"), so always take the longest match.
+		while (!InCode.empty())
+		{
+			const std::pair<std::string_view, ElementType>* BestMatch {nullptr};
+
+			for (const auto& ElementCode : ElementCodes)
+			{
+				if (InCode.substr(0, ElementCode.first.size()) == ElementCode.first &&
+					(!BestMatch || ElementCode.first.size() > BestMatch->first.size()))
+				{
+					BestMatch = &ElementCode;
+				}
+			}
+
+			if (!BestMatch)
+			{
+				return std::nullopt;
+			}
+
+			Layout.Append(BestMatch->second);
+			InCode.remove_prefix(BestMatch->first.size());
+		}
+
+		return Layout;
+	}
+
+	class Writer
+	{
+	public:
+		// Continues at InOutOffset and keeps it up to date, so alignment carries over from one writer to the next on the same stream.
+		Writer(std::ofstream& InStream, size_t& InOutOffset) noexcept
+			: Stream(InStream), Offset(InOutOffset)
+		{}
+
+		template<typename T>
+		void Write(const T& InValue)
+		{
+			WriteBytes(&InValue, sizeof(T));
+		}
+
+		void WriteString(const std::string_view InString)
+		{
+			Write(static_cast<uint32_t>(InString.size()));
+			WriteBytes(InString.data(), InString.size());
+		}
+
+		void WriteBytes(const void* InData, const size_t InSize)
+		{
+			Stream.write(static_cast<const char*>(InData), static_cast<std::streamsize>(InSize));
+			Offset += InSize;
+		}
+
+		void Align()
+		{
+			constexpr char Padding[DataAlignment] {};
+			WriteBytes(Padding, (DataAlignment - Offset % DataAlignment) % DataAlignment);
+		}
+
+	private:
+		std::ofstream& Stream;
+		size_t& Offset;
+	};
+
+	class Reader
+	{
+	public:
+		Reader(const std::byte* InData, const size_t InSize) noexcept
+			: Begin(InData), Cursor(InData), End(InData + InSize)
+		{}
+
+		template<typename T>
+		bool Read(T& OutValue) noexcept
+		{
+			const void* Data;
+			if (!ReadView(Data, sizeof(T)))
+			{
+				return false;
+			}
+
+			memcpy(&OutValue, Data, sizeof(T));
+			return true;
+		}
+
+		// Into a std::string or a std::pmr::string alike.
+		template<typename T>
+		bool ReadString(T& OutString)
+		{
+			uint32_t Length;
+			const void* Data;
+			if (!Read(Length) || !ReadView(Data, Length))
+			{
+				return false;
+			}
+
+			OutString.assign(static_cast<const char*>(Data), Length);
+			return true;
+		}
+
+		bool ReadView(const void*& OutData, const size_t InSize) noexcept
+		{
+			if (static_cast<size_t>(End - Cursor) < InSize)
+			{
+				return false;
+			}
+
+			OutData = Cursor;
+			Cursor += InSize;
+			return true;
+		}
+
+		bool Align() noexcept
+		{
+			const void* Padding;
+			const auto Offset = static_cast<size_t>(Cursor - Begin);
+			return ReadView(Padding, (DataAlignment - Offset % DataAlignment) % DataAlignment);
+		}
+
+	private:
+		const std::byte* Begin;
+		const std::byte* Cursor;
+		const std::byte* End;
+	};
+}
+
+namespace
+{
+	std::optional<Header> MakeSourceHeader(const std::filesystem::path& InSourcePath)
+	{
+		// The archive keeps the packed file's size and write time, so a cache written from the loose model still matches.
+		const auto& Archive = AssetArchive::Get();
+		const auto Status = Archive.GetStatus(InSourcePath);
+		if (!Status)
+		{
+			return std::nullopt;
+		}
+
+		Header SourceHeader {};
+		memcpy(SourceHeader.Magic, Magic, sizeof(Magic));
+		SourceHeader.Version = Version;
+		SourceHeader.SourceWriteTime = Status->WriteTime;
+
+		if (Archive.Contains(InSourcePath))
+		{
+			if (std::vector<std::byte> Bytes; Archive.Read(InSourcePath, Bytes) && !Bytes.empty())
+			{
+				SourceHeader.SourceSize = Bytes.size();
+				SourceHeader.SourceHash = HashBytes(Bytes.data(), Bytes.size());
+			}
+		}
+		else if (const MappedFile Source(InSourcePath); Source.IsValid())
+		{
+			SourceHeader.SourceSize = Source.GetSize();
+			SourceHeader.SourceHash = HashBytes(Source.GetData(), Source.GetSize());
+		}
+
+		return SourceHeader;
+	}
+
+	// Rejects keys out of order, sampling searches them by time.
+	bool ReadKeys(Reader& InReader, std::vector<MeshCache::KeyEntry>& OutKeys)
+	{
+		uint32_t KeyNum;
+		const void* KeyData;
+
+		if (!InReader.Read(KeyNum) ||
+			!InReader.ReadView(KeyData, static_cast<size_t>(KeyNum) * sizeof(MeshCache::KeyEntry)))
+		{
+			return false;
+		}
+
+		OutKeys.resize(KeyNum);
+		memcpy(OutKeys.data(), KeyData, KeyNum * sizeof(MeshCache::KeyEntry));
+
+		for (size_t Index = 1u; Index < OutKeys.size(); ++Index)
+		{
+			if (!(OutKeys[Index - 1u].Time <= OutKeys[Index].Time))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void WriteKeys(Writer& InWriter, const std::vector<MeshCache::KeyEntry>& InKeys)
+	{
+		InWriter.Write(static_cast<uint32_t>(InKeys.size()));
+		InWriter.WriteBytes(InKeys.data(), InKeys.size() * sizeof(MeshCache::KeyEntry));
+	}
+}
+
+MeshCache::~MeshCache() = default;
+
+std::unique_ptr<MeshCache> MeshCache::Open(const std::filesystem::path& InSourcePath, const uint64_t InImportHash)
+{
+	const auto CachePath = GetCachePath(InSourcePath);
+	const auto& Archive = AssetArchive::Get();
+	const bool bIsPacked = Archive.Contains(CachePath);
+	const auto SourceHeader = bIsPacked ? std::nullopt : MakeSourceHeader(InSourcePath);
+
+	if (!bIsPacked && !SourceHeader)
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<MeshCache> Cache {new MeshCache};
+	std::span<const std::byte> CacheBytes;
+
+	if (bIsPacked)
+	{
+		if (!Archive.Read(CachePath, Cache->PackedBytes))
+		{
+			return nullptr;
+		}
+
+		CacheBytes = Cache->PackedBytes;
+	}
+	else
+	{
+		Cache->Mapping = std::make_unique<MappedFile>(CachePath);
+		if (!Cache->Mapping->IsValid())
+		{
+			return nullptr;
+		}
+
+		CacheBytes = {Cache->Mapping->GetData(), Cache->Mapping->GetSize()};
+	}
+
+	Reader CacheReader(CacheBytes.data(), CacheBytes.size());
+
+	Header CacheHeader;
+	if (!CacheReader.Read(CacheHeader) ||
+		memcmp(CacheHeader.Magic, Magic, sizeof(Magic)) != 0 ||
+		CacheHeader.Version != Version ||
+		CacheHeader.ImportHash != InImportHash ||
+		(SourceHeader && (CacheHeader.SourceSize != SourceHeader->SourceSize ||
+		                  CacheHeader.SourceWriteTime != SourceHeader->SourceWriteTime ||
+		                  CacheHeader.SourceHash != SourceHeader->SourceHash)) ||
+		CacheHeader.NodeNum == 0u)
+	{
+		return nullptr;
+	}
+
+	Cache->Meshes.resize(CacheHeader.MeshNum);
+
+	for (auto& Entry : Cache->Meshes)
+	{
+		std::string LayoutCode;
+		uint64_t VertexBytes;
+		uint64_t IndexNum;
+		uint32_t LodNum;
+		const void* LodData;
+		uint32_t MeshletNum;
+		const void* MeshletData;
+		uint32_t BoneNum;
+		const void* BoneData;
+		uint32_t MorphTargetNum;
+		uint32_t MorphDeltaNum;
+		const void* MorphDeltaData;
+		// Zero when the stream is stored as it is, encoding didn't make it smaller.
+		uint64_t EncodedVertexBytes;
+		uint64_t EncodedIndexBytes;
+		const void* VertexData;
+		const void* IndexData;
+		uint32_t TriangleNodeNum;
+		uint32_t TriangleNum;
+		const void* TriangleNodeData;
+		const void* TriangleData;
+
+		if (!CacheReader.ReadString(Entry.Name) ||
+			!CacheReader.ReadString(LayoutCode) ||
+			!CacheReader.ReadString(Entry.DiffuseMap) ||
+			!CacheReader.ReadString(Entry.NormalMap) ||
+			!CacheReader.ReadString(Entry.SpecularMap) ||
+			!CacheReader.ReadString(Entry.LightmapMap) ||
+			!CacheReader.Read(Entry.Shininess) ||
+			!CacheReader.ReadString(Entry.MaterialName) ||
+			!CacheReader.Read(Entry.Opacity) ||
+			!CacheReader.Read(Entry.bIsTwoSided) ||
+			!CacheReader.Read(Entry.bIsAlphaTested) ||
+			!CacheReader.Read(VertexBytes) ||
+			!CacheReader.Read(IndexNum) ||
+			IndexNum > CacheBytes.size() / sizeof(unsigned int) * MeshCodec::MaxExpansion ||
+			!CacheReader.Read(LodNum) ||
+			LodNum == 0u ||
+			!CacheReader.ReadView(LodData, LodNum * sizeof(LodEntry)) ||
+			!CacheReader.Read(MeshletNum) ||
+			!CacheReader.ReadView(MeshletData, static_cast<size_t>(MeshletNum) * sizeof(MeshletEntry)) ||
+			!CacheReader.Read(BoneNum) ||
+			!CacheReader.ReadView(BoneData, static_cast<size_t>(BoneNum) * sizeof(BoneEntry)) ||
+			!CacheReader.Read(MorphTargetNum) ||
+			MorphTargetNum > CacheBytes.size())
+		{
+			return nullptr;
+		}
+
+		Entry.MorphTargetNames.resize(MorphTargetNum);
+
+		for (auto& Name : Entry.MorphTargetNames)
+		{
+			if (!CacheReader.ReadString(Name))
+			{
+				return nullptr;
+			}
+		}
+
+		if (!CacheReader.Read(MorphDeltaNum) ||
+			!CacheReader.ReadView(MorphDeltaData, static_cast<size_t>(MorphDeltaNum) * sizeof(MorphDeltaEntry)) ||
+			!CacheReader.Read(EncodedVertexBytes) ||
+			!CacheReader.Read(EncodedIndexBytes) ||
+			!CacheReader.Align() ||
+			!CacheReader.ReadView(VertexData, static_cast<size_t>(EncodedVertexBytes != 0u ? EncodedVertexBytes : VertexBytes)) ||
+			!CacheReader.Align() ||
+			!CacheReader.ReadView(IndexData, static_cast<size_t>(EncodedIndexBytes != 0u ? EncodedIndexBytes : IndexNum * sizeof(unsigned int))) ||
+			!CacheReader.Read(TriangleNodeNum) ||
+			!CacheReader.Read(TriangleNum) ||
+			!CacheReader.Align() ||
+			!CacheReader.ReadView(TriangleNodeData, static_cast<size_t>(TriangleNodeNum) * sizeof(TriangleBvh::Node)) ||
+			!CacheReader.ReadView(TriangleData, static_cast<size_t>(TriangleNum) * sizeof(TriangleBvh::Triangle)))
+		{
+			return nullptr;
+		}
+
+		auto Layout = LayoutFromCode(LayoutCode);
+		if (!Layout || Layout->Size() == 0u || VertexBytes % Layout->Size() != 0u ||
+		    (EncodedVertexBytes != 0u && (Layout->Size() > MeshCodec::MaxStride || VertexBytes / MeshCodec::MaxExpansion > EncodedVertexBytes)) ||
+		    (EncodedIndexBytes != 0u && IndexNum * sizeof(unsigned int) / MeshCodec::MaxExpansion > EncodedIndexBytes))
+		{
+			return nullptr;
+		}
+
+		Entry.Layout = std::move(*Layout);
+		Entry.VertexBytes = static_cast<size_t>(VertexBytes);
+		Entry.Vertices = VertexData;
+		Entry.Indices = static_cast<const unsigned int*>(IndexData);
+
+		// Encoded streams can't be bound from the mapping, they decode into memory the cache keeps.
+		if (EncodedVertexBytes != 0u)
+		{
+			auto& Decoded = Cache->DecodedStreams.emplace_back(std::make_unique_for_overwrite<std::byte[]>(Entry.VertexBytes));
+			if (!MeshCodec::DecodeVertices({static_cast<const std::byte*>(VertexData), static_cast<size_t>(EncodedVertexBytes)}, Decoded.get(),
+			                               Entry.VertexBytes / Entry.Layout.Size(), Entry.Layout.Size()))
+			{
+				return nullptr;
+			}
+
+			Entry.Vertices = Decoded.get();
+		}
+
+		if (EncodedIndexBytes != 0u)
+		{
+			auto& Decoded = Cache->DecodedStreams.emplace_back(std::make_unique_for_overwrite<std::byte[]>(static_cast<size_t>(IndexNum) * sizeof(unsigned int)));
+			auto* const Indices = reinterpret_cast<unsigned int*>(Decoded.get());
+			if (!MeshCodec::DecodeIndices({static_cast<const std::byte*>(IndexData), static_cast<size_t>(EncodedIndexBytes)}, {Indices, static_cast<size_t>(IndexNum)}))
+			{
+				return nullptr;
+			}
+
+			Entry.Indices = Indices;
+		}
+
+		Entry.IndexNum = static_cast<size_t>(IndexNum);
+		Entry.Lods.resize(LodNum);
+		memcpy(Entry.Lods.data(), LodData, LodNum * sizeof(LodEntry));
+		Entry.Meshlets.resize(MeshletNum);
+		memcpy(Entry.Meshlets.data(), MeshletData, MeshletNum * sizeof(MeshletEntry));
+		Entry.Bones.resize(BoneNum);
+		memcpy(Entry.Bones.data(), BoneData, BoneNum * sizeof(BoneEntry));
+		Entry.MorphDeltas.resize(MorphDeltaNum);
+		memcpy(Entry.MorphDeltas.data(), MorphDeltaData, MorphDeltaNum * sizeof(MorphDeltaEntry));
+
+		// Skin weights and the bones they refer to only make sense together.
+		if (Entry.Bones.empty() == Entry.Layout.Has<DV::VertexLayout::BoneIndices>())
+		{
+			return nullptr;
+		}
+
+		for (const auto& Bone : Entry.Bones)
+		{
+			if (Bone.Node >= CacheHeader.NodeNum)
+			{
+				return nullptr;
+			}
+		}
+
+		// The vertex shaders find a vertex's deltas by their order.
+		const auto VertexNum = Entry.VertexBytes / Entry.Layout.Size();
+
+		for (size_t Index = 0u; Index < Entry.MorphDeltas.size(); ++Index)
+		{
+			const auto& Delta = Entry.MorphDeltas[Index];
+
+			if (Delta.Vertex >= VertexNum || Delta.Target >= MorphTargetNum ||
+			    (Index > 0u && std::make_pair(Entry.MorphDeltas[Index - 1u].Vertex, Entry.MorphDeltas[Index - 1u].Target) >= std::make_pair(Delta.Vertex, Delta.Target)))
+			{
+				return nullptr;
+			}
+		}
+
+		for (const auto& Lod : Entry.Lods)
+		{
+			if (static_cast<uint64_t>(Lod.FirstIndex) + Lod.IndexNum > IndexNum)
+			{
+				return nullptr;
+			}
+		}
+
+		for (const auto& Meshlet : Entry.Meshlets)
+		{
+			if (static_cast<uint64_t>(Meshlet.FirstIndex) + Meshlet.TriangleNum * 3ull > Entry.Lods.front().IndexNum)
+			{
+				return nullptr;
+			}
+		}
+
+		if (TriangleNodeNum != 0u)
+		{
+			auto Triangles = std::make_shared<TriangleBvh>();
+			if (!Triangles->Assign({static_cast<const TriangleBvh::Node*>(TriangleNodeData), TriangleNodeNum},
+			                       {static_cast<const TriangleBvh::Triangle*>(TriangleData), TriangleNum}))
+			{
+				return nullptr;
+			}
+
+			// Hits name the triangle of the finest level they are on.
+			for (const auto& Triangle : Triangles->GetTriangles())
+			{
+				if (Triangle.Index * 3ull >= Entry.Lods.front().IndexNum)
+				{
+					return nullptr;
+				}
+			}
+
+			Entry.Triangles = std::move(Triangles);
+		}
+	}
+
+	Cache->Nodes.resize(CacheHeader.NodeNum);
+	size_t ChildTotal {0u};
+
+	for (auto& Entry : Cache->Nodes)
+	{
+		uint32_t MeshIndexNum;
+		const void* MeshIndexData;
+
+		if (!CacheReader.ReadString(Entry.Name) ||
+			!CacheReader.Read(Entry.Transform) ||
+			!CacheReader.Read(MeshIndexNum) ||
+			!CacheReader.ReadView(MeshIndexData, MeshIndexNum * sizeof(unsigned int)) ||
+			!CacheReader.Read(Entry.ChildNum))
+		{
+			return nullptr;
+		}
+
+		Entry.MeshIndices.resize(MeshIndexNum);
+		memcpy(Entry.MeshIndices.data(), MeshIndexData, MeshIndexNum * sizeof(unsigned int));
+
+		for (const auto MeshIndex : Entry.MeshIndices)
+		{
+			if (MeshIndex >= CacheHeader.MeshNum)
+			{
+				return nullptr;
+			}
+		}
+
+		ChildTotal += Entry.ChildNum;
+	}
+
+	// Every node but the root is somebody's child, anything else can't be rebuilt in pre-order.
+	if (ChildTotal != Cache->Nodes.size() - 1u)
+	{
+		return nullptr;
+	}
+
+	Cache->Animations.resize(CacheHeader.AnimationNum);
+
+	for (auto& Entry : Cache->Animations)
+	{
+		uint32_t ChannelNum;
+
+		if (!CacheReader.ReadString(Entry.Name) ||
+			!CacheReader.Read(Entry.Duration) ||
+			!CacheReader.Read(ChannelNum) ||
+			ChannelNum > CacheHeader.NodeNum)
+		{
+			return nullptr;
+		}
+
+		Entry.Channels.resize(ChannelNum);
+
+		for (auto& Channel : Entry.Channels)
+		{
+			if (!CacheReader.Read(Channel.Node) ||
+				Channel.Node >= CacheHeader.NodeNum ||
+				!ReadKeys(CacheReader, Channel.Translations) ||
+				!ReadKeys(CacheReader, Channel.Rotations) ||
+				!ReadKeys(CacheReader, Channel.Scalings))
+			{
+				return nullptr;
+			}
+		}
+	}
+
+	return Cache;
+}
+
+MeshCache::StreamWriter::StreamWriter(const std::filesystem::path& InSourcePath, const uint64_t InImportHash)
+	: CachePath(GetCachePath(InSourcePath)), TemporaryPath(CachePath)
+{
+	TemporaryPath += ".tmp";
+
+	// Only the counts are missing, Finish patches them in.
+	auto CacheHeader = MakeSourceHeader(InSourcePath);
+	if (!CacheHeader)
+	{
+		return;
+	}
+
+	CacheHeader->ImportHash = InImportHash;
+	Stream = std::make_unique<std::ofstream>(TemporaryPath, std::ios::binary | std::ios::trunc);
+
+	if (!*Stream)
+	{
+		Stream.reset();
+		return;
+	}
+
+	Writer(*Stream, Offset).Write(*CacheHeader);
+}
+
+MeshCache::StreamWriter::~StreamWriter()
+{
+	if (Stream && !bIsFinished)
+	{
+		Stream.reset();
+
+		std::error_code ErrorCode;
+		std::filesystem::remove(TemporaryPath, ErrorCode);
+	}
+}
+
+bool MeshCache::StreamWriter::IsValid() const noexcept
+{
+	return Stream && !Stream->fail();
+}
+
+void MeshCache::StreamWriter::AddMesh(const MeshEntry& InEntry)
+{
+	if (!IsValid())
+	{
+		return;
+	}
+
+	Writer CacheWriter(*Stream, Offset);
+	CacheWriter.WriteString(InEntry.Name);
+	CacheWriter.WriteString(InEntry.Layout.GetCode());
+	CacheWriter.WriteString(InEntry.DiffuseMap);
+	CacheWriter.WriteString(InEntry.NormalMap);
+	CacheWriter.WriteString(InEntry.SpecularMap);
+	CacheWriter.WriteString(InEntry.LightmapMap);
+	CacheWriter.Write(InEntry.Shininess);
+	CacheWriter.WriteString(InEntry.MaterialName);
+	CacheWriter.Write(InEntry.Opacity);
+	CacheWriter.Write(InEntry.bIsTwoSided);
+	CacheWriter.Write(InEntry.bIsAlphaTested);
+	CacheWriter.Write(static_cast<uint64_t>(InEntry.VertexBytes));
+	CacheWriter.Write(static_cast<uint64_t>(InEntry.IndexNum));
+	CacheWriter.Write(static_cast<uint32_t>(InEntry.Lods.size()));
+	CacheWriter.WriteBytes(InEntry.Lods.data(), InEntry.Lods.size() * sizeof(LodEntry));
+	CacheWriter.Write(static_cast<uint32_t>(InEntry.Meshlets.size()));
+	CacheWriter.WriteBytes(InEntry.Meshlets.data(), InEntry.Meshlets.size() * sizeof(MeshletEntry));
+	CacheWriter.Write(static_cast<uint32_t>(InEntry.Bones.size()));
+	CacheWriter.WriteBytes(InEntry.Bones.data(), InEntry.Bones.size() * sizeof(BoneEntry));
+	CacheWriter.Write(static_cast<uint32_t>(InEntry.MorphTargetNames.size()));
+
+	for (const auto& Name : InEntry.MorphTargetNames)
+	{
+		CacheWriter.WriteString(Name);
+	}
+
+	CacheWriter.Write(static_cast<uint32_t>(InEntry.MorphDeltas.size()));
+	CacheWriter.WriteBytes(InEntry.MorphDeltas.data(), InEntry.MorphDeltas.size() * sizeof(MorphDeltaEntry));
+
+	// A stream the codec doesn't shrink is stored as it is, and an encoded size of zero says so.
+	const auto Stride = InEntry.Layout.Size();
+	std::vector<std::byte> EncodedVertices;
+	if (Stride > 0u && Stride <= MeshCodec::MaxStride)
+	{
+		EncodedVertices = MeshCodec::EncodeVertices(InEntry.Vertices, InEntry.VertexBytes / Stride, Stride);
+		if (EncodedVertices.size() >= InEntry.VertexBytes)
+		{
+			EncodedVertices.clear();
+		}
+	}
+
+	auto EncodedIndices = MeshCodec::EncodeIndices({InEntry.Indices, InEntry.IndexNum});
+	if (EncodedIndices.size() >= InEntry.IndexNum * sizeof(unsigned int))
+	{
+		EncodedIndices.clear();
+	}
+
+	CacheWriter.Write(static_cast<uint64_t>(EncodedVertices.size()));
+	CacheWriter.Write(static_cast<uint64_t>(EncodedIndices.size()));
+	CacheWriter.Align();
+
+	if (EncodedVertices.empty())
+	{
+		CacheWriter.WriteBytes(InEntry.Vertices, InEntry.VertexBytes);
+	}
+	else
+	{
+		CacheWriter.WriteBytes(EncodedVertices.data(), EncodedVertices.size());
+	}
+
+	CacheWriter.Align();
+
+	if (EncodedIndices.empty())
+	{
+		CacheWriter.WriteBytes(InEntry.Indices, InEntry.IndexNum * sizeof(unsigned int));
+	}
+	else
+	{
+		CacheWriter.WriteBytes(EncodedIndices.data(), EncodedIndices.size());
+	}
+
+	const auto TriangleNodes = InEntry.Triangles ? InEntry.Triangles->GetNodes() : std::span<const TriangleBvh::Node>();
+	const auto Triangles = InEntry.Triangles ? InEntry.Triangles->GetTriangles() : std::span<const TriangleBvh::Triangle>();
+	CacheWriter.Write(static_cast<uint32_t>(TriangleNodes.size()));
+	CacheWriter.Write(static_cast<uint32_t>(Triangles.size()));
+	CacheWriter.Align();
+	CacheWriter.WriteBytes(TriangleNodes.data(), TriangleNodes.size_bytes());
+	CacheWriter.WriteBytes(Triangles.data(), Triangles.size_bytes());
+
+	++MeshNum;
+}
+
+bool MeshCache::StreamWriter::Finish(const NodeList& InNodes, const std::vector<AnimationEntry>& InAnimations)
+{
+	if (!IsValid())
+	{
+		return false;
+	}
+
+	Writer CacheWriter(*Stream, Offset);
+
+	for (const auto& Entry : InNodes)
+	{
+		CacheWriter.WriteString(Entry.Name);
+		CacheWriter.Write(Entry.Transform);
+		CacheWriter.Write(static_cast<uint32_t>(Entry.MeshIndices.size()));
+		CacheWriter.WriteBytes(Entry.MeshIndices.data(), Entry.MeshIndices.size() * sizeof(unsigned int));
+		CacheWriter.Write(Entry.ChildNum);
+	}
+
+	for (const auto& Entry : InAnimations)
+	{
+		CacheWriter.WriteString(Entry.Name);
+		CacheWriter.Write(Entry.Duration);
+		CacheWriter.Write(static_cast<uint32_t>(Entry.Channels.size()));
+
+		for (const auto& Channel : Entry.Channels)
+		{
+			CacheWriter.Write(Channel.Node);
+			WriteKeys(CacheWriter, Channel.Translations);
+			WriteKeys(CacheWriter, Channel.Rotations);
+			WriteKeys(CacheWriter, Channel.Scalings);
+		}
+	}
+
+	// The counts sit before the first mesh, they are patched into the header once known.
+	const std::array<uint32_t, 3> Counts {MeshNum, static_cast<uint32_t>(InNodes.size()), static_cast<uint32_t>(InAnimations.size())};
+	static_assert(offsetof(Header, NodeNum) == offsetof(Header, MeshNum) + sizeof(uint32_t) &&
+	              offsetof(Header, AnimationNum) == offsetof(Header, NodeNum) + sizeof(uint32_t));
+
+	Stream->seekp(offsetof(Header, MeshNum));
+	Stream->write(reinterpret_cast<const char*>(Counts.data()), sizeof(Counts));
+
+	if (!Stream->flush())
+	{
+		return false;
+	}
+
+	Stream.reset();
+
+	// Written aside and renamed so a crash never leaves a truncated cache behind.
+	std::error_code ErrorCode;
+	std::filesystem::rename(TemporaryPath, CachePath, ErrorCode);
+	if (ErrorCode)
+	{
+		std::filesystem::remove(TemporaryPath, ErrorCode);
+		return false;
+	}
+
+	bIsFinished = true;
+	return true;
+}
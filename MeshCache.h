@@ -0,0 +1,216 @@
+﻿#pragma once
+#include <cstdint>
+#include <DirectXMath.h>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "AssetArena.h"
+#include "DynamicVertex.h"
+#include "MeshOptimizer.h"
+#include "TriangleBvh.h"
+
+class MappedFile;
+
+/**
+ * Versioned binary snapshot of a post-processed model, written next to the source as "<file>.meshcache".
+ * Holds interleaved vertices, indices with their levels of detail and meshlets, sparse morph targets, material texture references, the node hierarchy with its bones and animations, and is
+ * invalidated when the source file's size, timestamp or content hash, or the hash of the import settings it was made with, no longer match.
+ * Opened caches are memory-mapped, mesh entries point straight into the mapping. A cache in the AssetArchive was checked against its
+ * source's content by the cooker that packed it, so it is trusted without the source and decompressed into memory instead.
+ * Vertex and index streams are stored through the MeshCodec wherever that makes them smaller, those decode into memory the cache keeps.
+ * Static meshes also store the TriangleBvh over their finest level, so ray casts against them don't wait for a build on load.
+ */
+class MeshCache
+{
+public:
+	// One level of detail, a range of the mesh's indices over the vertices every level shares.
+	struct LodEntry
+	{
+		unsigned int FirstIndex {0u};
+		unsigned int IndexNum {0u};
+		// How far simplification moved the surface, in the mesh's own units.
+		float Error {0.0f};
+	};
+
+	// Meshlets of the finest level, their index ranges are relative to its first index.
+	using MeshletEntry = MeshOptimizer::Meshlet;
+
+	// A node that deforms a skinned mesh, the layout's bone indices point into the mesh's list of them.
+	struct BoneEntry
+	{
+		unsigned int Node {0u};
+		// Takes the mesh's bind pose into the bone's space, transposed like node transforms.
+		DirectX::XMFLOAT4X4 Offset;
+	};
+
+	// How far one morph target at full weight moves one vertex, only the vertices a target moves have one.
+	struct MorphDeltaEntry
+	{
+		unsigned int Vertex {0u};
+		unsigned int Target {0u};
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Normal;
+	};
+
+	struct MeshEntry
+	{
+		std::string Name;
+		DV::VertexLayout Layout {};
+		const void* Vertices {nullptr};
+		size_t VertexBytes {0u};
+		const unsigned int* Indices {nullptr};
+		size_t IndexNum {0u};
+		// Finest first, the first level starts at index zero and the levels together cover all IndexNum indices.
+		std::vector<LodEntry> Lods;
+		std::vector<MeshletEntry> Meshlets;
+		// Over the finest level, null unless the mesh is static, skinned and morphed meshes leave the pose it was built in.
+		std::shared_ptr<const TriangleBvh> Triangles;
+		// Empty unless the layout has bone indices and weights.
+		std::vector<BoneEntry> Bones;
+		// The deltas' targets index the names. Sorted by vertex and by target within each, empty without morph targets.
+		std::vector<std::string> MorphTargetNames;
+		std::vector<MorphDeltaEntry> MorphDeltas;
+		// Texture file names relative to the source directory, empty when the material has no such map.
+		std::string DiffuseMap;
+		std::string NormalMap;
+		std::string SpecularMap;
+		// Baked at import beside the source when the profile asks for lightmaps, the layout then has lightmap coordinates.
+		std::string LightmapMap;
+		float Shininess {35.0f};
+		// Name of the source material, for import options that apply to it.
+		std::string MaterialName;
+		float Opacity {1.0f};
+		bool bIsTwoSided {false};
+		// The diffuse map's alpha cuts the surface out, read from glTF's MASK mode or the map itself at import.
+		bool bIsAlphaTested {false};
+	};
+
+	// Nodes are stored in pre-order, each followed by its ChildNum subtrees. Allocator-aware, so a NodeList on an AssetArena
+	// keeps the names and mesh indices of its entries there too.
+	struct NodeEntry
+	{
+		using allocator_type = std::pmr::polymorphic_allocator<>;
+
+		NodeEntry() = default;
+		explicit NodeEntry(const allocator_type& InAllocator)
+			: Name(InAllocator), MeshIndices(InAllocator)
+		{
+		}
+		NodeEntry(const NodeEntry& InOther, const allocator_type& InAllocator)
+			: Name(InOther.Name, InAllocator), Transform(InOther.Transform), MeshIndices(InOther.MeshIndices, InAllocator), ChildNum(InOther.ChildNum)
+		{
+		}
+		NodeEntry(NodeEntry&& InOther, const allocator_type& InAllocator)
+			: Name(std::move(InOther.Name), InAllocator), Transform(InOther.Transform), MeshIndices(std::move(InOther.MeshIndices), InAllocator),
+			  ChildNum(InOther.ChildNum)
+		{
+		}
+		NodeEntry(const NodeEntry&) = default;
+		NodeEntry(NodeEntry&&) noexcept = default;
+		NodeEntry& operator=(const NodeEntry&) = default;
+		NodeEntry& operator=(NodeEntry&&) = default;
+		~NodeEntry() = default;
+
+		std::pmr::string Name;
+		DirectX::XMFLOAT4X4 Transform;
+		std::pmr::vector<unsigned int> MeshIndices;
+		unsigned int ChildNum {0u};
+	};
+
+	using NodeList = std::pmr::vector<NodeEntry>;
+
+	// A translation or scaling in XYZ, or a rotation quaternion, at a time in seconds.
+	struct KeyEntry
+	{
+		float Time {0.0f};
+		DirectX::XMFLOAT4 Value;
+	};
+
+	// The keys of one node over a clip, each sorted by time.
+	struct ChannelEntry
+	{
+		unsigned int Node {0u};
+		std::vector<KeyEntry> Translations;
+		std::vector<KeyEntry> Rotations;
+		std::vector<KeyEntry> Scalings;
+	};
+
+	struct AnimationEntry
+	{
+		std::string Name;
+		// In seconds.
+		float Duration {0.0f};
+		std::vector<ChannelEntry> Channels;
+	};
+
+	/**
+	 * Writes a cache a mesh at a time, so an import only holds the mesh it is on and each is dropped once it is on disk.
+	 * The file is written aside and only replaces the cache once Finish succeeds, an unfinished writer removes it again.
+	 */
+	class StreamWriter
+	{
+	public:
+		StreamWriter(const std::filesystem::path& InSourcePath, uint64_t InImportHash);
+		StreamWriter(const StreamWriter&) = delete;
+		StreamWriter(StreamWriter&&) = delete;
+		StreamWriter& operator=(const StreamWriter&) = delete;
+		StreamWriter& operator=(StreamWriter&&) = delete;
+		~StreamWriter();
+
+		// False once anything failed, from then on nothing is written.
+		[[nodiscard]] bool IsValid() const noexcept;
+		void AddMesh(const MeshEntry& InEntry);
+		// The counts in the header are filled in now that every mesh is written.
+		bool Finish(const NodeList& InNodes, const std::vector<AnimationEntry>& InAnimations);
+
+	private:
+		std::filesystem::path CachePath;
+		std::filesystem::path TemporaryPath;
+		std::unique_ptr<std::ofstream> Stream;
+		size_t Offset {0u};
+		uint32_t MeshNum {0u};
+		bool bIsFinished {false};
+	};
+
+	MeshCache(const MeshCache&) = delete;
+	MeshCache(MeshCache&&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+	MeshCache& operator=(MeshCache&&) = delete;
+	~MeshCache();
+
+	// Returns null when there is no cache for the source or it is stale, unreadable or from another version.
+	// InImportHash identifies the profile the source is imported with, a cache written with another one is stale as well.
+	[[nodiscard]] static std::unique_ptr<MeshCache> Open(const std::filesystem::path& InSourcePath, uint64_t InImportHash);
+
+	[[nodiscard]] const std::vector<MeshEntry>& GetMeshes() const noexcept
+	{
+		return Meshes;
+	}
+
+	[[nodiscard]] const NodeList& GetNodes() const noexcept
+	{
+		return Nodes;
+	}
+
+	[[nodiscard]] const std::vector<AnimationEntry>& GetAnimations() const noexcept
+	{
+		return Animations;
+	}
+
+private:
+	MeshCache() = default;
+
+private:
+	std::unique_ptr<MappedFile> Mapping;
+	std::vector<std::byte> PackedBytes;
+	// The streams of every mesh that was stored encoded.
+	std::vector<std::unique_ptr<std::byte[]>> DecodedStreams;
+	std::vector<MeshEntry> Meshes;
+	// Whatever the nodes need besides the mapping, freed with the cache.
+	AssetArena NodeArena;
+	NodeList Nodes {&NodeArena};
+	std::vector<AnimationEntry> Animations;
+};
@@ -0,0 +1,366 @@
+﻿#include "MeshCodec.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+	constexpr size_t GroupSize {16u};
+	// Of the planes of one block, which stay on the stack while it decodes.
+	constexpr size_t BlockBytes {16u * 1024u};
+	constexpr size_t MaxBlockVertexNum {256u};
+	constexpr size_t IndexBlockNum {1024u};
+	constexpr size_t IndexPlaneNum {sizeof(uint32_t)};
+
+	// Whole groups, however many of its vertices fit the block's planes.
+	size_t GetBlockVertexNum(const size_t InStride) noexcept
+	{
+		return std::min(MaxBlockVertexNum, BlockBytes / InStride / GroupSize * GroupSize);
+	}
+
+	size_t RoundUpToGroup(const size_t InNum) noexcept
+	{
+		return (InNum + GroupSize - 1u) / GroupSize * GroupSize;
+	}
+
+	uint8_t ZigzagByte(const uint8_t InDelta) noexcept
+	{
+		const auto Signed = static_cast<int8_t>(InDelta);
+		return static_cast<uint8_t>((InDelta << 1u) ^ static_cast<uint8_t>(Signed >> 7));
+	}
+
+	uint32_t Zigzag(const uint32_t InDelta) noexcept
+	{
+		const auto Signed = static_cast<int32_t>(InDelta);
+		return (InDelta << 1u) ^ static_cast<uint32_t>(Signed >> 31);
+	}
+
+	/**
+	 * InNum values, a multiple of the group size, as a header of two bits per group followed by the groups' bits.
+	 * The codes are 0, 2, 4 and 8 bits per value, the value at index i of a group in the lowest bits first.
+	 */
+	void EncodePlane(const uint8_t* InValues, const size_t InNum, std::vector<std::byte>& OutBytes)
+	{
+		const auto GroupNum = InNum / GroupSize;
+		const auto HeaderOffset = OutBytes.size();
+		OutBytes.resize(HeaderOffset + (GroupNum + 3u) / 4u);
+
+		for (size_t Group = 0u; Group < GroupNum; ++Group)
+		{
+			const auto* const Values = InValues + Group * GroupSize;
+			const auto Largest = *std::max_element(Values, Values + GroupSize);
+			const unsigned int Code = Largest == 0u ? 0u : Largest < 4u ? 1u : Largest < 16u ? 2u : 3u;
+			OutBytes[HeaderOffset + Group / 4u] |= static_cast<std::byte>(Code << (Group % 4u * 2u));
+
+			if (Code == 0u)
+			{
+				continue;
+			}
+
+			const unsigned int Bits = 1u << Code;
+			const unsigned int PerByte = 8u / Bits;
+
+			for (size_t First = 0u; First < GroupSize; First += PerByte)
+			{
+				unsigned int Packed = 0u;
+
+				for (unsigned int Value = 0u; Value < PerByte; ++Value)
+				{
+					Packed |= static_cast<unsigned int>(Values[First + Value]) << (Value * Bits);
+				}
+
+				OutBytes.push_back(static_cast<std::byte>(Packed));
+			}
+		}
+	}
+
+	// Sixteen values of 2 bits from 4 bytes, each byte's lowest bits first.
+	__m128i Unpack2(const std::byte* InBytes) noexcept
+	{
+		uint32_t Word;
+		memcpy(&Word, InBytes, sizeof(Word));
+		const auto Packed = _mm_cvtsi32_si128(static_cast<int>(Word));
+		const auto Mask = _mm_set1_epi8(3);
+
+		// Shifted as 16 bit lanes, the mask drops what crossed over from the neighbouring byte.
+		const auto First = _mm_and_si128(Packed, Mask);
+		const auto Second = _mm_and_si128(_mm_srli_epi16(Packed, 2), Mask);
+		const auto Third = _mm_and_si128(_mm_srli_epi16(Packed, 4), Mask);
+		const auto Fourth = _mm_and_si128(_mm_srli_epi16(Packed, 6), Mask);
+		return _mm_unpacklo_epi16(_mm_unpacklo_epi8(First, Second), _mm_unpacklo_epi8(Third, Fourth));
+	}
+
+	// Sixteen values of 4 bits from 8 bytes.
+	__m128i Unpack4(const std::byte* InBytes) noexcept
+	{
+		const auto Packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(InBytes));
+		const auto Mask = _mm_set1_epi8(15);
+		return _mm_unpacklo_epi8(_mm_and_si128(Packed, Mask), _mm_and_si128(_mm_srli_epi16(Packed, 4), Mask));
+	}
+
+	// InNum values of what EncodePlane wrote into OutValues, false when the bytes run out first.
+	bool DecodePlane(const std::byte*& InOutCursor, const std::byte* const InEnd, const size_t InNum, uint8_t* const OutValues) noexcept
+	{
+		const auto GroupNum = InNum / GroupSize;
+		const auto* const Header = InOutCursor;
+		const auto HeaderBytes = (GroupNum + 3u) / 4u;
+
+		if (static_cast<size_t>(InEnd - InOutCursor) < HeaderBytes)
+		{
+			return false;
+		}
+
+		InOutCursor += HeaderBytes;
+
+		for (size_t Group = 0u; Group < GroupNum; ++Group)
+		{
+			const auto Code = (static_cast<unsigned int>(Header[Group / 4u]) >> (Group % 4u * 2u)) & 3u;
+			const size_t GroupBytes = Code == 0u ? 0u : GroupSize >> (3u - Code);
+
+			if (static_cast<size_t>(InEnd - InOutCursor) < GroupBytes)
+			{
+				return false;
+			}
+
+			const auto Values = Code == 0u ? _mm_setzero_si128() :
+			                    Code == 1u ? Unpack2(InOutCursor) :
+			                    Code == 2u ? Unpack4(InOutCursor) : _mm_loadu_si128(reinterpret_cast<const __m128i*>(InOutCursor));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(OutValues + Group * GroupSize), Values);
+			InOutCursor += GroupBytes;
+		}
+
+		return true;
+	}
+
+	// Undoes the zigzag and sums the deltas of one group in place, starting from InOutLast and leaving the group's last value in it.
+	void AccumulateBytes(uint8_t* const InOutValues, uint8_t& InOutLast) noexcept
+	{
+		const auto Zigzagged = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InOutValues));
+		const auto Magnitude = _mm_and_si128(_mm_srli_epi16(Zigzagged, 1), _mm_set1_epi8(0x7F));
+		const auto Sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(Zigzagged, _mm_set1_epi8(1)));
+		auto Sum = _mm_xor_si128(Magnitude, Sign);
+
+		// Each lane adds the one 1, 2, 4 and 8 before it, which leaves it the sum of all before it.
+		Sum = _mm_add_epi8(Sum, _mm_slli_si128(Sum, 1));
+		Sum = _mm_add_epi8(Sum, _mm_slli_si128(Sum, 2));
+		Sum = _mm_add_epi8(Sum, _mm_slli_si128(Sum, 4));
+		Sum = _mm_add_epi8(Sum, _mm_slli_si128(Sum, 8));
+		Sum = _mm_add_epi8(Sum, _mm_set1_epi8(static_cast<char>(InOutLast)));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(InOutValues), Sum);
+		InOutLast = InOutValues[GroupSize - 1u];
+	}
+
+	// Every round interleaves row i with row i + 8, which rotates the bits of a byte's row and column address by one, four
+	// rounds swap them.
+	void Transpose(__m128i (&InOutRows)[GroupSize]) noexcept
+	{
+		for (unsigned int Round = 0u; Round < 4u; ++Round)
+		{
+			__m128i Interleaved[GroupSize];
+
+			for (unsigned int Row = 0u; Row < GroupSize / 2u; ++Row)
+			{
+				Interleaved[Row * 2u] = _mm_unpacklo_epi8(InOutRows[Row], InOutRows[Row + GroupSize / 2u]);
+				Interleaved[Row * 2u + 1u] = _mm_unpackhi_epi8(InOutRows[Row], InOutRows[Row + GroupSize / 2u]);
+			}
+
+			std::copy(std::begin(Interleaved), std::end(Interleaved), std::begin(InOutRows));
+		}
+	}
+}
+
+std::vector<std::byte> MeshCodec::EncodeVertices(const void* const InVertices, const size_t InVertexNum, const size_t InStride)
+{
+	assert(InStride > 0u && InStride <= MaxStride && "Vertex too large to encode");
+
+	const auto* const Bytes = static_cast<const uint8_t*>(InVertices);
+	const auto BlockVertexNum = GetBlockVertexNum(InStride);
+	uint8_t Last[MaxStride] {};
+	uint8_t Plane[MaxBlockVertexNum];
+	std::vector<std::byte> Encoded;
+	Encoded.reserve(InVertexNum * InStride / 2u);
+
+	for (size_t First = 0u; First < InVertexNum; First += BlockVertexNum)
+	{
+		const auto VertexNum = std::min(BlockVertexNum, InVertexNum - First);
+		const auto PaddedNum = RoundUpToGroup(VertexNum);
+
+		for (size_t Byte = 0u; Byte < InStride; ++Byte)
+		{
+			// The padding repeats the last vertex, its deltas are zero.
+			for (size_t Vertex = 0u; Vertex < PaddedNum; ++Vertex)
+			{
+				const auto Value = Vertex < VertexNum ? Bytes[(First + Vertex) * InStride + Byte] : Last[Byte];
+				Plane[Vertex] = ZigzagByte(static_cast<uint8_t>(Value - Last[Byte]));
+				Last[Byte] = Value;
+			}
+
+			EncodePlane(Plane, PaddedNum, Encoded);
+		}
+	}
+
+	return Encoded;
+}
+
+bool MeshCodec::DecodeVertices(const std::span<const std::byte> InEncoded, void* const OutVertices, const size_t InVertexNum, const size_t InStride) noexcept
+{
+	if (InStride == 0u || InStride > MaxStride)
+	{
+		return false;
+	}
+
+	auto* const Bytes = static_cast<uint8_t*>(OutVertices);
+	const auto BlockVertexNum = GetBlockVertexNum(InStride);
+	const auto* Cursor = InEncoded.data();
+	const auto* const End = Cursor + InEncoded.size();
+	uint8_t Last[MaxStride] {};
+	alignas(16) uint8_t Planes[BlockBytes];
+	// Planes of sixteen bytes are transposed into vertices sixteen at a time, the rest of a vertex byte by byte.
+	const auto TransposedBytes = InStride / GroupSize * GroupSize;
+
+	for (size_t First = 0u; First < InVertexNum; First += BlockVertexNum)
+	{
+		const auto VertexNum = std::min(BlockVertexNum, InVertexNum - First);
+		const auto PaddedNum = RoundUpToGroup(VertexNum);
+
+		for (size_t Byte = 0u; Byte < InStride; ++Byte)
+		{
+			auto* const Plane = Planes + Byte * PaddedNum;
+
+			if (!DecodePlane(Cursor, End, PaddedNum, Plane))
+			{
+				return false;
+			}
+
+			for (size_t Group = 0u; Group < PaddedNum; Group += GroupSize)
+			{
+				AccumulateBytes(Plane + Group, Last[Byte]);
+			}
+		}
+
+		for (size_t Byte = 0u; Byte < TransposedBytes; Byte += GroupSize)
+		{
+			for (size_t Group = 0u; Group < PaddedNum; Group += GroupSize)
+			{
+				__m128i Rows[GroupSize];
+
+				for (size_t Row = 0u; Row < GroupSize; ++Row)
+				{
+					Rows[Row] = _mm_load_si128(reinterpret_cast<const __m128i*>(Planes + (Byte + Row) * PaddedNum + Group));
+				}
+
+				Transpose(Rows);
+
+				// The padding past the block's last vertex isn't written.
+				const auto GroupVertexNum = std::min(GroupSize, VertexNum - Group);
+
+				for (size_t Vertex = 0u; Vertex < GroupVertexNum; ++Vertex)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Bytes + (First + Group + Vertex) * InStride + Byte), Rows[Vertex]);
+				}
+			}
+		}
+
+		for (size_t Byte = TransposedBytes; Byte < InStride; ++Byte)
+		{
+			for (size_t Vertex = 0u; Vertex < VertexNum; ++Vertex)
+			{
+				Bytes[(First + Vertex) * InStride + Byte] = Planes[Byte * PaddedNum + Vertex];
+			}
+		}
+	}
+
+	return Cursor == End;
+}
+
+std::vector<std::byte> MeshCodec::EncodeIndices(const std::span<const unsigned int> InIndices)
+{
+	uint8_t Planes[IndexPlaneNum][IndexBlockNum];
+	uint32_t Last = 0u;
+	std::vector<std::byte> Encoded;
+	Encoded.reserve(InIndices.size());
+
+	for (size_t First = 0u; First < InIndices.size(); First += IndexBlockNum)
+	{
+		const auto IndexNum = std::min(IndexBlockNum, InIndices.size() - First);
+		const auto PaddedNum = RoundUpToGroup(IndexNum);
+
+		for (size_t Index = 0u; Index < PaddedNum; ++Index)
+		{
+			const auto Value = Index < IndexNum ? InIndices[First + Index] : Last;
+			const auto Zigzagged = Zigzag(Value - Last);
+			Last = Value;
+
+			for (size_t Plane = 0u; Plane < IndexPlaneNum; ++Plane)
+			{
+				Planes[Plane][Index] = static_cast<uint8_t>(Zigzagged >> (Plane * 8u));
+			}
+		}
+
+		for (const auto& Plane : Planes)
+		{
+			EncodePlane(Plane, PaddedNum, Encoded);
+		}
+	}
+
+	return Encoded;
+}
+
+bool MeshCodec::DecodeIndices(const std::span<const std::byte> InEncoded, const std::span<unsigned int> OutIndices) noexcept
+{
+	const auto* Cursor = InEncoded.data();
+	const auto* const End = Cursor + InEncoded.size();
+	alignas(16) uint8_t Planes[IndexPlaneNum][IndexBlockNum];
+	alignas(16) uint32_t Values[IndexBlockNum];
+	auto Last = _mm_setzero_si128();
+
+	for (size_t First = 0u; First < OutIndices.size(); First += IndexBlockNum)
+	{
+		const auto IndexNum = std::min(IndexBlockNum, OutIndices.size() - First);
+		const auto PaddedNum = RoundUpToGroup(IndexNum);
+
+		for (auto& Plane : Planes)
+		{
+			if (!DecodePlane(Cursor, End, PaddedNum, Plane))
+			{
+				return false;
+			}
+		}
+
+		for (size_t Group = 0u; Group < PaddedNum; Group += GroupSize)
+		{
+			const auto LoadPlane = [&Planes, Group](const size_t InPlane)
+			{
+				return _mm_load_si128(reinterpret_cast<const __m128i*>(Planes[InPlane] + Group));
+			};
+
+			// The four bytes of every index back together, lowest first.
+			const auto Low = LoadPlane(0u);
+			const auto High = LoadPlane(2u);
+			const auto LowWords = _mm_unpacklo_epi8(Low, LoadPlane(1u));
+			const auto LaterLowWords = _mm_unpackhi_epi8(Low, LoadPlane(1u));
+			const auto HighWords = _mm_unpacklo_epi8(High, LoadPlane(3u));
+			const auto LaterHighWords = _mm_unpackhi_epi8(High, LoadPlane(3u));
+			const __m128i Zigzagged[] {_mm_unpacklo_epi16(LowWords, HighWords), _mm_unpackhi_epi16(LowWords, HighWords),
+			                           _mm_unpacklo_epi16(LaterLowWords, LaterHighWords), _mm_unpackhi_epi16(LaterLowWords, LaterHighWords)};
+
+			for (size_t Quad = 0u; Quad < 4u; ++Quad)
+			{
+				const auto Sign = _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(Zigzagged[Quad], _mm_set1_epi32(1)));
+				auto Sum = _mm_xor_si128(_mm_srli_epi32(Zigzagged[Quad], 1), Sign);
+				Sum = _mm_add_epi32(Sum, _mm_slli_si128(Sum, 4));
+				Sum = _mm_add_epi32(Sum, _mm_slli_si128(Sum, 8));
+				Sum = _mm_add_epi32(Sum, Last);
+				Last = _mm_shuffle_epi32(Sum, _MM_SHUFFLE(3, 3, 3, 3));
+				_mm_store_si128(reinterpret_cast<__m128i*>(Values + Group + Quad * 4u), Sum);
+			}
+		}
+
+		memcpy(OutIndices.data() + First, Values, IndexNum * sizeof(uint32_t));
+	}
+
+	return Cursor == End;
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/**
+ * Lossless codec for the vertex and index streams of the MeshCache, after meshoptimizer's. Vertices are split into byte
+ * planes a block at a time, every byte delta coded against the same byte of the vertex before it and zigzagged, so the
+ * attributes that change slowly along the fetch order come out as small values. Indices are delta coded against the index
+ * before them and split into their four byte planes the same way. Each plane is bit packed in groups of 16 at the fewest
+ * of 0, 2, 4 or 8 bits that hold the whole group, which SSE2 unpacks, sums and transposes sixteen values at a time.
+ * Encode after OptimizeVertexFetch, whose first-use order is what keeps the deltas small.
+ */
+namespace MeshCodec
+{
+	// Vertices larger than this are not encoded.
+	constexpr size_t MaxStride {256u};
+	// However well the values pack, every header byte stands for four groups of one plane, so nothing decodes larger.
+	constexpr size_t MaxExpansion {64u};
+
+	[[nodiscard]] std::vector<std::byte> EncodeVertices(const void* InVertices, size_t InVertexNum, size_t InStride);
+	// False unless InEncoded holds exactly InVertexNum vertices of InStride bytes.
+	[[nodiscard]] bool DecodeVertices(std::span<const std::byte> InEncoded, void* OutVertices, size_t InVertexNum, size_t InStride) noexcept;
+
+	[[nodiscard]] std::vector<std::byte> EncodeIndices(std::span<const unsigned int> InIndices);
+	// False unless InEncoded holds exactly as many indices as OutIndices has room for.
+	[[nodiscard]] bool DecodeIndices(std::span<const std::byte> InEncoded, std::span<unsigned int> OutIndices) noexcept;
+}
@@ -0,0 +1,845 @@
+﻿#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <DirectXCollision.h>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	constexpr unsigned int ScoredCacheSize {32u};
+	constexpr float CacheDecayPower {1.5f};
+	constexpr float LastTriangleScore {0.75f};
+	constexpr float ValenceBoostScale {2.0f};
+	constexpr float ValenceBoostPower {0.5f};
+
+	// FIFO size the overdraw clustering simulates, close to what current hardware reuses.
+	constexpr unsigned int SimulatedCacheSize {16u};
+	constexpr unsigned int NoTriangle {~0u};
+
+	// A collapse may turn a remaining triangle by up to about 75 degrees.
+	constexpr double MinCollapseCosine {0.25};
+
+	float ScoreVertex(const int InCachePosition, const unsigned int InRemainingValence) noexcept
+	{
+		if (InRemainingValence == 0u)
+		{
+			return -1.0f;
+		}
+
+		auto Score = 0.0f;
+
+		if (InCachePosition >= 0)
+		{
+			// The last triangle's vertices get a fixed score so its neighbours don't win just by sharing one of them.
+			if (InCachePosition < 3)
+			{
+				Score = LastTriangleScore;
+			}
+			else
+			{
+				constexpr auto Scale = 1.0f / static_cast<float>(ScoredCacheSize - 3u);
+				Score = std::pow(1.0f - static_cast<float>(InCachePosition - 3) * Scale, CacheDecayPower);
+			}
+		}
+
+		// Vertices with few triangles left are finished off first so they can leave the cache for good.
+		return Score + ValenceBoostScale * std::pow(static_cast<float>(InRemainingValence), -ValenceBoostPower);
+	}
+
+	class FifoCache
+	{
+	public:
+		explicit FifoCache(const size_t InVertexNum)
+			: InsertTimes(InVertexNum, 0u)
+		{}
+
+		unsigned int AddTriangle(const unsigned int* InTriangle) noexcept
+		{
+			unsigned int MissNum = 0u;
+
+			for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+			{
+				if (auto& InsertTime = InsertTimes[InTriangle[Corner]]; Time - InsertTime > SimulatedCacheSize)
+				{
+					InsertTime = Time++;
+					++MissNum;
+				}
+			}
+
+			return MissNum;
+		}
+
+		void Flush() noexcept
+		{
+			Time += SimulatedCacheSize + 1u;
+		}
+
+	private:
+		std::vector<unsigned int> InsertTimes;
+		// Starts past the cache size so nothing counts as inserted at time zero.
+		unsigned int Time {SimulatedCacheSize + 1u};
+	};
+
+	// Sum of squared distances to a set of planes, each weighted by the area of the triangle it came from.
+	struct Quadric
+	{
+		double XX {0.0};
+		double XY {0.0};
+		double XZ {0.0};
+		double YY {0.0};
+		double YZ {0.0};
+		double ZZ {0.0};
+		double DX {0.0};
+		double DY {0.0};
+		double DZ {0.0};
+		double DD {0.0};
+		double Weight {0.0};
+
+		void AddPlane(const double InX, const double InY, const double InZ, const double InD, const double InWeight) noexcept
+		{
+			XX += InWeight * InX * InX;
+			XY += InWeight * InX * InY;
+			XZ += InWeight * InX * InZ;
+			YY += InWeight * InY * InY;
+			YZ += InWeight * InY * InZ;
+			ZZ += InWeight * InZ * InZ;
+			DX += InWeight * InD * InX;
+			DY += InWeight * InD * InY;
+			DZ += InWeight * InD * InZ;
+			DD += InWeight * InD * InD;
+			Weight += InWeight;
+		}
+
+		void Add(const Quadric& InOther) noexcept
+		{
+			XX += InOther.XX;
+			XY += InOther.XY;
+			XZ += InOther.XZ;
+			YY += InOther.YY;
+			YZ += InOther.YZ;
+			ZZ += InOther.ZZ;
+			DX += InOther.DX;
+			DY += InOther.DY;
+			DZ += InOther.DZ;
+			DD += InOther.DD;
+			Weight += InOther.Weight;
+		}
+
+		// Mean rather than total, so the error reads as a squared distance however many triangles were merged into the vertex.
+		[[nodiscard]] double Evaluate(const DirectX::XMFLOAT3& InPoint) const noexcept
+		{
+			const double X = InPoint.x;
+			const double Y = InPoint.y;
+			const double Z = InPoint.z;
+
+			const auto Error = XX * X * X + YY * Y * Y + ZZ * Z * Z +
+							   2.0 * (XY * X * Y + XZ * X * Z + YZ * Y * Z + DX * X + DY * Y + DZ * Z) + DD;
+
+			return Weight > 0.0 ? std::max(Error, 0.0) / Weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int From;
+		unsigned int To;
+		double Error;
+	};
+
+	// Twice the triangle's area along its normal, in double so slivers still get a direction.
+	std::array<double, 3> GetTriangleNormal(const DirectX::XMFLOAT3& InCorner0, const DirectX::XMFLOAT3& InCorner1, const DirectX::XMFLOAT3& InCorner2) noexcept
+	{
+		const double Edge1[3] {InCorner1.x - InCorner0.x, InCorner1.y - InCorner0.y, InCorner1.z - InCorner0.z};
+		const double Edge2[3] {InCorner2.x - InCorner0.x, InCorner2.y - InCorner0.y, InCorner2.z - InCorner0.z};
+
+		return {Edge1[1] * Edge2[2] - Edge1[2] * Edge2[1], Edge1[2] * Edge2[0] - Edge1[0] * Edge2[2], Edge1[0] * Edge2[1] - Edge1[1] * Edge2[0]};
+	}
+}
+
+void MeshOptimizer::OptimizeVertexCache(const std::span<unsigned int> InOutIndices, const size_t InVertexNum)
+{
+	assert(InOutIndices.size() % 3u == 0u);
+
+	const auto TriangleNum = static_cast<unsigned int>(InOutIndices.size() / 3u);
+
+	if (TriangleNum == 0u)
+	{
+		return;
+	}
+
+	// Triangles around every vertex, the unemitted ones kept at the front of each vertex's range.
+	std::vector<unsigned int> AdjacencyOffsets(InVertexNum + 1u, 0u);
+	std::vector<unsigned int> RemainingValences(InVertexNum, 0u);
+	std::vector<unsigned int> Adjacency(InOutIndices.size());
+
+	for (const auto Index : InOutIndices)
+	{
+		assert(Index < InVertexNum);
+		++AdjacencyOffsets[Index + 1u];
+	}
+
+	for (size_t Vertex = 0u; Vertex < InVertexNum; ++Vertex)
+	{
+		AdjacencyOffsets[Vertex + 1u] += AdjacencyOffsets[Vertex];
+	}
+
+	for (unsigned int Triangle = 0u; Triangle < TriangleNum; ++Triangle)
+	{
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			const auto Vertex = InOutIndices[Triangle * 3u + Corner];
+			Adjacency[AdjacencyOffsets[Vertex] + RemainingValences[Vertex]++] = Triangle;
+		}
+	}
+
+	std::vector<int> CachePositions(InVertexNum, -1);
+	std::vector<float> VertexScores(InVertexNum);
+
+	for (size_t Vertex = 0u; Vertex < InVertexNum; ++Vertex)
+	{
+		VertexScores[Vertex] = ScoreVertex(-1, RemainingValences[Vertex]);
+	}
+
+	std::vector<float> TriangleScores(TriangleNum);
+
+	for (unsigned int Triangle = 0u; Triangle < TriangleNum; ++Triangle)
+	{
+		const auto* Corners = &InOutIndices[Triangle * 3u];
+		TriangleScores[Triangle] = VertexScores[Corners[0]] + VertexScores[Corners[1]] + VertexScores[Corners[2]];
+	}
+
+	std::vector<bool> bIsEmitted(TriangleNum, false);
+	std::vector<unsigned int> Optimized;
+	Optimized.reserve(InOutIndices.size());
+
+	// Three extra entries for the vertices pushed out by the triangle just emitted.
+	std::array<unsigned int, ScoredCacheSize + 3u> Cache;
+	std::array<unsigned int, ScoredCacheSize + 3u> NextCache;
+	unsigned int CacheNum = 0u;
+
+	unsigned int ScanCursor = 0u;
+	auto BestTriangle = NoTriangle;
+
+	while (Optimized.size() < InOutIndices.size())
+	{
+		// Nothing left around the cached vertices, start over from the first remaining triangle.
+		if (BestTriangle == NoTriangle)
+		{
+			while (bIsEmitted[ScanCursor])
+			{
+				++ScanCursor;
+			}
+
+			BestTriangle = ScanCursor;
+		}
+
+		const auto* Corners = &InOutIndices[BestTriangle * 3u];
+		bIsEmitted[BestTriangle] = true;
+		unsigned int NextCacheNum = 0u;
+
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			const auto Vertex = Corners[Corner];
+			Optimized.push_back(Vertex);
+			NextCache[NextCacheNum++] = Vertex;
+
+			// Swap the emitted triangle past the end of the vertex's remaining range.
+			const auto First = Adjacency.begin() + AdjacencyOffsets[Vertex];
+			const auto Last = First + RemainingValences[Vertex];
+			std::iter_swap(std::find(First, Last, BestTriangle), Last - 1);
+			--RemainingValences[Vertex];
+		}
+
+		for (unsigned int CacheIndex = 0u; CacheIndex < CacheNum; ++CacheIndex)
+		{
+			if (const auto Vertex = Cache[CacheIndex]; Vertex != Corners[0] && Vertex != Corners[1] && Vertex != Corners[2])
+			{
+				NextCache[NextCacheNum++] = Vertex;
+			}
+		}
+
+		for (unsigned int CacheIndex = 0u; CacheIndex < NextCacheNum; ++CacheIndex)
+		{
+			const auto Vertex = NextCache[CacheIndex];
+			CachePositions[Vertex] = CacheIndex < ScoredCacheSize ? static_cast<int>(CacheIndex) : -1;
+			VertexScores[Vertex] = ScoreVertex(CachePositions[Vertex], RemainingValences[Vertex]);
+		}
+
+		// Only triangles around vertices whose score changed can change score themselves.
+		BestTriangle = NoTriangle;
+		auto BestScore = -1.0f;
+
+		for (unsigned int CacheIndex = 0u; CacheIndex < NextCacheNum; ++CacheIndex)
+		{
+			const auto Vertex = NextCache[CacheIndex];
+
+			for (auto Offset = AdjacencyOffsets[Vertex]; Offset < AdjacencyOffsets[Vertex] + RemainingValences[Vertex]; ++Offset)
+			{
+				const auto Triangle = Adjacency[Offset];
+				const auto* TriangleCorners = &InOutIndices[Triangle * 3u];
+				TriangleScores[Triangle] = VertexScores[TriangleCorners[0]] + VertexScores[TriangleCorners[1]] + VertexScores[TriangleCorners[2]];
+
+				if (TriangleScores[Triangle] > BestScore)
+				{
+					BestScore = TriangleScores[Triangle];
+					BestTriangle = Triangle;
+				}
+			}
+		}
+
+		CacheNum = std::min(NextCacheNum, ScoredCacheSize);
+		std::copy_n(NextCache.begin(), CacheNum, Cache.begin());
+	}
+
+	std::copy(Optimized.begin(), Optimized.end(), InOutIndices.begin());
+}
+
+void MeshOptimizer::OptimizeOverdraw(const std::span<unsigned int> InOutIndices, const std::span<const DirectX::XMFLOAT3> InPositions, const float InThreshold)
+{
+	assert(InOutIndices.size() % 3u == 0u);
+
+	const auto TriangleNum = static_cast<unsigned int>(InOutIndices.size() / 3u);
+
+	if (TriangleNum == 0u)
+	{
+		return;
+	}
+
+	FifoCache Cache(InPositions.size());
+
+	// A triangle missing all three vertices usually starts a separate patch, cutting there costs no cache reuse.
+	std::vector<unsigned int> HardBoundaries;
+
+	for (unsigned int Triangle = 0u; Triangle < TriangleNum; ++Triangle)
+	{
+		if (Cache.AddTriangle(&InOutIndices[Triangle * 3u]) == 3u || Triangle == 0u)
+		{
+			HardBoundaries.push_back(Triangle);
+		}
+	}
+
+	HardBoundaries.push_back(TriangleNum);
+
+	// Cut patches further wherever the triangles drawn so far already reuse the cache about as well as the whole patch does.
+	std::vector<unsigned int> ClusterStarts;
+
+	for (size_t Patch = 0u; Patch + 1u < HardBoundaries.size(); ++Patch)
+	{
+		const auto First = HardBoundaries[Patch];
+		const auto Last = HardBoundaries[Patch + 1u];
+
+		Cache.Flush();
+		unsigned int PatchMissNum = 0u;
+
+		for (auto Triangle = First; Triangle < Last; ++Triangle)
+		{
+			PatchMissNum += Cache.AddTriangle(&InOutIndices[Triangle * 3u]);
+		}
+
+		const auto TargetMissRatio = InThreshold * static_cast<float>(PatchMissNum) / static_cast<float>(Last - First);
+
+		Cache.Flush();
+		ClusterStarts.push_back(First);
+		unsigned int RunningMissNum = 0u;
+		unsigned int RunningTriangleNum = 0u;
+
+		for (auto Triangle = First; Triangle < Last; ++Triangle)
+		{
+			RunningMissNum += Cache.AddTriangle(&InOutIndices[Triangle * 3u]);
+			++RunningTriangleNum;
+
+			if (Triangle + 1u < Last && static_cast<float>(RunningMissNum) <= TargetMissRatio * static_cast<float>(RunningTriangleNum))
+			{
+				ClusterStarts.push_back(Triangle + 1u);
+				Cache.Flush();
+				RunningMissNum = 0u;
+				RunningTriangleNum = 0u;
+			}
+		}
+	}
+
+	ClusterStarts.push_back(TriangleNum);
+
+	const auto GetCorner = [&](const unsigned int InTriangle, const unsigned int InCorner)
+	{
+		return DirectX::XMLoadFloat3(&InPositions[InOutIndices[InTriangle * 3u + InCorner]]);
+	};
+
+	// Area weighted centroid and normal of every cluster, the normal's length is twice the area.
+	const auto ClusterNum = ClusterStarts.size() - 1u;
+	std::vector<DirectX::XMFLOAT3> ClusterCentroids(ClusterNum);
+	std::vector<DirectX::XMFLOAT3> ClusterNormals(ClusterNum);
+	auto MeshCentroid = DirectX::XMVectorZero();
+	auto MeshArea = 0.0f;
+
+	for (size_t Cluster = 0u; Cluster < ClusterNum; ++Cluster)
+	{
+		auto Centroid = DirectX::XMVectorZero();
+		auto Normal = DirectX::XMVectorZero();
+		auto Area = 0.0f;
+
+		for (auto Triangle = ClusterStarts[Cluster]; Triangle < ClusterStarts[Cluster + 1u]; ++Triangle)
+		{
+			const auto Corner0 = GetCorner(Triangle, 0u);
+			const auto Corner1 = GetCorner(Triangle, 1u);
+			const auto Corner2 = GetCorner(Triangle, 2u);
+			const auto TriangleNormal = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(Corner1, Corner0), DirectX::XMVectorSubtract(Corner2, Corner0));
+			const auto TriangleArea = DirectX::XMVectorGetX(DirectX::XMVector3Length(TriangleNormal));
+			const auto TriangleCentroid = DirectX::XMVectorScale(DirectX::XMVectorAdd(DirectX::XMVectorAdd(Corner0, Corner1), Corner2), 1.0f / 3.0f);
+
+			Centroid = DirectX::XMVectorAdd(Centroid, DirectX::XMVectorScale(TriangleCentroid, TriangleArea));
+			Normal = DirectX::XMVectorAdd(Normal, TriangleNormal);
+			Area += TriangleArea;
+		}
+
+		MeshCentroid = DirectX::XMVectorAdd(MeshCentroid, Centroid);
+		MeshArea += Area;
+
+		DirectX::XMStoreFloat3(&ClusterCentroids[Cluster], Area > 0.0f ? DirectX::XMVectorScale(Centroid, 1.0f / Area) : GetCorner(ClusterStarts[Cluster], 0u));
+		DirectX::XMStoreFloat3(&ClusterNormals[Cluster], DirectX::XMVector3Normalize(Normal));
+	}
+
+	MeshCentroid = MeshArea > 0.0f ? DirectX::XMVectorScale(MeshCentroid, 1.0f / MeshArea) : MeshCentroid;
+
+	// Clusters facing away from the middle of the mesh are on its outside and go first.
+	std::vector<float> Outwardness(ClusterNum);
+	std::vector<unsigned int> ClusterOrder(ClusterNum);
+
+	for (size_t Cluster = 0u; Cluster < ClusterNum; ++Cluster)
+	{
+		const auto Offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&ClusterCentroids[Cluster]), MeshCentroid);
+		Outwardness[Cluster] = DirectX::XMVectorGetX(DirectX::XMVector3Dot(Offset, DirectX::XMLoadFloat3(&ClusterNormals[Cluster])));
+		ClusterOrder[Cluster] = static_cast<unsigned int>(Cluster);
+	}
+
+	std::stable_sort(ClusterOrder.begin(), ClusterOrder.end(), [&Outwardness](const unsigned int InLeft, const unsigned int InRight)
+	{
+		return Outwardness[InLeft] > Outwardness[InRight];
+	});
+
+	std::vector<unsigned int> Reordered;
+	Reordered.reserve(InOutIndices.size());
+
+	for (const auto Cluster : ClusterOrder)
+	{
+		Reordered.insert(Reordered.end(), InOutIndices.begin() + ClusterStarts[Cluster] * 3u, InOutIndices.begin() + ClusterStarts[Cluster + 1u] * 3u);
+	}
+
+	std::copy(Reordered.begin(), Reordered.end(), InOutIndices.begin());
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(const std::span<unsigned int> InOutIndices, void* InOutVertices, const size_t InVertexNum, const size_t InStride,
+                                          std::vector<unsigned int>* OutRemap)
+{
+	std::vector<unsigned int> Remap(InVertexNum, UnusedVertex);
+	unsigned int UsedNum = 0u;
+
+	for (auto& Index : InOutIndices)
+	{
+		assert(Index < InVertexNum);
+
+		if (Remap[Index] == UnusedVertex)
+		{
+			Remap[Index] = UsedNum++;
+		}
+
+		Index = Remap[Index];
+	}
+
+	auto* const Vertices = static_cast<unsigned char*>(InOutVertices);
+	std::vector<unsigned char> Packed(static_cast<size_t>(UsedNum) * InStride);
+
+	for (size_t Vertex = 0u; Vertex < InVertexNum; ++Vertex)
+	{
+		if (Remap[Vertex] != UnusedVertex)
+		{
+			std::memcpy(Packed.data() + Remap[Vertex] * InStride, Vertices + Vertex * InStride, InStride);
+		}
+	}
+
+	std::memcpy(Vertices, Packed.data(), Packed.size());
+
+	if (OutRemap)
+	{
+		*OutRemap = std::move(Remap);
+	}
+
+	return UsedNum;
+}
+
+std::vector<unsigned int> MeshOptimizer::Simplify(const std::span<const unsigned int> InIndices, const std::span<const DirectX::XMFLOAT3> InPositions,
+                                                  const size_t InTargetIndexNum, float& OutError)
+{
+	assert(InIndices.size() % 3u == 0u);
+
+	const auto VertexNum = InPositions.size();
+	std::vector<unsigned int> Indices(InIndices.begin(), InIndices.end());
+	std::vector<bool> bIsLocked(VertexNum, false);
+	OutError = 0.0f;
+
+	// Vertices sharing a position were split along a normal or texture seam, moving one of them would tear the surface open.
+	std::vector<unsigned int> PositionOrder(VertexNum);
+	std::iota(PositionOrder.begin(), PositionOrder.end(), 0u);
+
+	const auto IsPositionLess = [&InPositions](const unsigned int InLeft, const unsigned int InRight)
+	{
+		const auto& Left = InPositions[InLeft];
+		const auto& Right = InPositions[InRight];
+		return Left.x != Right.x ? Left.x < Right.x : Left.y != Right.y ? Left.y < Right.y : Left.z < Right.z;
+	};
+
+	std::sort(PositionOrder.begin(), PositionOrder.end(), IsPositionLess);
+
+	for (size_t Order = 1u; Order < VertexNum; ++Order)
+	{
+		if (!IsPositionLess(PositionOrder[Order - 1u], PositionOrder[Order]))
+		{
+			bIsLocked[PositionOrder[Order - 1u]] = true;
+			bIsLocked[PositionOrder[Order]] = true;
+		}
+	}
+
+	// An edge with one triangle is on the boundary and one with more is non-manifold, either way its vertices stay.
+	std::vector<uint64_t> Edges;
+	Edges.reserve(Indices.size());
+
+	for (size_t Triangle = 0u; Triangle < Indices.size(); Triangle += 3u)
+	{
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			const auto First = Indices[Triangle + Corner];
+			const auto Second = Indices[Triangle + (Corner + 1u) % 3u];
+			Edges.push_back(static_cast<uint64_t>(std::min(First, Second)) << 32u | std::max(First, Second));
+		}
+	}
+
+	std::sort(Edges.begin(), Edges.end());
+
+	for (size_t First = 0u, Last = 0u; First < Edges.size(); First = Last)
+	{
+		while (Last < Edges.size() && Edges[Last] == Edges[First])
+		{
+			++Last;
+		}
+
+		if (Last - First != 2u)
+		{
+			bIsLocked[static_cast<size_t>(Edges[First] >> 32u)] = true;
+			bIsLocked[static_cast<size_t>(Edges[First] & 0xFFFFFFFFu)] = true;
+		}
+	}
+
+	std::vector<Quadric> Quadrics(VertexNum);
+
+	for (size_t Triangle = 0u; Triangle < Indices.size(); Triangle += 3u)
+	{
+		const auto& Corner0 = InPositions[Indices[Triangle]];
+		const auto Normal = GetTriangleNormal(Corner0, InPositions[Indices[Triangle + 1u]], InPositions[Indices[Triangle + 2u]]);
+		const auto Length = std::sqrt(Normal[0] * Normal[0] + Normal[1] * Normal[1] + Normal[2] * Normal[2]);
+
+		if (Length <= 0.0)
+		{
+			continue;
+		}
+
+		const auto X = Normal[0] / Length;
+		const auto Y = Normal[1] / Length;
+		const auto Z = Normal[2] / Length;
+		const auto D = -(X * Corner0.x + Y * Corner0.y + Z * Corner0.z);
+
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			Quadrics[Indices[Triangle + Corner]].AddPlane(X, Y, Z, D, 0.5 * Length);
+		}
+	}
+
+	std::vector<unsigned int> AdjacencyOffsets;
+	std::vector<unsigned int> Adjacency;
+	std::vector<Collapse> Collapses;
+	std::vector<bool> bIsTouched;
+
+	// Every pass collapses the cheapest edges whose neighbourhoods don't overlap, then rebuilds the triangles.
+	while (Indices.size() > InTargetIndexNum)
+	{
+		const auto TriangleNum = Indices.size() / 3u;
+
+		AdjacencyOffsets.assign(VertexNum + 1u, 0u);
+		Adjacency.resize(Indices.size());
+
+		for (const auto Index : Indices)
+		{
+			++AdjacencyOffsets[Index + 1u];
+		}
+
+		for (size_t Vertex = 0u; Vertex < VertexNum; ++Vertex)
+		{
+			AdjacencyOffsets[Vertex + 1u] += AdjacencyOffsets[Vertex];
+		}
+
+		std::vector<unsigned int> Filled(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+
+		for (size_t Corner = 0u; Corner < Indices.size(); ++Corner)
+		{
+			Adjacency[Filled[Indices[Corner]]++] = static_cast<unsigned int>(Corner / 3u);
+		}
+
+		Collapses.clear();
+
+		for (size_t Triangle = 0u; Triangle < Indices.size(); Triangle += 3u)
+		{
+			for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+			{
+				const auto From = Indices[Triangle + Corner];
+				const auto To = Indices[Triangle + (Corner + 1u) % 3u];
+
+				for (const auto& [Source, Target] : {std::pair(From, To), std::pair(To, From)})
+				{
+					if (!bIsLocked[Source])
+					{
+						auto Merged = Quadrics[Source];
+						Merged.Add(Quadrics[Target]);
+						Collapses.push_back({Source, Target, Merged.Evaluate(InPositions[Target])});
+					}
+				}
+			}
+		}
+
+		std::sort(Collapses.begin(), Collapses.end(), [](const Collapse& InLeft, const Collapse& InRight)
+		{
+			return InLeft.Error < InRight.Error;
+		});
+
+		// A collapse usually removes two triangles, so the cheapest ones are about as many as the pass may take.
+		const auto RemovalGoal = TriangleNum - InTargetIndexNum / 3u;
+		size_t RemovedNum = 0u;
+		bIsTouched.assign(VertexNum, false);
+
+		for (const auto& [From, To, Error] : Collapses)
+		{
+			if (RemovedNum >= RemovalGoal)
+			{
+				break;
+			}
+
+			if (bIsTouched[From] || bIsTouched[To])
+			{
+				continue;
+			}
+
+			unsigned int CollapsedNum = 0u;
+			bool bIsFlipping = false;
+
+			for (auto Offset = AdjacencyOffsets[From]; Offset < AdjacencyOffsets[From + 1u] && !bIsFlipping; ++Offset)
+			{
+				const auto* Corners = &Indices[Adjacency[Offset] * 3u];
+
+				if (Corners[0] == To || Corners[1] == To || Corners[2] == To)
+				{
+					++CollapsedNum;
+					continue;
+				}
+
+				// The triangles that stay must keep roughly facing the same way once the vertex moves, a fold or a sliver standing on edge is rejected.
+				const auto GetMoved = [&](const unsigned int InVertex) -> const DirectX::XMFLOAT3&
+				{
+					return InPositions[InVertex == From ? To : InVertex];
+				};
+
+				const auto Before = GetTriangleNormal(InPositions[Corners[0]], InPositions[Corners[1]], InPositions[Corners[2]]);
+				const auto After = GetTriangleNormal(GetMoved(Corners[0]), GetMoved(Corners[1]), GetMoved(Corners[2]));
+				const auto Dot = Before[0] * After[0] + Before[1] * After[1] + Before[2] * After[2];
+				const auto LengthProduct = std::sqrt((Before[0] * Before[0] + Before[1] * Before[1] + Before[2] * Before[2]) *
+													 (After[0] * After[0] + After[1] * After[1] + After[2] * After[2]));
+				bIsFlipping = Dot <= MinCollapseCosine * LengthProduct;
+			}
+
+			if (bIsFlipping || CollapsedNum == 0u)
+			{
+				continue;
+			}
+
+			for (auto Offset = AdjacencyOffsets[From]; Offset < AdjacencyOffsets[From + 1u]; ++Offset)
+			{
+				for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+				{
+					bIsTouched[Indices[Adjacency[Offset] * 3u + Corner]] = true;
+				}
+			}
+
+			Quadrics[To].Add(Quadrics[From]);
+
+			for (auto Offset = AdjacencyOffsets[From]; Offset < AdjacencyOffsets[From + 1u]; ++Offset)
+			{
+				for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+				{
+					if (auto& Index = Indices[Adjacency[Offset] * 3u + Corner]; Index == From)
+					{
+						Index = To;
+					}
+				}
+			}
+
+			OutError = std::max(OutError, static_cast<float>(std::sqrt(Error)));
+			RemovedNum += CollapsedNum;
+		}
+
+		if (RemovedNum == 0u)
+		{
+			break;
+		}
+
+		// Collapsed triangles now repeat a vertex.
+		size_t KeptNum = 0u;
+
+		for (size_t Triangle = 0u; Triangle < Indices.size(); Triangle += 3u)
+		{
+			const auto Index0 = Indices[Triangle];
+			const auto Index1 = Indices[Triangle + 1u];
+			const auto Index2 = Indices[Triangle + 2u];
+
+			if (Index0 != Index1 && Index1 != Index2 && Index2 != Index0)
+			{
+				Indices[KeptNum++] = Index0;
+				Indices[KeptNum++] = Index1;
+				Indices[KeptNum++] = Index2;
+			}
+		}
+
+		Indices.resize(KeptNum);
+	}
+
+	return Indices;
+}
+
+std::vector<MeshOptimizer::Meshlet> MeshOptimizer::BuildMeshlets(const std::span<const unsigned int> InIndices, const void* InPositions,
+                                                                 const size_t InVertexNum, const size_t InStride)
+{
+	assert(InIndices.size() % 3u == 0u);
+
+	constexpr auto NoMeshlet = ~0u;
+	// Below this the normals spread over more than about 84 degrees from the axis and nothing could ever be culled.
+	constexpr float MinConeDot {0.1f};
+
+	const auto* const Bytes = static_cast<const unsigned char*>(InPositions);
+	const auto GetPosition = [&](const unsigned int InVertex)
+	{
+		DirectX::XMFLOAT3 Position;
+		std::memcpy(&Position, Bytes + InVertex * InStride, sizeof(Position));
+		return Position;
+	};
+
+	std::vector<Meshlet> Meshlets;
+	// The meshlet each vertex was last added to, so shared vertices are only counted once per meshlet.
+	std::vector<unsigned int> Owners(InVertexNum, NoMeshlet);
+	std::vector<DirectX::XMFLOAT3> Points;
+	Points.reserve(MaxMeshletVertexNum);
+	std::vector<DirectX::XMVECTOR> Normals;
+	Normals.reserve(MaxMeshletTriangleNum);
+
+	Meshlet Current {};
+
+	const auto Finish = [&]
+	{
+		DirectX::BoundingSphere Sphere;
+		DirectX::BoundingSphere::CreateFromPoints(Sphere, Points.size(), Points.data(), sizeof(DirectX::XMFLOAT3));
+		Current.Center = Sphere.Center;
+		Current.Radius = Sphere.Radius;
+
+		Normals.clear();
+		auto NormalSum = DirectX::XMVectorZero();
+
+		for (auto Index = Current.FirstIndex; Index < Current.FirstIndex + Current.TriangleNum * 3u; Index += 3u)
+		{
+			const auto Position0 = GetPosition(InIndices[Index]);
+			const auto Position1 = GetPosition(InIndices[Index + 1u]);
+			const auto Position2 = GetPosition(InIndices[Index + 2u]);
+			const auto Vertex0 = DirectX::XMLoadFloat3(&Position0);
+
+			// Facing the viewer when it sees the triangle clockwise, as the rasterizer culls with front faces clockwise.
+			const auto Normal = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Position1), Vertex0),
+			                                            DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&Position2), Vertex0));
+
+			// Degenerate triangles cover nothing and don't widen the cone.
+			if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(Normal)) > 0.0f)
+			{
+				Normals.push_back(DirectX::XMVector3Normalize(Normal));
+				NormalSum = DirectX::XMVectorAdd(NormalSum, Normals.back());
+			}
+		}
+
+		Current.ConeAxis = {0.0f, 0.0f, 1.0f};
+		Current.ConeCutoff = 1.0f;
+
+		if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(NormalSum)) > 0.0f)
+		{
+			const auto Axis = DirectX::XMVector3Normalize(NormalSum);
+			auto MinDot = 1.0f;
+
+			for (const auto& Normal : Normals)
+			{
+				MinDot = std::min(MinDot, DirectX::XMVectorGetX(DirectX::XMVector3Dot(Normal, Axis)));
+			}
+
+			DirectX::XMStoreFloat3(&Current.ConeAxis, Axis);
+
+			if (MinDot > MinConeDot)
+			{
+				Current.ConeCutoff = std::sqrt(1.0f - MinDot * MinDot);
+			}
+		}
+
+		Meshlets.push_back(Current);
+		Current = {};
+		Current.FirstIndex = Meshlets.back().FirstIndex + Meshlets.back().TriangleNum * 3u;
+		Points.clear();
+	};
+
+	for (size_t Index = 0u; Index < InIndices.size(); Index += 3u)
+	{
+		const auto Id = static_cast<unsigned int>(Meshlets.size());
+		const auto* const Triangle = InIndices.data() + Index;
+
+		unsigned int NewVertexNum = 0u;
+
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			const auto Vertex = Triangle[Corner];
+			const auto bIsRepeated = (Corner > 0u && Vertex == Triangle[0]) || (Corner > 1u && Vertex == Triangle[1]);
+
+			if (Owners[Vertex] != Id && !bIsRepeated)
+			{
+				++NewVertexNum;
+			}
+		}
+
+		if (Current.TriangleNum == MaxMeshletTriangleNum || Points.size() + NewVertexNum > MaxMeshletVertexNum)
+		{
+			Finish();
+		}
+
+		for (unsigned int Corner = 0u; Corner < 3u; ++Corner)
+		{
+			if (const auto Vertex = Triangle[Corner]; Owners[Vertex] != static_cast<unsigned int>(Meshlets.size()))
+			{
+				Owners[Vertex] = static_cast<unsigned int>(Meshlets.size());
+				Points.push_back(GetPosition(Vertex));
+			}
+		}
+
+		++Current.TriangleNum;
+	}
+
+	if (Current.TriangleNum > 0u)
+	{
+		Finish();
+	}
+
+	return Meshlets;
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <DirectXMath.h>
+#include <span>
+#include <vector>
+
+/**
+ * Import-time triangle and vertex reordering, run once per mesh before it is written to the MeshCache.
+ * Apply in order: vertex cache, then overdraw (which keeps most of the cache order), then vertex fetch.
+ * Levels of detail are simplified from the ordered indices before the vertex fetch pass, which then runs over every level at once.
+ */
+namespace MeshOptimizer
+{
+	// Limits of one meshlet, small enough that a cluster's triangles fill one compute group.
+	constexpr unsigned int MaxMeshletVertexNum {64u};
+	constexpr unsigned int MaxMeshletTriangleNum {124u};
+
+	// A run of consecutive triangles culled as a whole, in the mesh's own space.
+	struct Meshlet
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		// Every triangle faces away from a viewpoint P when dot(Center - P, ConeAxis) >= ConeCutoff * length(Center - P) + Radius.
+		// A cutoff of one never culls, for clusters whose normals spread too far.
+		DirectX::XMFLOAT3 ConeAxis;
+		float ConeCutoff;
+		unsigned int FirstIndex;
+		unsigned int TriangleNum;
+	};
+
+	// Forsyth's linear-speed ordering, consecutive triangles reuse vertices still in the post-transform cache.
+	void OptimizeVertexCache(std::span<unsigned int> InOutIndices, size_t InVertexNum);
+
+	/**
+	 * Splits cache-ordered triangles into clusters where the simulated cache starts over and sorts the clusters so the most
+	 * outward facing are drawn first and occlude the rest. A cluster is also cut wherever its running miss ratio gets within
+	 * InThreshold times the miss ratio of its whole stretch, larger values give more clusters and less overdraw.
+	 */
+	void OptimizeOverdraw(std::span<unsigned int> InOutIndices, std::span<const DirectX::XMFLOAT3> InPositions, float InThreshold = 1.05f);
+
+	// Where OptimizeVertexFetch moves a vertex no index references.
+	constexpr unsigned int UnusedVertex {~0u};
+
+	// Renumbers vertices in first-use order and packs them to the front, returns how many are still referenced.
+	// OutRemap, when given, receives the new index of every old vertex, for data kept beside the vertices.
+	[[nodiscard]] size_t OptimizeVertexFetch(std::span<unsigned int> InOutIndices, void* InOutVertices, size_t InVertexNum, size_t InStride,
+	                                         std::vector<unsigned int>* OutRemap = nullptr);
+
+	/**
+	 * Quadric error edge collapse until at most InTargetIndexNum indices are left or nothing else can collapse.
+	 * Vertices only ever collapse onto other vertices, so the result indexes the same vertex buffer. Boundary vertices and
+	 * vertices split along attribute seams never move, which keeps the simplified surface closed wherever the source was.
+	 * OutError receives the largest error accepted, roughly how far the surface moved in the positions' units.
+	 */
+	[[nodiscard]] std::vector<unsigned int> Simplify(std::span<const unsigned int> InIndices, std::span<const DirectX::XMFLOAT3> InPositions,
+	                                                 size_t InTargetIndexNum, float& OutError);
+
+	/**
+	 * Cuts the triangles into meshlets in the order they already have, starting a new one whenever the next triangle would
+	 * take it past MaxMeshletVertexNum or MaxMeshletTriangleNum. Run last, on the final indices, so the cache order is kept
+	 * and every meshlet is one contiguous index range. Positions are read InStride bytes apart.
+	 */
+	[[nodiscard]] std::vector<Meshlet> BuildMeshlets(std::span<const unsigned int> InIndices, const void* InPositions, size_t InVertexNum, size_t InStride);
+}
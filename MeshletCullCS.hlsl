@@ -0,0 +1,123 @@
+#include "HiZ.hlsli"
+
+// One per meshlet, in mesh space.
+struct Cluster
+{
+    float3 Center;
+    float Radius;
+    float3 ConeAxis;
+    float ConeCutoff;
+    // Into the index page.
+    uint FirstIndex;
+    uint TriangleNum;
+    uint DrawIndex;
+    uint Padding;
+};
+
+// One per mesh, its visible triangles are compacted from OutputFirstIndex on.
+struct Draw
+{
+    matrix Model;
+    float3 LocalCameraPosition;
+    float Scale;
+    uint OutputFirstIndex;
+    uint bIsConeCulled;
+    uint2 Padding;
+};
+
+StructuredBuffer<Cluster> Clusters : register(t0);
+StructuredBuffer<Draw> Draws : register(t1);
+ByteAddressBuffer SourceIndices : register(t2);
+Texture2D<float> Pyramid : register(t3);
+RWByteAddressBuffer Arguments : register(u0);
+RWByteAddressBuffer CompactedIndices : register(u1);
+
+cbuffer Cull : register(b0)
+{
+    matrix ViewProjection;
+    // Clip space planes facing inwards, not normalized.
+    float4 FrustumPlanes[6];
+    float2 PyramidSize;
+    uint PyramidMipNum;
+    uint bHasPyramid;
+    uint FirstCluster;
+    // 16 bit pages hold two indices per word, the lower half first.
+    uint bIsShortIndex;
+}
+
+// D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, the index count is the first value.
+static const uint ArgumentStride = 20u;
+
+groupshared uint OutputIndex;
+groupshared uint bIsClusterVisible;
+
+uint LoadIndex(const uint InIndex)
+{
+    if (bIsShortIndex)
+    {
+        const uint Word = SourceIndices.Load((InIndex >> 1u) * 4u);
+        return InIndex & 1u ? Word >> 16u : Word & 0xFFFFu;
+    }
+
+    return SourceIndices.Load(InIndex * 4u);
+}
+
+bool IsVisible(const Cluster InCluster, const Draw InOwner)
+{
+    // Every triangle of the cluster faces away from the camera.
+    if (InOwner.bIsConeCulled)
+    {
+        const float3 Offset = InCluster.Center - InOwner.LocalCameraPosition;
+
+        if (dot(Offset, InCluster.ConeAxis) >= InCluster.ConeCutoff * length(Offset) + InCluster.Radius)
+        {
+            return false;
+        }
+    }
+
+    const float3 Center = mul(float4(InCluster.Center, 1.0f), InOwner.Model).xyz;
+    const float Radius = InCluster.Radius * InOwner.Scale;
+
+    [unroll]
+    for (uint Plane = 0u; Plane < 6u; ++Plane)
+    {
+        if (dot(FrustumPlanes[Plane].xyz, Center) + FrustumPlanes[Plane].w < -Radius * length(FrustumPlanes[Plane].xyz))
+        {
+            return false;
+        }
+    }
+
+    return !bHasPyramid || IsBoxUnoccluded(Pyramid, Center, Radius.xxx, ViewProjection, PyramidSize, PyramidMipNum);
+}
+
+// One group per meshlet, one thread per triangle.
+[numthreads(128, 1, 1)]
+void main(const uint3 InGroupID : SV_GroupID, const uint InThreadIndex : SV_GroupIndex)
+{
+    const Cluster Target = Clusters[FirstCluster + InGroupID.x];
+    const Draw Owner = Draws[Target.DrawIndex];
+
+    if (InThreadIndex == 0u)
+    {
+        bIsClusterVisible = IsVisible(Target, Owner);
+
+        if (bIsClusterVisible)
+        {
+            uint Reserved;
+            Arguments.InterlockedAdd(Target.DrawIndex * ArgumentStride, Target.TriangleNum * 3u, Reserved);
+            OutputIndex = Reserved;
+        }
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (!bIsClusterVisible || InThreadIndex >= Target.TriangleNum)
+    {
+        return;
+    }
+
+    const uint Source = Target.FirstIndex + InThreadIndex * 3u;
+    const uint3 Triangle = uint3(LoadIndex(Source), LoadIndex(Source + 1u), LoadIndex(Source + 2u));
+
+    CompactedIndices.Store3((Owner.OutputFirstIndex + OutputIndex + InThreadIndex * 3u) * 4u, Triangle);
+}
@@ -0,0 +1,238 @@
+﻿#include "MeshletCuller.h"
+#include <algorithm>
+#include <cstring>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	static_assert(MeshOptimizer::MaxMeshletTriangleNum <= 128u, "A meshlet's triangles have to fit one cull group");
+
+	void CreateDynamicStructuredBuffer(ID3D11Device* InDevice, const UINT InStride, const UINT InNum, Microsoft::WRL::ComPtr<ID3D11Buffer>& OutBuffer,
+	                                   Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& OutView)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC Desc {};
+		Desc.ByteWidth = InStride * InNum;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		Desc.StructureByteStride = InStride;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&Desc, nullptr, &OutBuffer))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(OutBuffer.Get(), nullptr, &OutView))
+	}
+
+	void CreateRawUav(ID3D11Device* InDevice, ID3D11Buffer* InBuffer, const UINT InByteWidth, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>& OutUav)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC UavDesc {};
+		UavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		UavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		UavDesc.Buffer.NumElements = InByteWidth / sizeof(UINT);
+		UavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(InBuffer, &UavDesc, &OutUav))
+	}
+
+	void Upload(ID3D11DeviceContext* InContext, ID3D11Buffer* InBuffer, const void* InData, const size_t InByteSize)
+	{
+		HRESULT ResultHandle;
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+		CHECK_HRESULT_EXCEPTION(InContext->Map(InBuffer, 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		std::memcpy(MappedResource.pData, InData, InByteSize);
+		InContext->Unmap(InBuffer, 0u);
+	}
+}
+
+MeshletCuller::MeshletCuller(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+{
+	HRESULT ResultHandle;
+	const auto Blob = InShaderBundle.Load("MeshletCullCS.cso");
+
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &CullShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(CullConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &CullConstantBuffer))
+
+	CreateDynamicStructuredBuffer(InDevice, sizeof(Cluster), MaxMeshletNum, ClusterBuffer, ClusterBufferView);
+	CreateDynamicStructuredBuffer(InDevice, sizeof(Draw), MaxMeshNum, DrawBuffer, DrawBufferView);
+
+	// Written as raw words by the cull shader, read by the input assembler as R32_UINT indices.
+	constexpr auto IndicesByteWidth = MaxIndexNum * sizeof(UINT);
+
+	D3D11_BUFFER_DESC IndicesDesc {};
+	IndicesDesc.ByteWidth = IndicesByteWidth;
+	IndicesDesc.Usage = D3D11_USAGE_DEFAULT;
+	IndicesDesc.BindFlags = D3D11_BIND_INDEX_BUFFER | D3D11_BIND_UNORDERED_ACCESS;
+	IndicesDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&IndicesDesc, nullptr, &Indices))
+	CreateRawUav(InDevice, Indices.Get(), IndicesByteWidth, IndicesUav);
+
+	constexpr auto ArgumentsByteWidth = MaxMeshNum * ArgumentStride;
+
+	D3D11_BUFFER_DESC ArgumentsDesc {};
+	ArgumentsDesc.ByteWidth = ArgumentsByteWidth;
+	ArgumentsDesc.Usage = D3D11_USAGE_DEFAULT;
+	ArgumentsDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	ArgumentsDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ArgumentsDesc, nullptr, &Arguments))
+	CreateRawUav(InDevice, Arguments.Get(), ArgumentsByteWidth, ArgumentsUav);
+
+	Draws.reserve(MaxMeshNum);
+	InitialArguments.reserve(MaxMeshNum);
+}
+
+void MeshletCuller::BeginFrame() noexcept
+{
+	LastMeshNum = static_cast<unsigned int>(Draws.size());
+	LastMeshletNum = static_cast<unsigned int>(Clusters.size());
+
+	Clusters.clear();
+	Draws.clear();
+	Batches.clear();
+	InitialArguments.clear();
+	ReservedIndexNum = 0u;
+}
+
+unsigned int MeshletCuller::AddMesh(const std::span<const MeshOptimizer::Meshlet> InMeshlets, DirectX::FXMMATRIX InWorld,
+                                    DirectX::FXMVECTOR InCameraPosition, ID3D11ShaderResourceView* InIndexView, const DXGI_FORMAT InIndexFormat,
+                                    const UINT InStartIndex, const INT InBaseVertex, const bool bInIsConeCulled)
+{
+	UINT IndexNum = 0u;
+
+	for (const auto& Source : InMeshlets)
+	{
+		IndexNum += Source.TriangleNum * 3u;
+	}
+
+	if (!bIsEnabled || InMeshlets.empty() || !InIndexView || Draws.size() == MaxMeshNum || Clusters.size() + InMeshlets.size() > MaxMeshletNum ||
+	    ReservedIndexNum + IndexNum > MaxIndexNum)
+	{
+		return NoSlot;
+	}
+
+	const auto Slot = static_cast<unsigned int>(Draws.size());
+
+	auto& Added = Draws.emplace_back();
+	DirectX::XMStoreFloat4x4(&Added.Model, DirectX::XMMatrixTranspose(InWorld));
+	DirectX::XMStoreFloat3(&Added.LocalCameraPosition, DirectX::XMVector3TransformCoord(InCameraPosition, DirectX::XMMatrixInverse(nullptr, InWorld)));
+	Added.Scale = std::max({DirectX::XMVectorGetX(DirectX::XMVector3Length(InWorld.r[0])),
+	                        DirectX::XMVectorGetX(DirectX::XMVector3Length(InWorld.r[1])),
+	                        DirectX::XMVectorGetX(DirectX::XMVector3Length(InWorld.r[2]))});
+	Added.OutputFirstIndex = ReservedIndexNum;
+	Added.bIsConeCulled = bInIsConeCulled;
+
+	// The count starts at zero and is added to by every visible meshlet, the compacted indices need the mesh's own base vertex still.
+	InitialArguments.push_back({0u, 1u, ReservedIndexNum, static_cast<UINT>(InBaseVertex), 0u});
+	ReservedIndexNum += IndexNum;
+
+	const auto bIsShortIndex = InIndexFormat == DXGI_FORMAT_R16_UINT;
+
+	if (Batches.empty() || Batches.back().IndexView != InIndexView || Batches.back().bIsShortIndex != bIsShortIndex)
+	{
+		Batches.push_back({InIndexView, bIsShortIndex, static_cast<UINT>(Clusters.size()), 0u});
+	}
+
+	for (const auto& Source : InMeshlets)
+	{
+		Clusters.push_back({Source.Center, Source.Radius, Source.ConeAxis, Source.ConeCutoff, InStartIndex + Source.FirstIndex, Source.TriangleNum, Slot, 0u});
+	}
+
+	Batches.back().ClusterNum += static_cast<UINT>(InMeshlets.size());
+
+	return Slot;
+}
+
+void MeshletCuller::Cull(const Graphics& InGraphics)
+{
+	if (Draws.empty())
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Meshlet cull");
+
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	auto* const Context = ImmediateContext.GetDeviceContext();
+
+	// The last compacted draw may have left the buffer bound as indices, it cannot be written meanwhile.
+	ImmediateContext.GetStateCache().SetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN);
+
+	Upload(Context, ClusterBuffer.Get(), Clusters.data(), Clusters.size() * sizeof(Cluster));
+	Upload(Context, DrawBuffer.Get(), Draws.data(), Draws.size() * sizeof(Draw));
+
+	const D3D11_BOX ArgumentsBox {0u, 0u, 0u, static_cast<UINT>(InitialArguments.size()) * ArgumentStride, 1u, 1u};
+	Context->UpdateSubresource(Arguments.Get(), 0u, &ArgumentsBox, InitialArguments.data(), 0u, 0u);
+
+	const auto Transposed = DirectX::XMMatrixTranspose(InGraphics.GetViewProjectionMatrix());
+
+	CullConstants Constants {};
+	Constants.ViewProjection = Transposed;
+
+	// Rows of the transposed matrix are the clip space axes, w + x >= 0 and so on for the sides, z >= 0 for the near plane.
+	const DirectX::XMVECTOR Planes[] =
+	{
+		DirectX::XMVectorAdd(Transposed.r[3], Transposed.r[0]),
+		DirectX::XMVectorSubtract(Transposed.r[3], Transposed.r[0]),
+		DirectX::XMVectorAdd(Transposed.r[3], Transposed.r[1]),
+		DirectX::XMVectorSubtract(Transposed.r[3], Transposed.r[1]),
+		Transposed.r[2],
+		DirectX::XMVectorSubtract(Transposed.r[3], Transposed.r[2])
+	};
+
+	for (size_t Index = 0u; Index < std::size(Planes); ++Index)
+	{
+		DirectX::XMStoreFloat4(&Constants.FrustumPlanes[Index], Planes[Index]);
+	}
+
+	const auto& Occlusion = InGraphics.GetOcclusionCuller();
+	ID3D11ShaderResourceView* Pyramid = nullptr;
+
+	if (Occlusion.IsEnabled() && Occlusion.HasPyramid())
+	{
+		Pyramid = Occlusion.GetPyramidView();
+		Constants.PyramidSize = Occlusion.GetPyramidSize();
+		Constants.PyramidMipNum = Occlusion.GetPyramidMipNum();
+		Constants.bHasPyramid = true;
+	}
+
+	ID3D11UnorderedAccessView* const Uavs[] = {ArgumentsUav.Get(), IndicesUav.Get()};
+
+	Context->CSSetShader(CullShader.Get(), nullptr, 0u);
+	Context->CSSetConstantBuffers(0u, 1u, CullConstantBuffer.GetAddressOf());
+	Context->CSSetUnorderedAccessViews(0u, static_cast<UINT>(std::size(Uavs)), Uavs, nullptr);
+
+	// One group per meshlet, batches over the dispatch limit go in several.
+	for (const auto& [IndexView, bIsShortIndex, FirstCluster, ClusterNum] : Batches)
+	{
+		ID3D11ShaderResourceView* const Views[] = {ClusterBufferView.Get(), DrawBufferView.Get(), IndexView, Pyramid};
+		Context->CSSetShaderResources(0u, static_cast<UINT>(std::size(Views)), Views);
+
+		for (UINT Dispatched = 0u; Dispatched < ClusterNum;)
+		{
+			const auto GroupNum = std::min<UINT>(ClusterNum - Dispatched, D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION);
+
+			Constants.FirstCluster = FirstCluster + Dispatched;
+			Constants.bIsShortIndex = bIsShortIndex;
+			Upload(Context, CullConstantBuffer.Get(), &Constants, sizeof(Constants));
+
+			Context->Dispatch(GroupNum, 1u, 1u);
+			Dispatched += GroupNum;
+		}
+	}
+
+	// Unbound so the arguments and indices can feed the input assembler.
+	ID3D11ShaderResourceView* const NullViews[4] {};
+	ID3D11UnorderedAccessView* const NullUavs[std::size(Uavs)] {};
+	Context->CSSetShaderResources(0u, static_cast<UINT>(std::size(NullViews)), NullViews);
+	Context->CSSetUnorderedAccessViews(0u, static_cast<UINT>(std::size(NullUavs)), NullUavs, nullptr);
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <span>
+#include <vector>
+#include "wrl/client.h"
+#include "MeshOptimizer.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Optional GPU culling of meshes by their import-time meshlets, so a mesh only partly in view only draws what is.
+ * One compute group per meshlet tests its sphere against the frustum and, while the occlusion culler has one, last frame's
+ * Hi-Z pyramid, and its normal cone against the camera for back faces. Surviving meshlets copy their triangles into
+ * the mesh's range of one compacted index buffer and count them into its indirect arguments, one draw per mesh.
+ * Like the instance culler there is no second phase, meshlets that just came out from behind an occluder show up a frame late.
+ */
+class MeshletCuller
+{
+public:
+	static constexpr unsigned int NoSlot {~0u};
+	static constexpr unsigned int MaxMeshNum {4096u};
+	static constexpr unsigned int MaxMeshletNum {262144u};
+	// Every mesh reserves all of its finest level, the compacted buffer holds at most this many indices a frame.
+	static constexpr unsigned int MaxIndexNum {1u << 22u};
+	// Byte size of D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS.
+	static constexpr UINT ArgumentStride {5u * sizeof(UINT)};
+
+	MeshletCuller(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	MeshletCuller(const MeshletCuller&) = delete;
+	MeshletCuller(MeshletCuller&&) = delete;
+	MeshletCuller& operator=(const MeshletCuller&) = delete;
+	MeshletCuller& operator=(MeshletCuller&&) = delete;
+	~MeshletCuller() = default;
+
+	void BeginFrame() noexcept;
+	// Slot of the mesh's arguments into GetIndices, NoSlot when disabled or full so the caller draws it whole.
+	// On the main thread, InMeshlets index InIndexView from InStartIndex on and InCameraPosition is in world space.
+	[[nodiscard]] unsigned int AddMesh(std::span<const MeshOptimizer::Meshlet> InMeshlets, DirectX::FXMMATRIX InWorld, DirectX::FXMVECTOR InCameraPosition,
+	                                   ID3D11ShaderResourceView* InIndexView, DXGI_FORMAT InIndexFormat, UINT InStartIndex, INT InBaseVertex,
+	                                   bool bInIsConeCulled);
+
+	// Before anything draws from the slots handed out this frame.
+	void Cull(const Graphics& InGraphics);
+
+	[[nodiscard]] ID3D11Buffer* GetArguments() const noexcept
+	{
+		return Arguments.Get();
+	}
+
+	// 32 bit indices relative to each mesh's base vertex, drawn in place of the mesh's own.
+	[[nodiscard]] ID3D11Buffer* GetIndices() const noexcept
+	{
+		return Indices.Get();
+	}
+
+	// Of the last frame, this one's meshes are only known once the render queue executes.
+	[[nodiscard]] unsigned int GetMeshNum() const noexcept
+	{
+		return LastMeshNum;
+	}
+
+	[[nodiscard]] unsigned int GetMeshletNum() const noexcept
+	{
+		return LastMeshletNum;
+	}
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+private:
+	struct Cluster
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		DirectX::XMFLOAT3 ConeAxis;
+		float ConeCutoff;
+		// Into the index page, not the mesh.
+		UINT FirstIndex;
+		UINT TriangleNum;
+		UINT DrawIndex;
+		UINT Padding;
+	};
+
+	struct Draw
+	{
+		// Transposed like every other matrix handed to the shaders.
+		DirectX::XMFLOAT4X4 Model;
+		// The cone test runs in mesh space, a triangle faces away from the camera there exactly when it does in the world.
+		DirectX::XMFLOAT3 LocalCameraPosition;
+		// Largest axis scale of the transform, turns the mesh space radii into world space ones.
+		float Scale;
+		UINT OutputFirstIndex;
+		UINT bIsConeCulled;
+		UINT Padding[2];
+	};
+
+	struct CullConstants
+	{
+		DirectX::XMMATRIX ViewProjection;
+		std::array<DirectX::XMFLOAT4, 6> FrustumPlanes;
+		DirectX::XMFLOAT2 PyramidSize;
+		UINT PyramidMipNum;
+		UINT bHasPyramid;
+		UINT FirstCluster;
+		UINT bIsShortIndex;
+		UINT Padding[2];
+	};
+
+	// Consecutive clusters reading the same index page, one dispatch each.
+	struct Batch
+	{
+		ID3D11ShaderResourceView* IndexView;
+		bool bIsShortIndex;
+		UINT FirstCluster;
+		UINT ClusterNum;
+	};
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> CullShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CullConstantBuffer;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ClusterBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ClusterBufferView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> DrawBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DrawBufferView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Indices;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> IndicesUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Arguments;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ArgumentsUav;
+
+	std::vector<Cluster> Clusters;
+	std::vector<Draw> Draws;
+	std::vector<Batch> Batches;
+	// What each mesh's arguments start the frame as, with no indices yet.
+	std::vector<std::array<UINT, 5>> InitialArguments;
+	UINT ReservedIndexNum {0u};
+	unsigned int LastMeshNum {0u};
+	unsigned int LastMeshletNum {0u};
+	bool bIsEnabled {false};
+};
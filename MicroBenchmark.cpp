@@ -0,0 +1,523 @@
+﻿#include "MicroBenchmark.h"
+#include "EngineWin.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include "BindManager.h"
+#include "ConstantBuffers.h"
+#include "CullingBounds.h"
+#include "DynamicVertex.h"
+#include "Graphics.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "Surface.h"
+#include "SurfaceKernels.h"
+#include "Topology.h"
+#include "TriangleBvh.h"
+#include "VertexBuffer.h"
+
+namespace
+{
+	constexpr size_t VertexNum {10'000u};
+	// Ten children per node four levels deep, 11111 nodes.
+	constexpr unsigned int NodeBranching {10u};
+	constexpr unsigned int NodeDepth {4u};
+	// Each side of the image the Surface kernels run over.
+	constexpr unsigned int KernelImageSize {2048u};
+	// Vertices along each side of the height field rays are cast against, 2 * 1023 * 1023 triangles.
+	constexpr unsigned int TerrainSize {1024u};
+	// Boxes culled at once, about one in twenty of them in view.
+	constexpr size_t CullingBoxNum {1'000'000u};
+	// Misses create a bindable each, the cache is emptied this often so it doesn't grow for the whole run.
+	constexpr size_t MissesPerClear {1024u};
+	const volatile char* volatile Sink {nullptr};
+
+	DV::VertexLayout MakeMeshLayout()
+	{
+		return DV::VertexLayout {}
+			.Append(DV::VertexLayout::ElementType::Position3D)
+			.Append(DV::VertexLayout::ElementType::Normal)
+			.Append(DV::VertexLayout::ElementType::Texture2D);
+	}
+
+	void AppendSubtree(MeshCache::NodeList& InNodes, const unsigned int InDepth)
+	{
+		const auto Index = InNodes.size();
+		auto& Entry = InNodes.emplace_back();
+		Entry.Name = "Node" + std::to_string(Index);
+		DirectX::XMStoreFloat4x4(&Entry.Transform, DirectX::XMMatrixTranslation(1.0f, 0.0f, 0.0f));
+
+		if (InDepth == 0u)
+		{
+			return;
+		}
+
+		InNodes[Index].ChildNum = NodeBranching;
+
+		for (unsigned int Child = 0u; Child < NodeBranching; ++Child)
+		{
+			AppendSubtree(InNodes, InDepth - 1u);
+		}
+	}
+
+	void AddVertexCases(std::vector<std::pair<std::string, MicroBenchmark::Function>>& InCases)
+	{
+		InCases.emplace_back("DV::VertexBuffer::Emplace", [](MicroBenchmark::State& InState)
+		{
+			const DirectX::XMFLOAT3 Position {1.0f, 2.0f, 3.0f};
+			const DirectX::XMFLOAT3 Normal {0.0f, 1.0f, 0.0f};
+			const DirectX::XMFLOAT2 TextureCoordinate {0.5f, 0.5f};
+
+			while (InState.KeepRunning())
+			{
+				DV::VertexBuffer Vertices {MakeMeshLayout()};
+				Vertices.Reserve(VertexNum);
+
+				for (size_t Index = 0u; Index < VertexNum; ++Index)
+				{
+					Vertices.Emplace(Position, Normal, TextureCoordinate);
+				}
+
+				MicroBenchmark::DoNotOptimize(*Vertices.GetData());
+			}
+
+			InState.SetItemsProcessed(InState.GetIterationNum() * VertexNum);
+		});
+
+		InCases.emplace_back("DV::VertexBuffer::FillAttribute", [](MicroBenchmark::State& InState)
+		{
+			const std::vector Positions(VertexNum, DirectX::XMFLOAT3 {1.0f, 2.0f, 3.0f});
+			const std::vector Normals(VertexNum, DirectX::XMFLOAT3 {0.0f, 1.0f, 0.0f});
+			const std::vector TextureCoordinates(VertexNum, DirectX::XMFLOAT2 {0.5f, 0.5f});
+
+			while (InState.KeepRunning())
+			{
+				DV::VertexBuffer Vertices {MakeMeshLayout()};
+				Vertices.Resize(VertexNum);
+				Vertices.FillAttribute<DV::VertexLayout::ElementType::Position3D>(std::span(Positions));
+				Vertices.FillAttribute<DV::VertexLayout::ElementType::Normal>(std::span(Normals));
+				Vertices.FillAttribute<DV::VertexLayout::ElementType::Texture2D>(std::span(TextureCoordinates));
+
+				MicroBenchmark::DoNotOptimize(*Vertices.GetData());
+			}
+
+			InState.SetItemsProcessed(InState.GetIterationNum() * VertexNum);
+		});
+
+		InCases.emplace_back("DV::VertexLayout::Resolve", [](MicroBenchmark::State& InState)
+		{
+			// The last element, the longest walk through the elements.
+			const auto Layout = MakeMeshLayout().Append(DV::VertexLayout::ElementType::Tangent).Append(DV::VertexLayout::ElementType::Bitangent);
+
+			while (InState.KeepRunning())
+			{
+				MicroBenchmark::DoNotOptimize(Layout.Resolve<DV::VertexLayout::ElementType::Bitangent>().GetByteOffset());
+			}
+		});
+	}
+
+	void AddBindCases(std::vector<std::pair<std::string, MicroBenchmark::Function>>& InCases, const Graphics& InGraphics)
+	{
+		InCases.emplace_back("BindManager::Resolve/Hit", [&InGraphics](MicroBenchmark::State& InState)
+		{
+			const auto Cached = Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+			while (InState.KeepRunning())
+			{
+				MicroBenchmark::DoNotOptimize(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
+			}
+		});
+
+		InCases.emplace_back("BindManager::Resolve/HitTag", [&InGraphics](MicroBenchmark::State& InState)
+		{
+			DV::VertexBuffer Vertices {MakeMeshLayout()};
+			Vertices.Resize(3u);
+			const std::string Tag {"MicroBenchmark"};
+			const auto Cached = VertexBuffer::Resolve(InGraphics, Tag, Vertices);
+
+			while (InState.KeepRunning())
+			{
+				MicroBenchmark::DoNotOptimize(VertexBuffer::Resolve(InGraphics, Tag, Vertices));
+			}
+		});
+
+		// Hashing a new tag, the lookup that fails and creating the buffer it then caches.
+		InCases.emplace_back("BindManager::Resolve/MissTag", [&InGraphics](MicroBenchmark::State& InState)
+		{
+			DV::VertexBuffer Vertices {MakeMeshLayout()};
+			Vertices.Resize(3u);
+			size_t TagIndex = 0u;
+
+			while (InState.KeepRunning())
+			{
+				MicroBenchmark::DoNotOptimize(VertexBuffer::Resolve(InGraphics, "MicroBenchmark" + std::to_string(TagIndex++), Vertices));
+
+				if (TagIndex % MissesPerClear == 0u)
+				{
+					InState.PauseTiming();
+					BindManager::Clear();
+					InState.ResumeTiming();
+				}
+			}
+
+			BindManager::Clear();
+		});
+	}
+
+	void AddNodeCases(std::vector<std::pair<std::string, MicroBenchmark::Function>>& InCases)
+	{
+		InCases.emplace_back("NodeHierarchy::UpdateWorldTransforms", [](MicroBenchmark::State& InState)
+		{
+			MeshCache::NodeList Nodes;
+			AppendSubtree(Nodes, NodeDepth);
+			NodeHierarchy Hierarchy {std::make_shared<const NodeHierarchy::Structure>(Nodes, std::span<const DirectX::BoundingBox> {})};
+			float Angle = 0.0f;
+
+			// Moving the root dirties every node, so each iteration is a full traversal.
+			while (InState.KeepRunning())
+			{
+				Hierarchy.SetAppliedTransform(0u, DirectX::XMMatrixRotationY(Angle += 0.01f));
+				Hierarchy.UpdateWorldTransforms();
+				MicroBenchmark::DoNotOptimize(Hierarchy.GetWorldBounds(Hierarchy.GetNodeNum() - 1u));
+			}
+
+			InState.SetItemsProcessed(InState.GetIterationNum() * Hierarchy.GetNodeNum());
+		});
+	}
+
+	// Rolling hills a unit apart, centred on the origin.
+	TriangleBvh MakeTerrain()
+	{
+		std::vector<DirectX::XMFLOAT3> Positions;
+		Positions.reserve(TerrainSize * TerrainSize);
+
+		for (unsigned int Z = 0u; Z < TerrainSize; ++Z)
+		{
+			for (unsigned int X = 0u; X < TerrainSize; ++X)
+			{
+				const auto PositionX = static_cast<float>(X) - 0.5f * TerrainSize;
+				const auto PositionZ = static_cast<float>(Z) - 0.5f * TerrainSize;
+				Positions.push_back({PositionX, 4.0f * std::sin(0.05f * PositionX) * std::cos(0.07f * PositionZ), PositionZ});
+			}
+		}
+
+		std::vector<unsigned int> Indices;
+		Indices.reserve(6u * (TerrainSize - 1u) * (TerrainSize - 1u));
+
+		for (unsigned int Z = 0u; Z + 1u < TerrainSize; ++Z)
+		{
+			for (unsigned int X = 0u; X + 1u < TerrainSize; ++X)
+			{
+				const auto Corner = Z * TerrainSize + X;
+				Indices.insert(Indices.end(), {Corner, Corner + TerrainSize, Corner + 1u, Corner + 1u, Corner + TerrainSize, Corner + TerrainSize + 1u});
+			}
+		}
+
+		return TriangleBvh(Indices, Positions.data(), Positions.size(), sizeof(DirectX::XMFLOAT3));
+	}
+
+	void AddRayCases(std::vector<std::pair<std::string, MicroBenchmark::Function>>& InCases)
+	{
+		// Built by the first case that runs, a filtered run that has none doesn't pay for it.
+		const auto Terrain = std::make_shared<TriangleBvh>();
+
+		// Packets of rays a tenth of a unit apart, slanting down onto the hills from a walk over them.
+		const auto MakeRays = [](const size_t InPacket)
+		{
+			TriangleBvh::RayPacket Rays;
+			const auto Step = static_cast<float>(InPacket % 4096u);
+
+			for (unsigned int Ray = 0u; Ray < TriangleBvh::PacketSize; ++Ray)
+			{
+				Rays.Origins[Ray] = {0.37f * Step - 400.0f + 0.1f * Ray, 20.0f, 0.21f * Step - 400.0f};
+				Rays.Directions[Ray] = {0.48f, -0.6f, 0.64f - 0.02f * Ray};
+			}
+
+			return Rays;
+		};
+
+		InCases.emplace_back("TriangleBvh::Intersect", [Terrain, MakeRays](MicroBenchmark::State& InState)
+		{
+			if (Terrain->IsEmpty())
+			{
+				*Terrain = MakeTerrain();
+			}
+
+			size_t Packet = 0u;
+
+			while (InState.KeepRunning())
+			{
+				const auto Rays = MakeRays(Packet++);
+				TriangleBvh::Hit Closest;
+				(void)Terrain->Intersect(DirectX::XMLoadFloat3(&Rays.Origins.front()), DirectX::XMLoadFloat3(&Rays.Directions.front()), Closest);
+				MicroBenchmark::DoNotOptimize(Closest);
+			}
+
+			InState.SetItemsProcessed(InState.GetIterationNum());
+		});
+
+		InCases.emplace_back("TriangleBvh::Intersect/Packet", [Terrain, MakeRays](MicroBenchmark::State& InState)
+		{
+			if (Terrain->IsEmpty())
+			{
+				*Terrain = MakeTerrain();
+			}
+
+			size_t Packet = 0u;
+
+			while (InState.KeepRunning())
+			{
+				std::array<TriangleBvh::Hit, TriangleBvh::PacketSize> Hits;
+				Terrain->Intersect(MakeRays(Packet++), Hits);
+				MicroBenchmark::DoNotOptimize(Hits);
+			}
+
+			InState.SetItemsProcessed(InState.GetIterationNum() * TriangleBvh::PacketSize);
+		});
+
+		InCases.emplace_back("TriangleBvh::GetOccludedMask", [Terrain, MakeRays](MicroBenchmark::State& InState)
+		{
+			if (Terrain->IsEmpty())
+			{
+				*Terrain = MakeTerrain();
+			}
+
+			constexpr std::array Distances {100.0f, 100.0f, 100.0f, 100.0f};
+			size_t Packet = 0u;
+
+			while (InState.KeepRunning())
+			{
+				MicroBenchmark::DoNotOptimize(Terrain->GetOccludedMask(MakeRays(Packet++), Distances));
+			}
+
+			InState.SetItemsProcessed(InState.GetIterationNum() * TriangleBvh::PacketSize);
+		});
+	}
+
+	void AddCullingCases(std::vector<std::pair<std::string, MicroBenchmark::Function>>& InCases)
+	{
+		InCases.emplace_back("CullingBounds::Cull", [](MicroBenchmark::State& InState)
+		{
+			// Boxes of a unit or two on a grid around a camera at the origin looking down z.
+			CullingBounds Bounds;
+			Bounds.Resize(CullingBoxNum);
+
+			for (size_t Index = 0u; Index < CullingBoxNum; ++Index)
+			{
+				const auto Center = DirectX::XMVectorSet(static_cast<float>(Index % 100u) * 4.0f - 200.0f, static_cast<float>(Index / 100u % 100u) * 4.0f - 200.0f,
+				                                         static_cast<float>(Index / 10000u) * 4.0f - 200.0f, 0.0f);
+				Bounds.Set(Index, Center, DirectX::XMVectorReplicate(0.5f + static_cast<float>(Index % 3u) * 0.5f));
+			}
+
+			const DirectX::BoundingFrustum Frustum(DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 16.0f / 9.0f, 0.1f, 500.0f));
+			std::vector<uint8_t> VisibleMasks;
+
+			while (InState.KeepRunning())
+			{
+				Bounds.Cull({&Frustum, 1u}, VisibleMasks);
+				MicroBenchmark::DoNotOptimize(VisibleMasks.front());
+			}
+
+			InState.SetItemsProcessed(InState.GetIterationNum() * CullingBoxNum);
+		});
+	}
+
+	void AddSurfaceCases(std::vector<std::pair<std::string, MicroBenchmark::Function>>& InCases)
+	{
+		// One image per codec the project ships.
+		std::vector<std::filesystem::path> Images;
+
+		if (std::error_code Error; std::filesystem::is_directory("Images", Error))
+		{
+			for (const auto& Entry : std::filesystem::directory_iterator("Images"))
+			{
+				const auto Extension = Entry.path().extension();
+				const auto bIsNewCodec = std::none_of(Images.begin(), Images.end(), [&Extension](const std::filesystem::path& InImage)
+				{
+					return InImage.extension() == Extension;
+				});
+
+				if (Entry.is_regular_file() && !Extension.empty() && bIsNewCodec)
+				{
+					Images.push_back(Entry.path());
+				}
+			}
+		}
+
+		for (const auto& Image : Images)
+		{
+			InCases.emplace_back("Surface::FromFile/" + Image.extension().string().substr(1u), [FileName = Image.string()](MicroBenchmark::State& InState)
+			{
+				size_t ByteNum = 0u;
+
+				while (InState.KeepRunning())
+				{
+					const auto Decoded = Surface::FromFile(FileName);
+					ByteNum += static_cast<size_t>(Decoded.GetWidth()) * Decoded.GetHeight() * sizeof(Surface::Color);
+					MicroBenchmark::DoNotOptimize(*Decoded.GetBufferPtrConst());
+				}
+
+				InState.SetBytesProcessed(ByteNum);
+			});
+		}
+
+		// On a generated image, the kernels' speed doesn't depend on what the pixels hold.
+		const auto AddKernelCase = [&InCases](std::string InName, std::function<void(Surface&)> InKernel)
+		{
+			InCases.emplace_back("SurfaceKernels::" + std::move(InName), [Kernel = std::move(InKernel)](MicroBenchmark::State& InState)
+			{
+				Surface Image {KernelImageSize, KernelImageSize};
+				SurfaceKernels::Fill(Image, Surface::Color {0x80u, 0x40u, 0xC0u, 0x20u});
+
+				size_t ByteNum = 0u;
+
+				while (InState.KeepRunning())
+				{
+					Kernel(Image);
+					ByteNum += static_cast<size_t>(KernelImageSize) * KernelImageSize * sizeof(Surface::Color);
+					MicroBenchmark::DoNotOptimize(*Image.GetBufferPtrConst());
+				}
+
+				InState.SetBytesProcessed(ByteNum);
+			});
+		};
+
+		AddKernelCase("SwapRedBlue", [](Surface& InOutImage) { SurfaceKernels::SwapRedBlue(InOutImage); });
+		AddKernelCase("Premultiply", [](Surface& InOutImage) { SurfaceKernels::Premultiply(InOutImage); });
+		AddKernelCase("DownsampleBox/Srgb", [](Surface& InImage) { MicroBenchmark::DoNotOptimize(SurfaceKernels::DownsampleBox(InImage, true)); });
+		AddKernelCase("DownsampleKaiser/Srgb", [](Surface& InImage) { MicroBenchmark::DoNotOptimize(SurfaceKernels::DownsampleKaiser(InImage, true)); });
+	}
+
+	void AddConstantBufferCases(std::vector<std::pair<std::string, MicroBenchmark::Function>>& InCases, const Graphics& InGraphics)
+	{
+		InCases.emplace_back("ConstantBuffer::Update", [&InGraphics](MicroBenchmark::State& InState)
+		{
+			using Constants = std::array<DirectX::XMFLOAT4X4, 4u>;
+			VertexConstantBuffer<Constants> Buffer {InGraphics};
+			Constants Values {};
+
+			// Discarding maps of one buffer, the pattern of the per draw transform buffers.
+			while (InState.KeepRunning())
+			{
+				Values[0]._11 = static_cast<float>(InState.GetIterationIndex());
+				Buffer.Update(InGraphics.GetImmediateContext(), Values);
+			}
+
+			InState.SetBytesProcessed(InState.GetIterationNum() * sizeof(Constants));
+		});
+	}
+}
+
+int MicroBenchmark::Run(const std::string_view InCommandLine)
+{
+	std::string Filter;
+	OffscreenSettings Settings;
+
+	std::istringstream Arguments {std::string(InCommandLine)};
+	for (std::string Argument; Arguments >> Argument;)
+	{
+		if (Argument == "--warp")
+		{
+			Settings.bShouldUseWarp = true;
+		}
+		else if (Argument.rfind("--", 0u) != 0u)
+		{
+			Filter = Argument;
+		}
+	}
+
+	// Declared first so it outlives Graphics, which sizes its deferred contexts by the workers.
+	JobSystem Jobs;
+	Graphics OffscreenGraphics(256, 256, Settings);
+
+	std::vector<std::pair<std::string, Function>> Cases;
+	AddVertexCases(Cases);
+	AddBindCases(Cases, OffscreenGraphics);
+	AddNodeCases(Cases);
+	AddRayCases(Cases);
+	AddCullingCases(Cases);
+	AddSurfaceCases(Cases);
+	AddConstantBufferCases(Cases, OffscreenGraphics);
+
+	std::vector<Result> Results;
+
+	for (auto& [Name, Body] : Cases)
+	{
+		if (Name.find(Filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		auto& Measured = Results.emplace_back(Measure({std::move(Name), std::move(Body)}));
+
+		std::ostringstream Line;
+		Line << "MicroBenchmark " << Measured.Name << ": " << Measured.Nanoseconds << " ns over " << Measured.IterationNum << " iterations\n";
+		OutputDebugStringA(Line.str().c_str());
+	}
+
+	return WriteReport(Results) ? 0 : -1;
+}
+
+MicroBenchmark::Result MicroBenchmark::Measure(const Case& InCase)
+{
+	size_t IterationNum = 1u;
+
+	while (true)
+	{
+		State Measured {IterationNum};
+		InCase.Body(Measured);
+
+		const auto Seconds = std::chrono::duration<double>(Measured.Elapsed).count();
+
+		if (Measured.Elapsed >= MinimumTime || IterationNum >= MaximumIterationNum)
+		{
+			const auto ToRate = [Seconds](const size_t InTotal)
+			{
+				return Seconds > 0.0 ? static_cast<double>(InTotal) / Seconds : 0.0;
+			};
+
+			return {InCase.Name, IterationNum, Seconds * 1e9 / static_cast<double>(IterationNum), ToRate(Measured.ItemNum), ToRate(Measured.ByteNum)};
+		}
+
+		// Aim a little past the minimum so the next run usually is the last, but grow at most tenfold on a noisy short run.
+		const auto Target = std::chrono::duration<double>(MinimumTime).count() * 1.4;
+		const auto Multiplier = Seconds > 0.0 ? std::clamp(Target / Seconds, 2.0, 10.0) : 10.0;
+		IterationNum = std::min(static_cast<size_t>(static_cast<double>(IterationNum) * Multiplier), MaximumIterationNum);
+	}
+}
+
+bool MicroBenchmark::WriteReport(const std::vector<Result>& InResults)
+{
+	std::ofstream Stream(ReportFileName);
+
+	if (!Stream)
+	{
+		return false;
+	}
+
+	Stream << "{\n";
+	Stream << "\t\"Cases\": [\n";
+
+	for (size_t Index = 0u; Index < InResults.size(); ++Index)
+	{
+		const auto& [Name, IterationNum, Nanoseconds, ItemsPerSecond, BytesPerSecond] = InResults[Index];
+		Stream << "\t\t{\"Name\": \"" << Name << "\", \"Iterations\": " << IterationNum << ", \"NanosecondsPerIteration\": " << Nanoseconds
+		       << ", \"ItemsPerSecond\": " << ItemsPerSecond << ", \"BytesPerSecond\": " << BytesPerSecond << '}'
+		       << (Index + 1u < InResults.size() ? "," : "") << '\n';
+	}
+
+	Stream << "\t]\n";
+	Stream << "}\n";
+
+	return static_cast<bool>(Stream);
+}
+
+void MicroBenchmark::UsePointer(const volatile char* InPointer) noexcept
+{
+	// A volatile store the optimizer has to keep, and with it whatever produced the pointed at value.
+	Sink = InPointer;
+}
@@ -0,0 +1,127 @@
+﻿#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Component timings started with --microbenchmark, for hot paths too small to stand out in a whole frame.
+ * Each case repeats its body while State::KeepRunning allows, the iteration count grows until one run takes long
+ * enough to time reliably, the way Google Benchmark does it, and the results are written as JSON.
+ */
+class MicroBenchmark
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	class State
+	{
+	public:
+		explicit State(const size_t InIterationNum) noexcept
+			: IterationNum(InIterationNum), RemainingNum(InIterationNum)
+		{}
+
+		// The clock starts on the first call and stops on the one that returns false.
+		[[nodiscard]] bool KeepRunning() noexcept
+		{
+			if (!bHasStarted)
+			{
+				bHasStarted = true;
+				Start = Clock::now();
+			}
+
+			if (RemainingNum > 0u)
+			{
+				--RemainingNum;
+				return true;
+			}
+
+			Elapsed += Clock::now() - Start;
+			return false;
+		}
+
+		// Brackets setup inside the loop that shouldn't count, such as releasing what the measured part created.
+		void PauseTiming() noexcept
+		{
+			Elapsed += Clock::now() - Start;
+		}
+
+		void ResumeTiming() noexcept
+		{
+			Start = Clock::now();
+		}
+
+		// Totals over the whole run, reported per second next to the time per iteration.
+		void SetItemsProcessed(const size_t InItemNum) noexcept
+		{
+			ItemNum = InItemNum;
+		}
+
+		void SetBytesProcessed(const size_t InByteNum) noexcept
+		{
+			ByteNum = InByteNum;
+		}
+
+		[[nodiscard]] size_t GetIterationNum() const noexcept
+		{
+			return IterationNum;
+		}
+
+		// Iterations completed so far, counting the one in progress.
+		[[nodiscard]] size_t GetIterationIndex() const noexcept
+		{
+			return IterationNum - RemainingNum - 1u;
+		}
+
+	private:
+		friend class MicroBenchmark;
+
+		size_t IterationNum;
+		size_t RemainingNum;
+		size_t ItemNum {0u};
+		size_t ByteNum {0u};
+		Clock::time_point Start {};
+		Clock::duration Elapsed {};
+		bool bHasStarted {false};
+	};
+
+	using Function = std::function<void(State&)>;
+
+	// --microbenchmark [name filter] [--warp], returns the process exit code. Runs without a window or a scene.
+	static int Run(std::string_view InCommandLine);
+
+	// Keeps a result the compiler could otherwise prove unused and delete along with the code being timed.
+	template<typename T>
+	static void DoNotOptimize(const T& InValue) noexcept
+	{
+		UsePointer(&reinterpret_cast<const volatile char&>(InValue));
+	}
+
+	static constexpr const char* ReportFileName = "MicroBenchmarkReport.json";
+
+private:
+	struct Case
+	{
+		std::string Name;
+		Function Body;
+	};
+
+	struct Result
+	{
+		std::string Name;
+		size_t IterationNum;
+		double Nanoseconds;
+		double ItemsPerSecond;
+		double BytesPerSecond;
+	};
+
+	[[nodiscard]] static Result Measure(const Case& InCase);
+	[[nodiscard]] static bool WriteReport(const std::vector<Result>& InResults);
+	static void UsePointer(const volatile char* InPointer) noexcept;
+
+	// Every case runs at least this long once the iteration count has settled.
+	static constexpr std::chrono::milliseconds MinimumTime {500};
+	static constexpr size_t MaximumIterationNum {1'000'000'000u};
+};
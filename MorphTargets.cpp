@@ -0,0 +1,97 @@
+﻿#include "MorphTargets.h"
+#include <algorithm>
+#include <cassert>
+#include "DrawPacket.h"
+#include "ExceptionMacros.h"
+
+namespace
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateStructuredView(ID3D11Device& InDevice, const void* InData, const UINT InNum, const UINT InStride)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC BufferDesc {};
+		BufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		BufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		BufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		BufferDesc.ByteWidth = InNum * InStride;
+		BufferDesc.StructureByteStride = InStride;
+
+		D3D11_SUBRESOURCE_DATA SubresourceData {};
+		SubresourceData.pSysMem = InData;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		CHECK_HRESULT_EXCEPTION(InDevice.CreateBuffer
+		(
+			&BufferDesc,
+			&SubresourceData,
+			&Buffer
+		))
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC ResourceViewDesc {};
+		ResourceViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		ResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		ResourceViewDesc.Buffer.FirstElement = 0u;
+		ResourceViewDesc.Buffer.NumElements = InNum;
+
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+		CHECK_HRESULT_EXCEPTION(InDevice.CreateShaderResourceView
+		(
+			Buffer.Get(),
+			&ResourceViewDesc,
+			&View
+		))
+
+		return View;
+	}
+}
+
+MorphTargets::MorphTargets(const Graphics& InGraphics, std::vector<std::string> InNames, const std::span<const MeshCache::MorphDeltaEntry> InDeltas,
+                           const size_t InVertexNum)
+	: Names(std::move(InNames))
+{
+	assert(!InDeltas.empty() && Names.size() <= MaxTargetNum && "Morph targets need deltas and at most as many targets as the weights hold");
+
+	// First delta and delta count of every vertex, the deltas are already in vertex order.
+	std::vector<DirectX::XMUINT2> Ranges(InVertexNum, {0u, 0u});
+
+	for (UINT Index = 0u; Index < static_cast<UINT>(InDeltas.size()); ++Index)
+	{
+		auto& Range = Ranges[InDeltas[Index].Vertex];
+
+		if (Range.y == 0u)
+		{
+			Range.x = Index;
+		}
+
+		++Range.y;
+	}
+
+	MyRangeView = CreateStructuredView(*GetDevice(InGraphics), Ranges.data(), static_cast<UINT>(Ranges.size()), sizeof(DirectX::XMUINT2));
+	MyDeltaView = CreateStructuredView(*GetDevice(InGraphics), InDeltas.data(), static_cast<UINT>(InDeltas.size()), sizeof(MeshCache::MorphDeltaEntry));
+	ByteSize = Ranges.size() * sizeof(DirectX::XMUINT2) + InDeltas.size_bytes();
+}
+
+void MorphTargets::Bind(RenderContext& InContext) noexcept
+{
+	auto& Cache = GetStateCache(InContext);
+	Cache.SetVertexShaderResource(RangeSlot, MyRangeView.Get());
+	Cache.SetVertexShaderResource(DeltaSlot, MyDeltaView.Get());
+}
+
+bool MorphTargets::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.AddVertexShaderResource(RangeSlot, MyRangeView.Get());
+	InOutPacket.AddVertexShaderResource(DeltaSlot, MyDeltaView.Get());
+	return true;
+}
+
+UINT MorphTargets::FindTarget(const std::string_view InName) const noexcept
+{
+	return static_cast<UINT>(std::find(Names.begin(), Names.end(), InName) - Names.begin());
+}
+
+size_t MorphTargets::GetGpuByteSize() const noexcept
+{
+	return ByteSize;
+}
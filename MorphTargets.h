@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Bindable.h"
+#include "MeshCache.h"
+
+/**
+ * The blend shapes of one mesh, read by the morphing vertex shaders as two StructuredBuffers: every vertex's range of deltas and
+ * the deltas themselves, each vertex's back to back and only for the targets that move it. Shared by every instance of the mesh,
+ * the instances weight the targets with a Weights constant buffer of their own, so animating them uploads a few floats a frame.
+ */
+class MorphTargets : public Bindable
+{
+public:
+	// A mesh with more keeps the first ones.
+	static constexpr UINT MaxTargetNum {64u};
+	static constexpr UINT RangeSlot {2u};
+	static constexpr UINT DeltaSlot {3u};
+	static constexpr UINT WeightSlot {1u};
+
+	// Laid out like the MorphWeights cbuffer. With no weight set the shaders skip the deltas altogether.
+	struct Weights
+	{
+		float Values[MaxTargetNum];
+		UINT ActiveNum;
+		UINT Padding[3];
+	};
+
+	// InDeltas sorted by vertex as the mesh cache keeps them, over InVertexNum vertices.
+	MorphTargets(const Graphics& InGraphics, std::vector<std::string> InNames, std::span<const MeshCache::MorphDeltaEntry> InDeltas, size_t InVertexNum);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] UINT GetTargetNum() const noexcept
+	{
+		return static_cast<UINT>(Names.size());
+	}
+
+	// The index of the target of that name, or GetTargetNum() when the mesh has none.
+	[[nodiscard]] UINT FindTarget(std::string_view InName) const noexcept;
+
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	std::vector<std::string> Names;
+	size_t ByteSize;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyRangeView;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyDeltaView;
+};
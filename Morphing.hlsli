@@ -0,0 +1,41 @@
+// Sparse blend shapes, shared by the shading and depth-only vertex shaders so both move a vertex exactly alike.
+// Laid out like MorphTargets: the range of every vertex points at its deltas, one per target that moves it.
+struct MorphDelta
+{
+    uint Vertex;
+    uint Target;
+    float3 Position;
+    float3 Normal;
+};
+
+StructuredBuffer<uint2> MorphRanges : register(t2);
+StructuredBuffer<MorphDelta> MorphDeltas : register(t3);
+
+// One weight per target of the mesh, per instance.
+cbuffer MorphWeights : register(b1)
+{
+    float4 MorphWeightValues[16];
+    uint ActiveMorphNum;
+};
+
+// In the mesh's bind pose, before skinning. SV_VertexID of an indexed draw is the index itself, the buffer's base vertex isn't added.
+// The depth-only shaders pass a normal they never read, the compiler drops its half of the loop.
+void ApplyMorphTargets(const uint InVertexID, inout float3 InOutPosition, inout float3 InOutNormal)
+{
+    [branch]
+    if (ActiveMorphNum == 0u)
+    {
+        return;
+    }
+
+    const uint2 Range = MorphRanges[InVertexID];
+
+    [loop]
+    for (uint Index = Range.x; Index < Range.x + Range.y; ++Index)
+    {
+        const MorphDelta Delta = MorphDeltas[Index];
+        const float Weight = MorphWeightValues[Delta.Target >> 2u][Delta.Target & 3u];
+        InOutPosition += Delta.Position * Weight;
+        InOutNormal += Delta.Normal * Weight;
+    }
+}
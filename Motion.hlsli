@@ -0,0 +1,20 @@
+// Laid out like TemporalAntiAliasing::MotionConstants, set once for the camera and again for everything that moved.
+cbuffer Motion : register(b0)
+{
+    // From this frame's clip space to last frame's, for the surface seen through a pixel.
+    matrix Reprojection;
+    // The part of the targets this frame renders to, from their top left.
+    float2 ViewportSize;
+    // Render pixels this frame's samples sit off their texel centers.
+    float2 JitterOffset;
+}
+
+// How far across the viewport, in texture coordinates, the surface at InDepth under the pixel moved since last frame.
+// Measured from where the surface is without this frame's jitter, which the resolve reprojects the display pixel from.
+float2 GetMotion(const float2 InPixelPosition, const float InDepth)
+{
+    const float2 Ndc = float2(InPixelPosition.x / ViewportSize.x * 2.0f - 1.0f, 1.0f - InPixelPosition.y / ViewportSize.y * 2.0f);
+    const float4 Previous = mul(float4(Ndc, InDepth, 1.0f), Reprojection);
+    const float2 PreviousCoordinate = Previous.xy / Previous.w * float2(0.5f, -0.5f) + 0.5f;
+    return (InPixelPosition - JitterOffset) / ViewportSize - PreviousCoordinate;
+}
@@ -3,30 +3,12 @@
 
 std::optional<Mouse::Event> Mouse::Read() noexcept
 {
-	if (!Buffer.empty())
-	{
-		const auto Event = Buffer.front();
-		Buffer.pop();
-		return std::optional{Event};
-	}
-	else
-	{
-		return std::nullopt;
-	}
+	return Buffer.Pop();
 }
 
 std::optional<Mouse::RawDelta> Mouse::ReadRawDelta() noexcept
 {
-	if (!RawDeltaBuffer.empty())
-	{
-		const auto RawDelta = RawDeltaBuffer.front();
-		RawDeltaBuffer.pop();
-		return std::optional{RawDelta};
-	}
-	else
-	{
-		return std::nullopt;
-	}
+	return RawDeltaBuffer.Pop();
 }
 
 void Mouse::OnMove(int InX, int InY) noexcept
@@ -34,52 +16,45 @@ void Mouse::OnMove(int InX, int InY) noexcept
 	X = InX;
 	Y = InY;
 
-	Buffer.emplace(Event::Type::Move, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::Move, *this);
 }
 
 void Mouse::OnLeftPressed(int InX, int InY) noexcept
 {
 	bIsLeftPressed = true;
 
-	Buffer.emplace(Event::Type::LeftPress, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::LeftPress, *this);
 }
 
 void Mouse::OnLeftReleased(int InX, int InY) noexcept
 {
 	bIsLeftPressed = false;
 
-	Buffer.emplace(Event::Type::LeftRelease, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::LeftRelease, *this);
 }
 
 void Mouse::OnRightPressed(int InX, int InY) noexcept
 {
 	bIsRightPressed = true;
 
-	Buffer.emplace(Event::Type::RightPress, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::RightPress, *this);
 }
 
 void Mouse::OnRightReleased(int InX, int InY) noexcept
 {
 	bIsRightPressed = false;
 
-	Buffer.emplace(Event::Type::RightRelease, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::RightRelease, *this);
 }
 
 void Mouse::OnWheelUp(int InX, int InY) noexcept
 {
-	Buffer.emplace(Event::Type::WheelUp, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::WheelUp, *this);
 }
 
 void Mouse::OnWheelDown(int InX, int InY) noexcept
 {
-	Buffer.emplace(Event::Type::WheelDown, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::WheelDown, *this);
 }
 
 void Mouse::OnWheelDelta(int InX, int InY, int InDelta)
@@ -103,36 +78,17 @@ void Mouse::OnLeave() noexcept
 {
 	bIsInWindow = false;
 
-	Buffer.emplace(Event::Type::Leave, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::Leave, *this);
 }
 
 void Mouse::OnEnter() noexcept
 {
 	bIsInWindow = true;
 
-	Buffer.emplace(Event::Type::Enter, *this);
-	TrimBuffer();
+	Buffer.Push(Event::Type::Enter, *this);
 }
 
 void Mouse::OnRawDelta(int InDeltaX, int InDeltaY)
 {
-	RawDeltaBuffer.push({InDeltaX, InDeltaY});
-	TrimRawInputBuffer();
-}
-
-void Mouse::TrimBuffer() noexcept
-{
-	while (Buffer.size() > BufferSize)
-	{
-		Buffer.pop();
-	}
-}
-
-void Mouse::TrimRawInputBuffer() noexcept
-{
-	while (RawDeltaBuffer.size() > BufferSize)
-	{
-		RawDeltaBuffer.pop();
-	}
+	RawDeltaBuffer.Push(RawDelta {InDeltaX, InDeltaY, Clock::now()});
 }
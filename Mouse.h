@@ -1,16 +1,23 @@
 ﻿#pragma once
-#include <queue>
+#include <atomic>
+#include <chrono>
 #include <optional>
+#include <utility>
+#include "SpscQueue.h"
 
 class Mouse
 {
 	friend class Window;
 
 public:
+	// std::chrono::steady_clock reads the performance counter, fine enough to place events within a frame.
+	using Clock = std::chrono::steady_clock;
+
 	struct RawDelta
 	{
 		int DeltaX;
 		int DeltaY;
+		Clock::time_point Timestamp;
 	};
 
 	class Event
@@ -36,7 +43,7 @@ public:
 
 		Event(const Type InType, const Mouse& InMouse) noexcept
 			: Type(InType), bIsLeftPressed(InMouse.bIsLeftPressed), bIsRightPressed(InMouse.bIsRightPressed),
-			  X(InMouse.X), Y(InMouse.Y)
+			  X(InMouse.X), Y(InMouse.Y), Timestamp(Clock::now())
 		{}
 
 		[[nodiscard]] bool IsValid() const noexcept
@@ -74,12 +81,19 @@ public:
 			return bIsRightPressed;
 		}
 
+		// When the message reached the window procedure.
+		[[nodiscard]] Clock::time_point GetTimestamp() const noexcept
+		{
+			return Timestamp;
+		}
+
 	private:
 		Type Type;
 		bool bIsLeftPressed;
 		bool bIsRightPressed;
 		int X;
 		int Y;
+		Clock::time_point Timestamp {};
 	};
 
 	Mouse() = default;
@@ -94,7 +108,7 @@ public:
 
 	void Flush() noexcept
 	{
-		Buffer = std::queue<Event>{};
+		Buffer.Clear();
 	}
 
 	[[nodiscard]] std::pair<int, int> GetPos() const noexcept
@@ -129,7 +143,7 @@ public:
 
 	[[nodiscard]] bool IsEmpty() const noexcept
 	{
-		return Buffer.empty();
+		return Buffer.IsEmpty();
 	}
 
 	void EnableRawInput() noexcept
@@ -159,20 +173,25 @@ private:
 	void OnLeave() noexcept;
 	void OnEnter() noexcept;
 	void OnRawDelta(int InDeltaX, int InDeltaY);
-	void TrimBuffer() noexcept;
-	void TrimRawInputBuffer() noexcept;
 
 private:
 	static constexpr unsigned int BufferSize {16u};
-
-	int X;
-	int Y;
-	int WheelDeltaCarry;
-	bool bIsLeftPressed {false};
-	bool bIsRightPressed {false};
-	bool bIsInWindow {false};
-	bool bIsRawInputEnabled {false};
-
-	std::queue<Event> Buffer;
-	std::queue<RawDelta> RawDeltaBuffer;
+	// A 1000 Hz mouse alone sends 16 per frame at 60 Hz, room for a long hitch before the oldest is dropped.
+	static constexpr unsigned int RawDeltaBufferSize {256u};
+
+	// Filled by the window procedure and drained by the render loop, which may run on another thread.
+	template<typename T, unsigned int Size = BufferSize>
+	using EventQueue = SpscQueue<T, Size>;
+
+	// Latest state snapshot, written by the window procedure and read at any time by the render loop.
+	std::atomic<int> X {0};
+	std::atomic<int> Y {0};
+	int WheelDeltaCarry {0};
+	std::atomic<bool> bIsLeftPressed {false};
+	std::atomic<bool> bIsRightPressed {false};
+	std::atomic<bool> bIsInWindow {false};
+	std::atomic<bool> bIsRawInputEnabled {false};
+
+	EventQueue<Event> Buffer;
+	EventQueue<RawDelta, RawDeltaBufferSize> RawDeltaBuffer;
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+// Set by ObjectPicker before each candidate's draw.
+cbuffer ObjectId : register(b0)
+{
+    uint Id;
+    uint3 Padding;
+};
+
+// Whatever is in front under the pick pixel leaves its ID behind.
+uint main() : SV_Target
+{
+    return Id;
+}
@@ -0,0 +1,8 @@
+// Motion vectors of a drawable that moved since last frame, drawn with its depth only vertex shader where its depth is still in front.
+// The reprojection set for it takes the surface through its own space to where it was last frame.
+#include "Motion.hlsli"
+
+float2 main(const float4 InPosition : SV_Position) : SV_Target
+{
+    return GetMotion(InPosition.xy, InPosition.z);
+}
@@ -0,0 +1,194 @@
+﻿#include "ObjectPicker.h"
+#include <cassert>
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+ObjectPicker::ObjectPicker(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+{
+	HRESULT ResultHandle;
+
+	const auto Blob = InShaderBundle.Load("ObjectIdPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &IdShader))
+
+	D3D11_BUFFER_DESC ConstantDesc {};
+	ConstantDesc.ByteWidth = 4u * sizeof(UINT);
+	ConstantDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantDesc, nullptr, &IdConstantBuffer))
+
+	// The one pixel under the cursor, the projection stretches it over the whole target.
+	D3D11_TEXTURE2D_DESC TargetDesc {};
+	TargetDesc.Width = 1u;
+	TargetDesc.Height = 1u;
+	TargetDesc.MipLevels = 1u;
+	TargetDesc.ArraySize = 1u;
+	TargetDesc.Format = DXGI_FORMAT_R32_UINT;
+	TargetDesc.SampleDesc.Count = 1u;
+	TargetDesc.Usage = D3D11_USAGE_DEFAULT;
+	TargetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TargetDesc, nullptr, &IdTarget))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(IdTarget.Get(), nullptr, &IdTargetView))
+
+	auto DepthDesc = TargetDesc;
+	DepthDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	DepthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> DepthTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&DepthDesc, nullptr, &DepthTexture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilView(DepthTexture.Get(), nullptr, &DepthView))
+
+	auto StagingDesc = TargetDesc;
+	StagingDesc.Usage = D3D11_USAGE_STAGING;
+	StagingDesc.BindFlags = 0u;
+	StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	for (auto& Pending : Readbacks)
+	{
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&StagingDesc, nullptr, &Pending.Staging))
+	}
+}
+
+void ObjectPicker::BeginFrame(const Graphics& InGraphics)
+{
+	Candidates.clear();
+	bIsPicking = false;
+
+	auto* const Context = InGraphics.GetImmediateContext().GetDeviceContext();
+
+	// Oldest first, the GPU finishes them in order, so the first one still drawing holds up the others too.
+	for (unsigned int Offset = 0u; Offset < ReadbackNum; ++Offset)
+	{
+		auto& Pending = Readbacks[(NextReadback + Offset) % ReadbackNum];
+		D3D11_MAPPED_SUBRESOURCE Mapped;
+
+		if (!Pending.bIsPending)
+		{
+			continue;
+		}
+
+		if (FAILED(Context->Map(Pending.Staging.Get(), 0u, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &Mapped)))
+		{
+			break;
+		}
+
+		const auto Id = *static_cast<const UINT*>(Mapped.pData);
+		Context->Unmap(Pending.Staging.Get(), 0u);
+
+		Results.push_back(Id != NoId && Id <= Pending.Tags.size() ? Pending.Tags[Id - 1u] : Result {});
+		Pending.Tags.clear();
+		Pending.bIsPending = false;
+	}
+
+	if (!bIsRequested || Readbacks[NextReadback].bIsPending)
+	{
+		return;
+	}
+
+	bIsRequested = false;
+	bIsPicking = true;
+
+	// The pixel's center in normalized device coordinates, then moved to the origin and scaled up until the pixel fills
+	// the clip space square, its neighbors fall outside the frustum.
+	const auto& Viewport = InGraphics.GetDisplayViewport();
+	const auto CenterX = 2.0f * (static_cast<float>(RequestedX) + 0.5f - Viewport.TopLeftX) / Viewport.Width - 1.0f;
+	const auto CenterY = 1.0f - 2.0f * (static_cast<float>(RequestedY) + 0.5f - Viewport.TopLeftY) / Viewport.Height;
+	const DirectX::XMMATRIX Narrowing
+	{
+		Viewport.Width, 0.0f, 0.0f, 0.0f,
+		0.0f, Viewport.Height, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		-CenterX * Viewport.Width, -CenterY * Viewport.Height, 0.0f, 1.0f
+	};
+
+	const auto Projection = InGraphics.GetProjectionMatrix() * Narrowing;
+	const auto View = InGraphics.GetViewMatrix();
+	DirectX::XMStoreFloat4x4(&PickProjection, Projection);
+	DirectX::XMStoreFloat4x4(&PickView, View);
+
+	PickFrustum = DirectX::BoundingFrustum(Projection);
+	PickFrustum.Transform(PickFrustum, DirectX::XMMatrixInverse(nullptr, View));
+}
+
+void ObjectPicker::RequestPick(const int InX, const int InY) noexcept
+{
+	RequestedX = InX;
+	RequestedY = InY;
+	bIsRequested = true;
+}
+
+void ObjectPicker::AddCandidate(const Drawable& InDrawable, const void* InOwner, const unsigned int InItem)
+{
+	assert(bIsPicking && "Candidate added on a frame without a pick");
+	assert(InDrawable.IsDepthOnlySupported() && "Pick candidates are drawn with their depth only vertex shader");
+
+	// Candidates may not be submitted to the queue this frame, such as meshes an impostor stands in for.
+	InDrawable.Prepare();
+
+	Candidates.push_back({&InDrawable, {InOwner, InItem}});
+}
+
+void ObjectPicker::Render(const Graphics& InGraphics)
+{
+	if (!bIsPicking)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Object pick");
+
+	HRESULT ResultHandle;
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	constexpr float ClearColor[] = {static_cast<float>(NoId), 0.0f, 0.0f, 0.0f};
+	Cache.SetRenderTarget(IdTargetView.Get(), DepthView.Get());
+	DeviceContext->ClearRenderTargetView(IdTargetView.Get(), ClearColor);
+	DeviceContext->ClearDepthStencilView(DepthView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+
+	constexpr D3D11_VIEWPORT PixelViewport {0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f};
+	DeviceContext->RSSetViewports(1u, &PixelViewport);
+	InGraphics.BindDepthTest(Context, DepthTest::Less);
+	InGraphics.OverrideViewConstants(Context, DirectX::XMLoadFloat4x4(&PickView), DirectX::XMLoadFloat4x4(&PickProjection));
+	Cache.SetPixelConstantBuffer(ConstantSlot, IdConstantBuffer.Get());
+
+	auto& Pending = Readbacks[NextReadback];
+	Pending.Tags.clear();
+
+	for (const auto& [Drawn, Tag] : Candidates)
+	{
+		// A handful of draws on the rare frame that picks, uploaded one by one.
+		Pending.Tags.push_back(Tag);
+		const UINT Id = static_cast<UINT>(Pending.Tags.size());
+
+		D3D11_MAPPED_SUBRESOURCE Mapped;
+		CHECK_HRESULT_EXCEPTION(DeviceContext->Map(IdConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &Mapped))
+		*static_cast<UINT*>(Mapped.pData) = Id;
+		DeviceContext->Unmap(IdConstantBuffer.Get(), 0u);
+
+		Drawn->DrawWithPixelShader(Context, IdShader.Get());
+	}
+
+	DeviceContext->CopyResource(Pending.Staging.Get(), IdTarget.Get());
+	Pending.bIsPending = true;
+	NextReadback = (NextReadback + 1u) % ReadbackNum;
+
+	InGraphics.RestoreViewConstants(Context);
+	InGraphics.BindFrameState(Context);
+}
+
+std::optional<ObjectPicker::Result> ObjectPicker::TakeResult() noexcept
+{
+	if (Results.empty())
+	{
+		return std::nullopt;
+	}
+
+	const auto Oldest = Results.front();
+	Results.erase(Results.begin());
+	return Oldest;
+}
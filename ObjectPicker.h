@@ -0,0 +1,107 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <optional>
+#include <vector>
+#include "wrl/client.h"
+
+class Drawable;
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Picks what is drawn under a pixel by drawing IDs instead of testing rays against the geometry on the CPU.
+ * A requested pick narrows the next frame's projection to the one pixel, so only what the tiny frustum around it holds is
+ * handed over, and draws those drawables depth only with a pixel shader writing each one's ID into a single pixel
+ * R32_UINT target. The pixel is copied into a ring of staging textures and read a few frames later without waiting on
+ * the GPU. Frames without a pick draw and copy nothing.
+ */
+class ObjectPicker
+{
+public:
+	// What the candidate drawn in front under the cursor was added for, Owner is null when nothing was.
+	struct Result
+	{
+		const void* Owner {nullptr};
+		unsigned int Item {0u};
+	};
+
+	ObjectPicker(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	ObjectPicker(const ObjectPicker&) = delete;
+	ObjectPicker(ObjectPicker&&) = delete;
+	ObjectPicker& operator=(const ObjectPicker&) = delete;
+	ObjectPicker& operator=(ObjectPicker&&) = delete;
+	~ObjectPicker() = default;
+
+	// Reads back whichever earlier picks the GPU finished, and narrows this frame's pick to the requested pixel, if any
+	// and the ring has room. After the frame's view and projection are set.
+	void BeginFrame(const Graphics& InGraphics);
+
+	// In display pixels, drawn on the next frame. A later request the same frame replaces it.
+	void RequestPick(int InX, int InY) noexcept;
+
+	// The world space frustum around this frame's pick pixel, null on frames without a pick.
+	[[nodiscard]] const DirectX::BoundingFrustum* GetPickFrustum() const noexcept
+	{
+		return bIsPicking ? &PickFrustum : nullptr;
+	}
+
+	// The drawable is drawn into this frame's pick, tagged with what the result names when it is in front. InOwner is only
+	// compared, never dereferenced, so it may be gone by the time the result arrives.
+	void AddCandidate(const Drawable& InDrawable, const void* InOwner, unsigned int InItem);
+
+	// Draws this frame's candidates, if it picks. Leaves the frame state bound again.
+	void Render(const Graphics& InGraphics);
+
+	[[nodiscard]] bool IsPicking() const noexcept
+	{
+		return bIsPicking;
+	}
+
+	// The oldest pick that came back, once.
+	[[nodiscard]] std::optional<Result> TakeResult() noexcept;
+
+private:
+	struct Candidate
+	{
+		const Drawable* Drawn;
+		Result Tag;
+	};
+
+	// A pick copied out and waiting for the GPU, with what its IDs stood for.
+	struct Readback
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Staging;
+		std::vector<Result> Tags;
+		bool bIsPending {false};
+	};
+
+	// Staging textures in flight, and so picks a frame can read back at most.
+	static constexpr unsigned int ReadbackNum {3u};
+	// Pixel shader register of the ID constants in ObjectIdPS.hlsl.
+	static constexpr UINT ConstantSlot {0u};
+	// Written where nothing was drawn, IDs are candidate indices plus one.
+	static constexpr UINT NoId {0u};
+
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> IdShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> IdConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> IdTarget;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> IdTargetView;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthView;
+	std::array<Readback, ReadbackNum> Readbacks;
+	// Where the next pick is copied, the oldest in flight when all are.
+	unsigned int NextReadback {0u};
+
+	std::vector<Candidate> Candidates;
+	std::vector<Result> Results;
+	DirectX::BoundingFrustum PickFrustum;
+	DirectX::XMFLOAT4X4 PickProjection;
+	DirectX::XMFLOAT4X4 PickView;
+	int RequestedX {0};
+	int RequestedY {0};
+	bool bIsRequested {false};
+	bool bIsPicking {false};
+};
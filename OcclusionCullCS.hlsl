@@ -0,0 +1,61 @@
+#include "HiZ.hlsli"
+
+struct Candidate
+{
+    float3 Center;
+    uint IndexCount;
+    float3 Extents;
+    uint StartIndex;
+    int BaseVertex;
+    uint3 Padding;
+};
+
+StructuredBuffer<Candidate> Candidates : register(t0);
+Texture2D<float> Pyramid : register(t1);
+ByteAddressBuffer FirstPhaseArguments : register(t2);
+RWByteAddressBuffer Arguments : register(u0);
+
+cbuffer Cull : register(b0)
+{
+    matrix ViewProjection;
+    float2 PyramidSize;
+    uint PyramidMipNum;
+    uint CandidateNum;
+    uint bIsSecondPhase;
+    uint bHasPyramid;
+}
+
+// D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS
+static const uint ArgumentStride = 20u;
+
+bool IsVisible(const Candidate InCandidate)
+{
+    return !bHasPyramid || IsBoxUnoccluded(Pyramid, InCandidate.Center, InCandidate.Extents, ViewProjection, PyramidSize, PyramidMipNum);
+}
+
+[numthreads(64, 1, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    const uint Index = InThreadID.x;
+
+    if (Index >= CandidateNum)
+    {
+        return;
+    }
+
+    const Candidate Target = Candidates[Index];
+    bool bIsVisible = IsVisible(Target);
+
+    // The second phase only draws what the first one rejected, everything else is already on screen.
+    if (bIsSecondPhase)
+    {
+        bIsVisible = bIsVisible && FirstPhaseArguments.Load(Index * ArgumentStride + 4u) == 0u;
+    }
+
+    const uint Address = Index * ArgumentStride;
+    Arguments.Store(Address, Target.IndexCount);
+    Arguments.Store(Address + 4u, bIsVisible ? 1u : 0u);
+    Arguments.Store(Address + 8u, Target.StartIndex);
+    Arguments.Store(Address + 12u, asuint(Target.BaseVertex));
+    Arguments.Store(Address + 16u, 0u);
+}
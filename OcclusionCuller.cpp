@@ -0,0 +1,301 @@
+﻿#include "OcclusionCuller.h"
+#include <algorithm>
+#include <cstring>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	constexpr UINT PyramidGroupSize {8u};
+	constexpr UINT CullGroupSize {64u};
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> LoadComputeShader(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, const char* InFileName)
+	{
+		HRESULT ResultHandle;
+		Microsoft::WRL::ComPtr<ID3D11ComputeShader> Shader;
+
+		const auto Blob = InShaderBundle.Load(InFileName);
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &Shader))
+
+		return Shader;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CreateConstantBuffer(ID3D11Device* InDevice, const UINT InByteWidth)
+	{
+		HRESULT ResultHandle;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+
+		D3D11_BUFFER_DESC Desc {};
+		Desc.ByteWidth = InByteWidth;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&Desc, nullptr, &Buffer))
+
+		return Buffer;
+	}
+
+	// Raw views let the cull shader write the arguments the input assembler later reads.
+	void CreateArguments(ID3D11Device* InDevice, Microsoft::WRL::ComPtr<ID3D11Buffer>& OutBuffer,
+	                     Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>& OutUav, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>* OutView)
+	{
+		HRESULT ResultHandle;
+		constexpr auto ByteWidth = OcclusionCuller::MaxCandidateNum * OcclusionCuller::ArgumentStride;
+
+		D3D11_BUFFER_DESC Desc {};
+		Desc.ByteWidth = ByteWidth;
+		Desc.Usage = D3D11_USAGE_DEFAULT;
+		Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+		Desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&Desc, nullptr, &OutBuffer))
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC UavDesc {};
+		UavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		UavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		UavDesc.Buffer.NumElements = ByteWidth / sizeof(UINT);
+		UavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(OutBuffer.Get(), &UavDesc, &OutUav))
+
+		if (OutView)
+		{
+			D3D11_SHADER_RESOURCE_VIEW_DESC ViewDesc {};
+			ViewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+			ViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+			ViewDesc.BufferEx.NumElements = ByteWidth / sizeof(UINT);
+			ViewDesc.BufferEx.Flags = D3D11_BUFFEREX_SRV_FLAG_RAW;
+			CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(OutBuffer.Get(), &ViewDesc, OutView->ReleaseAndGetAddressOf()))
+		}
+	}
+}
+
+OcclusionCuller::OcclusionCuller(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView, const UINT InWidth, const UINT InHeight)
+	: DepthView(InDepthView)
+{
+	HRESULT ResultHandle;
+
+	DownsampleShader = LoadComputeShader(InDevice, InShaderBundle, "HiZDownsampleCS.cso");
+	CullShader = LoadComputeShader(InDevice, InShaderBundle, "OcclusionCullCS.cso");
+	DownsampleConstantBuffer = CreateConstantBuffer(InDevice, sizeof(DownsampleConstants));
+	CullConstantBuffer = CreateConstantBuffer(InDevice, sizeof(CullConstants));
+	CreatePyramid(InDevice, InWidth, InHeight);
+
+	D3D11_BUFFER_DESC CandidateDesc {};
+	CandidateDesc.ByteWidth = MaxCandidateNum * sizeof(Candidate);
+	CandidateDesc.Usage = D3D11_USAGE_DYNAMIC;
+	CandidateDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	CandidateDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CandidateDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	CandidateDesc.StructureByteStride = sizeof(Candidate);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&CandidateDesc, nullptr, &CandidateBuffer))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(CandidateBuffer.Get(), nullptr, &CandidateView))
+
+	CreateArguments(InDevice, FirstPhaseArguments, FirstPhaseArgumentsUav, &FirstPhaseArgumentsView);
+	CreateArguments(InDevice, SecondPhaseArguments, SecondPhaseArgumentsUav, nullptr);
+
+	Candidates.reserve(MaxCandidateNum);
+}
+
+void OcclusionCuller::Resize(ID3D11Device* InDevice, ID3D11ShaderResourceView* InDepthView, const UINT InWidth, const UINT InHeight)
+{
+	DepthView = InDepthView;
+	PyramidMipViews.clear();
+	PyramidMipUavs.clear();
+	CreatePyramid(InDevice, InWidth, InHeight);
+	// Its depths are of the old size, culling against them would reject visible objects.
+	bHasPyramid = false;
+}
+
+void OcclusionCuller::CreatePyramid(ID3D11Device* InDevice, const UINT InWidth, const UINT InHeight)
+{
+	HRESULT ResultHandle;
+
+	PyramidWidth = std::max((InWidth + 1u) / 2u, 1u);
+	PyramidHeight = std::max((InHeight + 1u) / 2u, 1u);
+	BuiltWidth = PyramidWidth;
+	BuiltHeight = PyramidHeight;
+
+	UINT MipNum = 1u;
+	while ((std::max(PyramidWidth, PyramidHeight) >> MipNum) > 0u)
+	{
+		++MipNum;
+	}
+
+	D3D11_TEXTURE2D_DESC PyramidDesc {};
+	PyramidDesc.Width = PyramidWidth;
+	PyramidDesc.Height = PyramidHeight;
+	PyramidDesc.MipLevels = MipNum;
+	PyramidDesc.ArraySize = 1u;
+	PyramidDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	PyramidDesc.SampleDesc.Count = 1u;
+	PyramidDesc.Usage = D3D11_USAGE_DEFAULT;
+	PyramidDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&PyramidDesc, nullptr, &Pyramid))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Pyramid.Get(), nullptr, &PyramidView))
+
+	for (UINT Mip = 0u; Mip < MipNum; ++Mip)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC MipViewDesc {};
+		MipViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		MipViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		MipViewDesc.Texture2D.MostDetailedMip = Mip;
+		MipViewDesc.Texture2D.MipLevels = 1u;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Pyramid.Get(), &MipViewDesc, &PyramidMipViews.emplace_back()))
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC MipUavDesc {};
+		MipUavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		MipUavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+		MipUavDesc.Texture2D.MipSlice = Mip;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(Pyramid.Get(), &MipUavDesc, &PyramidMipUavs.emplace_back()))
+	}
+}
+
+void OcclusionCuller::BeginFrame() noexcept
+{
+	Candidates.clear();
+}
+
+unsigned int OcclusionCuller::AddCandidate(const DirectX::BoundingBox& InWorldBounds, const UINT InIndexCount, const UINT InStartIndex,
+                                           const INT InBaseVertex) noexcept
+{
+	if (!bIsEnabled)
+	{
+		return NoSlot;
+	}
+
+	std::lock_guard Lock(CandidateMutex);
+
+	if (Candidates.size() == MaxCandidateNum)
+	{
+		return NoSlot;
+	}
+
+	Candidates.push_back({InWorldBounds.Center, InIndexCount, InWorldBounds.Extents, InStartIndex, InBaseVertex, {}});
+	return static_cast<unsigned int>(Candidates.size() - 1u);
+}
+
+void OcclusionCuller::CullFirstPhase(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Occlusion cull");
+
+	auto* const Context = InGraphics.GetImmediateContext().GetDeviceContext();
+	Upload(Context, CandidateBuffer.Get(), Candidates.data(), Candidates.size());
+
+	Cull(InGraphics, Phase::First);
+}
+
+void OcclusionCuller::CullSecondPhase(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Occlusion retest");
+
+	BuildPyramid(InGraphics);
+	Cull(InGraphics, Phase::Second);
+}
+
+void OcclusionCuller::EndFrame(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Hi-Z pyramid");
+
+	BuildPyramid(InGraphics);
+}
+
+void OcclusionCuller::BuildPyramid(const Graphics& InGraphics)
+{
+	auto* const Context = InGraphics.GetImmediateContext().GetDeviceContext();
+
+	// A multisampled depth buffer is read through its resolved copy.
+	InGraphics.ResolveDepth();
+
+	// The depth buffer cannot be read while it is bound for writing.
+	Context->OMSetRenderTargets(0u, nullptr, nullptr);
+	Context->CSSetShader(DownsampleShader.Get(), nullptr, 0u);
+	Context->CSSetConstantBuffers(0u, 1u, DownsampleConstantBuffer.GetAddressOf());
+
+	// Only the viewport's part of the depth buffer was drawn this frame. The pyramid keeps it in its own top left, and
+	// the cull maps the screen onto whatever part that is.
+	UINT SourceWidth = static_cast<UINT>(InGraphics.GetViewport().Width);
+	UINT SourceHeight = static_cast<UINT>(InGraphics.GetViewport().Height);
+	ID3D11ShaderResourceView* Source = DepthView;
+
+	BuiltWidth = std::min(std::max((SourceWidth + 1u) / 2u, 1u), PyramidWidth);
+	BuiltHeight = std::min(std::max((SourceHeight + 1u) / 2u, 1u), PyramidHeight);
+
+	for (UINT Mip = 0u; Mip < PyramidMipViews.size(); ++Mip)
+	{
+		const UINT Width = std::max(BuiltWidth >> Mip, 1u);
+		const UINT Height = std::max(BuiltHeight >> Mip, 1u);
+		const DownsampleConstants Constants {{SourceWidth, SourceHeight}, {Width, Height}};
+		Upload(Context, DownsampleConstantBuffer.Get(), &Constants, 1u);
+
+		// A mip is only read as the next one's source after its own UAV is unbound.
+		ID3D11ShaderResourceView* const NullView = nullptr;
+		Context->CSSetShaderResources(0u, 1u, &NullView);
+		Context->CSSetUnorderedAccessViews(0u, 1u, PyramidMipUavs[Mip].GetAddressOf(), nullptr);
+		Context->CSSetShaderResources(0u, 1u, &Source);
+		Context->Dispatch((Width + PyramidGroupSize - 1u) / PyramidGroupSize, (Height + PyramidGroupSize - 1u) / PyramidGroupSize, 1u);
+
+		ID3D11UnorderedAccessView* const NullUav = nullptr;
+		Context->CSSetUnorderedAccessViews(0u, 1u, &NullUav, nullptr);
+
+		SourceWidth = Width;
+		SourceHeight = Height;
+		Source = PyramidMipViews[Mip].Get();
+	}
+
+	ID3D11ShaderResourceView* const NullView = nullptr;
+	Context->CSSetShaderResources(0u, 1u, &NullView);
+
+	InGraphics.RestoreFrameState();
+	bHasPyramid = true;
+}
+
+void OcclusionCuller::Cull(const Graphics& InGraphics, const Phase InPhase)
+{
+	if (Candidates.empty())
+	{
+		return;
+	}
+
+	auto* const Context = InGraphics.GetImmediateContext().GetDeviceContext();
+
+	CullConstants Constants {};
+	Constants.ViewProjection = DirectX::XMMatrixTranspose(InGraphics.GetViewProjectionMatrix());
+	Constants.PyramidSize = {static_cast<float>(BuiltWidth), static_cast<float>(BuiltHeight)};
+	Constants.PyramidMipNum = static_cast<UINT>(PyramidMipViews.size());
+	Constants.CandidateNum = static_cast<UINT>(Candidates.size());
+	Constants.bIsSecondPhase = InPhase == Phase::Second;
+	Constants.bHasPyramid = bHasPyramid;
+	Upload(Context, CullConstantBuffer.Get(), &Constants, 1u);
+
+	ID3D11ShaderResourceView* const Views[] =
+	{
+		CandidateView.Get(),
+		PyramidView.Get(),
+		InPhase == Phase::Second ? FirstPhaseArgumentsView.Get() : nullptr
+	};
+	auto* const Uav = InPhase == Phase::First ? FirstPhaseArgumentsUav.Get() : SecondPhaseArgumentsUav.Get();
+
+	Context->CSSetShader(CullShader.Get(), nullptr, 0u);
+	Context->CSSetConstantBuffers(0u, 1u, CullConstantBuffer.GetAddressOf());
+	Context->CSSetShaderResources(0u, static_cast<UINT>(std::size(Views)), Views);
+	Context->CSSetUnorderedAccessViews(0u, 1u, &Uav, nullptr);
+	Context->Dispatch((Constants.CandidateNum + CullGroupSize - 1u) / CullGroupSize, 1u, 1u);
+
+	// Unbound so the arguments can feed the input assembler.
+	ID3D11ShaderResourceView* const NullViews[std::size(Views)] {};
+	ID3D11UnorderedAccessView* const NullUav = nullptr;
+	Context->CSSetShaderResources(0u, static_cast<UINT>(std::size(NullViews)), NullViews);
+	Context->CSSetUnorderedAccessViews(0u, 1u, &NullUav, nullptr);
+}
+
+template<typename T>
+void OcclusionCuller::Upload(ID3D11DeviceContext* InContext, ID3D11Buffer* InBuffer, const T* InData, const size_t InCount)
+{
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(InContext->Map(InBuffer, 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, InData, sizeof(T) * InCount);
+	InContext->Unmap(InBuffer, 0u);
+}
@@ -0,0 +1,167 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <mutex>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Optional GPU occlusion test of submitted mesh bounds against a hierarchical Z pyramid of the depth buffer.
+ * The first phase tests against last frame's pyramid. The second rebuilds it from the depth drawn so far and
+ * retests what the first rejected, so objects that just came into view are never lost.
+ * Results are written straight into indirect draw arguments, nothing is read back on the CPU.
+ */
+class OcclusionCuller
+{
+public:
+	enum class Phase
+	{
+		First,
+		Second
+	};
+
+	static constexpr unsigned int NoSlot {~0u};
+	static constexpr unsigned int MaxCandidateNum {4096u};
+	// Byte size of D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS.
+	static constexpr UINT ArgumentStride {5u * sizeof(UINT)};
+
+	// Sized for a depth buffer of InWidth by InHeight, of which each build reads the part the frame's viewport covers.
+	OcclusionCuller(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView, UINT InWidth, UINT InHeight);
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller(OcclusionCuller&&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(OcclusionCuller&&) = delete;
+	~OcclusionCuller() = default;
+
+	// For a depth buffer resized to InWidth by InHeight, the pyramid is rebuilt from the next frame's.
+	void Resize(ID3D11Device* InDevice, ID3D11ShaderResourceView* InDepthView, UINT InWidth, UINT InHeight);
+
+	void BeginFrame() noexcept;
+	// Slot of the candidate's arguments, NoSlot when disabled or full so the caller draws directly. Any thread during submission.
+	[[nodiscard]] unsigned int AddCandidate(const DirectX::BoundingBox& InWorldBounds, UINT InIndexCount, UINT InStartIndex, INT InBaseVertex) noexcept;
+
+	void CullFirstPhase(const Graphics& InGraphics);
+	void CullSecondPhase(const Graphics& InGraphics);
+	// Leaves a pyramid of the final depth for the next frame's first phase.
+	void EndFrame(const Graphics& InGraphics);
+
+	[[nodiscard]] ID3D11Buffer* GetArguments(const Phase InPhase) const noexcept
+	{
+		return InPhase == Phase::First ? FirstPhaseArguments.Get() : SecondPhaseArguments.Get();
+	}
+
+	[[nodiscard]] bool HasCandidates() const noexcept
+	{
+		return !Candidates.empty();
+	}
+
+	// False until a pyramid was built since culling was enabled.
+	[[nodiscard]] bool HasPyramid() const noexcept
+	{
+		return bHasPyramid;
+	}
+
+	[[nodiscard]] ID3D11ShaderResourceView* GetPyramidView() const noexcept
+	{
+		return PyramidView.Get();
+	}
+
+	// The part of mip 0 the last build filled.
+	[[nodiscard]] DirectX::XMFLOAT2 GetPyramidSize() const noexcept
+	{
+		return {static_cast<float>(BuiltWidth), static_cast<float>(BuiltHeight)};
+	}
+
+	[[nodiscard]] UINT GetPyramidMipNum() const noexcept
+	{
+		return static_cast<UINT>(PyramidMipViews.size());
+	}
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+		// Whatever the pyramid holds is from before culling was turned off.
+		bHasPyramid = false;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+private:
+	struct Candidate
+	{
+		DirectX::XMFLOAT3 Center;
+		UINT IndexCount;
+		DirectX::XMFLOAT3 Extents;
+		UINT StartIndex;
+		INT BaseVertex;
+		UINT Padding[3];
+	};
+
+	struct CullConstants
+	{
+		DirectX::XMMATRIX ViewProjection;
+		DirectX::XMFLOAT2 PyramidSize;
+		UINT PyramidMipNum;
+		UINT CandidateNum;
+		UINT bIsSecondPhase;
+		UINT bHasPyramid;
+		UINT Padding[2];
+	};
+
+	struct DownsampleConstants
+	{
+		UINT SourceSize[2];
+		UINT DestinationSize[2];
+	};
+
+	void CreatePyramid(ID3D11Device* InDevice, UINT InWidth, UINT InHeight);
+	void BuildPyramid(const Graphics& InGraphics);
+	void Cull(const Graphics& InGraphics, Phase InPhase);
+
+	template<typename T>
+	void Upload(ID3D11DeviceContext* InContext, ID3D11Buffer* InBuffer, const T* InData, size_t InCount);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> DownsampleShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> CullShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> DownsampleConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CullConstantBuffer;
+
+	ID3D11ShaderResourceView* DepthView;
+
+	// Mip 0 is half the depth resolution, every mip keeps the farthest depth below it.
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Pyramid;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> PyramidView;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> PyramidMipViews;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>> PyramidMipUavs;
+	UINT PyramidWidth {0u};
+	UINT PyramidHeight {0u};
+	// What of mip 0 the last build filled, less than all of it while the scene renders below full resolution.
+	UINT BuiltWidth {0u};
+	UINT BuiltHeight {0u};
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CandidateBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CandidateView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> FirstPhaseArguments;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> FirstPhaseArgumentsView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> FirstPhaseArgumentsUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> SecondPhaseArguments;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> SecondPhaseArgumentsUav;
+
+	std::mutex CandidateMutex;
+	std::vector<Candidate> Candidates;
+	bool bIsEnabled {false};
+	bool bHasPyramid {false};
+};
@@ -0,0 +1,140 @@
+﻿#include "OcclusionPredication.h"
+#include <cstring>
+#include "Camera.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+OcclusionPredication::OcclusionPredication(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+	: Device(InDevice)
+{
+	HRESULT ResultHandle;
+
+	const auto VertexBlob = InShaderBundle.Load("OcclusionProxyVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &VertexShader))
+
+	D3D11_BUFFER_DESC BoxDesc {};
+	BoxDesc.ByteWidth = MaxProxyNum * sizeof(ProxyBox);
+	BoxDesc.Usage = D3D11_USAGE_DYNAMIC;
+	BoxDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	BoxDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	BoxDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	BoxDesc.StructureByteStride = sizeof(ProxyBox);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&BoxDesc, nullptr, &BoxBuffer))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(BoxBuffer.Get(), nullptr, &BoxView))
+
+	// The far side of a box still passes where the near one is clipped away by the near plane.
+	D3D11_RASTERIZER_DESC RasterizerDesc {};
+	RasterizerDesc.FillMode = D3D11_FILL_SOLID;
+	RasterizerDesc.CullMode = D3D11_CULL_NONE;
+	RasterizerDesc.DepthClipEnable = TRUE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateRasterizerState(&RasterizerDesc, &RasterizerState))
+
+	D3D11_DEPTH_STENCIL_DESC DepthStencilDesc {};
+	DepthStencilDesc.DepthEnable = TRUE;
+	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DepthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&DepthStencilDesc, &DepthStencilState))
+
+	Proxies.reserve(MaxProxyNum);
+}
+
+void OcclusionPredication::BeginFrame(const Graphics& InGraphics) noexcept
+{
+	Proxies.clear();
+	++FrameIndex;
+
+	DirectX::XMFLOAT4X4 ProjectionValues;
+	DirectX::XMStoreFloat4x4(&ProjectionValues, InGraphics.GetProjectionMatrix());
+	NearZ = -ProjectionValues._43 / ProjectionValues._33;
+	CameraPosition = InGraphics.GetCamera().GetPosition();
+}
+
+ID3D11Predicate* OcclusionPredication::AddCandidate(History& InOutHistory, const DirectX::BoundingBox& InWorldBounds)
+{
+	// Inside its bounds, or close enough for the near plane to cut into them, the box can't tell whether the mesh is covered.
+	// Past the last proxy the mesh draws unconditionally next frame too.
+	auto Grown = InWorldBounds;
+	Grown.Extents = {Grown.Extents.x + NearZ * 2.0f, Grown.Extents.y + NearZ * 2.0f, Grown.Extents.z + NearZ * 2.0f};
+
+	if (!bIsEnabled || Grown.Contains(DirectX::XMLoadFloat3(&CameraPosition)) != DirectX::DISJOINT)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard Lock(ProxyMutex);
+
+	if (Proxies.size() == MaxProxyNum)
+	{
+		return nullptr;
+	}
+
+	auto* const Previous = InOutHistory.IssuedFrame + 1u == FrameIndex ? InOutHistory.Predicates[InOutHistory.IssuedIndex].Get() : nullptr;
+	const auto Index = InOutHistory.IssuedIndex ^ 1u;
+	auto& Predicate = InOutHistory.Predicates[Index];
+
+	if (!Predicate)
+	{
+		HRESULT ResultHandle;
+
+		// Hinted, the GPU may still draw a mesh whose box was hidden if the result isn't in yet, never the other way around.
+		const D3D11_QUERY_DESC PredicateDesc {D3D11_QUERY_OCCLUSION_PREDICATE, D3D11_QUERY_MISC_PREDICATEHINT};
+		CHECK_HRESULT_EXCEPTION(Device->CreatePredicate(&PredicateDesc, &Predicate))
+	}
+
+	const auto& [Center, Extents] = InWorldBounds;
+	Proxies.push_back({{Center, 0.0f, {Extents.x + BoxMargin, Extents.y + BoxMargin, Extents.z + BoxMargin}, 0.0f}, Predicate.Get()});
+
+	InOutHistory.IssuedFrame = FrameIndex;
+	InOutHistory.IssuedIndex = Index;
+	return Previous;
+}
+
+void OcclusionPredication::Render(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Occlusion predicates");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(BoxBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+
+	for (size_t Index = 0u; Index < Proxies.size(); ++Index)
+	{
+		std::memcpy(static_cast<ProxyBox*>(MappedResource.pData) + Index, &Proxies[Index].Box, sizeof(ProxyBox));
+	}
+
+	DeviceContext->Unmap(BoxBuffer.Get(), 0u);
+	Cache.CountUpload(Proxies.size() * sizeof(ProxyBox));
+
+	// Depth only, with the scene still bound as the target, nothing reaches it without a pixel shader.
+	InGraphics.BindFrameState(Context);
+	Cache.SetRasterizerState(RasterizerState.Get());
+	Cache.SetDepthStencilState(DepthStencilState.Get());
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	Cache.SetInputLayout(nullptr);
+	Cache.SetVertexShader(VertexShader.Get());
+	Cache.SetHullShader(nullptr);
+	Cache.SetDomainShader(nullptr);
+	Cache.SetPixelShader(nullptr);
+	Cache.SetVertexShaderResource(BoxSlot, BoxView.Get());
+
+	// One query per box, each drawn from its own run of vertex IDs.
+	for (UINT Index = 0u; Index < static_cast<UINT>(Proxies.size()); ++Index)
+	{
+		auto* const Predicate = Proxies[Index].Predicate;
+		DeviceContext->Begin(Predicate);
+		DeviceContext->Draw(BoxVertexNum, Index * BoxVertexNum);
+		DeviceContext->End(Predicate);
+		Cache.CountDraw(BoxVertexNum, 1u);
+	}
+
+	// Instanced draws read their transforms through the same slot.
+	Cache.SetVertexShaderResource(BoxSlot, nullptr);
+	InGraphics.BindFrameState(Context);
+}
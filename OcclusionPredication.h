@@ -0,0 +1,132 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <cstdint>
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <mutex>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Occlusion predicates for meshes heavy enough that drawing them hidden costs more than a box. Once the frame's depth is
+ * final, the world bounds of every such mesh are drawn as a box that only tests depth, each inside an occlusion predicate
+ * query of its own, and the next frame draws the mesh itself under that predicate. The GPU then skips the whole draw where
+ * no sample of the box passed, and nothing is ever read back, at the cost of a mesh coming into view a frame late.
+ * Each mesh keeps two predicates and issues them in turn, so the one it is drawn under is never the one being written.
+ * Meshes the camera is inside draw unconditionally, from within its box says nothing about what covers the mesh.
+ */
+class OcclusionPredication
+{
+public:
+	static constexpr UINT MaxProxyNum {1024u};
+
+	// What a mesh keeps between frames, created on its first proxy.
+	struct History
+	{
+		std::array<Microsoft::WRL::ComPtr<ID3D11Predicate>, 2u> Predicates;
+		// The frame and predicate of the last proxy drawn for the mesh.
+		uint64_t IssuedFrame {~0ull};
+		UINT IssuedIndex {0u};
+	};
+
+	OcclusionPredication(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	OcclusionPredication(const OcclusionPredication&) = delete;
+	OcclusionPredication(OcclusionPredication&&) = delete;
+	OcclusionPredication& operator=(const OcclusionPredication&) = delete;
+	OcclusionPredication& operator=(OcclusionPredication&&) = delete;
+	~OcclusionPredication() = default;
+
+	// After the frame's view and projection are set.
+	void BeginFrame(const Graphics& InGraphics) noexcept;
+	// Queues the proxy of InWorldBounds under this frame's predicate of InOutHistory. Returns the predicate last frame's proxy
+	// was drawn under, or null when there's none to trust and the mesh is drawn unconditionally. Any thread during submission,
+	// each history from one at a time.
+	[[nodiscard]] ID3D11Predicate* AddCandidate(History& InOutHistory, const DirectX::BoundingBox& InWorldBounds);
+	// Draws the queued proxies against the frame's final depth, on the immediate context.
+	void Render(const Graphics& InGraphics);
+
+	// Meshes below this many triangles at full detail are cheaper to draw than to test.
+	[[nodiscard]] bool IsEligible(const UINT InTriangleNum) const noexcept
+	{
+		return bIsEnabled && InTriangleNum >= MinTriangleNum;
+	}
+
+	[[nodiscard]] bool HasProxies() const noexcept
+	{
+		return !Proxies.empty();
+	}
+
+	// Proxies queued this frame, the meshes drawn under a predicate next frame.
+	[[nodiscard]] UINT GetProxyNum() const noexcept
+	{
+		return static_cast<UINT>(Proxies.size());
+	}
+
+	void SetMinTriangleNum(const UINT InTriangleNum) noexcept
+	{
+		MinTriangleNum = InTriangleNum;
+	}
+
+	[[nodiscard]] UINT GetMinTriangleNum() const noexcept
+	{
+		return MinTriangleNum;
+	}
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+private:
+	// Laid out like ProxyBox in OcclusionProxyVS.hlsl.
+	struct ProxyBox
+	{
+		DirectX::XMFLOAT3 Center;
+		float Padding0;
+		DirectX::XMFLOAT3 Extents;
+		float Padding1;
+	};
+
+	struct Proxy
+	{
+		ProxyBox Box;
+		ID3D11Predicate* Predicate;
+	};
+
+	// Register of the boxes in OcclusionProxyVS.hlsl, and the vertices each box is drawn with.
+	static constexpr UINT BoxSlot {0u};
+	static constexpr UINT BoxVertexNum {36u};
+	// World units the boxes grow by, so the mesh's own surfaces on its bounds never hide them.
+	static constexpr float BoxMargin {0.01f};
+
+	ID3D11Device* Device;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> BoxBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> BoxView;
+	// Both faces, tested against depth with nothing written.
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> RasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> DepthStencilState;
+
+	std::mutex ProxyMutex;
+	std::vector<Proxy> Proxies;
+	uint64_t FrameIndex {0u};
+	DirectX::XMFLOAT3 CameraPosition {};
+	float NearZ {0.0f};
+	UINT MinTriangleNum {20000u};
+	bool bIsEnabled {true};
+};
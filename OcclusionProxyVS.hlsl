@@ -0,0 +1,33 @@
+// World space bounds of the meshes drawn under occlusion predicates, as boxes built from the vertex ID alone.
+// Each box is drawn as its own run of 36 vertices with no pixel shader, only whether any of its samples pass depth counts.
+#include "FrameConstants.hlsli"
+
+// Laid out like OcclusionPredication::ProxyBox.
+struct ProxyBox
+{
+    float3 Center;
+    float Padding0;
+    float3 Extents;
+    float Padding1;
+};
+
+StructuredBuffer<ProxyBox> Boxes : register(t0);
+
+// Two triangles per face, as corners whose bits are set for the positive side along x, y and z.
+static const uint BoxCorners[36] =
+{
+    0u, 2u, 3u, 0u, 3u, 1u,
+    4u, 5u, 7u, 4u, 7u, 6u,
+    0u, 4u, 6u, 0u, 6u, 2u,
+    1u, 3u, 7u, 1u, 7u, 5u,
+    0u, 1u, 5u, 0u, 5u, 4u,
+    2u, 6u, 7u, 2u, 7u, 3u
+};
+
+float4 main(const uint InVertexID : SV_VertexID) : SV_Position
+{
+    const ProxyBox Box = Boxes[InVertexID / 36u];
+    const uint Corner = BoxCorners[InVertexID % 36u];
+    const float3 Side = float3(Corner & 1u, (Corner >> 1u) & 1u, (Corner >> 2u) & 1u) * 2.0f - 1.0f;
+    return mul(float4(Box.Center + Box.Extents * Side, 1.0f), ViewProjection);
+}
@@ -0,0 +1,118 @@
+﻿#include "OrderIndependentTransparency.h"
+#include <iterator>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	// The bundle's MULTISAMPLED build of TransparencyCompositePS.hlsl, see the ShaderVariant items in Engine.vcxproj.
+	constexpr unsigned int MultisampledComposite {1u};
+}
+
+OrderIndependentTransparency::OrderIndependentTransparency(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, const UINT InWidth,
+                                                           const UINT InHeight, const UINT InSampleNum)
+	: SampleNum(InSampleNum)
+{
+	HRESULT ResultHandle;
+
+	CreateTargets(InDevice, InWidth, InHeight);
+
+	const auto VertexBlob = InShaderBundle.Load("FullscreenVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &VertexShader))
+
+	// Multisampled targets are resolved per sample, each one takes the blended surfaces that covered it.
+	const auto PixelBlob = InShaderBundle.Load("TransparencyCompositePS", InSampleNum > 1u ? MultisampledComposite : ShaderBundle::NoFeatures);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(PixelBlob->GetBufferPointer(), PixelBlob->GetBufferSize(), nullptr, &CompositeShader))
+
+	// The average colour over what is behind by the coverage, which the shader returns in alpha.
+	D3D11_BLEND_DESC BlendDesc {};
+	auto& Target = BlendDesc.RenderTarget[0];
+	Target.BlendEnable = TRUE;
+	Target.SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	Target.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	Target.BlendOp = D3D11_BLEND_OP_ADD;
+	Target.SrcBlendAlpha = D3D11_BLEND_ONE;
+	Target.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	Target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	Target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBlendState(&BlendDesc, &CompositeBlendState))
+
+	D3D11_DEPTH_STENCIL_DESC DepthStencilDesc {};
+	DepthStencilDesc.DepthEnable = FALSE;
+	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DepthStencilDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&DepthStencilDesc, &CompositeDepthState))
+}
+
+void OrderIndependentTransparency::Resize(ID3D11Device* InDevice, const UINT InWidth, const UINT InHeight)
+{
+	CreateTargets(InDevice, InWidth, InHeight);
+}
+
+void OrderIndependentTransparency::CreateTargets(ID3D11Device* InDevice, const UINT InWidth, const UINT InHeight)
+{
+	HRESULT ResultHandle;
+
+	const DXGI_FORMAT Formats[] = {AccumulationFormat, RevealageFormat};
+	static_assert(std::size(Formats) == std::tuple_size_v<decltype(TargetViews)>, "One format per target");
+
+	for (size_t Index = 0u; Index < std::size(Formats); ++Index)
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+		D3D11_TEXTURE2D_DESC TextureDesc {};
+		TextureDesc.Width = InWidth;
+		TextureDesc.Height = InHeight;
+		TextureDesc.MipLevels = 1u;
+		TextureDesc.ArraySize = 1u;
+		TextureDesc.Format = Formats[Index];
+		TextureDesc.SampleDesc.Count = SampleNum;
+		TextureDesc.SampleDesc.Quality = 0u;
+		TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+		TextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, nullptr, &Texture))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(Texture.Get(), nullptr, &OwnedTargetViews[Index]))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Texture.Get(), nullptr, &TextureViews[Index]))
+		TargetViews[Index] = OwnedTargetViews[Index].Get();
+	}
+}
+
+void OrderIndependentTransparency::Clear(const Graphics& InGraphics) const noexcept
+{
+	auto* const DeviceContext = InGraphics.GetImmediateContext().GetDeviceContext();
+
+	constexpr float Empty[] = {0.0f, 0.0f, 0.0f, 0.0f};
+	constexpr float Revealed[] = {1.0f, 1.0f, 1.0f, 1.0f};
+	DeviceContext->ClearRenderTargetView(TargetViews[0], Empty);
+	DeviceContext->ClearRenderTargetView(TargetViews[1], Revealed);
+}
+
+void OrderIndependentTransparency::Composite(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Transparency composite");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+
+	// Onto the scene, the targets can't stay bound for drawing while they are read.
+	InGraphics.BindFrameState(Context);
+	Cache.SetBlendState(CompositeBlendState.Get());
+	Cache.SetDepthStencilState(CompositeDepthState.Get());
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	Cache.SetInputLayout(nullptr);
+	Cache.SetVertexShader(VertexShader.Get());
+	Cache.SetHullShader(nullptr);
+	Cache.SetDomainShader(nullptr);
+	Cache.SetPixelShader(CompositeShader.Get());
+	Cache.SetPixelShaderResource(AccumulationSlot, TextureViews[0].Get());
+	Cache.SetPixelShaderResource(RevealageSlot, TextureViews[1].Get());
+
+	Context.GetDeviceContext()->Draw(3u, 0u);
+	Cache.CountDraw(3u, 1u);
+
+	// The material maps share these slots, and the targets are drawn into again next frame.
+	Cache.SetPixelShaderResource(AccumulationSlot, nullptr);
+	Cache.SetPixelShaderResource(RevealageSlot, nullptr);
+	InGraphics.BindFrameState(Context);
+}
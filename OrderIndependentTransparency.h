@@ -0,0 +1,61 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <span>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Weighted blended order-independent transparency. Blended material draws add their colour, premultiplied by opacity and
+ * a weight falling off with distance, into an accumulation target, and multiply one minus their opacity into a revealage
+ * target, so the result doesn't depend on draw order and the pass needs no sorting and batches like the opaque one.
+ * One fullscreen pass then divides the sum by its weights and blends the average over the scene by how much is covered.
+ * Both targets have the scene's sample count, they are drawn with the frame's depth. The layout is in Transparency.hlsli.
+ */
+class OrderIndependentTransparency
+{
+public:
+	static constexpr DXGI_FORMAT AccumulationFormat {DXGI_FORMAT_R16G16B16A16_FLOAT};
+	static constexpr DXGI_FORMAT RevealageFormat {DXGI_FORMAT_R16_FLOAT};
+
+	OrderIndependentTransparency(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, UINT InWidth, UINT InHeight, UINT InSampleNum);
+	OrderIndependentTransparency(const OrderIndependentTransparency&) = delete;
+	OrderIndependentTransparency(OrderIndependentTransparency&&) = delete;
+	OrderIndependentTransparency& operator=(const OrderIndependentTransparency&) = delete;
+	OrderIndependentTransparency& operator=(OrderIndependentTransparency&&) = delete;
+	~OrderIndependentTransparency() = default;
+
+	// Both targets again at InWidth by InHeight, with the sample count they were created with.
+	void Resize(ID3D11Device* InDevice, UINT InWidth, UINT InHeight);
+
+	// Accumulation then revealage, in MaterialPS.hlsl's target order.
+	[[nodiscard]] std::span<ID3D11RenderTargetView* const> GetTargets() const noexcept
+	{
+		return TargetViews;
+	}
+
+	// Nothing accumulated and everything revealed, on the immediate context before the frame's blended draws.
+	void Clear(const Graphics& InGraphics) const noexcept;
+	// Blends what was accumulated over the scene on the immediate context, then binds the frame state again.
+	void Composite(const Graphics& InGraphics);
+
+private:
+	// Registers in TransparencyCompositePS.hlsl.
+	static constexpr UINT AccumulationSlot {0u};
+	static constexpr UINT RevealageSlot {1u};
+
+	void CreateTargets(ID3D11Device* InDevice, UINT InWidth, UINT InHeight);
+
+	std::array<ID3D11RenderTargetView*, 2u> TargetViews {};
+	std::array<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>, 2u> OwnedTargetViews;
+	std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, 2u> TextureViews;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> CompositeShader;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> CompositeBlendState;
+	// The composite covers the screen, it neither tests nor writes depth.
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> CompositeDepthState;
+	UINT SampleNum;
+};
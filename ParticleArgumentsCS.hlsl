@@ -0,0 +1,11 @@
+#include "ParticleCompute.hlsli"
+
+// Between emission and simulation, sizes the simulate dispatch to the particles alive and empties the survivors' list.
+[numthreads(1, 1, 1)]
+void main()
+{
+    const uint AliveNum = Counters.Load(GetAliveCountOffset(AliveSide));
+
+    Counters.Store3(DispatchArgumentsOffset, uint3((AliveNum + ParticleGroupSize - 1u) / ParticleGroupSize, 1u, 1u));
+    Counters.Store(GetAliveCountOffset(1u - AliveSide), 0u);
+}
@@ -0,0 +1,87 @@
+// Shared by the particle shaders, laid out like the structs in ParticleSystem.h.
+
+struct Particle
+{
+    float3 Position;
+    float Age;
+    float3 Velocity;
+    float Lifetime;
+    // Eight bits per channel, red lowest.
+    uint StartColor;
+    uint EndColor;
+    float StartSize;
+    float EndSize;
+};
+
+struct EmitterData
+{
+    float3 Position;
+    // Emit threads from here on take their particles from this emitter.
+    uint FirstParticle;
+    float3 Velocity;
+    float Spread;
+    uint StartColor;
+    uint EndColor;
+    float Lifetime;
+    float StartSize;
+    float EndSize;
+    uint ParticleNum;
+    uint2 Padding;
+};
+
+// What the draw instances index, in the order they are drawn. Keys are squared distances to the camera.
+struct ParticleOrder
+{
+    float Key;
+    uint Index;
+};
+
+static const uint ParticleGroupSize = 256u;
+static const uint LocalSortSize = 1024u;
+
+static const uint DeadCountOffset = 0u;
+// D3D11 dispatch arguments.
+static const uint DispatchArgumentsOffset = 4u;
+// D3D11 draw instanced arguments, one set per alive list.
+static const uint DrawArgumentsOffset = 16u;
+static const uint DrawArgumentsStride = 16u;
+
+uint GetAliveCountOffset(const uint InSide)
+{
+    // The instance count is the second of the draw arguments.
+    return DrawArgumentsOffset + InSide * DrawArgumentsStride + 4u;
+}
+
+float4 UnpackColor(const uint InColor)
+{
+    return float4(InColor & 0xffu, (InColor >> 8u) & 0xffu, (InColor >> 16u) & 0xffu, InColor >> 24u) / 255.0f;
+}
+
+// PCG, advances the state and returns 32 random bits.
+uint NextRandom(inout uint InOutState)
+{
+    InOutState = InOutState * 747796405u + 2891336453u;
+    const uint Word = ((InOutState >> ((InOutState >> 28u) + 4u)) ^ InOutState) * 277803737u;
+    return (Word >> 22u) ^ Word;
+}
+
+// In [0, 1).
+float NextRandomFloat(inout uint InOutState)
+{
+    return float(NextRandom(InOutState) >> 8u) / 16777216.0f;
+}
+
+// Of the bitonic sort, what the padding past the alive particles is keyed, below any distance so it sorts to the end.
+static const float PaddingKey = -1.0f;
+
+// Back to front overall, each sequence of the current block size alternates direction until the last is the whole buffer.
+bool IsSortedDescending(const uint InIndex, const uint InBlockSize)
+{
+    return (InIndex & InBlockSize) == 0u;
+}
+
+// First of the pair the step compares for every thread, the second is CompareDistance further.
+uint GetPairFirst(const uint InThreadIndex, const uint InCompareDistance)
+{
+    return 2u * InThreadIndex - (InThreadIndex & (InCompareDistance - 1u));
+}
@@ -0,0 +1,35 @@
+// The bindings of the particle compute shaders. Every one declares the whole set, the compiler keeps only the registers each reads.
+#include "ParticleCommon.hlsli"
+
+cbuffer ParticleFrame : register(b0)
+{
+    float3 Gravity;
+    float DeltaTime;
+    // The camera's, what the sort keys measure from.
+    float3 ViewerPosition;
+    float Drag;
+    uint EmitNum;
+    uint EmitterNum;
+    uint RandomSeed;
+    // Which alive list holds the particles before simulation, the survivors go to the other one.
+    uint AliveSide;
+}
+
+cbuffer ParticleSort : register(b1)
+{
+    // Elements of each bitonic sequence being merged, and how far apart the pairs of this step are.
+    uint BlockSize;
+    uint CompareDistance;
+    // The side the survivors were counted on.
+    uint SortedSide;
+    uint SortPadding;
+}
+
+StructuredBuffer<EmitterData> Emitters : register(t0);
+RWStructuredBuffer<Particle> Particles : register(u0);
+RWStructuredBuffer<uint> DeadList : register(u1);
+RWStructuredBuffer<uint> AliveList : register(u2);
+// Dead count, the simulate dispatch's group counts and two sets of draw arguments whose instance counts are the alive counts.
+RWByteAddressBuffer Counters : register(u3);
+RWStructuredBuffer<uint> SurvivorList : register(u4);
+RWStructuredBuffer<ParticleOrder> DrawOrder : register(u5);
@@ -0,0 +1,54 @@
+#include "ParticleCompute.hlsli"
+
+[numthreads(ParticleGroupSize, 1, 1)]
+void main(const uint3 InDispatchThreadID : SV_DispatchThreadID)
+{
+    const uint ThreadIndex = InDispatchThreadID.x;
+
+    if (ThreadIndex >= EmitNum)
+    {
+        return;
+    }
+
+    // Few enough emitters that a scan beats anything cleverer.
+    uint EmitterIndex = 0u;
+
+    while (EmitterIndex + 1u < EmitterNum && ThreadIndex >= Emitters[EmitterIndex + 1u].FirstParticle)
+    {
+        ++EmitterIndex;
+    }
+
+    // Taking from an empty dead list gives the slot back, threads that fail only ever undo their own decrement.
+    uint DeadNum;
+    Counters.InterlockedAdd(DeadCountOffset, 0xffffffffu, DeadNum);
+
+    if (asint(DeadNum) <= 0)
+    {
+        Counters.InterlockedAdd(DeadCountOffset, 1u);
+        return;
+    }
+
+    const uint ParticleIndex = DeadList[DeadNum - 1u];
+    const EmitterData Emitter = Emitters[EmitterIndex];
+
+    uint RandomState = ThreadIndex ^ (RandomSeed * 2654435769u);
+    NextRandom(RandomState);
+
+    // Rejection free, uniform in the cube rather than the sphere, which nobody can tell apart in a plume.
+    const float3 Jitter = float3(NextRandomFloat(RandomState), NextRandomFloat(RandomState), NextRandomFloat(RandomState)) * 2.0f - 1.0f;
+
+    Particle Spawned;
+    Spawned.Position = Emitter.Position;
+    Spawned.Age = 0.0f;
+    Spawned.Velocity = Emitter.Velocity + Jitter * Emitter.Spread;
+    Spawned.Lifetime = Emitter.Lifetime * (0.75f + 0.5f * NextRandomFloat(RandomState));
+    Spawned.StartColor = Emitter.StartColor;
+    Spawned.EndColor = Emitter.EndColor;
+    Spawned.StartSize = Emitter.StartSize;
+    Spawned.EndSize = Emitter.EndSize;
+    Particles[ParticleIndex] = Spawned;
+
+    uint AliveSlot;
+    Counters.InterlockedAdd(GetAliveCountOffset(AliveSide), 1u, AliveSlot);
+    AliveList[AliveSlot] = ParticleIndex;
+}
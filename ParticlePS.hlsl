@@ -0,0 +1,9 @@
+// Premultiplied, the same output blends over the scene or adds to it depending on the blend state.
+float4 main(const float4 InColor : Color, const float2 InCorner : TexCoord) : SV_Target
+{
+    // A soft disc rather than a texture, falling off to nothing at the quad's inscribed circle.
+    const float Coverage = saturate(1.0f - dot(InCorner, InCorner));
+    const float Alpha = InColor.a * Coverage * Coverage;
+
+    return float4(InColor.rgb * Alpha, Alpha);
+}
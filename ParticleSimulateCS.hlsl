@@ -0,0 +1,41 @@
+#include "ParticleCompute.hlsli"
+
+[numthreads(ParticleGroupSize, 1, 1)]
+void main(const uint3 InDispatchThreadID : SV_DispatchThreadID)
+{
+    const uint ThreadIndex = InDispatchThreadID.x;
+
+    if (ThreadIndex >= Counters.Load(GetAliveCountOffset(AliveSide)))
+    {
+        return;
+    }
+
+    const uint ParticleIndex = AliveList[ThreadIndex];
+    Particle Simulated = Particles[ParticleIndex];
+    Simulated.Age += DeltaTime;
+
+    if (Simulated.Age >= Simulated.Lifetime)
+    {
+        uint DeadSlot;
+        Counters.InterlockedAdd(DeadCountOffset, 1u, DeadSlot);
+        DeadList[DeadSlot] = ParticleIndex;
+        return;
+    }
+
+    // Semi-implicit Euler, steady enough at frame sized steps for particles that only fall and slow down.
+    Simulated.Velocity += Gravity * DeltaTime;
+    Simulated.Velocity *= saturate(1.0f - Drag * DeltaTime);
+    Simulated.Position += Simulated.Velocity * DeltaTime;
+    Particles[ParticleIndex] = Simulated;
+
+    uint SurvivorSlot;
+    Counters.InterlockedAdd(GetAliveCountOffset(1u - AliveSide), 1u, SurvivorSlot);
+    SurvivorList[SurvivorSlot] = ParticleIndex;
+
+    const float3 FromCamera = Simulated.Position - ViewerPosition;
+
+    ParticleOrder Order;
+    Order.Key = dot(FromCamera, FromCamera);
+    Order.Index = ParticleIndex;
+    DrawOrder[SurvivorSlot] = Order;
+}
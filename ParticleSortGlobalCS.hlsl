@@ -0,0 +1,19 @@
+#include "ParticleCompute.hlsli"
+
+// One step of the sort for pairs too far apart to share a group, one thread per pair. The capacity is a multiple of the group
+// size, so every thread has its pair.
+[numthreads(ParticleGroupSize, 1, 1)]
+void main(const uint3 InDispatchThreadID : SV_DispatchThreadID)
+{
+    const uint Lower = GetPairFirst(InDispatchThreadID.x, CompareDistance);
+    const uint Upper = Lower + CompareDistance;
+
+    const ParticleOrder LowerOrder = DrawOrder[Lower];
+    const ParticleOrder UpperOrder = DrawOrder[Upper];
+
+    if ((LowerOrder.Key < UpperOrder.Key) == IsSortedDescending(Lower, BlockSize))
+    {
+        DrawOrder[Lower] = UpperOrder;
+        DrawOrder[Upper] = LowerOrder;
+    }
+}
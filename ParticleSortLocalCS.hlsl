@@ -0,0 +1,73 @@
+#include "ParticleCompute.hlsli"
+
+// Runs every step of the sort whose pairs lie within LocalSortSize elements in group shared memory. With BlockSize at
+// LocalSortSize it sorts each block from the simulation's order, padding what is past the survivors, otherwise it finishes
+// merging blocks of BlockSize after the global steps brought the pairs that far apart together.
+groupshared ParticleOrder SharedOrder[LocalSortSize];
+
+void CompareExchange(const uint InThreadIndex, const uint InFirst, const uint InBlockSize, const uint InCompareDistance)
+{
+    const uint Lower = GetPairFirst(InThreadIndex, InCompareDistance);
+    const uint Upper = Lower + InCompareDistance;
+
+    const ParticleOrder LowerOrder = SharedOrder[Lower];
+    const ParticleOrder UpperOrder = SharedOrder[Upper];
+
+    if ((LowerOrder.Key < UpperOrder.Key) == IsSortedDescending(InFirst + Lower, InBlockSize))
+    {
+        SharedOrder[Lower] = UpperOrder;
+        SharedOrder[Upper] = LowerOrder;
+    }
+}
+
+[numthreads(LocalSortSize / 2u, 1, 1)]
+void main(const uint3 InGroupID : SV_GroupID, const uint InGroupIndex : SV_GroupIndex)
+{
+    const uint First = InGroupID.x * LocalSortSize;
+    const bool bIsPresort = BlockSize <= LocalSortSize;
+    const uint AliveNum = Counters.Load(GetAliveCountOffset(SortedSide));
+
+    [unroll]
+    for (uint Half = 0u; Half < 2u; ++Half)
+    {
+        const uint Element = InGroupIndex + Half * (LocalSortSize / 2u);
+        ParticleOrder Loaded = DrawOrder[First + Element];
+
+        // Only the presort reads the simulation's order, whatever comes after already moved the padding.
+        if (bIsPresort && First + Element >= AliveNum)
+        {
+            Loaded.Key = PaddingKey;
+        }
+
+        SharedOrder[Element] = Loaded;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (bIsPresort)
+    {
+        for (uint Size = 2u; Size <= LocalSortSize; Size <<= 1u)
+        {
+            for (uint Distance = Size >> 1u; Distance > 0u; Distance >>= 1u)
+            {
+                CompareExchange(InGroupIndex, First, Size, Distance);
+                GroupMemoryBarrierWithGroupSync();
+            }
+        }
+    }
+    else
+    {
+        for (uint Distance = LocalSortSize >> 1u; Distance > 0u; Distance >>= 1u)
+        {
+            CompareExchange(InGroupIndex, First, BlockSize, Distance);
+            GroupMemoryBarrierWithGroupSync();
+        }
+    }
+
+    [unroll]
+    for (uint Half = 0u; Half < 2u; ++Half)
+    {
+        const uint Element = InGroupIndex + Half * (LocalSortSize / 2u);
+        DrawOrder[First + Element] = SharedOrder[Element];
+    }
+}
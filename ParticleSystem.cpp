@@ -0,0 +1,412 @@
+﻿#include "ParticleSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	// Registers in ParticleCompute.hlsli and ParticleVS.hlsl.
+	constexpr UINT EmitterSlot {0u};
+	constexpr UINT ParticlesSlot {0u};
+	constexpr UINT DeadListSlot {1u};
+	constexpr UINT AliveListSlot {2u};
+	constexpr UINT CountersSlot {3u};
+	constexpr UINT SurvivorListSlot {4u};
+	constexpr UINT DrawOrderSlot {5u};
+	constexpr UINT FrameConstantSlot {0u};
+	constexpr UINT SortConstantSlot {1u};
+	constexpr UINT DrawnParticlesSlot {0u};
+	constexpr UINT DrawnOrderSlot {1u};
+
+	void CreateStructuredBuffer(ID3D11Device* InDevice, const UINT InStride, const UINT InNum, const void* InInitialData,
+	                            Microsoft::WRL::ComPtr<ID3D11Buffer>& OutBuffer, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>& OutUav,
+	                            Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>* OutView = nullptr)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC Desc {};
+		Desc.ByteWidth = InStride * InNum;
+		Desc.Usage = D3D11_USAGE_DEFAULT;
+		Desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | (OutView ? D3D11_BIND_SHADER_RESOURCE : 0u);
+		Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		Desc.StructureByteStride = InStride;
+
+		D3D11_SUBRESOURCE_DATA InitialData {};
+		InitialData.pSysMem = InInitialData;
+
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&Desc, InInitialData ? &InitialData : nullptr, &OutBuffer))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(OutBuffer.Get(), nullptr, &OutUav))
+
+		if (OutView)
+		{
+			CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(OutBuffer.Get(), nullptr, OutView->GetAddressOf()))
+		}
+	}
+
+	void CreateDynamicConstantBuffer(ID3D11Device* InDevice, const UINT InByteWidth, Microsoft::WRL::ComPtr<ID3D11Buffer>& OutBuffer)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC Desc {};
+		Desc.ByteWidth = InByteWidth;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&Desc, nullptr, &OutBuffer))
+	}
+
+	void Upload(ID3D11DeviceContext* InContext, ID3D11Buffer* InBuffer, const void* InData, const size_t InByteSize)
+	{
+		HRESULT ResultHandle;
+		D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+		CHECK_HRESULT_EXCEPTION(InContext->Map(InBuffer, 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+		std::memcpy(MappedResource.pData, InData, InByteSize);
+		InContext->Unmap(InBuffer, 0u);
+	}
+
+	UINT PackColor(const DirectX::XMFLOAT4& InColor) noexcept
+	{
+		const auto Channel = [](const float InValue, const unsigned int InShift)
+		{
+			return static_cast<UINT>(std::lround(std::clamp(InValue, 0.0f, 1.0f) * 255.0f)) << InShift;
+		};
+
+		return Channel(InColor.x, 0u) | Channel(InColor.y, 8u) | Channel(InColor.z, 16u) | Channel(InColor.w, 24u);
+	}
+}
+
+ParticleSystem::ParticleSystem(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+{
+	static_assert((MaxParticleNum & (MaxParticleNum - 1u)) == 0u && MaxParticleNum >= 2u * LocalSortSize, "The bitonic sort runs over a power of two");
+	static_assert(MaxParticleNum / 2u % GroupSize == 0u, "Every global sort thread has a pair");
+
+	HRESULT ResultHandle;
+
+	const auto CreateComputeShader = [&](const char* InFileName, Microsoft::WRL::ComPtr<ID3D11ComputeShader>& OutShader)
+	{
+		const auto Blob = InShaderBundle.Load(InFileName);
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(Blob->GetBufferPointer(), Blob->GetBufferSize(), nullptr, &OutShader))
+	};
+
+	CreateComputeShader("ParticleEmitCS.cso", EmitShader);
+	CreateComputeShader("ParticleArgumentsCS.cso", ArgumentsShader);
+	CreateComputeShader("ParticleSimulateCS.cso", SimulateShader);
+	CreateComputeShader("ParticleSortLocalCS.cso", LocalSortShader);
+	CreateComputeShader("ParticleSortGlobalCS.cso", GlobalSortShader);
+
+	const auto VertexBlob = InShaderBundle.Load("ParticleVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &VertexShader))
+
+	const auto PixelBlob = InShaderBundle.Load("ParticlePS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(PixelBlob->GetBufferPointer(), PixelBlob->GetBufferSize(), nullptr, &PixelShader))
+
+	CreateDynamicConstantBuffer(InDevice, sizeof(FrameConstants), FrameConstantBuffer);
+	CreateDynamicConstantBuffer(InDevice, sizeof(SortConstants), SortConstantBuffer);
+
+	// Laid out like Particle in ParticleCommon.hlsli, the colors packed to eight bits a channel.
+	constexpr UINT ParticleStride {12u * sizeof(UINT)};
+	CreateStructuredBuffer(InDevice, ParticleStride, MaxParticleNum, nullptr, Particles, ParticlesUav, &ParticlesView);
+
+	// Every slot starts out free.
+	std::vector<UINT> AllFree(MaxParticleNum);
+	std::iota(AllFree.begin(), AllFree.end(), 0u);
+	CreateStructuredBuffer(InDevice, sizeof(UINT), MaxParticleNum, AllFree.data(), DeadList, DeadListUav);
+
+	for (size_t Side = 0u; Side < AliveLists.size(); ++Side)
+	{
+		CreateStructuredBuffer(InDevice, sizeof(UINT), MaxParticleNum, nullptr, AliveLists[Side], AliveListUavs[Side]);
+	}
+
+	CreateStructuredBuffer(InDevice, 2u * sizeof(UINT), MaxParticleNum, nullptr, DrawOrder, DrawOrderUav, &DrawOrderView);
+
+	// A full dead list, no particles alive on either side, and four vertices per instance for the quads.
+	const UINT InitialCounters[CountersByteSize / sizeof(UINT)] {MaxParticleNum, 0u, 0u, 0u, 4u, 0u, 0u, 0u, 4u, 0u, 0u, 0u};
+
+	D3D11_BUFFER_DESC CountersDesc {};
+	CountersDesc.ByteWidth = CountersByteSize;
+	CountersDesc.Usage = D3D11_USAGE_DEFAULT;
+	CountersDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	CountersDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+
+	D3D11_SUBRESOURCE_DATA CountersData {};
+	CountersData.pSysMem = InitialCounters;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&CountersDesc, &CountersData, &Counters))
+
+	CountersDesc.BindFlags = 0u;
+	CountersDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&CountersDesc, &CountersData, &Arguments))
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC CountersUavDesc {};
+	CountersUavDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	CountersUavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	CountersUavDesc.Buffer.NumElements = CountersByteSize / sizeof(UINT);
+	CountersUavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(Counters.Get(), &CountersUavDesc, &CountersUav))
+
+	D3D11_BUFFER_DESC EmitterDesc {};
+	EmitterDesc.ByteWidth = MaxEmitterNum * sizeof(EmitterData);
+	EmitterDesc.Usage = D3D11_USAGE_DYNAMIC;
+	EmitterDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	EmitterDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	EmitterDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	EmitterDesc.StructureByteStride = sizeof(EmitterData);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&EmitterDesc, nullptr, &EmitterBuffer))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(EmitterBuffer.Get(), nullptr, &EmitterBufferView))
+
+	D3D11_BUFFER_DESC ReadbackDesc {};
+	ReadbackDesc.ByteWidth = CountersByteSize;
+	ReadbackDesc.Usage = D3D11_USAGE_STAGING;
+	ReadbackDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	for (auto& Readback : ReadbackBuffers)
+	{
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ReadbackDesc, nullptr, &Readback))
+	}
+
+	// Premultiplied by the pixel shader, so one output suits both.
+	D3D11_BLEND_DESC BlendDesc {};
+	auto& Target = BlendDesc.RenderTarget[0];
+	Target.BlendEnable = TRUE;
+	Target.SrcBlend = D3D11_BLEND_ONE;
+	Target.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	Target.BlendOp = D3D11_BLEND_OP_ADD;
+	Target.SrcBlendAlpha = D3D11_BLEND_ONE;
+	Target.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	Target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	Target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBlendState(&BlendDesc, &AlphaBlendState))
+
+	Target.DestBlend = D3D11_BLEND_ONE;
+	Target.DestBlendAlpha = D3D11_BLEND_ONE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBlendState(&BlendDesc, &AdditiveBlendState))
+
+	// Hidden behind the scene, but never hiding each other.
+	D3D11_DEPTH_STENCIL_DESC DepthDesc {};
+	DepthDesc.DepthEnable = TRUE;
+	DepthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DepthDesc.DepthFunc = D3D11_COMPARISON_LESS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&DepthDesc, &DepthStencilState))
+
+	Emitters.reserve(MaxEmitterNum);
+	PendingParticles.reserve(MaxEmitterNum);
+	FrameEmitters.reserve(MaxEmitterNum);
+}
+
+unsigned int ParticleSystem::AddEmitter(const Emitter& InEmitter)
+{
+	if (Emitters.size() == MaxEmitterNum)
+	{
+		return NoEmitter;
+	}
+
+	Emitters.push_back(InEmitter);
+	PendingParticles.push_back(0.0f);
+	return static_cast<unsigned int>(Emitters.size() - 1u);
+}
+
+ParticleSystem::Emitter& ParticleSystem::GetEmitter(const unsigned int InIndex) noexcept
+{
+	assert(InIndex < Emitters.size() && "No such emitter");
+	return Emitters[InIndex];
+}
+
+void ParticleSystem::ClearEmitters() noexcept
+{
+	Emitters.clear();
+	PendingParticles.clear();
+}
+
+bool ParticleSystem::HasWork() const noexcept
+{
+	return !Emitters.empty() || LastStatistics.AliveNum > 0u || IdleFrameNum < ReadbackLatency;
+}
+
+void ParticleSystem::Simulate(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Particle simulation");
+
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	auto* const Context = ImmediateContext.GetDeviceContext();
+	const auto DeltaTime = std::min(FrameTimer.Mark(), MaxDeltaTime);
+
+	// Whole particles only, each emitter keeps its fraction for the next frame.
+	FrameEmitters.clear();
+	UINT EmitNum = 0u;
+
+	for (size_t Index = 0u; Index < Emitters.size(); ++Index)
+	{
+		const auto& Source = Emitters[Index];
+		PendingParticles[Index] += std::max(Source.Rate, 0.0f) * DeltaTime;
+
+		const auto ParticleNum = std::min(static_cast<UINT>(PendingParticles[Index]), MaxParticleNum - EmitNum);
+		PendingParticles[Index] -= static_cast<float>(ParticleNum);
+
+		if (ParticleNum == 0u)
+		{
+			continue;
+		}
+
+		FrameEmitters.push_back({Source.Position, EmitNum, Source.Velocity, Source.Spread, PackColor(Source.StartColor), PackColor(Source.EndColor),
+		                         Source.Lifetime, Source.StartSize, Source.EndSize, ParticleNum, {}});
+		EmitNum += ParticleNum;
+	}
+
+	IdleFrameNum = EmitNum > 0u ? 0u : std::min(IdleFrameNum + 1u, ReadbackLatency);
+
+	FrameConstants Constants {};
+	Constants.Gravity = Gravity;
+	Constants.DeltaTime = DeltaTime;
+	Constants.ViewerPosition = InGraphics.GetCamera().GetPosition();
+	Constants.Drag = Drag;
+	Constants.EmitNum = EmitNum;
+	Constants.EmitterNum = static_cast<UINT>(FrameEmitters.size());
+	Constants.RandomSeed = static_cast<UINT>(FrameIndex);
+	Constants.AliveSide = AliveSide;
+	Upload(Context, FrameConstantBuffer.Get(), &Constants, sizeof(Constants));
+
+	// Last frame's draw still has the particles and their order bound to the vertex shader, they cannot be written meanwhile.
+	auto& Cache = ImmediateContext.GetStateCache();
+	Cache.SetVertexShaderResource(DrawnParticlesSlot, nullptr);
+	Cache.SetVertexShaderResource(DrawnOrderSlot, nullptr);
+
+	ID3D11UnorderedAccessView* const Uavs[] =
+	{
+		ParticlesUav.Get(), DeadListUav.Get(), AliveListUavs[AliveSide].Get(), CountersUav.Get(), AliveListUavs[1u - AliveSide].Get(), DrawOrderUav.Get()
+	};
+
+	const auto BindSimulation = [&](ID3D11ComputeShader* InShader)
+	{
+		Context->CSSetShader(InShader, nullptr, 0u);
+		Context->CSSetConstantBuffers(FrameConstantSlot, 1u, FrameConstantBuffer.GetAddressOf());
+		Context->CSSetUnorderedAccessViews(0u, static_cast<UINT>(std::size(Uavs)), Uavs, nullptr);
+	};
+
+	if (EmitNum > 0u)
+	{
+		Upload(Context, EmitterBuffer.Get(), FrameEmitters.data(), FrameEmitters.size() * sizeof(EmitterData));
+
+		BindSimulation(EmitShader.Get());
+		Context->CSSetShaderResources(EmitterSlot, 1u, EmitterBufferView.GetAddressOf());
+		InGraphics.Dispatch((EmitNum + GroupSize - 1u) / GroupSize);
+	}
+
+	BindSimulation(ArgumentsShader.Get());
+	InGraphics.Dispatch(1u);
+	Context->CopyResource(Arguments.Get(), Counters.Get());
+
+	BindSimulation(SimulateShader.Get());
+	InGraphics.DispatchIndirect(Arguments.Get(), DispatchArgumentsOffset);
+	Context->CopyResource(Arguments.Get(), Counters.Get());
+
+	// The survivors are where the next frame emits into and simulates from.
+	AliveSide = 1u - AliveSide;
+
+	if (MyBlendMode == BlendMode::AlphaBlend)
+	{
+		Sort(InGraphics);
+	}
+
+	ReadStatistics(Context);
+
+	LastStatistics.EmittedNum = EmitNum;
+	LastStatistics.EmitterNum = static_cast<unsigned int>(Emitters.size());
+	LastStatistics.bIsSorted = MyBlendMode == BlendMode::AlphaBlend;
+	++FrameIndex;
+}
+
+void ParticleSystem::Sort(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Particle sort");
+
+	/**
+	 * Sorted over the whole capacity, the survivor count is only known on the GPU. Every block of LocalSortSize is sorted in
+	 * group shared memory first, then each merge runs its steps with pairs further apart than a block as global dispatches
+	 * and finishes the rest in shared memory again, so a merge takes one dispatch per doubling beyond a block plus one.
+	 */
+	constexpr UINT LocalGroupNum {MaxParticleNum / LocalSortSize};
+	constexpr UINT GlobalGroupNum {MaxParticleNum / 2u / GroupSize};
+
+	DispatchSortStep(InGraphics, LocalSortShader.Get(), LocalSortSize, 0u, LocalGroupNum);
+
+	for (UINT BlockSize = 2u * LocalSortSize; BlockSize <= MaxParticleNum; BlockSize *= 2u)
+	{
+		for (UINT CompareDistance = BlockSize / 2u; CompareDistance >= LocalSortSize; CompareDistance /= 2u)
+		{
+			DispatchSortStep(InGraphics, GlobalSortShader.Get(), BlockSize, CompareDistance, GlobalGroupNum);
+		}
+
+		DispatchSortStep(InGraphics, LocalSortShader.Get(), BlockSize, 0u, LocalGroupNum);
+	}
+}
+
+void ParticleSystem::DispatchSortStep(const Graphics& InGraphics, ID3D11ComputeShader* InShader, const UINT InBlockSize, const UINT InCompareDistance,
+                                      const UINT InGroupNum)
+{
+	auto* const Context = InGraphics.GetImmediateContext().GetDeviceContext();
+
+	// The survivors were counted on what is now the current side.
+	const SortConstants Constants {InBlockSize, InCompareDistance, AliveSide, 0u};
+	Upload(Context, SortConstantBuffer.Get(), &Constants, sizeof(Constants));
+
+	ID3D11UnorderedAccessView* const Uavs[] = {CountersUav.Get(), DrawOrderUav.Get()};
+
+	Context->CSSetShader(InShader, nullptr, 0u);
+	Context->CSSetConstantBuffers(SortConstantSlot, 1u, SortConstantBuffer.GetAddressOf());
+	Context->CSSetUnorderedAccessViews(CountersSlot, 1u, &Uavs[0], nullptr);
+	Context->CSSetUnorderedAccessViews(DrawOrderSlot, 1u, &Uavs[1], nullptr);
+	InGraphics.Dispatch(InGroupNum);
+}
+
+void ParticleSystem::ReadStatistics(ID3D11DeviceContext* InContext)
+{
+	// Copied now, read once the GPU is sure to be done with the oldest copy, which the map then never waits on.
+	InContext->CopyResource(ReadbackBuffers[FrameIndex % ReadbackLatency].Get(), Counters.Get());
+
+	if (FrameIndex + 1u < ReadbackLatency)
+	{
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE Mapped;
+
+	if (SUCCEEDED(InContext->Map(ReadbackBuffers[(FrameIndex + 1u) % ReadbackLatency].Get(), 0u, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &Mapped)))
+	{
+		// Whatever is not on the dead list survived that frame's simulation.
+		const auto DeadNum = *static_cast<const UINT*>(Mapped.pData);
+		LastStatistics.AliveNum = MaxParticleNum - std::min(DeadNum, MaxParticleNum);
+		InContext->Unmap(ReadbackBuffers[(FrameIndex + 1u) % ReadbackLatency].Get(), 0u);
+	}
+}
+
+void ParticleSystem::Draw(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Particles");
+
+	auto& ImmediateContext = InGraphics.GetImmediateContext();
+	auto& Cache = ImmediateContext.GetStateCache();
+
+	// Onto the scene with its depth, bound again since passes before may have left other targets.
+	InGraphics.BindFrameState(ImmediateContext);
+	Cache.SetBlendState(MyBlendMode == BlendMode::AlphaBlend ? AlphaBlendState.Get() : AdditiveBlendState.Get());
+	Cache.SetDepthStencilState(DepthStencilState.Get());
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	Cache.SetInputLayout(nullptr);
+	Cache.SetVertexShader(VertexShader.Get());
+	Cache.SetHullShader(nullptr);
+	Cache.SetDomainShader(nullptr);
+	Cache.SetPixelShader(PixelShader.Get());
+	Cache.SetVertexShaderResource(DrawnParticlesSlot, ParticlesView.Get());
+	Cache.SetVertexShaderResource(DrawnOrderSlot, DrawOrderView.Get());
+
+	ImmediateContext.DrawInstancedIndirect(Arguments.Get(), DrawArgumentsOffset + AliveSide * DrawArgumentsStride);
+
+	// Everything after draws opaque again, its own packets set the rest.
+	Cache.SetBlendState(nullptr);
+}
@@ -0,0 +1,228 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <vector>
+#include "wrl/client.h"
+#include "EngineTimer.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Particles that live on the GPU from emission to death, the CPU only uploads how many each emitter spawns this frame.
+ * Their state sits in one structured buffer, with the free slots on a dead list and the living ones on one of two alive
+ * lists that swap every frame. Emission pops the dead list and appends to the current alive list, simulation moves the
+ * survivors to the other alive list and pushes the rest back on the dead list, and the survivor count is counted straight
+ * into the indirect arguments of the draw, so nothing about the particles is read back to decide what to do.
+ * Alpha blended particles are sorted back to front by a bitonic sort over the draw order before they are drawn,
+ * additive ones are order independent and skip it. Every particle is one instance of a camera facing quad its vertex
+ * shader expands from the particle, there is no vertex or index buffer.
+ * See ParticleCommon.hlsli for the buffers' layout.
+ */
+class ParticleSystem
+{
+public:
+	static constexpr UINT MaxParticleNum {262144u};
+	static constexpr unsigned int MaxEmitterNum {64u};
+	static constexpr unsigned int NoEmitter {~0u};
+
+	enum class BlendMode : unsigned char
+	{
+		// Premultiplied and sorted.
+		AlphaBlend,
+		// Unsorted, for sparks and fire.
+		Additive
+	};
+
+	struct Emitter
+	{
+		DirectX::XMFLOAT3 Position {0.0f, 0.0f, 0.0f};
+		// Particles per second, the fractions carry over to the next frame.
+		float Rate {4000.0f};
+		DirectX::XMFLOAT3 Velocity {0.0f, 6.0f, 0.0f};
+		// Random velocity of up to this many units per second added in every direction.
+		float Spread {1.5f};
+		// Linear, faded over each particle's life.
+		DirectX::XMFLOAT4 StartColor {1.0f, 0.6f, 0.2f, 1.0f};
+		DirectX::XMFLOAT4 EndColor {0.2f, 0.2f, 0.2f, 0.0f};
+		// Seconds, each particle lives within a quarter of this either way.
+		float Lifetime {2.5f};
+		// World units across.
+		float StartSize {0.08f};
+		float EndSize {0.3f};
+	};
+
+	struct Statistics
+	{
+		// Of a frame a few frames back, counted on the GPU.
+		unsigned int AliveNum {0u};
+		unsigned int EmittedNum {0u};
+		unsigned int EmitterNum {0u};
+		bool bIsSorted {false};
+	};
+
+	ParticleSystem(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem(ParticleSystem&&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(ParticleSystem&&) = delete;
+	~ParticleSystem() = default;
+
+	// Returns where to find it with GetEmitter, NoEmitter when all MaxEmitterNum are taken.
+	[[nodiscard]] unsigned int AddEmitter(const Emitter& InEmitter);
+	[[nodiscard]] Emitter& GetEmitter(unsigned int InIndex) noexcept;
+	// Particles already emitted live on.
+	void ClearEmitters() noexcept;
+
+	// Emits this frame's particles and simulates every living one, before Draw.
+	void Simulate(const Graphics& InGraphics);
+	// Into the scene target with the frame's depth tested but not written, after everything opaque and transparent.
+	void Draw(const Graphics& InGraphics);
+
+	// False when nothing is emitting and the last particle is known to have died, the passes are then left out.
+	[[nodiscard]] bool HasWork() const noexcept;
+
+	void SetBlendMode(const BlendMode InMode) noexcept
+	{
+		MyBlendMode = InMode;
+	}
+
+	[[nodiscard]] BlendMode GetBlendMode() const noexcept
+	{
+		return MyBlendMode;
+	}
+
+	void SetGravity(const DirectX::XMFLOAT3& InGravity) noexcept
+	{
+		Gravity = InGravity;
+	}
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+private:
+	// Laid out like the structs in ParticleCommon.hlsli.
+	struct EmitterData
+	{
+		DirectX::XMFLOAT3 Position;
+		UINT FirstParticle;
+		DirectX::XMFLOAT3 Velocity;
+		float Spread;
+		UINT StartColor;
+		UINT EndColor;
+		float Lifetime;
+		float StartSize;
+		float EndSize;
+		UINT ParticleNum;
+		UINT Padding[2];
+	};
+
+	struct FrameConstants
+	{
+		DirectX::XMFLOAT3 Gravity;
+		float DeltaTime;
+		DirectX::XMFLOAT3 ViewerPosition;
+		float Drag;
+		UINT EmitNum;
+		UINT EmitterNum;
+		UINT RandomSeed;
+		UINT AliveSide;
+	};
+
+	struct SortConstants
+	{
+		UINT BlockSize;
+		UINT CompareDistance;
+		UINT SortedSide;
+		UINT Padding;
+	};
+
+	// Threads per group of the emit, simulate and global sort steps, and elements the local sort holds in group shared memory.
+	static constexpr UINT GroupSize {256u};
+	static constexpr UINT LocalSortSize {1024u};
+	// Frames between copying the counters out and reading the copy, so the map never waits on the GPU.
+	static constexpr unsigned int ReadbackLatency {3u};
+	// Longer frames, such as the first after the window was hidden, simulate as if this many seconds had passed.
+	static constexpr float MaxDeltaTime {0.1f};
+	// Offsets in ParticleCommon.hlsli, the dead count, the simulate dispatch's arguments and a set of draw arguments per alive list.
+	static constexpr UINT DispatchArgumentsOffset {4u};
+	static constexpr UINT DrawArgumentsOffset {16u};
+	static constexpr UINT DrawArgumentsStride {16u};
+	static constexpr UINT CountersByteSize {DrawArgumentsOffset + 2u * DrawArgumentsStride};
+
+	void Sort(const Graphics& InGraphics);
+	void ReadStatistics(ID3D11DeviceContext* InContext);
+	void DispatchSortStep(const Graphics& InGraphics, ID3D11ComputeShader* InShader, UINT InBlockSize, UINT InCompareDistance, UINT InGroupNum);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> EmitShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> ArgumentsShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> SimulateShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> LocalSortShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> GlobalSortShader;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> PixelShader;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> FrameConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> SortConstantBuffer;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Particles;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ParticlesView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ParticlesUav;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> DeadList;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> DeadListUav;
+	std::array<Microsoft::WRL::ComPtr<ID3D11Buffer>, 2> AliveLists;
+	std::array<Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>, 2> AliveListUavs;
+	// What the draw reads the particles through, the survivors in alive order or sorted back to front.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> DrawOrder;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> DrawOrderView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> DrawOrderUav;
+	// The counters and the indirect arguments read from them, a raw buffer the shaders count into.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Counters;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> CountersUav;
+	// A copy of the counters the indirect dispatch and draw read, the simulation counts into Counters while its dispatch reads.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Arguments;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> EmitterBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> EmitterBufferView;
+	std::array<Microsoft::WRL::ComPtr<ID3D11Buffer>, ReadbackLatency> ReadbackBuffers;
+
+	Microsoft::WRL::ComPtr<ID3D11BlendState> AlphaBlendState;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> AdditiveBlendState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> DepthStencilState;
+
+	std::vector<Emitter> Emitters;
+	// Fractions of a particle each emitter owes from earlier frames.
+	std::vector<float> PendingParticles;
+	std::vector<EmitterData> FrameEmitters;
+	EngineTimer FrameTimer;
+	DirectX::XMFLOAT3 Gravity {0.0f, -4.0f, 0.0f};
+	// Fraction of the velocity lost per second.
+	float Drag {0.3f};
+	BlendMode MyBlendMode {BlendMode::AlphaBlend};
+	// Which alive list holds this frame's particles before simulation, the other one gets the survivors.
+	UINT AliveSide {0u};
+	unsigned long long FrameIndex {0u};
+	// Frames since anything was emitted, simulation continues until the readback can tell every particle has died.
+	unsigned int IdleFrameNum {ReadbackLatency};
+	Statistics LastStatistics {};
+	bool bIsEnabled {true};
+};
@@ -0,0 +1,34 @@
+#include "FrameConstants.hlsli"
+#include "ParticleCommon.hlsli"
+
+// The simulation's UAVs read back as shader resources.
+StructuredBuffer<Particle> DrawnParticles : register(t0);
+StructuredBuffer<ParticleOrder> DrawnOrder : register(t1);
+
+struct VSOut
+{
+    float4 Color : Color;
+    // From -1 to 1 across the quad, what the pixel shader rounds it off by.
+    float2 Corner : TexCoord;
+    float4 Position : SV_Position;
+};
+
+// Four vertices drawn as a strip per instance, each instance one particle in draw order.
+VSOut main(const uint InVertexID : SV_VertexID, const uint InInstanceID : SV_InstanceID)
+{
+    const Particle Drawn = DrawnParticles[DrawnOrder[InInstanceID].Index];
+    const float Life = saturate(Drawn.Age / Drawn.Lifetime);
+
+    // Clockwise in view space, so the quad faces the camera with back faces culled.
+    const float2 Corner = float2(InVertexID & 1u ? 1.0f : -1.0f, InVertexID & 2u ? -1.0f : 1.0f);
+    const float HalfSize = 0.5f * lerp(Drawn.StartSize, Drawn.EndSize, Life);
+
+    float4 ViewPosition = mul(float4(Drawn.Position, 1.0f), View);
+    ViewPosition.xy += Corner * HalfSize;
+
+    VSOut Out;
+    Out.Color = lerp(UnpackColor(Drawn.StartColor), UnpackColor(Drawn.EndColor), Life);
+    Out.Corner = Corner;
+    Out.Position = mul(ViewPosition, Projection);
+    return Out;
+}
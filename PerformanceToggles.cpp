@@ -0,0 +1,397 @@
+﻿#include "PerformanceToggles.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+#include "Graphics.h"
+#include "imgui/imgui.h"
+
+namespace
+{
+	// Two-sided 95% of Student's t for 1 to 30 degrees of freedom.
+	constexpr double CriticalValues[] =
+	{
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+		2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+	};
+
+	// Past the table the first term of the expansion around the normal's 1.96 is close enough.
+	double GetCriticalValue(const double InDegreeNum) noexcept
+	{
+		if (InDegreeNum < static_cast<double>(std::size(CriticalValues)))
+		{
+			return CriticalValues[static_cast<size_t>(std::max(InDegreeNum, 1.0)) - 1u];
+		}
+
+		return 1.96 + 2.37 / InDegreeNum;
+	}
+
+	// The naming every switchable subsystem follows, Enable, Disable and IsEnabled or the same with the feature's name.
+	template<typename Object>
+	void RegisterSwitch(PerformanceToggles& InOutToggles, const char* InName, Object& InObject, bool (Object::*InIsEnabled)() const,
+	                    void (Object::*InEnable)(), void (Object::*InDisable)())
+	{
+		InOutToggles.Register(InName, [&InObject, InIsEnabled] { return (InObject.*InIsEnabled)(); }, [&InObject, InEnable, InDisable](const bool bInIsEnabled)
+		{
+			(InObject.*(bInIsEnabled ? InEnable : InDisable))();
+		});
+	}
+
+	template<typename Object>
+	void RegisterSwitch(PerformanceToggles& InOutToggles, const char* InName, Object& InObject)
+	{
+		RegisterSwitch(InOutToggles, InName, InObject, &Object::IsEnabled, &Object::Enable, &Object::Disable);
+	}
+}
+
+PerformanceToggles::PerformanceToggles(Graphics& InGraphics)
+{
+	RegisterSwitch(*this, "State cache filtering", InGraphics, &Graphics::IsStateFilteringEnabled, &Graphics::EnableStateFiltering, &Graphics::DisableStateFiltering);
+
+	// Devices without constant offsetting never had the ring.
+	if (InGraphics.IsConstantBufferRingEnabled())
+	{
+		RegisterSwitch(*this, "Constant buffer ring", InGraphics, &Graphics::IsConstantBufferRingEnabled, &Graphics::EnableConstantBufferRing,
+		               &Graphics::DisableConstantBufferRing);
+	}
+
+	auto& Queue = InGraphics.GetRenderQueue();
+	RegisterSwitch(*this, "Instancing", Queue, &RenderQueue::IsInstancingEnabled, &RenderQueue::EnableInstancing, &RenderQueue::DisableInstancing);
+	RegisterSwitch(*this, "Multithreaded recording", Queue, &RenderQueue::IsMultithreadedRecordingEnabled, &RenderQueue::EnableMultithreadedRecording,
+	               &RenderQueue::DisableMultithreadedRecording);
+	RegisterSwitch(*this, "Depth pre-pass", Queue, &RenderQueue::IsDepthPrepassEnabled, &RenderQueue::EnableDepthPrepass, &RenderQueue::DisableDepthPrepass);
+	RegisterSwitch(*this, "LOD selection", InGraphics, &Graphics::IsLodSelectionEnabled, &Graphics::EnableLodSelection, &Graphics::DisableLodSelection);
+	RegisterSwitch(*this, "Occlusion culling", InGraphics.GetOcclusionCuller());
+	RegisterSwitch(*this, "Instance culling", InGraphics.GetInstanceCuller());
+	RegisterSwitch(*this, "Meshlet culling", InGraphics.GetMeshletCuller());
+	RegisterSwitch(*this, "Occlusion predication", InGraphics.GetOcclusionPredication());
+	RegisterSwitch(*this, "Impostors", InGraphics.GetImpostorBaker());
+	RegisterSwitch(*this, "Deferred shading", InGraphics.GetDeferredShading());
+}
+
+void PerformanceToggles::Register(const char* InName, std::function<bool()> InIsEnabled, std::function<void(bool)> InSetEnabled)
+{
+	const bool bIsEnabled = InIsEnabled();
+	Toggles.push_back({InName, std::move(InIsEnabled), std::move(InSetEnabled), bIsEnabled, bIsEnabled});
+}
+
+void PerformanceToggles::RunningStatistics::Add(const double InValue) noexcept
+{
+	++Num;
+	const auto Deviation = InValue - Mean;
+	Mean += Deviation / static_cast<double>(Num);
+	SquaredDeviationSum += Deviation * (InValue - Mean);
+}
+
+double PerformanceToggles::RunningStatistics::GetVariance() const noexcept
+{
+	return Num > 1u ? SquaredDeviationSum / static_cast<double>(Num - 1u) : 0.0;
+}
+
+void PerformanceToggles::Record(const Graphics& InGraphics)
+{
+	const auto& Gpu = InGraphics.GetGpuProfiler();
+	const auto ResolvedFrameNum = Gpu.GetTotalResolvedFrameNum();
+	const bool bHasNewGpuTimings = ResolvedFrameNum != LastResolvedFrameNum;
+	LastResolvedFrameNum = ResolvedFrameNum;
+
+	if (!bIsComparing)
+	{
+		return;
+	}
+
+	// The frame just closed was drawn with the current configuration.
+	++RecordedPhaseFrameNum;
+
+	if (RecordedPhaseFrameNum > SettleFrameNum)
+	{
+		auto& Live = Configurations[Current];
+		const auto FrameTime = static_cast<double>(FrameProfiler::GetLastFrameTime());
+		Live.Frames.Add(FrameTime);
+		PhaseMilliseconds += FrameTime;
+
+		FrameProfiler::GetLastTimings(CpuTimings);
+
+		for (const auto& [Name, Depth, Milliseconds, CallNum] : CpuTimings)
+		{
+			Accumulate(Live.CpuZones, Name, Depth, Milliseconds);
+		}
+
+		if (bHasNewGpuTimings)
+		{
+			++Live.GpuFrameNum;
+
+			for (const auto& [Name, Depth, Milliseconds] : Gpu.GetLastTimings())
+			{
+				Accumulate(Live.GpuZones, Name, Depth, Milliseconds);
+			}
+		}
+	}
+
+	if (RecordedPhaseFrameNum < PhaseFrameNum)
+	{
+		return;
+	}
+
+	Configurations[Current].Phases.Add(PhaseMilliseconds / static_cast<double>(RecordedPhaseFrameNum - SettleFrameNum));
+	PhaseMilliseconds = 0.0;
+	RecordedPhaseFrameNum = 0u;
+	Current = 1u - Current;
+	Apply(Current);
+}
+
+void PerformanceToggles::StartComparison()
+{
+	for (auto& Switch : Toggles)
+	{
+		Switch.bWasEnabled = Switch.IsEnabled();
+	}
+
+	Configurations = {};
+	Current = 0u;
+	RecordedPhaseFrameNum = 0u;
+	PhaseMilliseconds = 0.0;
+	bIsComparing = true;
+	Apply(Current);
+}
+
+void PerformanceToggles::StopComparison()
+{
+	bIsComparing = false;
+
+	for (const auto& Switch : Toggles)
+	{
+		if (Switch.IsEnabled() != Switch.bWasEnabled)
+		{
+			Switch.SetEnabled(Switch.bWasEnabled);
+		}
+	}
+}
+
+void PerformanceToggles::Apply(const size_t InIndex) const
+{
+	for (const auto& Switch : Toggles)
+	{
+		// Only what differs, some switches cost a rebuild even when set to what they are.
+		if (const bool bIsEnabled = InIndex == 0u ? Switch.bIsEnabledInA : Switch.bIsEnabledInB; Switch.IsEnabled() != bIsEnabled)
+		{
+			Switch.SetEnabled(bIsEnabled);
+		}
+	}
+}
+
+void PerformanceToggles::Accumulate(std::vector<ZoneTotal>& InOutTotals, const char* InName, const unsigned int InDepth, const double InMilliseconds)
+{
+	// Zone names are string literals, so the pointer identifies the zone.
+	auto Total = std::find_if(InOutTotals.begin(), InOutTotals.end(), [InName](const ZoneTotal& InTotal)
+	{
+		return InTotal.Name == InName;
+	});
+
+	if (Total == InOutTotals.end())
+	{
+		Total = InOutTotals.insert(InOutTotals.end(), ZoneTotal {InName, InDepth});
+	}
+
+	Total->Milliseconds += InMilliseconds;
+}
+
+void PerformanceToggles::ShowWindow()
+{
+	if (ImGui::Begin("Performance toggles"))
+	{
+		if (ImGui::BeginTable("Toggles", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Toggle");
+			ImGui::TableSetupColumn("Live");
+			ImGui::TableSetupColumn("A");
+			ImGui::TableSetupColumn("B");
+			ImGui::TableHeadersRow();
+
+			for (auto& Switch : Toggles)
+			{
+				ImGui::PushID(Switch.Name);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+
+				// What the configurations differ in stands out.
+				if (Switch.bIsEnabledInA != Switch.bIsEnabledInB)
+				{
+					ImGui::TextColored({1.0f, 0.8f, 0.2f, 1.0f}, "%s", Switch.Name);
+				}
+				else
+				{
+					ImGui::TextUnformatted(Switch.Name);
+				}
+
+				// The comparison owns the live state while it runs, and a configuration changed halfway would count under both.
+				ImGui::BeginDisabled(bIsComparing);
+				ImGui::TableNextColumn();
+
+				if (bool bIsEnabled = Switch.IsEnabled(); ImGui::Checkbox("##Live", &bIsEnabled))
+				{
+					Switch.SetEnabled(bIsEnabled);
+				}
+
+				ImGui::TableNextColumn();
+				ImGui::Checkbox("##A", &Switch.bIsEnabledInA);
+				ImGui::TableNextColumn();
+				ImGui::Checkbox("##B", &Switch.bIsEnabledInB);
+				ImGui::EndDisabled();
+				ImGui::PopID();
+			}
+
+			ImGui::EndTable();
+		}
+
+		auto Frames = static_cast<int>(PhaseFrameNum);
+
+		if (ImGui::SliderInt("Frames per phase", &Frames, static_cast<int>(MinPhaseFrameNum), static_cast<int>(MaxPhaseFrameNum)))
+		{
+			PhaseFrameNum = static_cast<unsigned int>(Frames);
+		}
+
+		if (bIsComparing)
+		{
+			if (ImGui::Button("Stop A/B"))
+			{
+				StopComparison();
+			}
+
+			ImGui::SameLine();
+			ImGui::Text("Drawing %s, frame %u of %u", Current == 0u ? "A" : "B", RecordedPhaseFrameNum, PhaseFrameNum);
+		}
+		else
+		{
+			if (ImGui::Button("Start A/B"))
+			{
+				StartComparison();
+			}
+
+			ImGui::SameLine();
+
+			if (ImGui::Button("A from live"))
+			{
+				for (auto& Switch : Toggles)
+				{
+					Switch.bIsEnabledInA = Switch.IsEnabled();
+				}
+			}
+
+			ImGui::SameLine();
+
+			if (ImGui::Button("B from live"))
+			{
+				for (auto& Switch : Toggles)
+				{
+					Switch.bIsEnabledInB = Switch.IsEnabled();
+				}
+			}
+		}
+
+		ShowResults();
+	}
+
+	ImGui::End();
+}
+
+void PerformanceToggles::ShowResults() const
+{
+	const auto& [A, B] = Configurations;
+
+	if (A.Frames.Num == 0u && B.Frames.Num == 0u)
+	{
+		return;
+	}
+
+	for (size_t Index = 0u; Index < Configurations.size(); ++Index)
+	{
+		const auto& Frames = Configurations[Index].Frames;
+		ImGui::Text("%s: %.3f ms, deviation %.3f ms, %llu frames in %llu phases", Index == 0u ? "A" : "B", Frames.Mean, std::sqrt(Frames.GetVariance()),
+		            Frames.Num, Configurations[Index].Phases.Num);
+	}
+
+	// Welch's interval of the difference of the phase means, with the Welch-Satterthwaite degrees of freedom.
+	if (A.Phases.Num >= MinPhaseNum && B.Phases.Num >= MinPhaseNum)
+	{
+		const auto ShareA = A.Phases.GetVariance() / static_cast<double>(A.Phases.Num);
+		const auto ShareB = B.Phases.GetVariance() / static_cast<double>(B.Phases.Num);
+		const auto Difference = B.Phases.Mean - A.Phases.Mean;
+		const auto StandardError = std::sqrt(ShareA + ShareB);
+		const auto DegreeNum = StandardError > 0.0 ? (ShareA + ShareB) * (ShareA + ShareB) /
+		                       (ShareA * ShareA / static_cast<double>(A.Phases.Num - 1u) + ShareB * ShareB / static_cast<double>(B.Phases.Num - 1u)) : 1.0;
+		const auto Margin = GetCriticalValue(DegreeNum) * StandardError;
+
+		ImGui::Text("B - A: %+.3f ms (%+.1f%%), +-%.3f ms at 95%%", Difference, A.Phases.Mean > 0.0 ? Difference / A.Phases.Mean * 100.0 : 0.0, Margin);
+		ImGui::TextUnformatted(std::abs(Difference) > Margin ? (Difference < 0.0 ? "B is faster" : "A is faster") : "No difference told apart yet");
+	}
+	else
+	{
+		ImGui::Text("The interval needs %u phases of each", MinPhaseNum);
+	}
+
+	if (ImGui::CollapsingHeader("CPU zones"))
+	{
+		ShowZones("CpuZones", A.CpuZones, A.Frames.Num, B.CpuZones, B.Frames.Num);
+	}
+
+	if (ImGui::CollapsingHeader("GPU scopes"))
+	{
+		ShowZones("GpuZones", A.GpuZones, A.GpuFrameNum, B.GpuZones, B.GpuFrameNum);
+	}
+}
+
+void PerformanceToggles::ShowZones(const char* InId, const std::vector<ZoneTotal>& InA, const unsigned long long InFrameNumA, const std::vector<ZoneTotal>& InB,
+                                   const unsigned long long InFrameNumB)
+{
+	if (!ImGui::BeginTable(InId, 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		return;
+	}
+
+	ImGui::TableSetupColumn("Zone");
+	ImGui::TableSetupColumn("A ms");
+	ImGui::TableSetupColumn("B ms");
+	ImGui::TableSetupColumn("B - A");
+	ImGui::TableHeadersRow();
+
+	const auto Find = [](const std::vector<ZoneTotal>& InTotals, const char* InName)
+	{
+		const auto Found = std::find_if(InTotals.begin(), InTotals.end(), [InName](const ZoneTotal& InTotal) { return InTotal.Name == InName; });
+		return Found == InTotals.end() ? nullptr : &*Found;
+	};
+
+	// Averaged over every counted frame, a zone one configuration never entered is zero in it.
+	const auto ShowRow = [&](const ZoneTotal& InZone)
+	{
+		const auto* const ZoneA = Find(InA, InZone.Name);
+		const auto* const ZoneB = Find(InB, InZone.Name);
+		const auto MillisecondsA = ZoneA && InFrameNumA ? ZoneA->Milliseconds / static_cast<double>(InFrameNumA) : 0.0;
+		const auto MillisecondsB = ZoneB && InFrameNumB ? ZoneB->Milliseconds / static_cast<double>(InFrameNumB) : 0.0;
+
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::Text("%*s%s", static_cast<int>(InZone.Depth * 2u), "", InZone.Name);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", MillisecondsA);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", MillisecondsB);
+		ImGui::TableNextColumn();
+		ImGui::Text("%+.3f", MillisecondsB - MillisecondsA);
+	};
+
+	for (const auto& Zone : InA)
+	{
+		ShowRow(Zone);
+	}
+
+	for (const auto& Zone : InB)
+	{
+		if (!Find(InA, Zone.Name))
+		{
+			ShowRow(Zone);
+		}
+	}
+
+	ImGui::EndTable();
+}
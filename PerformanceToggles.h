@@ -0,0 +1,113 @@
+﻿#pragma once
+#include <array>
+#include <functional>
+#include <vector>
+#include "FrameProfiler.h"
+#include "GpuProfiler.h"
+
+class Graphics;
+
+/**
+ * The engine's optimizations as named switches, flipped live from a window to judge each one on the scene at hand.
+ * An A/B comparison alternates two configurations of them every few frames and keeps the frame times and the CPU and GPU
+ * zones of each apart. The first SettleFrameNum frames of a phase aren't counted, they still pay for the switch and the
+ * GPU timings trail them by the readback latency. Short phases spread slow drift such as clocks, streaming and heat
+ * evenly over both configurations, and the difference is given with a 95% interval from the phase means, which unlike
+ * single frames are close to independent of each other.
+ * Whatever else has a switch worth measuring registers it too, App does for the pipelined simulation.
+ */
+class PerformanceToggles
+{
+public:
+	explicit PerformanceToggles(Graphics& InGraphics);
+	PerformanceToggles(const PerformanceToggles&) = delete;
+	PerformanceToggles(PerformanceToggles&&) = delete;
+	PerformanceToggles& operator=(const PerformanceToggles&) = delete;
+	PerformanceToggles& operator=(PerformanceToggles&&) = delete;
+	~PerformanceToggles() = default;
+
+	// The name must be a string literal. Both configurations start from the toggle's current state.
+	void Register(const char* InName, std::function<bool()> InIsEnabled, std::function<void(bool)> InSetEnabled);
+
+	// Once per frame after FrameProfiler::BeginFrame, for the frame it closed. Switches to the other configuration when
+	// a phase is over.
+	void Record(const Graphics& InGraphics);
+
+	// From configuration A on, with the statistics of any comparison before cleared.
+	void StartComparison();
+	// Puts back what was live before the comparison started, its statistics stay to be read.
+	void StopComparison();
+
+	[[nodiscard]] bool IsComparing() const noexcept
+	{
+		return bIsComparing;
+	}
+
+	void ShowWindow();
+
+	// Past the readback latency, so a counted frame's GPU timings are of its own configuration too.
+	static constexpr unsigned int SettleFrameNum {GpuProfiler::LatencyFrameNum + 2u};
+	static constexpr unsigned int MinPhaseFrameNum {SettleFrameNum * 2u};
+	static constexpr unsigned int MaxPhaseFrameNum {600u};
+	// Below it per configuration the interval isn't worth showing.
+	static constexpr unsigned int MinPhaseNum {3u};
+
+private:
+	struct Toggle
+	{
+		const char* Name;
+		std::function<bool()> IsEnabled;
+		std::function<void(bool)> SetEnabled;
+		bool bIsEnabledInA;
+		bool bIsEnabledInB;
+		// Live when the comparison started.
+		bool bWasEnabled {false};
+	};
+
+	// Welford's running mean and variance, which stays accurate over long runs.
+	struct RunningStatistics
+	{
+		unsigned long long Num {0u};
+		double Mean {0.0};
+		double SquaredDeviationSum {0.0};
+
+		void Add(double InValue) noexcept;
+		[[nodiscard]] double GetVariance() const noexcept;
+	};
+
+	struct ZoneTotal
+	{
+		const char* Name;
+		unsigned int Depth;
+		double Milliseconds {0.0};
+	};
+
+	struct Configuration
+	{
+		RunningStatistics Frames;
+		RunningStatistics Phases;
+		std::vector<ZoneTotal> CpuZones;
+		std::vector<ZoneTotal> GpuZones;
+		// Frames whose GPU timings were new, the readback can skip some.
+		unsigned long long GpuFrameNum {0u};
+	};
+
+	// Puts every toggle in the state configuration InIndex has it in.
+	void Apply(size_t InIndex) const;
+	static void Accumulate(std::vector<ZoneTotal>& InOutTotals, const char* InName, unsigned int InDepth, double InMilliseconds);
+	void ShowResults() const;
+	static void ShowZones(const char* InId, const std::vector<ZoneTotal>& InA, unsigned long long InFrameNumA, const std::vector<ZoneTotal>& InB,
+	                      unsigned long long InFrameNumB);
+
+	std::vector<Toggle> Toggles;
+	std::array<Configuration, 2u> Configurations;
+	std::vector<FrameProfiler::Timing> CpuTimings;
+	unsigned int PhaseFrameNum {60u};
+
+	bool bIsComparing {false};
+	// Which configuration is live, 0 for A.
+	size_t Current {0u};
+	unsigned int RecordedPhaseFrameNum {0u};
+	double PhaseMilliseconds {0.0};
+	unsigned long long LastResolvedFrameNum {0u};
+};
@@ -1,46 +1,52 @@
-cbuffer Light
-{
-    float3 Position;
-    float3 AmbientColor;
-    float3 DiffuseColor;
-    float DiffuseStrength;
-    float QuadraticAttenuation;
-    float LinearAttenuation;
-    float ConstantAttenuation;
-}
-
-cbuffer Material
-{
-    float4 Color;
-    float SpecularIntensity;
-    float SpecularPower;
-}
-
-cbuffer Camera
-{
-    float3 CameraPosition;
-}
+#include "FrameConstants.hlsli"
+#include "MaterialConstants.hlsli"
+#include "PointLight.hlsli"
+#include "ShaderOperations.hlsli"
+#include "Decals.hlsli"
 
 float4 main(const float3 InWorldPosition : Position,
-			float3 InWorldNormal : Normal)
+			float3 InWorldNormal : Normal,
+			const float4 InPixelPosition : SV_Position)
 			: SV_TARGET
 {
     InWorldNormal = normalize(InWorldNormal);
 
-    const float3 VectorToLight = Position - InWorldPosition;
-    const float DistanceToLight = length(VectorToLight);
-    const float3 DirectionToLight = VectorToLight / DistanceToLight;
+    const float3 DirectionToCamera = normalize(CameraPosition - InWorldPosition);
+
+    float3 Diffuse = float3(0.0f, 0.0f, 0.0f);
+    float3 Specular = float3(0.0f, 0.0f, 0.0f);
 
-    const float Attenuation = 1.0f / (QuadraticAttenuation * (DistanceToLight * DistanceToLight) +
-							  LinearAttenuation * DistanceToLight +
-							  ConstantAttenuation);
+    const ClusterLights Cluster = GetClusterLights(InPixelPosition.xy, InWorldPosition);
 
-    const float3 Diffuse = DiffuseColor * DiffuseStrength * Attenuation * max(0.0f, dot(DirectionToLight, InWorldNormal));
+    for (uint Index = 0u; Index < Cluster.Num; ++Index)
+    {
+        const PointLightData Light = GetClusterLight(Cluster, Index);
 
-    const float3 VectorToLightProjectedToNormal = InWorldNormal * dot(VectorToLight, InWorldNormal);
-    // R = 2 * (L  N) - L
-    const float3 VectorToLightReflected = -VectorToLight + 2.0f * VectorToLightProjectedToNormal;
-    const float3 Specular = Attenuation * (DiffuseColor * DiffuseStrength) * SpecularIntensity * pow(max(0.0f, dot(normalize(VectorToLightReflected), normalize(CameraPosition - InWorldPosition))), SpecularPower);
+        const float3 VectorToLight = Light.WorldPosition - InWorldPosition;
+        const float DistanceToLight = length(VectorToLight);
 
-    return float4(saturate((Diffuse + AmbientColor) * Color.rgb + Specular), 1.0f);
-}
\ No newline at end of file
+        if (DistanceToLight >= Light.Range)
+        {
+            continue;
+        }
+
+        const float3 DirectionToLight = VectorToLight / DistanceToLight;
+
+        const float Attenuation = GetShadowFactor(Light, VectorToLight) / (Light.QuadraticAttenuation * (DistanceToLight * DistanceToLight) +
+								  Light.LinearAttenuation * DistanceToLight +
+								  Light.ConstantAttenuation);
+
+        Diffuse += Light.DiffuseColor * Light.DiffuseStrength * Attenuation * max(0.0f, dot(DirectionToLight, InWorldNormal));
+
+        const float3 VectorToLightProjectedToNormal = InWorldNormal * dot(VectorToLight, InWorldNormal);
+        // R = 2 * (L  N) - L
+        const float3 VectorToLightReflected = -VectorToLight + 2.0f * VectorToLightProjectedToNormal;
+        Specular += Attenuation * (Light.DiffuseColor * Light.DiffuseStrength) * SpecularIntensity * pow(max(0.0f, dot(normalize(VectorToLightReflected), DirectionToCamera)), SpecularPower);
+    }
+
+    Specular += SpecularIntensity * CalcReflection(InWorldPosition, InWorldNormal, DirectionToCamera, SpecularPower, InPixelPosition.xy);
+
+    const float3 Albedo = ApplyDecals(MaterialColor.rgb, InPixelPosition.xy, InWorldPosition, InWorldNormal, ddx(InWorldPosition), ddy(InWorldPosition));
+
+    return float4((Diffuse + CalcAmbient(AmbientColor, InWorldPosition, InWorldNormal, InPixelPosition.xy)) * Albedo + Specular, 1.0f);
+}
@@ -1,7 +1,8 @@
+#include "FrameConstants.hlsli"
+
 cbuffer Transform
 {
     matrix Model;
-    matrix ModelViewProjection;
 };
 
 struct VSOutput
@@ -13,10 +14,12 @@ struct VSOutput
 
 VSOutput main(const float3 InModelPosition : Position, const float3 InNormal : Normal)
 {
+    const float4 WorldPosition = mul(float4(InModelPosition, 1.0f), Model);
+
     VSOutput VSOutput;
-    VSOutput.VertexWorldPosition = (float3) mul(float4(InModelPosition, 1.0f), Model);
+    VSOutput.VertexWorldPosition = (float3) WorldPosition;
     VSOutput.NormalWorldPosition = normalize(mul(InNormal, (float3x3) Model));
-    VSOutput.VertexPosition = mul(float4(InModelPosition, 1.0f), ModelViewProjection);
+    VSOutput.VertexPosition = mul(WorldPosition, ViewProjection);
 
     return VSOutput;
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+﻿#include "PipelineState.h"
+#include <cassert>
+#include "BindManager.h"
+#include "DrawPacket.h"
+#include "ExceptionMacros.h"
+#include "InputLayout.h"
+#include "PixelShader.h"
+#include "Topology.h"
+#include "VertexShader.h"
+
+PipelineState::PipelineState(const Graphics& InGraphics, const Description& InDescription)
+	: MyDescription(InDescription), MyTopology(Topology::Resolve(InGraphics, InDescription.TopologyType))
+{
+	assert(InDescription.Vertex && InDescription.Pixel && InDescription.Layout && "Pipelines need both shaders and a layout");
+
+	HRESULT ResultHandle;
+
+	if (InDescription.CullMode != D3D11_CULL_BACK || InDescription.FillMode != D3D11_FILL_SOLID)
+	{
+		D3D11_RASTERIZER_DESC RasterizerDesc {};
+		RasterizerDesc.FillMode = InDescription.FillMode;
+		RasterizerDesc.CullMode = InDescription.CullMode;
+		RasterizerDesc.DepthClipEnable = TRUE;
+
+		CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateRasterizerState(&RasterizerDesc, &RasterizerState))
+	}
+
+	if (IsBlended())
+	{
+		D3D11_BLEND_DESC BlendDesc {};
+		auto& Target = BlendDesc.RenderTarget[0];
+		Target.BlendEnable = TRUE;
+		Target.SrcBlend = InDescription.Blending == BlendMode::AlphaBlend ? D3D11_BLEND_SRC_ALPHA : D3D11_BLEND_ONE;
+		Target.DestBlend = InDescription.Blending == BlendMode::AlphaBlend ? D3D11_BLEND_INV_SRC_ALPHA : D3D11_BLEND_ONE;
+		Target.BlendOp = D3D11_BLEND_OP_ADD;
+		Target.SrcBlendAlpha = D3D11_BLEND_ONE;
+		Target.DestBlendAlpha = InDescription.Blending == BlendMode::WeightedBlended ? D3D11_BLEND_ONE : D3D11_BLEND_INV_SRC_ALPHA;
+		Target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		Target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+		// The accumulation sums like additive blending, the revealage is multiplied by one minus each surface's opacity.
+		if (InDescription.Blending == BlendMode::WeightedBlended)
+		{
+			BlendDesc.IndependentBlendEnable = TRUE;
+
+			auto& Revealage = BlendDesc.RenderTarget[1];
+			Revealage.BlendEnable = TRUE;
+			Revealage.SrcBlend = D3D11_BLEND_ZERO;
+			Revealage.DestBlend = D3D11_BLEND_INV_SRC_COLOR;
+			Revealage.BlendOp = D3D11_BLEND_OP_ADD;
+			Revealage.SrcBlendAlpha = D3D11_BLEND_ZERO;
+			Revealage.DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+			Revealage.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+			Revealage.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_RED;
+		}
+
+		CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBlendState(&BlendDesc, &BlendState))
+
+		// Hidden behind opaque surfaces, but never hiding each other, they are sorted back to front or weighted instead.
+		D3D11_DEPTH_STENCIL_DESC DepthStencilDesc {};
+		DepthStencilDesc.DepthEnable = TRUE;
+		DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+		DepthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+
+		CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateDepthStencilState(&DepthStencilDesc, &DepthStencilState))
+	}
+}
+
+void PipelineState::Bind(RenderContext& InContext) noexcept
+{
+	MyDescription.Vertex->Bind(InContext);
+	MyDescription.Pixel->Bind(InContext);
+	MyDescription.Layout->Bind(InContext);
+	MyTopology->Bind(InContext);
+
+	auto& Cache = GetStateCache(InContext);
+	Cache.SetRasterizerState(RasterizerState.Get());
+	Cache.SetBlendState(BlendState.Get());
+
+	if (DepthStencilState)
+	{
+		Cache.SetDepthStencilState(DepthStencilState.Get(), 1u);
+	}
+}
+
+bool PipelineState::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	MyDescription.Vertex->Bake(InOutPacket);
+	MyDescription.Pixel->Bake(InOutPacket);
+	MyDescription.Layout->Bake(InOutPacket);
+	MyTopology->Bake(InOutPacket);
+
+	InOutPacket.RasterizerState = RasterizerState.Get();
+	InOutPacket.BlendState = BlendState.Get();
+	InOutPacket.DepthStencilState = DepthStencilState.Get();
+
+	return true;
+}
+
+std::shared_ptr<PipelineState> PipelineState::Resolve(const Graphics& InGraphics, const Description& InDescription)
+{
+	return BindManager::Resolve<PipelineState>(InGraphics, InDescription);
+}
+
+std::string PipelineState::GenerateUniqueID(const Description& InDescription)
+{
+	using namespace std::string_literals;
+
+	return typeid(PipelineState).name() + "#"s + InDescription.Vertex->GetUniqueID() + "#"s + InDescription.Pixel->GetUniqueID() +
+		   "#"s + InDescription.Layout->GetUniqueID() + "#"s + std::to_string(InDescription.TopologyType) +
+		   "#"s + std::to_string(InDescription.CullMode) + "#"s + std::to_string(InDescription.FillMode) +
+		   "#"s + std::to_string(static_cast<int>(InDescription.Blending));
+}
+
+BindKey PipelineState::GenerateKey(const Description& InDescription)
+{
+	// Shaders and layouts are BindManager resources too, so the object identifies its contents, and since the pipeline
+	// holds them the address isn't reused while the pipeline is cached.
+	return BindKey::Make<PipelineState>(reinterpret_cast<uintptr_t>(InDescription.Vertex.get()), reinterpret_cast<uintptr_t>(InDescription.Pixel.get()),
+	                                    reinterpret_cast<uintptr_t>(InDescription.Layout.get()), InDescription.TopologyType,
+	                                    InDescription.CullMode, InDescription.FillMode, InDescription.Blending);
+}
+
+std::string PipelineState::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(MyDescription);
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include "BindKey.h"
+#include "Bindable.h"
+
+class InputLayout;
+class PixelShader;
+class Topology;
+class VertexShader;
+
+/**
+ * Everything fixed about how a draw runs: the shaders, input layout, topology and the rasterizer, blend and depth-stencil states.
+ * Created once per distinct combination through the BindManager and applied as one unit, the state cache skips whatever
+ * the previous draw's pipeline already set.
+ */
+class PipelineState : public Bindable
+{
+public:
+	enum class BlendMode : uint8_t
+	{
+		Opaque,
+		// Over what is behind by the pixel shader's alpha.
+		AlphaBlend,
+		// Added onto what is behind, for glows.
+		Additive,
+		// Summed by weight into the order-independent transparency targets, in any order.
+		WeightedBlended
+	};
+
+	struct Description
+	{
+		std::shared_ptr<VertexShader> Vertex;
+		std::shared_ptr<PixelShader> Pixel;
+		std::shared_ptr<InputLayout> Layout;
+		D3D11_PRIMITIVE_TOPOLOGY TopologyType {D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST};
+		// None for surfaces seen from both sides.
+		D3D11_CULL_MODE CullMode {D3D11_CULL_BACK};
+		D3D11_FILL_MODE FillMode {D3D11_FILL_SOLID};
+		// Blended pipelines test depth without writing it and are drawn after the opaque pass, weighted blended ones unsorted.
+		BlendMode Blending {BlendMode::Opaque};
+	};
+
+	PipelineState(const Graphics& InGraphics, const Description& InDescription);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] bool IsBlended() const noexcept
+	{
+		return MyDescription.Blending != BlendMode::Opaque;
+	}
+
+	[[nodiscard]] bool IsOrderIndependent() const noexcept
+	{
+		return MyDescription.Blending == BlendMode::WeightedBlended;
+	}
+
+	[[nodiscard]] bool IsBackFaceCulled() const noexcept
+	{
+		return MyDescription.CullMode == D3D11_CULL_BACK;
+	}
+
+	[[nodiscard]] const Description& GetDescription() const noexcept
+	{
+		return MyDescription;
+	}
+
+	[[nodiscard]] const VertexShader* GetVertexShader() const noexcept
+	{
+		return MyDescription.Vertex.get();
+	}
+
+	[[nodiscard]] const PixelShader* GetPixelShader() const noexcept
+	{
+		return MyDescription.Pixel.get();
+	}
+
+	[[nodiscard]] const InputLayout* GetInputLayout() const noexcept
+	{
+		return MyDescription.Layout.get();
+	}
+
+	[[nodiscard]] const Topology* GetTopology() const noexcept
+	{
+		return MyTopology.get();
+	}
+
+	[[nodiscard]] static std::shared_ptr<PipelineState> Resolve(const Graphics& InGraphics, const Description& InDescription);
+	[[nodiscard]] static std::string GenerateUniqueID(const Description& InDescription);
+	[[nodiscard]] static BindKey GenerateKey(const Description& InDescription);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+
+private:
+	Description MyDescription;
+	std::shared_ptr<Topology> MyTopology;
+	// Null where the description asks for the defaults, so pipelines that only differ elsewhere don't switch them.
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> RasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> BlendState;
+	// Null for opaque pipelines, they keep the depth test of the pass they are drawn in.
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> DepthStencilState;
+};
@@ -0,0 +1,189 @@
+﻿#include "PipelineWarmup.h"
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include "BindManager.h"
+#include "DXGIInfoManager.h"
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "Graphics.h"
+#include "InputLayout.h"
+#include "PipelineState.h"
+#include "PixelShader.h"
+#include "VertexShader.h"
+
+PipelineWarmup::PipelineWarmup(const Graphics& InGraphics, ID3D11Device* InDevice)
+	: MyGraphics(InGraphics)
+{
+	HRESULT ResultHandle;
+
+	const std::vector<std::byte> Zeros(ZeroBufferBytes);
+
+	D3D11_BUFFER_DESC ZeroDesc {};
+	ZeroDesc.ByteWidth = ZeroBufferBytes;
+	ZeroDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ZeroDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_INDEX_BUFFER;
+
+	const D3D11_SUBRESOURCE_DATA ZeroData {Zeros.data(), 0u, 0u};
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ZeroDesc, &ZeroData, &ZeroBuffer))
+}
+
+PipelineWarmup::~PipelineWarmup() = default;
+
+unsigned int PipelineWarmup::WarmManifest(const std::string& InFileName)
+{
+	std::ifstream Stream(InFileName);
+
+	if (!Stream)
+	{
+		return 0u;
+	}
+
+	std::vector<std::shared_ptr<PipelineState>> Pipelines;
+	std::string Line;
+
+	while (std::getline(Stream, Line))
+	{
+		std::istringstream LineStream(Line);
+		std::string Keyword;
+
+		// Blank lines and comments.
+		if (!(LineStream >> Keyword) || Keyword != "pipeline")
+		{
+			continue;
+		}
+
+		std::string VertexShaderName;
+		std::string PixelShaderName;
+		unsigned int VertexFeatures = 0u;
+		unsigned int PixelFeatures = 0u;
+		int TopologyType = 0;
+		int CullMode = 0;
+		int FillMode = 0;
+		int Blending = 0;
+		int Elements = 0;
+		LineStream >> VertexShaderName >> VertexFeatures >> PixelShaderName >> PixelFeatures >> TopologyType >> CullMode >> FillMode >> Blending >> Elements;
+
+		// The rest of the line is the vertex layout, one element type after another.
+		DV::VertexLayout Layout {};
+		bool bIsLayoutValid = !LineStream.fail();
+
+		for (int ElementType; bIsLayoutValid && LineStream >> ElementType;)
+		{
+			bIsLayoutValid = ElementType >= 0 && ElementType <= static_cast<int>(DV::VertexLayout::ElementType::LightmapTexture2D);
+			Layout.Append(static_cast<DV::VertexLayout::ElementType>(ElementType));
+		}
+
+		if (!bIsLayoutValid || !LineStream.eof() || Layout.Num() == 0u || Layout.Size() > ZeroBufferBytes ||
+		    (Elements != static_cast<int>(InputLayout::Elements::All) && Elements != static_cast<int>(InputLayout::Elements::PositionOnly)) ||
+		    Blending < 0 || Blending > static_cast<int>(PipelineState::BlendMode::WeightedBlended))
+		{
+			continue;
+		}
+
+		// Written by an older build, some of what it names may have been renamed or removed since.
+		try
+		{
+			PipelineState::Description Description;
+			Description.Vertex = VertexShader::Resolve(MyGraphics, VertexShaderName, VertexFeatures);
+			Description.Pixel = PixelShader::Resolve(MyGraphics, PixelShaderName, PixelFeatures);
+			Description.Layout = InputLayout::Resolve(MyGraphics, Layout, Description.Vertex->GetByteCode(), static_cast<InputLayout::Elements>(Elements));
+			Description.TopologyType = static_cast<D3D11_PRIMITIVE_TOPOLOGY>(TopologyType);
+			Description.CullMode = static_cast<D3D11_CULL_MODE>(CullMode);
+			Description.FillMode = static_cast<D3D11_FILL_MODE>(FillMode);
+			Description.Blending = static_cast<PipelineState::BlendMode>(Blending);
+			Pipelines.push_back(PipelineState::Resolve(MyGraphics, Description));
+		}
+		catch (const std::exception&)
+		{
+		}
+	}
+
+	return Warm(Pipelines);
+}
+
+unsigned int PipelineWarmup::WarmCached()
+{
+	return Warm(BindManager::GetAll<PipelineState>());
+}
+
+bool PipelineWarmup::WriteManifest(const std::string& InFileName) const
+{
+	std::ofstream Stream(InFileName);
+
+	if (!Stream)
+	{
+		return false;
+	}
+
+	Stream << "# pipeline <vertex shader> <features> <pixel shader> <features> <topology> <cull> <fill> <blend> <elements> <layout element types...>\n";
+
+	for (const auto& Pipeline : Warmed)
+	{
+		const auto* const Vertex = Pipeline->GetVertexShader();
+		const auto* const Pixel = Pipeline->GetPixelShader();
+		const auto* const Layout = Pipeline->GetInputLayout();
+		const auto& Description = Pipeline->GetDescription();
+
+		Stream << "pipeline " << Vertex->GetFileName() << ' ' << Vertex->GetFeatures() << ' ' << Pixel->GetFileName() << ' ' << Pixel->GetFeatures() << ' '
+		       << Description.TopologyType << ' ' << Description.CullMode << ' ' << Description.FillMode << ' ' << static_cast<int>(Description.Blending) << ' '
+		       << static_cast<int>(Layout->GetElements());
+
+		for (size_t Index = 0u; Index < Layout->GetLayout().Num(); ++Index)
+		{
+			Stream << ' ' << static_cast<int>(Layout->GetLayout().ResolveByIndex(Index).GetType());
+		}
+
+		Stream << '\n';
+	}
+
+	return static_cast<bool>(Stream);
+}
+
+unsigned int PipelineWarmup::Warm(const std::vector<std::shared_ptr<PipelineState>>& InPipelines)
+{
+	PROFILE_SCOPE("PipelineWarmup::Warm");
+
+	auto& Context = MyGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+
+#ifndef NDEBUG
+	// What came before still gets reported, only the warm-up's own draws are exempt.
+	DXGIInfoManager::ReportDrawMessages(__FILE__, __LINE__);
+#endif
+
+	MyGraphics.BindFrameState(Context);
+	Cache.SetIndexBuffer(ZeroBuffer.Get(), DXGI_FORMAT_R16_UINT);
+
+	unsigned int WarmedNum = 0u;
+
+	for (const auto& Pipeline : InPipelines)
+	{
+		if (!WarmedSet.insert(Pipeline.get()).second)
+		{
+			continue;
+		}
+
+		const auto& Layout = Pipeline->GetInputLayout()->GetLayout();
+		assert(Layout.Size() <= ZeroBufferBytes && "Vertex too large to read from the zero buffer");
+
+		Pipeline->Bind(Context);
+
+		// Every stream reads the same zeros.
+		for (UINT Stream = 0u; Stream < DV::VertexLayout::StreamNum; ++Stream)
+		{
+			Cache.SetVertexBuffer(Stream, ZeroBuffer.Get(), static_cast<UINT>(Layout.GetStreamStride(Stream)));
+		}
+		// Around the draw validation, what is left unbound here is every shader's own resources.
+		Context.GetDeviceContext()->DrawIndexed(3u, 0u, 0);
+
+		Warmed.push_back(Pipeline);
+		++WarmedNum;
+	}
+
+	// Pipelines leave their rasterizer and blend states behind, draws after this expect the frame's.
+	MyGraphics.BindFrameState(Context);
+	DXGIInfoManager::SkipDrawMessages();
+
+	return WarmedNum;
+}
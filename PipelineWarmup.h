@@ -0,0 +1,58 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "wrl/client.h"
+
+class Graphics;
+class PipelineState;
+
+/**
+ * Draws each pipeline once before it is needed, so the driver builds its shaders for that state while content loads
+ * instead of in the frame a new material first comes into view.
+ * Every draw is a triangle of three copies of one zero vertex. It covers no pixels, but the driver still has to compile
+ * the whole combination against the scene's own targets. Warmed pipelines stay held for the session, since their
+ * compiled code would go with them.
+ * What was warmed is written to a manifest, which the next session warms from before its content has loaded.
+ */
+class PipelineWarmup
+{
+public:
+	static constexpr const char* ManifestFileName = "Pipelines.manifest";
+
+	PipelineWarmup(const Graphics& InGraphics, ID3D11Device* InDevice);
+	PipelineWarmup(const PipelineWarmup&) = delete;
+	PipelineWarmup(PipelineWarmup&&) = delete;
+	PipelineWarmup& operator=(const PipelineWarmup&) = delete;
+	PipelineWarmup& operator=(PipelineWarmup&&) = delete;
+	~PipelineWarmup();
+
+	// Both on the main thread while nothing is recording, they return how many pipelines they drew.
+	// Resolves what each line of the manifest names first, lines that don't parse or whose shaders are gone are skipped.
+	unsigned int WarmManifest(const std::string& InFileName = ManifestFileName);
+	// Every cached pipeline not warmed yet, such as those of a model that just finished loading.
+	unsigned int WarmCached();
+
+	// One line per warmed pipeline, false when the file can't be written.
+	bool WriteManifest(const std::string& InFileName = ManifestFileName) const;
+
+	[[nodiscard]] unsigned int GetWarmedNum() const noexcept
+	{
+		return static_cast<unsigned int>(Warmed.size());
+	}
+
+private:
+	// Vertices up to this size read all zeros from it, as do 16 bit indices.
+	static constexpr UINT ZeroBufferBytes {256u};
+
+	unsigned int Warm(const std::vector<std::shared_ptr<PipelineState>>& InPipelines);
+
+private:
+	const Graphics& MyGraphics;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ZeroBuffer;
+	std::vector<std::shared_ptr<PipelineState>> Warmed;
+	std::unordered_set<const PipelineState*> WarmedSet;
+};
@@ -1,40 +1,68 @@
 ﻿#include "PixelShader.h"
-#include <d3dcompiler.h>
 #include "BindManager.h"
+#include "DrawPacket.h"
 #include "ExceptionMacros.h"
 
-PixelShader::PixelShader(const Graphics& InGraphics, const std::string& InFileName)
+PixelShader::PixelShader(const Graphics& InGraphics, const std::string_view InFileName, const unsigned int InFeatures)
+	: FileName(InFileName), Features(InFeatures)
+	, ByteCodeBlob(InGraphics.GetShaderBundle().Load(InFileName, InFeatures))
+	, Reflection(ByteCodeBlob.Get())
+{
+	MyPixelShader = CreateShader(InGraphics, ByteCodeBlob.Get());
+}
+
+Microsoft::WRL::ComPtr<ID3D11PixelShader> PixelShader::CreateShader(const Graphics& InGraphics, ID3DBlob* InByteCode)
 {
 	HRESULT ResultHandle;
-	Microsoft::WRL::ComPtr<ID3DBlob> Blob;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> Shader;
 
-	CHECK_HRESULT_EXCEPTION(D3DReadFileToBlob(std::wstring{InFileName.begin(), InFileName.end()}.c_str(), &Blob))
 	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreatePixelShader
 	(
-		Blob->GetBufferPointer(),
-		Blob->GetBufferSize(),
+		InByteCode->GetBufferPointer(),
+		InByteCode->GetBufferSize(),
 		nullptr,
-		&MyPixelShader
+		&Shader
 	))
+
+	return Shader;
+}
+
+void PixelShader::Swap(Microsoft::WRL::ComPtr<ID3D11PixelShader> InShader, Microsoft::WRL::ComPtr<ID3DBlob> InByteCode, ShaderReflection InReflection) noexcept
+{
+	MyPixelShader = std::move(InShader);
+	ByteCodeBlob = std::move(InByteCode);
+	Reflection = std::move(InReflection);
+	InvalidateBaked();
 }
 
-void PixelShader::Bind(const Graphics& InGraphics) noexcept
+void PixelShader::Bind(RenderContext& InContext) noexcept
 {
-	GetContext(InGraphics)->PSSetShader(MyPixelShader.Get(), nullptr, 0u);
+	GetStateCache(InContext).SetPixelShader(MyPixelShader.Get());
 }
 
-std::shared_ptr<PixelShader> PixelShader::Resolve(const Graphics& InGraphics, const std::string& InFileName)
+bool PixelShader::Bake(DrawPacket& InOutPacket) const noexcept
 {
-	return BindManager::Resolve<PixelShader>(InGraphics, InFileName);
+	InOutPacket.PixelShader = MyPixelShader.Get();
+	return true;
 }
 
-std::string PixelShader::GenerateUniqueID(const std::string& InFileName)
+std::shared_ptr<PixelShader> PixelShader::Resolve(const Graphics& InGraphics, const std::string_view InFileName, const unsigned int InFeatures)
+{
+	return BindManager::Resolve<PixelShader>(InGraphics, InFileName, InFeatures);
+}
+
+std::string PixelShader::GenerateUniqueID(const std::string_view InFileName, const unsigned int InFeatures)
 {
 	using namespace std::string_literals;
-	return typeid(PixelShader).name() + "#"s + InFileName;
+	return typeid(PixelShader).name() + "#"s + std::string(InFileName) + "#"s + std::to_string(InFeatures);
+}
+
+BindKey PixelShader::GenerateKey(const std::string_view InFileName, const unsigned int InFeatures)
+{
+	return BindKey::Make<PixelShader>(InFileName, InFeatures);
 }
 
 std::string PixelShader::GetUniqueID() const noexcept
 {
-	return GenerateUniqueID(FileName);
+	return GenerateUniqueID(FileName, Features);
 }
@@ -1,48 +1,63 @@
 ﻿#include "Plane.h"
-#include "PlaneGeometry.h"
 #include "Bindables.h"
+#include "GeometryCache.h"
 
-Plane::Plane(const Graphics& InGraphics, const float InSize)
+Plane::Plane(const Graphics& InGraphics, const float InSize, const std::optional<Displacement::Settings>& InDisplacement)
+	: Size(InSize)
 {
-	auto Model = PlaneGeometry::Make();
-	Model.Transform(DirectX::XMMatrixScaling(InSize, InSize, 1.0f));
+	using Element = DV::VertexLayout::ElementType;
 
-	const auto GeometryTag = "$plane." + std::to_string( InSize );
+	// The displacement shaders read the packed normal and tangent frame of VertexPacking.hlsli.
+	const auto bIsDisplaced = InDisplacement.has_value();
+	const auto& Geometry = bIsDisplaced
+		? GeometryCache::Get(GeometryCache::Shape::Plane, {Element::Position3D, Element::OctahedralNormal, Element::TangentFrame, Element::Texture2D},
+		                     PatchDivisions, PatchDivisions)
+		: GeometryCache::Get(GeometryCache::Shape::Plane, {Element::Position3D, Element::Normal, Element::Texture2D});
+	const auto& Model = Geometry.Model;
 
-	Bind(VertexBuffer::Resolve(InGraphics, GeometryTag, Model.Vertices));
+	Bind(VertexBuffer::Resolve(InGraphics, Geometry.Tag, Model.Vertices));
 
-	Bind(IndexBuffer::Resolve(InGraphics, GeometryTag, Model.Indices));
+	Bind(IndexBuffer::Resolve(InGraphics, Geometry.Tag, Model.Indices));
 
-	Bind(Texture::Resolve(InGraphics, "Images\\brickwall.jpg"));
-	Bind(Texture::Resolve(InGraphics, "Images\\brickwall_normal.jpg"));
+	auto BrickTexture = Texture::Resolve(InGraphics, "Images\\brickwall.jpg");
+	Bind(BrickTexture);
+	Bind(std::make_shared<TextureBinding>(Texture::Resolve(InGraphics, "Images\\brickwall_normal.jpg"), 1u));
 
-	Bind(std::make_shared<Sampler>(InGraphics));
+	// Seen at grazing angles most of the time, where trilinear filtering blurs the bricks.
+	Bind(Sampler::Resolve(InGraphics, Sampler::Anisotropic));
 
-	auto ModelVertexShader = VertexShader::Resolve(InGraphics, "DiffuseNormalPhongVS.cso");
+	auto ModelVertexShader = VertexShader::Resolve(InGraphics, bIsDisplaced ? "DisplacementVS.cso" : "DiffuseNormalPhongVS.cso");
 	auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
 	Bind(std::move(ModelVertexShader));
 
-	Bind(PixelShader::Resolve(InGraphics, "DiffuseNormalPhongPS.cso"));
+	auto ModelPixelShader = PixelShader::Resolve(InGraphics, "DiffuseNormalPhongPS.cso");
+	const auto& PixelReflection = ModelPixelShader->GetReflection();
+	Bind(ModelPixelShader);
 
 	struct PSMaterialConstant
 	{
+		DirectX::XMFLOAT4 color {1.0f, 1.0f, 1.0f, 1.0f};
 		float specularIntensity = 0.1f;
 		float specularPower = 20.0f;
-		BOOL normalMappingEnabled = TRUE;
-		float padding[1];
+		float padding[2] {};
 	} ModelMaterialConstants;
 
-	struct PSCameraConstants
-	{
-		alignas(16) DirectX::XMFLOAT3 Position;
-	} ModelCameraConstants;
-
-	Bind(PixelConstantBuffer<PSMaterialConstant>::Resolve(InGraphics, ModelMaterialConstants, 1u));
-	Bind(PixelConstantBuffer<PSCameraConstants>::Resolve(InGraphics, ModelCameraConstants, 2u));
+	Bind(PixelConstantBuffer<PSMaterialConstant>::Resolve(InGraphics, ModelMaterialConstants, PixelReflection, "Material"));
 
 	Bind(InputLayout::Resolve(InGraphics, Model.Vertices.GetLayout(), ModelVertexShaderBlob));
 
-	Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
+	if (bIsDisplaced)
+	{
+		// The mortar is darker than the bricks, so the brick texture stands in for a height map.
+		Bind(HullShader::Resolve(InGraphics, "DisplacementHS.cso"));
+		Bind(DomainShader::Resolve(InGraphics, "DisplacementDS.cso"));
+		Bind(std::make_shared<Displacement>(InGraphics, std::move(BrickTexture), *InDisplacement));
+		Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST));
+	}
+	else
+	{
+		Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
+	}
 
 	Bind(std::make_shared<TransformConstantBuffer>(InGraphics, *this, TransformConstantBuffer::Target::Vertex));
 }
@@ -61,6 +76,7 @@ void Plane::SetRotation(const float InRoll, const float InPitch, const float InY
 
 DirectX::XMMATRIX Plane::GetTransformMatrix() const noexcept
 {
-	return DirectX::XMMatrixRotationRollPitchYaw(Roll, Pitch, Yaw) *
+	return DirectX::XMMatrixScaling(Size, Size, 1.0f) *
+		   DirectX::XMMatrixRotationRollPitchYaw(Roll, Pitch, Yaw) *
 		   DirectX::XMMatrixTranslation(Position.x, Position.y, Position.z);
 }
\ No newline at end of file
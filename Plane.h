@@ -1,15 +1,24 @@
 ﻿#pragma once
+#include <optional>
+#include "Displacement.h"
 #include "Drawable.h"
 
 class Plane : public Drawable
 {
 public:
-	Plane(const Graphics& InGraphics, float InSize);
+	// With InDisplacement the plane is a coarse grid of patches the GPU tessellates by their size on screen and lifts by the
+	// brick texture's brightness, vertex memory stays that of the grid and the detail lands only near the camera.
+	explicit Plane(const Graphics& InGraphics, float InSize, const std::optional<Displacement::Settings>& InDisplacement = std::nullopt);
 	void SetPosition(DirectX::XMFLOAT3 InPosition) noexcept;
 	void SetRotation(float InRoll, float InPitch, float InYaw) noexcept;
 	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept override;
 
 private:
+	// Patches along each side of a displaced plane, enough that the tessellation factors stay well below their limit.
+	static constexpr int PatchDivisions {16};
+
+	// Applied in the world matrix, planes of every size share the cached unit plane.
+	float Size;
 	DirectX::XMFLOAT3 Position {1.0f, 1.0f, 1.0f};
 	float Roll {0.0f};
 	float Pitch {0.0f};
@@ -45,7 +45,7 @@ public:
 		}
 
 		std::vector<unsigned int> PlaneIndices;
-		PlaneIndices.reserve(Math::Square(InXDivisions * InYDivisions) * 6);
+		PlaneIndices.reserve(static_cast<size_t>(InXDivisions) * InYDivisions * 6u);
 
 		const auto VertexToIndex = [XVerticesNum](const size_t InX, const size_t InY)
 		{
@@ -76,6 +76,34 @@ public:
 		return {std::move(PlaneVertexBuffer), std::move(PlaneIndices)};
 	}
 
+	// The compact normal and tangent frame VertexPacking.hlsli decodes, in place of the plain normal.
+	static IndexedTriangleList MakeTesselatedPacked(const int InXDivisions, const int InYDivisions)
+	{
+		using Element = DV::VertexLayout::ElementType;
+
+		auto Unpacked = MakeTesselatedTextured({Element::Position3D, Element::Normal, Element::Texture2D}, InXDivisions, InYDivisions);
+		DV::VertexBuffer Packed {DV::VertexLayout {Element::Position3D, Element::OctahedralNormal, Element::TangentFrame, Element::Texture2D}};
+		// Texture coordinates run along x and against y.
+		constexpr DirectX::XMFLOAT3 Tangent {1.0f, 0.0f, 0.0f};
+		constexpr DirectX::XMFLOAT3 Bitangent {0.0f, -1.0f, 0.0f};
+
+		for (size_t VertexIndex = 0u; VertexIndex < Unpacked.Vertices.Num(); ++VertexIndex)
+		{
+			auto Vertex = Unpacked.Vertices[VertexIndex];
+			const auto& Normal = Vertex.Attribute<Element::Normal>();
+
+			Packed.Emplace
+			(
+				Vertex.Attribute<Element::Position3D>(),
+				DV::EncodeOctahedralNormal(Normal),
+				DV::EncodeTangentFrame(Normal, Tangent, Bitangent),
+				Vertex.Attribute<Element::Texture2D>()
+			);
+		}
+
+		return {std::move(Packed), std::move(Unpacked.Indices)};
+	}
+
 	static IndexedTriangleList Make()
 	{
 		DV::VertexLayout PlaneVertexLayout
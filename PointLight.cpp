@@ -1,8 +1,8 @@
 ﻿#include "PointLight.h"
 #include "imgui/imgui.h"
 
-PointLight::PointLight(Graphics& InGraphics, const float InRadius)
-	: Mesh(InGraphics, InRadius), ConstantBuffer(InGraphics)
+PointLight::PointLight(const Graphics& InGraphics, const float InRadius)
+	: Mesh(InGraphics, InRadius)
 {
 	Reset();
 }
@@ -28,6 +28,8 @@ void PointLight::ShowControlWindow() noexcept
 		ImGui::SliderFloat("Linear", &Constants.LinearAttenuation, 0.0001f, 4.0f, "%.4f");
 		ImGui::SliderFloat("Constant", &Constants.ConstantAttenuation, 0.0000001f, 10.0f, "%.7f");
 
+		ImGui::Checkbox("Cast shadows", &bIsShadowCasting);
+
 		if (ImGui::Button("Reset"))
 		{
 			Reset();
@@ -51,14 +53,54 @@ void PointLight::Reset() noexcept
 	};
 }
 
-void PointLight::Draw(const Graphics& InGraphics) const
+void PointLight::Submit(const Graphics& InGraphics) const
 {
 	Mesh.SetPosition(Constants.Position);
-	Mesh.Draw(InGraphics);
+	Mesh.Submit(InGraphics);
+}
+
+void PointLight::SetPosition(const DirectX::XMFLOAT3& InPosition) noexcept
+{
+	Constants.Position = InPosition;
 }
 
-void PointLight::Bind(const Graphics& InGraphics, const DirectX::FXMMATRIX& InViewMatrix) const noexcept
-{	
-	ConstantBuffer.Update(InGraphics, Constants);
-	ConstantBuffer.Bind(InGraphics);
+void PointLight::SetDiffuseColor(const DirectX::XMFLOAT3& InColor) noexcept
+{
+	Constants.DiffuseColor = InColor;
+}
+
+void PointLight::SetAttenuation(const float InQuadratic, const float InLinear, const float InConstant) noexcept
+{
+	Constants.QuadraticAttenuation = InQuadratic;
+	Constants.LinearAttenuation = InLinear;
+	Constants.ConstantAttenuation = InConstant;
+}
+
+void PointLight::SetShadowCasting(const bool bInIsShadowCasting) noexcept
+{
+	bIsShadowCasting = bInIsShadowCasting;
+}
+
+void PointLight::SetConstants(const PointLightConstants& InConstants) noexcept
+{
+	Constants = InConstants;
+}
+
+void PointLight::Bind(const Graphics& InGraphics) const noexcept
+{
+	ClusteredLighting::PointLightData Light {};
+	Light.WorldPosition = Constants.Position;
+	Light.DiffuseColor = Constants.DiffuseColor;
+	Light.DiffuseStrength = Constants.DiffuseStrength;
+	Light.QuadraticAttenuation = Constants.QuadraticAttenuation;
+	Light.LinearAttenuation = Constants.LinearAttenuation;
+	Light.ConstantAttenuation = Constants.ConstantAttenuation;
+	Light.ShadowIndex = PointLightShadows::NoShadow;
+
+	if (bIsShadowCasting)
+	{
+		InGraphics.GetPointLightShadows().AddLight(InGraphics, Light);
+	}
+
+	InGraphics.GetClusteredLighting().AddLight(Light, Constants.AmbientColor);
 }
\ No newline at end of file
@@ -1,7 +1,6 @@
 ﻿#pragma once
 #include "Graphics.h"
 #include "SolidSphere.h"
-#include "ConstantBuffers.h"
 
 struct PointLightConstants
 {
@@ -17,15 +16,37 @@ struct PointLightConstants
 class PointLight
 {
 public:
-	PointLight(Graphics& InGraphics, float InRadius = 0.5f);
+	PointLight(const Graphics& InGraphics, float InRadius = 0.5f);
 
 	void ShowControlWindow() noexcept;
 	void Reset() noexcept;
-	void Draw(const Graphics& InGraphics) const;
-	void Bind(const Graphics& InGraphics, const DirectX::FXMMATRIX& InViewMatrix) const noexcept;
+	void Submit(const Graphics& InGraphics) const;
+
+	void SetPosition(const DirectX::XMFLOAT3& InPosition) noexcept;
+	void SetDiffuseColor(const DirectX::XMFLOAT3& InColor) noexcept;
+	// The clustered light list sizes each light's range by where this falls below its cutoff.
+	void SetAttenuation(float InQuadratic, float InLinear, float InConstant) noexcept;
+	// Shadowed lights take a tile of the shadow atlas each, scenes with many lights leave most of them unshadowed.
+	void SetShadowCasting(bool bInIsShadowCasting) noexcept;
+	// Everything the control window edits but shadow casting, for scene files to save and restore.
+	void SetConstants(const PointLightConstants& InConstants) noexcept;
+
+	[[nodiscard]] const PointLightConstants& GetConstants() const noexcept
+	{
+		return Constants;
+	}
+
+	[[nodiscard]] bool IsShadowCasting() const noexcept
+	{
+		return bIsShadowCasting;
+	}
+
+	// Adds the light to the frame's clustered light list, call between BeginFrame and executing the render queue.
+	// Shadowed lights have to be added before anything reports moved bounds to the shadow faces.
+	void Bind(const Graphics& InGraphics) const noexcept;
 
 private:
 	PointLightConstants Constants;
 	mutable SolidSphere Mesh;
-	mutable PixelConstantBuffer<PointLightConstants> ConstantBuffer;
+	bool bIsShadowCasting {true};
 };
\ No newline at end of file
@@ -1,10 +1,88 @@
-cbuffer PointLightConstants
-{
-    float3 LightWorldPosition;
-    float3 AmbientColor;
-    float3 DiffuseColor;
-    float DiffuseStrength;
-    float QuadraticAttenuation;
-    float LinearAttenuation;
-    float ConstantAttenuation;
-}
\ No newline at end of file
+#include "ClusteredLighting.hlsli"
+
+StructuredBuffer<PointLightData> Lights : register(t8);
+StructuredBuffer<uint> ClusterLightCounts : register(t9);
+StructuredBuffer<uint> ClusterLightIndices : register(t10);
+Texture2D<float> ShadowAtlas : register(t11);
+SamplerComparisonState ShadowSampler : register(s1);
+
+// Laid out like PointLightShadows::AtlasConstants.
+cbuffer ShadowAtlasTiles : register(b6)
+{
+    // Per shadow index and face the tile's corner and size in atlas coordinates, w the half texel lookups stay inside it by.
+    float4 ShadowTiles[16 * 6];
+}
+
+// Right and up of each face's view, in the order PointLightShadows draws them, +X -X +Y -Y +Z -Z.
+static const float3 ShadowFaceRights[6] =
+{
+    float3(0.0f, 0.0f, -1.0f), float3(0.0f, 0.0f, 1.0f), float3(1.0f, 0.0f, 0.0f),
+    float3(1.0f, 0.0f, 0.0f), float3(1.0f, 0.0f, 0.0f), float3(-1.0f, 0.0f, 0.0f)
+};
+
+static const float3 ShadowFaceUps[6] =
+{
+    float3(0.0f, 1.0f, 0.0f), float3(0.0f, 1.0f, 0.0f), float3(0.0f, 0.0f, -1.0f),
+    float3(0.0f, 0.0f, 1.0f), float3(0.0f, 1.0f, 0.0f), float3(0.0f, 1.0f, 0.0f)
+};
+
+// World units the stored depth is compared closer to the light by, so surfaces do not shadow themselves.
+static const float ShadowBias = 0.05f;
+
+struct ClusterLights
+{
+    uint First;
+    uint Num;
+};
+
+// The lights whose range touches the cluster the pixel falls into.
+ClusterLights GetClusterLights(const float2 InPixelPosition, const float3 InWorldPosition)
+{
+    ClusterLights Cluster;
+
+    if (bIsUnclustered)
+    {
+        Cluster.First = 0u;
+        Cluster.Num = ObjectLightNum;
+        return Cluster;
+    }
+
+    const uint ClusterIndex = FindClusterIndex(InPixelPosition, InWorldPosition);
+
+    Cluster.First = ClusterIndex * MaxLightsPerCluster;
+    Cluster.Num = ClusterLightCounts[ClusterIndex];
+    return Cluster;
+}
+
+PointLightData GetClusterLight(const ClusterLights InCluster, const uint InIndex)
+{
+    return Lights[bIsUnclustered ? ObjectLightIndices[InIndex / 4u][InIndex % 4u] : ClusterLightIndices[InCluster.First + InIndex]];
+}
+
+// Fraction of the light that reaches the pixel, InVectorToLight points from the pixel to the light.
+float GetShadowFactor(const PointLightData InLight, const float3 InVectorToLight)
+{
+    if (InLight.ShadowIndex < 0)
+    {
+        return 1.0f;
+    }
+
+    // The face is picked by the major axis, whose length is the view depth on that face.
+    const float3 Direction = -InVectorToLight;
+    const float3 Distances = abs(Direction);
+    const float MajorDistance = max(max(Distances.x, Distances.y), Distances.z);
+    const uint Face = Distances.x >= Distances.y && Distances.x >= Distances.z ? (Direction.x >= 0.0f ? 0u : 1u)
+                    : Distances.y >= Distances.z ? (Direction.y >= 0.0f ? 2u : 3u)
+                    : (Direction.z >= 0.0f ? 4u : 5u);
+
+    // The face's ninety degree projection, then into its tile, kept off the neighbouring tiles' texels.
+    const float2 FaceCoordinate = float2(dot(Direction, ShadowFaceRights[Face]), -dot(Direction, ShadowFaceUps[Face])) / MajorDistance * 0.5f + 0.5f;
+    const float4 Tile = ShadowTiles[(uint) InLight.ShadowIndex * 6u + Face];
+    const float2 AtlasCoordinate = Tile.xy + clamp(FaceCoordinate * Tile.z, Tile.w, Tile.z - Tile.w);
+
+    // Past the far plane the depth saturates and compares against the cleared far depth, so it stays lit.
+    const float ViewDepth = MajorDistance - ShadowBias;
+    const float Depth = saturate(InLight.ShadowDepthTransform.x + InLight.ShadowDepthTransform.y / max(ViewDepth, 1e-3f));
+
+    return ShadowAtlas.SampleCmpLevelZero(ShadowSampler, AtlasCoordinate, Depth);
+}
@@ -0,0 +1,384 @@
+﻿#include "PointLightShadows.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "Sampler.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	// Left handed cube face order and orientation, +X -X +Y -Y +Z -Z.
+	constexpr DirectX::XMVECTORF32 FaceDirections[] =
+	{
+		{{{1.0f, 0.0f, 0.0f, 0.0f}}},
+		{{{-1.0f, 0.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, -1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 0.0f, 1.0f, 0.0f}}},
+		{{{0.0f, 0.0f, -1.0f, 0.0f}}}
+	};
+
+	constexpr DirectX::XMVECTORF32 FaceUps[] =
+	{
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 0.0f, -1.0f, 0.0f}}},
+		{{{0.0f, 0.0f, 1.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}}
+	};
+}
+
+PointLightShadows::PointLightShadows(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle)
+{
+	static_assert(MaxFaceSize <= AtlasSize && AtlasSize % MaxFaceSize == 0u, "The largest faces tile the atlas");
+
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC AtlasDesc {};
+	AtlasDesc.Width = AtlasSize;
+	AtlasDesc.Height = AtlasSize;
+	AtlasDesc.MipLevels = 1u;
+	AtlasDesc.ArraySize = 1u;
+	// Typeless so the tiles are written as depth and sampled as R32_FLOAT.
+	AtlasDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	AtlasDesc.SampleDesc.Count = 1u;
+	AtlasDesc.Usage = D3D11_USAGE_DEFAULT;
+	AtlasDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> AtlasTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&AtlasDesc, nullptr, &AtlasTexture))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC AtlasViewDesc {};
+	AtlasViewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	AtlasViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	AtlasViewDesc.Texture2D.MipLevels = 1u;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(AtlasTexture.Get(), &AtlasViewDesc, &AtlasView))
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC AtlasDepthViewDesc {};
+	AtlasDepthViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	AtlasDepthViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilView(AtlasTexture.Get(), &AtlasDepthViewDesc, &AtlasDepthView))
+
+	// Filtered comparison gives two by two percentage closer filtering for free.
+	const auto SamplerDesc = Sampler::MakeDesc(Sampler::ShadowComparison);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateSamplerState(&SamplerDesc, &ComparisonSampler))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(AtlasConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	const auto ClearBlob = InShaderBundle.Load("ShadowTileClearVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(ClearBlob->GetBufferPointer(), ClearBlob->GetBufferSize(), nullptr, &ClearShader))
+
+	D3D11_DEPTH_STENCIL_DESC ClearDepthDesc {};
+	ClearDepthDesc.DepthEnable = TRUE;
+	ClearDepthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	ClearDepthDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&ClearDepthDesc, &ClearDepthState))
+}
+
+void PointLightShadows::BeginFrame() noexcept
+{
+	LastLightNum = LightNum;
+	LightNum = 0u;
+}
+
+void PointLightShadows::AddLight(const Graphics& InGraphics, ClusteredLighting::PointLightData& InOutLight) noexcept
+{
+	InOutLight.ShadowIndex = NoShadow;
+
+	if (LightNum == MaxShadowedLightNum)
+	{
+		return;
+	}
+
+	const auto ShadowIndex = LightNum;
+	auto& Light = Lights[ShadowIndex];
+	const auto& Position = InOutLight.WorldPosition;
+	const auto Range = std::clamp(ClusteredLighting::GetRange(InOutLight), 2.0f * NearZ, MaxShadowRange);
+
+	// A slot left unused last frame missed whatever moved meanwhile, a different light invalidates it anyway.
+	if (ShadowIndex >= LastLightNum ||
+		Position.x != Light.Position.x || Position.y != Light.Position.y || Position.z != Light.Position.z || Range != Light.Range)
+	{
+		Light.Position = Position;
+		Light.Range = Range;
+		Light.StaleFaces = AllFaces;
+
+		const auto Projection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 1.0f, NearZ, Range);
+		DirectX::XMStoreFloat4x4(&Light.Projection, Projection);
+		const auto Eye = DirectX::XMLoadFloat3(&Position);
+		const DirectX::BoundingFrustum ViewFrustum(Projection);
+
+		for (UINT Face = 0u; Face < FaceNum; ++Face)
+		{
+			const auto View = DirectX::XMMatrixLookToLH(Eye, FaceDirections[Face], FaceUps[Face]);
+
+			DirectX::XMStoreFloat4x4(&Light.FaceViews[Face], View);
+			ViewFrustum.Transform(Light.FaceFrustums[Face], DirectX::XMMatrixInverse(nullptr, View));
+		}
+	}
+
+	const auto FaceSize = SelectFaceSize(InGraphics, InOutLight, Range, Light.RequestedFaceSize);
+
+	// Tiles squeezed smaller by a full atlas are kept until the light wants another size, rather than retried every frame.
+	if (FaceSize != Light.RequestedFaceSize || Light.FaceSize == 0u)
+	{
+		FreeTiles(Light);
+		Light.RequestedFaceSize = FaceSize;
+
+		if (!AllocateTiles(Light, FaceSize))
+		{
+			// The slot goes to the next light, this one is drawn unshadowed.
+			return;
+		}
+	}
+
+	++LightNum;
+	Light.Casters.clear();
+
+	// Inverts the projection's depth mapping for the distance along a face's view direction.
+	InOutLight.ShadowIndex = static_cast<int>(ShadowIndex);
+	InOutLight.ShadowDepthTransform = {Range / (Range - NearZ), -NearZ * Range / (Range - NearZ)};
+}
+
+void PointLightShadows::AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept
+{
+	for (unsigned int ShadowIndex = 0u; ShadowIndex < LightNum; ++ShadowIndex)
+	{
+		auto& Light = Lights[ShadowIndex];
+
+		for (UINT Face = 0u; Face < FaceNum && Light.StaleFaces != AllFaces; ++Face)
+		{
+			if (Light.FaceFrustums[Face].Intersects(InBounds))
+			{
+				Light.StaleFaces |= 1u << Face;
+			}
+		}
+	}
+}
+
+void PointLightShadows::AddCaster(const unsigned int InShadowIndex, const Drawable& InCaster, const DirectX::BoundingBox& InWorldBounds)
+{
+	assert(InShadowIndex < LightNum && "Caster added for a light that has no tiles this frame");
+	assert(InCaster.IsDepthOnlySupported() && "Shadow casters are drawn depth only");
+
+	// Casters may not be submitted to the queue this frame, culled from the camera but not from the light.
+	InCaster.Prepare();
+
+	Lights[InShadowIndex].Casters.emplace_back(&InCaster, InWorldBounds);
+}
+
+void PointLightShadows::Render(const Graphics& InGraphics)
+{
+	RenderedFaceNum = 0u;
+
+	// Slots no light took this frame give their tiles back to the atlas.
+	for (unsigned int ShadowIndex = LightNum; ShadowIndex < MaxShadowedLightNum; ++ShadowIndex)
+	{
+		FreeTiles(Lights[ShadowIndex]);
+	}
+
+	if (bIsConstantBufferStale)
+	{
+		UploadConstants(InGraphics);
+	}
+
+	const auto bHasStaleFaces = std::any_of(Lights.begin(), Lights.begin() + LightNum, [](const ShadowedLight& InLight)
+	{
+		return InLight.StaleFaces != 0u;
+	});
+
+	if (!bHasStaleFaces)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Shadow faces");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	// The atlas cannot stay bound for reading while its tiles are drawn.
+	Cache.SetPixelShaderResource(ShadowSlot, nullptr);
+	Cache.SetRenderTarget(nullptr, AtlasDepthView.Get());
+
+	for (unsigned int ShadowIndex = 0u; ShadowIndex < LightNum; ++ShadowIndex)
+	{
+		auto& Light = Lights[ShadowIndex];
+
+		for (UINT Face = 0u; Face < FaceNum; ++Face)
+		{
+			if (!(Light.StaleFaces & (1u << Face)))
+			{
+				continue;
+			}
+
+			const auto& Tile = Light.Tiles[Face];
+			const D3D11_VIEWPORT TileViewport {static_cast<float>(Tile.X), static_cast<float>(Tile.Y), static_cast<float>(Tile.Size), static_cast<float>(Tile.Size), 0.0f, 1.0f};
+			DeviceContext->RSSetViewports(1u, &TileViewport);
+
+			// The viewport keeps the reset inside the tile.
+			Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			Cache.SetInputLayout(nullptr);
+			Cache.SetRasterizerState(nullptr);
+			Cache.SetVertexShader(ClearShader.Get());
+			Cache.SetPixelShader(nullptr);
+			Cache.SetDepthStencilState(ClearDepthState.Get());
+			DeviceContext->Draw(3u, 0u);
+			Cache.CountDraw(3u, 1u);
+
+			InGraphics.BindDepthTest(Context, DepthTest::Less);
+			InGraphics.OverrideViewConstants(Context, DirectX::XMLoadFloat4x4(&Light.FaceViews[Face]), DirectX::XMLoadFloat4x4(&Light.Projection));
+
+			for (const auto& [Caster, Bounds] : Light.Casters)
+			{
+				if (Light.FaceFrustums[Face].Intersects(Bounds))
+				{
+					Caster->Draw(Context, DrawStage::DepthOnly);
+				}
+			}
+
+			++RenderedFaceNum;
+		}
+
+		Light.StaleFaces = 0u;
+	}
+
+	InGraphics.RestoreViewConstants(Context);
+	InGraphics.BindFrameState(Context);
+}
+
+void PointLightShadows::Bind(RenderContext& InContext) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelShaderResource(ShadowSlot, AtlasView.Get());
+	Cache.SetPixelSampler(SamplerSlot, ComparisonSampler.Get());
+}
+
+void PointLightShadows::BindCompute(ID3D11DeviceContext* InContext) const noexcept
+{
+	InContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	InContext->CSSetShaderResources(ShadowSlot, 1u, AtlasView.GetAddressOf());
+	InContext->CSSetSamplers(SamplerSlot, 1u, ComparisonSampler.GetAddressOf());
+}
+
+UINT PointLightShadows::SelectFaceSize(const Graphics& InGraphics, const ClusteredLighting::PointLightData& InLight, const float InRange,
+                                       const UINT InRequestedSize)
+{
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMStoreFloat4x4(&Projection, InGraphics.GetProjectionMatrix());
+
+	// Screen height fraction the range's sphere spans, all of it once the camera is inside.
+	const auto ViewPosition = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&InLight.WorldPosition), InGraphics.GetViewMatrix());
+	const auto Distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(ViewPosition));
+	const auto Coverage = Distance <= InRange ? 1.0f : std::min(Projection._22 * InRange / std::sqrt(Distance * Distance - InRange * InRange), 1.0f);
+
+	// Dim lights cast faint shadows, whose edges need fewer texels.
+	const auto Brightness = InLight.DiffuseStrength * std::max({InLight.DiffuseColor.x, InLight.DiffuseColor.y, InLight.DiffuseColor.z});
+	const auto Importance = std::clamp(Brightness, 0.25f, 1.0f);
+
+	// About a texel per pixel the light's reach covers on screen.
+	const auto Texels = static_cast<UINT>(Coverage * Importance * InGraphics.GetViewport().Height);
+	const auto FaceSize = std::clamp(std::bit_ceil(std::max(Texels, 1u)), MinFaceSize, MaxFaceSize);
+
+	// Grows as soon as it is more, only shrinks once it is a quarter, so coverage hovering at a step keeps its tiles.
+	if (InRequestedSize != 0u && FaceSize < InRequestedSize && FaceSize * 4u > InRequestedSize)
+	{
+		return InRequestedSize;
+	}
+
+	return FaceSize;
+}
+
+bool PointLightShadows::AllocateTiles(ShadowedLight& InOutLight, const UINT InFaceSize)
+{
+	for (auto FaceSize = InFaceSize; FaceSize >= MinFaceSize; FaceSize /= 2u)
+	{
+		UINT AllocatedNum = 0u;
+
+		for (; AllocatedNum < FaceNum; ++AllocatedNum)
+		{
+			const auto Tile = Atlas.Allocate(FaceSize);
+
+			if (!Tile)
+			{
+				break;
+			}
+
+			InOutLight.Tiles[AllocatedNum] = *Tile;
+		}
+
+		if (AllocatedNum == FaceNum)
+		{
+			InOutLight.FaceSize = FaceSize;
+			InOutLight.StaleFaces = AllFaces;
+			bIsConstantBufferStale = true;
+			return true;
+		}
+
+		while (AllocatedNum > 0u)
+		{
+			Atlas.Free(InOutLight.Tiles[--AllocatedNum]);
+		}
+	}
+
+	return false;
+}
+
+void PointLightShadows::FreeTiles(ShadowedLight& InOutLight)
+{
+	if (InOutLight.FaceSize == 0u)
+	{
+		return;
+	}
+
+	for (const auto& Tile : InOutLight.Tiles)
+	{
+		Atlas.Free(Tile);
+	}
+
+	InOutLight.FaceSize = 0u;
+	bIsConstantBufferStale = true;
+}
+
+void PointLightShadows::UploadConstants(const Graphics& InGraphics)
+{
+	AtlasConstants Constants {};
+	constexpr auto TexelSize = 1.0f / static_cast<float>(AtlasSize);
+
+	for (unsigned int ShadowIndex = 0u; ShadowIndex < MaxShadowedLightNum; ++ShadowIndex)
+	{
+		for (UINT Face = 0u; Face < FaceNum; ++Face)
+		{
+			const auto& Tile = Lights[ShadowIndex].Tiles[Face];
+			Constants.Tiles[ShadowIndex * FaceNum + Face] = {Tile.X * TexelSize, Tile.Y * TexelSize, Tile.Size * TexelSize, 0.5f * TexelSize};
+		}
+	}
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	bIsConstantBufferStale = false;
+}
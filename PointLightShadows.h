@@ -0,0 +1,146 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <utility>
+#include <vector>
+#include "wrl/client.h"
+#include "AtlasAllocator.h"
+#include "ClusteredLighting.h"
+
+class Drawable;
+class Graphics;
+class RenderContext;
+class ShaderBundle;
+
+/**
+ * Omnidirectional shadows for point lights, six faces per shadowed light drawn through the drawables' depth-only path.
+ * The faces are tiles of one depth atlas, so shadow memory is a fixed budget. Each light's face size follows how much of
+ * the screen its range covers and how bright it is, and when the atlas runs full later lights get smaller tiles or stay unshadowed.
+ * Faces are cached across frames and only drawn again when their light moves, their tiles change or bounds reported as
+ * moved reach into them, so a static scene costs nothing beyond the lookups in the pixel shaders.
+ * Each frame lights are added first, then models report what moved and hand over casters for lights with stale faces.
+ */
+class PointLightShadows
+{
+public:
+	static constexpr int NoShadow {-1};
+	static constexpr UINT MaxShadowedLightNum {16u};
+	static constexpr UINT FaceNum {6u};
+	static constexpr UINT AtlasSize {4096u};
+	static constexpr UINT MaxFaceSize {1024u};
+	static constexpr UINT MinFaceSize {64u};
+	static constexpr float NearZ {0.1f};
+	// Shadows end at the light's range or this distance, whichever is closer.
+	static constexpr float MaxShadowRange {100.0f};
+
+	PointLightShadows(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle);
+	PointLightShadows(const PointLightShadows&) = delete;
+	PointLightShadows(PointLightShadows&&) = delete;
+	PointLightShadows& operator=(const PointLightShadows&) = delete;
+	PointLightShadows& operator=(PointLightShadows&&) = delete;
+	~PointLightShadows() = default;
+
+	void BeginFrame() noexcept;
+	// Gives the light the next slot and its face tiles for the camera as InGraphics has it this frame, and fills in its
+	// shadow fields. Lights past MaxShadowedLightNum, or that find no room in the atlas even at MinFaceSize, stay unshadowed.
+	void AddLight(const Graphics& InGraphics, ClusteredLighting::PointLightData& InOutLight) noexcept;
+	// World space region whose casters changed since last frame, covering both where they were and where they are.
+	void AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept;
+	// The caster is drawn into every stale face of the light its bounds reach.
+	void AddCaster(unsigned int InShadowIndex, const Drawable& InCaster, const DirectX::BoundingBox& InWorldBounds);
+
+	// Draws the stale faces, before anything samples the atlas.
+	void Render(const Graphics& InGraphics);
+	void Bind(RenderContext& InContext) const noexcept;
+	// The same slots for compute shaders that shade, straight to the context like every compute binding.
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+
+	[[nodiscard]] unsigned int GetLightNum() const noexcept
+	{
+		return LightNum;
+	}
+
+	[[nodiscard]] bool IsUpdatePending(const unsigned int InShadowIndex) const noexcept
+	{
+		return Lights[InShadowIndex].StaleFaces != 0u;
+	}
+
+	// Everything that can cast into the light's faces.
+	[[nodiscard]] DirectX::BoundingSphere GetLightBounds(const unsigned int InShadowIndex) const noexcept
+	{
+		return {Lights[InShadowIndex].Position, Lights[InShadowIndex].Range};
+	}
+
+	// Faces drawn by the last Render, zero while nothing moves.
+	[[nodiscard]] unsigned int GetRenderedFaceNum() const noexcept
+	{
+		return RenderedFaceNum;
+	}
+
+	// Fraction of the atlas the shadowed lights' tiles take up.
+	[[nodiscard]] float GetAtlasUsage() const noexcept
+	{
+		return static_cast<float>(Atlas.GetAllocatedArea()) / (static_cast<float>(AtlasSize) * AtlasSize);
+	}
+
+	// Face size of the light in the slot, zero when it has no tiles.
+	[[nodiscard]] UINT GetFaceSize(const unsigned int InShadowIndex) const noexcept
+	{
+		return Lights[InShadowIndex].FaceSize;
+	}
+
+private:
+	static constexpr unsigned int AllFaces {(1u << FaceNum) - 1u};
+	// Pixel shader slots, after the cluster light lists and the reflection probes' constants.
+	static constexpr UINT ConstantSlot {6u};
+	static constexpr UINT ShadowSlot {11u};
+	static constexpr UINT SamplerSlot {1u};
+
+	struct AtlasConstants
+	{
+		// Per light and face the tile's corner and size in atlas coordinates, and the half texel the lookups keep inside it.
+		std::array<DirectX::XMFLOAT4, MaxShadowedLightNum * FaceNum> Tiles;
+	};
+
+	struct ShadowedLight
+	{
+		DirectX::XMFLOAT3 Position {};
+		float Range {0.0f};
+		DirectX::XMFLOAT4X4 Projection {};
+		std::array<DirectX::XMFLOAT4X4, FaceNum> FaceViews {};
+		std::array<DirectX::BoundingFrustum, FaceNum> FaceFrustums;
+		std::array<AtlasAllocator::Tile, FaceNum> Tiles {};
+		// Of every tile, zero while the slot holds none, and what it was chosen for, which is larger when the atlas was full.
+		UINT FaceSize {0u};
+		UINT RequestedFaceSize {0u};
+		// One bit per face that no longer matches the scene.
+		unsigned int StaleFaces {AllFaces};
+		std::vector<std::pair<const Drawable*, DirectX::BoundingBox>> Casters;
+	};
+
+	// The face size for the light's screen coverage and brightness, kept for small changes so tiles aren't traded every frame.
+	[[nodiscard]] static UINT SelectFaceSize(const Graphics& InGraphics, const ClusteredLighting::PointLightData& InLight, float InRange, UINT InRequestedSize);
+	// All six tiles at the size or the largest smaller one that fits, false when not even MinFaceSize does.
+	bool AllocateTiles(ShadowedLight& InOutLight, UINT InFaceSize);
+	void FreeTiles(ShadowedLight& InOutLight);
+	void UploadConstants(const Graphics& InGraphics);
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AtlasView;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> AtlasDepthView;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> ComparisonSampler;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	// Depth cannot be cleared in part, a tile is reset by a triangle at the far plane that always passes.
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> ClearShader;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> ClearDepthState;
+
+	AtlasAllocator Atlas {AtlasSize, MinFaceSize};
+
+	std::array<ShadowedLight, MaxShadowedLightNum> Lights;
+	unsigned int LightNum {0u};
+	// A slot only keeps its faces while it is used every frame.
+	unsigned int LastLightNum {0u};
+	unsigned int RenderedFaceNum {0u};
+	bool bIsConstantBufferStale {true};
+};
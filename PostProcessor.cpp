@@ -0,0 +1,239 @@
+﻿#include "PostProcessor.h"
+#include <cstring>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+PostProcessor::PostProcessor(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, const UINT InWidth, const UINT InHeight)
+{
+	static_assert(BloomGroupSize >> (BloomMipNum - 1u) == 1u, "A bloom group ends in one texel of the last mip");
+
+	HRESULT ResultHandle;
+
+	const auto BloomBlob = InShaderBundle.Load("BloomDownsampleCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(BloomBlob->GetBufferPointer(), BloomBlob->GetBufferSize(), nullptr, &BloomShader))
+
+	const auto ToneMapBlob = InShaderBundle.Load("ToneMapCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(ToneMapBlob->GetBufferPointer(), ToneMapBlob->GetBufferSize(), nullptr, &ToneMapShader))
+
+	const auto VertexBlob = InShaderBundle.Load("FullscreenVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &VertexShader))
+
+	const auto FxaaBlob = InShaderBundle.Load("FxaaPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(FxaaBlob->GetBufferPointer(), FxaaBlob->GetBufferSize(), nullptr, &FxaaShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ConstantBufferDesc.ByteWidth = sizeof(BloomConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &BloomBinding.Buffer))
+	ConstantBufferDesc.ByteWidth = sizeof(ToneMapConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ToneMapBinding.Buffer))
+	ConstantBufferDesc.ByteWidth = sizeof(FxaaConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &FxaaBinding.Buffer))
+
+	D3D11_SAMPLER_DESC SamplerDesc {};
+	SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateSamplerState(&SamplerDesc, &Sampler))
+
+	CreateTargets(InDevice, InWidth, InHeight);
+}
+
+void PostProcessor::Resize(ID3D11Device* InDevice, const UINT InWidth, const UINT InHeight)
+{
+	CreateTargets(InDevice, InWidth, InHeight);
+}
+
+void PostProcessor::CreateTargets(ID3D11Device* InDevice, const UINT InWidth, const UINT InHeight)
+{
+	HRESULT ResultHandle;
+
+	Width = InWidth;
+	Height = InHeight;
+	BloomWidth = ((InWidth + 1u) / 2u + BloomGroupSize - 1u) / BloomGroupSize * BloomGroupSize;
+	BloomHeight = ((InHeight + 1u) / 2u + BloomGroupSize - 1u) / BloomGroupSize * BloomGroupSize;
+
+	// Half precision is plenty for a glow that is blurred anyway.
+	D3D11_TEXTURE2D_DESC BloomDesc {};
+	BloomDesc.Width = BloomWidth;
+	BloomDesc.Height = BloomHeight;
+	BloomDesc.MipLevels = BloomMipNum;
+	BloomDesc.ArraySize = 1u;
+	BloomDesc.Format = DXGI_FORMAT_R11G11B10_FLOAT;
+	BloomDesc.SampleDesc.Count = 1u;
+	BloomDesc.Usage = D3D11_USAGE_DEFAULT;
+	BloomDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> BloomTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&BloomDesc, nullptr, &BloomTexture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(BloomTexture.Get(), nullptr, &BloomView))
+
+	for (UINT Mip = 0u; Mip < BloomMipNum; ++Mip)
+	{
+		D3D11_UNORDERED_ACCESS_VIEW_DESC MipUavDesc {};
+		MipUavDesc.Format = BloomDesc.Format;
+		MipUavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+		MipUavDesc.Texture2D.MipSlice = Mip;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(BloomTexture.Get(), &MipUavDesc, &BloomMipUavs[Mip]))
+	}
+
+	D3D11_TEXTURE2D_DESC ImageDesc {};
+	ImageDesc.Width = Width;
+	ImageDesc.Height = Height;
+	ImageDesc.MipLevels = 1u;
+	ImageDesc.ArraySize = 1u;
+	ImageDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	ImageDesc.SampleDesc.Count = 1u;
+	ImageDesc.Usage = D3D11_USAGE_DEFAULT;
+	ImageDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> ImageTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&ImageDesc, nullptr, &ImageTexture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(ImageTexture.Get(), nullptr, &ImageView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(ImageTexture.Get(), nullptr, &ImageUav))
+}
+
+void PostProcessor::Apply(const Graphics& InGraphics, ID3D11RenderTargetView* InDisplayTarget, ID3D11ShaderResourceView* InSceneView,
+                          const D3D11_VIEWPORT& InSceneViewport)
+{
+	const bool bHasBloom = bIsBloomEnabled && BloomIntensity > 0.0f;
+
+	// The scene is still bound as the target the frame was drawn to, it has to be unbound before it can be read.
+	InGraphics.GetImmediateContext().GetStateCache().SetRenderTarget(nullptr, nullptr);
+
+	if (bHasBloom)
+	{
+		DownsampleBloom(InGraphics, InSceneView, InSceneViewport);
+	}
+
+	ToneMap(InGraphics, InSceneView, InSceneViewport, bHasBloom);
+	Present(InGraphics, InDisplayTarget, InSceneViewport);
+}
+
+template <typename TConstants>
+void PostProcessor::Upload(const Graphics& InGraphics, ConstantBinding<TConstants>& InOutBinding, const TConstants& InConstants)
+{
+	auto& Context = InGraphics.GetImmediateContext();
+
+	if (InOutBinding.bHasUploaded && std::memcmp(&InConstants, &InOutBinding.Uploaded, sizeof(InConstants)) == 0)
+	{
+		Context.GetStateCache().CountSkippedUpload();
+		return;
+	}
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(Context.GetDeviceContext()->Map(InOutBinding.Buffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &InConstants, sizeof(InConstants));
+	Context.GetDeviceContext()->Unmap(InOutBinding.Buffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(InConstants));
+
+	InOutBinding.Uploaded = InConstants;
+	InOutBinding.bHasUploaded = true;
+}
+
+void PostProcessor::DownsampleBloom(const Graphics& InGraphics, ID3D11ShaderResourceView* InSceneView, const D3D11_VIEWPORT& InSceneViewport)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Bloom");
+
+	const UINT Mip0Width = (static_cast<UINT>(InSceneViewport.Width) + 1u) / 2u;
+	const UINT Mip0Height = (static_cast<UINT>(InSceneViewport.Height) + 1u) / 2u;
+
+	BloomConstants Constants {};
+	Constants.SceneTexelSize = {1.0f / static_cast<float>(Width), 1.0f / static_cast<float>(Height)};
+	Constants.MaxSceneCoordinate = {(InSceneViewport.Width - 0.5f) / static_cast<float>(Width), (InSceneViewport.Height - 0.5f) / static_cast<float>(Height)};
+	Constants.Mip0Size = {Mip0Width, Mip0Height};
+	Constants.Threshold = BloomThreshold;
+	Constants.Knee = BloomThreshold * BloomKneeRatio;
+	Upload(InGraphics, BloomBinding, Constants);
+
+	auto* const DeviceContext = InGraphics.GetImmediateContext().GetDeviceContext();
+
+	ID3D11UnorderedAccessView* Uavs[BloomMipNum];
+
+	for (UINT Mip = 0u; Mip < BloomMipNum; ++Mip)
+	{
+		Uavs[Mip] = BloomMipUavs[Mip].Get();
+	}
+
+	DeviceContext->CSSetShader(BloomShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, BloomBinding.Buffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(SourceSlot, 1u, &InSceneView);
+	DeviceContext->CSSetSamplers(SamplerSlot, 1u, Sampler.GetAddressOf());
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, BloomMipNum, Uavs, nullptr);
+
+	InGraphics.Dispatch((Mip0Width + BloomGroupSize - 1u) / BloomGroupSize, (Mip0Height + BloomGroupSize - 1u) / BloomGroupSize);
+}
+
+void PostProcessor::ToneMap(const Graphics& InGraphics, ID3D11ShaderResourceView* InSceneView, const D3D11_VIEWPORT& InSceneViewport,
+                            const bool bInHasBloom)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Tonemap");
+
+	const UINT ViewportWidth = static_cast<UINT>(InSceneViewport.Width);
+	const UINT ViewportHeight = static_cast<UINT>(InSceneViewport.Height);
+
+	ToneMapConstants Constants {};
+	Constants.BloomScale = {0.5f / static_cast<float>(BloomWidth), 0.5f / static_cast<float>(BloomHeight)};
+	Constants.BloomMip0Size = {(ViewportWidth + 1u) / 2u, (ViewportHeight + 1u) / 2u};
+	Constants.BloomSize = {BloomWidth, BloomHeight};
+	Constants.ViewportSize = {ViewportWidth, ViewportHeight};
+	Constants.Exposure = Exposure;
+	Constants.BloomIntensity = bInHasBloom ? BloomIntensity : 0.0f;
+	Upload(InGraphics, ToneMapBinding, Constants);
+
+	auto* const DeviceContext = InGraphics.GetImmediateContext().GetDeviceContext();
+	ID3D11ShaderResourceView* const Views[] = {InSceneView, BloomView.Get()};
+	static_assert(BloomSlot == SourceSlot + 1u, "Views are bound as one range");
+
+	DeviceContext->CSSetShader(ToneMapShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ToneMapBinding.Buffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(SourceSlot, bInHasBloom ? 2u : 1u, Views);
+	DeviceContext->CSSetSamplers(SamplerSlot, 1u, Sampler.GetAddressOf());
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, ImageUav.GetAddressOf(), nullptr);
+
+	InGraphics.Dispatch((ViewportWidth + ToneMapGroupSize - 1u) / ToneMapGroupSize, (ViewportHeight + ToneMapGroupSize - 1u) / ToneMapGroupSize);
+}
+
+void PostProcessor::Present(const Graphics& InGraphics, ID3D11RenderTargetView* InDisplayTarget, const D3D11_VIEWPORT& InSceneViewport)
+{
+	PROFILE_GPU_SCOPE(InGraphics, bIsFxaaEnabled ? "FXAA" : "Upscale");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	const auto& DisplayViewport = InGraphics.GetDisplayViewport();
+
+	FxaaConstants Constants {};
+	Constants.SceneScale = {InSceneViewport.Width / (DisplayViewport.Width * static_cast<float>(Width)), InSceneViewport.Height / (DisplayViewport.Height * static_cast<float>(Height))};
+	Constants.MaxSceneCoordinate = {(InSceneViewport.Width - 0.5f) / static_cast<float>(Width), (InSceneViewport.Height - 0.5f) / static_cast<float>(Height)};
+	Constants.RcpFrame = {1.0f / static_cast<float>(Width), 1.0f / static_cast<float>(Height)};
+	Constants.bIsFxaaEnabled = bIsFxaaEnabled;
+	Upload(InGraphics, FxaaBinding, Constants);
+
+	Cache.SetRenderTarget(InDisplayTarget, nullptr);
+	Context.GetDeviceContext()->RSSetViewports(1u, &DisplayViewport);
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	Cache.SetInputLayout(nullptr);
+	// The transparent pass may have left blending on.
+	Cache.SetRasterizerState(nullptr);
+	Cache.SetBlendState(nullptr);
+	Cache.SetVertexShader(VertexShader.Get());
+	Cache.SetPixelShader(FxaaShader.Get());
+	Cache.SetPixelConstantBuffer(ConstantSlot, FxaaBinding.Buffer.Get());
+	Cache.SetPixelShaderResource(SourceSlot, ImageView.Get());
+	Cache.SetPixelSampler(SamplerSlot, Sampler.Get());
+
+	Context.GetDeviceContext()->Draw(3u, 0u);
+	Cache.CountDraw(3u, 1u);
+
+	// Written again by the next frame's tonemap.
+	Cache.SetPixelShaderResource(SourceSlot, nullptr);
+}
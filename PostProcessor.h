@@ -0,0 +1,179 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Resolves the HDR scene target to the display through a chain of post-processing passes.
+ * A compute pass builds every bloom mip from the bright parts of the scene in one dispatch, a second adds them back
+ * to the scene, exposes, compresses into the displayable range with a filmic curve and encodes to sRGB. The last pass
+ * draws the result to the display with FXAA, upscaling a scene rendered below the display resolution on the way.
+ * The scene comes in with each frame, either Graphics' own target or temporal anti-aliasing's output already upsampled.
+ * The intermediates are the post processor's own, the render graph's transients only live while the queue executes.
+ */
+class PostProcessor
+{
+public:
+	static constexpr UINT BloomMipNum {5u};
+
+	// InWidth by InHeight is the size of the scene textures, which is the display's.
+	PostProcessor(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, UINT InWidth, UINT InHeight);
+	PostProcessor(const PostProcessor&) = delete;
+	PostProcessor(PostProcessor&&) = delete;
+	PostProcessor& operator=(const PostProcessor&) = delete;
+	PostProcessor& operator=(PostProcessor&&) = delete;
+	~PostProcessor() = default;
+
+	// The bloom chain and the tonemapped image follow the scene textures to their new size.
+	void Resize(ID3D11Device* InDevice, UINT InWidth, UINT InHeight);
+
+	// Leaves InDisplayTarget bound without depth and with the display viewport, with the scene unbound again so it can
+	// be rendered into next frame. The target is written as it is, the values are already encoded. Only InSceneViewport,
+	// from the scene texture's top left, holds this frame.
+	void Apply(const Graphics& InGraphics, ID3D11RenderTargetView* InDisplayTarget, ID3D11ShaderResourceView* InSceneView,
+	           const D3D11_VIEWPORT& InSceneViewport);
+
+	// Linear scale applied before the curve, one leaves the lit values as they are.
+	void SetExposure(const float InExposure) noexcept
+	{
+		Exposure = InExposure;
+	}
+
+	[[nodiscard]] float GetExposure() const noexcept
+	{
+		return Exposure;
+	}
+
+	void EnableBloom() noexcept
+	{
+		bIsBloomEnabled = true;
+	}
+
+	void DisableBloom() noexcept
+	{
+		bIsBloomEnabled = false;
+	}
+
+	[[nodiscard]] bool IsBloomEnabled() const noexcept
+	{
+		return bIsBloomEnabled;
+	}
+
+	// Scene brightness at which the glow starts, past a soft knee below it.
+	void SetBloomThreshold(const float InThreshold) noexcept
+	{
+		BloomThreshold = InThreshold;
+	}
+
+	// Scale of the glow added to the scene, zero skips the bloom passes.
+	void SetBloomIntensity(const float InIntensity) noexcept
+	{
+		BloomIntensity = InIntensity;
+	}
+
+	void EnableFxaa() noexcept
+	{
+		bIsFxaaEnabled = true;
+	}
+
+	void DisableFxaa() noexcept
+	{
+		bIsFxaaEnabled = false;
+	}
+
+	[[nodiscard]] bool IsFxaaEnabled() const noexcept
+	{
+		return bIsFxaaEnabled;
+	}
+
+private:
+	struct BloomConstants
+	{
+		DirectX::XMFLOAT2 SceneTexelSize;
+		DirectX::XMFLOAT2 MaxSceneCoordinate;
+		DirectX::XMUINT2 Mip0Size;
+		float Threshold;
+		float Knee;
+	};
+
+	struct ToneMapConstants
+	{
+		DirectX::XMFLOAT2 BloomScale;
+		DirectX::XMUINT2 BloomMip0Size;
+		DirectX::XMUINT2 BloomSize;
+		DirectX::XMUINT2 ViewportSize;
+		float Exposure;
+		float BloomIntensity;
+		float Padding[2];
+	};
+
+	struct FxaaConstants
+	{
+		// From display pixel to image texture coordinate, and the farthest coordinate that only filters rendered texels.
+		DirectX::XMFLOAT2 SceneScale;
+		DirectX::XMFLOAT2 MaxSceneCoordinate;
+		DirectX::XMFLOAT2 RcpFrame;
+		UINT bIsFxaaEnabled;
+		float Padding;
+	};
+
+	// Each constant buffer is only written when what it holds changes.
+	template <typename TConstants>
+	struct ConstantBinding
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		TConstants Uploaded {};
+		bool bHasUploaded {false};
+	};
+
+	template <typename TConstants>
+	static void Upload(const Graphics& InGraphics, ConstantBinding<TConstants>& InOutBinding, const TConstants& InConstants);
+
+	void CreateTargets(ID3D11Device* InDevice, UINT InWidth, UINT InHeight);
+	void DownsampleBloom(const Graphics& InGraphics, ID3D11ShaderResourceView* InSceneView, const D3D11_VIEWPORT& InSceneViewport);
+	void ToneMap(const Graphics& InGraphics, ID3D11ShaderResourceView* InSceneView, const D3D11_VIEWPORT& InSceneViewport, bool bInHasBloom);
+	void Present(const Graphics& InGraphics, ID3D11RenderTargetView* InDisplayTarget, const D3D11_VIEWPORT& InSceneViewport);
+
+	// Registers in BloomDownsampleCS.hlsl, ToneMapCS.hlsl and FxaaPS.hlsl, each pass starts its views from zero.
+	static constexpr UINT ConstantSlot {0u};
+	static constexpr UINT SourceSlot {0u};
+	static constexpr UINT BloomSlot {1u};
+	static constexpr UINT SamplerSlot {0u};
+	static constexpr UINT OutputSlot {0u};
+	static constexpr UINT BloomGroupSize {16u};
+	static constexpr UINT ToneMapGroupSize {8u};
+	// Threshold over knee of the soft ramp below it.
+	static constexpr float BloomKneeRatio {0.5f};
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> BloomShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> ToneMapShader;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> FxaaShader;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> Sampler;
+
+	ConstantBinding<BloomConstants> BloomBinding;
+	ConstantBinding<ToneMapConstants> ToneMapBinding;
+	ConstantBinding<FxaaConstants> FxaaBinding;
+
+	// Mip 0 is half the scene's size, rounded up to whole bloom groups so every mip halves evenly.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> BloomView;
+	std::array<Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>, BloomMipNum> BloomMipUavs;
+	// The tonemapped image, encoded, with its luma in alpha for FXAA.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ImageView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ImageUav;
+
+	UINT Width {0u};
+	UINT Height {0u};
+	UINT BloomWidth {0u};
+	UINT BloomHeight {0u};
+	float Exposure {1.0f};
+	float BloomThreshold {1.0f};
+	float BloomIntensity {0.1f};
+	bool bIsBloomEnabled {true};
+	bool bIsFxaaEnabled {true};
+};
@@ -0,0 +1,408 @@
+﻿#include "QualityCalibration.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "GpuProfiler.h"
+#include "Logger.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	struct Tier
+	{
+		const char* Name;
+		float RenderScale;
+		UINT SampleNum;
+		UINT ShadowMapSize;
+		float LodErrorScale;
+		size_t TextureBudgetMegabytes;
+	};
+
+	// From the best down, Choose takes the first predicted to fit.
+	constexpr std::array Tiers
+	{
+		Tier {"ultra", 1.0f, 4u, 4096u, 1.0f, 2048u},
+		Tier {"high", 0.85f, 1u, 2048u, 1.0f, 1024u},
+		Tier {"medium", 0.7f, 1u, 2048u, 2.0f, 512u},
+		Tier {"low", 0.5f, 1u, 1024u, 4.0f, 256u}
+	};
+
+	// A frame of the default scene in units of the tests. Rough, the model only has to rank the tiers and size the scale.
+	// Full screen writes per pixel, the G-buffer, lighting, transparency and post-processing together.
+	constexpr float SceneFillPasses {10.0f};
+	// Shading per pixel, in runs of the ALU test's loop.
+	constexpr float SceneAluPasses {1.5f};
+	// At the finest LODs and with the shadow passes, coarser LODs halve their triangles about as often as they double their error.
+	constexpr float SceneTriangleMillions {2.0f};
+	constexpr float SceneDrawNum {3000.0f};
+	// Of a pixel's writes each sample past the first adds, shading runs once per pixel.
+	constexpr float SampleFillCost {0.35f};
+	// The temporal resolve reads the history and a neighbourhood, and writes.
+	constexpr float TemporalFillPasses {2.0f};
+	// The near cascade is drawn every frame and the far ones every few.
+	constexpr float CascadesPerFrame {1.5f};
+	// Of the target a prediction has to stay under, for the model's error and the scene's own variation.
+	constexpr float Headroom {0.8f};
+	constexpr float MinRenderScale {0.5f};
+	// Streamed textures get at most half of the video memory, which unified memory GPUs report next to none of.
+	constexpr size_t MinTextureBudgetBytes {256u * 1024u * 1024u};
+
+	float GetMedian(std::vector<float>& InOutSamples) noexcept
+	{
+		if (InOutSamples.empty())
+		{
+			return 0.0f;
+		}
+
+		const auto Middle = InOutSamples.begin() + InOutSamples.size() / 2u;
+		std::nth_element(InOutSamples.begin(), Middle, InOutSamples.end());
+		return *Middle;
+	}
+}
+
+QualityCalibration::QualityCalibration(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, const ShaderBundle& InShaderBundle)
+	: Device(InDevice), Context(InContext)
+{
+	HRESULT ResultHandle;
+
+	// The scene's format, so fills cost what the scene's writes do.
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Target;
+	D3D11_TEXTURE2D_DESC TargetDesc {};
+	TargetDesc.Width = TargetWidth;
+	TargetDesc.Height = TargetHeight;
+	TargetDesc.MipLevels = 1u;
+	TargetDesc.ArraySize = 1u;
+	TargetDesc.Format = DXGI_FORMAT_R11G11B10_FLOAT;
+	TargetDesc.SampleDesc.Count = 1u;
+	TargetDesc.Usage = D3D11_USAGE_DEFAULT;
+	TargetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TargetDesc, nullptr, &Target))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(Target.Get(), nullptr, &TargetView))
+
+	const auto FullscreenBlob = InShaderBundle.Load("FullscreenVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(FullscreenBlob->GetBufferPointer(), FullscreenBlob->GetBufferSize(), nullptr, &FullscreenShader))
+
+	const auto GridBlob = InShaderBundle.Load("CalibrationGridVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(GridBlob->GetBufferPointer(), GridBlob->GetBufferSize(), nullptr, &GridShader))
+
+	const auto FillBlob = InShaderBundle.Load("CalibrationFillPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(FillBlob->GetBufferPointer(), FillBlob->GetBufferSize(), nullptr, &FillShader))
+
+	const auto AluBlob = InShaderBundle.Load("CalibrationAluPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(AluBlob->GetBufferPointer(), AluBlob->GetBufferSize(), nullptr, &AluShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(Constants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	D3D11_QUERY_DESC FrameDoneDesc {};
+	FrameDoneDesc.Query = D3D11_QUERY_EVENT;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateQuery(&FrameDoneDesc, &FrameDone))
+}
+
+QualityCalibration::Measurements QualityCalibration::Measure()
+{
+	GpuProfiler Profiler {Device, Context};
+	std::vector<float> FillTimes;
+	std::vector<float> AluTimes;
+	std::vector<float> VertexTimes;
+	std::vector<float> SubmitTimes;
+	auto ResolvedNum = Profiler.GetTotalResolvedFrameNum();
+
+	// A frame's timings are read back GpuProfiler::LatencyFrameNum frames after it, the warmup's are left out.
+	for (unsigned int Frame = 0u; Frame < WarmupFrameNum + MeasuredFrameNum + GpuProfiler::LatencyFrameNum; ++Frame)
+	{
+		Profiler.BeginFrame();
+
+		// Frames whose timestamps were disjoint, such as across a clock change, are skipped by the profiler and missing here.
+		if (Profiler.GetTotalResolvedFrameNum() != ResolvedNum && Frame >= WarmupFrameNum + GpuProfiler::LatencyFrameNum)
+		{
+			for (const auto& [Name, Depth, Milliseconds] : Profiler.GetLastTimings())
+			{
+				const std::string_view Scope {Name};
+				auto* const Samples = Scope == "Calibration fill" ? &FillTimes : Scope == "Calibration ALU" ? &AluTimes :
+				                      Scope == "Calibration vertices" ? &VertexTimes : nullptr;
+
+				if (Samples)
+				{
+					Samples->push_back(Milliseconds);
+				}
+			}
+		}
+
+		ResolvedNum = Profiler.GetTotalResolvedFrameNum();
+		const auto SubmitMicroseconds = DrawTests(Profiler);
+		Profiler.EndFrame();
+
+		// Each frame runs alone, the next one's submission isn't timed against a GPU still busy with this one.
+		Context->End(FrameDone.Get());
+		while (Context->GetData(FrameDone.Get(), nullptr, 0u, 0u) == S_FALSE)
+		{
+			std::this_thread::yield();
+		}
+
+		if (Frame >= WarmupFrameNum)
+		{
+			SubmitTimes.push_back(SubmitMicroseconds);
+		}
+	}
+
+	constexpr auto Megapixels = static_cast<float>(TargetWidth * TargetHeight) / 1'000'000.0f;
+
+	Measurements Measured;
+	Measured.FillMilliseconds = GetMedian(FillTimes) / (FillPassNum * Megapixels);
+	// The ALU passes write as much as fills do, which isn't the loop's.
+	Measured.AluMilliseconds = std::max(GetMedian(AluTimes) / (AluPassNum * Megapixels) - Measured.FillMilliseconds, 0.0f);
+	Measured.VertexMilliseconds = GetMedian(VertexTimes) / (static_cast<float>(VertexTriangleNum) / 1'000'000.0f);
+	Measured.SubmitMicroseconds = GetMedian(SubmitTimes) / SubmitDrawNum;
+
+	LOG_INFO("Calibration: {} ms per megapixel of fill, {} of ALU, {} ms per million triangles, {} us per draw over {} frames",
+	         Measured.FillMilliseconds, Measured.AluMilliseconds, Measured.VertexMilliseconds, Measured.SubmitMicroseconds, FillTimes.size());
+
+	return Measured;
+}
+
+float QualityCalibration::DrawTests(GpuProfiler& InProfiler)
+{
+	const D3D11_VIEWPORT TargetViewport {0.0f, 0.0f, static_cast<float>(TargetWidth), static_cast<float>(TargetHeight), 0.0f, 1.0f};
+
+	Context->OMSetRenderTargets(1u, TargetView.GetAddressOf(), nullptr);
+	Context->RSSetViewports(1u, &TargetViewport);
+	Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	Context->IASetInputLayout(nullptr);
+	Context->PSSetConstantBuffers(0u, 1u, ConstantBuffer.GetAddressOf());
+
+	{
+		const GpuProfiler::Scope Scope {InProfiler, "Calibration fill"};
+		Upload(0.5f, 0u);
+		Context->VSSetShader(FullscreenShader.Get(), nullptr, 0u);
+		Context->PSSetShader(FillShader.Get(), nullptr, 0u);
+
+		for (UINT Pass = 0u; Pass < FillPassNum; ++Pass)
+		{
+			Context->Draw(3u, 0u);
+		}
+	}
+
+	{
+		const GpuProfiler::Scope Scope {InProfiler, "Calibration ALU"};
+		Upload(0.5f, AluIterationNum);
+		Context->PSSetShader(AluShader.Get(), nullptr, 0u);
+
+		for (UINT Pass = 0u; Pass < AluPassNum; ++Pass)
+		{
+			Context->Draw(3u, 0u);
+		}
+	}
+
+	{
+		const GpuProfiler::Scope Scope {InProfiler, "Calibration vertices"};
+		Context->VSSetShader(GridShader.Get(), nullptr, 0u);
+		Context->PSSetShader(FillShader.Get(), nullptr, 0u);
+		Context->Draw(VertexTriangleNum * 3u, 0u);
+	}
+
+	// One pixel each, so the GPU keeps up and only issuing them costs. Shaders alternate, like materials between draws.
+	const D3D11_VIEWPORT PixelViewport {0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f};
+	Context->RSSetViewports(1u, &PixelViewport);
+	Context->VSSetShader(FullscreenShader.Get(), nullptr, 0u);
+
+	const auto Start = FrameProfiler::Clock::now();
+
+	for (UINT Draw = 0u; Draw < SubmitDrawNum; ++Draw)
+	{
+		Upload(static_cast<float>(Draw) / SubmitDrawNum, 0u);
+		Context->PSSetShader(Draw % 2u ? AluShader.Get() : FillShader.Get(), nullptr, 0u);
+		Context->Draw(3u, 0u);
+	}
+
+	Context->Flush();
+
+	return std::chrono::duration<float, std::micro>(FrameProfiler::Clock::now() - Start).count();
+}
+
+void QualityCalibration::Upload(const float InValue, const UINT InIterationNum)
+{
+	HRESULT ResultHandle;
+
+	D3D11_MAPPED_SUBRESOURCE Mapped;
+	CHECK_HRESULT_EXCEPTION(Context->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &Mapped))
+	*static_cast<Constants*>(Mapped.pData) = {InValue, InIterationNum, {}};
+	Context->Unmap(ConstantBuffer.Get(), 0u);
+}
+
+QualityCalibration::Preset QualityCalibration::Choose(const Measurements& InMeasured, const float InTargetMilliseconds, const float InDisplayPixels,
+                                                      const SIZE_T InVideoBytes)
+{
+	const auto Budget = InTargetMilliseconds * Headroom;
+	const auto DisplayMegapixels = InDisplayPixels / 1'000'000.0f;
+
+	// GPU milliseconds split into what follows the square of the render scale, at full scale, and what doesn't.
+	const auto Predict = [&](const Tier& InTier)
+	{
+		const auto SampleFill = 1.0f + SampleFillCost * static_cast<float>(InTier.SampleNum - 1u);
+		const auto Temporal = InTier.SampleNum == 1u ? TemporalFillPasses : 0.0f;
+		const auto ShadowMegapixels = static_cast<float>(InTier.ShadowMapSize) * static_cast<float>(InTier.ShadowMapSize) / 1'000'000.0f;
+
+		const auto Scaled = DisplayMegapixels * (InMeasured.FillMilliseconds * (SceneFillPasses * SampleFill + Temporal) +
+		                                         InMeasured.AluMilliseconds * SceneAluPasses);
+		const auto Fixed = ShadowMegapixels * InMeasured.FillMilliseconds * CascadesPerFrame +
+		                   SceneTriangleMillions / InTier.LodErrorScale * InMeasured.VertexMilliseconds;
+		return std::pair {Scaled, Fixed};
+	};
+
+	// The lowest tier when none fits, at whatever scale comes closest.
+	auto Chosen = &Tiers.back();
+
+	for (const auto& Candidate : Tiers)
+	{
+		const auto [Scaled, Fixed] = Predict(Candidate);
+
+		if (Scaled * Candidate.RenderScale * Candidate.RenderScale + Fixed <= Budget)
+		{
+			Chosen = &Candidate;
+			break;
+		}
+	}
+
+	const auto [Scaled, Fixed] = Predict(*Chosen);
+	const auto IdealScale = Scaled > 0.0f ? std::sqrt(std::max(Budget - Fixed, 0.0f) / Scaled) : 1.0f;
+
+	Preset Picked;
+	Picked.RenderScale = std::clamp(IdealScale, MinRenderScale, 1.0f);
+	Picked.SampleNum = Chosen->SampleNum;
+	Picked.ShadowMapSize = Chosen->ShadowMapSize;
+	Picked.LodErrorScale = Chosen->LodErrorScale;
+	Picked.TextureBudgetBytes = std::min(Chosen->TextureBudgetMegabytes * 1024u * 1024u, std::max(static_cast<size_t>(InVideoBytes / 2u), MinTextureBudgetBytes));
+	Picked.GpuMilliseconds = Scaled * Picked.RenderScale * Picked.RenderScale + Fixed;
+	Picked.CpuMilliseconds = SceneDrawNum * InMeasured.SubmitMicroseconds / 1000.0f;
+
+	LOG_INFO("Calibration: the {} tier at {} scale, predicted {} ms GPU and {} ms CPU against a target of {} ms", Chosen->Name,
+	         Picked.RenderScale, Picked.GpuMilliseconds, Picked.CpuMilliseconds, InTargetMilliseconds);
+
+	// Quality only moves the GPU's share, a CPU over the target is reported but can't be helped by it.
+	if (Picked.CpuMilliseconds > Budget)
+	{
+		LOG_WARNING("Calibration: submitting the scene is predicted to take {} ms of CPU, over the target whatever the quality",
+		            Picked.CpuMilliseconds);
+	}
+
+	return Picked;
+}
+
+std::optional<QualityCalibration::Preset> QualityCalibration::Load(const AdapterIdentity& InIdentity, const float InTargetMilliseconds,
+                                                                   const std::string& InFileName)
+{
+	std::ifstream Stream(InFileName);
+
+	if (!Stream)
+	{
+		return std::nullopt;
+	}
+
+	Preset Loaded;
+	AdapterIdentity Measured;
+	float TargetMilliseconds = 0.0f;
+	size_t TextureBudgetMegabytes = 0u;
+	std::string Line;
+
+	while (std::getline(Stream, Line))
+	{
+		std::istringstream LineStream(Line);
+		std::string Keyword;
+
+		// Blank lines and comments.
+		if (!(LineStream >> Keyword) || Keyword.front() == '#')
+		{
+			continue;
+		}
+
+		if (Keyword == "adapter")
+		{
+			LineStream >> Measured.VendorId >> Measured.DeviceId >> Measured.Revision >> Measured.DedicatedVideoBytes;
+		}
+		else if (Keyword == "driver")
+		{
+			LineStream >> Measured.DriverVersion;
+		}
+		else if (Keyword == "threads")
+		{
+			LineStream >> Measured.ThreadNum;
+		}
+		else if (Keyword == "target")
+		{
+			LineStream >> TargetMilliseconds;
+		}
+		else if (Keyword == "scale")
+		{
+			LineStream >> Loaded.RenderScale;
+		}
+		else if (Keyword == "samples")
+		{
+			LineStream >> Loaded.SampleNum;
+		}
+		else if (Keyword == "shadow")
+		{
+			LineStream >> Loaded.ShadowMapSize;
+		}
+		else if (Keyword == "lod")
+		{
+			LineStream >> Loaded.LodErrorScale;
+		}
+		else if (Keyword == "texture-budget")
+		{
+			LineStream >> TextureBudgetMegabytes;
+		}
+	}
+
+	// Written with a few digits, a target set in code compares equal to what was written for it.
+	if (!(Measured == InIdentity) || std::abs(TargetMilliseconds - InTargetMilliseconds) > 0.01f)
+	{
+		LOG_INFO("{} was calibrated for another adapter, driver, CPU or target frame time", InFileName);
+		return std::nullopt;
+	}
+
+	if (TextureBudgetMegabytes > 0u)
+	{
+		Loaded.TextureBudgetBytes = TextureBudgetMegabytes * 1024u * 1024u;
+	}
+
+	Loaded.RenderScale = std::clamp(Loaded.RenderScale, MinRenderScale, 1.0f);
+	Loaded.SampleNum = std::max(Loaded.SampleNum, 1u);
+	Loaded.LodErrorScale = std::max(Loaded.LodErrorScale, 0.1f);
+	return Loaded;
+}
+
+bool QualityCalibration::Write(const Preset& InPreset, const Measurements& InMeasured, const AdapterIdentity& InIdentity,
+                               const float InTargetMilliseconds, const std::string& InFileName)
+{
+	std::ofstream Stream(InFileName);
+
+	Stream << "# Quality the startup calibration picked for this machine, read on every start. Edits are kept until the adapter,\n"
+	          "# driver or CPU changes. Delete the file or pass --calibrate to measure again.\n";
+	Stream << "adapter " << InIdentity.VendorId << ' ' << InIdentity.DeviceId << ' ' << InIdentity.Revision << ' ' << InIdentity.DedicatedVideoBytes << '\n';
+	Stream << "driver " << InIdentity.DriverVersion << '\n';
+	Stream << "threads " << InIdentity.ThreadNum << '\n';
+	Stream << "target " << InTargetMilliseconds << '\n';
+	Stream << "# Measured " << InMeasured.FillMilliseconds << " ms per megapixel of fill, " << InMeasured.AluMilliseconds << " of ALU, "
+	       << InMeasured.VertexMilliseconds << " ms per million triangles, " << InMeasured.SubmitMicroseconds << " us per draw.\n";
+	Stream << "scale " << InPreset.RenderScale << '\n';
+	Stream << "samples " << InPreset.SampleNum << '\n';
+	Stream << "shadow " << InPreset.ShadowMapSize << '\n';
+	Stream << "lod " << InPreset.LodErrorScale << '\n';
+	Stream << "texture-budget " << InPreset.TextureBudgetBytes / (1024u * 1024u) << '\n';
+
+	return static_cast<bool>(Stream);
+}
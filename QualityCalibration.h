@@ -0,0 +1,119 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <optional>
+#include <string>
+#include "wrl/client.h"
+
+class GpuProfiler;
+class ShaderBundle;
+
+// What the preset was measured on, the machine is calibrated again once any of it changes.
+struct AdapterIdentity
+{
+	UINT VendorId {0u};
+	UINT DeviceId {0u};
+	UINT Revision {0u};
+	// UMD version as DXGI reports it, a driver update changes it.
+	unsigned long long DriverVersion {0u};
+	unsigned int ThreadNum {0u};
+	SIZE_T DedicatedVideoBytes {0u};
+
+	[[nodiscard]] bool operator==(const AdapterIdentity&) const noexcept = default;
+};
+
+/**
+ * The first-run calibration, a few seconds of micro-benchmarks on the device that pick the quality settings a machine can
+ * hold its target frame time with, so field machines stop being tuned by hand. It runs on a device of its own from
+ * Graphics::Prepare before the window exists, since the MSAA it picks is the swap chain's.
+ * Measure times full screen fills, a long pixel shader loop and a grid of tiny triangles with a GPU profiler's scopes, and
+ * draw submission on the CPU. Choose predicts a frame of every tier from those and takes the best that fits, and the preset
+ * is written next to the executable with the adapter, driver and CPU it was measured on. Later runs read it back, and
+ * measure again when any of those changed. It is plain text, an operator's edits stay until the hardware changes.
+ */
+class QualityCalibration
+{
+public:
+	struct Measurements
+	{
+		// GPU milliseconds per million pixels of a flat colour, and of the ALU loop on top of it.
+		float FillMilliseconds {0.0f};
+		float AluMilliseconds {0.0f};
+		// Per million triangles too small to cover a pixel.
+		float VertexMilliseconds {0.0f};
+		// CPU time to issue one draw with its constants, driver flush included.
+		float SubmitMicroseconds {0.0f};
+	};
+
+	struct Preset
+	{
+		// The scale dynamic resolution starts at and never rises above.
+		float RenderScale {1.0f};
+		// MSAA samples, temporal anti-aliasing takes over without them.
+		UINT SampleNum {1u};
+		UINT ShadowMapSize {2048u};
+		// Of Mesh::MaxScreenError, above one coarser LODs come in closer.
+		float LodErrorScale {1.0f};
+		size_t TextureBudgetBytes {512u * 1024u * 1024u};
+		// The frame times predicted for the preset, kept for the log.
+		float GpuMilliseconds {0.0f};
+		float CpuMilliseconds {0.0f};
+	};
+
+	static constexpr const char* PresetFileName = "Quality.preset";
+
+	QualityCalibration(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, const ShaderBundle& InShaderBundle);
+	QualityCalibration(const QualityCalibration&) = delete;
+	QualityCalibration(QualityCalibration&&) = delete;
+	QualityCalibration& operator=(const QualityCalibration&) = delete;
+	QualityCalibration& operator=(QualityCalibration&&) = delete;
+	~QualityCalibration() = default;
+
+	// Runs every test for a number of frames and keeps the median of each.
+	[[nodiscard]] Measurements Measure();
+
+	// The best tier predicted to fit InTargetMilliseconds at InDisplayPixels, its render scale then raised as far as it still does.
+	[[nodiscard]] static Preset Choose(const Measurements& InMeasured, float InTargetMilliseconds, float InDisplayPixels, SIZE_T InVideoBytes);
+	// Nothing when the file is missing, unreadable, or was written for another adapter, driver, CPU or target.
+	[[nodiscard]] static std::optional<Preset> Load(const AdapterIdentity& InIdentity, float InTargetMilliseconds,
+	                                                const std::string& InFileName = PresetFileName);
+	static bool Write(const Preset& InPreset, const Measurements& InMeasured, const AdapterIdentity& InIdentity, float InTargetMilliseconds,
+	                  const std::string& InFileName = PresetFileName);
+
+private:
+	// Size of the target the GPU tests draw into, a 1080p display's.
+	static constexpr UINT TargetWidth {1920u};
+	static constexpr UINT TargetHeight {1080u};
+	// Full screen passes per frame of each pixel test, enough that their time dwarfs the timestamps' own resolution.
+	static constexpr UINT FillPassNum {16u};
+	static constexpr UINT AluPassNum {4u};
+	// Loop iterations per pixel of the ALU test.
+	static constexpr UINT AluIterationNum {256u};
+	static constexpr UINT VertexTriangleNum {1u << 20};
+	static constexpr UINT SubmitDrawNum {2000u};
+	static constexpr unsigned int WarmupFrameNum {4u};
+	static constexpr unsigned int MeasuredFrameNum {24u};
+
+	struct Constants
+	{
+		// Varies per draw of the submission test, so each really does upload.
+		float Value;
+		UINT IterationNum;
+		float Padding[2];
+	};
+
+	// One frame of every test, returns the CPU microseconds of its submission.
+	[[nodiscard]] float DrawTests(GpuProfiler& InProfiler);
+	void Upload(float InValue, UINT InIterationNum);
+
+	ID3D11Device* Device;
+	ID3D11DeviceContext* Context;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> TargetView;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> FullscreenShader;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> GridShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> FillShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> AluShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	// Signalled once the GPU has finished a frame of tests, so each is timed alone.
+	Microsoft::WRL::ComPtr<ID3D11Query> FrameDone;
+};
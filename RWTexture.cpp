@@ -0,0 +1,97 @@
+﻿#include "RWTexture.h"
+#include "BindManager.h"
+#include "ExceptionMacros.h"
+
+namespace
+{
+	// The formats typed UAVs can be created with, anything else is counted at four bytes.
+	size_t GetTexelByteSize(const DXGI_FORMAT InFormat) noexcept
+	{
+		switch (InFormat)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_UINT:
+			return 16u;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R32G32_UINT:
+			return 8u;
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_R16_UINT:
+			return 2u;
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_R8_UINT:
+			return 1u;
+		default:
+			return 4u;
+		}
+	}
+}
+
+RWTexture::RWTexture(const Graphics& InGraphics, const std::string& InTag, const UINT InWidth, const UINT InHeight, const DXGI_FORMAT InFormat,
+                     const UINT InSlot)
+	: Tag(InTag), Width(InWidth), Height(InHeight), Format(InFormat), Slot(InSlot)
+{
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = Width;
+	TextureDesc.Height = Height;
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = Format;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateTexture2D(&TextureDesc, nullptr, &MyTexture))
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateShaderResourceView(MyTexture.Get(), nullptr, &MyView))
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateUnorderedAccessView(MyTexture.Get(), nullptr, &MyUnorderedAccessView))
+}
+
+void RWTexture::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetPixelShaderResource(Slot, MyView.Get());
+}
+
+void RWTexture::BindCompute(RenderContext& InContext, const UINT InSlot) noexcept
+{
+	assert(InSlot < Graphics::ComputeResourceSlotNum);
+	GetContext(InContext)->CSSetShaderResources(InSlot, 1u, MyView.GetAddressOf());
+}
+
+void RWTexture::BindUnorderedAccess(RenderContext& InContext, const UINT InSlot) noexcept
+{
+	assert(InSlot < D3D11_PS_CS_UAV_REGISTER_COUNT);
+	GetStateCache(InContext).SetPixelShaderResource(Slot, nullptr);
+	GetContext(InContext)->CSSetUnorderedAccessViews(InSlot, 1u, MyUnorderedAccessView.GetAddressOf(), nullptr);
+}
+
+std::shared_ptr<RWTexture> RWTexture::Resolve(const Graphics& InGraphics, const std::string& InTag, const UINT InWidth, const UINT InHeight,
+                                              const DXGI_FORMAT InFormat, const UINT InSlot)
+{
+	return BindManager::Resolve<RWTexture>(InGraphics, InTag, InWidth, InHeight, InFormat, InSlot);
+}
+
+std::string RWTexture::GenerateUniqueID(const std::string& InTag, const UINT InWidth, const UINT InHeight, const DXGI_FORMAT InFormat, const UINT InSlot)
+{
+	using namespace std::string_literals;
+	return typeid(RWTexture).name() + "#"s + InTag + "#"s + std::to_string(InWidth) + "x"s + std::to_string(InHeight) + "#"s +
+	       std::to_string(InFormat) + "#"s + std::to_string(InSlot);
+}
+
+BindKey RWTexture::GenerateKey(const std::string& InTag, const UINT InWidth, const UINT InHeight, const DXGI_FORMAT InFormat, const UINT InSlot)
+{
+	return BindKey::Make<RWTexture>(InTag, InWidth, InHeight, InFormat, InSlot);
+}
+
+std::string RWTexture::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(Tag, Width, Height, Format, Slot);
+}
+
+size_t RWTexture::GetGpuByteSize() const noexcept
+{
+	return GetTexelByteSize(Format) * Width * Height;
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <memory>
+#include <string>
+#include "BindKey.h"
+#include "Bindable.h"
+
+/**
+ * A 2D texture compute shaders write as a RWTexture2D and every stage can read, for post-processing and other passes
+ * that produce images instead of drawing them. Bind reads it from the pixel shaders in its slot, the compute bindings
+ * pass their own slots. Cached under its tag with its size and format, so the writing and reading passes share it.
+ */
+class RWTexture : public Bindable
+{
+public:
+	RWTexture(const Graphics& InGraphics, const std::string& InTag, UINT InWidth, UINT InHeight, DXGI_FORMAT InFormat, UINT InSlot = 0u);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	void BindCompute(RenderContext& InContext, UINT InSlot) noexcept;
+	// Clears its pixel slot first, the runtime would otherwise drop the read binding behind the state cache's back.
+	void BindUnorderedAccess(RenderContext& InContext, UINT InSlot) noexcept;
+
+	[[nodiscard]] ID3D11Texture2D* GetTexture() const noexcept
+	{
+		return MyTexture.Get();
+	}
+
+	[[nodiscard]] ID3D11ShaderResourceView* GetView() const noexcept
+	{
+		return MyView.Get();
+	}
+
+	[[nodiscard]] ID3D11UnorderedAccessView* GetUnorderedAccessView() const noexcept
+	{
+		return MyUnorderedAccessView.Get();
+	}
+
+	[[nodiscard]] UINT GetWidth() const noexcept
+	{
+		return Width;
+	}
+
+	[[nodiscard]] UINT GetHeight() const noexcept
+	{
+		return Height;
+	}
+
+	[[nodiscard]] static std::shared_ptr<RWTexture> Resolve(const Graphics& InGraphics, const std::string& InTag, UINT InWidth, UINT InHeight,
+	                                                        DXGI_FORMAT InFormat, UINT InSlot = 0u);
+	[[nodiscard]] static std::string GenerateUniqueID(const std::string& InTag, UINT InWidth, UINT InHeight, DXGI_FORMAT InFormat, UINT InSlot = 0u);
+	[[nodiscard]] static BindKey GenerateKey(const std::string& InTag, UINT InWidth, UINT InHeight, DXGI_FORMAT InFormat, UINT InSlot = 0u);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	std::string Tag;
+	UINT Width;
+	UINT Height;
+	DXGI_FORMAT Format;
+	UINT Slot;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> MyTexture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> MyUnorderedAccessView;
+};
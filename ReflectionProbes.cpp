@@ -0,0 +1,353 @@
+﻿#include "ReflectionProbes.h"
+#include <cassert>
+#include <cstring>
+#include "AmbientOcclusion.h"
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+
+namespace
+{
+	// Left handed cube face order and orientation, +X -X +Y -Y +Z -Z, the same as the shadow faces'.
+	constexpr DirectX::XMVECTORF32 FaceDirections[] =
+	{
+		{{{1.0f, 0.0f, 0.0f, 0.0f}}},
+		{{{-1.0f, 0.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, -1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 0.0f, 1.0f, 0.0f}}},
+		{{{0.0f, 0.0f, -1.0f, 0.0f}}}
+	};
+
+	constexpr DirectX::XMVECTORF32 FaceUps[] =
+	{
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 0.0f, -1.0f, 0.0f}}},
+		{{{0.0f, 0.0f, 1.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}},
+		{{{0.0f, 1.0f, 0.0f, 0.0f}}}
+	};
+}
+
+ReflectionProbes::ReflectionProbes(ID3D11Device* InDevice)
+{
+	static_assert(FaceSize <= AmbientOcclusion::UnoccludedSize, "Faces are drawn without occlusion");
+	static_assert((FaceSize >> (MipNum - 1u)) == 1u, "The mips go down to one texel");
+
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(ProbeConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	const ProbeConstants CaptureConstants {};
+	const D3D11_SUBRESOURCE_DATA CaptureData {&CaptureConstants, 0u, 0u};
+
+	ConstantBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ConstantBufferDesc.CPUAccessFlags = 0u;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, &CaptureData, &CaptureConstantBuffer))
+
+	D3D11_TEXTURE2D_DESC CubeDesc {};
+	CubeDesc.Width = FaceSize;
+	CubeDesc.Height = FaceSize;
+	CubeDesc.MipLevels = MipNum;
+	CubeDesc.ArraySize = MaxProbeNum * FaceNum;
+	CubeDesc.Format = Format;
+	CubeDesc.SampleDesc.Count = 1u;
+	CubeDesc.Usage = D3D11_USAGE_DEFAULT;
+	CubeDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	CubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE | D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Cubes;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&CubeDesc, nullptr, &Cubes))
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC CubeViewDesc {};
+	CubeViewDesc.Format = Format;
+	CubeViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+	CubeViewDesc.TextureCubeArray.MipLevels = MipNum;
+	CubeViewDesc.TextureCubeArray.NumCubes = MaxProbeNum;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Cubes.Get(), &CubeViewDesc, &CubeView))
+
+	for (UINT ProbeIndex = 0u; ProbeIndex < MaxProbeNum; ++ProbeIndex)
+	{
+		CubeViewDesc.TextureCubeArray.First2DArrayFace = ProbeIndex * FaceNum;
+		CubeViewDesc.TextureCubeArray.NumCubes = 1u;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(Cubes.Get(), &CubeViewDesc, &ProbeViews[ProbeIndex]))
+	}
+
+	for (UINT Slice = 0u; Slice < MaxProbeNum * FaceNum; ++Slice)
+	{
+		D3D11_RENDER_TARGET_VIEW_DESC FaceViewDesc {};
+		FaceViewDesc.Format = Format;
+		FaceViewDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+		FaceViewDesc.Texture2DArray.FirstArraySlice = Slice;
+		FaceViewDesc.Texture2DArray.ArraySize = 1u;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(Cubes.Get(), &FaceViewDesc, &FaceViews[Slice]))
+	}
+
+	// One depth buffer for every face, only one is drawn at a time.
+	D3D11_TEXTURE2D_DESC DepthDesc {};
+	DepthDesc.Width = FaceSize;
+	DepthDesc.Height = FaceSize;
+	DepthDesc.MipLevels = 1u;
+	DepthDesc.ArraySize = 1u;
+	DepthDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	DepthDesc.SampleDesc.Count = 1u;
+	DepthDesc.Usage = D3D11_USAGE_DEFAULT;
+	DepthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Depth;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&DepthDesc, nullptr, &Depth))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilView(Depth.Get(), nullptr, &DepthView))
+
+	DirectX::XMStoreFloat4x4(&Projection, DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 1.0f, NearZ, FarZ));
+}
+
+void ReflectionProbes::BeginFrame(const Graphics& InGraphics)
+{
+	Captures.clear();
+	CaptureFace = NoFace;
+
+	const auto SlotNum = ProbeNum * FaceNum;
+
+	for (unsigned int Step = 0u; Step < SlotNum; ++Step)
+	{
+		const auto Slot = (NextFace + Step) % SlotNum;
+
+		if (Probes[Slot / FaceNum].StaleFaces & (1u << (Slot % FaceNum)))
+		{
+			CaptureFace = Slot;
+			break;
+		}
+	}
+
+	if (CaptureFace == NoFace && bIsContinuousUpdateEnabled && SlotNum > 0u)
+	{
+		CaptureFace = NextFace % SlotNum;
+	}
+
+	// Cleared now, so whatever moves before the face is drawn marks it stale again for a later frame.
+	if (CaptureFace != NoFace)
+	{
+		Probes[CaptureFace / FaceNum].StaleFaces &= ~(1u << (CaptureFace % FaceNum));
+		NextFace = (CaptureFace + 1u) % SlotNum;
+	}
+
+	if (bIsConstantBufferStale)
+	{
+		UploadConstants(InGraphics);
+	}
+}
+
+unsigned int ReflectionProbes::PlaceProbe(const DirectX::XMFLOAT3& InPosition, const float InRadius)
+{
+	assert(InRadius > 0.0f && "Probes need a sphere to reflect onto");
+
+	unsigned int ProbeIndex;
+
+	if (ProbeNum < MaxProbeNum)
+	{
+		ProbeIndex = ProbeNum++;
+	}
+	else
+	{
+		ProbeIndex = NextReplacedProbe;
+		NextReplacedProbe = (NextReplacedProbe + 1u) % MaxProbeNum;
+	}
+
+	auto& Placed = Probes[ProbeIndex];
+	Placed.Position = InPosition;
+	Placed.Radius = InRadius;
+	Placed.StaleFaces = AllFaces;
+	Placed.DrawnFaces = 0u;
+
+	const auto Eye = DirectX::XMLoadFloat3(&InPosition);
+	const DirectX::BoundingFrustum ViewFrustum(DirectX::XMLoadFloat4x4(&Projection));
+
+	for (UINT Face = 0u; Face < FaceNum; ++Face)
+	{
+		const auto View = DirectX::XMMatrixLookToLH(Eye, FaceDirections[Face], FaceUps[Face]);
+
+		DirectX::XMStoreFloat4x4(&Placed.FaceViews[Face], View);
+		ViewFrustum.Transform(Placed.FaceFrustums[Face], DirectX::XMMatrixInverse(nullptr, View));
+	}
+
+	bIsConstantBufferStale = true;
+	return ProbeIndex;
+}
+
+void ReflectionProbes::Invalidate(const unsigned int InProbe) noexcept
+{
+	assert(InProbe < ProbeNum && "Invalidated a probe that was never placed");
+
+	Probes[InProbe].StaleFaces = AllFaces;
+}
+
+void ReflectionProbes::AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept
+{
+	for (unsigned int ProbeIndex = 0u; ProbeIndex < ProbeNum; ++ProbeIndex)
+	{
+		auto& Moved = Probes[ProbeIndex];
+
+		for (UINT Face = 0u; Face < FaceNum && Moved.StaleFaces != AllFaces; ++Face)
+		{
+			if (Moved.FaceFrustums[Face].Intersects(InBounds))
+			{
+				Moved.StaleFaces |= 1u << Face;
+			}
+		}
+	}
+}
+
+const DirectX::BoundingFrustum* ReflectionProbes::GetCaptureFrustum() const noexcept
+{
+	return CaptureFace != NoFace ? &Probes[CaptureFace / FaceNum].FaceFrustums[CaptureFace % FaceNum] : nullptr;
+}
+
+void ReflectionProbes::AddCapture(const Drawable& InDrawable)
+{
+	assert(CaptureFace != NoFace && "Capture added on a frame no face is drawn");
+
+	// A face has no transparency targets to accumulate into, the probes only hold what is opaque.
+	if (InDrawable.IsOrderIndependent())
+	{
+		return;
+	}
+
+	// Drawables may not be submitted to the queue this frame, culled from the camera but not from the probe.
+	InDrawable.Prepare();
+
+	Captures.push_back(&InDrawable);
+}
+
+void ReflectionProbes::Render(const Graphics& InGraphics)
+{
+	RenderedDrawableNum = 0u;
+
+	if (CaptureFace == NoFace)
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Reflection probe face");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+	const auto ProbeIndex = CaptureFace / FaceNum;
+	auto& Captured = Probes[ProbeIndex];
+
+	// Shaded like the camera's view with what only holds for it swapped out: the cluster lists and the occlusion are
+	// the camera's screen's, and the cube array cannot stay bound for reading while one of its faces is drawn.
+	InGraphics.BindDepthTest(Context, DepthTest::Less);
+	InGraphics.GetClusteredLighting().BindUnclustered(Context);
+	InGraphics.GetPointLightShadows().Bind(Context);
+	InGraphics.GetDirectionalLight().Bind(Context);
+	InGraphics.GetAmbientOcclusion().BindUnoccluded(Context);
+	InGraphics.GetImageBasedLighting().Bind(Context);
+	Cache.SetPixelConstantBuffer(ConstantSlot, CaptureConstantBuffer.Get());
+	Cache.SetPixelShaderResource(CubeSlot, nullptr);
+
+	// Black behind the geometry, the probes hold no sky.
+	auto* const FaceView = FaceViews[CaptureFace].Get();
+	constexpr float ClearColor[] = {0.0f, 0.0f, 0.0f, 1.0f};
+	Cache.SetRenderTarget(FaceView, DepthView.Get());
+	DeviceContext->ClearRenderTargetView(FaceView, ClearColor);
+	DeviceContext->ClearDepthStencilView(DepthView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+
+	const D3D11_VIEWPORT FaceViewport {0.0f, 0.0f, static_cast<float>(FaceSize), static_cast<float>(FaceSize), 0.0f, 1.0f};
+	DeviceContext->RSSetViewports(1u, &FaceViewport);
+	InGraphics.OverrideViewConstants(Context, DirectX::XMLoadFloat4x4(&Captured.FaceViews[CaptureFace % FaceNum]),
+	                                 DirectX::XMLoadFloat4x4(&Projection), Captured.Position);
+
+	const auto& Lighting = InGraphics.GetClusteredLighting();
+
+	for (const auto* const Capture : Captures)
+	{
+		DirectX::BoundingBox WorldBounds;
+
+		if (const auto* const LocalBounds = Capture->GetLocalBounds())
+		{
+			LocalBounds->Transform(WorldBounds, Capture->GetTransformMatrix());
+		}
+
+		Lighting.BindObjectLights(Context, Capture->GetLocalBounds() ? &WorldBounds : nullptr);
+		Capture->Draw(Context, DrawStage::Shaded);
+	}
+
+	RenderedDrawableNum = static_cast<unsigned int>(Captures.size());
+
+	InGraphics.RestoreViewConstants(Context);
+	InGraphics.BindFrameState(Context);
+
+	// The face is unbound as a target again, the whole probe's mips are built from it.
+	DeviceContext->GenerateMips(ProbeViews[ProbeIndex].Get());
+
+	// Surfaces only see the probe once every face holds the scene.
+	if (Captured.DrawnFaces != AllFaces)
+	{
+		Captured.DrawnFaces |= 1u << (CaptureFace % FaceNum);
+		bIsConstantBufferStale |= Captured.DrawnFaces == AllFaces;
+	}
+}
+
+void ReflectionProbes::Bind(RenderContext& InContext) const noexcept
+{
+	auto& Cache = InContext.GetStateCache();
+
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelShaderResource(CubeSlot, CubeView.Get());
+}
+
+void ReflectionProbes::BindCompute(ID3D11DeviceContext* InContext) const noexcept
+{
+	InContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	InContext->CSSetShaderResources(CubeSlot, 1u, CubeView.GetAddressOf());
+}
+
+unsigned int ReflectionProbes::GetStaleFaceNum() const noexcept
+{
+	unsigned int StaleFaceNum = 0u;
+
+	for (unsigned int ProbeIndex = 0u; ProbeIndex < ProbeNum; ++ProbeIndex)
+	{
+		for (UINT Face = 0u; Face < FaceNum; ++Face)
+		{
+			StaleFaceNum += (Probes[ProbeIndex].StaleFaces >> Face) & 1u;
+		}
+	}
+
+	return StaleFaceNum;
+}
+
+void ReflectionProbes::UploadConstants(const Graphics& InGraphics)
+{
+	ProbeConstants Constants {};
+	Constants.ProbeNum = ProbeNum;
+	Constants.FaceSize = static_cast<float>(FaceSize);
+	Constants.MipNum = static_cast<float>(MipNum);
+
+	for (unsigned int ProbeIndex = 0u; ProbeIndex < ProbeNum; ++ProbeIndex)
+	{
+		const auto& Placed = Probes[ProbeIndex];
+		Constants.Spheres[ProbeIndex] = {Placed.Position.x, Placed.Position.y, Placed.Position.z, Placed.DrawnFaces == AllFaces ? Placed.Radius : 0.0f};
+	}
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	bIsConstantBufferStale = false;
+}
@@ -0,0 +1,141 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include "wrl/client.h"
+
+class Drawable;
+class Graphics;
+class RenderContext;
+
+/**
+ * Local reflections from cubes captured around placed points, for the surfaces inside each probe's sphere.
+ * The scene is drawn into a probe's faces through the drawables' regular shaded path, one face per frame at most: faces
+ * that bounds reported as moved reach into go first, otherwise the faces are refreshed round-robin so lighting changes
+ * show up too. The cubes live in one cube array, their mips box filtered for the wider specular lobes.
+ * Each frame models report what moved and hand over what falls into the capture frustum, if a face is due.
+ */
+class ReflectionProbes
+{
+public:
+	static constexpr UINT MaxProbeNum {4u};
+	static constexpr UINT FaceNum {6u};
+	static constexpr UINT FaceSize {128u};
+	static constexpr UINT MipNum {8u};
+	static constexpr DXGI_FORMAT Format {DXGI_FORMAT_R16G16B16A16_FLOAT};
+	static constexpr float NearZ {0.1f};
+	// Geometry farther from the probe is left out of its faces.
+	static constexpr float FarZ {100.0f};
+
+	explicit ReflectionProbes(ID3D11Device* InDevice);
+	ReflectionProbes(const ReflectionProbes&) = delete;
+	ReflectionProbes(ReflectionProbes&&) = delete;
+	ReflectionProbes& operator=(const ReflectionProbes&) = delete;
+	ReflectionProbes& operator=(ReflectionProbes&&) = delete;
+	~ReflectionProbes() = default;
+
+	// Picks the face drawn this frame and writes the constants when a probe changed, before the frame's first bind.
+	void BeginFrame(const Graphics& InGraphics);
+
+	// Adds a probe reflecting onto the sphere, or once MaxProbeNum are placed moves the one placed longest ago there.
+	// Surfaces keep the environment's reflections until all of its faces are drawn.
+	unsigned int PlaceProbe(const DirectX::XMFLOAT3& InPosition, float InRadius);
+	// Draws all of the probe's faces again ahead of the round-robin, such as after the lights changed.
+	void Invalidate(unsigned int InProbe) noexcept;
+	// World space region whose drawables changed since last frame, covering both where they were and where they are.
+	void AddMovedBounds(const DirectX::BoundingBox& InBounds) noexcept;
+
+	// The world space frustum of the face drawn this frame, null when no face is due.
+	[[nodiscard]] const DirectX::BoundingFrustum* GetCaptureFrustum() const noexcept;
+	// The drawable is drawn into this frame's face, it should fall into the capture frustum.
+	void AddCapture(const Drawable& InDrawable);
+
+	// Draws this frame's face once the lights are culled, before anything samples the cubes.
+	void Render(const Graphics& InGraphics);
+	void Bind(RenderContext& InContext) const noexcept;
+	// The same slots for compute shaders that shade, straight to the context like every compute binding.
+	void BindCompute(ID3D11DeviceContext* InContext) const noexcept;
+
+	// Off only draws faces that moved bounds reach into, a static scene then costs nothing.
+	void EnableContinuousUpdate() noexcept
+	{
+		bIsContinuousUpdateEnabled = true;
+	}
+
+	void DisableContinuousUpdate() noexcept
+	{
+		bIsContinuousUpdateEnabled = false;
+	}
+
+	[[nodiscard]] bool IsContinuousUpdateEnabled() const noexcept
+	{
+		return bIsContinuousUpdateEnabled;
+	}
+
+	[[nodiscard]] unsigned int GetProbeNum() const noexcept
+	{
+		return ProbeNum;
+	}
+
+	// Faces still waiting to be drawn again across all probes.
+	[[nodiscard]] unsigned int GetStaleFaceNum() const noexcept;
+
+	// Drawables drawn into the face by the last Render, zero when it drew none.
+	[[nodiscard]] unsigned int GetRenderedDrawableNum() const noexcept
+	{
+		return RenderedDrawableNum;
+	}
+
+private:
+	static constexpr unsigned int AllFaces {(1u << FaceNum) - 1u};
+	static constexpr unsigned int NoFace {~0u};
+	// Registers in ReflectionProbes.hlsli, after the environment's.
+	static constexpr UINT ConstantSlot {5u};
+	static constexpr UINT CubeSlot {14u};
+
+	struct ProbeConstants
+	{
+		// The centre and radius of each probe's sphere, radius zero for probes whose faces are not all drawn yet.
+		std::array<DirectX::XMFLOAT4, MaxProbeNum> Spheres;
+		UINT ProbeNum;
+		float FaceSize;
+		float MipNum;
+		float Padding;
+	};
+
+	struct Probe
+	{
+		DirectX::XMFLOAT3 Position {};
+		float Radius {0.0f};
+		std::array<DirectX::XMFLOAT4X4, FaceNum> FaceViews {};
+		std::array<DirectX::BoundingFrustum, FaceNum> FaceFrustums;
+		// One bit per face that no longer matches the scene, and per face drawn since the probe was placed.
+		unsigned int StaleFaces {AllFaces};
+		unsigned int DrawnFaces {0u};
+	};
+
+	void UploadConstants(const Graphics& InGraphics);
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	// No probes, bound while a face is drawn so nothing samples the cube array being written.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CaptureConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CubeView;
+	// Each probe's cube alone, for building its mips.
+	std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, MaxProbeNum> ProbeViews;
+	std::array<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>, MaxProbeNum * FaceNum> FaceViews;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthView;
+
+	std::array<Probe, MaxProbeNum> Probes;
+	DirectX::XMFLOAT4X4 Projection {};
+	std::vector<const Drawable*> Captures;
+	unsigned int ProbeNum {0u};
+	unsigned int NextReplacedProbe {0u};
+	// Probe times FaceNum plus face, the round-robin continues after whichever face was drawn last.
+	unsigned int CaptureFace {NoFace};
+	unsigned int NextFace {0u};
+	unsigned int RenderedDrawableNum {0u};
+	bool bIsContinuousUpdateEnabled {true};
+	bool bIsConstantBufferStale {true};
+};
@@ -0,0 +1,54 @@
+// Local reflections from ReflectionProbes' cubes, laid out like ReflectionProbes::ProbeConstants.
+// Sampled with the environment's sampler, so ImageBasedLighting.hlsli comes first.
+cbuffer ReflectionProbes : register(b5)
+{
+    // xyz the probe's position, w the radius of the sphere it covers and reflects onto, zero while it is being drawn.
+    float4 ProbeSpheres[4];
+    uint ProbeNum;
+    float ProbeFaceSize;
+    float ProbeMipNum;
+    float ProbePadding;
+}
+
+TextureCubeArray<float3> ProbeCubes : register(t14);
+
+// The outer part of a probe's sphere over which its reflection gives way to what is reflected outside it.
+static const float ProbeFadeFraction = 0.2f;
+
+// The nearest probe around InWorldPosition reflects along a Phong lobe of InSpecularPower in place of InFallback.
+float3 CalcProbeReflection(const float3 InWorldPosition, const float3 InReflected, const float InSpecularPower, const float3 InFallback)
+{
+    uint Nearest = ProbeNum;
+    float NearestDistance = 0.0f;
+
+    for (uint Probe = 0u; Probe < ProbeNum; ++Probe)
+    {
+        const float Distance = distance(InWorldPosition, ProbeSpheres[Probe].xyz);
+
+        if (Distance < ProbeSpheres[Probe].w && (Nearest == ProbeNum || Distance < NearestDistance))
+        {
+            Nearest = Probe;
+            NearestDistance = Distance;
+        }
+    }
+
+    if (Nearest == ProbeNum)
+    {
+        return InFallback;
+    }
+
+    // Looked up towards where the reflected ray leaves the sphere rather than along the ray from the probe's centre,
+    // so what the probe saw nearby lines up with the surface.
+    const float4 Sphere = ProbeSpheres[Nearest];
+    const float3 Offset = InWorldPosition - Sphere.xyz;
+    const float B = dot(Offset, InReflected);
+    const float C = dot(Offset, Offset) - Sphere.w * Sphere.w;
+    const float3 Direction = Offset + (sqrt(max(B * B - C, 0.0f)) - B) * InReflected;
+
+    // The mips are box filtered, the one whose texels are as wide as the lobe stands in for it.
+    const float LobeWidth = sqrt(2.0f / (max(InSpecularPower, 1.0f) + 2.0f));
+    const float Mip = clamp(log2(LobeWidth * ProbeFaceSize * 2.0f / 3.14159265f), 0.0f, ProbeMipNum - 1.0f);
+    const float3 Reflection = ProbeCubes.SampleLevel(EnvironmentSampler, float4(Direction, Nearest), Mip);
+
+    return lerp(InFallback, Reflection, saturate((Sphere.w - NearestDistance) / (ProbeFadeFraction * Sphere.w)));
+}
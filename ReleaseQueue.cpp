@@ -0,0 +1,93 @@
+﻿#include "ReleaseQueue.h"
+#include <cassert>
+#include <utility>
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+
+ReleaseQueue::ReleaseQueue(ID3D11Device* InDevice, ID3D11DeviceContext* InContext)
+	: Device(InDevice), Context(InContext)
+{
+	assert(!Instance && "Only one ReleaseQueue may exist");
+	Instance = this;
+}
+
+ReleaseQueue::~ReleaseQueue()
+{
+	// What is released here can retire more of its own, that goes at once from now on.
+	Instance = nullptr;
+
+	std::vector<std::shared_ptr<void>> Remaining;
+	{
+		std::lock_guard Lock(Mutex);
+		Remaining.swap(Retired);
+	}
+
+	Remaining.clear();
+	Batches.clear();
+}
+
+void ReleaseQueue::Retire(std::shared_ptr<void> InHeld)
+{
+	if (!InHeld || !Instance)
+	{
+		return;
+	}
+
+	std::lock_guard Lock(Instance->Mutex);
+	Instance->Retired.push_back(std::move(InHeld));
+}
+
+void ReleaseQueue::EndFrame()
+{
+	PROFILE_SCOPE("ReleaseQueue::EndFrame");
+
+	std::vector<std::shared_ptr<void>> Held;
+	{
+		std::lock_guard Lock(Mutex);
+		Held.swap(Retired);
+	}
+
+	if (!Held.empty())
+	{
+		HRESULT ResultHandle;
+
+		Microsoft::WRL::ComPtr<ID3D11Query> Fence;
+
+		if (FreeFences.empty())
+		{
+			D3D11_QUERY_DESC FenceDesc {};
+			FenceDesc.Query = D3D11_QUERY_EVENT;
+			CHECK_HRESULT_EXCEPTION(Device->CreateQuery(&FenceDesc, &Fence))
+		}
+		else
+		{
+			Fence = std::move(FreeFences.back());
+			FreeFences.pop_back();
+		}
+
+		Context->End(Fence.Get());
+		Batches.push_back({FrameIndex, std::move(Fence), std::move(Held)});
+	}
+
+	++FrameIndex;
+	LastStatistics.ReleasedNum = 0u;
+
+	// Frames finish in order, once one hasn't the ones after it haven't either. Polled without flushing, the present does that.
+	while (!Batches.empty() && FrameIndex - Batches.front().Frame > MinimumFrameNum &&
+	       Context->GetData(Batches.front().Fence.Get(), nullptr, 0u, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+	{
+		// Taken out first, destroying what it holds may retire more.
+		auto Finished = std::move(Batches.front());
+		Batches.pop_front();
+
+		LastStatistics.ReleasedNum += static_cast<unsigned int>(Finished.Held.size());
+		Finished.Held.clear();
+		FreeFences.push_back(std::move(Finished.Fence));
+	}
+
+	LastStatistics.PendingNum = 0u;
+	for (const auto& Pending : Batches)
+	{
+		LastStatistics.PendingNum += static_cast<unsigned int>(Pending.Held.size());
+	}
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "wrl/client.h"
+
+/**
+ * Keeps what the GPU may still be using alive until it has finished the frames that could use it, so content dropped
+ * mid-frame neither makes the driver wait on a resource in flight nor leaves recorded packets pointing at released views.
+ * What is retired during a frame is released together once MinimumFrameNum more frames have ended and the event query
+ * issued at the end of its own frame has signalled.
+ * Owned by Graphics, everything else reaches it through Retire.
+ */
+class ReleaseQueue
+{
+public:
+	struct Statistics
+	{
+		unsigned int PendingNum {0u};
+		// In the last EndFrame.
+		unsigned int ReleasedNum {0u};
+	};
+
+	static constexpr unsigned long long MinimumFrameNum {2u};
+
+	ReleaseQueue(ID3D11Device* InDevice, ID3D11DeviceContext* InContext);
+	ReleaseQueue(const ReleaseQueue&) = delete;
+	ReleaseQueue(ReleaseQueue&&) = delete;
+	ReleaseQueue& operator=(const ReleaseQueue&) = delete;
+	ReleaseQueue& operator=(ReleaseQueue&&) = delete;
+	// Releases everything still held, Graphics only goes once the GPU is idle.
+	~ReleaseQueue();
+
+	// Any thread. Released right away when there is no queue, before Graphics exists or after it is gone.
+	static void Retire(std::shared_ptr<void> InHeld);
+
+	template<typename T>
+	static void Retire(Microsoft::WRL::ComPtr<T> InResource)
+	{
+		if (InResource)
+		{
+			Retire(std::shared_ptr<void>(InResource.Detach(), [](void* InDetached) { static_cast<T*>(InDetached)->Release(); }));
+		}
+	}
+
+	// Main thread, after the frame's last command is recorded and before it is presented.
+	void EndFrame();
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+private:
+	struct Batch
+	{
+		unsigned long long Frame;
+		Microsoft::WRL::ComPtr<ID3D11Query> Fence;
+		std::vector<std::shared_ptr<void>> Held;
+	};
+
+private:
+	static inline ReleaseQueue* Instance {nullptr};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> Device;
+	ID3D11DeviceContext* Context;
+
+	std::mutex Mutex;
+	// This frame's, not fenced yet.
+	std::vector<std::shared_ptr<void>> Retired;
+	// Oldest first.
+	std::deque<Batch> Batches;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> FreeFences;
+	unsigned long long FrameIndex {0u};
+
+	Statistics LastStatistics {};
+};
@@ -0,0 +1,128 @@
+﻿#include "RenderContext.h"
+#include "ExceptionMacros.h"
+#include "Graphics.h"
+
+RenderContext::EventScope::EventScope(const RenderContext& InContext, const std::wstring& InName) noexcept
+{
+	// Checked per scope, a tool can attach mid-session.
+	if (!InName.empty() && InContext.Annotation && InContext.Annotation->GetStatus())
+	{
+		Annotation = InContext.Annotation.Get();
+		Annotation->BeginEvent(InName.c_str());
+	}
+}
+
+RenderContext::EventScope::~EventScope()
+{
+	if (Annotation)
+	{
+		Annotation->EndEvent();
+	}
+}
+
+RenderContext::RenderContext(const Graphics& InGraphics, Microsoft::WRL::ComPtr<ID3D11DeviceContext> InContext,
+                             Microsoft::WRL::ComPtr<ID3D11DeviceContext1> InContext1, std::unique_ptr<ConstantBufferRing> InConstantBufferRing)
+	: MyGraphics(InGraphics)
+	, Context(std::move(InContext))
+	, Context1(std::move(InContext1))
+	, MyStateCache(Context.Get(), Context1.Get())
+	, MyConstantBufferRing(std::move(InConstantBufferRing))
+{
+#if PROFILE_MARKERS_ENABLED
+	Context.As(&Annotation);
+#endif
+}
+
+RenderContext::~RenderContext() = default;
+
+void RenderContext::Draw(const UINT InVertexCount, const UINT InStartVertex)
+{
+	if (MyStateCache.IsRecording())
+	{
+		MyStateCache.Record(CommandTrace::Op::Draw, {InVertexCount, InStartVertex});
+	}
+
+	MyStateCache.CountDraw();
+	CHECK_DRAW_INFO_EXCEPTION(Context->Draw(InVertexCount, InStartVertex))
+}
+
+void RenderContext::DrawIndexed(const UINT InCount, const UINT InStartIndex, const INT InBaseVertex)
+{
+	if (InstanceRepeat > 1u)
+	{
+		DrawIndexedInstanced(InCount, 1u, InStartIndex, InBaseVertex);
+		return;
+	}
+
+	if (MyStateCache.IsRecording())
+	{
+		MyStateCache.Record(CommandTrace::Op::DrawIndexed, {InCount, InStartIndex, static_cast<UINT>(InBaseVertex)});
+	}
+
+	MyStateCache.CountDraw(InCount);
+	CHECK_DRAW_INFO_EXCEPTION(Context->DrawIndexed(InCount, InStartIndex, InBaseVertex))
+}
+
+void RenderContext::DrawIndexedInstanced(const UINT InIndexCount, const UINT InInstanceCount, const UINT InStartIndex, const INT InBaseVertex)
+{
+	const auto InstanceCount = InInstanceCount * InstanceRepeat;
+
+	if (MyStateCache.IsRecording())
+	{
+		MyStateCache.Record(CommandTrace::Op::DrawIndexedInstanced, {InIndexCount, InstanceCount, InStartIndex, static_cast<UINT>(InBaseVertex)});
+	}
+
+	MyStateCache.CountDraw(InIndexCount, InstanceCount);
+	CHECK_DRAW_INFO_EXCEPTION(Context->DrawIndexedInstanced(InIndexCount, InstanceCount, InStartIndex, InBaseVertex, 0u))
+}
+
+void RenderContext::DrawIndexedInstancedIndirect(ID3D11Buffer* InArguments, const UINT InArgumentsOffset)
+{
+	if (MyStateCache.IsRecording())
+	{
+		MyStateCache.Record(CommandTrace::Op::DrawIndexedInstancedIndirect, {MyStateCache.GetTraceId(InArguments), InArgumentsOffset});
+	}
+
+	MyStateCache.CountDraw();
+	CHECK_DRAW_INFO_EXCEPTION(Context->DrawIndexedInstancedIndirect(InArguments, InArgumentsOffset))
+}
+
+void RenderContext::DrawInstancedIndirect(ID3D11Buffer* InArguments, const UINT InArgumentsOffset)
+{
+	if (MyStateCache.IsRecording())
+	{
+		MyStateCache.Record(CommandTrace::Op::DrawInstancedIndirect, {MyStateCache.GetTraceId(InArguments), InArgumentsOffset});
+	}
+
+	MyStateCache.CountDraw();
+	CHECK_DRAW_INFO_EXCEPTION(Context->DrawInstancedIndirect(InArguments, InArgumentsOffset))
+}
+
+void RenderContext::BeginRecording()
+{
+	MyStateCache.Reset();
+
+	// The first map of a dynamic buffer in a command list has to discard.
+	if (MyConstantBufferRing)
+	{
+		MyConstantBufferRing->BeginFrame();
+	}
+
+	MyGraphics.BindFrameState(*this);
+}
+
+Microsoft::WRL::ComPtr<ID3D11CommandList> RenderContext::FinishRecording()
+{
+	HRESULT ResultHandle;
+	Microsoft::WRL::ComPtr<ID3D11CommandList> CommandList;
+
+	CHECK_HRESULT_EXCEPTION(Context->FinishCommandList(FALSE, &CommandList))
+
+	// Spliced into the immediate context's words where the list is executed.
+	if (MyStateCache.IsRecording())
+	{
+		MyGraphics.GetCommandRecorder().AddCommandList(CommandList.Get(), MyStateCache.TakeRecorded());
+	}
+
+	return CommandList;
+}
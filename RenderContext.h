@@ -0,0 +1,121 @@
+﻿#pragma once
+#include <d3d11_1.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <string>
+#include "wrl/client.h"
+#include "ConstantBufferRing.h"
+#include "FrameProfiler.h"
+#include "StateCache.h"
+
+class DebugViews;
+class Graphics;
+
+/**
+ * A device context together with the state that has to be tracked per context when recording commands.
+ * Graphics owns one for the immediate context and one per recording worker for deferred contexts.
+ * https://learn.microsoft.com/en-us/windows/win32/direct3d11/overviews-direct3d-11-render-multi-thread-render
+ */
+class RenderContext
+{
+public:
+	// Names the draws of its lifetime in PIX and RenderDoc captures, on deferred contexts inside the command list.
+	// Does nothing for an empty name, without a capture tool attached or in shipping builds.
+	class EventScope
+	{
+	public:
+		EventScope(const RenderContext& InContext, const std::wstring& InName) noexcept;
+		EventScope(const EventScope&) = delete;
+		EventScope(EventScope&&) = delete;
+		EventScope& operator=(const EventScope&) = delete;
+		EventScope& operator=(EventScope&&) = delete;
+		~EventScope();
+
+	private:
+		ID3DUserDefinedAnnotation* Annotation {nullptr};
+	};
+
+	RenderContext(const Graphics& InGraphics, Microsoft::WRL::ComPtr<ID3D11DeviceContext> InContext,
+	              Microsoft::WRL::ComPtr<ID3D11DeviceContext1> InContext1, std::unique_ptr<ConstantBufferRing> InConstantBufferRing);
+	RenderContext(const RenderContext&) = delete;
+	RenderContext(RenderContext&&) = delete;
+	RenderContext& operator=(const RenderContext&) = delete;
+	RenderContext& operator=(RenderContext&&) = delete;
+	~RenderContext();
+
+	// Lines and points, counted as draws without triangles.
+	void Draw(UINT InVertexCount, UINT InStartVertex = 0u);
+	void DrawIndexed(UINT InCount, UINT InStartIndex = 0u, INT InBaseVertex = 0);
+	void DrawIndexedInstanced(UINT InIndexCount, UINT InInstanceCount, UINT InStartIndex = 0u, INT InBaseVertex = 0);
+	void DrawIndexedInstancedIndirect(ID3D11Buffer* InArguments, UINT InArgumentsOffset);
+	// Without an index buffer, such as vertices the vertex shader generates from their IDs.
+	void DrawInstancedIndirect(ID3D11Buffer* InArguments, UINT InArgumentsOffset);
+
+	// Every indexed draw after is instanced this many times over, one copy per eye of the instanced stereo pass, which the vertex
+	// shaders tell apart by their instance IDs. Indirect draws take their counts from the GPU and can't be repeated.
+	void SetInstanceRepeat(const UINT InRepeat) noexcept
+	{
+		InstanceRepeat = InRepeat;
+	}
+
+	// Deferred contexts start every command list from default state, so the tracked state is cleared alongside.
+	void BeginRecording();
+	[[nodiscard]] Microsoft::WRL::ComPtr<ID3D11CommandList> FinishRecording();
+
+	[[nodiscard]] const Graphics& GetGraphics() const noexcept
+	{
+		return MyGraphics;
+	}
+
+	[[nodiscard]] ID3D11DeviceContext* GetDeviceContext() const noexcept
+	{
+		return Context.Get();
+	}
+
+	[[nodiscard]] StateCache& GetStateCache() noexcept
+	{
+		return MyStateCache;
+	}
+
+	// Null where the device can't bind constant ranges or the ring is disabled, per-draw constants are then mapped into
+	// buffers of their own.
+	[[nodiscard]] ConstantBufferRing* GetConstantBufferRing() const noexcept
+	{
+		return bIsConstantBufferRingEnabled ? MyConstantBufferRing.get() : nullptr;
+	}
+
+	// While nothing records on the context, the ring's range bindings and the fallback's buffers both stay valid either way.
+	void SetConstantBufferRingEnabled(const bool bInIsEnabled) noexcept
+	{
+		bIsConstantBufferRingEnabled = bInIsEnabled;
+	}
+
+	[[nodiscard]] bool IsDeferred() const noexcept
+	{
+		return Context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED;
+	}
+
+	// Draw packets applied while set bind the view's pixel shader in place of their own, null for their own.
+	void SetDebugViews(const DebugViews* InViews) noexcept
+	{
+		SubstitutingViews = InViews;
+	}
+
+	[[nodiscard]] const DebugViews* GetDebugViews() const noexcept
+	{
+		return SubstitutingViews;
+	}
+
+private:
+	const Graphics& MyGraphics;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> Context;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> Context1;
+	StateCache MyStateCache;
+	std::unique_ptr<ConstantBufferRing> MyConstantBufferRing;
+	// Null in shipping builds.
+	Microsoft::WRL::ComPtr<ID3DUserDefinedAnnotation> Annotation;
+	UINT InstanceRepeat {1u};
+	bool bIsConstantBufferRingEnabled {true};
+	// Set by the render queue around the draws the current debug view replaces.
+	const DebugViews* SubstitutingViews {nullptr};
+};
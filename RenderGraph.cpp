@@ -0,0 +1,458 @@
+﻿#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "ReleaseQueue.h"
+
+namespace
+{
+	constexpr size_t NoIndex {~size_t{0u}};
+
+	size_t GetBytesPerPixel(const DXGI_FORMAT InFormat) noexcept
+	{
+		switch (InFormat)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return 16u;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R32G32_FLOAT:
+			return 8u;
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R16G16_UNORM:
+		case DXGI_FORMAT_R32_FLOAT:
+		case DXGI_FORMAT_R32_UINT:
+		case DXGI_FORMAT_D32_FLOAT:
+			return 4u;
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_R16_UNORM:
+			return 2u;
+		case DXGI_FORMAT_R8_UNORM:
+			return 1u;
+		default:
+			assert(false && "Transient texture format missing from GetBytesPerPixel");
+			return 4u;
+		}
+	}
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(const Handle InResource)
+{
+	assert(InResource < Graph.Resources.size() && "Unknown render graph resource");
+
+	Graph.Passes[PassIndex].Accesses.push_back({InResource, Graph.Resources[InResource].Version, false});
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(const Handle InResource)
+{
+	assert(InResource < Graph.Resources.size() && "Unknown render graph resource");
+
+	Graph.Passes[PassIndex].Accesses.push_back({InResource, ++Graph.Resources[InResource].Version, true});
+	return *this;
+}
+
+RenderGraph::RenderGraph(ID3D11Device* InDevice)
+	: Device(InDevice)
+{
+}
+
+RenderGraph::Handle RenderGraph::Import(const char* InName)
+{
+	for (Handle Index = 0u; Index < Resources.size(); ++Index)
+	{
+		if (Resources[Index].Type == ResourceType::Imported && std::strcmp(Resources[Index].Name, InName) == 0)
+		{
+			return Index;
+		}
+	}
+
+	return AddResource(InName, ResourceType::Imported, {});
+}
+
+RenderGraph::Handle RenderGraph::Create(const char* InName)
+{
+	return AddResource(InName, ResourceType::Virtual, {});
+}
+
+RenderGraph::Handle RenderGraph::CreateTexture(const char* InName, const TextureDesc& InDesc)
+{
+	assert(InDesc.Width && InDesc.Height && InDesc.BindFlags && "Empty transient texture");
+	return AddResource(InName, ResourceType::Texture, InDesc);
+}
+
+RenderGraph::Handle RenderGraph::AddResource(const char* InName, const ResourceType InType, const TextureDesc& InDesc)
+{
+	Resources.push_back({InName, InType, InDesc});
+	return static_cast<Handle>(Resources.size() - 1u);
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* InName, ExecuteFunction InExecute)
+{
+	Passes.push_back({InName, std::move(InExecute), {}});
+	return {*this, Passes.size() - 1u};
+}
+
+void RenderGraph::Execute()
+{
+	PROFILE_SCOPE("RenderGraph::Execute");
+
+	Cull();
+	const auto Order = Schedule();
+
+	LastStatistics = {};
+	LastStatistics.PassNum = static_cast<unsigned int>(Order.size());
+	LastStatistics.CulledPassNum = static_cast<unsigned int>(Passes.size() - Order.size());
+	LastSchedule.clear();
+
+	for (size_t Position = 0u; Position < Order.size(); ++Position)
+	{
+		for (const auto& [ResourceIndex, Version, bIsWrite] : Passes[Order[Position]].Accesses)
+		{
+			auto& Used = Resources[ResourceIndex];
+			Used.FirstUse = std::min(Used.FirstUse, Position);
+			Used.LastUse = std::max(Used.LastUse, Position);
+		}
+	}
+
+	for (size_t Position = 0u; Position < Order.size(); ++Position)
+	{
+		const auto& Running = Passes[Order[Position]];
+
+		// A transient takes its texture right before its first pass, while those whose last pass ended have given theirs back.
+		for (const auto& Used : Running.Accesses)
+		{
+			if (auto& Transient = Resources[Used.Resource]; Transient.Type == ResourceType::Texture && Transient.PooledIndex == NoIndex)
+			{
+				const auto PooledIndex = Acquire(Transient.Desc);
+				Transient.PooledIndex = PooledIndex;
+
+				++LastStatistics.TransientNum;
+				LastStatistics.TransientBytes += Pool[PooledIndex].ByteSize;
+			}
+		}
+
+		RunningPass = &Running;
+		Running.Execute(*this);
+		RunningPass = nullptr;
+		LastSchedule.push_back(Running.Name);
+
+		for (const auto& Used : Running.Accesses)
+		{
+			const auto& Transient = Resources[Used.Resource];
+
+			if (Transient.Type == ResourceType::Texture && Transient.LastUse == Position)
+			{
+				Pool[Transient.PooledIndex].bIsInUse = false;
+			}
+		}
+	}
+
+	for (const auto& Pooled : Pool)
+	{
+		if (Pooled.LastUsedFrame == FrameIndex)
+		{
+			++LastStatistics.TextureNum;
+			LastStatistics.AliasedBytes += Pooled.ByteSize;
+		}
+	}
+
+	Passes.clear();
+	Resources.clear();
+	++FrameIndex;
+
+	TrimPool();
+}
+
+void RenderGraph::Cull()
+{
+	// Which versions of each resource a kept pass reads, filled from the last pass back to the first.
+	std::vector<std::vector<bool>> NeededVersions(Resources.size());
+
+	for (Handle Index = 0u; Index < Resources.size(); ++Index)
+	{
+		NeededVersions[Index].resize(Resources[Index].Version + 1u, false);
+	}
+
+	for (auto Pass = Passes.rbegin(); Pass != Passes.rend(); ++Pass)
+	{
+		Pass->bIsKept = std::any_of(Pass->Accesses.begin(), Pass->Accesses.end(), [this, &NeededVersions](const Access& InAccess)
+		{
+			return InAccess.bIsWrite && (Resources[InAccess.Resource].Type == ResourceType::Imported || NeededVersions[InAccess.Resource][InAccess.Version]);
+		});
+
+		if (!Pass->bIsKept)
+		{
+			continue;
+		}
+
+		for (const auto& [ResourceIndex, Version, bIsWrite] : Pass->Accesses)
+		{
+			assert((bIsWrite || Version || Resources[ResourceIndex].Type == ResourceType::Imported) && "Render graph resource read before anything wrote it");
+
+			if (!bIsWrite)
+			{
+				NeededVersions[ResourceIndex][Version] = true;
+			}
+		}
+	}
+}
+
+std::vector<size_t> RenderGraph::Schedule() const
+{
+	std::vector<std::vector<size_t>> Successors(Passes.size());
+	std::vector<size_t> PredecessorNums(Passes.size(), 0u);
+
+	const auto AddEdge = [&Successors, &PredecessorNums](const size_t InFrom, const size_t InTo)
+	{
+		if (InFrom != InTo && std::find(Successors[InFrom].begin(), Successors[InFrom].end(), InTo) == Successors[InFrom].end())
+		{
+			Successors[InFrom].push_back(InTo);
+			++PredecessorNums[InTo];
+		}
+	};
+
+	// Accesses of kept passes per resource in the order they were declared, each depends on the last write and a write
+	// also on the reads since.
+	std::vector<size_t> LastWriters(Resources.size(), NoIndex);
+	std::vector<std::vector<size_t>> Readers(Resources.size());
+
+	for (size_t PassIndex = 0u; PassIndex < Passes.size(); ++PassIndex)
+	{
+		if (!Passes[PassIndex].bIsKept)
+		{
+			continue;
+		}
+
+		for (const auto& [ResourceIndex, Version, bIsWrite] : Passes[PassIndex].Accesses)
+		{
+			if (LastWriters[ResourceIndex] != NoIndex)
+			{
+				AddEdge(LastWriters[ResourceIndex], PassIndex);
+			}
+
+			if (!bIsWrite)
+			{
+				Readers[ResourceIndex].push_back(PassIndex);
+				continue;
+			}
+
+			for (const auto Reader : Readers[ResourceIndex])
+			{
+				AddEdge(Reader, PassIndex);
+			}
+
+			Readers[ResourceIndex].clear();
+			LastWriters[ResourceIndex] = PassIndex;
+		}
+	}
+
+	std::vector<size_t> Ready;
+	std::vector<size_t> Order;
+	std::vector<bool> Touched(Resources.size(), false);
+
+	for (size_t PassIndex = 0u; PassIndex < Passes.size(); ++PassIndex)
+	{
+		if (Passes[PassIndex].bIsKept && PredecessorNums[PassIndex] == 0u)
+		{
+			Ready.push_back(PassIndex);
+		}
+	}
+
+	while (!Ready.empty())
+	{
+		// Passes continuing a transient another pass already took go first, so lifetimes stay short and more of them
+		// can share a texture. Otherwise the order they were added in.
+		const auto ContinuesTransient = [this, &Touched](const size_t InPassIndex)
+		{
+			return std::any_of(Passes[InPassIndex].Accesses.begin(), Passes[InPassIndex].Accesses.end(), [this, &Touched](const Access& InAccess)
+			{
+				return Resources[InAccess.Resource].Type == ResourceType::Texture && Touched[InAccess.Resource];
+			});
+		};
+
+		auto Next = std::find_if(Ready.begin(), Ready.end(), ContinuesTransient);
+		if (Next == Ready.end())
+		{
+			Next = std::min_element(Ready.begin(), Ready.end());
+		}
+
+		const auto PassIndex = *Next;
+		Ready.erase(Next);
+		Order.push_back(PassIndex);
+
+		for (const auto& Used : Passes[PassIndex].Accesses)
+		{
+			Touched[Used.Resource] = true;
+		}
+
+		for (const auto Successor : Successors[PassIndex])
+		{
+			if (--PredecessorNums[Successor] == 0u)
+			{
+				Ready.push_back(Successor);
+			}
+		}
+	}
+
+	return Order;
+}
+
+size_t RenderGraph::Acquire(const TextureDesc& InDesc)
+{
+	auto Found = std::find_if(Pool.begin(), Pool.end(), [&InDesc](const PooledTexture& InPooled)
+	{
+		return !InPooled.bIsInUse && InPooled.Desc == InDesc;
+	});
+
+	if (Found == Pool.end())
+	{
+		auto& Created = Pool.emplace_back();
+		Created.Desc = InDesc;
+		CreatePooledTexture(Created);
+		Found = Pool.end() - 1;
+	}
+
+	Found->bIsInUse = true;
+	Found->LastUsedFrame = FrameIndex;
+	return static_cast<size_t>(Found - Pool.begin());
+}
+
+void RenderGraph::CreatePooledTexture(PooledTexture& OutPooled) const
+{
+	HRESULT ResultHandle;
+
+	const auto& Desc = OutPooled.Desc;
+	const bool bIsDepth = (Desc.BindFlags & D3D11_BIND_DEPTH_STENCIL) != 0u;
+	assert((!bIsDepth || Desc.Format == DXGI_FORMAT_D32_FLOAT) && "Transient depth textures are D32_FLOAT");
+
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = Desc.Width;
+	TextureDesc.Height = Desc.Height;
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = bIsDepth ? DXGI_FORMAT_R32_TYPELESS : Desc.Format;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.SampleDesc.Quality = 0u;
+	TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	TextureDesc.BindFlags = Desc.BindFlags;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&TextureDesc, nullptr, &OutPooled.Texture))
+
+	if (Desc.BindFlags & D3D11_BIND_SHADER_RESOURCE)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC ShaderResourceViewDesc {};
+		ShaderResourceViewDesc.Format = bIsDepth ? DXGI_FORMAT_R32_FLOAT : Desc.Format;
+		ShaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		ShaderResourceViewDesc.Texture2D.MipLevels = 1u;
+		CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(OutPooled.Texture.Get(), &ShaderResourceViewDesc, &OutPooled.ShaderResourceView))
+	}
+
+	if (Desc.BindFlags & D3D11_BIND_RENDER_TARGET)
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView(OutPooled.Texture.Get(), nullptr, &OutPooled.RenderTargetView))
+	}
+
+	if (Desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS)
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateUnorderedAccessView(OutPooled.Texture.Get(), nullptr, &OutPooled.UnorderedAccessView))
+	}
+
+	if (bIsDepth)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC DepthStencilViewDesc {};
+		DepthStencilViewDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		DepthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+		DepthStencilViewDesc.Texture2D.MipSlice = 0u;
+		CHECK_HRESULT_EXCEPTION(Device->CreateDepthStencilView(OutPooled.Texture.Get(), &DepthStencilViewDesc, &OutPooled.DepthStencilView))
+	}
+
+	OutPooled.ByteSize = static_cast<size_t>(Desc.Width) * Desc.Height * GetBytesPerPixel(Desc.Format);
+}
+
+void RenderGraph::TrimPool()
+{
+	// Such as the sizes of a resolution dynamic resolution has moved away from.
+	const auto Stale = std::remove_if(Pool.begin(), Pool.end(), [this](PooledTexture& InPooled)
+	{
+		if (FrameIndex - InPooled.LastUsedFrame <= UnusedFrameNum)
+		{
+			return false;
+		}
+
+		Retire(InPooled);
+		return true;
+	});
+
+	Pool.erase(Stale, Pool.end());
+
+	for (const auto& Pooled : Pool)
+	{
+		++LastStatistics.PooledNum;
+		LastStatistics.PooledBytes += Pooled.ByteSize;
+	}
+}
+
+void RenderGraph::ReleasePool()
+{
+	for (auto& Pooled : Pool)
+	{
+		Retire(Pooled);
+	}
+
+	Pool.clear();
+}
+
+void RenderGraph::Retire(PooledTexture& InOutPooled)
+{
+	ReleaseQueue::Retire(std::move(InOutPooled.ShaderResourceView));
+	ReleaseQueue::Retire(std::move(InOutPooled.RenderTargetView));
+	ReleaseQueue::Retire(std::move(InOutPooled.UnorderedAccessView));
+	ReleaseQueue::Retire(std::move(InOutPooled.DepthStencilView));
+	ReleaseQueue::Retire(std::move(InOutPooled.Texture));
+}
+
+const RenderGraph::PooledTexture* RenderGraph::FindPooled(const Handle InResource) const noexcept
+{
+	assert(RunningPass && InResource < Resources.size() && Resources[InResource].Type == ResourceType::Texture && "Not a transient of the running pass");
+	assert(std::any_of(RunningPass->Accesses.begin(), RunningPass->Accesses.end(), [InResource](const Access& InAccess)
+	{
+		return InAccess.Resource == InResource;
+	}) && "Transient the running pass didn't declare");
+
+	return &Pool[Resources[InResource].PooledIndex];
+}
+
+ID3D11Texture2D* RenderGraph::GetTexture(const Handle InResource) const noexcept
+{
+	return FindPooled(InResource)->Texture.Get();
+}
+
+ID3D11ShaderResourceView* RenderGraph::GetShaderResourceView(const Handle InResource) const noexcept
+{
+	return FindPooled(InResource)->ShaderResourceView.Get();
+}
+
+ID3D11RenderTargetView* RenderGraph::GetRenderTargetView(const Handle InResource) const noexcept
+{
+	return FindPooled(InResource)->RenderTargetView.Get();
+}
+
+ID3D11UnorderedAccessView* RenderGraph::GetUnorderedAccessView(const Handle InResource) const noexcept
+{
+	return FindPooled(InResource)->UnorderedAccessView.Get();
+}
+
+ID3D11DepthStencilView* RenderGraph::GetDepthStencilView(const Handle InResource) const noexcept
+{
+	return FindPooled(InResource)->DepthStencilView.Get();
+}
@@ -0,0 +1,189 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <cstdint>
+#include <d3d11.h>
+#include <functional>
+#include <vector>
+#include "wrl/client.h"
+
+/**
+ * Orders the GPU work of a frame from what each pass declares it reads and writes, instead of the order it is called in.
+ * Passes are added every frame and run together by Execute, which first drops those whose results nothing kept reads,
+ * then schedules the rest so every pass still sees its inputs in the order they were declared.
+ * Resources are imported when something else owns them and they outlive the frame, such as the scene target, and
+ * writing one keeps its pass. Transient textures only live from their first use to their last, and are taken from a
+ * pool of textures that transients of the same description share whenever their lifetimes don't overlap.
+ * A pass leaves no transient bound when it ends, the next may be handed the same texture under another name.
+ */
+class RenderGraph
+{
+public:
+	using Handle = uint32_t;
+
+	struct Statistics
+	{
+		unsigned int PassNum {0u};
+		unsigned int CulledPassNum {0u};
+		unsigned int TransientNum {0u};
+		// Pool textures the transients were placed in, and their bytes against what a texture per transient would take.
+		unsigned int TextureNum {0u};
+		size_t AliasedBytes {0u};
+		size_t TransientBytes {0u};
+		// Textures the pool holds in total, including those unused this frame.
+		unsigned int PooledNum {0u};
+		size_t PooledBytes {0u};
+	};
+
+	struct TextureDesc
+	{
+		UINT Width {0u};
+		UINT Height {0u};
+		// D32_FLOAT for depth, created typeless so it can also be read as R32_FLOAT.
+		DXGI_FORMAT Format {DXGI_FORMAT_UNKNOWN};
+		// Decides the views created along with it.
+		UINT BindFlags {0u};
+
+		[[nodiscard]] bool operator==(const TextureDesc& InOther) const noexcept
+		{
+			return Width == InOther.Width && Height == InOther.Height && Format == InOther.Format && BindFlags == InOther.BindFlags;
+		}
+	};
+
+	using ExecuteFunction = std::function<void(const RenderGraph&)>;
+
+	/**
+	 * The accesses of one pass, declared before Execute. A read sees what the last write declared before it left, a write
+	 * follows every read and write of the resource declared before it. Writing doesn't imply reading, passes that depend
+	 * on what is already there, such as depth testing or blending, declare both.
+	 */
+	class PassBuilder
+	{
+	public:
+		PassBuilder& Read(Handle InResource);
+		PassBuilder& Write(Handle InResource);
+
+	private:
+		friend class RenderGraph;
+
+		PassBuilder(RenderGraph& InGraph, size_t InPassIndex) noexcept
+			: Graph(InGraph), PassIndex(InPassIndex)
+		{
+		}
+
+		RenderGraph& Graph;
+		size_t PassIndex;
+	};
+
+	explicit RenderGraph(ID3D11Device* InDevice);
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph(RenderGraph&&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+	RenderGraph& operator=(RenderGraph&&) = delete;
+	~RenderGraph() = default;
+
+	// Names must be string literals. Importing a name again within the frame returns the same handle.
+	[[nodiscard]] Handle Import(const char* InName);
+	// Tracked for ordering and culling only, whoever writes it owns the storage, such as a culler's indirect arguments.
+	[[nodiscard]] Handle Create(const char* InName);
+	// Contents are undefined when the first pass writing it begins, it has to clear or fully overwrite it.
+	[[nodiscard]] Handle CreateTexture(const char* InName, const TextureDesc& InDesc);
+
+	PassBuilder AddPass(const char* InName, ExecuteFunction InExecute);
+
+	// Culls, schedules and runs the passes added since the last Execute, then forgets them. Main thread only.
+	void Execute();
+	// Every pool texture, for when the display resized and the transients sized after it never will be acquired again. Between frames only.
+	void ReleasePool();
+
+	// Only while a pass that declared the transient runs, null for views its bind flags don't allow.
+	[[nodiscard]] ID3D11Texture2D* GetTexture(Handle InResource) const noexcept;
+	[[nodiscard]] ID3D11ShaderResourceView* GetShaderResourceView(Handle InResource) const noexcept;
+	[[nodiscard]] ID3D11RenderTargetView* GetRenderTargetView(Handle InResource) const noexcept;
+	[[nodiscard]] ID3D11UnorderedAccessView* GetUnorderedAccessView(Handle InResource) const noexcept;
+	[[nodiscard]] ID3D11DepthStencilView* GetDepthStencilView(Handle InResource) const noexcept;
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+	// Names of the passes the last Execute ran, in the order it ran them.
+	[[nodiscard]] const std::vector<const char*>& GetLastSchedule() const noexcept
+	{
+		return LastSchedule;
+	}
+
+private:
+	enum class ResourceType : uint8_t
+	{
+		Imported,
+		Virtual,
+		Texture
+	};
+
+	struct Resource
+	{
+		const char* Name;
+		ResourceType Type;
+		TextureDesc Desc;
+		// Bumped by every write, accesses refer to the version they see.
+		unsigned int Version {0u};
+		// Schedule positions of the first and last kept pass using it.
+		size_t FirstUse {~size_t{0u}};
+		size_t LastUse {0u};
+		size_t PooledIndex {~size_t{0u}};
+	};
+
+	struct Access
+	{
+		Handle Resource;
+		unsigned int Version;
+		bool bIsWrite;
+	};
+
+	struct Pass
+	{
+		const char* Name;
+		ExecuteFunction Execute;
+		std::vector<Access> Accesses;
+		bool bIsKept {false};
+	};
+
+	struct PooledTexture
+	{
+		TextureDesc Desc;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ShaderResourceView;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RenderTargetView;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> UnorderedAccessView;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> DepthStencilView;
+		size_t ByteSize {0u};
+		unsigned long long LastUsedFrame {0u};
+		bool bIsInUse {false};
+	};
+
+	// Pool textures no frame used for this long are released.
+	static constexpr unsigned long long UnusedFrameNum {120u};
+
+	Handle AddResource(const char* InName, ResourceType InType, const TextureDesc& InDesc);
+	void Cull();
+	[[nodiscard]] std::vector<size_t> Schedule() const;
+	size_t Acquire(const TextureDesc& InDesc);
+	void CreatePooledTexture(PooledTexture& OutPooled) const;
+	void TrimPool();
+	static void Retire(PooledTexture& InOutPooled);
+	[[nodiscard]] const PooledTexture* FindPooled(Handle InResource) const noexcept;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> Device;
+
+	std::vector<Resource> Resources;
+	std::vector<Pass> Passes;
+	std::vector<PooledTexture> Pool;
+	// Set while its pass runs, so transients can only be looked up from the passes that use them.
+	const Pass* RunningPass {nullptr};
+	unsigned long long FrameIndex {0u};
+
+	Statistics LastStatistics {};
+	std::vector<const char*> LastSchedule;
+};
@@ -0,0 +1,1053 @@
+﻿#include "RenderQueue.h"
+#include <algorithm>
+#include <utility>
+#include "AllocationTracker.h"
+#include "Bindable.h"
+#include "DebugViews.h"
+#include "Drawable.h"
+#include "FrameProfiler.h"
+#include "Graphics.h"
+#include "IndexBuffer.h"
+#include "JobSystem.h"
+#include "RenderGraph.h"
+
+namespace
+{
+	const char* GetPassName(const RenderPass InPass) noexcept
+	{
+		switch (InPass)
+		{
+		case RenderPass::DepthPrepass:
+			return "Depth prepass";
+		case RenderPass::AlphaTestedPrepass:
+			return "Alpha-tested prepass";
+		case RenderPass::Opaque:
+			return "Opaque";
+		case RenderPass::AlphaTested:
+			return "Alpha-tested";
+		case RenderPass::OrderIndependent:
+			return "Order-independent transparency";
+		case RenderPass::Transparent:
+			return "Transparent";
+		}
+
+		return "Unknown pass";
+	}
+
+	// Runs InDraw once per view of a multi-view frame with that view's bit, each into its own tile, otherwise once for the camera.
+	// A stereo frame starts with both eyes at once.
+	template<typename Function>
+	void ForEachView(const Graphics& InGraphics, Function&& InDraw)
+	{
+		if (!InGraphics.IsMultiView())
+		{
+			InDraw(RenderQueue::AllViews);
+			return;
+		}
+
+		if (InGraphics.IsStereo())
+		{
+			InGraphics.BeginStereo();
+			InDraw(RenderQueue::StereoViews);
+		}
+
+		for (unsigned int View = 0u; View < InGraphics.GetViewNum(); ++View)
+		{
+			InGraphics.BeginView(View);
+			InDraw(uint32_t {1u} << View);
+		}
+
+		InGraphics.EndViews();
+	}
+
+	// Jobs per slice of the parallel sort, fewer are sorted on the calling thread alone.
+	constexpr size_t MinSortSliceJobNum {4096u};
+	constexpr unsigned int RadixBits {8u};
+	constexpr size_t RadixNum {size_t {1u} << RadixBits};
+
+	// Least significant digit first, a byte per pass, so it is stable. Digits every key shares are skipped, which the pass,
+	// shader and material fields of most frames mostly are. Each pass counts and scatters contiguous slices as jobs, a slice
+	// writing its keys behind every earlier slice's of the same digit.
+	void SortByKey(std::vector<RenderQueue::Job>& InOutJobs, std::vector<RenderQueue::Job>& InOutScratch)
+	{
+		PROFILE_SCOPE("RenderQueue::SortByKey");
+
+		using Histogram = std::array<size_t, RadixNum>;
+		constexpr unsigned int PassNum {sizeof(RenderQueue::SortKey) * 8u / RadixBits};
+
+		const auto JobNum = InOutJobs.size();
+		auto& Pool = JobSystem::Get();
+		const auto SliceNum = std::clamp<size_t>(JobNum / MinSortSliceJobNum, 1u, Pool.GetWorkerNum() + 1u);
+		const auto SliceSize = (JobNum + SliceNum - 1u) / SliceNum;
+
+		const auto ForEachSlice = [&](auto&& InBody)
+		{
+			if (SliceNum == 1u)
+			{
+				InBody(size_t {0u});
+			}
+			else
+			{
+				Pool.ParallelFor(SliceNum, 1u, InBody);
+			}
+		};
+
+		// Any key tells which digits are shared, those differing from it anywhere are not.
+		std::vector<RenderQueue::SortKey> SliceDiffers(SliceNum, 0u);
+		const auto FirstKey = JobNum > 0u ? InOutJobs.front().Key : 0u;
+
+		ForEachSlice([&](const size_t InSlice)
+		{
+			RenderQueue::SortKey Differs = 0u;
+
+			for (auto Index = InSlice * SliceSize, Last = std::min(Index + SliceSize, JobNum); Index < Last; ++Index)
+			{
+				Differs |= InOutJobs[Index].Key ^ FirstKey;
+			}
+
+			SliceDiffers[InSlice] = Differs;
+		});
+
+		RenderQueue::SortKey Differs = 0u;
+
+		for (const auto SliceDiffer : SliceDiffers)
+		{
+			Differs |= SliceDiffer;
+		}
+
+		InOutScratch.resize(JobNum);
+		std::vector<Histogram> Offsets(SliceNum);
+
+		for (unsigned int Pass = 0u; Pass < PassNum; ++Pass)
+		{
+			const auto Shift = Pass * RadixBits;
+
+			if (((Differs >> Shift) & (RadixNum - 1u)) == 0u)
+			{
+				continue;
+			}
+
+			ForEachSlice([&](const size_t InSlice)
+			{
+				auto& Counts = Offsets[InSlice];
+				Counts.fill(0u);
+
+				for (auto Index = InSlice * SliceSize, Last = std::min(Index + SliceSize, JobNum); Index < Last; ++Index)
+				{
+					++Counts[(InOutJobs[Index].Key >> Shift) & (RadixNum - 1u)];
+				}
+			});
+
+			// Digit by digit, then slice by slice within a digit, the counts become where each slice writes.
+			size_t Offset = 0u;
+
+			for (size_t Digit = 0u; Digit < RadixNum; ++Digit)
+			{
+				for (auto& Counts : Offsets)
+				{
+					Offset += std::exchange(Counts[Digit], Offset);
+				}
+			}
+
+			ForEachSlice([&](const size_t InSlice)
+			{
+				auto& Cursors = Offsets[InSlice];
+
+				for (auto Index = InSlice * SliceSize, Last = std::min(Index + SliceSize, JobNum); Index < Last; ++Index)
+				{
+					const auto& Sorted = InOutJobs[Index];
+					InOutScratch[Cursors[(Sorted.Key >> Shift) & (RadixNum - 1u)]++] = Sorted;
+				}
+			});
+
+			InOutJobs.swap(InOutScratch);
+		}
+	}
+}
+
+RenderQueue::RenderQueue()
+	: ThreadJobs(JobSystem::Get().GetWorkerNum() + 1u)
+{
+}
+
+RenderQueue::SortKey RenderQueue::MakeKey(const RenderPass InPass, const uint32_t InShaderHash, const uint32_t InMaterialKey,
+                                          const uint32_t InLayoutHash, const float InNormalizedDepth) noexcept
+{
+	constexpr auto Mask = [](const unsigned int InBits)
+	{
+		return (SortKey{1u} << InBits) - 1u;
+	};
+
+	const auto Depth = static_cast<SortKey>(std::clamp(InNormalizedDepth, 0.0f, 1.0f) * static_cast<float>(Mask(DepthBits)));
+
+	return (static_cast<SortKey>(InPass) & Mask(PassBits)) << (ShaderBits + MaterialBits + LayoutBits + DepthBits) |
+		   (static_cast<SortKey>(InShaderHash) & Mask(ShaderBits)) << (MaterialBits + LayoutBits + DepthBits) |
+		   (static_cast<SortKey>(InMaterialKey) & Mask(MaterialBits)) << (LayoutBits + DepthBits) |
+		   (static_cast<SortKey>(InLayoutHash) & Mask(LayoutBits)) << DepthBits |
+		   Depth;
+}
+
+RenderPass RenderQueue::GetPass(const SortKey InKey) noexcept
+{
+	return static_cast<RenderPass>(InKey >> (ShaderBits + MaterialBits + LayoutBits + DepthBits));
+}
+
+void RenderQueue::Submit(const SortKey InKey, const Drawable& InDrawable, const unsigned int InOcclusionSlot)
+{
+	ALLOCATION_SCOPE(Rendering);
+	ThreadJobs[JobSystem::Get().GetThreadIndex()].push_back({InKey, &InDrawable, InOcclusionSlot});
+}
+
+size_t RenderQueue::Num() const noexcept
+{
+	size_t JobNum = 0u;
+
+	for (const auto& Submitted : ThreadJobs)
+	{
+		JobNum += Submitted.size();
+	}
+
+	return JobNum;
+}
+
+void RenderQueue::AddFrameBindable(Bindable& InBindable)
+{
+	FrameBindables.push_back(&InBindable);
+}
+
+void RenderQueue::Execute(const Graphics& InGraphics)
+{
+	PROFILE_SCOPE("RenderQueue::Execute");
+	ALLOCATION_SCOPE(Rendering);
+
+	// Geometry created since last frame, possibly by loader threads, reaches its pages before anything draws from them.
+	InGraphics.GetUploadManager().Flush();
+
+	// Before any worker records, they only read what it looked up.
+	auto& Views = InGraphics.GetDebugViews();
+	Views.Prepare();
+
+	Jobs.reserve(Num());
+
+	for (auto& Submitted : ThreadJobs)
+	{
+		Jobs.insert(Jobs.end(), Submitted.begin(), Submitted.end());
+		Submitted.clear();
+	}
+
+	SortByKey(Jobs, SortScratch);
+
+	// Meshes split into meshlets are culled one by one instead of instanced, sorted blended ones are drawn whole in their order.
+	auto& MeshletCulling = InGraphics.GetMeshletCuller();
+	// Submission, sorting and the commands are shared by every view, only recording runs per view.
+	const bool bIsMultiView = InGraphics.IsMultiView();
+	const auto IsCulledPerMeshlet = [&MeshletCulling, bIsMultiView](const Job& InJob)
+	{
+		return MeshletCulling.IsEnabled() && !bIsMultiView && InJob.OcclusionSlot == OcclusionCuller::NoSlot && GetPass(InJob.Key) != RenderPass::Transparent &&
+		       !InJob.Target->GetMeshlets().empty();
+	};
+
+	// Per pass, since a drawable in the depth pre-pass is drawn again in the opaque pass. Rebuilt every frame, so it lives in the frame arena.
+	std::array<FrameUnorderedMap<const void*, FrameVector<const Drawable*>>, RenderPassNum> InstanceGroups;
+
+	if (bIsInstancingEnabled)
+	{
+		for (const auto& Submitted : Jobs)
+		{
+			const auto& [Key, Target, OcclusionSlot] = Submitted;
+
+			// Sorted blended instances would be drawn in one go whatever their order.
+			if (const auto* Group = Target->GetInstanceGroup(); Group && OcclusionSlot == OcclusionCuller::NoSlot && GetPass(Key) != RenderPass::Transparent &&
+			    !IsCulledPerMeshlet(Submitted))
+			{
+				InstanceGroups[static_cast<size_t>(GetPass(Key))][Group].push_back(Target);
+			}
+		}
+	}
+
+	// Everything is decided up front so recording workers only ever read the queue.
+	auto& Culler = InGraphics.GetOcclusionCuller();
+	auto* const FirstPhaseArguments = Culler.GetArguments(OcclusionCuller::Phase::First);
+	auto& InstanceCulling = InGraphics.GetInstanceCuller();
+	// The pre-pass and the opaque pass draw the same compacted triangles, so the equal depth test still holds.
+	FrameUnorderedMap<const Drawable*, unsigned int> MeshletSlots;
+	const auto CameraPosition = DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewMatrix()).r[3];
+	auto& Deferred = InGraphics.GetDeferredShading();
+	const bool bIsDeferredShadingActive = IsDeferredShadingActive(InGraphics);
+	bool bHasDepthPrepass = false;
+
+	for (const auto& Submitted : Jobs)
+	{
+		const auto& [Key, Target, OcclusionSlot] = Submitted;
+		const auto Pass = GetPass(Key);
+		const auto Stage = Pass == RenderPass::DepthPrepass && Target->IsDepthOnlySupported() ? DrawStage::DepthOnly :
+		                   Pass == RenderPass::AlphaTestedPrepass ? DrawStage::AlphaTest :
+		                   Pass == RenderPass::Opaque && bIsDeferredShadingActive && Target->IsGBufferSupported() ? DrawStage::GBuffer : DrawStage::Shaded;
+		bHasDepthPrepass |= Stage == DrawStage::DepthOnly;
+
+		if (OcclusionSlot != OcclusionCuller::NoSlot)
+		{
+			Commands.push_back({Key, Target, nullptr, FirstPhaseArguments, OcclusionSlot * OcclusionCuller::ArgumentStride, nullptr, nullptr, Stage});
+			continue;
+		}
+
+		if (IsCulledPerMeshlet(Submitted))
+		{
+			auto [Found, bIsNew] = MeshletSlots.try_emplace(Target, MeshletCuller::NoSlot);
+
+			if (bIsNew)
+			{
+				const auto* Indices = Target->GetIndexBuffer();
+				Found->second = MeshletCulling.AddMesh(Target->GetMeshlets(), Target->GetTransformMatrix(), CameraPosition, Indices->GetShaderResourceView(),
+				                                       Indices->GetFormat(), Target->GetStartIndex(), Target->GetBaseVertex(), Target->IsBackFaceCulled());
+			}
+
+			if (Found->second != MeshletCuller::NoSlot)
+			{
+				Commands.push_back({Key, Target, nullptr, MeshletCulling.GetArguments(), Found->second * MeshletCuller::ArgumentStride, nullptr,
+				                    MeshletCulling.GetIndices(), Stage});
+			}
+			else
+			{
+				Commands.push_back({Key, Target, nullptr, nullptr, 0u, nullptr, nullptr, Stage});
+			}
+
+			continue;
+		}
+
+		const auto* Group = bIsInstancingEnabled && Pass != RenderPass::Transparent ? Target->GetInstanceGroup() : nullptr;
+
+		if (!Group)
+		{
+			Commands.push_back({Key, Target, nullptr, nullptr, 0u, nullptr, nullptr, Stage});
+			continue;
+		}
+
+		// The whole group is issued at the position of its first member, later members are skipped.
+		const auto& Instances = InstanceGroups[static_cast<size_t>(Pass)][Group];
+
+		if (Instances.front() != Target)
+		{
+			continue;
+		}
+
+		if (const auto* Bounds = Target->GetLocalBounds(); Bounds && InstanceCulling.IsEnabled() && !bIsMultiView)
+		{
+			// Groups of one too, nothing else tests them once their meshes skip the occlusion culler.
+			const auto InstanceSlot = InstanceCulling.AddGroup(*Bounds, Target->GetIndexCount(), Target->GetStartIndex(), Target->GetBaseVertex(), Instances);
+
+			if (InstanceSlot != InstanceCuller::NoSlot)
+			{
+				Commands.push_back({Key, Target, nullptr, InstanceCulling.GetArguments(), InstanceSlot * InstanceCuller::ArgumentStride,
+				                    InstanceCulling.GetInstanceView(InstanceSlot), nullptr, Stage});
+				continue;
+			}
+		}
+
+		Commands.push_back({Key, Target, Instances.size() > 1u ? &Instances : nullptr, nullptr, 0u, nullptr, nullptr, Stage});
+	}
+
+	// Each draw is only recorded into the views its bounds reach, an instance group into those any of its members reaches.
+	if (bIsMultiView)
+	{
+		for (auto& Built : Commands)
+		{
+			const auto Members = Built.Instances ? std::span<const Drawable* const>(*Built.Instances) : std::span<const Drawable* const>(&Built.Target, 1u);
+
+			// Drawn in every view, with the brightest lights anywhere.
+			Built.ViewMask = (uint32_t {1u} << InGraphics.GetViewNum()) - 1u;
+
+			if (!std::all_of(Members.begin(), Members.end(), [](const Drawable* InMember) { return InMember->GetLocalBounds() != nullptr; }))
+			{
+				continue;
+			}
+
+			for (const auto* const Member : Members)
+			{
+				DirectX::BoundingBox WorldBounds;
+				Member->GetLocalBounds()->Transform(WorldBounds, Member->GetTransformMatrix());
+
+				if (Built.bHasBounds)
+				{
+					DirectX::BoundingBox::CreateMerged(Built.Bounds, Built.Bounds, WorldBounds);
+				}
+				else
+				{
+					Built.Bounds = WorldBounds;
+					Built.bHasBounds = true;
+				}
+			}
+
+			Built.ViewMask = InGraphics.GetViewMask(Built.Bounds);
+
+			// Both eyes in one draw instanced twice over, however many instances it has.
+			if (InGraphics.IsStereo() && Built.ViewMask != 0u && Built.Target->IsStereoInstanced())
+			{
+				Built.ViewMask = StereoViews;
+			}
+		}
+	}
+
+	/**
+	 * The GPU work runs as render graph passes. The targets, the shadow maps and the pyramid outlive the frame and are
+	 * imported, what the culling passes write is only declared, so a culler no kept draw reads from doesn't dispatch.
+	 */
+	auto& Graph = InGraphics.GetRenderGraph();
+	const auto SceneTarget = Graph.Import("Scene");
+	const auto Depth = Graph.Import("Depth");
+	const auto ShadowAtlas = Graph.Import("Shadow atlas");
+	const auto SunShadows = Graph.Import("Sun shadow cascades");
+	const auto Pyramid = Graph.Import("Hi-Z pyramid");
+	const auto LightLists = Graph.Create("Light lists");
+	const auto OcclusionArguments = Graph.Create("Occlusion arguments");
+	const auto InstanceArguments = Graph.Create("Instance arguments");
+	const auto MeshletArguments = Graph.Create("Meshlet arguments");
+	const auto Occlusion = Graph.Import("Ambient occlusion");
+	const auto Probes = Graph.Import("Reflection probes");
+	const auto Volume = Graph.Import("Irradiance volume");
+	const auto Impostors = Graph.Import("Impostor atlases");
+	const auto PickIds = Graph.Import("Pick IDs");
+	const auto TextureFeedback = Graph.Import("Virtual texture feedback");
+	const auto TransparencyTargets = Graph.Import("Transparency targets");
+	const auto Predicates = Graph.Import("Occlusion predicates");
+	const auto MotionVectors = Graph.Import("Motion vectors");
+	const auto OverdrawCounter = Graph.Import("Debug view counter");
+	const bool bIsCountingOverdraw = Views.GetMode() == DebugViewMode::Overdraw;
+
+	if (bIsCountingOverdraw)
+	{
+		Graph.AddPass("Debug view clear", [&InGraphics, &Views](const RenderGraph&)
+		{
+			Views.Clear(InGraphics);
+		}).Write(OverdrawCounter);
+	}
+
+	Graph.AddPass("Point light shadows", [&InGraphics](const RenderGraph&)
+	{
+		InGraphics.GetPointLightShadows().Render(InGraphics);
+	}).Write(ShadowAtlas);
+
+	Graph.AddPass("Sun shadow cascades", [&InGraphics](const RenderGraph&)
+	{
+		InGraphics.GetDirectionalLight().Render(InGraphics);
+	}).Write(SunShadows);
+
+	Graph.AddPass("Light culling", [&InGraphics](const RenderGraph&)
+	{
+		InGraphics.GetClusteredLighting().Cull(InGraphics);
+	}).Write(LightLists);
+
+	// Shaded with every light, so after the lights are uploaded, though not by the cluster lists.
+	Graph.AddPass("Reflection probe face", [&InGraphics](const RenderGraph&)
+	{
+		InGraphics.GetReflectionProbes().Render(InGraphics);
+	}).Read(LightLists).Read(ShadowAtlas).Read(SunShadows).Write(Probes);
+
+	// The same, and its faces see the reflection probes.
+	Graph.AddPass("Irradiance probes", [&InGraphics](const RenderGraph&)
+	{
+		InGraphics.GetIrradianceVolume().Render(InGraphics);
+	}).Read(LightLists).Read(ShadowAtlas).Read(SunShadows).Read(Probes).Write(Volume);
+
+	// Lit from the cluster lists like the surfaces, and applied over them once the scene's depth is final.
+	auto& Fog = InGraphics.GetVolumetricFog();
+	const bool bHasFog = Fog.IsActive(InGraphics) && !Views.ReplacesShading();
+	const auto FogVolume = Graph.Create("Fog volume");
+
+	if (bHasFog)
+	{
+		Graph.AddPass("Volumetric fog", [&InGraphics, &Fog](const RenderGraph&)
+		{
+			Fog.Render(InGraphics);
+		}).Read(LightLists).Read(ShadowAtlas).Write(FogVolume);
+	}
+
+	// Only G-buffer draws, lit when the impostors are drawn.
+	Graph.AddPass("Impostor bake", [&InGraphics](const RenderGraph&)
+	{
+		InGraphics.GetImpostorBaker().Render(InGraphics);
+	}).Write(Impostors);
+
+	// Only on frames with a pick, it draws its own targets from its own view.
+	if (auto& Picker = InGraphics.GetObjectPicker(); Picker.IsPicking())
+	{
+		Graph.AddPass("Object pick", [&InGraphics, &Picker](const RenderGraph&)
+		{
+			Picker.Render(InGraphics);
+		}).Write(PickIds);
+	}
+
+	// Likewise only on frames that gather which virtual texture pages are on screen.
+	if (auto* const VirtualTextures = InGraphics.GetVirtualTextureCache(); VirtualTextures && VirtualTextures->IsGatheringFeedback())
+	{
+		Graph.AddPass("Virtual texture feedback", [&InGraphics, VirtualTextures](const RenderGraph&)
+		{
+			VirtualTextures->RenderFeedback(InGraphics);
+		}).Write(TextureFeedback);
+	}
+
+	const bool bIsOcclusionCullingActive = Culler.IsEnabled() && !bIsMultiView;
+
+	if (bIsOcclusionCullingActive)
+	{
+		Graph.AddPass("Occlusion cull", [&InGraphics, &Culler](const RenderGraph&)
+		{
+			Culler.CullFirstPhase(InGraphics);
+		}).Read(Pyramid).Write(OcclusionArguments);
+	}
+
+	Graph.AddPass("Instance cull", [&InGraphics, &InstanceCulling](const RenderGraph&)
+	{
+		InstanceCulling.Cull(InGraphics);
+	}).Write(InstanceArguments);
+
+	Graph.AddPass("Meshlet cull", [&InGraphics, &MeshletCulling](const RenderGraph&)
+	{
+		MeshletCulling.Cull(InGraphics);
+	}).Write(MeshletArguments);
+
+	auto& Particles = InGraphics.GetParticleSystem();
+	const bool bHasParticles = Particles.IsEnabled() && Particles.HasWork();
+	const auto ParticleState = Graph.Create("Particles");
+
+	if (bHasParticles)
+	{
+		Graph.AddPass("Particle simulation", [&InGraphics, &Particles](const RenderGraph&)
+		{
+			Particles.Simulate(InGraphics);
+		}).Write(ParticleState);
+	}
+
+	// Depth is tested against what earlier passes left, the lights are read by shaded draws and the arguments by culled ones.
+	const auto DeclareCommands = [&](RenderGraph::PassBuilder& InOutDeclared, const size_t InFirst, const size_t InLast)
+	{
+		bool bIsShaded = false;
+		bool bIsOcclusionCulled = false;
+		bool bIsInstanceCulled = false;
+		bool bIsMeshletCulled = false;
+		bool bIsPredicated = false;
+
+		for (size_t Index = InFirst; Index < InLast; ++Index)
+		{
+			bIsShaded |= Commands[Index].Stage == DrawStage::Shaded;
+			bIsOcclusionCulled |= Commands[Index].Arguments && Commands[Index].Arguments == FirstPhaseArguments;
+			bIsInstanceCulled |= Commands[Index].InstanceView != nullptr;
+			bIsMeshletCulled |= Commands[Index].Indices != nullptr;
+			bIsPredicated |= Commands[Index].Target->GetPredicate() != nullptr;
+		}
+
+		InOutDeclared.Read(Depth).Write(Depth);
+
+		if (bIsShaded)
+		{
+			InOutDeclared.Read(LightLists).Read(ShadowAtlas).Read(SunShadows).Read(Occlusion).Read(Probes).Read(Volume).Read(Impostors);
+		}
+
+		if (bIsOcclusionCulled)
+		{
+			InOutDeclared.Read(OcclusionArguments);
+		}
+
+		if (bIsInstanceCulled)
+		{
+			InOutDeclared.Read(InstanceArguments);
+		}
+
+		if (bIsMeshletCulled)
+		{
+			InOutDeclared.Read(MeshletArguments);
+		}
+
+		// Drawn under last frame's results, so ahead of this frame's proxies.
+		if (bIsPredicated)
+		{
+			InOutDeclared.Read(Predicates);
+		}
+	};
+
+	// Once depth is down and before it is shaded, from the G-buffer's normals when there are any.
+	auto& Ssao = InGraphics.GetAmbientOcclusion();
+	bool bHasAmbientOcclusion = false;
+
+	const auto AddAmbientOcclusion = [&](const bool bInHasNormals, const RenderGraph::Handle InNormal)
+	{
+		const auto HalfOcclusion = Graph.CreateTexture("SSAO half resolution", Ssao.GetHalfResolutionDesc());
+
+		auto Declared = Graph.AddPass("SSAO", [&InGraphics, &Ssao, HalfOcclusion, bInHasNormals, InNormal](const RenderGraph& InGraph)
+		{
+			Ssao.Compute(InGraphics, InGraph.GetUnorderedAccessView(HalfOcclusion), bInHasNormals ? InGraph.GetShaderResourceView(InNormal) : nullptr);
+		});
+
+		Declared.Read(Depth).Write(HalfOcclusion);
+
+		if (bInHasNormals)
+		{
+			Declared.Read(InNormal);
+		}
+
+		Graph.AddPass("SSAO upsample", [&InGraphics, &Ssao, HalfOcclusion](const RenderGraph& InGraph)
+		{
+			Ssao.Upsample(InGraphics, InGraph.GetShaderResourceView(HalfOcclusion));
+		}).Read(HalfOcclusion).Read(Depth).Write(Occlusion);
+
+		bHasAmbientOcclusion = true;
+	};
+
+	// Each pass is timed as one GPU scope, the sort keeps its commands contiguous.
+	for (size_t First = 0u; First < Commands.size();)
+	{
+		const auto Pass = GetPass(Commands[First].Key);
+		auto Last = First + 1u;
+
+		while (Last < Commands.size() && GetPass(Commands[Last].Key) == Pass)
+		{
+			++Last;
+		}
+
+		// Accumulated with the frame's depth, then averaged over the scene once however many surfaces overlap.
+		if (Pass == RenderPass::OrderIndependent && !Views.ReplacesShading())
+		{
+			auto& Transparency = InGraphics.GetOrderIndependentTransparency();
+
+			auto Declared = Graph.AddPass(GetPassName(Pass), [this, &InGraphics, &Transparency, First, Last](const RenderGraph&)
+			{
+				auto& Profiler = InGraphics.GetGpuProfiler();
+				Profiler.BeginScope(GetPassName(RenderPass::OrderIndependent));
+
+				Transparency.Clear(InGraphics);
+
+				ForEachView(InGraphics, [&](const uint32_t InViewMask)
+				{
+					ExecutePass(InGraphics, First, Last, DepthTest::Less, InViewMask, Transparency.GetTargets());
+				});
+
+				Profiler.EndScope();
+			});
+
+			DeclareCommands(Declared, First, Last);
+			Declared.Write(TransparencyTargets);
+
+			Graph.AddPass("Transparency composite", [&InGraphics, &Transparency](const RenderGraph&)
+			{
+				Transparency.Composite(InGraphics);
+			}).Read(TransparencyTargets).Read(SceneTarget).Write(SceneTarget);
+
+			First = Last;
+			continue;
+		}
+
+		// Whatever reaches the opaque pass had its depth laid down by the pre-pass, alpha-tested surfaces always had theirs.
+		const auto PassDepthTest = (Pass == RenderPass::Opaque && bHasDepthPrepass) || Pass == RenderPass::AlphaTested ? DepthTest::Equal : DepthTest::Less;
+		auto ForwardFirst = First;
+
+		if (Pass == RenderPass::Opaque && bIsDeferredShadingActive)
+		{
+			// Stable, so both halves keep the state order of the sort.
+			ForwardFirst = static_cast<size_t>(std::stable_partition(Commands.begin() + First, Commands.begin() + Last, [](const Command& InCommand)
+			{
+				return InCommand.Stage == DrawStage::GBuffer;
+			}) - Commands.begin());
+		}
+
+		if (ForwardFirst > First)
+		{
+			const auto Albedo = Graph.CreateTexture("G-buffer albedo", Deferred.GetAlbedoDesc());
+			const auto Normal = Graph.CreateTexture("G-buffer normal", Deferred.GetNormalDesc());
+
+			auto Declared = Graph.AddPass("G-buffer", [this, &InGraphics, &Deferred, First, ForwardFirst, PassDepthTest, Albedo, Normal](const RenderGraph& InGraph)
+			{
+				auto& Profiler = InGraphics.GetGpuProfiler();
+				Profiler.BeginScope("G-buffer");
+
+				ID3D11RenderTargetView* const Targets[] = {InGraph.GetRenderTargetView(Albedo), InGraph.GetRenderTargetView(Normal)};
+				Deferred.Clear(InGraphics, Targets[1]);
+				ExecutePass(InGraphics, First, ForwardFirst, PassDepthTest, AllViews, Targets);
+
+				Profiler.EndScope();
+			});
+
+			DeclareCommands(Declared, First, ForwardFirst);
+			Declared.Write(Albedo).Write(Normal);
+
+			if (IsAmbientOcclusionActive(InGraphics) && !bHasAmbientOcclusion)
+			{
+				AddAmbientOcclusion(true, Normal);
+			}
+
+			// Before the forward draws of the pass, which depth test against the G-buffer's surfaces and draw over their lighting.
+			Graph.AddPass("Deferred lighting", [&InGraphics, &Deferred, Albedo, Normal](const RenderGraph& InGraph)
+			{
+				Deferred.Light(InGraphics, InGraph.GetShaderResourceView(Albedo), InGraph.GetShaderResourceView(Normal));
+			}).Read(Albedo).Read(Normal).Read(Depth).Read(LightLists).Read(ShadowAtlas).Read(SunShadows).Read(Occlusion).Read(Probes).Read(Volume).Write(SceneTarget);
+		}
+
+		if (ForwardFirst == Last)
+		{
+			First = Last;
+			continue;
+		}
+
+		auto Declared = Graph.AddPass(GetPassName(Pass), [this, &InGraphics, &Views, Pass, ForwardFirst, Last, PassDepthTest](const RenderGraph&)
+		{
+			auto& Profiler = InGraphics.GetGpuProfiler();
+			Profiler.BeginScope(GetPassName(Pass));
+
+			ForEachView(InGraphics, [&](const uint32_t InViewMask)
+			{
+				ExecutePass(InGraphics, ForwardFirst, Last, PassDepthTest, InViewMask, Views.GetTargets());
+			});
+
+			Profiler.EndScope();
+		});
+
+		DeclareCommands(Declared, ForwardFirst, Last);
+
+		// Blended surfaces read the scene behind them, counted layers add onto those before them.
+		if (bIsCountingOverdraw)
+		{
+			Declared.Read(OverdrawCounter).Write(OverdrawCounter);
+		}
+		else
+		{
+			if (Pass == RenderPass::Transparent)
+			{
+				Declared.Read(SceneTarget);
+			}
+
+			Declared.Write(SceneTarget);
+		}
+
+		// Without deferred shading the pre-passes are the last depth before the opaque pass shades, the alpha-tested one follows the other.
+		if ((Pass == RenderPass::DepthPrepass || Pass == RenderPass::AlphaTestedPrepass) && IsAmbientOcclusionActive(InGraphics) && !bIsDeferredShadingActive &&
+		    (Last == Commands.size() || GetPass(Commands[Last].Key) > RenderPass::AlphaTestedPrepass))
+		{
+			AddAmbientOcclusion(false, 0u);
+		}
+
+		First = Last;
+	}
+
+	if (bIsOcclusionCullingActive)
+	{
+		// The retest rebuilds the pyramid from the depth drawn so far, then draws what it finds visible after all.
+		Graph.AddPass("Occlusion retest", [this, &InGraphics](const RenderGraph&)
+		{
+			ExecuteOcclusionRetest(InGraphics);
+		}).Read(OcclusionArguments).Read(Depth).Read(ShadowAtlas).Read(SunShadows).Read(LightLists).Read(Occlusion).Read(Probes).Read(Volume).Read(OverdrawCounter)
+		  .Write(Pyramid).Write(Depth).Write(SceneTarget).Write(OverdrawCounter);
+
+		Graph.AddPass("Hi-Z pyramid", [&InGraphics, &Culler](const RenderGraph&)
+		{
+			Culler.EndFrame(InGraphics);
+		}).Read(Depth).Write(Pyramid);
+	}
+
+	// Against the frame's final depth, what next frame's heavy meshes are drawn under.
+	if (auto& Predication = InGraphics.GetOcclusionPredication(); Predication.HasProxies())
+	{
+		Graph.AddPass("Occlusion predicates", [&InGraphics, &Predication](const RenderGraph&)
+		{
+			Predication.Render(InGraphics);
+		}).Read(Depth).Write(Predicates);
+	}
+
+	// Also once depth is final, the resolve after the frame reprojects the history through them.
+	if (auto& Temporal = InGraphics.GetTemporalAntiAliasing(); Temporal.IsActive())
+	{
+		Graph.AddPass("Motion vectors", [&InGraphics, &Temporal](const RenderGraph&)
+		{
+			Temporal.RenderMotion(InGraphics);
+		}).Read(Depth).Write(MotionVectors);
+	}
+
+	// Over every surface the frame drew, blended and retested ones included, before the particles and lines drawn over it.
+	if (bHasFog)
+	{
+		Graph.AddPass("Volumetric fog apply", [&InGraphics, &Fog](const RenderGraph&)
+		{
+			Fog.Apply(InGraphics);
+		}).Read(FogVolume).Read(Depth).Read(SceneTarget).Write(SceneTarget);
+	}
+
+	// Over the whole scene, what the counted passes left of it is only the background.
+	if (bIsCountingOverdraw)
+	{
+		Graph.AddPass("Overdraw heatmap", [&InGraphics, &Views](const RenderGraph&)
+		{
+			Views.Composite(InGraphics);
+		}).Read(OverdrawCounter).Read(SceneTarget).Write(SceneTarget);
+	}
+
+	// Every shaded draw of the frame recorded once more, as edges over the finished surfaces.
+	if (Views.GetMode() == DebugViewMode::Wireframe)
+	{
+		const auto FirstShaded = static_cast<size_t>(std::find_if(Commands.begin(), Commands.end(), [](const Command& InCommand)
+		{
+			return GetPass(InCommand.Key) >= RenderPass::Opaque;
+		}) - Commands.begin());
+
+		Graph.AddPass("Wireframe", [this, &InGraphics, &Views, FirstShaded](const RenderGraph&)
+		{
+			PROFILE_GPU_SCOPE(InGraphics, "Wireframe");
+
+			// Up to the end of the queue as it is now, which has the occlusion retest's draws too.
+			Views.DrawWireframe([&]
+			{
+				ForEachView(InGraphics, [&](const uint32_t InViewMask)
+				{
+					ExecutePass(InGraphics, FirstShaded, Commands.size(), DepthTest::Less, InViewMask);
+				});
+			});
+		}).Read(Depth).Read(SceneTarget).Write(SceneTarget);
+	}
+
+	// Over everything the frame drew, retested draws included, tested against its depth.
+	if (bHasParticles)
+	{
+		Graph.AddPass("Particles", [&InGraphics, &Particles](const RenderGraph&)
+		{
+			// From their own vertex shader, which knows no eyes.
+			ForEachView(InGraphics, [&](const uint32_t InViewMask)
+			{
+				if (InViewMask != StereoViews)
+				{
+					Particles.Draw(InGraphics);
+				}
+			});
+		}).Read(ParticleState).Read(Depth).Read(SceneTarget).Write(SceneTarget);
+	}
+
+	// Last of all, so nothing the frame draws covers the lines meant to be on top.
+	if (auto& Lines = InGraphics.GetDebugDraw(); Lines.HasLines())
+	{
+		Graph.AddPass("Debug lines", [&InGraphics, &Lines](const RenderGraph&)
+		{
+			// Flushing hands the lines over, so a multi-view frame only shows them in its first view.
+			if (InGraphics.IsMultiView())
+			{
+				InGraphics.BeginView(0u);
+				Lines.Flush(InGraphics);
+				InGraphics.EndViews();
+				return;
+			}
+
+			Lines.Flush(InGraphics);
+		}).Read(Depth).Write(SceneTarget);
+	}
+
+	// Shading reads no occlusion on a frame without it, cleared ahead of every pass on the immediate context.
+	if (!bHasAmbientOcclusion)
+	{
+		Ssao.Skip(InGraphics);
+	}
+
+	Graph.Execute();
+
+	Jobs.clear();
+	Commands.clear();
+	FrameBindables.clear();
+}
+
+bool RenderQueue::IsDepthPrepassActive(const Graphics& InGraphics) const noexcept
+{
+	return bIsDepthPrepassEnabled || (IsAmbientOcclusionActive(InGraphics) && !IsDeferredShadingActive(InGraphics));
+}
+
+bool RenderQueue::IsDeferredShadingActive(const Graphics& InGraphics) noexcept
+{
+	return InGraphics.GetDeferredShading().IsEnabled() && InGraphics.GetSampleNum() == 1u && !InGraphics.IsMultiView() && !InGraphics.GetDebugViews().ReplacesShading();
+}
+
+bool RenderQueue::IsAmbientOcclusionActive(const Graphics& InGraphics) noexcept
+{
+	return InGraphics.GetAmbientOcclusion().IsEnabled() && !InGraphics.IsMultiView();
+}
+
+void RenderQueue::ExecuteOcclusionRetest(const Graphics& InGraphics)
+{
+	auto& Culler = InGraphics.GetOcclusionCuller();
+
+	if (!Culler.HasCandidates())
+	{
+		return;
+	}
+
+	Culler.CullSecondPhase(InGraphics);
+
+	/**
+	 * Every tested draw is issued again with the second phase arguments, only those rejected before and visible now draw anything.
+	 * The pre-pass never wrote their depth, so they are drawn shaded with the regular depth test. Alpha-tested ones clip their
+	 * depth again first and are shaded with the equal test after it, like in their own passes.
+	 */
+	auto* const SecondPhaseArguments = Culler.GetArguments(OcclusionCuller::Phase::Second);
+	const auto RetestFirst = Commands.size();
+	Commands.reserve(RetestFirst * 2u);
+
+	const auto AddRetests = [this, SecondPhaseArguments, RetestFirst](const RenderPass InPass, const DrawStage InStage)
+	{
+		for (size_t Index = 0u; Index < RetestFirst; ++Index)
+		{
+			// Instance and meshlet culled draws have no second phase.
+			if (const auto& Command = Commands[Index]; Command.Arguments && !Command.InstanceView && !Command.Indices && GetPass(Command.Key) == InPass)
+			{
+				Commands.push_back({Command.Key, Command.Target, nullptr, SecondPhaseArguments, Command.ArgumentsOffset, nullptr, nullptr, InStage});
+			}
+		}
+	};
+
+	AddRetests(RenderPass::Opaque, DrawStage::Shaded);
+	AddRetests(RenderPass::AlphaTestedPrepass, DrawStage::AlphaTest);
+	const auto AlphaTestedFirst = Commands.size();
+	AddRetests(RenderPass::AlphaTested, DrawStage::Shaded);
+
+	PROFILE_GPU_SCOPE(InGraphics, "Occlusion retest draws");
+	const auto Targets = InGraphics.GetDebugViews().GetTargets();
+	ExecutePass(InGraphics, RetestFirst, AlphaTestedFirst, DepthTest::Less, AllViews, Targets);
+	ExecutePass(InGraphics, AlphaTestedFirst, Commands.size(), DepthTest::Equal, AllViews, Targets);
+}
+
+void RenderQueue::ExecutePass(const Graphics& InGraphics, const size_t InFirst, const size_t InLast, const DepthTest InDepthTest,
+                              const uint32_t InViewMask, const std::span<ID3D11RenderTargetView* const> InTargets) const
+{
+	const auto& DeferredContexts = InGraphics.GetDeferredContexts();
+	const auto CommandNum = InLast - InFirst;
+	const auto WorkerNum = bIsMultithreadedRecordingEnabled ? std::min(DeferredContexts.size(), CommandNum / MinCommandsPerWorker) : 0u;
+
+	// Small passes are not worth the command list overhead.
+	if (WorkerNum < 2u)
+	{
+		Record(InGraphics.GetImmediateContext(), InFirst, InLast, InDepthTest, InViewMask, InTargets);
+		return;
+	}
+
+	auto& Scheduler = JobSystem::Get();
+	FrameVector<Microsoft::WRL::ComPtr<ID3D11CommandList>> CommandLists(WorkerNum);
+	JobCounter Recorded;
+
+	for (size_t Worker = 0u; Worker < WorkerNum; ++Worker)
+	{
+		const auto SliceFirst = InFirst + CommandNum * Worker / WorkerNum;
+		const auto SliceLast = InFirst + CommandNum * (Worker + 1u) / WorkerNum;
+
+		Scheduler.Run([this, &Context = *DeferredContexts[Worker], &CommandList = CommandLists[Worker], SliceFirst, SliceLast, InDepthTest, InViewMask,
+		               InTargets]
+		{
+			Context.BeginRecording();
+			Record(Context, SliceFirst, SliceLast, InDepthTest, InViewMask, InTargets);
+			CommandList = Context.FinishRecording();
+		}, &Recorded);
+	}
+
+	// The main thread records slices too instead of idling until the workers are done.
+	Scheduler.Wait(Recorded);
+
+	// Command lists run in slice order, which keeps the sorted submission order intact.
+	for (const auto& CommandList : CommandLists)
+	{
+		PROFILE_SCOPE("RenderQueue::ExecuteCommandList");
+
+		InGraphics.ExecuteCommandList(CommandList.Get());
+	}
+}
+
+void RenderQueue::Record(RenderContext& InContext, const size_t InFirst, const size_t InLast, const DepthTest InDepthTest, const uint32_t InViewMask,
+                         const std::span<ID3D11RenderTargetView* const> InTargets) const
+{
+	const auto& Lighting = InContext.GetGraphics().GetClusteredLighting();
+	const auto& Views = InContext.GetGraphics().GetDebugViews();
+	const auto* const SubstitutingViews = Views.IsSubstituting() ? &Views : nullptr;
+	// The clusters are of the camera's view, each draw of a multi-view frame gets its own lights instead.
+	const bool bIsMultiView = InContext.GetGraphics().IsMultiView();
+
+	for (auto* const FrameBindable : FrameBindables)
+	{
+		FrameBindable->Bind(InContext);
+	}
+
+	InContext.GetGraphics().BindDepthTest(InContext, InDepthTest);
+	// Only the stereo pass draws anything but one copy of each instance.
+	InContext.SetInstanceRepeat(InViewMask == StereoViews ? 2u : 1u);
+
+	if (bIsMultiView)
+	{
+		Lighting.BindUnclustered(InContext);
+	}
+	else
+	{
+		Lighting.Bind(InContext);
+	}
+
+	InContext.GetGraphics().GetDecalAtlas().Bind(InContext);
+	InContext.GetGraphics().GetPointLightShadows().Bind(InContext);
+	InContext.GetGraphics().GetDirectionalLight().Bind(InContext);
+	InContext.GetGraphics().GetAmbientOcclusion().Bind(InContext);
+	InContext.GetGraphics().GetImageBasedLighting().Bind(InContext);
+	InContext.GetGraphics().GetReflectionProbes().Bind(InContext);
+	InContext.GetGraphics().GetIrradianceVolume().Bind(InContext);
+
+	if (!InTargets.empty())
+	{
+		InContext.GetGraphics().BindRenderTargets(InContext, InTargets);
+	}
+
+	for (size_t Index = InFirst; Index < InLast; ++Index)
+	{
+		const auto& [Key, Target, Instances, Arguments, ArgumentsOffset, InstanceView, Indices, Stage, ViewMask, Bounds, bHasBounds] = Commands[Index];
+
+		if ((ViewMask & InViewMask) == 0u)
+		{
+			continue;
+		}
+
+		if (bIsMultiView)
+		{
+			Lighting.BindObjectLights(InContext, bHasBounds ? &Bounds : nullptr);
+		}
+
+		// Depth-only and alpha test draws keep their shaders, so the views see the same cut-outs as the frame.
+		InContext.SetDebugViews(Stage == DrawStage::Shaded || Stage == DrawStage::GBuffer ? SubstitutingViews : nullptr);
+
+		auto* const Predicate = Target->GetPredicate();
+
+		// Skipped by the GPU when the proxy drawn last frame had no sample pass.
+		if (Predicate)
+		{
+			InContext.GetDeviceContext()->SetPredication(Predicate, FALSE);
+		}
+
+		if (Indices)
+		{
+			Target->DrawCompacted(InContext, Arguments, ArgumentsOffset, Indices, Stage);
+		}
+		else if (InstanceView)
+		{
+			Target->DrawInstancedIndirect(InContext, Arguments, ArgumentsOffset, InstanceView, Stage);
+		}
+		else if (Arguments)
+		{
+			Target->DrawIndirect(InContext, Arguments, ArgumentsOffset, Stage);
+		}
+		else if (Instances)
+		{
+			Target->DrawInstanced(InContext, *Instances, Stage);
+		}
+		else
+		{
+			Target->Draw(InContext, Stage);
+		}
+
+		if (Predicate)
+		{
+			InContext.GetDeviceContext()->SetPredication(nullptr, FALSE);
+		}
+	}
+
+	InContext.SetInstanceRepeat(1u);
+	InContext.SetDebugViews(nullptr);
+
+	// Whatever records next on this context expects the scene as its target again.
+	if (!InTargets.empty())
+	{
+		InContext.GetGraphics().BindFrameState(InContext);
+	}
+}
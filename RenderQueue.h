@@ -0,0 +1,195 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <DirectXCollision.h>
+#include <span>
+#include <vector>
+#include "FrameArena.h"
+#include "OcclusionCuller.h"
+
+class Bindable;
+class Drawable;
+class Graphics;
+class RenderContext;
+
+enum class RenderPass : uint8_t
+{
+	// Depth of everything that supports depth-only drawing, and the full draw of anything that does not.
+	DepthPrepass,
+	// Depth of alpha-tested surfaces with their cut-out texels clipped, after the opaque depth so it rejects what it covers.
+	AlphaTestedPrepass,
+	Opaque,
+	// Alpha-tested surfaces shaded where their pre-pass left their depth, so they keep early depth rejection like opaque ones.
+	AlphaTested,
+	// Weighted blended surfaces accumulated in any order, keyed by state like the opaque pass, then composited over the scene once.
+	OrderIndependent,
+	// Other blended surfaces over the finished opaque scene, keyed by depth alone so they draw back to front.
+	Transparent
+};
+
+inline constexpr size_t RenderPassNum {6u};
+
+enum class DrawStage : uint8_t
+{
+	Shaded,
+	// Position only with no pixel shader, for passes that only need depth.
+	DepthOnly,
+	// The material's surface written into the G-buffer instead of lit, for deferred shading.
+	GBuffer,
+	// The shaded state with the material's alpha test pixel shader, which only clips, for the alpha-tested pre-pass.
+	AlphaTest
+};
+
+enum class DepthTest : uint8_t
+{
+	// Tests and writes depth, the regular forward path.
+	Less,
+	// Only passes where the depth pre-pass wrote this exact depth, and leaves the buffer untouched.
+	Equal
+};
+
+/**
+ * Draws of the frame, submitted from the main thread or from jobs on the JobSystem as draw items with a sort key each. Every
+ * thread appends to a draw list of its own, so traversal and culling can run as jobs without a lock per draw, and Execute
+ * merges the lists and radix sorts them in parallel before recording.
+ */
+class RenderQueue
+{
+public:
+	using SortKey = uint64_t;
+
+	/**
+	 * 63..60 Pass | 59..44 Shader Pair | 43..32 Material | 31..24 Input Layout | 23..0 Depth
+	 * Passes run in order, and within a pass state changes are grouped before depth is considered.
+	 * The material field holds a Material's ID, or a hash of the textures for drawables binding them directly.
+	 * Transparent keys leave the state fields zero and store one minus the depth, so they sort back to front. Order-independent
+	 * ones sum the same whatever their order and keep the state fields.
+	 */
+	static constexpr unsigned int PassBits {4u};
+	static constexpr unsigned int ShaderBits {16u};
+	static constexpr unsigned int MaterialBits {12u};
+	static constexpr unsigned int LayoutBits {8u};
+	static constexpr unsigned int DepthBits {24u};
+	// A view mask with every view's bit, what a frame of the camera alone draws with.
+	static constexpr uint32_t AllViews {~0u};
+	// Past every view's own bit, the stereo pass drawing both eyes of stereo instanced drawables at once.
+	static constexpr uint32_t StereoViews {1u << 31u};
+
+	struct Job
+	{
+		SortKey Key;
+		const Drawable* Target;
+		unsigned int OcclusionSlot;
+	};
+
+	[[nodiscard]] static SortKey MakeKey(RenderPass InPass, uint32_t InShaderHash, uint32_t InMaterialKey,
+	                                     uint32_t InLayoutHash, float InNormalizedDepth) noexcept;
+	[[nodiscard]] static RenderPass GetPass(SortKey InKey) noexcept;
+
+	RenderQueue();
+
+	// Drawables with an occlusion slot are drawn through the culler's indirect arguments and never instanced. Any thread
+	// during submission, only one of them from outside the JobSystem's pool.
+	void Submit(SortKey InKey, const Drawable& InDrawable, unsigned int InOcclusionSlot = OcclusionCuller::NoSlot);
+	// Bound at the start of every context that records this frame, then dropped after Execute.
+	void AddFrameBindable(Bindable& InBindable);
+	void Execute(const Graphics& InGraphics);
+
+	void EnableInstancing() noexcept
+	{
+		bIsInstancingEnabled = true;
+	}
+
+	void DisableInstancing() noexcept
+	{
+		bIsInstancingEnabled = false;
+	}
+
+	[[nodiscard]] bool IsInstancingEnabled() const noexcept
+	{
+		return bIsInstancingEnabled;
+	}
+
+	void EnableMultithreadedRecording() noexcept
+	{
+		bIsMultithreadedRecordingEnabled = true;
+	}
+
+	void DisableMultithreadedRecording() noexcept
+	{
+		bIsMultithreadedRecordingEnabled = false;
+	}
+
+	[[nodiscard]] bool IsMultithreadedRecordingEnabled() const noexcept
+	{
+		return bIsMultithreadedRecordingEnabled;
+	}
+
+	// Drawables lay down depth first so the opaque pass shades every pixel once, at the cost of a second vertex pass.
+	void EnableDepthPrepass() noexcept
+	{
+		bIsDepthPrepassEnabled = true;
+	}
+
+	void DisableDepthPrepass() noexcept
+	{
+		bIsDepthPrepassEnabled = false;
+	}
+
+	[[nodiscard]] bool IsDepthPrepassEnabled() const noexcept
+	{
+		return bIsDepthPrepassEnabled;
+	}
+
+	// Also while forward shading reads ambient occlusion, which needs the depth laid down before anything is shaded.
+	[[nodiscard]] bool IsDepthPrepassActive(const Graphics& InGraphics) const noexcept;
+	// The G-buffer is single sampled, it can't share a multisampled depth buffer. Both are of the camera's screen alone, so a
+	// multi-view frame is lit forward and without ambient occlusion.
+	[[nodiscard]] static bool IsDeferredShadingActive(const Graphics& InGraphics) noexcept;
+	[[nodiscard]] static bool IsAmbientOcclusionActive(const Graphics& InGraphics) noexcept;
+
+	[[nodiscard]] size_t Num() const noexcept;
+
+private:
+	struct Command
+	{
+		SortKey Key;
+		const Drawable* Target;
+		// Null for a single draw, otherwise the whole instance group issued by its first member.
+		const FrameVector<const Drawable*>* Instances;
+		// Non-null when the occlusion culler decides on the GPU whether this draw happens.
+		ID3D11Buffer* Arguments;
+		UINT ArgumentsOffset;
+		// Non-null when the instance culler decides which instances of the group are drawn, with Arguments its count.
+		ID3D11ShaderResourceView* InstanceView;
+		// Non-null when the meshlet culler compacted the visible triangles into it, with Arguments their count.
+		ID3D11Buffer* Indices;
+		DrawStage Stage;
+		// Only set in multi-view frames: the views the draw reaches, and the world bounds its lights are picked by.
+		uint32_t ViewMask {AllViews};
+		DirectX::BoundingBox Bounds {};
+		bool bHasBounds {false};
+	};
+
+	void ExecuteOcclusionRetest(const Graphics& InGraphics);
+	// Draws into InTargets with the frame's depth instead of the scene when there are any, such as the G-buffer. Commands
+	// reaching none of the views in InViewMask are skipped.
+	void ExecutePass(const Graphics& InGraphics, size_t InFirst, size_t InLast, DepthTest InDepthTest, uint32_t InViewMask = AllViews,
+	                 std::span<ID3D11RenderTargetView* const> InTargets = {}) const;
+	void Record(RenderContext& InContext, size_t InFirst, size_t InLast, DepthTest InDepthTest, uint32_t InViewMask,
+	            std::span<ID3D11RenderTargetView* const> InTargets) const;
+
+private:
+	// A worker only records a deferred command list when it gets at least this many commands.
+	static constexpr size_t MinCommandsPerWorker {64u};
+
+	// One list per JobSystem thread index, merged into Jobs and sorted with SortScratch by Execute.
+	std::vector<std::vector<Job>> ThreadJobs;
+	std::vector<Job> Jobs;
+	std::vector<Job> SortScratch;
+	std::vector<Command> Commands;
+	std::vector<Bindable*> FrameBindables;
+	bool bIsInstancingEnabled {true};
+	bool bIsMultithreadedRecordingEnabled {true};
+	bool bIsDepthPrepassEnabled {false};
+};
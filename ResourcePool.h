@@ -0,0 +1,130 @@
+﻿#pragma once
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Dense storage of T addressed by 32-bit generational handles: the low bits are the slot, the high ones count how often the slot
+ * was reused, so a handle kept past the removal of its element finds nothing instead of the element that took the slot over.
+ * Elements sit next to each other in one array rather than in a node each, sweeps over all of them are one linear pass.
+ * Handles stay valid while the array grows, pointers from Find only until the next Add. Not synchronized, the owner locks.
+ */
+template<typename T>
+class ResourcePool
+{
+public:
+	class Handle
+	{
+	public:
+		constexpr Handle() noexcept = default;
+
+		[[nodiscard]] constexpr bool IsNull() const noexcept
+		{
+			return Value == 0u;
+		}
+
+		[[nodiscard]] constexpr uint32_t GetValue() const noexcept
+		{
+			return Value;
+		}
+
+		constexpr bool operator==(const Handle&) const noexcept = default;
+
+	private:
+		friend class ResourcePool;
+
+		constexpr Handle(const uint32_t InSlot, const uint32_t InGeneration) noexcept
+			: Value(InGeneration << SlotBits | InSlot)
+		{
+		}
+
+		[[nodiscard]] constexpr uint32_t GetSlot() const noexcept
+		{
+			return Value & SlotMask;
+		}
+
+		[[nodiscard]] constexpr uint32_t GetGeneration() const noexcept
+		{
+			return Value >> SlotBits;
+		}
+
+		// Generations start at one, so no live element has the null handle.
+		uint32_t Value {0u};
+	};
+
+	// A million slots, and 4096 reuses of each before an old handle could match again.
+	static constexpr uint32_t SlotBits {20u};
+	static constexpr uint32_t SlotMask {(1u << SlotBits) - 1u};
+	static constexpr uint32_t GenerationMask {(1u << (32u - SlotBits)) - 1u};
+
+	[[nodiscard]] Handle Add(T InElement)
+	{
+		uint32_t Slot;
+
+		if (!FreeSlots.empty())
+		{
+			Slot = FreeSlots.back();
+			FreeSlots.pop_back();
+			Elements[Slot] = std::move(InElement);
+		}
+		else
+		{
+			Slot = static_cast<uint32_t>(Elements.size());
+			assert(Slot <= SlotMask && "ResourcePool is full");
+			Elements.push_back(std::move(InElement));
+			Generations.push_back(1u);
+			bIsAlive.push_back(0u);
+		}
+
+		bIsAlive[Slot] = 1u;
+		++Num;
+		return {Slot, Generations[Slot]};
+	}
+
+	// Moves the element out, the slot is reused by a later Add under the next generation.
+	T Remove(const Handle InHandle) noexcept
+	{
+		assert(Find(InHandle) && "Handle is stale");
+
+		const auto Slot = InHandle.GetSlot();
+		T Removed = std::exchange(Elements[Slot], T {});
+		bIsAlive[Slot] = 0u;
+		Generations[Slot] = Generations[Slot] % GenerationMask + 1u;
+		FreeSlots.push_back(Slot);
+		--Num;
+		return Removed;
+	}
+
+	// Null for stale and null handles.
+	[[nodiscard]] T* Find(const Handle InHandle) noexcept
+	{
+		const auto Slot = InHandle.GetSlot();
+		return !InHandle.IsNull() && Slot < Elements.size() && bIsAlive[Slot] && Generations[Slot] == InHandle.GetGeneration() ? &Elements[Slot] : nullptr;
+	}
+
+	// Calls InFunction with the handle and the element of each one alive, in slot order. It may remove the element it is given.
+	template<typename Function>
+	void ForEach(Function&& InFunction)
+	{
+		for (uint32_t Slot = 0u; Slot < Elements.size(); ++Slot)
+		{
+			if (bIsAlive[Slot])
+			{
+				InFunction(Handle {Slot, Generations[Slot]}, Elements[Slot]);
+			}
+		}
+	}
+
+	[[nodiscard]] size_t GetNum() const noexcept
+	{
+		return Num;
+	}
+
+private:
+	std::vector<T> Elements;
+	std::vector<uint32_t> Generations;
+	std::vector<uint8_t> bIsAlive;
+	std::vector<uint32_t> FreeSlots;
+	size_t Num {0u};
+};
@@ -1,17 +1,16 @@
 ﻿#include "Sampler.h"
-
+#include <bit>
+#include <cassert>
 #include "BindManager.h"
+#include "DrawPacket.h"
 #include "ExceptionMacros.h"
 
-Sampler::Sampler(const Graphics& InGraphics)
+Sampler::Sampler(const Graphics& InGraphics, const Description& InDescription)
+	: MyDescription(InDescription)
 {
 	HRESULT ResultHandle;
 
-	D3D11_SAMPLER_DESC SamplerDesc = {};
-	SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-	SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	const auto SamplerDesc = MakeDesc(InDescription);
 
 	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateSamplerState
 	(
@@ -20,22 +19,65 @@ Sampler::Sampler(const Graphics& InGraphics)
 	))
 }
 
-void Sampler::Bind(const Graphics& InGraphics) noexcept
+void Sampler::Bind(RenderContext& InContext) noexcept
+{
+	BindTo(InContext, 0u);
+}
+
+bool Sampler::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	BakeTo(InOutPacket, 0u);
+	return true;
+}
+
+void Sampler::BindTo(RenderContext& InContext, const UINT InSlot) const noexcept
+{
+	GetStateCache(InContext).SetPixelSampler(InSlot, MySamplerState.Get());
+}
+
+void Sampler::BakeTo(DrawPacket& InOutPacket, const UINT InSlot) const noexcept
 {
-	GetContext(InGraphics)->PSSetSamplers(0u, 1u, MySamplerState.GetAddressOf());
+	InOutPacket.AddPixelSampler(InSlot, MySamplerState.Get());
 }
 
-std::shared_ptr<Sampler> Sampler::Resolve(const Graphics& InGraphics)
+D3D11_SAMPLER_DESC Sampler::MakeDesc(const Description& InDescription) noexcept
 {
-	return BindManager::Resolve<Sampler>(InGraphics);
+	assert(InDescription.MaxAnisotropy >= 1u && InDescription.MaxAnisotropy <= D3D11_MAX_MAXANISOTROPY && "Anisotropy is 1 to 16");
+
+	D3D11_SAMPLER_DESC SamplerDesc = {};
+	SamplerDesc.Filter = InDescription.Filter;
+	SamplerDesc.AddressU = InDescription.AddressMode;
+	SamplerDesc.AddressV = InDescription.AddressMode;
+	SamplerDesc.AddressW = InDescription.AddressMode;
+	SamplerDesc.MipLODBias = InDescription.MipLodBias;
+	SamplerDesc.MaxAnisotropy = InDescription.MaxAnisotropy;
+	SamplerDesc.ComparisonFunc = InDescription.Comparison;
+	SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	return SamplerDesc;
+}
+
+std::shared_ptr<Sampler> Sampler::Resolve(const Graphics& InGraphics, const Description& InDescription)
+{
+	return BindManager::Resolve<Sampler>(InGraphics, InDescription);
+}
+
+std::string Sampler::GenerateUniqueID(const Description& InDescription)
+{
+	using namespace std::string_literals;
+
+	return typeid(Sampler).name() + "#"s + std::to_string(InDescription.Filter) + "#"s + std::to_string(InDescription.AddressMode) +
+		   "#"s + std::to_string(InDescription.MaxAnisotropy) + "#"s + std::to_string(InDescription.MipLodBias) +
+		   "#"s + std::to_string(InDescription.Comparison);
 }
 
-std::string Sampler::GenerateUniqueID()
+BindKey Sampler::GenerateKey(const Description& InDescription)
 {
-	return typeid(Sampler).name();
+	return BindKey::Make<Sampler>(InDescription.Filter, InDescription.AddressMode, InDescription.MaxAnisotropy,
+	                              std::bit_cast<uint32_t>(InDescription.MipLodBias), InDescription.Comparison);
 }
 
 std::string Sampler::GetUniqueID() const noexcept
 {
-	return GenerateUniqueID();
+	return GenerateUniqueID(MyDescription);
 }
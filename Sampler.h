@@ -1,18 +1,60 @@
 ﻿#pragma once
 #include <memory>
+#include "BindKey.h"
 #include "Bindable.h"
 
+/**
+ * Pixel shader sampler state made from a Description, created once per distinct description and shared through the BindManager.
+ * The presets cover what the engine samples with, materials pick one to trade filtering quality for bandwidth.
+ * The slot isn't part of the description, bound on its own it goes to slot 0 and owners that read it elsewhere use BindTo.
+ */
 class Sampler : public Bindable
 {
 public:
-	Sampler(const Graphics& InGraphics);
+	struct Description
+	{
+		D3D11_FILTER Filter {D3D11_FILTER_MIN_MAG_MIP_LINEAR};
+		// Applies to U, V and W alike.
+		D3D11_TEXTURE_ADDRESS_MODE AddressMode {D3D11_TEXTURE_ADDRESS_WRAP};
+		// Only anisotropic filters read it, 1 to 16.
+		UINT MaxAnisotropy {1u};
+		float MipLodBias {0.0f};
+		// Only comparison filters read it.
+		D3D11_COMPARISON_FUNC Comparison {D3D11_COMPARISON_NEVER};
+	};
 
-	void Bind(const Graphics& InGraphics) noexcept override;
+	// Defined below the class, the member initializers of Description can't be used before the class is complete.
+	// Trilinear, what every sampler used before there were descriptions.
+	static const Description Linear;
+	// Keeps surfaces seen at grazing angles sharp, at up to MaxAnisotropy times the texture reads.
+	static const Description Anisotropic;
+	// Texel exact, for UI images and lookups that must not blend neighbours.
+	static const Description Point;
+	// Depth comparison with two by two percentage closer filtering, for shadow maps.
+	static const Description ShadowComparison;
 
-	[[nodiscard]] static std::shared_ptr<Sampler> Resolve(const Graphics& InGraphics);
-	[[nodiscard]] static std::string GenerateUniqueID();
+	Sampler(const Graphics& InGraphics, const Description& InDescription = Linear);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+	void BindTo(RenderContext& InContext, UINT InSlot) const noexcept;
+	void BakeTo(DrawPacket& InOutPacket, UINT InSlot) const noexcept;
+
+	// For subsystems that create their samplers on the device themselves, so they still come from the same descriptions.
+	[[nodiscard]] static D3D11_SAMPLER_DESC MakeDesc(const Description& InDescription) noexcept;
+
+	[[nodiscard]] static std::shared_ptr<Sampler> Resolve(const Graphics& InGraphics, const Description& InDescription = Linear);
+	[[nodiscard]] static std::string GenerateUniqueID(const Description& InDescription = Linear);
+	[[nodiscard]] static BindKey GenerateKey(const Description& InDescription = Linear);
 	[[nodiscard]] std::string GetUniqueID() const noexcept override;
 
 protected:
+	Description MyDescription;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> MySamplerState;
 };
+
+inline constexpr Sampler::Description Sampler::Linear {};
+inline constexpr Sampler::Description Sampler::Anisotropic {D3D11_FILTER_ANISOTROPIC, D3D11_TEXTURE_ADDRESS_WRAP, 8u};
+inline constexpr Sampler::Description Sampler::Point {D3D11_FILTER_MIN_MAG_MIP_POINT, D3D11_TEXTURE_ADDRESS_CLAMP};
+inline constexpr Sampler::Description Sampler::ShadowComparison {D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT, D3D11_TEXTURE_ADDRESS_CLAMP, 1u,
+                                                                 0.0f, D3D11_COMPARISON_LESS_EQUAL};
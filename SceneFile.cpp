@@ -0,0 +1,334 @@
+﻿#include "SceneFile.h"
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include "Camera.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "PointLight.h"
+
+namespace
+{
+	static_assert(std::is_trivially_copyable_v<SceneFile::Header> && std::is_trivially_copyable_v<SceneFile::Model> &&
+	              std::is_trivially_copyable_v<SceneFile::Instance> && std::is_trivially_copyable_v<SceneFile::Light>,
+	              "Scene records are read in place from the mapping");
+
+	// The records right after InOutCursor, which is moved past them.
+	template <typename TRecord>
+	std::span<const TRecord> TakeRecords(const std::byte*& InOutCursor, const uint32_t InNum) noexcept
+	{
+		const std::span Records(reinterpret_cast<const TRecord*>(InOutCursor), InNum);
+		InOutCursor += Records.size_bytes();
+		return Records;
+	}
+
+	template <typename TRecord>
+	void WriteRecords(std::ofstream& InOutStream, const std::vector<TRecord>& InRecords)
+	{
+		InOutStream.write(reinterpret_cast<const char*>(InRecords.data()), static_cast<std::streamsize>(InRecords.size() * sizeof(TRecord)));
+	}
+
+	[[nodiscard]] uint64_t GetFileSize(const SceneFile::Header& InHeader) noexcept
+	{
+		// The counts are 32 bits, none of the products can overflow.
+		return sizeof(SceneFile::Header) + uint64_t {InHeader.ModelNum} * sizeof(SceneFile::Model) +
+		       uint64_t {InHeader.MaterialOverrideNum} * sizeof(SceneFile::MaterialOverride) + uint64_t {InHeader.StaticNodeNum} * sizeof(SceneFile::String) +
+		       uint64_t {InHeader.InstanceNum} * sizeof(SceneFile::Instance) + uint64_t {InHeader.NodeTransformNum} * sizeof(SceneFile::NodeTransform) +
+		       uint64_t {InHeader.LightNum} * sizeof(SceneFile::Light) + InHeader.StringBytes;
+	}
+}
+
+SceneFile::SceneFile(const std::filesystem::path& InFileName)
+	: Mapping(std::make_unique<MappedFile>(InFileName))
+{
+	if (!Mapping->IsValid() || Mapping->GetSize() < sizeof(Header))
+	{
+		return;
+	}
+
+	const auto* Cursor = Mapping->GetData();
+	const auto& MappedHeader = *reinterpret_cast<const Header*>(Cursor);
+
+	if (MappedHeader.Magic != Magic || MappedHeader.Version != Version || GetFileSize(MappedHeader) > Mapping->GetSize())
+	{
+		return;
+	}
+
+	Cursor += sizeof(Header);
+	Models = TakeRecords<Model>(Cursor, MappedHeader.ModelNum);
+	MaterialOverrides = TakeRecords<MaterialOverride>(Cursor, MappedHeader.MaterialOverrideNum);
+	StaticNodes = TakeRecords<String>(Cursor, MappedHeader.StaticNodeNum);
+	Instances = TakeRecords<Instance>(Cursor, MappedHeader.InstanceNum);
+	NodeTransforms = TakeRecords<NodeTransform>(Cursor, MappedHeader.NodeTransformNum);
+	Lights = TakeRecords<Light>(Cursor, MappedHeader.LightNum);
+	Strings = reinterpret_cast<const char*>(Cursor);
+
+	if (!Validate(MappedHeader))
+	{
+		Models = {};
+		MaterialOverrides = {};
+		StaticNodes = {};
+		Instances = {};
+		NodeTransforms = {};
+		Lights = {};
+		Strings = nullptr;
+		return;
+	}
+
+	SceneHeader = &MappedHeader;
+}
+
+SceneFile::~SceneFile() = default;
+
+bool SceneFile::Write(const std::filesystem::path& InFileName, const Camera& InCamera, DirectX::FXMMATRIX InProjection,
+                      const std::span<const ModelInstance* const> InInstances, const std::span<const PointLight* const> InLights)
+{
+	std::vector<Model> FileModels;
+	std::vector<MaterialOverride> FileMaterialOverrides;
+	std::vector<String> FileStaticNodes;
+	std::vector<Instance> FileInstances;
+	std::vector<NodeTransform> FileNodeTransforms;
+	std::vector<Light> FileLights;
+	std::string FileStrings;
+	std::unordered_map<const ModelAsset*, uint32_t> ModelIndices;
+
+	const auto AddString = [&FileStrings](const std::string_view InText)
+	{
+		const String Added {static_cast<uint32_t>(FileStrings.size()), static_cast<uint32_t>(InText.size())};
+		FileStrings += InText;
+		return Added;
+	};
+
+	for (const auto* const Placed : InInstances)
+	{
+		if (!Placed->IsReady())
+		{
+			continue;
+		}
+
+		const auto* const Asset = Placed->GetAsset().get();
+		auto [Found, bIsNew] = ModelIndices.try_emplace(Asset, static_cast<uint32_t>(FileModels.size()));
+
+		if (bIsNew)
+		{
+			const auto& Options = Asset->GetOptions();
+			auto& Added = FileModels.emplace_back();
+			Added.Path = AddString(Asset->GetSourcePath());
+			Added.ImportFlags = (Options.bPacksTextureArrays ? Model::PacksTextureArrays : 0u) | (Options.bCooksTextures ? Model::CooksTextures : 0u) |
+			                    (Options.bBakesVertexAnimation ? Model::BakesVertexAnimation : 0u);
+			Added.FirstMaterialOverride = static_cast<uint32_t>(FileMaterialOverrides.size());
+			Added.MaterialOverrideNum = static_cast<uint32_t>(Options.MaterialOverrides.size());
+			Added.FirstStaticNode = static_cast<uint32_t>(FileStaticNodes.size());
+			Added.StaticNodeNum = static_cast<uint32_t>(Options.StaticNodes.size());
+			Added.MaterialSampling = Options.MaterialSampling;
+
+			for (const auto& [MaterialName, Opacity, bIsTwoSided] : Options.MaterialOverrides)
+			{
+				FileMaterialOverrides.push_back({AddString(MaterialName), Opacity, bIsTwoSided ? 1u : 0u});
+			}
+
+			for (const auto& Name : Options.StaticNodes)
+			{
+				FileStaticNodes.push_back(AddString(Name));
+			}
+		}
+
+		auto& Added = FileInstances.emplace_back();
+		DirectX::XMStoreFloat4x4(&Added.RootTransform, Placed->GetRootTransform());
+		Added.Model = Found->second;
+		Added.FirstNodeTransform = static_cast<uint32_t>(FileNodeTransforms.size());
+		Added.Animation = Placed->GetPlayingAnimation();
+
+		for (const auto& [Node, Roll, Pitch, Yaw, Position] : Placed->GetNodeTransforms())
+		{
+			FileNodeTransforms.push_back({Node, Roll, Pitch, Yaw, Position});
+		}
+
+		Added.NodeTransformNum = static_cast<uint32_t>(FileNodeTransforms.size()) - Added.FirstNodeTransform;
+	}
+
+	for (const auto* const Lit : InLights)
+	{
+		const auto& Constants = Lit->GetConstants();
+		FileLights.push_back({Constants.Position, Constants.AmbientColor, Constants.DiffuseColor, Constants.DiffuseStrength, Constants.QuadraticAttenuation,
+		                      Constants.LinearAttenuation, Constants.ConstantAttenuation, Lit->IsShadowCasting() ? 1u : 0u});
+	}
+
+	Header FileHeader {Magic, Version, static_cast<uint32_t>(FileModels.size()), static_cast<uint32_t>(FileMaterialOverrides.size()),
+	                   static_cast<uint32_t>(FileStaticNodes.size()), static_cast<uint32_t>(FileInstances.size()), static_cast<uint32_t>(FileNodeTransforms.size()),
+	                   static_cast<uint32_t>(FileLights.size()), static_cast<uint32_t>(FileStrings.size()), {InCamera.GetPosition(), InCamera.GetPitch(), InCamera.GetYaw()}};
+	DirectX::XMStoreFloat4x4(&FileHeader.View.Projection, InProjection);
+
+	auto TemporaryPath = InFileName;
+	TemporaryPath += ".tmp";
+	std::error_code ErrorCode;
+
+	{
+		std::ofstream Stream(TemporaryPath, std::ios::binary | std::ios::trunc);
+		if (!Stream)
+		{
+			return false;
+		}
+
+		Stream.write(reinterpret_cast<const char*>(&FileHeader), sizeof(FileHeader));
+		WriteRecords(Stream, FileModels);
+		WriteRecords(Stream, FileMaterialOverrides);
+		WriteRecords(Stream, FileStaticNodes);
+		WriteRecords(Stream, FileInstances);
+		WriteRecords(Stream, FileNodeTransforms);
+		WriteRecords(Stream, FileLights);
+		Stream.write(FileStrings.data(), static_cast<std::streamsize>(FileStrings.size()));
+
+		if (!Stream.flush())
+		{
+			Stream.close();
+			std::filesystem::remove(TemporaryPath, ErrorCode);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(TemporaryPath, InFileName, ErrorCode);
+	if (ErrorCode)
+	{
+		std::filesystem::remove(TemporaryPath, ErrorCode);
+		return false;
+	}
+
+	return true;
+}
+
+std::vector<std::unique_ptr<ModelInstance>> SceneFile::LoadInstances(const Graphics& InGraphics) const
+{
+	std::vector<std::unique_ptr<ModelInstance>> Loaded;
+	Loaded.reserve(Instances.size());
+	// The first instance of each model imports it, the others wait on that import.
+	std::vector<const ModelInstance*> Importers(Models.size(), nullptr);
+
+	for (size_t Index = 0u; Index < Instances.size(); ++Index)
+	{
+		auto*& Importer = Importers[Instances[Index].Model];
+		Loaded.push_back(LoadInstance(InGraphics, Index, Importer));
+
+		if (!Importer)
+		{
+			Importer = Loaded.back().get();
+		}
+	}
+
+	return Loaded;
+}
+
+std::unique_ptr<ModelInstance> SceneFile::LoadInstance(const Graphics& InGraphics, const size_t InIndex, const ModelInstance* InSharing) const
+{
+	const auto& [RootTransform, ModelIndex, FirstNodeTransform, NodeTransformNum, Animation] = Instances[InIndex];
+	std::unique_ptr<ModelInstance> Loaded;
+
+	if (InSharing)
+	{
+		Loaded = InSharing->LoadShared(InGraphics);
+	}
+	else
+	{
+		const auto& Referenced = Models[ModelIndex];
+		ModelAsset::ImportOptions Options;
+		Options.bPacksTextureArrays = (Referenced.ImportFlags & Model::PacksTextureArrays) != 0u;
+		Options.bCooksTextures = (Referenced.ImportFlags & Model::CooksTextures) != 0u;
+		Options.bBakesVertexAnimation = (Referenced.ImportFlags & Model::BakesVertexAnimation) != 0u;
+		Options.MaterialSampling = Referenced.MaterialSampling;
+
+		for (const auto& [MaterialName, Opacity, bIsTwoSided] : MaterialOverrides.subspan(Referenced.FirstMaterialOverride, Referenced.MaterialOverrideNum))
+		{
+			Options.MaterialOverrides.push_back({std::string(GetString(MaterialName)), Opacity, bIsTwoSided != 0u});
+		}
+
+		for (const auto& Name : StaticNodes.subspan(Referenced.FirstStaticNode, Referenced.StaticNodeNum))
+		{
+			Options.StaticNodes.emplace_back(GetString(Name));
+		}
+
+		Loaded = ModelInstance::LoadAsync(InGraphics, GetString(Referenced.Path), Options);
+	}
+
+	Loaded->SetRootTransform(DirectX::XMLoadFloat4x4(&RootTransform));
+
+	if (Animation != ModelInstance::NoAnimation)
+	{
+		Loaded->PlayAnimation(Animation);
+	}
+
+	for (const auto& [Node, Roll, Pitch, Yaw, Position] : NodeTransforms.subspan(FirstNodeTransform, NodeTransformNum))
+	{
+		Loaded->SetNodeTransform({Node, Roll, Pitch, Yaw, Position});
+	}
+
+	return Loaded;
+}
+
+std::vector<std::unique_ptr<PointLight>> SceneFile::CreateLights(const Graphics& InGraphics) const
+{
+	std::vector<std::unique_ptr<PointLight>> Created;
+
+	for (const auto& Lit : Lights)
+	{
+		auto& Added = *Created.emplace_back(std::make_unique<PointLight>(InGraphics));
+		Added.SetConstants({Lit.Position, Lit.AmbientColor, Lit.DiffuseColor, Lit.DiffuseStrength, Lit.QuadraticAttenuation, Lit.LinearAttenuation,
+		                    Lit.ConstantAttenuation});
+		Added.SetShadowCasting(Lit.bIsShadowCasting != 0u);
+	}
+
+	return Created;
+}
+
+bool SceneFile::Validate(const Header& InHeader) const noexcept
+{
+	const auto IsInside = [&InHeader](const String& InString)
+	{
+		return InString.Offset <= InHeader.StringBytes && InString.Length <= InHeader.StringBytes - InString.Offset;
+	};
+
+	const auto IsRange = [](const uint32_t InFirst, const uint32_t InNum, const size_t InTotal)
+	{
+		return InFirst <= InTotal && InNum <= InTotal - InFirst;
+	};
+
+	for (const auto& Referenced : Models)
+	{
+		if (!IsInside(Referenced.Path) || !IsRange(Referenced.FirstMaterialOverride, Referenced.MaterialOverrideNum, MaterialOverrides.size()) ||
+			!IsRange(Referenced.FirstStaticNode, Referenced.StaticNodeNum, StaticNodes.size()))
+		{
+			return false;
+		}
+	}
+
+	for (const auto& Overridden : MaterialOverrides)
+	{
+		if (!IsInside(Overridden.MaterialName))
+		{
+			return false;
+		}
+	}
+
+	for (const auto& Name : StaticNodes)
+	{
+		if (!IsInside(Name))
+		{
+			return false;
+		}
+	}
+
+	for (const auto& Placed : Instances)
+	{
+		if (Placed.Model >= Models.size() || !IsRange(Placed.FirstNodeTransform, Placed.NodeTransformNum, NodeTransforms.size()))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::string_view SceneFile::GetString(const String& InString) const noexcept
+{
+	return {Strings + InString.Offset, InString.Length};
+}
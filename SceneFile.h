@@ -0,0 +1,180 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <DirectXMath.h>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "Sampler.h"
+
+class Camera;
+class Graphics;
+class MappedFile;
+class ModelInstance;
+class PointLight;
+
+/**
+ * A whole scene in one memory-mapped file: the models it references with their import options, every instance of them with its
+ * root transform, animation and the node transforms set in its model window, the point lights and the camera.
+ * Nothing is parsed, the records are fixed-size and read where they lie in the mapping once Validate has checked the counts and
+ * every offset against the file's size. Loading starts every instance at once, so the models import in parallel on the job
+ * system and the instances of one model share its import.
+ *
+ * Layout, little endian: Header, then Header::ModelNum Model records, MaterialOverrideNum MaterialOverride records, StaticNodeNum
+ * String records, InstanceNum Instance records, NodeTransformNum NodeTransform records, LightNum Light records and StringBytes of
+ * text the String records point into, offsets from the start of the text.
+ */
+class SceneFile
+{
+public:
+	struct String
+	{
+		uint32_t Offset;
+		uint32_t Length;
+	};
+
+	struct CameraPose
+	{
+		DirectX::XMFLOAT3 Position;
+		float Pitch;
+		float Yaw;
+		DirectX::XMFLOAT4X4 Projection;
+	};
+
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t ModelNum;
+		uint32_t MaterialOverrideNum;
+		uint32_t StaticNodeNum;
+		uint32_t InstanceNum;
+		uint32_t NodeTransformNum;
+		uint32_t LightNum;
+		uint32_t StringBytes;
+		CameraPose View;
+	};
+
+	struct Model
+	{
+		enum Flags : uint32_t
+		{
+			PacksTextureArrays = 1u << 0u,
+			CooksTextures = 1u << 1u,
+			BakesVertexAnimation = 1u << 2u
+		};
+
+		String Path;
+		uint32_t ImportFlags;
+		uint32_t FirstMaterialOverride;
+		uint32_t MaterialOverrideNum;
+		uint32_t FirstStaticNode;
+		uint32_t StaticNodeNum;
+		Sampler::Description MaterialSampling;
+	};
+
+	struct MaterialOverride
+	{
+		String MaterialName;
+		float Opacity;
+		uint32_t bIsTwoSided;
+	};
+
+	struct Instance
+	{
+		DirectX::XMFLOAT4X4 RootTransform;
+		uint32_t Model;
+		uint32_t FirstNodeTransform;
+		uint32_t NodeTransformNum;
+		// ~0u plays nothing.
+		uint32_t Animation;
+	};
+
+	// What a model window's sliders hold for the node.
+	struct NodeTransform
+	{
+		uint32_t Node;
+		float Roll;
+		float Pitch;
+		float Yaw;
+		DirectX::XMFLOAT3 Position;
+	};
+
+	struct Light
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 AmbientColor;
+		DirectX::XMFLOAT3 DiffuseColor;
+		float DiffuseStrength;
+		float QuadraticAttenuation;
+		float LinearAttenuation;
+		float ConstantAttenuation;
+		uint32_t bIsShadowCasting;
+	};
+
+	// "SCNE"
+	static constexpr uint32_t Magic {0x454E4353u};
+	static constexpr uint32_t Version {1u};
+
+	// A missing or malformed file is left invalid.
+	explicit SceneFile(const std::filesystem::path& InFileName);
+	SceneFile(const SceneFile&) = delete;
+	SceneFile(SceneFile&&) = delete;
+	SceneFile& operator=(const SceneFile&) = delete;
+	SceneFile& operator=(SceneFile&&) = delete;
+	~SceneFile();
+
+	// Only the instances that finished loading are written, instances sharing an asset share its model record. Written aside and
+	// renamed, so a failed write leaves the previous file in place.
+	static bool Write(const std::filesystem::path& InFileName, const Camera& InCamera, DirectX::FXMMATRIX InProjection,
+	                  std::span<const ModelInstance* const> InInstances, std::span<const PointLight* const> InLights);
+
+	[[nodiscard]] bool IsValid() const noexcept
+	{
+		return SceneHeader != nullptr;
+	}
+
+	// Starts loading every instance, in the order they were written.
+	[[nodiscard]] std::vector<std::unique_ptr<ModelInstance>> LoadInstances(const Graphics& InGraphics) const;
+	// One instance, for streaming a part of the scene. InSharing, an instance of the same model, is loaded from instead of
+	// importing the model again.
+	[[nodiscard]] std::unique_ptr<ModelInstance> LoadInstance(const Graphics& InGraphics, size_t InIndex, const ModelInstance* InSharing = nullptr) const;
+	[[nodiscard]] std::vector<std::unique_ptr<PointLight>> CreateLights(const Graphics& InGraphics) const;
+
+	[[nodiscard]] const CameraPose& GetView() const noexcept
+	{
+		return SceneHeader->View;
+	}
+
+	[[nodiscard]] size_t GetInstanceNum() const noexcept
+	{
+		return Instances.size();
+	}
+
+	[[nodiscard]] const Instance& GetInstance(const size_t InIndex) const noexcept
+	{
+		return Instances[InIndex];
+	}
+
+	[[nodiscard]] size_t GetModelNum() const noexcept
+	{
+		return Models.size();
+	}
+
+private:
+	[[nodiscard]] bool Validate(const Header& InHeader) const noexcept;
+	[[nodiscard]] std::string_view GetString(const String& InString) const noexcept;
+
+private:
+	std::unique_ptr<MappedFile> Mapping;
+	const Header* SceneHeader {nullptr};
+	std::span<const Model> Models;
+	std::span<const MaterialOverride> MaterialOverrides;
+	std::span<const String> StaticNodes;
+	std::span<const Instance> Instances;
+	std::span<const NodeTransform> NodeTransforms;
+	std::span<const Light> Lights;
+	const char* Strings {nullptr};
+};
@@ -0,0 +1,129 @@
+﻿#include "ShaderBundle.h"
+#include <algorithm>
+#include <cstring>
+#include <d3dcompiler.h>
+#include <filesystem>
+#include <string>
+#include "AssetArchive.h"
+#include "ExceptionMacros.h"
+
+ShaderBundle::ShaderBundle(const wchar_t* const InFileName)
+{
+	const auto FileHandle = CreateFileW(InFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (FileHandle == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER FileSize;
+	DWORD ReadSize = 0u;
+
+	if (GetFileSizeEx(FileHandle, &FileSize) && FileSize.QuadPart >= static_cast<LONGLONG>(sizeof(Header)) && FileSize.QuadPart <= MAXDWORD)
+	{
+		Data.resize(static_cast<size_t>(FileSize.QuadPart));
+
+		if (!ReadFile(FileHandle, Data.data(), static_cast<DWORD>(Data.size()), &ReadSize, nullptr))
+		{
+			ReadSize = 0u;
+		}
+	}
+
+	CloseHandle(FileHandle);
+
+	if (ReadSize != Data.size() || !Validate())
+	{
+		Data.clear();
+		return;
+	}
+
+	Entries = reinterpret_cast<const Entry*>(Data.data() + sizeof(Header));
+	EntryNum = reinterpret_cast<const Header*>(Data.data())->EntryNum;
+}
+
+bool ShaderBundle::Validate() const noexcept
+{
+	if (Data.size() < sizeof(Header))
+	{
+		return false;
+	}
+
+	const auto& BundleHeader = *reinterpret_cast<const Header*>(Data.data());
+	if (BundleHeader.Magic != Magic || BundleHeader.Version != Version ||
+		BundleHeader.EntryNum > (Data.size() - sizeof(Header)) / sizeof(Entry))
+	{
+		return false;
+	}
+
+	const auto* const BundleEntries = reinterpret_cast<const Entry*>(Data.data() + sizeof(Header));
+	const auto IsInside = [this](const unsigned int InOffset, const unsigned int InSize)
+	{
+		return InOffset <= Data.size() && InSize <= Data.size() - InOffset;
+	};
+
+	return std::all_of(BundleEntries, BundleEntries + BundleHeader.EntryNum, [&](const Entry& InEntry)
+	{
+		return IsInside(InEntry.NameOffset, InEntry.NameLength) && IsInside(InEntry.ByteCodeOffset, InEntry.ByteCodeSize) && InEntry.ByteCodeSize &&
+			   IsInside(InEntry.SourceOffset, InEntry.SourceLength) && IsInside(InEntry.DefinesOffset, InEntry.DefinesLength);
+	});
+}
+
+std::string_view ShaderBundle::GetString(const unsigned int InOffset, const unsigned int InLength) const noexcept
+{
+	return {reinterpret_cast<const char*>(Data.data() + InOffset), InLength};
+}
+
+const ShaderBundle::Entry* ShaderBundle::FindEntry(const std::string_view InName, const unsigned int InFeatures) const noexcept
+{
+	const auto* const Found = std::lower_bound(Entries, Entries + EntryNum, InName, [&](const Entry& InEntry, const std::string_view InKey)
+	{
+		const auto Order = GetString(InEntry.NameOffset, InEntry.NameLength).compare(InKey);
+		return Order < 0 || (Order == 0 && InEntry.Features < InFeatures);
+	});
+
+	if (Found == Entries + EntryNum || GetString(Found->NameOffset, Found->NameLength) != InName || Found->Features != InFeatures)
+	{
+		return nullptr;
+	}
+
+	return Found;
+}
+
+std::span<const std::byte> ShaderBundle::Find(const std::string_view InName, const unsigned int InFeatures) const noexcept
+{
+	const auto* const Found = FindEntry(InName, InFeatures);
+	return Found ? std::span<const std::byte>{Data.data() + Found->ByteCodeOffset, Found->ByteCodeSize} : std::span<const std::byte>{};
+}
+
+Microsoft::WRL::ComPtr<ID3DBlob> ShaderBundle::Load(const std::string_view InName, const unsigned int InFeatures) const
+{
+	HRESULT ResultHandle;
+	Microsoft::WRL::ComPtr<ID3DBlob> Blob;
+
+	std::span<const std::byte> ByteCode = Find(InName, InFeatures);
+	std::vector<std::byte> FileBytes;
+
+	// Variants only exist inside the bundle, a missing one fails here the same as a missing file.
+	if (ByteCode.empty())
+	{
+		if (!AssetArchive::Get().Read(std::filesystem::path(InName), FileBytes) || FileBytes.empty())
+		{
+			CHECK_HRESULT_EXCEPTION(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+		}
+
+		ByteCode = FileBytes;
+	}
+
+	CHECK_HRESULT_EXCEPTION(D3DCreateBlob(ByteCode.size(), &Blob))
+	std::memcpy(Blob->GetBufferPointer(), ByteCode.data(), ByteCode.size());
+	return Blob;
+}
+
+ShaderBundle::Source ShaderBundle::FindSource(const std::string_view InName, const unsigned int InFeatures) const noexcept
+{
+	if (const auto* const Found = FindEntry(InName, InFeatures))
+	{
+		return {GetString(Found->SourceOffset, Found->SourceLength), GetString(Found->DefinesOffset, Found->DefinesLength)};
+	}
+
+	return {};
+}
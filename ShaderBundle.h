@@ -0,0 +1,79 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <cstddef>
+#include <d3d11.h>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "wrl/client.h"
+
+/**
+ * Every compiled shader packed into one file at build time and read with a single call at startup.
+ * Shaders are found by name and feature mask, the mask picks among the #define-driven variants of an uber source
+ * and is zero for shaders that have only one. Shaders the bundle doesn't have are read from their loose .cso files.
+ *
+ * Layout, little endian: Header, Header::EntryNum Entry records sorted by name then features, then the strings and bytecode
+ * at the offsets the entries give from the start of the file.
+ */
+class ShaderBundle
+{
+public:
+	static constexpr unsigned int NoFeatures {0u};
+
+	struct Header
+	{
+		unsigned int Magic;
+		unsigned int Version;
+		unsigned int EntryNum;
+	};
+
+	struct Entry
+	{
+		unsigned int NameOffset;
+		unsigned int NameLength;
+		unsigned int Features;
+		unsigned int ByteCodeOffset;
+		unsigned int ByteCodeSize;
+		// What the shader was compiled from, so it can be compiled again at run time.
+		unsigned int SourceOffset;
+		unsigned int SourceLength;
+		unsigned int DefinesOffset;
+		unsigned int DefinesLength;
+	};
+
+	struct Source
+	{
+		std::string_view FileName;
+		// Semicolon separated NAME=VALUE pairs, as in the ShaderVariant items.
+		std::string_view Defines;
+	};
+
+	// "SHBD"
+	static constexpr unsigned int Magic {0x44424853u};
+	static constexpr unsigned int Version {2u};
+
+	// A missing or malformed bundle is left empty and everything falls back to loose files.
+	explicit ShaderBundle(const wchar_t* InFileName);
+	ShaderBundle(const ShaderBundle&) = delete;
+	ShaderBundle(ShaderBundle&&) = delete;
+	ShaderBundle& operator=(const ShaderBundle&) = delete;
+	ShaderBundle& operator=(ShaderBundle&&) = delete;
+	~ShaderBundle() = default;
+
+	// Empty when the bundle has no such shader.
+	[[nodiscard]] std::span<const std::byte> Find(std::string_view InName, unsigned int InFeatures = NoFeatures) const noexcept;
+	// The bundled bytecode, or the loose file of that name when it isn't bundled.
+	[[nodiscard]] Microsoft::WRL::ComPtr<ID3DBlob> Load(std::string_view InName, unsigned int InFeatures = NoFeatures) const;
+	// What a bundled shader was built from, empty when it isn't bundled.
+	[[nodiscard]] Source FindSource(std::string_view InName, unsigned int InFeatures = NoFeatures) const noexcept;
+
+private:
+	[[nodiscard]] bool Validate() const noexcept;
+	[[nodiscard]] const Entry* FindEntry(std::string_view InName, unsigned int InFeatures) const noexcept;
+	[[nodiscard]] std::string_view GetString(unsigned int InOffset, unsigned int InLength) const noexcept;
+
+private:
+	std::vector<std::byte> Data;
+	const Entry* Entries {nullptr};
+	size_t EntryNum {0u};
+};
@@ -1,46 +1,106 @@
-float3 NormalMapToWorldSpace(const float3 InTangent,
-							 const float3 InBitangent,
-							 const float3 InWorldNormal,
-							 const float2 InTextureCoordinate,
-							 Texture2D InNormalMap,
-							 const SamplerState InSampler)
-{
-    const float3x3 TangentToWorld = float3x3(InTangent, InBitangent, InWorldNormal);
-    const float3 SampledTangentNormal = InNormalMap.Sample(InSampler, InTextureCoordinate).xyz;
-    const float3 TangentNormal = SampledTangentNormal * 2.0f - 1.0f;
+#include "ImageBasedLighting.hlsli"
+#include "ReflectionProbes.hlsli"
+#include "IrradianceVolume.hlsli"
+
+// Builds with HALF_PRECISION run the per-light terms and the normal map decode at 16-bit minimum precision where the
+// device has it, see Material::HalfPrecision. Positions, attenuation and the specular power stay 32-bit, they need the range.
+#if HALF_PRECISION
+typedef min16float LightingFloat;
+typedef min16float2 LightingFloat2;
+typedef min16float3 LightingFloat3;
+typedef min16float3x3 LightingFloat3x3;
+#else
+typedef float LightingFloat;
+typedef float2 LightingFloat2;
+typedef float3 LightingFloat3;
+typedef float3x3 LightingFloat3x3;
+#endif
+
+// Takes the XY of a normal map sample, so it works for whatever kind of resource the map was sampled from.
+float3 NormalSampleToWorldSpace(const float3 InTangent,
+								const float3 InBitangent,
+								const float3 InWorldNormal,
+								const float2 InNormalSample)
+{
+    const LightingFloat3x3 TangentToWorld = LightingFloat3x3((LightingFloat3) InTangent, (LightingFloat3) InBitangent, (LightingFloat3) InWorldNormal);
+    // Z is rebuilt from XY so two-channel BC5 normal maps work the same as full RGB ones.
+    const LightingFloat2 TangentNormalXY = (LightingFloat2) InNormalSample * 2.0f - 1.0f;
+    const LightingFloat3 TangentNormal = LightingFloat3(TangentNormalXY, sqrt(saturate(1.0f - dot(TangentNormalXY, TangentNormalXY))));
     return normalize(mul(TangentNormal, TangentToWorld));
 }
 
-float CalcAttenuate(const uniform float InQuadraticAttenuation,
-					const uniform float InLinearAttenuation,
-					const uniform float InConstantAttenuation,
+// Colour maps are authored in sRGB, lighting adds up linear light.
+float3 SrgbToLinear(const float3 InColor)
+{
+    return InColor <= 0.04045f ? InColor / 12.92f : pow((InColor + 0.055f) / 1.055f, 2.4f);
+}
+
+// For targets written through views that can't encode on write, such as UAVs.
+float3 LinearToSrgb(const float3 InColor)
+{
+    return InColor <= 0.0031308f ? InColor * 12.92f : 1.055f * pow(InColor, 1.0f / 2.4f) - 0.055f;
+}
+
+float CalcAttenuate(const in float InQuadraticAttenuation,
+					const in float InLinearAttenuation,
+					const in float InConstantAttenuation,
 					const in float InDistanceToLight)
 {
     return 1.0f / (InQuadraticAttenuation * (InDistanceToLight * InDistanceToLight) + InLinearAttenuation * InDistanceToLight + InConstantAttenuation);
 }
 
-float3 CalcDiffuse(const uniform float3 InDiffuseColor,
-				   const uniform float InDiffuseStrength,
+float3 CalcDiffuse(const in float3 InDiffuseColor,
+				   const in float InDiffuseStrength,
 				   const in float InAttenuation,
 				   const in float3 InDirectionToLight,
 				   const in float3 InWorldNormal)
 {
-    return InDiffuseColor * InDiffuseStrength * InAttenuation * max(0.0f, dot(InDirectionToLight, InWorldNormal));
+    const LightingFloat Lambert = max(0.0f, dot((LightingFloat3) InDirectionToLight, (LightingFloat3) InWorldNormal));
+    return (LightingFloat3) InDiffuseColor * (LightingFloat) InDiffuseStrength * Lambert * InAttenuation;
 }
 
 float3 CalcSpeculate(const in float3 InSpecularColor,
-					 const uniform float InSpecularIntensity,
+					 const in float InSpecularIntensity,
 					 const in float3 InWorldNormal,
 					 const in float3 InVectorToLight,
 					 const in float3 InVectorToCamera,
 					 const in float InAttenuation,
 					 const in float InSpecularPower)
 {
-    const float3 VectorToLightProjectedToNormal = InWorldNormal * dot(InVectorToLight, InWorldNormal);
+    // The unnormalised vectors span world distances, they are only narrowed once they are directions.
+    const LightingFloat3 WorldNormal = (LightingFloat3) InWorldNormal;
+    const LightingFloat3 VectorToLight = (LightingFloat3) normalize(InVectorToLight);
+    const LightingFloat3 VectorToLightProjectedToNormal = WorldNormal * dot(VectorToLight, WorldNormal);
 
     // R = 2 * (L  N) - L
-    const float3 VectorToLightReflected = normalize(-InVectorToLight + 2.0f * VectorToLightProjectedToNormal);
-    const float3 VectorToCamera = normalize(InVectorToCamera);
+    const LightingFloat3 VectorToLightReflected = normalize(-VectorToLight + 2.0f * VectorToLightProjectedToNormal);
+    const LightingFloat3 VectorToCamera = (LightingFloat3) normalize(InVectorToCamera);
 
-    return InAttenuation * InSpecularColor * InSpecularIntensity * pow(max(0.0f, dot(VectorToLightReflected, VectorToCamera)), InSpecularPower);
-}
\ No newline at end of file
+    // Powers run into the thousands, the highlight is raised at full precision so it doesn't band or overflow.
+    const float Highlight = pow(max(0.0f, (float) dot(VectorToLightReflected, VectorToCamera)), InSpecularPower);
+    return InAttenuation * Highlight * ((LightingFloat3) InSpecularColor * (LightingFloat) InSpecularIntensity);
+}
+
+// AmbientOcclusion's full resolution result, no occlusion on frames its passes didn't run.
+Texture2D<float> AmbientOcclusion : register(t12);
+
+// The ambient light reaching the pixel at InPixelPosition, its SV_Position, from the irradiance volume inside it and from
+// the environment when there is one elsewhere.
+float3 CalcAmbient(const float3 InAmbientColor, const float3 InWorldPosition, const float3 InNormal, const float2 InPixelPosition)
+{
+    const float3 Ambient = CalcVolumeIrradiance(InWorldPosition, InNormal, bHasEnvironment ? CalcIrradiance(InNormal) : InAmbientColor);
+    return Ambient * AmbientOcclusion[(uint2) InPixelPosition];
+}
+
+// The reflection of the probe around InWorldPosition, or the environment's outside every probe, occluded like the
+// ambient light, before the surface's specular intensity and tint.
+float3 CalcReflection(const float3 InWorldPosition,
+                      const float3 InNormal,
+                      const float3 InVectorToCamera,
+                      const float InSpecularPower,
+                      const float2 InPixelPosition)
+{
+    const float3 Reflected = reflect(-normalize(InVectorToCamera), InNormal);
+    const float3 Environment = CalcEnvironmentSpecular(InNormal, InVectorToCamera, InSpecularPower);
+    return CalcProbeReflection(InWorldPosition, Reflected, InSpecularPower, Environment) * AmbientOcclusion[(uint2) InPixelPosition];
+}
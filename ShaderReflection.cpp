@@ -0,0 +1,57 @@
+﻿#include "ShaderReflection.h"
+#include <algorithm>
+#include <d3dcompiler.h>
+#include "ExceptionMacros.h"
+#include "wrl/client.h"
+
+ShaderReflection::ShaderReflection(ID3DBlob* InByteCode)
+{
+	HRESULT ResultHandle;
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> Reflector;
+
+	CHECK_HRESULT_EXCEPTION(D3DReflect(InByteCode->GetBufferPointer(), InByteCode->GetBufferSize(), IID_PPV_ARGS(&Reflector)))
+
+	D3D11_SHADER_DESC ShaderDesc;
+	CHECK_HRESULT_EXCEPTION(Reflector->GetDesc(&ShaderDesc))
+
+	Bindings.reserve(ShaderDesc.BoundResources);
+	InstructionNum = ShaderDesc.InstructionCount;
+
+	for (UINT Index = 0u; Index < ShaderDesc.BoundResources; ++Index)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC BindDesc;
+		CHECK_HRESULT_EXCEPTION(Reflector->GetResourceBindingDesc(Index, &BindDesc))
+
+		UINT Size = 0u;
+
+		if (BindDesc.Type == D3D_SIT_CBUFFER)
+		{
+			D3D11_SHADER_BUFFER_DESC BufferDesc;
+			CHECK_HRESULT_EXCEPTION(Reflector->GetConstantBufferByName(BindDesc.Name)->GetDesc(&BufferDesc))
+			Size = BufferDesc.Size;
+		}
+
+		Bindings.push_back({BindDesc.Name, BindDesc.Type, BindDesc.BindPoint, Size});
+	}
+
+	Reflector->GetThreadGroupSize(&ThreadGroupSize[0], &ThreadGroupSize[1], &ThreadGroupSize[2]);
+}
+
+const ShaderReflection::Binding* ShaderReflection::Find(const std::string_view InName, const D3D_SHADER_INPUT_TYPE InType) const noexcept
+{
+	const auto Found = std::find_if(Bindings.begin(), Bindings.end(), [&](const Binding& InBinding)
+	{
+		return InBinding.Type == InType && InBinding.Name == InName;
+	});
+
+	return Found == Bindings.end() ? nullptr : &*Found;
+}
+
+bool ShaderReflection::IsCoveredBy(const ShaderReflection& InOther) const noexcept
+{
+	return std::all_of(Bindings.begin(), Bindings.end(), [&](const Binding& InBinding)
+	{
+		const auto* const Other = InOther.Find(InBinding.Name, InBinding.Type);
+		return Other && Other->Slot == InBinding.Slot && Other->Size == InBinding.Size;
+	});
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11.h>
+#include <d3dcommon.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * What a compiled shader actually reads, taken from ID3D11ShaderReflection when the shader is created.
+ * The compiler strips resources the code never touches, so a name that can't be found is one nothing needs to upload or bind.
+ * Slots and constant buffer sizes come from here instead of being repeated by hand next to every C++ struct.
+ */
+class ShaderReflection
+{
+public:
+	struct Binding
+	{
+		std::string Name;
+		D3D_SHADER_INPUT_TYPE Type;
+		UINT Slot;
+		// Bytes for constant buffers, zero for everything else.
+		UINT Size;
+	};
+
+	ShaderReflection() = default;
+	explicit ShaderReflection(ID3DBlob* InByteCode);
+
+	// Null when the shader doesn't read it.
+	[[nodiscard]] const Binding* Find(std::string_view InName, D3D_SHADER_INPUT_TYPE InType) const noexcept;
+
+	[[nodiscard]] const Binding* FindConstantBuffer(const std::string_view InName) const noexcept
+	{
+		return Find(InName, D3D_SIT_CBUFFER);
+	}
+
+	[[nodiscard]] const Binding* FindTexture(const std::string_view InName) const noexcept
+	{
+		return Find(InName, D3D_SIT_TEXTURE);
+	}
+
+	[[nodiscard]] const Binding* FindSampler(const std::string_view InName) const noexcept
+	{
+		return Find(InName, D3D_SIT_SAMPLER);
+	}
+
+	// Whether everything this reads is bound the same way for the other, so a shader can replace another one under bound resources.
+	[[nodiscard]] bool IsCoveredBy(const ShaderReflection& InOther) const noexcept;
+
+	[[nodiscard]] const std::vector<Binding>& GetBindings() const noexcept
+	{
+		return Bindings;
+	}
+
+	// Of the compiled bytecode, what the shader complexity debug view colours by.
+	[[nodiscard]] UINT GetInstructionNum() const noexcept
+	{
+		return InstructionNum;
+	}
+
+	// The numthreads of a compute shader, zeros for every other stage.
+	[[nodiscard]] const std::array<UINT, 3>& GetThreadGroupSize() const noexcept
+	{
+		return ThreadGroupSize;
+	}
+
+private:
+	std::vector<Binding> Bindings;
+	std::array<UINT, 3> ThreadGroupSize {};
+	UINT InstructionNum {0u};
+};
@@ -0,0 +1,280 @@
+﻿#include "ShaderReloader.h"
+#include <algorithm>
+#include <cstring>
+#include <d3dcompiler.h>
+#include <exception>
+#include "BindManager.h"
+#include "Graphics.h"
+#include "InputLayout.h"
+#include "Logger.h"
+#include "PixelShader.h"
+#include "VertexShader.h"
+
+namespace
+{
+	bool IsShaderSource(const std::filesystem::path& InPath)
+	{
+		const auto Extension = InPath.extension();
+		return Extension == L".hlsl" || Extension == L".hlsli";
+	}
+
+	bool HasSameByteCode(ID3DBlob* InLeft, ID3DBlob* InRight) noexcept
+	{
+		return InLeft->GetBufferSize() == InRight->GetBufferSize() &&
+			   std::memcmp(InLeft->GetBufferPointer(), InRight->GetBufferPointer(), InLeft->GetBufferSize()) == 0;
+	}
+
+	void Report(const std::string& InMessage)
+	{
+		LOG_WARNING("Shader reload: {}", InMessage);
+	}
+}
+
+ShaderReloader::ShaderReloader(const Graphics& InGraphics)
+	: MyGraphics(InGraphics)
+{
+	// The first scan only records what is there.
+	(void)HaveSourcesChanged();
+	Watcher = std::thread(&ShaderReloader::WatchLoop, this);
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	{
+		std::lock_guard Lock(SleepMutex);
+		bIsStopping = true;
+	}
+
+	WakeCondition.notify_all();
+	Watcher.join();
+}
+
+void ShaderReloader::Apply() noexcept
+{
+	std::unique_lock Lock(PassMutex, std::try_to_lock);
+
+	if (!Lock || !bHasPendingPass)
+	{
+		return;
+	}
+
+	for (auto& [Target, Shader, ByteCode, Reflection] : PendingVertexShaders)
+	{
+		Target->Swap(std::move(Shader), std::move(ByteCode), std::move(Reflection));
+	}
+
+	for (auto& [Target, Shader, ByteCode, Reflection] : PendingPixelShaders)
+	{
+		Target->Swap(std::move(Shader), std::move(ByteCode), std::move(Reflection));
+	}
+
+	PendingVertexShaders.clear();
+	PendingPixelShaders.clear();
+	LastStatistics = PendingStatistics;
+	bHasPendingPass = false;
+}
+
+void ShaderReloader::WatchLoop()
+{
+	JobSystem::Get().JoinLane(JobLane::Background);
+	std::unique_lock Lock(SleepMutex);
+
+	while (!WakeCondition.wait_for(Lock, PollInterval, [this] { return bIsStopping; }))
+	{
+		Lock.unlock();
+
+		if (HaveSourcesChanged())
+		{
+			Rebuild();
+		}
+
+		Lock.lock();
+	}
+}
+
+bool ShaderReloader::HaveSourcesChanged()
+{
+	std::error_code Error;
+	bool bHasChanged = false;
+
+	for (const auto& File : std::filesystem::directory_iterator(std::filesystem::current_path(Error), Error))
+	{
+		if (!IsShaderSource(File.path()))
+		{
+			continue;
+		}
+
+		// Editors often replace the file, which can briefly fail the query.
+		const auto WriteTime = File.last_write_time(Error);
+		if (Error)
+		{
+			continue;
+		}
+
+		if (auto& Known = SourceTimes[File.path()]; Known != WriteTime)
+		{
+			bHasChanged = true;
+			Known = WriteTime;
+		}
+	}
+
+	return bHasChanged;
+}
+
+void ShaderReloader::Rebuild()
+{
+	std::lock_guard Lock(PassMutex);
+
+	// A pass nobody applied yet is superseded, its targets are rebuilt below anyway.
+	PendingVertexShaders.clear();
+	PendingPixelShaders.clear();
+	PendingStatistics = {};
+
+	const auto Layouts = BindManager::GetAll<InputLayout>();
+
+	for (const auto& Target : BindManager::GetAll<VertexShader>())
+	{
+		const auto ByteCode = Compile(Target->GetFileName(), Target->GetFeatures(), "vs_5_0");
+
+		if (!ByteCode)
+		{
+			++PendingStatistics.FailedNum;
+			continue;
+		}
+
+		if (HasSameByteCode(ByteCode.Get(), Target->GetByteCode()))
+		{
+			continue;
+		}
+
+		const auto bFitsLayouts = std::all_of(Layouts.begin(), Layouts.end(), [&](const std::shared_ptr<InputLayout>& InLayout)
+		{
+			return !InLayout->Accepts(MyGraphics, Target->GetByteCode()) || InLayout->Accepts(MyGraphics, ByteCode.Get());
+		});
+
+		if (!bFitsLayouts)
+		{
+			Report(Target->GetFileName() + " no longer fits the input layouts it is used with, keeping the old shader");
+			++PendingStatistics.FailedNum;
+			continue;
+		}
+
+		try
+		{
+			ShaderReflection Reflection(ByteCode.Get());
+
+			if (!Reflection.IsCoveredBy(Target->GetReflection()))
+			{
+				Report(Target->GetFileName() + " reads resources that aren't bound for it, keeping the old shader until it is loaded again");
+				++PendingStatistics.FailedNum;
+				continue;
+			}
+
+			PendingVertexShaders.push_back({Target, VertexShader::CreateShader(MyGraphics, ByteCode.Get()), ByteCode, std::move(Reflection)});
+			++PendingStatistics.ReloadedNum;
+		}
+		catch (const std::exception&)
+		{
+			++PendingStatistics.FailedNum;
+		}
+	}
+
+	for (const auto& Target : BindManager::GetAll<PixelShader>())
+	{
+		const auto ByteCode = Compile(Target->GetFileName(), Target->GetFeatures(), "ps_5_0");
+
+		if (!ByteCode)
+		{
+			++PendingStatistics.FailedNum;
+			continue;
+		}
+
+		if (HasSameByteCode(ByteCode.Get(), Target->GetByteCode()))
+		{
+			continue;
+		}
+
+		try
+		{
+			ShaderReflection Reflection(ByteCode.Get());
+
+			if (!Reflection.IsCoveredBy(Target->GetReflection()))
+			{
+				Report(Target->GetFileName() + " reads resources that aren't bound for it, keeping the old shader until it is loaded again");
+				++PendingStatistics.FailedNum;
+				continue;
+			}
+
+			PendingPixelShaders.push_back({Target, PixelShader::CreateShader(MyGraphics, ByteCode.Get()), ByteCode, std::move(Reflection)});
+			++PendingStatistics.ReloadedNum;
+		}
+		catch (const std::exception&)
+		{
+			++PendingStatistics.FailedNum;
+		}
+	}
+
+	bHasPendingPass = true;
+}
+
+Microsoft::WRL::ComPtr<ID3DBlob> ShaderReloader::Compile(const std::string& InName, const unsigned int InFeatures, const char* InProfile) const
+{
+	auto [SourceName, Defines] = MyGraphics.GetShaderBundle().FindSource(InName, InFeatures);
+	std::string FileName {SourceName};
+
+	// Not bundled, a loose X.cso is built from X.hlsl.
+	if (FileName.empty() && InName.ends_with(".cso"))
+	{
+		FileName = InName.substr(0u, InName.size() - 4u) + ".hlsl";
+	}
+
+	if (FileName.empty())
+	{
+		Report("no source known for " + InName);
+		return nullptr;
+	}
+
+	// "NAME=VALUE;NAME=VALUE" into the null terminated macro array the compiler takes.
+	std::vector<std::string> MacroStrings;
+	for (size_t Begin = 0u; Begin < Defines.size();)
+	{
+		const auto End = std::min(Defines.find(';', Begin), Defines.size());
+		const auto Define = Defines.substr(Begin, End - Begin);
+		const auto Equals = std::min(Define.find('='), Define.size());
+
+		if (!Define.empty())
+		{
+			MacroStrings.emplace_back(Define.substr(0u, Equals));
+			MacroStrings.emplace_back(Equals < Define.size() ? Define.substr(Equals + 1u) : "1");
+		}
+
+		Begin = End + 1u;
+	}
+
+	std::vector<D3D_SHADER_MACRO> Macros;
+	for (size_t Index = 0u; Index < MacroStrings.size(); Index += 2u)
+	{
+		Macros.push_back({MacroStrings[Index].c_str(), MacroStrings[Index + 1u].c_str()});
+	}
+
+	Macros.push_back({nullptr, nullptr});
+
+#ifndef NDEBUG
+	constexpr UINT CompileFlags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+	constexpr UINT CompileFlags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+	Microsoft::WRL::ComPtr<ID3DBlob> ByteCode;
+	Microsoft::WRL::ComPtr<ID3DBlob> Errors;
+
+	if (FAILED(D3DCompileFromFile(std::filesystem::path(FileName).c_str(), Macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+	                              "main", InProfile, CompileFlags, 0u, &ByteCode, &Errors)))
+	{
+		Report(FileName + " failed to compile, keeping the old shader" +
+		       (Errors ? "\n" + std::string(static_cast<const char*>(Errors->GetBufferPointer()), Errors->GetBufferSize()) : std::string{}));
+		return nullptr;
+	}
+
+	return ByteCode;
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <chrono>
+#include <condition_variable>
+#include <d3d11.h>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wrl/client.h"
+#include "ShaderReflection.h"
+
+class Graphics;
+class PixelShader;
+class VertexShader;
+
+/**
+ * Watch mode for shader sources. A background thread polls the .hlsl and .hlsli files in the working directory and after
+ * any change recompiles every vertex and pixel shader BindManager holds with D3DCompileFromFile, from the source and
+ * defines the shader bundle recorded for it. Includes aren't tracked, so an edit anywhere rebuilds them all, and shaders
+ * whose bytecode comes out unchanged are left alone.
+ * Replacements are swapped into the live bindables by Apply between frames, so recording threads never see a shader change
+ * halfway. A shader keeps its old version when it fails to compile, reads constant buffers or resources its old version
+ * didn't or at other slots or sizes, or, for vertex shaders, no longer fits an input layout its old version fit.
+ */
+class ShaderReloader
+{
+public:
+	struct Statistics
+	{
+		unsigned int ReloadedNum {0u};
+		unsigned int FailedNum {0u};
+	};
+
+	explicit ShaderReloader(const Graphics& InGraphics);
+	ShaderReloader(const ShaderReloader&) = delete;
+	ShaderReloader(ShaderReloader&&) = delete;
+	ShaderReloader& operator=(const ShaderReloader&) = delete;
+	ShaderReloader& operator=(ShaderReloader&&) = delete;
+	~ShaderReloader();
+
+	// Swaps in what the last pass built, on the main thread before anything records. Skipped while a pass is running.
+	void Apply() noexcept;
+
+	// Of the last pass that was applied.
+	[[nodiscard]] Statistics GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+private:
+	template<typename T, typename ShaderType>
+	struct Replacement
+	{
+		std::shared_ptr<T> Target;
+		Microsoft::WRL::ComPtr<ShaderType> Shader;
+		Microsoft::WRL::ComPtr<ID3DBlob> ByteCode;
+		ShaderReflection Reflection;
+	};
+
+	static constexpr auto PollInterval {std::chrono::milliseconds(500)};
+
+	void WatchLoop();
+	[[nodiscard]] bool HaveSourcesChanged();
+	void Rebuild();
+	[[nodiscard]] Microsoft::WRL::ComPtr<ID3DBlob> Compile(const std::string& InName, unsigned int InFeatures, const char* InProfile) const;
+
+private:
+	const Graphics& MyGraphics;
+	std::map<std::filesystem::path, std::filesystem::file_time_type> SourceTimes;
+
+	// Held by a whole rebuild pass, Apply only swaps when it gets it without waiting.
+	std::mutex PassMutex;
+	std::vector<Replacement<VertexShader, ID3D11VertexShader>> PendingVertexShaders;
+	std::vector<Replacement<PixelShader, ID3D11PixelShader>> PendingPixelShaders;
+	Statistics PendingStatistics;
+	bool bHasPendingPass {false};
+	Statistics LastStatistics;
+
+	std::mutex SleepMutex;
+	std::condition_variable WakeCondition;
+	bool bIsStopping {false};
+	std::thread Watcher;
+};
@@ -0,0 +1,6 @@
+// One triangle over the viewport at the far plane, which resets a shadow atlas tile to nothing casting into it.
+float4 main(const uint InVertexID : SV_VertexID) : SV_Position
+{
+    const float2 TextureCoordinate = float2((InVertexID << 1) & 2, InVertexID & 2);
+    return float4(TextureCoordinate * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 1.0f, 1.0f);
+}
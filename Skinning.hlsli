@@ -0,0 +1,11 @@
+// Linear blend skinning, shared by the shading and depth-only vertex shaders so both move a vertex exactly alike.
+// Palette matrices take the bind pose into the space of the node the mesh hangs off, the Model transform follows.
+StructuredBuffer<matrix> BonePalette : register(t1);
+
+matrix GetSkinTransform(const uint4 InBoneIndices, const float4 InBoneWeights)
+{
+    return BonePalette[InBoneIndices.x] * InBoneWeights.x +
+           BonePalette[InBoneIndices.y] * InBoneWeights.y +
+           BonePalette[InBoneIndices.z] * InBoneWeights.z +
+           BonePalette[InBoneIndices.w] * InBoneWeights.w;
+}
@@ -1,47 +1,44 @@
 ﻿#include "SolidSphere.h"
-#include "Sphere.h"
 #include "Bindables.h"
+#include "GeometryCache.h"
 
-SolidSphere::SolidSphere(Graphics& InGraphics, const float InRadius)
+SolidSphere::SolidSphere(const Graphics& InGraphics, const float InRadius)
+	: Radius(InRadius)
 {
-	struct Vertex
-	{
-		DirectX::XMFLOAT3 Position;
-	};
-
-	auto Model = Sphere::Make();
-	Model.Transform(DirectX::XMMatrixScaling(InRadius, InRadius, InRadius));
+	const auto& Geometry = GeometryCache::Get(GeometryCache::Shape::Sphere, {DV::VertexLayout::ElementType::Position3D});
+	const auto& Model = Geometry.Model;
 
-	const auto GeometryTag = "$sphere." + std::to_string(InRadius);
+	Bind(VertexBuffer::Resolve(InGraphics, Geometry.Tag, Model.Vertices));
 
-	Bind(VertexBuffer::Resolve(InGraphics, GeometryTag, Model.Vertices));
-
-	Bind(IndexBuffer::Resolve(InGraphics, GeometryTag, Model.Indices));
+	Bind(IndexBuffer::Resolve(InGraphics, Geometry.Tag, Model.Indices));
 
 	auto ModelVertexShader = VertexShader::Resolve(InGraphics, "SolidVS.cso");
 	auto ModelVertexShaderBlob = ModelVertexShader->GetByteCode();
 	Bind(std::move(ModelVertexShader));
 
-	Bind(PixelShader::Resolve(InGraphics, "SolidPS.cso"));
+	auto ModelPixelShader = PixelShader::Resolve(InGraphics, "SolidPS.cso");
+	Bind(ModelPixelShader);
 
 	struct PSColorConstants
 	{
 		DirectX::XMFLOAT3 color {1.0f,1.0f,1.0f};
-		float padding;
+		float padding {0.0f};
 	} ModelColorConstants;
 
-	Bind(PixelConstantBuffer<PSColorConstants>::Resolve(InGraphics, ModelColorConstants));
+	Bind(PixelConstantBuffer<PSColorConstants>::Resolve(InGraphics, ModelColorConstants, ModelPixelShader->GetReflection(), "PixelConstantBuffer"));
 
 	Bind(InputLayout::Resolve(InGraphics, Model.Vertices.GetLayout(), ModelVertexShaderBlob));
 
 	Bind(Topology::Resolve(InGraphics, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST));
 
 	Bind(std::make_shared<TransformConstantBuffer>(InGraphics, *this, TransformConstantBuffer::Target::Vertex));
+
+	BindDepthOnly(InGraphics);
 }
 
 DirectX::XMMATRIX SolidSphere::GetTransformMatrix() const noexcept
 {
-	return DirectX::XMMatrixTranslation(Position.x, Position.y, Position.z);
+	return DirectX::XMMatrixScaling(Radius, Radius, Radius) * DirectX::XMMatrixTranslation(Position.x, Position.y, Position.z);
 }
 
 void SolidSphere::SetPosition(const DirectX::XMFLOAT3& InPosition) noexcept
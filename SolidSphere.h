@@ -4,11 +4,13 @@
 class SolidSphere : public Drawable
 {
 public:
-	SolidSphere(Graphics& InGraphics, float InRadius);
+	// Every radius draws the cached unit sphere, scaled in the world matrix.
+	SolidSphere(const Graphics& InGraphics, float InRadius);
 
 	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept override;
 	void SetPosition(const DirectX::XMFLOAT3& InPosition) noexcept;
 
 private:
 	DirectX::XMFLOAT3 Position {1.0f,1.0f,1.0f};
+	float Radius;
 };
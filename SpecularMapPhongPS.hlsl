@@ -1,51 +1,63 @@
-cbuffer Light
-{
-    float3 Position;
-    float3 AmbientColor;
-    float3 DiffuseColor;
-    float DiffuseStrength;
-    float QuadraticAttenuation;
-    float LinearAttenuation;
-    float ConstantAttenuation;
-}
+#include "FrameConstants.hlsli"
+#include "PointLight.hlsli"
+#include "ShaderOperations.hlsli"
+#include "Decals.hlsli"
 
-cbuffer Material
+cbuffer Material : register(b1)
 {
     float SpecularIntensity;
     float SpecularPower;
     float Padding[2];
 }
 
-cbuffer Camera
-{
-    float3 CameraPosition;
-}
-
 Texture2D TextureMap;
 Texture2D SpecularMap;
 SamplerState Sampler;
 
 float4 main(const float3 InWorldPosition : Position, const float3 InNormal : Normal,
-            const float2 InTextureCoordinate : TexCoord) : SV_TARGET
+            const float2 InTextureCoordinate : TexCoord, const float4 InPixelPosition : SV_Position) : SV_TARGET
 {
-    const float3 VectorToLight = Position - InWorldPosition;
-    const float DistanceToLight = length(VectorToLight);
-    const float3 DirectionToLight = VectorToLight / DistanceToLight;
+    const float4 SpecularSample = SpecularMap.Sample(Sampler, InTextureCoordinate);
+    const float3 SpecularReflectionColor = SpecularSample.rgb;
+    const float  SpecularPower = pow(2.0f, SpecularSample.a * 13.0f);
+    const float3 DirectionToCamera = normalize(CameraPosition - InWorldPosition);
 
-    const float Attenuation = 1.0f / (QuadraticAttenuation * (DistanceToLight * DistanceToLight) +
-							  LinearAttenuation * DistanceToLight +
-							  ConstantAttenuation);
+    float3 Diffuse = float3(0.0f, 0.0f, 0.0f);
+    float3 Specular = float3(0.0f, 0.0f, 0.0f);
 
-    const float3 Diffuse = DiffuseColor * DiffuseStrength * Attenuation * max(0.0f, dot(DirectionToLight, InNormal));
+    const ClusterLights Cluster = GetClusterLights(InPixelPosition.xy, InWorldPosition);
 
-    const float3 VectorToLightProjectedToNormal = InNormal * dot(VectorToLight, InNormal);
-    // R = 2 * (L  N) - L
-    const float3 VectorToLightReflected = -VectorToLight + 2.0f * VectorToLightProjectedToNormal;
+    for (uint Index = 0u; Index < Cluster.Num; ++Index)
+    {
+        const PointLightData Light = GetClusterLight(Cluster, Index);
 
-    const float4 SpecularSample = SpecularMap.Sample(Sampler, InTextureCoordinate);
-    const float3 SpecularReflectionColor = SpecularSample.rgb;
-    const float  SpecularPower = pow(2.0f, SpecularSample.a * 13.0f);
-    const float3 Specular = Attenuation * (DiffuseColor * DiffuseStrength) * pow(max(0.0f, dot(normalize(VectorToLightReflected), normalize(CameraPosition - InWorldPosition))), SpecularPower);
+        const float3 VectorToLight = Light.WorldPosition - InWorldPosition;
+        const float DistanceToLight = length(VectorToLight);
+
+        if (DistanceToLight >= Light.Range)
+        {
+            continue;
+        }
+
+        const float3 DirectionToLight = VectorToLight / DistanceToLight;
+
+        const float Attenuation = GetShadowFactor(Light, VectorToLight) / (Light.QuadraticAttenuation * (DistanceToLight * DistanceToLight) +
+								  Light.LinearAttenuation * DistanceToLight +
+								  Light.ConstantAttenuation);
+
+        Diffuse += Light.DiffuseColor * Light.DiffuseStrength * Attenuation * max(0.0f, dot(DirectionToLight, InNormal));
 
-    return float4(saturate((Diffuse + AmbientColor) * TextureMap.Sample(Sampler, InTextureCoordinate).rgb + Specular * SpecularReflectionColor), 1.0f);
-}
\ No newline at end of file
+        const float3 VectorToLightProjectedToNormal = InNormal * dot(VectorToLight, InNormal);
+        // R = 2 * (L  N) - L
+        const float3 VectorToLightReflected = -VectorToLight + 2.0f * VectorToLightProjectedToNormal;
+        Specular += Attenuation * (Light.DiffuseColor * Light.DiffuseStrength) * pow(max(0.0f, dot(normalize(VectorToLightReflected), DirectionToCamera)), SpecularPower);
+    }
+
+    // Tinted by the map below like the highlights.
+    Specular += CalcReflection(InWorldPosition, InNormal, DirectionToCamera, SpecularPower, InPixelPosition.xy);
+
+    const float3 Albedo = ApplyDecals(SrgbToLinear(TextureMap.Sample(Sampler, InTextureCoordinate).rgb), InPixelPosition.xy, InWorldPosition, InNormal,
+                                      ddx(InWorldPosition), ddy(InWorldPosition));
+
+    return float4((Diffuse + CalcAmbient(AmbientColor, InWorldPosition, InNormal, InPixelPosition.xy)) * Albedo + Specular * SpecularReflectionColor, 1.0f);
+}
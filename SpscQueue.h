@@ -0,0 +1,69 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <utility>
+
+/**
+ * Fixed capacity queue for exactly one producer thread and one consumer thread, without locks or heap allocations.
+ * The window procedure pushes and the render loop pops, whether or not they share a thread.
+ * A full queue refuses the push, so under overflow the newest events are the ones dropped.
+ */
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity > 0u && (Capacity & (Capacity - 1u)) == 0u, "SpscQueue capacity must be a power of two");
+
+public:
+	// Producer only, false when the queue is full.
+	template<typename... Arguments>
+	bool Push(Arguments&&... InArguments) noexcept
+	{
+		const auto CurrentTail = Tail.load(std::memory_order_relaxed);
+
+		if (CurrentTail - Head.load(std::memory_order_acquire) == Capacity)
+		{
+			return false;
+		}
+
+		Elements[CurrentTail & (Capacity - 1u)] = T(std::forward<Arguments>(InArguments)...);
+		Tail.store(CurrentTail + 1u, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer only.
+	std::optional<T> Pop() noexcept
+	{
+		const auto CurrentHead = Head.load(std::memory_order_relaxed);
+
+		if (CurrentHead == Tail.load(std::memory_order_acquire))
+		{
+			return std::nullopt;
+		}
+
+		std::optional<T> Element {Elements[CurrentHead & (Capacity - 1u)]};
+		Head.store(CurrentHead + 1u, std::memory_order_release);
+
+		return Element;
+	}
+
+	// Consumer only, drops everything pushed so far.
+	void Clear() noexcept
+	{
+		Head.store(Tail.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	[[nodiscard]] bool IsEmpty() const noexcept
+	{
+		return Head.load(std::memory_order_acquire) == Tail.load(std::memory_order_acquire);
+	}
+
+private:
+	std::array<T, Capacity> Elements {};
+	// Kept on separate cache lines so the two threads do not invalidate each other on every event.
+	alignas(std::hardware_destructive_interference_size) std::atomic<size_t> Head {0u};
+	alignas(std::hardware_destructive_interference_size) std::atomic<size_t> Tail {0u};
+};
@@ -0,0 +1,191 @@
+﻿#include "StartupTimeline.h"
+#include "EngineWin.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include "Logger.h"
+
+namespace
+{
+	using Clock = StartupTimeline::Clock;
+
+	struct Record
+	{
+		const char* Name {nullptr};
+		Clock::time_point Start {};
+		Clock::time_point End {};
+		DWORD ThreadId {0u};
+		// Set last, a record is only read once it is.
+		std::atomic<bool> bIsWritten {false};
+	};
+
+	std::array<Record, StartupTimeline::MaxPhaseNum> Records;
+	std::atomic<unsigned int> ClaimedNum {0u};
+	std::atomic<bool> bHasFirstFrame {false};
+	std::atomic<Clock::rep> FirstFrameTicks {0};
+
+	// Process creation in steady clock time, so what ran before main and the loader count too.
+	Clock::time_point GetProcessStart() noexcept
+	{
+		static const auto Start = []
+		{
+			FILETIME Creation;
+			FILETIME Exit;
+			FILETIME Kernel;
+			FILETIME User;
+			FILETIME Now;
+			GetSystemTimePreciseAsFileTime(&Now);
+			const auto SteadyNow = Clock::now();
+
+			if (!GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User))
+			{
+				return SteadyNow;
+			}
+
+			const auto ToTicks = [](const FILETIME& InTime)
+			{
+				return static_cast<long long>(InTime.dwHighDateTime) << 32 | InTime.dwLowDateTime;
+			};
+
+			// FILETIME counts in 100 ns.
+			const std::chrono::duration<long long, std::ratio<1, 10000000>> Elapsed {std::max(ToTicks(Now) - ToTicks(Creation), 0ll)};
+			return SteadyNow - std::chrono::duration_cast<Clock::duration>(Elapsed);
+		}();
+
+		return Start;
+	}
+
+	float ToMilliseconds(const Clock::time_point InTime) noexcept
+	{
+		return std::chrono::duration<float, std::milli>(InTime - GetProcessStart()).count();
+	}
+
+	void Add(const char* InName, const Clock::time_point InStart, const Clock::time_point InEnd) noexcept
+	{
+		const auto Index = ClaimedNum.fetch_add(1u, std::memory_order_relaxed);
+
+		if (Index >= Records.size())
+		{
+			return;
+		}
+
+		auto& Added = Records[Index];
+		Added.Name = InName;
+		Added.Start = InStart;
+		Added.End = InEnd;
+		Added.ThreadId = GetCurrentThreadId();
+		Added.bIsWritten.store(true, std::memory_order_release);
+	}
+
+	void LogLate(const char* InName, const Clock::time_point InStart, const Clock::time_point InEnd)
+	{
+		LOG_INFO("Startup: {} from {} to {} ms, after the first frame", InName, ToMilliseconds(InStart), ToMilliseconds(InEnd));
+	}
+}
+
+StartupTimeline::Phase::Phase(const char* InName) noexcept
+	: Name(InName), Start(Clock::now()), bIsRecorded(!bHasFirstFrame.load(std::memory_order_acquire))
+{
+	GetProcessStart();
+}
+
+StartupTimeline::Phase::~Phase()
+{
+	if (!bIsRecorded)
+	{
+		return;
+	}
+
+	const auto End = Clock::now();
+
+	if (bHasFirstFrame.load(std::memory_order_acquire))
+	{
+		LogLate(Name, Start, End);
+	}
+	else
+	{
+		Add(Name, Start, End);
+	}
+}
+
+void StartupTimeline::Mark(const char* InName) noexcept
+{
+	const auto Now = Clock::now();
+
+	if (bHasFirstFrame.load(std::memory_order_acquire))
+	{
+		LogLate(InName, Now, Now);
+	}
+	else
+	{
+		Add(InName, Now, Now);
+	}
+}
+
+void StartupTimeline::MarkFirstFrame() noexcept
+{
+	const auto Now = Clock::now();
+
+	if (bHasFirstFrame.load(std::memory_order_relaxed) || bHasFirstFrame.exchange(true, std::memory_order_acq_rel))
+	{
+		return;
+	}
+
+	FirstFrameTicks.store((Now - GetProcessStart()).count(), std::memory_order_relaxed);
+
+	// Phases claimed before are done writing by now, or end late and are logged on their own.
+	std::array<const Record*, MaxPhaseNum> Sorted {};
+	unsigned int SortedNum = 0u;
+
+	for (const auto& Recorded : Records)
+	{
+		if (Recorded.bIsWritten.load(std::memory_order_acquire))
+		{
+			Sorted[SortedNum++] = &Recorded;
+		}
+	}
+
+	std::sort(Sorted.begin(), Sorted.begin() + SortedNum, [](const Record* InLeft, const Record* InRight)
+	{
+		return InLeft->Start < InRight->Start;
+	});
+
+	LOG_INFO("Startup: first frame {} ms after the process was created", ToMilliseconds(Now));
+
+	// How much of the phases ran side by side, the sum of their lengths against the time any of them ran.
+	Clock::duration Summed {};
+	Clock::duration Covered {};
+	Clock::time_point CoveredUntil {};
+	const auto MainThreadId = GetCurrentThreadId();
+
+	for (unsigned int Index = 0u; Index < SortedNum; ++Index)
+	{
+		const auto& [Name, Start, End, ThreadId, bIsWritten] = *Sorted[Index];
+
+		if (ThreadId == MainThreadId)
+		{
+			LOG_INFO("Startup: {} from {} to {} ms", Name, ToMilliseconds(Start), ToMilliseconds(End));
+		}
+		else
+		{
+			LOG_INFO("Startup: {} from {} to {} ms on thread {}", Name, ToMilliseconds(Start), ToMilliseconds(End), ThreadId);
+		}
+
+		Summed += End - Start;
+		Covered += std::max(End, CoveredUntil) - std::max(Start, CoveredUntil);
+		CoveredUntil = std::max(End, CoveredUntil);
+	}
+
+	if (ClaimedNum.load(std::memory_order_relaxed) > MaxPhaseNum)
+	{
+		LOG_WARNING("Startup: {} phases over the limit were not recorded", ClaimedNum.load(std::memory_order_relaxed) - MaxPhaseNum);
+	}
+
+	LOG_INFO("Startup: phases took {} ms, {} ms of it overlapped", std::chrono::duration<float, std::milli>(Summed).count(),
+	         std::chrono::duration<float, std::milli>(Summed - Covered).count());
+}
+
+float StartupTimeline::GetTimeToFirstFrame() noexcept
+{
+	return std::chrono::duration<float, std::milli>(Clock::duration(FirstFrameTicks.load(std::memory_order_relaxed))).count();
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <chrono>
+
+#define STARTUP_CONCAT_IMPL(InLeft, InRight) InLeft##InRight
+#define STARTUP_CONCAT(InLeft, InRight) STARTUP_CONCAT_IMPL(InLeft, InRight)
+// Records the enclosing block as a phase of startup when it starts before the first frame, the name must be a string literal.
+// Phases aren't nested, the overlap is measured between whatever phases ran at the same time.
+#define STARTUP_PHASE(InName) const StartupTimeline::Phase STARTUP_CONCAT(StartupPhase, __LINE__) {InName}
+
+/**
+ * Where the time from process creation to the first presented frame goes, phase by phase and on which thread, so the phases
+ * that overlap and the ones left in the way show. Usable from static initializers on, it keeps its records in a fixed array
+ * and never allocates. MarkFirstFrame logs the timeline, phases still running then are logged as they end.
+ */
+class StartupTimeline
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	class Phase
+	{
+	public:
+		explicit Phase(const char* InName) noexcept;
+		Phase(const Phase&) = delete;
+		Phase(Phase&&) = delete;
+		Phase& operator=(const Phase&) = delete;
+		Phase& operator=(Phase&&) = delete;
+		~Phase();
+
+	private:
+		const char* Name;
+		Clock::time_point Start;
+		bool bIsRecorded;
+	};
+
+	// A moment of startup, such as the first model becoming ready, logged like a phase of no length.
+	static void Mark(const char* InName) noexcept;
+	// Called after every present, only the first call counts.
+	static void MarkFirstFrame() noexcept;
+
+	// Since the process was created, zero before the first frame.
+	[[nodiscard]] static float GetTimeToFirstFrame() noexcept;
+
+	// Phases past it go unrecorded.
+	static constexpr unsigned int MaxPhaseNum {64u};
+};
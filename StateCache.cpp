@@ -0,0 +1,454 @@
+﻿#include "StateCache.h"
+#include <algorithm>
+#include <cassert>
+#include "CommandRecorder.h"
+
+StateCache::StateCache(ID3D11DeviceContext* InContext, ID3D11DeviceContext1* InContext1) noexcept
+	: Context(InContext)
+	, Context1(InContext1)
+{
+	assert(Context);
+}
+
+void StateCache::SetPrimitiveTopology(const D3D11_PRIMITIVE_TOPOLOGY InTopology) noexcept
+{
+	if (ShouldIssue(StateType::Topology, Topology, InTopology))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::Topology, {static_cast<UINT>(InTopology)});
+		}
+
+		Context->IASetPrimitiveTopology(InTopology);
+	}
+
+	// Left bound, the stages would fail every later draw that never heard of them.
+	if (InTopology < D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST)
+	{
+		SetHullShader(nullptr);
+		SetDomainShader(nullptr);
+	}
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* InInputLayout) noexcept
+{
+	if (ShouldIssue(StateType::InputLayout, InputLayout, InInputLayout))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::InputLayout, {GetTraceId(InInputLayout)});
+		}
+
+		Context->IASetInputLayout(InInputLayout);
+	}
+}
+
+void StateCache::SetVertexBuffer(const UINT InSlot, ID3D11Buffer* InBuffer, const UINT InStride, const UINT InOffset) noexcept
+{
+	assert(InSlot < VertexBufferSlotNum);
+
+	if (ShouldIssue(StateType::VertexBuffer, VertexBuffers[InSlot], {InBuffer, InStride, InOffset}))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::VertexBuffer, {InSlot, GetTraceId(InBuffer), InStride, InOffset});
+		}
+
+		Context->IASetVertexBuffers(InSlot, 1u, &InBuffer, &InStride, &InOffset);
+	}
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* InBuffer, const DXGI_FORMAT InFormat, const UINT InOffset) noexcept
+{
+	if (ShouldIssue(StateType::IndexBuffer, IndexBuffer, {InBuffer, InFormat, InOffset}))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::IndexBuffer, {GetTraceId(InBuffer), static_cast<UINT>(InFormat), InOffset});
+		}
+
+		Context->IASetIndexBuffer(InBuffer, InFormat, InOffset);
+	}
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* InShader) noexcept
+{
+	if (ShouldIssue(StateType::Shader, VertexShader, InShader))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::VertexShader, {GetTraceId(InShader)});
+		}
+
+		Context->VSSetShader(InShader, nullptr, 0u);
+	}
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* InShader) noexcept
+{
+	if (ShouldIssue(StateType::Shader, PixelShader, InShader))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::PixelShader, {GetTraceId(InShader)});
+		}
+
+		Context->PSSetShader(InShader, nullptr, 0u);
+	}
+}
+
+void StateCache::SetHullShader(ID3D11HullShader* InShader) noexcept
+{
+	if (ShouldIssue(StateType::Shader, HullShader, InShader))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::HullShader, {GetTraceId(InShader)});
+		}
+
+		Context->HSSetShader(InShader, nullptr, 0u);
+	}
+}
+
+void StateCache::SetDomainShader(ID3D11DomainShader* InShader) noexcept
+{
+	if (ShouldIssue(StateType::Shader, DomainShader, InShader))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::DomainShader, {GetTraceId(InShader)});
+		}
+
+		Context->DSSetShader(InShader, nullptr, 0u);
+	}
+}
+
+void StateCache::SetVertexConstantBuffer(const UINT InSlot, ID3D11Buffer* InBuffer, const UINT InFirstConstant, const UINT InConstantNum) noexcept
+{
+	assert(InSlot < ConstantBufferSlotNum);
+	assert((InConstantNum == 0u || Context1) && "Constant buffer ranges need a D3D11.1 context");
+
+	if (ShouldIssue(StateType::ConstantBuffer, VertexConstantBuffers[InSlot], {InBuffer, InFirstConstant, InConstantNum}))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::VertexConstantBuffer, {InSlot, GetTraceId(InBuffer), InFirstConstant, InConstantNum});
+		}
+
+		if (InConstantNum)
+		{
+			Context1->VSSetConstantBuffers1(InSlot, 1u, &InBuffer, &InFirstConstant, &InConstantNum);
+		}
+		else
+		{
+			Context->VSSetConstantBuffers(InSlot, 1u, &InBuffer);
+		}
+	}
+}
+
+void StateCache::SetVertexShaderResource(const UINT InSlot, ID3D11ShaderResourceView* InView) noexcept
+{
+	assert(InSlot < ShaderResourceSlotNum);
+
+	if (ShouldIssue(StateType::ShaderResource, VertexShaderResources[InSlot], InView))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::VertexShaderResource, {InSlot, GetTraceId(InView)});
+		}
+
+		Context->VSSetShaderResources(InSlot, 1u, &InView);
+	}
+}
+
+void StateCache::SetPixelConstantBuffer(const UINT InSlot, ID3D11Buffer* InBuffer, const UINT InFirstConstant, const UINT InConstantNum) noexcept
+{
+	assert(InSlot < ConstantBufferSlotNum);
+	assert((InConstantNum == 0u || Context1) && "Constant buffer ranges need a D3D11.1 context");
+
+	if (ShouldIssue(StateType::ConstantBuffer, PixelConstantBuffers[InSlot], {InBuffer, InFirstConstant, InConstantNum}))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::PixelConstantBuffer, {InSlot, GetTraceId(InBuffer), InFirstConstant, InConstantNum});
+		}
+
+		if (InConstantNum)
+		{
+			Context1->PSSetConstantBuffers1(InSlot, 1u, &InBuffer, &InFirstConstant, &InConstantNum);
+		}
+		else
+		{
+			Context->PSSetConstantBuffers(InSlot, 1u, &InBuffer);
+		}
+	}
+}
+
+void StateCache::SetPixelShaderResource(const UINT InSlot, ID3D11ShaderResourceView* InView) noexcept
+{
+	assert(InSlot < ShaderResourceSlotNum);
+
+	if (ShouldIssue(StateType::ShaderResource, PixelShaderResources[InSlot], InView))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::PixelShaderResource, {InSlot, GetTraceId(InView)});
+		}
+
+		Context->PSSetShaderResources(InSlot, 1u, &InView);
+	}
+}
+
+void StateCache::SetPixelSampler(const UINT InSlot, ID3D11SamplerState* InSampler) noexcept
+{
+	assert(InSlot < SamplerSlotNum);
+
+	if (ShouldIssue(StateType::Sampler, PixelSamplers[InSlot], InSampler))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::PixelSampler, {InSlot, GetTraceId(InSampler)});
+		}
+
+		Context->PSSetSamplers(InSlot, 1u, &InSampler);
+	}
+}
+
+void StateCache::SetHullConstantBuffer(const UINT InSlot, ID3D11Buffer* InBuffer) noexcept
+{
+	assert(InSlot < ConstantBufferSlotNum);
+
+	if (ShouldIssue(StateType::ConstantBuffer, HullConstantBuffers[InSlot], InBuffer))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::HullConstantBuffer, {InSlot, GetTraceId(InBuffer)});
+		}
+
+		Context->HSSetConstantBuffers(InSlot, 1u, &InBuffer);
+	}
+}
+
+void StateCache::SetDomainConstantBuffer(const UINT InSlot, ID3D11Buffer* InBuffer) noexcept
+{
+	assert(InSlot < ConstantBufferSlotNum);
+
+	if (ShouldIssue(StateType::ConstantBuffer, DomainConstantBuffers[InSlot], InBuffer))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::DomainConstantBuffer, {InSlot, GetTraceId(InBuffer)});
+		}
+
+		Context->DSSetConstantBuffers(InSlot, 1u, &InBuffer);
+	}
+}
+
+void StateCache::SetDomainShaderResource(const UINT InSlot, ID3D11ShaderResourceView* InView) noexcept
+{
+	assert(InSlot < ShaderResourceSlotNum);
+
+	if (ShouldIssue(StateType::ShaderResource, DomainShaderResources[InSlot], InView))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::DomainShaderResource, {InSlot, GetTraceId(InView)});
+		}
+
+		Context->DSSetShaderResources(InSlot, 1u, &InView);
+	}
+}
+
+void StateCache::SetDomainSampler(const UINT InSlot, ID3D11SamplerState* InSampler) noexcept
+{
+	assert(InSlot < SamplerSlotNum);
+
+	if (ShouldIssue(StateType::Sampler, DomainSamplers[InSlot], InSampler))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::DomainSampler, {InSlot, GetTraceId(InSampler)});
+		}
+
+		Context->DSSetSamplers(InSlot, 1u, &InSampler);
+	}
+}
+
+void StateCache::SetRasterizerState(ID3D11RasterizerState* InState) noexcept
+{
+	if (ShouldIssue(StateType::Rasterizer, RasterizerState, InState))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::Rasterizer, {GetTraceId(InState)});
+		}
+
+		Context->RSSetState(InState);
+	}
+}
+
+void StateCache::SetBlendState(ID3D11BlendState* InState) noexcept
+{
+	if (ShouldIssue(StateType::Blend, BlendState, InState))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::Blend, {GetTraceId(InState)});
+		}
+
+		Context->OMSetBlendState(InState, nullptr, 0xFFFFFFFFu);
+	}
+}
+
+void StateCache::SetDepthStencilState(ID3D11DepthStencilState* InState, const UINT InStencilReference) noexcept
+{
+	if (ShouldIssue(StateType::DepthStencil, DepthStencil, {InState, InStencilReference}))
+	{
+		if (Recorder)
+		{
+			Record(CommandTrace::Op::DepthStencil, {GetTraceId(InState), InStencilReference});
+		}
+
+		Context->OMSetDepthStencilState(InState, InStencilReference);
+	}
+}
+
+void StateCache::SetRenderTarget(ID3D11RenderTargetView* InRenderTargetView, ID3D11DepthStencilView* InDepthStencilView) noexcept
+{
+	SetRenderTargets({&InRenderTargetView, InRenderTargetView ? 1u : 0u}, InDepthStencilView);
+}
+
+void StateCache::SetRenderTargets(const std::span<ID3D11RenderTargetView* const> InRenderTargetViews, ID3D11DepthStencilView* InDepthStencilView) noexcept
+{
+	assert(InRenderTargetViews.size() <= MaxRenderTargetNum && "Too many render targets");
+
+	RenderTargetBinding Binding {};
+	Binding.RenderTargetNum = static_cast<UINT>(InRenderTargetViews.size());
+	Binding.DepthStencilView = InDepthStencilView;
+	std::copy(InRenderTargetViews.begin(), InRenderTargetViews.end(), Binding.RenderTargetViews.begin());
+
+	if (ShouldIssue(StateType::RenderTarget, RenderTarget, Binding))
+	{
+		if (Recorder)
+		{
+			Recorded.push_back(CommandTrace::MakeCommand(CommandTrace::Op::RenderTargets, Binding.RenderTargetNum + 1u));
+			Recorded.push_back(GetTraceId(InDepthStencilView));
+
+			for (UINT Index = 0u; Index < Binding.RenderTargetNum; ++Index)
+			{
+				Recorded.push_back(GetTraceId(Binding.RenderTargetViews[Index]));
+			}
+		}
+
+		Context->OMSetRenderTargets(Binding.RenderTargetNum, Binding.RenderTargetViews.data(), InDepthStencilView);
+	}
+}
+
+const char* StateCache::GetStateTypeName(const StateType InType) noexcept
+{
+	switch (InType)
+	{
+		case StateType::Topology:
+			return "Topology";
+		case StateType::InputLayout:
+			return "Input layout";
+		case StateType::VertexBuffer:
+			return "Vertex buffer";
+		case StateType::IndexBuffer:
+			return "Index buffer";
+		case StateType::Shader:
+			return "Shader";
+		case StateType::ConstantBuffer:
+			return "Constant buffer";
+		case StateType::ShaderResource:
+			return "Shader resource";
+		case StateType::Sampler:
+			return "Sampler";
+		case StateType::Rasterizer:
+			return "Rasterizer";
+		case StateType::Blend:
+			return "Blend";
+		case StateType::DepthStencil:
+			return "Depth stencil";
+		case StateType::RenderTarget:
+			return "Render target";
+		default:
+			assert(false && "Unknown state type");
+			return "";
+	}
+}
+
+UINT StateCache::GetTriangleNum(const UINT InIndexNum) const noexcept
+{
+	switch (Topology)
+	{
+		case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+			return InIndexNum / 3u;
+		case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+			return InIndexNum > 2u ? InIndexNum - 2u : 0u;
+		case D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST:
+			return InIndexNum / 3u;
+		default:
+			return 0u;
+	}
+}
+
+void StateCache::BeginFrame() noexcept
+{
+	LastFrameStatistics = CurrentStatistics;
+	CurrentStatistics = {};
+}
+
+void StateCache::Reset() noexcept
+{
+	if (Recorder)
+	{
+		Record(CommandTrace::Op::Reset, {});
+	}
+
+	++ResetNum;
+
+	Topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	InputLayout = nullptr;
+	VertexBuffers = {};
+	IndexBuffer = {};
+	VertexShader = nullptr;
+	PixelShader = nullptr;
+	HullShader = nullptr;
+	DomainShader = nullptr;
+	VertexConstantBuffers = {};
+	PixelConstantBuffers = {};
+	VertexShaderResources = {};
+	PixelShaderResources = {};
+	PixelSamplers = {};
+	HullConstantBuffers = {};
+	DomainConstantBuffers = {};
+	DomainShaderResources = {};
+	DomainSamplers = {};
+	RasterizerState = nullptr;
+	BlendState = nullptr;
+	DepthStencil = {};
+	RenderTarget = {};
+}
+
+void StateCache::SetRecorder(CommandRecorder* InRecorder) noexcept
+{
+	Recorder = InRecorder;
+	Recorded.clear();
+}
+
+void StateCache::Record(const CommandTrace::Op InOp, const std::initializer_list<UINT> InOperands)
+{
+	Recorded.push_back(CommandTrace::MakeCommand(InOp, static_cast<UINT>(InOperands.size())));
+	Recorded.insert(Recorded.end(), InOperands);
+}
+
+void StateCache::AppendRecorded(const std::span<const UINT> InWords)
+{
+	Recorded.insert(Recorded.end(), InWords.begin(), InWords.end());
+}
+
+UINT StateCache::GetTraceId(IUnknown* InObject) const
+{
+	return InObject ? Recorder->GetId(InObject) : CommandTrace::NullId;
+}
@@ -0,0 +1,278 @@
+﻿#pragma once
+#include <array>
+#include <d3d11_1.h>
+#include <initializer_list>
+#include <span>
+#include <utility>
+#include <vector>
+#include "CommandTrace.h"
+
+class CommandRecorder;
+
+class StateCache
+{
+public:
+	// What each issued call changed, GetStatistics breaks IssuedCalls down by these.
+	enum class StateType : unsigned char
+	{
+		Topology,
+		InputLayout,
+		VertexBuffer,
+		IndexBuffer,
+		Shader,
+		ConstantBuffer,
+		ShaderResource,
+		Sampler,
+		Rasterizer,
+		Blend,
+		DepthStencil,
+		RenderTarget,
+		Num
+	};
+
+	static constexpr size_t StateTypeNum {static_cast<size_t>(StateType::Num)};
+	static constexpr size_t MaxRenderTargetNum {4u};
+
+	struct Statistics
+	{
+		unsigned int IssuedCalls {0u};
+		unsigned int SavedCalls {0u};
+		unsigned int DrawCalls {0u};
+		// Submitted, before any culling the GPU does, indirect draws are not counted since their arguments stay on the GPU.
+		unsigned long long Triangles {0u};
+		// Written through Map, the constant buffer ring reports its own bytes.
+		unsigned long long ConstantBytes {0u};
+		// Updates that found the buffer already holding the same contents and didn't map it.
+		unsigned int SkippedUploads {0u};
+		std::array<unsigned int, StateTypeNum> IssuedCallsByType {};
+
+		Statistics& operator+=(const Statistics& InOther) noexcept
+		{
+			IssuedCalls += InOther.IssuedCalls;
+			SavedCalls += InOther.SavedCalls;
+			DrawCalls += InOther.DrawCalls;
+			Triangles += InOther.Triangles;
+			ConstantBytes += InOther.ConstantBytes;
+			SkippedUploads += InOther.SkippedUploads;
+
+			for (size_t Index = 0u; Index < StateTypeNum; ++Index)
+			{
+				IssuedCallsByType[Index] += InOther.IssuedCallsByType[Index];
+			}
+
+			return *this;
+		}
+	};
+
+	[[nodiscard]] static const char* GetStateTypeName(StateType InType) noexcept;
+
+	explicit StateCache(ID3D11DeviceContext* InContext, ID3D11DeviceContext1* InContext1 = nullptr) noexcept;
+	StateCache(const StateCache&) = delete;
+	StateCache(StateCache&&) = delete;
+	StateCache& operator=(const StateCache&) = delete;
+	StateCache& operator=(StateCache&&) = delete;
+	~StateCache() = default;
+
+	void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY InTopology) noexcept;
+	void SetInputLayout(ID3D11InputLayout* InInputLayout) noexcept;
+	void SetVertexBuffer(UINT InSlot, ID3D11Buffer* InBuffer, UINT InStride, UINT InOffset = 0u) noexcept;
+	void SetIndexBuffer(ID3D11Buffer* InBuffer, DXGI_FORMAT InFormat, UINT InOffset = 0u) noexcept;
+	void SetVertexShader(ID3D11VertexShader* InShader) noexcept;
+	void SetPixelShader(ID3D11PixelShader* InShader) noexcept;
+	// Tessellation only runs on patch lists, switching to any other topology unbinds both stages.
+	void SetHullShader(ID3D11HullShader* InShader) noexcept;
+	void SetDomainShader(ID3D11DomainShader* InShader) noexcept;
+	// A zero constant count binds the whole buffer, otherwise the range is bound through the D3D11.1 context.
+	void SetVertexConstantBuffer(UINT InSlot, ID3D11Buffer* InBuffer, UINT InFirstConstant = 0u, UINT InConstantNum = 0u) noexcept;
+	void SetVertexShaderResource(UINT InSlot, ID3D11ShaderResourceView* InView) noexcept;
+	void SetPixelConstantBuffer(UINT InSlot, ID3D11Buffer* InBuffer, UINT InFirstConstant = 0u, UINT InConstantNum = 0u) noexcept;
+	void SetPixelShaderResource(UINT InSlot, ID3D11ShaderResourceView* InView) noexcept;
+	void SetPixelSampler(UINT InSlot, ID3D11SamplerState* InSampler) noexcept;
+	void SetHullConstantBuffer(UINT InSlot, ID3D11Buffer* InBuffer) noexcept;
+	void SetDomainConstantBuffer(UINT InSlot, ID3D11Buffer* InBuffer) noexcept;
+	void SetDomainShaderResource(UINT InSlot, ID3D11ShaderResourceView* InView) noexcept;
+	void SetDomainSampler(UINT InSlot, ID3D11SamplerState* InSampler) noexcept;
+	// Null for the defaults, solid with back faces culled and no blending.
+	void SetRasterizerState(ID3D11RasterizerState* InState) noexcept;
+	void SetBlendState(ID3D11BlendState* InState) noexcept;
+	void SetDepthStencilState(ID3D11DepthStencilState* InState, UINT InStencilReference = 1u) noexcept;
+	void SetRenderTarget(ID3D11RenderTargetView* InRenderTargetView, ID3D11DepthStencilView* InDepthStencilView) noexcept;
+	// Up to MaxRenderTargetNum targets from slot zero on, such as the G-buffer, the slots past them are unbound.
+	void SetRenderTargets(std::span<ID3D11RenderTargetView* const> InRenderTargetViews, ID3D11DepthStencilView* InDepthStencilView) noexcept;
+
+	// Draws go straight to the context, they are only counted here next to the bindings they consume.
+	void CountDraw(UINT InIndexNum = 0u, UINT InInstanceNum = 1u) noexcept
+	{
+		++CurrentStatistics.DrawCalls;
+		CurrentStatistics.Triangles += static_cast<unsigned long long>(GetTriangleNum(InIndexNum)) * InInstanceNum;
+	}
+
+	void CountUpload(const size_t InByteNum) noexcept
+	{
+		CurrentStatistics.ConstantBytes += InByteNum;
+	}
+
+	void CountSkippedUpload() noexcept
+	{
+		++CurrentStatistics.SkippedUploads;
+	}
+
+	// Changes whenever the context may have started over, what a buffer last wrote through it is only known to be there
+	// while this stays the same, since a deferred context starts each command list without the writes of the last one.
+	[[nodiscard]] unsigned int GetResetNum() const noexcept
+	{
+		return ResetNum;
+	}
+
+	// Off issues every call, redundant ones included, so what the filtering saves can be measured. Still counted as
+	// saved ones where they would have been skipped.
+	void EnableFiltering() noexcept
+	{
+		bIsFilteringEnabled = true;
+	}
+
+	void DisableFiltering() noexcept
+	{
+		bIsFilteringEnabled = false;
+	}
+
+	[[nodiscard]] bool IsFilteringEnabled() const noexcept
+	{
+		return bIsFilteringEnabled;
+	}
+
+	void BeginFrame() noexcept;
+	// Forgets every tracked binding, for when the context itself was reset to default state.
+	void Reset() noexcept;
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastFrameStatistics;
+	}
+
+	// While a recorder is attached, every issued call is also appended to this cache's words of the trace. Null detaches,
+	// both forget the words not taken yet.
+	void SetRecorder(CommandRecorder* InRecorder) noexcept;
+
+	[[nodiscard]] bool IsRecording() const noexcept
+	{
+		return Recorder != nullptr;
+	}
+
+	// For the draws RenderContext issues, the operands with objects already turned into trace IDs.
+	void Record(CommandTrace::Op InOp, std::initializer_list<UINT> InOperands);
+	[[nodiscard]] UINT GetTraceId(IUnknown* InObject) const;
+
+	// What was recorded since the last take, such as a finished command list's words.
+	[[nodiscard]] std::vector<UINT> TakeRecorded() noexcept
+	{
+		return std::exchange(Recorded, {});
+	}
+
+	// Where a command list was executed on this context, its words.
+	void AppendRecorded(std::span<const UINT> InWords);
+
+private:
+	template<typename T>
+	bool ShouldIssue(const StateType InType, T& InCached, const T& InValue) noexcept
+	{
+		if (InCached == InValue)
+		{
+			++CurrentStatistics.SavedCalls;
+			return !bIsFilteringEnabled;
+		}
+
+		InCached = InValue;
+		++CurrentStatistics.IssuedCalls;
+		++CurrentStatistics.IssuedCallsByType[static_cast<size_t>(InType)];
+		return true;
+	}
+
+	// Through the bound topology, lists and strips only, patches count as the triangles they are before tessellation.
+	[[nodiscard]] UINT GetTriangleNum(UINT InIndexNum) const noexcept;
+
+private:
+	struct VertexBufferBinding
+	{
+		ID3D11Buffer* Buffer {nullptr};
+		UINT Stride {0u};
+		UINT Offset {0u};
+
+		bool operator==(const VertexBufferBinding&) const = default;
+	};
+
+	struct IndexBufferBinding
+	{
+		ID3D11Buffer* Buffer {nullptr};
+		DXGI_FORMAT Format {DXGI_FORMAT_UNKNOWN};
+		UINT Offset {0u};
+
+		bool operator==(const IndexBufferBinding&) const = default;
+	};
+
+	struct ConstantBufferBinding
+	{
+		ID3D11Buffer* Buffer {nullptr};
+		UINT FirstConstant {0u};
+		UINT ConstantNum {0u};
+
+		bool operator==(const ConstantBufferBinding&) const = default;
+	};
+
+	struct DepthStencilBinding
+	{
+		ID3D11DepthStencilState* State {nullptr};
+		UINT StencilReference {0u};
+
+		bool operator==(const DepthStencilBinding&) const = default;
+	};
+
+	struct RenderTargetBinding
+	{
+		std::array<ID3D11RenderTargetView*, MaxRenderTargetNum> RenderTargetViews {};
+		UINT RenderTargetNum {0u};
+		ID3D11DepthStencilView* DepthStencilView {nullptr};
+
+		bool operator==(const RenderTargetBinding&) const = default;
+	};
+
+	static constexpr UINT VertexBufferSlotNum {D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT};
+	static constexpr UINT ConstantBufferSlotNum {D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT};
+	static constexpr UINT ShaderResourceSlotNum {D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT};
+	static constexpr UINT SamplerSlotNum {D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT};
+
+	ID3D11DeviceContext* Context;
+	ID3D11DeviceContext1* Context1;
+
+	D3D11_PRIMITIVE_TOPOLOGY Topology {D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED};
+	ID3D11InputLayout* InputLayout {nullptr};
+	std::array<VertexBufferBinding, VertexBufferSlotNum> VertexBuffers {};
+	IndexBufferBinding IndexBuffer {};
+	ID3D11VertexShader* VertexShader {nullptr};
+	ID3D11PixelShader* PixelShader {nullptr};
+	ID3D11HullShader* HullShader {nullptr};
+	ID3D11DomainShader* DomainShader {nullptr};
+	std::array<ConstantBufferBinding, ConstantBufferSlotNum> VertexConstantBuffers {};
+	std::array<ConstantBufferBinding, ConstantBufferSlotNum> PixelConstantBuffers {};
+
+	std::array<ID3D11ShaderResourceView*, ShaderResourceSlotNum> VertexShaderResources {};
+
+	std::array<ID3D11ShaderResourceView*, ShaderResourceSlotNum> PixelShaderResources {};
+	std::array<ID3D11SamplerState*, SamplerSlotNum> PixelSamplers {};
+	std::array<ID3D11Buffer*, ConstantBufferSlotNum> HullConstantBuffers {};
+	std::array<ID3D11Buffer*, ConstantBufferSlotNum> DomainConstantBuffers {};
+	std::array<ID3D11ShaderResourceView*, ShaderResourceSlotNum> DomainShaderResources {};
+	std::array<ID3D11SamplerState*, SamplerSlotNum> DomainSamplers {};
+	ID3D11RasterizerState* RasterizerState {nullptr};
+	ID3D11BlendState* BlendState {nullptr};
+	DepthStencilBinding DepthStencil {};
+	RenderTargetBinding RenderTarget {};
+
+	Statistics CurrentStatistics {};
+	Statistics LastFrameStatistics {};
+	unsigned int ResetNum {0u};
+	bool bIsFilteringEnabled {true};
+
+	CommandRecorder* Recorder {nullptr};
+	std::vector<UINT> Recorded;
+};
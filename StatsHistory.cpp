@@ -0,0 +1,52 @@
+﻿#include "StatsHistory.h"
+#include <algorithm>
+#include <string>
+#include "imgui/imgui.h"
+
+void StatsHistory::Record(const Graphics& InGraphics)
+{
+	const auto Statistics = InGraphics.GetStateStatistics();
+
+	Sums[static_cast<size_t>(Series::DrawCalls)] += Statistics.DrawCalls;
+	Sums[static_cast<size_t>(Series::Triangles)] += static_cast<double>(Statistics.Triangles);
+	Sums[static_cast<size_t>(Series::StateChanges)] += Statistics.IssuedCalls;
+	Sums[static_cast<size_t>(Series::ConstantKilobytes)] += static_cast<double>(Statistics.ConstantBytes) / 1024.0;
+	++FrameNum;
+
+	const auto Now = Clock::now();
+
+	if (Now - SampleStart < std::chrono::seconds(1))
+	{
+		return;
+	}
+
+	for (const auto PerFrame : {Series::DrawCalls, Series::Triangles, Series::StateChanges, Series::ConstantKilobytes})
+	{
+		const auto Index = static_cast<size_t>(PerFrame);
+		Samples[Index][NextSample] = static_cast<float>(Sums[Index] / FrameNum);
+	}
+
+	const auto Lifetimes = Bindable::GetLifetimes();
+	Samples[static_cast<size_t>(Series::CreatedResources)][NextSample] = static_cast<float>(Lifetimes.CreatedNum - LastLifetimes.CreatedNum);
+	Samples[static_cast<size_t>(Series::DestroyedResources)][NextSample] = static_cast<float>(Lifetimes.DestroyedNum - LastLifetimes.DestroyedNum);
+	LastLifetimes = Lifetimes;
+
+	// Queried once a second, the call goes to the kernel.
+	VideoMemory = InGraphics.QueryVideoMemory();
+	Samples[static_cast<size_t>(Series::VideoMemoryMegabytes)][NextSample] = static_cast<float>(VideoMemory.CurrentUsage) / (1024.0f * 1024.0f);
+
+	NextSample = (NextSample + 1u) % SampleNum;
+	Sums = {};
+	FrameNum = 0u;
+	SampleStart = Now;
+}
+
+void StatsHistory::Plot(const Series InSeries, const char* InLabel) const
+{
+	const auto& Values = Samples[static_cast<size_t>(InSeries)];
+	const auto Overlay = std::to_string(static_cast<long long>(GetLatest(InSeries)));
+
+	// Zero as the floor so a flat line still reads as its size, not as noise around the mean.
+	ImGui::PlotLines(InLabel, Values.data(), static_cast<int>(SampleNum), static_cast<int>(NextSample), Overlay.c_str(),
+	                 0.0f, std::max(*std::max_element(Values.begin(), Values.end()), 1.0f), {0.0f, 32.0f});
+}
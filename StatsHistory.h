@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include "Bindable.h"
+
+/**
+ * One sample per second of the renderer's frame counters, for the history graphs on the stats overlay.
+ * Per frame counters are averaged over the frames the second covered, creations and destructions are summed over it.
+ */
+class StatsHistory
+{
+public:
+	enum class Series : unsigned char
+	{
+		DrawCalls,
+		Triangles,
+		StateChanges,
+		ConstantKilobytes,
+		CreatedResources,
+		DestroyedResources,
+		VideoMemoryMegabytes,
+		Num
+	};
+
+	// Once per frame after Graphics::BeginFrame, which is when the previous frame's counters become readable.
+	void Record(const Graphics& InGraphics);
+	// Oldest sample on the left, the overlay is meant to show the trend rather than exact values.
+	void Plot(Series InSeries, const char* InLabel) const;
+
+	[[nodiscard]] float GetLatest(const Series InSeries) const noexcept
+	{
+		return Samples[static_cast<size_t>(InSeries)][(NextSample + SampleNum - 1u) % SampleNum];
+	}
+
+	// As of the latest sample.
+	[[nodiscard]] const DXGI_QUERY_VIDEO_MEMORY_INFO& GetVideoMemory() const noexcept
+	{
+		return VideoMemory;
+	}
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t SeriesNum {static_cast<size_t>(Series::Num)};
+	static constexpr size_t SampleNum {120u};
+
+	std::array<std::array<float, SampleNum>, SeriesNum> Samples {};
+	size_t NextSample {0u};
+	std::array<double, SeriesNum> Sums {};
+	unsigned int FrameNum {0u};
+	Clock::time_point SampleStart {Clock::now()};
+	Bindable::Lifetimes LastLifetimes {Bindable::GetLifetimes()};
+	DXGI_QUERY_VIDEO_MEMORY_INFO VideoMemory {};
+};
@@ -0,0 +1,169 @@
+﻿#include "StressScene.h"
+#include <algorithm>
+#include "ClusteredLighting.h"
+#include "FrameProfiler.h"
+#include "Graphics.h"
+#include "imgui/imgui.h"
+
+namespace
+{
+	// Next to the scene's own light, which has to find room in the clustered list as well.
+	constexpr unsigned int MaxLightNum {ClusteredLighting::MaxLightNum - 1u};
+}
+
+StressScene::StressScene(const Graphics& InGraphics, const Settings& InSettings)
+	: RequestedDrawableNum(static_cast<int>(std::min(InSettings.DrawableNum, MaxDrawableNum))),
+	  RequestedLightNum(static_cast<int>(std::min(InSettings.LightNum, MaxLightNum)))
+{
+	// The first count is there from the first frame, measurements start from a full scene.
+	while (GetDrawableNum() < static_cast<unsigned int>(RequestedDrawableNum))
+	{
+		Spawn(InGraphics, GetDrawableNum());
+	}
+
+	Populate(InGraphics);
+}
+
+void StressScene::Update(const float InDeltaTime)
+{
+	Entities.Update(InDeltaTime);
+}
+
+void StressScene::Populate(const Graphics& InGraphics)
+{
+	PROFILE_SCOPE("StressScene::Populate");
+
+	const auto RequestedNum = static_cast<unsigned int>(RequestedDrawableNum);
+
+	for (unsigned int SpawnNum = 0u; GetDrawableNum() < RequestedNum && SpawnNum < SpawnsPerFrame; ++SpawnNum)
+	{
+		Spawn(InGraphics, GetDrawableNum());
+	}
+
+	// The last spawned go first, what stays is the same scene a lower count would have spawned.
+	while (GetDrawableNum() > RequestedNum)
+	{
+		switch ((GetDrawableNum() - 1u) % 3u)
+		{
+			case 0u:
+				Entities.Remove(Balls.back()->GetEntity());
+				Balls.pop_back();
+				break;
+			case 1u:
+				Entities.Remove(Boxes.back()->GetEntity());
+				Boxes.pop_back();
+				break;
+			default:
+				Entities.Remove(TexturedBoxes.back()->GetEntity());
+				TexturedBoxes.pop_back();
+				break;
+		}
+	}
+
+	while (Lights.size() < static_cast<size_t>(RequestedLightNum))
+	{
+		SpawnLight(InGraphics);
+	}
+
+	Lights.resize(std::min(Lights.size(), static_cast<size_t>(RequestedLightNum)));
+}
+
+void StressScene::Bind(const Graphics& InGraphics) const noexcept
+{
+	for (const auto& Light : Lights)
+	{
+		Light->Bind(InGraphics);
+	}
+}
+
+void StressScene::Submit(const Graphics& InGraphics)
+{
+	PROFILE_SCOPE("StressScene::Submit");
+
+	if (bIsCullingEnabled)
+	{
+		// A multi-view frame draws what any of its views sees.
+		if (InGraphics.IsMultiView())
+		{
+			Entities.GetBounds().Cull(InGraphics.GetViewFrustums(), VisibleMasks);
+		}
+		else
+		{
+			DirectX::BoundingFrustum Frustum(InGraphics.GetProjectionMatrix());
+			Frustum.Transform(Frustum, DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewMatrix()));
+			Entities.GetBounds().Cull({&Frustum, 1u}, VisibleMasks);
+		}
+	}
+
+	SubmittedNum = 0u;
+
+	// The lights' spheres are left out, the draws measured are the slider's count alone.
+	const auto SubmitVisible = [this, &InGraphics](const auto& InMembers)
+	{
+		for (const auto& Member : InMembers)
+		{
+			if (!bIsCullingEnabled || CullingBounds::IsVisible(VisibleMasks, Member->GetEntity()))
+			{
+				Member->Submit(InGraphics);
+				++SubmittedNum;
+			}
+		}
+	};
+
+	SubmitVisible(Balls);
+	SubmitVisible(Boxes);
+	SubmitVisible(TexturedBoxes);
+}
+
+void StressScene::ShowControlWindow() noexcept
+{
+	if (ImGui::Begin("Stress scene"))
+	{
+		ImGui::SliderInt("Drawables", &RequestedDrawableNum, 0, static_cast<int>(MaxDrawableNum));
+		ImGui::SliderInt("Lights", &RequestedLightNum, 0, static_cast<int>(MaxLightNum));
+		ImGui::Text("%u balls, %u boxes, %u textured boxes, %u lights", static_cast<unsigned int>(Balls.size()), static_cast<unsigned int>(Boxes.size()),
+		            static_cast<unsigned int>(TexturedBoxes.size()), static_cast<unsigned int>(Lights.size()));
+		ImGui::Checkbox("Frustum culling", &bIsCullingEnabled);
+		ImGui::Text("%u drawables submitted", SubmittedNum);
+	}
+
+	ImGui::End();
+}
+
+void StressScene::Spawn(const Graphics& InGraphics, const unsigned int InIndex)
+{
+	// Every kind in turn, so any count holds the three in equal parts.
+	switch (InIndex % 3u)
+	{
+		case 0u:
+		{
+			const auto Entity = Entities.Add(RandomGenerator, AngleDistribution, SpinDistribution, TravelDistribution, RadiusDistribution, Ball::Scale, Ball::Extents);
+			Balls.push_back(std::make_unique<Ball>(InGraphics, Entities, Entity, RandomGenerator, LongitudeDistribution, LatitudeDistribution));
+			break;
+		}
+		case 1u:
+		{
+			const DirectX::XMFLOAT3 Color {ColorDistribution(RandomGenerator), ColorDistribution(RandomGenerator), ColorDistribution(RandomGenerator)};
+			const auto Entity = Entities.Add(RandomGenerator, AngleDistribution, SpinDistribution, TravelDistribution, RadiusDistribution);
+			Boxes.push_back(std::make_unique<Box>(InGraphics, Entities, Entity, Color));
+			break;
+		}
+		default:
+		{
+			const auto Entity = Entities.Add(RandomGenerator, AngleDistribution, SpinDistribution, TravelDistribution, RadiusDistribution);
+			TexturedBoxes.push_back(std::make_unique<TexturedBox>(InGraphics, Entities, Entity));
+			break;
+		}
+	}
+}
+
+void StressScene::SpawnLight(const Graphics& InGraphics)
+{
+	auto& Light = Lights.emplace_back(std::make_unique<PointLight>(InGraphics));
+	Light->SetPosition({PositionDistribution(RandomGenerator), PositionDistribution(RandomGenerator), PositionDistribution(RandomGenerator)});
+	Light->SetDiffuseColor({ColorDistribution(RandomGenerator), ColorDistribution(RandomGenerator), ColorDistribution(RandomGenerator)});
+	// A few units of reach each, so a cluster sees a handful of them rather than all.
+	Light->SetAttenuation(0.5f, 0.5f, 1.0f);
+	// The shadow atlas has tiles for a few lights, not for hundreds.
+	Light->SetShadowCasting(false);
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Ball.h"
+#include "Box.h"
+#include "EntityStore.h"
+#include "PointLight.h"
+#include "TexturedBox.h"
+
+/**
+ * Synthetic load for measuring how the renderer scales with draw calls and state changes. Balls, boxes and textured boxes in
+ * equal parts circle the origin on randomized orbits kept in an EntityStore, each its own draw with a transform buffer of its own
+ * and the boxes with a material buffer each, next to unshadowed point lights scattered through the same volume. Drawables
+ * outside the view are left out by culling the store's bounds once a frame, which the control window can turn off to
+ * measure the draws of the whole count.
+ * The counts are changed live from the control window, the profiler's curves then follow the slider.
+ */
+class StressScene
+{
+public:
+	struct Settings
+	{
+		unsigned int DrawableNum {3000u};
+		unsigned int LightNum {0u};
+	};
+
+	StressScene(const Graphics& InGraphics, const Settings& InSettings);
+	StressScene(const StressScene&) = delete;
+	StressScene(StressScene&&) = delete;
+	StressScene& operator=(const StressScene&) = delete;
+	StressScene& operator=(StressScene&&) = delete;
+	~StressScene() = default;
+
+	// Once per simulation step.
+	void Update(float InDeltaTime);
+	// Once per frame before Bind, creates or destroys drawables toward the requested count.
+	void Populate(const Graphics& InGraphics);
+	// Adds the lights to the frame's clustered light list.
+	void Bind(const Graphics& InGraphics) const noexcept;
+	void Submit(const Graphics& InGraphics);
+	void ShowControlWindow() noexcept;
+
+	[[nodiscard]] unsigned int GetDrawableNum() const noexcept
+	{
+		return static_cast<unsigned int>(Balls.size() + Boxes.size() + TexturedBoxes.size());
+	}
+
+private:
+	// Where the slider ends.
+	static constexpr unsigned int MaxDrawableNum {30000u};
+	// Drawables created per frame at most, so dragging the slider up spreads the buffer creation over a few frames.
+	static constexpr unsigned int SpawnsPerFrame {1000u};
+	// World units from the origin the orbits and the lights stay within.
+	static constexpr float MinRadius {6.0f};
+	static constexpr float MaxRadius {20.0f};
+
+	void Spawn(const Graphics& InGraphics, unsigned int InIndex);
+	void SpawnLight(const Graphics& InGraphics);
+
+	// Seeded the same every run, so curves plotted in different sessions measure the same scene.
+	std::mt19937 RandomGenerator {7u};
+	std::uniform_real_distribution<float> AngleDistribution {0.0f, 2.0f * DirectX::XM_PI};
+	std::uniform_real_distribution<float> SpinDistribution {0.0f, 0.5f * DirectX::XM_PI};
+	std::uniform_real_distribution<float> TravelDistribution {0.0f, 0.08f * DirectX::XM_PI};
+	std::uniform_real_distribution<float> RadiusDistribution {MinRadius, MaxRadius};
+	// A handful of sphere tessellations, each generated once and shared by the balls that picked it.
+	std::uniform_int_distribution<int> LongitudeDistribution {12, 24};
+	std::uniform_int_distribution<int> LatitudeDistribution {6, 12};
+	std::uniform_real_distribution<float> ColorDistribution {0.0f, 1.0f};
+	std::uniform_real_distribution<float> PositionDistribution {-MaxRadius, MaxRadius};
+
+	// Ahead of the drawables, which read their transforms from it until they are gone.
+	EntityStore Entities;
+	std::vector<std::unique_ptr<Ball>> Balls;
+	std::vector<std::unique_ptr<Box>> Boxes;
+	std::vector<std::unique_ptr<TexturedBox>> TexturedBoxes;
+	std::vector<std::unique_ptr<PointLight>> Lights;
+	// By entity, kept between frames so culling doesn't allocate.
+	std::vector<uint8_t> VisibleMasks;
+	unsigned int SubmittedNum {0u};
+	bool bIsCullingEnabled {true};
+	// What the control window asks for, Populate catches up on the drawables over the next frames.
+	int RequestedDrawableNum;
+	int RequestedLightNum;
+};
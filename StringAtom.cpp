@@ -0,0 +1,107 @@
+﻿#include "StringAtom.h"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include "AssetArena.h"
+
+namespace
+{
+	class StringTable
+	{
+	public:
+		static constexpr unsigned int ChunkBits {14u};
+		static constexpr uint32_t ChunkSize {1u << ChunkBits};
+		static constexpr size_t MaxChunkNum {4096u};
+
+		StringTable()
+		{
+			// Atom zero, the empty string.
+			Chunks[0] = std::make_unique<std::string_view[]>(ChunkSize);
+			Ids.emplace(std::string_view {}, 0u);
+			AtomNum = 1u;
+		}
+
+		[[nodiscard]] static StringTable& Get()
+		{
+			static StringTable Table;
+			return Table;
+		}
+
+		[[nodiscard]] uint32_t Intern(const std::string_view InString)
+		{
+			{
+				std::shared_lock Lock(Mutex);
+
+				if (const auto Found = Ids.find(InString); Found != Ids.end())
+				{
+					return Found->second;
+				}
+			}
+
+			std::unique_lock Lock(Mutex);
+
+			// Another thread may have added it between the locks.
+			if (const auto Found = Ids.find(InString); Found != Ids.end())
+			{
+				return Found->second;
+			}
+
+			const auto Id = AtomNum;
+			auto& Chunk = Chunks[Id >> ChunkBits];
+
+			if (!Chunk)
+			{
+				if ((Id >> ChunkBits) >= MaxChunkNum)
+				{
+					throw std::length_error("Too many distinct strings interned");
+				}
+
+				Chunk = std::make_unique<std::string_view[]>(ChunkSize);
+			}
+
+			const auto Stored = Strings.CopyString(InString);
+			Chunk[Id & (ChunkSize - 1u)] = Stored;
+			Ids.emplace(Stored, Id);
+			++AtomNum;
+			return Id;
+		}
+
+		// The chunk an atom lies in was made before the atom was handed out, and chunks never move.
+		[[nodiscard]] std::string_view Find(const uint32_t InId) const noexcept
+		{
+			return Chunks[InId >> ChunkBits][InId & (ChunkSize - 1u)];
+		}
+
+		[[nodiscard]] StringAtom::Statistics GetStatistics()
+		{
+			std::shared_lock Lock(Mutex);
+			return {AtomNum, Strings.GetStatistics().UsedBytes};
+		}
+
+	private:
+		std::shared_mutex Mutex;
+		// Written under the exclusive lock only.
+		AssetArena Strings {64u * 1024u};
+		std::unordered_map<std::string_view, uint32_t> Ids;
+		std::array<std::unique_ptr<std::string_view[]>, MaxChunkNum> Chunks;
+		uint32_t AtomNum {0u};
+	};
+}
+
+StringAtom::StringAtom(const std::string_view InString)
+	: Id(InString.empty() ? 0u : StringTable::Get().Intern(InString))
+{
+}
+
+std::string_view StringAtom::GetString() const noexcept
+{
+	return Id == 0u ? std::string_view {} : StringTable::Get().Find(Id);
+}
+
+StringAtom::Statistics StringAtom::GetStatistics()
+{
+	return StringTable::Get().GetStatistics();
+}
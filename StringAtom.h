@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+/**
+ * A string interned process-wide, such as a node name, a mesh tag or a texture's file name, held as a 32-bit index.
+ * Equal strings get the same atom, so atoms compare and hash as integers and each distinct string is stored once. Atoms are
+ * never freed, they are meant for names that come back, not for text that keeps changing.
+ * Interning takes a read lock and hashes the string, a write lock the first time the string is seen. Reading it back
+ * through GetString takes neither, from any thread. The empty string is atom zero, which default constructed ones hold.
+ */
+class StringAtom
+{
+public:
+	struct Statistics
+	{
+		unsigned int AtomNum {0u};
+		size_t StringBytes {0u};
+	};
+
+	StringAtom() noexcept = default;
+	explicit StringAtom(std::string_view InString);
+
+	// Valid for as long as the process runs.
+	[[nodiscard]] std::string_view GetString() const noexcept;
+
+	[[nodiscard]] uint32_t GetId() const noexcept
+	{
+		return Id;
+	}
+
+	[[nodiscard]] bool IsEmpty() const noexcept
+	{
+		return Id == 0u;
+	}
+
+	[[nodiscard]] static Statistics GetStatistics();
+
+	bool operator==(const StringAtom&) const = default;
+
+private:
+	uint32_t Id {0u};
+};
+
+template<>
+struct std::hash<StringAtom>
+{
+	size_t operator()(const StringAtom InAtom) const noexcept
+	{
+		return static_cast<size_t>(InAtom.GetId());
+	}
+};
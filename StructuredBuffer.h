@@ -0,0 +1,142 @@
+﻿#pragma once
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BindKey.h"
+#include "Bindable.h"
+#include "BindManager.h"
+#include "ExceptionMacros.h"
+
+/**
+ * A StructuredBuffer<T> for shaders to read and, when created writable, a RWStructuredBuffer<T> for compute shaders to
+ * write. Bind reads it from the pixel shaders in its slot, the compute bindings pass their own slots.
+ * Cached under its tag, so the passes that write and read it resolve the same buffer.
+ */
+template<typename T>
+class StructuredBuffer : public Bindable
+{
+public:
+	// InElements, when not empty, fills the first elements, the rest start zeroed.
+	StructuredBuffer(const Graphics& InGraphics, const std::string& InTag, const UINT InElementNum, const bool bInIsWritable, const UINT InSlot = 0u,
+	                 const std::vector<T>& InElements = {})
+		: Tag(InTag), ElementNum(InElementNum), Slot(InSlot)
+	{
+		assert(ElementNum > 0u && InElements.size() <= ElementNum);
+		static_assert(sizeof(T) % 4u == 0u, "Structured buffer elements are a whole number of 32-bit values");
+
+		HRESULT ResultHandle;
+
+		D3D11_BUFFER_DESC BufferDesc {};
+		BufferDesc.ByteWidth = static_cast<UINT>(sizeof(T)) * ElementNum;
+		BufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		BufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | (bInIsWritable ? D3D11_BIND_UNORDERED_ACCESS : 0u);
+		BufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		BufferDesc.StructureByteStride = sizeof(T);
+
+		// Zeroed past the given elements, so a partial fill never exposes whatever the memory held.
+		std::vector<T> Initial(ElementNum);
+		std::copy(InElements.begin(), InElements.end(), Initial.begin());
+
+		D3D11_SUBRESOURCE_DATA SubresourceData {};
+		SubresourceData.pSysMem = Initial.data();
+
+		CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer(&BufferDesc, &SubresourceData, &MyBuffer))
+		CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateShaderResourceView(MyBuffer.Get(), nullptr, &MyView))
+
+		if (bInIsWritable)
+		{
+			CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateUnorderedAccessView(MyBuffer.Get(), nullptr, &MyUnorderedAccessView))
+		}
+	}
+
+	void Bind(RenderContext& InContext) noexcept override
+	{
+		GetStateCache(InContext).SetPixelShaderResource(Slot, MyView.Get());
+	}
+
+	void BindCompute(RenderContext& InContext, const UINT InSlot) noexcept
+	{
+		assert(InSlot < Graphics::ComputeResourceSlotNum);
+		GetContext(InContext)->CSSetShaderResources(InSlot, 1u, MyView.GetAddressOf());
+	}
+
+	// Clears its pixel slot first, the runtime would otherwise drop the read binding behind the state cache's back.
+	void BindUnorderedAccess(RenderContext& InContext, const UINT InSlot) noexcept
+	{
+		assert(MyUnorderedAccessView && "Created read only");
+		assert(InSlot < D3D11_PS_CS_UAV_REGISTER_COUNT);
+
+		GetStateCache(InContext).SetPixelShaderResource(Slot, nullptr);
+		GetContext(InContext)->CSSetUnorderedAccessViews(InSlot, 1u, MyUnorderedAccessView.GetAddressOf(), nullptr);
+	}
+
+	// Overwrites elements from InFirstElement on, copied by the GPU when it gets there in the command stream.
+	void Update(RenderContext& InContext, const T* InElements, const UINT InNum, const UINT InFirstElement = 0u)
+	{
+		assert(InFirstElement + InNum <= ElementNum);
+
+		const D3D11_BOX Range {InFirstElement * static_cast<UINT>(sizeof(T)), 0u, 0u, (InFirstElement + InNum) * static_cast<UINT>(sizeof(T)), 1u, 1u};
+		GetContext(InContext)->UpdateSubresource(MyBuffer.Get(), 0u, &Range, InElements, 0u, 0u);
+		GetStateCache(InContext).CountUpload(sizeof(T) * InNum);
+	}
+
+	[[nodiscard]] ID3D11Buffer* GetBuffer() const noexcept
+	{
+		return MyBuffer.Get();
+	}
+
+	[[nodiscard]] ID3D11ShaderResourceView* GetView() const noexcept
+	{
+		return MyView.Get();
+	}
+
+	// Null when created read only.
+	[[nodiscard]] ID3D11UnorderedAccessView* GetUnorderedAccessView() const noexcept
+	{
+		return MyUnorderedAccessView.Get();
+	}
+
+	[[nodiscard]] UINT GetElementNum() const noexcept
+	{
+		return ElementNum;
+	}
+
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override
+	{
+		return sizeof(T) * ElementNum;
+	}
+
+	[[nodiscard]] static std::shared_ptr<StructuredBuffer> Resolve(const Graphics& InGraphics, const std::string& InTag, const UINT InElementNum,
+	                                                               const bool bInIsWritable, const UINT InSlot = 0u, const std::vector<T>& InElements = {})
+	{
+		return BindManager::Resolve<StructuredBuffer>(InGraphics, InTag, InElementNum, bInIsWritable, InSlot, InElements);
+	}
+
+	template<typename... IgnoredParams>
+	[[nodiscard]] static std::string GenerateUniqueID(const std::string& InTag, IgnoredParams&&... InIgnoredParams)
+	{
+		using namespace std::string_literals;
+		return typeid(StructuredBuffer).name() + "#"s + InTag;
+	}
+
+	template<typename... IgnoredParams>
+	[[nodiscard]] static BindKey GenerateKey(const std::string& InTag, IgnoredParams&&... InIgnoredParams)
+	{
+		return BindKey::Make<StructuredBuffer>(InTag);
+	}
+
+	[[nodiscard]] std::string GetUniqueID() const noexcept override
+	{
+		return GenerateUniqueID(Tag);
+	}
+
+private:
+	std::string Tag;
+	UINT ElementNum;
+	UINT Slot;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> MyBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> MyUnorderedAccessView;
+};
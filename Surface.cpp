@@ -2,10 +2,101 @@
 #define FULL_WINDOW
 #include "EngineWin.h"
 #include <cassert>
-#include <gdiplus.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
 #include <sstream>
+#include <vector>
+#include <wincodec.h>
+#include "AssetArchive.h"
 #include "ExceptionMacros.h"
-#pragma comment(lib, "gdiplus.lib")
+#include "SurfaceKernels.h"
+#include "wrl/client.h"
+#pragma comment(lib, "windowscodecs.lib")
+
+namespace
+{
+	// WIC needs COM on the calling thread, which includes the model loader's worker threads.
+	class ComScope
+	{
+	public:
+		ComScope() noexcept
+			: ResultHandle(CoInitializeEx(nullptr, COINIT_MULTITHREADED))
+		{
+		}
+
+		ComScope(const ComScope&) = delete;
+		ComScope& operator=(const ComScope&) = delete;
+
+		~ComScope()
+		{
+			if (SUCCEEDED(ResultHandle))
+			{
+				CoUninitialize();
+			}
+		}
+
+	private:
+		HRESULT ResultHandle;
+	};
+
+	IWICImagingFactory* GetImagingFactory()
+	{
+		thread_local ComScope Com;
+		thread_local Microsoft::WRL::ComPtr<IWICImagingFactory> Factory;
+
+		if (!Factory)
+		{
+			HRESULT ResultHandle;
+			CHECK_HRESULT_EXCEPTION(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&Factory)))
+		}
+
+		return Factory.Get();
+	}
+
+	[[noreturn]] void ThrowLoadError(const std::string& InFileName)
+	{
+		std::stringstream Stringstream;
+		Stringstream << "Loading image [" << InFileName << "]: failed to load.";
+		throw INFO_EXCEPTION({Stringstream.str()});
+	}
+
+	std::vector<std::byte> ReadFileBytes(const std::string& InFileName)
+	{
+		std::vector<std::byte> FileBytes;
+		if (!AssetArchive::Get().Read(InFileName, FileBytes))
+		{
+			ThrowLoadError(InFileName);
+		}
+
+		return FileBytes;
+	}
+
+	// The frame reads from the file's bytes until it's released, WIC only ever reads them.
+	Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> OpenFrame(const std::string& InFileName, const std::span<const std::byte> InFileBytes)
+	{
+		auto* const Factory = GetImagingFactory();
+		HRESULT ResultHandle;
+
+		Microsoft::WRL::ComPtr<IWICStream> Stream;
+		CHECK_HRESULT_EXCEPTION(Factory->CreateStream(&Stream))
+
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> Decoder;
+		if (InFileBytes.empty() || InFileBytes.size() > MAXDWORD ||
+			FAILED(Stream->InitializeFromMemory(reinterpret_cast<BYTE*>(const_cast<std::byte*>(InFileBytes.data())), static_cast<DWORD>(InFileBytes.size()))) ||
+			FAILED(Factory->CreateDecoderFromStream(Stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &Decoder)))
+		{
+			ThrowLoadError(InFileName);
+		}
+
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> Frame;
+		CHECK_HRESULT_EXCEPTION(Decoder->GetFrame(0u, &Frame))
+		return Frame;
+	}
+}
 
 Surface::Surface(const unsigned InWidth, const unsigned InHeight) noexcept
 	: Buffer(std::make_unique<Color[]>(static_cast<size_t>(InWidth * InHeight))), Width(InWidth), Height(InHeight)
@@ -17,7 +108,6 @@ Surface::Surface(const unsigned InWidth, const unsigned InHeight, std::unique_pt
 {
 }
 
-
 Surface::Surface(Surface&& InSurface) noexcept
 	: Buffer(std::move(InSurface.Buffer)), Width(InSurface.Width), Height(InSurface.Height)
 {
@@ -34,7 +124,7 @@ Surface& Surface::operator=(Surface&& InSurface) noexcept
 
 void Surface::Clear(const Color& InFillValue) const noexcept
 {
-	memset(Buffer.get(), InFillValue.ARGB, Width * Height * sizeof(Color));
+	SurfaceKernels::Fill({Buffer.get(), static_cast<size_t>(Width) * Height}, InFillValue);
 }
 
 void Surface::PutPixel(const unsigned InX, const unsigned InY, const Color& InColor)
@@ -71,36 +161,152 @@ const Surface::Color* Surface::GetBufferPtrConst() const noexcept
 	return Buffer.get();
 }
 
-Surface Surface::FromFile(const std::string& InFileName)
+Surface::Format Surface::DetectFormat() const
 {
-	unsigned int ImageWidth = 0;
-	unsigned int ImageHeight = 0;
-	std::unique_ptr<Color[]> ImageBuffer = nullptr;
+	return SurfaceKernels::DetectFormat({Buffer.get(), Width * static_cast<unsigned int>(sizeof(Color))}, Width, Height);
+}
 
-	wchar_t WideFileName[512];
-	mbstowcs_s(nullptr, WideFileName, InFileName.c_str(), _TRUNCATE);
+void Surface::FromFile(const std::string& InFileName, const GetDestination& InGetDestination)
+{
+	FromMemory(InFileName, ReadFileBytes(InFileName), InGetDestination);
+}
 
-	Gdiplus::Bitmap Bitmap {WideFileName};
-	if (Bitmap.GetLastStatus() != Gdiplus::Status::Ok)
+void Surface::FromMemory(const std::string& InFileName, const std::span<const std::byte> InFileBytes, const GetDestination& InGetDestination)
+{
+	FromMemory(InFileName, InFileBytes, Format::BGRA8, InGetDestination);
+}
+
+void Surface::FromMemory(const std::string& InFileName, const std::span<const std::byte> InFileBytes, const Format InFormat,
+                         const GetDestination& InGetDestination)
+{
+	assert((InFormat == Format::BGRA8 || InFormat == Format::R16F) && "WIC only decodes to BGRA8 and R16F");
+
+	const auto DecodeStart = std::chrono::steady_clock::now();
+
+	auto* const Factory = GetImagingFactory();
+	HRESULT ResultHandle;
+
+	const auto Frame = OpenFrame(InFileName, InFileBytes);
+
+	// Converts whatever the file holds into the Color layout, DXGI_FORMAT_B8G8R8A8_UNORM in memory, or into half float grey.
+	Microsoft::WRL::ComPtr<IWICFormatConverter> Converter;
+	CHECK_HRESULT_EXCEPTION(Factory->CreateFormatConverter(&Converter))
+	CHECK_HRESULT_EXCEPTION(Converter->Initialize
+	(
+		Frame.Get(),
+		InFormat == Format::R16F ? GUID_WICPixelFormat16bppGrayHalf : GUID_WICPixelFormat32bppBGRA,
+		WICBitmapDitherTypeNone,
+		nullptr,
+		0.0,
+		WICBitmapPaletteTypeCustom
+	))
+
+	UINT ImageWidth;
+	UINT ImageHeight;
+	CHECK_HRESULT_EXCEPTION(Converter->GetSize(&ImageWidth, &ImageHeight))
+
+	const UINT RowBytes = ImageWidth * GetTexelBytes(InFormat);
+	const auto [Pixels, RowPitch] = InGetDestination(ImageWidth, ImageHeight);
+	assert(Pixels && RowPitch >= RowBytes);
+
+	// The last row needs no padding after it.
+	const UINT Bytes = RowPitch * (ImageHeight - 1u) + RowBytes;
+	CHECK_HRESULT_EXCEPTION(Converter->CopyPixels(nullptr, RowPitch, Bytes, static_cast<BYTE*>(Pixels)))
+
+	const std::chrono::duration<float, std::milli> DecodeTime = std::chrono::steady_clock::now() - DecodeStart;
+
+	std::stringstream Stringstream;
+	Stringstream << "Decoded image [" << InFileName << "] " << ImageWidth << "x" << ImageHeight << " in " << DecodeTime.count() << " ms\n";
+	OutputDebugStringA(Stringstream.str().c_str());
+}
+
+void Surface::Save(const std::string& InFileName) const
+{
+	auto* const Factory = GetImagingFactory();
+	HRESULT ResultHandle;
+
+	Microsoft::WRL::ComPtr<IWICStream> Stream;
+	CHECK_HRESULT_EXCEPTION(Factory->CreateStream(&Stream))
+
+	if (FAILED(Stream->InitializeFromFilename(std::filesystem::path(InFileName).c_str(), GENERIC_WRITE)))
 	{
 		std::stringstream Stringstream;
-		Stringstream << "Loading image [" << InFileName << "]: failed to load.";
+		Stringstream << "Saving image [" << InFileName << "]: failed to open.";
 		throw INFO_EXCEPTION({Stringstream.str()});
 	}
 
-	ImageWidth = Bitmap.GetWidth();
-	ImageHeight = Bitmap.GetHeight();
-	ImageBuffer = std::make_unique<Color[]>(static_cast<size_t>(ImageWidth * ImageHeight));
+	Microsoft::WRL::ComPtr<IWICBitmapEncoder> Encoder;
+	CHECK_HRESULT_EXCEPTION(Factory->CreateEncoder(GUID_ContainerFormatPng, nullptr, &Encoder))
+	CHECK_HRESULT_EXCEPTION(Encoder->Initialize(Stream.Get(), WICBitmapEncoderNoCache))
+
+	Microsoft::WRL::ComPtr<IWICBitmapFrameEncode> Frame;
+	CHECK_HRESULT_EXCEPTION(Encoder->CreateNewFrame(&Frame, nullptr))
+	CHECK_HRESULT_EXCEPTION(Frame->Initialize(nullptr))
+	CHECK_HRESULT_EXCEPTION(Frame->SetSize(Width, Height))
 
-	for (unsigned int Row = 0; Row < ImageHeight; ++Row)
+	// PNG takes 32 bit BGRA as it is, so the encoder keeps the Color layout.
+	WICPixelFormatGUID PixelFormat = GUID_WICPixelFormat32bppBGRA;
+	CHECK_HRESULT_EXCEPTION(Frame->SetPixelFormat(&PixelFormat))
+	assert(PixelFormat == GUID_WICPixelFormat32bppBGRA);
+
+	const UINT Pitch = Width * sizeof(Color);
+	CHECK_HRESULT_EXCEPTION(Frame->WritePixels(Height, Pitch, Pitch * Height, reinterpret_cast<BYTE*>(Buffer.get())))
+	CHECK_HRESULT_EXCEPTION(Frame->Commit())
+	CHECK_HRESULT_EXCEPTION(Encoder->Commit())
+}
+
+void Surface::SaveRaw(const std::string& InFileName) const
+{
+	std::ofstream File(std::filesystem::path(InFileName), std::ios::binary);
+	const std::uint32_t Size[] = {Width, Height};
+	File.write(reinterpret_cast<const char*>(Size), sizeof(Size));
+	File.write(reinterpret_cast<const char*>(Buffer.get()), static_cast<std::streamsize>(Width) * Height * sizeof(Color));
+
+	if (!File)
 	{
-		for (unsigned int Column = 0; Column < ImageWidth; ++Column)
-		{
-			Gdiplus::Color Color;
-			Bitmap.GetPixel(static_cast<INT>(Column), static_cast<INT>(Row), &Color);
-			ImageBuffer[Row * ImageWidth + Column] = Surface::Color{Color.GetValue()};
-		}
+		std::stringstream Stringstream;
+		Stringstream << "Saving image [" << InFileName << "]: failed to write.";
+		throw INFO_EXCEPTION({Stringstream.str()});
 	}
+}
+
+Surface::Format Surface::ReadFormat(const std::string& InFileName, const std::span<const std::byte> InFileBytes)
+{
+	HRESULT ResultHandle;
+	WICPixelFormatGUID PixelFormat;
+	CHECK_HRESULT_EXCEPTION(OpenFrame(InFileName, InFileBytes)->GetPixelFormat(&PixelFormat))
+
+	const bool bIsWideGrey = PixelFormat == GUID_WICPixelFormat16bppGray || PixelFormat == GUID_WICPixelFormat16bppGrayHalf ||
+	                         PixelFormat == GUID_WICPixelFormat16bppGrayFixedPoint || PixelFormat == GUID_WICPixelFormat32bppGrayFloat ||
+	                         PixelFormat == GUID_WICPixelFormat32bppGrayFixedPoint;
+	return bIsWideGrey ? Format::R16F : Format::BGRA8;
+}
+
+void Surface::ReadSize(const std::string& InFileName, unsigned int& OutWidth, unsigned int& OutHeight)
+{
+	HRESULT ResultHandle;
+	const auto FileBytes = ReadFileBytes(InFileName);
+	CHECK_HRESULT_EXCEPTION(OpenFrame(InFileName, FileBytes)->GetSize(&OutWidth, &OutHeight))
+}
+
+Surface Surface::FromFile(const std::string& InFileName)
+{
+	return FromMemory(InFileName, ReadFileBytes(InFileName));
+}
+
+Surface Surface::FromMemory(const std::string& InFileName, const std::span<const std::byte> InFileBytes)
+{
+	unsigned int ImageWidth = 0;
+	unsigned int ImageHeight = 0;
+	std::unique_ptr<Color[]> ImageBuffer = nullptr;
+
+	FromMemory(InFileName, InFileBytes, [&](const unsigned int InWidth, const unsigned int InHeight)
+	{
+		ImageWidth = InWidth;
+		ImageHeight = InHeight;
+		ImageBuffer = std::make_unique<Color[]>(static_cast<size_t>(ImageWidth) * ImageHeight);
+		return Destination {ImageBuffer.get(), ImageWidth * static_cast<unsigned int>(sizeof(Color))};
+	});
 
 	return {ImageWidth, ImageHeight, std::move(ImageBuffer)};
-}
\ No newline at end of file
+}
@@ -1,5 +1,8 @@
 ﻿#pragma once
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <span>
 #include <string>
 
 class Surface
@@ -80,7 +83,33 @@ public:
 		}
 	};
 
+	// How texels are laid out, each like the DXGI format of the same name. Decodes are BGRA8, the others only keep a grey level:
+	// R8 and R8G8 that of images whose red, green and blue are always the same, R8G8 with alpha in green, and R16F that of
+	// images of more than eight bits of grey.
+	enum class Format : unsigned char
+	{
+		BGRA8,
+		R8G8,
+		R8,
+		R16F
+	};
+
+	// Where a decode writes its rows, RowPitch bytes apart, such as a mapped texture's level. The texels are Colors unless the
+	// decode was asked for another format.
+	struct Destination
+	{
+		void* Pixels;
+		unsigned int RowPitch;
+	};
+
+	using GetDestination = std::function<Destination(unsigned int InWidth, unsigned int InHeight)>;
+
 public:
+	[[nodiscard]] static constexpr unsigned int GetTexelBytes(const Format InFormat) noexcept
+	{
+		return InFormat == Format::BGRA8 ? 4u : InFormat == Format::R8 ? 1u : 2u;
+	}
+
 	Surface(unsigned int InWidth, unsigned int InHeight) noexcept;
 	Surface(Surface&& InSurface) noexcept;
 	Surface(Surface&) = delete;
@@ -95,8 +124,24 @@ public:
 	unsigned int GetHeight() const noexcept;
 	Color* GetBufferPtr() noexcept;
 	const Color* GetBufferPtrConst() const noexcept;
+	// The fewest channels that keep every texel as it is, BGRA8 unless the image is grey.
+	[[nodiscard]] Format DetectFormat() const;
 	static Surface FromFile(const std::string& InFileName);
-
+	// Encodes as PNG, lossless so saved frames can be compared pixel for pixel.
+	void Save(const std::string& InFileName) const;
+	// The pixels as they are after the width and height as two 32 bit integers, no encoding at all.
+	void SaveRaw(const std::string& InFileName) const;
+	// Decodes straight into the memory InGetDestination returns for the image size.
+	static void FromFile(const std::string& InFileName, const GetDestination& InGetDestination);
+	// The same from the file's bytes already read, the name is only for messages and the bytes only need to live for the call.
+	static Surface FromMemory(const std::string& InFileName, std::span<const std::byte> InFileBytes);
+	static void FromMemory(const std::string& InFileName, std::span<const std::byte> InFileBytes, const GetDestination& InGetDestination);
+	// Decodes as InFormat, which may be BGRA8 or R16F, WIC converts to either.
+	static void FromMemory(const std::string& InFileName, std::span<const std::byte> InFileBytes, Format InFormat, const GetDestination& InGetDestination);
+	// R16F for grey images of more than eight bits, which BGRA8 would round, and BGRA8 for anything else. Only reads the header.
+	[[nodiscard]] static Format ReadFormat(const std::string& InFileName, std::span<const std::byte> InFileBytes);
+	// Only reads the header, the pixels are not decoded.
+	static void ReadSize(const std::string& InFileName, unsigned int& OutWidth, unsigned int& OutHeight);
 
 private:
 	Surface(unsigned int InWidth, unsigned int InHeight, std::unique_ptr<Color[]> InBuffer) noexcept;
@@ -0,0 +1,654 @@
+﻿#include "SurfaceKernels.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <DirectXPackedVector.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <intrin.h>
+#include <numbers>
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+namespace
+{
+	// Rows are handed out in jobs of about this many pixels, a job has at least one whole row.
+	constexpr size_t PixelsPerJob {1u << 16u};
+	// Steps of the linear to sRGB table, fine enough that the darkest codes, where the curve is steepest, still round right.
+	constexpr size_t EncodeSteps {16384u};
+	// Half-width of the filter in pixels of the result, and the shape of its window, NVTT's defaults for mipmaps.
+	constexpr float KaiserWidth {3.0f};
+	constexpr float KaiserAlpha {4.0f};
+	// Source taps across a result pixel, which lies between two source pixels. The outer ones sit just inside the width.
+	constexpr int KaiserTapNum {12};
+
+	struct ConversionTables
+	{
+		// Per byte, decoded from sRGB and as it is.
+		float SrgbToLinear[256];
+		float UnitToFloat[256];
+		unsigned char LinearToSrgb[EncodeSteps + 1u];
+	};
+
+	const ConversionTables& GetTables() noexcept
+	{
+		static const ConversionTables Tables = []
+		{
+			ConversionTables Built {};
+
+			for (unsigned int Code = 0u; Code < 256u; ++Code)
+			{
+				const float Unit = static_cast<float>(Code) / 255.0f;
+				Built.UnitToFloat[Code] = Unit;
+				Built.SrgbToLinear[Code] = Unit <= 0.04045f ? Unit / 12.92f : std::pow((Unit + 0.055f) / 1.055f, 2.4f);
+			}
+
+			for (size_t Step = 0u; Step <= EncodeSteps; ++Step)
+			{
+				const float Linear = static_cast<float>(Step) / static_cast<float>(EncodeSteps);
+				const float Encoded = Linear <= 0.0031308f ? Linear * 12.92f : 1.055f * std::pow(Linear, 1.0f / 2.4f) - 0.055f;
+				Built.LinearToSrgb[Step] = static_cast<unsigned char>(std::lround(std::clamp(Encoded, 0.0f, 1.0f) * 255.0f));
+			}
+
+			return Built;
+		}();
+
+		return Tables;
+	}
+
+	template<typename Function>
+	void ForEachRow(const unsigned int InWidth, const unsigned int InHeight, Function&& InBody)
+	{
+		JobSystem::Get().ParallelFor(InHeight, std::max<size_t>(PixelsPerJob / std::max(InWidth, 1u), 1u), InBody);
+	}
+
+	template<typename Texel = Surface::Color>
+	Texel* GetRow(const Surface::Destination& InLevel, const unsigned int InRow) noexcept
+	{
+		return reinterpret_cast<Texel*>(static_cast<std::byte*>(InLevel.Pixels) + static_cast<size_t>(InLevel.RowPitch) * InRow);
+	}
+
+	// Lanes in memory order, blue to alpha.
+	__m128 Decode(const Surface::Color InColor, const float* InColorTable, const ConversionTables& InTables) noexcept
+	{
+		return _mm_setr_ps(InColorTable[InColor.GetB()], InColorTable[InColor.GetG()], InColorTable[InColor.GetR()], InTables.UnitToFloat[InColor.GetA()]);
+	}
+
+	Surface::Color Encode(const __m128 InValue, const bool bInIsSrgb, const ConversionTables& InTables) noexcept
+	{
+		alignas(16) float Lanes[4];
+		_mm_store_ps(Lanes, _mm_min_ps(_mm_max_ps(InValue, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+
+		const auto ToByte = [bInIsSrgb, &InTables](const float InLane)
+		{
+			return bInIsSrgb ? InTables.LinearToSrgb[static_cast<size_t>(InLane * static_cast<float>(EncodeSteps) + 0.5f)]
+			                 : static_cast<unsigned char>(InLane * 255.0f + 0.5f);
+		};
+
+		return {static_cast<unsigned char>(Lanes[3] * 255.0f + 0.5f), ToByte(Lanes[2]), ToByte(Lanes[1]), ToByte(Lanes[0])};
+	}
+
+	__m128i SwapRedBlue(const __m128i InPixels) noexcept
+	{
+		const auto GreenAlpha = _mm_and_si128(InPixels, _mm_set1_epi32(static_cast<int>(0xFF00FF00u)));
+		const auto RedBlue = _mm_and_si128(InPixels, _mm_set1_epi32(0x00FF00FF));
+		return _mm_or_si128(GreenAlpha, _mm_or_si128(_mm_srli_epi32(RedBlue, 16), _mm_slli_epi32(RedBlue, 16)));
+	}
+
+	// The products of 16 bit channels with their pixel's alpha, divided by 255 with rounding, exact for every pair of bytes.
+	__m128i PremultiplyWide(const __m128i InChannels) noexcept
+	{
+		const auto Alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(InChannels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		const auto Product = _mm_add_epi16(_mm_mullo_epi16(InChannels, Alpha), _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(Product, _mm_srli_epi16(Product, 8)), 8);
+	}
+
+	__m128i Premultiply(const __m128i InPixels) noexcept
+	{
+		const auto Zero = _mm_setzero_si128();
+		const auto AlphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+		const auto Scaled = _mm_packus_epi16(PremultiplyWide(_mm_unpacklo_epi8(InPixels, Zero)), PremultiplyWide(_mm_unpackhi_epi8(InPixels, Zero)));
+
+		// Alpha went through the product too, it is put back as it was.
+		return _mm_or_si128(_mm_andnot_si128(AlphaMask, Scaled), _mm_and_si128(InPixels, AlphaMask));
+	}
+
+	unsigned char Premultiply(const unsigned int InChannel, const unsigned int InAlpha) noexcept
+	{
+		const auto Product = InChannel * InAlpha + 128u;
+		return static_cast<unsigned char>((Product + (Product >> 8u)) >> 8u);
+	}
+
+	// The AVX2 paths take whole groups of eight pixels and return how many they did, the SSE2 and scalar ones do the rest.
+	// Each clears the upper halves before returning, so the SSE2 code after it doesn't pay for the transition.
+	size_t SwapRedBlueAvx2(const Surface::Color* InPixels, Surface::Color* OutPixels, const size_t InNum) noexcept
+	{
+		const auto Shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+		                                      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		size_t Index = 0u;
+
+		for (; Index + 8u <= InNum; Index += 8u)
+		{
+			const auto Pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(InPixels + Index));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(OutPixels + Index), _mm256_shuffle_epi8(Pixels, Shuffle));
+		}
+
+		_mm256_zeroupper();
+		return Index;
+	}
+
+	size_t PremultiplyAvx2(Surface::Color* InOutPixels, const size_t InNum) noexcept
+	{
+		const auto Zero = _mm256_setzero_si256();
+		const auto AlphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+		const auto Rounding = _mm256_set1_epi16(128);
+
+		// Unpacking and packing both work within each 128 bit lane, so the pixels come back where they were.
+		const auto Scale = [Rounding](const __m256i InChannels)
+		{
+			const auto Alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(InChannels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+			const auto Product = _mm256_add_epi16(_mm256_mullo_epi16(InChannels, Alpha), Rounding);
+			return _mm256_srli_epi16(_mm256_add_epi16(Product, _mm256_srli_epi16(Product, 8)), 8);
+		};
+
+		size_t Index = 0u;
+
+		for (; Index + 8u <= InNum; Index += 8u)
+		{
+			auto* const Address = reinterpret_cast<__m256i*>(InOutPixels + Index);
+			const auto Pixels = _mm256_loadu_si256(Address);
+			const auto Scaled = _mm256_packus_epi16(Scale(_mm256_unpacklo_epi8(Pixels, Zero)), Scale(_mm256_unpackhi_epi8(Pixels, Zero)));
+			_mm256_storeu_si256(Address, _mm256_or_si256(_mm256_andnot_si256(AlphaMask, Scaled), _mm256_and_si256(Pixels, AlphaMask)));
+		}
+
+		_mm256_zeroupper();
+		return Index;
+	}
+
+	size_t FillAvx2(Surface::Color* OutPixels, const size_t InNum, const Surface::Color InColor) noexcept
+	{
+		const auto Value = _mm256_set1_epi32(static_cast<int>(InColor.ARGB));
+		size_t Index = 0u;
+
+		for (; Index + 8u <= InNum; Index += 8u)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(OutPixels + Index), Value);
+		}
+
+		_mm256_zeroupper();
+		return Index;
+	}
+
+	std::array<float, KaiserTapNum> MakeKaiserWeights() noexcept
+	{
+		// The zeroth order modified Bessel function of the first kind, its series converges long before the last term here.
+		const auto Bessel = [](const float InX)
+		{
+			float Sum = 1.0f;
+			float Term = 1.0f;
+
+			for (int K = 1; K < 16; ++K)
+			{
+				const float Factor = InX / (2.0f * static_cast<float>(K));
+				Term *= Factor * Factor;
+				Sum += Term;
+			}
+
+			return Sum;
+		};
+
+		std::array<float, KaiserTapNum> Weights {};
+		float Total = 0.0f;
+
+		for (int Tap = 0; Tap < KaiserTapNum; ++Tap)
+		{
+			// Source pixels are half a pixel of the result wide, centred a quarter of one either side of it for the middle two.
+			const float Distance = (static_cast<float>(Tap - KaiserTapNum / 2) + 0.5f) * 0.5f;
+			const float Angle = std::numbers::pi_v<float> * Distance;
+			const float Window = Distance / KaiserWidth;
+
+			Weights[Tap] = std::sin(Angle) / Angle * Bessel(KaiserAlpha * std::sqrt(1.0f - Window * Window)) / Bessel(KaiserAlpha);
+			Total += Weights[Tap];
+		}
+
+		for (auto& Weight : Weights)
+		{
+			Weight /= Total;
+		}
+
+		return Weights;
+	}
+}
+
+void SurfaceKernels::SwapRedBlue(const std::span<const Surface::Color> InRow, const std::span<Surface::Color> OutRow) noexcept
+{
+	assert(InRow.size() == OutRow.size());
+
+	const auto Num = InRow.size();
+	size_t Index = CpuFeatures::HasAvx2() ? SwapRedBlueAvx2(InRow.data(), OutRow.data(), Num) : 0u;
+
+	for (; Index + 4u <= Num; Index += 4u)
+	{
+		const auto Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InRow.data() + Index));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(OutRow.data() + Index), ::SwapRedBlue(Pixels));
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		const auto Pixel = InRow[Index];
+		OutRow[Index] = {Pixel.GetA(), Pixel.GetB(), Pixel.GetG(), Pixel.GetR()};
+	}
+}
+
+void SurfaceKernels::Premultiply(const std::span<Surface::Color> InOutRow) noexcept
+{
+	const auto Num = InOutRow.size();
+	size_t Index = CpuFeatures::HasAvx2() ? PremultiplyAvx2(InOutRow.data(), Num) : 0u;
+
+	for (; Index + 4u <= Num; Index += 4u)
+	{
+		auto* const Address = reinterpret_cast<__m128i*>(InOutRow.data() + Index);
+		_mm_storeu_si128(Address, ::Premultiply(_mm_loadu_si128(Address)));
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		auto& Pixel = InOutRow[Index];
+		const unsigned int Alpha = Pixel.GetA();
+		Pixel = {Pixel.GetA(), ::Premultiply(Pixel.GetR(), Alpha), ::Premultiply(Pixel.GetG(), Alpha), ::Premultiply(Pixel.GetB(), Alpha)};
+	}
+}
+
+void SurfaceKernels::ExtractChannel(const std::span<const Surface::Color> InRow, const Channel InChannel, const std::span<unsigned char> OutBytes) noexcept
+{
+	assert(InRow.size() == OutBytes.size());
+
+	const auto Num = InRow.size();
+	const auto ShiftBits = static_cast<unsigned int>(InChannel) * 8u;
+	const auto Shift = _mm_cvtsi32_si128(static_cast<int>(ShiftBits));
+	const auto Mask = _mm_set1_epi32(0xFF);
+	size_t Index = 0u;
+
+	// Sixteen pixels narrow to one register of bytes, the values are below 256 so neither pack saturates.
+	for (; Index + 16u <= Num; Index += 16u)
+	{
+		const auto Load = [&InRow, Index, Shift, Mask](const size_t InOffset)
+		{
+			const auto Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InRow.data() + Index + InOffset));
+			return _mm_and_si128(_mm_srl_epi32(Pixels, Shift), Mask);
+		};
+
+		const auto Low = _mm_packs_epi32(Load(0u), Load(4u));
+		const auto High = _mm_packs_epi32(Load(8u), Load(12u));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(OutBytes.data() + Index), _mm_packus_epi16(Low, High));
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		OutBytes[Index] = static_cast<unsigned char>(InRow[Index].ARGB >> ShiftBits);
+	}
+}
+
+void SurfaceKernels::Fill(const std::span<Surface::Color> OutRow, const Surface::Color InColor) noexcept
+{
+	const auto Num = OutRow.size();
+	size_t Index = CpuFeatures::HasAvx2() ? FillAvx2(OutRow.data(), Num, InColor) : 0u;
+	const auto Value = _mm_set1_epi32(static_cast<int>(InColor.ARGB));
+
+	for (; Index + 4u <= Num; Index += 4u)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(OutRow.data() + Index), Value);
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		OutRow[Index] = InColor;
+	}
+}
+
+void SurfaceKernels::DownsampleBoxRow(const Surface::Color* InRow, const Surface::Color* InNextRow, const unsigned int InWidth, Surface::Color* OutRow,
+                                      const bool bInIsSrgb) noexcept
+{
+	const unsigned int MipWidth = std::max(1u, InWidth / 2u);
+	unsigned int Column = 0u;
+
+	if (bInIsSrgb)
+	{
+		const auto& Tables = GetTables();
+		const auto Quarter = _mm_set1_ps(0.25f);
+
+		for (; Column < MipWidth; ++Column)
+		{
+			const unsigned int SourceColumn = Column * 2u;
+			const unsigned int NextSourceColumn = std::min(SourceColumn + 1u, InWidth - 1u);
+
+			const auto Sum = _mm_add_ps(_mm_add_ps(Decode(InRow[SourceColumn], Tables.SrgbToLinear, Tables), Decode(InRow[NextSourceColumn], Tables.SrgbToLinear, Tables)),
+			                            _mm_add_ps(Decode(InNextRow[SourceColumn], Tables.SrgbToLinear, Tables), Decode(InNextRow[NextSourceColumn], Tables.SrgbToLinear, Tables)));
+			OutRow[Column] = Encode(_mm_mul_ps(Sum, Quarter), true, Tables);
+		}
+
+		return;
+	}
+
+	// Only a single column clamps, every other width has both columns of each pair.
+	if (InWidth >= 2u)
+	{
+		const auto Zero = _mm_setzero_si128();
+		const auto Rounding = _mm_set1_epi16(2);
+
+		// Four source pixels of both rows, two results at 16 bits a channel.
+		const auto Average = [Zero, Rounding](const Surface::Color* InTop, const Surface::Color* InBottom)
+		{
+			const auto Top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InTop));
+			const auto Bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InBottom));
+			const auto Low = _mm_add_epi16(_mm_unpacklo_epi8(Top, Zero), _mm_unpacklo_epi8(Bottom, Zero));
+			const auto High = _mm_add_epi16(_mm_unpackhi_epi8(Top, Zero), _mm_unpackhi_epi8(Bottom, Zero));
+			const auto Pairs = _mm_add_epi16(_mm_unpacklo_epi64(Low, High), _mm_unpackhi_epi64(Low, High));
+			return _mm_srli_epi16(_mm_add_epi16(Pairs, Rounding), 2);
+		};
+
+		for (; Column + 4u <= MipWidth; Column += 4u)
+		{
+			const auto* const Top = InRow + Column * 2u;
+			const auto* const Bottom = InNextRow + Column * 2u;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(OutRow + Column), _mm_packus_epi16(Average(Top, Bottom), Average(Top + 4u, Bottom + 4u)));
+		}
+	}
+
+	const auto AverageBytes = [](const unsigned int InFirst, const unsigned int InSecond, const unsigned int InThird, const unsigned int InFourth)
+	{
+		return static_cast<unsigned char>((InFirst + InSecond + InThird + InFourth + 2u) / 4u);
+	};
+
+	for (; Column < MipWidth; ++Column)
+	{
+		const unsigned int SourceColumn = Column * 2u;
+		const unsigned int NextSourceColumn = std::min(SourceColumn + 1u, InWidth - 1u);
+		const auto A = InRow[SourceColumn];
+		const auto B = InRow[NextSourceColumn];
+		const auto C = InNextRow[SourceColumn];
+		const auto D = InNextRow[NextSourceColumn];
+
+		OutRow[Column] =
+		{
+			AverageBytes(A.GetA(), B.GetA(), C.GetA(), D.GetA()),
+			AverageBytes(A.GetR(), B.GetR(), C.GetR(), D.GetR()),
+			AverageBytes(A.GetG(), B.GetG(), C.GetG(), D.GetG()),
+			AverageBytes(A.GetB(), B.GetB(), C.GetB(), D.GetB())
+		};
+	}
+}
+
+void SurfaceKernels::DownsampleHalfRow(const uint16_t* InRow, const uint16_t* InNextRow, const unsigned int InWidth, uint16_t* OutRow) noexcept
+{
+	using DirectX::PackedVector::XMConvertFloatToHalf;
+	using DirectX::PackedVector::XMConvertHalfToFloat;
+
+	const unsigned int MipWidth = std::max(1u, InWidth / 2u);
+
+	for (unsigned int Column = 0u; Column < MipWidth; ++Column)
+	{
+		const unsigned int SourceColumn = Column * 2u;
+		const unsigned int NextSourceColumn = std::min(SourceColumn + 1u, InWidth - 1u);
+		const float Sum = XMConvertHalfToFloat(InRow[SourceColumn]) + XMConvertHalfToFloat(InRow[NextSourceColumn]) +
+		                  XMConvertHalfToFloat(InNextRow[SourceColumn]) + XMConvertHalfToFloat(InNextRow[NextSourceColumn]);
+		OutRow[Column] = XMConvertFloatToHalf(Sum * 0.25f);
+	}
+}
+
+Surface::Format SurfaceKernels::DetectFormat(const std::span<const Surface::Color> InRow) noexcept
+{
+	const auto Num = InRow.size();
+	// Blue against green in the low byte and green against red above it, any bit left means colour.
+	const auto GreyMask = _mm_set1_epi32(0xFFFF);
+	auto Differences = _mm_setzero_si128();
+	auto Alphas = _mm_set1_epi32(-1);
+	size_t Index = 0u;
+
+	for (; Index + 4u <= Num; Index += 4u)
+	{
+		const auto Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InRow.data() + Index));
+		Differences = _mm_or_si128(Differences, _mm_and_si128(_mm_xor_si128(Pixels, _mm_srli_epi32(Pixels, 8)), GreyMask));
+		Alphas = _mm_and_si128(Alphas, Pixels);
+	}
+
+	bool bIsGrey = _mm_movemask_epi8(_mm_cmpeq_epi32(Differences, _mm_setzero_si128())) == 0xFFFF;
+	bool bIsOpaque = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(Alphas, 24), _mm_set1_epi32(0xFF))) == 0xFFFF;
+
+	for (; Index < Num; ++Index)
+	{
+		const auto Pixel = InRow[Index];
+		bIsGrey = bIsGrey && Pixel.GetB() == Pixel.GetG() && Pixel.GetG() == Pixel.GetR();
+		bIsOpaque = bIsOpaque && Pixel.GetA() == 0xFFu;
+	}
+
+	return !bIsGrey ? Surface::Format::BGRA8 : bIsOpaque ? Surface::Format::R8 : Surface::Format::R8G8;
+}
+
+void SurfaceKernels::Pack(const std::span<const Surface::Color> InRow, const Surface::Format InFormat, void* OutRow) noexcept
+{
+	assert(InFormat != Surface::Format::R16F && "Half floats are decoded, not packed");
+
+	const auto Num = InRow.size();
+
+	if (InFormat == Surface::Format::BGRA8)
+	{
+		std::copy(InRow.begin(), InRow.end(), static_cast<Surface::Color*>(OutRow));
+		return;
+	}
+
+	if (InFormat == Surface::Format::R8)
+	{
+		ExtractChannel(InRow, Channel::Green, {static_cast<unsigned char*>(OutRow), Num});
+		return;
+	}
+
+	auto* const Texels = static_cast<uint16_t*>(OutRow);
+	size_t Index = 0u;
+
+	// Green to the low byte and alpha above it, then narrowed to 16 bits. The pack saturates signed values, so each lane is
+	// sign extended from its low half first and comes out as the same bits.
+	for (; Index + 8u <= Num; Index += 8u)
+	{
+		const auto Load = [&InRow, Index](const size_t InOffset)
+		{
+			const auto Pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InRow.data() + Index + InOffset));
+			const auto GreyAlpha = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(Pixels, 8), _mm_set1_epi32(0xFF)),
+			                                    _mm_and_si128(_mm_srli_epi32(Pixels, 16), _mm_set1_epi32(0xFF00)));
+			return _mm_srai_epi32(_mm_slli_epi32(GreyAlpha, 16), 16);
+		};
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(Texels + Index), _mm_packs_epi32(Load(0u), Load(4u)));
+	}
+
+	for (; Index < Num; ++Index)
+	{
+		Texels[Index] = static_cast<uint16_t>(InRow[Index].GetG() | InRow[Index].GetA() << 8u);
+	}
+}
+
+void SurfaceKernels::SwapRedBlue(Surface& InOutSurface)
+{
+	const auto Width = InOutSurface.GetWidth();
+	auto* const Pixels = InOutSurface.GetBufferPtr();
+
+	ForEachRow(Width, InOutSurface.GetHeight(), [Width, Pixels](const size_t InRow)
+	{
+		const std::span<Surface::Color> Row {Pixels + InRow * Width, Width};
+		SwapRedBlue(Row, Row);
+	});
+}
+
+void SurfaceKernels::Premultiply(Surface& InOutSurface)
+{
+	const auto Width = InOutSurface.GetWidth();
+	auto* const Pixels = InOutSurface.GetBufferPtr();
+
+	ForEachRow(Width, InOutSurface.GetHeight(), [Width, Pixels](const size_t InRow)
+	{
+		Premultiply({Pixels + InRow * Width, Width});
+	});
+}
+
+std::vector<unsigned char> SurfaceKernels::ExtractChannel(const Surface& InSurface, const Channel InChannel)
+{
+	const auto Width = InSurface.GetWidth();
+	const auto* const Pixels = InSurface.GetBufferPtrConst();
+	std::vector<unsigned char> Bytes(static_cast<size_t>(Width) * InSurface.GetHeight());
+
+	ForEachRow(Width, InSurface.GetHeight(), [Width, Pixels, InChannel, &Bytes](const size_t InRow)
+	{
+		ExtractChannel({Pixels + InRow * Width, Width}, InChannel, {Bytes.data() + InRow * Width, Width});
+	});
+
+	return Bytes;
+}
+
+void SurfaceKernels::Fill(Surface& OutSurface, const Surface::Color InColor)
+{
+	const auto Width = OutSurface.GetWidth();
+	auto* const Pixels = OutSurface.GetBufferPtr();
+
+	ForEachRow(Width, OutSurface.GetHeight(), [Width, Pixels, InColor](const size_t InRow)
+	{
+		Fill({Pixels + InRow * Width, Width}, InColor);
+	});
+}
+
+void SurfaceKernels::DownsampleBox(const Surface::Destination& InSource, const unsigned int InWidth, const unsigned int InHeight,
+                                   const Surface::Destination& OutMip, const bool bInIsSrgb)
+{
+	ForEachRow(InWidth, std::max(1u, InHeight / 2u), [&InSource, InWidth, InHeight, &OutMip, bInIsSrgb](const size_t InRow)
+	{
+		const auto Row = static_cast<unsigned int>(InRow);
+		DownsampleBoxRow(GetRow(InSource, Row * 2u), GetRow(InSource, std::min(Row * 2u + 1u, InHeight - 1u)), InWidth, GetRow(OutMip, Row), bInIsSrgb);
+	});
+}
+
+Surface SurfaceKernels::DownsampleBox(const Surface& InSource, const bool bInIsSrgb)
+{
+	const auto Width = InSource.GetWidth();
+	const auto Height = InSource.GetHeight();
+	Surface Mip {std::max(1u, Width / 2u), std::max(1u, Height / 2u)};
+
+	const auto* const Pixels = InSource.GetBufferPtrConst();
+	auto* const MipPixels = Mip.GetBufferPtr();
+	const auto MipWidth = Mip.GetWidth();
+
+	ForEachRow(Width, Mip.GetHeight(), [Width, Height, Pixels, MipPixels, MipWidth, bInIsSrgb](const size_t InRow)
+	{
+		const auto Row = static_cast<unsigned int>(InRow);
+		const auto* const SourceRow = Pixels + static_cast<size_t>(Row) * 2u * Width;
+		const auto* const NextSourceRow = Pixels + static_cast<size_t>(std::min(Row * 2u + 1u, Height - 1u)) * Width;
+		DownsampleBoxRow(SourceRow, NextSourceRow, Width, MipPixels + InRow * MipWidth, bInIsSrgb);
+	});
+
+	return Mip;
+}
+
+void SurfaceKernels::DownsampleHalf(const Surface::Destination& InSource, const unsigned int InWidth, const unsigned int InHeight,
+                                    const Surface::Destination& OutMip)
+{
+	ForEachRow(InWidth, std::max(1u, InHeight / 2u), [&InSource, InWidth, InHeight, &OutMip](const size_t InRow)
+	{
+		const auto Row = static_cast<unsigned int>(InRow);
+		DownsampleHalfRow(GetRow<const uint16_t>(InSource, Row * 2u), GetRow<const uint16_t>(InSource, std::min(Row * 2u + 1u, InHeight - 1u)),
+		                  InWidth, GetRow<uint16_t>(OutMip, Row));
+	});
+}
+
+Surface::Format SurfaceKernels::DetectFormat(const Surface::Destination& InSource, const unsigned int InWidth, const unsigned int InHeight)
+{
+	std::atomic<bool> bIsGrey {true};
+	std::atomic<bool> bIsOpaque {true};
+
+	ForEachRow(InWidth, InHeight, [&](const size_t InRow)
+	{
+		if (!bIsGrey.load(std::memory_order_relaxed))
+		{
+			return;
+		}
+
+		switch (DetectFormat({GetRow<const Surface::Color>(InSource, static_cast<unsigned int>(InRow)), InWidth}))
+		{
+		case Surface::Format::BGRA8:
+			bIsGrey.store(false, std::memory_order_relaxed);
+			break;
+		case Surface::Format::R8G8:
+			bIsOpaque.store(false, std::memory_order_relaxed);
+			break;
+		default:
+			break;
+		}
+	});
+
+	return !bIsGrey ? Surface::Format::BGRA8 : bIsOpaque ? Surface::Format::R8 : Surface::Format::R8G8;
+}
+
+void SurfaceKernels::Pack(const Surface::Destination& InSource, const unsigned int InWidth, const unsigned int InHeight, const Surface::Format InFormat,
+                          const Surface::Destination& OutPacked)
+{
+	ForEachRow(InWidth, InHeight, [&InSource, InWidth, InFormat, &OutPacked](const size_t InRow)
+	{
+		const auto Row = static_cast<unsigned int>(InRow);
+		Pack({GetRow<const Surface::Color>(InSource, Row), InWidth}, InFormat, GetRow<std::byte>(OutPacked, Row));
+	});
+}
+
+Surface SurfaceKernels::DownsampleKaiser(const Surface& InSource, const bool bInIsSrgb)
+{
+	static const auto Weights = MakeKaiserWeights();
+
+	const auto Width = InSource.GetWidth();
+	const auto Height = InSource.GetHeight();
+	Surface Mip {std::max(1u, Width / 2u), std::max(1u, Height / 2u)};
+
+	const auto* const Pixels = InSource.GetBufferPtrConst();
+	auto* const MipPixels = Mip.GetBufferPtr();
+	const auto MipWidth = Mip.GetWidth();
+
+	// The taps of a result pixel start this many source pixels before the first of its two.
+	constexpr int FirstTap = KaiserTapNum / 2 - 1;
+
+	ForEachRow(Width, Mip.GetHeight(), [Width, Height, Pixels, MipPixels, MipWidth, bInIsSrgb](const size_t InRow)
+	{
+		const auto& Tables = GetTables();
+		const float* const ColorTable = bInIsSrgb ? Tables.SrgbToLinear : Tables.UnitToFloat;
+
+		// The vertical pass over every source column first, then the horizontal one over that row. Each source pixel is decoded
+		// again by every result row it reaches, which keeps the scratch to one row instead of a float copy of the image.
+		std::vector<__m128> Filtered(Width, _mm_setzero_ps());
+
+		for (int Tap = 0; Tap < KaiserTapNum; ++Tap)
+		{
+			const auto SourceRow = std::clamp(static_cast<int>(InRow) * 2 + Tap - FirstTap, 0, static_cast<int>(Height) - 1);
+			const auto* const Source = Pixels + static_cast<size_t>(SourceRow) * Width;
+			const auto Weight = _mm_set1_ps(Weights[Tap]);
+
+			for (unsigned int Column = 0u; Column < Width; ++Column)
+			{
+				Filtered[Column] = _mm_add_ps(Filtered[Column], _mm_mul_ps(Weight, Decode(Source[Column], ColorTable, Tables)));
+			}
+		}
+
+		auto* const MipRow = MipPixels + InRow * MipWidth;
+
+		for (unsigned int Column = 0u; Column < MipWidth; ++Column)
+		{
+			auto Sum = _mm_setzero_ps();
+
+			for (int Tap = 0; Tap < KaiserTapNum; ++Tap)
+			{
+				const auto SourceColumn = std::clamp(static_cast<int>(Column) * 2 + Tap - FirstTap, 0, static_cast<int>(Width) - 1);
+				Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_set1_ps(Weights[Tap]), Filtered[SourceColumn]));
+			}
+
+			MipRow[Column] = Encode(Sum, bInIsSrgb, Tables);
+		}
+	});
+
+	return Mip;
+}
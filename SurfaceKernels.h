@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Surface.h"
+
+/**
+ * SIMD kernels over rows of Surface::Color, for the CPU side of mip generation, atlas packing and format conversion. Every
+ * kernel has an SSE2 path and the byte-wise ones an AVX2 path too, picked once by what the processor supports, with scalar
+ * tails that give the same results. The row kernels run on any thread, the image ones split the rows into jobs on the
+ * JobSystem and wait for them, which is safe from inside a job.
+ * sRGB downsampling decodes the colour channels to linear light first and encodes the result again, alpha is always linear.
+ * Packing narrows Colors to the other Surface::Formats but R16F, which only WIC decodes to, and has its own downsampling.
+ */
+namespace SurfaceKernels
+{
+	// In the order the bytes of a Color lie in memory, DXGI_FORMAT_B8G8R8A8_UNORM's.
+	enum class Channel : unsigned int
+	{
+		Blue,
+		Green,
+		Red,
+		Alpha
+	};
+
+	// BGRA to RGBA and back, the same swap either way. InRow and OutRow are the same size and may be the same row.
+	void SwapRedBlue(std::span<const Surface::Color> InRow, std::span<Surface::Color> OutRow) noexcept;
+	// Colour times alpha, rounded like a blend unit would.
+	void Premultiply(std::span<Surface::Color> InOutRow) noexcept;
+	// One byte per pixel, such as a mask packed into another map's channel. OutBytes is as long as InRow.
+	void ExtractChannel(std::span<const Surface::Color> InRow, Channel InChannel, std::span<unsigned char> OutBytes) noexcept;
+	void Fill(std::span<Surface::Color> OutRow, Surface::Color InColor) noexcept;
+	// One row of the next level down from the two source rows over it, which are InWidth pixels wide. The last row of an odd
+	// height passes its row twice, a single column is averaged with itself.
+	void DownsampleBoxRow(const Surface::Color* InRow, const Surface::Color* InNextRow, unsigned int InWidth, Surface::Color* OutRow,
+	                      bool bInIsSrgb) noexcept;
+	// The same over half floats, averaged in float.
+	void DownsampleHalfRow(const uint16_t* InRow, const uint16_t* InNextRow, unsigned int InWidth, uint16_t* OutRow) noexcept;
+	// What Surface::DetectFormat finds for the row alone.
+	[[nodiscard]] Surface::Format DetectFormat(std::span<const Surface::Color> InRow) noexcept;
+	// Writes the row as InFormat into OutRow, which holds as many texels. R8 keeps green and R8G8 green and alpha, which for
+	// the grey images DetectFormat picks them for is all there is.
+	void Pack(std::span<const Surface::Color> InRow, Surface::Format InFormat, void* OutRow) noexcept;
+
+	void SwapRedBlue(Surface& InOutSurface);
+	void Premultiply(Surface& InOutSurface);
+	[[nodiscard]] std::vector<unsigned char> ExtractChannel(const Surface& InSurface, Channel InChannel);
+	void Fill(Surface& OutSurface, Surface::Color InColor);
+	// Half the size, at least one pixel a side. The level is written through OutMip, which may be mapped memory.
+	void DownsampleBox(const Surface::Destination& InSource, unsigned int InWidth, unsigned int InHeight, const Surface::Destination& OutMip,
+	                   bool bInIsSrgb);
+	[[nodiscard]] Surface DownsampleBox(const Surface& InSource, bool bInIsSrgb);
+	void DownsampleHalf(const Surface::Destination& InSource, unsigned int InWidth, unsigned int InHeight, const Surface::Destination& OutMip);
+	// Stops looking once a row turned out to have colour.
+	[[nodiscard]] Surface::Format DetectFormat(const Surface::Destination& InSource, unsigned int InWidth, unsigned int InHeight);
+	void Pack(const Surface::Destination& InSource, unsigned int InWidth, unsigned int InHeight, Surface::Format InFormat,
+	          const Surface::Destination& OutPacked);
+	// Kaiser windowed sinc over three pixels of the result either way, sharper than the box and without its aliasing, at twelve
+	// taps a side instead of two. Filtered in float, separably, edges clamped.
+	[[nodiscard]] Surface DownsampleKaiser(const Surface& InSource, bool bInIsSrgb);
+}
@@ -0,0 +1,412 @@
+﻿#include "TelemetryServer.h"
+#include "EngineWin.h"
+#include <WinSock2.h>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "AllocationTracker.h"
+#include "Bindable.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "Logger.h"
+#include "StatsHistory.h"
+
+#pragma comment(lib, "Ws2_32.lib")
+
+namespace
+{
+	template<typename T>
+	void AppendNumber(std::string& InOutText, const T InValue)
+	{
+		char Digits[32];
+		std::to_chars_result Result;
+
+		if constexpr (std::is_floating_point_v<T>)
+		{
+			Result = std::to_chars(Digits, Digits + sizeof(Digits), InValue, std::chars_format::fixed, 3);
+		}
+		else
+		{
+			Result = std::to_chars(Digits, Digits + sizeof(Digits), InValue);
+		}
+
+		InOutText.append(Digits, Result.ptr);
+	}
+
+	void AppendString(std::string& InOutText, const char* InText)
+	{
+		InOutText += '"';
+
+		for (; *InText; ++InText)
+		{
+			// Names and replies are plain text, control characters a client could trip on are left out.
+			if (static_cast<unsigned char>(*InText) < 0x20u)
+			{
+				continue;
+			}
+
+			if (*InText == '"' || *InText == '\\')
+			{
+				InOutText += '\\';
+			}
+
+			InOutText += *InText;
+		}
+
+		InOutText += '"';
+	}
+
+	TelemetryServer::Line ToLine(const std::string_view InText) noexcept
+	{
+		TelemetryServer::Line Copied {};
+		const auto Length = std::min(InText.size(), Copied.size() - 1u);
+		std::memcpy(Copied.data(), InText.data(), Length);
+		return Copied;
+	}
+}
+
+TelemetryServer::TelemetryServer(const unsigned short InPort)
+	: ListenSocket(INVALID_SOCKET), ClientSocket(INVALID_SOCKET)
+{
+	WSADATA WinsockData;
+
+	if (WSAStartup(MAKEWORD(2, 2), &WinsockData) != 0)
+	{
+		throw std::runtime_error("Winsock could not start for the telemetry server");
+	}
+
+	const auto Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	sockaddr_in Address {};
+	Address.sin_family = AF_INET;
+	Address.sin_addr.s_addr = htonl(INADDR_ANY);
+	Address.sin_port = htons(InPort);
+	u_long bIsNonBlocking = 1u;
+
+	if (Listener == INVALID_SOCKET || ioctlsocket(Listener, FIONBIO, &bIsNonBlocking) == SOCKET_ERROR ||
+	    bind(Listener, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address)) == SOCKET_ERROR || listen(Listener, 1) == SOCKET_ERROR)
+	{
+		if (Listener != INVALID_SOCKET)
+		{
+			closesocket(Listener);
+		}
+
+		WSACleanup();
+		throw std::runtime_error("The telemetry server could not listen on port " + std::to_string(InPort));
+	}
+
+	ListenSocket = Listener;
+	CpuTimings.reserve(MaxZoneNum);
+	Output.reserve(2u * MaxPendingBytes);
+	Input.reserve(2u * MaxLineLength);
+
+	Thread = std::thread(&TelemetryServer::ThreadLoop, this);
+	LOG_INFO("Telemetry listening on port {}", InPort);
+}
+
+TelemetryServer::~TelemetryServer()
+{
+	bIsStopping.store(true, std::memory_order_release);
+	Thread.join();
+
+	closesocket(ListenSocket);
+	WSACleanup();
+}
+
+void TelemetryServer::Publish(const Graphics& InGraphics, const StatsHistory& InStats)
+{
+	++PublishedNum;
+
+	if (!bIsConnected.load(std::memory_order_acquire))
+	{
+		return;
+	}
+
+	PROFILE_SCOPE("TelemetryServer::Publish");
+
+	const auto Statistics = InGraphics.GetStateStatistics();
+	const auto Lifetimes = Bindable::GetLifetimes();
+
+	Frame Published;
+	Published.Index = PublishedNum;
+	Published.Milliseconds = FrameProfiler::GetLastFrameTime();
+	Published.DrawCalls = Statistics.DrawCalls;
+	Published.StateChanges = Statistics.IssuedCalls;
+	Published.Triangles = Statistics.Triangles;
+	Published.ConstantBytes = Statistics.ConstantBytes;
+	Published.AllocationNum = 0u;
+	Published.AllocatedBytes = 0u;
+	Published.LiveBytes = 0;
+	Published.VideoMemoryBytes = InStats.GetVideoMemory().CurrentUsage;
+	Published.LiveBindableNum = Lifetimes.CreatedNum - Lifetimes.DestroyedNum;
+	Published.DroppedNum = DroppedFrameNum;
+
+	for (unsigned char Tag = 0u; Tag < static_cast<unsigned char>(AllocationTracker::Tag::Num); ++Tag)
+	{
+		const auto Allocated = AllocationTracker::GetLastFrame(static_cast<AllocationTracker::Tag>(Tag));
+		Published.AllocationNum += Allocated.FrameAllocationNum;
+		Published.AllocatedBytes += Allocated.FrameBytes;
+		Published.LiveBytes += Allocated.LiveBytes;
+	}
+
+	// Zones keep the order they were first entered in, the ones past the limit are the least likely to matter.
+	FrameProfiler::GetLastTimings(CpuTimings);
+	Published.ZoneNum = 0u;
+
+	for (const auto& [Name, Depth, Milliseconds, CallNum] : CpuTimings)
+	{
+		if (Published.ZoneNum == MaxZoneNum)
+		{
+			break;
+		}
+
+		if (CallNum)
+		{
+			Published.Zones[Published.ZoneNum++] = {Name, Milliseconds, CallNum};
+		}
+	}
+
+	Published.GpuScopeNum = 0u;
+
+	for (const auto& [Name, Depth, Milliseconds] : InGraphics.GetGpuProfiler().GetLastTimings())
+	{
+		if (Published.GpuScopeNum == MaxGpuScopeNum)
+		{
+			break;
+		}
+
+		Published.GpuScopes[Published.GpuScopeNum++] = {Name, Milliseconds, 1u};
+	}
+
+	if (Frames.Push(Published))
+	{
+		DroppedFrameNum = 0u;
+	}
+	else
+	{
+		++DroppedFrameNum;
+	}
+}
+
+std::optional<TelemetryServer::Line> TelemetryServer::PollCommand() noexcept
+{
+	return Commands.Pop();
+}
+
+void TelemetryServer::Reply(const std::string_view InText) noexcept
+{
+	Replies.Push(ToLine(InText));
+}
+
+void TelemetryServer::AppendFrame(const Frame& InFrame)
+{
+	Output += "{\"frame\":";
+	AppendNumber(Output, InFrame.Index);
+	Output += ",\"ms\":";
+	AppendNumber(Output, InFrame.Milliseconds);
+	Output += ",\"draws\":";
+	AppendNumber(Output, InFrame.DrawCalls);
+	Output += ",\"state_changes\":";
+	AppendNumber(Output, InFrame.StateChanges);
+	Output += ",\"triangles\":";
+	AppendNumber(Output, InFrame.Triangles);
+	Output += ",\"constant_bytes\":";
+	AppendNumber(Output, InFrame.ConstantBytes);
+	Output += ",\"allocations\":";
+	AppendNumber(Output, InFrame.AllocationNum);
+	Output += ",\"allocated_bytes\":";
+	AppendNumber(Output, InFrame.AllocatedBytes);
+	Output += ",\"live_bytes\":";
+	AppendNumber(Output, InFrame.LiveBytes);
+	Output += ",\"video_memory_bytes\":";
+	AppendNumber(Output, InFrame.VideoMemoryBytes);
+	Output += ",\"bindables\":";
+	AppendNumber(Output, InFrame.LiveBindableNum);
+	Output += ",\"dropped\":";
+	AppendNumber(Output, InFrame.DroppedNum);
+
+	Output += ",\"zones\":[";
+	for (unsigned int Index = 0u; Index < InFrame.ZoneNum; ++Index)
+	{
+		Output += Index ? ",{\"name\":" : "{\"name\":";
+		AppendString(Output, InFrame.Zones[Index].Name);
+		Output += ",\"ms\":";
+		AppendNumber(Output, InFrame.Zones[Index].Milliseconds);
+		Output += ",\"calls\":";
+		AppendNumber(Output, InFrame.Zones[Index].CallNum);
+		Output += '}';
+	}
+
+	Output += "],\"gpu\":[";
+	for (unsigned int Index = 0u; Index < InFrame.GpuScopeNum; ++Index)
+	{
+		Output += Index ? ",{\"name\":" : "{\"name\":";
+		AppendString(Output, InFrame.GpuScopes[Index].Name);
+		Output += ",\"ms\":";
+		AppendNumber(Output, InFrame.GpuScopes[Index].Milliseconds);
+		Output += '}';
+	}
+
+	Output += "]}\n";
+}
+
+void TelemetryServer::ThreadLoop()
+{
+	FrameProfiler::SetThreadName("Telemetry");
+
+	const auto AppendReply = [this](const char* InText)
+	{
+		Output += "{\"reply\":";
+		AppendString(Output, InText);
+		Output += "}\n";
+	};
+
+	const auto Disconnect = [this]
+	{
+		closesocket(ClientSocket);
+		ClientSocket = INVALID_SOCKET;
+		bIsConnected.store(false, std::memory_order_release);
+		LOG_INFO("Telemetry client disconnected");
+	};
+
+	std::array<char, 1024u> Received;
+
+	while (!bIsStopping.load(std::memory_order_acquire))
+	{
+		fd_set Readable;
+		fd_set Writable;
+		FD_ZERO(&Readable);
+		FD_ZERO(&Writable);
+		FD_SET(ListenSocket, &Readable);
+
+		if (ClientSocket != INVALID_SOCKET)
+		{
+			FD_SET(ClientSocket, &Readable);
+
+			if (!Output.empty())
+			{
+				FD_SET(ClientSocket, &Writable);
+			}
+		}
+
+		// Winsock ignores the first argument.
+		timeval Timeout {0, PollMicroseconds};
+		if (select(0, &Readable, &Writable, nullptr, &Timeout) == SOCKET_ERROR)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(PollMicroseconds));
+			continue;
+		}
+
+		if (FD_ISSET(ListenSocket, &Readable))
+		{
+			if (const auto Accepted = accept(ListenSocket, nullptr, nullptr); Accepted != INVALID_SOCKET)
+			{
+				u_long bIsNonBlocking = 1u;
+
+				if (ClientSocket != INVALID_SOCKET || ioctlsocket(Accepted, FIONBIO, &bIsNonBlocking) == SOCKET_ERROR)
+				{
+					closesocket(Accepted);
+				}
+				else
+				{
+					// Frames published while nobody listened are stale by now.
+					ClientSocket = Accepted;
+					Frames.Clear();
+					Replies.Clear();
+					Output.clear();
+					Input.clear();
+					bIsConnected.store(true, std::memory_order_release);
+					LOG_INFO("Telemetry client connected");
+				}
+			}
+		}
+
+		if (ClientSocket == INVALID_SOCKET)
+		{
+			continue;
+		}
+
+		if (FD_ISSET(ClientSocket, &Readable))
+		{
+			const auto ReceivedNum = recv(ClientSocket, Received.data(), static_cast<int>(Received.size()), 0);
+
+			if (ReceivedNum == 0 || (ReceivedNum == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK))
+			{
+				Disconnect();
+				continue;
+			}
+
+			Input.append(Received.data(), static_cast<size_t>(std::max(ReceivedNum, 0)));
+
+			for (auto End = Input.find('\n'); End != std::string::npos; End = Input.find('\n'))
+			{
+				std::string_view Command {Input.data(), End};
+
+				if (Command.ends_with('\r'))
+				{
+					Command.remove_suffix(1u);
+				}
+
+				if (Command.size() >= MaxLineLength)
+				{
+					AppendReply("error: command too long");
+				}
+				else if (!Command.empty() && !Commands.Push(ToLine(Command)))
+				{
+					AppendReply("error: busy");
+				}
+
+				Input.erase(0u, End + 1u);
+			}
+
+			// A line that never ends is no command, it is dropped rather than kept growing.
+			if (Input.size() >= MaxLineLength)
+			{
+				AppendReply("error: command too long");
+				Input.clear();
+			}
+		}
+
+		while (const auto Answer = Replies.Pop())
+		{
+			AppendReply(Answer->data());
+		}
+
+		while (Output.size() < MaxPendingBytes)
+		{
+			const auto Next = Frames.Pop();
+
+			if (!Next)
+			{
+				break;
+			}
+
+			AppendFrame(*Next);
+		}
+
+		if (!Output.empty())
+		{
+			const auto SentNum = send(ClientSocket, Output.data(), static_cast<int>(Output.size()), 0);
+
+			if (SentNum == SOCKET_ERROR)
+			{
+				if (WSAGetLastError() != WSAEWOULDBLOCK)
+				{
+					Disconnect();
+				}
+			}
+			else
+			{
+				Output.erase(0u, static_cast<size_t>(SentNum));
+			}
+		}
+	}
+
+	if (ClientSocket != INVALID_SOCKET)
+	{
+		closesocket(ClientSocket);
+	}
+}
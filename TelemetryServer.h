@@ -0,0 +1,107 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "FrameProfiler.h"
+#include "SpscQueue.h"
+
+class Graphics;
+class StatsHistory;
+
+/**
+ * Streams the counters of every frame to a dashboard over TCP, for units nobody watches the overlay of. A client connects
+ * to the port and reads one JSON object per frame and line: the frame time, the CPU zones and GPU scopes, the draws and
+ * state changes, and memory. It writes commands back one per line, which the app reads with PollCommand and answers with
+ * Reply. One client at a time, and nothing authenticates it, so the port is only for a network the units trust.
+ * Publish copies the frame into a fixed queue its own thread formats and sends from, frames the connection can't keep up
+ * with are dropped and reported in the next one sent. Nothing is gathered while no client is connected.
+ */
+class TelemetryServer
+{
+public:
+	static constexpr unsigned int MaxZoneNum {48u};
+	static constexpr unsigned int MaxGpuScopeNum {32u};
+	static constexpr size_t MaxLineLength {128u};
+
+	using Line = std::array<char, MaxLineLength>;
+
+	explicit TelemetryServer(unsigned short InPort);
+	TelemetryServer(const TelemetryServer&) = delete;
+	TelemetryServer(TelemetryServer&&) = delete;
+	TelemetryServer& operator=(const TelemetryServer&) = delete;
+	TelemetryServer& operator=(TelemetryServer&&) = delete;
+	~TelemetryServer();
+
+	// Once a frame after Graphics::BeginFrame and StatsHistory::Record, for the frame the profilers last closed.
+	void Publish(const Graphics& InGraphics, const StatsHistory& InStats);
+	// The oldest command not read yet, without its newline.
+	[[nodiscard]] std::optional<Line> PollCommand() noexcept;
+	// Sent to the client as {"reply": InText}, cut short past MaxLineLength.
+	void Reply(std::string_view InText) noexcept;
+
+private:
+	struct Timing
+	{
+		const char* Name;
+		float Milliseconds;
+		unsigned int CallNum;
+	};
+
+	struct Frame
+	{
+		unsigned long long Index;
+		float Milliseconds;
+		unsigned int DrawCalls;
+		unsigned int StateChanges;
+		unsigned long long Triangles;
+		unsigned long long ConstantBytes;
+		unsigned long long AllocationNum;
+		unsigned long long AllocatedBytes;
+		long long LiveBytes;
+		unsigned long long VideoMemoryBytes;
+		unsigned long long LiveBindableNum;
+		// Frames dropped since the previous one sent.
+		unsigned int DroppedNum;
+		unsigned int ZoneNum;
+		unsigned int GpuScopeNum;
+		std::array<Timing, MaxZoneNum> Zones;
+		std::array<Timing, MaxGpuScopeNum> GpuScopes;
+	};
+
+	// About four seconds at 60 Hz, what one slow moment of the network is given to catch up.
+	static constexpr size_t FrameQueueNum {256u};
+	static constexpr size_t CommandQueueNum {32u};
+	// Formatted frames wait in at most this much unsent output before the queue is no longer drained.
+	static constexpr size_t MaxPendingBytes {64u * 1024u};
+	// How long the thread sleeps on its sockets before looking for frames again.
+	static constexpr long PollMicroseconds {5000};
+
+	void ThreadLoop();
+	void AppendFrame(const Frame& InFrame);
+
+	// Win32 SOCKETs, so includers don't need the Winsock headers.
+	uintptr_t ListenSocket;
+	uintptr_t ClientSocket;
+
+	SpscQueue<Frame, FrameQueueNum> Frames;
+	SpscQueue<Line, CommandQueueNum> Commands;
+	SpscQueue<Line, CommandQueueNum> Replies;
+	std::atomic<bool> bIsConnected {false};
+	std::atomic<bool> bIsStopping {false};
+	// Frames Publish couldn't queue, counted by the publishing thread and sent with the next frame that fits.
+	unsigned int DroppedFrameNum {0u};
+	unsigned long long PublishedNum {0u};
+	std::vector<FrameProfiler::Timing> CpuTimings;
+
+	// The thread's own.
+	std::string Output;
+	std::string Input;
+
+	// Started last, once everything it uses exists.
+	std::thread Thread;
+};
@@ -0,0 +1,278 @@
+﻿#include "TemporalAntiAliasing.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+namespace
+{
+	// Low discrepancy in any prefix, so however many phases are cycled through they spread evenly over the pixel.
+	float Halton(unsigned int InIndex, const unsigned int InBase) noexcept
+	{
+		float Result = 0.0f;
+
+		for (float Fraction = 1.0f / static_cast<float>(InBase); InIndex > 0u; Fraction /= static_cast<float>(InBase))
+		{
+			Result += Fraction * static_cast<float>(InIndex % InBase);
+			InIndex /= InBase;
+		}
+
+		return Result;
+	}
+}
+
+TemporalAntiAliasing::TemporalAntiAliasing(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView,
+                                           ID3D11ShaderResourceView* InSceneView, const DXGI_FORMAT InSceneFormat, const UINT InWidth,
+                                           const UINT InHeight, const UINT InSampleNum)
+	: DepthView(InDepthView), SceneView(InSceneView), SceneFormat(InSceneFormat), Width(InWidth), Height(InHeight), SampleNum(InSampleNum)
+{
+	HRESULT ResultHandle;
+
+	const auto CameraBlob = InShaderBundle.Load("CameraMotionCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(CameraBlob->GetBufferPointer(), CameraBlob->GetBufferSize(), nullptr, &CameraMotionShader))
+
+	const auto ObjectBlob = InShaderBundle.Load("ObjectMotionPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(ObjectBlob->GetBufferPointer(), ObjectBlob->GetBufferSize(), nullptr, &ObjectMotionShader))
+
+	const auto ResolveBlob = InShaderBundle.Load("TemporalResolveCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(ResolveBlob->GetBufferPointer(), ResolveBlob->GetBufferSize(), nullptr, &ResolveShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ConstantBufferDesc.ByteWidth = sizeof(MotionConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &MotionBuffer))
+	ConstantBufferDesc.ByteWidth = sizeof(ResolveConstants);
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ResolveBuffer))
+
+	D3D11_SAMPLER_DESC SamplerDesc {};
+	SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateSamplerState(&SamplerDesc, &Sampler))
+
+	CreateTargets(InDevice);
+}
+
+void TemporalAntiAliasing::Resize(ID3D11Device* InDevice, ID3D11ShaderResourceView* InDepthView, ID3D11ShaderResourceView* InSceneView,
+                                  const UINT InWidth, const UINT InHeight)
+{
+	DepthView = InDepthView;
+	SceneView = InSceneView;
+	Width = InWidth;
+	Height = InHeight;
+	CreateTargets(InDevice);
+	bHasHistory = false;
+}
+
+void TemporalAntiAliasing::CreateTargets(ID3D11Device* InDevice)
+{
+	// Nothing of this is drawn with MSAA, the targets would only take up memory.
+	if (!IsSupported())
+	{
+		return;
+	}
+
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = Width;
+	TextureDesc.Height = Height;
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = MotionFormat;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.Usage = D3D11_USAGE_DEFAULT;
+	// Written by the camera's compute pass, then drawn over by what moved.
+	TextureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> MotionTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, nullptr, &MotionTexture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateRenderTargetView(MotionTexture.Get(), nullptr, &MotionTargetView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(MotionTexture.Get(), nullptr, &MotionView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(MotionTexture.Get(), nullptr, &MotionUav))
+
+	// The scene's format, so the history holds the same range post-processing expects from the scene.
+	TextureDesc.Format = SceneFormat;
+	TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	for (size_t Index = 0u; Index < HistoryViews.size(); ++Index)
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> HistoryTexture;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&TextureDesc, nullptr, &HistoryTexture))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(HistoryTexture.Get(), nullptr, &HistoryViews[Index]))
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(HistoryTexture.Get(), nullptr, &HistoryUavs[Index]))
+	}
+}
+
+void TemporalAntiAliasing::BeginFrame(const Graphics& InGraphics) noexcept
+{
+	MovedDrawables.clear();
+	++FrameIndex;
+
+	// A frame that wasn't resolved breaks the history, the first one after it starts over from its own samples.
+	bHasHistory = bHasHistory && bIsActive;
+	// The history is of one view, a multi-view frame has several in tiles.
+	bIsActive = bIsEnabled && IsSupported() && !InGraphics.IsMultiView();
+
+	PreviousViewProjection = ViewProjection;
+	DirectX::XMStoreFloat4x4(&ViewProjection, InGraphics.GetViewMatrix() * InGraphics.GetProjectionMatrix());
+
+	const auto& Viewport = InGraphics.GetViewport();
+	const auto& DisplayViewport = InGraphics.GetDisplayViewport();
+	ViewportSize = {Viewport.Width, Viewport.Height};
+
+	// Every display pixel needs about as many samples as at full resolution, so the cycle grows as fewer pixels render.
+	const auto PixelRatio = DisplayViewport.Width * DisplayViewport.Height / (Viewport.Width * Viewport.Height);
+	const auto PhaseNum = std::clamp(static_cast<UINT>(std::ceil(PixelRatio * static_cast<float>(MinPhaseNum))), MinPhaseNum, MaxPhaseNum);
+	// Index zero is the pixel's corner in both bases, it would repeat the sample at every cycle's start.
+	const auto Phase = static_cast<unsigned int>(FrameIndex % PhaseNum) + 1u;
+	JitterOffset = {Halton(Phase, 2u) - 0.5f, Halton(Phase, 3u) - 0.5f};
+}
+
+void TemporalAntiAliasing::LatchView(const Graphics& InGraphics) noexcept
+{
+	DirectX::XMStoreFloat4x4(&ViewProjection, InGraphics.GetViewMatrix() * InGraphics.GetProjectionMatrix());
+}
+
+DirectX::XMMATRIX TemporalAntiAliasing::Jitter(DirectX::FXMMATRIX InProjection) const noexcept
+{
+	if (!bIsActive)
+	{
+		return InProjection;
+	}
+
+	// Applied after the projection as a clip space offset scaled by w, so the image shifts by the same pixels at every depth.
+	// Down the screen is down in pixels and up in clip space.
+	return InProjection * DirectX::XMMatrixTranslation(2.0f * JitterOffset.x / ViewportSize.x, -2.0f * JitterOffset.y / ViewportSize.y, 0.0f);
+}
+
+void TemporalAntiAliasing::AddMovedDrawable(const Drawable& InDrawable, DirectX::FXMMATRIX InPreviousTransform)
+{
+	assert(InDrawable.IsDepthOnlySupported() && "Motion is drawn with the depth only vertex shader");
+
+	std::lock_guard Lock(MovedMutex);
+	auto& [Drawn, PreviousTransform] = MovedDrawables.emplace_back();
+	Drawn = &InDrawable;
+	DirectX::XMStoreFloat4x4(&PreviousTransform, InPreviousTransform);
+}
+
+void TemporalAntiAliasing::UploadMotion(const Graphics& InGraphics, DirectX::FXMMATRIX InReprojection)
+{
+	auto& Context = InGraphics.GetImmediateContext();
+
+	MotionConstants Constants {};
+	Constants.Reprojection = DirectX::XMMatrixTranspose(InReprojection);
+	Constants.ViewportSize = ViewportSize;
+	Constants.JitterOffset = JitterOffset;
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(Context.GetDeviceContext()->Map(MotionBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	Context.GetDeviceContext()->Unmap(MotionBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+}
+
+void TemporalAntiAliasing::RenderMotion(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Motion vectors");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+	auto* const DeviceContext = Context.GetDeviceContext();
+
+	// From a pixel of this frame, drawn jittered, back to the world and into last frame's view without its jitter.
+	const auto ToWorld = DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewProjectionMatrix());
+	const auto FromWorld = DirectX::XMLoadFloat4x4(&PreviousViewProjection);
+	UploadMotion(InGraphics, ToWorld * FromWorld);
+
+	// Depth is read here, it can't stay bound to the output merger meanwhile.
+	Cache.SetRenderTarget(nullptr, nullptr);
+	DeviceContext->CSSetShader(CameraMotionShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, MotionBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(CameraDepthSlot, 1u, &DepthView);
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, MotionUav.GetAddressOf(), nullptr);
+
+	const auto GroupNumX = (static_cast<UINT>(ViewportSize.x) + GroupSize - 1u) / GroupSize;
+	const auto GroupNumY = (static_cast<UINT>(ViewportSize.y) + GroupSize - 1u) / GroupSize;
+	InGraphics.Dispatch(GroupNumX, GroupNumY);
+
+	if (!MovedDrawables.empty())
+	{
+		// Only where each one's surfaces are still in front, through the same vertex shader that laid down their depth.
+		ID3D11RenderTargetView* const Targets[] = {MotionTargetView.Get()};
+		InGraphics.BindFrameState(Context);
+		InGraphics.BindRenderTargets(Context, Targets);
+		InGraphics.BindDepthTest(Context, DepthTest::Equal);
+		Cache.SetPixelConstantBuffer(ConstantSlot, MotionBuffer.Get());
+
+		for (const auto& [Drawn, PreviousTransform] : MovedDrawables)
+		{
+			// Back from the world into the drawable's own space, then out again where it was last frame.
+			const auto ToPrevious = DirectX::XMMatrixInverse(nullptr, Drawn->GetTransformMatrix()) * DirectX::XMLoadFloat4x4(&PreviousTransform);
+			UploadMotion(InGraphics, ToWorld * ToPrevious * FromWorld);
+			Drawn->DrawWithPixelShader(Context, ObjectMotionShader.Get());
+		}
+	}
+
+	InGraphics.BindFrameState(Context);
+}
+
+void TemporalAntiAliasing::Resolve(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Temporal resolve");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+	const auto& DisplayViewport = InGraphics.GetDisplayViewport();
+
+	ResolveConstants Constants {};
+	Constants.RenderSize = ViewportSize;
+	Constants.DisplaySize = {DisplayViewport.Width, DisplayViewport.Height};
+	Constants.TextureSize = {static_cast<float>(Width), static_cast<float>(Height)};
+	Constants.JitterOffset = JitterOffset;
+	Constants.CurrentWeight = CurrentWeight;
+	Constants.bHasHistory = bHasHistory;
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ResolveBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ResolveBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	// Last frame's output is read while this frame's is written into the other history.
+	const auto PreviousIndex = HistoryIndex;
+	HistoryIndex ^= 1u;
+
+	Context.GetStateCache().SetRenderTarget(nullptr, nullptr);
+
+	ID3D11ShaderResourceView* const Views[] = {SceneView, DepthView, MotionView.Get(), HistoryViews[PreviousIndex].Get()};
+	static_assert(SceneSlot == 0u && DepthSlot == SceneSlot + 1u && MotionSlot == DepthSlot + 1u && HistorySlot == MotionSlot + 1u,
+	              "Views are bound as one range");
+
+	DeviceContext->CSSetShader(ResolveShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ResolveBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(SceneSlot, static_cast<UINT>(std::size(Views)), Views);
+	DeviceContext->CSSetSamplers(SamplerSlot, 1u, Sampler.GetAddressOf());
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, HistoryUavs[HistoryIndex].GetAddressOf(), nullptr);
+
+	const auto GroupNumX = (static_cast<UINT>(DisplayViewport.Width) + GroupSize - 1u) / GroupSize;
+	const auto GroupNumY = (static_cast<UINT>(DisplayViewport.Height) + GroupSize - 1u) / GroupSize;
+	InGraphics.Dispatch(GroupNumX, GroupNumY);
+
+	bHasHistory = true;
+}
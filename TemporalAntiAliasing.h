@@ -0,0 +1,179 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <cstdint>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "wrl/client.h"
+
+class Drawable;
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Temporal anti-aliasing, accumulating the frames into a history at the display's resolution instead of drawing every
+ * pass at more samples. Each frame the projection is offset by a different sub-pixel jitter, so over a few frames every
+ * display pixel is covered by samples at many positions, even when the scene renders below the display's size.
+ * Motion vectors say where each pixel was last frame: from depth and the camera's last view for everything, then from
+ * the last transform of whatever moved, drawn over the surfaces it left in the depth buffer. The resolve reprojects the
+ * history through them, clamps it to the spread of the current pixel's neighbours so what was disoccluded or changed
+ * doesn't ghost, and blends in the jittered samples weighted by how close they fall to the display pixel.
+ * Only without MSAA, which it replaces. The layout of the motion constants is in Motion.hlsli.
+ */
+class TemporalAntiAliasing
+{
+public:
+	static constexpr DXGI_FORMAT MotionFormat {DXGI_FORMAT_R16G16_FLOAT};
+	// Jitter positions cycled through at the display's resolution, more once the scene renders below it.
+	static constexpr UINT MinPhaseNum {8u};
+	static constexpr UINT MaxPhaseNum {32u};
+
+	// The depth and scene views are Graphics', InWidth by InHeight their size, which is the display's.
+	TemporalAntiAliasing(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView,
+	                     ID3D11ShaderResourceView* InSceneView, DXGI_FORMAT InSceneFormat, UINT InWidth, UINT InHeight, UINT InSampleNum);
+	TemporalAntiAliasing(const TemporalAntiAliasing&) = delete;
+	TemporalAntiAliasing(TemporalAntiAliasing&&) = delete;
+	TemporalAntiAliasing& operator=(const TemporalAntiAliasing&) = delete;
+	TemporalAntiAliasing& operator=(TemporalAntiAliasing&&) = delete;
+	~TemporalAntiAliasing() = default;
+
+	// For Graphics' depth and scene views recreated at InWidth by InHeight. The history is of the old size, the next frame starts over.
+	void Resize(ID3D11Device* InDevice, ID3D11ShaderResourceView* InDepthView, ID3D11ShaderResourceView* InSceneView, UINT InWidth, UINT InHeight);
+
+	// Once the camera's view and the frame's viewport are known, before anything is drawn: takes the next jitter and
+	// keeps last frame's view projection to reproject from.
+	void BeginFrame(const Graphics& InGraphics) noexcept;
+	// After Graphics::LatchView moved the camera, so this frame's motion is reprojected from where it is drawn.
+	void LatchView(const Graphics& InGraphics) noexcept;
+	// InProjection offset by this frame's jitter, unchanged while inactive.
+	[[nodiscard]] DirectX::XMMATRIX Jitter(DirectX::FXMMATRIX InProjection) const noexcept;
+	// A drawable whose transform differs from last frame's, which gets motion vectors of its own. Any thread during submission.
+	void AddMovedDrawable(const Drawable& InDrawable, DirectX::FXMMATRIX InPreviousTransform);
+
+	// Writes the frame's motion vectors once its depth is final.
+	void RenderMotion(const Graphics& InGraphics);
+	// Blends the resolved scene into the history on the immediate context, after the frame is drawn.
+	void Resolve(const Graphics& InGraphics);
+
+	// What the last Resolve wrote, at the display's resolution and viewport.
+	[[nodiscard]] ID3D11ShaderResourceView* GetOutput() const noexcept
+	{
+		return HistoryViews[HistoryIndex].Get();
+	}
+
+	// Whether this frame is jittered and resolved, decided by BeginFrame.
+	[[nodiscard]] bool IsActive() const noexcept
+	{
+		return bIsActive;
+	}
+
+	// Takes effect from the next BeginFrame.
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+	[[nodiscard]] bool IsSupported() const noexcept
+	{
+		return SampleNum == 1u;
+	}
+
+	// Of the current frame in each resolved pixel at most, lower keeps more history and smooths more.
+	void SetCurrentWeight(const float InWeight) noexcept
+	{
+		CurrentWeight = InWeight;
+	}
+
+	[[nodiscard]] float GetCurrentWeight() const noexcept
+	{
+		return CurrentWeight;
+	}
+
+	[[nodiscard]] UINT GetMovedDrawableNum() const noexcept
+	{
+		return static_cast<UINT>(MovedDrawables.size());
+	}
+
+private:
+	struct MotionConstants
+	{
+		// From this frame's clip space at a pixel to where the same surface was in last frame's.
+		DirectX::XMMATRIX Reprojection;
+		DirectX::XMFLOAT2 ViewportSize;
+		DirectX::XMFLOAT2 JitterOffset;
+	};
+
+	struct ResolveConstants
+	{
+		DirectX::XMFLOAT2 RenderSize;
+		DirectX::XMFLOAT2 DisplaySize;
+		DirectX::XMFLOAT2 TextureSize;
+		// Render pixels the frame's samples sit off their texel centers.
+		DirectX::XMFLOAT2 JitterOffset;
+		float CurrentWeight;
+		UINT bHasHistory;
+		float Padding[2];
+	};
+
+	void CreateTargets(ID3D11Device* InDevice);
+	void UploadMotion(const Graphics& InGraphics, DirectX::FXMMATRIX InReprojection);
+
+	// Registers in Motion.hlsli, CameraMotionCS.hlsl, ObjectMotionPS.hlsl and TemporalResolveCS.hlsl, each pass starts its views from zero.
+	static constexpr UINT ConstantSlot {0u};
+	static constexpr UINT SceneSlot {0u};
+	static constexpr UINT DepthSlot {1u};
+	static constexpr UINT MotionSlot {2u};
+	static constexpr UINT HistorySlot {3u};
+	static constexpr UINT CameraDepthSlot {0u};
+	static constexpr UINT OutputSlot {0u};
+	static constexpr UINT SamplerSlot {0u};
+	static constexpr UINT GroupSize {8u};
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> CameraMotionShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> ObjectMotionShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> ResolveShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> MotionBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ResolveBuffer;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> Sampler;
+
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> MotionTargetView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> MotionUav;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MotionView;
+	// Written and read in turn, the one HistoryIndex names is the last output.
+	std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, 2u> HistoryViews;
+	std::array<Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>, 2u> HistoryUavs;
+
+	ID3D11ShaderResourceView* DepthView;
+	ID3D11ShaderResourceView* SceneView;
+	DXGI_FORMAT SceneFormat;
+	UINT Width;
+	UINT Height;
+	UINT SampleNum;
+
+	// Without jitter, so the history reprojects onto where surfaces are rather than where last frame's samples were.
+	DirectX::XMFLOAT4X4 ViewProjection {};
+	DirectX::XMFLOAT4X4 PreviousViewProjection {};
+	std::mutex MovedMutex;
+	std::vector<std::pair<const Drawable*, DirectX::XMFLOAT4X4>> MovedDrawables;
+	uint64_t FrameIndex {0u};
+	DirectX::XMFLOAT2 JitterOffset {};
+	DirectX::XMFLOAT2 ViewportSize {1.0f, 1.0f};
+	UINT HistoryIndex {0u};
+	float CurrentWeight {0.1f};
+	bool bIsEnabled {false};
+	bool bIsActive {false};
+	bool bHasHistory {false};
+};
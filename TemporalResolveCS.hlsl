@@ -0,0 +1,109 @@
+// Blends this frame's jittered samples into the reprojected history, one thread per display pixel in 8x8 tiles.
+// The scene may render below the display's size, the samples near each display pixel are filtered onto it, so the
+// history fills in the detail the frames rendered at different jitters had between them.
+Texture2D<float4> Scene : register(t0);
+Texture2D<float> Depth : register(t1);
+Texture2D<float2> Motion : register(t2);
+Texture2D<float4> History : register(t3);
+SamplerState LinearClamp : register(s0);
+RWTexture2D<float4> Output : register(u0);
+
+// Laid out like TemporalAntiAliasing::ResolveConstants.
+cbuffer Resolve : register(b0)
+{
+    // The part of the scene rendered this frame and the part of the history it resolves into, both from their top left.
+    float2 RenderSize;
+    float2 DisplaySize;
+    float2 TextureSize;
+    float2 JitterOffset;
+    float CurrentWeight;
+    uint bHasHistory;
+    float2 ResolvePadding;
+}
+
+// Standard deviations the history may stray from the neighbours' mean, wider keeps more detail and more ghosting.
+static const float ClipScale = 1.25f;
+
+// Karis' Gaussian fit of a Blackman-Harris window one pixel wide, by squared distance in pixels.
+float GetFilterWeight(const float InSquaredDistance)
+{
+    return exp(-2.29f * InSquaredDistance);
+}
+
+// Inverse luminance, so a single bright sample doesn't flicker through the average.
+float GetLumaWeight(const float3 InColor)
+{
+    return rcp(1.0f + dot(InColor, float3(0.2126f, 0.7152f, 0.0722f)));
+}
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= (uint2) DisplaySize))
+    {
+        return;
+    }
+
+    // Where the display pixel's center falls among the render pixels, each sample sits JitterOffset off its texel's center.
+    const float2 Coordinate = (InThreadID.xy + 0.5f) / DisplaySize;
+    const float2 RenderPosition = Coordinate * RenderSize;
+    const int2 Nearest = (int2) floor(RenderPosition + JitterOffset);
+    const int2 MaxTexel = (int2) RenderSize - 1;
+
+    float3 Filtered = 0.0f;
+    float FilterWeightSum = 0.0f;
+    float3 Moment1 = 0.0f;
+    float3 Moment2 = 0.0f;
+    float ClosestDepth = 1.0f;
+    int2 ClosestTexel = clamp(Nearest, int2(0, 0), MaxTexel);
+
+    [unroll]
+    for (int Y = -1; Y <= 1; ++Y)
+    {
+        [unroll]
+        for (int X = -1; X <= 1; ++X)
+        {
+            const int2 Texel = clamp(Nearest + int2(X, Y), int2(0, 0), MaxTexel);
+            const float3 Color = Scene[Texel].rgb;
+            const float2 Offset = Texel + 0.5f - JitterOffset - RenderPosition;
+            const float Weight = GetFilterWeight(dot(Offset, Offset)) * GetLumaWeight(Color);
+
+            Filtered += Color * Weight;
+            FilterWeightSum += Weight;
+            Moment1 += Color;
+            Moment2 += Color * Color;
+
+            // Motion is taken from the nearest surface around, so edges of what moved carry its motion and don't smear.
+            const float TexelDepth = Depth[Texel];
+
+            if (TexelDepth < ClosestDepth)
+            {
+                ClosestDepth = TexelDepth;
+                ClosestTexel = Texel;
+            }
+        }
+    }
+
+    const float3 Current = Filtered / max(FilterWeightSum, 1e-5f);
+    const float2 PreviousCoordinate = Coordinate - Motion[ClosestTexel];
+
+    if (!bHasHistory || any(PreviousCoordinate != saturate(PreviousCoordinate)))
+    {
+        Output[InThreadID.xy] = float4(Current, 1.0f);
+        return;
+    }
+
+    // Clipped to the spread of the neighbourhood, history that no longer matches what is there now is pulled back to it.
+    const float3 Mean = Moment1 / 9.0f;
+    const float3 Deviation = sqrt(max(Moment2 / 9.0f - Mean * Mean, 0.0f));
+    const float3 Previous = clamp(History.SampleLevel(LinearClamp, PreviousCoordinate * DisplaySize / TextureSize, 0.0f).rgb,
+                                  Mean - Deviation * ClipScale, Mean + Deviation * ClipScale);
+
+    // Below the display's resolution most display pixels have no sample close by, those lean on the history instead.
+    const float2 NearestOffset = (Nearest + 0.5f - JitterOffset - RenderPosition) * DisplaySize / RenderSize;
+    const float Blend = CurrentWeight * GetFilterWeight(dot(NearestOffset, NearestOffset));
+    const float CurrentLumaWeight = Blend * GetLumaWeight(Current);
+    const float PreviousLumaWeight = (1.0f - Blend) * GetLumaWeight(Previous);
+
+    Output[InThreadID.xy] = float4((Current * CurrentLumaWeight + Previous * PreviousLumaWeight) / (CurrentLumaWeight + PreviousLumaWeight), 1.0f);
+}
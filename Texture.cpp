@@ -1,71 +1,1045 @@
 ﻿#include "Texture.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include "AssetArchive.h"
 #include "BindManager.h"
+#include "DDSFormat.h"
+#include "DrawPacket.h"
 #include "ExceptionMacros.h"
+#include "JobSystem.h"
 #include "Surface.h"
+#include "SurfaceKernels.h"
+#include "TextureStreamer.h"
+#include "UploadManager.h"
+#include "VirtualTextureCache.h"
 
-Texture::Texture(const Graphics& InGraphics, const std::string& InFileName, unsigned int InSlot)
+namespace
+{
+	struct TextureData
+	{
+		D3D11_TEXTURE2D_DESC Desc {};
+		std::vector<D3D11_SUBRESOURCE_DATA> Levels;
+		// Keeps the memory Levels point into alive until the texture is created, unless they point into a mapped texture.
+		std::vector<std::vector<std::byte>> MipStorage;
+		std::vector<std::byte> FileBytes;
+	};
+
+	// The levels of a streamed texture mapped for its decode, from FirstMip of the full image on.
+	struct MappedLevels
+	{
+		D3D11_TEXTURE2D_DESC Desc;
+		UINT FirstMip;
+		std::span<const D3D11_MAPPED_SUBRESOURCE> Levels;
+	};
+
+	[[noreturn]] void ThrowLoadError(const std::string& InFileName, const char* InReason)
+	{
+		std::stringstream Stringstream;
+		Stringstream << "Loading texture [" << InFileName << "]: " << InReason;
+		throw INFO_EXCEPTION({Stringstream.str()});
+	}
+
+	DXGI_FORMAT GetImageFormat(const Surface::Format InFormat) noexcept
+	{
+		switch (InFormat)
+		{
+		case Surface::Format::R8G8:
+			return DXGI_FORMAT_R8G8_UNORM;
+		case Surface::Format::R8:
+			return DXGI_FORMAT_R8_UNORM;
+		case Surface::Format::R16F:
+			return DXGI_FORMAT_R16_FLOAT;
+		default:
+			return DXGI_FORMAT_B8G8R8A8_UNORM;
+		}
+	}
+
+	// Decodes the image and box-filters the full mip chain on the CPU, the loader threads have no context for GenerateMips.
+	// The maps are filtered as they are stored, the shaders decode sRGB themselves and normal maps aren't colours at all.
+	// Packed images are kept in the fewest channels Surface::DetectFormat finds, or decoded to R16F when the file has more
+	// bits of grey than BGRA8 keeps. Their levels are filtered as Colors and packed after, the grey level averages the same.
+	// Levels InMapped holds are decoded and filtered in place, once the image turns out to be the size and format they were
+	// mapped for.
+	void DecodeImage(const std::string& InFileName, const std::span<const std::byte> InFileBytes, const bool bInIsPacked, TextureData& OutData,
+	                 const MappedLevels* InMapped = nullptr)
+	{
+		const auto DecodedFormat = bInIsPacked ? Surface::ReadFormat(InFileName, InFileBytes) : Surface::Format::BGRA8;
+		bool bIsMappedSize = false;
+		bool bIsDecodedMapped = false;
+		// Levels as decoded and filtered that aren't mapped, those of a packed image only live until they are packed.
+		std::vector<std::vector<std::byte>> Decoded;
+
+		const auto GetDestination = [InMapped](const UINT InLevel, const unsigned int InWidth, const unsigned int InHeight, const Surface::Format InFormat,
+		                                       const bool bInIsMapped, std::vector<std::vector<std::byte>>& OutStorage)
+		{
+			if (bInIsMapped && InLevel >= InMapped->FirstMip)
+			{
+				const auto& Level = InMapped->Levels[InLevel - InMapped->FirstMip];
+				return Surface::Destination {Level.pData, Level.RowPitch};
+			}
+
+			const unsigned int RowPitch = InWidth * Surface::GetTexelBytes(InFormat);
+			auto& Storage = OutStorage.emplace_back(static_cast<size_t>(RowPitch) * InHeight);
+			return Surface::Destination {Storage.data(), RowPitch};
+		};
+
+		unsigned int Width = 0u;
+		unsigned int Height = 0u;
+		Surface::Destination Source {};
+
+		Surface::FromMemory(InFileName, InFileBytes, DecodedFormat, [&](const unsigned int InWidth, const unsigned int InHeight)
+		{
+			Width = InWidth;
+			Height = InHeight;
+			bIsMappedSize = InMapped && InMapped->Desc.Width == InWidth && InMapped->Desc.Height == InHeight &&
+			                InMapped->Desc.MipLevels == static_cast<UINT>(std::bit_width(std::max(InWidth, InHeight)));
+			bIsDecodedMapped = bIsMappedSize && InMapped->Desc.Format == GetImageFormat(DecodedFormat);
+			Source = GetDestination(0u, InWidth, InHeight, DecodedFormat, bIsDecodedMapped, Decoded);
+			return Source;
+		});
+
+		// Only Colors narrow any further, which takes the whole image to tell.
+		const auto Format = bInIsPacked && DecodedFormat == Surface::Format::BGRA8 ? SurfaceKernels::DetectFormat(Source, Width, Height) : DecodedFormat;
+		const bool bIsPacking = Format != DecodedFormat;
+		const bool bIsPackedMapped = bIsPacking && bIsMappedSize && InMapped->Desc.Format == GetImageFormat(Format);
+
+		const auto AddLevel = [&](const Surface::Destination& InLevel, const unsigned int InWidth, const unsigned int InHeight)
+		{
+			auto Level = InLevel;
+
+			if (bIsPacking)
+			{
+				Level = GetDestination(static_cast<UINT>(OutData.Levels.size()), InWidth, InHeight, Format, bIsPackedMapped, OutData.MipStorage);
+				SurfaceKernels::Pack(InLevel, InWidth, InHeight, Format, Level);
+			}
+
+			OutData.Levels.push_back({Level.Pixels, Level.RowPitch, 0u});
+		};
+
+		OutData.Desc.Width = Width;
+		OutData.Desc.Height = Height;
+		AddLevel(Source, Width, Height);
+
+		while (Width > 1u || Height > 1u)
+		{
+			const unsigned int MipWidth = std::max(1u, Width / 2u);
+			const unsigned int MipHeight = std::max(1u, Height / 2u);
+			const auto Mip = GetDestination(static_cast<UINT>(OutData.Levels.size()), MipWidth, MipHeight, DecodedFormat, bIsDecodedMapped, Decoded);
+
+			if (DecodedFormat == Surface::Format::R16F)
+			{
+				SurfaceKernels::DownsampleHalf(Source, Width, Height, Mip);
+			}
+			else
+			{
+				SurfaceKernels::DownsampleBox(Source, Width, Height, Mip, false);
+			}
+
+			AddLevel(Mip, MipWidth, MipHeight);
+
+			Width = MipWidth;
+			Height = MipHeight;
+			Source = Mip;
+		}
+
+		// Moving the vectors keeps their bytes where the levels point.
+		if (!bIsPacking)
+		{
+			std::move(Decoded.begin(), Decoded.end(), std::back_inserter(OutData.MipStorage));
+		}
+
+		OutData.Desc.MipLevels = static_cast<UINT>(OutData.Levels.size());
+		OutData.Desc.Format = GetImageFormat(Format);
+	}
+
+	DXGI_FORMAT GetBlockCompressedFormat(const DDSPixelFormat& InPixelFormat) noexcept
+	{
+		if (!(InPixelFormat.Flags & DDSFourCCFlag))
+		{
+			return DXGI_FORMAT_UNKNOWN;
+		}
+
+		switch (InPixelFormat.FourCC)
+		{
+		case MakeFourCC('D', 'X', 'T', '1'):
+			return DXGI_FORMAT_BC1_UNORM;
+		case MakeFourCC('D', 'X', 'T', '5'):
+			return DXGI_FORMAT_BC3_UNORM;
+		case MakeFourCC('A', 'T', 'I', '1'):
+		case MakeFourCC('B', 'C', '4', 'U'):
+			return DXGI_FORMAT_BC4_UNORM;
+		case MakeFourCC('A', 'T', 'I', '2'):
+		case MakeFourCC('B', 'C', '5', 'U'):
+			return DXGI_FORMAT_BC5_UNORM;
+		default:
+			return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	bool IsSupportedBlockFormat(const DXGI_FORMAT InFormat) noexcept
+	{
+		return InFormat == DXGI_FORMAT_BC1_UNORM || InFormat == DXGI_FORMAT_BC3_UNORM || InFormat == DXGI_FORMAT_BC4_UNORM ||
+			   InFormat == DXGI_FORMAT_BC5_UNORM || InFormat == DXGI_FORMAT_BC7_UNORM;
+	}
+
+	// BC1 and BC4 keep half the bits per texel of the others.
+	UINT GetBlockBytes(const DXGI_FORMAT InFormat) noexcept
+	{
+		return InFormat == DXGI_FORMAT_BC1_UNORM || InFormat == DXGI_FORMAT_BC4_UNORM ? 8u : 16u;
+	}
+
+	// Of the formats GetImageFormat gives.
+	UINT GetTexelBytes(const DXGI_FORMAT InFormat) noexcept
+	{
+		switch (InFormat)
+		{
+		case DXGI_FORMAT_R8_UNORM:
+			return 1u;
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R16_FLOAT:
+			return 2u;
+		default:
+			return static_cast<UINT>(sizeof(Surface::Color));
+		}
+	}
+
+	// Every level as the GPU stores it, one 4x4 block per unit for compressed formats and one texel otherwise.
+	size_t GetTextureByteSize(const D3D11_TEXTURE2D_DESC& InDesc) noexcept
+	{
+		const bool bIsBlockCompressed = IsSupportedBlockFormat(InDesc.Format);
+		const UINT UnitBytes = bIsBlockCompressed ? GetBlockBytes(InDesc.Format) : GetTexelBytes(InDesc.Format);
+		const UINT UnitSize = bIsBlockCompressed ? 4u : 1u;
+		size_t Bytes = 0u;
+
+		for (UINT Level = 0; Level < InDesc.MipLevels; ++Level)
+		{
+			const UINT LevelWidth = std::max(1u, InDesc.Width >> Level);
+			const UINT LevelHeight = std::max(1u, InDesc.Height >> Level);
+			Bytes += static_cast<size_t>((LevelWidth + UnitSize - 1u) / UnitSize) * ((LevelHeight + UnitSize - 1u) / UnitSize) * UnitBytes;
+		}
+
+		return Bytes * InDesc.ArraySize;
+	}
+
+	// Size, format and level count of a 2D BC1/BC3/BC4/BC5/BC7 file, returns where the first level starts.
+	const char* ReadDDSHeader(const std::string& InFileName, const char* Cursor, const char* const End, D3D11_TEXTURE2D_DESC& OutDesc)
+	{
+		uint32_t Magic;
+		DDSHeader Header;
+		if (End - Cursor < static_cast<ptrdiff_t>(sizeof(Magic) + sizeof(Header)))
+		{
+			ThrowLoadError(InFileName, "truncated header.");
+		}
+
+		memcpy(&Magic, Cursor, sizeof(Magic));
+		memcpy(&Header, Cursor + sizeof(Magic), sizeof(Header));
+		Cursor += sizeof(Magic) + sizeof(Header);
+
+		if (Magic != DDSMagic || Header.Size != sizeof(DDSHeader) || Header.PixelFormat.Size != sizeof(DDSPixelFormat))
+		{
+			ThrowLoadError(InFileName, "not a DDS file.");
+		}
+
+		if (Header.Caps2 & DDSCubeMapFlag)
+		{
+			ThrowLoadError(InFileName, "cube maps are not supported.");
+		}
+
+		DXGI_FORMAT Format = GetBlockCompressedFormat(Header.PixelFormat);
+
+		if ((Header.PixelFormat.Flags & DDSFourCCFlag) && Header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			DDSHeaderDXT10 HeaderDXT10;
+			if (End - Cursor < static_cast<ptrdiff_t>(sizeof(HeaderDXT10)))
+			{
+				ThrowLoadError(InFileName, "truncated DX10 header.");
+			}
+
+			memcpy(&HeaderDXT10, Cursor, sizeof(HeaderDXT10));
+			Cursor += sizeof(HeaderDXT10);
+
+			if (HeaderDXT10.ResourceDimension != DDSResourceDimensionTexture2D || HeaderDXT10.ArraySize != 1u)
+			{
+				ThrowLoadError(InFileName, "only single 2D textures are supported.");
+			}
+
+			Format = HeaderDXT10.Format;
+		}
+
+		if (!IsSupportedBlockFormat(Format))
+		{
+			ThrowLoadError(InFileName, "only BC1, BC3, BC4, BC5 and BC7 are supported.");
+		}
+
+		OutDesc.Width = Header.Width;
+		OutDesc.Height = Header.Height;
+		OutDesc.MipLevels = (Header.Flags & DDSMipMapCountFlag) ? std::clamp(Header.MipMapCount, 1u, static_cast<UINT>(D3D11_REQ_MIP_LEVELS)) : 1u;
+		OutDesc.Format = Format;
+
+		return Cursor;
+	}
+
+	// Accepts what ReadDDSHeader does with the whole mip chain present, the levels point straight into the file bytes.
+	void DecodeDDS(const std::string& InFileName, const std::span<const std::byte> InFileBytes, TextureData& OutData)
+	{
+		const char* const Begin = reinterpret_cast<const char*>(InFileBytes.data());
+		const char* const End = Begin + InFileBytes.size();
+		const char* Cursor = ReadDDSHeader(InFileName, Begin, End, OutData.Desc);
+
+		const UINT BlockBytes = GetBlockBytes(OutData.Desc.Format);
+
+		for (UINT Level = 0; Level < OutData.Desc.MipLevels; ++Level)
+		{
+			const UINT LevelWidth = std::max(1u, OutData.Desc.Width >> Level);
+			const UINT LevelHeight = std::max(1u, OutData.Desc.Height >> Level);
+			const UINT RowPitch = std::max(1u, (LevelWidth + 3u) / 4u) * BlockBytes;
+			const size_t LevelBytes = static_cast<size_t>(RowPitch) * std::max(1u, (LevelHeight + 3u) / 4u);
+
+			if (static_cast<size_t>(End - Cursor) < LevelBytes)
+			{
+				ThrowLoadError(InFileName, "truncated mip chain.");
+			}
+
+			OutData.Levels.push_back({Cursor, RowPitch, 0u});
+			Cursor += LevelBytes;
+		}
+	}
+
+	// Everything but the size, format and level count, which come from the file.
+	void SetTextureDesc(D3D11_TEXTURE2D_DESC& OutDesc) noexcept
+	{
+		OutDesc.ArraySize = 1;
+		OutDesc.SampleDesc.Count = 1;
+		OutDesc.SampleDesc.Quality = 0;
+		OutDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		OutDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		OutDesc.CPUAccessFlags = 0;
+		OutDesc.MiscFlags = 0;
+	}
+
+	// A pre-compressed ".dds" next to the requested image takes precedence, e.g. BC5 for the "_ddn" normal maps.
+	std::filesystem::path FindCompressedFile(const std::string& InFileName)
+	{
+		auto CompressedFileName = std::filesystem::path(InFileName).replace_extension(".dds");
+		return AssetArchive::Get().Exists(CompressedFileName) ? CompressedFileName : std::filesystem::path {};
+	}
+
+	// The file LoadTexture reads for the image.
+	std::string FindSourceFile(const std::string& InFileName)
+	{
+		const auto CompressedFileName = FindCompressedFile(InFileName);
+		return CompressedFileName.empty() ? InFileName : CompressedFileName.string();
+	}
+
+	// DDS files are told apart by their magic, anything else goes to WIC. DDS levels point into the bytes, images may be
+	// decoded into InMapped and packed, see DecodeImage.
+	void DecodeTexture(const std::string& InFileName, const std::span<const std::byte> InFileBytes, const bool bInIsPacked, TextureData& OutData,
+	                   const MappedLevels* InMapped = nullptr)
+	{
+		uint32_t Magic = 0u;
+		if (InFileBytes.size() >= sizeof(Magic))
+		{
+			memcpy(&Magic, InFileBytes.data(), sizeof(Magic));
+		}
+
+		if (Magic == DDSMagic)
+		{
+			DecodeDDS(InFileName, InFileBytes, OutData);
+		}
+		else
+		{
+			DecodeImage(InFileName, InFileBytes, bInIsPacked, OutData, InMapped);
+		}
+
+		SetTextureDesc(OutData.Desc);
+	}
+
+	// Copies the levels the decode didn't write in place into the mapped ones, row by row at their pitch. Those of a DDS file
+	// come straight from its bytes. InData has to match the description the levels were mapped for.
+	void WriteMappedLevels(const TextureData& InData, const MappedLevels& InMapped)
+	{
+		const bool bIsBlockCompressed = IsSupportedBlockFormat(InData.Desc.Format);
+
+		for (UINT Level = InMapped.FirstMip; Level < InData.Desc.MipLevels; ++Level)
+		{
+			const auto& Source = InData.Levels[Level];
+			const auto& Destination = InMapped.Levels[Level - InMapped.FirstMip];
+
+			if (Source.pSysMem == Destination.pData)
+			{
+				continue;
+			}
+
+			// Of 4x4 blocks for compressed formats.
+			const UINT LevelHeight = std::max(1u, InData.Desc.Height >> Level);
+			const UINT RowNum = bIsBlockCompressed ? (LevelHeight + 3u) / 4u : LevelHeight;
+
+			for (UINT Row = 0u; Row < RowNum; ++Row)
+			{
+				memcpy(static_cast<std::byte*>(Destination.pData) + static_cast<size_t>(Destination.RowPitch) * Row,
+				       static_cast<const std::byte*>(Source.pSysMem) + static_cast<size_t>(Source.SysMemPitch) * Row, Source.SysMemPitch);
+			}
+		}
+	}
+
+	// One tile of the level as UpdateTiles takes it, rows of whole 4x4 blocks for compressed formats. What lies past the
+	// level's edge stays zero.
+	void CopyTile(const TextureData& InData, const UINT InMip, const UINT InX, const UINT InY, const UINT InTileWidth, const UINT InTileHeight,
+	              std::vector<std::byte>& OutBytes)
+	{
+		const bool bIsBlockCompressed = IsSupportedBlockFormat(InData.Desc.Format);
+		const UINT UnitSize = bIsBlockCompressed ? 4u : 1u;
+		const UINT UnitBytes = bIsBlockCompressed ? GetBlockBytes(InData.Desc.Format) : GetTexelBytes(InData.Desc.Format);
+		const UINT TileColumns = InTileWidth / UnitSize;
+		const UINT TileRows = InTileHeight / UnitSize;
+		const UINT LevelColumns = (std::max(1u, InData.Desc.Width >> InMip) + UnitSize - 1u) / UnitSize;
+		const UINT LevelRows = (std::max(1u, InData.Desc.Height >> InMip) + UnitSize - 1u) / UnitSize;
+		const UINT FirstColumn = InX * TileColumns;
+		const UINT FirstRow = InY * TileRows;
+		const auto& Level = InData.Levels[InMip];
+
+		OutBytes.assign(static_cast<size_t>(TileColumns) * TileRows * UnitBytes, std::byte {0});
+
+		if (FirstColumn >= LevelColumns || FirstRow >= LevelRows)
+		{
+			return;
+		}
+
+		const size_t RowBytes = static_cast<size_t>(std::min(TileColumns, LevelColumns - FirstColumn)) * UnitBytes;
+		const UINT RowNum = std::min(TileRows, LevelRows - FirstRow);
+
+		for (UINT Row = 0u; Row < RowNum; ++Row)
+		{
+			memcpy(OutBytes.data() + static_cast<size_t>(Row) * TileColumns * UnitBytes,
+			       static_cast<const std::byte*>(Level.pSysMem) + static_cast<size_t>(Level.SysMemPitch) * (FirstRow + Row) +
+			       static_cast<size_t>(FirstColumn) * UnitBytes, RowBytes);
+		}
+	}
+
+	// The whole level at the pitch it was decoded with, as UpdateSubresource takes it.
+	void CopyLevel(const TextureData& InData, const UINT InMip, std::vector<std::byte>& OutBytes)
+	{
+		const UINT LevelHeight = std::max(1u, InData.Desc.Height >> InMip);
+		const UINT RowNum = IsSupportedBlockFormat(InData.Desc.Format) ? (LevelHeight + 3u) / 4u : LevelHeight;
+		const auto& Level = InData.Levels[InMip];
+		const auto* const Begin = static_cast<const std::byte*>(Level.pSysMem);
+
+		OutBytes.assign(Begin, Begin + static_cast<size_t>(Level.SysMemPitch) * RowNum);
+	}
+
+	void LoadTexture(const std::string& InFileName, const bool bInIsPacked, TextureData& OutData)
+	{
+		const auto SourceFileName = FindSourceFile(InFileName);
+		if (!AssetArchive::Get().Read(SourceFileName, OutData.FileBytes))
+		{
+			ThrowLoadError(SourceFileName, "failed to open.");
+		}
+
+		DecodeTexture(SourceFileName, OutData.FileBytes, bInIsPacked, OutData);
+	}
+
+	// Which channels a packed image keeps takes decoding it, which is done once per file. The import asks for every mesh.
+	DXGI_FORMAT ReadPackedFormat(const std::string& InFileName)
+	{
+		static std::mutex FormatMutex;
+		static std::unordered_map<std::string, DXGI_FORMAT> Formats;
+
+		{
+			std::lock_guard Lock(FormatMutex);
+			if (const auto Found = Formats.find(InFileName); Found != Formats.end())
+			{
+				return Found->second;
+			}
+		}
+
+		std::vector<std::byte> FileBytes;
+		if (!AssetArchive::Get().Read(InFileName, FileBytes))
+		{
+			ThrowLoadError(InFileName, "failed to open.");
+		}
+
+		auto Format = Surface::ReadFormat(InFileName, FileBytes);
+		if (Format == Surface::Format::BGRA8)
+		{
+			Format = Surface::FromMemory(InFileName, FileBytes).DetectFormat();
+		}
+
+		std::lock_guard Lock(FormatMutex);
+		return Formats.try_emplace(InFileName, GetImageFormat(Format)).first->second;
+	}
+
+	// What LoadTexture would create, from the headers alone unless a packed image has to be decoded for its format.
+	D3D11_TEXTURE2D_DESC ReadTextureDesc(const std::string& InFileName, const bool bInIsPacked)
+	{
+		D3D11_TEXTURE2D_DESC Desc {};
+
+		if (const auto CompressedFileName = FindCompressedFile(InFileName); !CompressedFileName.empty())
+		{
+			// The DX10 extension is optional, a shorter read is only an error when the header needs it.
+			std::vector<std::byte> HeaderBytes;
+			if (!AssetArchive::Get().Read(CompressedFileName, HeaderBytes, sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDXT10)))
+			{
+				ThrowLoadError(CompressedFileName.string(), "failed to open.");
+			}
+
+			const char* const Begin = reinterpret_cast<const char*>(HeaderBytes.data());
+			ReadDDSHeader(CompressedFileName.string(), Begin, Begin + HeaderBytes.size(), Desc);
+		}
+		else
+		{
+			Surface::ReadSize(InFileName, Desc.Width, Desc.Height);
+			Desc.MipLevels = static_cast<UINT>(std::bit_width(std::max(Desc.Width, Desc.Height)));
+			Desc.Format = bInIsPacked ? ReadPackedFormat(InFileName) : DXGI_FORMAT_B8G8R8A8_UNORM;
+		}
+
+		SetTextureDesc(Desc);
+		return Desc;
+	}
+
+	// The levels from InFirstMip on, as a texture of their own.
+	D3D11_TEXTURE2D_DESC GetLevelsDesc(const D3D11_TEXTURE2D_DESC& InDesc, const UINT InFirstMip) noexcept
+	{
+		auto Desc = InDesc;
+		Desc.Width = std::max(1u, InDesc.Width >> InFirstMip);
+		Desc.Height = std::max(1u, InDesc.Height >> InFirstMip);
+		Desc.MipLevels = InDesc.MipLevels - InFirstMip;
+		return Desc;
+	}
+
+	// The first level no larger than InMaximumSize, block compressed levels also have to stay whole blocks to start a texture.
+	UINT FindFirstMip(const D3D11_TEXTURE2D_DESC& InDesc, const UINT InMaximumSize) noexcept
+	{
+		UINT FirstMip = 0u;
+
+		while (FirstMip + 1u < InDesc.MipLevels && std::max(InDesc.Width >> FirstMip, InDesc.Height >> FirstMip) > InMaximumSize)
+		{
+			const UINT NextWidth = std::max(1u, InDesc.Width >> (FirstMip + 1u));
+			const UINT NextHeight = std::max(1u, InDesc.Height >> (FirstMip + 1u));
+
+			if (IsSupportedBlockFormat(InDesc.Format) && (NextWidth % 4u || NextHeight % 4u))
+			{
+				break;
+			}
+
+			++FirstMip;
+		}
+
+		return FirstMip;
+	}
+
+	void CreateView(ID3D11Device* InDevice, ID3D11Texture2D* InTexture, const D3D11_TEXTURE2D_DESC& InDesc,
+	                Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& OutView)
+	{
+		HRESULT ResultHandle;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC ResourceViewDesc = {};
+		ResourceViewDesc.Format = InDesc.Format;
+		ResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		ResourceViewDesc.Texture2D.MostDetailedMip = 0;
+		ResourceViewDesc.Texture2D.MipLevels = InDesc.MipLevels;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView
+		(
+			InTexture,
+			&ResourceViewDesc,
+			&OutView
+		))
+	}
+
+	// Called from loader and streaming jobs as well, creating resources on the device is free-threaded.
+	void CreateLevels(ID3D11Device* InDevice, const TextureData& InData, const UINT InFirstMip,
+	                  Microsoft::WRL::ComPtr<ID3D11Texture2D>& OutTexture, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& OutView)
+	{
+		HRESULT ResultHandle;
+
+		const auto Desc = GetLevelsDesc(InData.Desc, InFirstMip);
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D
+		(
+			&Desc,
+			InData.Levels.data() + InFirstMip,
+			&OutTexture
+		))
+
+		CreateView(InDevice, OutTexture.Get(), Desc, OutView);
+	}
+
+	// For streamed levels, the empty default usage texture UploadManager copies the mapped staging one into.
+	// Creating an immutable texture with its data would upload it all at once on the immediate context's next flush.
+	void CreateStreamedLevels(ID3D11Device* InDevice, const D3D11_TEXTURE2D_DESC& InDesc, const UINT InFirstMip,
+	                          Microsoft::WRL::ComPtr<ID3D11Texture2D>& OutTexture, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& OutView)
+	{
+		HRESULT ResultHandle;
+
+		auto Desc = GetLevelsDesc(InDesc, InFirstMip);
+		Desc.Usage = D3D11_USAGE_DEFAULT;
+		CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&Desc, nullptr, &OutTexture))
+
+		CreateView(InDevice, OutTexture.Get(), Desc, OutView);
+	}
+}
+
+Texture::Texture(const Graphics& InGraphics, const StringAtom InFileName, const bool bInIsStreamed, const bool bInIsVirtual, const bool bInIsPacked)
 	: FileName(InFileName)
+	, bIsStreamed(bInIsStreamed)
+	, bIsVirtual(bInIsVirtual)
+	, bIsPacked(bInIsPacked)
+{
+	assert((bIsStreamed || !bIsVirtual) && "Virtual textures start from their coarse levels like streamed ones");
+
+	const std::string Path(FileName.GetString());
+	SourceFileName = FindSourceFile(Path);
+	TextureData Data;
+	LoadTexture(Path, bIsPacked, Data);
+	FullDesc = Data.Desc;
+
+	// Low levels first, the rest is decoded again once a mesh on screen needs it.
+	if (bIsStreamed)
+	{
+		CoarsestMip = FindFirstMip(FullDesc, TextureStreamer::InitialSize);
+	}
+
+	ResidentMip = CoarsestMip;
+	WantedMip = CoarsestMip;
+	CreateLevels(GetDevice(InGraphics), Data, ResidentMip, MyTexture, MyTextureView);
+	ByteSize = GetByteSize(ResidentMip);
+
+	if (auto* const Cache = InGraphics.GetVirtualTextureCache(); bIsVirtual && Cache)
+	{
+		VirtualTextures = Cache;
+		VirtualTextures->Register(*this);
+	}
+	else if (bIsStreamed)
+	{
+		Streamer = &InGraphics.GetTextureStreamer();
+		Streamer->Register(*this);
+	}
+}
+
+Texture::~Texture()
+{
+	if (Pending)
+	{
+		IoService::Get().Cancel(Pending->Request);
+	}
+
+	if (Streamer)
+	{
+		Streamer->Unregister(*this);
+	}
+
+	// Also takes it back from the streamer, if the cache handed it over.
+	if (VirtualTextures)
+	{
+		VirtualTextures->Unregister(*this);
+	}
+}
+
+void Texture::Bind(RenderContext& InContext) noexcept
+{
+	BindTo(InContext, 0u);
+}
+
+bool Texture::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	BakeTo(InOutPacket, 0u);
+	return true;
+}
+
+void Texture::BindTo(RenderContext& InContext, const UINT InSlot) const noexcept
+{
+	GetStateCache(InContext).SetPixelShaderResource(InSlot, MyTextureView.Get());
+}
+
+void Texture::BakeTo(DrawPacket& InOutPacket, const UINT InSlot) const noexcept
+{
+	InOutPacket.AddPixelShaderResource(InSlot, MyTextureView.Get());
+}
+
+void Texture::BindResidencyTo(RenderContext& InContext, const UINT InSlot) const noexcept
+{
+	GetStateCache(InContext).SetPixelShaderResource(InSlot, MyResidencyView.Get());
+}
+
+void Texture::BakeResidencyTo(DrawPacket& InOutPacket, const UINT InSlot) const noexcept
+{
+	InOutPacket.AddPixelShaderResource(InSlot, MyResidencyView.Get());
+}
+
+void Texture::RequestDetail(const float InPixelsPerTexcoord) noexcept
+{
+	if (!bIsStreamed || !(InPixelsPerTexcoord > 0.0f))
+	{
+		return;
+	}
+
+	// Along the larger side, every level halves the texels per pixel.
+	const auto TexelsPerPixel = static_cast<float>(std::max(FullDesc.Width, FullDesc.Height)) / InPixelsPerTexcoord;
+	const auto Mip = TexelsPerPixel > 1.0f ? std::min(static_cast<UINT>(std::log2(TexelsPerPixel)), FullDesc.MipLevels - 1u) : 0u;
+
+	auto Requested = RequestedMip.load(std::memory_order_relaxed);
+	while (Mip < Requested && !RequestedMip.compare_exchange_weak(Requested, Mip, std::memory_order_relaxed))
+	{
+	}
+}
+
+void Texture::StreamIn(ID3D11Device* InDevice, UploadManager& InUploads, const UINT InFirstMip, const IoPriority InPriority, JobCounter& InSignal)
+{
+	assert(!Pending && InFirstMip < ResidentMip);
+
+	Pending = std::make_shared<StreamedLevels>();
+	Pending->FirstMip = InFirstMip;
+
+	// Mapped here on the main thread, so the read's completion decodes or copies the levels straight into the staging texture.
+	auto Mapped = InUploads.MapTexture(GetLevelsDesc(FullDesc, InFirstMip));
+
+	// Only copies are captured, the texture may be gone by the time the read completes.
+	Pending->Request = IoService::Get().Read(SourceFileName, InPriority,
+	[Levels = Pending, InDevice, Uploads = &InUploads, FileName = SourceFileName, ExpectedDesc = FullDesc, bIsPacked = bIsPacked, Mapped = std::move(Mapped)]
+	(const IoStatus InStatus, const std::span<const std::byte> InFileBytes) mutable
+	{
+		try
+		{
+			if (InStatus == IoStatus::Done)
+			{
+				const MappedLevels Destination {ExpectedDesc, Levels->FirstMip, Mapped.Levels};
+				TextureData Data;
+				DecodeTexture(FileName, InFileBytes, bIsPacked, Data, &Destination);
+
+				// A file replaced since the texture was created keeps its old levels until it is loaded again.
+				if (Data.Desc.Width == ExpectedDesc.Width && Data.Desc.Height == ExpectedDesc.Height &&
+				    Data.Desc.MipLevels == ExpectedDesc.MipLevels && Data.Desc.Format == ExpectedDesc.Format)
+				{
+					WriteMappedLevels(Data, Destination);
+					CreateStreamedLevels(InDevice, ExpectedDesc, Levels->FirstMip, Levels->Texture, Levels->View);
+
+					// Done once the copy is issued, the view can be swapped in from the next frame on.
+					Uploads->UploadTexture(Levels->Texture, std::move(Mapped), GetTextureByteSize(GetLevelsDesc(ExpectedDesc, Levels->FirstMip)), [Levels]
+					{
+						Levels->bIsDone.store(true, std::memory_order_release);
+					});
+					return;
+				}
+			}
+		}
+		catch (const std::exception&)
+		{
+			// Stays at the resident levels, a file that can't be read again is not worth stopping the frame for.
+			Levels->Texture.Reset();
+			Levels->View.Reset();
+		}
+
+		Uploads->DiscardTexture(std::move(Mapped));
+		Levels->bIsDone.store(true, std::memory_order_release);
+	}, &InSignal);
+}
+
+bool Texture::ApplyStreamed()
+{
+	if (!Pending || !Pending->bIsDone.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	if (Pending->View)
+	{
+		MyTexture = std::move(Pending->Texture);
+		MyTextureView = std::move(Pending->View);
+		ResidentMip = Pending->FirstMip;
+		ByteSize = GetByteSize(ResidentMip);
+		InvalidateBaked();
+	}
+
+	Pending.reset();
+	return true;
+}
+
+void Texture::Evict(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, const UINT InFirstMip)
+{
+	assert(!Pending && InFirstMip > ResidentMip && InFirstMip <= CoarsestMip);
+
+	HRESULT ResultHandle;
+
+	// Default usage, the copies below write to it.
+	auto Desc = GetLevelsDesc(FullDesc, InFirstMip);
+	Desc.Usage = D3D11_USAGE_DEFAULT;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Remaining;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture2D(&Desc, nullptr, &Remaining))
+
+	// The levels that stay are already on the GPU, copying them is far cheaper than decoding the file again.
+	for (UINT Level = 0u; Level < Desc.MipLevels; ++Level)
+	{
+		InContext->CopySubresourceRegion(Remaining.Get(), Level, 0u, 0u, 0u, MyTexture.Get(), Level + InFirstMip - ResidentMip, nullptr);
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> RemainingView;
+	CreateView(InDevice, Remaining.Get(), Desc, RemainingView);
+
+	MyTexture = std::move(Remaining);
+	MyTextureView = std::move(RemainingView);
+	ResidentMip = InFirstMip;
+	ByteSize = GetByteSize(ResidentMip);
+	InvalidateBaked();
+}
+
+Texture::ReloadedLevels Texture::Reload(const Graphics& InGraphics) const
+{
+	TextureData Data;
+	LoadTexture(std::string(FileName.GetString()), bIsPacked, Data);
+
+	ReloadedLevels Levels;
+	Levels.FullDesc = Data.Desc;
+	Levels.FirstMip = bIsStreamed ? FindFirstMip(Data.Desc, TextureStreamer::InitialSize) : 0u;
+	CreateLevels(GetDevice(InGraphics), Data, Levels.FirstMip, Levels.Texture, Levels.View);
+	return Levels;
+}
+
+bool Texture::ApplyReload(ReloadedLevels& InLevels)
+{
+	// The streamer counts a load until it lands, and would swap in levels decoded from the old file.
+	if (Pending)
+	{
+		return false;
+	}
+
+	MyTexture = std::move(InLevels.Texture);
+	MyTextureView = std::move(InLevels.View);
+	FullDesc = InLevels.FullDesc;
+	CoarsestMip = InLevels.FirstMip;
+	ResidentMip = CoarsestMip;
+	WantedMip = CoarsestMip;
+	RequestedMip.store(NoRequest, std::memory_order_relaxed);
+	ByteSize = GetByteSize(ResidentMip);
+	InvalidateBaked();
+	return true;
+}
+
+size_t Texture::GetByteSize(const UINT InFirstMip) const noexcept
+{
+	return GetTextureByteSize(GetLevelsDesc(FullDesc, InFirstMip));
+}
+
+void Texture::LoadPages(std::shared_ptr<PageLoad> InLoad, const UINT InTileWidth, const UINT InTileHeight, const IoPriority InPriority,
+                        JobCounter& InSignal) const
+{
+	// Only copies are captured, the texture may be gone by the time the read completes.
+	InLoad->Request = IoService::Get().Read(SourceFileName, InPriority,
+	[Load = InLoad, FileName = SourceFileName, ExpectedDesc = FullDesc, bIsPacked = bIsPacked, InTileWidth, InTileHeight]
+	(const IoStatus InStatus, const std::span<const std::byte> InFileBytes)
+	{
+		try
+		{
+			if (InStatus == IoStatus::Done)
+			{
+				TextureData Data;
+				DecodeTexture(FileName, InFileBytes, bIsPacked, Data);
+
+				// The tiles were laid out for the texture as it was created, a replaced file has to be loaded again.
+				if (Data.Desc.Width == ExpectedDesc.Width && Data.Desc.Height == ExpectedDesc.Height &&
+				    Data.Desc.MipLevels == ExpectedDesc.MipLevels && Data.Desc.Format == ExpectedDesc.Format)
+				{
+					for (auto& Page : Load->Pages)
+					{
+						CopyTile(Data, Page.Mip, Page.X, Page.Y, InTileWidth, InTileHeight, Page.Bytes);
+					}
+
+					for (UINT Level = Load->TailMip; Level < Data.Desc.MipLevels; ++Level)
+					{
+						auto& Tail = Load->Tail.emplace_back();
+						Tail.RowPitch = Data.Levels[Level].SysMemPitch;
+						CopyLevel(Data, Level, Tail.Bytes);
+					}
+
+					Load->bHasSucceeded = true;
+				}
+			}
+		}
+		catch (const std::exception&)
+		{
+			// Keeps what is resident, the cache asks again or gives up on the texture.
+			Load->bHasSucceeded = false;
+		}
+
+		Load->bIsDone.store(true, std::memory_order_release);
+	}, &InSignal);
+}
+
+std::shared_ptr<Texture> Texture::Resolve(const Graphics& InGraphics, const std::string& InFileName, const bool bInIsStreamed, const bool bInIsVirtual,
+                                          const bool bInIsPacked)
+{
+	return BindManager::Resolve<Texture>(InGraphics, StringAtom(InFileName), bInIsStreamed, bInIsVirtual, bInIsPacked);
+}
+
+std::string Texture::GenerateUniqueID(const StringAtom InFileName, const bool bInIsStreamed, const bool bInIsVirtual, const bool bInIsPacked)
+{
+	using namespace std::string_literals;
+	return typeid(Texture).name() + (bInIsVirtual ? "#virtual"s : bInIsStreamed ? "#streamed"s : ""s) + (bInIsPacked ? "#packed#"s : "#"s) +
+	       std::string(InFileName.GetString());
+}
+
+BindKey Texture::GenerateKey(const StringAtom InFileName, const bool bInIsStreamed, const bool bInIsVirtual, const bool bInIsPacked)
+{
+	return BindKey::Make<Texture>(InFileName, bInIsStreamed, bInIsVirtual, bInIsPacked);
+}
+
+std::string Texture::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(FileName, bIsStreamed, bIsVirtual, bIsPacked);
+}
+
+size_t Texture::GetGpuByteSize() const noexcept
+{
+	return ByteSize;
+}
+
+TextureBinding::TextureBinding(std::shared_ptr<Texture> InTexture, const UINT InSlot) noexcept
+	: MyTexture(std::move(InTexture))
 	, Slot(InSlot)
+{}
+
+void TextureBinding::Bind(RenderContext& InContext) noexcept
+{
+	MyTexture->BindTo(InContext, Slot);
+}
+
+bool TextureBinding::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	MyTexture->BakeTo(InOutPacket, Slot);
+	return true;
+}
+
+TextureArray::TextureArray(const Graphics& InGraphics, const std::vector<std::string>& InFileNames)
+	: FileNames(InFileNames)
 {
+	assert(!FileNames.empty() && "Texture arrays need at least one slice");
+
 	HRESULT ResultHandle;
 
-	const auto Surface = Surface::FromFile(InFileName);
-
-	D3D11_TEXTURE2D_DESC Texture2DDesc = {};
-	Texture2DDesc.Width = Surface.GetWidth();
-	Texture2DDesc.Height = Surface.GetHeight();
-	Texture2DDesc.MipLevels = 1;
-	Texture2DDesc.ArraySize = 1;
-	Texture2DDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-	Texture2DDesc.SampleDesc.Count = 1;
-	Texture2DDesc.SampleDesc.Quality = 0;
-	Texture2DDesc.Usage = D3D11_USAGE_DEFAULT;
-	Texture2DDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	Texture2DDesc.CPUAccessFlags = 0;
-	Texture2DDesc.MiscFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA SubresourceData = {};
-	SubresourceData.pSysMem = Surface.GetBufferPtrConst();
-	SubresourceData.SysMemPitch = Surface.GetWidth() * sizeof(Surface::Color);
-
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture2D;
+	// All slices stay decoded until the array is created from them, the levels of one slice follow each other.
+	std::vector<TextureData> Slices(FileNames.size());
+	std::vector<D3D11_SUBRESOURCE_DATA> Levels;
+
+	for (size_t Index = 0u; Index < FileNames.size(); ++Index)
+	{
+		LoadTexture(FileNames[Index], true, Slices[Index]);
+
+		const auto& Desc = Slices[Index].Desc;
+		const auto& FirstDesc = Slices.front().Desc;
+
+		if (Desc.Width != FirstDesc.Width || Desc.Height != FirstDesc.Height || Desc.MipLevels != FirstDesc.MipLevels || Desc.Format != FirstDesc.Format)
+		{
+			ThrowLoadError(FileNames[Index], "size, format or levels differ from the other slices of its texture array.");
+		}
+
+		Levels.insert(Levels.end(), Slices[Index].Levels.begin(), Slices[Index].Levels.end());
+	}
+
+	auto Desc = Slices.front().Desc;
+	Desc.ArraySize = static_cast<UINT>(FileNames.size());
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> ArrayTexture;
 	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateTexture2D
 	(
-		&Texture2DDesc,
-		&SubresourceData,
-		&Texture2D
+		&Desc,
+		Levels.data(),
+		&ArrayTexture
 	))
 
 	D3D11_SHADER_RESOURCE_VIEW_DESC ResourceViewDesc = {};
-	ResourceViewDesc.Format = Texture2DDesc.Format;
-	ResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	ResourceViewDesc.Texture2D.MostDetailedMip = 0;
-	ResourceViewDesc.Texture2D.MipLevels = 1;
+	ResourceViewDesc.Format = Desc.Format;
+	ResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	ResourceViewDesc.Texture2DArray.MostDetailedMip = 0;
+	ResourceViewDesc.Texture2DArray.MipLevels = Desc.MipLevels;
+	ResourceViewDesc.Texture2DArray.FirstArraySlice = 0;
+	ResourceViewDesc.Texture2DArray.ArraySize = Desc.ArraySize;
 	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateShaderResourceView
 	(
-		Texture2D.Get(),
+		ArrayTexture.Get(),
 		&ResourceViewDesc,
 		&MyTextureView
 	))
+
+	Format = Desc.Format;
+	ByteSize = GetTextureByteSize(Desc);
+}
+
+void TextureArray::Bind(RenderContext& InContext) noexcept
+{
+	BindTo(InContext, 0u);
+}
+
+bool TextureArray::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	BakeTo(InOutPacket, 0u);
+	return true;
+}
+
+void TextureArray::BindTo(RenderContext& InContext, const UINT InSlot) const noexcept
+{
+	GetStateCache(InContext).SetPixelShaderResource(InSlot, MyTextureView.Get());
+}
+
+void TextureArray::BakeTo(DrawPacket& InOutPacket, const UINT InSlot) const noexcept
+{
+	InOutPacket.AddPixelShaderResource(InSlot, MyTextureView.Get());
+}
+
+unsigned int TextureArray::FindSlice(const std::string& InFileName) const noexcept
+{
+	const auto Found = std::find(FileNames.begin(), FileNames.end(), InFileName);
+	assert(Found != FileNames.end() && "File is not a slice of this texture array");
+	return static_cast<unsigned int>(Found - FileNames.begin());
 }
 
-void Texture::Bind(const Graphics& InGraphics) noexcept
+D3D11_TEXTURE2D_DESC TextureArray::ReadDesc(const std::string& InFileName)
 {
-	GetContext(InGraphics)->PSSetShaderResources(Slot, 1u, MyTextureView.GetAddressOf());
+	return ReadTextureDesc(InFileName, true);
 }
 
-std::shared_ptr<Texture> Texture::Resolve(const Graphics& InGraphics, const std::string& InFileName, unsigned InSlot)
+std::shared_ptr<TextureArray> TextureArray::Resolve(const Graphics& InGraphics, const std::vector<std::string>& InFileNames)
 {
-	return BindManager::Resolve<Texture>(InGraphics, InFileName, InSlot);
+	return BindManager::Resolve<TextureArray>(InGraphics, InFileNames);
 }
 
-std::string Texture::GenerateUniqueID(const std::string& InFileName, unsigned InSlot)
+std::string TextureArray::GenerateUniqueID(const std::vector<std::string>& InFileNames)
 {
 	using namespace std::string_literals;
-	return typeid(Texture).name() + "#"s + std::to_string(InSlot) + "#"s + InFileName ;
+
+	auto UniqueID = typeid(TextureArray).name() + "#"s;
+
+	for (size_t Index = 0u; Index < InFileNames.size(); ++Index)
+	{
+		UniqueID += (Index > 0u ? "|"s : ""s) + InFileNames[Index];
+	}
+
+	return UniqueID;
 }
 
-std::string Texture::GetUniqueID() const noexcept
+BindKey TextureArray::GenerateKey(const std::vector<std::string>& InFileNames)
+{
+	auto Key = BindKey::Make<TextureArray>(InFileNames.size());
+
+	for (const auto& FileName : InFileNames)
+	{
+		Key.Combine(FileName);
+	}
+
+	return Key;
+}
+
+std::string TextureArray::GetUniqueID() const noexcept
+{
+	return GenerateUniqueID(FileNames);
+}
+
+size_t TextureArray::GetGpuByteSize() const noexcept
 {
-	return GenerateUniqueID(FileName, Slot);
+	return ByteSize;
 }
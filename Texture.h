@@ -1,22 +1,240 @@
 ﻿#pragma once
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
+#include "BindKey.h"
 #include "Bindable.h"
+#include "IoService.h"
+#include "StringAtom.h"
 
+class TextureStreamer;
+class UploadManager;
+class VirtualTextureCache;
+
+/**
+ * A texture file on the GPU, shared by file identity alone so an image read through several slots is loaded once.
+ * Bound on its own it is read from slot 0, TextureBinding or the owner's own BindTo put it in any other.
+ * A packed one keeps an image in the fewest channels that hold it, see Surface::Format, for readers that expand grey levels
+ * again from its format like the material shaders do. Others read every image as BGRA.
+ */
 class Texture : public Bindable
 {
+	friend class TextureStreamer;
+	friend class VirtualTextureCache;
+
 public:
-	Texture(const Graphics& InGraphics, const std::string& InFileName, unsigned int InSlot = 0);
+	// A map's residency is read this many slots after the map, by the VIRTUAL_TEXTURED material shaders.
+	static constexpr UINT ResidencySlotOffset {4u};
+
+	// The texture as Reload read it from a changed file, swapped in by ApplyReload.
+	struct ReloadedLevels
+	{
+		D3D11_TEXTURE2D_DESC FullDesc {};
+		UINT FirstMip {0u};
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+	};
 
-	void Bind(const Graphics& InGraphics) noexcept override;
+	// A streamed texture starts at its coarse levels and is refined as RequestDetail asks, others are resident in full.
+	// A virtual one is paged by the VirtualTextureCache where Graphics has one, and streamed otherwise.
+	Texture(const Graphics& InGraphics, StringAtom InFileName, bool bInIsStreamed = false, bool bInIsVirtual = false, bool bInIsPacked = false);
+	~Texture() override;
 
-	[[nodiscard]] static std::shared_ptr<Texture> Resolve(const Graphics& InGraphics, const std::string& InFileName, unsigned int InSlot = 0);
-	[[nodiscard]] static std::string GenerateUniqueID(const std::string& InFileName, unsigned int InSlot = 0);
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+	void BindTo(RenderContext& InContext, UINT InSlot) const noexcept;
+	void BakeTo(DrawPacket& InOutPacket, UINT InSlot) const noexcept;
+	// Null until the cache has paged the texture, which samples at full detail without one.
+	void BindResidencyTo(RenderContext& InContext, UINT InSlot) const noexcept;
+	void BakeResidencyTo(DrawPacket& InOutPacket, UINT InSlot) const noexcept;
+	// The finest level that still has about one texel per pixel when a texture coordinate unit spans InPixelsPerTexcoord pixels.
+	// Any thread during submission, the finest request of the frame wins.
+	void RequestDetail(float InPixelsPerTexcoord) noexcept;
+	// Reads and creates the texture again the way the constructor did, on any thread. Throws when the file can't be read.
+	[[nodiscard]] ReloadedLevels Reload(const Graphics& InGraphics) const;
+	// Swaps in what Reload read, on the main thread between frames. A streamed texture starts over from its coarse levels.
+	// False while streamed levels decoded from the old file are in flight, the swap is left for a later frame.
+	bool ApplyReload(ReloadedLevels& InLevels);
+
+	[[nodiscard]] static std::shared_ptr<Texture> Resolve(const Graphics& InGraphics, const std::string& InFileName, bool bInIsStreamed = false,
+	                                                      bool bInIsVirtual = false, bool bInIsPacked = false);
+	[[nodiscard]] static std::string GenerateUniqueID(StringAtom InFileName, bool bInIsStreamed = false, bool bInIsVirtual = false, bool bInIsPacked = false);
+	[[nodiscard]] static BindKey GenerateKey(StringAtom InFileName, bool bInIsStreamed = false, bool bInIsVirtual = false, bool bInIsPacked = false);
 	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+	// The resident levels only.
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+	// For stages other than the pixel shader, which bind it themselves. Replaced as streamed levels come and go.
+	[[nodiscard]] ID3D11ShaderResourceView* GetView() const noexcept
+	{
+		return MyTextureView.Get();
+	}
+
+	// Of every level, whichever are resident.
+	[[nodiscard]] DXGI_FORMAT GetFormat() const noexcept
+	{
+		return FullDesc.Format;
+	}
+
+	// What the levels are read from, the .dds found at creation in place of the image.
+	[[nodiscard]] const std::string& GetSourceFileName() const noexcept
+	{
+		return SourceFileName;
+	}
+
+	// Registered with the VirtualTextureCache, whether or not it could page the texture.
+	[[nodiscard]] bool IsVirtual() const noexcept
+	{
+		return VirtualTextures != nullptr;
+	}
 
 protected:
-	std::string FileName;
+	StringAtom FileName;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyTextureView;
 
 private:
-	unsigned int Slot;
+	static constexpr UINT NoRequest {~0u};
+
+	// Levels finer than the resident ones, decoded and created by a job and swapped in by ApplyStreamed.
+	struct StreamedLevels
+	{
+		UINT FirstMip;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+		std::atomic<bool> bIsDone {false};
+		// Cancelled when the texture goes first.
+		IoService::RequestId Request {IoService::NoRequest};
+	};
+
+	// One tile of a level, the position in tiles is the cache's and the bytes the load's, row after row of whole 4x4 blocks
+	// for compressed formats. Rows and columns past the level's edge are zeros.
+	struct TilePage
+	{
+		UINT Mip;
+		UINT X;
+		UINT Y;
+		std::vector<std::byte> Bytes;
+	};
+
+	// A level too small to be paged, read whole.
+	struct TailLevel
+	{
+		UINT RowPitch;
+		std::vector<std::byte> Bytes;
+	};
+
+	// Pages cut out of one read of the file for the VirtualTextureCache, and the levels from TailMip on unless it is NoRequest.
+	struct PageLoad
+	{
+		std::vector<TilePage> Pages;
+		UINT TailMip {NoRequest};
+		std::vector<TailLevel> Tail;
+		std::atomic<bool> bIsDone {false};
+		// False when the file couldn't be read or no longer matches the texture.
+		bool bHasSucceeded {false};
+		IoService::RequestId Request {IoService::NoRequest};
+	};
+
+	// Reads the file through IoService and decodes it in the read's completion, the levels are then copied in by UploadManager.
+	void StreamIn(ID3D11Device* InDevice, UploadManager& InUploads, UINT InFirstMip, IoPriority InPriority, JobCounter& InSignal);
+	// True once a load started by StreamIn has finished, whether or not it succeeded.
+	bool ApplyStreamed();
+	void Evict(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, UINT InFirstMip);
+	[[nodiscard]] size_t GetByteSize(UINT InFirstMip) const noexcept;
+	// Reads the file through IoService like StreamIn, and cuts the pages out of it on a job. Tiles are InTileWidth by
+	// InTileHeight texels of 64KB each.
+	void LoadPages(std::shared_ptr<PageLoad> InLoad, UINT InTileWidth, UINT InTileHeight, IoPriority InPriority, JobCounter& InSignal) const;
+
+private:
+	bool bIsStreamed;
+	bool bIsVirtual;
+	bool bIsPacked;
+	// What the levels are read from, the .dds found at creation in place of the image.
+	std::string SourceFileName;
+	// Every level the file has, the resident ones start at ResidentMip.
+	D3D11_TEXTURE2D_DESC FullDesc {};
+	UINT ResidentMip {0u};
+	// Never evicted below, what the texture was created with.
+	UINT CoarsestMip {0u};
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> MyTexture;
+	size_t ByteSize {0u};
+
+	// Streaming state, only the requests are touched outside TextureStreamer::Update.
+	std::atomic<UINT> RequestedMip {NoRequest};
+	UINT WantedMip {0u};
+	unsigned long long LastUsedFrame {0u};
+	std::shared_ptr<StreamedLevels> Pending;
+	TextureStreamer* Streamer {nullptr};
+
+	// Paging state, the residency view is set by VirtualTextureCache::Update once the tiled resource is in place.
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyResidencyView;
+	VirtualTextureCache* VirtualTextures {nullptr};
+};
+
+/**
+ * One pixel shader slot reading a shared Texture, what a drawable binds to read a texture anywhere but slot 0.
+ * Only the pointer and the slot are its own, it isn't shared through the BindManager.
+ */
+class TextureBinding : public Bindable
+{
+public:
+	TextureBinding(std::shared_ptr<Texture> InTexture, UINT InSlot) noexcept;
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] const Texture& GetTexture() const noexcept
+	{
+		return *MyTexture;
+	}
+
+	[[nodiscard]] UINT GetSlot() const noexcept
+	{
+		return Slot;
+	}
+
+private:
+	std::shared_ptr<Texture> MyTexture;
+	UINT Slot;
+};
+
+/**
+ * Texture files of the same size, format and level count as the slices of one Texture2DArray, in the order given.
+ * Materials of a model share them and only tell the slice apart, so switching materials doesn't switch textures.
+ * Shared by the files alone like Texture, whatever slot the materials read it from. Only materials read arrays, so their
+ * images are always packed.
+ */
+class TextureArray : public Bindable
+{
+public:
+	TextureArray(const Graphics& InGraphics, const std::vector<std::string>& InFileNames);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+	void BindTo(RenderContext& InContext, UINT InSlot) const noexcept;
+	void BakeTo(DrawPacket& InOutPacket, UINT InSlot) const noexcept;
+
+	// Where InFileName is in the list the array was created from.
+	[[nodiscard]] unsigned int FindSlice(const std::string& InFileName) const noexcept;
+	[[nodiscard]] DXGI_FORMAT GetFormat() const noexcept
+	{
+		return Format;
+	}
+
+	// What a slice loaded from the file would be created as, read from its header. Images are decoded once to find how they
+	// pack.
+	[[nodiscard]] static D3D11_TEXTURE2D_DESC ReadDesc(const std::string& InFileName);
+
+	[[nodiscard]] static std::shared_ptr<TextureArray> Resolve(const Graphics& InGraphics, const std::vector<std::string>& InFileNames);
+	[[nodiscard]] static std::string GenerateUniqueID(const std::vector<std::string>& InFileNames);
+	[[nodiscard]] static BindKey GenerateKey(const std::vector<std::string>& InFileNames);
+	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	std::vector<std::string> FileNames;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyTextureView;
+	DXGI_FORMAT Format {DXGI_FORMAT_UNKNOWN};
+	size_t ByteSize {0u};
 };
@@ -0,0 +1,647 @@
+#include "TextureCooker.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+#include <DirectXMath.h>
+#include "AssetArchive.h"
+#include "DDSFormat.h"
+#include "JobSystem.h"
+#include "Surface.h"
+
+namespace
+{
+	// Roughly this many blocks per job, small levels are encoded in one.
+	constexpr size_t BlocksPerJob {256u};
+
+	// BC7's weights for four bit indices, in sixty-fourths of the way from the first endpoint.
+	constexpr unsigned int BC7Weights[16] {0u, 4u, 9u, 13u, 17u, 21u, 26u, 30u, 34u, 38u, 43u, 47u, 51u, 55u, 60u, 64u};
+
+	// Filtered as floats so normals can be renormalized per level.
+	// Colour maps keep all four channels, normals only need Z to be renormalized and specular maps have two.
+	struct Level
+	{
+		unsigned int Width;
+		unsigned int Height;
+		std::vector<DirectX::XMFLOAT4> Texels;
+	};
+
+	// What the shaders read back in [0, 1], normals are kept in [-1, 1] until they are quantized.
+	Level ReadTopLevel(const Surface& InImage, const TextureCooker::Usage InUsage)
+	{
+		Level Top {InImage.GetWidth(), InImage.GetHeight(), {}};
+		const size_t TexelNum = static_cast<size_t>(Top.Width) * Top.Height;
+		Top.Texels.reserve(TexelNum);
+
+		const Surface::Color* const Source = InImage.GetBufferPtrConst();
+
+		for (size_t Index = 0u; Index < TexelNum; ++Index)
+		{
+			const float R = Source[Index].GetR() / 255.0f;
+			const float G = Source[Index].GetG() / 255.0f;
+			const float B = Source[Index].GetB() / 255.0f;
+			const float A = Source[Index].GetA() / 255.0f;
+
+			switch (InUsage)
+			{
+			case TextureCooker::Usage::ColorMap:
+				Top.Texels.push_back({R, G, B, A});
+				break;
+			case TextureCooker::Usage::NormalMap:
+				Top.Texels.push_back({R * 2.0f - 1.0f, G * 2.0f - 1.0f, B * 2.0f - 1.0f, 0.0f});
+				break;
+			case TextureCooker::Usage::SpecularMap:
+				// The shaders square it back, which is the luminance the tinted highlights reduce to.
+				Top.Texels.push_back({std::sqrt(0.2126f * R * R + 0.7152f * G * G + 0.0722f * B * B), A, 0.0f, 0.0f});
+				break;
+			}
+		}
+
+		return Top;
+	}
+
+	Level FilterLevel(const Level& InSource, const TextureCooker::Usage InUsage)
+	{
+		Level Mip {std::max(1u, InSource.Width / 2u), std::max(1u, InSource.Height / 2u), {}};
+		Mip.Texels.reserve(static_cast<size_t>(Mip.Width) * Mip.Height);
+
+		for (unsigned int Row = 0; Row < Mip.Height; ++Row)
+		{
+			const unsigned int SourceRow = Row * 2u;
+			const unsigned int NextSourceRow = std::min(SourceRow + 1u, InSource.Height - 1u);
+
+			for (unsigned int Column = 0; Column < Mip.Width; ++Column)
+			{
+				const unsigned int SourceColumn = Column * 2u;
+				const unsigned int NextSourceColumn = std::min(SourceColumn + 1u, InSource.Width - 1u);
+
+				const auto Load = [&InSource](const unsigned int InRow, const unsigned int InColumn)
+				{
+					return DirectX::XMLoadFloat4(&InSource.Texels[static_cast<size_t>(InRow) * InSource.Width + InColumn]);
+				};
+
+				auto Average = DirectX::XMVectorScale(DirectX::XMVectorAdd(
+					DirectX::XMVectorAdd(Load(SourceRow, SourceColumn), Load(SourceRow, NextSourceColumn)),
+					DirectX::XMVectorAdd(Load(NextSourceRow, SourceColumn), Load(NextSourceRow, NextSourceColumn))), 0.25f);
+
+				// Averaged normals shorten where they spread, which would flatten the rebuilt Z.
+				if (InUsage == TextureCooker::Usage::NormalMap && DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(Average)) > 1e-8f)
+				{
+					Average = DirectX::XMVector3Normalize(Average);
+				}
+
+				DirectX::XMStoreFloat4(&Mip.Texels.emplace_back(), Average);
+			}
+		}
+
+		return Mip;
+	}
+
+	unsigned char Quantize(const float InValue, const TextureCooker::Usage InUsage) noexcept
+	{
+		const float Unit = InUsage == TextureCooker::Usage::NormalMap ? InValue * 0.5f + 0.5f : InValue;
+		return static_cast<unsigned char>(std::lround(std::clamp(Unit, 0.0f, 1.0f) * 255.0f));
+	}
+
+	// BC1 keeps half the bits of the others.
+	size_t GetBlockBytes(const DXGI_FORMAT InFormat) noexcept
+	{
+		return InFormat == DXGI_FORMAT_BC1_UNORM ? 8u : 16u;
+	}
+
+	// The block's extremes along its principal axis, found by power iteration of its covariance from the bounding box diagonal.
+	template<size_t N>
+	void FindEndpoints(const std::span<const TextureCooker::Texel, 16> InTexels, std::array<float, N>& OutFirst, std::array<float, N>& OutLast) noexcept
+	{
+		std::array<float, N> Mean {};
+		std::array<float, N> Axis {};
+		std::array<float, N> Min;
+		std::array<float, N> Max;
+		Min.fill(255.0f);
+		Max.fill(0.0f);
+
+		for (const auto& Texel : InTexels)
+		{
+			for (size_t Channel = 0u; Channel < N; ++Channel)
+			{
+				Mean[Channel] += Texel[Channel] / 16.0f;
+				Min[Channel] = std::min(Min[Channel], static_cast<float>(Texel[Channel]));
+				Max[Channel] = std::max(Max[Channel], static_cast<float>(Texel[Channel]));
+			}
+		}
+
+		std::array<float, N * N> Covariance {};
+
+		for (const auto& Texel : InTexels)
+		{
+			for (size_t Row = 0u; Row < N; ++Row)
+			{
+				for (size_t Column = 0u; Column < N; ++Column)
+				{
+					Covariance[Row * N + Column] += (Texel[Row] - Mean[Row]) * (Texel[Column] - Mean[Column]);
+				}
+			}
+		}
+
+		for (size_t Channel = 0u; Channel < N; ++Channel)
+		{
+			Axis[Channel] = Max[Channel] - Min[Channel];
+		}
+
+		for (unsigned int Iteration = 0u; Iteration < 8u; ++Iteration)
+		{
+			std::array<float, N> Next {};
+			float Largest = 0.0f;
+
+			for (size_t Row = 0u; Row < N; ++Row)
+			{
+				for (size_t Column = 0u; Column < N; ++Column)
+				{
+					Next[Row] += Covariance[Row * N + Column] * Axis[Column];
+				}
+
+				Largest = std::max(Largest, std::abs(Next[Row]));
+			}
+
+			if (Largest <= 0.0f)
+			{
+				break;
+			}
+
+			for (size_t Channel = 0u; Channel < N; ++Channel)
+			{
+				Axis[Channel] = Next[Channel] / Largest;
+			}
+		}
+
+		float AxisLengthSq = 0.0f;
+		for (const auto Component : Axis)
+		{
+			AxisLengthSq += Component * Component;
+		}
+
+		// A flat block has no axis, both endpoints are its colour.
+		if (AxisLengthSq <= 0.0f)
+		{
+			OutFirst = Mean;
+			OutLast = Mean;
+			return;
+		}
+
+		float MinProjection = std::numeric_limits<float>::max();
+		float MaxProjection = std::numeric_limits<float>::lowest();
+
+		for (const auto& Texel : InTexels)
+		{
+			float Projection = 0.0f;
+			for (size_t Channel = 0u; Channel < N; ++Channel)
+			{
+				Projection += (Texel[Channel] - Mean[Channel]) * Axis[Channel];
+			}
+
+			MinProjection = std::min(MinProjection, Projection / AxisLengthSq);
+			MaxProjection = std::max(MaxProjection, Projection / AxisLengthSq);
+		}
+
+		for (size_t Channel = 0u; Channel < N; ++Channel)
+		{
+			OutFirst[Channel] = std::clamp(Mean[Channel] + Axis[Channel] * MinProjection, 0.0f, 255.0f);
+			OutLast[Channel] = std::clamp(Mean[Channel] + Axis[Channel] * MaxProjection, 0.0f, 255.0f);
+		}
+	}
+
+	// Index of the palette entry closest to InTexel over the first N channels.
+	template<size_t N, size_t PaletteNum>
+	unsigned int FindClosest(const TextureCooker::Texel& InTexel, const std::array<std::array<int, N>, PaletteNum>& InPalette) noexcept
+	{
+		unsigned int Best = 0u;
+		int BestError = std::numeric_limits<int>::max();
+
+		for (unsigned int Entry = 0u; Entry < PaletteNum; ++Entry)
+		{
+			int Error = 0;
+			for (size_t Channel = 0u; Channel < N; ++Channel)
+			{
+				const int Difference = static_cast<int>(InTexel[Channel]) - InPalette[Entry][Channel];
+				Error += Difference * Difference;
+			}
+
+			if (Error < BestError)
+			{
+				Best = Entry;
+				BestError = Error;
+			}
+		}
+
+		return Best;
+	}
+
+	uint16_t ToRgb565(const std::array<float, 3>& InColor) noexcept
+	{
+		const auto R = static_cast<uint16_t>(std::lround(InColor[0] * 31.0f / 255.0f));
+		const auto G = static_cast<uint16_t>(std::lround(InColor[1] * 63.0f / 255.0f));
+		const auto B = static_cast<uint16_t>(std::lround(InColor[2] * 31.0f / 255.0f));
+		return static_cast<uint16_t>(R << 11u | G << 5u | B);
+	}
+
+	// Expanded the way the hardware does, the high bits repeat into the low ones.
+	std::array<int, 3> FromRgb565(const uint16_t InColor) noexcept
+	{
+		const int R = InColor >> 11u & 31u;
+		const int G = InColor >> 5u & 63u;
+		const int B = InColor & 31u;
+		return {R << 3 | R >> 2, G << 2 | G >> 4, B << 3 | B >> 2};
+	}
+
+	// Least significant bit first, the order block formats are specified in.
+	class BitWriter
+	{
+	public:
+		void Write(const uint64_t InValue, const unsigned int InBitNum) noexcept
+		{
+			for (unsigned int Bit = 0u; Bit < InBitNum; ++Bit, ++Position)
+			{
+				Words[Position / 64u] |= (InValue >> Bit & 1u) << (Position % 64u);
+			}
+		}
+
+		void CopyTo(const std::span<std::byte, 16> OutBlock) const noexcept
+		{
+			std::memcpy(OutBlock.data(), Words.data(), OutBlock.size());
+		}
+
+	private:
+		std::array<uint64_t, 2> Words {};
+		unsigned int Position {0u};
+	};
+
+	void EncodeBlock(const Level& InLevel, const TextureCooker::Usage InUsage, const DXGI_FORMAT InFormat, const unsigned int InBlockRow,
+	                 const unsigned int InBlockColumn, std::byte* const OutBlock) noexcept
+	{
+		std::array<TextureCooker::Texel, 16> Texels;
+
+		// Blocks past the edge of levels smaller than four texels repeat the last row and column.
+		for (unsigned int Texel = 0; Texel < 16u; ++Texel)
+		{
+			const unsigned int Row = std::min(InBlockRow * 4u + Texel / 4u, InLevel.Height - 1u);
+			const unsigned int Column = std::min(InBlockColumn * 4u + Texel % 4u, InLevel.Width - 1u);
+			const auto& Value = InLevel.Texels[static_cast<size_t>(Row) * InLevel.Width + Column];
+
+			Texels[Texel] = {Quantize(Value.x, InUsage), Quantize(Value.y, InUsage), Quantize(Value.z, InUsage), Quantize(Value.w, InUsage)};
+		}
+
+		switch (InFormat)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			TextureCooker::EncodeBC1Block(Texels, std::span<std::byte, 8>(OutBlock, 8u));
+			break;
+		case DXGI_FORMAT_BC7_UNORM:
+			TextureCooker::EncodeBC7Block(Texels, std::span<std::byte, 16>(OutBlock, 16u));
+			break;
+		default:
+		{
+			// BC5 is two BC4 blocks, X first.
+			std::array<unsigned char, 16> X;
+			std::array<unsigned char, 16> Y;
+
+			for (unsigned int Texel = 0; Texel < 16u; ++Texel)
+			{
+				X[Texel] = Texels[Texel][0];
+				Y[Texel] = Texels[Texel][1];
+			}
+
+			TextureCooker::EncodeBC4Block(X, std::span<std::byte, 8>(OutBlock, 8u));
+			TextureCooker::EncodeBC4Block(Y, std::span<std::byte, 8>(OutBlock + 8u, 8u));
+			break;
+		}
+		}
+	}
+
+	void EncodeLevel(const Level& InLevel, const TextureCooker::Usage InUsage, const DXGI_FORMAT InFormat, std::vector<std::byte>& OutBytes)
+	{
+		const unsigned int BlockColumns = (InLevel.Width + 3u) / 4u;
+		const unsigned int BlockRows = (InLevel.Height + 3u) / 4u;
+		const size_t BlockBytes = GetBlockBytes(InFormat);
+		const size_t RowBytes = BlockColumns * BlockBytes;
+		const size_t Offset = OutBytes.size();
+
+		OutBytes.resize(Offset + RowBytes * BlockRows);
+		std::byte* const Blocks = OutBytes.data() + Offset;
+
+		JobSystem::Get().ParallelFor(BlockRows, std::max<size_t>(1u, BlocksPerJob / BlockColumns), [&](const size_t InBlockRow)
+		{
+			for (unsigned int BlockColumn = 0; BlockColumn < BlockColumns; ++BlockColumn)
+			{
+				EncodeBlock(InLevel, InUsage, InFormat, static_cast<unsigned int>(InBlockRow), BlockColumn, Blocks + InBlockRow * RowBytes + BlockColumn * BlockBytes);
+			}
+		});
+	}
+
+	template<typename T>
+	void AppendBytes(std::vector<std::byte>& OutBytes, const T& InValue)
+	{
+		const auto Offset = OutBytes.size();
+		OutBytes.resize(Offset + sizeof(T));
+		std::memcpy(OutBytes.data() + Offset, &InValue, sizeof(T));
+	}
+
+	bool WriteFile(const std::filesystem::path& InPath, const std::vector<std::byte>& InBytes)
+	{
+		auto TemporaryPath = InPath;
+		TemporaryPath += ".tmp";
+
+		std::error_code ErrorCode;
+
+		{
+			std::ofstream Stream(TemporaryPath, std::ios::binary | std::ios::trunc);
+			if (!Stream)
+			{
+				return false;
+			}
+
+			if (!Stream.write(reinterpret_cast<const char*>(InBytes.data()), static_cast<std::streamsize>(InBytes.size())).flush())
+			{
+				Stream.close();
+				std::filesystem::remove(TemporaryPath, ErrorCode);
+				return false;
+			}
+		}
+
+		// Written aside and renamed so a loader on another thread never reads half a file.
+		std::filesystem::rename(TemporaryPath, InPath, ErrorCode);
+		if (ErrorCode)
+		{
+			std::filesystem::remove(TemporaryPath, ErrorCode);
+			return false;
+		}
+
+		return true;
+	}
+
+	// The header and every level, encoded in InFormat.
+	bool WriteLevels(const std::filesystem::path& InPath, const std::vector<Level>& InLevels, const TextureCooker::Usage InUsage, const DXGI_FORMAT InFormat)
+	{
+		DDSHeader Header {};
+		Header.Size = sizeof(DDSHeader);
+		Header.Flags = DDSRequiredFlags | DDSMipMapCountFlag;
+		Header.Height = InLevels.front().Height;
+		Header.Width = InLevels.front().Width;
+		Header.PitchOrLinearSize = static_cast<uint32_t>(((Header.Width + 3u) / 4u) * ((Header.Height + 3u) / 4u) * GetBlockBytes(InFormat));
+		Header.MipMapCount = static_cast<uint32_t>(InLevels.size());
+		Header.PixelFormat.Size = sizeof(DDSPixelFormat);
+		Header.PixelFormat.Flags = DDSFourCCFlag;
+		Header.Caps = DDSMipMappedCaps;
+
+		switch (InFormat)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			Header.PixelFormat.FourCC = MakeFourCC('D', 'X', 'T', '1');
+			break;
+		case DXGI_FORMAT_BC5_UNORM:
+			Header.PixelFormat.FourCC = MakeFourCC('B', 'C', '5', 'U');
+			break;
+		default:
+			// BC7 has no code of its own, only the extended header names it.
+			Header.PixelFormat.FourCC = MakeFourCC('D', 'X', '1', '0');
+			break;
+		}
+
+		std::vector<std::byte> CookedBytes;
+		AppendBytes(CookedBytes, DDSMagic);
+		AppendBytes(CookedBytes, Header);
+
+		if (Header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			AppendBytes(CookedBytes, DDSHeaderDXT10 {InFormat, DDSResourceDimensionTexture2D, 0u, 1u, 0u});
+		}
+
+		for (const auto& CookedLevel : InLevels)
+		{
+			EncodeLevel(CookedLevel, InUsage, InFormat, CookedBytes);
+		}
+
+		return WriteFile(InPath, CookedBytes);
+	}
+}
+
+DXGI_FORMAT TextureCooker::GetFormat(const Usage InUsage, const Quality InQuality) noexcept
+{
+	if (InUsage != Usage::ColorMap)
+	{
+		return DXGI_FORMAT_BC5_UNORM;
+	}
+
+	return InQuality == Quality::High ? DXGI_FORMAT_BC7_UNORM : DXGI_FORMAT_BC1_UNORM;
+}
+
+void TextureCooker::EncodeBC1Block(const std::span<const Texel, 16> InTexels, const std::span<std::byte, 8> OutBlock) noexcept
+{
+	std::array<float, 3> First;
+	std::array<float, 3> Last;
+	FindEndpoints<3>(InTexels, First, Last);
+
+	// The first endpoint has to be the larger for four colours, equal endpoints only ever use index zero.
+	uint16_t Color0 = ToRgb565(Last);
+	uint16_t Color1 = ToRgb565(First);
+	if (Color0 < Color1)
+	{
+		std::swap(Color0, Color1);
+	}
+
+	uint32_t Indices = 0u;
+
+	if (Color0 != Color1)
+	{
+		const auto Endpoint0 = FromRgb565(Color0);
+		const auto Endpoint1 = FromRgb565(Color1);
+		std::array<std::array<int, 3>, 4> Palette {Endpoint0, Endpoint1};
+
+		for (size_t Channel = 0u; Channel < 3u; ++Channel)
+		{
+			Palette[2][Channel] = (2 * Endpoint0[Channel] + Endpoint1[Channel]) / 3;
+			Palette[3][Channel] = (Endpoint0[Channel] + 2 * Endpoint1[Channel]) / 3;
+		}
+
+		for (unsigned int Texel = 0u; Texel < 16u; ++Texel)
+		{
+			Indices |= FindClosest(InTexels[Texel], Palette) << (Texel * 2u);
+		}
+	}
+
+	std::memcpy(OutBlock.data(), &Color0, sizeof(Color0));
+	std::memcpy(OutBlock.data() + 2u, &Color1, sizeof(Color1));
+	std::memcpy(OutBlock.data() + 4u, &Indices, sizeof(Indices));
+}
+
+void TextureCooker::EncodeBC7Block(const std::span<const Texel, 16> InTexels, const std::span<std::byte, 16> OutBlock) noexcept
+{
+	std::array<float, 4> First;
+	std::array<float, 4> Last;
+	FindEndpoints<4>(InTexels, First, Last);
+
+	// Seven bits per channel and one lowest bit shared by the endpoint's channels, whichever comes closer.
+	const auto QuantizeEndpoint = [](const std::array<float, 4>& InEndpoint, std::array<unsigned int, 4>& OutBits, unsigned int& OutLowestBit)
+	{
+		float BestError = std::numeric_limits<float>::max();
+
+		for (unsigned int LowestBit = 0u; LowestBit < 2u; ++LowestBit)
+		{
+			std::array<unsigned int, 4> Bits;
+			float Error = 0.0f;
+
+			for (size_t Channel = 0u; Channel < 4u; ++Channel)
+			{
+				Bits[Channel] = static_cast<unsigned int>(std::clamp(std::lround((InEndpoint[Channel] - LowestBit) / 2.0f), 0l, 127l));
+				const float Difference = static_cast<float>(Bits[Channel] << 1u | LowestBit) - InEndpoint[Channel];
+				Error += Difference * Difference;
+			}
+
+			if (Error < BestError)
+			{
+				BestError = Error;
+				OutBits = Bits;
+				OutLowestBit = LowestBit;
+			}
+		}
+	};
+
+	std::array<std::array<unsigned int, 4>, 2> Endpoints;
+	std::array<unsigned int, 2> LowestBits;
+	QuantizeEndpoint(First, Endpoints[0], LowestBits[0]);
+	QuantizeEndpoint(Last, Endpoints[1], LowestBits[1]);
+
+	const auto FindIndices = [&]
+	{
+		std::array<std::array<int, 4>, 16> Palette;
+
+		for (size_t Entry = 0u; Entry < 16u; ++Entry)
+		{
+			for (size_t Channel = 0u; Channel < 4u; ++Channel)
+			{
+				const auto Value0 = Endpoints[0][Channel] << 1u | LowestBits[0];
+				const auto Value1 = Endpoints[1][Channel] << 1u | LowestBits[1];
+				Palette[Entry][Channel] = static_cast<int>(((64u - BC7Weights[Entry]) * Value0 + BC7Weights[Entry] * Value1 + 32u) >> 6u);
+			}
+		}
+
+		std::array<unsigned int, 16> Indices;
+		for (unsigned int Texel = 0u; Texel < 16u; ++Texel)
+		{
+			Indices[Texel] = FindClosest(InTexels[Texel], Palette);
+		}
+
+		return Indices;
+	};
+
+	auto Indices = FindIndices();
+
+	// The first texel's index drops its highest bit, so it has to be in the lower half of the palette.
+	if (Indices[0] >= 8u)
+	{
+		std::swap(Endpoints[0], Endpoints[1]);
+		std::swap(LowestBits[0], LowestBits[1]);
+
+		for (auto& Index : Indices)
+		{
+			Index = 15u - Index;
+		}
+	}
+
+	BitWriter Writer;
+	// Mode 6 is six zero bits and a one.
+	Writer.Write(1u << 6u, 7u);
+
+	for (size_t Channel = 0u; Channel < 4u; ++Channel)
+	{
+		Writer.Write(Endpoints[0][Channel], 7u);
+		Writer.Write(Endpoints[1][Channel], 7u);
+	}
+
+	Writer.Write(LowestBits[0], 1u);
+	Writer.Write(LowestBits[1], 1u);
+	Writer.Write(Indices[0], 3u);
+
+	for (unsigned int Texel = 1u; Texel < 16u; ++Texel)
+	{
+		Writer.Write(Indices[Texel], 4u);
+	}
+
+	Writer.CopyTo(OutBlock);
+}
+
+void TextureCooker::EncodeBC4Block(const std::span<const unsigned char, 16> InValues, const std::span<std::byte, 8> OutBlock) noexcept
+{
+	const auto [Min, Max] = std::minmax_element(InValues.begin(), InValues.end());
+	// With the first endpoint the larger, the block has six steps between them as well, eight values in all.
+	const unsigned int First = *Max;
+	const unsigned int Last = *Min;
+	uint64_t Bits = First | Last << 8u;
+
+	if (First != Last)
+	{
+		const unsigned int Range = First - Last;
+
+		for (unsigned int Texel = 0; Texel < 16u; ++Texel)
+		{
+			// How many sevenths of the way from the first endpoint to the last, rounded to the nearest.
+			const unsigned int Step = ((First - InValues[Texel]) * 14u + Range) / (Range * 2u);
+			// Index zero is the first endpoint and one the last, the steps between are two onwards.
+			const uint64_t Index = Step == 0u ? 0u : Step == 7u ? 1u : Step + 1u;
+			Bits |= Index << (16u + Texel * 3u);
+		}
+	}
+
+	std::memcpy(OutBlock.data(), &Bits, OutBlock.size());
+}
+
+bool TextureCooker::Cook(const std::string& InFileName, const Usage InUsage, const Quality InQuality)
+{
+	const auto CookedPath = std::filesystem::path(InFileName).replace_extension(".dds");
+	const auto& Archive = AssetArchive::Get();
+	const auto SourceStatus = Archive.GetStatus(InFileName);
+
+	if (!SourceStatus)
+	{
+		return false;
+	}
+
+	if (const auto CookedStatus = Archive.GetStatus(CookedPath); CookedStatus && CookedStatus->WriteTime >= SourceStatus->WriteTime)
+	{
+		return true;
+	}
+
+	std::vector<std::byte> FileBytes;
+	if (!Archive.Read(InFileName, FileBytes))
+	{
+		return false;
+	}
+
+	std::vector<Level> Levels;
+	Levels.push_back(ReadTopLevel(Surface::FromMemory(InFileName, FileBytes), InUsage));
+
+	while (Levels.back().Width > 1u || Levels.back().Height > 1u)
+	{
+		Levels.push_back(FilterLevel(Levels.back(), InUsage));
+	}
+
+	return WriteLevels(CookedPath, Levels, InUsage, GetFormat(InUsage, InQuality));
+}
+
+bool TextureCooker::WriteColorMap(const std::filesystem::path& InFileName, const unsigned int InWidth, const unsigned int InHeight, const std::span<const Texel> InTexels)
+{
+	assert(InTexels.size() == static_cast<size_t>(InWidth) * InHeight && "One texel per texel of the map");
+
+	Level Top {InWidth, InHeight, {}};
+	Top.Texels.reserve(InTexels.size());
+
+	for (const auto& [R, G, B, A] : InTexels)
+	{
+		Top.Texels.push_back({R / 255.0f, G / 255.0f, B / 255.0f, A / 255.0f});
+	}
+
+	return WriteLevels(InFileName, {Top}, Usage::ColorMap, DXGI_FORMAT_BC7_UNORM);
+}
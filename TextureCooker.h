@@ -0,0 +1,54 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <dxgiformat.h>
+#include <filesystem>
+#include <span>
+#include <string>
+
+/**
+ * Block compression of a model's maps into the ".dds" next to each image, which Texture loads in its place.
+ * Normal maps keep only X and Y as two-channel BC5, the material shaders rebuild Z. Specular maps pack the grey level of their
+ * tint and their power into BC5 the same way, which the packed specular material variants read. Colour maps become BC7, or BC1
+ * where size matters more than quality. Every level of the mip chain is filtered before it is compressed, the rows of blocks
+ * of a level are encoded in parallel on the job system.
+ * Run at import with ModelAsset::ImportOptions::bCooksTextures, or ahead of time by the cooker for the asset archive.
+ */
+namespace TextureCooker
+{
+	enum class Usage
+	{
+		ColorMap,
+		NormalMap,
+		SpecularMap
+	};
+
+	// Only picks the colour map format, the others always have two channels.
+	enum class Quality
+	{
+		// BC7 with one subset, eight bits per texel.
+		High,
+		// BC1 without alpha, four bits per texel.
+		Fast
+	};
+
+	// Red, green, blue and alpha.
+	using Texel = std::array<unsigned char, 4>;
+
+	[[nodiscard]] DXGI_FORMAT GetFormat(Usage InUsage, Quality InQuality) noexcept;
+
+	// Each takes the sixteen texels of one 4x4 block row by row. The endpoints are the extremes along the block's principal axis.
+	void EncodeBC1Block(std::span<const Texel, 16> InTexels, std::span<std::byte, 8> OutBlock) noexcept;
+	// Mode 6, a single subset with alpha and sixteen steps between the endpoints.
+	void EncodeBC7Block(std::span<const Texel, 16> InTexels, std::span<std::byte, 16> OutBlock) noexcept;
+	// Single channel values, spread between the block's own minimum and maximum.
+	void EncodeBC4Block(std::span<const unsigned char, 16> InValues, std::span<std::byte, 8> OutBlock) noexcept;
+
+	// Writes the ".dds" unless one at least as new as the image is already there, which is also kept when it was authored by hand.
+	// Returns whether the file is current, a failed read or write leaves the image to be loaded as it is.
+	bool Cook(const std::string& InFileName, Usage InUsage, Quality InQuality = Quality::High);
+
+	// Texels made rather than read from an image, such as baked lightmaps, as a single level of BC7. Without mips nothing bleeds
+	// between the regions of an atlas, which is left to the caller to space out.
+	bool WriteColorMap(const std::filesystem::path& InFileName, unsigned int InWidth, unsigned int InHeight, std::span<const Texel> InTexels);
+}
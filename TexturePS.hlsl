@@ -1,7 +1,10 @@
+#include "ShaderOperations.hlsli"
+
 Texture2D Tex;
 SamplerState Sample;
 
 float4 main(const float2 InTextureCoordinate : TextureCoordinate) : SV_Target
 {
-    return Tex.Sample(Sample, InTextureCoordinate);
+    const float4 Color = Tex.Sample(Sample, InTextureCoordinate);
+    return float4(SrgbToLinear(Color.rgb), Color.a);
 }
\ No newline at end of file
@@ -0,0 +1,169 @@
+﻿#include "TextureStreamer.h"
+#include <algorithm>
+#include <cassert>
+#include "AllocationTracker.h"
+#include "FrameProfiler.h"
+#include "Texture.h"
+
+TextureStreamer::TextureStreamer(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, UploadManager& InUploads, const size_t InBudgetBytes) noexcept
+	: Device(InDevice), Context(InContext), Uploads(InUploads), BudgetBytes(InBudgetBytes)
+{}
+
+TextureStreamer::~TextureStreamer()
+{
+	JobSystem::Get().Wait(Jobs);
+}
+
+void TextureStreamer::Register(Texture& InTexture)
+{
+	std::lock_guard Lock(Mutex);
+	Textures.push_back(&InTexture);
+}
+
+void TextureStreamer::Unregister(Texture& InTexture)
+{
+	std::lock_guard Lock(Mutex);
+
+	if (const auto Found = std::find(Textures.begin(), Textures.end(), &InTexture); Found != Textures.end())
+	{
+		// A load still running for it finishes into its own result and is dropped with it.
+		if (InTexture.Pending)
+		{
+			--PendingNum;
+		}
+
+		*Found = Textures.back();
+		Textures.pop_back();
+	}
+}
+
+void TextureStreamer::Update()
+{
+	PROFILE_SCOPE("TextureStreamer::Update");
+	ALLOCATION_SCOPE(Streaming);
+
+	std::lock_guard Lock(Mutex);
+	++FrameIndex;
+
+	size_t ResidentBytes = 0u;
+	size_t PendingBytes = 0u;
+
+	for (auto* Streamed : Textures)
+	{
+		if (Streamed->ApplyStreamed())
+		{
+			--PendingNum;
+			++LastStatistics.StreamedNum;
+		}
+
+		if (const auto Requested = Streamed->RequestedMip.exchange(Texture::NoRequest, std::memory_order_relaxed); Requested != Texture::NoRequest)
+		{
+			Streamed->WantedMip = std::min(Requested, Streamed->CoarsestMip);
+			Streamed->LastUsedFrame = FrameIndex;
+		}
+		else if (FrameIndex - Streamed->LastUsedFrame > UnusedFrameNum)
+		{
+			Streamed->WantedMip = Streamed->CoarsestMip;
+		}
+
+		ResidentBytes += Streamed->ByteSize;
+
+		// Loads in flight already have their levels reserved.
+		if (Streamed->Pending)
+		{
+			PendingBytes += Streamed->GetByteSize(Streamed->Pending->FirstMip) - Streamed->ByteSize;
+		}
+	}
+
+	auto CommittedBytes = ResidentBytes + PendingBytes;
+
+	while (CommittedBytes > BudgetBytes && EvictOne(CommittedBytes))
+	{
+	}
+
+	std::vector<Texture*> Candidates;
+
+	for (auto* Streamed : Textures)
+	{
+		if (!Streamed->Pending && Streamed->WantedMip < Streamed->ResidentMip)
+		{
+			Candidates.push_back(Streamed);
+		}
+	}
+
+	// Textures needed most recently first, then the ones missing the most detail.
+	std::sort(Candidates.begin(), Candidates.end(), [](const Texture* InLeft, const Texture* InRight)
+	{
+		if (InLeft->LastUsedFrame != InRight->LastUsedFrame)
+		{
+			return InLeft->LastUsedFrame > InRight->LastUsedFrame;
+		}
+
+		return InLeft->ResidentMip - InLeft->WantedMip > InRight->ResidentMip - InRight->WantedMip;
+	});
+
+	for (auto* Candidate : Candidates)
+	{
+		if (PendingNum >= MaxPendingNum)
+		{
+			break;
+		}
+
+		const auto ExtraBytes = Candidate->GetByteSize(Candidate->WantedMip) - Candidate->ByteSize;
+
+		while (CommittedBytes + ExtraBytes > BudgetBytes && EvictOne(CommittedBytes))
+		{
+		}
+
+		// Everything left is needed at least as recently, this one waits until something else is dropped.
+		if (CommittedBytes + ExtraBytes > BudgetBytes)
+		{
+			continue;
+		}
+
+		// Detail for what's on screen right now is read ahead of detail kept for what was.
+		Candidate->StreamIn(Device, Uploads, Candidate->WantedMip, Candidate->LastUsedFrame == FrameIndex ? IoPriority::Visible : IoPriority::Prefetch, Jobs);
+		CommittedBytes += ExtraBytes;
+		++PendingNum;
+	}
+
+	LastStatistics.ResidentBytes = 0u;
+	for (const auto* Streamed : Textures)
+	{
+		LastStatistics.ResidentBytes += Streamed->ByteSize;
+	}
+
+	LastStatistics.TextureNum = static_cast<unsigned int>(Textures.size());
+	LastStatistics.PendingNum = PendingNum;
+}
+
+bool TextureStreamer::EvictOne(size_t& InOutResidentBytes)
+{
+	Texture* Victim = nullptr;
+
+	for (auto* Streamed : Textures)
+	{
+		// Levels it still wants this frame only go once nothing older is left.
+		const auto bHasSpareLevel = !Streamed->Pending && Streamed->ResidentMip < Streamed->CoarsestMip &&
+		                            (Streamed->ResidentMip < Streamed->WantedMip || Streamed->LastUsedFrame < FrameIndex);
+
+		if (bHasSpareLevel && (!Victim || Streamed->LastUsedFrame < Victim->LastUsedFrame))
+		{
+			Victim = Streamed;
+		}
+	}
+
+	if (!Victim)
+	{
+		return false;
+	}
+
+	const auto PreviousBytes = Victim->ByteSize;
+	Victim->Evict(Device, Context, Victim->ResidentMip + 1u);
+
+	assert(PreviousBytes >= Victim->ByteSize);
+	InOutResidentBytes -= PreviousBytes - Victim->ByteSize;
+	++LastStatistics.EvictedNum;
+
+	return true;
+}
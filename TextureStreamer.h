@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <d3d11.h>
+#include <mutex>
+#include <vector>
+#include "JobSystem.h"
+
+class Texture;
+class UploadManager;
+
+/**
+ * Keeps streamed textures at the detail their meshes need instead of resident in full.
+ * Streamed textures start from their coarse levels, meshes report the finest level they need each frame, and finer
+ * levels are decoded by jobs and uploaded through UploadManager while the resident total stays under the budget.
+ * When it would not, the levels last needed longest ago are dropped first.
+ */
+class TextureStreamer
+{
+public:
+	struct Statistics
+	{
+		size_t ResidentBytes {0u};
+		unsigned int TextureNum {0u};
+		unsigned int PendingNum {0u};
+		// Since startup.
+		unsigned int StreamedNum {0u};
+		unsigned int EvictedNum {0u};
+	};
+
+	// New streamed textures keep their levels from the first one no larger than this on either side.
+	static constexpr UINT InitialSize {128u};
+
+	TextureStreamer(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, UploadManager& InUploads, size_t InBudgetBytes = 512u * 1024u * 1024u) noexcept;
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer(TextureStreamer&&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(TextureStreamer&&) = delete;
+	// Waits for the jobs in flight, they upload through the device.
+	~TextureStreamer();
+
+	// Called by streamed textures from any thread, they unregister when destroyed.
+	void Register(Texture& InTexture);
+	void Unregister(Texture& InTexture);
+
+	// Swaps in finished levels, evicts and starts new loads, once per frame on the main thread before anything is recorded.
+	void Update();
+
+	void SetBudget(const size_t InBudgetBytes) noexcept
+	{
+		BudgetBytes = InBudgetBytes;
+	}
+
+	[[nodiscard]] size_t GetBudget() const noexcept
+	{
+		return BudgetBytes;
+	}
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+	[[nodiscard]] JobCounter& GetJobCounter() noexcept
+	{
+		return Jobs;
+	}
+
+private:
+	// Loads are read without a worker but decode the whole file on one, a few at a time so they don't crowd out the frame's own jobs.
+	static constexpr unsigned int MaxPendingNum {2u};
+	// A texture no mesh asked for in this many frames gives up its streamed levels first.
+	static constexpr unsigned long long UnusedFrameNum {120u};
+
+	// Drops one level of the least recently needed texture that has one to spare, false when none does.
+	bool EvictOne(size_t& InOutResidentBytes);
+
+private:
+	ID3D11Device* Device;
+	ID3D11DeviceContext* Context;
+	UploadManager& Uploads;
+	size_t BudgetBytes;
+
+	std::mutex Mutex;
+	std::vector<Texture*> Textures;
+	JobCounter Jobs;
+	unsigned long long FrameIndex {0u};
+	unsigned int PendingNum {0u};
+	Statistics LastStatistics {};
+};
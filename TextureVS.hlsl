@@ -1,3 +1,5 @@
+#include "FrameConstants.hlsli"
+
 cbuffer CBuf
 {
     matrix Transform;
@@ -9,10 +11,10 @@ struct VSOut
     float4 VertexPosition : SV_Position;
 };
 
-VSOut main(float3 InVertexPosition : Position, const float2 InTextureCoordinate : TextureCoordinate)
+VSOut main(float3 InVertexPosition : Position, const float2 InTextureCoordinate : TexCoord)
 {
     VSOut Out;
-    Out.VertexPosition = mul(float4(InVertexPosition, 1.0f), Transform);
+    Out.VertexPosition = mul(mul(float4(InVertexPosition, 1.0f), Transform), ViewProjection);
     Out.TextureCoordinate = InTextureCoordinate;
     return Out;
 }
\ No newline at end of file
@@ -1,15 +1,21 @@
 ﻿#pragma once
 #include "Drawable.h"
+#include "EntityStore.h"
 
 class TexturedBox : public Drawable
 {
 public:
-	TexturedBox(const Graphics& InGraphics);
+	// InEntity moves the box, the store outlives it.
+	TexturedBox(const Graphics& InGraphics, const EntityStore& InStore, EntityStore::Entity InEntity);
 
 	[[nodiscard]] DirectX::XMMATRIX GetTransformMatrix() const noexcept override;
 
+	[[nodiscard]] EntityStore::Entity GetEntity() const noexcept
+	{
+		return MyEntity;
+	}
+
 private:
-	float X {0.0f};
-	float Y {0.0f};
-	float Z {0.0f};
+	const EntityStore& Store;
+	EntityStore::Entity MyEntity;
 };
@@ -0,0 +1,62 @@
+// Resolves the HDR scene to display values in one pass: adds the bloom, exposes, compresses with a filmic curve and
+// encodes to sRGB. The UAV can't encode on write, the final pass copies the encoded values as they are.
+// Alpha holds the luma of the result, what FXAA finds edges by.
+#include "ShaderOperations.hlsli"
+
+Texture2D<float3> Scene : register(t0);
+Texture2D<float3> Bloom : register(t1);
+SamplerState LinearSampler : register(s0);
+RWTexture2D<float4> Output : register(u0);
+
+cbuffer ToneMap : register(b0)
+{
+    // From a scene texel to the bloom texture coordinate of the same spot.
+    float2 BloomScale;
+    // Rendered texels of the bloom's mip 0 and the size of the whole texture, so each mip stays inside what was rendered.
+    uint2 BloomMip0Size;
+    uint2 BloomSize;
+    uint2 ViewportSize;
+    float Exposure;
+    // Zero leaves the bloom texture unread.
+    float BloomIntensity;
+    float2 Padding;
+}
+
+#define BLOOM_MIP_NUM 5
+
+// Narkowicz's fit of the ACES filmic curve, maps [0, inf) onto [0, 1) with a soft shoulder.
+float3 ToneMapAces(const float3 InColor)
+{
+    return saturate((InColor * (2.51f * InColor + 0.03f)) / (InColor * (2.43f * InColor + 0.59f) + 0.14f));
+}
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= ViewportSize))
+    {
+        return;
+    }
+
+    float3 Color = Scene.Load(int3(InThreadID.xy, 0));
+
+    if (BloomIntensity > 0.0f)
+    {
+        // Each mip spreads the glow twice as wide as the one before, weighing them equally falls off smoothly with distance.
+        const float2 Coordinate = (InThreadID.xy + 0.5f) * BloomScale;
+        float3 Glow = float3(0.0f, 0.0f, 0.0f);
+
+        [unroll]
+        for (uint Mip = 0u; Mip < BLOOM_MIP_NUM; ++Mip)
+        {
+            const float2 MipSize = BloomSize >> Mip;
+            const float2 MaxCoordinate = (((BloomMip0Size + (1u << Mip) - 1u) >> Mip) - 0.5f) / MipSize;
+            Glow += Bloom.SampleLevel(LinearSampler, min(Coordinate, MaxCoordinate), Mip);
+        }
+
+        Color += Glow * (BloomIntensity / BLOOM_MIP_NUM);
+    }
+
+    const float3 Encoded = LinearToSrgb(ToneMapAces(Color * Exposure));
+    Output[InThreadID.xy] = float4(Encoded, dot(Encoded, float3(0.299f, 0.587f, 0.114f)));
+}
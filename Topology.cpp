@@ -1,13 +1,20 @@
 ﻿#include "Topology.h"
 #include "BindManager.h"
+#include "DrawPacket.h"
 
 Topology::Topology(const Graphics& InGraphics, const D3D11_PRIMITIVE_TOPOLOGY InTopologyType)
 	: TopologyType(InTopologyType)
 {}
 
-void Topology::Bind(const Graphics& InGraphics) noexcept
+void Topology::Bind(RenderContext& InContext) noexcept
 {
-	GetContext(InGraphics)->IASetPrimitiveTopology(TopologyType);
+	GetStateCache(InContext).SetPrimitiveTopology(TopologyType);
+}
+
+bool Topology::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.Topology = TopologyType;
+	return true;
 }
 
 std::shared_ptr<Topology> Topology::Resolve(const Graphics& InGraphics, D3D11_PRIMITIVE_TOPOLOGY InTopologyType)
@@ -21,6 +28,11 @@ std::string Topology::GenerateUniqueID(const D3D11_PRIMITIVE_TOPOLOGY InTopology
 	return typeid(Topology).name() + "#"s + std::to_string(InTopologyType);
 }
 
+BindKey Topology::GenerateKey(const D3D11_PRIMITIVE_TOPOLOGY InTopologyType)
+{
+	return BindKey::Make<Topology>(InTopologyType);
+}
+
 std::string Topology::GetUniqueID() const noexcept
 {
 	return GenerateUniqueID(TopologyType);
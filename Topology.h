@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <memory>
+#include "BindKey.h"
 #include "Bindable.h"
 
 class Topology : public Bindable
@@ -7,10 +8,12 @@ class Topology : public Bindable
 public:
 	explicit Topology(const Graphics& InGraphics, D3D11_PRIMITIVE_TOPOLOGY InTopologyType);
 
-	void Bind(const Graphics& InGraphics) noexcept override;
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
 
 	[[nodiscard]] static std::shared_ptr<Topology> Resolve(const Graphics& InGraphics, D3D11_PRIMITIVE_TOPOLOGY InTopologyType);
 	[[nodiscard]] static std::string GenerateUniqueID(D3D11_PRIMITIVE_TOPOLOGY InTopologyType);
+	[[nodiscard]] static BindKey GenerateKey(D3D11_PRIMITIVE_TOPOLOGY InTopologyType);
 	[[nodiscard]] std::string GetUniqueID() const noexcept override;
 
 protected:
@@ -1,12 +1,14 @@
 ﻿#include "TransformConstantBuffer.h"
-#include "Camera.h"
 #include "Drawable.h"
 
 TransformConstantBuffer::TransformConstantBuffer(const Graphics& InGraphics, const Drawable& InParent,
                                                  const Target InType, UINT InSlot)
 	: Parent(InParent)
 	, Type(InType)
+	, Slot(InSlot)
 {
+	std::lock_guard Lock(SharedBufferMutex);
+
 	if (!MyVertexConstantBuffer)
 	{
 		MyVertexConstantBuffer = std::make_unique<VertexConstantBuffer<Transforms>>(InGraphics, InSlot);
@@ -18,44 +20,50 @@ TransformConstantBuffer::TransformConstantBuffer(const Graphics& InGraphics, con
 	}
 }
 
-void TransformConstantBuffer::Bind(const Graphics& InGraphics) noexcept
+void TransformConstantBuffer::Bind(RenderContext& InContext) noexcept
 {
-	BindImpl(InGraphics, GetTransforms(InGraphics));
+	BindImpl(InContext, GetTransforms());
 }
 
-void TransformConstantBuffer::BindImpl(const Graphics& InGraphics, const Transforms& InTransforms) const noexcept
+void TransformConstantBuffer::BindImpl(RenderContext& InContext, const Transforms& InTransforms) const noexcept
 {
+	if (ConstantBufferRing* Ring = GetConstantBufferRing(InContext))
+	{
+		const auto Allocation = Ring->Allocate(&InTransforms, sizeof(InTransforms));
+
+		switch (Type)
+		{
+		case Target::Vertex:
+			GetStateCache(InContext).SetVertexConstantBuffer(Slot, Allocation.Buffer, Allocation.FirstConstant, Allocation.ConstantNum);
+			break;
+		case Target::Pixel:
+			GetStateCache(InContext).SetPixelConstantBuffer(Slot, Allocation.Buffer, Allocation.FirstConstant, Allocation.ConstantNum);
+			break;
+		}
+
+		return;
+	}
+
 	switch (Type)
 	{
 	case Target::Vertex:
 		{
-			MyVertexConstantBuffer->Update(InGraphics, InTransforms);
-			MyVertexConstantBuffer->Bind(InGraphics);
+			MyVertexConstantBuffer->Update(InContext, InTransforms);
+			MyVertexConstantBuffer->Bind(InContext);
 		}
 		break;
 	case Target::Pixel:
 		{
-			MyPixelConstantBuffer->Update(InGraphics, InTransforms);
-			MyPixelConstantBuffer->Bind(InGraphics);
+			MyPixelConstantBuffer->Update(InContext, InTransforms);
+			MyPixelConstantBuffer->Bind(InContext);
 		}
 		break;
 	}
 }
 
-TransformConstantBuffer::Transforms TransformConstantBuffer::GetTransforms(const Graphics& InGraphics) const noexcept
+TransformConstantBuffer::Transforms TransformConstantBuffer::GetTransforms() const noexcept
 {
-	const auto WorldTransformMatrix = Parent.get().GetTransformMatrix();
-
-	return
-	{
-		DirectX::XMMatrixTranspose(WorldTransformMatrix),
-		DirectX::XMMatrixTranspose
-		(
-			WorldTransformMatrix *
-			InGraphics.GetCamera().GetMatrix() *
-			InGraphics.GetProjectionMatrix()
-		)
-	};
+	return {DirectX::XMMatrixTranspose(Parent.get().GetTransformMatrix()), Parent.get().GetMaterialIndex(), Parent.get().GetPlayedAnimation(), {}};
 }
 
 
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include <DirectXMath.h>
 #include <memory>
+#include <mutex>
 #include "Bindable.h"
 #include "ConstantBuffers.h"
 
@@ -16,25 +17,31 @@ public:
 	};
 
 private:
+	// View and projection come from the frame constants, only the world matrix and the material change per draw.
 	struct Transforms
 	{
 		DirectX::XMMATRIX World;
-		DirectX::XMMATRIX WorldViewProjection;
+		// Into the MaterialTable, the material vertex shaders pass it on to the pixel shaders.
+		UINT MaterialIndex;
+		// Clip and time offset of the vertex animation, see Drawable::GetPlayedAnimation.
+		UINT Animation;
+		UINT Padding[2];
 	};
 
 public:
 	TransformConstantBuffer(const Graphics& InGraphics, const Drawable& InParent, Target InType, UINT InSlot = 0u);
 
-	void Bind(const Graphics& InGraphics) noexcept override;
-	Transforms GetTransforms(const Graphics& InGraphics) const noexcept;
+	void Bind(RenderContext& InContext) noexcept override;
+	Transforms GetTransforms() const noexcept;
 
 private:
-	void BindImpl(const Graphics& InGraphics, const Transforms& InTransforms) const noexcept;
-
+	void BindImpl(RenderContext& InContext, const Transforms& InTransforms) const noexcept;
 
 private:
 	static inline std::unique_ptr<VertexConstantBuffer<Transforms>> MyVertexConstantBuffer;
 	static inline std::unique_ptr<PixelConstantBuffer<Transforms>> MyPixelConstantBuffer;
+	static inline std::mutex SharedBufferMutex;
 	std::reference_wrapper<const Drawable> Parent;
 	Target Type;
+	UINT Slot;
 };
@@ -0,0 +1,21 @@
+// Weighted blended transparency targets written by the TRANSPARENT build of MaterialPS.hlsl and read by TransparencyCompositePS.hlsl,
+// the formats are OrderIndependentTransparency's.
+// Target 0, R16G16B16A16_FLOAT, blended ONE, ONE: colour premultiplied by opacity, and the opacity, each times the surface's weight.
+// Target 1, R16_FLOAT, blended ZERO, INV_SRC_COLOR: the product of one minus every surface's opacity, cleared to one.
+
+struct TransparencyTargets
+{
+    float4 Accumulation : SV_Target0;
+    float Revealage : SV_Target1;
+};
+
+// McGuire and Bavoil's depth weight, nearer surfaces outweigh farther ones without ever reaching the limits of half floats.
+TransparencyTargets EncodeTransparency(const float3 InColor, const float InOpacity, const float InDistance)
+{
+    const float Weight = InOpacity * clamp(0.03f / (1e-5f + pow(InDistance / 200.0f, 4.0f)), 1e-2f, 3e3f);
+
+    TransparencyTargets Targets;
+    Targets.Accumulation = float4(InColor * InOpacity, InOpacity) * Weight;
+    Targets.Revealage = InOpacity;
+    return Targets;
+}
@@ -0,0 +1,42 @@
+// The weighted average of the blended surfaces over the scene, blended with SRC_ALPHA, INV_SRC_ALPHA by how much they cover.
+// MULTISAMPLED builds run once per sample and read the sample they write, the targets have the scene's sample count.
+#if MULTISAMPLED
+Texture2DMS<float4> Accumulation : register(t0);
+Texture2DMS<float> Revealage : register(t1);
+#else
+Texture2D<float4> Accumulation : register(t0);
+Texture2D<float> Revealage : register(t1);
+#endif
+
+float4 main(const float4 InPosition : SV_Position
+#if MULTISAMPLED
+            , const uint InSampleIndex : SV_SampleIndex
+#endif
+            ) : SV_Target
+{
+#if MULTISAMPLED
+    const float Revealed = Revealage.Load(int2(InPosition.xy), InSampleIndex);
+#else
+    const float Revealed = Revealage.Load(int3(InPosition.xy, 0));
+#endif
+
+    // Nothing blended covers the pixel, the scene stays as it is.
+    if (Revealed >= 1.0f)
+    {
+        discard;
+    }
+
+#if MULTISAMPLED
+    float4 Sum = Accumulation.Load(int2(InPosition.xy), InSampleIndex);
+#else
+    float4 Sum = Accumulation.Load(int3(InPosition.xy, 0));
+#endif
+
+    // Many near layers can still overflow the colour, the average of white keeps the pixel bright instead of black.
+    if (any(isinf(Sum.rgb)))
+    {
+        Sum.rgb = Sum.aaa;
+    }
+
+    return float4(Sum.rgb / clamp(Sum.a, 1e-4f, 5e4f), 1.0f - Revealed);
+}
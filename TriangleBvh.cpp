@@ -0,0 +1,678 @@
+﻿#include "TriangleBvh.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <emmintrin.h>
+#include <limits>
+
+namespace
+{
+	// Parallel rays and slivers, as DirectX::TriangleTests takes them.
+	constexpr float RayEpsilon {1e-20f};
+
+	// Grows from empty, its area is only asked for once something was added.
+	struct Extent
+	{
+		DirectX::XMFLOAT3 Min {FLT_MAX, FLT_MAX, FLT_MAX};
+		DirectX::XMFLOAT3 Max {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+		void Grow(const DirectX::XMFLOAT3& InMin, const DirectX::XMFLOAT3& InMax) noexcept
+		{
+			DirectX::XMStoreFloat3(&Min, DirectX::XMVectorMin(DirectX::XMLoadFloat3(&Min), DirectX::XMLoadFloat3(&InMin)));
+			DirectX::XMStoreFloat3(&Max, DirectX::XMVectorMax(DirectX::XMLoadFloat3(&Max), DirectX::XMLoadFloat3(&InMax)));
+		}
+
+		[[nodiscard]] float GetSurfaceArea() const noexcept
+		{
+			const auto X = Max.x - Min.x;
+			const auto Y = Max.y - Min.y;
+			const auto Z = Max.z - Min.z;
+			return 2.0f * (X * Y + Y * Z + Z * X);
+		}
+	};
+
+	float GetAxis(const DirectX::XMFLOAT3& InVector, const unsigned int InAxis) noexcept
+	{
+		return InAxis == 0u ? InVector.x : InAxis == 1u ? InVector.y : InVector.z;
+	}
+
+	// Where the ray enters the box, or infinity when it misses it or only gets there after InDistance.
+	float IntersectBox(const TriangleBvh::Node& InNode, const DirectX::XMFLOAT3& InOrigin, const DirectX::XMFLOAT3& InInverseDirection,
+	                   const float InDistance) noexcept
+	{
+		const auto X1 = (InNode.Min.x - InOrigin.x) * InInverseDirection.x;
+		const auto X2 = (InNode.Max.x - InOrigin.x) * InInverseDirection.x;
+		const auto Y1 = (InNode.Min.y - InOrigin.y) * InInverseDirection.y;
+		const auto Y2 = (InNode.Max.y - InOrigin.y) * InInverseDirection.y;
+		const auto Z1 = (InNode.Min.z - InOrigin.z) * InInverseDirection.z;
+		const auto Z2 = (InNode.Max.z - InOrigin.z) * InInverseDirection.z;
+
+		const auto Near = std::max({std::min(X1, X2), std::min(Y1, Y2), std::min(Z1, Z2), 0.0f});
+		const auto Far = std::min({std::max(X1, X2), std::max(Y1, Y2), std::max(Z1, Z2), InDistance});
+
+		return Near <= Far ? Near : std::numeric_limits<float>::infinity();
+	}
+
+	// Moller and Trumbore's test, narrows InOutHit to the triangle when it is hit closer.
+	bool IntersectTriangle(const TriangleBvh::Triangle& InTriangle, const DirectX::XMFLOAT3& InOrigin, const DirectX::XMFLOAT3& InDirection,
+	                       TriangleBvh::Hit& InOutHit) noexcept
+	{
+		const auto& [E1x, E1y, E1z] = InTriangle.Edge1;
+		const auto& [E2x, E2y, E2z] = InTriangle.Edge2;
+		const auto& [Dx, Dy, Dz] = InDirection;
+
+		const auto Px = Dy * E2z - Dz * E2y;
+		const auto Py = Dz * E2x - Dx * E2z;
+		const auto Pz = Dx * E2y - Dy * E2x;
+		const auto Determinant = E1x * Px + E1y * Py + E1z * Pz;
+
+		if (std::abs(Determinant) <= RayEpsilon)
+		{
+			return false;
+		}
+
+		const auto InverseDeterminant = 1.0f / Determinant;
+		const auto Tx = InOrigin.x - InTriangle.Corner.x;
+		const auto Ty = InOrigin.y - InTriangle.Corner.y;
+		const auto Tz = InOrigin.z - InTriangle.Corner.z;
+		const auto U = (Tx * Px + Ty * Py + Tz * Pz) * InverseDeterminant;
+
+		if (U < 0.0f || U > 1.0f)
+		{
+			return false;
+		}
+
+		const auto Qx = Ty * E1z - Tz * E1y;
+		const auto Qy = Tz * E1x - Tx * E1z;
+		const auto Qz = Tx * E1y - Ty * E1x;
+		const auto V = (Dx * Qx + Dy * Qy + Dz * Qz) * InverseDeterminant;
+
+		if (V < 0.0f || U + V > 1.0f)
+		{
+			return false;
+		}
+
+		const auto Distance = (E2x * Qx + E2y * Qy + E2z * Qz) * InverseDeterminant;
+
+		if (Distance < 0.0f || Distance >= InOutHit.Distance)
+		{
+			return false;
+		}
+
+		InOutHit = {Distance, InTriangle.Index, U, V};
+		return true;
+	}
+
+	// Four rays a register, one per lane, in their three axes.
+	struct PacketRays
+	{
+		std::array<__m128, 3u> Origin;
+		std::array<__m128, 3u> Direction;
+		std::array<__m128, 3u> InverseDirection;
+	};
+
+	// A lane bit per active ray that enters the box within its distance, and the nearest of their entry distances.
+	int IntersectBox(const TriangleBvh::Node& InNode, const PacketRays& InRays, const __m128 InDistances, const int InActiveMask, float& OutNear) noexcept
+	{
+		const std::array Min {InNode.Min.x, InNode.Min.y, InNode.Min.z};
+		const std::array Max {InNode.Max.x, InNode.Max.y, InNode.Max.z};
+		auto Near = _mm_setzero_ps();
+		auto Far = InDistances;
+
+		for (unsigned int Axis = 0u; Axis < 3u; ++Axis)
+		{
+			const auto T1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Min[Axis]), InRays.Origin[Axis]), InRays.InverseDirection[Axis]);
+			const auto T2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Max[Axis]), InRays.Origin[Axis]), InRays.InverseDirection[Axis]);
+			Near = _mm_max_ps(Near, _mm_min_ps(T1, T2));
+			Far = _mm_min_ps(Far, _mm_max_ps(T1, T2));
+		}
+
+		const auto Entered = _mm_cmple_ps(Near, Far);
+		const auto Mask = _mm_movemask_ps(Entered) & InActiveMask;
+
+		if (Mask)
+		{
+			// The smallest lane, misses counting as infinitely far.
+			auto Nearest = _mm_or_ps(_mm_and_ps(Entered, Near), _mm_andnot_ps(Entered, _mm_set1_ps(std::numeric_limits<float>::infinity())));
+			Nearest = _mm_min_ps(Nearest, _mm_shuffle_ps(Nearest, Nearest, _MM_SHUFFLE(2, 3, 0, 1)));
+			Nearest = _mm_min_ps(Nearest, _mm_shuffle_ps(Nearest, Nearest, _MM_SHUFFLE(1, 0, 3, 2)));
+			OutNear = _mm_cvtss_f32(Nearest);
+		}
+
+		return Mask;
+	}
+
+	// The same test four rays at a time, a lane bit per active ray that hits the triangle closer than its distance so far, which
+	// InOutDistances, InOutU and InOutV are narrowed to.
+	int IntersectTriangle(const TriangleBvh::Triangle& InTriangle, const PacketRays& InRays, __m128& InOutDistances, __m128& InOutU, __m128& InOutV,
+	                      const int InActiveMask) noexcept
+	{
+		const auto E1x = _mm_set1_ps(InTriangle.Edge1.x);
+		const auto E1y = _mm_set1_ps(InTriangle.Edge1.y);
+		const auto E1z = _mm_set1_ps(InTriangle.Edge1.z);
+		const auto E2x = _mm_set1_ps(InTriangle.Edge2.x);
+		const auto E2y = _mm_set1_ps(InTriangle.Edge2.y);
+		const auto E2z = _mm_set1_ps(InTriangle.Edge2.z);
+		const auto& [Dx, Dy, Dz] = InRays.Direction;
+
+		const auto Px = _mm_sub_ps(_mm_mul_ps(Dy, E2z), _mm_mul_ps(Dz, E2y));
+		const auto Py = _mm_sub_ps(_mm_mul_ps(Dz, E2x), _mm_mul_ps(Dx, E2z));
+		const auto Pz = _mm_sub_ps(_mm_mul_ps(Dx, E2y), _mm_mul_ps(Dy, E2x));
+		const auto Determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(E1x, Px), _mm_mul_ps(E1y, Py)), _mm_mul_ps(E1z, Pz));
+		const auto InverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), Determinant);
+
+		const auto Tx = _mm_sub_ps(InRays.Origin[0], _mm_set1_ps(InTriangle.Corner.x));
+		const auto Ty = _mm_sub_ps(InRays.Origin[1], _mm_set1_ps(InTriangle.Corner.y));
+		const auto Tz = _mm_sub_ps(InRays.Origin[2], _mm_set1_ps(InTriangle.Corner.z));
+		const auto U = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Tx, Px), _mm_mul_ps(Ty, Py)), _mm_mul_ps(Tz, Pz)), InverseDeterminant);
+
+		const auto Qx = _mm_sub_ps(_mm_mul_ps(Ty, E1z), _mm_mul_ps(Tz, E1y));
+		const auto Qy = _mm_sub_ps(_mm_mul_ps(Tz, E1x), _mm_mul_ps(Tx, E1z));
+		const auto Qz = _mm_sub_ps(_mm_mul_ps(Tx, E1y), _mm_mul_ps(Ty, E1x));
+		const auto V = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Dx, Qx), _mm_mul_ps(Dy, Qy)), _mm_mul_ps(Dz, Qz)), InverseDeterminant);
+		const auto Distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(E2x, Qx), _mm_mul_ps(E2y, Qy)), _mm_mul_ps(E2z, Qz)), InverseDeterminant);
+
+		// The absolute value clears the sign bit. Lanes that divided by zero fail every comparison.
+		const auto Zero = _mm_setzero_ps();
+		auto IsHit = _mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), Determinant), _mm_set1_ps(RayEpsilon));
+		IsHit = _mm_and_ps(IsHit, _mm_cmpge_ps(U, Zero));
+		IsHit = _mm_and_ps(IsHit, _mm_cmpge_ps(V, Zero));
+		IsHit = _mm_and_ps(IsHit, _mm_cmple_ps(_mm_add_ps(U, V), _mm_set1_ps(1.0f)));
+		IsHit = _mm_and_ps(IsHit, _mm_cmpge_ps(Distance, Zero));
+		IsHit = _mm_and_ps(IsHit, _mm_cmplt_ps(Distance, InOutDistances));
+
+		const auto Mask = _mm_movemask_ps(IsHit) & InActiveMask;
+
+		if (Mask)
+		{
+			const auto Taken = _mm_castsi128_ps(_mm_setr_epi32(Mask & 1 ? -1 : 0, Mask & 2 ? -1 : 0, Mask & 4 ? -1 : 0, Mask & 8 ? -1 : 0));
+			InOutDistances = _mm_or_ps(_mm_and_ps(Taken, Distance), _mm_andnot_ps(Taken, InOutDistances));
+			InOutU = _mm_or_ps(_mm_and_ps(Taken, U), _mm_andnot_ps(Taken, InOutU));
+			InOutV = _mm_or_ps(_mm_and_ps(Taken, V), _mm_andnot_ps(Taken, InOutV));
+		}
+
+		return Mask;
+	}
+}
+
+TriangleBvh::TriangleBvh(const std::span<const unsigned int> InIndices, const void* InPositions, const size_t InVertexNum, const size_t InStride)
+{
+	const auto GetPosition = [&](const unsigned int InIndex)
+	{
+		assert(InIndex < InVertexNum);
+		return DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(static_cast<const char*>(InPositions) + InIndex * InStride));
+	};
+
+	std::vector<BuildItem> Items;
+	Items.reserve(InIndices.size() / 3u);
+
+	for (size_t First = 0u; First + 2u < InIndices.size(); First += 3u)
+	{
+		const auto A = GetPosition(InIndices[First]);
+		const auto B = GetPosition(InIndices[First + 1u]);
+		const auto C = GetPosition(InIndices[First + 2u]);
+		const auto Edge1 = DirectX::XMVectorSubtract(B, A);
+		const auto Edge2 = DirectX::XMVectorSubtract(C, A);
+
+		// No ray can hit what has no area.
+		if (DirectX::XMVector3Equal(DirectX::XMVector3Cross(Edge1, Edge2), DirectX::XMVectorZero()))
+		{
+			continue;
+		}
+
+		auto& Item = Items.emplace_back();
+		DirectX::XMStoreFloat3(&Item.Min, DirectX::XMVectorMin(A, DirectX::XMVectorMin(B, C)));
+		DirectX::XMStoreFloat3(&Item.Max, DirectX::XMVectorMax(A, DirectX::XMVectorMax(B, C)));
+		DirectX::XMStoreFloat3(&Item.Centroid, DirectX::XMVectorScale(DirectX::XMVectorAdd(A, DirectX::XMVectorAdd(B, C)), 1.0f / 3.0f));
+		DirectX::XMStoreFloat3(&Item.Source.Corner, A);
+		DirectX::XMStoreFloat3(&Item.Source.Edge1, Edge1);
+		DirectX::XMStoreFloat3(&Item.Source.Edge2, Edge2);
+		Item.Source.Index = static_cast<uint32_t>(First / 3u);
+	}
+
+	if (Items.empty())
+	{
+		return;
+	}
+
+	Nodes.reserve(2u * Items.size() / MaxLeafTriangleNum + 1u);
+	Triangles.reserve(Items.size());
+	BuildRange(Items, 0u, static_cast<unsigned int>(Items.size()), 0u);
+	Nodes.shrink_to_fit();
+}
+
+void TriangleBvh::BuildRange(std::vector<BuildItem>& InOutItems, const unsigned int InFirst, const unsigned int InLast, const unsigned int InDepth)
+{
+	const auto NodeIndex = static_cast<unsigned int>(Nodes.size());
+	Nodes.emplace_back();
+
+	Extent Bounds;
+	Extent Centroids;
+
+	for (auto Index = InFirst; Index < InLast; ++Index)
+	{
+		Bounds.Grow(InOutItems[Index].Min, InOutItems[Index].Max);
+		Centroids.Grow(InOutItems[Index].Centroid, InOutItems[Index].Centroid);
+	}
+
+	Nodes[NodeIndex].Min = Bounds.Min;
+	Nodes[NodeIndex].Max = Bounds.Max;
+
+	const auto ItemNum = InLast - InFirst;
+
+	const auto MakeLeaf = [&]
+	{
+		auto& Leaf = Nodes[NodeIndex];
+		Leaf.ChildOrFirstTriangle = static_cast<uint32_t>(Triangles.size());
+		Leaf.TriangleNum = ItemNum;
+
+		for (auto Index = InFirst; Index < InLast; ++Index)
+		{
+			Triangles.push_back(InOutItems[Index].Source);
+		}
+	};
+
+	if (ItemNum <= 1u || InDepth + 4u >= MaxDepth)
+	{
+		MakeLeaf();
+		return;
+	}
+
+	// Split along the widest axis of the centroids.
+	const DirectX::XMFLOAT3 CentroidExtent {Centroids.Max.x - Centroids.Min.x, Centroids.Max.y - Centroids.Min.y, Centroids.Max.z - Centroids.Min.z};
+	const auto Axis = CentroidExtent.x >= CentroidExtent.y && CentroidExtent.x >= CentroidExtent.z ? 0u : CentroidExtent.y >= CentroidExtent.z ? 1u : 2u;
+	const auto AxisMin = GetAxis(Centroids.Min, Axis);
+	const auto AxisExtent = GetAxis(CentroidExtent, Axis);
+
+	auto Middle = InFirst + ItemNum / 2u;
+
+	if (AxisExtent <= 0.0f)
+	{
+		if (ItemNum <= MaxLeafTriangleNum)
+		{
+			MakeLeaf();
+			return;
+		}
+	}
+	else
+	{
+		const auto GetBin = [&](const BuildItem& InItem)
+		{
+			const auto Offset = (GetAxis(InItem.Centroid, Axis) - AxisMin) / AxisExtent;
+			return std::min(static_cast<unsigned int>(Offset * BinNum), BinNum - 1u);
+		};
+
+		struct Bin
+		{
+			Extent Bounds;
+			unsigned int ItemNum {0u};
+		};
+
+		std::array<Bin, BinNum> Bins;
+
+		for (auto Index = InFirst; Index < InLast; ++Index)
+		{
+			auto& Target = Bins[GetBin(InOutItems[Index])];
+			Target.Bounds.Grow(InOutItems[Index].Min, InOutItems[Index].Max);
+			++Target.ItemNum;
+		}
+
+		// Sweep from the right once to get every right-hand side cost, then from the left to pick the split.
+		std::array<float, BinNum> RightCosts {};
+		Extent RightBounds;
+		unsigned int RightNum = 0u;
+
+		for (auto BinIndex = BinNum - 1u; BinIndex > 0u; --BinIndex)
+		{
+			if (Bins[BinIndex].ItemNum)
+			{
+				RightBounds.Grow(Bins[BinIndex].Bounds.Min, Bins[BinIndex].Bounds.Max);
+				RightNum += Bins[BinIndex].ItemNum;
+			}
+
+			RightCosts[BinIndex] = RightNum ? RightBounds.GetSurfaceArea() * static_cast<float>(RightNum) : 0.0f;
+		}
+
+		auto BestCost = std::numeric_limits<float>::max();
+		unsigned int BestSplit = 0u;
+		Extent LeftBounds;
+		unsigned int LeftNum = 0u;
+
+		for (unsigned int Split = 1u; Split < BinNum; ++Split)
+		{
+			if (Bins[Split - 1u].ItemNum)
+			{
+				LeftBounds.Grow(Bins[Split - 1u].Bounds.Min, Bins[Split - 1u].Bounds.Max);
+				LeftNum += Bins[Split - 1u].ItemNum;
+			}
+
+			if (LeftNum == 0u || LeftNum == ItemNum)
+			{
+				continue;
+			}
+
+			if (const auto Cost = LeftBounds.GetSurfaceArea() * static_cast<float>(LeftNum) + RightCosts[Split]; Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestSplit = Split;
+			}
+		}
+
+		// Testing the leaf's triangles against splitting it, which also costs visiting the two children.
+		const auto LeafCost = Bounds.GetSurfaceArea() * static_cast<float>(ItemNum);
+
+		if (ItemNum <= MaxLeafTriangleNum && LeafCost <= BestCost + TraversalCost * Bounds.GetSurfaceArea())
+		{
+			MakeLeaf();
+			return;
+		}
+
+		if (BestSplit)
+		{
+			Middle = static_cast<unsigned int>(std::partition(InOutItems.begin() + InFirst, InOutItems.begin() + InLast, [&](const BuildItem& InItem)
+			{
+				return GetBin(InItem) < BestSplit;
+			}) - InOutItems.begin());
+		}
+	}
+
+	if (Middle == InFirst || Middle == InLast)
+	{
+		Middle = InFirst + ItemNum / 2u;
+	}
+
+	Nodes[NodeIndex].TriangleNum = 0u;
+	BuildRange(InOutItems, InFirst, Middle, InDepth + 1u);
+	const auto RightChild = static_cast<uint32_t>(Nodes.size());
+	BuildRange(InOutItems, Middle, InLast, InDepth + 1u);
+	Nodes[NodeIndex].ChildOrFirstTriangle = RightChild;
+}
+
+bool TriangleBvh::Assign(const std::span<const Node> InNodes, const std::span<const Triangle> InTriangles)
+{
+	Nodes.clear();
+	Triangles.clear();
+
+	if (InNodes.empty())
+	{
+		return InTriangles.empty();
+	}
+
+	// Children come after their parents, so one pass in order finds every node's depth before its children need it.
+	std::vector<unsigned int> Depths(InNodes.size(), 0u);
+	size_t LeafTriangleNum = 0u;
+
+	for (size_t Index = 0u; Index < InNodes.size(); ++Index)
+	{
+		const auto& Candidate = InNodes[Index];
+
+		if (Depths[Index] >= MaxDepth)
+		{
+			return false;
+		}
+
+		if (Candidate.TriangleNum)
+		{
+			if (static_cast<uint64_t>(Candidate.ChildOrFirstTriangle) + Candidate.TriangleNum > InTriangles.size())
+			{
+				return false;
+			}
+
+			LeafTriangleNum += Candidate.TriangleNum;
+			continue;
+		}
+
+		if (Index + 1u >= InNodes.size() || Candidate.ChildOrFirstTriangle <= Index + 1u || Candidate.ChildOrFirstTriangle >= InNodes.size())
+		{
+			return false;
+		}
+
+		Depths[Index + 1u] = Depths[Index] + 1u;
+		Depths[Candidate.ChildOrFirstTriangle] = Depths[Index] + 1u;
+	}
+
+	if (LeafTriangleNum != InTriangles.size())
+	{
+		return false;
+	}
+
+	Nodes.assign(InNodes.begin(), InNodes.end());
+	Triangles.assign(InTriangles.begin(), InTriangles.end());
+	return true;
+}
+
+bool TriangleBvh::Intersect(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, Hit& InOutHit) const noexcept
+{
+	return TraceRay<false>(InOrigin, InDirection, InOutHit);
+}
+
+bool TriangleBvh::IsOccluded(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, const float InDistance) const noexcept
+{
+	Hit Blocker;
+	Blocker.Distance = InDistance;
+	return TraceRay<true>(InOrigin, InDirection, Blocker);
+}
+
+void TriangleBvh::Intersect(const RayPacket& InRays, std::array<Hit, PacketSize>& InOutHits) const noexcept
+{
+	unsigned int RayMask = 0u;
+
+	for (unsigned int Ray = 0u; Ray < PacketSize; ++Ray)
+	{
+		RayMask |= InOutHits[Ray].Distance > 0.0f ? 1u << Ray : 0u;
+	}
+
+	(void)TracePacket<false>(InRays, InOutHits, RayMask);
+}
+
+unsigned int TriangleBvh::GetOccludedMask(const RayPacket& InRays, const std::array<float, PacketSize>& InDistances, const unsigned int InRayMask) const noexcept
+{
+	std::array<Hit, PacketSize> Blockers;
+
+	for (unsigned int Ray = 0u; Ray < PacketSize; ++Ray)
+	{
+		Blockers[Ray].Distance = InDistances[Ray];
+	}
+
+	return TracePacket<true>(InRays, Blockers, InRayMask);
+}
+
+DirectX::BoundingBox TriangleBvh::GetBounds() const noexcept
+{
+	assert(!Nodes.empty());
+
+	DirectX::BoundingBox Bounds;
+	DirectX::BoundingBox::CreateFromPoints(Bounds, DirectX::XMLoadFloat3(&Nodes.front().Min), DirectX::XMLoadFloat3(&Nodes.front().Max));
+	return Bounds;
+}
+
+template<bool bIsAnyHit>
+bool TriangleBvh::TraceRay(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, Hit& InOutHit) const noexcept
+{
+	if (Nodes.empty())
+	{
+		return false;
+	}
+
+	DirectX::XMFLOAT3 Origin;
+	DirectX::XMFLOAT3 Direction;
+	DirectX::XMFLOAT3 InverseDirection;
+	DirectX::XMStoreFloat3(&Origin, InOrigin);
+	DirectX::XMStoreFloat3(&Direction, InDirection);
+	DirectX::XMStoreFloat3(&InverseDirection, DirectX::XMVectorReciprocal(InDirection));
+
+	// Nodes waiting with the distance their box was entered at, the nearer child is always taken first.
+	std::array<std::pair<unsigned int, float>, MaxDepth> Stack;
+	unsigned int StackSize = 0u;
+	bool bIsHit = false;
+
+	if (const auto Near = IntersectBox(Nodes.front(), Origin, InverseDirection, InOutHit.Distance); Near != std::numeric_limits<float>::infinity())
+	{
+		Stack[StackSize++] = {0u, Near};
+	}
+
+	while (StackSize)
+	{
+		const auto [NodeIndex, Near] = Stack[--StackSize];
+
+		// A closer hit was found since the box was entered.
+		if (Near >= InOutHit.Distance)
+		{
+			continue;
+		}
+
+		const auto& Current = Nodes[NodeIndex];
+
+		if (Current.TriangleNum)
+		{
+			for (auto Index = Current.ChildOrFirstTriangle; Index < Current.ChildOrFirstTriangle + Current.TriangleNum; ++Index)
+			{
+				if (IntersectTriangle(Triangles[Index], Origin, Direction, InOutHit))
+				{
+					bIsHit = true;
+
+					if constexpr (bIsAnyHit)
+					{
+						return true;
+					}
+				}
+			}
+
+			continue;
+		}
+
+		const auto Left = NodeIndex + 1u;
+		const auto Right = Current.ChildOrFirstTriangle;
+		const auto LeftNear = IntersectBox(Nodes[Left], Origin, InverseDirection, InOutHit.Distance);
+		const auto RightNear = IntersectBox(Nodes[Right], Origin, InverseDirection, InOutHit.Distance);
+		const auto bIsLeftFirst = LeftNear <= RightNear;
+
+		// Farther first, so the nearer one is popped next. A missed child is infinitely far and never pushed.
+		if (const auto Farther = bIsLeftFirst ? std::pair {Right, RightNear} : std::pair {Left, LeftNear}; Farther.second != std::numeric_limits<float>::infinity())
+		{
+			Stack[StackSize++] = Farther;
+		}
+
+		if (const auto Nearer = bIsLeftFirst ? std::pair {Left, LeftNear} : std::pair {Right, RightNear}; Nearer.second != std::numeric_limits<float>::infinity())
+		{
+			Stack[StackSize++] = Nearer;
+		}
+	}
+
+	return bIsHit;
+}
+
+template<bool bIsAnyHit>
+unsigned int TriangleBvh::TracePacket(const RayPacket& InRays, std::array<Hit, PacketSize>& InOutHits, const unsigned int InRayMask) const noexcept
+{
+	static_assert(PacketSize == 4u, "A packet is one SSE register per axis");
+
+	auto ActiveMask = static_cast<int>(InRayMask);
+
+	if (Nodes.empty() || !ActiveMask)
+	{
+		return 0u;
+	}
+
+	const auto& [O, D] = InRays;
+	PacketRays Rays;
+	Rays.Origin = {_mm_setr_ps(O[0].x, O[1].x, O[2].x, O[3].x), _mm_setr_ps(O[0].y, O[1].y, O[2].y, O[3].y), _mm_setr_ps(O[0].z, O[1].z, O[2].z, O[3].z)};
+	Rays.Direction = {_mm_setr_ps(D[0].x, D[1].x, D[2].x, D[3].x), _mm_setr_ps(D[0].y, D[1].y, D[2].y, D[3].y), _mm_setr_ps(D[0].z, D[1].z, D[2].z, D[3].z)};
+
+	for (unsigned int Axis = 0u; Axis < 3u; ++Axis)
+	{
+		Rays.InverseDirection[Axis] = _mm_div_ps(_mm_set1_ps(1.0f), Rays.Direction[Axis]);
+	}
+
+	auto Distances = _mm_setr_ps(InOutHits[0].Distance, InOutHits[1].Distance, InOutHits[2].Distance, InOutHits[3].Distance);
+	auto U = _mm_setzero_ps();
+	auto V = _mm_setzero_ps();
+	std::array<unsigned int, PacketSize> HitTriangles {NoTriangle, NoTriangle, NoTriangle, NoTriangle};
+	int HitMask = 0;
+
+	// The farthest any ray still searches, a box entered beyond it can't hold a closer hit for any of them.
+	const auto GetFarthest = [&Distances]
+	{
+		auto Farthest = _mm_max_ps(Distances, _mm_shuffle_ps(Distances, Distances, _MM_SHUFFLE(2, 3, 0, 1)));
+		Farthest = _mm_max_ps(Farthest, _mm_shuffle_ps(Farthest, Farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtss_f32(Farthest);
+	};
+
+	std::array<std::pair<unsigned int, float>, MaxDepth> Stack;
+	unsigned int StackSize = 0u;
+
+	if (float Near; IntersectBox(Nodes.front(), Rays, Distances, ActiveMask, Near))
+	{
+		Stack[StackSize++] = {0u, Near};
+	}
+
+	while (StackSize && ActiveMask)
+	{
+		const auto [NodeIndex, Near] = Stack[--StackSize];
+
+		if (Near >= GetFarthest())
+		{
+			continue;
+		}
+
+		const auto& Current = Nodes[NodeIndex];
+
+		if (Current.TriangleNum)
+		{
+			for (auto Index = Current.ChildOrFirstTriangle; Index < Current.ChildOrFirstTriangle + Current.TriangleNum && ActiveMask; ++Index)
+			{
+				const auto Mask = IntersectTriangle(Triangles[Index], Rays, Distances, U, V, ActiveMask);
+				HitMask |= Mask;
+
+				// A ray that found a blocker is done, the others go on.
+				if constexpr (bIsAnyHit)
+				{
+					ActiveMask &= ~Mask;
+				}
+
+				for (unsigned int Ray = 0u; Ray < PacketSize; ++Ray)
+				{
+					HitTriangles[Ray] = Mask & (1 << Ray) ? Triangles[Index].Index : HitTriangles[Ray];
+				}
+			}
+
+			continue;
+		}
+
+		const auto Left = NodeIndex + 1u;
+		const auto Right = Current.ChildOrFirstTriangle;
+		float LeftNear = std::numeric_limits<float>::infinity();
+		float RightNear = std::numeric_limits<float>::infinity();
+		const auto bIsLeftEntered = IntersectBox(Nodes[Left], Rays, Distances, ActiveMask, LeftNear) != 0;
+		const auto bIsRightEntered = IntersectBox(Nodes[Right], Rays, Distances, ActiveMask, RightNear) != 0;
+		const auto bIsLeftFirst = LeftNear <= RightNear;
+
+		// Farther first, as for a single ray.
+		if (bIsLeftEntered && bIsRightEntered)
+		{
+			Stack[StackSize++] = bIsLeftFirst ? std::pair {Right, RightNear} : std::pair {Left, LeftNear};
+			Stack[StackSize++] = bIsLeftFirst ? std::pair {Left, LeftNear} : std::pair {Right, RightNear};
+		}
+		else if (bIsLeftEntered || bIsRightEntered)
+		{
+			Stack[StackSize++] = bIsLeftEntered ? std::pair {Left, LeftNear} : std::pair {Right, RightNear};
+		}
+	}
+
+	std::array<float, PacketSize> HitDistances;
+	std::array<float, PacketSize> HitU;
+	std::array<float, PacketSize> HitV;
+	_mm_storeu_ps(HitDistances.data(), Distances);
+	_mm_storeu_ps(HitU.data(), U);
+	_mm_storeu_ps(HitV.data(), V);
+
+	for (unsigned int Ray = 0u; Ray < PacketSize; ++Ray)
+	{
+		if (HitMask & (1 << Ray))
+		{
+			InOutHits[Ray] = {HitDistances[Ray], HitTriangles[Ray], HitU[Ray], HitV[Ray]};
+		}
+	}
+
+	return static_cast<unsigned int>(HitMask);
+}
@@ -0,0 +1,126 @@
+﻿#pragma once
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <DirectXCollision.h>
+#include <span>
+#include <vector>
+
+/**
+ * Binary tree over the triangles of one mesh, built with a binned surface area heuristic at import and stored in the MeshCache,
+ * for ray casts against the mesh in its own space. Unlike BoundingVolumeHierarchy it is never refit, and keeps its triangles
+ * in leaf order as a corner and two edges, so a query touches nothing but the tree's own two arrays.
+ * Rays need not be normalized, distances are in lengths of their direction, so a ray taken into the mesh's space by its
+ * node's inverse transform hits at the same distances it would in the world. Triangles are hit from either side.
+ * Packets trace PacketSize rays at once down the tree, four wide in SIMD registers, best for rays that start close together and
+ * point roughly the same way, such as the hemisphere of one baked sample.
+ */
+class TriangleBvh
+{
+public:
+	static constexpr unsigned int NoTriangle {~0u};
+	static constexpr unsigned int PacketSize {4u};
+
+	// Laid out as stored in the cache.
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		// The left child always follows its parent, internal nodes store the right one here and leaves their first triangle.
+		uint32_t ChildOrFirstTriangle;
+		DirectX::XMFLOAT3 Max;
+		// Zero for internal nodes.
+		uint32_t TriangleNum;
+	};
+
+	struct Triangle
+	{
+		DirectX::XMFLOAT3 Corner;
+		DirectX::XMFLOAT3 Edge1;
+		DirectX::XMFLOAT3 Edge2;
+		// Of the triangle in the indices the tree was built from, a third of its first index's position.
+		uint32_t Index;
+	};
+
+	// Distance is how far to search going in and where the closest triangle was hit coming out, which stays NoTriangle on a miss.
+	// U and V weigh the triangle's second and third corner at the hit, the first one gets the rest.
+	struct Hit
+	{
+		float Distance {FLT_MAX};
+		unsigned int Triangle {NoTriangle};
+		float U {0.0f};
+		float V {0.0f};
+	};
+
+	struct RayPacket
+	{
+		std::array<DirectX::XMFLOAT3, PacketSize> Origins;
+		std::array<DirectX::XMFLOAT3, PacketSize> Directions;
+	};
+
+	TriangleBvh() = default;
+	// Positions are read InStride bytes apart, like MeshOptimizer::BuildMeshlets reads them. Degenerate triangles are left out.
+	TriangleBvh(std::span<const unsigned int> InIndices, const void* InPositions, size_t InVertexNum, size_t InStride);
+
+	// A tree as a cache stored it, false when it doesn't hold together and the tree stays empty.
+	[[nodiscard]] bool Assign(std::span<const Node> InNodes, std::span<const Triangle> InTriangles);
+
+	// The closest triangle within InOutHit.Distance, false on a miss.
+	bool Intersect(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, Hit& InOutHit) const noexcept;
+	// Whether any triangle lies within InDistance, stopping at the first one found.
+	[[nodiscard]] bool IsOccluded(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, float InDistance) const noexcept;
+
+	// The closest triangle of every ray within its hit's distance, a ray going in with a distance of zero is left alone.
+	void Intersect(const RayPacket& InRays, std::array<Hit, PacketSize>& InOutHits) const noexcept;
+	// A bit per ray that has a triangle within its distance, only rays in InRayMask are traced and the rest stay clear.
+	[[nodiscard]] unsigned int GetOccludedMask(const RayPacket& InRays, const std::array<float, PacketSize>& InDistances,
+	                                           unsigned int InRayMask = (1u << PacketSize) - 1u) const noexcept;
+
+	[[nodiscard]] bool IsEmpty() const noexcept
+	{
+		return Nodes.empty();
+	}
+
+	[[nodiscard]] std::span<const Node> GetNodes() const noexcept
+	{
+		return Nodes;
+	}
+
+	[[nodiscard]] std::span<const Triangle> GetTriangles() const noexcept
+	{
+		return Triangles;
+	}
+
+	[[nodiscard]] unsigned int GetTriangleNum() const noexcept
+	{
+		return static_cast<unsigned int>(Triangles.size());
+	}
+
+	// Box around every triangle, the tree must not be empty.
+	[[nodiscard]] DirectX::BoundingBox GetBounds() const noexcept;
+
+private:
+	static constexpr unsigned int MaxLeafTriangleNum {4u};
+	static constexpr unsigned int BinNum {12u};
+	// Visiting a node, in triangle tests.
+	static constexpr float TraversalCost {1.0f};
+	// Traversal keeps at most one pending sibling per level, deeper ranges become a single large leaf instead.
+	static constexpr unsigned int MaxDepth {64u};
+
+	struct BuildItem
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+		DirectX::XMFLOAT3 Centroid;
+		Triangle Source;
+	};
+
+	void BuildRange(std::vector<BuildItem>& InOutItems, unsigned int InFirst, unsigned int InLast, unsigned int InDepth);
+
+	template<bool bIsAnyHit>
+	bool TraceRay(DirectX::FXMVECTOR InOrigin, DirectX::FXMVECTOR InDirection, Hit& InOutHit) const noexcept;
+	template<bool bIsAnyHit>
+	unsigned int TracePacket(const RayPacket& InRays, std::array<Hit, PacketSize>& InOutHits, unsigned int InRayMask) const noexcept;
+
+	std::vector<Node> Nodes;
+	std::vector<Triangle> Triangles;
+};
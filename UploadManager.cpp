@@ -0,0 +1,338 @@
+﻿#include "UploadManager.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+
+namespace
+{
+	// Keeps every write into a slot starting on a cache line of its own.
+	constexpr UINT SlotAlignment {64u};
+}
+
+UploadManager::UploadManager(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, const size_t InBudgetBytes)
+	: Device(InDevice), Context(InContext), BudgetBytes(InBudgetBytes)
+{
+	HRESULT ResultHandle;
+
+	D3D11_BUFFER_DESC SlotDesc {};
+	SlotDesc.ByteWidth = SlotBytes;
+	SlotDesc.Usage = D3D11_USAGE_STAGING;
+	SlotDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	for (auto& NewSlot : Slots)
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateBuffer(&SlotDesc, nullptr, &NewSlot.Buffer))
+	}
+
+	// Nothing has been copied out of the first one yet.
+	OpenIndex = SlotNum - 1u;
+	OpenSlot();
+}
+
+UploadManager::~UploadManager()
+{
+	{
+		std::lock_guard Lock(Mutex);
+		UnmapTextures();
+	}
+
+	if (Mapped)
+	{
+		Context->Unmap(Slots[OpenIndex].Buffer.Get(), 0u);
+	}
+}
+
+void UploadManager::UploadBuffer(ID3D11Buffer* InDestination, const UINT InByteOffset, const void* InData, const UINT InSize, Callback InOnUploaded)
+{
+	assert(InDestination && InSize && "Empty upload");
+
+	if (WriteToSlot(InDestination, InByteOffset, InData, InSize, InOnUploaded))
+	{
+		return;
+	}
+
+	const auto* const Bytes = static_cast<const std::byte*>(InData);
+	std::lock_guard Lock(Mutex);
+
+	if (!InOnUploaded)
+	{
+		Needed.push_back({InDestination, InByteOffset, {Bytes, Bytes + InSize}});
+		return;
+	}
+
+	// In pieces that each fit a slot, the callback goes with the last one.
+	for (UINT Offset = 0u; Offset < InSize; Offset += SlotBytes)
+	{
+		const auto Size = std::min(SlotBytes, InSize - Offset);
+		auto& Piece = Streamed.emplace_back(PendingUpload {InDestination, InByteOffset + Offset, {Bytes + Offset, Bytes + Offset + Size}});
+		Piece.ByteSize = Size;
+	}
+
+	Streamed.back().OnUploaded = std::move(InOnUploaded);
+}
+
+void UploadManager::UploadTexture(Microsoft::WRL::ComPtr<ID3D11Texture2D> InDestination, Microsoft::WRL::ComPtr<ID3D11Texture2D> InStaging,
+                                  const size_t InByteSize, Callback InOnUploaded)
+{
+	assert(InDestination && InStaging && "Empty upload");
+
+	PendingUpload NewUpload;
+	NewUpload.Texture = std::move(InDestination);
+	NewUpload.Staging = std::move(InStaging);
+	NewUpload.ByteSize = InByteSize;
+	NewUpload.OnUploaded = std::move(InOnUploaded);
+
+	std::lock_guard Lock(Mutex);
+	(NewUpload.OnUploaded ? Streamed : Needed).push_back(std::move(NewUpload));
+}
+
+UploadManager::MappedTexture UploadManager::MapTexture(const D3D11_TEXTURE2D_DESC& InDesc)
+{
+	HRESULT ResultHandle;
+
+	auto StagingDesc = InDesc;
+	StagingDesc.Usage = D3D11_USAGE_STAGING;
+	StagingDesc.BindFlags = 0u;
+	StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ | D3D11_CPU_ACCESS_WRITE;
+	StagingDesc.MiscFlags = 0u;
+
+	MappedTexture NewMapped;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&StagingDesc, nullptr, &NewMapped.Staging))
+	NewMapped.Levels.resize(static_cast<size_t>(StagingDesc.MipLevels) * StagingDesc.ArraySize);
+
+	// Nothing has copied from the texture yet, so none of the maps waits on the GPU.
+	for (UINT Level = 0u; Level < NewMapped.Levels.size(); ++Level)
+	{
+		CHECK_HRESULT_EXCEPTION(Context->Map(NewMapped.Staging.Get(), Level, D3D11_MAP_READ_WRITE, 0u, &NewMapped.Levels[Level]))
+	}
+
+	return NewMapped;
+}
+
+void UploadManager::UploadTexture(Microsoft::WRL::ComPtr<ID3D11Texture2D> InDestination, MappedTexture InMapped, const size_t InByteSize,
+                                  Callback InOnUploaded)
+{
+	assert(InDestination && InMapped.Staging && "Empty upload");
+
+	PendingUpload NewUpload;
+	NewUpload.Texture = std::move(InDestination);
+	NewUpload.Staging = std::move(InMapped.Staging);
+	NewUpload.ByteSize = InByteSize;
+	NewUpload.OnUploaded = std::move(InOnUploaded);
+	NewUpload.MappedLevelNum = static_cast<UINT>(InMapped.Levels.size());
+
+	std::lock_guard Lock(Mutex);
+	(NewUpload.OnUploaded ? Streamed : Needed).push_back(std::move(NewUpload));
+}
+
+void UploadManager::DiscardTexture(MappedTexture InMapped)
+{
+	std::lock_guard Lock(Mutex);
+	Discarded.push_back(std::move(InMapped));
+}
+
+void UploadManager::Flush()
+{
+	PROFILE_SCOPE("UploadManager::Flush");
+
+	std::vector<Callback> Uploaded;
+	auto CopiedBytes = CloseSlot(Uploaded);
+
+	std::deque<PendingUpload> NeededNow;
+	{
+		std::lock_guard Lock(Mutex);
+		UnmapTextures();
+		NeededNow.swap(Needed);
+	}
+
+	// The ring was full when these came in, and the next draws can't wait for it.
+	for (const auto& Upload : NeededNow)
+	{
+		if (Upload.Staging)
+		{
+			Context->CopyResource(Upload.Texture.Get(), Upload.Staging.Get());
+			CopiedBytes += Upload.ByteSize;
+			continue;
+		}
+
+		const auto Size = static_cast<UINT>(Upload.Data.size());
+		const D3D11_BOX Destination {Upload.DestinationOffset, 0u, 0u, Upload.DestinationOffset + Size, 1u, 1u};
+		Context->UpdateSubresource(Upload.Destination, 0u, &Destination, Upload.Data.data(), 0u, 0u);
+		CopiedBytes += Size;
+		++LastStatistics.OverflowNum;
+	}
+
+	OpenSlot();
+
+	// Oldest first while the budget lasts, the first one goes whatever its size so a large texture isn't stuck for good.
+	// Buffer data moves into the slot just opened and is copied out of it by the next Flush.
+	size_t StreamedBytes = 0u;
+	for (;;)
+	{
+		PendingUpload Next;
+		{
+			std::lock_guard Lock(Mutex);
+
+			if (Streamed.empty() || (StreamedBytes && StreamedBytes + Streamed.front().ByteSize > BudgetBytes))
+			{
+				break;
+			}
+
+			Next = std::move(Streamed.front());
+			Streamed.pop_front();
+		}
+
+		if (!Next.Staging)
+		{
+			if (!WriteToSlot(Next.Destination, Next.DestinationOffset, Next.Data.data(), static_cast<UINT>(Next.Data.size()), Next.OnUploaded))
+			{
+				std::lock_guard Lock(Mutex);
+				Streamed.push_front(std::move(Next));
+				break;
+			}
+
+			StreamedBytes += Next.ByteSize;
+			continue;
+		}
+
+		Context->CopyResource(Next.Texture.Get(), Next.Staging.Get());
+		StreamedBytes += Next.ByteSize;
+		CopiedBytes += Next.ByteSize;
+		Uploaded.push_back(std::move(Next.OnUploaded));
+	}
+
+	{
+		std::lock_guard Lock(Mutex);
+
+		LastStatistics.CopiedBytes = CopiedBytes;
+		LastStatistics.PendingBytes = 0u;
+		LastStatistics.PendingNum = static_cast<unsigned int>(Streamed.size() + Needed.size());
+
+		for (const auto& Pending : Streamed)
+		{
+			LastStatistics.PendingBytes += Pending.ByteSize;
+		}
+	}
+
+	for (const auto& OnUploaded : Uploaded)
+	{
+		OnUploaded();
+	}
+}
+
+bool UploadManager::WriteToSlot(ID3D11Buffer* InDestination, const UINT InByteOffset, const void* InData, const UINT InSize, Callback& InOutOnUploaded)
+{
+	std::byte* Target;
+	{
+		std::lock_guard Lock(Mutex);
+
+		if (!Mapped || InSize > SlotBytes - OpenOffset)
+		{
+			return false;
+		}
+
+		Target = Mapped + OpenOffset;
+		Slots[OpenIndex].Copies.push_back({InDestination, InByteOffset, OpenOffset, InSize, std::move(InOutOnUploaded)});
+		OpenOffset = std::min(SlotBytes, (OpenOffset + InSize + SlotAlignment - 1u) / SlotAlignment * SlotAlignment);
+		++WriterNum;
+	}
+
+	// Outside the lock, other writers fill their own ranges of the slot at the same time.
+	std::memcpy(Target, InData, InSize);
+
+	{
+		std::lock_guard Lock(Mutex);
+		--WriterNum;
+	}
+
+	WritersDone.notify_all();
+	return true;
+}
+
+void UploadManager::OpenSlot()
+{
+	HRESULT ResultHandle;
+
+	const auto NextIndex = (OpenIndex + 1u) % SlotNum;
+
+	// Staging buffers the GPU still reads from would stall the map, the ring waits a frame instead.
+	D3D11_MAPPED_SUBRESOURCE MappedSlot;
+	ResultHandle = Context->Map(Slots[NextIndex].Buffer.Get(), 0u, D3D11_MAP_WRITE, D3D11_MAP_FLAG_DO_NOT_WAIT, &MappedSlot);
+	if (ResultHandle == DXGI_ERROR_WAS_STILL_DRAWING)
+	{
+		return;
+	}
+
+	CHECK_HRESULT_EXCEPTION(ResultHandle)
+
+	std::lock_guard Lock(Mutex);
+	OpenIndex = NextIndex;
+	OpenOffset = 0u;
+	Mapped = static_cast<std::byte*>(MappedSlot.pData);
+}
+
+size_t UploadManager::CloseSlot(std::vector<Callback>& OutUploaded)
+{
+	std::vector<Copy> Copies;
+	{
+		std::unique_lock Lock(Mutex);
+
+		if (!Mapped)
+		{
+			return 0u;
+		}
+
+		// No new writer gets a range from here on.
+		Mapped = nullptr;
+		WritersDone.wait(Lock, [this] { return WriterNum == 0u; });
+		Copies.swap(Slots[OpenIndex].Copies);
+	}
+
+	auto* const Source = Slots[OpenIndex].Buffer.Get();
+	Context->Unmap(Source, 0u);
+
+	size_t CopiedBytes = 0u;
+	for (auto& [Destination, DestinationOffset, SourceOffset, Size, OnUploaded] : Copies)
+	{
+		const D3D11_BOX SourceBox {SourceOffset, 0u, 0u, SourceOffset + Size, 1u, 1u};
+		Context->CopySubresourceRegion(Destination, 0u, DestinationOffset, 0u, 0u, Source, 0u, &SourceBox);
+		CopiedBytes += Size;
+
+		if (OnUploaded)
+		{
+			OutUploaded.push_back(std::move(OnUploaded));
+		}
+	}
+
+	return CopiedBytes;
+}
+
+void UploadManager::UnmapTextures()
+{
+	// Whatever was handed back has been written, streamed textures waiting for budget are unmapped meanwhile too.
+	const auto Unmap = [this](PendingUpload& InOutUpload)
+	{
+		for (UINT Level = 0u; Level < InOutUpload.MappedLevelNum; ++Level)
+		{
+			Context->Unmap(InOutUpload.Staging.Get(), Level);
+		}
+
+		InOutUpload.MappedLevelNum = 0u;
+	};
+
+	std::for_each(Needed.begin(), Needed.end(), Unmap);
+	std::for_each(Streamed.begin(), Streamed.end(), Unmap);
+
+	for (const auto& [Staging, Levels] : Discarded)
+	{
+		for (UINT Level = 0u; Level < Levels.size(); ++Level)
+		{
+			Context->Unmap(Staging.Get(), Level);
+		}
+	}
+
+	Discarded.clear();
+}
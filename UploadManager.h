@@ -0,0 +1,145 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <d3d11.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "wrl/client.h"
+
+/**
+ * Moves data into default usage resources from any thread without the caller waiting on the immediate context.
+ * Buffer data is written straight into a staging buffer that stays mapped for the frame, one of a small ring so the GPU
+ * can still be copying out of the previous ones. Textures arrive as staging textures the caller created with their data on
+ * the free-threaded device, or mapped by MapTexture on the main thread for a worker to decode straight into, which saves
+ * the copy of a decoded image into the texture. Flush, once per frame on the main thread, issues the copies into place.
+ * Uploads without a callback are needed by the next draws and always go in the next Flush. Streamed ones report through
+ * their callback and are copied oldest first under a byte budget per frame, so a burst of them is spread over frames.
+ */
+class UploadManager
+{
+public:
+	// Runs on the main thread in Flush, once the copy into the destination is issued.
+	using Callback = std::function<void()>;
+
+	struct Statistics
+	{
+		// In the last Flush.
+		size_t CopiedBytes {0u};
+		size_t PendingBytes {0u};
+		unsigned int PendingNum {0u};
+		// Since startup, uploads that went through UpdateSubresource because the ring had no room for them.
+		unsigned int OverflowNum {0u};
+	};
+
+	// A staging texture whose every level stays mapped until it is handed back.
+	struct MappedTexture
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Staging;
+		// One per level, its rows RowPitch bytes apart. Readable too, so a level can be filtered from the one above it.
+		std::vector<D3D11_MAPPED_SUBRESOURCE> Levels;
+	};
+
+	static constexpr UINT SlotBytes {8u << 20u};
+	// One being written, the others still being copied from by the frames in flight.
+	static constexpr unsigned int SlotNum {3u};
+
+	UploadManager(ID3D11Device* InDevice, ID3D11DeviceContext* InContext, size_t InBudgetBytes = 16u * 1024u * 1024u);
+	UploadManager(const UploadManager&) = delete;
+	UploadManager(UploadManager&&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+	UploadManager& operator=(UploadManager&&) = delete;
+	~UploadManager();
+
+	// InData is copied before the call returns.
+	void UploadBuffer(ID3D11Buffer* InDestination, UINT InByteOffset, const void* InData, UINT InSize, Callback InOnUploaded = {});
+	// Every subresource of the staging texture goes to the same one of the destination, which matches it in size and format.
+	// InByteSize is what the copy counts against the budget.
+	void UploadTexture(Microsoft::WRL::ComPtr<ID3D11Texture2D> InDestination, Microsoft::WRL::ComPtr<ID3D11Texture2D> InStaging,
+	                   size_t InByteSize, Callback InOnUploaded = {});
+	// Main thread only. Of InDesc's size, format and levels, the rest of the description is the staging one's.
+	[[nodiscard]] MappedTexture MapTexture(const D3D11_TEXTURE2D_DESC& InDesc);
+	// From any thread once the levels are written, they are unmapped in the next Flush.
+	void UploadTexture(Microsoft::WRL::ComPtr<ID3D11Texture2D> InDestination, MappedTexture InMapped, size_t InByteSize, Callback InOnUploaded = {});
+	// A mapped texture there turned out to be nothing to upload from.
+	void DiscardTexture(MappedTexture InMapped);
+
+	// Main thread, before anything draws from what was uploaded since the last call.
+	void Flush();
+
+	void SetBudget(const size_t InBudgetBytes) noexcept
+	{
+		BudgetBytes = InBudgetBytes;
+	}
+
+	[[nodiscard]] size_t GetBudget() const noexcept
+	{
+		return BudgetBytes;
+	}
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+private:
+	struct Copy
+	{
+		ID3D11Buffer* Destination;
+		UINT DestinationOffset;
+		UINT SourceOffset;
+		UINT Size;
+		Callback OnUploaded;
+	};
+
+	struct Slot
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		std::vector<Copy> Copies;
+	};
+
+	// Buffer data waiting for room in the ring or for budget, or a texture waiting for budget.
+	struct PendingUpload
+	{
+		ID3D11Buffer* Destination {nullptr};
+		UINT DestinationOffset {0u};
+		std::vector<std::byte> Data;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Staging;
+		size_t ByteSize {0u};
+		Callback OnUploaded;
+		// Levels of the staging texture still mapped.
+		UINT MappedLevelNum {0u};
+	};
+
+	// Copies into the open slot, false without touching the callback when it has no room.
+	bool WriteToSlot(ID3D11Buffer* InDestination, UINT InByteOffset, const void* InData, UINT InSize, Callback& InOutOnUploaded);
+	// Maps the next slot unless the GPU is still copying out of it, then uploads wait in the queues for another frame.
+	void OpenSlot();
+	// Waits for writers still copying into the open slot, unmaps it and issues its copies.
+	size_t CloseSlot(std::vector<Callback>& OutUploaded);
+	// With the mutex held, on the main thread.
+	void UnmapTextures();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> Device;
+	ID3D11DeviceContext* Context;
+	size_t BudgetBytes;
+	std::array<Slot, SlotNum> Slots;
+
+	std::mutex Mutex;
+	std::condition_variable WritersDone;
+	// Null while no slot is mapped.
+	std::byte* Mapped {nullptr};
+	unsigned int OpenIndex {0u};
+	UINT OpenOffset {0u};
+	unsigned int WriterNum {0u};
+	std::deque<PendingUpload> Needed;
+	std::deque<PendingUpload> Streamed;
+	std::vector<MappedTexture> Discarded;
+
+	Statistics LastStatistics {};
+};
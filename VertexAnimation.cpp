@@ -0,0 +1,219 @@
+﻿#include "VertexAnimation.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include "AnimationClip.h"
+#include "DrawPacket.h"
+#include "ExceptionMacros.h"
+#include "Logger.h"
+#include "Mesh.h"
+
+VertexAnimation::Frames VertexAnimation::SampleSkin(const MeshCache::MeshEntry& InMesh, const std::span<const AnimationClip> InClips,
+                                                    const NodeHierarchy& InBindPose, const unsigned int InMeshNode)
+{
+	using namespace DirectX;
+	using ElementType = DV::VertexLayout::ElementType;
+
+	Frames Sampled;
+	const auto Stride = InMesh.Layout.Size();
+	const auto VertexNum = static_cast<UINT>(Stride ? InMesh.VertexBytes / Stride : 0u);
+
+	if (VertexNum == 0u || InMesh.Bones.empty())
+	{
+		return Sampled;
+	}
+
+	const auto* const Vertices = static_cast<const char*>(InMesh.Vertices);
+	const auto PositionOffset = InMesh.Layout.Resolve<ElementType::Position3D>().GetByteOffset();
+	const auto IndexOffset = InMesh.Layout.Resolve<ElementType::BoneIndices>().GetByteOffset();
+	const auto WeightOffset = InMesh.Layout.Resolve<ElementType::BoneWeights>().GetByteOffset();
+	const auto MaxFrameNum = static_cast<size_t>(TextureWidth) * MaxTextureHeight / (2u * VertexNum);
+
+	// The node stays where it is imported while the GPU plays the clips, so the bones are taken into its space at rest.
+	auto RestPose = InBindPose;
+	RestPose.UpdateWorldTransforms();
+	const auto WorldToMesh = XMMatrixInverse(nullptr, RestPose.GetWorldTransform(InMeshNode));
+
+	std::vector<XMFLOAT4X4> Bones(InMesh.Bones.size());
+	auto Minimum = XMVectorReplicate(std::numeric_limits<float>::max());
+	auto Maximum = XMVectorReplicate(-std::numeric_limits<float>::max());
+	UINT FrameNum = 0u;
+
+	for (const auto& Played : InClips)
+	{
+		if (Sampled.Table.ClipNum == MaxClipNum)
+		{
+			LOG_WARNING("'{}' has more than {} animations, only the first are baked", InMesh.Name, MaxClipNum);
+			break;
+		}
+
+		const auto Duration = Played.GetDuration();
+		const auto ClipFrameNum = Duration > 0.0f ? static_cast<UINT>(std::ceil(Duration * FrameRate)) + 1u : 1u;
+
+		if (FrameNum + ClipFrameNum > MaxFrameNum)
+		{
+			LOG_WARNING("The vertex animation of '{}' only holds its first {} animations", InMesh.Name, Sampled.Table.ClipNum);
+			break;
+		}
+
+		Sampled.Table.Clips[Sampled.Table.ClipNum++] = {FrameNum, ClipFrameNum, Duration, 0u};
+		Sampled.Texels.reserve(Sampled.Texels.size() + static_cast<size_t>(ClipFrameNum) * VertexNum * 2u);
+		// Nodes the clip has no channels for stay as imported rather than where the previous clip left them.
+		auto Pose = InBindPose;
+		std::vector<unsigned int> Cursors(Played.GetCursorNum(), 0u);
+
+		for (UINT Frame = 0u; Frame < ClipFrameNum; ++Frame)
+		{
+			Played.Sample(std::min(static_cast<float>(Frame) / FrameRate, Duration), Cursors, Pose);
+			Pose.UpdateWorldTransforms();
+
+			for (size_t Index = 0u; Index < Bones.size(); ++Index)
+			{
+				const auto& [Node, Offset] = InMesh.Bones[Index];
+				XMStoreFloat4x4(&Bones[Index], XMLoadFloat4x4(&Offset) * Pose.GetWorldTransform(Node) * WorldToMesh);
+			}
+
+			for (UINT Vertex = 0u; Vertex < VertexNum; ++Vertex)
+			{
+				const auto* const Source = Vertices + static_cast<size_t>(Vertex) * Stride;
+				const auto& Indices = *reinterpret_cast<const PackedVector::XMUBYTE4*>(Source + IndexOffset);
+				XMFLOAT4 Weights;
+				XMStoreFloat4(&Weights, PackedVector::XMLoadUByteN4(reinterpret_cast<const PackedVector::XMUBYTEN4*>(Source + WeightOffset)));
+
+				// Blended the way Skinning.hlsli blends the palette, influences of no weight add nothing.
+				XMMATRIX Skin(XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero());
+				const std::array<std::pair<uint8_t, float>, 4> Influences {{{Indices.x, Weights.x}, {Indices.y, Weights.y}, {Indices.z, Weights.z},
+				                                                            {Indices.w, Weights.w}}};
+
+				for (const auto& [Bone, Weight] : Influences)
+				{
+					if (Weight > 0.0f && Bone < Bones.size())
+					{
+						const auto Palette = XMLoadFloat4x4(&Bones[Bone]);
+
+						for (size_t Row = 0u; Row < 4u; ++Row)
+						{
+							Skin.r[Row] = XMVectorMultiplyAdd(Palette.r[Row], XMVectorReplicate(Weight), Skin.r[Row]);
+						}
+					}
+				}
+
+				const auto Position = XMVector3Transform(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(Source + PositionOffset)), Skin);
+				XMVECTOR Scale;
+				XMVECTOR Rotation;
+				XMVECTOR Translation;
+
+				if (!XMMatrixDecompose(&Scale, &Rotation, &Translation, Skin))
+				{
+					Rotation = XMQuaternionIdentity();
+				}
+
+				Minimum = XMVectorMin(Minimum, Position);
+				Maximum = XMVectorMax(Maximum, Position);
+
+				PackedVector::XMHALF4 Texels[2];
+				PackedVector::XMStoreHalf4(&Texels[0], XMVectorSetW(Position, 0.0f));
+				PackedVector::XMStoreHalf4(&Texels[1], Rotation);
+				Sampled.Texels.insert(Sampled.Texels.end(), std::begin(Texels), std::end(Texels));
+			}
+		}
+
+		FrameNum += ClipFrameNum;
+	}
+
+	if (Sampled.Table.ClipNum == 0u)
+	{
+		Sampled.Texels.clear();
+		return Sampled;
+	}
+
+	Sampled.Texels.resize((Sampled.Texels.size() + TextureWidth - 1u) / TextureWidth * TextureWidth, {});
+	Sampled.Table.VertexNum = VertexNum;
+	Sampled.Table.Width = TextureWidth;
+	Sampled.Table.Rate = FrameRate;
+	BoundingBox::CreateFromPoints(Sampled.Bounds, Minimum, Maximum);
+
+	return Sampled;
+}
+
+UINT VertexAnimation::Pack(const unsigned int InClip, const float InTimeOffset) noexcept
+{
+	return std::min(InClip, 0xFFFFu) | static_cast<UINT>(DirectX::PackedVector::XMConvertFloatToHalf(InTimeOffset)) << 16u;
+}
+
+VertexAnimation::VertexAnimation(const Graphics& InGraphics, const Frames& InFrames)
+	: ClipNum(InFrames.Table.ClipNum)
+	, Bounds(InFrames.Bounds)
+{
+	assert(ClipNum > 0u && !InFrames.Texels.empty() && InFrames.Texels.size() % TextureWidth == 0u && "Vertex animations need whole rows of at least one clip");
+
+	HRESULT ResultHandle;
+
+	D3D11_TEXTURE2D_DESC TextureDesc {};
+	TextureDesc.Width = TextureWidth;
+	TextureDesc.Height = static_cast<UINT>(InFrames.Texels.size() / TextureWidth);
+	TextureDesc.MipLevels = 1u;
+	TextureDesc.ArraySize = 1u;
+	TextureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	TextureDesc.SampleDesc.Count = 1u;
+	TextureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	TextureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA TextureData {};
+	TextureData.pSysMem = InFrames.Texels.data();
+	TextureData.SysMemPitch = TextureWidth * sizeof(DirectX::PackedVector::XMHALF4);
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateTexture2D
+	(
+		&TextureDesc,
+		&TextureData,
+		&Texture
+	))
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateShaderResourceView
+	(
+		Texture.Get(),
+		nullptr,
+		&MyFrameView
+	))
+
+	D3D11_BUFFER_DESC BufferDesc {};
+	BufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	BufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	BufferDesc.ByteWidth = sizeof(Constants);
+
+	D3D11_SUBRESOURCE_DATA BufferData {};
+	BufferData.pSysMem = &InFrames.Table;
+
+	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer
+	(
+		&BufferDesc,
+		&BufferData,
+		&MyClipBuffer
+	))
+
+	ByteSize = InFrames.Texels.size() * sizeof(DirectX::PackedVector::XMHALF4) + sizeof(Constants);
+}
+
+void VertexAnimation::Bind(RenderContext& InContext) noexcept
+{
+	auto& Cache = GetStateCache(InContext);
+	Cache.SetVertexShaderResource(FrameSlot, MyFrameView.Get());
+	Cache.SetVertexConstantBuffer(ClipSlot, MyClipBuffer.Get());
+}
+
+bool VertexAnimation::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.AddVertexShaderResource(FrameSlot, MyFrameView.Get());
+	InOutPacket.AddVertexConstantBuffer(ClipSlot, MyClipBuffer.Get());
+	return true;
+}
+
+size_t VertexAnimation::GetGpuByteSize() const noexcept
+{
+	return ByteSize;
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+#include <DirectXCollision.h>
+#include <DirectXPackedVector.h>
+#include <span>
+#include <vector>
+#include "Bindable.h"
+#include "MeshCache.h"
+
+class AnimationClip;
+class NodeHierarchy;
+
+/**
+ * The animations of one skinned mesh baked into a half-float texture at import, so instances play them without bones or any CPU
+ * work and are instanced like static meshes. Every frame holds two texels per vertex, where the vertex is in the space of the node
+ * the mesh hangs off and the rotation its bones turn it by as a quaternion, which turns the normal and the tangent frame alike.
+ * Shared by every instance of the mesh, each instance picks its clip and time offset with Pack and the shaders loop it on the frame time.
+ */
+class VertexAnimation : public Bindable
+{
+public:
+	static constexpr UINT FrameSlot {2u};
+	static constexpr UINT ClipSlot {2u};
+	// A model with more bakes the first ones.
+	static constexpr UINT MaxClipNum {32u};
+	static constexpr float FrameRate {30.0f};
+	static constexpr UINT TextureWidth {4096u};
+	// Caps a mesh's frames at 64 MB, clips that don't fit any more are left out.
+	static constexpr UINT MaxTextureHeight {2048u};
+
+	// Laid out like VertexAnimationClip in VertexAnimation.hlsli.
+	struct Clip
+	{
+		UINT FirstFrame;
+		UINT FrameNum;
+		float Duration;
+		UINT Padding;
+	};
+
+	// Laid out like the VertexAnimationClips cbuffer.
+	struct Constants
+	{
+		Clip Clips[MaxClipNum];
+		UINT VertexNum;
+		UINT ClipNum;
+		UINT Width;
+		float Rate;
+	};
+
+	// What a bake sampled, before anything is created on the device.
+	struct Frames
+	{
+		// Rows of TextureWidth, the last one padded.
+		std::vector<DirectX::PackedVector::XMHALF4> Texels;
+		Constants Table {};
+		// Around the vertices in every frame, in the space of the node the mesh hangs off.
+		DirectX::BoundingBox Bounds;
+	};
+
+	// Skins InMesh through every clip at FrameRate on the calling thread. Each clip is sampled from a copy of InBindPose, where the node
+	// InMeshNode holds the mesh as it is drawn. No clip is baked when even the first doesn't fit.
+	[[nodiscard]] static Frames SampleSkin(const MeshCache::MeshEntry& InMesh, std::span<const AnimationClip> InClips, const NodeHierarchy& InBindPose,
+	                                       unsigned int InMeshNode);
+	// What Drawable::GetPlayedAnimation reports: InClip in the low half, the seconds the instance plays ahead as a half float in the high one.
+	// Clips the mesh doesn't have play its last.
+	[[nodiscard]] static UINT Pack(unsigned int InClip, float InTimeOffset) noexcept;
+
+	VertexAnimation(const Graphics& InGraphics, const Frames& InFrames);
+
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+
+	[[nodiscard]] UINT GetClipNum() const noexcept
+	{
+		return ClipNum;
+	}
+
+	[[nodiscard]] const DirectX::BoundingBox& GetBounds() const noexcept
+	{
+		return Bounds;
+	}
+
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+private:
+	UINT ClipNum;
+	DirectX::BoundingBox Bounds;
+	size_t ByteSize;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> MyFrameView;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> MyClipBuffer;
+};
@@ -0,0 +1,68 @@
+// Baked skinning, shared by the shading and depth-only vertex shaders so both move a vertex exactly alike.
+// Laid out like VertexAnimation: two texels per vertex per frame, each clip's frames back to back and the rows wrapped at TextureWidth.
+// The first holds where the vertex is in the space of the node the mesh hangs off, the second the rotation its bones turn it by.
+Texture2D<float4> VertexAnimationFrames : register(t2);
+
+struct VertexAnimationClip
+{
+    uint FirstFrame;
+    uint FrameNum;
+    // In seconds, zero for a clip of one frame.
+    float Duration;
+    uint Padding;
+};
+
+cbuffer VertexAnimationClips : register(b2)
+{
+    VertexAnimationClip AnimationClips[32];
+    uint AnimatedVertexNum;
+    uint AnimationClipNum;
+    uint TextureWidth;
+    float AnimationFrameRate;
+};
+
+struct AnimatedVertex
+{
+    float3 Position;
+    float4 Rotation;
+};
+
+float4 LoadAnimationTexel(const uint InTexel)
+{
+    return VertexAnimationFrames.Load(int3(InTexel % TextureWidth, InTexel / TextureWidth, 0));
+}
+
+// Turns InVector by the unit quaternion InRotation, as q v q* does.
+float3 RotateByQuaternion(const float3 InVector, const float4 InRotation)
+{
+    const float3 Twice = 2.0f * cross(InRotation.xyz, InVector);
+    return InVector + InRotation.w * Twice + cross(InRotation.xyz, Twice);
+}
+
+// InAnimation as VertexAnimation::Pack packs it, the clip in the low half and the seconds it plays ahead of the frame time as a half float in the
+// high one. Clips loop. SV_VertexID of an indexed draw is the index itself, the buffer's base vertex isn't added.
+AnimatedVertex SampleVertexAnimation(const uint InVertexID, const uint InAnimation)
+{
+    const VertexAnimationClip Clip = AnimationClips[min(InAnimation & 0xFFFFu, AnimationClipNum - 1u)];
+    const float Offset = f16tof32(InAnimation >> 16u);
+
+    float ClipTime = Clip.Duration > 0.0f ? fmod(Time + Offset, Clip.Duration) : 0.0f;
+    ClipTime += ClipTime < 0.0f ? Clip.Duration : 0.0f;
+
+    const float Frame = min(ClipTime * AnimationFrameRate, (float) (Clip.FrameNum - 1u));
+    const uint FirstFrame = (uint) Frame;
+    const uint SecondFrame = min(FirstFrame + 1u, Clip.FrameNum - 1u);
+    const float Weight = Frame - (float) FirstFrame;
+    const uint FirstTexel = ((Clip.FirstFrame + FirstFrame) * AnimatedVertexNum + InVertexID) * 2u;
+    const uint SecondTexel = ((Clip.FirstFrame + SecondFrame) * AnimatedVertexNum + InVertexID) * 2u;
+
+    const float4 FirstRotation = LoadAnimationTexel(FirstTexel + 1u);
+    float4 SecondRotation = LoadAnimationTexel(SecondTexel + 1u);
+    // Either sign is the same rotation, blending across them would pass through none.
+    SecondRotation = dot(FirstRotation, SecondRotation) < 0.0f ? -SecondRotation : SecondRotation;
+
+    AnimatedVertex Animated;
+    Animated.Position = lerp(LoadAnimationTexel(FirstTexel).xyz, LoadAnimationTexel(SecondTexel).xyz, Weight);
+    Animated.Rotation = normalize(lerp(FirstRotation, SecondRotation, Weight));
+    return Animated;
+}
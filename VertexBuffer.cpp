@@ -1,62 +1,82 @@
 ﻿#include "VertexBuffer.h"
 #include "BindManager.h"
-#include "ExceptionMacros.h"
+#include "DrawPacket.h"
 
 VertexBuffer::VertexBuffer(const Graphics& InGraphics, const DV::VertexBuffer& InVertices)
-	: VertexBuffer(InGraphics, "?", InVertices)
+	: VertexBuffer(InGraphics, StringAtom("?"), InVertices)
 {
 }
 
-VertexBuffer::VertexBuffer(const Graphics& InGraphics, const std::string& InTag, const DV::VertexBuffer& InVertices)
+VertexBuffer::VertexBuffer(const Graphics& InGraphics, const StringAtom InTag, const DV::VertexBuffer& InVertices)
+	: VertexBuffer(InGraphics, InTag, InVertices.GetLayout(), InVertices.GetData(), InVertices.Size())
+{
+}
+
+VertexBuffer::VertexBuffer(const Graphics& InGraphics, const StringAtom InTag, const DV::VertexLayout& InLayout,
+                           const void* InVertices, const size_t InSize)
 	: Tag(InTag)
-	, Stride(static_cast<UINT>(InVertices.GetLayout().Size()))
+	, PositionStride(static_cast<UINT>(InLayout.GetStreamStride(DV::VertexLayout::PositionStream)))
+	, AttributeStride(static_cast<UINT>(InLayout.GetStreamStride(DV::VertexLayout::AttributeStream)))
+	, Pool(InGraphics.GetGeometryPool())
+	, MyAllocation(Pool.AllocateVertices(InLayout, InVertices, InSize))
 {
-	HRESULT ResultHandle;
+}
 
-	D3D11_BUFFER_DESC VertexBufferDesc {};
-	VertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	VertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	VertexBufferDesc.CPUAccessFlags = 0u;
-	VertexBufferDesc.MiscFlags = 0u;
-	VertexBufferDesc.ByteWidth = static_cast<UINT>(InVertices.Size());
-	VertexBufferDesc.StructureByteStride = Stride;
+VertexBuffer::VertexBuffer(const Graphics& InGraphics, const StringAtom InTag, const DV::VertexLayout& InLayout)
+	: Tag(InTag)
+	, PositionStride(static_cast<UINT>(InLayout.GetStreamStride(DV::VertexLayout::PositionStream)))
+	, AttributeStride(static_cast<UINT>(InLayout.GetStreamStride(DV::VertexLayout::AttributeStream)))
+	, Pool(InGraphics.GetGeometryPool())
+{
+}
 
-	D3D11_SUBRESOURCE_DATA SubresourceData = {};
-	SubresourceData.pSysMem = InVertices.GetData();
+VertexBuffer::~VertexBuffer()
+{
+	Pool.Free(MyAllocation);
+}
 
-	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateBuffer
-	(
-		&VertexBufferDesc,
-		&SubresourceData,
-		&MyVertexBuffer
-	))
+void VertexBuffer::Bind(RenderContext& InContext) noexcept
+{
+	// Every buffer in the page binds the same way, the state cache skips the calls between them.
+	GetStateCache(InContext).SetVertexBuffer(DV::VertexLayout::PositionStream, MyAllocation.Buffer, PositionStride);
+	GetStateCache(InContext).SetVertexBuffer(DV::VertexLayout::AttributeStream, MyAllocation.AttributeBuffer, AttributeStride);
 }
 
-void VertexBuffer::Bind(const Graphics& InGraphics) noexcept
+bool VertexBuffer::Bake(DrawPacket& InOutPacket) const noexcept
 {
-	constexpr UINT Offset = 0u;
+	InOutPacket.VertexBuffers = {MyAllocation.Buffer, MyAllocation.AttributeBuffer};
+	InOutPacket.VertexStrides = {PositionStride, AttributeStride};
+	return true;
+}
 
-	GetContext(InGraphics)->IASetVertexBuffers
-	(
-		0u,
-		1u,
-		MyVertexBuffer.GetAddressOf(),
-		&Stride,
-		&Offset
-	);
+size_t VertexBuffer::GetGpuByteSize() const noexcept
+{
+	return static_cast<size_t>(MyAllocation.Num) * (PositionStride + AttributeStride);
+}
+
+INT VertexBuffer::GetBaseVertex() const noexcept
+{
+	return static_cast<INT>(MyAllocation.Offset);
 }
 
 std::shared_ptr<VertexBuffer> VertexBuffer::Resolve(const Graphics& InGraphics, const std::string& InTag,
                                                     const DV::VertexBuffer& InVertices)
 {
 	assert(InTag != "?");
-	return BindManager::Resolve<VertexBuffer>(InGraphics, InTag, InVertices);
+	return BindManager::Resolve<VertexBuffer>(InGraphics, StringAtom(InTag), InVertices);
+}
+
+std::shared_ptr<VertexBuffer> VertexBuffer::Resolve(const Graphics& InGraphics, const std::string& InTag, const DV::VertexLayout& InLayout,
+                                                    const void* InVertices, const size_t InSize)
+{
+	assert(InTag != "?");
+	return BindManager::Resolve<VertexBuffer>(InGraphics, StringAtom(InTag), InLayout, InVertices, InSize);
 }
 
-std::string VertexBuffer::GenerateUniqueIDImpl(const std::string& InTag)
+std::string VertexBuffer::GenerateUniqueIDImpl(const StringAtom InTag)
 {
 	using namespace std::string_literals;
-	return typeid(VertexBuffer).name() + "#"s + InTag;
+	return typeid(VertexBuffer).name() + "#"s + std::string(InTag.GetString());
 }
 
 std::string VertexBuffer::GetUniqueID() const noexcept
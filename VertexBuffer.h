@@ -1,31 +1,56 @@
 ﻿#pragma once
 #include <memory>
+#include "BindKey.h"
 #include "Bindable.h"
 #include "DynamicVertex.h"
+#include "GeometryPool.h"
+#include "StringAtom.h"
 
 class VertexBuffer : public Bindable
 {
 public:
 	VertexBuffer(const Graphics& InGraphics, const DV::VertexBuffer& InVertices);
-	VertexBuffer(const Graphics& InGraphics, const std::string& InTag,  const DV::VertexBuffer& InVertices);
+	VertexBuffer(const Graphics& InGraphics, StringAtom InTag,  const DV::VertexBuffer& InVertices);
+	VertexBuffer(const Graphics& InGraphics, StringAtom InTag, const DV::VertexLayout& InLayout, const void* InVertices, size_t InSize);
+	~VertexBuffer() override;
 
-	void Bind(const Graphics& InGraphics) noexcept override;
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
+	// Where the vertices start in the shared page, passed to the draw as the base vertex.
+	[[nodiscard]] INT GetBaseVertex() const noexcept;
 
 	[[nodiscard]] static std::shared_ptr<VertexBuffer> Resolve(const Graphics& InGraphics, const std::string& InTag, const DV::VertexBuffer& InVertices);
+	[[nodiscard]] static std::shared_ptr<VertexBuffer> Resolve(const Graphics& InGraphics, const std::string& InTag, const DV::VertexLayout& InLayout,
+	                                                           const void* InVertices, size_t InSize);
 
 	template<typename... IgnoredParams>
-	[[nodiscard]] static std::string GenerateUniqueID(const std::string& InTag, IgnoredParams&&... InIgnoredParams)
+	[[nodiscard]] static std::string GenerateUniqueID(StringAtom InTag, IgnoredParams&&... InIgnoredParams)
 	{
 		return GenerateUniqueIDImpl(InTag);
 	}
 
+	template<typename... IgnoredParams>
+	[[nodiscard]] static BindKey GenerateKey(StringAtom InTag, IgnoredParams&&... InIgnoredParams)
+	{
+		return BindKey::Make<VertexBuffer>(InTag);
+	}
+
 	[[nodiscard]] std::string GetUniqueID() const noexcept override;
+	// The range this buffer holds in the shared page, the pages themselves are the geometry pool's.
+	[[nodiscard]] size_t GetGpuByteSize() const noexcept override;
+
+protected:
+	// For buffers owning their storage such as DynamicVertexBuffer, which leave the allocation empty for the pool and fill it in themselves.
+	VertexBuffer(const Graphics& InGraphics, StringAtom InTag, const DV::VertexLayout& InLayout);
 
 private:
-	[[nodiscard]] static std::string GenerateUniqueIDImpl(const std::string& InTag);
+	[[nodiscard]] static std::string GenerateUniqueIDImpl(StringAtom InTag);
 
 protected:
-	std::string Tag;
-	UINT Stride;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> MyVertexBuffer;
+	StringAtom Tag;
+	// Of the position and the attribute streams, zero for a stream the layout has no elements in.
+	UINT PositionStride;
+	UINT AttributeStride;
+	GeometryPool& Pool;
+	GeometryPool::Allocation MyAllocation;
 };
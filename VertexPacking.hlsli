@@ -0,0 +1,17 @@
+// Decoders for the compact vertex elements written by DynamicVertex.h.
+
+// Inverse of DV::EncodeOctahedralNormal.
+float3 DecodeOctahedralNormal(const float2 InEncoded)
+{
+    float3 Normal = float3(InEncoded, 1.0f - abs(InEncoded.x) - abs(InEncoded.y));
+    const float Fold = saturate(-Normal.z);
+    Normal.xy += Normal.xy >= 0.0f ? -Fold : Fold;
+    return normalize(Normal);
+}
+
+// Inverse of DV::EncodeTangentFrame, the bitangent is rebuilt from the normal and the stored handedness.
+void DecodeTangentFrame(const float4 InEncoded, const float3 InNormal, out float3 OutTangent, out float3 OutBitangent)
+{
+    OutTangent = InEncoded.xyz * 2.0f - 1.0f;
+    OutBitangent = cross(InNormal, OutTangent) * (InEncoded.w * 2.0f - 1.0f);
+}
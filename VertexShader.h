@@ -1,20 +1,47 @@
 ﻿#pragma once
+#include <string_view>
+#include "BindKey.h"
 #include "Bindable.h"
+#include "ShaderReflection.h"
 
 class VertexShader : public Bindable
 {
 public:
-	VertexShader(const Graphics& InGraphics, const std::string& InFileName);
+	// Features select a variant of a bundled uber shader, the file name is then the variant's bundle name.
+	VertexShader(const Graphics& InGraphics, std::string_view InFileName, unsigned int InFeatures = 0u);
 
-	void Bind(const Graphics& InGraphics) noexcept override;
+	void Bind(RenderContext& InContext) noexcept override;
+	bool Bake(DrawPacket& InOutPacket) const noexcept override;
 	[[nodiscard]] ID3DBlob* GetByteCode() const noexcept;
 
-	[[nodiscard]] static std::shared_ptr<VertexShader> Resolve(const Graphics& InGraphics, const std::string& InFileName);
-	[[nodiscard]] static std::string GenerateUniqueID(const std::string& InFileName);
+	[[nodiscard]] const std::string& GetFileName() const noexcept
+	{
+		return FileName;
+	}
+
+	[[nodiscard]] unsigned int GetFeatures() const noexcept
+	{
+		return Features;
+	}
+
+	[[nodiscard]] const ShaderReflection& GetReflection() const noexcept
+	{
+		return Reflection;
+	}
+
+	// Creates a replacement from recompiled bytecode, Swap puts it in place while nothing is recording.
+	[[nodiscard]] static Microsoft::WRL::ComPtr<ID3D11VertexShader> CreateShader(const Graphics& InGraphics, ID3DBlob* InByteCode);
+	void Swap(Microsoft::WRL::ComPtr<ID3D11VertexShader> InShader, Microsoft::WRL::ComPtr<ID3DBlob> InByteCode, ShaderReflection InReflection) noexcept;
+
+	[[nodiscard]] static std::shared_ptr<VertexShader> Resolve(const Graphics& InGraphics, std::string_view InFileName, unsigned int InFeatures = 0u);
+	[[nodiscard]] static std::string GenerateUniqueID(std::string_view InFileName, unsigned int InFeatures = 0u);
+	[[nodiscard]] static BindKey GenerateKey(std::string_view InFileName, unsigned int InFeatures = 0u);
 	[[nodiscard]] std::string GetUniqueID() const noexcept override;
 
 protected:
 	std::string FileName;
+	unsigned int Features;
 	Microsoft::WRL::ComPtr<ID3DBlob> ByteCodeBlob;
+	ShaderReflection Reflection;
 	Microsoft::WRL::ComPtr<ID3D11VertexShader> MyVertexShader;
 };
\ No newline at end of file
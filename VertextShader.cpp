@@ -1,32 +1,50 @@
-﻿#include <d3dcompiler.h>
-#include <memory>
+﻿#include <memory>
 #include "BindManager.h"
+#include "DrawPacket.h"
 #include "ExceptionMacros.h"
 #include "VertexShader.h"
 
-VertexShader::VertexShader(const Graphics& InGraphics, const std::string& InFileName)
-	: FileName(InFileName)
+VertexShader::VertexShader(const Graphics& InGraphics, const std::string_view InFileName, const unsigned int InFeatures)
+	: FileName(InFileName), Features(InFeatures)
+{
+	ByteCodeBlob = InGraphics.GetShaderBundle().Load(InFileName, InFeatures);
+	Reflection = ShaderReflection(ByteCodeBlob.Get());
+	MyVertexShader = CreateShader(InGraphics, ByteCodeBlob.Get());
+}
+
+Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader::CreateShader(const Graphics& InGraphics, ID3DBlob* InByteCode)
 {
 	HRESULT ResultHandle;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> Shader;
 
-	CHECK_HRESULT_EXCEPTION(D3DReadFileToBlob(std::wstring{InFileName.begin(), InFileName.end()}.c_str(), &ByteCodeBlob))
 	CHECK_HRESULT_EXCEPTION(GetDevice(InGraphics)->CreateVertexShader
 	(
-		ByteCodeBlob->GetBufferPointer(),
-		ByteCodeBlob->GetBufferSize(),
+		InByteCode->GetBufferPointer(),
+		InByteCode->GetBufferSize(),
 		nullptr,
-		&MyVertexShader
+		&Shader
 	))
+
+	return Shader;
 }
 
-void VertexShader::Bind(const Graphics& InGraphics) noexcept
+void VertexShader::Swap(Microsoft::WRL::ComPtr<ID3D11VertexShader> InShader, Microsoft::WRL::ComPtr<ID3DBlob> InByteCode, ShaderReflection InReflection) noexcept
 {
-	GetContext(InGraphics)->VSSetShader
-	(
-		MyVertexShader.Get(),
-		nullptr,
-		0u
-	);
+	MyVertexShader = std::move(InShader);
+	ByteCodeBlob = std::move(InByteCode);
+	Reflection = std::move(InReflection);
+	InvalidateBaked();
+}
+
+void VertexShader::Bind(RenderContext& InContext) noexcept
+{
+	GetStateCache(InContext).SetVertexShader(MyVertexShader.Get());
+}
+
+bool VertexShader::Bake(DrawPacket& InOutPacket) const noexcept
+{
+	InOutPacket.VertexShader = MyVertexShader.Get();
+	return true;
 }
 
 ID3DBlob* VertexShader::GetByteCode() const noexcept
@@ -34,18 +52,23 @@ ID3DBlob* VertexShader::GetByteCode() const noexcept
 	return ByteCodeBlob.Get();
 }
 
-std::shared_ptr<VertexShader> VertexShader::Resolve(const Graphics& InGraphics, const std::string& InFileName)
+std::shared_ptr<VertexShader> VertexShader::Resolve(const Graphics& InGraphics, const std::string_view InFileName, const unsigned int InFeatures)
 {
-	return BindManager::Resolve<VertexShader>(InGraphics, InFileName);
+	return BindManager::Resolve<VertexShader>(InGraphics, InFileName, InFeatures);
 }
 
-std::string VertexShader::GenerateUniqueID(const std::string& InFileName)
+std::string VertexShader::GenerateUniqueID(const std::string_view InFileName, const unsigned int InFeatures)
 {
 	using namespace std::string_literals;
-	return typeid(VertexShader).name() + "#"s + InFileName;
+	return typeid(VertexShader).name() + "#"s + std::string(InFileName) + "#"s + std::to_string(InFeatures);
+}
+
+BindKey VertexShader::GenerateKey(const std::string_view InFileName, const unsigned int InFeatures)
+{
+	return BindKey::Make<VertexShader>(InFileName, InFeatures);
 }
 
 std::string VertexShader::GetUniqueID() const noexcept
 {
-	return GenerateUniqueID(FileName);
+	return GenerateUniqueID(FileName, Features);
 }
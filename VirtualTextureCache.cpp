@@ -0,0 +1,735 @@
+﻿#include "VirtualTextureCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include "AllocationTracker.h"
+#include "Drawable.h"
+#include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "PixelShader.h"
+#include "TextureStreamer.h"
+
+struct VirtualTextureCache::Entry
+{
+	Texture* Owner;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Tiled;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> View;
+	// The finest level resident per tile of the finest level, what the material shaders clamp their samples to.
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> Residency;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ResidencyView;
+	std::vector<uint8_t> ResidentMips;
+	D3D11_TILE_SHAPE Shape {};
+	D3D11_PACKED_MIP_DESC PackedDesc {};
+	std::vector<D3D11_SUBRESOURCE_TILING> Tilings;
+	// Levels from here on are pinned, finer ones are paged.
+	UINT FloorMip {0u};
+	// Pool pages of the paged levels by key, and those of the pinned ones.
+	std::unordered_map<uint32_t, UINT> Pages;
+	std::vector<UINT> PinnedPages;
+	// Keys the last feedback found missing.
+	std::vector<uint32_t> Requested;
+	std::shared_ptr<Texture::PageLoad> Pending;
+	// Sampled through the tiled resource, once its pinned levels were read in.
+	bool bIsLive {false};
+	// Handed to the streamer, which the texture is unregistered from as well.
+	bool bIsStreamed {false};
+	bool bIsResidencyDirty {false};
+};
+
+namespace
+{
+	constexpr uint32_t MipShift {28u};
+	constexpr uint32_t XShift {14u};
+	constexpr uint32_t CoordinateMask {(1u << XShift) - 1u};
+	// Where nothing is drawn, materials are their ID plus one.
+	constexpr UINT NoMaterial {0u};
+
+	UINT GetKeyMip(const uint32_t InKey) noexcept
+	{
+		return InKey >> MipShift;
+	}
+
+	UINT GetKeyX(const uint32_t InKey) noexcept
+	{
+		return (InKey >> XShift) & CoordinateMask;
+	}
+
+	UINT GetKeyY(const uint32_t InKey) noexcept
+	{
+		return InKey & CoordinateMask;
+	}
+}
+
+VirtualTextureCache::VirtualTextureCache(ID3D11Device2* InDevice, ID3D11DeviceContext2* InContext, TextureStreamer& InStreamer,
+                                         const UINT InWidth, const UINT InHeight, const size_t InPoolBytes)
+	: Device(InDevice), Context(InContext), Streamer(InStreamer)
+{
+	HRESULT ResultHandle;
+
+	const auto PageNum = static_cast<UINT>(InPoolBytes / PageBytes);
+
+	D3D11_BUFFER_DESC PoolDesc {};
+	PoolDesc.ByteWidth = PageNum * static_cast<UINT>(PageBytes);
+	PoolDesc.Usage = D3D11_USAGE_DEFAULT;
+	PoolDesc.MiscFlags = D3D11_RESOURCE_MISC_TILE_POOL;
+	CHECK_HRESULT_EXCEPTION(Device->CreateBuffer(&PoolDesc, nullptr, &Pool))
+
+	Pages.resize(PageNum);
+	FreePages.reserve(PageNum);
+
+	// Popped from the back, so the pool fills from its start.
+	for (UINT Index = PageNum; Index > 0u; --Index)
+	{
+		FreePages.push_back(Index - 1u);
+	}
+
+	CreateTargets(InWidth, InHeight);
+}
+
+VirtualTextureCache::~VirtualTextureCache()
+{
+	JobSystem::Get().Wait(Jobs);
+}
+
+void VirtualTextureCache::Register(Texture& InTexture)
+{
+	std::lock_guard Lock(Mutex);
+
+	auto NewEntry = std::make_unique<Entry>();
+	NewEntry->Owner = &InTexture;
+	Entries.emplace(&InTexture, std::move(NewEntry));
+}
+
+void VirtualTextureCache::Unregister(Texture& InTexture)
+{
+	std::lock_guard Lock(Mutex);
+
+	const auto Found = Entries.find(&InTexture);
+	if (Found == Entries.end())
+	{
+		return;
+	}
+
+	auto& Unregistered = *Found->second;
+
+	// The read finishes into its own result and is dropped with it.
+	if (Unregistered.Pending)
+	{
+		IoService::Get().Cancel(Unregistered.Pending->Request);
+		--PendingNum;
+	}
+
+	if (Unregistered.bIsStreamed)
+	{
+		Streamer.Unregister(InTexture);
+	}
+
+	Release(Unregistered);
+	Entries.erase(Found);
+}
+
+void VirtualTextureCache::RegisterMaterial(const unsigned int InMaterialId, std::vector<Texture*> InTextures)
+{
+	std::lock_guard Lock(Mutex);
+	Materials[InMaterialId] = std::move(InTextures);
+}
+
+void VirtualTextureCache::UnregisterMaterial(const unsigned int InMaterialId)
+{
+	std::lock_guard Lock(Mutex);
+	Materials.erase(InMaterialId);
+}
+
+void VirtualTextureCache::AddCandidate(const Drawable& InDrawable, const PixelShader& InFeedbackShader)
+{
+	if (!bIsGathering)
+	{
+		return;
+	}
+
+	std::lock_guard Lock(Mutex);
+	Candidates.push_back({&InDrawable, &InFeedbackShader});
+}
+
+bool VirtualTextureCache::IsGatheringFeedback() const noexcept
+{
+	return bIsGathering && !Candidates.empty();
+}
+
+void VirtualTextureCache::RenderFeedback(const Graphics& InGraphics)
+{
+	if (!IsGatheringFeedback())
+	{
+		return;
+	}
+
+	PROFILE_GPU_SCOPE(InGraphics, "Virtual texture feedback");
+
+	auto& RenderContext = InGraphics.GetImmediateContext();
+	auto& Cache = RenderContext.GetStateCache();
+	auto* const DeviceContext = RenderContext.GetDeviceContext();
+
+	constexpr float ClearColor[] = {static_cast<float>(NoMaterial), 0.0f, 0.0f, 0.0f};
+	Cache.SetRenderTarget(FeedbackTargetView.Get(), FeedbackDepthView.Get());
+	DeviceContext->ClearRenderTargetView(FeedbackTargetView.Get(), ClearColor);
+	DeviceContext->ClearDepthStencilView(FeedbackDepthView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
+
+	// The scene's viewport at an eighth of the size, it doesn't start at the origin in the views of a split screen.
+	const auto& Viewport = InGraphics.GetViewport();
+	const D3D11_VIEWPORT FeedbackViewport
+	{
+		Viewport.TopLeftX / FeedbackScale, Viewport.TopLeftY / FeedbackScale,
+		std::max(1.0f, Viewport.Width / FeedbackScale), std::max(1.0f, Viewport.Height / FeedbackScale), 0.0f, 1.0f
+	};
+
+	DeviceContext->RSSetViewports(1u, &FeedbackViewport);
+	InGraphics.BindDepthTest(RenderContext, DepthTest::Less);
+
+	for (const auto& [Drawn, Shader] : Candidates)
+	{
+		// The shaded state for the material's texture coordinates and ID, the feedback shader writes nothing else.
+		Drawn->DrawWithPixelShader(RenderContext, Shader->GetShader(), DrawStage::Shaded);
+	}
+
+	auto& Pending = Readbacks[NextReadback];
+	DeviceContext->CopyResource(Pending.Staging.Get(), FeedbackTarget.Get());
+	Pending.Width = std::min(FeedbackWidth, static_cast<UINT>(FeedbackViewport.TopLeftX + FeedbackViewport.Width));
+	Pending.Height = std::min(FeedbackHeight, static_cast<UINT>(FeedbackViewport.TopLeftY + FeedbackViewport.Height));
+	Pending.bIsPending = true;
+	NextReadback = (NextReadback + 1u) % ReadbackNum;
+
+	InGraphics.BindFrameState(RenderContext);
+}
+
+void VirtualTextureCache::Update()
+{
+	PROFILE_SCOPE("VirtualTextureCache::Update");
+	ALLOCATION_SCOPE(Streaming);
+
+	std::lock_guard Lock(Mutex);
+	++FrameIndex;
+
+	for (auto& [Owner, Registered] : Entries)
+	{
+		if (Registered->bIsStreamed)
+		{
+			continue;
+		}
+
+		// The pinned levels are a whole file read each, a few at a time like the pages.
+		if (!Registered->Tiled)
+		{
+			if (PendingNum < MaxPendingNum)
+			{
+				Adopt(*Registered);
+			}
+		}
+		else if (ApplyLoad(*Registered))
+		{
+			--PendingNum;
+		}
+	}
+
+	ReadFeedback();
+	StartLoads();
+
+	for (auto& [Owner, Registered] : Entries)
+	{
+		if (Registered->bIsResidencyDirty)
+		{
+			Context->UpdateSubresource(Registered->Residency.Get(), 0u, nullptr, Registered->ResidentMips.data(), Registered->Tilings[0].WidthInTiles, 0u);
+			Registered->bIsResidencyDirty = false;
+		}
+	}
+
+	// Drawn into the readback that comes free next, the GPU is done with it once it was read.
+	Candidates.clear();
+	bIsGathering = !Materials.empty() && !Readbacks[NextReadback].bIsPending;
+
+	LastStatistics.TextureNum = static_cast<unsigned int>(Entries.size());
+	LastStatistics.PageNum = static_cast<unsigned int>(Pages.size());
+	LastStatistics.ResidentPageNum = static_cast<unsigned int>(Pages.size() - FreePages.size());
+	LastStatistics.PendingNum = PendingNum;
+}
+
+void VirtualTextureCache::Resize(const UINT InWidth, const UINT InHeight)
+{
+	// Feedback in flight was drawn at the old size, it is only missed for a few frames.
+	for (auto& Pending : Readbacks)
+	{
+		Pending.bIsPending = false;
+	}
+
+	CreateTargets(InWidth, InHeight);
+}
+
+uint32_t VirtualTextureCache::MakeKey(const UINT InMip, const UINT InX, const UINT InY) noexcept
+{
+	return (InMip << MipShift) | (InX << XShift) | InY;
+}
+
+void VirtualTextureCache::CreateTargets(const UINT InWidth, const UINT InHeight)
+{
+	HRESULT ResultHandle;
+
+	FeedbackWidth = std::max(1u, InWidth / FeedbackScale);
+	FeedbackHeight = std::max(1u, InHeight / FeedbackScale);
+
+	// The material in red and the texture coordinate and its footprint packed into green.
+	D3D11_TEXTURE2D_DESC TargetDesc {};
+	TargetDesc.Width = FeedbackWidth;
+	TargetDesc.Height = FeedbackHeight;
+	TargetDesc.MipLevels = 1u;
+	TargetDesc.ArraySize = 1u;
+	TargetDesc.Format = DXGI_FORMAT_R32G32_UINT;
+	TargetDesc.SampleDesc.Count = 1u;
+	TargetDesc.Usage = D3D11_USAGE_DEFAULT;
+	TargetDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&TargetDesc, nullptr, &FeedbackTarget))
+	CHECK_HRESULT_EXCEPTION(Device->CreateRenderTargetView(FeedbackTarget.Get(), nullptr, &FeedbackTargetView))
+
+	auto DepthDesc = TargetDesc;
+	DepthDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	DepthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> DepthTexture;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&DepthDesc, nullptr, &DepthTexture))
+	CHECK_HRESULT_EXCEPTION(Device->CreateDepthStencilView(DepthTexture.Get(), nullptr, &FeedbackDepthView))
+
+	auto StagingDesc = TargetDesc;
+	StagingDesc.Usage = D3D11_USAGE_STAGING;
+	StagingDesc.BindFlags = 0u;
+	StagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	for (auto& Pending : Readbacks)
+	{
+		CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&StagingDesc, nullptr, &Pending.Staging))
+	}
+}
+
+void VirtualTextureCache::Adopt(Entry& InEntry)
+{
+	HRESULT ResultHandle;
+
+	auto& Owner = *InEntry.Owner;
+
+	auto Desc = Owner.FullDesc;
+	Desc.Usage = D3D11_USAGE_DEFAULT;
+	Desc.MiscFlags = D3D11_RESOURCE_MISC_TILED;
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&Desc, nullptr, &InEntry.Tiled))
+
+	UINT TileNum = 0u;
+	UINT TilingNum = Desc.MipLevels;
+	InEntry.Tilings.resize(TilingNum);
+	Device->GetResourceTiling(InEntry.Tiled.Get(), &TileNum, &InEntry.PackedDesc, &InEntry.Shape, &TilingNum, 0u, InEntry.Tilings.data());
+
+	// Levels smaller than a tile share the packed ones, which can only be mapped whole.
+	InEntry.FloorMip = std::min(Owner.CoarsestMip, static_cast<UINT>(InEntry.PackedDesc.NumStandardMips));
+
+	// Nothing to page, or levels finer than the keys can address.
+	const auto& Finest = InEntry.Tilings[0];
+	if (InEntry.FloorMip == 0u || Finest.WidthInTiles > CoordinateMask || Finest.HeightInTiles > CoordinateMask)
+	{
+		InEntry.Tiled.Reset();
+		InEntry.bIsStreamed = true;
+		Streamer.Register(Owner);
+		return;
+	}
+
+	std::vector<D3D11_TILED_RESOURCE_COORDINATE> Coordinates;
+
+	for (UINT Mip = InEntry.FloorMip; Mip < InEntry.PackedDesc.NumStandardMips; ++Mip)
+	{
+		for (UINT Y = 0u; Y < InEntry.Tilings[Mip].HeightInTiles; ++Y)
+		{
+			for (UINT X = 0u; X < InEntry.Tilings[Mip].WidthInTiles; ++X)
+			{
+				Coordinates.push_back({X, Y, 0u, Mip});
+			}
+		}
+	}
+
+	// Addressed by their index from the first packed level on.
+	for (UINT Index = 0u; Index < InEntry.PackedDesc.NumTilesForPackedMips; ++Index)
+	{
+		Coordinates.push_back({Index, 0u, 0u, InEntry.PackedDesc.NumStandardMips});
+	}
+
+	for (const auto& Coordinate : Coordinates)
+	{
+		const auto Allocated = AllocatePage();
+
+		// Tried again next frame, once pages were needed longer ago.
+		if (Allocated == NoPage)
+		{
+			Release(InEntry);
+			InEntry.Tiled.Reset();
+			return;
+		}
+
+		Pages[Allocated] = {&InEntry, 0u, FrameIndex, true};
+		InEntry.PinnedPages.push_back(Allocated);
+		MapTile(InEntry, Coordinate, Allocated);
+	}
+
+	InEntry.ResidentMips.assign(static_cast<size_t>(Finest.WidthInTiles) * Finest.HeightInTiles, static_cast<uint8_t>(InEntry.FloorMip));
+
+	D3D11_TEXTURE2D_DESC ResidencyDesc {};
+	ResidencyDesc.Width = Finest.WidthInTiles;
+	ResidencyDesc.Height = Finest.HeightInTiles;
+	ResidencyDesc.MipLevels = 1u;
+	ResidencyDesc.ArraySize = 1u;
+	ResidencyDesc.Format = DXGI_FORMAT_R8_UINT;
+	ResidencyDesc.SampleDesc.Count = 1u;
+	ResidencyDesc.Usage = D3D11_USAGE_DEFAULT;
+	ResidencyDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	const D3D11_SUBRESOURCE_DATA ResidencyData {InEntry.ResidentMips.data(), Finest.WidthInTiles, 0u};
+	CHECK_HRESULT_EXCEPTION(Device->CreateTexture2D(&ResidencyDesc, &ResidencyData, &InEntry.Residency))
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(InEntry.Residency.Get(), nullptr, &InEntry.ResidencyView))
+	CHECK_HRESULT_EXCEPTION(Device->CreateShaderResourceView(InEntry.Tiled.Get(), nullptr, &InEntry.View))
+
+	// The pinned levels are read whole before the texture switches over, it keeps its coarse levels until then.
+	InEntry.Pending = std::make_shared<Texture::PageLoad>();
+	InEntry.Pending->TailMip = InEntry.FloorMip;
+	Owner.LoadPages(InEntry.Pending, InEntry.Shape.WidthInTexels, InEntry.Shape.HeightInTexels, IoPriority::Prefetch, Jobs);
+	++PendingNum;
+}
+
+void VirtualTextureCache::Reject(Entry& InEntry)
+{
+	Release(InEntry);
+	InEntry.Tiled.Reset();
+	InEntry.View.Reset();
+	InEntry.bIsStreamed = true;
+	Streamer.Register(*InEntry.Owner);
+}
+
+void VirtualTextureCache::Release(Entry& InEntry)
+{
+	for (const auto& [Key, Allocated] : InEntry.Pages)
+	{
+		Pages[Allocated] = {};
+		FreePages.push_back(Allocated);
+	}
+
+	for (const auto Allocated : InEntry.PinnedPages)
+	{
+		Pages[Allocated] = {};
+		FreePages.push_back(Allocated);
+	}
+
+	InEntry.Pages.clear();
+	InEntry.PinnedPages.clear();
+}
+
+void VirtualTextureCache::ReadFeedback()
+{
+	std::vector<uint64_t> Samples;
+
+	// Oldest first like the object picker's, the first one the GPU hasn't finished holds up the others.
+	for (unsigned int Offset = 0u; Offset < ReadbackNum; ++Offset)
+	{
+		auto& Pending = Readbacks[(NextReadback + Offset) % ReadbackNum];
+		D3D11_MAPPED_SUBRESOURCE Mapped;
+
+		if (!Pending.bIsPending)
+		{
+			continue;
+		}
+
+		if (FAILED(Context->Map(Pending.Staging.Get(), 0u, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &Mapped)))
+		{
+			break;
+		}
+
+		for (UINT Row = 0u; Row < Pending.Height; ++Row)
+		{
+			const auto* const Pixels = reinterpret_cast<const uint32_t*>(static_cast<const std::byte*>(Mapped.pData) + static_cast<size_t>(Mapped.RowPitch) * Row);
+
+			for (UINT Column = 0u; Column < Pending.Width; ++Column)
+			{
+				if (Pixels[Column * 2u] != NoMaterial)
+				{
+					Samples.push_back(static_cast<uint64_t>(Pixels[Column * 2u]) | (static_cast<uint64_t>(Pixels[Column * 2u + 1u]) << 32u));
+				}
+			}
+		}
+
+		Context->Unmap(Pending.Staging.Get(), 0u);
+		Pending.bIsPending = false;
+	}
+
+	if (Samples.empty())
+	{
+		return;
+	}
+
+	// Large surfaces cover many pixels of the same tile at the same footprint.
+	std::sort(Samples.begin(), Samples.end());
+	Samples.erase(std::unique(Samples.begin(), Samples.end()), Samples.end());
+
+	for (auto& [Owner, Registered] : Entries)
+	{
+		Registered->Requested.clear();
+	}
+
+	for (const auto Sample : Samples)
+	{
+		const auto Found = Materials.find(static_cast<unsigned int>(Sample & 0xFFFFFFFFu) - 1u);
+		if (Found == Materials.end())
+		{
+			continue;
+		}
+
+		// See MaterialFeedbackPS.hlsl, 12 bits for each coordinate and 8 for the footprint's log2 in eighths from -24.
+		const auto Packed = static_cast<uint32_t>(Sample >> 32u);
+		const float U = static_cast<float>(Packed & 0xFFFu) / 4096.0f;
+		const float V = static_cast<float>((Packed >> 12u) & 0xFFFu) / 4096.0f;
+		const float CoordinateLod = static_cast<float>(Packed >> 24u) / 8.0f - 24.0f - FeedbackLodBias;
+
+		for (auto* MapTexture : Found->second)
+		{
+			const auto FoundEntry = Entries.find(MapTexture);
+			if (FoundEntry == Entries.end() || !FoundEntry->second->bIsLive)
+			{
+				continue;
+			}
+
+			auto& Sampled = *FoundEntry->second;
+			const auto& Finest = Sampled.Tilings[0];
+			const auto& FullDesc = Sampled.Owner->FullDesc;
+
+			// Along the larger side, like Texture::RequestDetail.
+			const auto Lod = std::floor(CoordinateLod + std::log2(static_cast<float>(std::max(FullDesc.Width, FullDesc.Height))));
+			const auto Mip = static_cast<UINT>(std::clamp(Lod, 0.0f, static_cast<float>(Sampled.FloorMip - 1u)));
+			const auto TileX = std::min(static_cast<UINT>(U * static_cast<float>(Finest.WidthInTiles)), Finest.WidthInTiles - 1u);
+			const auto TileY = std::min(static_cast<UINT>(V * static_cast<float>(Finest.HeightInTiles)), Finest.HeightInTiles - 1u);
+
+			Request(Sampled, Mip, TileX, TileY);
+		}
+	}
+}
+
+void VirtualTextureCache::Request(Entry& InEntry, const UINT InMip, const UINT InTileX, const UINT InTileY)
+{
+	// Coarsest first, a level is only loaded and sampled below one that is resident.
+	for (UINT Mip = InEntry.FloorMip; Mip-- > InMip;)
+	{
+		const auto Key = MakeKey(Mip, InTileX >> Mip, InTileY >> Mip);
+
+		if (const auto Found = InEntry.Pages.find(Key); Found != InEntry.Pages.end())
+		{
+			Pages[Found->second].LastUsedFrame = FrameIndex;
+		}
+		else
+		{
+			InEntry.Requested.push_back(Key);
+		}
+	}
+}
+
+bool VirtualTextureCache::ApplyLoad(Entry& InEntry)
+{
+	if (!InEntry.Pending || !InEntry.Pending->bIsDone.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	auto Load = std::move(InEntry.Pending);
+
+	if (!Load->bHasSucceeded)
+	{
+		// Without its pinned levels there is nothing to sample, missing pages are asked for again by the next feedback.
+		if (!InEntry.bIsLive)
+		{
+			Reject(InEntry);
+		}
+
+		return true;
+	}
+
+	auto& Owner = *InEntry.Owner;
+
+	for (size_t Index = 0u; Index < Load->Tail.size(); ++Index)
+	{
+		const auto& Level = Load->Tail[Index];
+		Context->UpdateSubresource(InEntry.Tiled.Get(), Load->TailMip + static_cast<UINT>(Index), nullptr, Level.Bytes.data(), Level.RowPitch, 0u);
+	}
+
+	if (!InEntry.bIsLive)
+	{
+		Owner.MyTexture = InEntry.Tiled;
+		Owner.MyTextureView = InEntry.View;
+		Owner.MyResidencyView = InEntry.ResidencyView;
+		Owner.ResidentMip = 0u;
+		Owner.InvalidateBaked();
+		InEntry.bIsLive = true;
+	}
+
+	// Coarsest first, a page only goes in below one that is already resident.
+	std::sort(Load->Pages.begin(), Load->Pages.end(), [](const Texture::TilePage& InLeft, const Texture::TilePage& InRight)
+	{
+		return InLeft.Mip > InRight.Mip;
+	});
+
+	for (const auto& Page : Load->Pages)
+	{
+		const auto Key = MakeKey(Page.Mip, Page.X, Page.Y);
+		const bool bHasParent = Page.Mip + 1u >= InEntry.FloorMip || InEntry.Pages.contains(MakeKey(Page.Mip + 1u, Page.X >> 1u, Page.Y >> 1u));
+
+		if (InEntry.Pages.contains(Key) || !bHasParent)
+		{
+			continue;
+		}
+
+		const auto Allocated = AllocatePage();
+		if (Allocated == NoPage)
+		{
+			break;
+		}
+
+		const D3D11_TILED_RESOURCE_COORDINATE Coordinate {Page.X, Page.Y, 0u, Page.Mip};
+		MapTile(InEntry, Coordinate, Allocated);
+
+		const D3D11_TILE_REGION_SIZE Region {1u, FALSE, 0u, 0u, 0u};
+		Context->UpdateTiles(InEntry.Tiled.Get(), &Coordinate, &Region, Page.Bytes.data(), 0u);
+
+		Pages[Allocated] = {&InEntry, Key, FrameIndex, false};
+		InEntry.Pages.emplace(Key, Allocated);
+		UpdateResidency(InEntry, Page.Mip, Page.X, Page.Y);
+		++LastStatistics.LoadedNum;
+	}
+
+	Owner.ByteSize = (InEntry.PinnedPages.size() + InEntry.Pages.size()) * PageBytes;
+	return true;
+}
+
+void VirtualTextureCache::StartLoads()
+{
+	for (auto& [Owner, Registered] : Entries)
+	{
+		if (PendingNum >= MaxPendingNum)
+		{
+			break;
+		}
+
+		if (!Registered->bIsLive || Registered->Pending || Registered->Requested.empty())
+		{
+			continue;
+		}
+
+		auto& Requested = Registered->Requested;
+
+		// Coarsest first, whatever doesn't fit is asked for again by later feedback.
+		std::sort(Requested.begin(), Requested.end(), std::greater<uint32_t> {});
+		Requested.erase(std::unique(Requested.begin(), Requested.end()), Requested.end());
+		Requested.resize(std::min(Requested.size(), MaxLoadPageNum));
+
+		Registered->Pending = std::make_shared<Texture::PageLoad>();
+
+		for (const auto Key : Requested)
+		{
+			Registered->Pending->Pages.push_back({GetKeyMip(Key), GetKeyX(Key), GetKeyY(Key), {}});
+		}
+
+		Requested.clear();
+		Owner->LoadPages(Registered->Pending, Registered->Shape.WidthInTexels, Registered->Shape.HeightInTexels, IoPriority::Visible, Jobs);
+		++PendingNum;
+	}
+}
+
+void VirtualTextureCache::MapTile(Entry& InEntry, const D3D11_TILED_RESOURCE_COORDINATE& InCoordinate, const UINT InPage)
+{
+	HRESULT ResultHandle;
+
+	const D3D11_TILE_REGION_SIZE Region {1u, FALSE, 0u, 0u, 0u};
+	const UINT RangeFlags = InPage == NoPage ? D3D11_TILE_RANGE_NULL : 0u;
+	const UINT RangeStart = InPage == NoPage ? 0u : InPage;
+	const UINT RangeTileNum = 1u;
+
+	CHECK_HRESULT_EXCEPTION(Context->UpdateTileMappings(InEntry.Tiled.Get(), 1u, &InCoordinate, &Region, Pool.Get(), 1u, &RangeFlags, &RangeStart,
+	                                                    &RangeTileNum, 0u))
+}
+
+UINT VirtualTextureCache::AllocatePage()
+{
+	if (!FreePages.empty())
+	{
+		const auto Allocated = FreePages.back();
+		FreePages.pop_back();
+		return Allocated;
+	}
+
+	UINT Victim = NoPage;
+
+	for (UINT Index = 0u; Index < static_cast<UINT>(Pages.size()); ++Index)
+	{
+		const auto& Candidate = Pages[Index];
+
+		// Pages this frame's feedback asked for stay, pages needed equally long ago go finest first.
+		if (Candidate.bIsPinned || Candidate.LastUsedFrame >= FrameIndex)
+		{
+			continue;
+		}
+
+		if (Victim == NoPage || Candidate.LastUsedFrame < Pages[Victim].LastUsedFrame ||
+		    (Candidate.LastUsedFrame == Pages[Victim].LastUsedFrame && GetKeyMip(Candidate.Key) < GetKeyMip(Pages[Victim].Key)))
+		{
+			Victim = Index;
+		}
+	}
+
+	if (Victim != NoPage)
+	{
+		Evict(Victim);
+	}
+
+	return Victim;
+}
+
+void VirtualTextureCache::Evict(const UINT InPage)
+{
+	auto& Evicted = Pages[InPage];
+	auto& Paged = *Evicted.Owner;
+	const auto Mip = GetKeyMip(Evicted.Key);
+	const auto X = GetKeyX(Evicted.Key);
+	const auto Y = GetKeyY(Evicted.Key);
+
+	// Finer pages below it stay mapped until they are evicted in turn, the residency stops short of them.
+	MapTile(Paged, {X, Y, 0u, Mip}, NoPage);
+	Paged.Pages.erase(Evicted.Key);
+	Paged.Owner->ByteSize -= PageBytes;
+	Evicted = {};
+
+	UpdateResidency(Paged, Mip, X, Y);
+	++LastStatistics.EvictedNum;
+}
+
+void VirtualTextureCache::UpdateResidency(Entry& InEntry, const UINT InMip, const UINT InX, const UINT InY)
+{
+	const auto& Finest = InEntry.Tilings[0];
+	const UINT EndX = std::min((InX + 1u) << InMip, Finest.WidthInTiles);
+	const UINT EndY = std::min((InY + 1u) << InMip, Finest.HeightInTiles);
+
+	for (UINT TileY = InY << InMip; TileY < EndY; ++TileY)
+	{
+		for (UINT TileX = InX << InMip; TileX < EndX; ++TileX)
+		{
+			// The finest level the chain of resident pages from the pinned levels down reaches.
+			UINT Resident = InEntry.FloorMip;
+
+			while (Resident > 0u && InEntry.Pages.contains(MakeKey(Resident - 1u, TileX >> (Resident - 1u), TileY >> (Resident - 1u))))
+			{
+				--Resident;
+			}
+
+			InEntry.ResidentMips[static_cast<size_t>(TileY) * Finest.WidthInTiles + TileX] = static_cast<uint8_t>(Resident);
+		}
+	}
+
+	InEntry.bIsResidencyDirty = true;
+}
@@ -0,0 +1,169 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <array>
+#include <d3d11_2.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "wrl/client.h"
+#include "JobSystem.h"
+
+class Drawable;
+class Graphics;
+class PixelShader;
+class Texture;
+class TextureStreamer;
+
+/**
+ * Virtual texturing for texture sets larger than any card holds, over D3D11.2 tiled resources. Streamed maps of materials
+ * that ask for it are recreated tiled, with every tile of their coarse levels mapped for good and the finer ones paged in
+ * and out of one shared pool of 64KB tiles, so what is resident follows what is on screen instead of the size of the content.
+ * Which pages are needed comes from a feedback pass: the candidates are drawn again at an eighth of the display's size,
+ * writing their material and the texture coordinate and footprint of each pixel. Those are read back a few frames later
+ * without waiting on the GPU, missing pages are cut out of the file by a job once IoService has read it, and the pages
+ * needed longest ago are evicted once the pool is full. Each texture keeps a residency map of the finest level resident
+ * per tile of its finest level, which the VIRTUAL_TEXTURED material shaders clamp their samples to, so a page is only
+ * sampled once every coarser page above it is resident too. It takes tiled resources tier 2 for the clamp.
+ */
+class VirtualTextureCache
+{
+public:
+	struct Statistics
+	{
+		unsigned int TextureNum {0u};
+		// Of the pool, the coarse levels' pinned pages included.
+		unsigned int ResidentPageNum {0u};
+		unsigned int PageNum {0u};
+		unsigned int PendingNum {0u};
+		// Since startup.
+		unsigned int LoadedNum {0u};
+		unsigned int EvictedNum {0u};
+	};
+
+	static constexpr size_t PageBytes {D3D11_2_TILED_RESOURCE_TILE_SIZE_IN_BYTES};
+	// Each side of the feedback target, against the display's.
+	static constexpr UINT FeedbackScale {8u};
+
+	// Textures the pool can't page, those smaller than a tile or with no level to spare, are handed to InStreamer instead.
+	VirtualTextureCache(ID3D11Device2* InDevice, ID3D11DeviceContext2* InContext, TextureStreamer& InStreamer, UINT InWidth, UINT InHeight,
+	                    size_t InPoolBytes = 256u * 1024u * 1024u);
+	VirtualTextureCache(const VirtualTextureCache&) = delete;
+	VirtualTextureCache(VirtualTextureCache&&) = delete;
+	VirtualTextureCache& operator=(const VirtualTextureCache&) = delete;
+	VirtualTextureCache& operator=(VirtualTextureCache&&) = delete;
+	// Waits for the loads in flight, their completions write into the textures' pages.
+	~VirtualTextureCache();
+
+	// Called by textures from any thread, they unregister when destroyed. They keep their coarse levels until the next
+	// Update has made their tiled resource and its coarse levels were read in.
+	void Register(Texture& InTexture);
+	void Unregister(Texture& InTexture);
+	// Feedback of the material is credited to its virtual maps, also from any thread.
+	void RegisterMaterial(unsigned int InMaterialId, std::vector<Texture*> InTextures);
+	void UnregisterMaterial(unsigned int InMaterialId);
+
+	// Any thread during submission. InDrawable is drawn into this frame's feedback with InFeedbackShader, its material's.
+	void AddCandidate(const Drawable& InDrawable, const PixelShader& InFeedbackShader);
+	// True when this frame's candidates are drawn, there are some and a readback is free for them.
+	[[nodiscard]] bool IsGatheringFeedback() const noexcept;
+	// Draws this frame's candidates, if it gathers feedback. Leaves the frame state bound again.
+	void RenderFeedback(const Graphics& InGraphics);
+
+	// Reads back feedback, maps finished pages, evicts and starts new loads, once per frame on the main thread before anything is recorded.
+	void Update();
+	void Resize(UINT InWidth, UINT InHeight);
+
+	[[nodiscard]] const Statistics& GetStatistics() const noexcept
+	{
+		return LastStatistics;
+	}
+
+private:
+	struct Entry;
+
+	// A tile of the pool, unused while it has no entry.
+	struct Page
+	{
+		Entry* Owner {nullptr};
+		uint32_t Key {0u};
+		unsigned long long LastUsedFrame {0u};
+		// Holds a coarse level, only freed with its texture.
+		bool bIsPinned {false};
+	};
+
+	struct Candidate
+	{
+		const Drawable* Drawn;
+		const PixelShader* Shader;
+	};
+
+	// A feedback target copied out and waiting for the GPU, with the part of it this frame's viewport covered.
+	struct Readback
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Staging;
+		UINT Width {0u};
+		UINT Height {0u};
+		bool bIsPending {false};
+	};
+
+	static constexpr unsigned int ReadbackNum {3u};
+	// Loads are a whole file read and decode each, a few at a time like the streamer's.
+	static constexpr unsigned int MaxPendingNum {2u};
+	// Pages of one texture cut out by one load, the rest wait for the next.
+	static constexpr size_t MaxLoadPageNum {64u};
+
+	// Packs the level and tile position, the same key the pages of an entry are kept under.
+	[[nodiscard]] static uint32_t MakeKey(UINT InMip, UINT InX, UINT InY) noexcept;
+
+	void CreateTargets(UINT InWidth, UINT InHeight);
+	// Makes the tiled resource, maps its coarse levels and starts reading them, or hands the texture to the streamer.
+	void Adopt(Entry& InEntry);
+	// Back to the streamer at the coarse levels it was created with, after a failed read.
+	void Reject(Entry& InEntry);
+	void Release(Entry& InEntry);
+	void ReadFeedback();
+	// Marks the page at InMip above the finest level tile and every coarser one as used, and asks for those missing.
+	void Request(Entry& InEntry, UINT InMip, UINT InTileX, UINT InTileY);
+	// True once the entry's load has finished, whether or not it succeeded.
+	bool ApplyLoad(Entry& InEntry);
+	void StartLoads();
+	// Points the tile at the page, or at nothing for NoPage.
+	void MapTile(Entry& InEntry, const D3D11_TILED_RESOURCE_COORDINATE& InCoordinate, UINT InPage);
+	// A free page, evicting the one needed longest ago when there is none, NoPage when every page is in use this frame.
+	[[nodiscard]] UINT AllocatePage();
+	void Evict(UINT InPage);
+	// Recomputes the residency of the finest level tiles under the page.
+	void UpdateResidency(Entry& InEntry, UINT InMip, UINT InX, UINT InY);
+
+private:
+	static constexpr UINT NoPage {~0u};
+	// Log2 of FeedbackScale, how many levels coarser the feedback pass samples than the frame.
+	static constexpr float FeedbackLodBias {3.0f};
+
+	Microsoft::WRL::ComPtr<ID3D11Device2> Device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext2> Context;
+	TextureStreamer& Streamer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> Pool;
+	std::vector<Page> Pages;
+	std::vector<UINT> FreePages;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> FeedbackTarget;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> FeedbackTargetView;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> FeedbackDepthView;
+	std::array<Readback, ReadbackNum> Readbacks;
+	unsigned int NextReadback {0u};
+	UINT FeedbackWidth {0u};
+	UINT FeedbackHeight {0u};
+
+	std::mutex Mutex;
+	std::unordered_map<Texture*, std::unique_ptr<Entry>> Entries;
+	std::unordered_map<unsigned int, std::vector<Texture*>> Materials;
+	std::vector<Candidate> Candidates;
+	// Only drawn on frames that gather feedback, set by Update.
+	bool bIsGathering {false};
+	JobCounter Jobs;
+	unsigned long long FrameIndex {0u};
+	unsigned int PendingNum {0u};
+	Statistics LastStatistics {};
+};
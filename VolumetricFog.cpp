@@ -0,0 +1,165 @@
+﻿#include "VolumetricFog.h"
+#include <algorithm>
+#include <cstring>
+#include "ExceptionMacros.h"
+#include "GpuProfiler.h"
+#include "Graphics.h"
+#include "ShaderBundle.h"
+
+VolumetricFog::VolumetricFog(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView)
+	: DepthView(InDepthView)
+{
+	HRESULT ResultHandle;
+
+	const auto InjectBlob = InShaderBundle.Load("VolumetricFogInjectCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(InjectBlob->GetBufferPointer(), InjectBlob->GetBufferSize(), nullptr, &InjectShader))
+
+	const auto IntegrateBlob = InShaderBundle.Load("VolumetricFogIntegrateCS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateComputeShader(IntegrateBlob->GetBufferPointer(), IntegrateBlob->GetBufferSize(), nullptr, &IntegrateShader))
+
+	const auto VertexBlob = InShaderBundle.Load("FullscreenVS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateVertexShader(VertexBlob->GetBufferPointer(), VertexBlob->GetBufferSize(), nullptr, &VertexShader))
+
+	const auto ApplyBlob = InShaderBundle.Load("VolumetricFogApplyPS.cso");
+	CHECK_HRESULT_EXCEPTION(InDevice->CreatePixelShader(ApplyBlob->GetBufferPointer(), ApplyBlob->GetBufferSize(), nullptr, &ApplyShader))
+
+	D3D11_BUFFER_DESC ConstantBufferDesc {};
+	ConstantBufferDesc.ByteWidth = sizeof(FogConstants);
+	ConstantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ConstantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	ConstantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBuffer(&ConstantBufferDesc, nullptr, &ConstantBuffer))
+
+	// The injected scattering and its integral, written a froxel or a column at a time and never needing their old contents.
+	D3D11_TEXTURE3D_DESC VolumeDesc {};
+	VolumeDesc.Width = FroxelNumX;
+	VolumeDesc.Height = FroxelNumY;
+	VolumeDesc.Depth = FroxelNumZ;
+	VolumeDesc.MipLevels = 1u;
+	VolumeDesc.Format = Format;
+	VolumeDesc.Usage = D3D11_USAGE_DEFAULT;
+	VolumeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture3D> ScatteringTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture3D(&VolumeDesc, nullptr, &ScatteringTexture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(ScatteringTexture.Get(), nullptr, &ScatteringView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(ScatteringTexture.Get(), nullptr, &ScatteringUav))
+
+	Microsoft::WRL::ComPtr<ID3D11Texture3D> IntegratedTexture;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateTexture3D(&VolumeDesc, nullptr, &IntegratedTexture))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateShaderResourceView(IntegratedTexture.Get(), nullptr, &IntegratedView))
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateUnorderedAccessView(IntegratedTexture.Get(), nullptr, &IntegratedUav))
+
+	// Trilinear between froxels, pixels past the last slice take the fog of the whole range.
+	D3D11_SAMPLER_DESC SamplerDesc {};
+	SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateSamplerState(&SamplerDesc, &Sampler))
+
+	// The scene dimmed by the transmittance the shader returns in alpha, plus the light scattered towards the camera.
+	D3D11_BLEND_DESC BlendDesc {};
+	auto& Target = BlendDesc.RenderTarget[0];
+	Target.BlendEnable = TRUE;
+	Target.SrcBlend = D3D11_BLEND_ONE;
+	Target.DestBlend = D3D11_BLEND_SRC_ALPHA;
+	Target.BlendOp = D3D11_BLEND_OP_ADD;
+	Target.SrcBlendAlpha = D3D11_BLEND_ZERO;
+	Target.DestBlendAlpha = D3D11_BLEND_ONE;
+	Target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	Target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateBlendState(&BlendDesc, &ApplyBlendState))
+
+	D3D11_DEPTH_STENCIL_DESC DepthStencilDesc {};
+	DepthStencilDesc.DepthEnable = FALSE;
+	DepthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	DepthStencilDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	CHECK_HRESULT_EXCEPTION(InDevice->CreateDepthStencilState(&DepthStencilDesc, &ApplyDepthState))
+}
+
+bool VolumetricFog::IsActive(const Graphics& InGraphics) const noexcept
+{
+	return bIsEnabled && Density > 0.0f && !InGraphics.IsMultiView();
+}
+
+void VolumetricFog::Render(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Volumetric fog");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto* const DeviceContext = Context.GetDeviceContext();
+	const auto& Viewport = InGraphics.GetViewport();
+
+	// Unjittered, the froxels are far coarser than the jitter and would only shimmer with it.
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMStoreFloat4x4(&Projection, InGraphics.GetProjectionMatrix());
+	const auto NearZ = -Projection._43 / Projection._33;
+	const auto FarZ = Projection._43 / (1.0f - Projection._33);
+
+	FogConstants Constants {};
+	Constants.InverseView = DirectX::XMMatrixTranspose(DirectX::XMMatrixInverse(nullptr, InGraphics.GetViewMatrix()));
+	Constants.ProjectionParameters = {1.0f / Projection._11, 1.0f / Projection._22, Projection._33, Projection._43};
+	Constants.CameraPosition = InGraphics.GetCamera().GetPosition();
+	Constants.Density = Density;
+	Constants.ViewportSize = {Viewport.Width, Viewport.Height};
+	Constants.NearZ = NearZ;
+	Constants.Range = std::clamp(Range, NearZ * 2.0f, FarZ);
+	Constants.Anisotropy = std::clamp(Anisotropy, -0.99f, 0.99f);
+
+	HRESULT ResultHandle;
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+
+	CHECK_HRESULT_EXCEPTION(DeviceContext->Map(ConstantBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &MappedResource))
+	std::memcpy(MappedResource.pData, &Constants, sizeof(Constants));
+	DeviceContext->Unmap(ConstantBuffer.Get(), 0u);
+	Context.GetStateCache().CountUpload(sizeof(Constants));
+
+	DeviceContext->CSSetShader(InjectShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, ScatteringUav.GetAddressOf(), nullptr);
+	InGraphics.GetClusteredLighting().BindCompute(DeviceContext);
+	InGraphics.GetPointLightShadows().BindCompute(DeviceContext);
+	InGraphics.Dispatch((FroxelNumX + GroupSize - 1u) / GroupSize, (FroxelNumY + GroupSize - 1u) / GroupSize, FroxelNumZ);
+
+	DeviceContext->CSSetShader(IntegrateShader.Get(), nullptr, 0u);
+	DeviceContext->CSSetConstantBuffers(ConstantSlot, 1u, ConstantBuffer.GetAddressOf());
+	DeviceContext->CSSetShaderResources(ScatteringSlot, 1u, ScatteringView.GetAddressOf());
+	DeviceContext->CSSetUnorderedAccessViews(OutputSlot, 1u, IntegratedUav.GetAddressOf(), nullptr);
+	InGraphics.Dispatch((FroxelNumX + GroupSize - 1u) / GroupSize, (FroxelNumY + GroupSize - 1u) / GroupSize);
+}
+
+void VolumetricFog::Apply(const Graphics& InGraphics)
+{
+	PROFILE_GPU_SCOPE(InGraphics, "Volumetric fog apply");
+
+	auto& Context = InGraphics.GetImmediateContext();
+	auto& Cache = Context.GetStateCache();
+
+	// Depth is read here, so only the scene stays bound to the output merger.
+	Cache.SetRenderTarget(nullptr, nullptr);
+	InGraphics.ResolveDepth();
+	InGraphics.BindFrameState(Context);
+	InGraphics.BindSceneTarget(Context);
+	Cache.SetBlendState(ApplyBlendState.Get());
+	Cache.SetDepthStencilState(ApplyDepthState.Get());
+	Cache.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	Cache.SetInputLayout(nullptr);
+	Cache.SetVertexShader(VertexShader.Get());
+	Cache.SetHullShader(nullptr);
+	Cache.SetDomainShader(nullptr);
+	Cache.SetPixelShader(ApplyShader.Get());
+	Cache.SetPixelConstantBuffer(ConstantSlot, ConstantBuffer.Get());
+	Cache.SetPixelShaderResource(DepthSlot, DepthView);
+	Cache.SetPixelShaderResource(IntegratedSlot, IntegratedView.Get());
+	Cache.SetPixelSampler(SamplerSlot, Sampler.Get());
+
+	Context.GetDeviceContext()->Draw(3u, 0u);
+	Cache.CountDraw(3u, 1u);
+
+	// The material maps share these slots, and depth is bound for drawing again.
+	Cache.SetPixelShaderResource(DepthSlot, nullptr);
+	Cache.SetPixelShaderResource(IntegratedSlot, nullptr);
+	InGraphics.BindFrameState(Context);
+}
@@ -0,0 +1,140 @@
+﻿#pragma once
+#include "EngineWin.h"
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include "wrl/client.h"
+
+class Graphics;
+class ShaderBundle;
+
+/**
+ * Haze lit by the point lights, over a grid of froxels aligned with the camera, FroxelNumX by FroxelNumY across the viewport
+ * and FroxelNumZ exponential slices deep out to the fog's range. A compute pass injects the light each froxel scatters towards
+ * the camera from the lights of the cluster it falls into, shadows included, a second one adds the slices up front to back, and
+ * a fullscreen pass blends what lies in front of every pixel over the scene in a single fetch. The cost is the grid's, whatever
+ * the resolution and however much of the screen the lights cover. The layout and grid size mirror VolumetricFog.hlsli.
+ * The fog is applied once the scene's surfaces are drawn, so blended ones take the fog of what is behind them, and particles and
+ * debug lines draw over it unfogged. Multi-view frames skip it.
+ */
+class VolumetricFog
+{
+public:
+	static constexpr UINT FroxelNumX {160u};
+	static constexpr UINT FroxelNumY {90u};
+	static constexpr UINT FroxelNumZ {64u};
+	static constexpr DXGI_FORMAT Format {DXGI_FORMAT_R16G16B16A16_FLOAT};
+
+	// The depth view is Graphics', the froxel volumes are the subsystem's own and don't depend on the resolution.
+	VolumetricFog(ID3D11Device* InDevice, const ShaderBundle& InShaderBundle, ID3D11ShaderResourceView* InDepthView);
+	VolumetricFog(const VolumetricFog&) = delete;
+	VolumetricFog(VolumetricFog&&) = delete;
+	VolumetricFog& operator=(const VolumetricFog&) = delete;
+	VolumetricFog& operator=(VolumetricFog&&) = delete;
+	~VolumetricFog() = default;
+
+	// For Graphics' depth view recreated by a resize.
+	void Resize(ID3D11ShaderResourceView* InDepthView) noexcept
+	{
+		DepthView = InDepthView;
+	}
+
+	// Whether this frame's passes run, enabled and with a view the clusters cover.
+	[[nodiscard]] bool IsActive(const Graphics& InGraphics) const noexcept;
+
+	// Injects and integrates the scattering on the immediate context, once the lights are culled and their shadows drawn.
+	void Render(const Graphics& InGraphics);
+	// Blends the fog over the scene once its depth is final, then binds the frame state again.
+	void Apply(const Graphics& InGraphics);
+
+	void Enable() noexcept
+	{
+		bIsEnabled = true;
+	}
+
+	void Disable() noexcept
+	{
+		bIsEnabled = false;
+	}
+
+	[[nodiscard]] bool IsEnabled() const noexcept
+	{
+		return bIsEnabled;
+	}
+
+	// Of the light crossing a world unit of fog, the fraction scattered, at the most a few hundredths for a haze.
+	void SetDensity(const float InDensity) noexcept
+	{
+		Density = InDensity;
+	}
+
+	[[nodiscard]] float GetDensity() const noexcept
+	{
+		return Density;
+	}
+
+	// Between -1 and 1, zero scatters evenly and towards one the fog glows mostly around lights the camera looks at.
+	void SetAnisotropy(const float InAnisotropy) noexcept
+	{
+		Anisotropy = InAnisotropy;
+	}
+
+	[[nodiscard]] float GetAnisotropy() const noexcept
+	{
+		return Anisotropy;
+	}
+
+	// View depth the froxels reach, clamped to the far plane. Shorter ranges give each slice less depth to cover.
+	void SetRange(const float InRange) noexcept
+	{
+		Range = InRange;
+	}
+
+	[[nodiscard]] float GetRange() const noexcept
+	{
+		return Range;
+	}
+
+private:
+	// Laid out like the Fog cbuffer.
+	struct FogConstants
+	{
+		DirectX::XMMATRIX InverseView;
+		DirectX::XMFLOAT4 ProjectionParameters;
+		DirectX::XMFLOAT3 CameraPosition;
+		float Density;
+		DirectX::XMFLOAT2 ViewportSize;
+		float NearZ;
+		float Range;
+		float Anisotropy;
+		float Padding[3];
+	};
+
+	// Registers in VolumetricFog.hlsli and the passes' shaders.
+	static constexpr UINT ConstantSlot {0u};
+	static constexpr UINT ScatteringSlot {0u};
+	static constexpr UINT OutputSlot {0u};
+	static constexpr UINT DepthSlot {0u};
+	static constexpr UINT IntegratedSlot {1u};
+	static constexpr UINT SamplerSlot {0u};
+	static constexpr UINT GroupSize {8u};
+
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> InjectShader;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> IntegrateShader;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> ApplyShader;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ScatteringView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> ScatteringUav;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> IntegratedView;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> IntegratedUav;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> Sampler;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> ApplyBlendState;
+	// The pass covers the screen, it neither tests nor writes depth.
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> ApplyDepthState;
+
+	ID3D11ShaderResourceView* DepthView;
+	float Density {0.02f};
+	float Anisotropy {0.3f};
+	float Range {40.0f};
+	bool bIsEnabled {false};
+};
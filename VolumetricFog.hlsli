@@ -0,0 +1,47 @@
+// Shared by the volumetric fog passes, laid out like VolumetricFog::FogConstants. Froxels split the viewport evenly across and the
+// view depth from FogNearZ to FogRange exponentially, so the slices are thinnest near the camera where the fog's detail shows most.
+static const uint3 FroxelNum = uint3(160u, 90u, 64u);
+
+cbuffer Fog : register(b0)
+{
+    // View to world, from the centre of a froxel to where its lights are.
+    matrix InverseView;
+    // 1 / Projection._11, 1 / Projection._22, Projection._33 and Projection._43, enough to undo the projection.
+    float4 ProjectionParameters;
+    float3 CameraPosition;
+    // Scattering per world unit, the medium absorbs nothing so it is also the extinction.
+    float Density;
+    // The part of the scene target this frame renders to, from its top left.
+    float2 ViewportSize;
+    float FogNearZ;
+    // View depth the last slice ends at, nothing beyond it is fogged any further.
+    float FogRange;
+    // Of the Henyey-Greenstein phase function, positive scatters forward, towards the viewer looking at the light.
+    float Anisotropy;
+    float3 FogPadding;
+}
+
+float LinearizeDepth(const float InDepth)
+{
+    return ProjectionParameters.w / (InDepth - ProjectionParameters.z);
+}
+
+// Where the fractional slice InSlice starts, slice FroxelNum.z ends at FogRange.
+float GetSliceDepth(const float InSlice)
+{
+    return FogNearZ * pow(FogRange / FogNearZ, InSlice / FroxelNum.z);
+}
+
+// The inverse of GetSliceDepth, as a fraction of the volume's depth.
+float GetSliceCoordinate(const float InViewDepth)
+{
+    return saturate(log(max(InViewDepth, FogNearZ) / FogNearZ) / log(FogRange / FogNearZ));
+}
+
+// Through the froxel column's centre at a view depth of one, whose length is how much longer the ray is than its depth.
+float3 GetFroxelRay(const uint2 InFroxel)
+{
+    const float2 Coordinate = (InFroxel + 0.5f) / FroxelNum.xy;
+    const float2 Ndc = float2(Coordinate.x * 2.0f - 1.0f, 1.0f - Coordinate.y * 2.0f);
+    return float3(Ndc * ProjectionParameters.xy, 1.0f);
+}
@@ -0,0 +1,15 @@
+// The fog in front of every pixel over the scene in one fetch of the integrated volume, blended with ONE, SRC_ALPHA so the scene
+// is dimmed by the transmittance and the scattered light added. Texel centres hold what reaches their slice's far end, hence the
+// half slice taken off the depth. Depth is the single sampled view, the farthest sample of a multisampled pixel.
+#include "VolumetricFog.hlsli"
+
+Texture2D<float> Depth : register(t0);
+Texture3D<float4> Integrated : register(t1);
+SamplerState VolumeSampler : register(s0);
+
+float4 main(const float4 InPosition : SV_Position) : SV_Target
+{
+    const float ViewDepth = LinearizeDepth(Depth.Load(int3(InPosition.xy, 0)));
+    const float3 Coordinate = float3(InPosition.xy / ViewportSize, GetSliceCoordinate(ViewDepth) - 0.5f / FroxelNum.z);
+    return Integrated.SampleLevel(VolumeSampler, Coordinate, 0.0f);
+}
@@ -0,0 +1,55 @@
+// Light scattered towards the camera at the centre of every froxel, one thread per froxel in 8x8 tiles of a slice. Each froxel
+// takes the point lights of the cluster it falls into, shadowed like surfaces are, and the ambient light from every direction.
+// Written as the scattered radiance per world unit and the extinction, which VolumetricFogIntegrateCS.hlsl adds up along the view.
+#include "VolumetricFog.hlsli"
+#include "PointLight.hlsli"
+
+RWTexture3D<float4> Scattering : register(u0);
+
+// Henyey-Greenstein, scaled by four pi so an isotropic medium scatters all the light reaching it, as lit surfaces reflect it.
+float GetPhase(const float InCosAngle)
+{
+    const float Squared = Anisotropy * Anisotropy;
+    return (1.0f - Squared) / pow(max(1.0f + Squared - 2.0f * Anisotropy * InCosAngle, 1e-4f), 1.5f);
+}
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID >= FroxelNum))
+    {
+        return;
+    }
+
+    const float3 ViewPosition = GetFroxelRay(InThreadID.xy) * GetSliceDepth(InThreadID.z + 0.5f);
+    const float3 WorldPosition = mul(float4(ViewPosition, 1.0f), InverseView).xyz;
+    const float3 DirectionFromCamera = normalize(WorldPosition - CameraPosition);
+
+    // The froxel's viewport position in pixels, as FindClusterIndex takes it.
+    const float2 PixelPosition = (InThreadID.xy + 0.5f) / FroxelNum.xy * TileSize * float2(ClusterCountX, ClusterCountY);
+    const uint ClusterIndex = FindClusterIndex(PixelPosition, WorldPosition);
+    const uint First = ClusterIndex * MaxLightsPerCluster;
+    const uint ClusterLightNum = ClusterLightCounts[ClusterIndex];
+
+    float3 Radiance = AmbientColor;
+
+    for (uint Index = 0u; Index < ClusterLightNum; ++Index)
+    {
+        const PointLightData Light = Lights[ClusterLightIndices[First + Index]];
+        const float3 VectorToLight = Light.WorldPosition - WorldPosition;
+        const float DistanceToLight = length(VectorToLight);
+
+        // The lists hold every light reaching somewhere in the cluster, which is far larger than a froxel.
+        if (DistanceToLight >= Light.Range)
+        {
+            continue;
+        }
+
+        const float Attenuation = GetShadowFactor(Light, VectorToLight) / (Light.QuadraticAttenuation * (DistanceToLight * DistanceToLight) +
+                                                                             Light.LinearAttenuation * DistanceToLight + Light.ConstantAttenuation);
+        const float Phase = GetPhase(dot(DirectionFromCamera, VectorToLight / max(DistanceToLight, 1e-4f)));
+        Radiance += Light.DiffuseColor * Light.DiffuseStrength * Attenuation * Phase;
+    }
+
+    Scattering[InThreadID] = float4(Radiance * Density, Density);
+}
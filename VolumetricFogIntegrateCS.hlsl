@@ -0,0 +1,35 @@
+// Adds up the scattering front to back along every froxel column, one thread per column in 8x8 tiles. Each slice holds the light
+// scattered towards the camera from the near plane to its far end, and how much of what lies behind it still shows through.
+#include "VolumetricFog.hlsli"
+
+Texture3D<float4> Scattering : register(t0);
+RWTexture3D<float4> Integrated : register(u0);
+
+[numthreads(8, 8, 1)]
+void main(const uint3 InThreadID : SV_DispatchThreadID)
+{
+    if (any(InThreadID.xy >= FroxelNum.xy))
+    {
+        return;
+    }
+
+    const float RayScale = length(GetFroxelRay(InThreadID.xy));
+
+    float3 Accumulated = 0.0f;
+    float Transmittance = 1.0f;
+    float SliceStart = FogNearZ;
+
+    for (uint Slice = 0u; Slice < FroxelNum.z; ++Slice)
+    {
+        const uint3 Froxel = uint3(InThreadID.xy, Slice);
+        const float4 Medium = Scattering[Froxel];
+        const float SliceEnd = GetSliceDepth(Slice + 1.0f);
+        const float SliceTransmittance = exp(-Medium.a * (SliceEnd - SliceStart) * RayScale);
+
+        // Integrated over the slice as the light behind its front dims, so thick slices don't add more than the medium lets through.
+        Accumulated += Transmittance * Medium.rgb * (1.0f - SliceTransmittance) / max(Medium.a, 1e-6f);
+        Transmittance *= SliceTransmittance;
+        Integrated[Froxel] = float4(Accumulated, Transmittance);
+        SliceStart = SliceEnd;
+    }
+}
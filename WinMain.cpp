@@ -1,12 +1,21 @@
 #include "App.h"
 #include "Exception.h"
+#include "MicroBenchmark.h"
 
 // https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-winmain
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd)
 {
 	try
 	{
-		return App{}.Run();
+		const std::string_view CommandLine {lpCmdLine};
+
+		// Component timings never open a window, so they run before App creates one.
+		if (CommandLine.find("--microbenchmark") != std::string_view::npos)
+		{
+			return MicroBenchmark::Run(CommandLine);
+		}
+
+		return App{CommandLine}.Run();
 	}
 	catch (const EngineException& InException)
 	{
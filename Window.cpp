@@ -1,13 +1,21 @@
 ﻿#include "Window.h"
+#include <future>
+#include <mutex>
 #include <sstream>
+#include "AllocationTracker.h"
 #include "Exception.h"
 #include "ExceptionMacros.h"
+#include "FrameProfiler.h"
+#include "ImGuiManager.h"
+#include "JobSystem.h"
+#include "StartupTimeline.h"
 #include "imgui/imgui_impl_win32.h"
 
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 WindowClass::WindowClass() : HandleInstance(GetModuleHandle(nullptr))
 {
+	STARTUP_PHASE("Window class");
 	/**
 	 * https://learn.microsoft.com/en-us/windows/win32/api/winuser/ns-winuser-wndclassexw
 	 * Window Class Configuration
@@ -48,16 +56,111 @@ HINSTANCE WindowClass::GetHandleInstance() const
 	return HandleInstance;
 }
 
-Window::Window(const int InWidth, const int InHeight, const wchar_t* InName)
-	: Width(InWidth), Height(InHeight)
+Window::Window(const int InWidth, const int InHeight, const wchar_t* InName, const bool bInUseMessageThread, const SwapChainSettings& InSettings)
+	: Width(InWidth), Height(InHeight), bUsesMessageThread(bInUseMessageThread)
 {
+	// The device and the shaders don't need the window, so they are made while it is.
+	Graphics::Prerequisites Prepared;
+	JobCounter PreparedDone;
+	Graphics::Prepare(InSettings.AdapterIndex, Prepared, PreparedDone);
+
+	try
+	{
+		if (bUsesMessageThread)
+		{
+			CreateOnMessageThread(InName);
+		}
+		else
+		{
+			Create(InName);
+		}
+	}
+	catch (...)
+	{
+		// The jobs write into Prepared. Whatever they failed at goes unreported behind the window's own failure.
+		try
+		{
+			JobSystem::Get().Wait(PreparedDone);
+		}
+		catch (...)
+		{
+		}
+
+		throw;
+	}
+
+	try
+	{
+		JobSystem::Get().Wait(PreparedDone);
+		MyGraphics = std::make_unique<Graphics>(Handle, InWidth, InHeight, InSettings, std::move(Prepared));
+
+		if (InSettings.Fullscreen == FullscreenMode::Borderless)
+		{
+			MakeBorderless(InSettings.OutputIndex);
+		}
+	}
+	catch (...)
+	{
+		Destroy();
+		throw;
+	}
+}
+
+Window::~Window()
+{
+	Destroy();
+}
+
+void Window::CreateOnMessageThread(const wchar_t* InName)
+{
+	MessageEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	if (!MessageEvent)
+	{
+		throw HRESULT_LAST_EXCEPTION();
+	}
+
+	std::promise<void> Created;
+	auto CreatedFuture = Created.get_future();
+
+	MessageThread = std::thread([this, InName, &Created]
+	{
+		try
+		{
+			Create(InName);
+		}
+		catch (...)
+		{
+			Created.set_exception(std::current_exception());
+			return;
+		}
+
+		Created.set_value();
+		RunMessageLoop();
+	});
+
+	try
+	{
+		CreatedFuture.get();
+	}
+	catch (...)
+	{
+		MessageThread.join();
+		CloseHandle(MessageEvent);
+		throw;
+	}
+}
+
+void Window::Create(const wchar_t* InName)
+{
+	STARTUP_PHASE("Window");
 	RECT WindowRect;
 	WindowRect.left = 0;
-	WindowRect.right = InWidth + WindowRect.left;
+	WindowRect.right = Width + WindowRect.left;
 	WindowRect.top = 0;
-	WindowRect.bottom = InHeight + WindowRect.top;
+	WindowRect.bottom = Height + WindowRect.top;
 
-	if (!AdjustWindowRect(&WindowRect, WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU, FALSE))
+	if (!AdjustWindowRect(&WindowRect, WS_OVERLAPPEDWINDOW, FALSE))
 	{
 		throw HRESULT_LAST_EXCEPTION();
 	}
@@ -66,7 +169,7 @@ Window::Window(const int InWidth, const int InHeight, const wchar_t* InName)
 	 * https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-createwindowexa
 	 * Create Window Instance
 	 */
-	Handle = CreateWindowEx(0, WindowClass::GetName(), InName, WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU, CW_USEDEFAULT,
+	Handle = CreateWindowEx(0, WindowClass::GetName(), InName, WS_OVERLAPPEDWINDOW, CW_USEDEFAULT,
 	                        CW_USEDEFAULT, WindowRect.right - WindowRect.left, WindowRect.bottom - WindowRect.top,
 	                        nullptr, nullptr, WindowClassInstance.GetHandleInstance(), this);
 
@@ -93,19 +196,93 @@ Window::Window(const int InWidth, const int InHeight, const wchar_t* InName)
 	}
 
 	ImGui_ImplWin32_Init(Handle);
-	MyGraphics = std::make_unique<Graphics>(Handle, InWidth, InHeight);
 }
 
-Window::~Window()
+void Window::MakeBorderless(const UINT InOutputIndex)
 {
-	ImGui_ImplWin32_Shutdown();
-	DestroyWindow(Handle);
+	const auto& Outputs = MyGraphics->GetOutputs();
+	RECT Covered;
+
+	if (InOutputIndex < Outputs.size())
+	{
+		Covered = Outputs[InOutputIndex].DesktopRect;
+	}
+	else
+	{
+		// Adapters such as WARP list no outputs, the monitor the window opened on stands in.
+		MONITORINFO Monitor {};
+		Monitor.cbSize = sizeof(Monitor);
+
+		if (!GetMonitorInfo(MonitorFromWindow(Handle, MONITOR_DEFAULTTOPRIMARY), &Monitor))
+		{
+			throw HRESULT_LAST_EXCEPTION();
+		}
+
+		Covered = Monitor.rcMonitor;
+	}
+
+	SetWindowLongPtr(Handle, GWL_STYLE, WS_POPUP | WS_VISIBLE);
+
+	// Not topmost, so other windows still come to the front. Whenever one covers it, DWM composes it again.
+	if (!SetWindowPos(Handle, HWND_TOP, Covered.left, Covered.top, Covered.right - Covered.left, Covered.bottom - Covered.top,
+	                  SWP_FRAMECHANGED | SWP_NOOWNERZORDER))
+	{
+		throw HRESULT_LAST_EXCEPTION();
+	}
+}
+
+void Window::Destroy() noexcept
+{
+	// The swap chain goes before the window it presents to.
+	MyGraphics.reset();
+
+	if (bUsesMessageThread)
+	{
+		PostMessage(Handle, DestroyMessage, 0, 0);
+		MessageThread.join();
+		CloseHandle(MessageEvent);
+	}
+	else
+	{
+		ImGui_ImplWin32_Shutdown();
+		DestroyWindow(Handle);
+	}
 }
 
-std::optional<int> Window::ProcessMessages()
+void Window::RunMessageLoop() noexcept
 {
 	MSG Message;
 
+	// Blocks until something arrives, the thread has nothing else to do.
+	while (GetMessage(&Message, nullptr, 0, 0) > 0)
+	{
+		TranslateMessage(&Message);
+		DispatchMessage(&Message);
+	}
+}
+
+std::optional<int> Window::ProcessMessages(const DWORD InMaxWait)
+{
+	PROFILE_SCOPE("Window::ProcessMessages");
+
+	if (bUsesMessageThread)
+	{
+		if (InMaxWait > 0u)
+		{
+			WaitForSingleObject(MessageEvent, InMaxWait);
+		}
+
+		return bIsQuitRequested.load(std::memory_order_acquire) ? std::optional{0} : std::nullopt;
+	}
+
+	if (InMaxWait > 0u)
+	{
+		// https://learn.microsoft.com/en-us/windows/win32/api/winuser/nf-winuser-msgwaitformultipleobjectsex
+		MsgWaitForMultipleObjectsEx(0u, nullptr, InMaxWait, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+	}
+
+	MSG Message;
+
 	while (PeekMessage(&Message, nullptr, 0, 0, PM_REMOVE))
 	{
 		if (Message.message == WM_QUIT)
@@ -120,6 +297,23 @@ std::optional<int> Window::ProcessMessages()
 	return std::nullopt;
 }
 
+bool Window::ApplyResize()
+{
+	const auto Requested = RequestedSize.exchange(0u, std::memory_order_acquire);
+	const auto NewWidth = static_cast<int>(Requested >> 32u);
+	const auto NewHeight = static_cast<int>(Requested & 0xFFFFFFFFu);
+
+	// Moving the window ends a size move too, and a zero sized client area has nothing to render to.
+	if (!MyGraphics || NewWidth == 0 || NewHeight == 0 ||
+		(static_cast<float>(NewWidth) == MyGraphics->GetDisplayViewport().Width && static_cast<float>(NewHeight) == MyGraphics->GetDisplayViewport().Height))
+	{
+		return false;
+	}
+
+	MyGraphics->Resize(NewWidth, NewHeight);
+	return true;
+}
+
 Graphics& Window::GetGraphics() const
 {
 	if (!MyGraphics)
@@ -133,17 +327,15 @@ Graphics& Window::GetGraphics() const
 void Window::EnableCursor()
 {
 	bIsCursorEnabled = true;
-	ShowCursor();
 	EnableImGuiMouseInput();
-	FreeCursor();
+	UpdateCursor();
 }
 
 void Window::DisableCursor()
 {
 	bIsCursorEnabled = false;
-	HideCursor();
 	DisableImGuiMouseInput();
-	TrapCursor();
+	UpdateCursor();
 }
 
 bool Window::IsCursorEnabled()
@@ -173,20 +365,101 @@ LRESULT WINAPI Window::HandleMessageThunk(HWND hWnd, UINT msg, WPARAM wParam, LP
 
 LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
-	if (ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam))
+	ALLOCATION_SCOPE(Input);
+
+	if (bUsesMessageThread)
 	{
-		return true;
+		SetEvent(MessageEvent);
 	}
 
-	const auto& ImGuiIO = ImGui::GetIO();
+	bool bWantCaptureKeyboard;
+	bool bWantCaptureMouse;
+
+	{
+		std::scoped_lock Lock {ImGuiManager::GetInputMutex()};
+
+		if (ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam))
+		{
+			return true;
+		}
+
+		const auto& ImGuiIO = ImGui::GetIO();
+		bWantCaptureKeyboard = ImGuiIO.WantCaptureKeyboard;
+		bWantCaptureMouse = ImGuiIO.WantCaptureMouse;
+
+		// Keys only matter while a window has keyboard focus, the cursor whenever ImGui is allowed to see it.
+		if ((msg >= WM_MOUSEFIRST && msg <= WM_MOUSELAST && !(ImGuiIO.ConfigFlags & ImGuiConfigFlags_NoMouse)) ||
+			(msg >= WM_KEYFIRST && msg <= WM_KEYLAST && bWantCaptureKeyboard))
+		{
+			ImGuiManager::NotifyInput();
+		}
+	}
 
 	switch (msg)
 	{
 	case WM_CLOSE:
 		{
+			// The message thread keeps pumping until the render loop is done with the window and destroys it.
+			if (bUsesMessageThread)
+			{
+				bIsQuitRequested.store(true, std::memory_order_release);
+			}
+			else
+			{
+				PostQuitMessage(0);
+			}
+
+			return 0;
+		}
+	case DestroyMessage:
+		{
+			ImGui_ImplWin32_Shutdown();
+			DestroyWindow(hWnd);
 			PostQuitMessage(0);
 			return 0;
 		}
+	case ApplyCursorMessage:
+		{
+			ApplyCursorState();
+			return 0;
+		}
+	// https://learn.microsoft.com/en-us/windows/win32/winmsg/wm-size
+	case WM_SIZE:
+		{
+			bIsMinimized.store(wParam == SIZE_MINIMIZED, std::memory_order_relaxed);
+
+			if (wParam == SIZE_MINIMIZED)
+			{
+				break;
+			}
+
+			Width = LOWORD(lParam);
+			Height = HIWORD(lParam);
+
+			if (!bIsCursorEnabled)
+			{
+				TrapCursor();
+			}
+
+			// A drag sends one for every step, maximizing and restoring just the one.
+			if (!bIsSizing)
+			{
+				RequestedSize.store(static_cast<uint64_t>(Width) << 32u | static_cast<uint32_t>(Height), std::memory_order_release);
+			}
+		}
+		break;
+	// https://learn.microsoft.com/en-us/windows/win32/winmsg/wm-entersizemove
+	case WM_ENTERSIZEMOVE:
+		{
+			bIsSizing = true;
+		}
+		break;
+	case WM_EXITSIZEMOVE:
+		{
+			bIsSizing = false;
+			RequestedSize.store(static_cast<uint64_t>(Width) << 32u | static_cast<uint32_t>(Height), std::memory_order_release);
+		}
+		break;
 	// https://learn.microsoft.com/en-us/windows/win32/inputdev/wm-killfocus
 	case WM_KILLFOCUS:
 		{
@@ -215,7 +488,7 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	// https://learn.microsoft.com/en-us/windows/win32/inputdev/wm-syskeydown
 	case WM_SYSKEYDOWN:
 		{
-			if (ImGuiIO.WantCaptureKeyboard) { break; }
+			if (bWantCaptureKeyboard) { break; }
 
 			// AutoRepeat가 활성화 되지 않았으면 꾹 누르고 있을 때 보내지는 메시지(30번 째 비트가 1)는 처리하지 않는다.
 			if (!MyKeyboard.IsAutoRepeatEnabled() && lParam & 0x40000000) { break; }
@@ -227,14 +500,14 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	// https://learn.microsoft.com/en-us/windows/win32/inputdev/wm-syskeyup
 	case WM_SYSKEYUP:
 		{
-			if (ImGuiIO.WantCaptureKeyboard) { break; }
+			if (bWantCaptureKeyboard) { break; }
 			MyKeyboard.OnKeyReleased(static_cast<unsigned char>(wParam));
 		}
 		break;
 	// https://learn.microsoft.com/en-us/windows/win32/inputdev/wm-char
 	case WM_CHAR:
 		{
-			if (ImGuiIO.WantCaptureKeyboard) { break; }
+			if (bWantCaptureKeyboard) { break; }
 			MyKeyboard.OnChar(static_cast<unsigned char>(wParam));
 		}
 		break;
@@ -254,7 +527,7 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				break;
 			}
 
-			if (ImGuiIO.WantCaptureMouse) { break; }
+			if (bWantCaptureMouse) { break; }
 
 			if (X >= 0 && X < Width && Y >= 0 && Y < Height)
 			{
@@ -290,21 +563,21 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 				HideCursor();
 			}
 
-			if (ImGuiIO.WantCaptureMouse) { break; }
+			if (bWantCaptureMouse) { break; }
 			const auto [X, Y] = MAKEPOINTS(lParam);
 			MyMouse.OnLeftPressed(X, Y);
 		}
 		break;
 	case WM_RBUTTONDOWN:
 		{
-			if (ImGuiIO.WantCaptureMouse) { break; }
+			if (bWantCaptureMouse) { break; }
 			const auto [X, Y] = MAKEPOINTS(lParam);
 			MyMouse.OnRightPressed(X, Y);
 		}
 		break;
 	case WM_LBUTTONUP:
 		{
-			if (ImGuiIO.WantCaptureMouse) { break; }
+			if (bWantCaptureMouse) { break; }
 			const auto [X, Y] = MAKEPOINTS(lParam);
 			MyMouse.OnLeftReleased(X, Y);
 
@@ -317,7 +590,7 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		break;
 	case WM_RBUTTONUP:
 		{
-			if (ImGuiIO.WantCaptureMouse) { break; }
+			if (bWantCaptureMouse) { break; }
 			const auto [X, Y] = MAKEPOINTS(lParam);
 			MyMouse.OnRightReleased(X, Y);
 
@@ -330,7 +603,7 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		break;
 	case WM_MOUSEWHEEL:
 		{
-			if (ImGuiIO.WantCaptureMouse) { break; }
+			if (bWantCaptureMouse) { break; }
 			const auto [X, Y] = MAKEPOINTS(lParam);
 			MyMouse.OnWheelDelta(X, Y, GET_WHEEL_DELTA_WPARAM(wParam));
 		}
@@ -339,47 +612,110 @@ LRESULT Window::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		{
 			if (!MyMouse.IsRawInputEnabled()) { break; }
 
-			UINT Size;
+			ReadRawInput(reinterpret_cast<HRAWINPUT>(lParam));
+		}
+		break;
+	}
 
-			if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_INPUT, nullptr, &Size, sizeof(RAWINPUTHEADER)) == -1)
-			{
-				break;
-			}
+	return DefWindowProc(hWnd, msg, wParam, lParam);
+}
 
-			RawBuffer.resize(Size);
+void Window::ReadRawInput(const HRAWINPUT InHandle)
+{
+	int DeltaX = 0;
+	int DeltaY = 0;
 
-			if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_INPUT, RawBuffer.data(), &Size, sizeof(RAWINPUTHEADER)) != Size)
-			{
-				break;
-			}
+	// Only mice are registered, so a single RAWINPUT always holds the input of this message.
+	RAWINPUT Input;
+	UINT Size = sizeof(Input);
 
-			if (const auto& [Header, Data] = reinterpret_cast<const RAWINPUT&>(*RawBuffer.data()); Header.dwType == RIM_TYPEMOUSE && (Data.mouse.lLastX != 0 || Data.mouse.lLastY != 0))
-			{
-				if ((Data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE) == MOUSE_MOVE_ABSOLUTE)
-				{
-					static DirectX::XMFLOAT3 LastPosition {FLT_MAX, FLT_MAX, FLT_MAX};
-					const bool bIsVirtualDesktop = (Data.mouse.usFlags & MOUSE_VIRTUAL_DESKTOP) == MOUSE_VIRTUAL_DESKTOP;
-					const int Width = GetSystemMetrics(bIsVirtualDesktop ? SM_CXVIRTUALSCREEN : SM_CXSCREEN);
-					const int Height = GetSystemMetrics(bIsVirtualDesktop ? SM_CYVIRTUALSCREEN : SM_CYSCREEN);
-					const DirectX::XMFLOAT3 AbsolutePosition {Data.mouse.lLastX / static_cast<float>(USHRT_MAX) * Width, Data.mouse.lLastY / static_cast<float>(USHRT_MAX) * Height, 0};
-
-					if (LastPosition.x != FLT_MAX || LastPosition.y != FLT_MAX || LastPosition.z != FLT_MAX)
-					{
-						MyMouse.OnRawDelta(static_cast<int>(AbsolutePosition.x - LastPosition.x), static_cast<int>(AbsolutePosition.y - LastPosition.y));
-					}
-
-					LastPosition = AbsolutePosition;
-				}
-				else
-				{
-					MyMouse.OnRawDelta(Data.mouse.lLastX, Data.mouse.lLastY);
-				}
-			}
+	if (GetRawInputData(InHandle, RID_INPUT, &Input, &Size, sizeof(RAWINPUTHEADER)) != static_cast<UINT>(-1))
+	{
+		AccumulateRawInput(Input, DeltaX, DeltaY);
+	}
+
+	// Everything queued behind this message in a few calls instead of one message each, high-rate mice send hundreds a frame.
+	while (true)
+	{
+		UINT BatchSize = static_cast<UINT>(RawInputBatch.size() * sizeof(RAWINPUT));
+		const UINT InputNum = GetRawInputBuffer(RawInputBatch.data(), &BatchSize, sizeof(RAWINPUTHEADER));
+
+		if (InputNum == 0u || InputNum == static_cast<UINT>(-1))
+		{
+			break;
+		}
+
+		const RAWINPUT* BatchInput = RawInputBatch.data();
+
+		for (UINT Index = 0u; Index < InputNum; ++Index, BatchInput = NEXTRAWINPUTBLOCK(BatchInput))
+		{
+			AccumulateRawInput(*BatchInput, DeltaX, DeltaY);
 		}
-		break;
 	}
 
-	return DefWindowProc(hWnd, msg, wParam, lParam);
+	// One delta for the whole batch, the camera only cares about the sum.
+	if (DeltaX != 0 || DeltaY != 0)
+	{
+		MyMouse.OnRawDelta(DeltaX, DeltaY);
+	}
+}
+
+void Window::AccumulateRawInput(const RAWINPUT& InInput, int& OutDeltaX, int& OutDeltaY)
+{
+	const auto& [Header, Data] = InInput;
+
+	if (Header.dwType != RIM_TYPEMOUSE || (Data.mouse.lLastX == 0 && Data.mouse.lLastY == 0))
+	{
+		return;
+	}
+
+	if ((Data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE) == MOUSE_MOVE_ABSOLUTE)
+	{
+		const bool bIsVirtualDesktop = (Data.mouse.usFlags & MOUSE_VIRTUAL_DESKTOP) == MOUSE_VIRTUAL_DESKTOP;
+		const int ScreenWidth = GetSystemMetrics(bIsVirtualDesktop ? SM_CXVIRTUALSCREEN : SM_CXSCREEN);
+		const int ScreenHeight = GetSystemMetrics(bIsVirtualDesktop ? SM_CYVIRTUALSCREEN : SM_CYSCREEN);
+		const DirectX::XMFLOAT2 AbsolutePosition {Data.mouse.lLastX / static_cast<float>(USHRT_MAX) * ScreenWidth, Data.mouse.lLastY / static_cast<float>(USHRT_MAX) * ScreenHeight};
+
+		if (LastAbsolutePosition)
+		{
+			OutDeltaX += static_cast<int>(AbsolutePosition.x - LastAbsolutePosition->x);
+			OutDeltaY += static_cast<int>(AbsolutePosition.y - LastAbsolutePosition->y);
+		}
+
+		LastAbsolutePosition = AbsolutePosition;
+	}
+	else
+	{
+		OutDeltaX += Data.mouse.lLastX;
+		OutDeltaY += Data.mouse.lLastY;
+	}
+}
+
+void Window::UpdateCursor()
+{
+	// ShowCursor keeps a display count per thread, only the thread owning the window changes what is shown over it.
+	if (bUsesMessageThread)
+	{
+		PostMessage(Handle, ApplyCursorMessage, 0, 0);
+	}
+	else
+	{
+		ApplyCursorState();
+	}
+}
+
+void Window::ApplyCursorState()
+{
+	if (bIsCursorEnabled)
+	{
+		ShowCursor();
+		FreeCursor();
+	}
+	else
+	{
+		HideCursor();
+		TrapCursor();
+	}
 }
 
 void Window::ShowCursor()
@@ -1,5 +1,10 @@
 ﻿#pragma once
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
 #include "EngineWin.h"
 #include "Graphics.h"
 #include "Keyboard.h"
@@ -33,7 +38,11 @@ class Window
 friend class WindowClass;
 
 public:
-	Window(int InWidth, int InHeight, const wchar_t* InName);
+	/**
+	 * With a message thread the window is created and pumped on its own thread, so input keeps flowing during long frames,
+	 * window drags and a blocking Present. The thread never waits on the render loop, which DXGI requires of it.
+	 */
+	Window(int InWidth, int InHeight, const wchar_t* InName, bool bInUseMessageThread = false, const SwapChainSettings& InSettings = {});
 	Window(const Window&) = delete;
 	Window(Window&&) = delete;
 	Window& operator=(const Window&) = delete;
@@ -45,10 +54,32 @@ public:
 	void DisableCursor();
 	bool IsCursorEnabled();
 
-	static std::optional<int> ProcessMessages();
+	// Pumps the calling thread's queue, or only reports a close request when the message thread does the pumping.
+	// A nonzero InMaxWait first sleeps until a message arrives or that many milliseconds pass, how an idle loop waits.
+	std::optional<int> ProcessMessages(DWORD InMaxWait = 0u);
+
+	[[nodiscard]] bool IsMinimized() const noexcept
+	{
+		return bIsMinimized.load(std::memory_order_relaxed);
+	}
+
+	// Resizes the graphics to the client area once a resize has ended, on the render loop's thread between frames. A drag
+	// only resizes when it is released, the swap chain stretches the old buffers until then. True when it resized.
+	bool ApplyResize();
 
 private:
+	void Create(const wchar_t* InName);
+	// Windows deliver messages to the thread that created them, so the message thread has to be the one creating it.
+	void CreateOnMessageThread(const wchar_t* InName);
+	// A popup covering the output, resized to it by the next ApplyResize.
+	void MakeBorderless(UINT InOutputIndex);
+	void Destroy() noexcept;
+	void RunMessageLoop() noexcept;
 	LRESULT HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+	void ReadRawInput(HRAWINPUT InHandle);
+	void AccumulateRawInput(const RAWINPUT& InInput, int& OutDeltaX, int& OutDeltaY);
+	void UpdateCursor();
+	void ApplyCursorState();
 	void ShowCursor();
 	void HideCursor();
 	void TrapCursor();
@@ -64,12 +95,30 @@ public:
 	Mouse MyMouse;
 
 private:
+	// Posted to the thread that owns the window, the only one its cursor and DestroyWindow act on.
+	static constexpr UINT ApplyCursorMessage {WM_APP};
+	static constexpr UINT DestroyMessage {WM_APP + 1u};
+	static constexpr size_t RawInputBatchSize {64u};
+
 	static inline WindowClass WindowClassInstance;
 
 	std::unique_ptr<Graphics> MyGraphics;
-	std::vector<byte> RawBuffer;
-	HWND Handle;
+	// Allocated once, GetRawInputBuffer fills it on every batch.
+	std::vector<RAWINPUT> RawInputBatch = std::vector<RAWINPUT>(RawInputBatchSize);
+	// For tablets and remote desktops, which report absolute positions instead of motion.
+	std::optional<DirectX::XMFLOAT2> LastAbsolutePosition;
+	HWND Handle {nullptr};
 	int Width;
 	int Height;
-	bool bIsCursorEnabled {true};
+	const bool bUsesMessageThread;
+	std::thread MessageThread;
+	std::atomic<bool> bIsQuitRequested {false};
+	std::atomic<bool> bIsMinimized {false};
+	// Between WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE, only read by the thread that owns the window.
+	bool bIsSizing {false};
+	// The client size the window last settled at, width in the upper half, zero once ApplyResize took it.
+	std::atomic<uint64_t> RequestedSize {0u};
+	// Signaled by the message thread on every message, what ProcessMessages sleeps on in its place.
+	HANDLE MessageEvent {nullptr};
+	std::atomic<bool> bIsCursorEnabled {true};
 };
\ No newline at end of file
@@ -0,0 +1,306 @@
+﻿#include "WorldStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+#include <utility>
+#include "AllocationTracker.h"
+#include "DebugDraw.h"
+#include "FrameProfiler.h"
+#include "Graphics.h"
+#include "Mesh.h"
+
+WorldStreamer::WorldStreamer(const std::filesystem::path& InFileName, const Settings& InSettings)
+	: World(InFileName)
+	, MySettings(InSettings)
+	, Importers(World.GetModelNum(), nullptr)
+{
+	for (uint32_t Index = 0u; Index < static_cast<uint32_t>(World.GetInstanceNum()); ++Index)
+	{
+		const auto& Placement = World.GetInstance(Index).RootTransform;
+		const auto X = static_cast<int>(std::floor(Placement._41 / MySettings.CellSize));
+		const auto Z = static_cast<int>(std::floor(Placement._43 / MySettings.CellSize));
+		const auto [Found, bIsNew] = CellIndices.try_emplace(MakeKey(X, Z), static_cast<uint32_t>(Cells.size()));
+
+		if (bIsNew)
+		{
+			Cells.push_back({X, Z, Placement._42, Placement._42});
+		}
+
+		auto& Owner = Cells[Found->second];
+		Owner.MinY = std::min(Owner.MinY, Placement._42);
+		Owner.MaxY = std::max(Owner.MaxY, Placement._42);
+		Owner.Instances.push_back(Index);
+	}
+}
+
+WorldStreamer::~WorldStreamer() = default;
+
+void WorldStreamer::Update(const Graphics& InGraphics, const DirectX::XMFLOAT3& InViewPosition)
+{
+	PROFILE_SCOPE("WorldStreamer::Update");
+	ALLOCATION_SCOPE(Streaming);
+
+	unsigned int LoadingCellNum = 0u;
+
+	for (const auto Index : ActiveCells)
+	{
+		auto& Streamed = Cells[Index];
+
+		if (Streamed.State != CellState::Loading)
+		{
+			continue;
+		}
+
+		bool bIsDone = true;
+
+		for (const auto& Member : Streamed.Loaded)
+		{
+			Member->Update();
+			bIsDone &= Member->IsReady();
+		}
+
+		if (!bIsDone)
+		{
+			++LoadingCellNum;
+			continue;
+		}
+
+		// Loaded instances are shared from synchronously, only pending ones are worth waiting on.
+		for (const auto& Member : Streamed.Loaded)
+		{
+			std::replace(Importers.begin(), Importers.end(), static_cast<const ModelInstance*>(Member.get()), static_cast<const ModelInstance*>(nullptr));
+		}
+
+		LoadingBytes -= Streamed.EstimatedBytes;
+		Streamed.Bytes = MeasureBytes(Streamed);
+		Streamed.bWasLoaded = true;
+		Streamed.State = CellState::Resident;
+		ResidentBytes += Streamed.Bytes;
+		++ResidentCellNum;
+	}
+
+	// Resident instances of a model hot reload imported again move over to the new import.
+	if (InGraphics.GetAssetReloader())
+	{
+		for (const auto Index : ActiveCells)
+		{
+			if (Cells[Index].State == CellState::Resident)
+			{
+				for (const auto& Member : Cells[Index].Loaded)
+				{
+					Member->ApplyReload(InGraphics);
+				}
+			}
+		}
+	}
+
+	// Maps stream their mips in after the load, so one cell a frame is measured again and the total follows them.
+	if (!ActiveCells.empty())
+	{
+		if (auto& Measured = Cells[ActiveCells[MeasureCursor++ % ActiveCells.size()]]; Measured.State == CellState::Resident)
+		{
+			ResidentBytes -= Measured.Bytes;
+			Measured.Bytes = MeasureBytes(Measured);
+			ResidentBytes += Measured.Bytes;
+		}
+	}
+
+	// Loading cells are kept until they are done, dropping them would wait on their imports here.
+	std::erase_if(ActiveCells, [&](const uint32_t InIndex)
+	{
+		auto& Streamed = Cells[InIndex];
+
+		if (Streamed.State != CellState::Resident || GetDistance(Streamed, InViewPosition) <= MySettings.UnloadRadius)
+		{
+			return false;
+		}
+
+		Unload(Streamed);
+		return true;
+	});
+
+	// Mips streamed in past the budget.
+	MakeRoom(0u, 0.0f, InViewPosition);
+
+	// Only the cells under the load radius are looked up, however many the world has.
+	std::vector<std::pair<float, uint32_t>> Candidates;
+	const auto FirstX = static_cast<int>(std::floor((InViewPosition.x - MySettings.LoadRadius) / MySettings.CellSize));
+	const auto LastX = static_cast<int>(std::floor((InViewPosition.x + MySettings.LoadRadius) / MySettings.CellSize));
+	const auto FirstZ = static_cast<int>(std::floor((InViewPosition.z - MySettings.LoadRadius) / MySettings.CellSize));
+	const auto LastZ = static_cast<int>(std::floor((InViewPosition.z + MySettings.LoadRadius) / MySettings.CellSize));
+
+	for (auto Z = FirstZ; Z <= LastZ; ++Z)
+	{
+		for (auto X = FirstX; X <= LastX; ++X)
+		{
+			if (const auto Found = CellIndices.find(MakeKey(X, Z)); Found != CellIndices.end() && Cells[Found->second].State == CellState::Unloaded)
+			{
+				if (const auto Distance = GetDistance(Cells[Found->second], InViewPosition); Distance <= MySettings.LoadRadius)
+				{
+					Candidates.emplace_back(Distance, Found->second);
+				}
+			}
+		}
+	}
+
+	std::sort(Candidates.begin(), Candidates.end());
+
+	for (const auto& [Distance, Index] : Candidates)
+	{
+		if (LoadingCellNum == MySettings.MaxLoadingCellNum)
+		{
+			break;
+		}
+
+		auto& Streamed = Cells[Index];
+		const auto Needed = EstimateBytes(Streamed);
+
+		// Farther candidates are no more likely to fit, and would take the place of this one.
+		if (!MakeRoom(Needed, Distance, InViewPosition))
+		{
+			break;
+		}
+
+		Streamed.EstimatedBytes = Needed;
+		LoadingBytes += Needed;
+		StartLoading(InGraphics, Streamed);
+		ActiveCells.push_back(Index);
+		++LoadingCellNum;
+	}
+}
+
+void WorldStreamer::Submit(const Graphics& InGraphics) const
+{
+	PROFILE_SCOPE("WorldStreamer::Submit");
+
+	for (const auto Index : ActiveCells)
+	{
+		for (const auto& Member : Cells[Index].Loaded)
+		{
+			Member->Submit(InGraphics);
+			Member->SubmitShadowCasters(InGraphics);
+			Member->SubmitPickCandidates(InGraphics);
+		}
+	}
+}
+
+void WorldStreamer::DrawBounds(const Graphics& InGraphics) const
+{
+	auto& Lines = InGraphics.GetDebugDraw();
+
+	for (const auto Index : ActiveCells)
+	{
+		const auto& Streamed = Cells[Index];
+		const auto HalfSize = 0.5f * MySettings.CellSize;
+		const DirectX::BoundingBox Bounds {{(static_cast<float>(Streamed.X) + 0.5f) * MySettings.CellSize, 0.5f * (Streamed.MinY + Streamed.MaxY),
+		                                    (static_cast<float>(Streamed.Z) + 0.5f) * MySettings.CellSize},
+		                                   {HalfSize, 0.5f * (Streamed.MaxY - Streamed.MinY) + 1.0f, HalfSize}};
+		Lines.Box(Bounds, Streamed.State == CellState::Resident ? DirectX::XMFLOAT4 {0.0f, 1.0f, 0.0f, 1.0f} : DirectX::XMFLOAT4 {1.0f, 1.0f, 0.0f, 1.0f});
+
+		for (const auto& Member : Streamed.Loaded)
+		{
+			Member->DrawBounds(InGraphics);
+		}
+	}
+}
+
+WorldStreamer::Statistics WorldStreamer::GetStatistics() const noexcept
+{
+	return {static_cast<unsigned int>(Cells.size()), ResidentCellNum, static_cast<unsigned int>(ActiveCells.size()) - ResidentCellNum, ResidentBytes};
+}
+
+uint64_t WorldStreamer::MakeKey(const int InX, const int InZ) noexcept
+{
+	return static_cast<uint64_t>(static_cast<uint32_t>(InX)) << 32u | static_cast<uint32_t>(InZ);
+}
+
+size_t WorldStreamer::MeasureBytes(const Cell& InCell)
+{
+	// The cell's instances share the assets of a model, cells sharing one each count it in full.
+	std::unordered_set<const ModelAsset*> Counted;
+	size_t Bytes = 0u;
+
+	for (const auto& Member : InCell.Loaded)
+	{
+		if (Counted.insert(Member->GetAsset().get()).second)
+		{
+			Bytes += Member->GetAsset()->GetGpuByteSize();
+		}
+	}
+
+	return Bytes;
+}
+
+float WorldStreamer::GetDistance(const Cell& InCell, const DirectX::XMFLOAT3& InViewPosition) const noexcept
+{
+	const auto MinX = static_cast<float>(InCell.X) * MySettings.CellSize;
+	const auto MinZ = static_cast<float>(InCell.Z) * MySettings.CellSize;
+	const auto DeltaX = std::max({MinX - InViewPosition.x, 0.0f, InViewPosition.x - MinX - MySettings.CellSize});
+	const auto DeltaZ = std::max({MinZ - InViewPosition.z, 0.0f, InViewPosition.z - MinZ - MySettings.CellSize});
+	return std::sqrt(DeltaX * DeltaX + DeltaZ * DeltaZ);
+}
+
+size_t WorldStreamer::EstimateBytes(const Cell& InCell) const noexcept
+{
+	if (InCell.bWasLoaded)
+	{
+		return InCell.Bytes;
+	}
+
+	return ResidentCellNum > 0u ? ResidentBytes / ResidentCellNum : 0u;
+}
+
+void WorldStreamer::StartLoading(const Graphics& InGraphics, Cell& InOutCell)
+{
+	InOutCell.State = CellState::Loading;
+	InOutCell.Loaded.reserve(InOutCell.Instances.size());
+
+	for (const auto Index : InOutCell.Instances)
+	{
+		auto*& Importer = Importers[World.GetInstance(Index).Model];
+		InOutCell.Loaded.push_back(World.LoadInstance(InGraphics, Index, Importer));
+
+		if (!Importer)
+		{
+			Importer = InOutCell.Loaded.back().get();
+		}
+	}
+}
+
+void WorldStreamer::Unload(Cell& InOutCell)
+{
+	// An asset no other cell holds is freed with the last of its instances, its bindables once the cache's grace period is over.
+	InOutCell.Loaded.clear();
+	InOutCell.Loaded.shrink_to_fit();
+	InOutCell.State = CellState::Unloaded;
+	ResidentBytes -= InOutCell.Bytes;
+	--ResidentCellNum;
+}
+
+bool WorldStreamer::MakeRoom(const size_t InBytes, const float InNearerThan, const DirectX::XMFLOAT3& InViewPosition)
+{
+	while (ResidentBytes + LoadingBytes + InBytes > MySettings.MemoryBudget)
+	{
+		auto Farthest = ActiveCells.end();
+		auto FarthestDistance = std::max(InNearerThan, MySettings.LoadRadius);
+
+		for (auto Active = ActiveCells.begin(); Active != ActiveCells.end(); ++Active)
+		{
+			if (const auto Distance = GetDistance(Cells[*Active], InViewPosition); Cells[*Active].State == CellState::Resident && Distance > FarthestDistance)
+			{
+				Farthest = Active;
+				FarthestDistance = Distance;
+			}
+		}
+
+		if (Farthest == ActiveCells.end())
+		{
+			return false;
+		}
+
+		Unload(Cells[*Farthest]);
+		ActiveCells.erase(Farthest);
+	}
+
+	return true;
+}
@@ -0,0 +1,116 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <DirectXMath.h>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "SceneFile.h"
+
+class Graphics;
+class ModelInstance;
+
+/**
+ * Streams a scene file too large to load at once, in square cells of the ground plane around the camera, each holding the
+ * instances placed inside it. A cell starts loading, nearest first, when its edge comes within LoadRadius of the camera, and is
+ * dropped once it is farther than UnloadRadius, so a camera on its edge doesn't load and drop it every frame. Instances still in
+ * flight show their placeholders where they will stand.
+ * The resident cells' models are kept within a GPU memory budget. A cell is only started when what it took the last time, or the
+ * resident cells' average before it ever was loaded, still fits, and cells between the two radii are dropped, farthest first, to
+ * make room for nearer ones. Cells that aren't loaded cost only their entry in the cell table and the file's mapping.
+ */
+class WorldStreamer
+{
+public:
+	struct Settings
+	{
+		float CellSize {32.0f};
+		float LoadRadius {64.0f};
+		float UnloadRadius {96.0f};
+		size_t MemoryBudget {size_t {1024u} << 20u};
+		// More keeps more workers importing, but delays the nearest cells behind farther ones.
+		unsigned int MaxLoadingCellNum {4u};
+	};
+
+	struct Statistics
+	{
+		unsigned int CellNum;
+		unsigned int ResidentCellNum;
+		unsigned int LoadingCellNum;
+		size_t ResidentBytes;
+	};
+
+	// A missing or malformed file streams nothing, see IsValid.
+	WorldStreamer(const std::filesystem::path& InFileName, const Settings& InSettings);
+	WorldStreamer(const WorldStreamer&) = delete;
+	WorldStreamer(WorldStreamer&&) = delete;
+	WorldStreamer& operator=(const WorldStreamer&) = delete;
+	WorldStreamer& operator=(WorldStreamer&&) = delete;
+	~WorldStreamer();
+
+	// Once per frame on the main thread before Submit: finishes the loads that are done, then drops and starts cells around InViewPosition.
+	void Update(const Graphics& InGraphics, const DirectX::XMFLOAT3& InViewPosition);
+	// Every instance of the resident and loading cells, with its shadow casters and pick candidates.
+	void Submit(const Graphics& InGraphics) const;
+	// The loaded cells' bounds, green when resident and yellow while loading, and their instances' own.
+	void DrawBounds(const Graphics& InGraphics) const;
+
+	[[nodiscard]] bool IsValid() const noexcept
+	{
+		return World.IsValid();
+	}
+
+	[[nodiscard]] Statistics GetStatistics() const noexcept;
+
+private:
+	enum class CellState : uint8_t
+	{
+		Unloaded,
+		Loading,
+		Resident
+	};
+
+	struct Cell
+	{
+		int X;
+		int Z;
+		// Of the instances' origins, the debug bounds span them.
+		float MinY;
+		float MaxY;
+		std::vector<uint32_t> Instances;
+		std::vector<std::unique_ptr<ModelInstance>> Loaded;
+		// Measured while resident and kept once dropped, to tell whether the cell fits again.
+		size_t Bytes {0u};
+		// What the cell was counted at while loading.
+		size_t EstimatedBytes {0u};
+		bool bWasLoaded {false};
+		CellState State {CellState::Unloaded};
+	};
+
+	[[nodiscard]] static uint64_t MakeKey(int InX, int InZ) noexcept;
+	[[nodiscard]] static size_t MeasureBytes(const Cell& InCell);
+	// From the view to the nearest point of the cell on the ground plane.
+	[[nodiscard]] float GetDistance(const Cell& InCell, const DirectX::XMFLOAT3& InViewPosition) const noexcept;
+	[[nodiscard]] size_t EstimateBytes(const Cell& InCell) const noexcept;
+	void StartLoading(const Graphics& InGraphics, Cell& InOutCell);
+	void Unload(Cell& InOutCell);
+	// Drops resident cells between the radii and farther than InNearerThan, farthest first, until InBytes more fit the budget. False
+	// when they don't even then.
+	bool MakeRoom(size_t InBytes, float InNearerThan, const DirectX::XMFLOAT3& InViewPosition);
+
+private:
+	SceneFile World;
+	Settings MySettings;
+	std::vector<Cell> Cells;
+	std::unordered_map<uint64_t, uint32_t> CellIndices;
+	// The cells loading or resident, the only ones a frame walks.
+	std::vector<uint32_t> ActiveCells;
+	// Per model of the file, an instance still loading that the next instance of the model is loaded from, so each import runs once.
+	std::vector<const ModelInstance*> Importers;
+	size_t ResidentBytes {0u};
+	size_t LoadingBytes {0u};
+	unsigned int ResidentCellNum {0u};
+	// Which active cell is measured again this frame.
+	size_t MeasureCursor {0u};
+};